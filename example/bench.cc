@@ -25,11 +25,23 @@
 /// -t Throughput test
 /// -p Publish node
 /// -r Reply node
+/// -R Latency test at a fixed rate (msgs/s), instead of one message at a time
+/// -H Latency histogram output filename
+/// -s Latency samples output filename
 ///
 /// Choose one of [-l, -t], and one (or none for in-process
 /// testing) [-p,-r].
 ///
-/// See `latency.gp` and `throughput.gp` to plot output.
+/// By default the latency test sends a message once the previous one came
+/// back. In this closed loop a slow reply delays the next messages, so the
+/// delays they would have seen are never measured ("coordinated
+/// omission"). With -R the messages are sent at a fixed rate
+/// whatever the replies, and the latency is measured from the time each
+/// message was scheduled to be sent.
+///
+/// See `latency.gp` and `throughput.gp` to plot output. The histogram uses
+/// the percentile distribution format of HdrHistogram, which its plotter
+/// reads.
 //////////////////////////////////////////////////
 
 #ifdef __linux__
@@ -38,13 +50,17 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <iomanip>
 #include <chrono>
 #include <condition_variable>
 #include <csignal>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <thread>
 #include <mutex>
@@ -60,6 +76,9 @@ DEFINE_bool(p, false, "Publishing node");
 DEFINE_uint64(f, 0, "Flood the network with extra publishers and subscribers");
 DEFINE_uint64(i, 1000, "Number of iterations");
 DEFINE_string(o, "", "Output filename");
+DEFINE_uint64(R, 0, "Latency test rate in msgs/s, 0 for closed loop");
+DEFINE_string(H, "", "Latency histogram output filename");
+DEFINE_string(s, "", "Latency samples output filename");
 
 std::condition_variable gCondition;
 std::mutex gMutex;
@@ -301,6 +320,37 @@ class PubTester
     this->sentMsgs = _iters;
   }
 
+  /// \brief Set the rate of the latency test.
+  /// \param[in] _rate Messages per second, 0 to send a message once the
+  /// previous one came back.
+  public: void SetRate(const uint64_t _rate)
+  {
+    this->rate = _rate;
+  }
+
+  /// \brief Set the output filename of the latency histograms. Use empty
+  /// string to skip them.
+  /// \param[in] _filename Output filename
+  public: void SetHistogramFilename(const std::string &_filename)
+  {
+    this->histogramFilename = _filename;
+  }
+
+  /// \brief Set the output filename of the latency samples. Use empty
+  /// string to skip them.
+  /// \param[in] _filename Output filename
+  public: void SetSamplesFilename(const std::string &_filename)
+  {
+    this->samplesFilename = _filename;
+  }
+
+  /// \brief Set whether the replies come from another process.
+  /// \param[in] _interProcess True if the replier is another process.
+  public: void SetInterProcess(const bool _interProcess)
+  {
+    this->interProcess = _interProcess;
+  }
+
   /// \brief Create the publishers and subscribers.
   public: void Init()
   {
@@ -452,9 +502,14 @@ class PubTester
     }
   }
 
-  /// \brief Measure latency. The output contains two columns:
-  ///    1. Message size in bytes.
-  ///    2. Latency in microseconds.
+  /// \brief Measure latency. The output contains the columns:
+  ///    1. Test number.
+  ///    2. Message size in bytes.
+  ///    3-5. Average, minimum and maximum latency in microseconds.
+  ///    6-10. 50th, 90th, 99th, 99.9th and 99.99th percentiles of the
+  ///    latency in microseconds.
+  ///    11. Messages lost.
+  /// The latency is half of the round trip time.
   public: void Latency()
   {
     // Wait for subscriber
@@ -475,13 +530,33 @@ class PubTester
       stream = &fstream;
     }
 
+    std::ofstream histogramStream;
+    if (!this->histogramFilename.empty())
+    {
+      histogramStream.open(this->histogramFilename);
+      this->OutputHeader(&histogramStream);
+    }
+
+    std::ofstream samplesStream;
+    if (!this->samplesFilename.empty())
+    {
+      samplesStream.open(this->samplesFilename);
+      this->OutputHeader(&samplesStream);
+      samplesStream << "# Size(B)\tSeq\tScheduled_(ns)\tSent_(ns)"
+                    << "\tReceived_(ns)\n";
+    }
+
     this->OutputHeader(stream);
+    (*stream) << "# Mode: " << this->Mode() << ", "
+              << (this->rate > 0 ? "open loop at " +
+                  std::to_string(this->rate) + " msgs/s" : "closed loop")
+              << std::endl;
 
     // Column headers.
-    (*stream) << "# Test\tSize(B)\tAvg_(us)\tMin_(us)\tMax_(us)\n";
+    (*stream) << "# Test\tSize(B)\tAvg_(us)\tMin_(us)\tMax_(us)"
+              << "\tP50_(us)\tP90_(us)\tP99_(us)\tP99.9_(us)\tP99.99_(us)"
+              << "\tLost\n";
 
-    uint64_t maxLatency = 0;
-    uint64_t minLatency = std::numeric_limits<uint64_t>::max();
     int testNum = 1;
     // Iterate over each of the message sizes
     for (auto msgSize : this->msgSizes)
@@ -492,45 +567,219 @@ class PubTester
       // Create the message of the given size
       this->PrepMsg(msgSize);
 
-      uint64_t sum = 0;
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->samples.assign(this->sentMsgs, LatencySample());
+        this->replies = 0;
+      }
 
-      // Send each message.
-      for (int i = 0; i < this->sentMsgs && !this->stop; ++i)
+      if (this->rate > 0)
+        this->SendOpenLoop();
+      else
+        this->SendClosedLoop();
+
+      // Latencies in microseconds, from the scheduled send time.
+      std::vector<double> latencies;
+      uint64_t lost = 0;
       {
-        // Lock so that we wait on a condition variable.
-        std::unique_lock<std::mutex> lk(this->mutex);
+        std::lock_guard<std::mutex> lk(this->mutex);
+        for (uint64_t i = 0; i < this->samples.size(); ++i)
+        {
+          const LatencySample &sample = this->samples[i];
+          if (samplesStream.is_open())
+          {
+            samplesStream << this->dataSize << "\t" << i << "\t"
+                          << sample.scheduled << "\t" << sample.sent << "\t"
+                          << sample.received << "\n";
+          }
+
+          if (sample.received == 0)
+          {
+            ++lost;
+            continue;
+          }
+          latencies.push_back((sample.received - sample.scheduled) * 0.5e-3);
+        }
+      }
 
-        // Start the clock
-        auto timeStart = std::chrono::high_resolution_clock::now();
-        this->timeEnd = timeStart;
+      std::sort(latencies.begin(), latencies.end());
+      double sum = 0;
+      for (const double latency : latencies)
+        sum += latency;
 
-        // Send the message.
-        this->latencyPub.Publish(this->msg);
+      // Output data.
+      (*stream) << std::fixed << testNum++ << "\t" << this->dataSize << "\t"
+                << (latencies.empty() ? 0 : sum / latencies.size()) << "\t"
+                << Percentile(latencies, 0) << "\t"
+                << Percentile(latencies, 1) << "\t"
+                << Percentile(latencies, 0.5) << "\t"
+                << Percentile(latencies, 0.9) << "\t"
+                << Percentile(latencies, 0.99) << "\t"
+                << Percentile(latencies, 0.999) << "\t"
+                << Percentile(latencies, 0.9999) << "\t"
+                << lost << std::endl;
+
+      if (histogramStream.is_open())
+      {
+        histogramStream << "# Size(B): " << this->dataSize << std::endl;
+        OutputHistogram(latencies, histogramStream);
+      }
+    }
+  }
 
-        // Wait for the response.
-        this->condition.wait(lk, [this, &timeStart] {
-            return gStop || this->timeEnd > timeStart;});
+  /// \brief Send the latency messages one at a time, each one once the
+  /// previous one came back.
+  private: void SendClosedLoop()
+  {
+    for (uint64_t i = 0; i < this->sentMsgs && !this->stop; ++i)
+    {
+      // Lock so that we wait on a condition variable.
+      std::unique_lock<std::mutex> lk(this->mutex);
+
+      // Start the clock
+      this->samples[i].scheduled = this->samples[i].sent = Now();
+
+      // Send the message.
+      this->msg.mutable_header()->mutable_stamp()->set_sec(i);
+      this->latencyPub.Publish(this->msg);
 
-        // Compute the number of microseconds
-        uint64_t duration =
-          std::chrono::duration_cast<std::chrono::microseconds>(
-              this->timeEnd - timeStart).count();
+      // Wait for the response.
+      this->condition.wait(lk, [this, i] {
+          return gStop || this->samples[i].received != 0;});
+    }
+  }
 
-        if (duration > maxLatency)
-          maxLatency = duration;
-        if (duration < minLatency)
-          minLatency = duration;
+  /// \brief Send the latency messages at a fixed rate, without waiting for
+  /// the replies.
+  private: void SendOpenLoop()
+  {
+    const std::chrono::nanoseconds period(1000000000 / this->rate);
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < this->sentMsgs && !this->stop; ++i)
+    {
+      const auto scheduled = start + i * period;
+      std::this_thread::sleep_until(scheduled);
 
-        // Add to the sum of microseconds
-        sum += duration;
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->samples[i].scheduled = std::chrono::duration_cast<
+          std::chrono::nanoseconds>(scheduled.time_since_epoch()).count();
+        this->samples[i].sent = Now();
       }
 
-      // Output data.
-      (*stream) << std::fixed << testNum++ << "\t" << this->dataSize << "\t"
-                << (sum / static_cast<double>(this->sentMsgs)) * 0.5 << "\t"
-                << minLatency * 0.5 << "\t"
-                << maxLatency * 0.5 << std::endl;
+      this->msg.mutable_header()->mutable_stamp()->set_sec(i);
+      this->latencyPub.Publish(this->msg);
+    }
+
+    // Wait for the last replies, the missing ones are lost.
+    std::unique_lock<std::mutex> lk(this->mutex);
+    this->condition.wait_for(lk, std::chrono::seconds(5), [this] {
+        return gStop || this->replies >= this->sentMsgs;});
+  }
+
+  /// \brief Describe how the replier is reached.
+  /// \return intra-process, inter-process or inter-host.
+  private: std::string Mode() const
+  {
+    if (!this->interProcess)
+      return "intra-process";
+
+    // The address of the replier tells whether it's on this host.
+    std::vector<ignition::transport::MessagePublisher> publishers;
+    this->node.TopicInfo("/benchmark/latency/reply", publishers);
+    const std::string host = ignition::transport::determineHost();
+    for (const auto &publisher : publishers)
+    {
+      const std::string addr = publisher.Addr();
+      const auto begin = addr.find("://");
+      const auto end = addr.rfind(':');
+      if (begin != std::string::npos && end != std::string::npos &&
+          addr.substr(begin + 3, end - begin - 3) != host)
+      {
+        return "inter-host";
+      }
+    }
+    return "inter-process";
+  }
+
+  /// \brief Steady clock time.
+  /// \return The time, in nanoseconds.
+  private: static int64_t Now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /// \brief Get a percentile of sorted values.
+  /// \param[in] _values Sorted values.
+  /// \param[in] _p The percentile, from 0 to 1.
+  /// \return The value, 0 if there are no values.
+  private: static double Percentile(const std::vector<double> &_values,
+                                    const double _p)
+  {
+    if (_values.empty())
+      return 0;
+
+    const auto index = static_cast<std::size_t>(
+      std::ceil(_p * _values.size()));
+    return _values[std::min(_values.size() - 1, index > 0 ? index - 1 : 0)];
+  }
+
+  /// \brief Output the percentile distribution of sorted values, in the
+  /// format of HdrHistogram: 5 percentiles per halving of the distance to
+  /// 100%.
+  /// \param[in] _values Sorted values.
+  /// \param[in] _stream Output stream.
+  private: static void OutputHistogram(const std::vector<double> &_values,
+                                       std::ostream &_stream)
+  {
+    _stream << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+    if (_values.empty())
+      return;
+
+    const int ticksPerHalfDistance = 5;
+    const double total = static_cast<double>(_values.size());
+    for (int half = 0; ; ++half)
+    {
+      bool last = false;
+      for (int tick = 0; tick < ticksPerHalfDistance; ++tick)
+      {
+        const double remaining = std::pow(0.5, half) *
+          (1.0 - tick / (2.0 * ticksPerHalfDistance));
+        const double p = 1.0 - remaining;
+        const auto count = static_cast<uint64_t>(std::ceil(p * total));
+        _stream << std::fixed << std::setw(12) << std::setprecision(3)
+                << Percentile(_values, p) << " " << std::setw(14)
+                << std::setprecision(12) << p << " " << std::setw(10)
+                << std::max<uint64_t>(count, 1) << " " << std::setw(14)
+                << std::setprecision(2) << 1.0 / remaining << "\n";
+
+        // Past the resolution of the samples.
+        if (remaining * total < 1.0)
+        {
+          last = true;
+          break;
+        }
+      }
+      if (last)
+        break;
     }
+
+    double sum = 0;
+    for (const double value : _values)
+      sum += value;
+    const double mean = sum / total;
+    double variance = 0;
+    for (const double value : _values)
+      variance += (value - mean) * (value - mean);
+
+    _stream << std::setw(12) << std::setprecision(3) << _values.back()
+            << " " << std::setw(14) << std::setprecision(12) << 1.0 << " "
+            << std::setw(10) << _values.size() << "\n";
+    _stream << std::setprecision(3) << "#[Mean    = " << mean
+            << ", StdDeviation   = " << std::sqrt(variance / total) << "]\n"
+            << "#[Max     = " << _values.back() << ", Total count    = "
+            << _values.size() << "]\n\n" << std::flush;
   }
 
   /// \brief Callback that handles throughput replies
@@ -567,11 +816,18 @@ class PubTester
   private: void LatencyCb(const ignition::msgs::Bytes &_msg)
   {
     // End the time.
-    this->timeEnd = std::chrono::high_resolution_clock::now();
+    const int64_t now = Now();
 
     // Lock and notify
     std::unique_lock<std::mutex> lk(this->mutex);
 
+    const auto seq = static_cast<uint64_t>(_msg.header().stamp().sec());
+    if (seq < this->samples.size() && this->samples[seq].received == 0)
+    {
+      this->samples[seq].received = now;
+      ++this->replies;
+    }
+
     this->condition.notify_all();
   }
 
@@ -636,6 +892,39 @@ class PubTester
   /// \brief Output filename or empty string for console output.
   private: std::string filename = "";
 
+  /// \brief Latency histograms output filename, or empty string.
+  private: std::string histogramFilename = "";
+
+  /// \brief Latency samples output filename, or empty string.
+  private: std::string samplesFilename = "";
+
+  /// \brief Time stamps of a latency message, in nanoseconds of the steady
+  /// clock.
+  private: struct LatencySample
+  {
+    /// \brief Time the message was scheduled to be sent.
+    int64_t scheduled = 0;
+
+    /// \brief Time the message was sent.
+    int64_t sent = 0;
+
+    /// \brief Time the reply was received, 0 if none.
+    int64_t received = 0;
+  };
+
+  /// \brief Samples of the message size under test, indexed by sequence
+  /// number.
+  private: std::vector<LatencySample> samples;
+
+  /// \brief Number of replies received for the message size under test.
+  private: uint64_t replies = 0;
+
+  /// \brief Rate of the latency test in msgs/s, 0 for closed loop.
+  private: uint64_t rate = 0;
+
+  /// \brief True if the replier is another process.
+  private: bool interProcess = false;
+
   private: int expectedStamp = 0;
 };
 
@@ -668,6 +957,9 @@ int main(int argc, char **argv)
   usage += " Example interprocess latency:\n";
   usage += " \tTerminal 1: ./bench -l -r\n";
   usage += " \tTerminal 2: ./bench -l -p\n";
+  usage += " Example interprocess latency at 1000 msgs/s with histograms:\n";
+  usage += " \tTerminal 1: ./bench -l -r\n";
+  usage += " \tTerminal 2: ./bench -l -p -R 1000 -H latency.hgrm\n";
   usage += " Example intraprocess throughput:\n\t./bench -t\n";
   usage += " Example interprocess throughput:\n";
   usage += " \tTerminal 1: ./bench -t -r\n";
@@ -691,6 +983,10 @@ int main(int argc, char **argv)
   // Set the number of iterations.
   gPubTester.SetIterations(FLAGS_i);
   gPubTester.SetOutputFilename(FLAGS_o);
+  gPubTester.SetRate(FLAGS_R);
+  gPubTester.SetHistogramFilename(FLAGS_H);
+  gPubTester.SetSamplesFilename(FLAGS_s);
+  gPubTester.SetInterProcess(FLAGS_p);
 
   // Run the responder
   if (FLAGS_r)
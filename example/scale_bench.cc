@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+//////////////////////////////////////////////////
+/// Usage: ./scale_bench <options>
+///
+/// One process of the scalability benchmark, usually started by
+/// scale_bench.sh, which launches many of them on several hosts and
+/// collects their results.
+///
+/// Options:
+///
+/// -role pub|sub Publisher or subscriber process
+/// -id Index of the publisher process
+/// -publishers Number of publisher processes, for a subscriber
+/// -topics Number of topics of each publisher process
+/// -size Payload size of the messages, in bytes
+/// -rate Messages per second of each topic, 0 for as fast as possible
+/// -duration Publication time, in seconds
+/// -timeout Maximum time waiting for the discovery, in seconds
+/// -max_samples Maximum number of latency samples kept
+///
+/// Publisher <id> advertises the topics /scale/pub<id>/t<i>. A subscriber
+/// subscribes to the topics of all the publishers. Each process prints one
+/// line of JSON with its results when it finishes:
+///
+///   * discovery_s: time until the topics were connected, for a publisher
+///     the time until every topic had a subscriber, for a subscriber the
+///     time until it received a message on every topic.
+///   * msgs, msgs_per_s, mbytes_per_s: messages sent or received.
+///   * cpu_us_per_msg: CPU time of the process per message.
+///   * p50_us, p99_us, p999_us, max_us: latency of the messages received,
+///     from the publication time in their header. The clocks of the hosts
+///     must be synchronized for the latency between hosts to be meaningful.
+//////////////////////////////////////////////////
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <ignition/msgs.hh>
+#include <ignition/transport.hh>
+
+DEFINE_string(role, "", "Role of the process: pub or sub");
+DEFINE_uint64(id, 0, "Index of the publisher process");
+DEFINE_uint64(publishers, 1, "Number of publisher processes");
+DEFINE_uint64(topics, 1, "Number of topics of each publisher process");
+DEFINE_uint64(size, 1000, "Payload size of the messages, in bytes");
+DEFINE_uint64(rate, 100, "Messages per second of each topic, 0 for max");
+DEFINE_uint64(duration, 10, "Publication time, in seconds");
+DEFINE_uint64(timeout, 60, "Maximum time waiting for the discovery, in s");
+DEFINE_uint64(max_samples, 10000000, "Maximum number of latency samples");
+
+using Clock = std::chrono::steady_clock;
+
+/// \brief Set when the process is interrupted.
+static std::atomic<bool> g_stop{false};
+
+//////////////////////////////////////////////////
+/// \brief Interrupt the process.
+void signalHandler(int)
+{
+  g_stop = true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Name of a topic of the benchmark.
+/// \param[in] _pub Index of the publisher process.
+/// \param[in] _topic Index of the topic.
+/// \return The topic name.
+std::string topicName(const uint64_t _pub, const uint64_t _topic)
+{
+  return "/scale/pub" + std::to_string(_pub) + "/t" + std::to_string(_topic);
+}
+
+//////////////////////////////////////////////////
+/// \brief Seconds elapsed since a time point.
+/// \param[in] _start The time point.
+/// \return The seconds elapsed.
+double secondsSince(const Clock::time_point &_start)
+{
+  return std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+//////////////////////////////////////////////////
+/// \brief CPU time used by the process, all threads included.
+/// \return The CPU time, in microseconds.
+double cpuTimeUs()
+{
+  return 1e6 * static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+//////////////////////////////////////////////////
+/// \brief Print the fields shared by the results of all the processes.
+void printConfig()
+{
+  std::cout << "{\"role\":\"" << FLAGS_role << "\",\"id\":" << FLAGS_id
+            << ",\"host\":\"" << ignition::transport::hostname() << "\""
+            << ",\"publishers\":" << FLAGS_publishers
+            << ",\"topics\":" << FLAGS_topics
+            << ",\"size\":" << FLAGS_size << ",\"rate\":" << FLAGS_rate;
+}
+
+//////////////////////////////////////////////////
+/// \brief Advertise the topics of this process, wait for their subscribers
+/// and publish on all of them.
+/// \return Exit code.
+int runPublisher()
+{
+  const auto start = Clock::now();
+  ignition::transport::Node node;
+  std::vector<ignition::transport::Node::Publisher> pubs;
+  for (uint64_t i = 0; i < FLAGS_topics; ++i)
+  {
+    pubs.push_back(node.Advertise<ignition::msgs::Bytes>(
+      topicName(FLAGS_id, i)));
+    if (!pubs.back())
+    {
+      std::cerr << "Error advertising topic " << topicName(FLAGS_id, i)
+                << std::endl;
+      return -1;
+    }
+  }
+
+  // Discovery convergence: every topic has a subscriber.
+  const auto deadline = start + std::chrono::seconds(FLAGS_timeout);
+  while (!g_stop && Clock::now() < deadline &&
+         !std::all_of(pubs.begin(), pubs.end(),
+            [](const ignition::transport::Node::Publisher &_pub)
+            {
+              return _pub.HasConnections();
+            }))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const double discovery = secondsSince(start);
+
+  ignition::msgs::Bytes msg;
+  msg.set_data(std::string(FLAGS_size, '0'));
+
+  const auto period = FLAGS_rate > 0 ?
+    std::chrono::nanoseconds(1000000000 / FLAGS_rate) :
+    std::chrono::nanoseconds(0);
+  const double cpuStart = cpuTimeUs();
+  const auto pubStart = Clock::now();
+  const auto pubEnd = pubStart + std::chrono::seconds(FLAGS_duration);
+  auto next = pubStart;
+  uint64_t sent = 0;
+
+  while (!g_stop && Clock::now() < pubEnd)
+  {
+    // One message per topic per period.
+    for (auto &pub : pubs)
+    {
+      const auto now = std::chrono::system_clock::now().time_since_epoch();
+      const auto ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+      msg.mutable_header()->mutable_stamp()->set_sec(ns / 1000000000);
+      msg.mutable_header()->mutable_stamp()->set_nsec(ns % 1000000000);
+      if (pub.Publish(msg))
+        ++sent;
+    }
+
+    if (period.count() > 0)
+    {
+      next += period;
+      std::this_thread::sleep_until(next);
+    }
+  }
+
+  const double elapsed = secondsSince(pubStart);
+  const double cpu = cpuTimeUs() - cpuStart;
+
+  printConfig();
+  std::cout << ",\"discovery_s\":" << discovery
+            << ",\"msgs\":" << sent
+            << ",\"msgs_per_s\":" << sent / elapsed
+            << ",\"mbytes_per_s\":" << sent * FLAGS_size / elapsed / 1e6
+            << ",\"cpu_us_per_msg\":" << (sent > 0 ? cpu / sent : 0.0)
+            << "}" << std::endl;
+  return 0;
+}
+
+/// \brief Collects the messages of all the topics.
+class ScaleSubscriber
+{
+  /// \brief Subscribe to the topics of all the publishers.
+  /// \return False if a subscription failed.
+  public: bool Subscribe()
+  {
+    this->expectedTopics = FLAGS_publishers * FLAGS_topics;
+    this->latencies.reserve(std::min<uint64_t>(FLAGS_max_samples,
+      FLAGS_publishers * FLAGS_topics * std::max<uint64_t>(FLAGS_rate, 1) *
+      FLAGS_duration));
+
+    for (uint64_t p = 0; p < FLAGS_publishers; ++p)
+    {
+      for (uint64_t t = 0; t < FLAGS_topics; ++t)
+      {
+        if (!this->node.Subscribe(topicName(p, t), &ScaleSubscriber::OnMsg,
+              this))
+        {
+          std::cerr << "Error subscribing to topic " << topicName(p, t)
+                    << std::endl;
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /// \brief Receive messages until the publishers are done.
+  /// \return Exit code.
+  public: int Run()
+  {
+    const auto deadline = this->start + std::chrono::seconds(
+      FLAGS_timeout + FLAGS_duration);
+
+    // The publishers are done when nothing was received for a while.
+    const auto idle = std::chrono::seconds(2);
+    while (!g_stop && Clock::now() < deadline)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      std::lock_guard<std::mutex> lk(this->mutex);
+      if (this->received > 0 && Clock::now() - this->last > idle)
+        break;
+    }
+
+    std::lock_guard<std::mutex> lk(this->mutex);
+    const double cpu = cpuTimeUs() - this->cpuStart;
+    const double elapsed = this->received > 1 ?
+      std::chrono::duration<double>(this->last - this->first).count() : 0.0;
+
+    std::sort(this->latencies.begin(), this->latencies.end());
+    auto percentile = [this](double _p)
+    {
+      if (this->latencies.empty())
+        return 0.0;
+      const std::size_t index = static_cast<std::size_t>(
+        _p * static_cast<double>(this->latencies.size() - 1));
+      return this->latencies[index];
+    };
+
+    printConfig();
+    std::cout << ",\"discovery_s\":" << this->discovery
+              << ",\"topics_seen\":" << this->seenTopics.size()
+              << ",\"msgs\":" << this->received
+              << ",\"msgs_per_s\":"
+              << (elapsed > 0 ? this->received / elapsed : 0.0)
+              << ",\"mbytes_per_s\":"
+              << (elapsed > 0 ? this->received * FLAGS_size / elapsed / 1e6 :
+                  0.0)
+              << ",\"cpu_us_per_msg\":"
+              << (this->received > 0 ? cpu / this->received : 0.0)
+              << ",\"p50_us\":" << percentile(0.5)
+              << ",\"p99_us\":" << percentile(0.99)
+              << ",\"p999_us\":" << percentile(0.999)
+              << ",\"max_us\":" << percentile(1.0)
+              << "}" << std::endl;
+    return 0;
+  }
+
+  /// \brief Record a message.
+  /// \param[in] _msg The message.
+  /// \param[in] _info Information about the message.
+  private: void OnMsg(const ignition::msgs::Bytes &_msg,
+                      const ignition::transport::MessageInfo &_info)
+  {
+    const auto now = Clock::now();
+    const auto systemNow = std::chrono::duration_cast<
+      std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const int64_t stamp = _msg.header().stamp().sec() * 1000000000ll +
+      _msg.header().stamp().nsec();
+
+    std::lock_guard<std::mutex> lk(this->mutex);
+    if (this->received == 0)
+    {
+      this->first = now;
+      this->cpuStart = cpuTimeUs();
+    }
+    this->last = now;
+    ++this->received;
+
+    if (this->latencies.size() < FLAGS_max_samples)
+      this->latencies.push_back((systemNow - stamp) / 1000.0);
+
+    // Discovery convergence: a message was received on every topic.
+    if (this->seenTopics.size() < this->expectedTopics &&
+        this->seenTopics.insert(_info.Topic()).second &&
+        this->seenTopics.size() == this->expectedTopics)
+    {
+      this->discovery = secondsSince(this->start);
+    }
+  }
+
+  /// \brief Communication node.
+  private: ignition::transport::Node node;
+
+  /// \brief Protects the members below.
+  private: std::mutex mutex;
+
+  /// \brief Start of the process.
+  private: Clock::time_point start = Clock::now();
+
+  /// \brief Reception time of the first message.
+  private: Clock::time_point first;
+
+  /// \brief Reception time of the last message.
+  private: Clock::time_point last;
+
+  /// \brief CPU time when the first message was received.
+  private: double cpuStart = 0;
+
+  /// \brief Number of messages received.
+  private: uint64_t received = 0;
+
+  /// \brief Latency samples, in microseconds.
+  private: std::vector<double> latencies;
+
+  /// \brief Topics on which a message was received.
+  private: std::unordered_set<std::string> seenTopics;
+
+  /// \brief Number of topics of all the publishers.
+  private: uint64_t expectedTopics = 0;
+
+  /// \brief Time until a message was received on every topic, -1 if it
+  /// didn't happen.
+  private: double discovery = -1;
+};
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  std::string usage("Scalability benchmark process, see scale_bench.sh.");
+  gflags::SetUsageMessage(usage);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::signal(SIGINT, signalHandler);
+  std::signal(SIGTERM, signalHandler);
+
+  if (FLAGS_role == "pub")
+    return runPublisher();
+
+  if (FLAGS_role == "sub")
+  {
+    ScaleSubscriber subscriber;
+    if (!subscriber.Subscribe())
+      return -1;
+    return subscriber.Run();
+  }
+
+  std::cerr << "Set -role to pub or sub" << std::endl;
+  return -1;
+}
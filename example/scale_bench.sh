@@ -0,0 +1,117 @@
+#!/bin/bash
+#
+# Copyright (C) 2021 Open Source Robotics Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Scalability benchmark: launches N publisher processes and M subscriber
+# processes of scale_bench, on this host or on other hosts through ssh, for
+# each combination of topics per publisher, message size and rate. Each
+# process appends one line of JSON with its results to the output file.
+#
+# Usage: ./scale_bench.sh [options]
+#
+#   -b <path>   scale_bench executable, the same path on every host
+#               (default: ./scale_bench)
+#   -P <hosts>  Comma separated hosts of the publishers, used round robin
+#               (default: localhost)
+#   -S <hosts>  Comma separated hosts of the subscribers (default: localhost)
+#   -n <N>      Number of publisher processes (default: 1)
+#   -m <M>      Number of subscriber processes (default: 1)
+#   -t <list>   Comma separated topics per publisher (default: 1,10,100)
+#   -s <list>   Comma separated message sizes, in bytes (default: 100,10000)
+#   -r <list>   Comma separated rates per topic, 0 for max (default: 10,100)
+#   -d <secs>   Publication time of each run (default: 10)
+#   -o <file>   Output file (default: scale_bench.jsonl)
+#
+# The hosts other than localhost must accept ssh without a password. The
+# latencies between hosts are only meaningful with synchronized clocks.
+
+set -e
+
+BIN=./scale_bench
+PUB_HOSTS=localhost
+SUB_HOSTS=localhost
+PUBLISHERS=1
+SUBSCRIBERS=1
+TOPICS=1,10,100
+SIZES=100,10000
+RATES=10,100
+DURATION=10
+OUTPUT=scale_bench.jsonl
+
+while getopts "b:P:S:n:m:t:s:r:d:o:h" opt; do
+  case $opt in
+    b) BIN=$OPTARG ;;
+    P) PUB_HOSTS=$OPTARG ;;
+    S) SUB_HOSTS=$OPTARG ;;
+    n) PUBLISHERS=$OPTARG ;;
+    m) SUBSCRIBERS=$OPTARG ;;
+    t) TOPICS=$OPTARG ;;
+    s) SIZES=$OPTARG ;;
+    r) RATES=$OPTARG ;;
+    d) DURATION=$OPTARG ;;
+    o) OUTPUT=$OPTARG ;;
+    *) sed -n '/^# Usage/,/^# latencies/p' "$0" | sed 's/^# \{0,1\}//'
+       exit 1 ;;
+  esac
+done
+
+IFS=, read -r -a PUB_HOST_LIST <<< "$PUB_HOSTS"
+IFS=, read -r -a SUB_HOST_LIST <<< "$SUB_HOSTS"
+
+# Run a process of the benchmark on a host, its results go to the output.
+# $1: host, the other arguments are passed to scale_bench.
+launch()
+{
+  local host=$1
+  shift
+  if [ "$host" == "localhost" ]; then
+    IGN_PARTITION=$PARTITION "$BIN" "$@" >> "$OUTPUT" &
+  else
+    ssh -n "$host" env IGN_PARTITION=$PARTITION "$BIN" "$@" >> "$OUTPUT" &
+  fi
+}
+
+for topics in ${TOPICS//,/ }; do
+  for size in ${SIZES//,/ }; do
+    for rate in ${RATES//,/ }; do
+      # Each run in its own partition, the processes of the previous run
+      # can't interfere.
+      PARTITION=scale_bench_$$_${topics}_${size}_${rate}
+      echo "Running $PUBLISHERS x $topics topics -> $SUBSCRIBERS" \
+           "subscribers, $size bytes at $rate Hz"
+
+      COMMON="-publishers=$PUBLISHERS -topics=$topics -size=$size"\
+" -rate=$rate -duration=$DURATION"
+
+      pids=()
+      for ((i = 0; i < SUBSCRIBERS; ++i)); do
+        launch "${SUB_HOST_LIST[i % ${#SUB_HOST_LIST[@]}]}" \
+          -role=sub $COMMON
+        pids+=($!)
+      done
+
+      for ((i = 0; i < PUBLISHERS; ++i)); do
+        launch "${PUB_HOST_LIST[i % ${#PUB_HOST_LIST[@]}]}" \
+          -role=pub -id=$i $COMMON
+        pids+=($!)
+      done
+
+      # A failed process only loses its own results.
+      wait "${pids[@]}" || true
+    done
+  done
+done
+
+echo "Results in $OUTPUT"
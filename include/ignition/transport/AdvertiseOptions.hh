@@ -18,9 +18,11 @@
 #ifndef IGN_TRANSPORT_ADVERTISEOPTIONS_HH_
 #define IGN_TRANSPORT_ADVERTISEOPTIONS_HH_
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <string>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
@@ -51,6 +53,72 @@ namespace ignition
       ALL
     };
 
+    /// \def Compression This strongly typed enum defines the compression
+    /// algorithms that can be applied to the messages sent to remote
+    /// subscribers.
+    enum class Compression_t
+    {
+      /// \brief Messages are sent uncompressed (default).
+      NONE,
+      /// \brief Messages are compressed with zlib. Only available if
+      /// ign-transport was built with zlib support.
+      ZLIB
+    };
+
+    /// \brief Default minimum size of a message to be compressed (bytes).
+    static const std::size_t kDefaultCompressionThreshold = 1024;
+
+    /// \def PublishMode This strongly typed enum defines how the messages
+    /// are sent to remote subscribers.
+    enum class PublishMode_t
+    {
+      /// \brief Publish() sends the message before returning (default).
+      SYNC,
+      /// \brief Publish() queues the message and returns. A background
+      /// thread sends the queued messages.
+      ASYNC
+    };
+
+    /// \def QueuePolicy This strongly typed enum defines what happens when
+    /// a message is published while the send queue is full.
+    enum class QueuePolicy_t
+    {
+      /// \brief The oldest queued message is discarded (default).
+      DROP_OLDEST,
+      /// \brief The new message is discarded.
+      DROP_NEWEST,
+      /// \brief Publish() blocks until there is room in the queue.
+      BLOCK
+    };
+
+    /// \def Priority This strongly typed enum defines the priority class of
+    /// a topic.
+    enum class Priority_t
+    {
+      /// \brief The topic shares the connections of the process with the
+      /// other topics (default).
+      NORMAL,
+      /// \brief The topic has its own connections, so its messages aren't
+      /// queued behind the messages of the other topics.
+      HIGH
+    };
+
+    /// \def Durability This strongly typed enum defines what late-joining
+    /// subscribers of a topic receive.
+    enum class Durability_t
+    {
+      /// \brief The subscribers only receive the messages published after
+      /// they joined (default).
+      VOLATILE,
+      /// \brief The publisher retains its latest message and sends it to the
+      /// subscribers joining later.
+      TRANSIENT_LOCAL
+    };
+
+    /// \brief Default capacity of the send queue of an asynchronous
+    /// publisher (messages).
+    static const std::size_t kDefaultAsyncQueueSize = 100;
+
     /// \class AdvertiseOptions AdvertiseOptions.hh
     /// ignition/transport/AdvertiseOptions.hh
     /// \brief A class for customizing the publication options for a topic or
@@ -173,10 +241,66 @@ namespace ignition
         {
           _out << "\tThrottled? Yes" << std::endl;
           _out << "\tRate: " << _other.MsgsPerSec() << " msgs/sec" << std::endl;
+          if (_other.Burst() > 1)
+            _out << "\tBurst: " << _other.Burst() << " msgs" << std::endl;
+          if (_other.CoarseClock())
+            _out << "\tCoarse clock? Yes" << std::endl;
         }
         else
           _out << "\tThrottled? No" << std::endl;
 
+        if (_other.Compression() == Compression_t::ZLIB)
+        {
+          _out << "\tCompression: zlib (messages of at least "
+               << _other.CompressionThreshold() << " bytes)" << std::endl;
+        }
+
+        if (_other.PublishMode() == PublishMode_t::ASYNC)
+        {
+          _out << "\tPublish mode: async (queue of "
+               << _other.AsyncQueueSize() << " msgs, ";
+          if (_other.AsyncQueueBytes() > 0)
+            _out << _other.AsyncQueueBytes() << " bytes, ";
+          switch (_other.AsyncQueuePolicy())
+          {
+            case QueuePolicy_t::DROP_NEWEST:
+              _out << "drop newest";
+              break;
+            case QueuePolicy_t::BLOCK:
+              _out << "block";
+              break;
+            case QueuePolicy_t::DROP_OLDEST:
+            default:
+              _out << "drop oldest";
+              break;
+          }
+          _out << ")" << std::endl;
+        }
+
+        if (_other.Conflated())
+          _out << "\tConflated? Yes" << std::endl;
+
+        if (!_other.MulticastGroup().empty())
+        {
+          _out << "\tMulticast group: " << _other.MulticastGroup()
+               << std::endl;
+        }
+
+        if (_other.Priority() == Priority_t::HIGH)
+          _out << "\tPriority: high" << std::endl;
+
+        if (_other.Durability() == Durability_t::TRANSIENT_LOCAL)
+          _out << "\tDurability: transient local" << std::endl;
+
+        if (_other.Reliable())
+        {
+          _out << "\tReliable? Yes (retransmit buffer of "
+               << _other.RetransmitBufferSize() << " msgs)" << std::endl;
+        }
+
+        if (_other.Acknowledged())
+          _out << "\tAcknowledged? Yes" << std::endl;
+
         return _out;
       }
 
@@ -193,10 +317,222 @@ namespace ignition
       /// \brief Set the maximum number of messages per second to be published.
       /// Note that we calculate the minimum period of a message based
       /// on the msgs/sec rate. Any message sent since the last Publish()
-      /// and the duration of the period will be discarded.
+      /// and the duration of the period will be discarded, unless a burst
+      /// larger than one is allowed.
       /// \param[in] _newMsgsPerSec Maximum number of messages per second.
+      /// \sa SetBurst
       public: void SetMsgsPerSec(const uint64_t _newMsgsPerSec);
 
+      /// \brief Get the number of messages that a throttled publisher may
+      /// publish back to back.
+      /// \return The burst size.
+      /// \sa SetBurst
+      public: uint64_t Burst() const;
+
+      /// \brief Set the number of messages that a throttled publisher may
+      /// publish back to back. The throttling is a token bucket: it's
+      /// refilled at the rate set with SetMsgsPerSec() and holds up to
+      /// _burst messages, so the publisher may catch up after being idle
+      /// while the average rate stays bounded. The default of one keeps a
+      /// strict minimum period between the messages.
+      /// \param[in] _burst Maximum number of messages published back to
+      /// back. Zero is treated as one.
+      public: void SetBurst(const uint64_t _burst);
+
+      /// \brief Whether the throttling reads the coarse clock of the
+      /// system.
+      /// \return True if the coarse clock is used.
+      /// \sa SetCoarseClock
+      public: bool CoarseClock() const;
+
+      /// \brief Set whether the throttling reads the coarse clock of the
+      /// system instead of std::chrono::steady_clock. The coarse clock
+      /// only advances on the ticks of the kernel (a few milliseconds) but
+      /// is cheaper to read, which matters for publishers of very high
+      /// frequency. The burst is raised to the number of messages allowed
+      /// during one tick. Only available on Linux, the steady clock is used
+      /// otherwise.
+      /// \param[in] _coarse True to use the coarse clock.
+      public: void SetCoarseClock(const bool _coarse);
+
+      /// \brief Get the compression applied to the messages sent to remote
+      /// subscribers.
+      /// \return The compression algorithm.
+      /// \sa SetCompression
+      public: Compression_t Compression() const;
+
+      /// \brief Set the compression applied to the messages sent to remote
+      /// subscribers. Local subscribers and subscribers on the same host
+      /// that use shared memory always receive the uncompressed message.
+      /// Messages are only compressed when all the remote subscribers
+      /// support it, otherwise they are sent uncompressed.
+      /// \param[in] _compression The compression algorithm.
+      public: void SetCompression(const Compression_t _compression);
+
+      /// \brief Get the minimum size of a message to be compressed.
+      /// \return Size in bytes.
+      /// \sa SetCompressionThreshold
+      public: std::size_t CompressionThreshold() const;
+
+      /// \brief Set the minimum size of a message to be compressed. Smaller
+      /// messages are sent uncompressed, as compressing them is not worth
+      /// the CPU time.
+      /// \param[in] _threshold Size in bytes.
+      public: void SetCompressionThreshold(const std::size_t _threshold);
+
+      /// \brief Get how the messages are sent to remote subscribers.
+      /// \return The publish mode.
+      /// \sa SetPublishMode
+      public: PublishMode_t PublishMode() const;
+
+      /// \brief Set how the messages are sent to remote subscribers. In
+      /// PublishMode_t::ASYNC mode, Publish() serializes the message, queues
+      /// it and returns without waiting for the network. A message given up
+      /// by the caller, see Node::Publisher::Publish(std::unique_ptr<>), is
+      /// serialized by the background thread as well. Local subscribers are
+      /// not affected.
+      /// \param[in] _mode The publish mode.
+      public: void SetPublishMode(const PublishMode_t _mode);
+
+      /// \brief Get the capacity of the send queue used in
+      /// PublishMode_t::ASYNC mode.
+      /// \return Number of messages.
+      /// \sa SetAsyncQueueSize
+      public: std::size_t AsyncQueueSize() const;
+
+      /// \brief Set the capacity of the send queue used in
+      /// PublishMode_t::ASYNC mode.
+      /// \param[in] _size Number of messages. A value of zero is treated
+      /// as one.
+      public: void SetAsyncQueueSize(const std::size_t _size);
+
+      /// \brief Get the maximum number of bytes of the send queue used in
+      /// PublishMode_t::ASYNC mode.
+      /// \return Number of bytes, zero if the queue is only bounded by its
+      /// number of messages.
+      /// \sa SetAsyncQueueBytes
+      public: uint64_t AsyncQueueBytes() const;
+
+      /// \brief Bound the send queue used in PublishMode_t::ASYNC mode by
+      /// the serialized size of its messages, in addition to their number.
+      /// The queue policy applies when either limit is reached. A message
+      /// larger than the limit is still queued when the queue is empty.
+      /// \param[in] _bytes Number of bytes. Zero (the default) disables the
+      /// limit.
+      /// \sa SetAsyncQueueSize
+      public: void SetAsyncQueueBytes(const uint64_t _bytes);
+
+      /// \brief Get what happens when a message is published while the send
+      /// queue is full.
+      /// \return The queue policy.
+      /// \sa SetAsyncQueuePolicy
+      public: QueuePolicy_t AsyncQueuePolicy() const;
+
+      /// \brief Set what happens when a message is published while the send
+      /// queue is full. Only used in PublishMode_t::ASYNC mode.
+      /// \param[in] _policy The queue policy.
+      public: void SetAsyncQueuePolicy(const QueuePolicy_t _policy);
+
+      /// \brief Whether only the latest message is sent to remote
+      /// subscribers.
+      /// \return True if the publication is conflated.
+      /// \sa SetConflated
+      public: bool Conflated() const;
+
+      /// \brief Set whether only the latest message is sent to remote
+      /// subscribers. The remote sends go through a single-slot queue, so
+      /// if the network can't keep up with the publisher, the stale messages
+      /// are replaced by the latest one. This suits state topics, e.g. poses
+      /// or joint states. See also SubscribeOptions::SetConflated for slow
+      /// subscribers.
+      /// \param[in] _conflated True to enable conflation.
+      public: void SetConflated(const bool _conflated);
+
+      /// \brief Get the multicast group the messages are sent to.
+      /// \return The group and port, e.g. "239.255.0.7:11320", or an empty
+      /// string if the messages are sent to each subscriber over TCP.
+      /// \sa SetMulticastGroup
+      public: const std::string &MulticastGroup() const;
+
+      /// \brief Send the messages to the remote subscribers once, to a
+      /// UDP multicast group, instead of once per subscriber over TCP. The
+      /// bandwidth used by the publisher doesn't depend on the number of
+      /// subscribers anymore, which suits topics with many remote
+      /// subscribers. The transport is the ZeroMQ epgm transport, so
+      /// ZeroMQ must be built with OpenPGM, and it's only used while all
+      /// the remote subscribers have joined the group. Otherwise, the
+      /// messages are sent over TCP. The messages can't be authenticated,
+      /// so the group is ignored when IGN_TRANSPORT_USERNAME and
+      /// IGN_TRANSPORT_PASSWORD are set. See also
+      /// IGN_TRANSPORT_MULTICAST_RATE.
+      /// \param[in] _group Multicast group and port, e.g.
+      /// "239.255.0.7:11320". Topics sent to the same group share it, and
+      /// an empty string disables multicast (default).
+      public: void SetMulticastGroup(const std::string &_group);
+
+      /// \brief Get the priority class of the topic.
+      /// \return The priority class.
+      /// \sa SetPriority
+      public: Priority_t Priority() const;
+
+      /// \brief Set the priority class of the topic. High priority topics
+      /// are sent through a publisher socket of their own, with their own
+      /// TCP connections, so a small command isn't queued behind a large
+      /// message of another topic. The connections can be marked with
+      /// IGN_TRANSPORT_PRIORITY_DSCP.
+      /// \param[in] _priority The priority class.
+      public: void SetPriority(const Priority_t _priority);
+
+      /// \brief Get the durability of the topic.
+      /// \return The durability.
+      /// \sa SetDurability
+      public: Durability_t Durability() const;
+
+      /// \brief Set the durability of the topic. With transient local
+      /// durability, the publisher retains its latest message and sends it
+      /// to each remote subscriber when it connects, so slow topics, e.g. a
+      /// map, don't need to be published periodically for the subscribers
+      /// joining late. The subscribers of a process receive the message
+      /// again when another one of its nodes subscribes.
+      /// \param[in] _durability The durability.
+      public: void SetDurability(const Durability_t _durability);
+
+      /// \brief Whether the topic is reliable.
+      /// \return True if the retransmit buffer isn't empty.
+      /// \sa SetRetransmitBufferSize
+      public: bool Reliable() const;
+
+      /// \brief Get the size of the retransmit buffer of a reliable topic.
+      /// \return The number of messages retained, 0 if the topic isn't
+      /// reliable.
+      /// \sa SetRetransmitBufferSize
+      public: uint64_t RetransmitBufferSize() const;
+
+      /// \brief Make the topic reliable. Each message is numbered and the
+      /// publisher retains the latest _size messages. The remote subscribers
+      /// that detect a gap in the numbers, e.g. because a high water mark
+      /// was hit or during a reconnection, request the missing messages,
+      /// which are sent to them again. The recovered messages are delivered
+      /// when they arrive, so they may be out of order, but each message is
+      /// delivered once. Messages older than the buffer can't be recovered.
+      /// Reliable topics aren't split in chunks.
+      /// \param[in] _size Number of messages retained, 0 disables the
+      /// reliability (default).
+      public: void SetRetransmitBufferSize(const uint64_t _size);
+
+      /// \brief Whether the remote subscribers acknowledge the messages
+      /// published with Node::Publisher::PublishAcked().
+      /// \return True if the topic is acknowledged.
+      /// \sa SetAcknowledged
+      public: bool Acknowledged() const;
+
+      /// \brief Let the remote subscribers acknowledge the messages
+      /// published with Node::Publisher::PublishAcked(), once their
+      /// callbacks returned. The local subscribers always acknowledge them.
+      /// \param[in] _acknowledged True to advertise the topic with the
+      /// address receiving the acknowledgements. False by default.
+      public: void SetAcknowledged(const bool _acknowledged);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
@@ -251,9 +587,77 @@ namespace ignition
                                           const AdvertiseServiceOptions &_other)
       {
         _out << static_cast<AdvertiseOptions>(_other);
+        if (_other.MaxConcurrency() > 0)
+        {
+          _out << "\tMax concurrency: " << _other.MaxConcurrency()
+               << std::endl;
+        }
+        if (_other.MaxQueue() > 0)
+        {
+          _out << "\tMax queue: " << _other.MaxQueue() << std::endl;
+        }
+        if (_other.ResponseCacheTtl() > 0)
+        {
+          _out << "\tResponse cache TTL: " << _other.ResponseCacheTtl()
+               << " ms" << std::endl;
+        }
         return _out;
       }
 
+      /// \brief Get the maximum number of requests of the service executed
+      /// at the same time.
+      /// \return The maximum concurrency. Zero means that the requests run
+      /// one at a time on the thread that receives them.
+      /// \sa SetMaxConcurrency
+      public: unsigned int MaxConcurrency() const;
+
+      /// \brief Set the maximum number of requests of the service executed
+      /// at the same time. When greater than zero, the requests received from
+      /// other processes run on a pool with that many threads dedicated to
+      /// the service and the responses are sent when each callback returns,
+      /// so a slow service doesn't delay the reception of messages and of
+      /// other service requests. The callback must then be thread safe.
+      /// Requests made from the same process still run on the requesting
+      /// thread.
+      /// \param[in] _maxConcurrency Maximum concurrency, zero (default) to
+      /// run the requests on the reception thread.
+      public: void SetMaxConcurrency(const unsigned int _maxConcurrency);
+
+      /// \brief Get the maximum number of requests of the service waiting
+      /// for a thread of the pool.
+      /// \return The maximum number of waiting requests. Zero means that
+      /// there is no limit.
+      /// \sa SetMaxQueue
+      public: unsigned int MaxQueue() const;
+
+      /// \brief Set the maximum number of requests of the service waiting
+      /// for a thread of the pool, see SetMaxConcurrency(). The requests
+      /// received from other processes while every thread is busy and the
+      /// queue is full are rejected right away with a "busy" response,
+      /// instead of waiting until the requester timed out. The requester
+      /// then sends the request to another process offering the service,
+      /// if there is one that didn't reject a request recently, or the
+      /// request fails. Ignored if the maximum concurrency is zero.
+      /// \param[in] _maxQueue Maximum number of waiting requests, zero
+      /// (default) for no limit.
+      public: void SetMaxQueue(const unsigned int _maxQueue);
+
+      /// \brief Get how long the responses of the service are reused.
+      /// \return The time to live of the responses in milliseconds. Zero
+      /// means that every request runs the callback.
+      /// \sa SetResponseCacheTtl
+      public: unsigned int ResponseCacheTtl() const;
+
+      /// \brief Mark the service as idempotent, i.e. its response only
+      /// depends on the request. The identical requests received at the
+      /// same time run the callback once and share its response, and the
+      /// successful responses are reused for the identical requests
+      /// received during the time to live. The requests are compared by
+      /// their serialized bytes.
+      /// \param[in] _ttl Time to live of the responses in milliseconds, zero
+      /// (default) to run the callback for every request.
+      public: void SetResponseCacheTtl(const unsigned int _ttl);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
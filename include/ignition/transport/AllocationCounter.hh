@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_ALLOCATIONCOUNTER_HH_
+#define IGN_TRANSPORT_ALLOCATIONCOUNTER_HH_
+
+#include <cstdint>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \brief Hot paths whose heap allocations are counted.
+    enum class AllocationPath : int
+    {
+      /// \brief Node::Publisher::Publish().
+      PUBLISHER_PUBLISH = 0,
+
+      /// \brief NodeShared::Publish(), sending to the remote subscribers.
+      NODE_SHARED_PUBLISH,
+
+      /// \brief NodeShared::RecvMsgUpdate(), receiving a remote message.
+      RECV_MSG_UPDATE,
+
+      /// \brief NodeShared::TriggerCallbacks(), running the callbacks of a
+      /// received message.
+      TRIGGER_CALLBACKS,
+
+      /// \brief One message of NodeSharedPrivate::PublishThread(), the
+      /// asynchronous delivery to the local subscribers.
+      PUBLISH_THREAD,
+
+      /// \brief Number of paths, not a path.
+      COUNT
+    };
+
+    /// \class AllocationCounter AllocationCounter.hh
+    /// ignition/transport/AllocationCounter.hh
+    /// \brief Counts the calls to operator new made while running the hot
+    /// paths of the library, to check that they don't allocate in steady
+    /// state.
+    ///
+    /// Counting is only compiled with the IGN_TRANSPORT_ALLOCATION_COUNTING
+    /// CMake option, which replaces the global operator new and delete of
+    /// the process. Otherwise the counts stay at zero and Enabled() returns
+    /// false. An allocation is counted in every path running on the
+    /// allocating thread, e.g. an allocation of NodeShared::Publish() is
+    /// also counted in Node::Publisher::Publish().
+    class IGNITION_TRANSPORT_VISIBLE AllocationCounter
+    {
+      /// \brief Marks a path as running on this thread during its
+      /// lifetime. A path entered again while running is counted once.
+      public: class IGNITION_TRANSPORT_VISIBLE Scope
+      {
+        /// \brief Enter a path.
+        /// \param[in] _path The path.
+        public: explicit Scope(AllocationPath _path);
+
+        /// \brief Leave the path.
+        public: ~Scope();
+
+        /// \brief Noncopyable.
+        public: Scope(const Scope &) = delete;
+
+        /// \brief Noncopyable.
+        public: Scope &operator=(const Scope &) = delete;
+
+        /// \brief Bit of the path in the running paths of the thread, zero
+        /// if the path was already running.
+        private: uint32_t bit;
+      };
+
+      /// \brief Whether the allocations are counted in this build.
+      /// \return True if compiled with IGN_TRANSPORT_ALLOCATION_COUNTING.
+      public: static bool Enabled();
+
+      /// \brief Reset the counts of all the paths.
+      public: static void Reset();
+
+      /// \brief Number of times a path ran since the last Reset().
+      /// \param[in] _path The path.
+      /// \return The number of calls.
+      public: static uint64_t Calls(AllocationPath _path);
+
+      /// \brief Number of allocations made by a path since the last
+      /// Reset().
+      /// \param[in] _path The path.
+      /// \return The number of allocations.
+      public: static uint64_t Allocations(AllocationPath _path);
+
+      /// \brief Record an allocation of the current thread. Called by the
+      /// replaced operator new.
+      public: static void OnAllocation();
+    };
+    }
+  }
+}
+
+/// \brief Count the allocations of a hot path until the end of the scope.
+/// \param[in] _path Enumerator of AllocationPath, e.g. RECV_MSG_UPDATE.
+#ifdef IGN_TRANSPORT_ALLOCATION_COUNTING
+#define IGN_TRANSPORT_COUNT_ALLOCATIONS(_path) \
+  ignition::transport::AllocationCounter::Scope \
+    ignTransportAllocationScope( \
+      ignition::transport::AllocationPath::_path)
+#else
+#define IGN_TRANSPORT_COUNT_ALLOCATIONS(_path)
+#endif
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGN_TRANSPORT_BUFFERALLOCATOR_HH_
+#define IGN_TRANSPORT_BUFFERALLOCATOR_HH_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    // Forward declarations.
+    class LargeBufferAllocatorPrivate;
+
+    /// \class BufferAllocator BufferAllocator.hh
+    /// ignition/transport/BufferAllocator.hh
+    /// \brief Allocates the buffers of the serialized messages: the messages
+    /// serialized by Node::Publisher::Publish(), the large messages
+    /// reassembled or copied from shared memory by the subscribers, and the
+    /// queue of the log recorder. The default allocator of the process uses
+    /// the heap, unless IGN_TRANSPORT_HUGE_PAGES or IGN_TRANSPORT_NUMA_NODE
+    /// are set, in which case it's a LargeBufferAllocator. Applications can
+    /// replace it with SetDefault().
+    class IGNITION_TRANSPORT_VISIBLE BufferAllocator
+    {
+      /// \brief Destructor.
+      public: virtual ~BufferAllocator();
+
+      /// \brief Allocate a buffer.
+      /// \param[in] _size Size of the buffer (bytes).
+      /// \return The buffer, aligned for any type, or nullptr on failure.
+      public: virtual void *Allocate(const std::size_t _size) = 0;
+
+      /// \brief Deallocate a buffer returned by Allocate().
+      /// \param[in] _data The buffer.
+      /// \param[in] _size Size passed to Allocate().
+      public: virtual void Deallocate(void *_data,
+                                      const std::size_t _size) = 0;
+
+      /// \brief Get the default allocator of the process.
+      /// \return The allocator.
+      public: static std::shared_ptr<BufferAllocator> Default();
+
+      /// \brief Replace the default allocator of the process. The buffers
+      /// allocated before keep their allocator alive.
+      /// \param[in] _allocator The new allocator, or nullptr to restore the
+      /// heap allocator.
+      public: static void SetDefault(
+        const std::shared_ptr<BufferAllocator> &_allocator);
+
+      /// \brief Allocate a reference counted buffer with the default
+      /// allocator.
+      /// \param[in] _size Size of the buffer (bytes).
+      /// \return The buffer, or nullptr on failure.
+      public: static std::shared_ptr<char> Shared(const std::size_t _size);
+    };
+
+    /// \class HeapBufferAllocator BufferAllocator.hh
+    /// ignition/transport/BufferAllocator.hh
+    /// \brief Allocates the buffers on the heap.
+    class IGNITION_TRANSPORT_VISIBLE HeapBufferAllocator
+      : public BufferAllocator
+    {
+      // Documentation inherited.
+      public: void *Allocate(const std::size_t _size) override;
+
+      // Documentation inherited.
+      public: void Deallocate(void *_data, const std::size_t _size) override;
+    };
+
+    /// \class LargeBufferAllocator BufferAllocator.hh
+    /// ignition/transport/BufferAllocator.hh
+    /// \brief Allocates the large buffers from pools of memory mappings,
+    /// backed by 2 MB huge pages and bound to a NUMA node, and the small
+    /// ones on the heap. Huge pages avoid most TLB misses when reading large
+    /// messages. Binding the buffers to the NUMA node of the threads
+    /// processing the messages, e.g. with IGN_TRANSPORT_THREAD_AFFINITY,
+    /// avoids cross-socket memory traffic. Only supported on Linux, other
+    /// platforms use the heap.
+    class IGNITION_TRANSPORT_VISIBLE LargeBufferAllocator
+      : public BufferAllocator
+    {
+      /// \brief Default size from which the buffers are mapped (bytes).
+      public: static const std::size_t kDefaultThreshold = 1024 * 1024;
+
+      /// \brief Constructor.
+      /// \param[in] _hugePages True to back the buffers with huge pages.
+      /// Explicit huge pages are used if the system reserved some, and
+      /// transparent huge pages otherwise.
+      /// \param[in] _numaNode NUMA node the buffers are bound to, or -1 to
+      /// let the system place them.
+      /// \param[in] _threshold Size from which the buffers are mapped.
+      /// \param[in] _maxFreeBuffers Maximum number of idle mappings kept
+      /// for reuse.
+      public: LargeBufferAllocator(const bool _hugePages = true,
+                                   const int _numaNode = -1,
+                                   const std::size_t _threshold =
+                                     kDefaultThreshold,
+                                   const std::size_t _maxFreeBuffers = 8);
+
+      /// \brief Destructor. Unmaps the idle buffers.
+      public: ~LargeBufferAllocator() override;
+
+      // Documentation inherited.
+      public: void *Allocate(const std::size_t _size) override;
+
+      // Documentation inherited.
+      public: void Deallocate(void *_data, const std::size_t _size) override;
+
+      /// \brief Number of idle mappings kept for reuse.
+      /// \return The number of idle mappings.
+      public: std::size_t FreeCount() const;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::unique_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \internal
+      /// \brief Smart pointer to private data.
+      private: std::unique_ptr<LargeBufferAllocatorPrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+
+    /// \class BufferStdAllocator BufferAllocator.hh
+    /// ignition/transport/BufferAllocator.hh
+    /// \brief Standard allocator using the default BufferAllocator of the
+    /// process when it is constructed, for the containers of message data.
+    template<typename T>
+    class BufferStdAllocator
+    {
+      /// \brief Type allocated.
+      public: using value_type = T;
+
+      /// \brief The allocator follows the containers swapped or moved.
+      public: using propagate_on_container_swap = std::true_type;
+
+      /// \brief The allocator follows the containers moved.
+      public: using propagate_on_container_move_assignment = std::true_type;
+
+      /// \brief The allocator follows the containers copied.
+      public: using propagate_on_container_copy_assignment = std::true_type;
+
+      /// \brief Constructor.
+      public: BufferStdAllocator()
+        : allocator(BufferAllocator::Default())
+      {
+      }
+
+      /// \brief Conversion constructor.
+      /// \param[in] _other Allocator of another type.
+      public: template<typename U>
+        BufferStdAllocator(const BufferStdAllocator<U> &_other)  // NOLINT
+        : allocator(_other.allocator)
+      {
+      }
+
+      /// \brief Allocate memory.
+      /// \param[in] _n Number of elements.
+      /// \return The memory.
+      public: T *allocate(const std::size_t _n)
+      {
+        void *data = this->allocator->Allocate(_n * sizeof(T));
+        if (!data)
+          throw std::bad_alloc();
+        return static_cast<T *>(data);
+      }
+
+      /// \brief Deallocate memory.
+      /// \param[in] _data Memory returned by allocate().
+      /// \param[in] _n Number of elements.
+      public: void deallocate(T *_data, const std::size_t _n)
+      {
+        this->allocator->Deallocate(_data, _n * sizeof(T));
+      }
+
+      /// \brief Equality operator.
+      /// \param[in] _other Another allocator.
+      /// \return True if both use the same BufferAllocator.
+      public: template<typename U>
+        bool operator==(const BufferStdAllocator<U> &_other) const
+      {
+        return this->allocator == _other.allocator;
+      }
+
+      /// \brief Inequality operator.
+      /// \param[in] _other Another allocator.
+      /// \return True if they use different BufferAllocators.
+      public: template<typename U>
+        bool operator!=(const BufferStdAllocator<U> &_other) const
+      {
+        return !(*this == _other);
+      }
+
+      /// \brief The buffer allocator.
+      public: std::shared_ptr<BufferAllocator> allocator;
+    };
+    }
+  }
+}
+#endif
@@ -18,6 +18,8 @@
 #ifndef INCLUDE_IGNITION_TRANSPORT_CIFACE_H_
 #define INCLUDE_IGNITION_TRANSPORT_CIFACE_H_
 
+#include <stddef.h>
+
 #include "ignition/transport/Export.hh"
 
 #ifdef __cplusplus
@@ -32,6 +34,27 @@ extern "C" {
   /// \brief A transport node.
   typedef struct IgnTransportNode IgnTransportNode;
 
+  /// \brief A publisher of a transport node, see
+  /// ignTransportAdvertisePublisher().
+  typedef struct IgnTransportPublisher IgnTransportPublisher;
+
+  /// \brief A subscription whose messages are queued until they're polled,
+  /// see ignTransportSubscribePoll().
+  typedef struct IgnTransportSubscription IgnTransportSubscription;
+
+  /// \brief A message read by ignTransportPoll().
+  typedef struct IgnTransportMessage
+  {
+    /// \brief Serialized data of the message.
+    const char *data;
+
+    /// \brief Number of bytes of data.
+    size_t size;
+
+    /// \brief Name of the message type.
+    const char *msgType;
+  } IgnTransportMessage;
+
   /// \brief Create a transport node.
   /// \param[in] _partition Optional name of the partition to use.
   /// Use nullptr to use the default value, which is specified via the
@@ -57,10 +80,78 @@ extern "C" {
                       const char *_msgType);
 
 
+  /// \brief Advertise a topic and get its publisher, to publish without
+  /// looking the topic up on every message.
+  /// \param[in] _node Pointer to a node.
+  /// \param[in] _topic Topic on which to publish the messages.
+  /// \param[in] _msgType Name of the message type.
+  /// \return The publisher, owned by the node and valid until the node is
+  /// destroyed, or NULL on failure. Advertising a topic again returns the
+  /// same publisher.
+  IgnTransportPublisher IGNITION_TRANSPORT_VISIBLE *
+  ignTransportAdvertisePublisher(IgnTransportNode *_node,
+                                 const char *_topic,
+                                 const char *_msgType);
+
+  /// \brief Publish a message with a publisher.
+  /// \param[in] _publisher The publisher.
+  /// \param[in] _data Serialized data of the message, only read during
+  /// this call.
+  /// \param[in] _size Number of bytes of _data.
+  /// \return 0 on success.
+  int IGNITION_TRANSPORT_VISIBLE
+  ignTransportPublisherPublish(IgnTransportPublisher *_publisher,
+                               const void *_data,
+                               size_t _size);
+
+  /// \brief Publish several messages with a publisher, in order.
+  /// \param[in] _publisher The publisher.
+  /// \param[in] _data Serialized data of each message.
+  /// \param[in] _sizes Number of bytes of each message.
+  /// \param[in] _count Number of messages.
+  /// \return The number of messages that could not be published, 0 on
+  /// success.
+  size_t IGNITION_TRANSPORT_VISIBLE
+  ignTransportPublisherPublishBatch(IgnTransportPublisher *_publisher,
+                                    const void *const *_data,
+                                    const size_t *_sizes,
+                                    size_t _count);
+
+  /// \brief Borrow a buffer of a publisher, to serialize a message in it
+  /// and publish it with ignTransportPublisherPublishLoaned(), which
+  /// doesn't copy it for the remote subscribers.
+  /// \param[in] _publisher The publisher.
+  /// \param[in] _size Minimum size of the buffer, in bytes.
+  /// \return The buffer, or NULL on failure.
+  void IGNITION_TRANSPORT_VISIBLE *
+  ignTransportPublisherLoan(IgnTransportPublisher *_publisher, size_t _size);
+
+  /// \brief Publish a message serialized in a buffer of
+  /// ignTransportPublisherLoan(). The buffer goes back to the publisher, so
+  /// it must not be used after this call, even on failure.
+  /// \param[in] _publisher The publisher.
+  /// \param[in] _data The buffer.
+  /// \param[in] _size Number of bytes of the message in the buffer.
+  /// \return 0 on success.
+  int IGNITION_TRANSPORT_VISIBLE
+  ignTransportPublisherPublishLoaned(IgnTransportPublisher *_publisher,
+                                     void *_data,
+                                     size_t _size);
+
+  /// \brief Give back a buffer of ignTransportPublisherLoan() without
+  /// publishing it.
+  /// \param[in] _publisher The publisher.
+  /// \param[in] _data The buffer.
+  void IGNITION_TRANSPORT_VISIBLE
+  ignTransportPublisherReturnLoan(IgnTransportPublisher *_publisher,
+                                  void *_data);
+
   /// \brief Publishes a message on a topic.
   /// \param[in] _node Pointer to a node.
   /// \param[in] _topic Topic on which to publish the message.
-  /// \param[in] _data Byte array of serialized data to publish.
+  /// \param[in] _data Byte array of serialized data to publish. It's read
+  /// up to its first null byte; use ignTransportPublisherPublish() for data
+  /// of a given size.
   /// \param[in] _msgType Name of the message type.
   /// \return 0 on success.
   int IGNITION_TRANSPORT_VISIBLE
@@ -104,6 +195,56 @@ extern "C" {
                             void (*_callback)(char *, size_t, char *, void *),
                             void *_userData);
 
+  /// \brief Subscribe to a topic, queueing the messages received until
+  /// they're read with ignTransportPoll(), e.g. from the thread of an
+  /// event loop, instead of calling a callback from the reception thread.
+  /// \param[in] _node Pointer to a node.
+  /// \param[in] _topic Name of the topic.
+  /// \param[in] _capacity Maximum number of messages queued. The messages
+  /// received while the queue is full are dropped, see
+  /// ignTransportSubscriptionDropped().
+  /// \return The subscription, or NULL on failure. It's destroyed by
+  /// ignTransportUnsubscribePoll() or with its node.
+  IgnTransportSubscription IGNITION_TRANSPORT_VISIBLE *
+  ignTransportSubscribePoll(IgnTransportNode *_node,
+                            const char *_topic,
+                            size_t _capacity);
+
+  /// \brief Get a file descriptor that is readable while messages are
+  /// queued, to wait for them with select(), poll() or an event loop. It
+  /// must not be read or closed by the caller.
+  /// \param[in] _subscription The subscription.
+  /// \return The file descriptor, or -1 if the platform has none, in which
+  /// case the subscription must be polled periodically.
+  int IGNITION_TRANSPORT_VISIBLE
+  ignTransportSubscriptionFd(IgnTransportSubscription *_subscription);
+
+  /// \brief Read the messages queued, oldest first.
+  /// \param[in] _subscription The subscription.
+  /// \param[out] _msgs The messages read. Their data are valid until the
+  /// next call to ignTransportPoll() or ignTransportUnsubscribePoll().
+  /// \param[in] _max Maximum number of messages to read.
+  /// \return The number of messages read.
+  size_t IGNITION_TRANSPORT_VISIBLE
+  ignTransportPoll(IgnTransportSubscription *_subscription,
+                   IgnTransportMessage *_msgs,
+                   size_t _max);
+
+  /// \brief Get the number of messages dropped because the queue was full.
+  /// \param[in] _subscription The subscription.
+  /// \return The number of messages.
+  size_t IGNITION_TRANSPORT_VISIBLE
+  ignTransportSubscriptionDropped(IgnTransportSubscription *_subscription);
+
+  /// \brief Unsubscribe and destroy a subscription of
+  /// ignTransportSubscribePoll().
+  /// \param[in] _node Pointer to the node of the subscription.
+  /// \param[in, out] _subscription The subscription, set to NULL.
+  /// \return 0 on success.
+  int IGNITION_TRANSPORT_VISIBLE
+  ignTransportUnsubscribePoll(IgnTransportNode *_node,
+                              IgnTransportSubscription **_subscription);
+
   /// \brief Unsubscribe from a topic.
   /// \param[in] _node Pointer to a node.
   /// \param[in] _topic Name of the topic.
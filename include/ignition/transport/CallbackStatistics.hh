@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_CALLBACKSTATISTICS_HH_
+#define IGN_TRANSPORT_CALLBACKSTATISTICS_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Histogram.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \brief Execution time of the callback of a subscription, see
+    /// Node::CallbackStats(). The callbacks are timed when the subscription
+    /// is profiled, see SubscribeOptions::SetCallbackProfiling() and the
+    /// IGN_TRANSPORT_CALLBACK_BUDGET environment variable.
+    struct CallbackStatistics
+    {
+      /// \brief Topic of the subscription.
+      std::string topic;
+
+      /// \brief UUID of the subscription handler.
+      std::string handlerUuid;
+
+      /// \brief Durations of the callbacks, in microseconds.
+      Histogram duration;
+
+      /// \brief Budget of the callbacks, zero for none.
+      std::chrono::microseconds budget{0};
+
+      /// \brief Number of callbacks that took longer than the budget.
+      uint64_t overBudget = 0;
+    };
+    }
+  }
+}
+#endif
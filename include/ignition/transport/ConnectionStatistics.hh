@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_CONNECTIONSTATISTICS_HH_
+#define IGN_TRANSPORT_CONNECTIONSTATISTICS_HH_
+
+#include <cstdint>
+#include <string>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \brief Statistics of a connection of the sockets carrying the
+    /// messages of this process, see Node::ConnectionStats(). They are
+    /// collected from the events of the sockets when the
+    /// IGN_TRANSPORT_CONNECTION_STATISTICS environment variable is 1.
+    struct ConnectionStatistics
+    {
+      /// \brief "publisher" for the connections of the remote subscribers
+      /// to this process, "subscriber" for the connections of this process
+      /// to the remote publishers.
+      std::string socket;
+
+      /// \brief Address of the peer, e.g. "tcp://10.0.0.2:41234".
+      std::string endpoint;
+
+      /// \brief Whether the connection is up.
+      bool connected = false;
+
+      /// \brief Number of times the connection was established.
+      uint64_t connects = 0;
+
+      /// \brief Number of times the connection was lost or closed.
+      uint64_t disconnects = 0;
+
+      /// \brief Number of times the connection was established again
+      /// after it was lost.
+      uint64_t reconnects = 0;
+
+      /// \brief Number of failed attempts to connect to the peer, retried
+      /// later.
+      uint64_t connectRetries = 0;
+
+      /// \brief Number of connections rejected by the security handshake.
+      uint64_t handshakeFailures = 0;
+
+      /// \brief Bytes sent to the peer that it hasn't acknowledged yet, in
+      /// the queue of the TCP socket of the connection. It grows while the
+      /// peer can't keep up, until the messages queued in the publisher
+      /// reach its high water mark and are dropped. -1 if unknown, e.g.
+      /// for the ipc:// connections or on other systems than Linux.
+      int64_t queuedBytes = -1;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_DEVICEBUFFER_HH_
+#define IGN_TRANSPORT_DEVICEBUFFER_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/Serialization.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \brief Kind of device buffer referenced by a DeviceBufferHandle.
+    enum class DeviceBufferKind : uint32_t
+    {
+      /// \brief No buffer.
+      NONE = 0,
+
+      /// \brief A CUDA allocation exported with cudaIpcGetMemHandle().
+      CUDA_IPC = 1,
+
+      /// \brief A Linux dma-buf file descriptor, e.g. exported by a V4L2
+      /// camera, a GPU driver or Vulkan.
+      DMABUF = 2
+    };
+
+    /// \class DeviceBufferHandle DeviceBuffer.hh
+    /// ignition/transport/DeviceBuffer.hh
+    /// \brief A message that references a device buffer, e.g. a camera
+    /// frame in GPU memory, instead of carrying its bytes. Subscribers on
+    /// the same host map the buffer, so large frames are passed between
+    /// processes without copying them through the host memory.
+    ///
+    /// The handle is only meaningful on the host of the publisher, so the
+    /// topics of this type have at most the host scope. The publisher keeps
+    /// the buffer alive and unmodified while the subscribers use it, e.g.
+    /// by cycling over a pool of buffers larger than the subscriber queues.
+    /// This library doesn't depend on CUDA: the CUDA IPC handle is opaque,
+    /// and subscribers open it with cudaIpcOpenMemHandle().
+    ///
+    ///     cudaIpcMemHandle_t ipc;
+    ///     cudaIpcGetMemHandle(&ipc, devicePtr);
+    ///     pub.Publish(DeviceBufferHandle::CudaIpc(&ipc, sizeof(ipc),
+    ///       frameSize, device));
+    struct IGNITION_TRANSPORT_VISIBLE DeviceBufferHandle
+    {
+      /// \brief Largest opaque handle, the size of a cudaIpcMemHandle_t.
+      public: static constexpr std::size_t kMaxHandleSize = 64u;
+
+      /// \brief Reference a CUDA allocation.
+      /// \param[in] _ipcHandle The cudaIpcMemHandle_t of the allocation.
+      /// \param[in] _handleSize Size of _ipcHandle, at most kMaxHandleSize.
+      /// \param[in] _size Size of the buffer (bytes).
+      /// \param[in] _device CUDA device of the allocation.
+      /// \param[in] _offset Position of the buffer in the allocation.
+      /// \return The handle, whose kind is NONE if _handleSize is too big.
+      public: static DeviceBufferHandle CudaIpc(const void *_ipcHandle,
+                                                const std::size_t _handleSize,
+                                                const uint64_t _size,
+                                                const int32_t _device,
+                                                const uint64_t _offset = 0u);
+
+      /// \brief Reference a dma-buf of this process. Subscribers get their
+      /// own file descriptor of the buffer with ImportDmaBuf().
+      /// \param[in] _fd File descriptor of the dma-buf in this process.
+      /// \param[in] _size Size of the buffer (bytes).
+      /// \param[in] _offset Position of the buffer in the dma-buf.
+      /// \return The handle.
+      public: static DeviceBufferHandle DmaBuf(const int32_t _fd,
+                                               const uint64_t _size,
+                                               const uint64_t _offset = 0u);
+
+      /// \brief Get a file descriptor of the dma-buf in this process. The
+      /// descriptor is duplicated from the publisher with pidfd_getfd(),
+      /// which needs Linux 5.6 and the permission to trace the publisher,
+      /// e.g. the same user and a Yama ptrace_scope of 0. The caller closes
+      /// the returned descriptor.
+      /// \return The new file descriptor, or -1 on error, e.g. if this is
+      /// not a dma-buf handle or the publisher is gone.
+      public: int ImportDmaBuf() const;
+
+      /// \brief Process ID of the publisher, which owns the buffer.
+      public: int64_t pid = 0;
+
+      /// \brief Size of the buffer (bytes).
+      public: uint64_t size = 0u;
+
+      /// \brief Position of the buffer in the allocation or dma-buf.
+      public: uint64_t offset = 0u;
+
+      /// \brief Kind of buffer.
+      public: DeviceBufferKind kind = DeviceBufferKind::NONE;
+
+      /// \brief Device of the buffer, e.g. the CUDA device.
+      public: int32_t device = 0;
+
+      /// \brief File descriptor of the dma-buf in the publisher.
+      public: int32_t fd = -1;
+
+      /// \brief Number of bytes used in handle.
+      public: uint32_t handleSize = 0u;
+
+      /// \brief Opaque handle of the buffer, e.g. a cudaIpcMemHandle_t.
+      public: uint8_t handle[kMaxHandleSize] = {};
+    };
+
+    /// \brief The handles are sent as is, they are only read on the host
+    /// that published them.
+    template<>
+    struct Serializer<DeviceBufferHandle>
+      : public TrivialSerializer<DeviceBufferHandle>
+    {
+      /// \brief The handles can't be used by other hosts.
+      static constexpr bool kHostLocal = true;
+
+      /// \brief Get the name of the message type.
+      /// \return The name of the type.
+      static std::string TypeName()
+      {
+        return "ignition.transport.DeviceBufferHandle";
+      }
+    };
+    }
+  }
+}
+
+#endif
@@ -59,13 +59,21 @@
 #include <ignition/msgs/discovery.pb.h>
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <shared_mutex>  //NOLINT
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <ignition/msgs/Utility.hh>
@@ -73,9 +81,11 @@
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
 #include "ignition/transport/Helpers.hh"
+#include "ignition/transport/MetricsRegistry.hh"
 #include "ignition/transport/NetUtils.hh"
 #include "ignition/transport/Publisher.hh"
 #include "ignition/transport/TopicStorage.hh"
+#include "ignition/transport/TopicUtils.hh"
 #include "ignition/transport/TransportTypes.hh"
 
 namespace ignition
@@ -105,6 +115,17 @@ namespace ignition
       const std::vector<int> &_sockets,
       const int _timeout);
 
+    /// \internal
+    /// \brief Discovery helper function to poll several sockets at once.
+    /// \param[in] _sockets Sockets on which to listen.
+    /// \param[in] _timeout Length of time to poll (milliseconds).
+    /// \param[out] _readable Whether each socket has data to read.
+    /// \return True if any of the sockets received data.
+    bool IGNITION_TRANSPORT_VISIBLE pollSockets(
+      const std::vector<int> &_sockets,
+      const int _timeout,
+      std::vector<bool> &_readable);
+
     /// \class Discovery Discovery.hh ignition/transport/Discovery.hh
     /// \brief A discovery class that implements a distributed topic discovery
     /// protocol. It uses UDP multicast for sending/receiving messages and
@@ -113,6 +134,12 @@ namespace ignition
     /// discovery uses heartbeats to track the state of other peers in the
     /// network. The discovery clients can register callbacks to detect when
     /// new topics are discovered or topics are no longer available.
+    ///
+    /// When the IGN_DISCOVERY_SERVER environment variable contains the IP
+    /// address of a discovery server, no multicast traffic is used. All the
+    /// discovery messages are sent to the server via unicast, the server
+    /// keeps the state of the whole network and only forwards the changes
+    /// to the processes interested in them.
     template<typename Pub>
     class Discovery
     {
@@ -122,10 +149,13 @@ namespace ignition
       /// \param[in] _ip IP address used for discovery traffic.
       /// \param[in] _port UDP port used for discovery traffic.
       /// \param[in] _verbose true for enabling verbose mode.
+      /// \param[in] _server true for running as the discovery server that
+      /// the other processes register with. See IGN_DISCOVERY_SERVER.
       public: Discovery(const std::string &_pUuid,
                         const std::string &_ip,
                         const int _port,
-                        const bool _verbose = false)
+                        const bool _verbose = false,
+                        const bool _server = false)
         : multicastGroup(_ip),
           port(_port),
           hostAddr(determineHost()),
@@ -133,13 +163,16 @@ namespace ignition
           silenceInterval(kDefSilenceInterval),
           activityInterval(kDefActivityInterval),
           heartbeatInterval(kDefHeartbeatInterval),
+          currentHeartbeatInterval(kDefHeartbeatInterval),
           connectionCb(nullptr),
           disconnectionCb(nullptr),
           verbose(_verbose),
           initialized(false),
           numHeartbeatsUninitialized(0),
           exit(false),
-          enabled(false)
+          enabled(false),
+          server(_server),
+          useServer(false)
       {
         std::string ignIp;
         if (env("IGN_IP", ignIp) && !ignIp.empty())
@@ -210,12 +243,34 @@ namespace ignition
           return;
         }
 #endif
-        // Bind the first socket to the discovery port.
+        // Use a discovery server instead of the multicast group.
+        std::string ignServer;
+        if (!this->server && env("IGN_DISCOVERY_SERVER", ignServer) &&
+            !ignServer.empty())
+        {
+          memset(&this->serverAddr, 0, sizeof(this->serverAddr));
+          this->serverAddr.sin_family = AF_INET;
+          this->serverAddr.sin_addr.s_addr = inet_addr(ignServer.c_str());
+          this->serverAddr.sin_port = htons(static_cast<u_short>(this->port));
+
+          if (this->serverAddr.sin_addr.s_addr == INADDR_NONE)
+          {
+            std::cerr << "Invalid IGN_DISCOVERY_SERVER address [" << ignServer
+                      << "]. Using multicast discovery." << std::endl;
+          }
+          else
+            this->useServer = true;
+        }
+
+        // Bind the first socket to the discovery port. The clients of a
+        // discovery server only receive unicast traffic from the server, so
+        // any port will do.
         sockaddr_in localAddr;
         memset(&localAddr, 0, sizeof(localAddr));
         localAddr.sin_family = AF_INET;
         localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-        localAddr.sin_port = htons(static_cast<u_short>(this->port));
+        localAddr.sin_port =
+          htons(static_cast<u_short>(this->useServer ? 0 : this->port));
 
         if (bind(this->sockets.at(0),
           reinterpret_cast<sockaddr *>(&localAddr), sizeof(sockaddr_in)) < 0)
@@ -224,6 +279,14 @@ namespace ignition
           return;
         }
 
+        // The reception thread can be woken up by the other threads.
+        this->CreateWakeSocket();
+
+        // Restrict the discovery traffic to some of the interfaces.
+        std::string ignIfaces;
+        if (env("IGN_DISCOVERY_INTERFACES", ignIfaces) && !ignIfaces.empty())
+          this->SetInterfaces(transport::split(ignIfaces, ':'));
+
         // Set 'mcastAddr' to the multicast discovery group.
         memset(&this->mcastAddr, 0, sizeof(this->mcastAddr));
         this->mcastAddr.sin_family = AF_INET;
@@ -231,9 +294,11 @@ namespace ignition
           inet_addr(this->multicastGroup.c_str());
         this->mcastAddr.sin_port = htons(static_cast<u_short>(this->port));
 
+        // The relays are not used with a discovery server.
         std::vector<std::string> relays;
         std::string ignRelay = "";
-        if (env("IGN_RELAY", ignRelay) && !ignRelay.empty())
+        if (!this->server && !this->useServer &&
+            env("IGN_RELAY", ignRelay) && !ignRelay.empty())
         {
           relays = transport::split(ignRelay, ':');
         }
@@ -253,11 +318,15 @@ namespace ignition
         this->exitMutex.lock();
         this->exit = true;
         this->exitMutex.unlock();
+        this->Wake();
 
         // Wait for the service threads to finish before exit.
         if (this->threadReception.joinable())
           this->threadReception.join();
 
+        // Keep the last state for the next start.
+        this->SaveCache();
+
         // Broadcast a BYE message to trigger the remote cancellation of
         // all our advertised topics.
         this->SendMsg(DestinationType::ALL, msgs::Discovery::BYE,
@@ -271,6 +340,15 @@ namespace ignition
           WSACleanup();
 #else
           close(sock);
+#endif
+        }
+
+        if (this->wakeSocket >= 0)
+        {
+#ifdef _WIN32
+          closesocket(this->wakeSocket);
+#else
+          close(this->wakeSocket);
 #endif
         }
       }
@@ -293,9 +371,33 @@ namespace ignition
         auto now = std::chrono::steady_clock::now();
         this->timeNextHeartbeat = now;
         this->timeNextActivity = now;
+        this->timeServerActivity = now;
+
+        // The discovery server doesn't wait for anybody.
+        if (!this->server)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->handshaking = true;
+          this->timeHandshakeEnd = now +
+            std::chrono::milliseconds(kHandshakeQuietInterval);
+        }
+
+        // Reuse the publishers known before a restart.
+        this->timeNextCache = now;
+        this->LoadCache();
 
         // Start the thread that receives discovery information.
         this->threadReception = std::thread(&Discovery::RecvMessages, this);
+        configureThread(this->threadReception, "ign-discovery");
+
+        // Ask all the peers for their discovery state, instead of waiting
+        // for their heartbeats. See UpdateHandshake.
+        if (!this->server)
+        {
+          Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
+          this->SendMsg(DestinationType::ALL, msgs::Discovery::SUBSCRIBE, pub,
+            {{kSnapshotOfKey, kAnyProcess}});
+        }
       }
 
       /// \brief Advertise a new message.
@@ -304,6 +406,7 @@ namespace ignition
       /// (e.g. if the discovery has not been started).
       public: bool Advertise(const Pub &_publisher)
       {
+        uint64_t seqNum = 0;
         {
           std::lock_guard<std::mutex> lock(this->mutex);
 
@@ -311,15 +414,90 @@ namespace ignition
             return false;
 
           // Add the addressing information (local publisher).
-          if (!this->info.AddPublisher(_publisher))
-            return false;
+          {
+            std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
+            if (!this->info.AddPublisher(_publisher))
+              return false;
+          }
+
+          if (_publisher.Options().Scope() != Scope_t::PROCESS)
+          {
+            seqNum = ++this->seq;
+            this->MarkChanged(false);
+          }
         }
 
         // Only advertise a message outside this process if the scope
         // is not 'Process'
         if (_publisher.Options().Scope() != Scope_t::PROCESS)
+        {
           this->SendMsg(DestinationType::ALL, msgs::Discovery::ADVERTISE,
-              _publisher);
+              _publisher, {{kSeqKey, std::to_string(seqNum)}});
+
+          // The next heartbeat might be due earlier now.
+          this->Wake();
+        }
+
+        return true;
+      }
+
+      /// \brief Advertise a set of new messages. The advertisements are sent
+      /// together, batched in as few datagrams as possible.
+      /// \param[in] _publishers Publishers' information to advertise.
+      /// \param[out] _advertised Whether each publisher was advertised. A
+      /// publisher fails if it was already advertised.
+      /// \return True if the method succeed or false otherwise
+      /// (e.g. if the discovery has not been started).
+      public: bool Advertise(const std::vector<Pub> &_publishers,
+                             std::vector<bool> &_advertised)
+      {
+        _advertised.assign(_publishers.size(), false);
+        std::vector<msgs::Discovery> discoveryMsgs;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+
+          if (!this->enabled)
+            return false;
+
+          for (std::size_t i = 0; i < _publishers.size(); ++i)
+          {
+            const Pub &publisher = _publishers[i];
+
+            // Add the addressing information (local publisher).
+            {
+              std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
+              if (!this->info.AddPublisher(publisher))
+                continue;
+            }
+            _advertised[i] = true;
+
+            // Only advertise a message outside this process if the scope
+            // is not 'Process'
+            if (publisher.Options().Scope() == Scope_t::PROCESS)
+              continue;
+
+            msgs::Discovery discoveryMsg;
+            if (!this->FillDiscoveryMsg(msgs::Discovery::ADVERTISE,
+                  publisher, this->pUuid, discoveryMsg))
+            {
+              continue;
+            }
+            SetHeaderValue(kSeqKey, std::to_string(++this->seq),
+              discoveryMsg);
+            discoveryMsgs.push_back(discoveryMsg);
+          }
+
+          if (!discoveryMsgs.empty())
+            this->MarkChanged(false);
+        }
+
+        if (!discoveryMsgs.empty())
+        {
+          this->SendMsgs(DestinationType::ALL, discoveryMsgs);
+
+          // The next heartbeat might be due earlier now.
+          this->Wake();
+        }
 
         return true;
       }
@@ -336,17 +514,19 @@ namespace ignition
       /// (e.g. if the discovery has not been started).
       public: bool Discover(const std::string &_topic) const
       {
-        DiscoveryCallback<Pub> cb;
         bool found;
         Addresses_M<Pub> addresses;
 
-        {
-          std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->enabled)
+          return false;
 
-          if (!this->enabled)
-            return false;
+        const CallbackPtr cb = LoadCallback(this->connectionCb);
 
-          cb = this->connectionCb;
+        // We are interested in the advertisements of this partition now.
+        if (this->partitionFilter)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->partitions.insert(PartitionOf(_topic));
         }
 
         Pub pub;
@@ -357,7 +537,7 @@ namespace ignition
         this->SendMsg(DestinationType::ALL, msgs::Discovery::SUBSCRIBE, pub);
 
         {
-          std::lock_guard<std::mutex> lock(this->mutex);
+          std::shared_lock<std::shared_mutex> lock(this->infoMutex);
           found = this->info.Publishers(_topic, addresses);
         }
 
@@ -373,7 +553,7 @@ namespace ignition
                 // Execute the user's callback for a service request. Notice
                 // that we only execute one callback for preventing receive
                 //  multiple service responses for a single request.
-                cb(node);
+                (*cb)(node);
               }
             }
           }
@@ -382,6 +562,76 @@ namespace ignition
         return true;
       }
 
+      /// \brief Request discovery information about a set of topics. The
+      /// requests are sent together, batched in as few datagrams as
+      /// possible.
+      /// \param[in] _topics Topic names requested.
+      /// \param[in] _notifyKnown Whether to execute the connection callback
+      /// for the publishers already known. Only the new advertisements are
+      /// notified otherwise.
+      /// \return True if the method succeeded or false otherwise
+      /// (e.g. if the discovery has not been started).
+      /// \sa Discover(const std::string &)
+      public: bool Discover(const std::vector<std::string> &_topics,
+                            const bool _notifyKnown = true) const
+      {
+        std::vector<msgs::Discovery> discoveryMsgs;
+        discoveryMsgs.reserve(_topics.size());
+
+        if (!this->enabled)
+          return false;
+
+        const CallbackPtr cb = LoadCallback(this->connectionCb);
+
+        // We are interested in the advertisements of these partitions now.
+        if (this->partitionFilter)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          for (const auto &topic : _topics)
+            this->partitions.insert(PartitionOf(topic));
+        }
+
+        for (const auto &topic : _topics)
+        {
+          Pub pub;
+          pub.SetTopic(topic);
+          pub.SetPUuid(this->pUuid);
+
+          msgs::Discovery discoveryMsg;
+          if (this->FillDiscoveryMsg(msgs::Discovery::SUBSCRIBE, pub,
+                this->pUuid, discoveryMsg))
+          {
+            discoveryMsgs.push_back(discoveryMsg);
+          }
+        }
+
+        // Send the discovery requests.
+        if (!discoveryMsgs.empty())
+          this->SendMsgs(DestinationType::ALL, discoveryMsgs);
+
+        if (!cb || !_notifyKnown)
+          return true;
+
+        // Notify the publishers that we already know about.
+        for (const auto &topic : _topics)
+        {
+          Addresses_M<Pub> addresses;
+          {
+            std::shared_lock<std::shared_mutex> lock(this->infoMutex);
+            if (!this->info.Publishers(topic, addresses))
+              continue;
+          }
+
+          for (const auto &proc : addresses)
+          {
+            for (const auto &node : proc.second)
+              (*cb)(node);
+          }
+        }
+
+        return true;
+      }
+
       /// \brief Register a node from this process as a remote subscriber.
       /// \param[in] _pub Contains information about the subscriber.
       public: void Register(const MessagePublisher &_pub) const
@@ -398,11 +648,34 @@ namespace ignition
           DestinationType::ALL, msgs::Discovery::END_CONNECTION, _pub);
       }
 
-      /// \brief Get the discovery information.
+      /// \brief Unregister nodes from this process as remote subscribers.
+      /// The messages are sent together, batched in as few datagrams as
+      /// possible.
+      /// \param[in] _pubs Information about the subscribers.
+      public: void Unregister(const std::vector<MessagePublisher> &_pubs) const
+      {
+        std::vector<msgs::Discovery> discoveryMsgs;
+        discoveryMsgs.reserve(_pubs.size());
+        for (const auto &pub : _pubs)
+        {
+          msgs::Discovery discoveryMsg;
+          if (this->FillDiscoveryMsg(msgs::Discovery::END_CONNECTION, pub,
+                this->pUuid, discoveryMsg))
+          {
+            discoveryMsgs.push_back(discoveryMsg);
+          }
+        }
+
+        if (!discoveryMsgs.empty())
+          this->SendMsgs(DestinationType::ALL, discoveryMsgs);
+      }
+
+      /// \brief Get the discovery information. The reception thread keeps
+      /// updating it, prefer Publishers(), PublishersByNode() or TopicList().
       /// \return Reference to the discovery information object.
       public: const TopicStorage<Pub> &Info() const
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
+        std::shared_lock<std::shared_mutex> lock(this->infoMutex);
         return this->info;
       }
 
@@ -413,10 +686,22 @@ namespace ignition
       public: bool Publishers(const std::string &_topic,
                               Addresses_M<Pub> &_publishers) const
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
+        std::shared_lock<std::shared_mutex> lock(this->infoMutex);
         return this->info.Publishers(_topic, _publishers);
       }
 
+      /// \brief Get all the publishers' information of a node.
+      /// \param[in] _pUuid Process UUID of the node.
+      /// \param[in] _nUuid Node UUID.
+      /// \param[out] _publishers Publishers of the node.
+      public: void PublishersByNode(const std::string &_pUuid,
+                                    const std::string &_nUuid,
+                                    std::vector<Pub> &_publishers) const
+      {
+        std::shared_lock<std::shared_mutex> lock(this->infoMutex);
+        this->info.PublishersByNode(_pUuid, _nUuid, _publishers);
+      }
+
       /// \brief Unadvertise a new message. Broadcast a discovery
       /// message that will cancel all the discovery information for the topic
       /// advertised by a specific node.
@@ -428,18 +713,30 @@ namespace ignition
                                const std::string &_nUuid)
       {
         Pub inf;
+        uint64_t seqNum = 0;
         {
           std::lock_guard<std::mutex> lock(this->mutex);
 
           if (!this->enabled)
             return false;
 
-          // Don't do anything if the topic is not advertised by any of my nodes
-          if (!this->info.Publisher(_topic, this->pUuid, _nUuid, inf))
-            return true;
+          {
+            std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
 
-          // Remove the topic information.
-          this->info.DelPublisherByNode(_topic, this->pUuid, _nUuid);
+            // Don't do anything if the topic is not advertised by any of my
+            // nodes.
+            if (!this->info.Publisher(_topic, this->pUuid, _nUuid, inf))
+              return true;
+
+            // Remove the topic information.
+            this->info.DelPublisherByNode(_topic, this->pUuid, _nUuid);
+          }
+
+          if (inf.Options().Scope() != Scope_t::PROCESS)
+          {
+            seqNum = ++this->seq;
+            this->MarkChanged(false);
+          }
         }
 
         // Only unadvertise a message outside this process if the scope
@@ -447,7 +744,67 @@ namespace ignition
         if (inf.Options().Scope() != Scope_t::PROCESS)
         {
           this->SendMsg(DestinationType::ALL,
-              msgs::Discovery::UNADVERTISE, inf);
+              msgs::Discovery::UNADVERTISE, inf,
+              {{kSeqKey, std::to_string(seqNum)}});
+
+          // The next heartbeat might be due earlier now.
+          this->Wake();
+        }
+
+        return true;
+      }
+
+      /// \brief Unadvertise all the topics of a node of this process. The
+      /// unadvertisements are sent together, batched in as few datagrams as
+      /// possible.
+      /// \param[in] _nUuid Node's UUID.
+      /// \return True if the method succeeded or false otherwise
+      /// (e.g. if the discovery has not been started).
+      public: bool UnadvertiseNode(const std::string &_nUuid)
+      {
+        std::vector<msgs::Discovery> discoveryMsgs;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+
+          if (!this->enabled)
+            return false;
+
+          // Remove the topic information.
+          std::vector<Pub> removed;
+          {
+            std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
+            if (!this->info.DelPublishersByNode(this->pUuid, _nUuid, removed))
+              return true;
+          }
+
+          for (const auto &inf : removed)
+          {
+            // Only unadvertise a message outside this process if the scope
+            // is not 'Process'.
+            if (inf.Options().Scope() == Scope_t::PROCESS)
+              continue;
+
+            msgs::Discovery discoveryMsg;
+            if (!this->FillDiscoveryMsg(msgs::Discovery::UNADVERTISE, inf,
+                  this->pUuid, discoveryMsg))
+            {
+              continue;
+            }
+            SetHeaderValue(kSeqKey, std::to_string(++this->seq),
+              discoveryMsg);
+            discoveryMsgs.push_back(discoveryMsg);
+          }
+
+          if (!discoveryMsgs.empty())
+            this->MarkChanged(false);
+        }
+
+        if (!discoveryMsgs.empty())
+        {
+          this->SendMsgs(DestinationType::ALL, discoveryMsgs);
+
+          // The next heartbeat might be due earlier now.
+          this->Wake();
         }
 
         return true;
@@ -461,6 +818,71 @@ namespace ignition
         return this->hostAddr;
       }
 
+      /// \brief Get the network interfaces used for the discovery traffic.
+      /// \sa SetInterfaces.
+      /// \return IP addresses of the interfaces.
+      public: std::vector<std::string> Interfaces() const
+      {
+        std::lock_guard<std::mutex> lock(this->socketsMutex);
+        std::vector<std::string> ifaces;
+        for (std::size_t i = 0; i < this->socketIfaces.size(); ++i)
+        {
+          if (this->activeSockets[i])
+            ifaces.push_back(this->socketIfaces[i]);
+        }
+        return ifaces;
+      }
+
+      /// \brief Restrict the discovery traffic to some of the network
+      /// interfaces of the host: the multicast messages are only sent and
+      /// received through these interfaces. The unicast messages (relays and
+      /// discovery server) are not affected.
+      /// \param[in] _ifaces IP addresses of the interfaces. An empty list
+      /// selects all the interfaces again.
+      /// \return False if none of the interfaces is used by the discovery, in
+      /// which case nothing changes.
+      public: bool SetInterfaces(const std::vector<std::string> &_ifaces)
+      {
+        std::lock_guard<std::mutex> lock(this->socketsMutex);
+
+        std::vector<bool> active(this->sockets.size(), false);
+        bool any = false;
+        for (std::size_t i = 0; i < this->socketIfaces.size(); ++i)
+        {
+          active[i] = _ifaces.empty() ||
+            std::find(_ifaces.begin(), _ifaces.end(),
+              this->socketIfaces[i]) != _ifaces.end();
+          any = any || active[i];
+        }
+
+        if (!any)
+        {
+          std::cerr << "None of the requested interfaces is used by the "
+                    << "discovery. Keeping the current interfaces."
+                    << std::endl;
+          return false;
+        }
+
+        // Join or leave the multicast group on the receiving socket.
+        for (std::size_t i = 0; i < active.size(); ++i)
+        {
+          if (active[i] == this->activeSockets[i])
+            continue;
+
+          struct ip_mreq group;
+          group.imr_multiaddr.s_addr =
+            inet_addr(this->multicastGroup.c_str());
+          group.imr_interface.s_addr =
+            inet_addr(this->socketIfaces[i].c_str());
+          setsockopt(this->sockets.at(0), IPPROTO_IP,
+            active[i] ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+            reinterpret_cast<const char*>(&group), sizeof(group));
+        }
+
+        this->activeSockets = active;
+        return true;
+      }
+
       /// \brief The discovery checks the validity of the topic information
       /// every 'activity interval' milliseconds.
       /// \sa SetActivityInterval.
@@ -497,8 +919,11 @@ namespace ignition
       /// \param[in] _ms New value in milliseconds.
       public: void SetActivityInterval(const unsigned int _ms)
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
-        this->activityInterval = _ms;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->activityInterval = _ms;
+        }
+        this->Wake();
       }
 
       /// \brief Set the heartbeat interval.
@@ -506,8 +931,11 @@ namespace ignition
       /// \param[in] _ms New value in milliseconds.
       public: void SetHeartbeatInterval(const unsigned int _ms)
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
-        this->heartbeatInterval = _ms;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->heartbeatInterval = _ms;
+        }
+        this->Wake();
       }
 
       /// \brief Set the maximum silence interval.
@@ -519,14 +947,124 @@ namespace ignition
         this->silenceInterval = _ms;
       }
 
+      /// \brief Whether the heartbeats back off while the discovery state
+      /// doesn't change.
+      /// \sa SetAdaptiveHeartbeat.
+      /// \return True if the adaptive heartbeat is enabled.
+      public: bool AdaptiveHeartbeat() const
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->adaptiveHeartbeat;
+      }
+
+      /// \brief Enable or disable the adaptive heartbeat. When enabled, the
+      /// interval between heartbeats doubles each time that nothing changed
+      /// since the previous heartbeat, up to kMaxHeartbeatBackoff times the
+      /// heartbeat interval. Any change (e.g.: an advertisement or a new
+      /// remote process) brings it back to the heartbeat interval. Each
+      /// heartbeat announces the time until the next one, so the remote
+      /// processes extend their silence interval.
+      /// \param[in] _enabled True for enabling the adaptive heartbeat.
+      public: void SetAdaptiveHeartbeat(const bool _enabled)
+      {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->adaptiveHeartbeat = _enabled;
+        }
+        this->Wake();
+      }
+
+      /// \brief Whether the remote advertisements are filtered by partition.
+      /// \sa SetPartitionFilter.
+      /// \return True if the partition filter is enabled.
+      public: bool PartitionFilter() const
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->partitionFilter;
+      }
+
+      /// \brief Only store the remote advertisements of the partitions added
+      /// with AddPartition() or used by Discover(), instead of the
+      /// advertisements of the whole network. The topics of the other
+      /// partitions won't be listed by TopicList(). It should be enabled
+      /// before Start(), the advertisements already received are kept.
+      /// \param[in] _enabled True for enabling the filter.
+      public: void SetPartitionFilter(const bool _enabled)
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->partitionFilter = _enabled;
+      }
+
+      /// \brief Accept the remote advertisements of a partition when the
+      /// partition filter is enabled.
+      /// \sa SetPartitionFilter.
+      /// \param[in] _partition Partition name.
+      public: void AddPartition(const std::string &_partition)
+      {
+        std::string name;
+        if (!TopicUtils::FullyQualifiedName(_partition, "", "t", name))
+          return;
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->partitions.insert(PartitionOf(name));
+      }
+
+      /// \brief Keep a copy of the remote publishers in a file, so a restart
+      /// doesn't have to wait for the peers to announce them again. Start()
+      /// loads the file and the copy is written every kCacheInterval
+      /// milliseconds while the information changes. The publishers loaded
+      /// are used right away, e.g. Discover() connects to them, until the
+      /// heartbeats of their processes confirm them or they expire like any
+      /// silent process. Each process should use its own file. It should be
+      /// set before Start().
+      /// \param[in] _path Path of the file, or an empty string for not
+      /// keeping a copy (the default).
+      public: void SetCachePath(const std::string &_path)
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->cachePath = _path;
+      }
+
+      /// \brief Get the path of the file keeping a copy of the remote
+      /// publishers.
+      /// \sa SetCachePath.
+      /// \return The path, or an empty string if there is no copy.
+      public: std::string CachePath() const
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->cachePath;
+      }
+
+      /// \brief Set the capabilities of this process, announced with its
+      /// publishers. The meaning of the bits is up to the user of the
+      /// discovery, e.g. the features of the service requests that the
+      /// responsers of this process understand. It should be set before
+      /// Start().
+      /// \param[in] _caps Bitmap of the capabilities.
+      public: void SetCapabilities(const uint64_t _caps)
+      {
+        std::lock_guard<std::mutex> lock(this->capsMutex);
+        this->capabilities[this->pUuid] = _caps;
+      }
+
+      /// \brief Get the capabilities announced by a process.
+      /// \param[in] _pUuid UUID of the process.
+      /// \return Bitmap of the capabilities, 0 if the process didn't
+      /// announce any, e.g. because it predates them.
+      public: uint64_t Capabilities(const std::string &_pUuid) const
+      {
+        std::lock_guard<std::mutex> lock(this->capsMutex);
+        auto it = this->capabilities.find(_pUuid);
+        return it != this->capabilities.end() ? it->second : 0;
+      }
+
       /// \brief Register a callback to receive discovery connection events.
       /// Each time a new topic is connected, the callback will be executed.
       /// This version uses a free function as callback.
       /// \param[in] _cb Function callback.
       public: void ConnectionsCb(const DiscoveryCallback<Pub> &_cb)
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
-        this->connectionCb = _cb;
+        StoreCallback(this->connectionCb, _cb);
       }
 
       /// \brief Register a callback to receive discovery disconnection events.
@@ -535,8 +1073,7 @@ namespace ignition
       /// \param[in] _cb Function callback.
       public: void DisconnectionsCb(const DiscoveryCallback<Pub> &_cb)
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
-        this->disconnectionCb = _cb;
+        StoreCallback(this->disconnectionCb, _cb);
       }
 
       /// \brief Register a callback to receive an event when a new remote
@@ -544,8 +1081,7 @@ namespace ignition
       /// \param[in] _cb Function callback.
       public: void RegistrationsCb(const DiscoveryCallback<Pub> &_cb)
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
-        this->registrationCb = _cb;
+        StoreCallback(this->registrationCb, _cb);
       }
 
       /// \brief Register a callback to receive an event when a remote
@@ -553,8 +1089,7 @@ namespace ignition
       /// \param[in] _cb Function callback.
       public: void UnregistrationsCb(const DiscoveryCallback<Pub> &_cb)
       {
-        std::lock_guard<std::mutex> lock(this->mutex);
-        this->unregistrationCb = _cb;
+        StoreCallback(this->unregistrationCb, _cb);
       }
 
       /// \brief Print the current discovery state.
@@ -564,7 +1099,7 @@ namespace ignition
 
         std::cout << "---------------" << std::endl;
         std::cout << std::boolalpha << "Enabled: "
-                  << this->enabled << std::endl;
+                  << this->enabled.load() << std::endl;
         std::cout << "Discovery state" << std::endl;
         std::cout << "\tUUID: " << this->pUuid << std::endl;
         std::cout << "Settings" << std::endl;
@@ -575,11 +1110,15 @@ namespace ignition
         std::cout << "\tSilence: " << this->silenceInterval
                   << " ms." << std::endl;
         std::cout << "Known information:" << std::endl;
-        this->info.Print();
+        {
+          std::shared_lock<std::shared_mutex> infoLock(this->infoMutex);
+          this->info.Print();
+        }
 
         // Used to calculate the elapsed time.
         Timestamp now = std::chrono::steady_clock::now();
 
+        std::lock_guard<std::mutex> activityLock(this->activityMutex);
         std::cout << "Activity" << std::endl;
         if (this->activity.empty())
           std::cout << "\t<empty>" << std::endl;
@@ -604,20 +1143,22 @@ namespace ignition
       public: void TopicList(std::vector<std::string> &_topics) const
       {
         this->WaitForInit();
-        std::lock_guard<std::mutex> lock(this->mutex);
+        std::shared_lock<std::shared_mutex> lock(this->infoMutex);
         this->info.TopicList(_topics);
       }
 
       /// \brief Check if ready/initialized. If not, then wait on the
-      /// initializedCv condition variable.
+      /// initializedCv condition variable. The discovery is initialized once
+      /// the peers have answered the request for their state sent by Start(),
+      /// or after two heartbeats at most.
       public: void WaitForInit() const
       {
-        std::unique_lock<std::mutex> lk(this->mutex);
+        // The discovery is initialized most of the time, no need to lock.
+        if (this->initialized)
+          return;
 
-        if (!this->initialized)
-        {
-          this->initializedCv.wait(lk, [this]{return this->initialized;});
-        }
+        std::unique_lock<std::mutex> lk(this->mutex);
+        this->initializedCv.wait(lk, [this]{return this->initialized.load();});
       }
 
       /// \brief Check the validity of the topic information. Each topic update
@@ -628,8 +1169,11 @@ namespace ignition
         // The UUIDs of the processes that have expired.
         std::vector<std::string> uuids;
 
-        // A copy of the disconnection callback.
-        DiscoveryCallback<Pub> disconnectCb;
+        // The disconnection callback.
+        CallbackPtr disconnectCb;
+
+        // The clients of the discovery server that are still alive.
+        std::vector<sockaddr_in> clientAddrs;
 
         Timestamp now = std::chrono::steady_clock::now();
 
@@ -639,19 +1183,41 @@ namespace ignition
           if (now < this->timeNextActivity)
             return;
 
-          disconnectCb = this->disconnectionCb;
+          disconnectCb = LoadCallback(this->disconnectionCb);
 
+          std::lock_guard<std::mutex> activityLock(this->activityMutex);
           for (auto it = this->activity.cbegin(); it != this->activity.cend();)
           {
-            // Elapsed time since the last update from this publisher.
-            auto elapsed = now - it->second;
+            // Elapsed time since the last update from this publisher. The
+            // clients of a discovery server only hear from the server, which
+            // notifies them when a remote process expires.
+            auto elapsed =
+              now - (this->useServer ? this->timeServerActivity : it->second);
+
+            // A remote process with a longer heartbeat interval is given
+            // more time.
+            unsigned int silence = this->silenceInterval;
+            auto remoteInterval = this->remoteHeartbeats.find(it->first);
+            if (remoteInterval != this->remoteHeartbeats.end())
+            {
+              silence = std::max(silence,
+                kSilenceHeartbeats * remoteInterval->second);
+            }
 
             // This publisher has expired.
             if (std::chrono::duration_cast<std::chrono::milliseconds>
-                 (elapsed).count() > this->silenceInterval)
+                 (elapsed).count() > silence)
             {
               // Remove all the info entries for this process UUID.
-              this->info.DelPublishersByProc(it->first);
+              {
+                std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
+                this->info.DelPublishersByProc(it->first);
+              }
+              this->RemoveCapabilities(it->first);
+              this->clients.erase(it->first);
+              this->remoteSeqs.erase(it->first);
+              this->pubSeqs.erase(it->first);
+              this->remoteHeartbeats.erase(it->first);
 
               uuids.push_back(it->first);
 
@@ -662,10 +1228,30 @@ namespace ignition
               ++it;
           }
 
+          if (!uuids.empty())
+          {
+            this->MarkChanged(false);
+            if (this->server)
+              clientAddrs = this->ClientAddrs("");
+          }
+
           this->timeNextActivity = std::chrono::steady_clock::now() +
             std::chrono::milliseconds(this->activityInterval);
         }
 
+        // The discovery server says goodbye on behalf of the expired
+        // processes.
+        for (auto const &uuid : uuids)
+        {
+          if (clientAddrs.empty())
+            break;
+
+          msgs::Discovery byeMsg;
+          Publisher pub("", "", uuid, "", AdvertiseOptions());
+          if (this->FillDiscoveryMsg(msgs::Discovery::BYE, pub, uuid, byeMsg))
+            this->SendUnicast(byeMsg, clientAddrs);
+        }
+
         if (!disconnectCb)
           return;
 
@@ -676,42 +1262,44 @@ namespace ignition
         {
           Pub publisher;
           publisher.SetPUuid(uuid);
-          disconnectCb(publisher);
+          (*disconnectCb)(publisher);
         }
       }
 
-      /// \brief Broadcast periodic heartbeats.
+      /// \brief Broadcast periodic heartbeats. Each heartbeat contains the
+      /// sequence number of our discovery state, the remote processes that
+      /// are not in sync request a snapshot of it.
       private: void UpdateHeartbeat()
       {
         Timestamp now = std::chrono::steady_clock::now();
+        uint64_t seqNum;
+        unsigned int interval;
 
         {
           std::lock_guard<std::mutex> lock(this->mutex);
 
           if (now < this->timeNextHeartbeat)
             return;
-        }
 
-        Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
-        this->SendMsg(DestinationType::ALL, msgs::Discovery::HEARTBEAT, pub);
+          seqNum = this->seq;
 
-        std::map<std::string, std::vector<Pub>> nodes;
-        {
-          std::lock_guard<std::mutex> lock(this->mutex);
-
-          // Re-advertise topics that are advertised inside this process.
-          this->info.PublishersByProc(this->pUuid, nodes);
-        }
-
-        for (const auto &topic : nodes)
-        {
-          for (const auto &node : topic.second)
+          // Back off while nothing changes.
+          if (this->adaptiveHeartbeat && this->initialized &&
+              !this->discoveryChanged)
           {
-            this->SendMsg(DestinationType::ALL,
-                msgs::Discovery::ADVERTISE, node);
+            this->currentHeartbeatInterval = std::min(
+              this->currentHeartbeatInterval * 2,
+              this->heartbeatInterval * kMaxHeartbeatBackoff);
           }
+          else
+            this->currentHeartbeatInterval = this->heartbeatInterval;
+
+          this->discoveryChanged = false;
+          interval = this->currentHeartbeatInterval;
         }
 
+        this->SendHeartbeat(seqNum, interval);
+
         {
           std::lock_guard<std::mutex> lock(this->mutex);
           if (!this->initialized)
@@ -722,6 +1310,7 @@ namespace ignition
               // We consider the discovery initialized after two cycles of
               // heartbeats sent.
               this->initialized = true;
+              this->handshaking = false;
 
               // Notify anyone waiting for the initialization phase to finish.
               this->initializedCv.notify_all();
@@ -729,8 +1318,40 @@ namespace ignition
           }
 
           this->timeNextHeartbeat = std::chrono::steady_clock::now() +
-            std::chrono::milliseconds(this->heartbeatInterval);
+            std::chrono::milliseconds(interval);
+        }
+      }
+
+      /// \brief Send a heartbeat. The heartbeats sent to the multicast group
+      /// use the compact binary layout of EncodeHeartbeat(), the relays and
+      /// the discovery server receive regular discovery messages.
+      /// \param[in] _seq Sequence number of our discovery state.
+      /// \param[in] _interval Current heartbeat interval (ms.).
+      private: void SendHeartbeat(const uint64_t _seq,
+                                  const unsigned int _interval) const
+      {
+        Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
+        const std::map<std::string, std::string> header =
+          {{kSeqKey, std::to_string(_seq)},
+           {kIntervalKey, std::to_string(_interval)}};
+
+        if (this->server || this->useServer)
+        {
+          this->SendMsg(DestinationType::ALL, msgs::Discovery::HEARTBEAT, pub,
+            header);
+          return;
+        }
+
+        this->SendMulticast(
+          EncodeHeartbeat(this->pUuid, this->Version(), _seq, _interval));
+
+        if (!this->relayAddrs.empty())
+        {
+          this->SendMsg(DestinationType::UNICAST, msgs::Discovery::HEARTBEAT,
+            pub, header);
         }
+        else if (this->verbose)
+          std::cout << "\t* Sending HEARTBEAT msg []" << std::endl;
       }
 
       /// \brief Calculate the next timeout. There are three main activities to
@@ -747,33 +1368,53 @@ namespace ignition
         auto now = std::chrono::steady_clock::now();
         auto timeUntilNextHeartbeat = this->timeNextHeartbeat - now;
         auto timeUntilNextActivity = this->timeNextActivity - now;
+        auto timeUntilNext = std::min(timeUntilNextHeartbeat,
+          timeUntilNextActivity);
+        if (this->handshaking)
+          timeUntilNext = std::min(timeUntilNext, this->timeHandshakeEnd - now);
 
         int t = static_cast<int>(
           std::chrono::duration_cast<std::chrono::milliseconds>
-            (std::min(timeUntilNextHeartbeat, timeUntilNextActivity)).count());
+            (timeUntilNext).count());
         int t2 = std::min(t, this->kTimeout);
         return std::max(t2, 0);
       }
 
-      /// \brief Receive discovery messages.
+      /// \brief Receive discovery messages. Besides the discovery socket, the
+      /// thread waits on the wake socket, so the other threads don't have to
+      /// wait for the timeout to be taken into account.
+      /// \sa Wake.
       private: void RecvMessages()
       {
+        std::vector<int> pollSet = {this->sockets.at(0)};
+        if (this->wakeSocket >= 0)
+          pollSet.push_back(this->wakeSocket);
+        std::vector<bool> readable;
+
         bool timeToExit = false;
         while (!timeToExit)
         {
           // Calculate the timeout.
           int timeout = this->NextTimeout();
 
-          if (pollSockets(this->sockets, timeout))
+          if (pollSockets(pollSet, timeout, readable))
           {
-            this->RecvDiscoveryUpdate();
+            if (readable.size() > 1 && readable[1])
+              this->DrainWake();
 
-            if (this->verbose)
-              this->PrintCurrentState();
+            if (readable[0])
+            {
+              this->RecvDiscoveryUpdate();
+
+              if (this->verbose)
+                this->PrintCurrentState();
+            }
           }
 
           this->UpdateHeartbeat();
           this->UpdateActivity();
+          this->UpdateHandshake();
+          this->UpdateCache();
 
           // Is it time to exit?
           {
@@ -798,8 +1439,8 @@ namespace ignition
               reinterpret_cast<socklen_t *>(&addrLen));
         if (received > 0)
         {
-          uint16_t len = 0;
-          memcpy(&len, &rcvStr[0], sizeof(len));
+          this->datagramsReceived.Increment();
+          this->bytesReceived.Increment(received);
 
           // Ignition Transport delimits each discovery message with a
           // frame_delimiter that contains byte size information.
@@ -821,12 +1462,24 @@ namespace ignition
           // It is possible that two incompatible versions of Ignition
           // Transport exist on the same network. If we receive an
           // unexpected size, then we ignore the message.
-
-          // If-condition for version 8+
-          if (len + sizeof(len) == received)
+          //
+          // A datagram can contain several discovery messages, one after
+          // the other.
+          std::string srcAddr = inet_ntoa(clntAddr.sin_addr);
+          uint16_t srcPort = ntohs(clntAddr.sin_port);
+
+          // The CPU time is measured per datagram, reading the clock is a
+          // system call.
+          const int64_t cpuStart = threadCpuTime();
+          size_t offset = 0;
+          uint16_t len = 0;
+          while (offset + sizeof(len) <= received)
           {
-            std::string srcAddr = inet_ntoa(clntAddr.sin_addr);
-            uint16_t srcPort = ntohs(clntAddr.sin_port);
+            memcpy(&len, &rcvStr[offset], sizeof(len));
+
+            // Version 8+ frames end within the datagram.
+            if (offset + sizeof(len) + len > received)
+              break;
 
             if (this->verbose)
             {
@@ -834,8 +1487,20 @@ namespace ignition
                 << srcAddr << ": " << srcPort << std::endl;
             }
 
-            this->DispatchDiscoveryMsg(srcAddr, rcvStr + sizeof(len), len);
+            this->msgsReceived.Increment();
+
+            char *frameBody = rcvStr + offset + sizeof(len);
+            if (this->server)
+              this->DispatchServerMsg(clntAddr, frameBody, len);
+            else if (len > 0 && frameBody[0] == kBinaryFrameMarker)
+              this->DispatchHeartbeat(srcAddr, frameBody, len);
+            else
+              this->DispatchDiscoveryMsg(srcAddr, frameBody, len);
+
+            offset += sizeof(len) + len;
           }
+          this->dispatchCpuTime.Increment(
+            static_cast<uint64_t>(threadCpuTime() - cpuStart));
         }
         else if (received < 0)
         {
@@ -844,6 +1509,151 @@ namespace ignition
         }
       }
 
+      /// \brief Handle a heartbeat received with the compact binary layout,
+      /// without decoding a discovery message.
+      /// \param[in] _fromIp IP address of the message sender.
+      /// \param[in] _msg Received frame body.
+      /// \param[in] _len Length of the frame body in octets.
+      private: void DispatchHeartbeat(const std::string &/*_fromIp*/,
+                                      const char *_msg, uint16_t _len)
+      {
+        std::string recvPUuid;
+        uint32_t version;
+        uint64_t seqNum;
+        uint32_t interval;
+        if (!DecodeHeartbeat(_msg, _len, recvPUuid, version, seqNum, interval))
+          return;
+
+        // Discard the heartbeat if the wire protocol is different than mine.
+        if (this->Version() != version)
+          return;
+
+        // Discard our own heartbeats.
+        if (recvPUuid == this->pUuid)
+          return;
+
+        bool outOfSync;
+        bool isNew;
+        {
+          std::lock_guard<std::mutex> lock(this->activityMutex);
+          isNew = this->UpdateProcActivity(recvPUuid, false, interval);
+          outOfSync = this->HeartbeatOutOfSync(recvPUuid, seqNum);
+        }
+
+        // A new process needs our heartbeat to get in sync with us.
+        if (isNew)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->RemoteChanged(true, false, false);
+        }
+
+        std::map<std::string, std::string> header =
+          {{kSeqKey, std::to_string(seqNum)},
+           {kIntervalKey, std::to_string(interval)}};
+
+        // Forward the heartbeat to our relays, as any other message received
+        // via multicast.
+        if (!this->relayAddrs.empty())
+        {
+          Publisher pub("", "", recvPUuid, "", AdvertiseOptions());
+          msgs::Discovery msg;
+          this->FillDiscoveryMsg(msgs::Discovery::HEARTBEAT, pub, recvPUuid,
+            msg);
+          for (const auto &entry : header)
+            SetHeaderValue(entry.first, entry.second, msg);
+          msg.mutable_flags()->set_relay(true);
+          this->SendUnicast(msg, this->relayAddrs);
+        }
+
+        if (outOfSync)
+        {
+          Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
+          this->SendMsg(DestinationType::ALL, msgs::Discovery::SUBSCRIBE, pub,
+            {{kSnapshotOfKey, recvPUuid}});
+        }
+      }
+
+      /// \brief Build a heartbeat frame with the compact binary layout:
+      /// <frame_delimiter><marker><layout><version><seq><interval><uuid>
+      /// where the marker is a zero byte, which never starts a serialized
+      /// discovery message, the layout is kHeartbeatLayout, the version,
+      /// sequence number and interval are 32, 64 and 32 bits big-endian
+      /// integers, and the process UUID follows its one byte length.
+      /// \param[in] _pUuid Process UUID.
+      /// \param[in] _version Wire protocol version.
+      /// \param[in] _seq Sequence number of the discovery state.
+      /// \param[in] _interval Heartbeat interval (ms.).
+      /// \return The frame, ready to be sent in a datagram.
+      private: static std::string EncodeHeartbeat(const std::string &_pUuid,
+                                                  const uint32_t _version,
+                                                  const uint64_t _seq,
+                                                  const uint32_t _interval)
+      {
+        const uint8_t uuidLen = static_cast<uint8_t>(
+          std::min<std::size_t>(_pUuid.size(), 255u));
+        const uint16_t bodyLen =
+          static_cast<uint16_t>(kHeartbeatFixedSize + uuidLen);
+
+        std::string frame(sizeof(bodyLen) + bodyLen, '\0');
+        memcpy(&frame[0], &bodyLen, sizeof(bodyLen));
+
+        std::size_t pos = sizeof(bodyLen);
+        frame[pos++] = kBinaryFrameMarker;
+        frame[pos++] = static_cast<char>(kHeartbeatLayout);
+        for (int i = 3; i >= 0; --i)
+          frame[pos++] = static_cast<char>((_version >> (8 * i)) & 0xFF);
+        for (int i = 7; i >= 0; --i)
+          frame[pos++] = static_cast<char>((_seq >> (8 * i)) & 0xFF);
+        for (int i = 3; i >= 0; --i)
+          frame[pos++] = static_cast<char>((_interval >> (8 * i)) & 0xFF);
+        frame[pos++] = static_cast<char>(uuidLen);
+        memcpy(&frame[pos], _pUuid.data(), uuidLen);
+
+        return frame;
+      }
+
+      /// \brief Decode the body of a heartbeat frame built by
+      /// EncodeHeartbeat().
+      /// \param[in] _body Frame body.
+      /// \param[in] _len Length of the frame body in octets.
+      /// \param[out] _pUuid Process UUID.
+      /// \param[out] _version Wire protocol version.
+      /// \param[out] _seq Sequence number of the discovery state.
+      /// \param[out] _interval Heartbeat interval (ms.).
+      /// \return False if the frame isn't a valid heartbeat.
+      private: static bool DecodeHeartbeat(const char *_body,
+                                           const uint16_t _len,
+                                           std::string &_pUuid,
+                                           uint32_t &_version,
+                                           uint64_t &_seq,
+                                           uint32_t &_interval)
+      {
+        if (_len < kHeartbeatFixedSize ||
+            _body[0] != kBinaryFrameMarker ||
+            static_cast<uint8_t>(_body[1]) != kHeartbeatLayout)
+        {
+          return false;
+        }
+
+        const uint8_t *data = reinterpret_cast<const uint8_t *>(_body) + 2;
+        _version = 0;
+        for (int i = 0; i < 4; ++i)
+          _version = (_version << 8) | *data++;
+        _seq = 0;
+        for (int i = 0; i < 8; ++i)
+          _seq = (_seq << 8) | *data++;
+        _interval = 0;
+        for (int i = 0; i < 4; ++i)
+          _interval = (_interval << 8) | *data++;
+
+        const uint8_t uuidLen = *data++;
+        if (_len != kHeartbeatFixedSize + uuidLen)
+          return false;
+
+        _pUuid.assign(reinterpret_cast<const char *>(data), uuidLen);
+        return true;
+      }
+
       /// \brief Parse a discovery message received via the UDP socket
       /// \param[in] _fromIp IP address of the message sender.
       /// \param[in] _msg Received message.
@@ -898,25 +1708,56 @@ namespace ignition
         else if (!msg.has_flags() || !msg.flags().no_relay())
         {
           msg.mutable_flags()->set_relay(true);
-          this->SendUnicast(msg);
+          this->SendUnicast(msg, this->relayAddrs);
         }
 
-        bool isSenderLocal = (std::find(this->hostInterfaces.begin(),
+        // The discovery server has already checked the scope of the topics.
+        bool isSenderLocal = this->useServer ||
+          (std::find(this->hostInterfaces.begin(),
           this->hostInterfaces.end(), _fromIp) != this->hostInterfaces.end()) ||
           (_fromIp.find("127.") == 0);
 
-        // Update timestamp and cache the callbacks.
-        DiscoveryCallback<Pub> connectCb;
-        DiscoveryCallback<Pub> disconnectCb;
-        DiscoveryCallback<Pub> registerCb;
-        DiscoveryCallback<Pub> unregisterCb;
+        // The callbacks run without any lock held.
+        const CallbackPtr connectCb = LoadCallback(this->connectionCb);
+        const CallbackPtr disconnectCb = LoadCallback(this->disconnectionCb);
+        const CallbackPtr registerCb = LoadCallback(registrationCb);
+        const CallbackPtr unregisterCb = LoadCallback(unregistrationCb);
+
+        // Update the state of the sender, without blocking the threads that
+        // only use the local state or the discovery information.
+        std::vector<Pub> stale;
+        bool outOfSync = false;
+        bool isNew;
+        bool isAnswer;
+        {
+          std::lock_guard<std::mutex> lock(this->activityMutex);
+          isNew = this->UpdateRemoteActivity(msg, isAnswer);
+          this->timeServerActivity = this->activity[recvPUuid];
+
+          // The discovery server keeps the clients in sync.
+          if (!this->useServer)
+            outOfSync = this->UpdateRemoteSeq(msg, stale);
+        }
+
+        const bool bye = msg.type() == msgs::Discovery::BYE;
+        if (isNew || bye || isAnswer)
         {
           std::lock_guard<std::mutex> lock(this->mutex);
-          this->activity[recvPUuid] = std::chrono::steady_clock::now();
-          connectCb = this->connectionCb;
-          disconnectCb = this->disconnectionCb;
-          registerCb = this->registrationCb;
-          unregisterCb = this->unregistrationCb;
+          this->RemoteChanged(isNew, bye, isAnswer);
+        }
+
+        // Publishers removed because they aren't part of the sender's state.
+        if (disconnectCb)
+        {
+          for (const auto &publisher : stale)
+            (*disconnectCb)(publisher);
+        }
+
+        if (outOfSync)
+        {
+          Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
+          this->SendMsg(DestinationType::ALL, msgs::Discovery::SUBSCRIBE, pub,
+            {{kSnapshotOfKey, recvPUuid}});
         }
 
         switch (msg.type())
@@ -926,6 +1767,7 @@ namespace ignition
             // Read the rest of the fields.
             Pub publisher;
             publisher.SetFromDiscovery(msg);
+            this->UpdateCapabilities(msg);
 
             // Check scope of the topic.
             if ((publisher.Options().Scope() == Scope_t::PROCESS) ||
@@ -935,23 +1777,41 @@ namespace ignition
               return;
             }
 
+            if (this->partitionFilter)
+            {
+              std::lock_guard<std::mutex> lock(this->mutex);
+              if (this->partitions.count(PartitionOf(publisher.Topic())) == 0)
+                return;
+            }
+
             // Register an advertised address for the topic.
             bool added;
             {
-              std::lock_guard<std::mutex> lock(this->mutex);
+              std::lock_guard<std::shared_mutex> lock(this->infoMutex);
               added = this->info.AddPublisher(publisher);
             }
 
             if (added && connectCb)
             {
               // Execute the client's callback.
-              connectCb(publisher);
+              (*connectCb)(publisher);
             }
 
             break;
           }
           case msgs::Discovery::SUBSCRIBE:
           {
+            // A remote process requests a snapshot of our discovery state.
+            std::string snapshotOf;
+            if (HeaderValue(msg, kSnapshotOfKey, snapshotOf))
+            {
+              if (snapshotOf == this->pUuid)
+                this->SendSnapshot(false);
+              else if (snapshotOf == kAnyProcess)
+                this->SendSnapshot(true);
+              break;
+            }
+
             std::string recvTopic;
             // Read the topic information.
             if (msg.has_sub())
@@ -967,8 +1827,10 @@ namespace ignition
 
             // Check if at least one of my nodes advertises the topic requested.
             Addresses_M<Pub> addresses;
+            uint64_t seqNum;
             {
               std::lock_guard<std::mutex> lock(this->mutex);
+              std::shared_lock<std::shared_mutex> infoLock(this->infoMutex);
               if (!this->info.HasAnyPublishers(recvTopic, this->pUuid))
               {
                 break;
@@ -976,8 +1838,12 @@ namespace ignition
 
               if (!this->info.Publishers(recvTopic, addresses))
                 break;
+
+              seqNum = this->seq;
             }
 
+            // Answer with ADVERTISE messages.
+            std::vector<msgs::Discovery> answers;
             for (const auto &nodeInfo : addresses[this->pUuid])
             {
               // Check scope of the topic.
@@ -988,11 +1854,16 @@ namespace ignition
                 continue;
               }
 
-              // Answer an ADVERTISE message.
-              this->SendMsg(DestinationType::ALL,
-                  msgs::Discovery::ADVERTISE, nodeInfo);
+              answers.emplace_back();
+              this->FillDiscoveryMsg(msgs::Discovery::ADVERTISE, nodeInfo,
+                this->pUuid, answers.back());
+              SetHeaderValue(kSnapshotKey, std::to_string(seqNum),
+                answers.back());
             }
 
+            if (!answers.empty())
+              this->SendMsgs(DestinationType::ALL, answers);
+
             break;
           }
           case msgs::Discovery::NEW_CONNECTION:
@@ -1002,7 +1873,7 @@ namespace ignition
             publisher.SetFromDiscovery(msg);
 
             if (registerCb)
-              registerCb(publisher);
+              (*registerCb)(publisher);
 
             break;
           }
@@ -1013,7 +1884,7 @@ namespace ignition
             publisher.SetFromDiscovery(msg);
 
             if (unregisterCb)
-              unregisterCb(publisher);
+              (*unregisterCb)(publisher);
 
             break;
           }
@@ -1026,7 +1897,7 @@ namespace ignition
           {
             // Remove the activity entry for this publisher.
             {
-              std::lock_guard<std::mutex> lock(this->mutex);
+              std::lock_guard<std::mutex> lock(this->activityMutex);
               this->activity.erase(recvPUuid);
             }
 
@@ -1035,14 +1906,15 @@ namespace ignition
               Pub pub;
               pub.SetPUuid(recvPUuid);
               // Notify the new disconnection.
-              disconnectCb(pub);
+              (*disconnectCb)(pub);
             }
 
             // Remove the address entry for this topic.
             {
-              std::lock_guard<std::mutex> lock(this->mutex);
+              std::lock_guard<std::shared_mutex> lock(this->infoMutex);
               this->info.DelPublishersByProc(recvPUuid);
             }
+            this->RemoveCapabilities(recvPUuid);
 
             break;
           }
@@ -1063,12 +1935,12 @@ namespace ignition
             if (disconnectCb)
             {
               // Notify the new disconnection.
-              disconnectCb(publisher);
+              (*disconnectCb)(publisher);
             }
 
             // Remove the address entry for this topic.
             {
-              std::lock_guard<std::mutex> lock(this->mutex);
+              std::lock_guard<std::shared_mutex> lock(this->infoMutex);
               this->info.DelPublisherByNode(publisher.Topic(),
                 publisher.PUuid(), publisher.NUuid());
             }
@@ -1083,201 +1955,1088 @@ namespace ignition
         }
       }
 
-      /// \brief Broadcast a discovery message.
-      /// \param[in] _type Message type.
-      /// \param[in] _pub Publishers's information to send.
-      /// \param[in] _flags Optional flags. Currently, the flags are not used
-      /// but they will in the future for specifying things like compression,
-      /// or encryption.
-      private: template<typename T>
-      void SendMsg(const DestinationType &_destType,
-                   const msgs::Discovery::Type _type,
-                   const T &_pub) const
+      /// \brief Parse a discovery message received by the discovery server.
+      /// The server keeps the discovery information of all its clients and
+      /// only forwards the changes to the clients that need them.
+      /// \param[in] _from Socket address of the message sender.
+      /// \param[in] _msg Received message.
+      /// \param[in] _len Entire length of the package in octets.
+      private: void DispatchServerMsg(const sockaddr_in &_from,
+                                      char *_msg, uint16_t _len)
       {
-        ignition::msgs::Discovery discoveryMsg;
-        discoveryMsg.set_version(this->Version());
-        discoveryMsg.set_type(_type);
-        discoveryMsg.set_process_uuid(this->pUuid);
+        ignition::msgs::Discovery msg;
+
+        if (!msg.ParseFromArray(_msg, _len))
+          return;
+
+        if (this->Version() != msg.version())
+          return;
+
+        std::string recvPUuid = msg.process_uuid();
+        if (recvPUuid == this->pUuid)
+          return;
+
+        // Messages to send back to the sender.
+        std::vector<msgs::Discovery> replies;
+
+        // Clients that receive the incoming message.
+        std::vector<sockaddr_in> dsts;
+
+        // Messages to send to other clients.
+        std::vector<std::pair<msgs::Discovery, std::vector<sockaddr_in>>>
+          forwards;
 
-        switch (_type)
         {
-          case msgs::Discovery::ADVERTISE:
-          case msgs::Discovery::UNADVERTISE:
-          case msgs::Discovery::NEW_CONNECTION:
-          case msgs::Discovery::END_CONNECTION:
+          std::lock_guard<std::mutex> lock(this->mutex);
+          std::lock_guard<std::mutex> activityLock(this->activityMutex);
+          bool isAnswer;
+          const bool isNew = this->UpdateRemoteActivity(msg, isAnswer);
+          this->RemoteChanged(isNew, msg.type() == msgs::Discovery::BYE,
+            isAnswer);
+          bool isNewClient = this->clients.find(recvPUuid) ==
+            this->clients.end();
+          this->clients[recvPUuid] = _from;
+
+          // Keep in sync with the discovery state of the client.
+          std::vector<Pub> stale;
+          if (this->UpdateRemoteSeq(msg, stale))
           {
-            _pub.FillDiscovery(discoveryMsg);
-            break;
+            replies.emplace_back();
+            Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
+            this->FillDiscoveryMsg(msgs::Discovery::SUBSCRIBE, pub,
+              this->pUuid, replies.back());
+            SetHeaderValue(kSnapshotOfKey, recvPUuid, replies.back());
           }
-          case msgs::Discovery::SUBSCRIBE:
+
+          for (const auto &publisher : stale)
           {
-            discoveryMsg.mutable_sub()->set_topic(_pub.Topic());
-            break;
+            forwards.emplace_back();
+            this->FillDiscoveryMsg(msgs::Discovery::UNADVERTISE, publisher,
+              recvPUuid, forwards.back().first);
+            forwards.back().second = this->ClientAddrs(recvPUuid,
+              publisher.Options().Scope() == Scope_t::HOST);
           }
-          case msgs::Discovery::HEARTBEAT:
-          case msgs::Discovery::BYE:
-            break;
-          default:
-            std::cerr << "Discovery::SendMsg() error: Unrecognized message"
-                      << " type [" << _type << "]" << std::endl;
-            return;
-        }
 
-        if (_destType == DestinationType::MULTICAST ||
-            _destType == DestinationType::ALL)
-        {
-          this->SendMulticast(discoveryMsg);
-        }
+          std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
 
-        // Send the discovery message to the unicast relays.
-        if (_destType == DestinationType::UNICAST ||
-            _destType == DestinationType::ALL)
-        {
-          // Set the RELAY flag in the header.
-          discoveryMsg.mutable_flags()->set_relay(true);
-          this->SendUnicast(discoveryMsg);
-        }
+          // A new client receives the current state of the network once.
+          if (isNewClient && msg.type() != msgs::Discovery::BYE)
+          {
+            std::vector<std::string> topics;
+            this->info.TopicList(topics);
+            for (const auto &topic : topics)
+              this->AppendAdvertise(topic, recvPUuid, replies);
+          }
 
-        if (this->verbose)
-        {
-          std::cout << "\t* Sending " << msgs::ToString(_type)
-                    << " msg [" << _pub.Topic() << "]" << std::endl;
+          switch (msg.type())
+          {
+            case msgs::Discovery::ADVERTISE:
+            {
+              Pub publisher;
+              publisher.SetFromDiscovery(msg);
+              this->UpdateCapabilities(msg);
+              if (publisher.Options().Scope() != Scope_t::PROCESS &&
+                  this->info.AddPublisher(publisher))
+              {
+                dsts = this->ClientAddrs(recvPUuid,
+                  publisher.Options().Scope() == Scope_t::HOST);
+              }
+              break;
+            }
+            case msgs::Discovery::UNADVERTISE:
+            {
+              Pub publisher;
+              publisher.SetFromDiscovery(msg);
+              if (this->info.DelPublisherByNode(publisher.Topic(),
+                    publisher.PUuid(), publisher.NUuid()))
+              {
+                dsts = this->ClientAddrs(recvPUuid,
+                  publisher.Options().Scope() == Scope_t::HOST);
+              }
+              break;
+            }
+            case msgs::Discovery::SUBSCRIBE:
+            {
+              // Answer with the publishers that we already know.
+              if (msg.has_sub() && !isNewClient)
+                this->AppendAdvertise(msg.sub().topic(), recvPUuid, replies);
+              break;
+            }
+            case msgs::Discovery::NEW_CONNECTION:
+            case msgs::Discovery::END_CONNECTION:
+            {
+              // Only the processes advertising the topic are interested.
+              Pub publisher;
+              publisher.SetFromDiscovery(msg);
+              Addresses_M<Pub> addresses;
+              this->info.Publishers(publisher.Topic(), addresses);
+              for (const auto &proc : addresses)
+              {
+                auto client = this->clients.find(proc.first);
+                if (proc.first != recvPUuid && client != this->clients.end())
+                  dsts.push_back(client->second);
+              }
+              break;
+            }
+            case msgs::Discovery::HEARTBEAT:
+            {
+              // The timestamp has already been updated.
+              break;
+            }
+            case msgs::Discovery::BYE:
+            {
+              this->info.DelPublishersByProc(recvPUuid);
+              this->RemoveCapabilities(recvPUuid);
+              this->activity.erase(recvPUuid);
+              this->clients.erase(recvPUuid);
+              dsts = this->ClientAddrs(recvPUuid);
+              break;
+            }
+            default:
+            {
+              std::cerr << "Unknown message type [" << msg.type() << "].\n";
+              break;
+            }
+          }
         }
+
+        if (!replies.empty())
+          this->SendUnicast(replies, {_from});
+
+        for (const auto &forward : forwards)
+          this->SendUnicast(forward.first, forward.second);
+
+        if (!dsts.empty())
+          this->SendUnicast(msg, dsts);
       }
 
-      /// \brief Send a discovery message through all unicast relays.
-      /// \param[in] _msg Discovery message.
-      private: void SendUnicast(const msgs::Discovery &_msg) const
+      /// \brief Append an ADVERTISE message for each publisher of a topic
+      /// that a client of the discovery server can use. You should call this
+      /// method with the mutex and the info mutex locked.
+      /// \param[in] _topic Topic name.
+      /// \param[in] _pUuid UUID of the client process.
+      /// \param[out] _msgs Messages to send to the client.
+      private: void AppendAdvertise(const std::string &_topic,
+                                    const std::string &_pUuid,
+                                    std::vector<msgs::Discovery> &_msgs) const
       {
-        uint16_t msgSize;
-
-#if GOOGLE_PROTOBUF_VERSION >= 3004000
-        size_t msgSizeFull = _msg.ByteSizeLong();
-#else
-        int msgSizeFull = _msg.ByteSize();
-#endif
-        if (msgSizeFull + sizeof(msgSize) > this->kMaxRcvStr)
-        {
-          std::cerr << "Discovery message too large to send. Discovery won't "
-            << "work. This shouldn't happen.\n";
+        Addresses_M<Pub> addresses;
+        if (!this->info.Publishers(_topic, addresses))
           return;
-        }
-        msgSize = msgSizeFull;
 
-        uint16_t totalSize = sizeof(msgSize) + msgSize;
-        char *buffer = static_cast<char *>(new char[totalSize]);
-        memcpy(&buffer[0], &msgSize, sizeof(msgSize));
-
-        if (_msg.SerializeToArray(buffer + sizeof(msgSize), msgSize))
+        auto client = this->clients.find(_pUuid);
+        for (const auto &proc : addresses)
         {
-          // Send the discovery message to the unicast relays.
-          for (const auto &sockAddr : this->relayAddrs)
+          auto owner = this->clients.find(proc.first);
+          if (proc.first == _pUuid || owner == this->clients.end())
+            continue;
+
+          for (const auto &publisher : proc.second)
           {
-            errno = 0;
-            auto sent = sendto(this->sockets.at(0),
-              reinterpret_cast<const raw_type *>(
-                reinterpret_cast<const unsigned char*>(buffer)),
-              totalSize, 0,
-              reinterpret_cast<const sockaddr *>(&sockAddr),
-              sizeof(sockAddr));
+            // Topics with host scope are only shared within the same host.
+            if (publisher.Options().Scope() == Scope_t::HOST &&
+                owner->second.sin_addr.s_addr !=
+                  client->second.sin_addr.s_addr)
+            {
+              continue;
+            }
 
-            if (sent != totalSize)
+            _msgs.emplace_back();
+            if (!this->FillDiscoveryMsg(msgs::Discovery::ADVERTISE,
+                  publisher, proc.first, _msgs.back()))
             {
-              std::cerr << "Exception sending a unicast message:" << std::endl;
-              std::cerr << "  Return value: " << sent << std::endl;
-              std::cerr << "  Error code: " << strerror(errno) << std::endl;
-              break;
+              _msgs.pop_back();
             }
           }
         }
-        else
-        {
-          std::cerr << "Discovery::SendUnicast: Error serializing data."
-            << std::endl;
-        }
-
-        delete [] buffer;
       }
 
-      /// \brief Send a discovery message through the multicast group.
-      /// \param[in] _msg Discovery message.
-      private: void SendMulticast(const msgs::Discovery &_msg) const
+      /// \brief Get the socket addresses of the clients of the discovery
+      /// server. You should call this method with the mutex locked.
+      /// \param[in] _pUuid UUID of a client process that is excluded.
+      /// \param[in] _sameHost When true, only the clients running on the same
+      /// host as _pUuid are included.
+      /// \return The socket addresses.
+      private: std::vector<sockaddr_in> ClientAddrs(const std::string &_pUuid,
+                                                    bool _sameHost = false) const
       {
-        uint16_t msgSize;
-
-#if GOOGLE_PROTOBUF_VERSION >= 3004000
-        size_t msgSizeFull = _msg.ByteSizeLong();
-#else
-        int msgSizeFull = _msg.ByteSize();
-#endif
-        if (msgSizeFull + sizeof(msgSize) > this->kMaxRcvStr)
+        std::vector<sockaddr_in> addrs;
+        auto origin = this->clients.find(_pUuid);
+        for (const auto &client : this->clients)
         {
-          std::cerr << "Discovery message too large to send. Discovery won't "
-            << "work. This shouldn't happen.\n";
-          return;
+          if (client.first == _pUuid)
+            continue;
+
+          if (_sameHost && origin != this->clients.end() &&
+              origin->second.sin_addr.s_addr != client.second.sin_addr.s_addr)
+          {
+            continue;
+          }
+
+          addrs.push_back(client.second);
         }
+        return addrs;
+      }
 
-        msgSize = msgSizeFull;
-        uint16_t totalSize = sizeof(msgSize) + msgSize;
-        char *buffer = static_cast<char *>(new char[totalSize]);
-        memcpy(&buffer[0], &msgSize, sizeof(msgSize));
+      /// \brief Update the activity of the remote process that sent a
+      /// discovery message. You should call this method with the activity
+      /// mutex locked, and then RemoteChanged().
+      /// \param[in] _msg Discovery message received.
+      /// \param[out] _isAnswer True if the message answers our request for
+      /// the discovery state of the peers.
+      /// \return True if the process is new.
+      private: bool UpdateRemoteActivity(const msgs::Discovery &_msg,
+                                         bool &_isAnswer)
+      {
+        std::string value;
+        _isAnswer = this->useServer || HeaderValue(_msg, kSnapshotKey, value);
 
-        if (_msg.SerializeToArray(buffer + sizeof(msgSize), msgSize))
+        unsigned int interval = 0;
+        if (_msg.type() == msgs::Discovery::HEARTBEAT &&
+            HeaderValue(_msg, kIntervalKey, value))
         {
-          // Send the discovery message to the multicast group through all the
-          // sockets.
-          for (const auto &sock : this->Sockets())
+          try
+          {
+            interval = static_cast<unsigned int>(std::stoul(value));
+          }
+          catch (...)
           {
-            errno = 0;
-            if (sendto(sock, reinterpret_cast<const raw_type *>(
-              reinterpret_cast<const unsigned char*>(buffer)),
-              totalSize, 0,
-              reinterpret_cast<const sockaddr *>(this->MulticastAddr()),
-              sizeof(*(this->MulticastAddr()))) != totalSize)
-            {
-              // Ignore EPERM and ENOBUFS errors.
-              //
-              // See issue #106
-              //
-              // Rationale drawn from:
-              //
-              // * https://groups.google.com/forum/#!topic/comp.protocols.tcp-ip/Qou9Sfgr77E
-              // * https://stackoverflow.com/questions/16555101/sendto-dgrams-do-not-block-for-enobufs-on-osx
-              if (errno != EPERM && errno != ENOBUFS)
-              {
-                std::cerr << "Exception sending a multicast message:"
-                  << strerror(errno) << std::endl;
-              }
-              break;
-            }
           }
-        }
-        else
-        {
-          std::cerr << "Discovery::SendMulticast: Error serializing data."
-            << std::endl;
         }
 
-        delete [] buffer;
+        return this->UpdateProcActivity(_msg.process_uuid(),
+          _msg.type() == msgs::Discovery::BYE, interval);
       }
 
-      /// \brief Get the list of sockets used for discovery.
-      /// \return The list of sockets.
-      private: const std::vector<int> &Sockets() const
+      /// \brief Update the activity of a remote process. You should call this
+      /// method with the activity mutex locked, and then RemoteChanged().
+      /// \param[in] _procUuid UUID of the remote process.
+      /// \param[in] _bye True if the process is leaving.
+      /// \param[in] _interval Heartbeat interval announced by the process, or
+      /// zero if none.
+      /// \return True if the process is new.
+      private: bool UpdateProcActivity(const std::string &_procUuid,
+                                       const bool _bye,
+                                       const unsigned int _interval)
       {
-        return this->sockets;
+        bool isNew = false;
+        if (_bye)
+          this->remoteHeartbeats.erase(_procUuid);
+        else
+          isNew = this->activity.find(_procUuid) == this->activity.end();
+
+        this->activity[_procUuid] = std::chrono::steady_clock::now();
+
+        if (_interval > 0)
+          this->remoteHeartbeats[_procUuid] = _interval;
+        return isNew;
       }
 
-      /// \brief Get the data structure used for multicast communication.
-      /// \return The data structure containing the multicast information.
-      private: const sockaddr_in *MulticastAddr() const
+      /// \brief Update our state after the message of a remote process.
+      /// You should call this method with the mutex locked. It only has
+      /// something to do if one of the parameters is true.
+      /// \param[in] _isNew True if the process is new.
+      /// \param[in] _bye True if the process is leaving.
+      /// \param[in] _isAnswer True if the message answers our request for
+      /// the discovery state of the peers.
+      private: void RemoteChanged(const bool _isNew,
+                                  const bool _bye,
+                                  const bool _isAnswer)
       {
-        return &this->mcastAddr;
+        if (_bye)
+          this->MarkChanged(false);
+        else if (_isNew)
+        {
+          // A new process needs our heartbeat to get in sync with us.
+          this->MarkChanged(true);
+        }
+
+        // Keep waiting while the peers answer our request for their state.
+        if (this->handshaking && _isAnswer)
+        {
+          this->timeHandshakeEnd = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(kHandshakeQuietInterval);
+        }
       }
 
-      /// \brief Get the discovery protocol version.
-      /// \return The discovery version.
-      private: uint8_t Version() const
+      /// \brief Record a change of the discovery state, which resets the
+      /// adaptive heartbeat. You should call this method with the mutex
+      /// locked.
+      /// \param[in] _now True for sending the next heartbeat right away.
+      private: void MarkChanged(const bool _now)
+      {
+        this->discoveryChanged = true;
+        if (!this->adaptiveHeartbeat)
+          return;
+
+        Timestamp next = std::chrono::steady_clock::now();
+        if (!_now)
+          next += std::chrono::milliseconds(this->heartbeatInterval);
+        this->timeNextHeartbeat = std::min(this->timeNextHeartbeat, next);
+      }
+
+      /// \brief Keep track of the discovery state of a remote process. Each
+      /// process numbers the changes of its discovery state and includes the
+      /// current sequence number in its heartbeats. The changes received in
+      /// order keep us in sync, otherwise we request a snapshot of the state.
+      /// You should call this method with the activity mutex locked, and
+      /// without the info mutex.
+      /// \param[in] _msg Discovery message received.
+      /// \param[out] _stale Publishers removed from the discovery information
+      /// because they are not part of the remote state anymore.
+      /// \return True if we are out of sync and should request a snapshot.
+      private: bool UpdateRemoteSeq(const msgs::Discovery &_msg,
+                                    std::vector<Pub> &_stale)
+      {
+        const std::string &procUuid = _msg.process_uuid();
+        if (_msg.type() == msgs::Discovery::BYE)
+        {
+          this->remoteSeqs.erase(procUuid);
+          this->pubSeqs.erase(procUuid);
+          return false;
+        }
+
+        std::string value;
+        uint64_t seqNum = 0;
+        bool isSnapshot = false;
+        if (HeaderValue(_msg, kSnapshotKey, value))
+          isSnapshot = true;
+        else if (!HeaderValue(_msg, kSeqKey, value))
+          return false;
+
+        try
+        {
+          seqNum = std::stoull(value);
+        }
+        catch (...)
+        {
+          return false;
+        }
+
+        auto &pubSeq = this->pubSeqs[procUuid];
+        auto known = this->remoteSeqs.find(procUuid);
+
+        // A process that we don't know anything about starts empty.
+        if (known == this->remoteSeqs.end() && pubSeq.empty())
+          known = this->remoteSeqs.emplace(procUuid, 0).first;
+
+        switch (_msg.type())
+        {
+          case msgs::Discovery::ADVERTISE:
+          case msgs::Discovery::UNADVERTISE:
+          {
+            if (!isSnapshot && known != this->remoteSeqs.end() &&
+                seqNum == known->second + 1)
+            {
+              known->second = seqNum;
+            }
+
+            auto key = std::make_pair(_msg.pub().topic(),
+              _msg.pub().node_uuid());
+            if (_msg.type() == msgs::Discovery::ADVERTISE)
+              pubSeq[key] = seqNum;
+            else
+              pubSeq.erase(key);
+            break;
+          }
+          case msgs::Discovery::HEARTBEAT:
+          {
+            if (!isSnapshot)
+              return this->HeartbeatOutOfSync(procUuid, seqNum);
+
+            // This is the end of a snapshot. The publishers that were not
+            // part of it are gone.
+            std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
+            for (auto it = pubSeq.begin(); it != pubSeq.end();)
+            {
+              if (it->second >= seqNum)
+              {
+                ++it;
+                continue;
+              }
+
+              Pub publisher;
+              if (this->info.Publisher(it->first.first, procUuid,
+                    it->first.second, publisher))
+              {
+                this->info.DelPublisherByNode(it->first.first, procUuid,
+                  it->first.second);
+                _stale.push_back(publisher);
+              }
+              pubSeq.erase(it++);
+            }
+
+            // Make sure that we didn't miss any part of the snapshot.
+            std::string count;
+            if (HeaderValue(_msg, kCountKey, count) &&
+                count == std::to_string(pubSeq.size()))
+            {
+              this->remoteSeqs[procUuid] = seqNum;
+            }
+            break;
+          }
+          default:
+            break;
+        }
+
+        return false;
+      }
+
+      /// \brief Check the sequence number announced by the heartbeat of a
+      /// remote process. You should call this method with the activity mutex
+      /// locked.
+      /// \param[in] _procUuid UUID of the remote process.
+      /// \param[in] _seq Sequence number of its discovery state.
+      /// \return True if we are out of sync and should request a snapshot.
+      private: bool HeartbeatOutOfSync(const std::string &_procUuid,
+                                       const uint64_t _seq)
+      {
+        auto known = this->remoteSeqs.find(_procUuid);
+        if (known == this->remoteSeqs.end())
+        {
+          // A process that we don't know anything about starts empty.
+          auto pubSeq = this->pubSeqs.find(_procUuid);
+          if (pubSeq != this->pubSeqs.end() && !pubSeq->second.empty())
+            return true;
+          known = this->remoteSeqs.emplace(_procUuid, 0).first;
+        }
+
+        return known->second != _seq;
+      }
+
+      /// \brief Send a snapshot of our discovery state: all the publishers
+      /// advertised by this process followed by a heartbeat with the number
+      /// of publishers sent. Snapshots are sent at most twice per heartbeat
+      /// interval, the processes that miss one request it again.
+      /// \param[in] _force Send the snapshot even if one was sent recently.
+      /// Used for answering the processes that just started, which would
+      /// otherwise wait for the rate limit to expire.
+      private: void SendSnapshot(const bool _force)
+      {
+        std::map<std::string, std::vector<Pub>> nodes;
+        std::string seqNum;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+
+          Timestamp now = std::chrono::steady_clock::now();
+          if (!_force && now < this->timeNextSnapshot)
+            return;
+
+          this->timeNextSnapshot = now +
+            std::chrono::milliseconds(this->heartbeatInterval / 2);
+
+          std::shared_lock<std::shared_mutex> infoLock(this->infoMutex);
+          this->info.PublishersByProc(this->pUuid, nodes);
+          seqNum = std::to_string(this->seq);
+        }
+
+        std::vector<msgs::Discovery> snapshot;
+        for (const auto &topic : nodes)
+        {
+          for (const auto &node : topic.second)
+          {
+            if (node.Options().Scope() == Scope_t::PROCESS)
+              continue;
+
+            snapshot.emplace_back();
+            this->FillDiscoveryMsg(msgs::Discovery::ADVERTISE, node,
+              this->pUuid, snapshot.back());
+            SetHeaderValue(kSnapshotKey, seqNum, snapshot.back());
+          }
+        }
+
+        const std::string count = std::to_string(snapshot.size());
+        snapshot.emplace_back();
+        Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
+        this->FillDiscoveryMsg(msgs::Discovery::HEARTBEAT, pub, this->pUuid,
+          snapshot.back());
+        SetHeaderValue(kSnapshotKey, seqNum, snapshot.back());
+        SetHeaderValue(kCountKey, count, snapshot.back());
+
+        this->SendMsgs(DestinationType::ALL, snapshot);
+      }
+
+      /// \brief Finish the initialization once the peers have answered the
+      /// request for their discovery state sent by Start(): when no answer
+      /// has been received for kHandshakeQuietInterval milliseconds.
+      private: void UpdateHandshake()
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        if (!this->handshaking ||
+            std::chrono::steady_clock::now() < this->timeHandshakeEnd)
+        {
+          return;
+        }
+
+        this->handshaking = false;
+        if (!this->initialized)
+        {
+          this->initialized = true;
+
+          // Notify anyone waiting for the initialization phase to finish.
+          this->initializedCv.notify_all();
+        }
+      }
+
+      /// \brief Write the copy of the remote publishers if it's time to.
+      /// \sa SetCachePath.
+      private: void UpdateCache()
+      {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (this->cachePath.empty() ||
+              std::chrono::steady_clock::now() < this->timeNextCache)
+          {
+            return;
+          }
+
+          this->timeNextCache = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(kCacheInterval);
+        }
+
+        this->SaveCache();
+      }
+
+      /// \brief Write the remote publishers in the cache file, if they
+      /// changed since the last time. The file starts with kCacheMagic and
+      /// the wire version, followed by an ADVERTISE message of each
+      /// publisher preceded by its 32 bits size. The file is replaced
+      /// atomically, so a crash can't leave half of it.
+      /// \sa SetCachePath.
+      private: void SaveCache()
+      {
+        std::string path;
+        std::string contents(kCacheMagic);
+        contents.push_back(static_cast<char>(this->Version()));
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (this->cachePath.empty())
+            return;
+          path = this->cachePath;
+
+          std::shared_lock<std::shared_mutex> infoLock(this->infoMutex);
+          std::vector<std::string> topics;
+          this->info.TopicList(topics);
+          for (const auto &topic : topics)
+          {
+            Addresses_M<Pub> addresses;
+            if (!this->info.Publishers(topic, addresses))
+              continue;
+
+            for (const auto &proc : addresses)
+            {
+              if (proc.first == this->pUuid)
+                continue;
+
+              for (const auto &publisher : proc.second)
+              {
+                msgs::Discovery msg;
+                if (!this->FillDiscoveryMsg(msgs::Discovery::ADVERTISE,
+                      publisher, proc.first, msg))
+                {
+                  continue;
+                }
+
+                const std::string data = msg.SerializeAsString();
+                const uint32_t size = static_cast<uint32_t>(data.size());
+                contents.append(reinterpret_cast<const char *>(&size),
+                  sizeof(size));
+                contents.append(data);
+              }
+            }
+          }
+
+          if (contents == this->lastCache)
+            return;
+          this->lastCache = contents;
+        }
+
+        const std::string tmpPath = path + ".tmp";
+        {
+          std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+          out.write(contents.data(),
+            static_cast<std::streamsize>(contents.size()));
+          if (!out)
+          {
+            std::cerr << "Discovery::SaveCache(): Unable to write ["
+                      << tmpPath << "]" << std::endl;
+            return;
+          }
+        }
+
+        if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        {
+          // Windows doesn't replace an existing file.
+          std::remove(path.c_str());
+          if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+          {
+            std::cerr << "Discovery::SaveCache(): Unable to replace ["
+                      << path << "]" << std::endl;
+          }
+        }
+      }
+
+      /// \brief Load the remote publishers of the cache file. Their
+      /// processes are considered active, so they expire after the silence
+      /// interval unless they send heartbeats. Since we don't know their
+      /// discovery state, their first heartbeat requests a snapshot, which
+      /// removes the publishers that are gone.
+      /// \sa SetCachePath.
+      private: void LoadCache()
+      {
+        std::string path = this->CachePath();
+        if (path.empty())
+          return;
+
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+          return;
+        const std::string contents((std::istreambuf_iterator<char>(in)),
+          std::istreambuf_iterator<char>());
+
+        // Skip the files written with another wire version.
+        const std::string magic(kCacheMagic);
+        if (contents.size() < magic.size() + 1 ||
+            contents.compare(0, magic.size(), magic) != 0 ||
+            static_cast<uint8_t>(contents[magic.size()]) != this->Version())
+        {
+          return;
+        }
+
+        const CallbackPtr connectCb = LoadCallback(this->connectionCb);
+        std::vector<Pub> added;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          std::lock_guard<std::mutex> activityLock(this->activityMutex);
+          std::lock_guard<std::shared_mutex> infoLock(this->infoMutex);
+
+          Timestamp now = std::chrono::steady_clock::now();
+          std::size_t pos = magic.size() + 1;
+          uint32_t size;
+          while (pos + sizeof(size) <= contents.size())
+          {
+            memcpy(&size, contents.data() + pos, sizeof(size));
+            pos += sizeof(size);
+            if (size > contents.size() - pos)
+              break;
+
+            msgs::Discovery msg;
+            const bool parsed = msg.ParseFromArray(contents.data() + pos,
+              static_cast<int>(size));
+            pos += size;
+            if (!parsed || msg.type() != msgs::Discovery::ADVERTISE ||
+                msg.process_uuid() == this->pUuid)
+            {
+              continue;
+            }
+
+            Pub publisher;
+            publisher.SetFromDiscovery(msg);
+            if (this->partitionFilter &&
+                this->partitions.count(PartitionOf(publisher.Topic())) == 0)
+            {
+              continue;
+            }
+
+            if (!this->info.AddPublisher(publisher))
+              continue;
+            this->UpdateCapabilities(msg);
+
+            const std::string &procUuid = msg.process_uuid();
+            this->activity[procUuid] = now;
+            this->pubSeqs[procUuid][std::make_pair(publisher.Topic(),
+              publisher.NUuid())] = 0;
+            added.push_back(publisher);
+          }
+
+          this->lastCache = contents;
+        }
+
+        if (!connectCb)
+          return;
+
+        for (const auto &publisher : added)
+          (*connectCb)(publisher);
+      }
+
+      /// \brief Get the partition of a fully qualified topic name.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return The partition, as it appears in the name (e.g. "/p"), or an
+      /// empty string if there is no partition.
+      private: static std::string PartitionOf(const std::string &_topic)
+      {
+        const std::size_t lastAt = _topic.find_last_of('@');
+        if (_topic.empty() || _topic.front() != '@' || lastAt == 0 ||
+            lastAt == std::string::npos)
+        {
+          return "";
+        }
+        return _topic.substr(1, lastAt - 1);
+      }
+
+      /// \brief Record the capabilities announced in an ADVERTISE message.
+      /// \param[in] _msg Discovery message.
+      private: void UpdateCapabilities(const msgs::Discovery &_msg)
+      {
+        std::string value;
+        if (!HeaderValue(_msg, kCapsKey, value))
+          return;
+
+        uint64_t caps;
+        try
+        {
+          caps = std::stoull(value);
+        }
+        catch (...)
+        {
+          return;
+        }
+
+        std::lock_guard<std::mutex> lock(this->capsMutex);
+        this->capabilities[_msg.process_uuid()] = caps;
+      }
+
+      /// \brief Forget the capabilities of a process that left.
+      /// \param[in] _pUuid UUID of the process.
+      private: void RemoveCapabilities(const std::string &_pUuid)
+      {
+        std::lock_guard<std::mutex> lock(this->capsMutex);
+        this->capabilities.erase(_pUuid);
+      }
+
+      /// \brief Store a value in the header of a discovery message.
+      /// \param[in] _key Key of the value.
+      /// \param[in] _value Value.
+      /// \param[in, out] _msg Discovery message.
+      private: static void SetHeaderValue(const std::string &_key,
+                                          const std::string &_value,
+                                          msgs::Discovery &_msg)
+      {
+        auto *data = _msg.mutable_header()->add_data();
+        data->set_key(_key);
+        data->add_value(_value);
+      }
+
+      /// \brief Get a value from the header of a discovery message.
+      /// \param[in] _msg Discovery message.
+      /// \param[in] _key Key of the value.
+      /// \param[out] _value Value.
+      /// \return True if the header contains the value.
+      private: static bool HeaderValue(const msgs::Discovery &_msg,
+                                       const std::string &_key,
+                                       std::string &_value)
+      {
+        for (const auto &data : _msg.header().data())
+        {
+          if (data.key() == _key && data.value_size() > 0)
+          {
+            _value = data.value(0);
+            return true;
+          }
+        }
+        return false;
+      }
+
+      /// \brief Broadcast a discovery message.
+      /// \param[in] _type Message type.
+      /// \param[in] _pub Publishers's information to send.
+      /// \param[in] _header Optional values stored in the message header
+      /// (e.g.: the sequence number of the discovery state).
+      private: template<typename T>
+      void SendMsg(const DestinationType &_destType,
+                   const msgs::Discovery::Type _type,
+                   const T &_pub,
+                   const std::map<std::string, std::string> &_header = {})
+        const
+      {
+        ignition::msgs::Discovery discoveryMsg;
+        if (!this->FillDiscoveryMsg(_type, _pub, this->pUuid, discoveryMsg))
+          return;
+
+        for (const auto &value : _header)
+          SetHeaderValue(value.first, value.second, discoveryMsg);
+
+        std::vector<msgs::Discovery> discoveryMsgs = {discoveryMsg};
+        this->SendMsgs(_destType, discoveryMsgs);
+      }
+
+      /// \brief Broadcast a sequence of discovery messages. The messages are
+      /// batched in as few datagrams as possible.
+      /// \param[in] _destType Destination type.
+      /// \param[in, out] _msgs Discovery messages.
+      private: void SendMsgs(const DestinationType &_destType,
+                             std::vector<msgs::Discovery> &_msgs) const
+      {
+        if (this->server)
+        {
+          // The discovery server talks to all its clients.
+          std::vector<sockaddr_in> clientAddrs;
+          {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            clientAddrs = this->ClientAddrs("");
+          }
+          this->SendUnicast(_msgs, clientAddrs);
+        }
+        else if (this->useServer)
+        {
+          // The clients of a discovery server only talk to the server.
+          this->SendUnicast(_msgs, {this->serverAddr});
+        }
+        else
+        {
+          if (_destType == DestinationType::MULTICAST ||
+              _destType == DestinationType::ALL)
+          {
+            this->SendMulticast(_msgs);
+          }
+
+          // Send the discovery messages to the unicast relays.
+          if ((_destType == DestinationType::UNICAST ||
+               _destType == DestinationType::ALL) &&
+              !this->relayAddrs.empty())
+          {
+            // Set the RELAY flag in the header.
+            for (auto &msg : _msgs)
+              msg.mutable_flags()->set_relay(true);
+            this->SendUnicast(_msgs, this->relayAddrs);
+          }
+        }
+
+        if (this->verbose)
+        {
+          for (const auto &msg : _msgs)
+          {
+            std::cout << "\t* Sending " << msgs::ToString(msg.type())
+                      << " msg [" << (msg.has_sub() ? msg.sub().topic() :
+                         msg.pub().topic()) << "]" << std::endl;
+          }
+        }
+      }
+
+      /// \brief Fill a discovery message.
+      /// \param[in] _type Message type.
+      /// \param[in] _pub Publishers's information to send.
+      /// \param[in] _pUuid UUID of the process that the message comes from.
+      /// \param[out] _msg Discovery message.
+      /// \return True if the message was filled or false otherwise (e.g.:
+      /// unknown message type).
+      private: template<typename T>
+      bool FillDiscoveryMsg(const msgs::Discovery::Type _type,
+                            const T &_pub,
+                            const std::string &_pUuid,
+                            msgs::Discovery &_msg) const
+      {
+        _msg.set_version(this->Version());
+        _msg.set_type(_type);
+        _msg.set_process_uuid(_pUuid);
+
+        switch (_type)
+        {
+          case msgs::Discovery::ADVERTISE:
+          {
+            _pub.FillDiscovery(_msg);
+
+            // The capabilities of the process come with its publishers.
+            const uint64_t caps = this->Capabilities(_pUuid);
+            if (caps != 0)
+              SetHeaderValue(kCapsKey, std::to_string(caps), _msg);
+            break;
+          }
+          case msgs::Discovery::UNADVERTISE:
+          case msgs::Discovery::NEW_CONNECTION:
+          case msgs::Discovery::END_CONNECTION:
+          {
+            _pub.FillDiscovery(_msg);
+            break;
+          }
+          case msgs::Discovery::SUBSCRIBE:
+          {
+            _msg.mutable_sub()->set_topic(_pub.Topic());
+            break;
+          }
+          case msgs::Discovery::HEARTBEAT:
+          case msgs::Discovery::BYE:
+            break;
+          default:
+            std::cerr << "Discovery::SendMsg() error: Unrecognized message"
+                      << " type [" << _type << "]" << std::endl;
+            return false;
+        }
+
+        return true;
+      }
+
+      /// \brief Serialize discovery messages into datagrams. Each frame has
+      /// the form <frame_delimiter><frame_body> and each datagram contains as
+      /// many frames as fit in kMaxDatagramSize bytes. A larger message is
+      /// sent in its own datagram.
+      /// \param[in] _msgs Discovery messages.
+      /// \return The datagrams.
+      private: static std::vector<std::string> Pack(
+        const std::vector<msgs::Discovery> &_msgs)
+      {
+        std::vector<std::string> datagrams;
+        std::string frame;
+        for (const auto &msg : _msgs)
+        {
+          uint16_t msgSize;
+
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+          size_t msgSizeFull = msg.ByteSizeLong();
+#else
+          int msgSizeFull = msg.ByteSize();
+#endif
+          if (msgSizeFull + sizeof(msgSize) > kMaxRcvStr)
+          {
+            std::cerr << "Discovery message too large to send. Discovery won't "
+              << "work. This shouldn't happen.\n";
+            continue;
+          }
+          msgSize = static_cast<uint16_t>(msgSizeFull);
+
+          frame.resize(sizeof(msgSize) + msgSize);
+          memcpy(&frame[0], &msgSize, sizeof(msgSize));
+          if (!msg.SerializeToArray(&frame[0] + sizeof(msgSize), msgSize))
+          {
+            std::cerr << "Discovery::Pack: Error serializing data."
+              << std::endl;
+            continue;
+          }
+
+          if (datagrams.empty() ||
+              datagrams.back().size() + frame.size() > kMaxDatagramSize)
+          {
+            datagrams.push_back(frame);
+          }
+          else
+            datagrams.back() += frame;
+        }
+
+        return datagrams;
+      }
+
+      /// \brief Send a discovery message through unicast.
+      /// \param[in] _msg Discovery message.
+      /// \param[in] _addrs Socket addresses of the destinations (e.g.: the
+      /// unicast relays).
+      private: void SendUnicast(const msgs::Discovery &_msg,
+                                const std::vector<sockaddr_in> &_addrs) const
+      {
+        this->SendUnicast(std::vector<msgs::Discovery>{_msg}, _addrs);
+      }
+
+      /// \brief Send a sequence of discovery messages through unicast.
+      /// \param[in] _msgs Discovery messages.
+      /// \param[in] _addrs Socket addresses of the destinations (e.g.: the
+      /// unicast relays).
+      private: void SendUnicast(const std::vector<msgs::Discovery> &_msgs,
+                                const std::vector<sockaddr_in> &_addrs) const
+      {
+        if (_addrs.empty())
+          return;
+
+        for (const auto &datagram : Pack(_msgs))
+        {
+          uint16_t totalSize = static_cast<uint16_t>(datagram.size());
+
+          // Send the datagram to all the destinations.
+          for (const auto &sockAddr : _addrs)
+          {
+            errno = 0;
+            auto sent = sendto(this->sockets.at(0),
+              reinterpret_cast<const raw_type *>(
+                reinterpret_cast<const unsigned char*>(datagram.data())),
+              totalSize, 0,
+              reinterpret_cast<const sockaddr *>(&sockAddr),
+              sizeof(sockAddr));
+
+            if (sent != totalSize)
+            {
+              std::cerr << "Exception sending a unicast message:" << std::endl;
+              std::cerr << "  Return value: " << sent << std::endl;
+              std::cerr << "  Error code: " << strerror(errno) << std::endl;
+              break;
+            }
+            this->unicastDatagramsSent.Increment();
+          }
+        }
+      }
+
+      /// \brief Send a discovery message through the multicast group.
+      /// \param[in] _msg Discovery message.
+      private: void SendMulticast(const msgs::Discovery &_msg) const
+      {
+        this->SendMulticast(std::vector<msgs::Discovery>{_msg});
+      }
+
+      /// \brief Send a sequence of discovery messages through the multicast
+      /// group.
+      /// \param[in] _msgs Discovery messages.
+      private: void SendMulticast(const std::vector<msgs::Discovery> &_msgs)
+        const
+      {
+        for (const auto &datagram : Pack(_msgs))
+          this->SendMulticast(datagram);
+      }
+
+      /// \brief Send a datagram to the multicast group.
+      /// \param[in] _datagram One or more framed discovery messages.
+      private: void SendMulticast(const std::string &_datagram) const
+      {
+        uint16_t totalSize = static_cast<uint16_t>(_datagram.size());
+
+        // Send the datagram to the multicast group through all the
+        // sockets of the selected interfaces.
+        std::lock_guard<std::mutex> lock(this->socketsMutex);
+        for (std::size_t i = 0; i < this->sockets.size(); ++i)
+        {
+          if (!this->activeSockets[i])
+            continue;
+
+          errno = 0;
+          if (sendto(this->sockets[i], reinterpret_cast<const raw_type *>(
+            reinterpret_cast<const unsigned char*>(_datagram.data())),
+            totalSize, 0,
+            reinterpret_cast<const sockaddr *>(this->MulticastAddr()),
+            sizeof(*(this->MulticastAddr()))) != totalSize)
+          {
+            // Ignore EPERM and ENOBUFS errors.
+            //
+            // See issue #106
+            //
+            // Rationale drawn from:
+            //
+            // * https://groups.google.com/forum/#!topic/comp.protocols.tcp-ip/Qou9Sfgr77E
+            // * https://stackoverflow.com/questions/16555101/sendto-dgrams-do-not-block-for-enobufs-on-osx
+            if (errno != EPERM && errno != ENOBUFS)
+            {
+              std::cerr << "Exception sending a multicast message:"
+                << strerror(errno) << std::endl;
+            }
+            break;
+          }
+          this->multicastDatagramsSent.Increment();
+        }
+      }
+
+      /// \brief Get the list of sockets used for discovery.
+      /// \return The list of sockets.
+      private: const std::vector<int> &Sockets() const
+      {
+        return this->sockets;
+      }
+
+      /// \brief Get the data structure used for multicast communication.
+      /// \return The data structure containing the multicast information.
+      private: const sockaddr_in *MulticastAddr() const
+      {
+        return &this->mcastAddr;
+      }
+
+      /// \brief Get the discovery protocol version.
+      /// \return The discovery version.
+      private: uint8_t Version() const
       {
         static std::string ignStats;
         static int topicStats =
@@ -1313,6 +3072,8 @@ namespace ignition
         }
 
         this->sockets.push_back(sock);
+        this->socketIfaces.push_back(_ip);
+        this->activeSockets.push_back(true);
 
         // Join the multicast group. We have to do it for each network interface
         // but we can do it on the same socket. We will use the socket at
@@ -1332,6 +3093,67 @@ namespace ignition
         return true;
       }
 
+      /// \brief Create the socket used for waking up the reception thread:
+      /// an UDP socket bound to an ephemeral port of the loopback interface,
+      /// to which Wake() sends an empty datagram. If it can't be created,
+      /// the reception thread only wakes up on the discovery traffic and its
+      /// timeouts.
+      private: void CreateWakeSocket()
+      {
+        int sock = static_cast<int>(socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP));
+        if (sock < 0)
+        {
+          std::cerr << "Wake socket creation failed." << std::endl;
+          return;
+        }
+
+        memset(&this->wakeAddr, 0, sizeof(this->wakeAddr));
+        this->wakeAddr.sin_family = AF_INET;
+        this->wakeAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        this->wakeAddr.sin_port = 0;
+
+        socklen_t addrLen = sizeof(this->wakeAddr);
+        if (bind(sock, reinterpret_cast<sockaddr *>(&this->wakeAddr),
+              sizeof(this->wakeAddr)) != 0 ||
+            getsockname(sock, reinterpret_cast<sockaddr *>(&this->wakeAddr),
+              &addrLen) != 0)
+        {
+          std::cerr << "Binding the wake socket failed." << std::endl;
+#ifdef _WIN32
+          closesocket(sock);
+#else
+          close(sock);
+#endif
+          return;
+        }
+
+        this->wakeSocket = sock;
+      }
+
+      /// \brief Wake up the reception thread, so it recalculates its timeout
+      /// and checks if it's time to exit. At most one wake up is pending at
+      /// any time.
+      private: void Wake() const
+      {
+        if (this->wakeSocket < 0 || this->wakePending.exchange(true))
+          return;
+
+        char byte = 0;
+        sendto(this->wakeSocket, reinterpret_cast<const raw_type *>(&byte), 1,
+          0, reinterpret_cast<const sockaddr *>(&this->wakeAddr),
+          sizeof(this->wakeAddr));
+      }
+
+      /// \brief Consume the pending wake up. The wake socket must be
+      /// readable.
+      private: void DrainWake()
+      {
+        this->wakePending = false;
+
+        char byte;
+        recv(this->wakeSocket, reinterpret_cast<raw_type *>(&byte), 1, 0);
+      }
+
       /// \brief Register a new relay address.
       /// \param[in] _ip New IP address.
       private: void AddRelayAddress(const std::string &_ip)
@@ -1370,16 +3192,78 @@ namespace ignition
       /// \brief IP Address used for multicast.
       private: std::string multicastGroup;
 
-      /// \brief Timeout used for receiving messages (ms.).
+      /// \brief Longest time the reception thread waits for messages (ms.).
+      /// The thread is woken up earlier when the heartbeats are rescheduled
+      /// or when the discovery is destroyed.
       private: const int kTimeout = 250;
 
       /// \brief Longest string to receive.
       private: static const uint16_t kMaxRcvStr =
                std::numeric_limits<uint16_t>::max();
 
+      /// \brief Largest datagram built when batching several discovery
+      /// messages: the payload of an UDP datagram in a 1500 bytes Ethernet
+      /// frame.
+      private: static const uint16_t kMaxDatagramSize = 1472;
+
       /// \brief Wire protocol version. Bump up the version number if you modify
       /// the wire protocol (for discovery or message/service exchange).
-      private: static const uint8_t kWireVersion = 10;
+      private: static const uint8_t kWireVersion = 12;
+
+      /// \brief Header key of the sequence number of a discovery state change
+      /// or heartbeat.
+      private: static constexpr const char *kSeqKey = "seq";
+
+      /// \brief Header key of the sequence number of a snapshot.
+      private: static constexpr const char *kSnapshotKey = "snapshot";
+
+      /// \brief Header key of the process whose snapshot is requested.
+      private: static constexpr const char *kSnapshotOfKey = "snapshot_of";
+
+      /// \brief Header key of the number of publishers of a snapshot.
+      private: static constexpr const char *kCountKey = "count";
+
+      /// \brief First byte of the frames with a binary layout.
+      private: static const char kBinaryFrameMarker = 0;
+
+      /// \brief Layout identifier of the binary heartbeats.
+      private: static const uint8_t kHeartbeatLayout = 1;
+
+      /// \brief Size of a binary heartbeat without the process UUID: marker,
+      /// layout, version, sequence number, interval and UUID length.
+      private: static const uint16_t kHeartbeatFixedSize = 19;
+
+      /// \brief Value of kSnapshotOfKey requesting the state of all the
+      /// processes.
+      private: static constexpr const char *kAnyProcess = "*";
+
+      /// \brief Time without answers from the peers after which the
+      /// handshake started by Start() is over (ms.).
+      private: static const unsigned int kHandshakeQuietInterval = 100;
+
+      /// \brief Header key of the time until the next heartbeat (ms.).
+      private: static constexpr const char *kIntervalKey = "interval";
+
+      /// \brief Header key of the capabilities of the process announcing a
+      /// publisher.
+      /// \sa SetCapabilities.
+      private: static constexpr const char *kCapsKey = "caps";
+
+      /// \brief Maximum heartbeat interval of the adaptive heartbeat, as a
+      /// multiple of the heartbeat interval.
+      /// \sa SetAdaptiveHeartbeat.
+      private: static const unsigned int kMaxHeartbeatBackoff = 8;
+
+      /// \brief Number of heartbeats announced by a remote process that we
+      /// can miss before it expires.
+      private: static const unsigned int kSilenceHeartbeats = 3;
+
+      /// \brief Interval between the writes of the cache file (ms.).
+      /// \sa SetCachePath.
+      private: static const unsigned int kCacheInterval = 1000;
+
+      /// \brief First bytes of the cache file.
+      private: static constexpr const char *kCacheMagic = "IGNDCACHE";
 
       /// \brief Port used to broadcast the discovery messages.
       private: int port;
@@ -1408,27 +3292,56 @@ namespace ignition
       /// \sa SetHeartbeatInterval.
       private: unsigned int heartbeatInterval;
 
+      /// \brief Time until the next heartbeat (ms.). It's longer than the
+      /// heartbeat interval when the adaptive heartbeat backs off.
+      private: unsigned int currentHeartbeatInterval;
+
+      /// \brief A callback, replaced and read atomically so that it runs
+      /// without any lock held. Null if there is no callback.
+      private: using CallbackPtr =
+                 std::shared_ptr<const DiscoveryCallback<Pub>>;
+
+      /// \brief Replace a callback.
+      /// \param[out] _slot The callback replaced.
+      /// \param[in] _cb The new callback, possibly empty.
+      private: static void StoreCallback(CallbackPtr &_slot,
+                                         const DiscoveryCallback<Pub> &_cb)
+      {
+        CallbackPtr cb;
+        if (_cb)
+          cb = std::make_shared<const DiscoveryCallback<Pub>>(_cb);
+        std::atomic_store(&_slot, cb);
+      }
+
+      /// \brief Get a callback.
+      /// \param[in] _slot The callback.
+      /// \return The callback, kept alive while it runs, or null.
+      private: static CallbackPtr LoadCallback(const CallbackPtr &_slot)
+      {
+        return std::atomic_load(&_slot);
+      }
+
       /// \brief Callback executed when new topics are discovered.
-      private: DiscoveryCallback<Pub> connectionCb;
+      private: CallbackPtr connectionCb;
 
       /// \brief Callback executed when new topics are invalid.
-      private: DiscoveryCallback<Pub> disconnectionCb;
+      private: CallbackPtr disconnectionCb;
 
       /// \brief Callback executed when a new remote subscriber is registered.
       /// ToDo: Remove static when possible.
-      private: inline static DiscoveryCallback<Pub> registrationCb;
+      private: inline static CallbackPtr registrationCb;
 
       /// \brief Callback executed when a new remote subscriber is unregistered.
       /// ToDo: Remove static when possible.
-      private: inline static DiscoveryCallback<Pub> unregistrationCb;
+      private: inline static CallbackPtr unregistrationCb;
 
-      /// \brief Addressing information.
+      /// \brief Addressing information. Protected by infoMutex.
       private: TopicStorage<Pub> info;
 
       /// \brief Activity information. Every time there is a message from a
       /// remote node, its activity information is updated. If we do not hear
       /// from a node in a while, its entries in 'info' will be invalided. The
-      /// key is the process uuid.
+      /// key is the process uuid. Protected by activityMutex.
       protected: std::map<std::string, Timestamp> activity;
 
       /// \brief Print discovery information to stdout.
@@ -1437,15 +3350,39 @@ namespace ignition
       /// \brief UDP socket used for sending/receiving discovery messages.
       private: std::vector<int> sockets;
 
+      /// \brief IP address of the interface of each socket.
+      private: std::vector<std::string> socketIfaces;
+
+      /// \brief Whether each socket sends discovery messages.
+      /// \sa SetInterfaces.
+      private: std::vector<bool> activeSockets;
+
+      /// \brief Mutex protecting the selection of interfaces.
+      private: mutable std::mutex socketsMutex;
+
       /// \brief Internet socket address for sending to the multicast group.
       private: sockaddr_in mcastAddr;
 
       /// \brief Collection of socket addresses used as remote relays.
       private: std::vector<sockaddr_in> relayAddrs;
 
-      /// \brief Mutex to guarantee exclusive access between the threads.
+      /// \brief Mutex protecting the local state and the settings, i.e. the
+      /// members that are neither protected by activityMutex nor by
+      /// infoMutex. The mutexes are locked in this order: mutex,
+      /// activityMutex, infoMutex. None of them is held while a callback
+      /// runs.
       private: mutable std::mutex mutex;
 
+      /// \brief Mutex protecting the state of the remote processes:
+      /// activity, timeServerActivity, remoteHeartbeats, remoteSeqs and
+      /// pubSeqs. The messages received only need this one most of the
+      /// time.
+      private: mutable std::mutex activityMutex;
+
+      /// \brief Reader-writer lock of the discovery information, the
+      /// queries of the application threads share it.
+      private: mutable std::shared_mutex infoMutex;
+
       /// \brief Thread in charge of receiving and handling incoming messages.
       private: std::thread threadReception;
 
@@ -1461,20 +3398,161 @@ namespace ignition
       /// \brief Once the discovery starts, it can take up to
       /// HeartbeatInterval milliseconds to discover the existing nodes on the
       /// network. This variable is 'false' during the first HeartbeatInterval
-      /// period and is set to 'true' after that.
-      private: bool initialized;
+      /// period and is set to 'true' after that. Set with the mutex locked,
+      /// read without it.
+      private: std::atomic<bool> initialized;
 
       /// \brief Number of heartbeats sent while discovery is uninitialized.
       private: unsigned int numHeartbeatsUninitialized;
 
+      /// \brief True while waiting for the peers to send their state.
+      /// \sa UpdateHandshake.
+      private: bool handshaking = false;
+
+      /// \brief Time at which the handshake will be over unless more
+      /// answers are received.
+      private: Timestamp timeHandshakeEnd;
+
       /// \brief Used to block/unblock until the initialization phase finishes.
       private: mutable std::condition_variable initializedCv;
 
       /// \brief When true, the service thread will finish.
       private: bool exit;
 
-      /// \brief When true, the service is enabled.
-      private: bool enabled;
+      /// \brief When true, the remote advertisements are filtered by
+      /// partition.
+      /// \sa SetPartitionFilter.
+      private: std::atomic<bool> partitionFilter{false};
+
+      /// \brief Partitions whose remote advertisements are stored when the
+      /// partition filter is enabled. Discover() adds the partition of its
+      /// topic.
+      private: mutable std::set<std::string> partitions;
+
+      /// \brief Socket which wakes up the reception thread, or -1.
+      /// \sa Wake.
+      private: int wakeSocket = -1;
+
+      /// \brief Loopback address of the wake socket.
+      private: sockaddr_in wakeAddr;
+
+      /// \brief Whether a wake up was sent but not consumed yet.
+      private: mutable std::atomic<bool> wakePending{false};
+
+      /// \brief When true, the service is enabled. Set with the mutex locked,
+      /// read without it.
+      private: std::atomic<bool> enabled;
+
+      /// \brief When true, this is the discovery server.
+      private: bool server;
+
+      /// \brief When true, the discovery messages are exchanged with a
+      /// discovery server. See IGN_DISCOVERY_SERVER.
+      private: bool useServer;
+
+      /// \brief Socket address of the discovery server.
+      private: sockaddr_in serverAddr;
+
+      /// \brief Time of the last message received from the discovery server.
+      private: Timestamp timeServerActivity;
+
+      /// \brief Socket addresses of the clients of the discovery server. The
+      /// key is the process uuid.
+      private: std::map<std::string, sockaddr_in> clients;
+
+      /// \brief Sequence number of our discovery state. It's increased each
+      /// time that we advertise or unadvertise a publisher.
+      private: uint64_t seq = 0;
+
+      /// \brief Sequence number of the discovery state of each remote process
+      /// that we are in sync with. The key is the process uuid.
+      private: std::map<std::string, uint64_t> remoteSeqs;
+
+      /// \brief Sequence number at which each remote publisher was last
+      /// advertised. The keys are the process uuid and the topic and node
+      /// uuid of the publisher.
+      private: std::map<std::string, std::map<
+               std::pair<std::string, std::string>, uint64_t>> pubSeqs;
+
+      /// \brief Time after which we can send another snapshot.
+      private: Timestamp timeNextSnapshot;
+
+      /// \brief When true, the heartbeats back off while the discovery state
+      /// doesn't change.
+      private: bool adaptiveHeartbeat = false;
+
+      /// \brief Whether the discovery state changed since the last heartbeat.
+      private: bool discoveryChanged = true;
+
+      /// \brief Time until the next heartbeat announced by each remote
+      /// process (ms.). The key is the process uuid.
+      private: std::map<std::string, unsigned int> remoteHeartbeats;
+
+      /// \brief Protects capabilities. It's locked after the other mutexes.
+      private: mutable std::mutex capsMutex;
+
+      /// \brief Capabilities of this process and of the remote processes
+      /// that announced any. The key is the process uuid.
+      /// \sa SetCapabilities.
+      private: std::map<std::string, uint64_t> capabilities;
+
+      /// \brief Path of the cache file, empty if there is none.
+      /// \sa SetCachePath.
+      private: std::string cachePath;
+
+      /// \brief Contents of the cache file, as last written or loaded.
+      private: std::string lastCache;
+
+      /// \brief Time after which the cache file is written again.
+      private: Timestamp timeNextCache;
+
+      /// \brief Get a counter of this discovery, in the metrics registry of
+      /// the process.
+      /// \param[in] _name Name of the counter.
+      /// \param[in] _help Description of the counter.
+      /// \return The counter.
+      private: static MetricCounter &DiscoveryCounter(const std::string &_name,
+                                                      const std::string &_help)
+      {
+        const std::string discovery =
+          std::is_same<Pub, MessagePublisher>::value ? "msg" : "srv";
+        return MetricsRegistry::Instance().Counter(_name, _help,
+          {{"discovery", discovery}});
+      }
+
+      /// \brief Discovery datagrams received.
+      private: MetricCounter &datagramsReceived = DiscoveryCounter(
+                 "ign_transport_discovery_datagrams_received",
+                 "Discovery datagrams received");
+
+      /// \brief Bytes of the discovery datagrams received.
+      private: MetricCounter &bytesReceived = DiscoveryCounter(
+                 "ign_transport_discovery_bytes_received",
+                 "Bytes of the discovery datagrams received");
+
+      /// \brief Discovery datagrams sent to the multicast group, once per
+      /// interface.
+      private: MetricCounter &multicastDatagramsSent = DiscoveryCounter(
+                 "ign_transport_discovery_multicast_datagrams_sent",
+                 "Discovery datagrams sent to the multicast group");
+
+      /// \brief Discovery datagrams sent to a unicast destination, e.g. a
+      /// relay or the discovery server.
+      private: MetricCounter &unicastDatagramsSent = DiscoveryCounter(
+                 "ign_transport_discovery_unicast_datagrams_sent",
+                 "Discovery datagrams sent to unicast destinations");
+
+      /// \brief Discovery messages received. A datagram can contain several
+      /// messages.
+      private: MetricCounter &msgsReceived = DiscoveryCounter(
+                 "ign_transport_discovery_messages_received",
+                 "Discovery messages received");
+
+      /// \brief CPU time spent handling the discovery datagrams received,
+      /// decoding and dispatching their messages (ns).
+      private: MetricCounter &dispatchCpuTime = DiscoveryCounter(
+                 "ign_transport_discovery_dispatch_cpu_nanoseconds",
+                 "CPU time spent handling the discovery datagrams received");
     };
 
     /// \def MsgDiscovery
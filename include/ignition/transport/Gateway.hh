@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_GATEWAY_HH_
+#define IGN_TRANSPORT_GATEWAY_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/NodeOptions.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    // Forward declarations.
+    class GatewayPrivate;
+
+    /// \class Gateway Gateway.hh ignition/transport/Gateway.hh
+    /// \brief Forwards topics between two sites through a single link. A
+    /// gateway runs at each end, on the same link. The messages of the
+    /// forwarded topics are received on the local side, packed in batches
+    /// and published on the link, where the other gateway republishes them
+    /// on its local side. The remote subscribers then only connect to their
+    /// own gateway, and the two gateways share one connection, instead of
+    /// every subscriber connecting to every publisher across the WAN.
+    ///
+    /// The two sides are usually different partitions, and the link a
+    /// partition shared by the gateways, made reachable across networks
+    /// with IGN_RELAY. A topic should only be forwarded by one of the two
+    /// gateways, otherwise its messages loop between them.
+    class IGNITION_TRANSPORT_VISIBLE Gateway
+    {
+      /// \brief Constructor.
+      /// \param[in] _link Name of the link, the same for the two gateways.
+      /// \param[in] _localOptions Options of the node on the local side,
+      /// e.g. its partition.
+      /// \param[in] _linkOptions Options of the node on the link, whose
+      /// partition is shared with the other gateway.
+      public: Gateway(const std::string &_link,
+                      const NodeOptions &_localOptions,
+                      const NodeOptions &_linkOptions);
+
+      /// \brief Destructor.
+      public: ~Gateway();
+
+      /// \brief Forward a topic of the local side to the other gateway.
+      /// \param[in] _topic Topic name. A pattern, as accepted by
+      /// Node::SubscribeRawWildcard(), forwards all the matching topics.
+      /// \param[in] _priority Priority of the messages. The messages of
+      /// higher priority are sent first and dropped last when the link
+      /// can't keep up.
+      /// \param[in] _maxRate Maximum number of messages per second sent for
+      /// the topic, or for all the topics of a pattern, the others are
+      /// dropped. Zero (default) sends them all.
+      /// \return True if the topic is forwarded.
+      public: bool Forward(const std::string &_topic,
+                           const int _priority = 0,
+                           const uint64_t _maxRate = 0);
+
+      /// \brief Set how long the messages wait to be sent with others.
+      /// \param[in] _delay Maximum delay in milliseconds. 10 by default.
+      public: void SetBatchDelay(const unsigned int _delay);
+
+      /// \brief Set the size of a batch. A batch is sent as soon as it's
+      /// full, without waiting for the batch delay.
+      /// \param[in] _size Maximum size of a batch (bytes), at least one
+      /// message is sent per batch. 1 MiB by default.
+      public: void SetMaxBatchSize(const std::size_t _size);
+
+      /// \brief Set the number of messages waiting to be sent, above which
+      /// the oldest messages of the lowest priority are dropped.
+      /// \param[in] _capacity Maximum number of messages. 10000 by default.
+      public: void SetQueueCapacity(const std::size_t _capacity);
+
+      /// \brief Compress the batches with zlib before sending them. The
+      /// batches that don't get smaller are sent as they are.
+      /// \param[in] _enabled True to compress. False by default.
+      public: void SetCompression(const bool _enabled);
+
+      /// \brief Get the number of messages sent to the other gateway.
+      /// \return The number of messages.
+      public: uint64_t SentMsgs() const;
+
+      /// \brief Get the number of batches sent to the other gateway.
+      /// \return The number of batches.
+      public: uint64_t SentBatches() const;
+
+      /// \brief Get the number of messages dropped by the rate limits or
+      /// because the queue was full.
+      /// \return The number of messages.
+      public: uint64_t DroppedMsgs() const;
+
+      /// \brief Get the number of messages received from the other gateway
+      /// and republished on the local side.
+      /// \return The number of messages.
+      public: uint64_t ReceivedMsgs() const;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::unique_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \internal
+      /// \brief Smart pointer to private data.
+      private: std::unique_ptr<GatewayPrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
@@ -18,13 +18,18 @@
 #ifndef IGN_TRANSPORT_HANDLERSTORAGE_HH_
 #define IGN_TRANSPORT_HANDLERSTORAGE_HH_
 
+#include <algorithm>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/TransportTypes.hh"
+#include "ignition/transport/Uuid.hh"
+#include "ignition/transport/detail/FlatHashMap.hh"
 
 namespace ignition
 {
@@ -45,9 +50,17 @@ namespace ignition
       using UUIDHandler_M = std::map<std::string, std::shared_ptr<T>>;
       using UUIDHandler_Collection_M = std::map<std::string, UUIDHandler_M>;
 
-      /// \brief key is a topic name and value is UUIDHandler_M
-      using TopicServiceCalls_M =
-        std::map<std::string, UUIDHandler_Collection_M>;
+      /// \brief Handlers of a node for a topic. The first element of each
+      /// pair is the handler UUID. A node rarely has more than a few
+      /// handlers per topic, a vector is faster to search than a map.
+      using NodeHandlers_V =
+        std::vector<std::pair<CompactUuid, std::shared_ptr<T>>>;
+
+      /// \brief Handlers of a topic. The key is the node UUID.
+      using NodeHandlers_M = FlatHashMap<CompactUuid, NodeHandlers_V>;
+
+      /// \brief key is a topic name and value is NodeHandlers_M
+      using TopicServiceCalls_M = FlatHashMap<std::string, NodeHandlers_M>;
 
       /// \brief Constructor.
       public: HandlerStorage() = default;
@@ -67,13 +80,38 @@ namespace ignition
         std::map<std::string,
           std::map<std::string, std::shared_ptr<T> >> &_handlers) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        _handlers = this->data.at(_topic);
+        _handlers.clear();
+        for (const auto &node : topicIt->second)
+        {
+          auto &handlers = _handlers[node.first.ToString()];
+          for (const auto &handler : node.second)
+            handlers.emplace(handler.first.ToString(), handler.second);
+        }
         return true;
       }
 
+      /// \brief Call a function for each handler of a topic, without copying
+      /// the handlers. The function must not add or remove handlers.
+      /// \param[in] _topic Topic name.
+      /// \param[in] _cb Function called with each handler.
+      public: void ForEachHandler(const std::string &_topic,
+        const std::function<void(const std::shared_ptr<T> &)> &_cb) const
+      {
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
+          return;
+
+        for (const auto &node : topicIt->second)
+        {
+          for (const auto &handler : node.second)
+            _cb(handler.second);
+        }
+      }
+
       /// \brief Get the first handler for a topic that matches a specific pair
       /// of request/response types.
       /// \param[in] _topic Topic name.
@@ -86,16 +124,15 @@ namespace ignition
                                 const std::string &_repTypeName,
                                 std::shared_ptr<T> &_handler) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        const auto &m = this->data.at(_topic);
-        for (const auto &node : m)
+        for (const auto &node : topicIt->second)
         {
           for (const auto &handler : node.second)
           {
-            if (_reqTypeName == handler.second->ReqTypeName() &&
-                _repTypeName == handler.second->RepTypeName())
+            if (handler.second->HasTypes(_reqTypeName, _repTypeName))
             {
               _handler = handler.second;
               return true;
@@ -115,11 +152,11 @@ namespace ignition
                                 const std::string &_msgTypeName,
                                 std::shared_ptr<T> &_handler) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        const auto &m = this->data.at(_topic);
-        for (const auto &node : m)
+        for (const auto &node : topicIt->second)
         {
           for (const auto &handler : node.second)
           {
@@ -145,18 +182,38 @@ namespace ignition
                            const std::string &_hUuid,
                            std::shared_ptr<T> &_handler) const
       {
-        if (this->data.find(_topic) == this->data.end())
-          return false;
+        return this->Handler(_topic, CompactUuid(_nUuid), CompactUuid(_hUuid),
+          _handler);
+      }
 
-        auto const &m = this->data.at(_topic);
-        if (m.find(_nUuid) == m.end())
+      /// \brief Get a specific handler.
+      /// \param[in] _topic Topic name.
+      /// \param[in] _nUuid Node UUID of the handler.
+      /// \param[in] _hUuid Handler UUID.
+      /// \param[out] _handler Handler requested.
+      /// \return true if the handler was found.
+      public: bool Handler(const std::string &_topic,
+                           const CompactUuid &_nUuid,
+                           const CompactUuid &_hUuid,
+                           std::shared_ptr<T> &_handler) const
+      {
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        if (m.at(_nUuid).find(_hUuid) == m.at(_nUuid).end())
+        auto nodeIt = topicIt->second.find(_nUuid);
+        if (nodeIt == topicIt->second.end())
           return false;
 
-        _handler = m.at(_nUuid).at(_hUuid);
-        return true;
+        for (const auto &handler : nodeIt->second)
+        {
+          if (handler.first == _hUuid)
+          {
+            _handler = handler.second;
+            return true;
+          }
+        }
+        return false;
       }
 
       /// \brief Add a request handler to a topic. A request handler stores
@@ -168,17 +225,30 @@ namespace ignition
                               const std::string &_nUuid,
                               const std::shared_ptr<T> &_handler)
       {
-        // Create the topic entry.
-        if (this->data.find(_topic) == this->data.end())
-          this->data[_topic] = UUIDHandler_Collection_M();
+        this->AddHandler(_topic, CompactUuid(_nUuid),
+          CompactUuid(_handler->HandlerUuid()), _handler);
+      }
 
-        // Create the Node UUID entry.
-        if (this->data[_topic].find(_nUuid) == this->data[_topic].end())
-          this->data[_topic][_nUuid] = UUIDHandler_M();
+      /// \brief Add a handler to a topic, given its UUIDs.
+      /// \param[in] _topic Topic name.
+      /// \param[in] _nUuid Node's unique identifier.
+      /// \param[in] _hUuid Handler's unique identifier.
+      /// \param[in] _handler The handler.
+      public: void AddHandler(const std::string &_topic,
+                              const CompactUuid &_nUuid,
+                              const CompactUuid &_hUuid,
+                              const std::shared_ptr<T> &_handler)
+      {
+        // Create the topic and node UUID entries if needed.
+        NodeHandlers_V &handlers = this->data[_topic][_nUuid];
 
-        // Add/Replace the Req handler.
-        this->data[_topic][_nUuid].insert(
-          std::make_pair(_handler->HandlerUuid(), _handler));
+        // A handler UUID that is already stored is kept.
+        for (const auto &handler : handlers)
+        {
+          if (handler.first == _hUuid)
+            return;
+        }
+        handlers.emplace_back(_hUuid, _handler);
       }
 
       /// \brief Return true if we have stored at least one request for the
@@ -187,10 +257,11 @@ namespace ignition
       /// \return true if we have stored at least one request for the topic.
       public: bool HasHandlersForTopic(const std::string &_topic) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        return !this->data.at(_topic).empty();
+        return !topicIt->second.empty();
       }
 
       /// \brief Check if a node has at least one handler.
@@ -200,11 +271,21 @@ namespace ignition
       public: bool HasHandlersForNode(const std::string &_topic,
                                       const std::string &_nUuid) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        return this->HasHandlersForNode(_topic, CompactUuid(_nUuid));
+      }
+
+      /// \brief Check if a node has at least one handler.
+      /// \param[in] _topic Topic name.
+      /// \param[in] _nUuid Node's unique identifier.
+      /// \return true if the node has at least one handler registered.
+      public: bool HasHandlersForNode(const std::string &_topic,
+                                      const CompactUuid &_nUuid) const
+      {
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        return this->data.at(_topic).find(_nUuid) !=
-               this->data.at(_topic).end();
+        return topicIt->second.count(_nUuid) > 0;
       }
 
       /// \brief Remove a request handler. The node's uuid is used as a key to
@@ -217,20 +298,43 @@ namespace ignition
                                  const std::string &_nUuid,
                                  const std::string &_reqUuid)
       {
-        size_t counter = 0;
-        if (this->data.find(_topic) != this->data.end())
-        {
-          if (this->data[_topic].find(_nUuid) != this->data[_topic].end())
+        return this->RemoveHandler(_topic, CompactUuid(_nUuid),
+          CompactUuid(_reqUuid));
+      }
+
+      /// \brief Remove a request handler, given its UUIDs.
+      /// \param[in] _topic Topic name.
+      /// \param[in] _nUuid Node's unique identifier.
+      /// \param[in] _reqUuid Request's UUID to remove.
+      /// \return True when the handler is removed or false otherwise.
+      public: bool RemoveHandler(const std::string &_topic,
+                                 const CompactUuid &_nUuid,
+                                 const CompactUuid &_reqUuid)
+      {
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
+          return false;
+
+        auto nodeIt = topicIt->second.find(_nUuid);
+        if (nodeIt == topicIt->second.end())
+          return false;
+
+        NodeHandlers_V &handlers = nodeIt->second;
+        auto it = std::find_if(handlers.begin(), handlers.end(),
+          [&_reqUuid](const typename NodeHandlers_V::value_type &_handler)
           {
-            counter = this->data[_topic][_nUuid].erase(_reqUuid);
-            if (this->data[_topic][_nUuid].empty())
-              this->data[_topic].erase(_nUuid);
-            if (this->data[_topic].empty())
-              this->data.erase(_topic);
-          }
-        }
+            return _handler.first == _reqUuid;
+          });
+        if (it == handlers.end())
+          return false;
 
-        return counter > 0;
+        handlers.erase(it);
+        if (handlers.empty())
+          topicIt->second.erase(nodeIt);
+        if (topicIt->second.empty())
+          this->data.erase(topicIt);
+
+        return true;
       }
 
       /// \brief Remove all the handlers from a given node.
@@ -240,20 +344,21 @@ namespace ignition
       public: bool RemoveHandlersForNode(const std::string &_topic,
                                          const std::string &_nUuid)
       {
-        size_t counter = 0;
-        if (this->data.find(_topic) != this->data.end())
-        {
-          counter = this->data[_topic].erase(_nUuid);
-          if (this->data[_topic].empty())
-            this->data.erase(_topic);
-        }
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
+          return false;
+
+        const std::size_t counter =
+          topicIt->second.erase(CompactUuid(_nUuid));
+        if (topicIt->second.empty())
+          this->data.erase(topicIt);
 
         return counter > 0;
       }
 
       /// \brief Stores all the service call data for each topic. The key of
       /// _data is the topic name. The value is another map, where the key is
-      /// the node UUID and the value is a smart pointer to the handler.
+      /// the node UUID and the value holds the handlers of the node.
       private: TopicServiceCalls_M data;
     };
     }
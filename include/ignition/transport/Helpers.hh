@@ -25,6 +25,7 @@
 #include <cstring>
 #include <limits>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "ignition/transport/config.hh"
@@ -72,6 +73,52 @@ namespace ignition
     /// \returns id of current process
     unsigned int IGNITION_TRANSPORT_VISIBLE getProcessId();
 
+    /// \brief Portable function to get the CPU time used by the calling
+    /// thread so far.
+    /// \returns CPU time of the current thread in nanoseconds, or 0 if the
+    /// system doesn't provide it.
+    int64_t IGNITION_TRANSPORT_VISIBLE threadCpuTime();
+
+    /// \brief Name a thread created by Ignition Transport and apply the
+    /// CPU affinity (IGN_TRANSPORT_THREAD_AFFINITY) and the SCHED_FIFO
+    /// priority (IGN_TRANSPORT_THREAD_PRIORITY) requested for the transport
+    /// threads. Only supported on Linux, it does nothing elsewhere.
+    /// \param[in] _thread The thread, which must be running.
+    /// \param[in] _name Name of the thread, truncated to 15 characters.
+    void IGNITION_TRANSPORT_VISIBLE configureThread(std::thread &_thread,
+        const std::string &_name);
+
+    /// \brief Parse a list of CPUs, as accepted by
+    /// IGN_TRANSPORT_THREAD_AFFINITY.
+    /// \param[in] _list A comma separated list of CPUs and CPU ranges, e.g.
+    /// "2,4-7".
+    /// \param[out] _cpus The CPUs, in the order of the list.
+    /// \return True if the list is valid.
+    bool IGNITION_TRANSPORT_VISIBLE parseCpus(const std::string &_list,
+        std::vector<int> &_cpus);
+
+    /// \brief Pin a thread to a single CPU, overriding the affinity applied
+    /// by configureThread(). Only supported on Linux, it does nothing
+    /// elsewhere.
+    /// \param[in] _thread The thread, which must be running.
+    /// \param[in] _cpu The CPU.
+    /// \param[in] _name Name of the thread, for the error messages.
+    void IGNITION_TRANSPORT_VISIBLE pinThread(std::thread &_thread,
+        const int _cpu, const std::string &_name);
+
+    /// \brief Hint the CPU that the caller is spinning, e.g. with the x86
+    /// pause instruction, to save power and leave the pipeline to the other
+    /// hardware thread of the core.
+    void IGNITION_TRANSPORT_VISIBLE cpuRelax();
+
+    /// \brief Apply the CPU affinity and the priority requested for the
+    /// transport threads to the I/O threads of a ZeroMQ context, as far as
+    /// libzmq supports it. It must be called before creating the sockets of
+    /// the context.
+    /// \param[in] _context The context.
+    void IGNITION_TRANSPORT_VISIBLE configureThreads(
+        zmq::context_t &_context);
+
     // Use safer functions on Windows
     #ifdef _MSC_VER
       #define ign_strcat strcat_s
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_HISTOGRAM_HH_
+#define IGN_TRANSPORT_HISTOGRAM_HH_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class Histogram Histogram.hh ignition/transport/Histogram.hh
+    /// \brief Fixed memory histogram of non negative integer samples, such
+    /// as durations, with a bounded relative error.
+    ///
+    /// The values below 2^(kSubBucketBits+1) have a bucket each. Above, each
+    /// power of two range is split into 2^kSubBucketBits buckets of the
+    /// same width, so a value is known with a relative error below
+    /// 1 / 2^kSubBucketBits (about 3%). Values above kMaxValue are counted
+    /// in the last bucket. Histograms can be merged, e.g. to combine the
+    /// snapshots of several periods or processes.
+    class IGNITION_TRANSPORT_VISIBLE Histogram
+    {
+      /// \brief Number of bits of precision of each bucket.
+      public: static constexpr unsigned int kSubBucketBits = 5u;
+
+      /// \brief Number of bits of the largest value told apart.
+      public: static constexpr unsigned int kMaxValueBits = 36u;
+
+      /// \brief Largest value told apart, about 19 hours in microseconds.
+      public: static constexpr uint64_t kMaxValue =
+        (uint64_t(1) << kMaxValueBits) - 1u;
+
+      /// \brief Number of buckets.
+      public: static constexpr std::size_t kNumBuckets =
+        std::size_t(kMaxValueBits - kSubBucketBits + 1u) << kSubBucketBits;
+
+      /// \brief Default constructor.
+      public: Histogram() = default;
+
+      /// \brief Default destructor.
+      public: ~Histogram() = default;
+
+      /// \brief Record a sample.
+      /// \param[in] _value Value of the sample.
+      /// \param[in] _count Number of samples with this value.
+      public: void Record(uint64_t _value, uint64_t _count = 1u);
+
+      /// \brief Add the samples of another histogram.
+      /// \param[in] _other Histogram to merge into this one.
+      public: void Merge(const Histogram &_other);
+
+      /// \brief Remove all the samples.
+      public: void Reset();
+
+      /// \brief Get the number of samples.
+      /// \return The number of samples.
+      public: uint64_t Count() const;
+
+      /// \brief Get the smallest sample.
+      /// \return The smallest sample, or 0 without samples.
+      public: uint64_t Min() const;
+
+      /// \brief Get the largest sample.
+      /// \return The largest sample, or 0 without samples.
+      public: uint64_t Max() const;
+
+      /// \brief Get the average of the samples.
+      /// \return The average value, or 0 without samples.
+      public: double Mean() const;
+
+      /// \brief Get the value that a percentage of the samples don't
+      /// exceed, e.g. 99 for the 99th percentile.
+      /// \param[in] _percentile Percentage of samples, between 0 and 100.
+      /// \return The largest value of the bucket that contains the
+      /// percentile, clamped between Min() and Max(). 0 without samples.
+      public: uint64_t ValueAtPercentile(double _percentile) const;
+
+      /// \brief Get the bucket of a value.
+      /// \param[in] _value The value.
+      /// \return Index of the bucket, below kNumBuckets.
+      public: static std::size_t BucketIndex(uint64_t _value);
+
+      /// \brief Get the smallest value of a bucket.
+      /// \param[in] _index Index of the bucket.
+      /// \return The smallest value counted in the bucket.
+      public: static uint64_t BucketLowestValue(std::size_t _index);
+
+      /// \brief Get the largest value of a bucket.
+      /// \param[in] _index Index of the bucket.
+      /// \return The largest value counted in the bucket.
+      public: static uint64_t BucketHighestValue(std::size_t _index);
+
+      /// \brief Number of samples of each bucket.
+      private: std::array<uint64_t, kNumBuckets> counts{};
+
+      /// \brief Number of samples.
+      private: uint64_t count = 0;
+
+      /// \brief Sum of the samples, used to calculate the average.
+      private: double sum = 0;
+
+      /// \brief Smallest sample.
+      private: uint64_t min = std::numeric_limits<uint64_t>::max();
+
+      /// \brief Largest sample.
+      private: uint64_t max = 0;
+    };
+    }
+  }
+}
+#endif
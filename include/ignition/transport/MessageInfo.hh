@@ -18,6 +18,7 @@
 #ifndef IGN_TRANSPORT_MESSAGEINFO_HH_
 #define IGN_TRANSPORT_MESSAGEINFO_HH_
 
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -89,6 +90,19 @@ namespace ignition
       /// \param[in] _value The intra-process value.
       public: void SetIntraProcess(bool _value);
 
+      /// \brief Get the time the message was received, on a monotonic clock.
+      /// A message from another process is stamped as soon as it's read from
+      /// the socket, and an intra-process message when it's published, so
+      /// the delay until a callback runs can be told apart from the arrival
+      /// time.
+      /// \return The time, or the epoch of the clock if it's unknown.
+      public: std::chrono::steady_clock::time_point ReceiveTime() const;
+
+      /// \brief Set the time the message was received.
+      /// \param[in] _time The time, on a monotonic clock.
+      public: void SetReceiveTime(
+                  const std::chrono::steady_clock::time_point &_time);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_MESSAGEPEEK_HH_
+#define IGN_TRANSPORT_MESSAGEPEEK_HH_
+
+#include <cstddef>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/TransportTypes.hh"
+
+namespace ignition
+{
+  namespace msgs
+  {
+    class Header;
+  }
+
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \brief Parse a single message field of a serialized message, e.g.
+    /// the header of a large message received by a raw subscriber, without
+    /// parsing the other fields. The other fields are skipped, so the cost
+    /// depends on the number of fields of the message, not on its size.
+    /// Like protobuf, every instance of the field is merged.
+    /// \param[in] _data The serialized message.
+    /// \param[in] _size Size of the serialized message.
+    /// \param[in] _field Number of the field.
+    /// \param[out] _msg The field, cleared if the message doesn't have it.
+    /// \return False if the serialized message or the field is malformed,
+    /// or if the field isn't a message.
+    bool IGNITION_TRANSPORT_VISIBLE peekField(const char *_data,
+                                              const std::size_t _size,
+                                              const int _field,
+                                              ProtoMsg &_msg);
+
+    /// \brief Whether the messages of a type start with an
+    /// ignition.msgs.Header, i.e. its first field is a header.
+    /// \param[in] _type Name of the type, e.g. "ignition.msgs.Image".
+    /// \return True if the type is known and has a header.
+    bool IGNITION_TRANSPORT_VISIBLE hasHeader(const std::string &_type);
+
+    /// \brief Parse the header of a serialized message, without parsing the
+    /// rest of it. The type of the message must have a header.
+    /// \param[in] _data The serialized message.
+    /// \param[in] _size Size of the serialized message.
+    /// \param[out] _header The header.
+    /// \return False if the serialized message is malformed.
+    /// \sa hasHeader
+    bool IGNITION_TRANSPORT_VISIBLE peekHeader(const char *_data,
+                                               const std::size_t _size,
+                                               msgs::Header &_header);
+    }
+  }
+}
+
+#endif
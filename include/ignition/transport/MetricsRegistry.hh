@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_METRICSREGISTRY_HH_
+#define IGN_TRANSPORT_METRICSREGISTRY_HH_
+
+#include <ignition/msgs/statistic.pb.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    // Forward declarations.
+    class MetricsRegistryPrivate;
+
+    /// \brief Labels of a metric, e.g. {{"topic", "/foo"}}.
+    using MetricLabels = std::map<std::string, std::string>;
+
+    /// \class MetricCounter MetricsRegistry.hh
+    /// ignition/transport/MetricsRegistry.hh
+    /// \brief Monotonic counter, cheap to increment from any thread.
+    class IGNITION_TRANSPORT_VISIBLE MetricCounter
+    {
+      /// \brief Increment the counter.
+      /// \param[in] _value Amount to add.
+      public: void Increment(uint64_t _value = 1)
+      {
+        this->value.fetch_add(_value, std::memory_order_relaxed);
+      }
+
+      /// \brief Get the value of the counter.
+      /// \return The value.
+      public: uint64_t Value() const
+      {
+        return this->value.load(std::memory_order_relaxed);
+      }
+
+      /// \brief The value.
+      private: std::atomic<uint64_t> value{0};
+    };
+
+    /// \class MetricGauge MetricsRegistry.hh
+    /// ignition/transport/MetricsRegistry.hh
+    /// \brief Value that goes up and down, cheap to update from any thread.
+    class IGNITION_TRANSPORT_VISIBLE MetricGauge
+    {
+      /// \brief Set the value of the gauge.
+      /// \param[in] _value The value.
+      public: void Set(int64_t _value)
+      {
+        this->value.store(_value, std::memory_order_relaxed);
+      }
+
+      /// \brief Add to the value of the gauge.
+      /// \param[in] _value Amount to add, negative to subtract.
+      public: void Add(int64_t _value)
+      {
+        this->value.fetch_add(_value, std::memory_order_relaxed);
+      }
+
+      /// \brief Get the value of the gauge.
+      /// \return The value.
+      public: int64_t Value() const
+      {
+        return this->value.load(std::memory_order_relaxed);
+      }
+
+      /// \brief The value.
+      private: std::atomic<int64_t> value{0};
+    };
+
+    /// \class MetricsRegistry MetricsRegistry.hh
+    /// ignition/transport/MetricsRegistry.hh
+    /// \brief Process-wide registry of the metrics of the transport
+    /// library: messages and bytes sent and received per topic, messages
+    /// dropped, local publish queues, discovery traffic and service
+    /// requests in flight.
+    ///
+    /// A metric is identified by its name and its labels. The counters and
+    /// gauges live as long as the process, so the hot paths look them up
+    /// once and keep a reference. Other values are sampled by a callback
+    /// when the metrics are exported.
+    ///
+    /// The metrics can be exported in the OpenMetrics text format, served
+    /// by a Prometheus scrape endpoint for instance, or published
+    /// periodically with Node::EnableMetrics().
+    class IGNITION_TRANSPORT_VISIBLE MetricsRegistry
+    {
+      /// \brief Get the registry of the process.
+      /// \return The registry.
+      public: static MetricsRegistry &Instance();
+
+      /// \brief Default destructor.
+      public: ~MetricsRegistry();
+
+      /// \brief Get a counter, created on first use.
+      /// \param[in] _name Name of the counter, without the "_total"
+      /// suffix added by the export.
+      /// \param[in] _help Description of the counter.
+      /// \param[in] _labels Labels of the counter.
+      /// \return The counter. If the name is already used by another type
+      /// of metric, the counter returned is not exported.
+      public: MetricCounter &Counter(const std::string &_name,
+                                     const std::string &_help,
+                                     const MetricLabels &_labels = {});
+
+      /// \brief Get a gauge, created on first use.
+      /// \param[in] _name Name of the gauge.
+      /// \param[in] _help Description of the gauge.
+      /// \param[in] _labels Labels of the gauge.
+      /// \return The gauge. If the name is already used by another type of
+      /// metric, the gauge returned is not exported.
+      public: MetricGauge &Gauge(const std::string &_name,
+                                 const std::string &_help,
+                                 const MetricLabels &_labels = {});
+
+      /// \brief Register a gauge whose value is sampled when the metrics
+      /// are exported. It replaces the callback registered with the same
+      /// name and labels, if any.
+      /// \param[in] _name Name of the gauge.
+      /// \param[in] _help Description of the gauge.
+      /// \param[in] _labels Labels of the gauge.
+      /// \param[in] _cb Callback returning the value. It runs without
+      /// holding any lock of the registry.
+      /// \return False if the name is already used by another type of
+      /// metric.
+      public: bool AddGaugeCallback(const std::string &_name,
+                                    const std::string &_help,
+                                    const MetricLabels &_labels,
+                                    std::function<double()> _cb);
+
+      /// \brief Remove a gauge registered with AddGaugeCallback().
+      /// \param[in] _name Name of the gauge.
+      /// \param[in] _labels Labels of the gauge.
+      /// \return True if the gauge was registered.
+      public: bool RemoveGaugeCallback(const std::string &_name,
+                                       const MetricLabels &_labels = {});
+
+      /// \brief Export the metrics in the OpenMetrics text format.
+      /// \return The metrics, ending with "# EOF".
+      public: std::string OpenMetrics() const;
+
+      /// \brief Populate an ignition::msgs::Metric message with the
+      /// metrics. Each statistic is named like an OpenMetrics sample, e.g.
+      /// ign_transport_messages_sent_total{topic="/foo"}.
+      /// \param[in] _msg Message to populate.
+      public: void FillMessage(msgs::Metric &_msg) const;
+
+      /// \brief Use Instance().
+      private: MetricsRegistry();
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::unique_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Private data pointer.
+      private: std::unique_ptr<MetricsRegistryPrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
@@ -47,12 +47,16 @@ namespace ignition
     /// \brief Determine IP or hostname.
     /// Reference: https://github.com/ros/ros_comm/blob/hydro-devel/clients/
     /// roscpp/src/libros/network.cpp
+    /// The hostname is resolved once per process, waiting at most
+    /// IGN_TRANSPORT_DNS_TIMEOUT milliseconds for it.
     /// \return The IP or hostname of this host.
     std::string IGNITION_TRANSPORT_VISIBLE determineHost();
 
     /// \brief Determine the list of network interfaces for this machine.
     /// Reference: https://github.com/ros/ros_comm/blob/hydro-devel/clients/
     /// roscpp/src/libros/network.cpp
+    /// The interfaces are enumerated once per process, unless
+    /// IGN_TRANSPORT_INTERFACES lists them.
     /// \return The list of network interfaces.
     std::vector<std::string> IGNITION_TRANSPORT_VISIBLE determineInterfaces();
 
@@ -18,7 +18,10 @@
 #define IGN_TRANSPORT_NODE_HH_
 
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -36,18 +39,23 @@
 #endif
 
 #include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/CallbackStatistics.hh"
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
 #include "ignition/transport/NodeOptions.hh"
 #include "ignition/transport/NodeShared.hh"
 #include "ignition/transport/Publisher.hh"
 #include "ignition/transport/RepHandler.hh"
+#include "ignition/transport/RequestFuture.hh"
 #include "ignition/transport/ReqHandler.hh"
+#include "ignition/transport/Serialization.hh"
 #include "ignition/transport/SubscribeOptions.hh"
 #include "ignition/transport/SubscriptionHandler.hh"
+#include "ignition/transport/ServiceStatistics.hh"
 #include "ignition/transport/TopicStatistics.hh"
 #include "ignition/transport/TopicUtils.hh"
 #include "ignition/transport/TransportTypes.hh"
+#include "ignition/transport/detail/PoolAllocator.hh"
 
 namespace ignition
 {
@@ -124,6 +132,15 @@ namespace ignition
         /// \brief Destructor.
         public: virtual ~Publisher();
 
+        /// \brief Constructor of a publisher of a transport domain.
+        /// \param[in] _publisher A message publisher.
+        /// \param[in] _shared The object shared by the nodes of the domain.
+        private: Publisher(const MessagePublisher &_publisher,
+                           NodeShared *_shared);
+
+        /// \brief Node creates the publishers of its domain.
+        private: friend class Node;
+
         /// \brief Allows this class to be evaluated as a boolean.
         /// \return True if valid
         /// \sa Valid
@@ -142,10 +159,53 @@ namespace ignition
         /// \brief Publish a message. This function will copy the message
         /// when publishing to interprocess subscribers. This copy is
         /// necessary to facilitate asynchronous publication.
+        /// If the topic was advertised with PublishMode_t::ASYNC, the
+        /// message is sent to the remote subscribers from a background
+        /// thread.
         /// \param[in] _msg A google::protobuf message.
-        /// \return true when success.
+        /// \return true when success. In PublishMode_t::ASYNC mode, false is
+        /// also returned when the message is dropped because the send queue
+        /// is full and the queue policy is QueuePolicy_t::DROP_NEWEST.
+        /// \sa AdvertiseMessageOptions::SetPublishMode
         public: bool Publish(const ProtoMsg &_msg);
 
+        /// \brief Publish a message without copying it for the local
+        /// subscribers. The local callbacks share the message, so it must not
+        /// be modified after this call. The message is still serialized for
+        /// the remote and raw subscribers. If the topic was advertised with
+        /// PublishMode_t::ASYNC, the message is serialized by the background
+        /// thread too, so this call doesn't wait for the serialization of a
+        /// large message. The messages of a publisher are still sent in
+        /// order. The raw subscribers of this process need the serialized
+        /// message right away, so it's serialized here if there are any.
+        /// \param[in] _msg A google::protobuf message.
+        /// \return true when success. A message that can't be serialized,
+        /// e.g. because of missing required fields, or whose buffer can't
+        /// be allocated, is reported here even when the serialization is
+        /// deferred.
+        /// \sa Publish(const ProtoMsg &)
+        public: bool Publish(const std::shared_ptr<const ProtoMsg> &_msg);
+
+        /// \brief Publish a message given up by the caller, without copying
+        /// it for the local subscribers.
+        /// \param[in] _msg A google::protobuf message.
+        /// \return true when success.
+        /// \sa Publish(const std::shared_ptr<const ProtoMsg> &)
+        public: template<typename MessageT>
+                bool Publish(std::unique_ptr<MessageT> _msg);
+
+        /// \brief Publish a message that isn't a protobuf message, using
+        /// its Serializer. The message is serialized once in a loaned
+        /// buffer, see PublishLoaned().
+        /// \param[in] _msg A message with a Serializer.
+        /// \return true when success.
+        /// \sa Serializer
+        public: template<typename MessageT>
+                typename std::enable_if<
+                  !std::is_base_of<ProtoMsg, MessageT>::value &&
+                  Serializer<MessageT>::kSupported, bool>::type
+                Publish(const MessageT &_msg);
+
         /// \brief Publish a raw pre-serialized message.
         ///
         /// \warning This function is only intended for advanced users. The
@@ -171,6 +231,101 @@ namespace ignition
           const std::string &_msgData,
           const std::string &_msgType);
 
+        /// \brief Publish a raw pre-serialized message held in a buffer of
+        /// the caller, e.g. the data of a log::Message. The data is only
+        /// read during this call, and it's copied once for the remote
+        /// subscribers.
+        /// \param[in] _msgData Serialized data of the message.
+        /// \param[in] _size Number of bytes of _msgData.
+        /// \param[in] _msgType A std::string that contains the message type
+        /// name.
+        /// \return true when success.
+        /// \sa PublishRaw
+        public: bool PublishRaw(
+          const char *_msgData,
+          const std::size_t _size,
+          const std::string &_msgType);
+
+        /// \brief Publish a raw pre-serialized message made of several
+        /// buffers, e.g. a header and a payload serialized separately. The
+        /// segments are sent to the remote subscribers without gathering
+        /// them when the topic is sent in chunks, and the subscribers
+        /// receive a single contiguous message. The release function of
+        /// each segment is called once nobody needs its data anymore,
+        /// which may be after this call returns.
+        /// \param[in] _segments Buffers of the message, in order.
+        /// \param[in] _msgType A std::string that contains the message type
+        /// name.
+        /// \return true when success.
+        /// \sa PublishRaw
+        public: bool PublishSegments(
+          const std::vector<MessageSegment> &_segments,
+          const std::string &_msgType);
+
+        /// \brief Publish a message and get a future completed once every
+        /// subscriber matched now has run its callbacks, e.g. to step a
+        /// simulation in lockstep with its subscribers. The local
+        /// subscribers always acknowledge the message. The remote ones only
+        /// do if the topic was advertised with
+        /// AdvertiseMessageOptions::SetAcknowledged(), otherwise this call
+        /// fails. The callbacks that run on an executor or a thread of
+        /// their own, e.g. conflated or batched subscriptions, acknowledge
+        /// the message once they ran, or once the message was dropped from
+        /// their queue or replaced by a newer one. The message is sent from
+        /// this thread even if the publisher is asynchronous.
+        /// \param[in] _msg Message to publish.
+        /// \return A future completed with true once all the subscribers
+        /// acknowledged the message, or with false if the message couldn't
+        /// be published or a subscriber process left before acknowledging
+        /// it. Wait for it with a timeout, a subscriber that lost the
+        /// message doesn't acknowledge it.
+        public: std::future<bool> PublishAcked(const ProtoMsg &_msg);
+
+        /// \brief Borrow a writable buffer from this publisher's buffer pool.
+        /// Serialize a message into the buffer and publish it with
+        /// PublishLoaned(), or give it back with ReturnLoan(). Buffers are
+        /// recycled once every subscriber is done with them, so publishing
+        /// loaned buffers avoids a memory allocation and a copy per message.
+        /// \param[in] _size Minimum size of the buffer (bytes).
+        /// \return Pointer to a buffer of at least _size bytes, or nullptr
+        /// if this publisher is not valid.
+        public: char *Loan(const std::size_t _size);
+
+        /// \brief Publish a raw pre-serialized message stored in a buffer
+        /// obtained from Loan(). The buffer is passed to remote subscribers
+        /// without copying it. Ownership of the buffer goes back to
+        /// this publisher, so _data must not be used after this call,
+        /// regardless of the result.
+        /// \param[in] _data A buffer returned by Loan().
+        /// \param[in] _size Number of bytes of serialized data in _data.
+        /// \param[in] _msgType A std::string that contains the message type
+        /// name.
+        /// \return true when success.
+        /// \sa PublishRaw
+        public: bool PublishLoaned(
+          char *_data,
+          const std::size_t _size,
+          const std::string &_msgType);
+
+        /// \brief Give back a buffer obtained from Loan() without
+        /// publishing it.
+        /// \param[in] _data A buffer returned by Loan().
+        public: void ReturnLoan(char *_data);
+
+        /// \brief Queue a message to be published with the next call to
+        /// Flush(). Remote subscribers receive all the queued messages in a
+        /// single ZeroMQ message, which reduces the per-message overhead
+        /// when publishing many small messages. Queued messages that haven't
+        /// been flushed when the publisher is destroyed are discarded.
+        /// \param[in] _msg A google::protobuf message.
+        /// \return true when success.
+        /// \sa Flush
+        public: bool Enqueue(const ProtoMsg &_msg);
+
+        /// \brief Publish all the messages queued with Enqueue(), in order.
+        /// \return true when success.
+        public: bool Flush();
+
         /// \brief Check if message publication is throttled. If so, verify
         /// whether the next message should be published or not.
         ///
@@ -186,10 +341,62 @@ namespace ignition
         /// \return true if the message should be published or false otherwise.
         private: bool UpdateThrottling();
 
+        /// \brief Publish a message whose type is the advertised one,
+        /// without checking it.
+        /// \param[in] _msg A google::protobuf message.
+        /// \return true when success.
+        /// \sa TypedPublisher
+        protected: bool PublishTyped(const ProtoMsg &_msg);
+
+        /// \brief Publish a loaned buffer holding a message of the
+        /// advertised type, without checking it.
+        /// \param[in] _data A buffer returned by Loan().
+        /// \param[in] _size Number of bytes of serialized data in _data.
+        /// \return true when success.
+        /// \sa TypedPublisher
+        protected: bool PublishLoanedTyped(char *_data,
+                                           const std::size_t _size);
+
+        /// \brief Serialize a message that isn't a protobuf message in a
+        /// loaned buffer and publish it.
+        /// \param[in] _msg A message with a Serializer.
+        /// \param[in] _typeChecked True if MessageT is the advertised type.
+        /// \return true when success.
+        protected: template<typename MessageT>
+                   bool PublishSerialized(const MessageT &_msg,
+                                          const bool _typeChecked);
+
+        /// \brief Implementation of PublishLoaned().
+        /// \param[in] _data A buffer returned by Loan().
+        /// \param[in] _size Number of bytes of serialized data in _data.
+        /// \param[in] _msgType Message type name.
+        /// \param[in] _typeChecked True if _msgType is known to be the
+        /// advertised type.
+        /// \return true when success.
+        private: bool PublishLoanedHelper(char *_data,
+                                          const std::size_t _size,
+                                          const std::string &_msgType,
+                                          const bool _typeChecked);
+
         /// \brief Return true if this publisher has subscribers.
         /// \return True if subscribers have connected to this publisher.
         public: bool HasConnections() const;
 
+        /// \brief Set a callback run when this topic gets its first
+        /// subscriber and when it loses its last one, with the same meaning
+        /// as HasConnections(). Producers of expensive messages may use it
+        /// to stop generating them while nobody listens, instead of polling
+        /// HasConnections(). The callback runs on a thread of its own, right
+        /// away with true if the topic already has subscribers, and is
+        /// stopped when this publisher is destroyed or the callback is
+        /// replaced. Calls in progress are not waited for.
+        /// \param[in] _callback Callback receiving true when the topic
+        /// gets subscribers and false when it loses them. An empty callback
+        /// stops the notifications.
+        /// \return False if this publisher is not valid.
+        public: bool SetMatchedCallback(
+          const std::function<void(const bool _matched)> &_callback);
+
         /// \internal
         /// \brief Smart pointer to private data.
         /// This is std::shared_ptr because we want to trigger the destructor
@@ -207,6 +414,45 @@ namespace ignition
 #endif
       };
 
+      /// \brief A publisher of a message type known at compile time,
+      /// returned by Node::Advertise<MessageT>(). Publishing a MessageT
+      /// skips the type checks that Publisher does at runtime, since the
+      /// topic was advertised with that type, and the subscribers are
+      /// matched with interned type IDs instead of type names. The other
+      /// functions of Publisher, including the Publish() overloads checked
+      /// at runtime, are still available.
+      ///
+      /// ## Pseudo code example ##
+      ///
+      ///    auto pub = myNode.Advertise<ignition::msgs::Int32>("topic_name");
+      ///    ignition::msgs::Int32 msg;
+      ///    pub.Publish(msg);
+      public: template<typename MessageT>
+      class TypedPublisher : public Publisher
+      {
+        static_assert(Serializer<MessageT>::kSupported,
+                      "The message type has no serializer");
+
+        /// \brief Default constructor, for a publisher that isn't valid.
+        public: TypedPublisher() = default;
+
+        /// \brief Constructor.
+        /// \param[in] _publisher A publisher advertised with MessageT.
+        private: explicit TypedPublisher(const Publisher &_publisher);
+
+        /// \brief Node::Advertise<MessageT>() creates the typed publishers.
+        private: friend class Node;
+
+        /// \brief The Publish() overloads of Publisher.
+        public: using Publisher::Publish;
+
+        /// \brief Publish a message of the advertised type.
+        /// \param[in] _msg Message to publish.
+        /// \return true when success.
+        /// \sa Publisher::Publish(const ProtoMsg &)
+        public: bool Publish(const MessageT &_msg);
+      };
+
       /// \brief Constructor.
       /// \param[in] _options Node options.
       public: explicit Node(const NodeOptions &_options = NodeOptions());
@@ -217,13 +463,14 @@ namespace ignition
       /// \brief Advertise a new topic. If a topic is currently advertised,
       /// you cannot advertise it a second time (regardless of its type).
       /// \param[in] _topic Topic name to be advertised.
-      /// \param[in] _options Advertise options.
-      /// \return A PublisherId, which can be used in Node::Publish calls.
-      /// The PublisherId also acts as boolean, where true occurs if the topic
-      /// was succesfully advertised.
+      /// \param[in] _options Advertise options. The topics of host local
+      /// message types, see HostLocalMessage, have at most the host scope.
+      /// \return A TypedPublisher, which can be used in Node::Publish calls.
+      /// The TypedPublisher also acts as boolean, where true occurs if the
+      /// topic was succesfully advertised.
       /// \sa AdvertiseOptions.
       public: template<typename MessageT>
-      Node::Publisher Advertise(
+      Node::TypedPublisher<MessageT> Advertise(
           const std::string &_topic,
           const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
 
@@ -243,6 +490,34 @@ namespace ignition
           const std::string &_msgTypeName,
           const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
 
+      /// \brief Advertise a set of new topics of the same type. The
+      /// discovery sends all the advertisements together, in as few
+      /// datagrams as possible, instead of one multicast packet per topic.
+      /// \param[in] _topics Topic names to be advertised.
+      /// \param[in] _options Advertise options, shared by all the topics.
+      /// \return One publisher per topic, in the same order. The publishers
+      /// of the topics that couldn't be advertised evaluate to false.
+      /// \sa Advertise
+      public: template<typename MessageT>
+      std::vector<Node::Publisher> AdvertiseMany(
+          const std::vector<std::string> &_topics,
+          const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
+
+      /// \brief Advertise a set of new topics of the same type. The
+      /// discovery sends all the advertisements together, in as few
+      /// datagrams as possible, instead of one multicast packet per topic.
+      /// \param[in] _topics Topic names to be advertised.
+      /// \param[in] _msgTypeName Name of the message type that will be
+      /// published on the topics.
+      /// \param[in] _options Advertise options, shared by all the topics.
+      /// \return One publisher per topic, in the same order. The publishers
+      /// of the topics that couldn't be advertised evaluate to false.
+      /// \sa Advertise
+      public: std::vector<Node::Publisher> AdvertiseMany(
+          const std::vector<std::string> &_topics,
+          const std::string &_msgTypeName,
+          const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
+
       /// \brief Get the list of topics advertised by this node.
       /// \return A vector containing all the topics advertised by this node.
       public: std::vector<std::string> AdvertisedTopics() const;
@@ -325,6 +600,25 @@ namespace ignition
                              const MessageInfo &_info)> &_callback,
           const SubscribeOptions &_opts = SubscribeOptions());
 
+      /// \brief Subscribe to a set of topics with the same callback. The
+      /// handlers are registered first and the discovery requests of all
+      /// the topics are sent together, in as few datagrams as possible,
+      /// instead of one multicast packet per topic. The callback tells the
+      /// topics apart with MessageInfo::Topic().
+      /// \param[in] _topics Topics to be subscribed.
+      /// \param[in] _callback Lambda function with the following parameters:
+      ///   \param[in] _msg Protobuf message containing a new topic update.
+      ///   \param[in] _info Message information (e.g.: topic name).
+      /// \param[in] _opts Subscription options, shared by all the topics.
+      /// \return true when all the topics were successfully subscribed or
+      /// false otherwise. The valid topics are subscribed anyway.
+      public: template<typename MessageT>
+      bool SubscribeMany(
+          const std::vector<std::string> &_topics,
+          const std::function<void(const MessageT &_msg,
+                                   const MessageInfo &_info)> &_callback,
+          const SubscribeOptions &_opts = SubscribeOptions());
+
       /// \brief Subscribe to a topic registering a callback.
       /// Note that this callback includes message information.
       /// In this version the callback is a member function.
@@ -344,6 +638,44 @@ namespace ignition
           ClassT *_obj,
           const SubscribeOptions &_opts = SubscribeOptions());
 
+      /// \brief Subscribe to a topic registering a callback that shares the
+      /// ownership of the messages. The message received by the callback is
+      /// the one deserialized by the transport, it can be kept or handed to
+      /// another thread without a copy. It is shared with the other
+      /// subscribers of the process and must not be modified.
+      /// \param[in] _topic Topic to be subscribed.
+      /// \param[in] _callback Callback with the following parameters:
+      ///   \param[in] _msg Protobuf message containing a new topic update.
+      ///   \param[in] _info Message information (e.g.: topic name).
+      /// \param[in] _opts Subscription options.
+      /// \return true when successfully subscribed or false otherwise.
+      public: template<typename MessageT>
+      bool Subscribe(
+          const std::string &_topic,
+          const std::function<void(std::shared_ptr<const MessageT> _msg,
+                                   const MessageInfo &_info)> &_callback,
+          const SubscribeOptions &_opts = SubscribeOptions());
+
+      /// \brief Subscribe to a topic registering a callback that receives
+      /// the messages in batches. The messages received from other processes
+      /// while the callback runs are delivered together in the next call,
+      /// which amortizes the dispatch of high rate topics. The callbacks of
+      /// all the batched subscriptions of the process run on a shared
+      /// thread. Intra-process messages are delivered one at a time. If the
+      /// options have a queue size, the oldest messages beyond it are
+      /// dropped; the dedicated thread and conflation options are ignored.
+      /// \param[in] _topic Topic to be subscribed.
+      /// \param[in] _callback Callback with the following parameters:
+      ///   \param[in] _msgs Protobuf messages, oldest first.
+      ///   \param[in] _infos Information of each message.
+      /// \param[in] _opts Subscription options.
+      /// \return true when successfully subscribed or false otherwise.
+      public: template<typename MessageT>
+      bool SubscribeBatch(
+          const std::string &_topic,
+          const BatchMsgCallback<MessageT> &_callback,
+          const SubscribeOptions &_opts = SubscribeOptions());
+
       /// \brief Get the list of topics subscribed by this node. Note that
       /// we might be interested in one topic but we still don't know the
       /// address of a publisher.
@@ -351,8 +683,8 @@ namespace ignition
       /// have an address for a particular topic yet).
       public: std::vector<std::string> SubscribedTopics() const;
 
-      /// \brief Unsubscribe from a topic.
-      /// \param[in] _topic Topic name to be unsubscribed.
+      /// \brief Unsubscribe from a topic, or remove a wildcard subscription.
+      /// \param[in] _topic Topic name or pattern to be unsubscribed.
       /// \return true when successfully unsubscribed or false otherwise.
       public: bool Unsubscribe(const std::string &_topic);
 
@@ -662,6 +994,180 @@ namespace ignition
       public: template<typename RequestT>
       bool Request(const std::string &_topic, const RequestT &_request);
 
+      /// \brief Request a service several times using a blocking call. All
+      /// the requests are sent before waiting for the responses, so they are
+      /// in flight at the same time and the call takes about one round trip
+      /// instead of one round trip per request.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _requests Protobuf messages containing the parameters of
+      /// each request.
+      /// \param[in] _timeout Maximum time to wait for all the responses (ms).
+      /// \param[out] _replies Protobuf messages containing the responses, in
+      /// the same order as _requests.
+      /// \param[out] _results Result of each service call. False for the
+      /// requests that were not executed before the timeout.
+      /// \return true when all the requests were executed or false if the
+      /// timeout expired before some of them.
+      public: template<typename RequestT, typename ReplyT>
+      bool RequestAll(
+          const std::string &_topic,
+          const std::vector<RequestT> &_requests,
+          const unsigned int &_timeout,
+          std::vector<ReplyT> &_replies,
+          std::vector<bool> &_results);
+
+      /// \brief Request a new service and get a handle to its response,
+      /// without blocking nor using a thread per request. The handle can be
+      /// waited on, given a continuation with RequestFuture::Then() or
+      /// awaited from a C++20 coroutine. Remote responsers don't answer
+      /// requests whose response is msgs::Empty, use
+      /// Request(_topic, _request) for those.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _request Protobuf message containing the request's
+      /// parameters.
+      /// \return Handle to the response. It completes without being executed
+      /// if the request couldn't be made.
+      public: template<typename RequestT, typename ReplyT>
+      RequestFuture<ReplyT> RequestAsync(
+          const std::string &_topic,
+          const RequestT &_request);
+
+      /// \brief Request a new service without input parameter and get a
+      /// handle to its response.
+      /// \param[in] _topic Service name requested.
+      /// \return Handle to the response.
+      /// \sa RequestAsync(const std::string &, const RequestT &)
+      public: template<typename ReplyT>
+      RequestFuture<ReplyT> RequestAsync(const std::string &_topic);
+
+      /// \brief Advertise a streaming service. The callback writes the
+      /// response as a sequence of chunks, each one is sent to the requester
+      /// as soon as it's written, so large or incremental responses don't
+      /// have to be built in memory first. Use RequestStream() to consume
+      /// the chunks.
+      /// \param[in] _topic Topic name associated to the service.
+      /// \param[in] _callback Callback to handle the service request with the
+      /// following parameters:
+      ///   \param[in] _request Protobuf message containing the request.
+      ///   \param[in] _write Function writing a chunk. It returns false if
+      ///   the chunk couldn't be sent, the callback should stop then.
+      ///   \return Service call result.
+      /// \param[in] _options Advertise options.
+      /// \return true when the topic has been successfully advertised or
+      /// false otherwise.
+      /// \sa AdvertiseOptions.
+      public: template<typename RequestT, typename ChunkT>
+      bool AdvertiseStream(
+          const std::string &_topic,
+          std::function<bool(const RequestT &_request,
+            const std::function<bool(const ChunkT &_chunk)> &_write)>
+            _callback,
+          const AdvertiseServiceOptions &_options = AdvertiseServiceOptions());
+
+      /// \brief Request a streaming service. The chunks are delivered as
+      /// they arrive, followed by the result of the service call. A regular
+      /// service delivers its reply as a single chunk.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _request Protobuf message containing the request's
+      /// parameters.
+      /// \param[in] _chunkCb Callback executed for each chunk of the
+      /// response.
+      /// \param[in] _doneCb Callback executed after the last chunk with the
+      /// result of the service call.
+      /// \return true when the service call was successfully requested.
+      public: template<typename RequestT, typename ChunkT>
+      bool RequestStream(
+          const std::string &_topic,
+          const RequestT &_request,
+          std::function<void(const ChunkT &_chunk)> _chunkCb,
+          std::function<void(const bool _result)> _doneCb);
+
+      /// \brief Advertise a service that handles serialized messages. The
+      /// requests reach the callback as they were received and the response
+      /// is sent as written, so proxies and bridges can forward services
+      /// without the message types. The requesters see a regular service
+      /// of the given types.
+      /// \param[in] _topic Topic name associated to the service.
+      /// \param[in] _reqType Message type name of the request.
+      /// \param[in] _repType Message type name of the response.
+      /// \param[in] _callback Callback to handle the service request, see
+      /// RawRepCallback.
+      /// \param[in] _options Advertise options.
+      /// \return true when the topic has been successfully advertised or
+      /// false otherwise.
+      public: bool AdvertiseRaw(
+          const std::string &_topic,
+          const std::string &_reqType,
+          const std::string &_repType,
+          const RawRepCallback &_callback,
+          const AdvertiseServiceOptions &_options = AdvertiseServiceOptions());
+
+      /// \brief Request a service with a serialized request and get the
+      /// serialized response. It blocks until the response is received or
+      /// the timeout expires.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _request Serialized request.
+      /// \param[in] _reqType Message type name of the request.
+      /// \param[in] _repType Message type name of the response.
+      /// \param[in] _timeout The request will timeout after '_timeout' ms.
+      /// \param[out] _response Serialized response.
+      /// \param[out] _result Result of the service call.
+      /// \return true when the request was executed or false if the timeout
+      /// expired.
+      public: bool RequestRaw(
+          const std::string &_topic,
+          const std::string &_request,
+          const std::string &_reqType,
+          const std::string &_repType,
+          const unsigned int _timeout,
+          std::string &_response,
+          bool &_result);
+
+      /// \brief Request a service with a serialized request. The callback
+      /// receives the serialized response.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _request Serialized request.
+      /// \param[in] _reqType Message type name of the request.
+      /// \param[in] _repType Message type name of the response.
+      /// \param[in] _callback Callback executed with the response, see
+      /// RawReqCallback.
+      /// \return true when the service call was successfully requested.
+      public: bool RequestRaw(
+          const std::string &_topic,
+          const std::string &_request,
+          const std::string &_reqType,
+          const std::string &_repType,
+          const RawReqCallback &_callback);
+
+      /// \brief Discover the responsers of some services ahead of their
+      /// first request. The responsers are connected as soon as they are
+      /// discovered, so the first requests go straight to the wire instead
+      /// of waiting for the discovery.
+      /// \param[in] _services Names of the services.
+      /// \param[in] _keepResolved Whether to discover the services again
+      /// whenever one of their responsers leaves, until this node is
+      /// destroyed, so a replacement is connected as soon as it appears.
+      /// \return True if the discovery requests were sent.
+      public: bool PrefetchServices(const std::vector<std::string> &_services,
+                                    const bool _keepResolved = false);
+
+      /// \brief Measure the round trip time and the clock offset to another
+      /// process. Every process offers a ping service once it uses services,
+      /// or from the start with IGN_TRANSPORT_PING=1. The pings are regular
+      /// service calls, so they also feed the response times of the latency
+      /// load balancing.
+      /// \param[in] _pUuid UUID of the process, e.g. from ServiceInfo().
+      /// \param[in] _timeout The ping will timeout after '_timeout' ms.
+      /// \param[out] _rtt Round trip time, without the time the other process
+      /// took to answer.
+      /// \param[out] _offset Offset of the system clock of the other process
+      /// relative to ours, positive if it's ahead.
+      /// \return True if the process answered before the timeout.
+      public: bool Ping(const std::string &_pUuid,
+                        const unsigned int _timeout,
+                        std::chrono::nanoseconds &_rtt,
+                        std::chrono::nanoseconds &_offset);
+
       /// \brief Unadvertise a service.
       /// \param[in] _topic Service name to be unadvertised.
       /// \return true if the service was successfully unadvertised.
@@ -717,16 +1223,67 @@ namespace ignition
         const std::string &_msgType = kGenericMessageType,
         const SubscribeOptions &_opts = SubscribeOptions());
 
+      /// \brief Subscribe to all the topics matching a pattern, including
+      /// the topics advertised later. A segment of the pattern may be "*",
+      /// which matches one segment, and the last segment may be "**", which
+      /// matches one or more segments. E.g. "/robot1/sensors/*" matches
+      /// "/robot1/sensors/lidar" and "/robot1/**" also matches
+      /// "/robot1/sensors/lidar/points". The callback is called for the
+      /// messages of every matching topic, MessageInfo::Topic() tells them
+      /// apart. Call Unsubscribe() with the same pattern to remove it.
+      /// \param[in] _pattern Topic pattern.
+      /// \param[in] _callback The callback, as in SubscribeRaw().
+      /// \param[in] _msgType Only match the topics of this type. Using
+      /// kGenericMessageType (the default) matches all the types.
+      /// \param[in] _opts Options for subscribing.
+      /// \return True if subscribing was successful.
+      public: bool SubscribeRawWildcard(
+        const std::string &_pattern,
+        const RawCallback &_callback,
+        const std::string &_msgType = kGenericMessageType,
+        const SubscribeOptions &_opts = SubscribeOptions());
+
       /// \brief Get the reference to the current node options.
       /// \return Reference to the current node options.
       public: const NodeOptions &Options() const;
 
+      /// \brief Run the pending subscription callbacks of this node on the
+      /// calling thread, when created with NodeOptions::SetSpinCallbacks().
+      /// The messages of a topic are delivered in order, also when several
+      /// threads spin the node.
+      /// \param[in] _max Maximum number of callbacks to run. Zero runs at
+      /// most the messages pending when called.
+      /// \return Number of messages delivered, zero if the node doesn't
+      /// spin its callbacks.
+      public: std::size_t SpinSome(const std::size_t _max = 0);
+
+      /// \brief Run the subscription callbacks of this node on the calling
+      /// thread as the messages arrive, until a deadline, when created with
+      /// NodeOptions::SetSpinCallbacks().
+      /// \param[in] _deadline Time when the function returns.
+      /// \return Number of messages delivered, zero if the node doesn't
+      /// spin its callbacks.
+      public: std::size_t SpinUntil(
+                const std::chrono::steady_clock::time_point &_deadline);
+
+      /// \brief File descriptor readable while messages are pending for
+      /// SpinSome(), to wait for them in an event loop with poll() or
+      /// select(). It must not be read or closed.
+      /// \return The file descriptor, or -1 if the node doesn't spin its
+      /// callbacks or on Windows.
+      public: int SpinFd() const;
+
       /// \brief Turn topic statistics on or off.
       /// \param[in] _topic The name of the topic on which to enable or disable
       /// statistics.
       /// \param[in] _enable True to enable statistics, false to disable.
       /// \param[in] _publicationTopic Topic on which to publish statistics.
       /// \param[in] _publicationRate Rate at which to publish statistics.
+      /// The statistics are published from a statistics thread, and only
+      /// if they were updated since the previous publication. The
+      /// statistics are disabled once no node of the process subscribes to
+      /// the topic, or when too many topics have statistics enabled, see
+      /// IGN_TRANSPORT_TOPIC_STATISTICS_MAX_TOPICS.
       public: bool EnableStats(const std::string &_topic, bool _enable,
                   const std::string &_publicationTopic = "/statistics",
                   uint64_t _publicationRate = 1);
@@ -740,6 +1297,80 @@ namespace ignition
       public: std::optional<TopicStatistics> TopicStats(
                   const std::string &_topic) const;
 
+      /// \brief Turn the statistics of a service on or off. The statistics
+      /// cover the requests of the service exchanged with other processes:
+      /// number of requests, requests in flight, end-to-end latency of the
+      /// requests of this process, and the queueing and execution times
+      /// of the requests served by this process.
+      /// \param[in] _service The name of the service on which to enable or
+      /// disable statistics.
+      /// \param[in] _enable True to enable statistics, false to disable.
+      /// \param[in] _publicationTopic Topic on which to publish statistics.
+      /// \param[in] _publicationRate Rate at which to publish statistics.
+      /// \return True if the service name is valid.
+      /// \sa ServiceStatistics
+      public: bool EnableServiceStats(const std::string &_service,
+                  bool _enable,
+                  const std::string &_publicationTopic =
+                    "/service_statistics",
+                  uint64_t _publicationRate = 1);
+
+      /// \brief Get the current statistics of a service. Statistics must
+      /// have been enabled using the EnableServiceStats function, otherwise
+      /// the return value will be std::nullopt.
+      /// \param[in] _service The name of the service to get statistics for.
+      /// \return A ServiceStatistics class, or std::nullopt if statistics
+      /// were not enabled.
+      public: std::optional<ServiceStatistics> ServiceStats(
+                  const std::string &_service) const;
+
+      /// \brief Turn the periodic publication of the transport metrics of
+      /// this process on or off: messages and bytes sent and received per
+      /// topic, messages dropped, local publish queues, discovery traffic
+      /// and service requests in flight. The metrics are published as an
+      /// ignition::msgs::Metric message, whose statistics are named like
+      /// OpenMetrics samples. Use MetricsRegistry::Instance() to export
+      /// them in the OpenMetrics text format instead.
+      /// \param[in] _enable True to enable the publication, false to
+      /// disable.
+      /// \param[in] _publicationTopic Topic on which to publish the metrics.
+      /// \param[in] _publicationRate Rate at which to publish the metrics.
+      /// \return True if the publication topic is valid.
+      /// \sa MetricsRegistry
+      public: bool EnableMetrics(bool _enable,
+                  const std::string &_publicationTopic =
+                    "/transport_metrics",
+                  uint64_t _publicationRate = 1);
+
+      /// \brief Get the number of messages discarded by the queues of the
+      /// subscriptions of this node to a topic, because their callbacks
+      /// couldn't keep up.
+      /// \param[in] _topic The topic name.
+      /// \return The number of messages discarded since the subscriptions
+      /// were created.
+      /// \sa SubscribeOptions::SetQueueSize
+      public: uint64_t SubscriptionDroppedMsgs(
+                  const std::string &_topic) const;
+
+      /// \brief Get the execution time of the callbacks of the profiled
+      /// subscriptions of this node to a topic, e.g. to find the callback
+      /// that stalls the reception of the messages.
+      /// \param[in] _topic The topic name.
+      /// \return The statistics of each profiled subscription.
+      /// \sa SubscribeOptions::SetCallbackProfiling
+      public: std::vector<CallbackStatistics> CallbackStats(
+                const std::string &_topic) const;
+
+      /// \brief Get the statistics of the connections between this process
+      /// and the others carrying messages: connections and disconnections
+      /// of each peer, and the bytes waiting to be sent to each remote
+      /// subscriber, which reveal the slow ones. The statistics are
+      /// collected when the IGN_TRANSPORT_CONNECTION_STATISTICS environment
+      /// variable is 1, and exported as metrics too, see MetricsRegistry.
+      /// \return The statistics of each connection, empty if they aren't
+      /// collected.
+      public: std::vector<ConnectionStatistics> ConnectionStats() const;
+
       /// \brief Get a pointer to the shared node (singleton shared by all the
       /// nodes).
       /// \return The pointer to the shared node.
@@ -762,6 +1393,66 @@ namespace ignition
       /// \return True on success.
       private: bool SubscribeHelper(const std::string &_fullyQualifiedTopic);
 
+      /// \brief Helper function for Subscribe. The new handler receives the
+      /// latest message of a transient local topic published by this
+      /// process.
+      /// \param[in] _fullyQualifiedTopic Fully qualified topic name
+      /// \param[in] _handler The new subscription handler.
+      /// \return True on success.
+      private: bool SubscribeHelper(const std::string &_fullyQualifiedTopic,
+                                    const ISubscriptionHandlerPtr &_handler);
+
+      /// \brief Start deferring the discovery requests of the new
+      /// subscriptions. Batches may be nested.
+      /// \sa EndDiscoveryBatch
+      private: void BeginDiscoveryBatch();
+
+      /// \brief Send the discovery requests deferred since the outermost
+      /// BeginDiscoveryBatch() call, together.
+      /// \return True on success.
+      private: bool EndDiscoveryBatch();
+
+      /// \brief Helper function for Advertise. Prepares the topic for
+      /// publication, without notifying the discovery service.
+      /// \param[in] _topic Topic name to be advertised.
+      /// \param[in] _msgTypeName Name of the message type.
+      /// \param[in] _options Advertise options.
+      /// \param[out] _publisher The publisher to advertise.
+      /// \return True on success.
+      private: bool AdvertiseHelper(const std::string &_topic,
+                                    const std::string &_msgTypeName,
+                                    const AdvertiseMessageOptions &_options,
+                                    MessagePublisher &_publisher);
+
+      /// \brief Subscribe to a topic of messages that aren't protobuf
+      /// messages. The messages are read with their Serializer from the raw
+      /// data received.
+      /// \param[in] _topic Topic to be subscribed.
+      /// \param[in] _cb Callback receiving the messages read.
+      /// \param[in] _opts Subscription options.
+      /// \return true when successfully subscribed or false otherwise.
+      private: template<typename MessageT>
+      bool SubscribeSerialized(
+          const std::string &_topic,
+          const std::function<void(const MessageT &_msg,
+                                   const MessageInfo &_info)> &_cb,
+          const SubscribeOptions &_opts);
+
+      /// \brief Apply the topic remapping of this node to a topic name and
+      /// fully qualify the result with the partition and namespace of the
+      /// node. The names are interned in a per node cache, so repeated calls
+      /// with the same topic do not validate or allocate again.
+      /// \param[in] _topic Topic name as passed by the user.
+      /// \return The fully qualified name or nullptr if the name is not valid.
+      /// \sa TopicUtils::FullyQualifiedName
+      private: std::shared_ptr<const std::string> FullyQualifiedTopic(
+                  const std::string &_topic) const;
+
+      /// \brief Apply the topic remapping of this node to a topic name.
+      /// \param[in] _topic Topic name as passed by the user.
+      /// \return The remapped topic name or _topic when it is not remapped.
+      private: std::string RemappedTopic(const std::string &_topic) const;
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
@@ -126,15 +127,112 @@ namespace ignition
       public: bool TopicRemap(const std::string &_fromTopic,
                               std::string &_toTopic) const;
 
+      /// \brief Get the number of threads running the subscription
+      /// callbacks of this node.
+      /// \return The number of threads.
+      /// \sa SetCallbackThreads
+      public: unsigned int CallbackThreads() const;
+
+      /// \brief Set the number of threads running the subscription callbacks
+      /// of this node. By default (zero), the callbacks of the messages
+      /// received from other processes run on the reception thread shared by
+      /// all the nodes in the process, so a slow callback delays every
+      /// topic. With one or more threads, the node owns a pool of threads
+      /// that run its callbacks. Messages of the same topic are still
+      /// delivered in order and one at a time, while different topics run in
+      /// parallel. See also SubscribeOptions::SetDedicatedThread.
+      /// \param[in] _threads Number of threads.
+      public: void SetCallbackThreads(const unsigned int _threads);
+
+      /// \brief Whether the application runs the subscription callbacks of
+      /// this node.
+      /// \return True if the callbacks run in Node::SpinSome() and
+      /// Node::SpinUntil().
+      /// \sa SetSpinCallbacks
+      public: bool SpinCallbacks() const;
+
+      /// \brief Let the application run the subscription callbacks of this
+      /// node on its own thread. The messages of the subscriptions are then
+      /// queued, local or remote, and their callbacks only run when the
+      /// application calls Node::SpinSome() or Node::SpinUntil(), e.g. from
+      /// its control loop, or when Node::SpinFd() becomes readable. This
+      /// takes precedence over SetCallbackThreads() and over the dedicated
+      /// threads and the queue limits of the subscriptions, whose messages
+      /// are only bounded by IGN_TRANSPORT_RCVQUEUE_BYTES. The conflated
+      /// and batched subscriptions, the subscriptions with inline delivery
+      /// and the services keep running on the threads of the transport.
+      /// \param[in] _spin True to run the callbacks from the application.
+      public: void SetSpinCallbacks(const bool _spin);
+
+      /// \brief Get the interval between discovery heartbeats requested by
+      /// this node.
+      /// \return The interval (ms.). Zero for the default value.
+      /// \sa SetDiscoveryHeartbeatInterval
+      public: unsigned int DiscoveryHeartbeatInterval() const;
+
+      /// \brief Set the interval between discovery heartbeats. The
+      /// discovery is shared by all the nodes of the process, so the value
+      /// applies to the whole process when the node is created. The default
+      /// value (zero) keeps the current interval, see also the
+      /// IGN_DISCOVERY_HEARTBEAT_INTERVAL environment variable.
+      /// \param[in] _ms Interval (ms.).
+      public: void SetDiscoveryHeartbeatInterval(const unsigned int _ms);
+
+      /// \brief Get the discovery silence interval requested by this node.
+      /// \return The interval (ms.). Zero for the default value.
+      /// \sa SetDiscoverySilenceInterval
+      public: unsigned int DiscoverySilenceInterval() const;
+
+      /// \brief Set the time without hearing from a remote process before
+      /// the discovery forgets its topics and services. Like the heartbeat
+      /// interval, it applies to the whole process when the node is created.
+      /// The default value (zero) keeps the current interval, see also the
+      /// IGN_DISCOVERY_SILENCE_INTERVAL environment variable.
+      /// \param[in] _ms Interval (ms.).
+      public: void SetDiscoverySilenceInterval(const unsigned int _ms);
+
+      /// \brief Get the network interfaces requested for the discovery.
+      /// \return IP addresses of the interfaces. Empty for the default value.
+      /// \sa SetDiscoveryInterfaces
+      public: std::vector<std::string> DiscoveryInterfaces() const;
+
+      /// \brief Restrict the discovery multicast traffic to some network
+      /// interfaces of the host. Like the discovery intervals, it applies to
+      /// the whole process when the node is created. The default value (an
+      /// empty list) keeps the current interfaces, see also the
+      /// IGN_DISCOVERY_INTERFACES environment variable.
+      /// \param[in] _ifaces IP addresses of the interfaces.
+      public: void SetDiscoveryInterfaces(
+                  const std::vector<std::string> &_ifaces);
+
+      /// \brief Get the transport domain of the node.
+      /// \return Name of the domain. Empty for the default domain.
+      /// \sa SetDomain
+      public: const std::string &Domain() const;
+
+      /// \brief Set the transport domain of the node. The nodes of a domain
+      /// share their sockets, reception threads, discovery and locks, which
+      /// are independent from the other domains of the process. Nodes of
+      /// different domains communicate as if they were in different
+      /// processes, so unrelated subsystems of a process can use their own
+      /// domain to avoid contending with each other. The process wide
+      /// settings above, e.g. the discovery intervals, apply to the domain.
+      /// The process metrics only cover the default domain.
+      /// \param[in] _domain Name of the domain. Empty for the default
+      /// domain, shared by all the nodes that don't set one.
+      public: void SetDomain(const std::string &_domain);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
-// std::unique_ptr
+// std::shared_ptr
 #pragma warning(push)
 #pragma warning(disable: 4251)
 #endif
       /// \internal
-      /// \brief Smart pointer to private data.
-      protected: std::unique_ptr<transport::NodeOptionsPrivate> dataPtr;
+      /// \brief Smart pointer to private data. The copies share it until
+      /// one of them is modified, so the nodes don't duplicate the options
+      /// they are created with.
+      protected: std::shared_ptr<transport::NodeOptionsPrivate> dataPtr;
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
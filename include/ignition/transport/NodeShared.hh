@@ -26,6 +26,8 @@
 #pragma warning(pop)
 #endif
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -35,11 +37,15 @@
 #include <map>
 
 #include "ignition/transport/config.hh"
+#include "ignition/transport/ConnectionStatistics.hh"
 #include "ignition/transport/Export.hh"
 #include "ignition/transport/HandlerStorage.hh"
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/MetricsRegistry.hh"
 #include "ignition/transport/Publisher.hh"
 #include "ignition/transport/RepHandler.hh"
 #include "ignition/transport/ReqHandler.hh"
+#include "ignition/transport/ServiceStatistics.hh"
 #include "ignition/transport/SubscriptionHandler.hh"
 #include "ignition/transport/TopicStorage.hh"
 #include "ignition/transport/TopicStatistics.hh"
@@ -70,10 +76,20 @@ namespace ignition
       /// \return Pointer to the current NodeShared instance.
       public: static NodeShared *Instance();
 
+      /// \brief Get the NodeShared instance shared between all the nodes
+      /// of a transport domain, creating it if needed.
+      /// \param[in] _domain Name of the domain. Empty for the default
+      /// domain, returned by Instance().
+      /// \return Pointer to the NodeShared instance of the domain.
+      /// \sa NodeOptions::SetDomain
+      public: static NodeShared *Instance(const std::string &_domain);
+
       /// \brief Receive data and control messages.
       public: void RunReceptionTask();
 
-      /// \brief Publish data.
+      /// \brief Publish data. This function doesn't take the global mutex
+      /// on the common path, so it can be called from many threads without
+      /// contending with the reception of messages and discovery updates.
       /// \param[in] _topic Topic to be published.
       /// \param[in, out] _data Serialized data. Note that this buffer will be
       /// automatically deallocated by ZMQ when all data has been published.
@@ -83,12 +99,32 @@ namespace ignition
       /// deallocates the buffer containing the published data.
       /// \ref http://zeromq.org/blog:zero-copy
       /// \param[in] _msgType Message type in string format.
+      /// \param[in] _hint Opaque pointer forwarded to _ffn as its second
+      /// argument. It can be used to release a reference counted buffer
+      /// shared with other subscribers.
+      /// \param[in] _ackId ID of the message in the acknowledgements of the
+      /// remote subscribers, or 0 if the message isn't acknowledged.
       /// \return true when success or false otherwise.
       public: bool Publish(const std::string &_topic,
                            char *_data,
                            const size_t _dataSize,
                            DeallocFunc *_ffn,
-                           const std::string &_msgType);
+                           const std::string &_msgType,
+                           void *_hint = nullptr,
+                           const uint64_t _ackId = 0);
+
+      /// \brief Publish a message made of several segments to the remote
+      /// subscribers. When all of them can reassemble chunked messages,
+      /// each segment is sent as a chunk, without copying it. Otherwise,
+      /// the segments are gathered in one buffer and sent with Publish().
+      /// \param[in] _topic Topic to be published.
+      /// \param[in] _segments Segments of the message. The segments are
+      /// released when the last reference to _segments is released.
+      /// \param[in] _msgType Message type in string format.
+      /// \return true when success or false otherwise.
+      public: bool PublishSegments(const std::string &_topic,
+        const std::shared_ptr<const std::vector<MessageSegment>> &_segments,
+        const std::string &_msgType);
 
       /// \brief Method in charge of receiving the topic updates.
       public: void RecvMsgUpdate();
@@ -144,6 +180,11 @@ namespace ignition
         // cppcheck-suppress unusedStructMember
         public: bool haveRemote;
 
+        /// \brief Highest rate accepted by the remote subscribers, or
+        /// kUnthrottled if at least one of them is not throttled. The
+        /// publishers don't send messages faster than this.
+        public: uint64_t remoteMsgsPerSec = kUnthrottled;
+
         // Friendship declaration
         friend class NodeShared;
 
@@ -173,6 +214,20 @@ namespace ignition
         const std::string &_msgData,
         const HandlerInfo &_handlerInfo);
 
+      /// \brief Call the SubscriptionHandler callbacks (local and raw) for this
+      /// NodeShared. The raw handlers receive _msgData directly and the local
+      /// handlers parse it in place.
+      /// \param[in] _info Message information.
+      /// \param[in] _msgData The raw serialized data for the message
+      /// \param[in] _size Size of the serialized data.
+      /// \param[in] _handlerInfo Information for the handlers of this node,
+      /// as generated by CheckHandlerInfo(const std::string&) const
+      public: void TriggerCallbacks(
+        const MessageInfo &_info,
+        const char *_msgData,
+        const std::size_t _size,
+        const HandlerInfo &_handlerInfo);
+
       /// \brief Method in charge of receiving the control updates (when a new
       /// remote subscriber notifies its presence for example).
       /// ToDo: Remove this function when possible.
@@ -193,6 +248,15 @@ namespace ignition
                                          const std::string &_reqType,
                                          const std::string &_repType);
 
+      /// \brief Stop waiting for the response of a request. The handler is
+      /// removed and, if the request was sent to a remote responser, a
+      /// cancellation is sent so the responser can skip the request if it
+      /// didn't run yet.
+      /// \param[in] _topic Fully qualified service name.
+      /// \param[in] _handler The request handler.
+      public: void CancelRemoteReq(const std::string &_topic,
+                                   const IReqHandlerPtr &_handler);
+
       /// \brief Callback executed when the discovery detects new topics.
       /// \param[in] _pub Information of the publisher in charge of the topic.
       public: void OnNewConnection(const MessagePublisher &_pub);
@@ -267,14 +331,68 @@ namespace ignition
       /// If your buffer reaches the maximum capacity data will be dropped.
       public: int SndHwm();
 
+      /// \brief Get the number of messages waiting to be delivered to the
+      /// subscribers of this process, in all the local publish queues.
+      /// \return The number of queued messages.
+      public: std::size_t LocalPublishQueueDepth() const;
+
+      /// \brief Get the highest number of messages queued so far in one of
+      /// the local publish queues.
+      /// \return The high-water mark (messages).
+      public: std::size_t LocalPublishQueueHighWaterMark() const;
+
+      /// \brief Get the statistics of the connections of the sockets
+      /// carrying the messages between this process and the others.
+      /// \return The statistics of the connections to the remote
+      /// subscribers, then the ones of the connections to the remote
+      /// publishers. Empty unless the IGN_TRANSPORT_CONNECTION_STATISTICS
+      /// environment variable is 1.
+      public: std::vector<ConnectionStatistics> ConnectionStats() const;
+
+      /// \brief Get the number of messages dropped because a local publish
+      /// queue was full. Set the size of the queues with the
+      /// IGN_TRANSPORT_LOCAL_PUBLISH_QUEUE_SIZE environment variable.
+      /// \return The number of messages dropped.
+      public: uint64_t LocalPublishQueueDroppedMsgs() const;
+
+      /// \brief Set the intervals of the message and service discovery.
+      /// The discovery is shared by all the nodes of the process.
+      /// \param[in] _heartbeat Interval between heartbeats (ms.).
+      /// \param[in] _silence Time without hearing from a remote process
+      /// before forgetting its topics and services (ms.).
+      /// \param[in] _activity Interval between checks of the remote
+      /// processes activity (ms.).
+      /// A zero value keeps the current interval.
+      public: void SetDiscoveryIntervals(const unsigned int _heartbeat,
+                                         const unsigned int _silence,
+                                         const unsigned int _activity = 0);
+
+      /// \brief Restrict the multicast traffic of the message and service
+      /// discovery to some network interfaces. The discovery is shared by all
+      /// the nodes of the process.
+      /// \param[in] _ifaces IP addresses of the interfaces. An empty list
+      /// keeps the current interfaces.
+      /// \return False if none of the interfaces is used by the discovery.
+      public: bool SetDiscoveryInterfaces(
+                  const std::vector<std::string> &_ifaces);
+
       /// \brief Turn topic statistics on or off.
       /// \param[in] _topic The name of the topic on which to enable or disable
       /// statistics.
       /// \param[in] _enable True to enable statistics, false to disable.
-      /// \param[in] _cb Callback that is triggered whenever statistics are
-      /// updated.
+      /// \param[in] _cb Callback that is triggered with the statistics when
+      /// they are updated, at most _rate times per second. It runs on a
+      /// statistics thread, so a slow callback doesn't delay the reception
+      /// of messages, and it's not triggered anymore once this function
+      /// returns after disabling the statistics.
+      /// \param[in] _rate Maximum number of calls of _cb per second, 0 for
+      /// every update. When more topics than
+      /// IGN_TRANSPORT_TOPIC_STATISTICS_MAX_TOPICS have statistics enabled,
+      /// the statistics of the topic updated the least recently are
+      /// disabled.
       public: void EnableStats(const std::string &_topic, bool _enable,
-                  std::function<void(const TopicStatistics &_stats)> _cb);
+                  std::function<void(const TopicStatistics &_stats)> _cb,
+                  uint64_t _rate = 0);
 
       /// \brief Get the current statistics for a topic. Statistics must
       /// have been enabled using the EnableStatistics function, otherwise
@@ -285,9 +403,52 @@ namespace ignition
       public: std::optional<TopicStatistics> TopicStats(
                   const std::string &_topic) const;
 
+      /// \brief Turn the statistics of a service on or off. The statistics
+      /// cover the requests exchanged with other processes, on both the
+      /// requester and the responder sides.
+      /// \param[in] _service Fully qualified service name.
+      /// \param[in] _enable True to enable statistics, false to disable.
+      /// \param[in] _cb Callback that is triggered with the statistics when
+      /// they are updated, at most _rate times per second. It runs on the
+      /// thread that updates the statistics.
+      /// \param[in] _rate Maximum number of calls of _cb per second, 0 for
+      /// every update.
+      public: void EnableServiceStats(const std::string &_service,
+                  bool _enable,
+                  std::function<void(const ServiceStatistics &_stats)> _cb,
+                  uint64_t _rate);
+
+      /// \brief Turn the periodic publication of the transport metrics on
+      /// or off. See MetricsRegistry.
+      /// \param[in] _enable True to enable the publication, false to
+      /// disable.
+      /// \param[in] _cb Callback that is triggered with the metrics
+      /// registry _rate times per second, on a metrics thread. It's not
+      /// triggered anymore once this function returns after disabling the
+      /// publication.
+      /// \param[in] _rate Number of calls of _cb per second, 0 for the
+      /// default of 1.
+      public: void EnableMetrics(bool _enable,
+                  std::function<void(const MetricsRegistry &_metrics)> _cb,
+                  uint64_t _rate);
+
+      /// \brief Get the current statistics of a service. Statistics must
+      /// have been enabled using the EnableServiceStats function, otherwise
+      /// the return value will be std::nullopt.
+      /// \param[in] _service Fully qualified service name.
+      /// \return A ServiceStatistics class, or std::nullopt if statistics
+      /// were not enabled.
+      public: std::optional<ServiceStatistics> ServiceStats(
+                  const std::string &_service) const;
+
       /// \brief Constructor.
       protected: NodeShared();
 
+      /// \brief Constructor of the instance of a transport domain.
+      /// \param[in] _domain Name of the domain. Empty for the default
+      /// domain.
+      protected: explicit NodeShared(const std::string &_domain);
+
       /// \brief Destructor.
       protected: virtual ~NodeShared();
 
@@ -296,6 +457,18 @@ namespace ignition
       /// return false if any operation on a ZMQ socket triggered an exception.
       private: bool InitializeSockets();
 
+      /// \brief Initialize the services on first use, see
+      /// InitializeServices(). The processes that neither offer nor request
+      /// services, nor use reliable or acknowledged topics, never do.
+      /// \return True if the services are available.
+      private: bool EnsureServices();
+
+      /// \brief Bind the service sockets, and start the service discovery
+      /// and the threads handling the services. Must be called with the
+      /// mutex locked, once.
+      /// \return True when success or false otherwise.
+      private: bool InitializeServices();
+
       //////////////////////////////////////////////////
       /////// Declare here other member variables //////
       //////////////////////////////////////////////////
@@ -383,6 +556,20 @@ namespace ignition
             const std::string &_fullyQualifiedTopic,
             const std::string &_msgTypeName) const;
 
+        /// \brief Get the highest rate accepted by the subscribers of a node
+        /// that match the topic and message type criteria.
+        /// \param[in] _fullyQualifiedTopic Fully-qualified topic name that the
+        /// subscribers must be listening to.
+        /// \param[in] _msgTypeName Name of the message type that the
+        /// subscribers must be listening for.
+        /// \param[in] _nUuid The UUID of the node.
+        /// \return The rate, or kUnthrottled if at least one subscriber of the
+        /// node is not throttled.
+        public: uint64_t MsgsPerSec(
+            const std::string &_fullyQualifiedTopic,
+            const std::string &_msgTypeName,
+            const std::string &_nUuid) const;
+
         /// \brief Remove the handlers for the given topic name that belong to
         /// a specific node.
         /// \param[in] _fullyQualifiedTopic The fully-qualified name of the
@@ -442,6 +629,7 @@ namespace ignition
 #endif
       private: friend Node;
       private: friend NodePrivate;
+      private: friend NodeSharedPrivate;
     };
     }
   }
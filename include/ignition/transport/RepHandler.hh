@@ -30,10 +30,15 @@
 #include <google/protobuf/stubs/casts.h>
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
@@ -76,6 +81,38 @@ namespace ignition
       public: virtual bool RunCallback(const std::string &_req,
                                        std::string &_rep) = 0;
 
+      /// \brief Whether the handler streams its response as a sequence of
+      /// chunks instead of a single reply.
+      /// \return True for the handlers of a streaming service.
+      public: virtual bool Streaming() const
+      {
+        return false;
+      }
+
+      /// \brief Executes the callback of a streaming service.
+      /// \param[in] _req Serialized request.
+      /// \param[in] _write Function that sends a serialized chunk. It
+      /// returns false if the chunk couldn't be sent, the callback should
+      /// stop then.
+      /// \return Service call result.
+      public: virtual bool RunStreamCallback(const std::string &/*_req*/,
+        const std::function<bool(const std::string &)> &/*_write*/)
+      {
+        return false;
+      }
+
+      /// \brief Executes the callback of a streaming service for a requester
+      /// in the same process.
+      /// \param[in] _msgReq Request.
+      /// \param[in] _write Function that delivers a chunk.
+      /// \return Service call result.
+      public: virtual bool RunLocalStreamCallback(
+        const transport::ProtoMsg &/*_msgReq*/,
+        const std::function<bool(const transport::ProtoMsg &)> &/*_write*/)
+      {
+        return false;
+      }
+
       /// \brief Get the unique UUID of this handler.
       /// \return a string representation of the handler UUID.
       public: std::string HandlerUuid() const
@@ -83,6 +120,187 @@ namespace ignition
         return this->hUuid;
       }
 
+      /// \brief Get the maximum number of requests from other processes
+      /// executed concurrently.
+      /// \return The maximum number of concurrent requests. Zero if the
+      /// requests run on the reception thread.
+      public: unsigned int MaxConcurrency() const
+      {
+        return this->maxConcurrency;
+      }
+
+      /// \brief Set the maximum number of requests from other processes
+      /// executed concurrently.
+      /// \param[in] _maxConcurrency The maximum number of concurrent
+      /// requests. Zero runs the requests on the reception thread.
+      public: void SetMaxConcurrency(const unsigned int _maxConcurrency)
+      {
+        this->maxConcurrency = _maxConcurrency;
+      }
+
+      /// \brief Get the maximum number of requests from other processes
+      /// waiting for a thread.
+      /// \return The maximum number of waiting requests. Zero if there is
+      /// no limit.
+      public: unsigned int MaxQueue() const
+      {
+        return this->maxQueue;
+      }
+
+      /// \brief Set the maximum number of requests from other processes
+      /// waiting for a thread, see AdvertiseServiceOptions::SetMaxQueue().
+      /// \param[in] _maxQueue The maximum number of waiting requests. Zero
+      /// for no limit.
+      public: void SetMaxQueue(const unsigned int _maxQueue)
+      {
+        this->maxQueue = _maxQueue;
+      }
+
+      /// \brief Reserve a place for a request from another process, running
+      /// or waiting for a thread. Release() must be called once the request
+      /// ran or was discarded.
+      /// \return False if every thread is busy and the queue is full, the
+      /// request must be rejected then.
+      public: bool Admit()
+      {
+        if (this->maxConcurrency == 0 || this->maxQueue == 0)
+        {
+          this->admitted.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+
+        const unsigned int limit = this->maxConcurrency + this->maxQueue;
+        unsigned int current = this->admitted.load(std::memory_order_relaxed);
+        do
+        {
+          if (current >= limit)
+            return false;
+        }
+        while (!this->admitted.compare_exchange_weak(current, current + 1,
+          std::memory_order_relaxed));
+        return true;
+      }
+
+      /// \brief Release the place of a request reserved by Admit().
+      public: void Release()
+      {
+        this->admitted.fetch_sub(1, std::memory_order_relaxed);
+      }
+
+      /// \brief Get how long the responses are reused.
+      /// \return The time to live of the responses in milliseconds. Zero if
+      /// every request runs the callback.
+      public: unsigned int ResponseCacheTtl() const
+      {
+        return this->responseCacheTtl;
+      }
+
+      /// \brief Set how long the responses are reused, see
+      /// AdvertiseServiceOptions::SetResponseCacheTtl().
+      /// \param[in] _ttl Time to live of the responses in milliseconds.
+      public: void SetResponseCacheTtl(const unsigned int _ttl)
+      {
+        this->responseCacheTtl = _ttl;
+      }
+
+      /// \brief Executes the callback, unless an identical request is
+      /// running or ran within the time to live of the responses. The
+      /// response of that request is used then.
+      /// \param[in] _req Serialized request.
+      /// \param[out] _rep Serialized response.
+      /// \return Service call result.
+      public: bool RunCachedCallback(const std::string &_req,
+                                     std::string &_rep)
+      {
+        if (this->responseCacheTtl == 0)
+          return this->RunCallback(_req, _rep);
+
+        std::shared_ptr<CachedResponse> entry;
+        {
+          std::unique_lock<std::mutex> lk(this->cacheMutex);
+          const auto now = std::chrono::steady_clock::now();
+          auto it = this->cache.find(_req);
+          if (it != this->cache.end() &&
+              (!it->second->done || now < it->second->expiry))
+          {
+            // Wait for the identical request running, if any.
+            entry = it->second;
+            this->cacheDone.wait(lk, [&entry]() {return entry->done;});
+            _rep = entry->rep;
+            return entry->result;
+          }
+
+          if (this->cache.size() >= kMaxCachedResponses)
+          {
+            for (it = this->cache.begin(); it != this->cache.end();)
+            {
+              if (it->second->done && now >= it->second->expiry)
+                it = this->cache.erase(it);
+              else
+                ++it;
+            }
+          }
+
+          // Too many different requests, don't keep this one.
+          if (this->cache.size() >= kMaxCachedResponses)
+          {
+            lk.unlock();
+            return this->RunCallback(_req, _rep);
+          }
+
+          entry = std::make_shared<CachedResponse>();
+          this->cache[_req] = entry;
+        }
+
+        const bool result = this->RunCallback(_req, _rep);
+
+        std::lock_guard<std::mutex> lk(this->cacheMutex);
+        entry->rep = _rep;
+        entry->result = result;
+        entry->done = true;
+        entry->expiry = std::chrono::steady_clock::now() +
+          std::chrono::milliseconds(this->responseCacheTtl);
+
+        // Only the successful responses are reused later.
+        if (!result)
+          this->cache.erase(_req);
+        this->cacheDone.notify_all();
+        return result;
+      }
+
+      /// \brief Executes the local callback, through the cached responses
+      /// if there is a time to live. The messages are serialized then.
+      /// \param[in] _msgReq Request.
+      /// \param[out] _msgRep Response.
+      /// \return Service call result.
+      public: bool RunLocalCachedCallback(const transport::ProtoMsg &_msgReq,
+                                          transport::ProtoMsg &_msgRep)
+      {
+        if (this->responseCacheTtl == 0)
+          return this->RunLocalCallback(_msgReq, _msgRep);
+
+        std::string req;
+        std::string rep;
+        if (!_msgReq.SerializeToString(&req))
+        {
+          std::cerr << "IRepHandler::RunLocalCachedCallback(): Error "
+                    << "serializing the request" << std::endl;
+          return false;
+        }
+
+        if (!this->RunCachedCallback(req, rep))
+          return false;
+
+        if (!_msgRep.ParseFromString(rep))
+        {
+          std::cerr << "IRepHandler::RunLocalCachedCallback(): Error parsing "
+                    << "the response" << std::endl;
+          return false;
+        }
+
+        return true;
+      }
+
       /// \brief Get the message type name used in the service request.
       /// \return Message type name.
       public: virtual std::string ReqTypeName() const = 0;
@@ -91,6 +309,17 @@ namespace ignition
       /// \return Message type name.
       public: virtual std::string RepTypeName() const = 0;
 
+      /// \brief Check the message types used by the service.
+      /// \param[in] _reqTypeName Message type name of the request.
+      /// \param[in] _repTypeName Message type name of the response.
+      /// \return True if the service uses those types.
+      public: virtual bool HasTypes(const std::string &_reqTypeName,
+                                    const std::string &_repTypeName) const
+      {
+        return _reqTypeName == this->ReqTypeName() &&
+               _repTypeName == this->RepTypeName();
+      }
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::string
@@ -101,6 +330,56 @@ namespace ignition
       protected: std::string hUuid;
 #ifdef _WIN32
 #pragma warning(pop)
+#endif
+
+      /// \brief Maximum number of concurrent requests.
+      private: unsigned int maxConcurrency = 0;
+
+      /// \brief Maximum number of requests waiting for a thread.
+      private: unsigned int maxQueue = 0;
+
+      /// \brief Requests running or waiting for a thread.
+      private: std::atomic<unsigned int> admitted{0};
+
+      /// \brief Time to live of the responses in milliseconds.
+      private: unsigned int responseCacheTtl = 0;
+
+      /// \brief Response of a request, shared by the identical requests.
+      private: struct CachedResponse
+      {
+        /// \brief Whether the callback returned.
+        bool done = false;
+
+        /// \brief Service call result.
+        bool result = false;
+
+        /// \brief Serialized response.
+        std::string rep;
+
+        /// \brief Time after which the response isn't reused.
+        std::chrono::steady_clock::time_point expiry;
+      };
+
+      /// \brief Maximum number of different requests cached.
+      private: static constexpr std::size_t kMaxCachedResponses = 1024;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Protects the cached responses.
+      private: std::mutex cacheMutex;
+
+      /// \brief Notified when a cached request completes.
+      private: std::condition_variable cacheDone;
+
+      /// \brief Responses by serialized request.
+      private: std::unordered_map<std::string,
+        std::shared_ptr<CachedResponse>> cache;
+#ifdef _WIN32
+#pragma warning(pop)
 #endif
     };
 
@@ -188,13 +467,21 @@ namespace ignition
       // Documentation inherited.
       public: virtual std::string ReqTypeName() const
       {
-        return Req().GetTypeName();
+        return MessageTypeName<Req>();
       }
 
       // Documentation inherited.
       public: virtual std::string RepTypeName() const
       {
-        return Rep().GetTypeName();
+        return MessageTypeName<Rep>();
+      }
+
+      // Documentation inherited.
+      public: virtual bool HasTypes(const std::string &_reqTypeName,
+                                    const std::string &_repTypeName) const
+      {
+        return _reqTypeName == MessageTypeName<Req>() &&
+               _repTypeName == MessageTypeName<Rep>();
       }
 
       /// \brief Create a specific protobuf message given its serialized data.
@@ -218,6 +505,236 @@ namespace ignition
       /// \brief Callback to the function registered for this handler.
       private: std::function<bool(const Req &, Rep &)> cb;
     };
+
+    /// \class StreamRepHandler RepHandler.hh
+    /// \brief Replier handler of a streaming service. 'Req' is the protobuf
+    /// message type of the request and 'Chunk' the protobuf message type of
+    /// each piece of the response. The callback writes the chunks as they
+    /// are produced, so the whole response never has to be in memory.
+    template <typename Req, typename Chunk> class StreamRepHandler
+      : public IRepHandler
+    {
+      /// \brief Function that writes a chunk of the response. It returns
+      /// false if the chunk couldn't be sent.
+      public: using Writer = std::function<bool(const Chunk &)>;
+
+      // Documentation inherited.
+      public: StreamRepHandler() = default;
+
+      /// \brief Set the callback for this handler.
+      /// \param[in] _cb The callback with the following parameters:
+      /// \param[in] _req Protobuf message containing the service request.
+      /// \param[in] _write Function writing each chunk of the response.
+      /// \return True when the service response is considered successful.
+      public: void SetCallback(
+        const std::function<bool(const Req &, const Writer &)> &_cb)
+      {
+        this->cb = _cb;
+      }
+
+      // Documentation inherited.
+      public: bool RunLocalCallback(const transport::ProtoMsg &/*_msgReq*/,
+                                    transport::ProtoMsg &/*_msgRep*/)
+      {
+        std::cerr << "StreamRepHandler::RunLocalCallback() error: "
+                  << "Use Node::RequestStream() for streaming services"
+                  << std::endl;
+        return false;
+      }
+
+      // Documentation inherited.
+      public: bool RunCallback(const std::string &_req, std::string &/*_rep*/)
+      {
+        // A regular request receives the chunks as separate responses and
+        // ignores them, only the result is meaningful.
+        return this->RunStreamCallback(_req,
+          [](const std::string &) {return true;});
+      }
+
+      // Documentation inherited.
+      public: virtual bool Streaming() const
+      {
+        return true;
+      }
+
+      // Documentation inherited.
+      public: virtual bool RunStreamCallback(const std::string &_req,
+        const std::function<bool(const std::string &)> &_write)
+      {
+        if (!this->cb)
+        {
+          std::cerr << "StreamRepHandler::RunStreamCallback() error: "
+                    << "Callback is NULL" << std::endl;
+          return false;
+        }
+
+        Req msgReq;
+        if (!msgReq.ParseFromString(_req))
+        {
+          std::cerr << "StreamRepHandler::RunStreamCallback() error: "
+                    << "ParseFromString failed" << std::endl;
+          return false;
+        }
+
+        std::string buffer;
+        return this->cb(msgReq, [&_write, &buffer](const Chunk &_chunk)
+        {
+          buffer.clear();
+          if (!_chunk.SerializeToString(&buffer))
+          {
+            std::cerr << "StreamRepHandler: Error serializing a chunk"
+                      << std::endl;
+            return false;
+          }
+          return _write(buffer);
+        });
+      }
+
+      // Documentation inherited.
+      public: virtual bool RunLocalStreamCallback(
+        const transport::ProtoMsg &_msgReq,
+        const std::function<bool(const transport::ProtoMsg &)> &_write)
+      {
+        if (!this->cb)
+        {
+          std::cerr << "StreamRepHandler::RunLocalStreamCallback() error: "
+                    << "Callback is NULL" << std::endl;
+          return false;
+        }
+
+#if GOOGLE_PROTOBUF_VERSION > 2999999
+        auto msgReq = google::protobuf::down_cast<const Req*>(&_msgReq);
+#else
+        auto msgReq =
+          google::protobuf::internal::down_cast<const Req*>(&_msgReq);
+#endif
+
+        return this->cb(*msgReq, [&_write](const Chunk &_chunk)
+        {
+          return _write(_chunk);
+        });
+      }
+
+      // Documentation inherited.
+      public: virtual std::string ReqTypeName() const
+      {
+        return MessageTypeName<Req>();
+      }
+
+      // Documentation inherited.
+      public: virtual std::string RepTypeName() const
+      {
+        return MessageTypeName<Chunk>();
+      }
+
+      // Documentation inherited.
+      public: virtual bool HasTypes(const std::string &_reqTypeName,
+                                    const std::string &_repTypeName) const
+      {
+        return _reqTypeName == MessageTypeName<Req>() &&
+               _repTypeName == MessageTypeName<Chunk>();
+      }
+
+      /// \brief Callback to the function registered for this handler.
+      private: std::function<bool(const Req &, const Writer &)> cb;
+    };
+
+    /// \class RawRepHandler RepHandler.hh
+    /// \brief Replier handler of a service advertised with
+    /// Node::AdvertiseRaw(). The callback receives the serialized request and
+    /// writes the serialized response, so the messages are never parsed.
+    class IGNITION_TRANSPORT_VISIBLE RawRepHandler
+      : public IRepHandler
+    {
+      /// \brief Constructor.
+      /// \param[in] _reqType Message type name of the request.
+      /// \param[in] _repType Message type name of the response.
+      public: RawRepHandler(const std::string &_reqType,
+                            const std::string &_repType)
+        : reqType(_reqType),
+          repType(_repType)
+      {
+      }
+
+      /// \brief Set the callback for this handler.
+      /// \param[in] _cb The callback with the following parameters:
+      /// \param[in] _req Serialized request.
+      /// \param[out] _rep Serialized response.
+      /// \return True when the service response is considered successful.
+      public: void SetCallback(const RawRepCallback &_cb)
+      {
+        this->cb = _cb;
+      }
+
+      // Documentation inherited.
+      public: bool RunLocalCallback(const transport::ProtoMsg &_msgReq,
+                                    transport::ProtoMsg &_msgRep)
+      {
+        std::string req;
+        if (!_msgReq.SerializeToString(&req))
+        {
+          std::cerr << "RawRepHandler::RunLocalCallback(): Error serializing "
+                    << "the request" << std::endl;
+          return false;
+        }
+
+        std::string rep;
+        if (!this->RunCallback(req, rep))
+          return false;
+
+        if (!_msgRep.ParseFromString(rep))
+        {
+          std::cerr << "RawRepHandler::RunLocalCallback(): Error parsing the "
+                    << "response" << std::endl;
+          return false;
+        }
+
+        return true;
+      }
+
+      // Documentation inherited.
+      public: bool RunCallback(const std::string &_req, std::string &_rep)
+      {
+        if (!this->cb)
+        {
+          std::cerr << "RawRepHandler::RunCallback() error: "
+                    << "Callback is NULL" << std::endl;
+          return false;
+        }
+
+        return this->cb(_req, _rep);
+      }
+
+      // Documentation inherited.
+      public: virtual std::string ReqTypeName() const
+      {
+        return this->reqType;
+      }
+
+      // Documentation inherited.
+      public: virtual std::string RepTypeName() const
+      {
+        return this->repType;
+      }
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Message type name of the request.
+      private: std::string reqType;
+
+      /// \brief Message type name of the response.
+      private: std::string repType;
+
+      /// \brief Callback to the function registered for this handler.
+      private: RawRepCallback cb;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
     }
   }
 }
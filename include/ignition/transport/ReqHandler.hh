@@ -26,6 +26,7 @@
 #pragma warning(pop)
 #endif
 
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -50,8 +51,7 @@ namespace ignition
       /// \brief Constructor.
       /// \param[in] _nUuid UUID of the node registering the request handler.
       public: explicit IReqHandler(const std::string &_nUuid)
-        : rep(""),
-          hUuid(Uuid().ToString()),
+        : hUuid(CompactUuid::Sequential()),
           nUuid(_nUuid),
           result(false),
           requested(false),
@@ -71,9 +71,24 @@ namespace ignition
       public: virtual void NotifyResult(const std::string &_rep,
                                         const bool _result) = 0;
 
+      /// \brief Executes the callback registered for the chunks of a
+      /// streaming response. The final NotifyResult() follows the last
+      /// chunk. Handlers of regular requests ignore the chunks.
+      /// \param[in] _chunk Serialized chunk.
+      public: virtual void NotifyChunk(const std::string &/*_chunk*/)
+      {
+      }
+
       /// \brief Get the node UUID.
       /// \return The string representation of the node UUID.
       public: std::string NodeUuid() const
+      {
+        return this->nUuid.ToString();
+      }
+
+      /// \brief Get the node UUID without converting it to a string.
+      /// \return The node UUID.
+      public: const CompactUuid &NodeId() const
       {
         return this->nUuid;
       }
@@ -106,6 +121,25 @@ namespace ignition
         this->requested = _value;
       }
 
+      /// \brief Set the time after which the requester stops waiting for the
+      /// response. The deadline travels with the request, so the responser
+      /// can skip the request once it expired.
+      /// \param[in] _deadline The deadline.
+      public: void SetDeadline(
+        const std::chrono::steady_clock::time_point &_deadline)
+      {
+        this->deadline = _deadline;
+      }
+
+      /// \brief Get the time after which the requester stops waiting for the
+      /// response.
+      /// \return The deadline, time_point::max() if the requester waits
+      /// without a timeout.
+      public: std::chrono::steady_clock::time_point Deadline() const
+      {
+        return this->deadline;
+      }
+
       /// \brief Serialize the Req protobuf message stored.
       /// \param[out] _buffer The serialized data.
       /// \return True if the serialization succeed or false otherwise.
@@ -114,6 +148,13 @@ namespace ignition
       /// \brief Returns the unique handler UUID.
       /// \return The handler's UUID.
       public: std::string HandlerUuid() const
+      {
+        return this->hUuid.ToString();
+      }
+
+      /// \brief Get the handler UUID without converting it to a string.
+      /// \return The handler's UUID.
+      public: const CompactUuid &HandlerId() const
       {
         return this->hUuid;
       }
@@ -129,7 +170,7 @@ namespace ignition
                                                     const unsigned int _timeout)
       {
         auto now = std::chrono::steady_clock::now();
-        return this->condition.wait_until(_lock,
+        return this->Condition().wait_until(_lock,
           now + std::chrono::milliseconds(_timeout),
           [this]
           {
@@ -145,24 +186,53 @@ namespace ignition
       /// \return Message type name.
       public: virtual std::string RepTypeName() const = 0;
 
+      /// \brief Check the message types used by the service call.
+      /// \param[in] _reqTypeName Message type name of the request.
+      /// \param[in] _repTypeName Message type name of the response.
+      /// \return True if the service call uses those types.
+      public: virtual bool HasTypes(const std::string &_reqTypeName,
+                                    const std::string &_repTypeName) const
+      {
+        return _reqTypeName == this->ReqTypeName() &&
+               _repTypeName == this->RepTypeName();
+      }
+
+      /// \brief Wake up the requester waiting on WaitUntil(), if any.
+      protected: void NotifyWaiter()
+      {
+        // Other handlers share the condition variable, their waiters check
+        // their own predicate and go back to sleep.
+        this->Condition().notify_all();
+      }
+
+      /// \brief Get the condition variable used to wait until the response
+      /// is available. Creating a condition variable per request allocates,
+      /// so the handlers share a fixed set of them, picked by handler UUID.
+      /// \return The condition variable of this handler.
+      private: std::condition_variable_any &Condition() const
+      {
+        static std::condition_variable_any conditions[kNumConditions];
+        return conditions[this->hUuid.Hash() % kNumConditions];
+      }
+
+      /// \brief Number of condition variables shared by the handlers.
+      private: static constexpr std::size_t kNumConditions = 16;
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::*
 #pragma warning(push)
 #pragma warning(disable: 4251)
 #endif
-      /// \brief Condition variable used to wait until a service call REP is
-      /// available.
-      protected: std::condition_variable_any condition;
-
       /// \brief Stores the service response as raw bytes.
       protected: std::string rep;
 
-      /// \brief Unique handler's UUID.
-      protected: std::string hUuid;
+      /// \brief Unique handler's UUID. It is unique within the process and
+      /// cheap to create.
+      protected: CompactUuid hUuid;
 
       /// \brief Node UUID.
-      private: std::string nUuid;
+      private: CompactUuid nUuid;
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
@@ -174,6 +244,10 @@ namespace ignition
       /// its way. Used to not resend the same REQ more than one time.
       private: bool requested;
 
+      /// \brief Time after which the requester stops waiting.
+      private: std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max();
+
       /// \brief When there is a blocking service call request, the call can
       /// be unlocked when a service call REP is available. This variable
       /// captures if we have found a node that can satisty our request.
@@ -277,19 +351,27 @@ namespace ignition
         }
 
         this->repAvailable = true;
-        this->condition.notify_one();
+        this->NotifyWaiter();
       }
 
       // Documentation inherited.
       public: virtual std::string ReqTypeName() const
       {
-        return Req().GetTypeName();
+        return MessageTypeName<Req>();
       }
 
       // Documentation inherited.
       public: virtual std::string RepTypeName() const
       {
-        return Rep().GetTypeName();
+        return MessageTypeName<Rep>();
+      }
+
+      // Documentation inherited.
+      public: virtual bool HasTypes(const std::string &_reqTypeName,
+                                    const std::string &_repTypeName) const
+      {
+        return _reqTypeName == MessageTypeName<Req>() &&
+               _repTypeName == MessageTypeName<Rep>();
       }
 
       /// \brief Protobuf message containing the request's parameters.
@@ -303,6 +385,212 @@ namespace ignition
       private: std::function<void(const Rep &_rep, const bool _result)> cb;
     };
 
+    /// \class StreamReqHandler ReqHandler.hh
+    /// \brief Request handler of a streaming service. 'Req' is the protobuf
+    /// message type of the request and 'Chunk' the protobuf message type of
+    /// each piece of the response. The chunks are delivered as they arrive.
+    /// A regular service answering the request delivers its reply as a
+    /// single chunk.
+    template <typename Req, typename Chunk> class StreamReqHandler
+      : public IReqHandler
+    {
+      // Documentation inherited.
+      public: explicit StreamReqHandler(const std::string &_nUuid)
+        : IReqHandler(_nUuid)
+      {
+      }
+
+      /// \brief Set the callbacks for this handler.
+      /// \param[in] _chunkCb Callback executed for each chunk.
+      /// \param[in] _doneCb Callback executed after the last chunk with the
+      /// result of the service call.
+      public: void SetCallbacks(
+        const std::function<void(const Chunk &_chunk)> &_chunkCb,
+        const std::function<void(const bool _result)> &_doneCb)
+      {
+        this->chunkCb = _chunkCb;
+        this->doneCb = _doneCb;
+      }
+
+      /// \brief Set the REQ protobuf message for this handler.
+      /// \param[in] _reqMsg Protobuf message containing the input parameters
+      /// of the service request.
+      public: void SetMessage(const Req *_reqMsg)
+      {
+        if (!_reqMsg)
+        {
+          std::cerr << "StreamReqHandler::SetMessage() _reqMsg is null"
+                    << std::endl;
+          return;
+        }
+
+        this->reqMsg.CopyFrom(*_reqMsg);
+      }
+
+      // Documentation inherited
+      public: bool Serialize(std::string &_buffer) const
+      {
+        if (!this->reqMsg.SerializeToString(&_buffer))
+        {
+          std::cerr << "StreamReqHandler::Serialize(): Error serializing the "
+                    << "request" << std::endl;
+          return false;
+        }
+
+        return true;
+      }
+
+      // Documentation inherited.
+      public: void NotifyChunk(const std::string &_chunk)
+      {
+        if (!this->chunkCb)
+          return;
+
+        Chunk msg;
+        if (!msg.ParseFromString(_chunk))
+        {
+          std::cerr << "StreamReqHandler::NotifyChunk() error: "
+                    << "ParseFromString failed" << std::endl;
+          return;
+        }
+
+        this->chunkCb(msg);
+      }
+
+      // Documentation inherited.
+      public: void NotifyResult(const std::string &_rep, const bool _result)
+      {
+        // The reply of a regular service is its only chunk.
+        if (_result && !_rep.empty())
+          this->NotifyChunk(_rep);
+
+        if (this->doneCb)
+          this->doneCb(_result);
+
+        this->result = _result;
+        this->repAvailable = true;
+        this->NotifyWaiter();
+      }
+
+      // Documentation inherited.
+      public: virtual std::string ReqTypeName() const
+      {
+        return MessageTypeName<Req>();
+      }
+
+      // Documentation inherited.
+      public: virtual std::string RepTypeName() const
+      {
+        return MessageTypeName<Chunk>();
+      }
+
+      // Documentation inherited.
+      public: virtual bool HasTypes(const std::string &_reqTypeName,
+                                    const std::string &_repTypeName) const
+      {
+        return _reqTypeName == MessageTypeName<Req>() &&
+               _repTypeName == MessageTypeName<Chunk>();
+      }
+
+      /// \brief Protobuf message containing the request's parameters.
+      private: Req reqMsg;
+
+      /// \brief Callback executed for each chunk.
+      private: std::function<void(const Chunk &_chunk)> chunkCb;
+
+      /// \brief Callback executed at the end of the stream.
+      private: std::function<void(const bool _result)> doneCb;
+    };
+
+    /// \class RawReqHandler ReqHandler.hh
+    /// \brief Request handler of a service call made with Node::RequestRaw().
+    /// The request is already serialized and the response is delivered as
+    /// is, so the messages are never parsed.
+    class IGNITION_TRANSPORT_VISIBLE RawReqHandler
+      : public IReqHandler
+    {
+      /// \brief Constructor.
+      /// \param[in] _nUuid UUID of the node registering the request handler.
+      /// \param[in] _req Serialized request.
+      /// \param[in] _reqType Message type name of the request.
+      /// \param[in] _repType Message type name of the response.
+      public: RawReqHandler(const std::string &_nUuid,
+                            const std::string &_req,
+                            const std::string &_reqType,
+                            const std::string &_repType)
+        : IReqHandler(_nUuid),
+          req(_req),
+          reqType(_reqType),
+          repType(_repType)
+      {
+      }
+
+      /// \brief Set the callback for this handler. Without a callback, the
+      /// response is stored for a blocking requester.
+      /// \param[in] _cb The callback with the following parameters:
+      /// \param[in] _rep Serialized response.
+      /// \param[in] _result True when the service request was successful.
+      public: void SetCallback(const RawReqCallback &_cb)
+      {
+        this->cb = _cb;
+      }
+
+      // Documentation inherited.
+      public: bool Serialize(std::string &_buffer) const
+      {
+        _buffer = this->req;
+        return true;
+      }
+
+      // Documentation inherited.
+      public: void NotifyResult(const std::string &_rep, const bool _result)
+      {
+        if (this->cb)
+          this->cb(_rep, _result);
+        else
+        {
+          this->rep = _rep;
+          this->result = _result;
+        }
+
+        this->repAvailable = true;
+        this->NotifyWaiter();
+      }
+
+      // Documentation inherited.
+      public: virtual std::string ReqTypeName() const
+      {
+        return this->reqType;
+      }
+
+      // Documentation inherited.
+      public: virtual std::string RepTypeName() const
+      {
+        return this->repType;
+      }
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Serialized request.
+      private: std::string req;
+
+      /// \brief Message type name of the request.
+      private: std::string reqType;
+
+      /// \brief Message type name of the response.
+      private: std::string repType;
+
+      /// \brief Callback executed with the response.
+      private: RawReqCallback cb;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+
     /// \class ReqHandler<google::protobuf::Message> ReqHandler.hh
     /// \brief Template specialization for google::protobuf::Message.
     /// This is only used by some ign command line tools.
@@ -373,7 +661,7 @@ namespace ignition
         this->result = _result;
 
         this->repAvailable = true;
-        this->condition.notify_one();
+        this->NotifyWaiter();
       }
 
       // Documentation inherited.
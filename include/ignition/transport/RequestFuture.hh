@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_REQUESTFUTURE_HH_
+#define IGN_TRANSPORT_REQUESTFUTURE_HH_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define IGN_TRANSPORT_HAS_COROUTINES 1
+#endif
+#endif
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class RequestResult RequestFuture.hh
+    /// ignition/transport/RequestFuture.hh
+    /// \brief Outcome of a service request made with Node::RequestAsync().
+    template<typename ReplyT>
+    class RequestResult
+    {
+      /// \brief True when the request was executed by a responser. False if
+      /// the request couldn't be sent.
+      public: bool executed = false;
+
+      /// \brief Result of the service call. Only meaningful when executed is
+      /// true.
+      public: bool result = false;
+
+      /// \brief Response of the service call. Only meaningful when result is
+      /// true.
+      public: ReplyT reply;
+    };
+
+    /// \class RequestFuture RequestFuture.hh
+    /// ignition/transport/RequestFuture.hh
+    /// \brief Handle to the response of a service request made with
+    /// Node::RequestAsync(). Waiting on the handle doesn't need a thread per
+    /// request: the response completes the handle from the thread that
+    /// receives it, which then runs the continuation registered with Then()
+    /// or resumes the coroutine awaiting the handle, if any.
+    ///
+    /// Copies of a handle share the same response.
+    template<typename ReplyT>
+    class RequestFuture
+    {
+      /// \brief State shared between the handles and the request handler.
+      public: class State
+      {
+        /// \brief Complete the request and run the continuation, if any.
+        /// Only the first call has effect.
+        /// \param[in] _executed True if the request was executed.
+        /// \param[in] _reply Response of the service call, or nullptr.
+        /// \param[in] _result Result of the service call.
+        public: void Complete(const bool _executed, const ReplyT *_reply,
+                              const bool _result)
+        {
+          std::function<void(const RequestResult<ReplyT> &)> then;
+          {
+            std::lock_guard<std::mutex> lk(this->mutex);
+            if (this->ready)
+              return;
+
+            this->value.executed = _executed;
+            this->value.result = _executed && _result;
+            if (_reply)
+              this->value.reply = *_reply;
+            this->ready = true;
+            then = std::move(this->then);
+          }
+          this->condition.notify_all();
+
+          // The continuation runs without the mutex, it might make other
+          // requests or destroy the last handle.
+          if (then)
+            then(this->value);
+        }
+
+        /// \brief Mutex protecting the members below.
+        public: std::mutex mutex;
+
+        /// \brief Notified when the request completes.
+        public: std::condition_variable condition;
+
+        /// \brief True when the request completed. value never changes
+        /// after that.
+        public: bool ready = false;
+
+        /// \brief Outcome of the request.
+        public: RequestResult<ReplyT> value;
+
+        /// \brief Continuation executed when the request completes.
+        public: std::function<void(const RequestResult<ReplyT> &)> then;
+      };
+
+      /// \brief Default constructor. The handle is not valid.
+      public: RequestFuture() = default;
+
+      /// \brief Constructor.
+      /// \param[in] _state State shared with the request handler.
+      public: explicit RequestFuture(std::shared_ptr<State> _state)
+        : state(std::move(_state))
+      {
+      }
+
+      /// \brief Whether this handle refers to a request.
+      /// \return True if the handle was returned by Node::RequestAsync().
+      public: bool Valid() const
+      {
+        return this->state != nullptr;
+      }
+
+      /// \brief Whether the request completed.
+      /// \return True if the request completed, so Get() won't block.
+      public: bool Ready() const
+      {
+        if (!this->state)
+          return false;
+
+        std::lock_guard<std::mutex> lk(this->state->mutex);
+        return this->state->ready;
+      }
+
+      /// \brief Block until the request completes or the timeout expires.
+      /// \param[in] _timeout Maximum waiting time in milliseconds.
+      /// \return True if the request completed.
+      public: bool WaitFor(const unsigned int _timeout) const
+      {
+        if (!this->state)
+          return false;
+
+        std::unique_lock<std::mutex> lk(this->state->mutex);
+        return this->state->condition.wait_for(lk,
+          std::chrono::milliseconds(_timeout),
+          [this]
+          {
+            return this->state->ready;
+          });
+      }
+
+      /// \brief Block until the request completes and get its outcome.
+      /// There is no timeout, use WaitFor() first if the responser might
+      /// never answer.
+      /// \return The outcome of the request. Not executed if the handle is
+      /// not valid.
+      public: RequestResult<ReplyT> Get() const
+      {
+        if (!this->state)
+          return RequestResult<ReplyT>();
+
+        std::unique_lock<std::mutex> lk(this->state->mutex);
+        this->state->condition.wait(lk,
+          [this]
+          {
+            return this->state->ready;
+          });
+        return this->state->value;
+      }
+
+      /// \brief Register a function executed when the request completes. It
+      /// runs on the thread that receives the response, or immediately on
+      /// the calling thread if the request already completed. Only one
+      /// continuation can be registered, a new one replaces the previous.
+      /// \param[in] _cb Continuation.
+      /// \return False if the handle is not valid.
+      public: bool Then(
+        const std::function<void(const RequestResult<ReplyT> &)> &_cb) const
+      {
+        if (!this->state || !_cb)
+          return false;
+
+        {
+          std::lock_guard<std::mutex> lk(this->state->mutex);
+          if (!this->state->ready)
+          {
+            this->state->then = _cb;
+            return true;
+          }
+        }
+
+        _cb(this->state->value);
+        return true;
+      }
+
+#ifdef IGN_TRANSPORT_HAS_COROUTINES
+      /// \brief Awaiter used by co_await. The coroutine is suspended until
+      /// the request completes and it's resumed on the thread that receives
+      /// the response.
+      public: class Awaiter
+      {
+        /// \brief Constructor.
+        /// \param[in] _state State of the awaited request.
+        public: explicit Awaiter(std::shared_ptr<State> _state)
+          : state(std::move(_state))
+        {
+        }
+
+        /// \brief Don't suspend if the request already completed.
+        /// \return True if the request completed or the handle is invalid.
+        public: bool await_ready() const
+        {
+          if (!this->state)
+            return true;
+
+          std::lock_guard<std::mutex> lk(this->state->mutex);
+          return this->state->ready;
+        }
+
+        /// \brief Resume the coroutine when the request completes.
+        /// \param[in] _handle Awaiting coroutine.
+        /// \return False if the request completed in the meantime, so the
+        /// coroutine continues without suspending.
+        public: bool await_suspend(std::coroutine_handle<> _handle)
+        {
+          std::lock_guard<std::mutex> lk(this->state->mutex);
+          if (this->state->ready)
+            return false;
+
+          this->state->then = [_handle](const RequestResult<ReplyT> &)
+          {
+            _handle.resume();
+          };
+          return true;
+        }
+
+        /// \brief Get the outcome of the request.
+        /// \return The outcome. Not executed if the handle is invalid.
+        public: RequestResult<ReplyT> await_resume() const
+        {
+          if (!this->state)
+            return RequestResult<ReplyT>();
+
+          std::lock_guard<std::mutex> lk(this->state->mutex);
+          return this->state->value;
+        }
+
+        /// \brief State of the awaited request.
+        private: std::shared_ptr<State> state;
+      };
+
+      /// \brief Await the outcome of the request from a coroutine.
+      /// \return The awaiter.
+      public: Awaiter operator co_await() const
+      {
+        return Awaiter(this->state);
+      }
+#endif
+
+      /// \brief State shared with the request handler.
+      private: std::shared_ptr<State> state;
+    };
+    }
+  }
+}
+
+#endif
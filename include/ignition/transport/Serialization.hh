@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_SERIALIZATION_HH_
+#define IGN_TRANSPORT_SERIALIZATION_HH_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/TransportTypes.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class Serializer Serialization.hh
+    /// ignition/transport/Serialization.hh
+    /// \brief How messages of type T are written to and read from the wire.
+    /// Node::Advertise<T>(), Node::Publisher::Publish() and
+    /// Node::Subscribe<T>() accept any type with a serializer. Protobuf
+    /// messages have one, other types can specialize this template with
+    /// the following static members:
+    ///
+    ///     // Name of the type, carried by the discovery.
+    ///     static std::string TypeName();
+    ///     // Number of bytes of the serialized message.
+    ///     static std::size_t ByteSize(const T &_msg);
+    ///     // Write the message in a buffer of ByteSize() bytes.
+    ///     static bool Serialize(const T &_msg, char *_buffer,
+    ///                           std::size_t _size);
+    ///     // Read the message from the data received. The data are only
+    ///     // valid during the callback, so types that are views of their
+    ///     // data, e.g. FlatBuffers tables, may point into it.
+    ///     static bool Deserialize(const char *_data, std::size_t _size,
+    ///                             T &_msg);
+    ///     // Optional. True if the messages are only meaningful on the host
+    ///     // that published them, see HostLocalMessage.
+    ///     static constexpr bool kHostLocal = true;
+    ///
+    /// Trivially copyable types are best handled with
+    /// IGN_TRANSPORT_TRIVIAL_MESSAGE, which copies their bytes as is.
+    template<typename T, typename Enable = void>
+    struct Serializer
+    {
+      /// \brief False, since the type has no serializer.
+      static constexpr bool kSupported = false;
+    };
+
+    /// \brief Serializer of the protobuf messages.
+    template<typename T>
+    struct Serializer<T,
+      typename std::enable_if<std::is_base_of<ProtoMsg, T>::value>::type>
+    {
+      /// \brief True, since the type has a serializer.
+      static constexpr bool kSupported = true;
+
+      /// \brief Get the name of the message type.
+      /// \return The protobuf name of the type.
+      static std::string TypeName()
+      {
+        return T().GetTypeName();
+      }
+
+      /// \brief Get the size of a serialized message.
+      /// \param[in] _msg The message.
+      /// \return The number of bytes of the serialized message.
+      static std::size_t ByteSize(const T &_msg)
+      {
+        return _msg.ByteSizeLong();
+      }
+
+      /// \brief Serialize a message.
+      /// \param[in] _msg The message.
+      /// \param[out] _buffer Buffer of ByteSize() bytes.
+      /// \param[in] _size Size of the buffer.
+      /// \return True on success.
+      static bool Serialize(const T &_msg, char *_buffer,
+                            const std::size_t _size)
+      {
+        return _msg.SerializeToArray(_buffer, static_cast<int>(_size));
+      }
+
+      /// \brief Deserialize a message.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message.
+      /// \param[out] _msg The message.
+      /// \return True on success.
+      static bool Deserialize(const char *_data, const std::size_t _size,
+                              T &_msg)
+      {
+        return _msg.ParseFromArray(_data, static_cast<int>(_size));
+      }
+    };
+
+    /// \brief Serializer of trivially copyable types, whose bytes are sent
+    /// as is. The publishers and the subscribers must agree on the layout
+    /// and the endianness of the type. Specialize Serializer with
+    /// IGN_TRANSPORT_TRIVIAL_MESSAGE to use it.
+    template<typename T>
+    struct TrivialSerializer
+    {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "The type must be trivially copyable");
+
+      /// \brief True, since the type has a serializer.
+      static constexpr bool kSupported = true;
+
+      /// \brief Get the size of a serialized message.
+      /// \return The size of the type.
+      static std::size_t ByteSize(const T &)
+      {
+        return sizeof(T);
+      }
+
+      /// \brief Copy the bytes of a message.
+      /// \param[in] _msg The message.
+      /// \param[out] _buffer Buffer of ByteSize() bytes.
+      /// \param[in] _size Size of the buffer.
+      /// \return True on success.
+      static bool Serialize(const T &_msg, char *_buffer,
+                            const std::size_t _size)
+      {
+        if (_size < sizeof(T))
+          return false;
+
+        std::memcpy(_buffer, &_msg, sizeof(T));
+        return true;
+      }
+
+      /// \brief Copy the bytes received into a message.
+      /// \param[in] _data The bytes received.
+      /// \param[in] _size Number of bytes received.
+      /// \param[out] _msg The message.
+      /// \return False if the size doesn't match the type.
+      static bool Deserialize(const char *_data, const std::size_t _size,
+                              T &_msg)
+      {
+        if (_size != sizeof(T))
+          return false;
+
+        std::memcpy(&_msg, _data, sizeof(T));
+        return true;
+      }
+    };
+
+    /// \brief Whether the messages of type T are only meaningful on the host
+    /// that published them, e.g. handles of device buffers or file
+    /// descriptors. Node::Advertise<T>() restricts the topics of these types
+    /// to the host unless they are restricted to the process already.
+    template<typename T, typename Enable = void>
+    struct HostLocalMessage : std::false_type
+    {
+    };
+
+    /// \brief Host local messages, whose serializer has a true kHostLocal
+    /// member.
+    template<typename T>
+    struct HostLocalMessage<T,
+      typename std::enable_if<Serializer<T>::kHostLocal>::type>
+      : std::true_type
+    {
+    };
+    }
+  }
+}
+
+/// \brief Give a trivially copyable type a serializer that sends its bytes
+/// as is. Use it in the global namespace.
+/// \param[in] _type The type.
+/// \param[in] _name Name of the type, carried by the discovery.
+#define IGN_TRANSPORT_TRIVIAL_MESSAGE(_type, _name) \
+  namespace ignition \
+  { \
+    namespace transport \
+    { \
+      template<> \
+      struct Serializer<_type> : public TrivialSerializer<_type> \
+      { \
+        static std::string TypeName() \
+        { \
+          return _name; \
+        } \
+      }; \
+    } \
+  }
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_SERVICESTATISTICS_HH_
+#define IGN_TRANSPORT_SERVICESTATISTICS_HH_
+
+#include <ignition/msgs/statistic.pb.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/Histogram.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    // Forward declarations.
+    class ServiceStatisticsPrivate;
+
+    /// \brief Encapsulates the statistics of the requests of a single
+    /// service exchanged with other processes. The set of statistics
+    /// include:
+    ///
+    /// 1. Requester side: Number of requests sent, number of requests
+    ///    waiting for a response, number of requests abandoned, and the
+    ///    latency between sending a request and receiving its response.
+    /// 2. Responder side: Number of requests received, number of requests
+    ///    queued or running, number of requests dropped because they were
+    ///    cancelled or expired, the time the requests waited for a worker
+    ///    and the execution time of the service callback.
+    ///
+    /// Durations are in microseconds.
+    class IGNITION_TRANSPORT_VISIBLE ServiceStatistics
+    {
+      /// \brief Default constructor.
+      public: ServiceStatistics();
+
+      /// \brief Copy constructor.
+      /// \param[in] _stats Statistics to copy.
+      public: ServiceStatistics(const ServiceStatistics &_stats);
+
+      /// \brief Default destructor.
+      public: ~ServiceStatistics();
+
+      /// \brief Count a request sent to a responder.
+      /// \param[in] _oneway True if no response is expected.
+      public: void RequestSent(bool _oneway);
+
+      /// \brief Count the response of a request sent.
+      /// \param[in] _latency Time between sending the request and receiving
+      /// the response.
+      public: void ResponseReceived(uint64_t _latency);
+
+      /// \brief Count a request sent whose requester stopped waiting for
+      /// a response.
+      public: void RequestAbandoned();
+
+      /// \brief Count a request sent that a busy responser rejected.
+      public: void BusyReceived();
+
+      /// \brief Count a request received from a requester.
+      public: void RequestReceived();
+
+      /// \brief Count a request received that starts running.
+      /// \param[in] _queueTime Time between receiving the request and
+      /// running its callback.
+      public: void RequestStarted(uint64_t _queueTime);
+
+      /// \brief Count a request received whose callback finished.
+      /// \param[in] _handlerTime Execution time of the callback.
+      public: void RequestFinished(uint64_t _handlerTime);
+
+      /// \brief Count a request received that is discarded before running
+      /// because it was cancelled or expired.
+      public: void RequestDropped();
+
+      /// \brief Count a request received that is rejected right away
+      /// because the queue of the service is full.
+      public: void RequestRejected();
+
+      /// \brief Populate an ignition::msgs::Metric message with service
+      /// statistics.
+      /// \param[in] _msg Message to populate.
+      public: void FillMessage(msgs::Metric &_msg) const;
+
+      /// \brief Get the number of requests sent.
+      /// \return Number of requests sent.
+      public: uint64_t SentCount() const;
+
+      /// \brief Get the number of requests sent waiting for a response.
+      /// \return Number of requests in flight.
+      public: uint64_t InFlightCount() const;
+
+      /// \brief Get the number of requests sent that were abandoned by
+      /// their requester, because of a timeout for instance.
+      /// \return Number of abandoned requests.
+      public: uint64_t AbandonedCount() const;
+
+      /// \brief Get the number of requests sent that were rejected by a
+      /// busy responser.
+      /// \return Number of busy responses.
+      public: uint64_t BusyCount() const;
+
+      /// \brief Get the latency of the responses received.
+      /// \return Histogram of the latencies.
+      public: const Histogram &Latency() const;
+
+      /// \brief Get the number of requests received.
+      /// \return Number of requests received.
+      public: uint64_t ReceivedCount() const;
+
+      /// \brief Get the number of requests received queued or running.
+      /// \return Number of requests being served.
+      public: uint64_t ServingCount() const;
+
+      /// \brief Get the number of requests received discarded before
+      /// running.
+      /// \return Number of dropped requests.
+      public: uint64_t DroppedCount() const;
+
+      /// \brief Get the number of requests received rejected because the
+      /// queue of the service was full.
+      /// \return Number of rejected requests.
+      public: uint64_t RejectedCount() const;
+
+      /// \brief Get the time the requests received waited before running.
+      /// \return Histogram of the queueing times.
+      public: const Histogram &QueueTime() const;
+
+      /// \brief Get the execution time of the service callback.
+      /// \return Histogram of the execution times.
+      public: const Histogram &HandlerTime() const;
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::unique_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Private data pointer.
+      private: std::unique_ptr<ServiceStatisticsPrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
@@ -18,14 +18,22 @@
 #ifndef IGN_TRANSPORT_SUBSCRIBEOPTIONS_HH_
 #define IGN_TRANSPORT_SUBSCRIBEOPTIONS_HH_
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <memory>
 
+#include "ignition/transport/AdvertiseOptions.hh"
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
 
 namespace ignition
 {
+  namespace msgs
+  {
+    class Header;
+  }
+
   namespace transport
   {
     // Inline bracket to help doxygen filtering.
@@ -58,6 +66,10 @@ namespace ignition
       /// topic. Note that we calculate the minimum period of a message based
       /// on the msgs/sec rate. Any message received since the last subscription
       /// callback and the duration of the period will be discarded.
+      ///
+      /// The rate is announced to the remote publishers of the topic. When all
+      /// the remote subscribers of a publisher are throttled, the publisher
+      /// skips the messages that none of them would accept.
       /// \param[in] _newMsgsPerSec Maximum number of messages per second.
       public: void SetMsgsPerSec(const uint64_t _newMsgsPerSec);
 
@@ -66,6 +78,202 @@ namespace ignition
       /// \return The maximum number of messages per second.
       public: uint64_t MsgsPerSec() const;
 
+      /// \brief Get the number of messages that a throttled subscription may
+      /// receive back to back.
+      /// \return The burst size.
+      /// \sa SetBurst
+      public: uint64_t Burst() const;
+
+      /// \brief Set the number of messages that a throttled subscription may
+      /// receive back to back. The throttling is a token bucket: it's
+      /// refilled at the rate set with SetMsgsPerSec() and holds up to
+      /// _burst messages, so bursty publishers are throttled evenly while
+      /// the average rate stays bounded. The default of one keeps a strict
+      /// minimum period between the callbacks. Only the rate is announced to
+      /// the remote publishers.
+      /// \param[in] _burst Maximum number of messages received back to
+      /// back. Zero is treated as one.
+      public: void SetBurst(const uint64_t _burst);
+
+      /// \brief Whether the throttling reads the coarse clock of the
+      /// system.
+      /// \return True if the coarse clock is used.
+      /// \sa SetCoarseClock
+      public: bool CoarseClock() const;
+
+      /// \brief Set whether the throttling reads the coarse clock of the
+      /// system instead of std::chrono::steady_clock. The coarse clock
+      /// only advances on the ticks of the kernel (a few milliseconds) but
+      /// is cheaper to read. The burst is raised to the number of messages
+      /// allowed during one tick. Only available on Linux, the steady clock
+      /// is used otherwise.
+      /// \param[in] _coarse True to use the coarse clock.
+      public: void SetCoarseClock(const bool _coarse);
+
+      /// \brief Whether the subscription only receives the latest message.
+      /// \return true when the subscription is conflated.
+      /// \sa SetConflated
+      public: bool Conflated() const;
+
+      /// \brief Set whether the subscription only receives the latest
+      /// message. The messages received from other processes are stored in a
+      /// single-slot mailbox and the callback runs from a separate thread.
+      /// If the callback is slower than the publisher, the stale messages are
+      /// replaced by the latest one instead of being queued. This suits
+      /// state topics, e.g. poses or joint states.
+      /// \param[in] _conflated True to enable conflation.
+      public: void SetConflated(const bool _conflated);
+
+      /// \brief Whether the callback of this subscription runs on its own
+      /// thread.
+      /// \return True if the subscription has a dedicated thread.
+      /// \sa SetDedicatedThread
+      public: bool DedicatedThread() const;
+
+      /// \brief Set whether the callback of this subscription runs on its
+      /// own thread, instead of the reception thread or the callback
+      /// threads of the node, for the messages received from other
+      /// processes. Useful to isolate a slow callback from the other
+      /// subscriptions.
+      /// \param[in] _dedicated True to use a dedicated thread.
+      /// \sa NodeOptions::SetCallbackThreads
+      public: void SetDedicatedThread(const bool _dedicated);
+
+      /// \brief Get the maximum number of messages waiting for the callback
+      /// of this subscription.
+      /// \return The queue size or zero if the subscription has no queue.
+      /// \sa SetQueueSize
+      public: uint64_t QueueSize() const;
+
+      /// \brief Give this subscription its own bounded queue of messages
+      /// received from other processes, between the reception thread and the
+      /// callback. The callback runs on a dedicated thread. When the callback
+      /// can't keep up and the queue is full, the queue policy applies and
+      /// the dropped messages are counted, see Node::SubscriptionDroppedMsgs
+      /// and TopicStatistics::QueueDroppedMsgCount. A slow subscription
+      /// doesn't delay the others unless QueuePolicy_t::BLOCK is used, which
+      /// stalls the reception thread until there is room in the queue.
+      /// \param[in] _size Maximum number of pending messages. Zero (the
+      /// default) disables the queue.
+      /// \sa SetQueuePolicy
+      public: void SetQueueSize(const uint64_t _size);
+
+      /// \brief Get the maximum number of bytes of the messages waiting for
+      /// the callback of this subscription.
+      /// \return The limit in bytes or zero if there is none.
+      /// \sa SetQueueBytes
+      public: uint64_t QueueBytes() const;
+
+      /// \brief Bound the queue of this subscription by the serialized size
+      /// of its pending messages instead of, or in addition to, their
+      /// number. Large messages, e.g. images or point clouds, fill the
+      /// queue with fewer messages, so its memory stays bounded whatever the
+      /// size of the messages. A message larger than the limit is still
+      /// queued when the queue is empty. The queue policy applies as for
+      /// SetQueueSize, and the callback runs on a dedicated thread.
+      /// \param[in] _bytes Maximum number of pending bytes. Zero (the
+      /// default) disables the limit.
+      /// \sa SetQueueSize
+      public: void SetQueueBytes(const uint64_t _bytes);
+
+      /// \brief Get what happens when the queue of this subscription is
+      /// full.
+      /// \return The queue policy.
+      /// \sa SetQueuePolicy
+      public: QueuePolicy_t QueuePolicy() const;
+
+      /// \brief Set what happens when the queue of this subscription is
+      /// full. The default is QueuePolicy_t::DROP_OLDEST.
+      /// \param[in] _policy The queue policy.
+      /// \sa SetQueueSize
+      public: void SetQueuePolicy(const QueuePolicy_t _policy);
+
+      /// \brief Whether the callback runs on the publisher's thread for
+      /// the messages published within the process.
+      /// \return True if the intra-process messages are delivered inline.
+      /// \sa SetInlineDelivery
+      public: bool InlineDelivery() const;
+
+      /// \brief Set whether the callback runs on the publisher's thread for
+      /// the messages published within the process. By default, these
+      /// messages are handed to a publish thread that runs the local
+      /// callbacks. With inline delivery, Publish() runs the callback before
+      /// returning, passing a reference to the published message. The
+      /// callback delays the publisher and may run concurrently from several
+      /// publishing threads. Messages received from other processes are not
+      /// affected.
+      /// \param[in] _inline True to deliver the intra-process messages
+      /// inline.
+      public: void SetInlineDelivery(const bool _inline);
+
+      /// \brief Whether the messages received by this subscription are
+      /// allocated on a protobuf arena.
+      /// \return True if the messages are allocated on an arena.
+      /// \sa SetArenaAllocation
+      public: bool ArenaAllocation() const;
+
+      /// \brief Set whether the messages received by this subscription are
+      /// parsed into a google::protobuf::Arena instead of the heap. The
+      /// arenas are recycled once all the references to their message are
+      /// released, so a nested message and its sub-messages cost no
+      /// allocation once the arenas grew to its size. Callbacks that share
+      /// the ownership of the message keep its arena alive. The message must
+      /// not be moved or swapped with a message of the heap. Messages
+      /// published within the process are not affected unless they're
+      /// received serialized.
+      /// \param[in] _arena True to allocate the messages on an arena.
+      public: void SetArenaAllocation(const bool _arena);
+
+      /// \brief Whether the callbacks of this subscription are timed.
+      /// \return True if the subscription is profiled.
+      /// \sa SetCallbackProfiling
+      public: bool CallbackProfiling() const;
+
+      /// \brief Set whether the execution time of the callbacks of this
+      /// subscription is measured, see Node::CallbackStats(). It costs two
+      /// reads of the steady clock per callback. The subscriptions with a
+      /// callback budget are always profiled, as are all the subscriptions
+      /// when the IGN_TRANSPORT_CALLBACK_BUDGET environment variable is set.
+      /// \param[in] _profiling True to time the callbacks.
+      /// \sa SetCallbackBudget
+      public: void SetCallbackProfiling(const bool _profiling);
+
+      /// \brief Get the longest expected execution time of the callbacks
+      /// of this subscription.
+      /// \return The budget, zero if none was set.
+      /// \sa SetCallbackBudget
+      public: std::chrono::microseconds CallbackBudget() const;
+
+      /// \brief Set the longest expected execution time of the callbacks of
+      /// this subscription. The callbacks are then profiled, and the ones
+      /// that take longer are counted by Node::CallbackStats() and by the
+      /// ign_transport_callbacks_over_budget metric of the topic, with a
+      /// warning at most once per second. A slow callback delays the other
+      /// subscriptions that share its thread. Without a budget, the one of
+      /// the IGN_TRANSPORT_CALLBACK_BUDGET environment variable applies.
+      /// \param[in] _budget The budget, zero for none.
+      public: void SetCallbackBudget(const std::chrono::microseconds &_budget);
+
+      /// \brief Get the filter of the headers of the messages received.
+      /// \return The filter, empty if none was set.
+      /// \sa SetHeaderFilter
+      public: const std::function<bool(const msgs::Header &)> &HeaderFilter()
+        const;
+
+      /// \brief Set a filter of the messages received, called with their
+      /// header before they're parsed. The messages it rejects are dropped,
+      /// so a subscriber that only processes some of the messages, e.g. the
+      /// ones stamped after a time, doesn't parse the others. Only the
+      /// header of a serialized message is parsed, see peekHeader(). The
+      /// messages without a header, i.e. whose first field isn't an
+      /// ignition.msgs.Header, are never filtered. The filter may be called
+      /// more than once per message and from several threads, so it should
+      /// only decide from the header.
+      /// \param[in] _filter Returns true to accept a message. Empty for no
+      /// filter.
+      public: void SetHeaderFilter(
+                const std::function<bool(const msgs::Header &)> &_filter);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
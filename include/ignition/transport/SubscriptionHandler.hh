@@ -21,6 +21,7 @@
 #ifdef _MSC_VER
 #pragma warning(push, 0)
 #endif
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
 #ifdef _MSC_VER
 #pragma warning(pop)
@@ -32,14 +33,22 @@
 #include <google/protobuf/stubs/casts.h>
 #endif
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <ignition/msgs/Factory.hh>
 
+#include "ignition/transport/CallbackStatistics.hh"
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
 #include "ignition/transport/MessageInfo.hh"
@@ -54,6 +63,11 @@ namespace ignition
     // Inline bracket to help doxygen filtering.
     inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
     //
+    // Forward declarations.
+    class ArenaPool;
+    class CallbackProfile;
+    class TokenBucket;
+
     /// \brief SubscriptionHandlerBase contains functions and data which are
     /// common to all SubscriptionHandler types.
     class IGNITION_TRANSPORT_VISIBLE SubscriptionHandlerBase
@@ -73,6 +87,11 @@ namespace ignition
       /// \return String representation of the message type.
       public: virtual std::string TypeName() = 0;
 
+      /// \brief Get the interned ID of TypeName(), so the publishers match
+      /// the handlers without comparing strings. It's computed on first use.
+      /// \return The ID of the message type.
+      public: uint32_t TypeId();
+
       /// \brief Get the node UUID.
       /// \return The string representation of the node UUID.
       public: std::string NodeUuid() const;
@@ -81,18 +100,156 @@ namespace ignition
       /// \return A string representation of the handler UUID.
       public: std::string HandlerUuid() const;
 
+      /// \brief Whether this handler only receives the latest message.
+      /// \return True if the subscription is conflated.
+      /// \sa SubscribeOptions::SetConflated
+      public: bool Conflated() const;
+
+      /// \brief Whether the callback of this handler runs on its own thread.
+      /// \return True if the subscription has a dedicated thread.
+      /// \sa SubscribeOptions::SetDedicatedThread
+      public: bool DedicatedThread() const;
+
+      /// \brief Maximum number of messages waiting for the callback.
+      /// \return The queue size or zero if the subscription has no queue.
+      /// \sa SubscribeOptions::SetQueueSize
+      public: uint64_t QueueSize() const;
+
+      /// \brief Maximum number of bytes waiting for the callback.
+      /// \return The limit in bytes or zero if there is none.
+      /// \sa SubscribeOptions::SetQueueBytes
+      public: uint64_t QueueBytes() const;
+
+      /// \brief What happens when the queue of this handler is full.
+      /// \return The queue policy.
+      /// \sa SubscribeOptions::SetQueuePolicy
+      public: QueuePolicy_t QueuePolicy() const;
+
+      /// \brief Whether the callback runs on the publisher's thread for the
+      /// intra-process messages.
+      /// \return True if the intra-process messages are delivered inline.
+      /// \sa SubscribeOptions::SetInlineDelivery
+      public: bool InlineDelivery() const;
+
+      /// \brief Whether the messages received by this handler are allocated
+      /// on a protobuf arena.
+      /// \return True if the messages are allocated on an arena.
+      /// \sa SubscribeOptions::SetArenaAllocation
+      public: bool ArenaAllocation() const;
+
+      /// \brief Whether the callback of this handler receives several
+      /// messages at once.
+      /// \return True if the subscription is batched.
+      /// \sa Node::SubscribeBatch
+      public: virtual bool Batched() const;
+
+      /// \brief Maximum number of messages per second accepted by this
+      /// handler.
+      /// \return The rate or kUnthrottled if the subscription is not
+      /// throttled.
+      /// \sa SubscribeOptions::SetMsgsPerSec
+      public: uint64_t MsgsPerSec() const;
+
+      /// \brief Check if message subscription is throttled. If so, verify
+      /// whether the next message would be accepted, without updating the
+      /// throttling state.
+      ///
+      /// This may be used to skip resource or time-intensive operations,
+      /// e.g. deserializing the message, when the callback won't run.
+      ///
+      /// \return true if the callback would be executed or false otherwise.
+      /// Additionally always returns true if the subscription is not
+      /// throttled.
+      public: bool ThrottledUpdateReady() const;
+
+      /// \brief Check a serialized message against the header filter of
+      /// the subscription, only parsing its header. Like
+      /// ThrottledUpdateReady(), this may be used to skip deserializing the
+      /// message when the callback won't run.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message.
+      /// \param[in] _type Type of the message.
+      /// \return False if the filter rejects the message. Always true if
+      /// the subscription has no filter, if the type has no header or if
+      /// the header can't be parsed.
+      /// \sa SubscribeOptions::SetHeaderFilter
+      public: bool HeaderAccepted(const char *_data, const std::size_t _size,
+                                  const std::string &_type) const;
+
+      /// \brief Get the execution time of the callbacks of this handler.
+      /// \return The statistics, without their topic, or std::nullopt if
+      /// the handler isn't profiled.
+      /// \sa SubscribeOptions::SetCallbackProfiling
+      public: std::optional<CallbackStatistics> CallbackStats() const;
+
       /// \brief Check if message subscription is throttled. If so, verify
       /// whether the callback should be executed or not.
       /// \return true if the callback should be executed or false otherwise.
       protected: bool UpdateThrottling();
 
+      /// \brief Check a message against the header filter of the
+      /// subscription.
+      /// \param[in] _msg The message.
+      /// \return False if the filter rejects the message, true otherwise.
+      /// \sa SubscribeOptions::SetHeaderFilter
+      protected: bool HeaderAccepted(const ProtoMsg &_msg) const;
+
+      /// \brief Measures a callback of a profiled handler, from its
+      /// construction to its destruction, so that a callback that throws is
+      /// measured too. Nothing is measured if the handler isn't profiled.
+      protected: class CallbackTimer
+      {
+        /// \brief Constructor. Starts measuring.
+        /// \param[in] _handler The handler running the callback.
+        /// \param[in] _info Information about the message.
+        public: CallbackTimer(SubscriptionHandlerBase &_handler,
+                              const MessageInfo &_info)
+          : handler(_handler), info(_info)
+        {
+          if (this->handler.profile)
+            this->start = std::chrono::steady_clock::now();
+        }
+
+        /// \brief Destructor. Records the duration of the callback.
+        public: ~CallbackTimer()
+        {
+          if (this->handler.profile)
+          {
+            this->handler.RecordCallback(
+              std::chrono::steady_clock::now() - this->start, this->info);
+          }
+        }
+
+        /// \brief The handler.
+        private: SubscriptionHandlerBase &handler;
+
+        /// \brief Information about the message.
+        private: const MessageInfo &info;
+
+        /// \brief Start of the callback.
+        private: std::chrono::steady_clock::time_point start;
+      };
+
+      /// \brief Record the duration of a callback, and warn if it's above
+      /// the budget of the handler. Only called if the handler is profiled.
+      /// \param[in] _duration Duration of the callback.
+      /// \param[in] _info Information about the message.
+      protected: void RecordCallback(
+                   const std::chrono::steady_clock::duration &_duration,
+                   const MessageInfo &_info);
+
+      /// \brief Get an empty arena of the pool of this handler. The arena
+      /// is reset and returned to the pool once the last reference to it is
+      /// released, which may happen on any thread.
+      /// \return The arena or nullptr if the handler doesn't allocate the
+      /// messages on an arena.
+      /// \sa ArenaAllocation
+      protected: std::shared_ptr<google::protobuf::Arena> RecycledArena()
+        const;
+
       /// \brief Subscribe options.
       protected: SubscribeOptions opts;
 
-      /// \brief If throttling is enabled, the minimum period for receiving a
-      /// message in nanoseconds.
-      protected: double periodNs;
-
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::*
@@ -102,11 +259,22 @@ namespace ignition
       /// \brief Unique handler's UUID.
       protected: std::string hUuid;
 
-      /// \brief Timestamp of the last callback executed.
-      protected: Timestamp lastCbTimestamp;
+      /// \brief Rate limiter of the callbacks, if throttling is enabled.
+      private: std::shared_ptr<TokenBucket> throttle;
+
+      /// \brief Arenas of the messages received, if they're allocated on
+      /// an arena.
+      private: std::shared_ptr<ArenaPool> arenas;
+
+      /// \brief Execution time of the callbacks, if they're profiled.
+      private: std::shared_ptr<CallbackProfile> profile;
 
       /// \brief Node UUID.
       private: std::string nUuid;
+
+      /// \brief Interned ID of the message type, 0 until TypeId() is first
+      /// called.
+      private: std::atomic<uint32_t> typeId{0};
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
@@ -141,6 +309,28 @@ namespace ignition
         const ProtoMsg &_msg,
         const MessageInfo &_info) = 0;
 
+      /// \brief Executes the local callback registered for this handler,
+      /// sharing the ownership of the message. Callbacks that accept a
+      /// std::shared_ptr keep a reference to _msg instead of copying it.
+      /// The default implementation calls RunLocalCallback(*_msg, _info).
+      /// \param[in] _msg Protobuf message received. It must not be modified
+      /// once passed to this function.
+      /// \param[in] _info Message information (e.g.: topic name).
+      /// \return True when success, false otherwise.
+      public: virtual bool RunLocalCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info);
+
+      /// \brief Executes the local callback registered for this handler with
+      /// several messages. The default implementation calls
+      /// RunLocalCallback() for each message.
+      /// \param[in] _msgs Protobuf messages received, oldest first.
+      /// \param[in] _infos Information of each message.
+      /// \return True when success, false otherwise.
+      public: virtual bool RunBatchCallback(
+        const std::vector<std::shared_ptr<const ProtoMsg>> &_msgs,
+        const std::vector<MessageInfo> &_infos);
+
       /// \brief Create a specific protobuf message given its serialized data.
       /// \param[in] _data The serialized data.
       /// \param[in] _type The data type.
@@ -148,6 +338,19 @@ namespace ignition
       public: virtual const std::shared_ptr<ProtoMsg> CreateMsg(
         const std::string &_data,
         const std::string &_type) const = 0;
+
+      /// \brief Create a specific protobuf message given a buffer with its
+      /// serialized data. The message is parsed in place, without copying
+      /// the buffer. The default implementation copies the buffer and calls
+      /// CreateMsg().
+      /// \param[in] _data The serialized data.
+      /// \param[in] _size Size of the serialized data.
+      /// \param[in] _type The data type.
+      /// \return Pointer to the specific protobuf message.
+      public: virtual const std::shared_ptr<ProtoMsg> ParseMsg(
+        const char *_data,
+        const std::size_t _size,
+        const std::string &_type) const;
     };
 
     /// \class SubscriptionHandler SubscriptionHandler.hh
@@ -170,7 +373,7 @@ namespace ignition
         const std::string &/*_type*/) const
       {
         // Instantiate a specific protobuf message
-        auto msgPtr = std::make_shared<T>();
+        auto msgPtr = this->NewMsg();
 
         // Create the message using some serialized data
         if (!msgPtr->ParseFromString(_data))
@@ -182,6 +385,25 @@ namespace ignition
         return msgPtr;
       }
 
+      // Documentation inherited.
+      public: const std::shared_ptr<ProtoMsg> ParseMsg(
+        const char *_data,
+        const std::size_t _size,
+        const std::string &/*_type*/) const
+      {
+        // Instantiate a specific protobuf message
+        auto msgPtr = this->NewMsg();
+
+        // Create the message using the serialized data in place
+        if (!msgPtr->ParseFromArray(_data, static_cast<int>(_size)))
+        {
+          std::cerr << "SubscriptionHandler::ParseMsg() error: ParseFromArray"
+                    << " failed" << std::endl;
+        }
+
+        return msgPtr;
+      }
+
       // Documentation inherited.
       public: std::string TypeName()
       {
@@ -193,6 +415,15 @@ namespace ignition
       public: void SetCallback(const MsgCallback<T> &_cb)
       {
         this->cb = _cb;
+        this->sharedCb = nullptr;
+      }
+
+      /// \brief Set a callback that shares the ownership of the messages.
+      /// \param[in] _cb The callback.
+      public: void SetCallback(const SharedMsgCallback<T> &_cb)
+      {
+        this->cb = nullptr;
+        this->sharedCb = _cb;
       }
 
       // Documentation inherited.
@@ -200,15 +431,16 @@ namespace ignition
                                     const MessageInfo &_info)
       {
         // No callback stored.
-        if (!this->cb)
+        if (!this->cb && !this->sharedCb)
         {
           std::cerr << "SubscriptionHandler::RunLocalCallback() error: "
                     << "Callback is NULL" << std::endl;
           return false;
         }
 
-        // Check the subscription throttling option.
-        if (!this->UpdateThrottling())
+        // Check the header filter and the throttling options of the
+        // subscription.
+        if (!this->HeaderAccepted(_msg) || !this->UpdateThrottling())
           return true;
 
 #if GOOGLE_PROTOBUF_VERSION >= 3000000
@@ -217,12 +449,52 @@ namespace ignition
         auto msgPtr = google::protobuf::internal::down_cast<const T*>(&_msg);
 #endif
 
-        this->cb(*msgPtr, _info);
+        CallbackTimer timer(*this, _info);
+        if (this->cb)
+          this->cb(*msgPtr, _info);
+        else
+          this->sharedCb(std::make_shared<const T>(*msgPtr), _info);
         return true;
       }
 
+      // Documentation inherited.
+      public: bool RunLocalCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info)
+      {
+        if (!this->sharedCb)
+          return this->RunLocalCallback(*_msg, _info);
+
+        // Check the header filter and the throttling options of the
+        // subscription.
+        if (!this->HeaderAccepted(*_msg) || !this->UpdateThrottling())
+          return true;
+
+        // The handler only receives messages of type T.
+        CallbackTimer timer(*this, _info);
+        this->sharedCb(std::static_pointer_cast<const T>(_msg), _info);
+        return true;
+      }
+
+      /// \brief Create an empty message, on an arena if the handler
+      /// allocates the messages on an arena.
+      /// \return The new message.
+      private: std::shared_ptr<T> NewMsg() const
+      {
+        auto arena = this->RecycledArena();
+        if (!arena)
+          return std::make_shared<T>();
+
+        // The message shares the ownership of its arena.
+        return std::shared_ptr<T>(arena,
+          google::protobuf::Arena::CreateMessage<T>(arena.get()));
+      }
+
       /// \brief Callback to the function registered for this handler.
       private: MsgCallback<T> cb;
+
+      /// \brief Callback sharing the ownership of the messages.
+      private: SharedMsgCallback<T> sharedCb;
     };
 
     /// \brief Specialized template when the user prefers a callbacks that
@@ -242,32 +514,34 @@ namespace ignition
         const std::string &_data,
         const std::string &_type) const
       {
-        std::shared_ptr<google::protobuf::Message> msgPtr;
-
-        const google::protobuf::Descriptor *desc =
-          google::protobuf::DescriptorPool::generated_pool()
-            ->FindMessageTypeByName(_type);
+        std::shared_ptr<google::protobuf::Message> msgPtr = this->NewMsg(_type);
+        if (!msgPtr)
+          return nullptr;
 
-        // First, check if we have the descriptor from the generated proto
-        // classes.
-        if (desc)
-        {
-          msgPtr.reset(google::protobuf::MessageFactory::generated_factory()
-            ->GetPrototype(desc)->New());
-        }
-        else
+        // Create the message using some serialized data
+        if (!msgPtr->ParseFromString(_data))
         {
-          // Fallback on Ignition Msgs if the message type is not found.
-          msgPtr = ignition::msgs::Factory::New(_type);
+          std::cerr << "CreateMsg() error: ParseFromString failed" << std::endl;
+          return nullptr;
         }
 
+        return msgPtr;
+      }
+
+      // Documentation inherited.
+      public: const std::shared_ptr<ProtoMsg> ParseMsg(
+        const char *_data,
+        const std::size_t _size,
+        const std::string &_type) const
+      {
+        std::shared_ptr<google::protobuf::Message> msgPtr = this->NewMsg(_type);
         if (!msgPtr)
           return nullptr;
 
-        // Create the message using some serialized data
-        if (!msgPtr->ParseFromString(_data))
+        // Create the message using the serialized data in place
+        if (!msgPtr->ParseFromArray(_data, static_cast<int>(_size)))
         {
-          std::cerr << "CreateMsg() error: ParseFromString failed" << std::endl;
+          std::cerr << "ParseMsg() error: ParseFromArray failed" << std::endl;
           return nullptr;
         }
 
@@ -285,6 +559,15 @@ namespace ignition
       public: void SetCallback(const MsgCallback<ProtoMsg> &_cb)
       {
         this->cb = _cb;
+        this->sharedCb = nullptr;
+      }
+
+      /// \brief Set a callback that shares the ownership of the messages.
+      /// \param[in] _cb The callback.
+      public: void SetCallback(const SharedMsgCallback<ProtoMsg> &_cb)
+      {
+        this->cb = nullptr;
+        this->sharedCb = _cb;
       }
 
       // Documentation inherited.
@@ -292,23 +575,242 @@ namespace ignition
                                     const MessageInfo &_info)
       {
         // No callback stored.
-        if (!this->cb)
+        if (!this->cb && !this->sharedCb)
         {
           std::cerr << "SubscriptionHandler::RunLocalCallback() "
                     << "error: Callback is NULL" << std::endl;
           return false;
         }
 
-        // Check the subscription throttling option.
-        if (!this->UpdateThrottling())
+        // Check the header filter and the throttling options of the
+        // subscription.
+        if (!this->HeaderAccepted(_msg) || !this->UpdateThrottling())
+          return true;
+
+        CallbackTimer timer(*this, _info);
+        if (this->cb)
+        {
+          this->cb(_msg, _info);
+        }
+        else
+        {
+          std::shared_ptr<ProtoMsg> copy(_msg.New());
+          copy->CopyFrom(_msg);
+          this->sharedCb(copy, _info);
+        }
+        return true;
+      }
+
+      // Documentation inherited.
+      public: bool RunLocalCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info)
+      {
+        if (!this->sharedCb)
+          return this->RunLocalCallback(*_msg, _info);
+
+        // Check the header filter and the throttling options of the
+        // subscription.
+        if (!this->HeaderAccepted(*_msg) || !this->UpdateThrottling())
           return true;
 
-        this->cb(_msg, _info);
+        CallbackTimer timer(*this, _info);
+        this->sharedCb(_msg, _info);
         return true;
       }
 
+      /// \brief Get an empty message given its type name. The prototype of
+      /// each type is looked up once. Unless the message is allocated on an
+      /// arena, the message parsed last of the type is cleared and reused if
+      /// no callback retained it.
+      /// \param[in] _type The message type name.
+      /// \return The empty message or nullptr if the type is unknown.
+      private: std::shared_ptr<google::protobuf::Message> NewMsg(
+        const std::string &_type) const
+      {
+        std::lock_guard<std::mutex> lock(this->cacheMutex);
+
+        CachedType &cached = this->cache[_type];
+        if (!cached.prototype)
+        {
+          const google::protobuf::Descriptor *desc =
+            google::protobuf::DescriptorPool::generated_pool()
+              ->FindMessageTypeByName(_type);
+
+          // First, check if we have the descriptor from the generated proto
+          // classes.
+          if (desc)
+          {
+            cached.prototype.reset(
+              google::protobuf::MessageFactory::generated_factory()
+                ->GetPrototype(desc),
+              [](const google::protobuf::Message *) {});
+          }
+          else
+          {
+            // Fallback on Ignition Msgs if the message type is not found.
+            cached.prototype = ignition::msgs::Factory::New(_type);
+          }
+
+          if (!cached.prototype)
+          {
+            // The type may be known later, e.g. once its descriptor is loaded.
+            this->cache.erase(_type);
+            return nullptr;
+          }
+        }
+
+        // The message shares the ownership of its arena.
+        auto arena = this->RecycledArena();
+        if (arena)
+        {
+          return std::shared_ptr<google::protobuf::Message>(arena,
+            cached.prototype->New(arena.get()));
+        }
+
+        // Nobody else holds the last message, so its reads are complete.
+        if (cached.last && cached.last.use_count() == 1)
+        {
+          std::atomic_thread_fence(std::memory_order_acquire);
+          cached.last->Clear();
+        }
+        else
+        {
+          cached.last.reset(cached.prototype->New());
+        }
+
+        return cached.last;
+      }
+
+      /// \brief Messages of a type received by this handler.
+      private: struct CachedType
+      {
+        /// \brief Default instance of the type.
+        std::shared_ptr<const google::protobuf::Message> prototype;
+
+        /// \brief Message returned last by NewMsg().
+        std::shared_ptr<google::protobuf::Message> last;
+      };
+
+      /// \brief Protects the cache, since messages may be parsed by several
+      /// threads.
+      private: mutable std::mutex cacheMutex;
+
+      /// \brief Messages received by this handler, by type name.
+      private: mutable std::unordered_map<std::string, CachedType> cache;
+
       /// \brief Callback to the function registered for this handler.
       private: MsgCallback<ProtoMsg> cb;
+
+      /// \brief Callback sharing the ownership of the messages.
+      private: SharedMsgCallback<ProtoMsg> sharedCb;
+    };
+
+    /// \class BatchSubscriptionHandler SubscriptionHandler.hh
+    /// \brief Subscription handler whose callback receives several messages
+    /// of type T at once.
+    template <typename T> class BatchSubscriptionHandler
+      : public SubscriptionHandler<T>
+    {
+      // Documentation inherited.
+      public: explicit BatchSubscriptionHandler(const std::string &_nUuid,
+        const SubscribeOptions &_opts = SubscribeOptions())
+        : SubscriptionHandler<T>(_nUuid, _opts)
+      {
+      }
+
+      /// \brief Set the callback for this handler.
+      /// \param[in] _cb The callback.
+      public: void SetCallback(const BatchMsgCallback<T> &_cb)
+      {
+        this->batchCb = _cb;
+      }
+
+      // Documentation inherited.
+      public: bool Batched() const override
+      {
+        return true;
+      }
+
+      // Documentation inherited.
+      public: bool RunLocalCallback(const ProtoMsg &_msg,
+                                    const MessageInfo &_info) override
+      {
+        if (!this->batchCb)
+        {
+          std::cerr << "BatchSubscriptionHandler::RunLocalCallback() error: "
+                    << "Callback is NULL" << std::endl;
+          return false;
+        }
+
+        // Check the header filter and the throttling options of the
+        // subscription.
+        if (!this->HeaderAccepted(_msg) || !this->UpdateThrottling())
+          return true;
+
+        // A batch of one message, e.g. an intra-process message.
+#if GOOGLE_PROTOBUF_VERSION >= 3000000
+        const std::vector<const T *> msgs = {
+          google::protobuf::down_cast<const T*>(&_msg)};
+#else
+        const std::vector<const T *> msgs = {
+          google::protobuf::internal::down_cast<const T*>(&_msg)};
+#endif
+        SubscriptionHandlerBase::CallbackTimer timer(*this, _info);
+        this->batchCb(msgs, {_info});
+        return true;
+      }
+
+      // Documentation inherited.
+      public: bool RunLocalCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info) override
+      {
+        return this->RunLocalCallback(*_msg, _info);
+      }
+
+      // Documentation inherited.
+      public: bool RunBatchCallback(
+        const std::vector<std::shared_ptr<const ProtoMsg>> &_msgs,
+        const std::vector<MessageInfo> &_infos) override
+      {
+        if (!this->batchCb)
+        {
+          std::cerr << "BatchSubscriptionHandler::RunBatchCallback() error: "
+                    << "Callback is NULL" << std::endl;
+          return false;
+        }
+
+        // The filtered and throttled messages are left out of the batch.
+        std::vector<const T *> msgs;
+        std::vector<MessageInfo> infos;
+        msgs.reserve(_msgs.size());
+        infos.reserve(_msgs.size());
+        for (std::size_t i = 0; i < _msgs.size() && i < _infos.size(); ++i)
+        {
+          if (!_msgs[i] || !this->HeaderAccepted(*_msgs[i]) ||
+              !this->UpdateThrottling())
+          {
+            continue;
+          }
+
+          // The handler only receives messages of type T.
+          msgs.push_back(static_cast<const T *>(_msgs[i].get()));
+          infos.push_back(_infos[i]);
+        }
+
+        // The batch is measured as one callback.
+        if (!msgs.empty())
+        {
+          SubscriptionHandlerBase::CallbackTimer timer(*this,
+            infos.front());
+          this->batchCb(msgs, infos);
+        }
+        return true;
+      }
+
+      /// \brief Callback receiving the batches.
+      private: BatchMsgCallback<T> batchCb;
     };
 
     //////////////////////////////////////////////////
@@ -20,11 +20,14 @@
 #include <ignition/msgs/statistic.pb.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <limits>
 #include <memory>
 #include <string>
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
+#include "ignition/transport/Histogram.hh"
 
 #ifdef _WIN32
 #ifndef NOMINMAX
@@ -47,10 +50,18 @@ namespace ignition
     // Forward declarations.
     class TopicStatisticsPrivate;
 
-    /// \brief Computes the rolling average, min, max, and standard
-    /// deviation for a set of samples.
+    /// \brief Computes the rolling average, min, max, standard
+    /// deviation and percentiles for a set of samples. The percentiles
+    /// come from a fixed memory Histogram of the samples, with a
+    /// resolution of kPercentileResolution units, so the memory used
+    /// doesn't grow with the number of samples.
     class IGNITION_TRANSPORT_VISIBLE Statistics
     {
+      /// \brief Resolution of the percentiles, in units of the samples.
+      /// The samples of the topic statistics are in milliseconds, their
+      /// percentiles are known to the microsecond.
+      public: static constexpr double kPercentileResolution = 0.001;
+
       /// \brief Default constructor.
       public: Statistics() = default;
 
@@ -81,6 +92,24 @@ namespace ignition
       /// \return The number of samples.
       public: uint64_t Count() const;
 
+      /// \brief Get the value that a percentage of the samples don't
+      /// exceed, e.g. 99 for the 99th percentile. Negative samples count
+      /// as 0.
+      /// \param[in] _percentile Percentage of samples, between 0 and 100.
+      /// \return The percentile, within the relative error of Histogram.
+      /// 0 without samples.
+      public: double Percentile(double _percentile) const;
+
+      /// \brief Add the samples of other statistics, e.g. to combine the
+      /// snapshots of several periods or processes.
+      /// \param[in] _other Statistics to merge into these ones.
+      public: void Merge(const Statistics &_other);
+
+      /// \brief Get the distribution of the samples.
+      /// \return Histogram of the samples, in units of
+      /// kPercentileResolution.
+      public: const Histogram &Distribution() const;
+
       /// \brief Count of the samples.
       private: uint64_t count = 0;
 
@@ -96,6 +125,9 @@ namespace ignition
 
       /// \brief Maximum sample.
       private: double max = std::numeric_limits<double>::min();
+
+      /// \brief Distribution of the samples.
+      private: Histogram histogram;
     };
 
     /// \brief Encapsulates statistics for a single topic. The set of
@@ -109,9 +141,17 @@ namespace ignition
     ///
     /// Publication statistics utilize time stamps generated by the
     /// publisher. Receive statistics use time stamps generated by the
-    /// subscriber.
+    /// subscriber. The durations are in milliseconds, with a nanosecond
+    /// precision.
     class IGNITION_TRANSPORT_VISIBLE TopicStatistics
     {
+      /// \brief Maximum number of senders whose sequence numbers and clock
+      /// offsets are tracked. The least recently heard sender is forgotten
+      /// first, so the statistics of a topic keep a constant size when its
+      /// publishers come and go. A sender heard again after being forgotten
+      /// is treated as a new one.
+      public: static constexpr std::size_t kMaxSenders = 64;
+
       /// \brief Default constructor.
       public: TopicStatistics();
 
@@ -124,11 +164,37 @@ namespace ignition
 
       /// \brief Update the topic statistics.
       /// \param[in] _sender Address of the sender.
-      /// \param[in] _stamp Publication time stamp.
+      /// \param[in] _stamp Publication time stamp of the steady clock, in
+      /// milliseconds.
       /// \param[in] _seq Publication sequence number.
       public: void Update(const std::string &_sender,
                           uint64_t _stamp, uint64_t _seq);
 
+      /// \brief Update the topic statistics with nanosecond time stamps.
+      /// The age of a message from the same host uses the steady clocks,
+      /// the age of a message from another host uses the system clocks,
+      /// which are only comparable if the hosts synchronize their clocks.
+      /// \param[in] _sender Address of the sender.
+      /// \param[in] _stamp Publication time of the steady clock of the
+      /// sender.
+      /// \param[in] _systemStamp Publication time of the system clock of the
+      /// sender.
+      /// \param[in] _sameHost True if the sender runs on this host.
+      /// \param[in] _seq Publication sequence number.
+      /// \sa SetClockOffsetCorrection
+      public: void Update(const std::string &_sender,
+                          const std::chrono::nanoseconds &_stamp,
+                          const std::chrono::nanoseconds &_systemStamp,
+                          bool _sameHost, uint64_t _seq);
+
+      /// \brief Correct the age of the messages from other hosts by an
+      /// estimate of the offset between the clocks: the smallest age seen
+      /// from each sender. The age then measures the delay above the
+      /// fastest delivery, which is meaningful even if the clocks of the
+      /// hosts aren't synchronized.
+      /// \param[in] _enable True to correct the age.
+      public: void SetClockOffsetCorrection(bool _enable);
+
       /// \brief Populate an ignition::msgs::Metric message with topic
       /// statistics.
       /// \param[in] _msg Message to populate.
@@ -138,6 +204,18 @@ namespace ignition
       /// \return Number of dropped messages.
       public: uint64_t DroppedMsgCount() const;
 
+      /// \brief Count messages discarded by the full queue of a
+      /// subscription of this process.
+      /// \param[in] _count Number of messages discarded.
+      /// \sa SubscribeOptions::SetQueueSize
+      public: void UpdateQueueDrops(uint64_t _count);
+
+      /// \brief Get the number of messages received but discarded by the
+      /// full queue of a subscription of this process. These are not
+      /// included in DroppedMsgCount().
+      /// \return Number of messages discarded by the subscription queues.
+      public: uint64_t QueueDroppedMsgCount() const;
+
       /// \brief Get statistics about publication of messages.
       /// \return Publication statistics.
       public: Statistics PublicationStatistics() const;
@@ -149,6 +227,12 @@ namespace ignition
       /// \brief Get the message age statistics.
       /// \return Age statistics.
       public: Statistics AgeStatistics() const;
+
+      /// \brief Add the statistics of a snapshot taken by another
+      /// subscriber, or in another period. The message counts and the
+      /// publication, reception and age statistics are combined.
+      /// \param[in] _other Statistics to merge into these ones.
+      public: void Merge(const TopicStatistics &_other);
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
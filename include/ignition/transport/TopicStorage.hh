@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -27,6 +28,8 @@
 #include "ignition/transport/Export.hh"
 #include "ignition/transport/Publisher.hh"
 #include "ignition/transport/TransportTypes.hh"
+#include "ignition/transport/Uuid.hh"
+#include "ignition/transport/detail/FlatHashMap.hh"
 
 namespace ignition
 {
@@ -40,6 +43,13 @@ namespace ignition
     /// methods for adding new topics, removing them, etc.
     template<typename T> class TopicStorage
     {
+      /// \brief Publishers of a topic. The key is the process UUID.
+      using ProcPublishers_M = FlatHashMap<CompactUuid, std::vector<T>>;
+
+      /// \brief Topics advertised by each node of a process. The key is the
+      /// node UUID.
+      using NodeTopics_M = FlatHashMap<CompactUuid, std::set<std::string>>;
+
       /// \brief Constructor.
       public: TopicStorage() = default;
 
@@ -52,20 +62,16 @@ namespace ignition
       /// was already stored).
       public: bool AddPublisher(const T &_publisher)
       {
-        // The topic does not exist.
-        if (this->data.find(_publisher.Topic()) == this->data.end())
-        {
-          // VS2013 is buggy with initializer list here {}
-          this->data[_publisher.Topic()] =
-            std::map<std::string, std::vector<T>>();
-        }
+        // Create the topic entry if needed.
+        auto &m = this->data[_publisher.Topic()];
 
         // Check if the process uuid exists.
-        auto &m = this->data[_publisher.Topic()];
-        if (m.find(_publisher.PUuid()) != m.end())
+        const CompactUuid pUuid(_publisher.PUuid());
+        auto procIt = m.find(pUuid);
+        if (procIt != m.end())
         {
           // Check that the Publisher does not exist.
-          auto &v = m[_publisher.PUuid()];
+          auto &v = procIt->second;
           auto found = std::find_if(v.begin(), v.end(),
             [&](const T &_pub)
             {
@@ -79,7 +85,10 @@ namespace ignition
         }
 
         // Add a new Publisher entry.
-        m[_publisher.PUuid()].push_back(T(_publisher));
+        m[pUuid].push_back(T(_publisher));
+        this->procs[pUuid][CompactUuid(_publisher.NUuid())].insert(
+          _publisher.Topic());
+        ++this->addrs[_publisher.Addr()];
         return true;
       }
 
@@ -100,11 +109,12 @@ namespace ignition
       public: bool HasTopic(const std::string &_topic,
                             const std::string &_type) const
       {
-        if (!this->HasTopic(_topic))
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
         // m is {pUUID=>std::vector<Publisher>}.
-        auto &m = this->data.at(_topic);
+        auto &m = topicIt->second;
 
         for (auto const &procs : m)
         {
@@ -134,11 +144,11 @@ namespace ignition
       public: bool HasAnyPublishers(const std::string &_topic,
                                     const std::string &_pUuid) const
       {
-        if (!this->HasTopic(_topic))
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        return this->data.at(_topic).find(_pUuid) !=
-               this->data.at(_topic).end();
+        return topicIt->second.count(CompactUuid(_pUuid)) > 0;
       }
 
       /// \brief Return if the requested publisher's address is stored.
@@ -146,18 +156,7 @@ namespace ignition
       /// \return true if the publisher's address is stored.
       public: bool HasPublisher(const std::string &_addr) const
       {
-        for (auto const &topic : this->data)
-        {
-          for (auto const &proc : topic.second)
-          {
-            for (auto const &pub : proc.second)
-            {
-              if (pub.Addr() == _addr)
-                return true;
-            }
-          }
-        }
-        return false;
+        return this->addrs.count(_addr) > 0;
       }
 
       /// \brief Get the address information for a given topic and node UUID.
@@ -172,18 +171,20 @@ namespace ignition
                              T &_publisher) const
       {
         // Topic not found.
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
         // m is {pUUID=>Publisher}.
-        auto &m = this->data.at(_topic);
+        auto &m = topicIt->second;
 
         // pUuid not found.
-        if (m.find(_pUuid) == m.end())
+        auto procIt = m.find(CompactUuid(_pUuid));
+        if (procIt == m.end())
           return false;
 
         // Vector of 0MQ known addresses for a given topic and pUuid.
-        auto &v = m.at(_pUuid);
+        auto &v = procIt->second;
         auto found = std::find_if(v.begin(), v.end(),
           [&](const T &_pub)
           {
@@ -207,10 +208,13 @@ namespace ignition
       public: bool Publishers(const std::string &_topic,
                              std::map<std::string, std::vector<T>> &_info) const
       {
-        if (!this->HasTopic(_topic))
+        auto topicIt = this->data.find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        _info = this->data.at(_topic);
+        _info.clear();
+        for (auto const &proc : topicIt->second)
+          _info[proc.first.ToString()] = proc.second;
         return true;
       }
 
@@ -225,54 +229,97 @@ namespace ignition
       {
         size_t counter = 0;
 
-        // Iterate over all the topics.
-        if (this->data.find(_topic) != this->data.end())
+        auto topicIt = this->data.find(_topic);
+        if (topicIt != this->data.end())
         {
           // m is {pUUID=>Publisher}.
-          auto &m = this->data[_topic];
+          auto &m = topicIt->second;
 
           // The pUuid exists.
-          if (m.find(_pUuid) != m.end())
+          auto procIt = m.find(CompactUuid(_pUuid));
+          if (procIt != m.end())
           {
             // Vector of 0MQ known addresses for a given topic and pUuid.
-            auto &v = m[_pUuid];
+            auto &v = procIt->second;
             auto priorSize = v.size();
-            v.erase(std::remove_if(v.begin(), v.end(),
+            auto last = std::remove_if(v.begin(), v.end(),
               [&](const T &_pub)
               {
                 return _pub.NUuid() == _nUuid;
-              }),
-              v.end());
+              });
+            for (auto it = last; it != v.end(); ++it)
+              this->DelAddr(it->Addr());
+            v.erase(last, v.end());
             counter = priorSize - v.size();
 
+            if (counter > 0)
+              this->DelNodeTopic(procIt->first, _nUuid, _topic);
+
             if (v.empty())
-              m.erase(_pUuid);
+              m.erase(procIt);
 
             if (m.empty())
-              this->data.erase(_topic);
+              this->data.erase(topicIt);
           }
         }
 
         return counter > 0;
       }
 
+      /// \brief Remove all the publishers associated to a given node. Only
+      /// the topics of the node are visited.
+      /// \param[in] _pUuid Process UUID of the publishers.
+      /// \param[in] _nUuid Node UUID of the publishers.
+      /// \param[out] _pubs The publishers removed.
+      /// \return True when at least one publisher was removed.
+      public: bool DelPublishersByNode(const std::string &_pUuid,
+                                       const std::string &_nUuid,
+                                       std::vector<T> &_pubs)
+      {
+        this->PublishersByNode(_pUuid, _nUuid, _pubs);
+        for (auto const &pub : _pubs)
+          this->DelPublisherByNode(pub.Topic(), _pUuid, _nUuid);
+
+        return !_pubs.empty();
+      }
+
       /// \brief Remove all the publishers associated to a given process.
       /// \param[in] _pUuid Process' UUID of the publisher.
       /// \return True when at least one address was removed or false otherwise.
       public: bool DelPublishersByProc(const std::string &_pUuid)
       {
         size_t counter = 0;
+        const CompactUuid pUuid(_pUuid);
+
+        auto nodesIt = this->procs.find(pUuid);
+        if (nodesIt == this->procs.end())
+          return false;
 
-        // Iterate over all the topics.
-        for (auto it = this->data.begin(); it != this->data.end();)
+        // Only visit the topics advertised by the process.
+        std::set<std::string> topics;
+        for (auto const &node : nodesIt->second)
+          topics.insert(node.second.begin(), node.second.end());
+        this->procs.erase(nodesIt);
+
+        for (auto const &topic : topics)
         {
+          auto topicIt = this->data.find(topic);
+          if (topicIt == this->data.end())
+            continue;
+
           // m is {pUUID=>Publisher}.
-          auto &m = it->second;
-          counter += m.erase(_pUuid);
+          auto &m = topicIt->second;
+          auto procIt = m.find(pUuid);
+          if (procIt == m.end())
+            continue;
+
+          for (auto const &pub : procIt->second)
+            this->DelAddr(pub.Addr());
+          m.erase(procIt);
+          ++counter;
+
           if (m.empty())
-            this->data.erase(it++);
-          else
-            ++it;
+            this->data.erase(topicIt);
         }
 
         return counter > 0;
@@ -287,19 +334,23 @@ namespace ignition
                              std::map<std::string, std::vector<T>> &_pubs) const
       {
         _pubs.clear();
+        const CompactUuid pUuid(_pUuid);
 
-        // Iterate over all the topics.
-        for (auto const &topic : this->data)
+        auto nodesIt = this->procs.find(pUuid);
+        if (nodesIt == this->procs.end())
+          return;
+
+        // Only visit the topics advertised by the process.
+        std::set<std::string> topics;
+        for (auto const &node : nodesIt->second)
+          topics.insert(node.second.begin(), node.second.end());
+
+        for (auto const &topic : topics)
         {
-          // m is {pUUID=>Publisher}.
-          auto &m = topic.second;
-          if (m.find(_pUuid) != m.end())
+          auto const &v = this->data.at(topic).at(pUuid);
+          for (auto const &pub : v)
           {
-            auto &v = m.at(_pUuid);
-            for (auto const &pub : v)
-            {
-              _pubs[pub.NUuid()].push_back(T(pub));
-            }
+            _pubs[pub.NUuid()].push_back(T(pub));
           }
         }
       }
@@ -314,21 +365,25 @@ namespace ignition
                                     std::vector<T> &_pubs) const
       {
         _pubs.clear();
+        const CompactUuid pUuid(_pUuid);
 
-        // Iterate over all the topics.
-        for (auto const &topic : this->data)
+        auto nodesIt = this->procs.find(pUuid);
+        if (nodesIt == this->procs.end())
+          return;
+
+        auto nodeIt = nodesIt->second.find(CompactUuid(_nUuid));
+        if (nodeIt == nodesIt->second.end())
+          return;
+
+        // Only visit the topics advertised by the node.
+        for (auto const &topic : nodeIt->second)
         {
-          // m is {pUUID=>Publisher}.
-          auto const &m = topic.second;
-          if (m.find(_pUuid) != m.end())
+          auto const &v = this->data.at(topic).at(pUuid);
+          for (auto const &pub : v)
           {
-            auto const &v = m.at(_pUuid);
-            for (auto const &pub : v)
+            if (pub.NUuid() == _nUuid)
             {
-              if (pub.NUuid() == _nUuid)
-              {
-                _pubs.push_back(T(pub));
-              }
+              _pubs.push_back(T(pub));
             }
           }
         }
@@ -338,8 +393,11 @@ namespace ignition
       /// \param[out] _topics List of stored topics.
       public: void TopicList(std::vector<std::string> &_topics) const
       {
+        // Keep the list sorted, the topics are not stored in order.
+        const std::size_t first = _topics.size();
         for (auto const &topic : this->data)
           _topics.push_back(topic.first);
+        std::sort(_topics.begin() + first, _topics.end());
       }
 
       /// \brief Print all the information for debugging purposes.
@@ -362,10 +420,50 @@ namespace ignition
         }
       }
 
+      /// \brief Forget a publisher's address.
+      /// \param[in] _addr Address of a removed publisher.
+      private: void DelAddr(const std::string &_addr)
+      {
+        auto it = this->addrs.find(_addr);
+        if (it != this->addrs.end() && --it->second == 0)
+          this->addrs.erase(it);
+      }
+
+      /// \brief Remove a topic from the index of a node.
+      /// \param[in] _pUuid Process UUID of the node.
+      /// \param[in] _nUuid Node UUID.
+      /// \param[in] _topic Topic name.
+      private: void DelNodeTopic(const CompactUuid &_pUuid,
+                                 const std::string &_nUuid,
+                                 const std::string &_topic)
+      {
+        auto nodesIt = this->procs.find(_pUuid);
+        if (nodesIt == this->procs.end())
+          return;
+
+        auto &nodes = nodesIt->second;
+        auto nodeIt = nodes.find(CompactUuid(_nUuid));
+        if (nodeIt == nodes.end())
+          return;
+
+        nodeIt->second.erase(_topic);
+        if (nodeIt->second.empty())
+          nodes.erase(nodeIt);
+        if (nodes.empty())
+          this->procs.erase(nodesIt);
+      }
+
       /// \brief The keys are topics. The values are another map, where the key
       /// is the process UUID and the value a vector of publishers.
-      private: std::map<std::string,
-                        std::map<std::string, std::vector<T>>> data;
+      private: FlatHashMap<std::string, ProcPublishers_M> data;
+
+      /// \brief Index of the topics of each process, so the operations on a
+      /// process or a node only visit its own topics. The key is the process
+      /// UUID and the value the topics of each of its nodes.
+      private: FlatHashMap<CompactUuid, NodeTopics_M> procs;
+
+      /// \brief Number of publishers stored for each address.
+      private: FlatHashMap<std::string, std::size_t> addrs;
     };
     }
   }
@@ -26,10 +26,12 @@
 #endif
 
 #include <chrono>
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "ignition/transport/config.hh"
@@ -140,6 +142,26 @@ namespace ignition
     using MsgCallback =
       std::function<void(const T &_msg, const MessageInfo &_info)>;
 
+    /// \def SharedMsgCallback
+    /// \brief User callback used for receiving messages and sharing their
+    /// ownership, so they can be kept without a copy:
+    ///   \param[in] _msg Protobuf message containing the topic update.
+    ///   \param[in] _info Message information (e.g.: topic name).
+    template <typename T>
+    using SharedMsgCallback =
+      std::function<void(std::shared_ptr<const T> _msg,
+                         const MessageInfo &_info)>;
+
+    /// \def BatchMsgCallback
+    /// \brief User callback used for receiving several messages at once:
+    ///   \param[in] _msgs Protobuf messages, oldest first. They are only
+    ///   valid during the callback.
+    ///   \param[in] _infos Information of each message (e.g.: topic name).
+    template <typename T>
+    using BatchMsgCallback =
+      std::function<void(const std::vector<const T *> &_msgs,
+                         const std::vector<MessageInfo> &_infos)>;
+
     /// \def RawCallback
     /// \brief User callback used for receiving raw message data:
     /// \param[in] _msgData string of a serialized protobuf message
@@ -150,6 +172,21 @@ namespace ignition
         std::function<void(const char *_msgData, const size_t _size,
                            const MessageInfo &_info)>;
 
+    /// \def RawRepCallback
+    /// \brief Callback of a service advertised with raw data:
+    /// \param[in] _req Serialized request.
+    /// \param[out] _rep Serialized response.
+    /// \return True when the service call was successful.
+    using RawRepCallback =
+        std::function<bool(const std::string &_req, std::string &_rep)>;
+
+    /// \def RawReqCallback
+    /// \brief Callback receiving the raw response of a service call:
+    /// \param[in] _rep Serialized response.
+    /// \param[in] _result True when the service call was successful.
+    using RawReqCallback =
+        std::function<void(const std::string &_rep, const bool _result)>;
+
     /// \def Timestamp
     /// \brief Used to evaluate the validity of a discovery entry.
     using Timestamp = std::chrono::steady_clock::time_point;
@@ -170,6 +207,23 @@ namespace ignition
     /// \ref http://zeromq.org/blog:zero-copy
     using DeallocFunc = void(void *_data, void *_hint);
 
+    /// \brief A part of a serialized message published without gathering
+    /// the parts in one buffer first.
+    /// \sa Node::Publisher::PublishSegments
+    struct MessageSegment
+    {
+      /// \brief Beginning of the part.
+      const char *data = nullptr;
+
+      /// \brief Size of the part (bytes).
+      std::size_t size = 0;
+
+      /// \brief Called once the transport no longer reads the part, which
+      /// may happen on another thread after the publication returns. It
+      /// may be empty if the part outlives the publication.
+      std::function<void()> release;
+    };
+
     /// \brief The string type used for generic messages.
     const std::string kGenericMessageType = "google.protobuf.Message";
 
@@ -180,6 +234,37 @@ namespace ignition
     /// \brief The high water mark of the send message buffer.
     /// \sa NodeShared::SndHwm
     const int kDefaultSndHwm = 1000;
+
+    /// \brief Get the type name of a protobuf message type. The name is
+    /// computed once per type, so it doesn't create a message nor a string
+    /// on each call.
+    /// \return The type name of T.
+    template<typename T>
+    const std::string &MessageTypeName()
+    {
+      static const std::string name = T().GetTypeName();
+      return name;
+    }
+
+    /// \brief Get the type name of a protobuf message. The name of a typed
+    /// message is computed once per type, as in MessageTypeName<T>(), the
+    /// name of a generic message is stored in _storage.
+    /// \param[in] _msg The message.
+    /// \param[out] _storage Holds the type name of a generic message.
+    /// \return The type name of the message.
+    template<typename T>
+    const std::string &MessageTypeName(const T &_msg, std::string &_storage)
+    {
+      if constexpr (std::is_abstract<T>::value)
+      {
+        _storage = _msg.GetTypeName();
+        return _storage;
+      }
+      else
+      {
+        return MessageTypeName<T>();
+      }
+    }
     }
   }
 }
@@ -18,7 +18,12 @@
 #ifndef IGN_TRANSPORT_UUID_HH_
 #define IGN_TRANSPORT_UUID_HH_
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "ignition/transport/config.hh"
@@ -75,7 +80,103 @@ namespace ignition
       /// \brief Internal representation.
       private: portable_uuid_t data;
     };
+
+    /// \class CompactUuid Uuid.hh ignition/transport/Uuid.hh
+    /// \brief A UUID stored as 16 bytes, used as a key in the bookkeeping
+    /// containers. It is compared and hashed as two 64-bit words instead of
+    /// a 36-character string, and copying it does not allocate.
+    ///
+    /// A CompactUuid can be built from any string. Strings in the canonical
+    /// UUID format (lowercase, 8-4-4-4-12) are packed; any other string is
+    /// kept as is, so ToString() always returns the original string.
+    class IGNITION_TRANSPORT_VISIBLE CompactUuid
+    {
+      /// \brief Default constructor. Creates the nil UUID.
+      public: CompactUuid();
+
+      /// \brief Constructor.
+      /// \param[in] _uuid The UUID.
+      public: explicit CompactUuid(const Uuid &_uuid);
+
+      /// \brief Constructor.
+      /// \param[in] _str A UUID in string format, or any other identifier.
+      public: explicit CompactUuid(const std::string &_str);
+
+      /// \brief Create a UUID that is unique within the process without
+      /// calling the system UUID generator. The first word is random and
+      /// shared by all the UUIDs of the process, the second one is a counter,
+      /// so creating one is an atomic increment.
+      /// \return A new UUID.
+      public: static CompactUuid Sequential();
+
+      /// \brief Return the string representation of the UUID.
+      /// \return The string the UUID was built from.
+      public: std::string ToString() const;
+
+      /// \brief Whether the identifier was packed in 16 bytes.
+      /// \return True if the identifier was a UUID in canonical format.
+      public: bool Packed() const;
+
+      /// \brief Hash of the UUID.
+      /// \return The hash.
+      public: std::size_t Hash() const;
+
+      /// \brief Equality operator.
+      /// \param[in] _other UUID to compare to.
+      /// \return True if both identifiers are equal.
+      public: bool operator==(const CompactUuid &_other) const;
+
+      /// \brief Inequality operator.
+      /// \param[in] _other UUID to compare to.
+      /// \return True if the identifiers are different.
+      public: bool operator!=(const CompactUuid &_other) const;
+
+      /// \brief Less than operator, for ordered containers.
+      /// \param[in] _other UUID to compare to.
+      /// \return True if this identifier sorts before _other.
+      public: bool operator<(const CompactUuid &_other) const;
+
+      /// \brief Stream insertion operator.
+      /// \param[out] _out The output stream.
+      /// \param[in] _uuid UUID to write to the stream.
+      public: friend std::ostream &operator<<(std::ostream &_out,
+                                              const CompactUuid &_uuid)
+      {
+        _out << _uuid.ToString();
+        return _out;
+      }
+
+      /// \brief The UUID as two 64-bit words.
+      private: std::array<uint64_t, 2> words;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::shared_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief The original string when it is not a UUID in canonical
+      /// format, or nullptr otherwise.
+      private: std::shared_ptr<const std::string> text;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
     }
   }
 }
+
+namespace std
+{
+  /// \brief Hash of a CompactUuid, for the unordered containers.
+  template<>
+  struct hash<ignition::transport::CompactUuid>
+  {
+    std::size_t operator()(
+      const ignition::transport::CompactUuid &_uuid) const
+    {
+      return _uuid.Hash();
+    }
+  };
+}
 #endif
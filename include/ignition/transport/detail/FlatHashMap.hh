@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_DETAIL_FLATHASHMAP_HH_
+#define IGN_TRANSPORT_DETAIL_FLATHASHMAP_HH_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class FlatHashMap FlatHashMap.hh
+    /// ignition/transport/detail/FlatHashMap.hh
+    /// \brief An open addressing hash map with linear probing. The entries
+    /// are stored in a single array next to their hash, so a lookup usually
+    /// touches one cache line and compares the keys only when the hashes
+    /// match. Erased entries leave a tombstone, so erasing while iterating
+    /// is safe. Inserting invalidates the iterators and references.
+    ///
+    /// The iteration order is unspecified. The keys must not be modified
+    /// through an iterator.
+    template<typename K, typename V, typename Hash = std::hash<K>>
+    class FlatHashMap
+    {
+      /// \brief An entry.
+      public: using value_type = std::pair<K, V>;
+
+      /// \brief Iterator over the entries.
+      /// \tparam Const True for a const iterator.
+      public: template<bool Const> class Iterator
+      {
+        /// \brief The map type.
+        private: using Map = typename std::conditional<Const,
+          const FlatHashMap, FlatHashMap>::type;
+
+        /// \brief Iterator category.
+        public: using iterator_category = std::forward_iterator_tag;
+
+        /// \brief Entry type.
+        public: using value_type = FlatHashMap::value_type;
+
+        /// \brief Distance type.
+        public: using difference_type = std::ptrdiff_t;
+
+        /// \brief Reference type.
+        public: using reference = typename std::conditional<Const,
+          const value_type &, value_type &>::type;
+
+        /// \brief Pointer type.
+        public: using pointer = typename std::conditional<Const,
+          const value_type *, value_type *>::type;
+
+        /// \brief Constructor.
+        /// \param[in] _map The map.
+        /// \param[in] _index Slot of the entry, skipping to the next used
+        /// slot.
+        public: Iterator(Map *_map, std::size_t _index)
+          : map(_map), index(_index)
+        {
+          this->Skip();
+        }
+
+        /// \brief Dereference.
+        /// \return The entry.
+        public: reference operator*() const
+        {
+          return this->map->entries[this->index];
+        }
+
+        /// \brief Member access.
+        /// \return The entry.
+        public: pointer operator->() const
+        {
+          return &this->map->entries[this->index];
+        }
+
+        /// \brief Prefix increment.
+        /// \return This iterator.
+        public: Iterator &operator++()
+        {
+          ++this->index;
+          this->Skip();
+          return *this;
+        }
+
+        /// \brief Postfix increment.
+        /// \return The iterator before being incremented.
+        public: Iterator operator++(int)
+        {
+          Iterator it = *this;
+          ++(*this);
+          return it;
+        }
+
+        /// \brief Equality operator.
+        /// \param[in] _other Iterator to compare to.
+        /// \return True if both iterators point to the same slot.
+        public: bool operator==(const Iterator &_other) const
+        {
+          return this->index == _other.index;
+        }
+
+        /// \brief Inequality operator.
+        /// \param[in] _other Iterator to compare to.
+        /// \return True if the iterators point to different slots.
+        public: bool operator!=(const Iterator &_other) const
+        {
+          return this->index != _other.index;
+        }
+
+        /// \brief Move to the first used slot, starting at the current one.
+        private: void Skip()
+        {
+          while (this->index < this->map->hashes.size() &&
+                 this->map->hashes[this->index] < kFirstHash)
+          {
+            ++this->index;
+          }
+        }
+
+        /// \brief The map.
+        private: Map *map;
+
+        /// \brief Current slot.
+        private: std::size_t index;
+
+        friend class FlatHashMap;
+      };
+
+      /// \brief Mutable iterator.
+      public: using iterator = Iterator<false>;
+
+      /// \brief Const iterator.
+      public: using const_iterator = Iterator<true>;
+
+      /// \brief Get an iterator to the first entry.
+      /// \return The iterator.
+      public: iterator begin()
+      {
+        return iterator(this, 0);
+      }
+
+      /// \brief Get an iterator past the last entry.
+      /// \return The iterator.
+      public: iterator end()
+      {
+        return iterator(this, this->hashes.size());
+      }
+
+      /// \brief Get an iterator to the first entry.
+      /// \return The iterator.
+      public: const_iterator begin() const
+      {
+        return const_iterator(this, 0);
+      }
+
+      /// \brief Get an iterator past the last entry.
+      /// \return The iterator.
+      public: const_iterator end() const
+      {
+        return const_iterator(this, this->hashes.size());
+      }
+
+      /// \brief Number of entries.
+      /// \return The number of entries.
+      public: std::size_t size() const
+      {
+        return this->numEntries;
+      }
+
+      /// \brief Whether the map is empty.
+      /// \return True if there are no entries.
+      public: bool empty() const
+      {
+        return this->numEntries == 0;
+      }
+
+      /// \brief Remove all the entries and release the memory.
+      public: void clear()
+      {
+        this->hashes.clear();
+        this->entries.clear();
+        this->numEntries = 0;
+        this->tombstones = 0;
+      }
+
+      /// \brief Find an entry.
+      /// \param[in] _key The key.
+      /// \return Iterator to the entry or end().
+      public: iterator find(const K &_key)
+      {
+        return iterator(this, this->Find(_key));
+      }
+
+      /// \brief Find an entry.
+      /// \param[in] _key The key.
+      /// \return Iterator to the entry or end().
+      public: const_iterator find(const K &_key) const
+      {
+        return const_iterator(this, this->Find(_key));
+      }
+
+      /// \brief Count the entries with a key.
+      /// \param[in] _key The key.
+      /// \return 1 if the key is stored or 0 otherwise.
+      public: std::size_t count(const K &_key) const
+      {
+        return this->Find(_key) != this->hashes.size() ? 1u : 0u;
+      }
+
+      /// \brief Get the value of an entry, inserting a default value if the
+      /// key is not stored.
+      /// \param[in] _key The key.
+      /// \return Reference to the value.
+      public: V &operator[](const K &_key)
+      {
+        return this->entries[this->Insert(_key)].second;
+      }
+
+      /// \brief Get the value of an entry that must exist.
+      /// \param[in] _key The key.
+      /// \return Reference to the value.
+      public: const V &at(const K &_key) const
+      {
+        return this->entries[this->Find(_key)].second;
+      }
+
+      /// \brief Remove an entry.
+      /// \param[in] _key The key.
+      /// \return Number of entries removed.
+      public: std::size_t erase(const K &_key)
+      {
+        const std::size_t index = this->Find(_key);
+        if (index == this->hashes.size())
+          return 0;
+
+        this->EraseSlot(index);
+        return 1;
+      }
+
+      /// \brief Remove an entry.
+      /// \param[in] _it Iterator to the entry.
+      /// \return Iterator to the next entry.
+      public: iterator erase(iterator _it)
+      {
+        this->EraseSlot(_it.index);
+        return ++_it;
+      }
+
+      /// \brief Reserve space for a number of entries.
+      /// \param[in] _size Number of entries.
+      public: void reserve(const std::size_t _size)
+      {
+        if ((_size + this->tombstones) * 4 > this->hashes.size() * 3)
+          this->Rehash(_size);
+      }
+
+      /// \brief Hash of an empty slot.
+      private: static constexpr std::size_t kEmpty = 0;
+
+      /// \brief Hash of an erased slot.
+      private: static constexpr std::size_t kTombstone = 1;
+
+      /// \brief Smallest hash of a used slot.
+      private: static constexpr std::size_t kFirstHash = 2;
+
+      /// \brief Hash a key, never returning a reserved value.
+      /// \param[in] _key The key.
+      /// \return The hash.
+      private: static std::size_t HashOf(const K &_key)
+      {
+        const std::size_t h = Hash()(_key);
+        return h < kFirstHash ? h + kFirstHash : h;
+      }
+
+      /// \brief Find the slot of a key.
+      /// \param[in] _key The key.
+      /// \return The slot or hashes.size() if the key is not stored.
+      private: std::size_t Find(const K &_key) const
+      {
+        if (this->numEntries == 0)
+          return this->hashes.size();
+
+        const std::size_t h = HashOf(_key);
+        const std::size_t mask = this->hashes.size() - 1;
+        for (std::size_t i = h & mask; ; i = (i + 1) & mask)
+        {
+          if (this->hashes[i] == kEmpty)
+            return this->hashes.size();
+          if (this->hashes[i] == h && this->entries[i].first == _key)
+            return i;
+        }
+      }
+
+      /// \brief Find the slot of a key, inserting a default value if the
+      /// key is not stored.
+      /// \param[in] _key The key.
+      /// \return The slot.
+      private: std::size_t Insert(const K &_key)
+      {
+        const std::size_t found = this->Find(_key);
+        if (found != this->hashes.size())
+          return found;
+
+        // Keep the load factor, including the tombstones, under 3/4.
+        if ((this->numEntries + this->tombstones + 1) * 4 >
+            this->hashes.size() * 3)
+        {
+          this->Rehash(this->numEntries + 1);
+        }
+
+        const std::size_t h = HashOf(_key);
+        const std::size_t index = this->FreeSlot(h);
+        if (this->hashes[index] == kTombstone)
+          --this->tombstones;
+        this->hashes[index] = h;
+        this->entries[index].first = _key;
+        ++this->numEntries;
+        return index;
+      }
+
+      /// \brief Find the first slot available for a hash.
+      /// \param[in] _hash The hash.
+      /// \return The slot.
+      private: std::size_t FreeSlot(const std::size_t _hash) const
+      {
+        const std::size_t mask = this->hashes.size() - 1;
+        std::size_t i = _hash & mask;
+        while (this->hashes[i] >= kFirstHash)
+          i = (i + 1) & mask;
+        return i;
+      }
+
+      /// \brief Erase the entry of a used slot.
+      /// \param[in] _index The slot.
+      private: void EraseSlot(const std::size_t _index)
+      {
+        this->hashes[_index] = kTombstone;
+        // Release the resources held by the entry.
+        this->entries[_index] = value_type();
+        --this->numEntries;
+        ++this->tombstones;
+      }
+
+      /// \brief Move the entries to a new array, dropping the tombstones.
+      /// \param[in] _size Number of entries that should fit.
+      private: void Rehash(const std::size_t _size)
+      {
+        const std::size_t size = std::max(_size, this->numEntries);
+        std::size_t capacity = 8;
+        while (size * 4 > capacity * 3)
+          capacity *= 2;
+
+        std::vector<std::size_t> oldHashes(capacity, kEmpty);
+        std::vector<value_type> oldEntries(capacity);
+        oldHashes.swap(this->hashes);
+        oldEntries.swap(this->entries);
+        this->tombstones = 0;
+
+        for (std::size_t i = 0; i < oldHashes.size(); ++i)
+        {
+          if (oldHashes[i] < kFirstHash)
+            continue;
+
+          const std::size_t index = this->FreeSlot(oldHashes[i]);
+          this->hashes[index] = oldHashes[i];
+          this->entries[index] = std::move(oldEntries[i]);
+        }
+      }
+
+      /// \brief Hash of each slot, or kEmpty or kTombstone.
+      private: std::vector<std::size_t> hashes;
+
+      /// \brief Entry of each slot.
+      private: std::vector<value_type> entries;
+
+      /// \brief Number of entries.
+      private: std::size_t numEntries = 0;
+
+      /// \brief Number of erased slots.
+      private: std::size_t tombstones = 0;
+    };
+    }
+  }
+}
+#endif
@@ -18,8 +18,13 @@
 #ifndef IGNITION_TRANSPORT_DETAIL_NODE_HH_
 #define IGNITION_TRANSPORT_DETAIL_NODE_HH_
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace ignition
 {
@@ -27,11 +32,89 @@ namespace ignition
   {
     //////////////////////////////////////////////////
     template<typename MessageT>
-    Node::Publisher Node::Advertise(
+    bool Node::Publisher::Publish(std::unique_ptr<MessageT> _msg)
+    {
+      return this->Publish(std::shared_ptr<const ProtoMsg>(std::move(_msg)));
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    typename std::enable_if<
+      !std::is_base_of<ProtoMsg, MessageT>::value &&
+      Serializer<MessageT>::kSupported, bool>::type
+    Node::Publisher::Publish(const MessageT &_msg)
+    {
+      return this->PublishSerialized(_msg, false);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::Publisher::PublishSerialized(const MessageT &_msg,
+                                            const bool _typeChecked)
+    {
+      const std::size_t size = Serializer<MessageT>::ByteSize(_msg);
+      char *buffer = this->Loan(size);
+      if (!buffer)
+        return false;
+
+      if (!Serializer<MessageT>::Serialize(_msg, buffer, size))
+      {
+        std::cerr << "Node::Publisher::Publish(): Error serializing data"
+                  << std::endl;
+        this->ReturnLoan(buffer);
+        return false;
+      }
+
+      if (_typeChecked)
+        return this->PublishLoanedTyped(buffer, size);
+
+      return this->PublishLoaned(buffer, size,
+        Serializer<MessageT>::TypeName());
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    Node::TypedPublisher<MessageT>::TypedPublisher(const Publisher &_publisher)
+      : Publisher(_publisher)
+    {
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::TypedPublisher<MessageT>::Publish(const MessageT &_msg)
+    {
+      if constexpr (std::is_base_of<ProtoMsg, MessageT>::value)
+        return this->PublishTyped(_msg);
+      else
+        return this->PublishSerialized(_msg, true);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    Node::TypedPublisher<MessageT> Node::Advertise(
         const std::string &_topic,
         const AdvertiseMessageOptions &_options)
     {
-      return this->Advertise(_topic, MessageT().GetTypeName(), _options);
+      AdvertiseMessageOptions opts = _options;
+      if (HostLocalMessage<MessageT>::value && opts.Scope() == Scope_t::ALL)
+        opts.SetScope(Scope_t::HOST);
+
+      return TypedPublisher<MessageT>(
+        this->Advertise(_topic, Serializer<MessageT>::TypeName(), opts));
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    std::vector<Node::Publisher> Node::AdvertiseMany(
+        const std::vector<std::string> &_topics,
+        const AdvertiseMessageOptions &_options)
+    {
+      AdvertiseMessageOptions opts = _options;
+      if (HostLocalMessage<MessageT>::value && opts.Scope() == Scope_t::ALL)
+        opts.SetScope(Scope_t::HOST);
+
+      return this->AdvertiseMany(_topics, Serializer<MessageT>::TypeName(),
+        opts);
     }
 
     //////////////////////////////////////////////////
@@ -112,35 +195,57 @@ namespace ignition
                            const MessageInfo &_info)> &_cb,
         const SubscribeOptions &_opts)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
-
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+      if constexpr (!std::is_base_of<ProtoMsg, MessageT>::value)
       {
-        std::cerr << "Topic [" << topic << "] is not valid." << std::endl;
-        return false;
+        return this->SubscribeSerialized<MessageT>(_topic, _cb, _opts);
       }
+      else
+      {
+        auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+        if (!fullyQualifiedTopicPtr)
+        {
+          std::cerr << "Topic [" << this->RemappedTopic(_topic)
+                    << "] is not valid." << std::endl;
+          return false;
+        }
+        const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-      // Create a new subscription handler.
-      std::shared_ptr<SubscriptionHandler<MessageT>> subscrHandlerPtr(
-          new SubscriptionHandler<MessageT>(this->NodeUuid(), _opts));
+        // Create a new subscription handler.
+        std::shared_ptr<SubscriptionHandler<MessageT>> subscrHandlerPtr(
+            new SubscriptionHandler<MessageT>(this->NodeUuid(), _opts));
 
-      // Insert the callback into the handler.
-      subscrHandlerPtr->SetCallback(_cb);
+        // Insert the callback into the handler.
+        subscrHandlerPtr->SetCallback(_cb);
 
-      std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+        std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
 
-      // Store the subscription handler. Each subscription handler is
-      // associated with a topic. When the receiving thread gets new data,
-      // it will recover the subscription handler associated to the topic and
-      // will invoke the callback.
-      this->Shared()->localSubscribers.normal.AddHandler(
-        fullyQualifiedTopic, this->NodeUuid(), subscrHandlerPtr);
+        // Store the subscription handler. Each subscription handler is
+        // associated with a topic. When the receiving thread gets new data,
+        // it will recover the subscription handler associated to the topic
+        // and will invoke the callback.
+        this->Shared()->localSubscribers.normal.AddHandler(
+          fullyQualifiedTopic, this->NodeUuid(), subscrHandlerPtr);
 
-      return this->SubscribeHelper(fullyQualifiedTopic);
+        return this->SubscribeHelper(fullyQualifiedTopic, subscrHandlerPtr);
+      }
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::SubscribeMany(
+        const std::vector<std::string> &_topics,
+        const std::function<void(const MessageT &_msg,
+                                 const MessageInfo &_info)> &_cb,
+        const SubscribeOptions &_opts)
+    {
+      std::function<void(const MessageT &, const MessageInfo &)> f = _cb;
+
+      bool result = true;
+      this->BeginDiscoveryBatch();
+      for (const auto &topic : _topics)
+        result = this->Subscribe<MessageT>(topic, f, _opts) && result;
+
+      return this->EndDiscoveryBatch() && result;
     }
 
     //////////////////////////////////////////////////
@@ -163,6 +268,119 @@ namespace ignition
       return this->Subscribe<MessageT>(_topic, f, _opts);
     }
 
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::Subscribe(
+        const std::string &_topic,
+        const std::function<void(std::shared_ptr<const MessageT> _msg,
+                                 const MessageInfo &_info)> &_cb,
+        const SubscribeOptions &_opts)
+    {
+      if constexpr (!std::is_base_of<ProtoMsg, MessageT>::value)
+      {
+        std::function<void(const MessageT &, const MessageInfo &)> f =
+          [_cb](const MessageT &_internalMsg,
+                const MessageInfo &_internalInfo)
+          {
+            _cb(std::make_shared<const MessageT>(_internalMsg),
+                _internalInfo);
+          };
+        return this->SubscribeSerialized<MessageT>(_topic, f, _opts);
+      }
+      else
+      {
+        auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+        if (!fullyQualifiedTopicPtr)
+        {
+          std::cerr << "Topic [" << this->RemappedTopic(_topic)
+                    << "] is not valid." << std::endl;
+          return false;
+        }
+        const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+        // Create a new subscription handler.
+        std::shared_ptr<SubscriptionHandler<MessageT>> subscrHandlerPtr(
+            new SubscriptionHandler<MessageT>(this->NodeUuid(), _opts));
+
+        // Insert the callback into the handler.
+        subscrHandlerPtr->SetCallback(SharedMsgCallback<MessageT>(_cb));
+
+        std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+        // Store the subscription handler.
+        this->Shared()->localSubscribers.normal.AddHandler(
+          fullyQualifiedTopic, this->NodeUuid(), subscrHandlerPtr);
+
+        return this->SubscribeHelper(fullyQualifiedTopic, subscrHandlerPtr);
+      }
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::SubscribeBatch(
+        const std::string &_topic,
+        const BatchMsgCallback<MessageT> &_cb,
+        const SubscribeOptions &_opts)
+    {
+      static_assert(std::is_base_of<ProtoMsg, MessageT>::value,
+                    "Batched subscriptions require protobuf messages");
+
+      auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+      if (!fullyQualifiedTopicPtr)
+      {
+        std::cerr << "Topic [" << this->RemappedTopic(_topic)
+                  << "] is not valid." << std::endl;
+        return false;
+      }
+      const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+      // Create a new subscription handler.
+      std::shared_ptr<BatchSubscriptionHandler<MessageT>> subscrHandlerPtr(
+          new BatchSubscriptionHandler<MessageT>(this->NodeUuid(), _opts));
+
+      // Insert the callback into the handler.
+      subscrHandlerPtr->SetCallback(_cb);
+
+      std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+      // Store the subscription handler.
+      this->Shared()->localSubscribers.normal.AddHandler(
+        fullyQualifiedTopic, this->NodeUuid(), subscrHandlerPtr);
+
+      return this->SubscribeHelper(fullyQualifiedTopic, subscrHandlerPtr);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::SubscribeSerialized(
+        const std::string &_topic,
+        const std::function<void(const MessageT &_msg,
+                                 const MessageInfo &_info)> &_cb,
+        const SubscribeOptions &_opts)
+    {
+      static_assert(Serializer<MessageT>::kSupported,
+                    "The message type has no Serializer");
+
+      // The data received are only read, the message is rebuilt for each
+      // callback.
+      auto cb = [_cb](const char *_data, const std::size_t _size,
+                      const MessageInfo &_info)
+      {
+        MessageT msg;
+        if (!Serializer<MessageT>::Deserialize(_data, _size, msg))
+        {
+          std::cerr << "Node::Subscribe(): Error deserializing a message of "
+                    << "type [" << _info.Type() << "] on topic ["
+                    << _info.Topic() << "]" << std::endl;
+          return;
+        }
+        _cb(msg, _info);
+      };
+
+      return this->SubscribeRaw(_topic, cb,
+        Serializer<MessageT>::TypeName(), _opts);
+    }
+
     //////////////////////////////////////////////////
     template<typename RequestT, typename ReplyT>
     bool Node::Advertise(
@@ -228,17 +446,14 @@ namespace ignition
       std::function<bool(const RequestT &, ReplyT &)> _cb,
       const AdvertiseServiceOptions &_options)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
-
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+      auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+      if (!fullyQualifiedTopicPtr)
       {
-        std::cerr << "Service [" << topic << "] is not valid." << std::endl;
+        std::cerr << "Service [" << this->RemappedTopic(_topic)
+                  << "] is not valid." << std::endl;
         return false;
       }
+      const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
       // Create a new service reply handler.
       std::shared_ptr<RepHandler<RequestT, ReplyT>> repHandlerPtr(
@@ -246,9 +461,15 @@ namespace ignition
 
       // Insert the callback into the handler.
       repHandlerPtr->SetCallback(_cb);
+      repHandlerPtr->SetMaxConcurrency(_options.MaxConcurrency());
+      repHandlerPtr->SetMaxQueue(_options.MaxQueue());
+      repHandlerPtr->SetResponseCacheTtl(_options.ResponseCacheTtl());
 
       std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
 
+      if (!this->Shared()->EnsureServices())
+        return false;
+
       // Add the topic to the list of advertised services.
       this->SrvsAdvertised().insert(fullyQualifiedTopic);
 
@@ -269,7 +490,7 @@ namespace ignition
       if (!this->Shared()->AdvertisePublisher(publisher))
       {
         std::cerr << "Node::Advertise(): Error advertising service ["
-                  << topic
+                  << this->RemappedTopic(_topic)
                   << "]. Did you forget to start the discovery service?"
                   << std::endl;
         return false;
@@ -399,17 +620,14 @@ namespace ignition
       const RequestT &_request,
       std::function<void(const ReplyT &_reply, const bool _result)> &_cb)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
-
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+      auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+      if (!fullyQualifiedTopicPtr)
       {
-        std::cerr << "Service [" << topic << "] is not valid." << std::endl;
+        std::cerr << "Service [" << this->RemappedTopic(_topic)
+                  << "] is not valid." << std::endl;
         return false;
       }
+      const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
       bool localResponserFound;
       IRepHandlerPtr repHandler;
@@ -417,8 +635,8 @@ namespace ignition
         std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
         localResponserFound = this->Shared()->repliers.FirstHandler(
               fullyQualifiedTopic,
-              RequestT().GetTypeName(),
-              ReplyT().GetTypeName(),
+              MessageTypeName<RequestT>(),
+              MessageTypeName<ReplyT>(),
               repHandler);
       }
 
@@ -427,15 +645,17 @@ namespace ignition
       {
         // There is a responser in my process, let's use it.
         ReplyT rep;
-        bool result = repHandler->RunLocalCallback(_request, rep);
+        bool result = repHandler->RunLocalCachedCallback(_request, rep);
 
         _cb(rep, result);
         return true;
       }
 
-      // Create a new request handler.
-      std::shared_ptr<ReqHandler<RequestT, ReplyT>> reqHandlerPtr(
-        new ReqHandler<RequestT, ReplyT>(this->NodeUuid()));
+      // Create a new request handler. Its memory is recycled through a
+      // pool.
+      using HandlerT = ReqHandler<RequestT, ReplyT>;
+      auto reqHandlerPtr = std::allocate_shared<HandlerT>(
+        PoolAllocator<HandlerT>(), this->NodeUuid());
 
       // Insert the request's parameters.
       reqHandlerPtr->SetMessage(&_request);
@@ -446,16 +666,19 @@ namespace ignition
       {
         std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
 
+        if (!this->Shared()->EnsureServices())
+          return false;
+
         // Store the request handler.
-        this->Shared()->requests.AddHandler(
-          fullyQualifiedTopic, this->NodeUuid(), reqHandlerPtr);
+        this->Shared()->requests.AddHandler(fullyQualifiedTopic,
+          reqHandlerPtr->NodeId(), reqHandlerPtr->HandlerId(), reqHandlerPtr);
 
         // If the responser's address is known, make the request.
         SrvAddresses_M addresses;
         if (this->Shared()->TopicPublishers(fullyQualifiedTopic, addresses))
         {
           this->Shared()->SendPendingRemoteReqs(fullyQualifiedTopic,
-            RequestT().GetTypeName(), ReplyT().GetTypeName());
+            MessageTypeName<RequestT>(), MessageTypeName<ReplyT>());
         }
         else
         {
@@ -463,7 +686,7 @@ namespace ignition
           if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
           {
             std::cerr << "Node::Request(): Error discovering service ["
-                      << topic
+                      << this->RemappedTopic(_topic)
                       << "]. Did you forget to start the discovery service?"
                       << std::endl;
             return false;
@@ -523,48 +746,63 @@ namespace ignition
             ReplyT &_reply,
             bool &_result)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
-
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+      auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+      if (!fullyQualifiedTopicPtr)
       {
-        std::cerr << "Service [" << topic << "] is not valid." << std::endl;
+        std::cerr << "Service [" << this->RemappedTopic(_topic)
+                  << "] is not valid." << std::endl;
         return false;
       }
+      const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-      // Create a new request handler.
-      std::shared_ptr<ReqHandler<RequestT, ReplyT>> reqHandlerPtr(
-        new ReqHandler<RequestT, ReplyT>(this->NodeUuid()));
+      std::string reqTypeStorage;
+      std::string repTypeStorage;
+      const std::string &reqType = MessageTypeName(_request, reqTypeStorage);
+      const std::string &repType = MessageTypeName(_reply, repTypeStorage);
+
+      // If the responser is within my process, call it directly. This path
+      // doesn't create a request handler nor serialize the messages.
+      IRepHandlerPtr repHandler;
+      bool localResponserFound;
+      {
+        std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+        localResponserFound = this->Shared()->repliers.FirstHandler(
+          fullyQualifiedTopic, reqType, repType, repHandler);
+      }
+
+      if (localResponserFound)
+      {
+        _result = repHandler->RunLocalCachedCallback(_request, _reply);
+        return true;
+      }
+
+      // Create a new request handler. Its memory is recycled through a
+      // pool.
+      using HandlerT = ReqHandler<RequestT, ReplyT>;
+      auto reqHandlerPtr = std::allocate_shared<HandlerT>(
+        PoolAllocator<HandlerT>(), this->NodeUuid());
 
       // Insert the request's parameters.
       reqHandlerPtr->SetMessage(&_request);
       reqHandlerPtr->SetResponse(&_reply);
+      reqHandlerPtr->SetDeadline(std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(_timeout));
 
       std::unique_lock<std::recursive_mutex> lk(this->Shared()->mutex);
 
-      // If the responser is within my process.
-      IRepHandlerPtr repHandler;
-      if (this->Shared()->repliers.FirstHandler(fullyQualifiedTopic,
-        _request.GetTypeName(), _reply.GetTypeName(), repHandler))
-      {
-        // There is a responser in my process, let's use it.
-        _result = repHandler->RunLocalCallback(_request, _reply);
-        return true;
-      }
+      if (!this->Shared()->EnsureServices())
+        return false;
 
       // Store the request handler.
-      this->Shared()->requests.AddHandler(
-        fullyQualifiedTopic, this->NodeUuid(), reqHandlerPtr);
+      this->Shared()->requests.AddHandler(fullyQualifiedTopic,
+        reqHandlerPtr->NodeId(), reqHandlerPtr->HandlerId(), reqHandlerPtr);
 
       // If the responser's address is known, make the request.
       SrvAddresses_M addresses;
       if (this->Shared()->TopicPublishers(fullyQualifiedTopic, addresses))
       {
         this->Shared()->SendPendingRemoteReqs(fullyQualifiedTopic,
-          _request.GetTypeName(), _reply.GetTypeName());
+          reqType, repType);
       }
       else
       {
@@ -572,7 +810,7 @@ namespace ignition
         if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
         {
           std::cerr << "Node::Request(): Error discovering service ["
-                    << topic
+                    << this->RemappedTopic(_topic)
                     << "]. Did you forget to start the discovery service?"
                     << std::endl;
           return false;
@@ -582,9 +820,12 @@ namespace ignition
       // Wait until the REP is available.
       bool executed = reqHandlerPtr->WaitUntil(lk, _timeout);
 
-      // The request was not executed.
+      // The request was not executed, let the responser know.
       if (!executed)
+      {
+        this->Shared()->CancelRemoteReq(fullyQualifiedTopic, reqHandlerPtr);
         return false;
+      }
 
       // The request was executed but did not succeed.
       if (!reqHandlerPtr->Result())
@@ -618,6 +859,326 @@ namespace ignition
       return this->Request(_topic, req, _timeout, _reply, _result);
     }
 
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    RequestFuture<ReplyT> Node::RequestAsync(
+            const std::string &_topic,
+            const RequestT &_request)
+    {
+      static_assert(!std::is_same<ReplyT, msgs::Empty>::value,
+        "Remote responsers don't answer requests without output, use "
+        "Request(_topic, _request) instead");
+
+      auto state = std::make_shared<typename RequestFuture<ReplyT>::State>();
+
+      // The handler completes the state from the thread that receives the
+      // response, nobody waits on the handler itself.
+      std::function<void(const ReplyT &, const bool)> cb =
+        [state](const ReplyT &_reply, const bool _result)
+      {
+        state->Complete(true, &_reply, _result);
+      };
+
+      if (!this->Request(_topic, _request, cb))
+        state->Complete(false, nullptr, false);
+
+      return RequestFuture<ReplyT>(state);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename ReplyT>
+    RequestFuture<ReplyT> Node::RequestAsync(const std::string &_topic)
+    {
+      msgs::Empty req;
+      return this->RequestAsync<msgs::Empty, ReplyT>(_topic, req);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ChunkT>
+    bool Node::AdvertiseStream(
+      const std::string &_topic,
+      std::function<bool(const RequestT &,
+        const std::function<bool(const ChunkT &)> &)> _cb,
+      const AdvertiseServiceOptions &_options)
+    {
+      auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+      if (!fullyQualifiedTopicPtr)
+      {
+        std::cerr << "Service [" << this->RemappedTopic(_topic)
+                  << "] is not valid." << std::endl;
+        return false;
+      }
+      const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+      // Create a new streaming reply handler.
+      std::shared_ptr<StreamRepHandler<RequestT, ChunkT>> repHandlerPtr(
+        new StreamRepHandler<RequestT, ChunkT>());
+
+      // Insert the callback into the handler.
+      repHandlerPtr->SetCallback(_cb);
+      repHandlerPtr->SetMaxConcurrency(_options.MaxConcurrency());
+      repHandlerPtr->SetMaxQueue(_options.MaxQueue());
+
+      std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+      if (!this->Shared()->EnsureServices())
+        return false;
+
+      // Add the topic to the list of advertised services.
+      this->SrvsAdvertised().insert(fullyQualifiedTopic);
+
+      // Store the replier handler.
+      this->Shared()->repliers.AddHandler(
+        fullyQualifiedTopic, this->NodeUuid(), repHandlerPtr);
+
+      // Notify the discovery service to register and advertise my responser.
+      ServicePublisher publisher(fullyQualifiedTopic,
+        this->Shared()->myReplierAddress,
+        this->Shared()->replierId.ToString(),
+        this->Shared()->pUuid, this->NodeUuid(),
+        MessageTypeName<RequestT>(), MessageTypeName<ChunkT>(), _options);
+
+      if (!this->Shared()->AdvertisePublisher(publisher))
+      {
+        std::cerr << "Node::AdvertiseStream(): Error advertising service ["
+                  << this->RemappedTopic(_topic)
+                  << "]. Did you forget to start the discovery service?"
+                  << std::endl;
+        return false;
+      }
+
+      return true;
+    }
+
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ChunkT>
+    bool Node::RequestStream(
+      const std::string &_topic,
+      const RequestT &_request,
+      std::function<void(const ChunkT &)> _chunkCb,
+      std::function<void(const bool)> _doneCb)
+    {
+      auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+      if (!fullyQualifiedTopicPtr)
+      {
+        std::cerr << "Service [" << this->RemappedTopic(_topic)
+                  << "] is not valid." << std::endl;
+        return false;
+      }
+      const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+      bool localResponserFound;
+      IRepHandlerPtr repHandler;
+      {
+        std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+        localResponserFound = this->Shared()->repliers.FirstHandler(
+              fullyQualifiedTopic,
+              MessageTypeName<RequestT>(),
+              MessageTypeName<ChunkT>(),
+              repHandler);
+      }
+
+      // If the responser is within my process.
+      if (localResponserFound)
+      {
+        bool result;
+        if (repHandler->Streaming())
+        {
+          result = repHandler->RunLocalStreamCallback(_request,
+            [&_chunkCb](const transport::ProtoMsg &_chunk)
+            {
+#if GOOGLE_PROTOBUF_VERSION > 2999999
+              auto chunk = google::protobuf::down_cast<const ChunkT*>(&_chunk);
+#else
+              auto chunk =
+                google::protobuf::internal::down_cast<const ChunkT*>(&_chunk);
+#endif
+              if (_chunkCb)
+                _chunkCb(*chunk);
+              return true;
+            });
+        }
+        else
+        {
+          // The reply of a regular service is its only chunk.
+          ChunkT rep;
+          result = repHandler->RunLocalCachedCallback(_request, rep);
+          if (result && _chunkCb)
+            _chunkCb(rep);
+        }
+
+        if (_doneCb)
+          _doneCb(result);
+        return true;
+      }
+
+      // Create a new streaming request handler. Its memory is recycled
+      // through a pool.
+      using HandlerT = StreamReqHandler<RequestT, ChunkT>;
+      auto reqHandlerPtr = std::allocate_shared<HandlerT>(
+        PoolAllocator<HandlerT>(), this->NodeUuid());
+
+      // Insert the request's parameters.
+      reqHandlerPtr->SetMessage(&_request);
+
+      // Insert the callbacks into the handler.
+      reqHandlerPtr->SetCallbacks(_chunkCb, _doneCb);
+
+      std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+      if (!this->Shared()->EnsureServices())
+        return false;
+
+      // Store the request handler.
+      this->Shared()->requests.AddHandler(fullyQualifiedTopic,
+        reqHandlerPtr->NodeId(), reqHandlerPtr->HandlerId(), reqHandlerPtr);
+
+      // If the responser's address is known, make the request.
+      SrvAddresses_M addresses;
+      if (this->Shared()->TopicPublishers(fullyQualifiedTopic, addresses))
+      {
+        this->Shared()->SendPendingRemoteReqs(fullyQualifiedTopic,
+          MessageTypeName<RequestT>(), MessageTypeName<ChunkT>());
+      }
+      else
+      {
+        // Discover the service responser.
+        if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
+        {
+          std::cerr << "Node::RequestStream(): Error discovering service ["
+                    << this->RemappedTopic(_topic)
+                    << "]. Did you forget to start the discovery service?"
+                    << std::endl;
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    bool Node::RequestAll(
+            const std::string &_topic,
+            const std::vector<RequestT> &_requests,
+            const unsigned int &_timeout,
+            std::vector<ReplyT> &_replies,
+            std::vector<bool> &_results)
+    {
+      _replies.assign(_requests.size(), ReplyT());
+      _results.assign(_requests.size(), false);
+
+      auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+      if (!fullyQualifiedTopicPtr)
+      {
+        std::cerr << "Service [" << this->RemappedTopic(_topic)
+                  << "] is not valid." << std::endl;
+        return false;
+      }
+      const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+      if (_requests.empty())
+        return true;
+
+      const std::string &reqType = MessageTypeName<RequestT>();
+      const std::string &repType = MessageTypeName<ReplyT>();
+
+      std::unique_lock<std::recursive_mutex> lk(this->Shared()->mutex);
+
+      // If the responser is within my process.
+      IRepHandlerPtr repHandler;
+      if (this->Shared()->repliers.FirstHandler(fullyQualifiedTopic,
+        reqType, repType, repHandler))
+      {
+        // There is a responser in my process, let's use it.
+        for (std::size_t i = 0; i < _requests.size(); ++i)
+        {
+          _results[i] =
+            repHandler->RunLocalCachedCallback(_requests[i], _replies[i]);
+        }
+        return true;
+      }
+
+      if (!this->Shared()->EnsureServices())
+        return false;
+
+      // Store all the request handlers before sending any request.
+      const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(_timeout);
+      std::vector<std::shared_ptr<ReqHandler<RequestT, ReplyT>>> handlers;
+      handlers.reserve(_requests.size());
+      for (std::size_t i = 0; i < _requests.size(); ++i)
+      {
+        using HandlerT = ReqHandler<RequestT, ReplyT>;
+        auto reqHandlerPtr = std::allocate_shared<HandlerT>(
+          PoolAllocator<HandlerT>(), this->NodeUuid());
+        reqHandlerPtr->SetMessage(&_requests[i]);
+        reqHandlerPtr->SetResponse(&_replies[i]);
+        reqHandlerPtr->SetDeadline(deadline);
+        this->Shared()->requests.AddHandler(fullyQualifiedTopic,
+          reqHandlerPtr->NodeId(), reqHandlerPtr->HandlerId(), reqHandlerPtr);
+        handlers.push_back(reqHandlerPtr);
+      }
+
+      // If the responser's address is known, send all the requests.
+      SrvAddresses_M addresses;
+      if (this->Shared()->TopicPublishers(fullyQualifiedTopic, addresses))
+      {
+        this->Shared()->SendPendingRemoteReqs(fullyQualifiedTopic,
+          reqType, repType);
+      }
+      else
+      {
+        // Discover the service responser.
+        if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
+        {
+          std::cerr << "Node::RequestAll(): Error discovering service ["
+                    << this->RemappedTopic(_topic)
+                    << "]. Did you forget to start the discovery service?"
+                    << std::endl;
+          for (auto &reqHandlerPtr : handlers)
+          {
+            this->Shared()->requests.RemoveHandler(fullyQualifiedTopic,
+              reqHandlerPtr->NodeId(), reqHandlerPtr->HandlerId());
+          }
+          return false;
+        }
+      }
+
+      // Wait until all the REPs are available or the timeout expires.
+      bool allExecuted = true;
+      for (std::size_t i = 0; i < handlers.size(); ++i)
+      {
+        auto &reqHandlerPtr = handlers[i];
+        const auto remaining = std::max(std::chrono::milliseconds(0),
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()));
+
+        if (!reqHandlerPtr->WaitUntil(lk,
+              static_cast<unsigned int>(remaining.count())))
+        {
+          // Stop waiting for this response.
+          this->Shared()->CancelRemoteReq(fullyQualifiedTopic,
+            reqHandlerPtr);
+          allExecuted = false;
+          continue;
+        }
+
+        // Parse the response if the request succeeded.
+        if (reqHandlerPtr->Result() &&
+            !_replies[i].ParseFromString(reqHandlerPtr->Response()))
+        {
+          std::cerr << "Node::RequestAll(): Error Parsing the response"
+                    << std::endl;
+          continue;
+        }
+
+        _results[i] = reqHandlerPtr->Result();
+      }
+
+      return allExecuted;
+    }
+
     //////////////////////////////////////////////////
     template<typename RequestT>
     bool Node::Request(
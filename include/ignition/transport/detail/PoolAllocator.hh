@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_DETAIL_POOLALLOCATOR_HH_
+#define IGN_TRANSPORT_DETAIL_POOLALLOCATOR_HH_
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class BlockFreeList PoolAllocator.hh
+    /// ignition/transport/detail/PoolAllocator.hh
+    /// \brief Process wide free list of memory blocks of the same size.
+    /// Released blocks are kept, up to a limit, and handed out again
+    /// instead of going back to the heap.
+    template<std::size_t Size>
+    class BlockFreeList
+    {
+      /// \brief Maximum number of idle blocks kept.
+      public: static constexpr std::size_t kMaxFreeBlocks = 256;
+
+      /// \brief Get the free list of this block size.
+      /// \return The free list.
+      public: static BlockFreeList &Instance()
+      {
+        // Never destroyed, blocks can be released during the static
+        // destruction.
+        static BlockFreeList *list = new BlockFreeList();
+        return *list;
+      }
+
+      /// \brief Get a block, from the free list if possible.
+      /// \return A block of Size bytes.
+      public: void *Allocate()
+      {
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          if (!this->blocks.empty())
+          {
+            void *block = this->blocks.back();
+            this->blocks.pop_back();
+            return block;
+          }
+        }
+        return ::operator new(Size);
+      }
+
+      /// \brief Return a block to the free list, or to the heap if the free
+      /// list is full.
+      /// \param[in] _block A block returned by Allocate().
+      public: void Deallocate(void *_block)
+      {
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          if (this->blocks.size() < kMaxFreeBlocks)
+          {
+            this->blocks.push_back(_block);
+            return;
+          }
+        }
+        ::operator delete(_block);
+      }
+
+      /// \brief Number of idle blocks.
+      /// \return The number of blocks in the free list.
+      public: std::size_t FreeCount()
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        return this->blocks.size();
+      }
+
+      /// \brief Constructor. Use Instance() instead.
+      private: BlockFreeList()
+      {
+        this->blocks.reserve(kMaxFreeBlocks);
+      }
+
+      /// \brief Protects the free list.
+      private: std::mutex mutex;
+
+      /// \brief Idle blocks.
+      private: std::vector<void *> blocks;
+    };
+
+    /// \class PoolAllocator PoolAllocator.hh
+    /// ignition/transport/detail/PoolAllocator.hh
+    /// \brief Allocator that recycles the memory of single objects through a
+    /// BlockFreeList. Used with std::allocate_shared() for objects created
+    /// at a high rate, such as the service request handlers: the object
+    /// and its control block come from one recycled block.
+    template<typename T>
+    class PoolAllocator
+    {
+      /// \brief Allocated type.
+      public: using value_type = T;
+
+      /// \brief Default constructor.
+      public: PoolAllocator() = default;
+
+      /// \brief Conversion from an allocator of another type.
+      public: template<typename U>
+      PoolAllocator(const PoolAllocator<U> &) noexcept
+      {
+      }
+
+      /// \brief Allocate memory for _n objects.
+      /// \param[in] _n Number of objects.
+      /// \return The memory.
+      public: T *allocate(const std::size_t _n)
+      {
+        if (_n != 1u)
+          return static_cast<T *>(::operator new(_n * sizeof(T)));
+
+        return static_cast<T *>(
+          BlockFreeList<sizeof(T)>::Instance().Allocate());
+      }
+
+      /// \brief Release memory returned by allocate().
+      /// \param[in] _p The memory.
+      /// \param[in] _n Number of objects.
+      public: void deallocate(T *_p, const std::size_t _n)
+      {
+        if (_n != 1u)
+        {
+          ::operator delete(_p);
+          return;
+        }
+
+        BlockFreeList<sizeof(T)>::Instance().Deallocate(_p);
+      }
+    };
+
+    /// \brief All the pool allocators are interchangeable.
+    template<typename T, typename U>
+    bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &)
+    {
+      return true;
+    }
+
+    /// \brief All the pool allocators are interchangeable.
+    template<typename T, typename U>
+    bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &)
+    {
+      return false;
+    }
+    }
+  }
+}
+
+#endif
@@ -18,7 +18,9 @@
 #ifndef IGNITION_TRANSPORT_LOG_BATCH_HH_
 #define IGNITION_TRANSPORT_LOG_BATCH_HH_
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Export.hh>
@@ -71,6 +73,20 @@ namespace ignition
         ///   to a valid message
         public: iterator end();
 
+        /// \brief Partition the messages into disjoint batches, which can
+        ///   be iterated by different threads at once. Together they hold
+        ///   the messages of this batch, each of them once, and the messages
+        ///   of a batch keep their order, but there is no order between the
+        ///   batches.
+        /// \remarks The messages of a SQLite3 log are split by their row
+        ///   id, and each batch reads the file through its own connection,
+        ///   except for the in-memory databases, which can only be shared.
+        ///   The messages of a chunked log are split by time received, and
+        ///   the downsampling of a topic restarts at each split.
+        /// \param[in] _count Number of batches.
+        /// \return _count batches, some of them possibly empty.
+        public: std::vector<Batch> Split(const std::size_t _count) const;
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::*
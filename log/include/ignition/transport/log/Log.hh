@@ -19,9 +19,13 @@
 #define IGNITION_TRANSPORT_LOG_LOG_HH_
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <ios>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Batch.hh>
@@ -41,6 +45,183 @@ namespace ignition
       /// \brief Name of Environment variable containing path to schema
       const std::string SchemaLocationEnvVar = "IGN_TRANSPORT_LOG_SQL_PATH";
 
+      /// \brief Extension of the log files that Log::Open() creates in the
+      /// chunked format by default.
+      const std::string ChunkedLogExtension = ".clog";
+
+      /// \brief Storage formats of a log file.
+      enum class LogFormat
+      {
+        /// \brief A SQLite3 database, one row per message.
+        SQLITE,
+
+        /// \brief An append-only file of compressed chunks of messages,
+        /// followed by an index of their time ranges and topics. It's much
+        /// cheaper to write, but it can't be modified after recording.
+        CHUNKED,
+
+        /// \brief A manifest listing the segments of a recording rotated by
+        /// the Recorder, read as one log. Each segment is a log file in one
+        /// of the other formats. It can only be opened for reading.
+        SEGMENTED,
+
+        /// \brief A manifest listing the shards of a recording split by
+        /// topic by the Recorder, see Recorder::AddShard(). The shards were
+        /// recorded at the same time, so they are read as one log whose
+        /// messages are merged by time received. Each shard is a log file in
+        /// the SQLITE or CHUNKED format. It can only be opened for reading.
+        SHARDED
+      };
+
+      /// \brief Settings of the SQLite3 database of a log, applied with
+      /// PRAGMA statements by Log::Open(). The default values keep the
+      /// defaults of SQLite3. They don't change the schema, and they are
+      /// ignored by the chunked logs, which compress all of their chunks
+      /// when zlib is available.
+      struct IGNITION_TRANSPORT_LOG_VISIBLE LogOpenOptions
+      {
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::string
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+        /// \brief Journal mode: DELETE, TRUNCATE, PERSIST, MEMORY, WAL or
+        /// OFF. Only applied when writing. A log recorded in WAL mode is
+        /// switched back to DELETE when it's closed, so that it can be read
+        /// from a read-only location.
+        std::string journalMode;
+
+        /// \brief Synchronous mode: OFF, NORMAL, FULL or EXTRA.
+        std::string synchronous;
+
+        /// \brief Topics whose messages are compressed, with zlib, mapped
+        /// to a preset dictionary of data typical of their messages, which
+        /// may be empty. A dictionary helps most with small messages, which
+        /// don't compress well on their own. Only applied to the topics
+        /// created while writing. Opening a log with compressed topics
+        /// fails if zlib was not available at build time. The messages are
+        /// decompressed by the queries.
+        std::map<std::string, std::string> compressedTopics;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+        /// \brief Size of the page cache, in pages if positive or in KiB if
+        /// negative. Zero keeps the default.
+        int64_t cacheSize = 0;
+
+        /// \brief Maximum number of bytes of the file to memory map. A
+        /// negative value keeps the default.
+        int64_t mmapSize = -1;
+
+        /// \brief Page size in bytes, a power of two between 512 and 65536.
+        /// Only applied when the log is created. Zero keeps the default.
+        int64_t pageSize = 0;
+
+        /// \brief Milliseconds to retry for when the database is locked by
+        /// another connection, e.g. by a Recorder committing a transaction to
+        /// a log that isn't in WAL mode. Zero fails at once.
+        int64_t busyTimeout = 0;
+
+        /// \brief Build the index of the messages by time received in bulk,
+        /// when the log is closed or on the first QueryMessages(), instead
+        /// of updating it on every insertion. Only applied when the log is
+        /// created. A log that isn't closed properly has no time index, so
+        /// its queries are slower.
+        bool deferTimeIndex = false;
+
+        /// \brief Options for recording: write-ahead logging without a sync
+        /// per transaction, large pages for message blobs, a 64 MiB cache and
+        /// a deferred time index.
+        /// A power failure may lose the last transactions, but doesn't
+        /// corrupt the log.
+        /// \return The options.
+        static LogOpenOptions WriteOptimized();
+
+        /// \brief Options for playback: a 64 MiB cache, the file memory
+        /// mapped up to the limit of the SQLite3 build, 2 GiB by default, and
+        /// a busy timeout of a second. The messages that fit in a page of a
+        /// mapped file are read without a copy, see Message::DataView().
+        /// \return The options.
+        static LogOpenOptions ReadOptimized();
+      };
+
+      /// \brief A message to insert with Log::InsertMessages(). It refers
+      /// to the caller's data, which must outlive the call.
+      struct MessageRecord
+      {
+        /// \brief Time the message was received (ns since Unix epoch)
+        std::chrono::nanoseconds time;
+
+        /// \brief Name of the topic the message was on
+        const std::string *topic;
+
+        /// \brief Name of the message type
+        const std::string *type;
+
+        /// \brief Pointer to a buffer containing the message data
+        const void *data;
+
+        /// \brief Number of bytes of data
+        std::size_t len;
+
+        /// \brief True if the data are already compressed like the log
+        /// compresses the messages of their topic, see
+        /// LogOpenOptions::compressedTopics, e.g. by the Recorder's encode
+        /// workers. The message is skipped if its topic isn't compressed.
+        bool compressed = false;
+
+        /// \brief Stamp of the header of the message, e.g. read by the
+        /// Recorder, see TimeRangeOption::TimeReference::HEADER, or nullptr
+        /// if it has none. The SQLite3 logs store it, the chunked logs
+        /// don't.
+        const std::chrono::nanoseconds *headerTime = nullptr;
+      };
+
+      /// \brief Messages of a topic in a log, see Log::TopicSummaries().
+      struct TopicSummary
+      {
+        /// \brief Name of the topic
+        std::string topic;
+
+        /// \brief Name of the message type
+        std::string type;
+
+        /// \brief Number of messages
+        uint64_t messageCount = 0;
+
+        /// \brief Time the first message was received (ns since Unix epoch)
+        std::chrono::nanoseconds startTime{0};
+
+        /// \brief Time the last message was received (ns since Unix epoch)
+        std::chrono::nanoseconds endTime{0};
+
+        /// \brief Bytes of message data stored in the log, after the
+        /// compression of the compressed topics. The chunked logs count the
+        /// messages as they were recorded.
+        uint64_t totalBytes = 0;
+      };
+
+      /// \brief Contents of a log, see Log::Summary().
+      struct LogSummary
+      {
+        /// \brief Summary of each topic with messages
+        std::vector<TopicSummary> topics;
+
+        /// \brief Number of messages
+        uint64_t messageCount = 0;
+
+        /// \brief Bytes of message data, see TopicSummary::totalBytes
+        uint64_t totalBytes = 0;
+
+        /// \brief Time the first message was received (ns since Unix epoch)
+        std::chrono::nanoseconds startTime{0};
+
+        /// \brief Time the last message was received (ns since Unix epoch)
+        std::chrono::nanoseconds endTime{0};
+      };
+
       /// \brief Interface to a log file
       class IGNITION_TRANSPORT_LOG_VISIBLE Log
       {
@@ -63,7 +244,18 @@ namespace ignition
         /// \return empty string if the log has not been opened
         public: std::string Version() const;
 
-        /// \brief Open a log file
+        /// \brief Open a log file. When reading, the format is detected
+        /// from the content of the file, and a manifest of segments (see
+        /// Recorder::SetMaxSegmentSize()) opens all of them as one log, in
+        /// the order they were recorded. When writing, files ending with
+        /// ChunkedLogExtension are created in the chunked format and the
+        /// others in the SQLite3 format.
+        ///
+        /// The SQLite3 logs opened for writing are migrated to the latest
+        /// schema. Opened with (in | out), an existing SQLite3 log keeps its
+        /// messages and gets the indexes added since it was recorded, which
+        /// takes a while on a large log. The logs opened read only are used
+        /// as they are.
         /// \param[in] _file path to log file
         /// \param[in] _mode flag indicating read only or read/write
         ///   Can use (in or out)
@@ -72,6 +264,35 @@ namespace ignition
         public: bool Open(const std::string &_file,
             std::ios_base::openmode _mode = std::ios_base::in);
 
+        /// \brief Open a log file with the given settings. The format is
+        /// selected like in Open(const std::string &, std::ios_base::openmode).
+        /// \param[in] _file path to log file
+        /// \param[in] _mode flag indicating read only or read/write
+        ///   Can use (in or out)
+        /// \param[in] _options Settings of the database.
+        /// \return True if the log file was successfully opened, false
+        /// otherwise.
+        public: bool Open(const std::string &_file,
+            std::ios_base::openmode _mode, const LogOpenOptions &_options);
+
+        /// \brief Open a log file in a given format.
+        /// \param[in] _file path to log file
+        /// \param[in] _mode flag indicating read only or read/write
+        ///   Can use (in or out). A chunked log opened for writing is
+        ///   created from scratch.
+        /// \param[in] _format Storage format of the file.
+        /// \param[in] _options Settings of the database.
+        /// \return True if the log file was successfully opened, false
+        /// otherwise.
+        public: bool Open(const std::string &_file,
+            std::ios_base::openmode _mode, LogFormat _format,
+            const LogOpenOptions &_options = LogOpenOptions());
+
+        /// \brief Get the storage format of the opened log.
+        /// \return The format. It's LogFormat::SQLITE if the log has not
+        /// been opened.
+        public: LogFormat Format() const;
+
         /// \brief Get the name of the log file.
         /// \return The name of the log file, or an empty string if Open has
         /// not been successfully called.
@@ -96,6 +317,28 @@ namespace ignition
             const std::string &_topic, const std::string &_type,
             const void *_data, std::size_t _len);
 
+        /// \brief Insert several messages into the log file. They are
+        /// inserted in the same transaction, several rows per statement,
+        /// which is much faster than inserting them one by one.
+        /// \param[in] _messages The messages, in the order to insert them.
+        /// \return The number of messages inserted. Empty messages are not
+        /// inserted.
+        public: std::size_t InsertMessages(
+            const std::vector<MessageRecord> &_messages);
+
+        /// \brief Insert the messages of another log file, e.g. to merge
+        /// logs or to cut a time range out of one. Between SQLite3 logs, the
+        /// messages are copied by the database as they are stored, without
+        /// being decoded or compressed again, in a single transaction; this
+        /// fails if a topic is compressed differently in both logs.
+        /// Otherwise the messages are read and inserted in batches.
+        /// \param[in] _file Path to the log file to insert. It can't be the
+        /// file of this log.
+        /// \param[in] _range Time range of the messages to insert.
+        /// \return The number of messages inserted, or -1 on failure.
+        public: int64_t InsertLog(const std::string &_file,
+            const QualifiedTimeRange &_range = QualifiedTimeRange::AllTime());
+
         /// \brief Get messages according to the specified options. By default,
         /// it will query all messages over the entire time range of the log.
         /// \param[in] _options A QueryOptions type to indicate what kind of
@@ -104,6 +347,26 @@ namespace ignition
         public: Batch QueryMessages(
             const QueryOptions &_options = AllTopics());
 
+        /// \brief Get the messages inserted into the log since the previous
+        /// call, to follow a log while it's recorded by another process.
+        /// The first call returns the messages inserted so far. The messages
+        /// are returned in the order they were inserted, which is the order
+        /// they were received except for the topics compressed by the encode
+        /// workers of the Recorder. The new topics are added to the
+        /// Descriptor, and the start and end times are read again.
+        ///
+        /// Open the log with LogOpenOptions::ReadOptimized() to wait for the
+        /// transactions of the Recorder instead of failing. A log recorded
+        /// in WAL mode, see LogOpenOptions::WriteOptimized(), is read while
+        /// the Recorder writes it.
+        /// \param[in] _options The messages to return. DownsampledTopics is
+        /// not supported. Calls with different options still share the
+        /// position in the log.
+        /// \return A Batch of the new messages. It's empty if there are none,
+        /// or if the log is chunked or segmented, which can't be followed.
+        public: Batch FollowMessages(
+            const QueryOptions &_options = AllTopics());
+
         /// \brief Get start time of the log, or in other words the
         /// time of the first message found in the log
         /// \return start time of the log, or zero if the log is not
@@ -116,6 +379,36 @@ namespace ignition
         /// valid or if data retrieval failed.
         public: std::chrono::nanoseconds EndTime() const;
 
+        /// \brief Get the number of messages and the time range of each
+        /// topic of the log. The SQLite3 logs keep them up to date while
+        /// recording, so they are read at once, the chunked logs and the
+        /// SQLite3 logs recorded by older versions are read entirely.
+        /// \return A summary of each topic with messages, or an empty list
+        /// if the log is not valid or if data retrieval failed.
+        public: std::vector<TopicSummary> TopicSummaries() const;
+
+        /// \brief Get the number of messages, the size and the time range of
+        /// the log and of each of its topics, from TopicSummaries().
+        /// \return The summary, empty if the log is not valid or if data
+        /// retrieval failed.
+        public: LogSummary Summary() const;
+
+        /// \brief Get times that split the messages of the log into windows
+        /// of about _stride messages, to read a long log one window at a
+        /// time. A query over a few topics and a time range sorts all of its
+        /// messages before returning the first one, so a query over a window
+        /// returns much sooner than one until the end of the log. The index
+        /// of an SQLite3 log is built from its time index the first time,
+        /// and kept until the log is closed. The chunked logs are already
+        /// read one chunk at a time, they have no index.
+        /// \param[in] _stride Number of messages between two times.
+        /// \return The times, in increasing order. Each one is the time of
+        /// a message, the messages before the first one and after the last
+        /// one are in windows too. Empty if the log is too short to be split,
+        /// is not valid or if data retrieval failed.
+        public: std::vector<std::chrono::nanoseconds> SeekIndex(
+            std::size_t _stride = 4096) const;
+
         /// \internal Implementation for this class
         private: class Implementation;
 
@@ -20,6 +20,7 @@
 #include <chrono>
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Export.hh>
@@ -61,6 +62,21 @@ namespace ignition
             const char *_type, std::size_t _typeLen,
             const char *_topic, std::size_t _topicLen);
 
+        /// \brief Construct with data, referring to the names of the topic
+        /// instead of copying them.
+        /// \internal
+        /// References and pointers are borrowed, and must be kept alive by
+        /// the creator for as long as an instance lives.
+        /// \param[in] _timeRecv time the message was received
+        /// \param[in] _data the serialized message
+        /// \param[in] _dataLen number of bytes in _data
+        /// \param[in] _type the name of the message type
+        /// \param[in] _topic the name of the topic the message was published to
+        public: Message(
+            const std::chrono::nanoseconds &_timeRecv,
+            const void *_data, std::size_t _dataLen,
+            const std::string &_type, const std::string &_topic);
+
         /// \brief No move constructor to prevent borrowed pointers from
         /// living beyond creator's expectations.
         public: Message(Message && _other) = delete;
@@ -76,13 +92,21 @@ namespace ignition
         /// \return The raw data for this message
         public: std::string Data() const;
 
+        /// \brief Get the message data without copying it
+        /// \return A view of the raw data for this message. It refers to the
+        /// memory of the iterator that produced this message, and is only
+        /// valid until the iterator advances.
+        public: std::string_view DataView() const;
+
         /// \brief Get the message type as a string
-        /// \return The message type name
-        public: std::string Type() const;
+        /// \return The message type name. Like DataView(), it refers to the
+        /// memory of the iterator that produced this message.
+        public: const std::string &Type() const;
 
         /// \brief Get the Topic name as a string
-        /// \return The topic for the message
-        public: std::string Topic() const;
+        /// \return The topic for the message. Like DataView(), it refers to
+        /// the memory of the iterator that produced this message.
+        public: const std::string &Topic() const;
 
         /// \brief Return the time the message was received
         /// \return The time the message was received
@@ -18,13 +18,21 @@
 #define IGNITION_TRANSPORT_LOG_PLAYBACK_HH_
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <regex>
+#include <set>
 #include <string>
+#include <vector>
 
+#include <ignition/transport/Clock.hh>
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Export.hh>
+#include <ignition/transport/MessageInfo.hh>
 #include <ignition/transport/NodeOptions.hh>
+#include <ignition/transport/TransportTypes.hh>
 
 namespace ignition
 {
@@ -39,6 +47,21 @@ namespace ignition
       class PlaybackHandle;
       using PlaybackHandlePtr = std::shared_ptr<PlaybackHandle>;
 
+      /// \brief How late the messages of a playback were published, compared
+      /// to the time they were due, see PlaybackHandle::JitterStats(). The
+      /// messages published without waiting aren't measured.
+      struct PlaybackJitterStats
+      {
+        /// \brief Number of messages measured
+        uint64_t samples = 0;
+
+        /// \brief Average delay of the messages measured
+        std::chrono::nanoseconds mean{0};
+
+        /// \brief Largest delay of the messages measured
+        std::chrono::nanoseconds max{0};
+      };
+
       //////////////////////////////////////////////////
       /// \brief Initiates playback of ignition transport topics
       /// This class makes it easy to play topics from a log file
@@ -51,6 +74,17 @@ namespace ignition
         public: explicit Playback(const std::string &_file,
                                const NodeOptions &_nodeOptions = NodeOptions());
 
+        /// \brief Constructor of the playback of several logs as one
+        /// timeline, e.g. logs recorded separately on several robots. Their
+        /// messages are merged by the time they were received and published
+        /// by one playback thread, so Seek(), Step() and Pause() of the
+        /// PlaybackHandle apply to every log at once. The logs must have
+        /// been recorded with clocks in sync.
+        /// \param[in] _files paths to the log files
+        /// \param[in] _nodeOptions Options of the node publishing the topics
+        public: explicit Playback(const std::vector<std::string> &_files,
+                               const NodeOptions &_nodeOptions = NodeOptions());
+
         /// \brief move constructor
         /// \param[in] _old the instance being moved into this one
         public: Playback(Playback &&_old);  // NOLINT
@@ -69,7 +103,8 @@ namespace ignition
         /// \note The topic discovery process will need some time before
         /// publishing begins, or else subscribers in other processes will miss
         /// the outgoing messages. The default value is recommended unless you
-        /// are confident in the timing of your system.
+        /// are confident in the timing of your system, or the subscribers are
+        /// known, see SetExpectedSubscribers().
         ///
         /// \remark If your application uses another library that uses sqlite3,
         /// it may be unsafe to start multiple simultaneous PlaybackHandles from
@@ -92,8 +127,26 @@ namespace ignition
             std::chrono::seconds(1),
             bool _msgWaiting = true) const;
 
+        /// \brief Begin playing messages, paced by a clock instead of the
+        /// steady clock of the system, e.g. a NetworkClock following the
+        /// time of a simulator. The playback waits for the clock to be
+        /// ready, then publishes each message once the clock has advanced
+        /// as much as the time between the messages, divided by the rate of
+        /// the playback.
+        /// \param[in] _clock The clock. It must outlive the playback.
+        /// \param[in] _waitAfterAdvertising How long to wait before the
+        /// publications begin after advertising the topics that will be played
+        /// back, on the steady clock.
+        /// \return A handle for managing the playback of the log, or nullptr
+        /// if an error prevents the playback from starting.
+        /// \sa Start(const std::chrono::nanoseconds &, bool) const
+        public: [[nodiscard]] PlaybackHandlePtr Start(const Clock *_clock,
+          const std::chrono::nanoseconds &_waitAfterAdvertising =
+            std::chrono::seconds(1)) const;
+
         /// \brief Check if this Playback object has a valid log to play back
         /// \return true if this has a valid log to play back, otherwise false.
+        /// With several logs, false if any of them couldn't be opened.
         public: bool Valid() const;
 
         /// \brief Add a topic to be played back (exact match only)
@@ -135,6 +188,131 @@ namespace ignition
         /// due to this function call.
         public: int64_t RemoveTopic(const std::regex &_topic);
 
+        /// \brief Publish the messages from several threads, so that the
+        /// large messages of a topic don't delay the messages of the others.
+        /// Each topic is published by one of the threads, in order, when the
+        /// playback reaches its messages. Applies to the playbacks started
+        /// afterwards.
+        /// \param[in] _count Number of threads. Zero (the default) publishes
+        /// every message from the thread of the playback.
+        public: void SetPublisherThreads(std::size_t _count);
+
+        /// \brief Get the number of threads publishing the messages.
+        /// \return The number of threads.
+        /// \sa SetPublisherThreads()
+        public: std::size_t PublisherThreads() const;
+
+        /// \brief Start the publications as soon as some topics have
+        /// subscribers, as told by Node::Publisher::HasConnections(), instead
+        /// of after the fixed wait of Start(). The wait given to Start() is
+        /// then the longest wait, after which the playback starts anyway.
+        /// Applies to the playbacks started afterwards.
+        /// \param[in] _topics Topics expected to have subscribers. The ones
+        /// that aren't played back are ignored, and the playback starts
+        /// right away if none is. Empty (the default) for the fixed wait.
+        /// With a fan-out, each topic is waited for in every partition.
+        public: void SetExpectedSubscribers(
+            const std::set<std::string> &_topics);
+
+        /// \brief Get the topics expected to have subscribers.
+        /// \return The topics.
+        /// \sa SetExpectedSubscribers()
+        public: const std::set<std::string> &ExpectedSubscribers() const;
+
+        /// \brief Choose the thread publishing a topic. The topics that
+        /// aren't assigned are spread over the threads that have no assigned
+        /// topics, or over all of them if every thread has some.
+        /// \param[in] _topic Name of the topic.
+        /// \param[in] _thread Index of the thread, below PublisherThreads().
+        /// \return False if there's no such thread.
+        public: bool SetTopicPublisherThread(const std::string &_topic,
+            std::size_t _thread);
+
+        /// \brief Publish each message played back in several partitions or
+        /// namespaces at once, e.g. to replay a log into isolated test
+        /// environments. One node is created with each of the options, and
+        /// advertises every topic played back. The log is still read once,
+        /// and the paused, stepped or sought playback applies to every node.
+        /// Applies to the playbacks started afterwards.
+        /// \param[in] _nodeOptions Options of each node. Empty (the default)
+        /// for the single node of the options given to the constructor.
+        public: void SetFanOut(const std::vector<NodeOptions> &_nodeOptions);
+
+        /// \brief Get the options of the nodes publishing the messages.
+        /// \return The options, empty for the single node of the options
+        /// given to the constructor.
+        /// \sa SetFanOut()
+        public: const std::vector<NodeOptions> &FanOut() const;
+
+        /// \brief Deliver the messages of a topic to a callback of this
+        /// process, straight from the messages read ahead, instead of
+        /// publishing them. Once a direct subscriber is added, the playbacks
+        /// started afterwards only deliver the topics played back that have
+        /// direct subscribers, in the order of the logs, and create no node,
+        /// so Start() doesn't wait after advertising. The messages of a
+        /// topic go to its callbacks in the order they were added.
+        /// \param[in] _topic Name of the topic, as recorded.
+        /// \param[in] _callback The callback. MessageInfo::Topic() and
+        /// MessageInfo::Type() tell the message, which is marked as
+        /// intra-process.
+        /// \return False if the logs aren't valid or the topic isn't in them.
+        /// \sa SetSynchronous()
+        public: bool AddDirectSubscriber(const std::string &_topic,
+            const RawCallback &_callback);
+
+        /// \brief Deliver the messages of a topic to a typed callback of
+        /// this process, see AddDirectSubscriber(const std::string &,
+        /// const RawCallback &). The messages recorded with another type are
+        /// skipped.
+        /// \param[in] _topic Name of the topic, as recorded.
+        /// \param[in] _callback The callback.
+        /// \return False if the logs aren't valid or the topic isn't in them.
+        public: template<typename MessageT>
+        bool AddDirectSubscriber(const std::string &_topic,
+            std::function<void(const MessageT &_msg,
+                               const MessageInfo &_info)> _callback)
+        {
+          const std::string type = MessageT().GetTypeName();
+          return this->AddDirectSubscriber(_topic,
+            [_callback, type](const char *_data, const size_t _size,
+                              const MessageInfo &_info)
+            {
+              if (_info.Type() != type)
+                return;
+              MessageT msg;
+              if (msg.ParseFromArray(_data, static_cast<int>(_size)))
+                _callback(msg, _info);
+            });
+        }
+
+        /// \brief Run the direct subscribers from the thread calling
+        /// Start(), as fast as possible and without publisher threads, so
+        /// that Start() returns once every message was delivered and the
+        /// deliveries are reproducible, e.g. in tests driven by a log. The
+        /// handle returned is then finished. Has no effect without direct
+        /// subscribers. Applies to the playbacks started afterwards.
+        /// \param[in] _synchronous True to run them from Start(). False (the
+        /// default) runs them from the thread of the playback, paced as the
+        /// publications.
+        /// \sa AddDirectSubscriber()
+        public: void SetSynchronous(bool _synchronous);
+
+        /// \brief Whether the direct subscribers run from Start().
+        /// \return True if they do.
+        /// \sa SetSynchronous()
+        public: bool Synchronous() const;
+
+        /// \brief Begin playing messages.
+        /// \param[in] _waitAfterAdvertising See Start().
+        /// \param[in] _msgWaiting See Start().
+        /// \param[in] _clock Clock pacing the playback, nullptr for the
+        /// steady clock.
+        /// \return The handle of the playback, or nullptr if it couldn't
+        /// start.
+        private: PlaybackHandlePtr StartPlayback(
+            const std::chrono::nanoseconds &_waitAfterAdvertising,
+            bool _msgWaiting, const Clock *_clock) const;
+
         /// \internal Implementation of this class
         private: class Implementation;
 
@@ -170,7 +348,8 @@ namespace ignition
 
         /// \brief Step the playback by a given amount of nanoseconds
         /// \pre Playback must be previously paused
-        /// \param[in] _stepDuration Length of the step in nanoseconds
+        /// \param[in] _stepDuration Length of the step in nanoseconds. A
+        /// negative step jumps back, like Seek(), and stays paused.
         public: void Step(const std::chrono::nanoseconds &_stepDuration);
 
         /// \brief Pauses the playback
@@ -182,6 +361,57 @@ namespace ignition
         /// \brief Check pause status
         public: bool IsPaused() const;
 
+        /// \brief Set how fast the messages are played back, relative to the
+        /// time they were recorded. The new rate applies from the next
+        /// message on.
+        /// \param[in] _rate Multiplier of the speed of the playback, e.g. 0.5
+        /// for half speed or 10 for ten times faster. Infinity publishes the
+        /// messages as fast as possible, in batches, without waiting between
+        /// them.
+        /// \return False if _rate isn't greater than zero, the rate isn't
+        /// changed in that case.
+        public: bool SetRate(double _rate);
+
+        /// \brief Get how fast the messages are played back.
+        /// \return The multiplier of the speed of the playback, 1 for real
+        /// time, or infinity when Playback::Start() was told not to wait
+        /// between messages.
+        /// \sa SetRate()
+        public: double Rate() const;
+
+        /// \brief Set how long before the time of a message the playback
+        /// stops sleeping and spins on the clock instead. Waking up from a
+        /// sleep typically takes tens of microseconds more than asked, which
+        /// shows on high-rate topics. Spinning uses a core fully until the
+        /// message is published.
+        /// \param[in] _threshold Duration of the spin, zero (the default) to
+        /// only sleep.
+        public: void SetSpinThreshold(
+            const std::chrono::nanoseconds &_threshold);
+
+        /// \brief Get how long before the time of a message the playback
+        /// spins.
+        /// \return The duration of the spin.
+        /// \sa SetSpinThreshold()
+        public: std::chrono::nanoseconds SpinThreshold() const;
+
+        /// \brief Run the thread publishing the messages on a single CPU.
+        /// Only supported on Linux.
+        /// \param[in] _cpu Index of the CPU.
+        /// \return False if the affinity couldn't be set.
+        public: bool SetThreadAffinity(int _cpu);
+
+        /// \brief Run the thread publishing the messages with the SCHED_FIFO
+        /// real-time policy, which usually needs the CAP_SYS_NICE capability.
+        /// Only supported on Linux.
+        /// \param[in] _priority Priority of the thread, between 1 and 99.
+        /// \return False if the priority couldn't be set.
+        public: bool SetRealTimePriority(int _priority);
+
+        /// \brief Get how late the messages were published so far.
+        /// \return The statistics of the delays.
+        public: PlaybackJitterStats JitterStats() const;
+
         /// \brief Block until playback runs out of messages to publish
         public: void WaitUntilFinished();
 
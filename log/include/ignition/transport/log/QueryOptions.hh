@@ -18,6 +18,7 @@
 #ifndef IGNITION_TRANSPORT_LOG_QUERYOPTIONS_HH_
 #define IGNITION_TRANSPORT_LOG_QUERYOPTIONS_HH_
 
+#include <chrono>
 #include <memory>
 #include <regex>
 #include <set>
@@ -82,6 +83,20 @@ namespace ignition
       /// QueryOptions classes.
       class IGNITION_TRANSPORT_LOG_VISIBLE TimeRangeOption
       {
+        /// \brief The time of the messages that the range applies to.
+        public: enum class TimeReference
+        {
+          /// \brief The time the messages were received by the recorder.
+          RECEIVED,
+
+          /// \brief The stamp of the header of the messages, as set by
+          /// their publisher. The messages without a header stamp are not
+          /// selected. Only the SQLite3 logs store it, when recorded with
+          /// Recorder::SetRecordHeaderTimes(). The messages are still in the
+          /// order they were received.
+          HEADER
+        };
+
         /// \brief Constructor that sets the initial time range option.
         /// \param[in] _timeRange The time range.
         public: explicit TimeRangeOption(const QualifiedTimeRange &_timeRange);
@@ -104,8 +119,19 @@ namespace ignition
         /// for.
         public: const QualifiedTimeRange &TimeRange() const;
 
+        /// \brief Set the time of the messages that the time range applies
+        /// to. By default, the time they were received.
+        /// \param[in] _reference The time of the messages.
+        public: void SetTimeReference(const TimeReference _reference);
+
+        /// \brief Get the time of the messages that the time range applies
+        /// to.
+        /// \return The time of the messages.
+        public: TimeReference GetTimeReference() const;
+
         /// \brief Generate a SQL string to represent the time conditions.
         /// This should be appended to a SQL statement after a WHERE keyword.
+        /// The columns are qualified by the messages table.
         /// \return A partial SqlStatement that specifies the time conditions
         /// that this TimeRangeOption has been set with.
         public: SqlStatement GenerateTimeConditions() const;
@@ -287,6 +313,79 @@ namespace ignition
         /// \internal Implementation of this class
         private: class Implementation;
 
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+        /// \internal Pointer to the implementation
+        private: std::unique_ptr<Implementation> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+      };
+
+      //////////////////////////////////////////////////
+      /// \brief Query for a list of topics, keeping at most one message of
+      /// each topic per period. The first message of a topic in the time
+      /// range is selected, then each time the first one received at least
+      /// a period after the previously selected one. The messages in between
+      /// are skipped by the query itself: with the index of the messages by
+      /// topic and time (schema 0.1.1), the number of messages read is
+      /// proportional to the number selected.
+      ///
+      /// The segments of a segmented log are downsampled one by one.
+      class IGNITION_TRANSPORT_LOG_VISIBLE DownsampledTopics final
+          : public virtual QueryOptions,
+            public virtual TimeRangeOption
+      {
+        /// \brief Query for downsampled topics over the specified time range
+        /// (by default, all time).
+        /// \param[in] _topics The topics to include
+        /// \param[in] _period Minimum time between the messages of a topic.
+        /// Zero or less selects every message, like TopicList.
+        /// \param[in] _timeRange The time range to query over
+        public: DownsampledTopics(
+          const std::set<std::string> &_topics,
+          const std::chrono::nanoseconds &_period,
+          const QualifiedTimeRange &_timeRange = QualifiedTimeRange::AllTime());
+
+        /// \brief Copy constructor
+        /// \param[in] _other Another DownsampledTopics
+        public: DownsampledTopics(const DownsampledTopics &_other);
+
+        /// \brief Move constructor
+        /// \param[in] _other Another DownsampledTopics
+        public: DownsampledTopics(
+          DownsampledTopics &&_other);  // NOLINT(whitespace/operators)
+
+        /// \brief Topics of this option
+        /// \return A mutable reference to the topics to query for.
+        public: std::set<std::string> &Topics();
+
+        /// \brief Topics of this option
+        /// \return A const reference to the topics to query for.
+        public: const std::set<std::string> &Topics() const;
+
+        /// \brief Minimum time between the selected messages of a topic
+        /// \return A mutable reference to the period.
+        public: std::chrono::nanoseconds &Period();
+
+        /// \brief Minimum time between the selected messages of a topic
+        /// \return A const reference to the period.
+        public: const std::chrono::nanoseconds &Period() const;
+
+        // Documentation inherited
+        public: std::vector<SqlStatement> GenerateStatements(
+          const Descriptor &_descriptor) const override;
+
+        /// \brief Destructor
+        public: ~DownsampledTopics();
+
+        /// \internal Implementation of this class
+        private: class Implementation;
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::*
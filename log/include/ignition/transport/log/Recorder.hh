@@ -17,7 +17,11 @@
 #ifndef IGNITION_TRANSPORT_LOG_RECORDER_HH_
 #define IGNITION_TRANSPORT_LOG_RECORDER_HH_
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
 #include <regex>
 #include <set>
@@ -26,6 +30,7 @@
 #include <ignition/transport/Clock.hh>
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Export.hh>
+#include <ignition/transport/log/Log.hh>
 
 namespace ignition
 {
@@ -47,6 +52,74 @@ namespace ignition
         ALREADY_SUBSCRIBED_TO_TOPIC = -6,
       };
 
+      /// \brief Statistics of the stages of a recording, see
+      /// Recorder::PipelineStats(). The received messages are queued, then
+      /// taken from the queue in batches, which are encoded and written to
+      /// the log in order. The counters start from zero with each recording.
+      struct RecorderPipelineStats
+      {
+        /// \brief Number of messages waiting in the queue
+        std::size_t queuedMessages = 0;
+
+        /// \brief Bytes of data of the messages waiting in the queue
+        std::size_t queuedBytes = 0;
+
+        /// \brief Number of batches taken from the queue that are being
+        /// encoded or written
+        std::size_t batchesInFlight = 0;
+
+        /// \brief Number of batches written since the recording started
+        uint64_t batchesWritten = 0;
+
+        /// \brief Time taken to encode the last batch written, since it was
+        /// taken from the queue. Zero if it had nothing to encode.
+        std::chrono::nanoseconds encodeLatency{0};
+
+        /// \brief Time taken to write the last batch written
+        std::chrono::nanoseconds writeLatency{0};
+
+        /// \brief Number of messages dropped from the queue because the
+        /// buffer was full, see Recorder::SetBufferSize()
+        uint64_t droppedMessages = 0;
+
+        /// \brief Bytes of data of the dropped messages
+        uint64_t droppedBytes = 0;
+
+        /// \brief Number of messages dropped of each topic that had some
+        std::map<std::string, uint64_t> droppedMessagesPerTopic;
+
+        /// \brief Number of messages written to the log
+        uint64_t writtenMessages = 0;
+
+        /// \brief Bytes of data of the messages written, before compression
+        uint64_t writtenBytes = 0;
+
+        /// \brief Bytes of data written per second, on average since the
+        /// recording started
+        double writeThroughput = 0;
+
+        /// \brief Time between the last message received and the last one
+        /// written, on the clock of the recorder. It grows while the writer
+        /// can't keep up with the messages.
+        std::chrono::nanoseconds writerLag{0};
+      };
+
+      /// \brief How the messages of a topic are sampled before they are
+      /// recorded, see Recorder::AddTopic(). The messages that aren't kept
+      /// are skipped in the subscription, before they are copied into the
+      /// buffer of the recorder.
+      struct RecorderTopicOptions
+      {
+        /// \brief Maximum number of messages per second recorded, applied
+        /// with SubscribeOptions::SetMsgsPerSec() so that the publishers
+        /// also know the rate. Zero records every message.
+        uint64_t msgsPerSec = 0;
+
+        /// \brief Record one of every _decimation_ messages received, after
+        /// the rate limit. Zero and one record every message.
+        uint64_t decimation = 1;
+      };
+
       /// \brief Records ignition transport topics
       /// This class makes it easy to record topics to a log file.
       /// Responsibilities: topic name matching, time received tracking,
@@ -72,16 +145,58 @@ namespace ignition
         public: RecorderError Sync(const Clock *_clockIn);
 
         /// \brief Begin recording topics
-        /// \param[in] _file path to log file
+        /// \param[in] _file path to log file. When a segment limit is set,
+        /// see SetMaxSegmentSize(), it's the path to the manifest of the
+        /// segments, which are created next to it. When shards were added,
+        /// see AddShard(), it's the path to the manifest of the shards, and
+        /// the topics of no shard are recorded to the first segment name,
+        /// e.g. "rec.0000.tlog" for "rec.tlog".
         /// \return NO_ERROR if recording was successfully started. If the file
         /// already existed, this will return FAILED_TO_OPEN.
         public: RecorderError Start(const std::string &_file);
 
         /// \brief Stop recording topics. This function will block if there is
         /// any data in the internal buffer that has not yet been written to
-        /// disk.
+        /// disk, and while a deferred time index is built (see
+        /// LogOpenOptions::deferTimeIndex). A flight recording is stopped
+        /// without writing its messages, see StartFlightRecorder().
         public: void Stop();
 
+        /// \brief Begin recording topics in memory only, like a flight
+        /// recorder. The last messages received are kept in a ring, and
+        /// nothing is written until Dump() is called, e.g. when an incident
+        /// is detected. The oldest messages are forgotten when the ring
+        /// exceeds one of the limits. Stop() ends the flight recording.
+        /// \param[in] _window Time covered by the ring, by the clock that
+        /// stamps the messages. Zero for no limit.
+        /// \param[in] _maxSize Maximum bytes of message data in the ring.
+        /// Zero for no limit.
+        /// \return SUCCESS if the flight recording started, or
+        /// ALREADY_RECORDING if a recording is already in progress.
+        public: RecorderError StartFlightRecorder(
+            const std::chrono::nanoseconds &_window,
+            std::size_t _maxSize);
+
+        /// \brief Write the messages of the flight recording to a new log
+        /// file, with the settings of SetOpenOptions(). The flight
+        /// recording continues.
+        /// \param[in] _file Path to the log file.
+        /// \return SUCCESS if the messages were written, FAILED_TO_OPEN if
+        /// the file can't be created or no flight recording is in progress.
+        public: RecorderError Dump(const std::string &_file);
+
+        /// \brief Advertise a service that calls Dump(), so that another
+        /// process can save the flight recording. The request is an
+        /// ignition::msgs::StringMsg with the path to the log file, and the
+        /// reply an ignition::msgs::Boolean, true on success.
+        /// \param[in] _service Name of the service.
+        /// \return True if the service was advertised.
+        public: bool AdvertiseDump(const std::string &_service);
+
+        /// \brief Check whether a flight recording is in progress.
+        /// \return True between StartFlightRecorder() and Stop().
+        public: bool FlightRecording() const;
+
         /// \brief Add a topic to be recorded (exact match only)
         /// \param[in] _topic The exact topic name
         /// \note This method attempts to subscribe to the topic immediately.
@@ -89,6 +204,15 @@ namespace ignition
         /// \return NO_ERROR if the subscription was created.
         public: RecorderError AddTopic(const std::string &_topic);
 
+        /// \brief Add a topic to be recorded (exact match only), with a
+        /// sampling of its messages
+        /// \param[in] _topic The exact topic name
+        /// \param[in] _options Rate limit and decimation of the topic
+        /// \return NO_ERROR if the subscription was created.
+        /// \sa AddTopic(const std::string &)
+        public: RecorderError AddTopic(const std::string &_topic,
+                                       const RecorderTopicOptions &_options);
+
         /// \brief Add a topic to be recorded (regex match)
         /// \param[in] _topic Pattern to match against topic names
         /// \note This method attempts to subscribe to topics immediately.
@@ -98,11 +222,72 @@ namespace ignition
         /// \return number of topics subscribed or negative number on error
         public: int64_t AddTopic(const std::regex &_topic);
 
+        /// \brief Add topics to be recorded (regex match), with a sampling of
+        /// their messages. The options of the first pattern added that
+        /// matches a topic apply to it.
+        /// \param[in] _topic Pattern to match against topic names
+        /// \param[in] _options Rate limit and decimation of each topic
+        /// \return number of topics subscribed or negative number on error
+        /// \sa AddTopic(const std::regex &)
+        public: int64_t AddTopic(const std::regex &_topic,
+                                 const RecorderTopicOptions &_options);
+
+        /// \brief Record the topics that match a pattern to a log file of
+        /// their own, a shard, e.g. on another disk. Each shard has its own
+        /// queue and writer thread, so that the recordings of high rate
+        /// topics don't slow each other down. The topics matching no shard
+        /// are recorded to the log of Start(), and a manifest listing every
+        /// log is written instead, that Log::Open() and Playback read as one
+        /// log. It only applies to the topics added afterwards, which match
+        /// the first shard whose pattern they match. The shards can't be
+        /// rotated, see SetMaxSegmentSize(), nor flight recorded.
+        /// \param[in] _topics Pattern to match against topic names.
+        /// \param[in] _file Path to the log file of the shard. It must be in
+        /// the directory of the manifest or an absolute path.
+        /// \return SUCCESS if the shard was added, ALREADY_RECORDING if a
+        /// recording is in progress.
+        public: RecorderError AddShard(const std::regex &_topics,
+            const std::string &_file);
+
         /// \brief Get the name of the log file.
         /// \return The name of the log file, or an empty string if Start has
-        /// not been successfully called.
+        /// not been successfully called. It's the manifest of the shards if
+        /// some were added, see AddShard().
         public: std::string Filename() const;
 
+        /// \brief Set the maximum size (in MB) of the message data written
+        /// to each segment of a recording. When the next message would
+        /// exceed it, the segment is closed and the recording continues in
+        /// a new one. Each segment is a complete log file, and they are
+        /// listed in a manifest that Log::Open() reads as one log. It
+        /// applies to the recordings started afterwards.
+        /// \param[in] _size Segment size in MB, zero to disable the limit.
+        public: void SetMaxSegmentSize(std::size_t _size);
+
+        /// \brief Get the maximum size of the segments of a recording.
+        /// \return Segment size in MB, zero if there's no limit.
+        public: std::size_t MaxSegmentSize() const;
+
+        /// \brief Set the maximum time between the first and the last
+        /// message of each segment of a recording, by the clock that stamps
+        /// the messages. See SetMaxSegmentSize(). It applies to the
+        /// recordings started afterwards.
+        /// \param[in] _duration Segment duration, zero to disable the limit.
+        public: void SetMaxSegmentDuration(
+            const std::chrono::nanoseconds &_duration);
+
+        /// \brief Get the maximum duration of the segments of a recording.
+        /// \return Segment duration, zero if there's no limit.
+        public: std::chrono::nanoseconds MaxSegmentDuration() const;
+
+        /// \brief Set a function to call when a segment of a recording is
+        /// complete, e.g. to upload it while the recording continues. It's
+        /// called from the thread that writes the log, or from Stop() for
+        /// the last segment.
+        /// \param[in] _callback Function taking the path to the segment.
+        public: void SetSegmentCallback(
+            const std::function<void(const std::string &)> &_callback);
+
         /// \brief Get the set of topics have have been added.
         /// \return The set of topic names that have been added using the
         /// AddTopic functions.
@@ -120,6 +305,48 @@ namespace ignition
         /// \param[in] _size Buffer size in MB
         public: void SetBufferSize(std::size_t _size);
 
+        /// \brief Set the settings of the log files created by Start(),
+        /// e.g. LogOpenOptions::WriteOptimized(). By default, the settings of
+        /// SQLite3 are kept.
+        /// \param[in] _options The settings.
+        public: void SetOpenOptions(const LogOpenOptions &_options);
+
+        /// \brief Set the number of threads that compress the messages of
+        /// the compressed topics, see LogOpenOptions::compressedTopics,
+        /// before they are written to the log. A batch of messages is
+        /// compressed while the one before is written, so that recording
+        /// scales with the cores. With zero, the default, the thread writing
+        /// the log compresses them. Applied by Start().
+        /// \param[in] _workers Number of threads.
+        public: void SetEncodeWorkers(std::size_t _workers);
+
+        /// \brief Get the number of threads that compress the messages.
+        /// \return Number of threads set by SetEncodeWorkers().
+        public: std::size_t EncodeWorkers() const;
+
+        /// \brief Set whether the stamps of the headers of the messages are
+        /// recorded, so that the SQLite3 logs can be queried by them, see
+        /// TimeRangeOption::TimeReference::HEADER. The messages of the types
+        /// whose first field is an ignition.msgs.Header have one, e.g. most
+        /// of the messages of ignition msgs. Only the header is parsed, as
+        /// the messages are received. Disabled by default.
+        /// \param[in] _record True to record the header stamps.
+        public: void SetRecordHeaderTimes(const bool _record);
+
+        /// \brief Get whether the stamps of the headers are recorded.
+        /// \return The value set by SetRecordHeaderTimes().
+        public: bool RecordHeaderTimes() const;
+
+        /// \brief Get the statistics of the stages of the current or last
+        /// recording. The counters of the shards are added up, and the
+        /// latencies and lag are their maximum.
+        /// \return The statistics.
+        public: RecorderPipelineStats PipelineStats() const;
+
+        /// \brief Get the settings of the log files created by Start().
+        /// \return The settings.
+        public: const LogOpenOptions &OpenOptions() const;
+
         /// \internal Implementation of this class
         private: class Implementation;
 
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/* Migrates a database from schema version 0.1.0 to 0.1.1 */
+
+/* Most queries select a few topics over a time range. With this index, the
+   messages of each topic are found in order of time received, instead of
+   scanning the time index and filtering out the other topics. */
+CREATE INDEX IF NOT EXISTS idx_topic_time_recv
+  ON messages (topic_id, time_recv);
+
+/* Number of messages and time range of each topic, updated in the same
+   transactions as the messages so that the time range of a log is known
+   without reading them. */
+CREATE TABLE IF NOT EXISTS topic_stats (
+  /* A topic in the topics table */
+  topic_id INTEGER PRIMARY KEY REFERENCES topics (id) ON DELETE CASCADE,
+  /* Number of messages recorded on the topic */
+  message_count INTEGER NOT NULL,
+  /* Timestamp of the first message received on the topic (utc nanoseconds) */
+  start_time INTEGER NOT NULL,
+  /* Timestamp of the last message received on the topic (utc nanoseconds) */
+  end_time INTEGER NOT NULL
+);
+
+/* The messages recorded before the migration */
+INSERT OR IGNORE INTO topic_stats
+  (topic_id, message_count, start_time, end_time)
+  SELECT topic_id, COUNT(*), MIN(time_recv), MAX(time_recv) FROM messages
+  GROUP BY topic_id;
+
+INSERT INTO migrations (from_version, to_version) VALUES ('0.1.0', '0.1.1');
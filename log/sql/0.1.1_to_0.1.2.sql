@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/* Migrates a database from schema version 0.1.1 to 0.1.2 */
+
+/* The topics whose messages are stored compressed. The message column of
+   their rows holds the size of the message, as a 32 bit integer in the byte
+   order of the host that recorded it, followed by the compressed data. The
+   other topics keep their messages as they are. */
+CREATE TABLE topic_compression (
+  /* A topic in the topics table */
+  topic_id INTEGER PRIMARY KEY REFERENCES topics (id) ON DELETE CASCADE,
+
+  /* Compression of the messages: 'zlib' */
+  codec TEXT NOT NULL,
+
+  /* Preset dictionary of the compression, or NULL */
+  dictionary BLOB
+);
+
+INSERT INTO migrations (from_version, to_version) VALUES ('0.1.1', '0.1.2');
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/* Migrates a database from schema version 0.1.2 to 0.1.3 */
+
+/* The statistics of the topics are altered below, make sure that every log
+   has them */
+CREATE TABLE IF NOT EXISTS topic_stats (
+  /* A topic in the topics table */
+  topic_id INTEGER PRIMARY KEY REFERENCES topics (id) ON DELETE CASCADE,
+  /* Number of messages recorded on the topic */
+  message_count INTEGER NOT NULL,
+  /* Timestamp of the first message received on the topic (utc nanoseconds) */
+  start_time INTEGER NOT NULL,
+  /* Timestamp of the last message received on the topic (utc nanoseconds) */
+  end_time INTEGER NOT NULL
+);
+
+INSERT OR IGNORE INTO topic_stats
+  (topic_id, message_count, start_time, end_time)
+  SELECT topic_id, COUNT(*), MIN(time_recv), MAX(time_recv) FROM messages
+  WHERE topic_id NOT IN (SELECT topic_id FROM topic_stats)
+  GROUP BY topic_id;
+
+/* Bytes of message data of each topic, as stored in the message column, so
+   that the size of a log is known without reading its messages. */
+ALTER TABLE topic_stats ADD COLUMN total_bytes INTEGER NOT NULL DEFAULT 0;
+
+UPDATE topic_stats SET total_bytes = (SELECT COALESCE(SUM(LENGTH(message)), 0)
+  FROM messages WHERE messages.topic_id = topic_stats.topic_id);
+
+INSERT INTO migrations (from_version, to_version) VALUES ('0.1.2', '0.1.3');
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/* Migrates a database from schema version 0.1.3 to 0.1.4 */
+
+/* Stamp of the header of each message (ns), as set by its publisher, or
+   NULL if the message has no header or it wasn't recorded. The index only
+   holds the messages with a stamp, so the logs recorded without them don't
+   maintain it. */
+ALTER TABLE messages ADD COLUMN time_header INTEGER;
+
+CREATE INDEX idx_time_header ON messages (time_header)
+  WHERE time_header IS NOT NULL;
+
+INSERT INTO migrations (from_version, to_version) VALUES ('0.1.3', '0.1.4');
@@ -0,0 +1,581 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef _WIN32
+  #include <fcntl.h>
+  #include <io.h>
+  #include <malloc.h>
+  #include <sys/stat.h>
+#else
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+// The io_uring system calls are used directly, without liburing.
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <sys/uio.h>
+  #if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+    #define IGN_TRANSPORT_HAVE_IO_URING
+  #endif
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "AsyncWriter.hh"
+#include "Console.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+//////////////////////////////////////////////////
+/// \brief Allocate memory for the direct writes.
+/// \param[in] _size Number of bytes.
+/// \return The memory, aligned to AsyncWriter::kAlignment, or null.
+static char *AlignedAlloc(const std::size_t _size)
+{
+#ifdef _WIN32
+  return static_cast<char *>(_aligned_malloc(_size, AsyncWriter::kAlignment));
+#else
+  void *ptr = nullptr;
+  if (posix_memalign(&ptr, AsyncWriter::kAlignment, _size) != 0)
+    return nullptr;
+  return static_cast<char *>(ptr);
+#endif
+}
+
+//////////////////////////////////////////////////
+/// \brief Release memory of AlignedAlloc().
+/// \param[in] _ptr The memory.
+static void AlignedFree(char *_ptr)
+{
+#ifdef _WIN32
+  _aligned_free(_ptr);
+#else
+  std::free(_ptr);
+#endif
+}
+
+//////////////////////////////////////////////////
+/// \brief The rings shared with the kernel, see io_uring_setup(2).
+struct AsyncWriter::Uring
+{
+#ifdef IGN_TRANSPORT_HAVE_IO_URING
+  /// \brief Destructor. Unmaps the rings and closes the io_uring.
+  ~Uring()
+  {
+    if (this->sqes)
+      munmap(this->sqes, this->sqesSize);
+    if (this->cqRing && this->cqRing != this->sqRing)
+      munmap(this->cqRing, this->cqRingSize);
+    if (this->sqRing)
+      munmap(this->sqRing, this->sqRingSize);
+    if (this->fd >= 0)
+      close(this->fd);
+  }
+
+  /// \brief File descriptor of the io_uring.
+  int fd = -1;
+
+  /// \brief Mapped submission ring.
+  void *sqRing = nullptr;
+
+  /// \brief Size of sqRing.
+  std::size_t sqRingSize = 0;
+
+  /// \brief Mapped completion ring, sqRing if they share the mapping.
+  void *cqRing = nullptr;
+
+  /// \brief Size of cqRing.
+  std::size_t cqRingSize = 0;
+
+  /// \brief Mapped submission entries.
+  io_uring_sqe *sqes = nullptr;
+
+  /// \brief Size of sqes.
+  std::size_t sqesSize = 0;
+
+  /// \brief Tail of the submission ring, written by the writer.
+  unsigned *sqTail = nullptr;
+
+  /// \brief Mask of the indices of the submission ring.
+  unsigned *sqMask = nullptr;
+
+  /// \brief Indices of the submitted entries.
+  unsigned *sqArray = nullptr;
+
+  /// \brief Head of the completion ring, written by the writer.
+  unsigned *cqHead = nullptr;
+
+  /// \brief Tail of the completion ring, written by the kernel.
+  unsigned *cqTail = nullptr;
+
+  /// \brief Mask of the indices of the completion ring.
+  unsigned *cqMask = nullptr;
+
+  /// \brief The completions.
+  io_uring_cqe *cqes = nullptr;
+
+  /// \brief Vector of each block written, valid until its completion.
+  iovec iovecs[AsyncWriter::kBlocks];
+#endif
+};
+
+//////////////////////////////////////////////////
+AsyncWriter::AsyncWriter(const bool _uring)
+  : uringAllowed(_uring)
+{
+}
+
+//////////////////////////////////////////////////
+AsyncWriter::~AsyncWriter()
+{
+  this->Close();
+}
+
+//////////////////////////////////////////////////
+bool AsyncWriter::Open(const std::string &_file)
+{
+  this->Close();
+
+#ifdef _WIN32
+  this->fd = _open(_file.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+    _S_IREAD | _S_IWRITE);
+  this->direct = false;
+#else
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  this->direct = false;
+#ifdef O_DIRECT
+  // Some file systems, e.g. tmpfs, refuse O_DIRECT.
+  this->fd = open(_file.c_str(), flags | O_DIRECT, 0644);
+  this->direct = this->fd >= 0;
+#endif
+  if (this->fd < 0)
+    this->fd = open(_file.c_str(), flags, 0644);
+#endif
+  if (this->fd < 0)
+    return false;
+
+  this->blocks.resize(kBlocks);
+  for (Block &block : this->blocks)
+  {
+    block = Block();
+    block.data = AlignedAlloc(kBlockSize);
+    if (!block.data)
+    {
+      this->Close();
+      return false;
+    }
+  }
+  this->current = 0;
+  this->size = 0;
+  this->failed = false;
+  this->stop = false;
+
+  if (this->uringAllowed && this->SetUpUring())
+  {
+    this->backend = Backend::URING;
+  }
+  else
+  {
+    this->backend = Backend::THREAD;
+    this->thread = std::thread(&AsyncWriter::WriterThread, this);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool AsyncWriter::Write(const void *_data, const std::size_t _len)
+{
+  if (this->fd < 0)
+    return false;
+
+  const char *src = static_cast<const char *>(_data);
+  std::size_t remaining = _len;
+  while (remaining > 0)
+  {
+    // The blocks are written at their offset, a multiple of kBlockSize.
+    Block &block = this->blocks[this->current];
+    const std::size_t fill = static_cast<std::size_t>(this->size % kBlockSize);
+    const std::size_t n = std::min(remaining, kBlockSize - fill);
+    std::memcpy(block.data + fill, src, n);
+    this->size += n;
+    src += n;
+    remaining -= n;
+
+    if (fill + n == kBlockSize)
+    {
+      block.offset = this->size - kBlockSize;
+      block.len = kBlockSize;
+      this->Submit(this->current);
+      this->NextBlock();
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return !this->failed;
+}
+
+//////////////////////////////////////////////////
+bool AsyncWriter::Sync()
+{
+  if (this->fd < 0)
+    return false;
+
+  // The block being filled is written up to the next aligned size, and
+  // written again once full.
+  const std::size_t fill = static_cast<std::size_t>(this->size % kBlockSize);
+  if (fill > 0)
+  {
+    Block &block = this->blocks[this->current];
+    const std::size_t padded =
+      (fill + kAlignment - 1) / kAlignment * kAlignment;
+    std::memset(block.data + fill, 0, padded - fill);
+    block.offset = this->size - fill;
+    block.len = padded;
+    this->Submit(this->current);
+  }
+  this->WaitAll();
+
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return !this->failed;
+}
+
+//////////////////////////////////////////////////
+bool AsyncWriter::Close()
+{
+  if (this->fd < 0)
+    return true;
+
+  bool result = this->Sync();
+  if (this->backend == Backend::THREAD)
+  {
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+      this->stop = true;
+    }
+    this->signal.notify_all();
+    if (this->thread.joinable())
+      this->thread.join();
+  }
+  this->uring.reset();
+
+  // Remove the padding of the last block.
+#ifdef _WIN32
+  if (_chsize_s(this->fd, static_cast<__int64>(this->size)) != 0)
+    result = false;
+  if (_close(this->fd) != 0)
+    result = false;
+#else
+  if (ftruncate(this->fd, static_cast<off_t>(this->size)) != 0)
+    result = false;
+  if (close(this->fd) != 0)
+    result = false;
+#endif
+  this->fd = -1;
+
+  for (Block &block : this->blocks)
+    AlignedFree(block.data);
+  this->blocks.clear();
+  return result;
+}
+
+//////////////////////////////////////////////////
+uint64_t AsyncWriter::Size() const
+{
+  return this->size;
+}
+
+//////////////////////////////////////////////////
+bool AsyncWriter::Direct() const
+{
+  return this->direct;
+}
+
+//////////////////////////////////////////////////
+AsyncWriter::Backend AsyncWriter::WriteBackend() const
+{
+  return this->backend;
+}
+
+//////////////////////////////////////////////////
+void AsyncWriter::Submit(const std::size_t _block)
+{
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->blocks[_block].busy = true;
+    this->blocks[_block].written = 0;
+    if (this->backend == Backend::THREAD)
+      this->queue.push_back(_block);
+  }
+
+  if (this->backend == Backend::THREAD)
+    this->signal.notify_all();
+  else
+    this->PushUring(_block);
+}
+
+//////////////////////////////////////////////////
+void AsyncWriter::WaitFree(const std::size_t _block)
+{
+  if (this->backend == Backend::THREAD)
+  {
+    std::unique_lock<std::mutex> lk(this->mutex);
+    this->signal.wait(lk, [this, _block]
+      {
+        return !this->blocks[_block].busy;
+      });
+    return;
+  }
+
+  // Only the caller reaps the completions of the io_uring.
+  while (true)
+  {
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+      if (!this->blocks[_block].busy)
+        return;
+    }
+    this->ReapUring(true);
+  }
+}
+
+//////////////////////////////////////////////////
+void AsyncWriter::WaitAll()
+{
+  for (std::size_t i = 0; i < this->blocks.size(); ++i)
+    this->WaitFree(i);
+}
+
+//////////////////////////////////////////////////
+void AsyncWriter::NextBlock()
+{
+  if (this->backend == Backend::URING)
+    this->ReapUring(false);
+
+  this->current = (this->current + 1) % this->blocks.size();
+  this->WaitFree(this->current);
+}
+
+//////////////////////////////////////////////////
+bool AsyncWriter::SetUpUring()
+{
+#ifdef IGN_TRANSPORT_HAVE_IO_URING
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  std::unique_ptr<Uring> ring(new Uring());
+  ring->fd = static_cast<int>(
+    syscall(__NR_io_uring_setup, static_cast<unsigned>(kBlocks), &params));
+  if (ring->fd < 0)
+    return false;
+
+  ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cqRingSize =
+    params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+  single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single)
+  {
+    ring->sqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+    ring->cqRingSize = ring->sqRingSize;
+  }
+#endif
+
+  void *sq = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (sq == MAP_FAILED)
+    return false;
+  ring->sqRing = sq;
+
+  void *cq = sq;
+  if (!single)
+  {
+    cq = mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (cq == MAP_FAILED)
+      return false;
+  }
+  ring->cqRing = cq;
+
+  ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+    return false;
+  ring->sqes = static_cast<io_uring_sqe *>(sqes);
+
+  char *sqBytes = static_cast<char *>(sq);
+  ring->sqTail = reinterpret_cast<unsigned *>(sqBytes + params.sq_off.tail);
+  ring->sqMask =
+    reinterpret_cast<unsigned *>(sqBytes + params.sq_off.ring_mask);
+  ring->sqArray = reinterpret_cast<unsigned *>(sqBytes + params.sq_off.array);
+
+  char *cqBytes = static_cast<char *>(cq);
+  ring->cqHead = reinterpret_cast<unsigned *>(cqBytes + params.cq_off.head);
+  ring->cqTail = reinterpret_cast<unsigned *>(cqBytes + params.cq_off.tail);
+  ring->cqMask =
+    reinterpret_cast<unsigned *>(cqBytes + params.cq_off.ring_mask);
+  ring->cqes = reinterpret_cast<io_uring_cqe *>(cqBytes + params.cq_off.cqes);
+
+  this->uring = std::move(ring);
+  return true;
+#else
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+void AsyncWriter::PushUring(const std::size_t _block)
+{
+#ifdef IGN_TRANSPORT_HAVE_IO_URING
+  Uring &ring = *this->uring;
+  Block &block = this->blocks[_block];
+
+  // At most one entry per block is in flight, the ring never overflows.
+  ring.iovecs[_block].iov_base = block.data + block.written;
+  ring.iovecs[_block].iov_len = block.len - block.written;
+
+  const unsigned tail = *ring.sqTail;
+  const unsigned index = tail & *ring.sqMask;
+  io_uring_sqe &sqe = ring.sqes[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_WRITEV;
+  sqe.fd = this->fd;
+  sqe.addr = reinterpret_cast<uint64_t>(&ring.iovecs[_block]);
+  sqe.len = 1;
+  sqe.off = block.offset + block.written;
+  sqe.user_data = _block;
+  ring.sqArray[index] = index;
+  __atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  if (syscall(__NR_io_uring_enter, ring.fd, 1u, 0u, 0u, nullptr, 0) < 0)
+  {
+    LERR("Failed to queue a write of " << block.len << " bytes\n");
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->failed = true;
+    block.busy = false;
+  }
+#else
+  static_cast<void>(_block);
+#endif
+}
+
+//////////////////////////////////////////////////
+void AsyncWriter::ReapUring(const bool _wait)
+{
+#ifdef IGN_TRANSPORT_HAVE_IO_URING
+  Uring &ring = *this->uring;
+  if (_wait)
+  {
+    // Interrupted waits return early, the callers try again.
+    syscall(__NR_io_uring_enter, ring.fd, 0u, 1u,
+      static_cast<unsigned>(IORING_ENTER_GETEVENTS), nullptr, 0);
+  }
+
+  std::vector<std::size_t> partial;
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    unsigned head = *ring.cqHead;
+    const unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+      const io_uring_cqe &cqe = ring.cqes[head & *ring.cqMask];
+      const std::size_t index = static_cast<std::size_t>(cqe.user_data);
+      Block &block = this->blocks[index];
+      if (cqe.res <= 0)
+      {
+        LERR("Failed to write " << block.len << " bytes: "
+            << std::strerror(-cqe.res) << "\n");
+        this->failed = true;
+        block.busy = false;
+        continue;
+      }
+
+      block.written += static_cast<std::size_t>(cqe.res);
+      if (block.written < block.len)
+        partial.push_back(index);
+      else
+        block.busy = false;
+    }
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+  }
+
+  for (const std::size_t index : partial)
+    this->PushUring(index);
+#else
+  static_cast<void>(_wait);
+#endif
+}
+
+//////////////////////////////////////////////////
+void AsyncWriter::WriterThread()
+{
+  std::unique_lock<std::mutex> lk(this->mutex);
+  while (true)
+  {
+    this->signal.wait(lk, [this]{return this->stop || !this->queue.empty();});
+    if (this->queue.empty())
+      return;
+
+    const std::size_t index = this->queue.front();
+    this->queue.pop_front();
+    Block &block = this->blocks[index];
+    lk.unlock();
+
+    bool ok = true;
+    while (block.written < block.len)
+    {
+      const int64_t n = this->WriteAt(block.data + block.written,
+        block.len - block.written, block.offset + block.written);
+      if (n <= 0)
+      {
+        LERR("Failed to write " << block.len << " bytes: "
+            << std::strerror(errno) << "\n");
+        ok = false;
+        break;
+      }
+      block.written += static_cast<std::size_t>(n);
+    }
+
+    lk.lock();
+    this->failed = this->failed || !ok;
+    block.busy = false;
+    this->signal.notify_all();
+  }
+}
+
+//////////////////////////////////////////////////
+int64_t AsyncWriter::WriteAt(const char *_data, const std::size_t _len,
+    const uint64_t _offset) const
+{
+#ifdef _WIN32
+  // Only the writer thread moves the position of the file.
+  if (_lseeki64(this->fd, static_cast<__int64>(_offset), SEEK_SET) < 0)
+    return -1;
+  return _write(this->fd, _data, static_cast<unsigned int>(_len));
+#else
+  return pwrite(this->fd, _data, _len, static_cast<off_t>(_offset));
+#endif
+}
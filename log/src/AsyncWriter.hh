@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_SRC_ASYNCWRITER_HH_
+#define IGNITION_TRANSPORT_LOG_SRC_ASYNCWRITER_HH_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Appends to a file without waiting for the disk.
+      ///
+      /// The data is copied into a few aligned blocks, which are written
+      /// once full while the next ones are filled. The file is opened with
+      /// O_DIRECT where the file system supports it, so the writes bypass
+      /// the page cache. On Linux the blocks are queued to an io_uring,
+      /// elsewhere, or when the kernel refuses it, a thread writes them.
+      /// The writer only waits when every block is in flight, i.e. when the
+      /// disk can't keep up.
+      ///
+      /// The errors of the writes are reported by the next call once the
+      /// write completed.
+      class AsyncWriter
+      {
+        /// \brief Size of each block, a multiple of kAlignment.
+        public: static constexpr std::size_t kBlockSize = 1024 * 1024;
+
+        /// \brief Number of blocks, the data in flight is at most
+        /// kBlocks * kBlockSize bytes.
+        public: static constexpr std::size_t kBlocks = 8;
+
+        /// \brief Alignment of the memory, offsets and sizes of the direct
+        /// writes.
+        public: static constexpr std::size_t kAlignment = 4096;
+
+        /// \brief How the blocks are written.
+        public: enum class Backend
+        {
+          /// \brief Queued to an io_uring.
+          URING,
+
+          /// \brief Written by a thread.
+          THREAD
+        };
+
+        /// \brief Constructor.
+        /// \param[in] _uring False to write with a thread even where
+        /// io_uring is available.
+        public: explicit AsyncWriter(const bool _uring = true);
+
+        /// \brief Destructor. Closes the file.
+        public: ~AsyncWriter();
+
+        /// \brief Create (or truncate) a file.
+        /// \param[in] _file Path to the file.
+        /// \return True if the file was created.
+        public: bool Open(const std::string &_file);
+
+        /// \brief Append data.
+        /// \param[in] _data The data.
+        /// \param[in] _len Number of bytes of data.
+        /// \return False if the file isn't open or a previous write failed.
+        public: bool Write(const void *_data, const std::size_t _len);
+
+        /// \brief Write everything appended so far and wait for it, so that
+        /// the file can be read. The end of the file is padded up to the
+        /// next aligned offset until Close().
+        /// \return False if the file isn't open or a write failed.
+        public: bool Sync();
+
+        /// \brief Write everything appended so far and close the file,
+        /// truncated to the data appended.
+        /// \return True on success.
+        public: bool Close();
+
+        /// \brief Number of bytes appended.
+        /// \return The size.
+        public: uint64_t Size() const;
+
+        /// \brief Whether the file was opened with O_DIRECT.
+        /// \return True if the writes bypass the page cache.
+        public: bool Direct() const;
+
+        /// \brief How the blocks are written.
+        /// \return The backend, valid while the file is open.
+        public: Backend WriteBackend() const;
+
+        /// \brief A buffer written at once.
+        private: struct Block
+        {
+          /// \brief The memory, aligned to kAlignment.
+          char *data = nullptr;
+
+          /// \brief Offset in the file.
+          uint64_t offset = 0;
+
+          /// \brief Number of bytes to write.
+          std::size_t len = 0;
+
+          /// \brief Number of bytes written so far.
+          std::size_t written = 0;
+
+          /// \brief True while the block is written.
+          bool busy = false;
+        };
+
+        /// \brief Queue the write of a block, at its offset.
+        /// \param[in] _block Index of the block.
+        private: void Submit(const std::size_t _block);
+
+        /// \brief Wait until a block is written.
+        /// \param[in] _block Index of the block.
+        private: void WaitFree(const std::size_t _block);
+
+        /// \brief Wait until every block is written.
+        private: void WaitAll();
+
+        /// \brief Make the next block the current one, waiting for its
+        /// previous write.
+        private: void NextBlock();
+
+        /// \brief Set up the io_uring.
+        /// \return True if io_uring is usable.
+        private: bool SetUpUring();
+
+        /// \brief Queue the remainder of a block to the io_uring.
+        /// \param[in] _block Index of the block.
+        private: void PushUring(const std::size_t _block);
+
+        /// \brief Process the completed writes of the io_uring.
+        /// \param[in] _wait Whether to wait for at least one of them.
+        private: void ReapUring(const bool _wait);
+
+        /// \brief Body of the thread writing the blocks.
+        private: void WriterThread();
+
+        /// \brief Write to the file at an offset.
+        /// \param[in] _data The data.
+        /// \param[in] _len Number of bytes.
+        /// \param[in] _offset Offset in the file.
+        /// \return Number of bytes written, or -1 on error.
+        private: int64_t WriteAt(const char *_data, const std::size_t _len,
+                                 const uint64_t _offset) const;
+
+        /// \brief Whether io_uring may be used.
+        private: const bool uringAllowed;
+
+        /// \brief How the blocks are written.
+        private: Backend backend = Backend::THREAD;
+
+        /// \brief File descriptor, -1 if closed.
+        private: int fd = -1;
+
+        /// \brief Whether the file was opened with O_DIRECT.
+        private: bool direct = false;
+
+        /// \brief The blocks.
+        private: std::vector<Block> blocks;
+
+        /// \brief Index of the block being filled.
+        private: std::size_t current = 0;
+
+        /// \brief Bytes appended.
+        private: uint64_t size = 0;
+
+        /// \brief Protects the members below, and the busy and written
+        /// members of the blocks.
+        private: mutable std::mutex mutex;
+
+        /// \brief Signaled when a block is written or queued.
+        private: std::condition_variable signal;
+
+        /// \brief True if a write failed.
+        private: bool failed = false;
+
+        /// \brief Blocks waiting for the writer thread.
+        private: std::deque<std::size_t> queue;
+
+        /// \brief True when the writer thread must finish.
+        private: bool stop = false;
+
+        /// \brief The writer thread.
+        private: std::thread thread;
+
+        /// \brief State of the io_uring.
+        private: struct Uring;
+
+        /// \brief The io_uring, null if unused.
+        private: std::unique_ptr<Uring> uring;
+      };
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "AsyncWriter.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+
+/// \brief Path to the file written by the tests.
+static const char kPath[] = "AsyncWriter_TEST.bin";
+
+//////////////////////////////////////////////////
+/// \brief Read a whole file.
+/// \param[in] _file Path to the file.
+/// \return The content.
+static std::string Content(const std::string &_file)
+{
+  std::ifstream in(_file, std::ios_base::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+    std::istreambuf_iterator<char>());
+}
+
+//////////////////////////////////////////////////
+/// \brief Append pieces of various sizes, across several blocks, and read
+/// them back after syncing and closing.
+/// \param[in] _uring Whether io_uring may be used.
+static void CheckWrites(const bool _uring)
+{
+  std::remove(kPath);
+  log::AsyncWriter writer(_uring);
+  ASSERT_TRUE(writer.Open(kPath));
+
+  std::string expected;
+  for (int i = 0; expected.size() < 3 * log::AsyncWriter::kBlockSize; ++i)
+  {
+    const std::string piece(1 + (i * 7919) % 100000,
+      static_cast<char>('a' + i % 26));
+    ASSERT_TRUE(writer.Write(piece.data(), piece.size()));
+    expected += piece;
+  }
+  EXPECT_EQ(expected.size(), writer.Size());
+
+  // The file is padded until it's closed.
+  ASSERT_TRUE(writer.Sync());
+  std::string content = Content(kPath);
+  ASSERT_GE(content.size(), expected.size());
+  EXPECT_EQ(0u, content.size() % log::AsyncWriter::kAlignment);
+  EXPECT_EQ(expected, content.substr(0, expected.size()));
+
+  // The last block is completed after a sync.
+  const std::string tail(log::AsyncWriter::kBlockSize, 'z');
+  ASSERT_TRUE(writer.Write(tail.data(), tail.size()));
+  expected += tail;
+
+  ASSERT_TRUE(writer.Close());
+  EXPECT_EQ(expected, Content(kPath));
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(AsyncWriter, Uring)
+{
+  CheckWrites(true);
+}
+
+//////////////////////////////////////////////////
+TEST(AsyncWriter, Thread)
+{
+  log::AsyncWriter writer(false);
+  ASSERT_TRUE(writer.Open(kPath));
+  EXPECT_EQ(log::AsyncWriter::Backend::THREAD, writer.WriteBackend());
+  writer.Close();
+
+  CheckWrites(false);
+}
+
+//////////////////////////////////////////////////
+TEST(AsyncWriter, Errors)
+{
+  log::AsyncWriter writer;
+  EXPECT_FALSE(writer.Write("a", 1));
+  EXPECT_FALSE(writer.Sync());
+  EXPECT_TRUE(writer.Close());
+  EXPECT_FALSE(writer.Open("/a/directory/that/does/not/exist/file.bin"));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
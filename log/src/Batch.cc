@@ -15,11 +15,17 @@
  *
 */
 
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "ignition/transport/log/Batch.hh"
 #include "BatchPrivate.hh"
 #include "build_config.hh"
+#include "Console.hh"
 #include "MsgIterPrivate.hh"
 #include "raii-sqlite3.hh"
 
@@ -28,8 +34,25 @@ using namespace ignition::transport::log;
 
 //////////////////////////////////////////////////
 BatchPrivate::BatchPrivate(const std::shared_ptr<raii_sqlite3::Database> &_db,
-      std::vector<SqlStatement> &&_statements)  // NOLINT(build/c++11)
-  : statements(new std::vector<SqlStatement>(std::move(_statements))), db(_db)
+      std::vector<SqlStatement> &&_statements,  // NOLINT(build/c++11)
+      const bool _merge)
+  : statements(new std::vector<SqlStatement>(std::move(_statements))),
+    merge(_merge), db(_db)
+{
+}
+
+//////////////////////////////////////////////////
+BatchPrivate::BatchPrivate(const std::shared_ptr<ChunkedLog> &_chunked,
+      ChunkedQuery &&_query)  // NOLINT(build/c++11)
+  : chunked(_chunked), query(std::move(_query))
+{
+}
+
+//////////////////////////////////////////////////
+BatchPrivate::BatchPrivate(
+      std::vector<Batch> &&_segments,  // NOLINT(build/c++11)
+      const bool _merge)
+  : merge(_merge), segments(new std::vector<Batch>(std::move(_segments)))
 {
 }
 
@@ -73,8 +96,26 @@ Batch::iterator Batch::begin()
     return Batch::iterator();
   }
 
+  if (this->dataPtr->chunked)
+  {
+    std::unique_ptr<MsgIterPrivate> msgPriv(new MsgIterPrivate(
+          this->dataPtr->chunked->Query(this->dataPtr->query)));
+    return Batch::iterator(std::move(msgPriv));
+  }
+
+  if (this->dataPtr->segments)
+  {
+    std::unique_ptr<MsgIterPrivate> msgPriv(
+          new MsgIterPrivate(this->dataPtr->segments,
+            this->dataPtr->merge));
+    return Batch::iterator(std::move(msgPriv));
+  }
+
   std::unique_ptr<MsgIterPrivate> msgPriv(new MsgIterPrivate(
-        this->dataPtr->db, this->dataPtr->statements));
+        this->dataPtr->db, this->dataPtr->statements,
+        this->dataPtr->merge));
+  msgPriv->dictionaries = this->dataPtr->dictionaries;
+  msgPriv->topicNames = this->dataPtr->topicNames;
   return Batch::iterator(std::move(msgPriv));
 }
 
@@ -84,6 +125,168 @@ Batch::iterator Batch::end()
   return Batch::iterator();
 }
 
+//////////////////////////////////////////////////
+/// \brief Get the bound of a part of a range split in equal parts.
+/// \param[in] _begin Beginning of the range.
+/// \param[in] _end End of the range.
+/// \param[in] _index Index of the part.
+/// \param[in] _count Number of parts.
+/// \return The beginning of the part, or _end if _index is _count.
+static int64_t SplitBound(const int64_t _begin, const int64_t _end,
+    const std::size_t _index, const std::size_t _count)
+{
+  const uint64_t span = static_cast<uint64_t>(_end - _begin);
+  return _begin + static_cast<int64_t>(span / _count * _index +
+    span % _count * _index / _count);
+}
+
+//////////////////////////////////////////////////
+/// \brief Open another connection to the file of a database, to read it
+/// from another thread.
+/// \param[in] _db The database.
+/// \return The connection, or _db itself if it's in memory or the file
+/// couldn't be opened.
+static std::shared_ptr<raii_sqlite3::Database> ReadConnection(
+    const std::shared_ptr<raii_sqlite3::Database> &_db)
+{
+  const char *file = sqlite3_db_filename(_db->Handle(), "main");
+  if (!file || *file == '\0')
+    return _db;
+
+  std::shared_ptr<raii_sqlite3::Database> connection(
+    new raii_sqlite3::Database(file, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI));
+  if (!*connection)
+  {
+    LWRN("Failed to open another connection to [" << file << "], the "
+         "batches share it\n");
+    return _db;
+  }
+  return connection;
+}
+
+//////////////////////////////////////////////////
+std::vector<Batch> Batch::Split(const std::size_t _count) const
+{
+  std::vector<Batch> result(_count);
+  if (!this->dataPtr || _count == 0)
+    return result;
+
+  // The batches of the segments are split, and the nth part of each of them
+  // goes to the nth batch
+  if (this->dataPtr->segments)
+  {
+    std::vector<std::vector<Batch>> parts(_count);
+    for (const Batch &segment : *this->dataPtr->segments)
+    {
+      std::vector<Batch> segmentParts = segment.Split(_count);
+      for (std::size_t i = 0; i < _count; ++i)
+        parts[i].push_back(std::move(segmentParts[i]));
+    }
+    for (std::size_t i = 0; i < _count; ++i)
+    {
+      result[i] = Batch(std::unique_ptr<BatchPrivate>(new BatchPrivate(
+        std::move(parts[i]), this->dataPtr->merge)));
+    }
+    return result;
+  }
+
+  // The messages of a chunked log are split by time received, within the
+  // time range of the query and of the log
+  if (this->dataPtr->chunked)
+  {
+    const ChunkedQuery &query = this->dataPtr->query;
+    int64_t begin = this->dataPtr->chunked->StartTime().count();
+    int64_t end = this->dataPtr->chunked->EndTime().count();
+    const QualifiedTime::Time *queryBegin =
+      query.range.Beginning().GetTime();
+    const QualifiedTime::Time *queryEnd = query.range.Ending().GetTime();
+    if (queryBegin && queryBegin->count() > begin)
+      begin = queryBegin->count();
+    if (queryEnd && queryEnd->count() < end)
+      end = queryEnd->count();
+
+    if (end <= begin)
+    {
+      ChunkedQuery whole = query;
+      result[0] = Batch(std::unique_ptr<BatchPrivate>(new BatchPrivate(
+        this->dataPtr->chunked, std::move(whole))));
+      return result;
+    }
+
+    for (std::size_t i = 0; i < _count; ++i)
+    {
+      const int64_t from = SplitBound(begin, end, i, _count);
+      const int64_t to = SplitBound(begin, end, i + 1, _count);
+      if (i + 1 < _count && from == to)
+        continue;
+
+      ChunkedQuery part = query;
+      part.range = QualifiedTimeRange(
+        i == 0 ? query.range.Beginning() : QualifiedTime(
+          std::chrono::nanoseconds(from),
+          QualifiedTime::Qualifier::INCLUSIVE),
+        i + 1 == _count ? query.range.Ending() : QualifiedTime(
+          std::chrono::nanoseconds(to),
+          QualifiedTime::Qualifier::EXCLUSIVE));
+      result[i] = Batch(std::unique_ptr<BatchPrivate>(new BatchPrivate(
+        this->dataPtr->chunked, std::move(part))));
+    }
+    return result;
+  }
+
+  // The messages of a database are split by row id. The statements are
+  // wrapped, so that their own conditions and limits still apply.
+  int64_t firstId = 1;
+  int64_t lastId = 0;
+  {
+    raii_sqlite3::Statement statement(*this->dataPtr->db,
+      "SELECT MIN(id), MAX(id) FROM messages;");
+    if (!statement || sqlite3_step(statement.Handle()) != SQLITE_ROW)
+    {
+      LERR("Failed to get the range of the messages: " << sqlite3_errmsg(
+        this->dataPtr->db->Handle()) << "\n");
+      return result;
+    }
+    if (sqlite3_column_type(statement.Handle(), 0) != SQLITE_NULL)
+    {
+      firstId = sqlite3_column_int64(statement.Handle(), 0);
+      lastId = sqlite3_column_int64(statement.Handle(), 1);
+    }
+  }
+  if (lastId < firstId)
+    return result;
+
+  for (std::size_t i = 0; i < _count; ++i)
+  {
+    const int64_t from = SplitBound(firstId, lastId + 1, i, _count);
+    const int64_t to = SplitBound(firstId, lastId + 1, i + 1, _count);
+    if (from == to)
+      continue;
+
+    std::vector<SqlStatement> statements;
+    for (const SqlStatement &original : *this->dataPtr->statements)
+    {
+      SqlStatement wrapped{"SELECT * FROM (", {}};
+      wrapped.Append(original);
+      const std::size_t last =
+        wrapped.statement.find_last_not_of("; \t\n");
+      wrapped.statement.erase(last + 1);
+      wrapped.statement += ") WHERE id >= ? AND id < ?;";
+      wrapped.parameters.emplace_back(from);
+      wrapped.parameters.emplace_back(to);
+      statements.push_back(std::move(wrapped));
+    }
+
+    std::unique_ptr<BatchPrivate> part(new BatchPrivate(
+      ReadConnection(this->dataPtr->db), std::move(statements),
+      this->dataPtr->merge));
+    part->dictionaries = this->dataPtr->dictionaries;
+    part->topicNames = this->dataPtr->topicNames;
+    result[i] = Batch(std::move(part));
+  }
+  return result;
+}
+
 //////////////////////////////////////////////////
 Batch::Batch(std::unique_ptr<BatchPrivate> &&_pimpl)  // NOLINT(build/c++11)
   : dataPtr(std::move(_pimpl))
@@ -20,7 +20,11 @@
 #include <memory>
 #include <vector>
 
+#include "ignition/transport/log/Batch.hh"
 #include "ignition/transport/log/SqlStatement.hh"
+#include "ChunkedLog.hh"
+#include "Compression.hh"
+#include "Descriptor.hh"
 #include "raii-sqlite3.hh"
 
 using namespace ignition::transport;
@@ -33,9 +37,26 @@ class ignition::transport::log::BatchPrivate
   /// \brief constructor
   /// \param[in] _db an open sqlite3 database handle wrapper
   /// \param[in] _statements a list of statments to be executed to get messages
+  /// \param[in] _merge true to merge the results of the statements by time
+  /// received, instead of getting them one statement after the other
   public: explicit BatchPrivate(
       const std::shared_ptr<raii_sqlite3::Database> &_db,
-      std::vector<SqlStatement> &&_statements);  // NOLINT(build/c++11)
+      std::vector<SqlStatement> &&_statements,  // NOLINT(build/c++11)
+      bool _merge = false);
+
+  /// \brief constructor
+  /// \param[in] _chunked an open chunked log
+  /// \param[in] _query the messages to get from it
+  public: BatchPrivate(const std::shared_ptr<ChunkedLog> &_chunked,
+      ChunkedQuery &&_query);  // NOLINT(build/c++11)
+
+  /// \brief constructor
+  /// \param[in] _segments the batches of the segments of a log, in order
+  /// \param[in] _merge true to merge the batches by time received, for the
+  /// shards of a log, instead of concatenating them
+  public: explicit BatchPrivate(
+      std::vector<Batch> &&_segments,  // NOLINT(build/c++11)
+      bool _merge = false);
 
   /// \brief destructor
   public: ~BatchPrivate();
@@ -43,8 +64,28 @@ class ignition::transport::log::BatchPrivate
   /// \brief topic names that should be queried
   public: std::shared_ptr<std::vector<SqlStatement>> statements;
 
+  /// \brief true if the results of the statements are merged
+  public: bool merge = false;
+
   /// \brief SQLite3 database pointer wrapper
   public: std::shared_ptr<raii_sqlite3::Database> db;
+
+  /// \brief dictionary of each compressed topic of the database, or
+  /// nullptr if it has none
+  public: std::shared_ptr<const TopicDictionaries> dictionaries;
+
+  /// \brief names of the topics of the database, by id
+  public: std::shared_ptr<const TopicNames> topicNames;
+
+  /// \brief Chunked log, instead of the database
+  public: std::shared_ptr<ChunkedLog> chunked;
+
+  /// \brief messages to get from the chunked log
+  public: ChunkedQuery query;
+
+  /// \brief batches concatenated, for the segments of a log, or merged if
+  /// merge is true
+  public: std::shared_ptr<std::vector<Batch>> segments;
 };
 
 #endif
@@ -0,0 +1,972 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/transport/config.hh>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+#include "../../src/Compression.hh"
+#include "ChunkedLog.hh"
+#include "Console.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+/// \brief Magic number at the beginning of the file.
+static const char kFileMagic[8] = {'I', 'G', 'N', 'C', 'L', 'O', 'G', '1'};
+
+/// \brief Version of the format.
+static const uint32_t kFormatVersion = 1;
+
+/// \brief Size of the file header: magic, version and flags.
+static const uint64_t kFileHeaderSize = 16;
+
+/// \brief Magic number at the beginning of each chunk.
+static const char kChunkMagic[4] = {'C', 'H', 'N', 'K'};
+
+/// \brief Size of the chunk header: magic, compression, message count,
+/// reserved, uncompressed size, stored size, start time and end time.
+static const uint64_t kChunkHeaderSize = 48;
+
+/// \brief Magic number at the beginning of the footer.
+static const char kFooterMagic[4] = {'F', 'O', 'O', 'T'};
+
+/// \brief Magic number at the end of a closed file.
+static const char kTrailerMagic[8] = {'I', 'G', 'N', 'C', 'L', 'E', 'N', 'D'};
+
+/// \brief Size of the trailer: footer offset and magic.
+static const uint64_t kTrailerSize = 16;
+
+/// \brief Compression of the chunks.
+static const uint32_t kCompressionNone = 0;
+static const uint32_t kCompressionZlib = 1;
+
+/// \brief Size of the buffered messages that triggers writing a chunk.
+static const std::size_t kChunkSize = 4 * 1024 * 1024;
+
+/// \brief Maximum time that messages stay buffered, so that a crash loses
+/// about as much as the SQLite logs, which commit twice per second.
+static const std::chrono::milliseconds kFlushPeriod(500);
+
+namespace
+{
+  /// \brief Header of a chunk.
+  struct ChunkHeader
+  {
+    uint32_t compression = kCompressionNone;
+    uint32_t count = 0;
+    uint64_t rawSize = 0;
+    uint64_t storedSize = 0;
+    int64_t start = 0;
+    int64_t end = 0;
+  };
+
+  //////////////////////////////////////////////////
+  /// \brief Append an integer to a buffer.
+  template <typename T>
+  void Put(std::string &_out, const T _value)
+  {
+    _out.append(reinterpret_cast<const char *>(&_value), sizeof(T));
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Append a string, preceded by its size, to a buffer.
+  void PutString(std::string &_out, const std::string &_value)
+  {
+    Put<uint32_t>(_out, static_cast<uint32_t>(_value.size()));
+    _out.append(_value);
+  }
+
+  /// \brief Reads the fields of a buffer, checking its bounds.
+  class BufferReader
+  {
+    /// \brief Constructor
+    /// \param[in] _data The buffer.
+    /// \param[in] _size Size of the buffer.
+    public: BufferReader(const char *_data, const std::size_t _size)
+      : cur(_data), end(_data + _size)
+    {
+    }
+
+    /// \brief Read an integer.
+    /// \param[out] _value The integer.
+    /// \return False if the buffer is too short.
+    public: template <typename T>
+    bool Get(T &_value)
+    {
+      if (static_cast<std::size_t>(this->end - this->cur) < sizeof(T))
+        return false;
+      std::memcpy(&_value, this->cur, sizeof(T));
+      this->cur += sizeof(T);
+      return true;
+    }
+
+    /// \brief Read bytes without copying them.
+    /// \param[in] _size Number of bytes.
+    /// \param[out] _data The bytes, in the buffer.
+    /// \return False if the buffer is too short.
+    public: bool GetBytes(const std::size_t _size, const char *&_data)
+    {
+      if (static_cast<std::size_t>(this->end - this->cur) < _size)
+        return false;
+      _data = this->cur;
+      this->cur += _size;
+      return true;
+    }
+
+    /// \brief Read a string written by PutString().
+    /// \param[out] _value The string.
+    /// \return False if the buffer is too short.
+    public: bool GetString(std::string &_value)
+    {
+      uint32_t size;
+      const char *data;
+      if (!this->Get(size) || !this->GetBytes(size, data))
+        return false;
+      _value.assign(data, size);
+      return true;
+    }
+
+    /// \brief Current position.
+    private: const char *cur;
+
+    /// \brief End of the buffer.
+    private: const char *end;
+  };
+
+  //////////////////////////////////////////////////
+  /// \brief Check whether a time satisfies the beginning of a range.
+  bool AfterBeginning(const QualifiedTimeRange &_range, const int64_t _time)
+  {
+    const QualifiedTime &begin = _range.Beginning();
+    if (begin.IsIndeterminate())
+      return true;
+    if (*begin.GetQualifier() == QualifiedTime::Qualifier::EXCLUSIVE)
+      return _time > begin.GetTime()->count();
+    return _time >= begin.GetTime()->count();
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Check whether a time satisfies the ending of a range.
+  bool BeforeEnding(const QualifiedTimeRange &_range, const int64_t _time)
+  {
+    const QualifiedTime &end = _range.Ending();
+    if (end.IsIndeterminate())
+      return true;
+    if (*end.GetQualifier() == QualifiedTime::Qualifier::EXCLUSIVE)
+      return _time < end.GetTime()->count();
+    return _time <= end.GetTime()->count();
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Read the file size and rewind.
+  uint64_t FileSize(std::istream &_in)
+  {
+    _in.seekg(0, std::ios_base::end);
+    const std::streamoff size = _in.tellg();
+    _in.seekg(0, std::ios_base::beg);
+    return size > 0 ? static_cast<uint64_t>(size) : 0u;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Parse the header of a chunk.
+  /// \param[in] _buffer The kChunkHeaderSize bytes of the header.
+  /// \param[in] _offset Offset of the chunk.
+  /// \param[in] _limit Offset where the chunks end.
+  /// \param[out] _header Header of the chunk.
+  /// \return False if the header is corrupted or the chunk incomplete.
+  bool ParseChunkHeader(const char *_buffer, const uint64_t _offset,
+      const uint64_t _limit, ChunkHeader &_header)
+  {
+    BufferReader reader(_buffer, kChunkHeaderSize);
+    const char *magic;
+    uint32_t reserved;
+    reader.GetBytes(sizeof(kChunkMagic), magic);
+    reader.Get(_header.compression);
+    reader.Get(_header.count);
+    reader.Get(reserved);
+    reader.Get(_header.rawSize);
+    reader.Get(_header.storedSize);
+    reader.Get(_header.start);
+    reader.Get(_header.end);
+    if (std::memcmp(magic, kChunkMagic, sizeof(kChunkMagic)) != 0 ||
+        _header.storedSize > _limit - _offset - kChunkHeaderSize)
+    {
+      return false;
+    }
+
+    if (_header.compression == kCompressionNone &&
+        _header.rawSize != _header.storedSize)
+    {
+      return false;
+    }
+
+    if (_header.compression != kCompressionNone &&
+        _header.compression != kCompressionZlib)
+    {
+      LERR("Unknown compression [" << _header.compression
+          << "] of the chunk at offset " << _offset << "\n");
+      return false;
+    }
+    return true;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Decompress the payload of a chunk compressed with zlib.
+  /// \param[in] _stored The stored payload.
+  /// \param[in] _header Header of the chunk.
+  /// \param[in] _offset Offset of the chunk.
+  /// \param[out] _raw Uncompressed payload.
+  /// \return False if the payload is corrupted.
+  bool Decompress(const char *_stored, const ChunkHeader &_header,
+      const uint64_t _offset, std::string &_raw)
+  {
+#ifdef HAVE_ZLIB
+    (void)_offset;
+    return ZlibInflate(_stored, static_cast<std::size_t>(_header.storedSize),
+        _header.rawSize, _raw);
+#else
+    (void)_stored;
+    (void)_header;
+    (void)_raw;
+    LERR("The chunk at offset " << _offset << " is compressed with zlib,"
+        << " which is not available in this build\n");
+    return false;
+#endif
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Read a chunk and decompress its payload.
+  /// \param[in] _in The log file.
+  /// \param[in] _offset Offset of the chunk.
+  /// \param[in] _limit Offset where the chunks end.
+  /// \param[out] _header Header of the chunk.
+  /// \param[out] _raw Uncompressed payload.
+  /// \return False if the chunk is incomplete or corrupted.
+  bool ReadChunk(std::istream &_in, const uint64_t _offset,
+      const uint64_t _limit, ChunkHeader &_header, std::string &_raw)
+  {
+    if (_offset + kChunkHeaderSize > _limit)
+      return false;
+
+    char buffer[kChunkHeaderSize];
+    _in.clear();
+    _in.seekg(static_cast<std::streamoff>(_offset));
+    if (!_in.read(buffer, sizeof(buffer)) ||
+        !ParseChunkHeader(buffer, _offset, _limit, _header))
+    {
+      return false;
+    }
+
+    std::string stored(static_cast<std::size_t>(_header.storedSize), '\0');
+    if (!stored.empty() && !_in.read(&stored[0], stored.size()))
+      return false;
+
+    if (_header.compression == kCompressionNone)
+    {
+      _raw = std::move(stored);
+      return true;
+    }
+    return Decompress(stored.data(), _header, _offset, _raw);
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Get the payload of a chunk of a memory mapped file. An
+  /// uncompressed payload is used where it's mapped, without a copy.
+  /// \param[in] _mapped The mapped file.
+  /// \param[in] _offset Offset of the chunk.
+  /// \param[in] _limit Offset where the chunks end.
+  /// \param[out] _header Header of the chunk.
+  /// \param[out] _raw Uncompressed payload, if it was compressed.
+  /// \param[out] _payload Uncompressed payload in the mapped file, or
+  /// nullptr if it was compressed.
+  /// \return False if the chunk is incomplete or corrupted.
+  bool MapChunk(const char *_mapped, const uint64_t _offset,
+      const uint64_t _limit, ChunkHeader &_header, std::string &_raw,
+      const char *&_payload)
+  {
+    _payload = nullptr;
+    if (_offset + kChunkHeaderSize > _limit ||
+        !ParseChunkHeader(_mapped + _offset, _offset, _limit, _header))
+    {
+      return false;
+    }
+
+    const char *stored = _mapped + _offset + kChunkHeaderSize;
+    if (_header.compression == kCompressionNone)
+    {
+      _payload = stored;
+      return true;
+    }
+    return Decompress(stored, _header, _offset, _raw);
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Parse the uncompressed payload of a chunk.
+  /// \param[in] _raw The payload.
+  /// \param[in] _count Number of messages.
+  /// \param[in] _onTopic Called for each topic defined by the chunk.
+  /// \param[in] _onMessage Called for each message.
+  /// \return False if the payload is corrupted.
+  bool ParseChunk(std::string_view _raw, const uint32_t _count,
+      const std::function<void(int64_t, TopicKey &&)> &_onTopic,
+      const std::function<void(int64_t, int64_t, const char *,
+        std::size_t)> &_onMessage)
+  {
+    BufferReader reader(_raw.data(), _raw.size());
+
+    uint32_t numTopics;
+    if (!reader.Get(numTopics))
+      return false;
+    for (uint32_t i = 0; i < numTopics; ++i)
+    {
+      int64_t id;
+      TopicKey key;
+      if (!reader.Get(id) || !reader.GetString(key.topic) ||
+          !reader.GetString(key.type))
+      {
+        return false;
+      }
+      _onTopic(id, std::move(key));
+    }
+
+    for (uint32_t i = 0; i < _count; ++i)
+    {
+      int64_t time;
+      uint32_t topic;
+      uint32_t len;
+      const char *data;
+      if (!reader.Get(time) || !reader.Get(topic) || !reader.Get(len) ||
+          !reader.GetBytes(len, data))
+      {
+        return false;
+      }
+      _onMessage(time, topic, data, len);
+    }
+    return true;
+  }
+}
+
+//////////////////////////////////////////////////
+ChunkedLogCursor::ChunkedLogCursor(const std::string &_file,
+    const std::map<int64_t, TopicKey> &_topics,
+    std::vector<ChunkInfo> &&_chunks,  // NOLINT(build/c++11)
+    const ChunkedQuery &_query)
+  : topics(_topics),
+    chunks(std::move(_chunks)),
+    query(_query)
+{
+#ifndef _WIN32
+  // The chunks are read where they're mapped, the pages are shared by the
+  // processes reading the same log. The writers only append to the file.
+  const int fd = ::open(_file.c_str(), O_RDONLY);
+  if (fd >= 0)
+  {
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+      void *address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+        PROT_READ, MAP_SHARED, fd, 0);
+      if (address != MAP_FAILED)
+      {
+        ::madvise(address, static_cast<std::size_t>(info.st_size),
+          MADV_SEQUENTIAL);
+        this->mapped = static_cast<const char *>(address);
+        this->size = static_cast<uint64_t>(info.st_size);
+      }
+    }
+    ::close(fd);
+  }
+  if (this->mapped)
+    return;
+#endif
+
+  this->in.open(_file, std::ios_base::in | std::ios_base::binary);
+  if (!this->in)
+  {
+    LERR("Failed to open log file [" << _file << "]\n");
+    this->chunks.clear();
+    return;
+  }
+  this->size = FileSize(this->in);
+}
+
+//////////////////////////////////////////////////
+ChunkedLogCursor::~ChunkedLogCursor()
+{
+#ifndef _WIN32
+  if (this->mapped)
+  {
+    ::munmap(const_cast<char *>(this->mapped),
+      static_cast<std::size_t>(this->size));
+  }
+#endif
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLogCursor::LoadWindow()
+{
+  this->buffers.clear();
+  this->entries.clear();
+  this->nextEntry = 0;
+
+  while (this->entries.empty() && this->nextChunk < this->chunks.size())
+  {
+    // The messages are sorted within a chunk, but the time ranges of
+    // consecutive chunks may overlap when messages arrive out of order.
+    const std::size_t first = this->nextChunk;
+    int64_t windowEnd = this->chunks[first].end;
+    for (++this->nextChunk; this->nextChunk < this->chunks.size() &&
+         this->chunks[this->nextChunk].start <= windowEnd; ++this->nextChunk)
+    {
+      windowEnd = std::max(windowEnd, this->chunks[this->nextChunk].end);
+    }
+
+    // The entries point into the buffers, which must not be reallocated.
+    this->buffers.reserve(this->nextChunk - first);
+    for (std::size_t i = first; i < this->nextChunk; ++i)
+    {
+      ChunkHeader header;
+      std::string raw;
+      const char *direct = nullptr;
+      const bool read = this->mapped ?
+        MapChunk(this->mapped, this->chunks[i].offset, this->size, header,
+          raw, direct) :
+        ReadChunk(this->in, this->chunks[i].offset, this->size, header, raw);
+      if (!read)
+      {
+        LERR("Failed to read the chunk at offset " << this->chunks[i].offset
+            << ", its messages are skipped\n");
+        continue;
+      }
+
+      // The uncompressed chunks of a mapped file need no buffer
+      std::string_view payload;
+      if (direct)
+      {
+        payload = std::string_view(direct,
+          static_cast<std::size_t>(header.rawSize));
+      }
+      else
+      {
+        this->buffers.push_back(std::move(raw));
+        payload = this->buffers.back();
+      }
+
+      const std::size_t before = this->entries.size();
+      const bool parsed = ParseChunk(payload, header.count,
+        [](int64_t, TopicKey &&) {},
+        [this](const int64_t _time, const int64_t _topic,
+               const char *_data, const std::size_t _len)
+        {
+          if (this->query.topics.count(_topic) &&
+              AfterBeginning(this->query.range, _time) &&
+              BeforeEnding(this->query.range, _time))
+          {
+            this->entries.push_back(Entry{_time, _topic, _data, _len});
+          }
+        });
+      if (!parsed)
+      {
+        LERR("The chunk at offset " << this->chunks[i].offset
+            << " is corrupted, its messages are skipped\n");
+        this->entries.resize(before);
+      }
+    }
+
+    if (this->nextChunk - first > 1)
+    {
+      std::stable_sort(this->entries.begin(), this->entries.end(),
+        [](const Entry &_a, const Entry &_b) {return _a.time < _b.time;});
+    }
+  }
+
+  return !this->entries.empty();
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLogCursor::Next(std::unique_ptr<Message> &_message)
+{
+  while (true)
+  {
+    if (this->nextEntry >= this->entries.size() && !this->LoadWindow())
+      return false;
+
+    const Entry &entry = this->entries[this->nextEntry++];
+    const auto it = this->topics.find(entry.topic);
+    if (it == this->topics.end())
+      continue;
+
+    if (this->query.period > 0)
+    {
+      const auto last = this->lastSelected.find(entry.topic);
+      if (last != this->lastSelected.end() &&
+          entry.time < last->second + this->query.period)
+      {
+        continue;
+      }
+      this->lastSelected[entry.topic] = entry.time;
+    }
+
+    _message.reset(new Message(std::chrono::nanoseconds(entry.time),
+          entry.data, entry.len, it->second.type, it->second.topic));
+    return true;
+  }
+}
+
+//////////////////////////////////////////////////
+ChunkedLog::~ChunkedLog()
+{
+  this->Close();
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLog::IsChunkedLog(const std::string &_file)
+{
+  std::ifstream in(_file, std::ios_base::in | std::ios_base::binary);
+  char magic[sizeof(kFileMagic)];
+  return in.read(magic, sizeof(magic)) &&
+    std::memcmp(magic, kFileMagic, sizeof(kFileMagic)) == 0;
+}
+
+//////////////////////////////////////////////////
+std::string ChunkedLog::Version()
+{
+  return "chunked-" + std::to_string(kFormatVersion);
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLog::Open(const std::string &_file,
+    const std::ios_base::openmode _mode)
+{
+  if (std::ios_base::out & _mode)
+  {
+    if (!this->out.Open(_file))
+    {
+      LERR("Failed to create log file [" << _file << "]\n");
+      return false;
+    }
+
+    std::string header(kFileMagic, sizeof(kFileMagic));
+    Put<uint32_t>(header, kFormatVersion);
+    Put<uint32_t>(header, 0u);
+    if (!this->out.Write(header.data(), header.size()))
+    {
+      LERR("Failed to write log file [" << _file << "]\n");
+      return false;
+    }
+
+    this->offset = kFileHeaderSize;
+    this->writing = true;
+    this->filename = _file;
+    return true;
+  }
+
+  std::ifstream in(_file, std::ios_base::in | std::ios_base::binary);
+  if (!in)
+  {
+    LERR("Failed to open log file [" << _file << "]\n");
+    return false;
+  }
+
+  const uint64_t size = FileSize(in);
+  char header[kFileHeaderSize];
+  uint32_t version = 0;
+  if (size < kFileHeaderSize || !in.read(header, sizeof(header)) ||
+      std::memcmp(header, kFileMagic, sizeof(kFileMagic)) != 0)
+  {
+    LERR("[" << _file << "] is not a chunked log\n");
+    return false;
+  }
+  std::memcpy(&version, header + sizeof(kFileMagic), sizeof(version));
+  if (version != kFormatVersion)
+  {
+    LERR("Chunked log version '" << version
+        << "' is unsupported by this tool\n");
+    return false;
+  }
+
+  if (!this->ReadFooter(in, size))
+  {
+    this->Recover(in, size);
+    LWRN("The log file [" << _file << "] was not closed properly, "
+        << this->chunks.size() << " chunks were recovered\n");
+  }
+
+  this->filename = _file;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLog::ReadFooter(std::istream &_in, const uint64_t _size)
+{
+  if (_size < kFileHeaderSize + kTrailerSize)
+    return false;
+
+  char trailer[kTrailerSize];
+  _in.clear();
+  _in.seekg(static_cast<std::streamoff>(_size - kTrailerSize));
+  if (!_in.read(trailer, sizeof(trailer)) ||
+      std::memcmp(trailer + sizeof(uint64_t), kTrailerMagic,
+        sizeof(kTrailerMagic)) != 0)
+  {
+    return false;
+  }
+
+  uint64_t footerOffset;
+  std::memcpy(&footerOffset, trailer, sizeof(footerOffset));
+  if (footerOffset < kFileHeaderSize || footerOffset > _size - kTrailerSize)
+    return false;
+
+  std::string footer(
+    static_cast<std::size_t>(_size - kTrailerSize - footerOffset), '\0');
+  _in.seekg(static_cast<std::streamoff>(footerOffset));
+  if (footer.size() < sizeof(kFooterMagic) ||
+      !_in.read(&footer[0], footer.size()) ||
+      std::memcmp(footer.data(), kFooterMagic, sizeof(kFooterMagic)) != 0)
+  {
+    return false;
+  }
+
+  BufferReader reader(footer.data() + sizeof(kFooterMagic),
+    footer.size() - sizeof(kFooterMagic));
+  TopicKeyMap topicsInLog;
+  std::vector<ChunkInfo> chunksInLog;
+
+  uint32_t numTopics;
+  if (!reader.Get(numTopics))
+    return false;
+  for (uint32_t i = 0; i < numTopics; ++i)
+  {
+    int64_t id;
+    TopicKey key;
+    if (!reader.Get(id) || !reader.GetString(key.topic) ||
+        !reader.GetString(key.type))
+    {
+      return false;
+    }
+    topicsInLog[key] = id;
+  }
+
+  uint32_t numChunks;
+  if (!reader.Get(numChunks))
+    return false;
+  for (uint32_t i = 0; i < numChunks; ++i)
+  {
+    ChunkInfo info;
+    uint32_t numChunkTopics;
+    if (!reader.Get(info.offset) || !reader.Get(info.start) ||
+        !reader.Get(info.end) || !reader.Get(info.count) ||
+        !reader.Get(numChunkTopics) || info.offset >= footerOffset)
+    {
+      return false;
+    }
+    for (uint32_t j = 0; j < numChunkTopics; ++j)
+    {
+      uint32_t id;
+      if (!reader.Get(id))
+        return false;
+      info.topics.insert(id);
+    }
+    chunksInLog.push_back(std::move(info));
+  }
+
+  this->topics = std::move(topicsInLog);
+  this->chunks = std::move(chunksInLog);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void ChunkedLog::Recover(std::istream &_in, const uint64_t _size)
+{
+  this->topics.clear();
+  this->chunks.clear();
+
+  uint64_t chunkOffset = kFileHeaderSize;
+  ChunkHeader header;
+  std::string raw;
+  while (ReadChunk(_in, chunkOffset, _size, header, raw))
+  {
+    ChunkInfo info;
+    info.offset = chunkOffset;
+    info.start = header.start;
+    info.end = header.end;
+    info.count = header.count;
+
+    TopicKeyMap chunkTopics;
+    const bool parsed = ParseChunk(raw, header.count,
+      [&chunkTopics](const int64_t _id, TopicKey &&_key)
+      {
+        chunkTopics[std::move(_key)] = _id;
+      },
+      [&info](int64_t, const int64_t _topic, const char *, std::size_t)
+      {
+        info.topics.insert(_topic);
+      });
+    if (!parsed)
+      break;
+
+    this->topics.insert(chunkTopics.begin(), chunkTopics.end());
+    this->chunks.push_back(std::move(info));
+    chunkOffset += kChunkHeaderSize + header.storedSize;
+  }
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLog::Insert(const std::chrono::nanoseconds &_time,
+    const std::string &_topic, const std::string &_type,
+    const void *_data, const std::size_t _len)
+{
+  if (!this->writing)
+    return false;
+
+  if (_len > std::numeric_limits<uint32_t>::max())
+  {
+    LERR("Message of " << _len << " bytes is too large for a chunked log\n");
+    return false;
+  }
+
+  TopicKey key{_topic, _type};
+  auto it = this->topics.find(key);
+  if (it == this->topics.end())
+  {
+    const int64_t id = static_cast<int64_t>(this->topics.size()) + 1;
+    it = this->topics.emplace(std::move(key), id).first;
+    this->newTopics.push_back(id);
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (this->pending.empty())
+    this->pendingSince = now;
+
+  this->pending.push_back(
+    Pending{_time.count(), it->second, this->pendingData.size(), _len});
+  this->pendingData.append(static_cast<const char *>(_data), _len);
+
+  if (this->pendingData.size() >= kChunkSize ||
+      now - this->pendingSince >= kFlushPeriod)
+  {
+    return this->Flush();
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLog::Flush()
+{
+  if (!this->writing || this->pending.empty())
+    return true;
+
+  std::stable_sort(this->pending.begin(), this->pending.end(),
+    [](const Pending &_a, const Pending &_b) {return _a.time < _b.time;});
+
+  ChunkInfo info;
+  info.offset = this->offset;
+  info.start = this->pending.front().time;
+  info.end = this->pending.back().time;
+  info.count = static_cast<uint32_t>(this->pending.size());
+
+  std::string raw;
+  raw.reserve(this->pendingData.size() + this->pending.size() * 16 + 4);
+  Put<uint32_t>(raw, static_cast<uint32_t>(this->newTopics.size()));
+  for (const int64_t id : this->newTopics)
+  {
+    for (const auto &topic : this->topics)
+    {
+      if (topic.second != id)
+        continue;
+      Put<int64_t>(raw, id);
+      PutString(raw, topic.first.topic);
+      PutString(raw, topic.first.type);
+    }
+  }
+  for (const Pending &msg : this->pending)
+  {
+    Put<int64_t>(raw, msg.time);
+    Put<uint32_t>(raw, static_cast<uint32_t>(msg.topic));
+    Put<uint32_t>(raw, static_cast<uint32_t>(msg.len));
+    raw.append(this->pendingData, msg.offset, msg.len);
+    info.topics.insert(msg.topic);
+  }
+
+  uint32_t compression = kCompressionNone;
+  std::string stored;
+  // Favor speed, the recorder has to keep up with the incoming messages.
+  if (ZlibDeflate(raw.data(), raw.size(), stored))
+    compression = kCompressionZlib;
+  const std::string &payload =
+    compression == kCompressionNone ? raw : stored;
+
+  std::string header(kChunkMagic, sizeof(kChunkMagic));
+  Put<uint32_t>(header, compression);
+  Put<uint32_t>(header, info.count);
+  Put<uint32_t>(header, 0u);
+  Put<uint64_t>(header, raw.size());
+  Put<uint64_t>(header, payload.size());
+  Put<int64_t>(header, info.start);
+  Put<int64_t>(header, info.end);
+
+  // The errors of the previous chunks are only known once written.
+  const bool written = this->out.Write(header.data(), header.size()) &&
+    this->out.Write(payload.data(), payload.size());
+
+  this->pending.clear();
+  this->pendingData.clear();
+  this->newTopics.clear();
+
+  if (!written)
+  {
+    LERR("Failed to write a chunk of " << info.count << " messages to ["
+        << this->filename << "]\n");
+    return false;
+  }
+
+  this->offset += header.size() + payload.size();
+  this->chunks.push_back(std::move(info));
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ChunkedLog::Close()
+{
+  if (!this->writing)
+    return true;
+
+  bool result = this->Flush();
+  this->writing = false;
+
+  std::string footer(kFooterMagic, sizeof(kFooterMagic));
+  Put<uint32_t>(footer, static_cast<uint32_t>(this->topics.size()));
+  for (const auto &topic : this->topics)
+  {
+    Put<int64_t>(footer, topic.second);
+    PutString(footer, topic.first.topic);
+    PutString(footer, topic.first.type);
+  }
+  Put<uint32_t>(footer, static_cast<uint32_t>(this->chunks.size()));
+  for (const ChunkInfo &info : this->chunks)
+  {
+    Put<uint64_t>(footer, info.offset);
+    Put<int64_t>(footer, info.start);
+    Put<int64_t>(footer, info.end);
+    Put<uint32_t>(footer, info.count);
+    Put<uint32_t>(footer, static_cast<uint32_t>(info.topics.size()));
+    for (const int64_t id : info.topics)
+      Put<uint32_t>(footer, static_cast<uint32_t>(id));
+  }
+  Put<uint64_t>(footer, this->offset);
+  footer.append(kTrailerMagic, sizeof(kTrailerMagic));
+
+  const bool footerWritten = this->out.Write(footer.data(), footer.size());
+  if (!this->out.Close() || !footerWritten)
+  {
+    LERR("Failed to write the index of [" << this->filename << "]\n");
+    result = false;
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+const TopicKeyMap &ChunkedLog::Topics() const
+{
+  return this->topics;
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds ChunkedLog::StartTime() const
+{
+  bool found = false;
+  int64_t start = 0;
+  for (const ChunkInfo &info : this->chunks)
+  {
+    start = found ? std::min(start, info.start) : info.start;
+    found = true;
+  }
+  for (const Pending &msg : this->pending)
+  {
+    start = found ? std::min(start, msg.time) : msg.time;
+    found = true;
+  }
+  return std::chrono::nanoseconds(start);
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds ChunkedLog::EndTime() const
+{
+  bool found = false;
+  int64_t end = 0;
+  for (const ChunkInfo &info : this->chunks)
+  {
+    end = found ? std::max(end, info.end) : info.end;
+    found = true;
+  }
+  for (const Pending &msg : this->pending)
+  {
+    end = found ? std::max(end, msg.time) : msg.time;
+    found = true;
+  }
+  return std::chrono::nanoseconds(end);
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<ChunkedLogCursor> ChunkedLog::Query(
+    const ChunkedQuery &_query)
+{
+  // The cursor reads the file, so the buffered messages must be in it.
+  this->Flush();
+  if (this->writing)
+    this->out.Sync();
+
+  std::vector<ChunkInfo> selected;
+  for (const ChunkInfo &info : this->chunks)
+  {
+    if (!AfterBeginning(_query.range, info.end) ||
+        !BeforeEnding(_query.range, info.start))
+    {
+      continue;
+    }
+
+    const bool hasTopic = std::any_of(info.topics.begin(), info.topics.end(),
+      [&_query](const int64_t _id) {return _query.topics.count(_id) > 0;});
+    if (hasTopic)
+      selected.push_back(info);
+  }
+  std::stable_sort(selected.begin(), selected.end(),
+    [](const ChunkInfo &_a, const ChunkInfo &_b)
+    {
+      return _a.start < _b.start;
+    });
+
+  std::map<int64_t, TopicKey> names;
+  for (const auto &topic : this->topics)
+    names[topic.second] = topic.first;
+
+  return std::unique_ptr<ChunkedLogCursor>(new ChunkedLogCursor(
+    this->filename, names, std::move(selected), _query));
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_SRC_CHUNKEDLOG_HH_
+#define IGNITION_TRANSPORT_LOG_SRC_CHUNKEDLOG_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/log/Message.hh"
+#include "ignition/transport/log/QualifiedTime.hh"
+#include "AsyncWriter.hh"
+#include "Descriptor.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Entry of the index of a chunked log, one per chunk.
+      struct ChunkInfo
+      {
+        /// \brief Offset of the chunk in the file.
+        uint64_t offset = 0;
+
+        /// \brief Time of the first message of the chunk (ns).
+        int64_t start = 0;
+
+        /// \brief Time of the last message of the chunk (ns).
+        int64_t end = 0;
+
+        /// \brief Number of messages in the chunk.
+        uint32_t count = 0;
+
+        /// \brief Ids of the topics with messages in the chunk.
+        std::set<int64_t> topics;
+      };
+
+      /// \brief Messages selected by a query of a chunked log.
+      struct ChunkedQuery
+      {
+        /// \brief Ids of the topics of the messages.
+        std::set<int64_t> topics;
+
+        /// \brief Time range of the messages.
+        QualifiedTimeRange range = QualifiedTimeRange::AllTime();
+
+        /// \brief Minimum time between the selected messages of a topic
+        /// (ns), see DownsampledTopics. Zero selects every message.
+        int64_t period = 0;
+      };
+
+      /// \brief Iterates through the messages selected by a ChunkedQuery,
+      /// in the order they were received.
+      class ChunkedLogCursor
+      {
+        /// \brief Constructor
+        /// \param[in] _file Path to the log file.
+        /// \param[in] _topics Topic name and type of each topic id.
+        /// \param[in] _chunks The chunks to read, sorted by start time.
+        /// \param[in] _query The messages to select.
+        public: ChunkedLogCursor(const std::string &_file,
+            const std::map<int64_t, TopicKey> &_topics,
+            std::vector<ChunkInfo> &&_chunks,  // NOLINT(build/c++11)
+            const ChunkedQuery &_query);
+
+        /// \brief Destructor. Unmaps the log file.
+        public: ~ChunkedLogCursor();
+
+        /// \brief Move to the next message.
+        /// \param[out] _message The message. It refers to the memory of
+        /// this cursor, which is valid until the next call.
+        /// \return False if there are no more messages.
+        public: bool Next(std::unique_ptr<Message> &_message);
+
+        /// \brief Decode the next chunks, every chunk whose time range
+        /// overlaps the ones before, so that their messages can be sorted.
+        /// \return False if there are no more chunks.
+        private: bool LoadWindow();
+
+        /// \brief A selected message of the current chunks.
+        private: struct Entry
+        {
+          /// \brief Time received (ns).
+          int64_t time;
+
+          /// \brief Topic id.
+          int64_t topic;
+
+          /// \brief Message data, in one of the buffers or the mapped file.
+          const char *data;
+
+          /// \brief Number of bytes of data.
+          std::size_t len;
+        };
+
+        /// \brief The log file, if it could not be memory mapped.
+        private: std::ifstream in;
+
+        /// \brief The memory mapped log file, nullptr if it's read through
+        /// in instead.
+        private: const char *mapped = nullptr;
+
+        /// \brief Size of the log file.
+        private: uint64_t size = 0;
+
+        /// \brief Topic name and type of each topic id.
+        private: std::map<int64_t, TopicKey> topics;
+
+        /// \brief The chunks to read.
+        private: std::vector<ChunkInfo> chunks;
+
+        /// \brief Index of the next chunk to decode.
+        private: std::size_t nextChunk = 0;
+
+        /// \brief The messages to select.
+        private: ChunkedQuery query;
+
+        /// \brief Decompressed data of the current chunks, or all of their
+        /// data if the file is not mapped.
+        private: std::vector<std::string> buffers;
+
+        /// \brief Selected messages of the current chunks, sorted by time.
+        private: std::vector<Entry> entries;
+
+        /// \brief Index of the next entry.
+        private: std::size_t nextEntry = 0;
+
+        /// \brief Time of the last selected message of each topic, when
+        /// downsampling.
+        private: std::map<int64_t, int64_t> lastSelected;
+      };
+
+      /// \brief Append-only log file made of chunks of messages, followed
+      /// by an index of the chunks.
+      ///
+      /// The messages are buffered and written a chunk at a time, compressed
+      /// with zlib when it's available, by an AsyncWriter so that appending
+      /// doesn't wait for the disk. Each chunk starts with a header holding
+      /// its size and time range, and defines the topics that appear for
+      /// the first time. While closing, a footer with the topics
+      /// and the time range and topics of every chunk is appended, so that
+      /// queries only decode the chunks they need. A file without a footer,
+      /// e.g. after a crash, is recovered by reading the chunks in order.
+      ///
+      /// The integers are stored in the byte order of the host.
+      class ChunkedLog
+      {
+        /// \brief Destructor. Closes the log.
+        public: ~ChunkedLog();
+
+        /// \brief Check whether a file is a chunked log.
+        /// \param[in] _file Path to the file.
+        /// \return True if the file starts like a chunked log.
+        public: static bool IsChunkedLog(const std::string &_file);
+
+        /// \brief Get the version of the format.
+        /// \return The version, as reported by Log::Version().
+        public: static std::string Version();
+
+        /// \brief Open a log file.
+        /// \param[in] _file Path to the log file.
+        /// \param[in] _mode std::ios_base::out creates (or truncates) the
+        /// file to write it, std::ios_base::in opens it to read it.
+        /// \return True if the log was opened.
+        public: bool Open(const std::string &_file,
+            std::ios_base::openmode _mode);
+
+        /// \brief Append a message.
+        /// \param[in] _time Time the message was received (ns).
+        /// \param[in] _topic Name of the topic.
+        /// \param[in] _type Name of the message type.
+        /// \param[in] _data Message data.
+        /// \param[in] _len Number of bytes of data.
+        /// \return True if the message was appended.
+        public: bool Insert(const std::chrono::nanoseconds &_time,
+            const std::string &_topic, const std::string &_type,
+            const void *_data, std::size_t _len);
+
+        /// \brief Write the buffered messages as a chunk.
+        /// \return True if there was nothing to write or it was written.
+        public: bool Flush();
+
+        /// \brief Write the buffered messages and the footer.
+        /// \return True on success.
+        public: bool Close();
+
+        /// \brief Get the topics of the log.
+        /// \return Id of each topic name and type.
+        public: const TopicKeyMap &Topics() const;
+
+        /// \brief Get the time of the first message.
+        /// \return The time, or zero if the log has no messages.
+        public: std::chrono::nanoseconds StartTime() const;
+
+        /// \brief Get the time of the last message.
+        /// \return The time, or zero if the log has no messages.
+        public: std::chrono::nanoseconds EndTime() const;
+
+        /// \brief Select messages. The buffered messages are written first.
+        /// \param[in] _query The messages to select.
+        /// \return A cursor through the messages.
+        public: std::unique_ptr<ChunkedLogCursor> Query(
+            const ChunkedQuery &_query);
+
+        /// \brief Read the footer.
+        /// \param[in] _in The log file.
+        /// \param[in] _size Size of the file.
+        /// \return True if the file has a valid footer.
+        private: bool ReadFooter(std::istream &_in, uint64_t _size);
+
+        /// \brief Rebuild the index by reading the chunks in order. Stops at
+        /// the first incomplete chunk.
+        /// \param[in] _in The log file.
+        /// \param[in] _size Size of the file.
+        private: void Recover(std::istream &_in, uint64_t _size);
+
+        /// \brief Path to the log file.
+        private: std::string filename;
+
+        /// \brief The file, while writing.
+        private: AsyncWriter out;
+
+        /// \brief True if the log is open for writing and not closed.
+        private: bool writing = false;
+
+        /// \brief Size of the file written so far.
+        private: uint64_t offset = 0;
+
+        /// \brief Id of each topic name and type.
+        private: TopicKeyMap topics;
+
+        /// \brief Index of the written chunks.
+        private: std::vector<ChunkInfo> chunks;
+
+        /// \brief A buffered message.
+        private: struct Pending
+        {
+          /// \brief Time received (ns).
+          int64_t time;
+
+          /// \brief Topic id.
+          int64_t topic;
+
+          /// \brief Offset of the data in pendingData.
+          std::size_t offset;
+
+          /// \brief Number of bytes of data.
+          std::size_t len;
+        };
+
+        /// \brief Buffered messages.
+        private: std::vector<Pending> pending;
+
+        /// \brief Data of the buffered messages.
+        private: std::string pendingData;
+
+        /// \brief Topics added since the last chunk.
+        private: std::vector<int64_t> newTopics;
+
+        /// \brief When the first buffered message was appended.
+        private: std::chrono::steady_clock::time_point pendingSince;
+      };
+      }
+    }
+  }
+}
+
+#endif
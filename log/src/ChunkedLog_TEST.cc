@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+/// \brief Path of the log files created by the tests.
+static const char kPath[] = "ChunkedLog_TEST.clog";
+
+//////////////////////////////////////////////////
+/// \brief Insert a message whose data is its topic followed by its time.
+/// \param[in] _log The log.
+/// \param[in] _time Time of the message.
+/// \param[in] _topic Topic of the message.
+/// \return True if the message was inserted.
+static bool Insert(log::Log &_log, const std::chrono::nanoseconds &_time,
+    const std::string &_topic)
+{
+  const std::string data = _topic + "@" + std::to_string(_time.count());
+  return _log.InsertMessage(_time, _topic, "some.message.type",
+    data.data(), data.size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the data of the messages of a batch.
+/// \param[in] _batch The batch.
+/// \return The data of each message, in order.
+static std::vector<std::string> Data(log::Batch _batch)
+{
+  std::vector<std::string> result;
+  for (const log::Message &msg : _batch)
+    result.push_back(msg.Data());
+  return result;
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, FormatFromExtension)
+{
+  std::remove(kPath);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+    EXPECT_EQ(log::LogFormat::CHUNKED, logFile.Format());
+    EXPECT_EQ("chunked-1", logFile.Version());
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath));
+  EXPECT_EQ(log::LogFormat::CHUNKED, logFile.Format());
+
+  log::Log memoryLog;
+  ASSERT_TRUE(memoryLog.Open(":memory:", std::ios_base::out));
+  EXPECT_EQ(log::LogFormat::SQLITE, memoryLog.Format());
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, ExplicitFormat)
+{
+  const std::string path = "ChunkedLog_TEST_explicit.tlog";
+  std::remove(path.c_str());
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out,
+      log::LogFormat::CHUNKED));
+    EXPECT_TRUE(Insert(logFile, 1s, "/foo"));
+  }
+
+  // The format is detected from the content
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  EXPECT_EQ(log::LogFormat::CHUNKED, logFile.Format());
+  EXPECT_EQ(std::vector<std::string>{"/foo@1000000000"},
+    Data(logFile.QueryMessages()));
+
+  log::Log sqliteLog;
+  EXPECT_FALSE(sqliteLog.Open(path, std::ios_base::in,
+    log::LogFormat::SQLITE));
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, InsertAndQuery)
+{
+  std::remove(kPath);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+    EXPECT_TRUE(Insert(logFile, 1s, "/foo"));
+    EXPECT_TRUE(Insert(logFile, 2s, "/bar"));
+    EXPECT_TRUE(Insert(logFile, 3s, "/foo"));
+
+    // Empty messages are skipped, like in the SQLite3 logs
+    EXPECT_FALSE(logFile.InsertMessage(4s, "/foo", "some.message.type",
+      nullptr, 0));
+
+    std::vector<log::MessageRecord> records;
+    const std::string topic = "/baz";
+    const std::string type = "other.message.type";
+    const std::string data = "/baz@4000000000";
+    records.push_back({4s, &topic, &type, data.data(), data.size()});
+    EXPECT_EQ(1u, logFile.InsertMessages(records));
+
+    // The log can be queried while it's written
+    EXPECT_EQ(4u, Data(logFile.QueryMessages()).size());
+    EXPECT_EQ(1s, logFile.StartTime());
+    EXPECT_EQ(4s, logFile.EndTime());
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath));
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(4s, logFile.EndTime());
+
+  const log::Descriptor *desc = logFile.Descriptor();
+  ASSERT_NE(nullptr, desc);
+  EXPECT_EQ(3u, desc->TopicsToMsgTypesToId().size());
+  EXPECT_GE(desc->TopicId("/baz", "other.message.type"), 0);
+
+  EXPECT_EQ((std::vector<std::string>{"/foo@1000000000", "/bar@2000000000",
+    "/foo@3000000000", "/baz@4000000000"}), Data(logFile.QueryMessages()));
+
+  EXPECT_EQ((std::vector<std::string>{"/foo@1000000000", "/foo@3000000000"}),
+    Data(logFile.QueryMessages(log::TopicList("/foo"))));
+
+  EXPECT_EQ((std::vector<std::string>{"/bar@2000000000", "/baz@4000000000"}),
+    Data(logFile.QueryMessages(log::TopicPattern(std::regex("/ba.")))));
+
+  const log::QualifiedTimeRange range(
+    log::QualifiedTime(1s, log::QualifiedTime::Qualifier::EXCLUSIVE),
+    log::QualifiedTime(3s, log::QualifiedTime::Qualifier::INCLUSIVE));
+  EXPECT_EQ((std::vector<std::string>{"/bar@2000000000", "/foo@3000000000"}),
+    Data(logFile.QueryMessages(log::AllTopics(range))));
+
+  EXPECT_TRUE(Data(logFile.QueryMessages(log::TopicList("/nope"))).empty());
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, MessagesOutOfOrder)
+{
+  std::remove(kPath);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+    EXPECT_TRUE(Insert(logFile, 5s, "/foo"));
+    EXPECT_TRUE(Insert(logFile, 6s, "/foo"));
+
+    // Querying writes the buffered messages as a chunk
+    EXPECT_EQ(2u, Data(logFile.QueryMessages()).size());
+
+    EXPECT_TRUE(Insert(logFile, 7s, "/foo"));
+    EXPECT_TRUE(Insert(logFile, 1s, "/bar"));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath));
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(7s, logFile.EndTime());
+  EXPECT_EQ((std::vector<std::string>{"/bar@1000000000", "/foo@5000000000",
+    "/foo@6000000000", "/foo@7000000000"}), Data(logFile.QueryMessages()));
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, QueryWhileAppending)
+{
+  std::remove(kPath);
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+  EXPECT_TRUE(Insert(logFile, 1s, "/foo"));
+  EXPECT_TRUE(Insert(logFile, 2s, "/foo"));
+
+  // A batch reads the chunks written when it's iterated, the file may grow
+  // meanwhile
+  log::Batch batch = logFile.QueryMessages();
+  auto iter = batch.begin();
+  EXPECT_TRUE(Insert(logFile, 3s, "/foo"));
+  EXPECT_EQ(3u, Data(logFile.QueryMessages()).size());
+
+  std::vector<std::string> result;
+  for (; iter != batch.end(); ++iter)
+    result.push_back(std::string(iter->DataView()));
+  EXPECT_EQ((std::vector<std::string>{"/foo@1000000000", "/foo@2000000000"}),
+    result);
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, RecoverUnclosedLog)
+{
+  std::remove(kPath);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+    EXPECT_TRUE(Insert(logFile, 1s, "/foo"));
+    EXPECT_EQ(1u, Data(logFile.QueryMessages()).size());
+    EXPECT_TRUE(Insert(logFile, 2s, "/bar"));
+  }
+
+  // Cut the end of the file, as if the recorder had crashed while writing
+  // the index.
+  std::string content;
+  {
+    std::ifstream in(kPath, std::ios_base::binary);
+    content.assign(std::istreambuf_iterator<char>(in),
+      std::istreambuf_iterator<char>());
+  }
+  ASSERT_GT(content.size(), 20u);
+  {
+    std::ofstream out(kPath, std::ios_base::binary | std::ios_base::trunc);
+    out.write(content.data(), content.size() - 20);
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath));
+  ASSERT_NE(nullptr, logFile.Descriptor());
+  EXPECT_EQ(2u, logFile.Descriptor()->TopicsToMsgTypesToId().size());
+  EXPECT_EQ((std::vector<std::string>{"/foo@1000000000", "/bar@2000000000"}),
+    Data(logFile.QueryMessages()));
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, DownsampledTopics)
+{
+  std::remove(kPath);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+    for (int i = 0; i <= 10; ++i)
+    {
+      EXPECT_TRUE(Insert(logFile, std::chrono::milliseconds(10 * i), "/foo"));
+      EXPECT_TRUE(Insert(logFile, std::chrono::milliseconds(10 * i), "/bar"));
+    }
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath));
+  EXPECT_EQ((std::vector<std::string>{"/foo@0", "/foo@30000000",
+    "/foo@60000000", "/foo@90000000"}),
+    Data(logFile.QueryMessages(log::DownsampledTopics({"/foo"}, 25ms))));
+
+  EXPECT_EQ((std::vector<std::string>{"/foo@20000000", "/foo@50000000",
+    "/foo@80000000"}),
+    Data(logFile.QueryMessages(log::DownsampledTopics({"/foo"}, 30ms,
+      log::QualifiedTimeRange(20ms, 100ms)))));
+
+  EXPECT_EQ(22u, Data(logFile.QueryMessages(
+    log::DownsampledTopics({"/foo", "/bar"}, 0ms))).size());
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, TopicSummaries)
+{
+  std::remove(kPath);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+    EXPECT_TRUE(Insert(logFile, 3s, "/foo"));
+    EXPECT_TRUE(Insert(logFile, 1s, "/foo"));
+    EXPECT_TRUE(Insert(logFile, 2s, "/bar"));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath));
+  std::vector<log::TopicSummary> summaries = logFile.TopicSummaries();
+  ASSERT_EQ(2u, summaries.size());
+  EXPECT_EQ("/bar", summaries[0].topic);
+  EXPECT_EQ(1u, summaries[0].messageCount);
+  EXPECT_EQ("/foo", summaries[1].topic);
+  EXPECT_EQ("some.message.type", summaries[1].type);
+  EXPECT_EQ(2u, summaries[1].messageCount);
+  EXPECT_EQ(1s, summaries[1].startTime);
+  EXPECT_EQ(3s, summaries[1].endTime);
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, InsertLog)
+{
+  std::remove(kPath);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+    EXPECT_TRUE(Insert(logFile, 1s, "/foo"));
+    EXPECT_TRUE(Insert(logFile, 2s, "/bar"));
+    EXPECT_TRUE(Insert(logFile, 3s, "/foo"));
+  }
+
+  // The messages of a chunked log are read and inserted
+  const std::string path = "ChunkedLog_TEST_insert.tlog";
+  std::remove(path.c_str());
+  {
+    log::Log sqliteLog;
+    ASSERT_TRUE(sqliteLog.Open(path, std::ios_base::out));
+    EXPECT_EQ(2, sqliteLog.InsertLog(kPath,
+      log::QualifiedTimeRange(log::QualifiedTime(2s), log::QualifiedTime())));
+    EXPECT_EQ((std::vector<std::string>{"/bar@2000000000",
+      "/foo@3000000000"}), Data(sqliteLog.QueryMessages()));
+  }
+
+  // And the other way around
+  const std::string copy = "ChunkedLog_TEST_copy.clog";
+  std::remove(copy.c_str());
+  {
+    log::Log chunkedLog;
+    ASSERT_TRUE(chunkedLog.Open(copy, std::ios_base::out));
+    EXPECT_EQ(2, chunkedLog.InsertLog(path));
+  }
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(copy));
+  EXPECT_EQ((std::vector<std::string>{"/bar@2000000000",
+    "/foo@3000000000"}), Data(logFile.QueryMessages()));
+
+  std::remove(kPath);
+  std::remove(path.c_str());
+  std::remove(copy.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, SplitBatch)
+{
+  std::remove(kPath);
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath, std::ios_base::out));
+  std::vector<std::string> expected;
+  for (int i = 0; i < 20; ++i)
+  {
+    const std::string topic = i % 2 ? "/foo" : "/bar";
+    EXPECT_TRUE(Insert(logFile, std::chrono::seconds(i), topic));
+    if (i >= 3)
+      expected.push_back(topic + "@" + std::to_string(i * 1000000000ll));
+  }
+
+  // The batches split the time range of the query, in order
+  std::vector<log::Batch> parts = logFile.QueryMessages(
+    log::AllTopics(log::QualifiedTimeRange::From(
+      log::QualifiedTime(3s)))).Split(3);
+  ASSERT_EQ(3u, parts.size());
+  std::vector<std::string> result;
+  for (log::Batch &part : parts)
+  {
+    const std::vector<std::string> data = Data(std::move(part));
+    EXPECT_FALSE(data.empty());
+    result.insert(result.end(), data.begin(), data.end());
+  }
+  EXPECT_EQ(expected, result);
+
+  // A log with a single time can't be split
+  const std::string path = "ChunkedLog_TEST_split.clog";
+  std::remove(path.c_str());
+  log::Log singleTime;
+  ASSERT_TRUE(singleTime.Open(path, std::ios_base::out));
+  EXPECT_TRUE(Insert(singleTime, 1s, "/foo"));
+  EXPECT_TRUE(Insert(singleTime, 1s, "/bar"));
+  parts = singleTime.QueryMessages().Split(2);
+  ASSERT_EQ(2u, parts.size());
+  EXPECT_EQ((std::vector<std::string>{"/foo@1000000000", "/bar@1000000000"}),
+    Data(std::move(parts[0])));
+  EXPECT_TRUE(Data(std::move(parts[1])).empty());
+  std::remove(path.c_str());
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, NotAChunkedLog)
+{
+  const std::string path = "ChunkedLog_TEST_garbage.clog";
+  {
+    std::ofstream out(path, std::ios_base::binary | std::ios_base::trunc);
+    out << "This is not a log file";
+  }
+
+  log::Log logFile;
+  EXPECT_FALSE(logFile.Open(path, std::ios_base::in,
+    log::LogFormat::CHUNKED));
+  EXPECT_FALSE(logFile.Valid());
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
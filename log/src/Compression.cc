@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/transport/config.hh>
+
+#ifdef HAVE_ZLIB
+  #include <zlib.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "../../src/Compression.hh"
+#include "Compression.hh"
+#include "Console.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+//////////////////////////////////////////////////
+class BlobCodec::Implementation
+{
+#ifdef HAVE_ZLIB
+  /// \brief Destructor
+  public: ~Implementation()
+  {
+    if (this->deflating)
+      deflateEnd(&this->deflater);
+    if (this->inflating)
+      inflateEnd(&this->inflater);
+  }
+
+  /// \brief Stream compressing the messages
+  public: z_stream deflater{};
+
+  /// \brief True once deflater is initialized
+  public: bool deflating = false;
+
+  /// \brief Stream decompressing the messages
+  public: z_stream inflater{};
+
+  /// \brief True once inflater is initialized
+  public: bool inflating = false;
+#endif
+};
+
+//////////////////////////////////////////////////
+BlobCodec::BlobCodec()
+  : dataPtr(new Implementation)
+{
+}
+
+//////////////////////////////////////////////////
+BlobCodec::~BlobCodec()
+{
+}
+
+//////////////////////////////////////////////////
+bool BlobCodec::Available()
+{
+#ifdef HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool BlobCodec::Compress(const void *_data, const std::size_t _len,
+    const std::string &_dictionary, std::string &_out)
+{
+#ifdef HAVE_ZLIB
+  if (_len > std::numeric_limits<uint32_t>::max())
+  {
+    LERR("Message of " << _len << " bytes is too large to compress\n");
+    return false;
+  }
+
+  z_stream &stream = this->dataPtr->deflater;
+  int returnCode = this->dataPtr->deflating ? deflateReset(&stream) :
+    deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+  if (returnCode != Z_OK)
+  {
+    LERR("Failed to initialize zlib [" << returnCode << "]\n");
+    return false;
+  }
+  this->dataPtr->deflating = true;
+
+  // The dictionary is set again after every reset
+  if (!_dictionary.empty() && deflateSetDictionary(&stream,
+        reinterpret_cast<const Bytef *>(_dictionary.data()),
+        static_cast<uInt>(_dictionary.size())) != Z_OK)
+  {
+    LERR("Failed to set the compression dictionary\n");
+    return false;
+  }
+
+  const uint32_t rawSize = static_cast<uint32_t>(_len);
+  _out.resize(sizeof(rawSize) + deflateBound(&stream, rawSize));
+  std::memcpy(&_out[0], &rawSize, sizeof(rawSize));
+
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<void *>(_data));
+  stream.avail_in = rawSize;
+  stream.next_out = reinterpret_cast<Bytef *>(&_out[sizeof(rawSize)]);
+  stream.avail_out = static_cast<uInt>(_out.size() - sizeof(rawSize));
+  returnCode = deflate(&stream, Z_FINISH);
+  if (returnCode != Z_STREAM_END)
+  {
+    LERR("Failed to compress message [" << returnCode << "]\n");
+    return false;
+  }
+  _out.resize(_out.size() - stream.avail_out);
+  return true;
+#else
+  (void)_data;
+  (void)_len;
+  (void)_dictionary;
+  (void)_out;
+  LERR("Messages can't be compressed, zlib was not available at build "
+       "time\n");
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool BlobCodec::Decompress(const void *_data, const std::size_t _len,
+    const std::string &_dictionary, std::string &_out)
+{
+#ifdef HAVE_ZLIB
+  uint32_t rawSize = 0;
+  if (_len < sizeof(rawSize))
+  {
+    LERR("Compressed message of " << _len << " bytes is truncated\n");
+    return false;
+  }
+  std::memcpy(&rawSize, _data, sizeof(rawSize));
+  if (!transport::ZlibSizeValid(rawSize, _len - sizeof(rawSize)))
+  {
+    LERR("Compressed message has an invalid size [" << rawSize << "]\n");
+    return false;
+  }
+
+  z_stream &stream = this->dataPtr->inflater;
+  int returnCode = this->dataPtr->inflating ? inflateReset(&stream) :
+    inflateInit(&stream);
+  if (returnCode != Z_OK)
+  {
+    LERR("Failed to initialize zlib [" << returnCode << "]\n");
+    return false;
+  }
+  this->dataPtr->inflating = true;
+
+  _out.resize(rawSize);
+  stream.next_in = reinterpret_cast<Bytef *>(
+    const_cast<char *>(static_cast<const char *>(_data) + sizeof(rawSize)));
+  stream.avail_in = static_cast<uInt>(_len - sizeof(rawSize));
+  stream.next_out = reinterpret_cast<Bytef *>(&_out[0]);
+  stream.avail_out = rawSize;
+
+  returnCode = inflate(&stream, Z_FINISH);
+  if (returnCode == Z_NEED_DICT)
+  {
+    if (_dictionary.empty() || inflateSetDictionary(&stream,
+          reinterpret_cast<const Bytef *>(_dictionary.data()),
+          static_cast<uInt>(_dictionary.size())) != Z_OK)
+    {
+      LERR("Compressed message needs another dictionary\n");
+      return false;
+    }
+    returnCode = inflate(&stream, Z_FINISH);
+  }
+
+  if (returnCode != Z_STREAM_END || stream.avail_out != 0)
+  {
+    LERR("Failed to decompress message [" << returnCode << "]\n");
+    return false;
+  }
+  return true;
+#else
+  (void)_data;
+  (void)_len;
+  (void)_dictionary;
+  (void)_out;
+  LERR("The log has compressed messages, but zlib was not available at "
+       "build time\n");
+  return false;
+#endif
+}
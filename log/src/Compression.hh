@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_SRC_COMPRESSION_HH_
+#define IGNITION_TRANSPORT_LOG_SRC_COMPRESSION_HH_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Descriptor.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Name of the codec of the compressed topics, in the codec
+      /// column of the topic_compression table.
+      constexpr char kZlibCodec[] = "zlib";
+
+      /// \brief Preset dictionary of each compressed topic of a log, which
+      /// may be empty.
+      using TopicDictionaries = std::unordered_map<TopicKey, std::string>;
+
+      /// \brief Compresses and decompresses the messages of the compressed
+      /// topics of the SQLite3 logs, with zlib and an optional preset
+      /// dictionary. A compressed message is the size of the uncompressed
+      /// data as a 32 bit integer, in the byte order of the host, followed
+      /// by the zlib stream. The streams are reset between the messages,
+      /// rather than allocated for each of them.
+      class BlobCodec
+      {
+        /// \brief Constructor
+        public: BlobCodec();
+
+        /// \brief Destructor
+        public: ~BlobCodec();
+
+        /// \brief Check whether the library was built with zlib.
+        /// \return True if the messages can be compressed and decompressed.
+        public: static bool Available();
+
+        /// \brief Compress a message.
+        /// \param[in] _data Message data.
+        /// \param[in] _len Number of bytes of data.
+        /// \param[in] _dictionary Preset dictionary, or empty.
+        /// \param[out] _out The compressed message. It keeps its memory
+        /// between the calls.
+        /// \return False if the message could not be compressed.
+        public: bool Compress(const void *_data, std::size_t _len,
+            const std::string &_dictionary, std::string &_out);
+
+        /// \brief Decompress a message.
+        /// \param[in] _data Compressed message.
+        /// \param[in] _len Number of bytes of the compressed message.
+        /// \param[in] _dictionary Preset dictionary it was compressed with.
+        /// \param[out] _out The message data. It keeps its memory between
+        /// the calls.
+        /// \return False if the message is corrupt.
+        public: bool Decompress(const void *_data, std::size_t _len,
+            const std::string &_dictionary, std::string &_out);
+
+        /// \brief Private implementation, which holds the zlib streams.
+        private: class Implementation;
+
+        /// \brief Pointer to the private implementation.
+        private: std::unique_ptr<Implementation> dataPtr;
+      };
+      }
+    }
+  }
+}
+
+#endif
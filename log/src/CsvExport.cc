@@ -0,0 +1,547 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/Factory.hh>
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/log/Batch.hh"
+#include "ignition/transport/log/Message.hh"
+#include "Console.hh"
+#include "CsvExport.hh"
+
+using namespace ignition::transport::log;
+
+using google::protobuf::FieldDescriptor;
+
+/// \brief Depth of the nested messages flattened into columns. The deeper
+/// ones, e.g. of recursive types, are written in a single cell.
+static const int kMaxDepth = 8;
+
+/// \brief Maximum number of messages of a block decoded by a worker.
+static const std::size_t kBlockMessages = 1024;
+
+/// \brief Maximum number of bytes of data of a block decoded by a worker.
+static const std::size_t kBlockBytes = 16u * 1024u * 1024u;
+
+namespace
+{
+  /// \brief A message to decode, copied out of the batch.
+  struct PendingMessage
+  {
+    /// \brief Time received (ns).
+    int64_t time;
+
+    /// \brief Index of the file of the topic.
+    std::size_t file;
+
+    /// \brief Serialized message.
+    std::string data;
+  };
+
+  /// \brief The rows of a block of messages.
+  struct FormattedBlock
+  {
+    /// \brief Rows of each file, in order.
+    std::vector<std::string> rows;
+
+    /// \brief Number of messages formatted.
+    uint64_t exported = 0;
+
+    /// \brief Number of messages that couldn't be decoded.
+    uint64_t skipped = 0;
+  };
+
+  /// \brief A file being written.
+  struct ExportFile
+  {
+    /// \brief The file.
+    std::ofstream out;
+
+    /// \brief Message of the type of the topic, to create the others.
+    std::unique_ptr<google::protobuf::Message> prototype;
+  };
+}
+
+//////////////////////////////////////////////////
+/// \brief Append a cell, quoted if it holds a separator or a quote.
+/// \param[in] _value Value of the cell.
+/// \param[in,out] _row The row.
+static void AppendEscaped(const std::string &_value, std::string &_row)
+{
+  if (_value.find_first_of(",\"\r\n") == std::string::npos)
+  {
+    _row += _value;
+    return;
+  }
+
+  _row += '"';
+  for (const char c : _value)
+  {
+    if (c == '"')
+      _row += '"';
+    _row += c;
+  }
+  _row += '"';
+}
+
+//////////////////////////////////////////////////
+/// \brief Encode bytes in base64.
+/// \param[in] _data The bytes.
+/// \return The encoded bytes.
+static std::string Base64(const std::string &_data)
+{
+  static const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  std::string result;
+  result.reserve((_data.size() + 2) / 3 * 4);
+  std::size_t i = 0;
+  for (; i + 2 < _data.size(); i += 3)
+  {
+    const uint32_t n = (static_cast<uint8_t>(_data[i]) << 16) |
+      (static_cast<uint8_t>(_data[i + 1]) << 8) |
+      static_cast<uint8_t>(_data[i + 2]);
+    result += kAlphabet[(n >> 18) & 63];
+    result += kAlphabet[(n >> 12) & 63];
+    result += kAlphabet[(n >> 6) & 63];
+    result += kAlphabet[n & 63];
+  }
+  if (i < _data.size())
+  {
+    uint32_t n = static_cast<uint8_t>(_data[i]) << 16;
+    if (i + 1 < _data.size())
+      n |= static_cast<uint8_t>(_data[i + 1]) << 8;
+    result += kAlphabet[(n >> 18) & 63];
+    result += kAlphabet[(n >> 12) & 63];
+    result += i + 1 < _data.size() ? kAlphabet[(n >> 6) & 63] : '=';
+    result += '=';
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+/// \brief Format a floating-point number so that it reads back the same.
+/// \param[in] _value The number.
+/// \param[in] _digits Number of significant digits.
+/// \return The formatted number.
+static std::string FormatReal(const double _value, const int _digits)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.*g", _digits, _value);
+  return buffer;
+}
+
+//////////////////////////////////////////////////
+/// \brief Format the value of a field.
+/// \param[in] _msg The message.
+/// \param[in] _field The field.
+/// \param[in] _index Index of the element of a repeated field, -1 for a
+/// singular field.
+/// \return The formatted value.
+static std::string FieldValue(const google::protobuf::Message &_msg,
+    const FieldDescriptor &_field, const int _index)
+{
+  const google::protobuf::Reflection *reflection = _msg.GetReflection();
+  const bool repeated = _index >= 0;
+  switch (_field.cpp_type())
+  {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return std::to_string(repeated ?
+        reflection->GetRepeatedInt32(_msg, &_field, _index) :
+        reflection->GetInt32(_msg, &_field));
+    case FieldDescriptor::CPPTYPE_INT64:
+      return std::to_string(repeated ?
+        reflection->GetRepeatedInt64(_msg, &_field, _index) :
+        reflection->GetInt64(_msg, &_field));
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return std::to_string(repeated ?
+        reflection->GetRepeatedUInt32(_msg, &_field, _index) :
+        reflection->GetUInt32(_msg, &_field));
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return std::to_string(repeated ?
+        reflection->GetRepeatedUInt64(_msg, &_field, _index) :
+        reflection->GetUInt64(_msg, &_field));
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return FormatReal(repeated ?
+        reflection->GetRepeatedDouble(_msg, &_field, _index) :
+        reflection->GetDouble(_msg, &_field), 17);
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return FormatReal(repeated ?
+        reflection->GetRepeatedFloat(_msg, &_field, _index) :
+        reflection->GetFloat(_msg, &_field), 9);
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return (repeated ?
+        reflection->GetRepeatedBool(_msg, &_field, _index) :
+        reflection->GetBool(_msg, &_field)) ? "true" : "false";
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return (repeated ?
+        reflection->GetRepeatedEnum(_msg, &_field, _index) :
+        reflection->GetEnum(_msg, &_field))->name();
+    case FieldDescriptor::CPPTYPE_STRING:
+    {
+      const std::string value = repeated ?
+        reflection->GetRepeatedString(_msg, &_field, _index) :
+        reflection->GetString(_msg, &_field);
+      return _field.type() == FieldDescriptor::TYPE_BYTES ?
+        Base64(value) : value;
+    }
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      return (repeated ?
+        reflection->GetRepeatedMessage(_msg, &_field, _index) :
+        reflection->GetMessage(_msg, &_field)).ShortDebugString();
+  }
+  return "";
+}
+
+//////////////////////////////////////////////////
+/// \brief Check whether a field is flattened into the columns of its
+/// fields.
+/// \param[in] _field The field.
+/// \param[in] _depth Depth of the message of the field.
+/// \return True for a singular message, below the maximum depth.
+static bool Flattened(const FieldDescriptor &_field, const int _depth)
+{
+  return !_field.is_repeated() &&
+    _field.cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+    _depth + 1 < kMaxDepth;
+}
+
+//////////////////////////////////////////////////
+/// \brief Append the columns of a message type.
+/// \param[in] _type The message type.
+/// \param[in] _prefix Path of the message.
+/// \param[in] _depth Depth of the message.
+/// \param[in,out] _columns The columns.
+static void AppendColumns(const google::protobuf::Descriptor &_type,
+    const std::string &_prefix, const int _depth,
+    std::vector<std::string> &_columns)
+{
+  for (int i = 0; i < _type.field_count(); ++i)
+  {
+    const FieldDescriptor &field = *_type.field(i);
+    const std::string name = _prefix + field.name();
+    if (Flattened(field, _depth))
+      AppendColumns(*field.message_type(), name + ".", _depth + 1, _columns);
+    else
+      _columns.push_back(name);
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Append the cells of a message.
+/// \param[in] _msg The message, nullptr for empty cells.
+/// \param[in] _type The message type.
+/// \param[in] _depth Depth of the message.
+/// \param[in,out] _row The row.
+static void AppendCells(const google::protobuf::Message *_msg,
+    const google::protobuf::Descriptor &_type, const int _depth,
+    std::string &_row)
+{
+  const google::protobuf::Reflection *reflection =
+    _msg ? _msg->GetReflection() : nullptr;
+  for (int i = 0; i < _type.field_count(); ++i)
+  {
+    const FieldDescriptor &field = *_type.field(i);
+    if (Flattened(field, _depth))
+    {
+      const google::protobuf::Message *nested =
+        _msg && reflection->HasField(*_msg, &field) ?
+        &reflection->GetMessage(*_msg, &field) : nullptr;
+      AppendCells(nested, *field.message_type(), _depth + 1, _row);
+      continue;
+    }
+
+    _row += ',';
+    if (!_msg)
+      continue;
+
+    if (field.is_repeated())
+    {
+      std::string value;
+      const int size = reflection->FieldSize(*_msg, &field);
+      for (int j = 0; j < size; ++j)
+      {
+        if (j > 0)
+          value += ';';
+        value += FieldValue(*_msg, field, j);
+      }
+      AppendEscaped(value, _row);
+    }
+    else if ((!field.containing_oneof() &&
+              field.cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) ||
+             reflection->HasField(*_msg, &field))
+    {
+      AppendEscaped(FieldValue(*_msg, field, -1), _row);
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Decode and format a block of messages.
+/// \param[in] _block The messages.
+/// \param[in] _prototypes Message of the type of each file.
+/// \return The rows of each file.
+static FormattedBlock FormatBlock(const std::vector<PendingMessage> &_block,
+    const std::vector<const google::protobuf::Message *> &_prototypes)
+{
+  FormattedBlock result;
+  result.rows.resize(_prototypes.size());
+
+  std::vector<std::unique_ptr<google::protobuf::Message>> messages(
+    _prototypes.size());
+  for (const PendingMessage &pending : _block)
+  {
+    std::unique_ptr<google::protobuf::Message> &msg = messages[pending.file];
+    if (!msg)
+      msg.reset(_prototypes[pending.file]->New());
+
+    if (!msg->ParseFromString(pending.data))
+    {
+      ++result.skipped;
+      continue;
+    }
+
+    std::string &rows = result.rows[pending.file];
+    rows += std::to_string(pending.time);
+    CsvExport::AppendCells(*msg, rows);
+    rows += '\n';
+    ++result.exported;
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+/// \brief Create an empty message given its type name.
+/// \param[in] _type The message type name.
+/// \return The new message or nullptr if the type is unknown.
+static std::unique_ptr<google::protobuf::Message> NewMessage(
+    const std::string &_type)
+{
+  const google::protobuf::Descriptor *desc =
+    google::protobuf::DescriptorPool::generated_pool()
+      ->FindMessageTypeByName(_type);
+
+  // First, check if we have the descriptor from the generated proto
+  // classes. Otherwise, fallback on Ignition Msgs.
+  if (desc)
+  {
+    return std::unique_ptr<google::protobuf::Message>(
+      google::protobuf::MessageFactory::generated_factory()
+        ->GetPrototype(desc)->New());
+  }
+
+  return ignition::msgs::Factory::New(_type);
+}
+
+//////////////////////////////////////////////////
+CsvExport::CsvExport(const std::string &_prefix, const std::size_t _workers)
+  : prefix(_prefix),
+    workers(_workers)
+{
+  if (this->workers == 0)
+    this->workers = std::max(1u, std::thread::hardware_concurrency());
+}
+
+//////////////////////////////////////////////////
+bool CsvExport::Export(Log &_log, const QueryOptions &_options)
+{
+  this->exported = 0;
+  this->skipped = 0;
+  this->files.clear();
+
+  // The file of each topic and type is created with its first message.
+  // The unknown types have no file.
+  std::map<std::pair<std::string, std::string>, std::size_t> fileIds;
+  std::set<std::string> fileNames;
+  std::vector<std::unique_ptr<ExportFile>> outputs;
+  std::vector<const google::protobuf::Message *> prototypes;
+  const std::size_t kUnknownType = static_cast<std::size_t>(-1);
+
+  std::deque<std::future<FormattedBlock>> inFlight;
+  bool ok = true;
+
+  // Write the oldest block
+  auto writeFront = [&]()
+  {
+    FormattedBlock block = inFlight.front().get();
+    inFlight.pop_front();
+    for (std::size_t i = 0; i < block.rows.size(); ++i)
+      outputs[i]->out << block.rows[i];
+    this->exported += block.exported;
+    this->skipped += block.skipped;
+  };
+
+  std::vector<PendingMessage> block;
+  std::size_t blockBytes = 0;
+
+  // Decode the block in a worker, the workers run one block each
+  auto submit = [&]()
+  {
+    if (inFlight.size() >= this->workers)
+      writeFront();
+    inFlight.push_back(std::async(std::launch::async, FormatBlock,
+      std::move(block), prototypes));
+    block = std::vector<PendingMessage>();
+    block.reserve(kBlockMessages);
+    blockBytes = 0;
+  };
+
+  block.reserve(kBlockMessages);
+  for (const Message &msg : _log.QueryMessages(_options))
+  {
+    const std::pair<std::string, std::string> key(msg.Topic(), msg.Type());
+    auto file = fileIds.find(key);
+    if (file == fileIds.end())
+    {
+      std::size_t id = kUnknownType;
+      std::unique_ptr<google::protobuf::Message> prototype =
+        NewMessage(key.second);
+      if (!prototype)
+      {
+        LWRN("Skipping topic [" << key.first << "] of unknown type ["
+            << key.second << "]\n");
+      }
+      else
+      {
+        // Several types of a topic, or topics with the same file name, get
+        // files of their own
+        std::string name = FileName(key.first);
+        for (int n = 1; !fileNames.insert(name).second; ++n)
+        {
+          name = FileName(key.first);
+          name.insert(name.size() - 4, "_" + std::to_string(n));
+        }
+
+        std::unique_ptr<ExportFile> output(new ExportFile);
+        const std::string path = this->prefix + name;
+        output->out.open(path, std::ios_base::out | std::ios_base::trunc);
+        if (!output->out)
+        {
+          LERR("Failed to create [" << path << "]\n");
+          ok = false;
+          break;
+        }
+
+        std::string header = "time_recv";
+        for (const std::string &column : Columns(*prototype->GetDescriptor()))
+        {
+          header += ',';
+          AppendEscaped(column, header);
+        }
+        output->out << header << '\n';
+
+        output->prototype = std::move(prototype);
+        id = outputs.size();
+        prototypes.push_back(output->prototype.get());
+        outputs.push_back(std::move(output));
+        this->files.push_back(path);
+      }
+      file = fileIds.emplace(key, id).first;
+    }
+
+    if (file->second == kUnknownType)
+    {
+      ++this->skipped;
+      continue;
+    }
+
+    block.push_back({msg.TimeReceived().count(), file->second, msg.Data()});
+    blockBytes += block.back().data.size();
+    if (block.size() >= kBlockMessages || blockBytes >= kBlockBytes)
+      submit();
+  }
+
+  if (ok && !block.empty())
+    submit();
+  while (!inFlight.empty())
+    writeFront();
+
+  for (const std::unique_ptr<ExportFile> &output : outputs)
+  {
+    output->out.close();
+    if (!output->out)
+    {
+      LERR("Failed to write the exported messages\n");
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+//////////////////////////////////////////////////
+uint64_t CsvExport::ExportedMessages() const
+{
+  return this->exported;
+}
+
+//////////////////////////////////////////////////
+uint64_t CsvExport::SkippedMessages() const
+{
+  return this->skipped;
+}
+
+//////////////////////////////////////////////////
+const std::vector<std::string> &CsvExport::Files() const
+{
+  return this->files;
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> CsvExport::Columns(
+    const google::protobuf::Descriptor &_type)
+{
+  std::vector<std::string> columns;
+  AppendColumns(_type, "", 0, columns);
+  return columns;
+}
+
+//////////////////////////////////////////////////
+void CsvExport::AppendCells(const google::protobuf::Message &_msg,
+    std::string &_row)
+{
+  ::AppendCells(&_msg, *_msg.GetDescriptor(), 0, _row);
+}
+
+//////////////////////////////////////////////////
+std::string CsvExport::FileName(const std::string &_topic)
+{
+  std::string name;
+  for (std::size_t i = 0; i < _topic.size(); ++i)
+  {
+    const char c = _topic[i];
+    if (i == 0 && c == '/')
+      continue;
+    const bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9') || c == '-' || c == '.';
+    name += allowed ? c : '_';
+  }
+  if (name.empty())
+    name = "_";
+  return name + ".csv";
+}
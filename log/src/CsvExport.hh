@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_SRC_CSVEXPORT_HH_
+#define IGNITION_TRANSPORT_LOG_SRC_CSVEXPORT_HH_
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/log/Log.hh"
+#include "ignition/transport/log/QueryOptions.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Exports the messages of a log to CSV files, one per topic,
+      /// with a column per field of the message type, to load them in
+      /// analytics tools or convert them to columnar formats.
+      ///
+      /// The first column is the time the message was received (ns). The
+      /// nested messages are flattened into columns named by the path of
+      /// their fields, e.g. pose.position.x, and an unset nested message
+      /// leaves its cells empty. The repeated fields and the maps are
+      /// written in a single cell, with their elements separated by
+      /// semicolons, the bytes in base64 and the enums by name.
+      ///
+      /// The messages are decoded by worker threads, a block of messages at
+      /// a time, and the blocks are written in the order of the log.
+      class CsvExport
+      {
+        /// \brief Constructor
+        /// \param[in] _prefix Prefix of the paths of the files, e.g. an
+        /// existing directory followed by a slash. Each file is named after
+        /// its topic, see FileName().
+        /// \param[in] _workers Number of threads decoding the messages,
+        /// zero for one per core.
+        public: explicit CsvExport(const std::string &_prefix,
+            std::size_t _workers = 0);
+
+        /// \brief Export the messages of a log. The files are overwritten.
+        /// \param[in] _log The log.
+        /// \param[in] _options The messages to export.
+        /// \return False if a file couldn't be written.
+        public: bool Export(Log &_log,
+            const QueryOptions &_options = AllTopics());
+
+        /// \brief Get the number of messages written by the last Export().
+        /// \return The number of messages.
+        public: uint64_t ExportedMessages() const;
+
+        /// \brief Get the number of messages skipped by the last Export(),
+        /// because their type is unknown or their data could not be decoded.
+        /// \return The number of messages.
+        public: uint64_t SkippedMessages() const;
+
+        /// \brief Get the files written by the last Export().
+        /// \return The path of each file.
+        public: const std::vector<std::string> &Files() const;
+
+        /// \brief Get the columns of a message type, after the time.
+        /// \param[in] _type The message type.
+        /// \return The name of each column.
+        public: static std::vector<std::string> Columns(
+            const google::protobuf::Descriptor &_type);
+
+        /// \brief Append the cells of a message to a row, matching
+        /// Columns(). Each cell is preceded by a comma.
+        /// \param[in] _msg The message.
+        /// \param[in,out] _row The row.
+        public: static void AppendCells(const google::protobuf::Message &_msg,
+            std::string &_row);
+
+        /// \brief Get the name of the file of a topic: the topic without its
+        /// leading slash, the characters other than letters, digits, dashes
+        /// and dots replaced by underscores, followed by ".csv".
+        /// \param[in] _topic Name of the topic.
+        /// \return The name of the file.
+        public: static std::string FileName(const std::string &_topic);
+
+        /// \brief Prefix of the paths of the files.
+        private: std::string prefix;
+
+        /// \brief Number of worker threads.
+        private: std::size_t workers;
+
+        /// \brief See ExportedMessages().
+        private: uint64_t exported = 0;
+
+        /// \brief See SkippedMessages().
+        private: uint64_t skipped = 0;
+
+        /// \brief See Files().
+        private: std::vector<std::string> files;
+      };
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/bytes.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
+#include <ignition/msgs/vector3d.pb.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "CsvExport.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+/// \brief Read a file.
+/// \param[in] _path Path to the file.
+/// \return The content of the file.
+static std::string ReadFile(const std::string &_path)
+{
+  std::ifstream in(_path, std::ios_base::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+    std::istreambuf_iterator<char>());
+}
+
+//////////////////////////////////////////////////
+/// \brief Insert a message into a log.
+/// \param[in] _log The log.
+/// \param[in] _time Time of the message.
+/// \param[in] _topic Topic of the message.
+/// \param[in] _msg The message.
+/// \return True if the message was inserted.
+static bool Insert(log::Log &_log, const std::chrono::nanoseconds &_time,
+    const std::string &_topic, const google::protobuf::Message &_msg)
+{
+  const std::string data = _msg.SerializeAsString();
+  return _log.InsertMessage(_time, _topic, _msg.GetTypeName(), data.data(),
+    data.size());
+}
+
+//////////////////////////////////////////////////
+TEST(CsvExport, FileName)
+{
+  EXPECT_EQ("robot_pose.csv", log::CsvExport::FileName("/robot/pose"));
+  EXPECT_EQ("a-b.c_d.csv", log::CsvExport::FileName("a-b.c@d"));
+  EXPECT_EQ("_.csv", log::CsvExport::FileName("/"));
+}
+
+//////////////////////////////////////////////////
+TEST(CsvExport, Columns)
+{
+  EXPECT_EQ((std::vector<std::string>{"header.stamp.sec", "header.stamp.nsec",
+    "header.data", "x", "y", "z"}),
+    log::CsvExport::Columns(*msgs::Vector3d::descriptor()));
+}
+
+//////////////////////////////////////////////////
+TEST(CsvExport, Cells)
+{
+  // An unset nested message leaves its cells empty
+  msgs::Vector3d vector;
+  vector.set_x(1);
+  vector.set_y(2.5);
+  vector.set_z(-0.1);
+  std::string row;
+  log::CsvExport::AppendCells(vector, row);
+  EXPECT_EQ(",,,,1,2.5,-0.10000000000000001", row);
+
+  // The repeated messages are in a single quoted cell
+  vector.mutable_header()->mutable_stamp()->set_sec(3);
+  msgs::Header::Map *entry = vector.mutable_header()->add_data();
+  entry->set_key("a");
+  entry->add_value("x");
+  row.clear();
+  log::CsvExport::AppendCells(vector, row);
+  EXPECT_EQ(",3,0,\"key: \"\"a\"\" value: \"\"x\"\"\",1,2.5,"
+    "-0.10000000000000001", row);
+
+  // The bytes are encoded in base64
+  msgs::Bytes bytes;
+  bytes.set_data("hello");
+  row.clear();
+  log::CsvExport::AppendCells(bytes, row);
+  EXPECT_EQ(",,,,aGVsbG8=", row);
+
+  msgs::StringMsg text;
+  text.set_data("one, two");
+  row.clear();
+  log::CsvExport::AppendCells(text, row);
+  EXPECT_EQ(",,,,\"one, two\"", row);
+}
+
+//////////////////////////////////////////////////
+TEST(CsvExport, Export)
+{
+  const std::string prefix = "CsvExport_TEST_";
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  // More messages than a block, so that several workers decode them
+  msgs::Vector3d vector;
+  msgs::StringMsg text;
+  vector.set_y(1);
+  for (int i = 0; i < 3000; ++i)
+  {
+    vector.set_x(i);
+    ASSERT_TRUE(Insert(logFile, std::chrono::seconds(i), "/pose", vector));
+  }
+  text.set_data("hello");
+  ASSERT_TRUE(Insert(logFile, 1500ms, "/name", text));
+
+  // The messages of an unknown type or that can't be parsed are skipped
+  const std::string garbage("\xff\xff\xff");
+  ASSERT_TRUE(logFile.InsertMessage(1s, "/unknown", "no.such.Type",
+    garbage.data(), garbage.size()));
+  ASSERT_TRUE(logFile.InsertMessage(2s, "/name", text.GetTypeName(),
+    garbage.data(), garbage.size()));
+
+  log::CsvExport exporter(prefix, 2);
+  ASSERT_TRUE(exporter.Export(logFile));
+  EXPECT_EQ(3001u, exporter.ExportedMessages());
+  EXPECT_EQ(2u, exporter.SkippedMessages());
+  ASSERT_EQ(2u, exporter.Files().size());
+  EXPECT_EQ(prefix + "pose.csv", exporter.Files()[0]);
+  EXPECT_EQ(prefix + "name.csv", exporter.Files()[1]);
+
+  std::string expected =
+    "time_recv,header.stamp.sec,header.stamp.nsec,header.data,x,y,z\n";
+  for (int i = 0; i < 3000; ++i)
+  {
+    expected += std::to_string(std::chrono::nanoseconds(
+      std::chrono::seconds(i)).count()) + ",,,," + std::to_string(i) +
+      ",1,0\n";
+  }
+  EXPECT_EQ(expected, ReadFile(exporter.Files()[0]));
+  EXPECT_EQ("time_recv,header.stamp.sec,header.stamp.nsec,header.data,data\n"
+    "1500000000,,,,hello\n", ReadFile(exporter.Files()[1]));
+
+  // The query options select the topics
+  ASSERT_TRUE(exporter.Export(logFile, log::TopicList("/name")));
+  EXPECT_EQ(1u, exporter.ExportedMessages());
+  EXPECT_EQ(1u, exporter.SkippedMessages());
+  EXPECT_EQ(std::vector<std::string>{prefix + "name.csv"}, exporter.Files());
+
+  std::remove((prefix + "pose.csv").c_str());
+  std::remove((prefix + "name.csv").c_str());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -17,6 +17,7 @@
 
 #include "Descriptor.hh"
 
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -27,15 +28,31 @@ void Descriptor::Implementation::Reset(const TopicKeyMap &_columns)
 {
   topicsToMsgTypesToId.clear();
   msgTypesToTopicsToId.clear();
+  topicIds.clear();
 
+  auto names = std::make_shared<TopicNames>();
   for (const auto &entry : _columns)
   {
-    const TopicKey &key = entry.first;
-    int64_t id = entry.second;
-
-    this->topicsToMsgTypesToId[key.topic][key.type] = id;
-    this->msgTypesToTopicsToId[key.type][key.topic] = id;
+    this->topicsToMsgTypesToId[entry.first.topic][entry.first.type] =
+      entry.second;
+    this->msgTypesToTopicsToId[entry.first.type][entry.first.topic] =
+      entry.second;
+    this->topicIds[entry.first] = entry.second;
+    (*names)[entry.second] = entry.first;
   }
+  this->topicNames = std::move(names);
+}
+
+//////////////////////////////////////////////////
+void Descriptor::Implementation::AddTopic(const TopicKey &_key, int64_t _id)
+{
+  this->topicsToMsgTypesToId[_key.topic][_key.type] = _id;
+  this->msgTypesToTopicsToId[_key.type][_key.topic] = _id;
+  this->topicIds[_key] = _id;
+
+  auto names = std::make_shared<TopicNames>(*this->topicNames);
+  (*names)[_id] = _key;
+  this->topicNames = std::move(names);
 }
 
 //////////////////////////////////////////////////
@@ -54,18 +71,12 @@ auto Descriptor::MsgTypesToTopicsToId() const -> const NameToMap &
 int64_t Descriptor::TopicId(const std::string &_topicName,
     const std::string &_msgType) const
 {
-  auto iter = this->dataPtr->topicsToMsgTypesToId.find(_topicName);
-  if (iter == this->dataPtr->topicsToMsgTypesToId.end())
-  {
-    return -1;
-  }
-
-  auto typeIter = iter->second.find(_msgType);
-  if (typeIter == iter->second.end())
+  auto iter = this->dataPtr->topicIds.find(TopicKey{_topicName, _msgType});
+  if (iter == this->dataPtr->topicIds.end())
   {
     return -1;
   }
-  return typeIter->second;
+  return iter->second;
 }
 
 //////////////////////////////////////////////////
@@ -18,7 +18,9 @@
 #ifndef IGNITION_TRANSPORT_LOG_SRC_DESCRIPTOR_HH_
 #define IGNITION_TRANSPORT_LOG_SRC_DESCRIPTOR_HH_
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -62,11 +64,43 @@ namespace ignition
                   this->type == _other.type);
         }
       };
+      }
+    }
+  }
+}
 
+//////////////////////////////////////////////////
+/// \brief Allow a TopicKey to be used as a key in a std::unordered_map
+namespace std {
+  template <> struct hash<ignition::transport::log::TopicKey>
+  {
+    size_t operator()(
+        const ignition::transport::log::TopicKey &_key) const
+    {
+      const size_t topicHash = std::hash<std::string>()(_key.topic);
+      return topicHash ^ (std::hash<std::string>()(_key.type) + 0x9e3779b9 +
+        (topicHash << 6) + (topicHash >> 2));
+    }
+  };
+}
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
       /// \brief A map from the (topic, message type) of a topic to its integer
       /// key in the database.
       using TopicKeyMap = std::unordered_map<TopicKey, int64_t>;
 
+      /// \brief The (topic, message type) of each topic, by its integer key
+      /// in the database.
+      using TopicNames = std::unordered_map<int64_t, TopicKey>;
+
       /// \brief Implementation of the Descriptor class
       /// \note We export the symbols for this class so it can be used in
       /// UNIT_Descriptor_TEST
@@ -78,6 +112,12 @@ namespace ignition
         /// \param[in] _topics The map of topics that the log contains.
         public: void Reset(const TopicKeyMap &_topics);
 
+        /// \internal Add a topic inserted after the descriptor was
+        /// generated, instead of reading all the topics again.
+        /// \param[in] _key The topic.
+        /// \param[in] _id Its id in the log.
+        public: void AddTopic(const TopicKey &_key, int64_t _id);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
@@ -89,6 +129,17 @@ namespace ignition
 
         /// \internal \sa Descriptor::MsgTypesToTopicsToId()
         public: NameToMap msgTypesToTopicsToId;
+
+        /// \internal Id of each topic, looked up by Descriptor::TopicId()
+        /// on every insertion of a message.
+        public: TopicKeyMap topicIds;
+
+        /// \internal Names of each topic id, shared with the iterators
+        /// through the messages, whose messages refer to these names. It's
+        /// replaced rather than modified when a topic is added, so the
+        /// iterators keep the names they started with.
+        public: std::shared_ptr<const TopicNames> topicNames =
+                  std::make_shared<const TopicNames>();
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
@@ -98,19 +149,4 @@ namespace ignition
   }
 }
 
-//////////////////////////////////////////////////
-/// \brief Allow a TopicKey to be used as a key in a std::unordered_map
-namespace std {
-  template <> struct hash<ignition::transport::log::TopicKey>
-  {
-    size_t operator()(
-        const ignition::transport::log::TopicKey &_key) const
-    {
-      // Terrible, but it gets the job done
-      return (std::hash<std::string>()(_key.topic) << 16)
-        + std::hash<std::string>()(_key.type);
-    }
-  };
-}
-
 #endif
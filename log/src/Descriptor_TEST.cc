@@ -39,6 +39,14 @@ class ignition::transport::log::Log
   {
     descriptor.dataPtr->Reset(_topics);
   }
+
+  /// \brief call descriptor api AddTopic()
+  /// \sa Descriptor::Implementation::AddTopic(const TopicKey &, int64_t)
+  public: static void AddTopic(
+      Descriptor &descriptor, const TopicKey &_key, int64_t _id)
+  {
+    descriptor.dataPtr->AddTopic(_key, _id);
+  }
 };
 
 //////////////////////////////////////////////////
@@ -109,6 +117,27 @@ TEST(Descriptor, TopicIdMultipleTopicsSameType)
   EXPECT_GT(0, desc.TopicId("/foo/bar", "ign.msgs.DNEE"));
 }
 
+//////////////////////////////////////////////////
+TEST(Descriptor, AddTopic)
+{
+  Descriptor desc = Log::Construct();
+  TopicKeyMap topics;
+  topics[TopicKey{"/foo/bar", "ign.msgs.DNE"}] = 5;
+  Log::Reset(desc, topics);
+  Log::AddTopic(desc, TopicKey{"/foo/bar", "ign.msgs.DNE2"}, 6);
+  Log::AddTopic(desc, TopicKey{"/fiz/buz", "ign.msgs.DNE"}, 7);
+  EXPECT_EQ(5, desc.TopicId("/foo/bar", "ign.msgs.DNE"));
+  EXPECT_EQ(6, desc.TopicId("/foo/bar", "ign.msgs.DNE2"));
+  EXPECT_EQ(7, desc.TopicId("/fiz/buz", "ign.msgs.DNE"));
+  EXPECT_EQ(2u, desc.TopicsToMsgTypesToId().at("/foo/bar").size());
+  EXPECT_EQ(2u, desc.MsgTypesToTopicsToId().at("ign.msgs.DNE").size());
+
+  // A reset forgets the topics added
+  Log::Reset(desc, topics);
+  EXPECT_GT(0, desc.TopicId("/fiz/buz", "ign.msgs.DNE"));
+  EXPECT_EQ(1u, desc.MsgTypesToTopicsToId().size());
+}
+
 //////////////////////////////////////////////////
 TEST(Descriptor, TopicsMapOneTopic)
 {
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <cstdint>
+
+#include "HeaderTime.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+using google::protobuf::internal::WireFormatLite;
+
+//////////////////////////////////////////////////
+/// \brief Move a stream to a length delimited field of the current message,
+/// and limit the stream to that field.
+/// \param[in] _in The stream.
+/// \param[in] _field Number of the field.
+/// \return False if the message doesn't have the field. The last instance
+/// of a field is not searched for, like protobuf would merge them.
+static bool EnterField(google::protobuf::io::CodedInputStream &_in,
+    const int _field)
+{
+  for (uint32_t tag = _in.ReadTag(); tag != 0; tag = _in.ReadTag())
+  {
+    if (WireFormatLite::GetTagFieldNumber(tag) == _field &&
+        WireFormatLite::GetTagWireType(tag) ==
+          WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+    {
+      uint32_t length = 0;
+      if (!_in.ReadVarint32(&length))
+        return false;
+      _in.PushLimit(static_cast<int>(length));
+      return true;
+    }
+    if (!WireFormatLite::SkipField(&_in, tag))
+      return false;
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool log::HasHeader(const std::string &_type)
+{
+  const google::protobuf::Descriptor *descriptor =
+    google::protobuf::DescriptorPool::generated_pool()->
+      FindMessageTypeByName(_type);
+  if (!descriptor)
+    return false;
+
+  const google::protobuf::FieldDescriptor *field =
+    descriptor->FindFieldByNumber(1);
+  return field && field->name() == "header" &&
+    field->type() == google::protobuf::FieldDescriptor::TYPE_MESSAGE &&
+    field->message_type()->full_name() == "ignition.msgs.Header";
+}
+
+//////////////////////////////////////////////////
+bool log::HeaderTime(const void *_data, const std::size_t _len,
+    std::chrono::nanoseconds &_time)
+{
+  // Message.header (1), then Header.stamp (1)
+  google::protobuf::io::CodedInputStream in(
+    static_cast<const uint8_t *>(_data), static_cast<int>(_len));
+  if (!EnterField(in, 1) || !EnterField(in, 1))
+    return false;
+
+  // Time.sec (1) and Time.nsec (2), zero when they're not set
+  uint64_t sec = 0;
+  uint32_t nsec = 0;
+  for (uint32_t tag = in.ReadTag(); tag != 0; tag = in.ReadTag())
+  {
+    const bool varint = WireFormatLite::GetTagWireType(tag) ==
+      WireFormatLite::WIRETYPE_VARINT;
+    const int field = WireFormatLite::GetTagFieldNumber(tag);
+    if (varint && field == 1)
+    {
+      if (!in.ReadVarint64(&sec))
+        return false;
+    }
+    else if (varint && field == 2)
+    {
+      if (!in.ReadVarint32(&nsec))
+        return false;
+    }
+    else if (!WireFormatLite::SkipField(&in, tag))
+    {
+      return false;
+    }
+  }
+
+  // The stream ends at the end of the stamp, unless the message is corrupt
+  // or truncated
+  if (!in.ConsumedEntireMessage() || in.BytesUntilLimit() != 0)
+    return false;
+
+  _time = std::chrono::seconds(static_cast<int64_t>(sec)) +
+    std::chrono::nanoseconds(static_cast<int32_t>(nsec));
+  return true;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_SRC_HEADERTIME_HH_
+#define IGNITION_TRANSPORT_LOG_SRC_HEADERTIME_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Check whether the messages of a type start with a header,
+      /// i.e. its first field is an ignition.msgs.Header named header, like
+      /// most of the messages of ignition msgs.
+      /// \param[in] _type Name of the message type.
+      /// \return False if the type has no header, or isn't linked into this
+      /// program.
+      bool HasHeader(const std::string &_type);
+
+      /// \brief Read the stamp of the header of a serialized message,
+      /// without parsing the rest of the message.
+      /// \param[in] _data The serialized message, of a type with a header,
+      /// see HasHeader().
+      /// \param[in] _len Number of bytes of the message.
+      /// \param[out] _time The stamp, since the epoch of the clock of the
+      /// publisher.
+      /// \return False if the message has no header stamp, or is corrupt.
+      bool HeaderTime(const void *_data, std::size_t _len,
+          std::chrono::nanoseconds &_time);
+      }
+    }
+  }
+}
+
+#endif
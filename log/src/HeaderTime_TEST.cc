@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/int32.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
+
+#include <chrono>
+#include <string>
+
+#include "HeaderTime.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+TEST(HeaderTime, HasHeader)
+{
+  EXPECT_TRUE(log::HasHeader(msgs::StringMsg().GetTypeName()));
+  EXPECT_TRUE(log::HasHeader(msgs::Int32().GetTypeName()));
+  EXPECT_FALSE(log::HasHeader(msgs::Header().GetTypeName()));
+  EXPECT_FALSE(log::HasHeader(msgs::Time().GetTypeName()));
+  EXPECT_FALSE(log::HasHeader("not.a.Type"));
+}
+
+//////////////////////////////////////////////////
+TEST(HeaderTime, Stamp)
+{
+  msgs::StringMsg msg;
+  msg.set_data("some data");
+  std::string data = msg.SerializeAsString();
+  std::chrono::nanoseconds time(-1);
+  EXPECT_FALSE(log::HeaderTime(data.data(), data.size(), time));
+
+  // A header with data but no stamp
+  auto *pair = msg.mutable_header()->add_data();
+  pair->set_key("frame_id");
+  pair->add_value("base");
+  data = msg.SerializeAsString();
+  EXPECT_FALSE(log::HeaderTime(data.data(), data.size(), time));
+
+  // The stamp may be after the data of the header
+  msg.mutable_header()->mutable_stamp()->set_sec(12);
+  msg.mutable_header()->mutable_stamp()->set_nsec(345);
+  data = msg.SerializeAsString();
+  ASSERT_TRUE(log::HeaderTime(data.data(), data.size(), time));
+  EXPECT_EQ(12s + 345ns, time);
+
+  // An empty stamp is zero
+  msg.mutable_header()->mutable_stamp()->Clear();
+  data = msg.SerializeAsString();
+  ASSERT_TRUE(log::HeaderTime(data.data(), data.size(), time));
+  EXPECT_EQ(0ns, time);
+
+  // A truncated message
+  msg.mutable_header()->mutable_stamp()->set_sec(12);
+  data = msg.SerializeAsString();
+  EXPECT_FALSE(log::HeaderTime(data.data(), 5, time));
+  EXPECT_FALSE(log::HeaderTime(nullptr, 0, time));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
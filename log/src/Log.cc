@@ -17,27 +17,312 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
+#include <map>
 #include <memory>
+#include <regex>
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "ignition/transport/log/Descriptor.hh"
 #include "ignition/transport/log/Log.hh"
 #include "ignition/transport/log/SqlStatement.hh"
 #include "BatchPrivate.hh"
 #include "build_config.hh"
+#include "ChunkedLog.hh"
+#include "Compression.hh"
 #include "Console.hh"
 #include "Descriptor.hh"
+#include "Manifest.hh"
 #include "raii-sqlite3.hh"
 
 using namespace ignition::transport;
 using namespace ignition::transport::log;
 
+/// \brief Schema version of the logs created by this version.
+static const char kSchemaVersion[] = "0.1.4";
+
+/// \brief A migration of the schema of the logs.
+struct SchemaMigration
+{
+  /// \brief Version migrated from.
+  const char *from;
+
+  /// \brief Version migrated to.
+  const char *to;
+
+  /// \brief File in the schema location with the statements to apply.
+  const char *file;
+};
+
+/// \brief Migrations of the schema, in order. The logs are created with
+/// 0.1.0.sql, then migrated to kSchemaVersion.
+static const SchemaMigration kMigrations[] =
+{
+  {"0.1.0", "0.1.1", "0.1.0_to_0.1.1.sql"},
+  {"0.1.1", "0.1.2", "0.1.1_to_0.1.2.sql"},
+  {"0.1.2", "0.1.3", "0.1.2_to_0.1.3.sql"},
+  {"0.1.3", "0.1.4", "0.1.3_to_0.1.4.sql"}
+};
+
+/// \brief Number of rows of the statements inserting several messages at
+/// once. Each row binds 4 parameters, the limit of SQLite is 999.
+static const std::size_t kRowsPerInsert = 64;
+
+//////////////////////////////////////////////////
+/// \brief Translate the options of a query into the messages to select in
+/// a chunked log. Only the native QueryOptions classes are supported, as
+/// the others select messages through SQL.
+/// \param[in] _options The options of the query.
+/// \param[in] _descriptor Descriptor of the log.
+/// \param[out] _query The messages to select.
+/// \return False if the options are not supported.
+static bool ChunkedQueryFromOptions(const QueryOptions &_options,
+    const Descriptor &_descriptor, ChunkedQuery &_query)
+{
+  const Descriptor::NameToMap &map = _descriptor.TopicsToMsgTypesToId();
+  std::set<std::string> names;
+
+  if (const auto *list = dynamic_cast<const TopicList *>(&_options))
+  {
+    names = list->Topics();
+  }
+  else if (const auto *downsampled =
+      dynamic_cast<const DownsampledTopics *>(&_options))
+  {
+    names = downsampled->Topics();
+    _query.period = downsampled->Period().count();
+  }
+  else if (const auto *pattern = dynamic_cast<const TopicPattern *>(&_options))
+  {
+    for (const auto &topicEntry : map)
+    {
+      if (std::regex_match(topicEntry.first, pattern->Pattern()))
+        names.insert(topicEntry.first);
+    }
+  }
+  else if (dynamic_cast<const AllTopics *>(&_options))
+  {
+    for (const auto &topicEntry : map)
+      names.insert(topicEntry.first);
+  }
+  else
+  {
+    LERR("Query options of this type are not supported by chunked logs\n");
+    return false;
+  }
+
+  for (const std::string &name : names)
+  {
+    Descriptor::NameToMap::const_iterator it = map.find(name);
+    if (it == map.end())
+      continue;
+    for (const auto &msgEntry : it->second)
+      _query.topics.insert(msgEntry.second);
+  }
+
+  if (const auto *time = dynamic_cast<const TimeRangeOption *>(&_options))
+  {
+    if (time->GetTimeReference() != TimeRangeOption::TimeReference::RECEIVED)
+    {
+      LERR("Chunked logs can only be queried by time received\n");
+      return false;
+    }
+    _query.range = time->TimeRange();
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Generate a statement per topic for the options of a query of
+/// several topics. Each statement selects the messages of its topic in the
+/// order they were received, so that they can be merged.
+/// \param[in] _options The options of the query.
+/// \param[in] _descriptor Descriptor of the log.
+/// \param[out] _statements The statements.
+/// \return False if the query is not of several topics of a TopicList or a
+/// TopicPattern. The other options are queried with their own statements.
+static bool PerTopicStatements(const QueryOptions &_options,
+    const Descriptor &_descriptor, std::vector<SqlStatement> &_statements)
+{
+  // A query of all the topics is read in order through the time index
+  if (!dynamic_cast<const TopicList *>(&_options) &&
+      !dynamic_cast<const TopicPattern *>(&_options))
+  {
+    return false;
+  }
+
+  ChunkedQuery query;
+  if (!ChunkedQueryFromOptions(_options, _descriptor, query) ||
+      query.topics.size() < 2)
+  {
+    return false;
+  }
+
+  const SqlStatement timeCondition =
+    dynamic_cast<const TimeRangeOption &>(_options).GenerateTimeConditions();
+
+  for (const int64_t id : query.topics)
+  {
+    SqlStatement sql = QueryOptions::StandardMessageQueryPreamble();
+    sql.statement += " WHERE messages.topic_id = ?";
+    sql.parameters.emplace_back(id);
+    if (!timeCondition.statement.empty())
+    {
+      sql.statement += " AND (";
+      sql.Append(timeCondition);
+      sql.statement += ")";
+    }
+    sql.Append(QueryOptions::StandardMessageQueryClose());
+    _statements.push_back(std::move(sql));
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Read a file of the schema location.
+/// \param[in] _name Name of the file.
+/// \param[out] _sql Content of the file.
+/// \return False if the file could not be read.
+static bool ReadSchemaFile(const std::string &_name, std::string &_sql)
+{
+  // Test hook so tests can be run before `make install`
+  std::string schemaFile;
+  const char *envPath = std::getenv(SchemaLocationEnvVar.c_str());
+  if (envPath)
+  {
+    schemaFile = envPath;
+  }
+  else
+  {
+    schemaFile = SCHEMA_INSTALL_PATH;
+  }
+  schemaFile += "/" + _name;
+
+  LDBG("Schema file: " << schemaFile << "\n");
+  std::ifstream fin(schemaFile, std::ifstream::in);
+  if (!fin)
+  {
+    LERR("Failed to open schema [" << schemaFile << "].\n"
+        << " Set " << SchemaLocationEnvVar << " to the schema location.\n");
+    return false;
+  }
+
+  // Read the schema file
+  _sql.clear();
+  char buffer[4096];
+  while (fin)
+  {
+    fin.read(buffer, sizeof(buffer));
+    _sql.insert(_sql.size(), buffer, fin.gcount());
+  }
+  if (_sql.empty())
+  {
+    LERR("Failed to read schema file [" << schemaFile << "]\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Execute SQL statements without parameters.
+/// \param[in] _db The database.
+/// \param[in] _sql The statements.
+/// \return False if a statement failed.
+static bool ExecuteSql(raii_sqlite3::Database &_db, const std::string &_sql)
+{
+  if (sqlite3_exec(_db.Handle(), _sql.c_str(), NULL, 0, nullptr) != SQLITE_OK)
+  {
+    LERR("Failed to execute [" << _sql << "]: " << sqlite3_errmsg(
+        _db.Handle()) << "\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Apply the settings of a log to its database.
+/// \param[in] _db The database.
+/// \param[in] _options The settings.
+/// \param[in] _writable True if the database is opened for writing.
+/// \return False if a setting is invalid or could not be applied.
+static bool ApplyOpenOptions(raii_sqlite3::Database &_db,
+    const LogOpenOptions &_options, const bool _writable)
+{
+  static const std::set<std::string> kJournalModes =
+    {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"};
+  static const std::set<std::string> kSynchronousModes =
+    {"OFF", "NORMAL", "FULL", "EXTRA"};
+
+  std::vector<std::string> pragmas;
+  if (_writable && _options.pageSize != 0)
+  {
+    if (_options.pageSize < 512 || _options.pageSize > 65536 ||
+        (_options.pageSize & (_options.pageSize - 1)) != 0)
+    {
+      LERR("Invalid page size [" << _options.pageSize << "]\n");
+      return false;
+    }
+    pragmas.push_back("page_size = " + std::to_string(_options.pageSize));
+  }
+  if (_writable && !_options.journalMode.empty())
+  {
+    if (!kJournalModes.count(_options.journalMode))
+    {
+      LERR("Invalid journal mode [" << _options.journalMode << "]\n");
+      return false;
+    }
+    pragmas.push_back("journal_mode = " + _options.journalMode);
+  }
+  if (!_options.synchronous.empty())
+  {
+    if (!kSynchronousModes.count(_options.synchronous))
+    {
+      LERR("Invalid synchronous mode [" << _options.synchronous << "]\n");
+      return false;
+    }
+    pragmas.push_back("synchronous = " + _options.synchronous);
+  }
+  if (_options.cacheSize != 0)
+    pragmas.push_back("cache_size = " + std::to_string(_options.cacheSize));
+  if (_options.mmapSize >= 0)
+    pragmas.push_back("mmap_size = " + std::to_string(_options.mmapSize));
+
+  if (_options.busyTimeout < 0)
+  {
+    LERR("Invalid busy timeout [" << _options.busyTimeout << "]\n");
+    return false;
+  }
+  if (_options.busyTimeout > 0 &&
+      sqlite3_busy_timeout(_db.Handle(),
+        static_cast<int>(_options.busyTimeout)) != SQLITE_OK)
+  {
+    LERR("Failed to set the busy timeout: " << sqlite3_errmsg(
+        _db.Handle()) << "\n");
+    return false;
+  }
+
+  for (const std::string &pragma : pragmas)
+  {
+    const std::string sql = "PRAGMA " + pragma + ";";
+    if (sqlite3_exec(_db.Handle(), sql.c_str(), NULL, 0, nullptr) != SQLITE_OK)
+    {
+      LERR("Failed to apply [" << sql << "]: " << sqlite3_errmsg(
+          _db.Handle()) << "\n");
+      return false;
+    }
+  }
+  return true;
+}
+
 /// \brief Private implementation
 class ignition::transport::log::Log::Implementation
 {
@@ -69,13 +354,180 @@ class ignition::transport::log::Log::Implementation
   public: bool InsertMessage(const std::chrono::nanoseconds &_time,
       int64_t _topic, const void *_data, std::size_t _len);
 
+  /// \brief Insert messages into the database, kRowsPerInsert rows per
+  /// statement while there are enough of them.
+  /// \param[in] _rows The messages and their topic_id.
+  /// \return The number of messages inserted.
+  public: std::size_t InsertMessages(
+      const std::vector<std::pair<const MessageRecord *, int64_t>> &_rows);
+
+  /// \brief Get the statement inserting rows into the messages table. It is
+  /// compiled on first use and reused afterwards.
+  /// \param[in] _rows Number of rows, 1 or kRowsPerInsert.
+  /// \return The statement, or nullptr if it could not be compiled.
+  public: raii_sqlite3::Statement *InsertStatement(std::size_t _rows);
+
+  /// \brief Bind a message to a row of an insert statement.
+  /// \param[in] _statement The statement.
+  /// \param[in] _row Index of the row in the statement.
+  /// \param[in] _time Time the message was received
+  /// \param[in] _topic topic_id of the message
+  /// \param[in] _data Message data
+  /// \param[in] _len Number of bytes of data
+  /// \param[in] _compressed True if the data are already compressed
+  /// \param[in] _headerTime Stamp of the header of the message, or nullptr
+  /// \return True if the parameters were bound. The number of bytes stored
+  /// is then in boundSizes.
+  public: bool BindMessage(sqlite3_stmt *_statement, std::size_t _row,
+      const std::chrono::nanoseconds &_time, int64_t _topic,
+      const void *_data, std::size_t _len, bool _compressed = false,
+      const std::chrono::nanoseconds *_headerTime = nullptr);
+
   /// \brief Return true if enough time has passed since the last transaction
   /// \return true if the transaction has lasted long enough
   public: bool TimeForNewTransaction() const;
 
+  /// \brief Count an inserted message in the statistics of its topic.
+  /// \param[in] _topic topic_id of the message
+  /// \param[in] _time Time the message was received
+  /// \param[in] _bytes Bytes of data stored
+  public: void CountMessage(int64_t _topic,
+      const std::chrono::nanoseconds &_time, std::size_t _bytes);
+
+  /// \brief Add the messages counted since the last call to the topic_stats
+  /// table, in the current transaction.
+  /// \return False if they could not be written.
+  public: bool FlushStats();
+
+  /// \brief Find the time of the last message that can be read from a
+  /// corrupt database. The messages are looked up backwards by id, which
+  /// follows the order they were inserted, skipping further back after each
+  /// unreadable page.
+  /// \param[out] _time The time of the message.
+  /// \return False if no message could be read.
+  public: bool LastReadableTime(std::chrono::nanoseconds &_time) const;
+
+  /// \brief Read the topic_compression table, if the log has one.
+  /// \return False if it could not be read.
+  public: bool LoadCompressedTopics();
+
+  /// \brief Copy the messages of the database attached as "source" in a
+  /// single transaction, see Log::InsertLog().
+  /// \param[in] _range Time range of the messages to copy.
+  /// \return The number of messages copied, or -1 on failure.
+  public: int64_t CopyAttachedLog(const QualifiedTimeRange &_range);
+
+  /// \brief Compress the messages of a new topic, if it's configured so.
+  /// \param[in] _name Name of the topic
+  /// \param[in] _type Name of the message type
+  /// \param[in] _topic topic_id of the topic
+  /// \return False if the topic could not be added to the
+  /// topic_compression table.
+  public: bool AddCompressedTopic(const std::string &_name,
+      const std::string &_type, int64_t _topic);
+
+  /// \brief Get the summaries of the topics of a SQLite3 log.
+  /// \param[out] _summaries The summaries.
+  /// \return False if they could not be read.
+  public: bool QuerySummaries(std::vector<TopicSummary> &_summaries);
+
+  /// \brief Messages of a topic counted since the statistics were written.
+  public: struct PendingStats
+  {
+    /// \brief Number of messages
+    uint64_t count = 0;
+
+    /// \brief Time of the first message (ns)
+    int64_t start = 0;
+
+    /// \brief Time of the last message (ns)
+    int64_t end = 0;
+
+    /// \brief Bytes of data stored
+    uint64_t bytes = 0;
+  };
+
+  /// \brief True if the log has the topic_stats table. The logs recorded by
+  /// older versions don't.
+  public: bool hasStats = false;
+
+  /// \brief True if the topic_stats table has the total_bytes column. The
+  /// logs recorded by older versions don't, their sizes are summed from the
+  /// messages.
+  public: bool hasStatsBytes = false;
+
+  /// \brief True if the messages table has the time_header column. The
+  /// logs recorded by older versions don't, they can't be queried by header
+  /// time.
+  public: bool hasHeaderTimes = false;
+
+  /// \brief Statistics to add to the topic_stats table, by topic_id.
+  public: std::map<int64_t, PendingStats> pendingStats;
+
   /// \brief SQLite3 database pointer wrapper
   public: std::shared_ptr<raii_sqlite3::Database> db;
 
+  /// \brief The log, if it's in the chunked format. It's shared with the
+  /// batches of its queries.
+  public: std::shared_ptr<ChunkedLog> chunked;
+
+  /// \brief The segments of the log, if it's a manifest of segments, or
+  /// its shards if it's a manifest of shards.
+  public: std::vector<std::unique_ptr<Log>> segments;
+
+  /// \brief Storage format of the log.
+  public: LogFormat format = LogFormat::SQLITE;
+
+  /// \brief Create the index of the messages by time received, if it was
+  /// deferred.
+  /// \return False if it could not be created.
+  public: bool CreateTimeIndex();
+
+  /// \brief Apply the migrations of the schema that the log is missing.
+  /// \param[in] _version Current version of the schema of the log.
+  /// \return False if a migration failed, the log is then left at the
+  /// version before it.
+  public: bool Migrate(std::string _version);
+
+  /// \brief True if the time index was deferred and not created yet.
+  public: bool timeIndexPending = false;
+
+  /// \brief True if the messages are indexed by topic and time received,
+  /// so that the queries of several topics can merge a scan per topic.
+  /// Logs recorded by older versions don't have the index.
+  public: bool hasTopicTimeIndex = false;
+
+  /// \brief True if the log was opened for writing in WAL mode, which is
+  /// left when the log is closed.
+  public: bool restoreJournalMode = false;
+
+  /// \brief Topics to compress when they are created, with their
+  /// dictionaries, see LogOpenOptions::compressedTopics.
+  public: std::map<std::string, std::string> compressedTopics;
+
+  /// \brief Dictionary of each compressed topic of the log, by topic_id,
+  /// to compress the messages inserted.
+  public: std::map<int64_t, std::string> compressedIds;
+
+  /// \brief Dictionary of each compressed topic of the log, shared with
+  /// the batches of its queries to decompress their messages. It's
+  /// replaced, rather than modified, when a topic is added.
+  public: std::shared_ptr<const TopicDictionaries> dictionaries;
+
+  /// \brief Compresses the messages inserted, created on the first one.
+  public: std::unique_ptr<BlobCodec> codec;
+
+  /// \brief Compressed data of each row of the insert statements. They
+  /// are bound without a copy, until the statement is executed.
+  public: std::vector<std::string> compressedRows;
+
+  /// \brief Number of bytes bound by BindMessage() to each row of the
+  /// insert statements.
+  public: std::vector<std::size_t> boundSizes;
+
+  /// \brief Number of topics of the chunked log in the descriptor.
+  private: mutable std::size_t describedTopics = 0;
+
   /// \brief True if a transaction is in progress
   public: bool inTransaction = false;
 
@@ -89,7 +541,7 @@ class ignition::transport::log::Log::Implementation
   public: std::chrono::milliseconds transactionPeriod;
 
   /// \brief Flag to track whether we need to generate a new Descriptor
-  private: mutable bool needNewDescriptor = true;
+  public: mutable bool needNewDescriptor = true;
 
   /// \brief Descriptor which provides insight to the column IDs in the database
   public: mutable log::Descriptor descriptor;
@@ -102,11 +554,87 @@ class ignition::transport::log::Log::Implementation
 
   /// \brief Time of the last message in the log file.
   public: std::chrono::nanoseconds endTime = std::chrono::nanoseconds(-1);
+
+  /// \brief See Log::SeekIndex(), built for seekIndexStride.
+  public: std::vector<std::chrono::nanoseconds> seekIndex;
+
+  /// \brief Stride of seekIndex, zero before it's built.
+  public: std::size_t seekIndexStride = 0;
+
+  /// \brief Id of the last message returned by Log::FollowMessages().
+  public: sqlite_int64 followedMessage = 0;
+
+  /// \brief Highest topic id seen by Log::FollowMessages().
+  public: sqlite_int64 followedTopic = 0;
+
+  /// \brief Compiled statement inserting one message. Declared after db so
+  /// that it's finalized before the database is closed.
+  public: std::unique_ptr<raii_sqlite3::Statement> insertStatement;
+
+  /// \brief Compiled statement inserting kRowsPerInsert messages.
+  public: std::unique_ptr<raii_sqlite3::Statement> insertBatchStatement;
+
+  /// \brief Compiled statement adding a topic to the topic_stats table.
+  public: std::unique_ptr<raii_sqlite3::Statement> insertStatsStatement;
+
+  /// \brief Compiled statement updating a row of the topic_stats table.
+  public: std::unique_ptr<raii_sqlite3::Statement> updateStatsStatement;
+
+  /// \brief Compiled statement adding a message type, see
+  /// InsertOrGetTopicId().
+  public: std::unique_ptr<raii_sqlite3::Statement> insertTypeStatement;
+
+  /// \brief Compiled statement adding a topic, see InsertOrGetTopicId().
+  public: std::unique_ptr<raii_sqlite3::Statement> insertTopicStatement;
 };
 
 //////////////////////////////////////////////////
 const log::Descriptor *Log::Implementation::Descriptor() const
 {
+  // The topics of a chunked log are in memory
+  if (this->chunked)
+  {
+    const TopicKeyMap &topicsInLog = this->chunked->Topics();
+    if (this->needNewDescriptor || this->describedTopics != topicsInLog.size())
+    {
+      this->needNewDescriptor = false;
+      this->describedTopics = topicsInLog.size();
+      descriptor.dataPtr->Reset(topicsInLog);
+    }
+    return &this->descriptor;
+  }
+
+  // The topics of the segments are merged, with ids of their own. The
+  // segments are only read, so they don't change.
+  if (!this->segments.empty())
+  {
+    if (this->needNewDescriptor)
+    {
+      TopicKeyMap topicsInLog;
+      for (const std::unique_ptr<Log> &segment : this->segments)
+      {
+        const log::Descriptor *segmentDesc = segment->Descriptor();
+        if (!segmentDesc)
+          return nullptr;
+        for (const auto &topicEntry : segmentDesc->TopicsToMsgTypesToId())
+        {
+          for (const auto &msgEntry : topicEntry.second)
+          {
+            const TopicKey key = {topicEntry.first, msgEntry.first};
+            if (topicsInLog.find(key) == topicsInLog.end())
+            {
+              const int64_t id = static_cast<int64_t>(topicsInLog.size()) + 1;
+              topicsInLog[key] = id;
+            }
+          }
+        }
+      }
+      this->needNewDescriptor = false;
+      descriptor.dataPtr->Reset(topicsInLog);
+    }
+    return &this->descriptor;
+  }
+
   if (!this->db)
     return nullptr;
 
@@ -186,6 +714,10 @@ int Log::Implementation::EndTransactionIfEnoughTimeHasPassed()
 //////////////////////////////////////////////////
 int Log::Implementation::EndTransaction()
 {
+  // The statistics are committed along with their messages. The messages
+  // are kept even if they fail.
+  this->FlushStats();
+
   // End the transaction
   int returnCode = sqlite3_exec(
       this->db->Handle(), "END;", NULL, 0, nullptr);
@@ -218,6 +750,75 @@ int Log::Implementation::BeginTransactionIfNotInOne()
   return returnCode;
 }
 
+//////////////////////////////////////////////////
+bool Log::Implementation::Migrate(std::string _version)
+{
+  // All or nothing, a log that fails a migration keeps its version
+  sqlite3 *db = this->db->Handle();
+  if (sqlite3_exec(db, "BEGIN;", NULL, 0, NULL) != SQLITE_OK)
+  {
+    LERR("Failed to migrate log: " << sqlite3_errmsg(db) << "\n");
+    return false;
+  }
+
+  for (const SchemaMigration &migration : kMigrations)
+  {
+    if (_version != migration.from)
+      continue;
+
+    // The migrations also record the new version
+    std::string sql;
+    if (!ReadSchemaFile(migration.file, sql))
+    {
+      sqlite3_exec(db, "ROLLBACK;", NULL, 0, NULL);
+      return false;
+    }
+
+    if (sqlite3_exec(db, sql.c_str(), NULL, 0, NULL) != SQLITE_OK)
+    {
+      LERR("Failed to migrate log from version " << migration.from << " to "
+          << migration.to << ": " << sqlite3_errmsg(db) << "\n");
+      sqlite3_exec(db, "ROLLBACK;", NULL, 0, NULL);
+      return false;
+    }
+    LDBG("Migrated log from version " << migration.from << " to "
+        << migration.to << "\n");
+    _version = migration.to;
+  }
+
+  if (sqlite3_exec(db, "COMMIT;", NULL, 0, NULL) != SQLITE_OK)
+  {
+    LERR("Failed to migrate log: " << sqlite3_errmsg(db) << "\n");
+    sqlite3_exec(db, "ROLLBACK;", NULL, 0, NULL);
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::CreateTimeIndex()
+{
+  if (!this->timeIndexPending)
+    return true;
+
+  // Same definitions as in the schema
+  const int returnCode = sqlite3_exec(this->db->Handle(),
+      "CREATE INDEX IF NOT EXISTS idx_time_recv ON messages (time_recv);"
+      "CREATE INDEX IF NOT EXISTS idx_topic_time_recv"
+      " ON messages (topic_id, time_recv);",
+      NULL, 0, nullptr);
+  if (returnCode != SQLITE_OK)
+  {
+    LERR("Failed to create the time index: " << sqlite3_errmsg(
+        this->db->Handle()) << "\n");
+    return false;
+  }
+  LDBG("Created the time index\n");
+  this->timeIndexPending = false;
+  this->hasTopicTimeIndex = true;
+  return true;
+}
+
 //////////////////////////////////////////////////
 bool Log::Implementation::TimeForNewTransaction() const
 {
@@ -226,63 +827,553 @@ bool Log::Implementation::TimeForNewTransaction() const
 }
 
 //////////////////////////////////////////////////
-int64_t Log::Implementation::InsertOrGetTopicId(
-    const std::string &_name,
-    const std::string &_type)
+void Log::Implementation::CountMessage(const int64_t _topic,
+    const std::chrono::nanoseconds &_time, const std::size_t _bytes)
 {
-  // If the name and type is known, return a cached ID
-  // Call method to get side effect of updating descriptor
-  const log::Descriptor *desc = this->Descriptor();
-  if (nullptr == desc)
+  if (!this->hasStats)
+    return;
+
+  PendingStats &stats = this->pendingStats[_topic];
+  if (stats.count == 0 || _time.count() < stats.start)
+    stats.start = _time.count();
+  if (stats.count == 0 || _time.count() > stats.end)
+    stats.end = _time.count();
+  ++stats.count;
+  stats.bytes += _bytes;
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::FlushStats()
+{
+  if (this->pendingStats.empty())
+    return true;
+
+  if (!this->insertStatsStatement)
   {
-    return -1;
+    this->insertStatsStatement.reset(new raii_sqlite3::Statement(*(this->db),
+      "INSERT OR IGNORE INTO topic_stats"
+      " (topic_id, message_count, start_time, end_time)"
+      " VALUES (?001, 0, ?002, ?003);"));
+    this->updateStatsStatement.reset(new raii_sqlite3::Statement(*(this->db),
+      this->hasStatsBytes ?
+      "UPDATE topic_stats SET message_count = message_count + ?002,"
+      " start_time = MIN(start_time, ?003), end_time = MAX(end_time, ?004),"
+      " total_bytes = total_bytes + ?005"
+      " WHERE topic_id = ?001;" :
+      "UPDATE topic_stats SET message_count = message_count + ?002,"
+      " start_time = MIN(start_time, ?003), end_time = MAX(end_time, ?004)"
+      " WHERE topic_id = ?001;"));
+    if (!*this->insertStatsStatement || !*this->updateStatsStatement)
+    {
+      LERR("Failed to compile the statements of the topic statistics\n");
+      this->insertStatsStatement.reset();
+      this->updateStatsStatement.reset();
+      return false;
+    }
   }
 
-  int64_t topicId = desc->TopicId(_name, _type);
-  if (topicId >= 0)
+  sqlite3_stmt *insert = this->insertStatsStatement->Handle();
+  sqlite3_stmt *update = this->updateStatsStatement->Handle();
+  bool result = true;
+  for (const auto &topicStats : this->pendingStats)
   {
-    return topicId;
+    const PendingStats &stats = topicStats.second;
+    sqlite3_bind_int64(insert, 1, topicStats.first);
+    sqlite3_bind_int64(insert, 2, stats.start);
+    sqlite3_bind_int64(insert, 3, stats.end);
+    sqlite3_bind_int64(update, 1, topicStats.first);
+    sqlite3_bind_int64(update, 2, static_cast<sqlite3_int64>(stats.count));
+    sqlite3_bind_int64(update, 3, stats.start);
+    sqlite3_bind_int64(update, 4, stats.end);
+    if (this->hasStatsBytes)
+      sqlite3_bind_int64(update, 5, static_cast<sqlite3_int64>(stats.bytes));
+
+    int returnCode = sqlite3_step(insert);
+    if (returnCode == SQLITE_DONE)
+      returnCode = sqlite3_step(update);
+    sqlite3_reset(insert);
+    sqlite3_reset(update);
+
+    if (returnCode != SQLITE_DONE)
+    {
+      LERR("Failed to update the topic statistics: " << sqlite3_errmsg(
+          this->db->Handle()) << "\n");
+      result = false;
+    }
   }
 
-  // Inserting a new topic invalidates the descriptor
-  this->needNewDescriptor = true;
+  this->pendingStats.clear();
+  return result;
+}
 
-  // Otherwise insert it into the database and return the new topic_id
-  const std::string sqlMessageType =
-    "INSERT OR IGNORE INTO message_types (name) VALUES (?001);";
-  const std::string sqlTopic =
-    "INSERT INTO topics (name, message_type_id)"
-    " SELECT ?002, id FROM message_types WHERE name = ?001 LIMIT 1;";
+//////////////////////////////////////////////////
+bool Log::Implementation::LastReadableTime(
+    std::chrono::nanoseconds &_time) const
+{
+  // AUTOINCREMENT keeps the highest id of the messages in sqlite_sequence
+  sqlite_int64 bound = 0;
+  {
+    raii_sqlite3::Statement statement(*(this->db),
+      "SELECT seq FROM sqlite_sequence WHERE name = 'messages';");
+    if (!statement || sqlite3_step(statement.Handle()) != SQLITE_ROW)
+    {
+      LERR("Failed to get the number of messages\n");
+      return false;
+    }
+    bound = sqlite3_column_int64(statement.Handle(), 0);
+  }
 
-  raii_sqlite3::Statement messageTypeStatement(
-      *(this->db), sqlMessageType);
-  if (!messageTypeStatement)
+  raii_sqlite3::Statement statement(*(this->db),
+    "SELECT time_recv FROM messages WHERE id <= ?001"
+    " ORDER BY id DESC LIMIT 1;");
+  if (!statement)
   {
-    LERR("Failed to compile statement to insert message type\n");
-    return -1;
+    LERR("Failed to compile last message query statement\n");
+    return false;
   }
-  raii_sqlite3::Statement topicStatement(
-      *(this->db), sqlTopic);
-  if (!topicStatement)
+
+  sqlite_int64 skip = 1;
+  while (bound > 0)
   {
-    LERR("Failed to compile statement to insert topic\n");
-    return -1;
+    sqlite3_bind_int64(statement.Handle(), 1, bound);
+    const int returnCode = sqlite3_step(statement.Handle());
+    if (returnCode == SQLITE_ROW)
+    {
+      _time = std::chrono::nanoseconds(
+        sqlite3_column_int64(statement.Handle(), 0));
+      return true;
+    }
+    sqlite3_reset(statement.Handle());
+    if (returnCode == SQLITE_DONE)
+      return false;
+
+    // Skip twice as many messages after each failure
+    bound -= skip;
+    skip *= 2;
   }
+  return false;
+}
 
-  // Reset startTime and endTime
-  this->startTime = std::chrono::nanoseconds(-1);
-  this->endTime = std::chrono::nanoseconds(-1);
+//////////////////////////////////////////////////
+bool Log::Implementation::LoadCompressedTopics()
+{
+  // The logs recorded by older versions have no compressed topics
+  {
+    raii_sqlite3::Statement statement(*(this->db),
+      "SELECT 1 FROM sqlite_master WHERE type = 'table'"
+      " AND name = 'topic_compression';");
+    if (!statement || sqlite3_step(statement.Handle()) != SQLITE_ROW)
+      return true;
+  }
 
-  int returnCode;
-  // Bind parameters
-  returnCode = sqlite3_bind_text(
-      messageTypeStatement.Handle(), 1, _type.c_str(), _type.size(), nullptr);
-  if (returnCode != SQLITE_OK)
+  raii_sqlite3::Statement statement(*(this->db),
+    "SELECT topics.id, topics.name, message_types.name,"
+    " topic_compression.codec, topic_compression.dictionary"
+    " FROM topic_compression"
+    " JOIN topics ON topics.id = topic_compression.topic_id"
+    " JOIN message_types ON topics.message_type_id = message_types.id;");
+  if (!statement)
   {
-    LERR("Failed to bind message type name(1): " << returnCode << "\n");
-    return -1;
+    LERR("Failed to compile compressed topics query statement\n");
+    return false;
   }
-  returnCode = sqlite3_bind_text(
+
+  std::shared_ptr<TopicDictionaries> loaded =
+    std::make_shared<TopicDictionaries>();
+  int returnCode;
+  while ((returnCode = sqlite3_step(statement.Handle())) == SQLITE_ROW)
+  {
+    TopicKey key;
+    key.topic = reinterpret_cast<const char *>(
+      sqlite3_column_text(statement.Handle(), 1));
+    key.type = reinterpret_cast<const char *>(
+      sqlite3_column_text(statement.Handle(), 2));
+
+    const std::string codecName = reinterpret_cast<const char *>(
+      sqlite3_column_text(statement.Handle(), 3));
+    if (codecName != kZlibCodec)
+    {
+      LERR("Topic [" << key.topic << "] is compressed with unsupported codec ["
+          << codecName << "]\n");
+      return false;
+    }
+
+    const char *dictionary = static_cast<const char *>(
+      sqlite3_column_blob(statement.Handle(), 4));
+    const std::size_t size = sqlite3_column_bytes(statement.Handle(), 4);
+    std::string &entry = (*loaded)[key];
+    if (dictionary)
+      entry.assign(dictionary, size);
+    this->compressedIds[sqlite3_column_int64(statement.Handle(), 0)] = entry;
+  }
+
+  if (returnCode != SQLITE_DONE)
+  {
+    LERR("Failed to query compressed topics: " << sqlite3_errmsg(
+        this->db->Handle()) << "\n");
+    return false;
+  }
+
+  if (!loaded->empty() && !BlobCodec::Available())
+  {
+    LERR("The log has compressed topics, but zlib was not available at "
+        "build time\n");
+    return false;
+  }
+
+  if (!loaded->empty())
+    this->dictionaries = std::move(loaded);
+  return true;
+}
+
+//////////////////////////////////////////////////
+int64_t Log::Implementation::CopyAttachedLog(const QualifiedTimeRange &_range)
+{
+  // The rows added by the copy are the ones after the last ones
+  sqlite_int64 lastTopic = 0;
+  sqlite_int64 lastMessage = 0;
+  bool compressed = false;
+  {
+    raii_sqlite3::Statement statement(*(this->db),
+      "SELECT (SELECT IFNULL(MAX(id), 0) FROM main.topics),"
+      " (SELECT IFNULL(MAX(id), 0) FROM main.messages),"
+      " EXISTS (SELECT 1 FROM source.sqlite_master WHERE type = 'table'"
+      " AND name = 'topic_compression');");
+    if (!statement || sqlite3_step(statement.Handle()) != SQLITE_ROW)
+    {
+      LERR("Failed to read the log to insert: " << sqlite3_errmsg(
+          this->db->Handle()) << "\n");
+      return -1;
+    }
+    lastTopic = sqlite3_column_int64(statement.Handle(), 0);
+    lastMessage = sqlite3_column_int64(statement.Handle(), 1);
+    compressed = sqlite3_column_int(statement.Handle(), 2) != 0;
+  }
+
+  if (!ExecuteSql(*(this->db), "BEGIN;"))
+    return -1;
+
+  auto rollback = [this]()
+  {
+    ExecuteSql(*(this->db), "ROLLBACK;");
+    return -1;
+  };
+
+  // Add the missing types and topics, and map the topics of the source
+  if (!ExecuteSql(*(this->db),
+        "INSERT INTO main.message_types (name)"
+        " SELECT DISTINCT name FROM source.message_types"
+        " WHERE name NOT IN (SELECT name FROM main.message_types);"
+        "INSERT INTO main.topics (name, message_type_id)"
+        " SELECT topics.name, types.id FROM source.topics AS topics"
+        " JOIN source.message_types AS source_types"
+        "   ON source_types.id = topics.message_type_id"
+        " JOIN main.message_types AS types ON types.name = source_types.name"
+        " WHERE NOT EXISTS (SELECT 1 FROM main.topics AS existing"
+        "   WHERE existing.name = topics.name"
+        "   AND existing.message_type_id = types.id);"
+        "CREATE TEMP TABLE topic_map AS"
+        " SELECT topics.id AS source_id, existing.id AS target_id"
+        " FROM source.topics AS topics"
+        " JOIN source.message_types AS source_types"
+        "   ON source_types.id = topics.message_type_id"
+        " JOIN main.message_types AS types ON types.name = source_types.name"
+        " JOIN main.topics AS existing ON existing.name = topics.name"
+        "   AND existing.message_type_id = types.id;"))
+  {
+    return rollback();
+  }
+
+  // The messages are copied as they are stored, so the topics must be
+  // compressed alike. The new topics are compressed like in the source.
+  std::string conflicts =
+    "SELECT COUNT(*) FROM temp.topic_map AS map"
+    " JOIN main.topic_compression AS target"
+    "   ON target.topic_id = map.target_id;";
+  if (compressed)
+  {
+    if (!ExecuteSql(*(this->db),
+          "INSERT INTO main.topic_compression (topic_id, codec, dictionary)"
+          " SELECT map.target_id, source.codec, source.dictionary"
+          " FROM temp.topic_map AS map"
+          " JOIN source.topic_compression AS source"
+          "   ON source.topic_id = map.source_id"
+          " WHERE map.target_id > " + std::to_string(lastTopic) + ";"))
+    {
+      return rollback();
+    }
+    conflicts =
+      "SELECT COUNT(*) FROM temp.topic_map AS map"
+      " LEFT JOIN source.topic_compression AS source"
+      "   ON source.topic_id = map.source_id"
+      " LEFT JOIN main.topic_compression AS target"
+      "   ON target.topic_id = map.target_id"
+      " WHERE source.codec IS NOT target.codec"
+      "   OR source.dictionary IS NOT target.dictionary;";
+  }
+  {
+    raii_sqlite3::Statement statement(*(this->db), conflicts);
+    if (!statement || sqlite3_step(statement.Handle()) != SQLITE_ROW)
+    {
+      LERR("Failed to compare the compressed topics: " << sqlite3_errmsg(
+          this->db->Handle()) << "\n");
+      return rollback();
+    }
+    if (sqlite3_column_int64(statement.Handle(), 0) > 0)
+    {
+      LERR("Topics of the log to insert are compressed differently than in "
+          "this log\n");
+      return rollback();
+    }
+  }
+
+  // The logs recorded by older versions have no header times
+  bool sourceHeaderTimes = false;
+  {
+    raii_sqlite3::Statement statement(*(this->db),
+      "SELECT time_header FROM source.messages LIMIT 0;");
+    sourceHeaderTimes = static_cast<bool>(statement);
+  }
+
+  // Copy the messages in the order they were received. The source is
+  // aliased as messages for the time conditions.
+  SqlStatement sql;
+  sql.statement =
+    "INSERT INTO main.messages (time_recv, topic_id, message, time_header)"
+    " SELECT messages.time_recv, map.target_id, messages.message, " +
+    std::string(sourceHeaderTimes ? "messages.time_header" : "NULL") +
+    " FROM source.messages AS messages"
+    " JOIN temp.topic_map AS map ON map.source_id = messages.topic_id";
+  const SqlStatement timeCondition =
+    AllTopics(_range).GenerateTimeConditions();
+  if (!timeCondition.statement.empty())
+  {
+    sql.statement += " WHERE (";
+    sql.Append(timeCondition);
+    sql.statement += ")";
+  }
+  sql.statement += " ORDER BY messages.time_recv;";
+
+  int64_t copied = 0;
+  {
+    raii_sqlite3::Statement statement(*(this->db), sql.statement);
+    if (!statement)
+    {
+      LERR("Failed to compile the copy of the messages: " << sqlite3_errmsg(
+          this->db->Handle()) << "\n");
+      return rollback();
+    }
+    int i = 1;
+    for (const SqlParameter &param : sql.parameters)
+      sqlite3_bind_int64(statement.Handle(), i++, *param.QueryInteger());
+    if (sqlite3_step(statement.Handle()) != SQLITE_DONE)
+    {
+      LERR("Failed to copy the messages: " << sqlite3_errmsg(
+          this->db->Handle()) << "\n");
+      return rollback();
+    }
+    copied = sqlite3_changes(this->db->Handle());
+  }
+
+  // Add the copied messages to the statistics of their topics
+  const std::string bytesColumn = this->hasStatsBytes ? ", total_bytes" : "";
+  if (this->hasStats && !ExecuteSql(*(this->db),
+        "CREATE TEMP TABLE new_stats AS"
+        " SELECT topic_id, COUNT(*) AS message_count,"
+        "   MIN(time_recv) AS start_time, MAX(time_recv) AS end_time,"
+        "   SUM(LENGTH(message)) AS total_bytes"
+        " FROM main.messages WHERE id > " + std::to_string(lastMessage) +
+        " GROUP BY topic_id;"
+        "UPDATE main.topic_stats SET"
+        " message_count = message_count + (SELECT message_count"
+        "   FROM temp.new_stats WHERE topic_id = topic_stats.topic_id),"
+        " start_time = MIN(start_time, (SELECT start_time"
+        "   FROM temp.new_stats WHERE topic_id = topic_stats.topic_id)),"
+        " end_time = MAX(end_time, (SELECT end_time"
+        "   FROM temp.new_stats WHERE topic_id = topic_stats.topic_id))" +
+        (this->hasStatsBytes ?
+         ", total_bytes = total_bytes + (SELECT total_bytes"
+         "   FROM temp.new_stats WHERE topic_id = topic_stats.topic_id)" :
+         "") +
+        " WHERE topic_id IN (SELECT topic_id FROM temp.new_stats);"
+        "INSERT INTO main.topic_stats"
+        " (topic_id, message_count, start_time, end_time" + bytesColumn + ")"
+        " SELECT topic_id, message_count, start_time, end_time" +
+        bytesColumn + " FROM temp.new_stats"
+        " WHERE topic_id NOT IN (SELECT topic_id FROM main.topic_stats);"))
+  {
+    return rollback();
+  }
+
+  if (!ExecuteSql(*(this->db), "COMMIT;"))
+    return rollback();
+  return copied;
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::AddCompressedTopic(const std::string &_name,
+    const std::string &_type, const int64_t _topic)
+{
+  auto configured = this->compressedTopics.find(_name);
+  if (configured == this->compressedTopics.end())
+    return true;
+
+  raii_sqlite3::Statement statement(*(this->db),
+    "INSERT INTO topic_compression (topic_id, codec, dictionary)"
+    " VALUES (?, ?, ?);");
+  if (!statement)
+  {
+    LERR("Failed to compile statement to insert compressed topic\n");
+    return false;
+  }
+
+  const std::string &dictionary = configured->second;
+  sqlite3_bind_int64(statement.Handle(), 1, _topic);
+  sqlite3_bind_text(statement.Handle(), 2, kZlibCodec, -1, nullptr);
+  if (!dictionary.empty())
+  {
+    sqlite3_bind_blob(statement.Handle(), 3, dictionary.data(),
+      static_cast<int>(dictionary.size()), nullptr);
+  }
+  const int returnCode = sqlite3_step(statement.Handle());
+  if (returnCode != SQLITE_DONE)
+  {
+    LERR("Failed to insert compressed topic: " << returnCode << "\n");
+    return false;
+  }
+  this->compressedIds[_topic] = dictionary;
+
+  // The batches of the earlier queries keep the dictionaries they had
+  std::shared_ptr<TopicDictionaries> updated =
+    this->dictionaries ?
+    std::make_shared<TopicDictionaries>(*this->dictionaries) :
+    std::make_shared<TopicDictionaries>();
+  (*updated)[TopicKey{_name, _type}] = dictionary;
+  this->dictionaries = std::move(updated);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::QuerySummaries(
+    std::vector<TopicSummary> &_summaries)
+{
+  // The logs recorded by older versions are summarized from their messages
+  // with a single query. The sizes of the messages are read from their
+  // headers, not their data.
+  std::string sql =
+    "SELECT topics.name, message_types.name, stats.message_count,"
+    " stats.start_time, stats.end_time, stats.total_bytes FROM ";
+  if (this->hasStatsBytes)
+  {
+    this->FlushStats();
+    sql += "topic_stats AS stats";
+  }
+  else
+  {
+    sql += "(SELECT topic_id, COUNT(*) AS message_count,"
+      " MIN(time_recv) AS start_time, MAX(time_recv) AS end_time,"
+      " SUM(LENGTH(message)) AS total_bytes"
+      " FROM messages GROUP BY topic_id) AS stats";
+  }
+  sql += " JOIN topics ON topics.id = stats.topic_id"
+    " JOIN message_types ON topics.message_type_id = message_types.id;";
+
+  raii_sqlite3::Statement statement(*(this->db), sql);
+  if (!statement)
+  {
+    LERR("Failed to compile topic summary query statement\n");
+    return false;
+  }
+
+  int returnCode;
+  while ((returnCode = sqlite3_step(statement.Handle())) == SQLITE_ROW)
+  {
+    TopicSummary summary;
+    summary.topic = reinterpret_cast<const char *>(
+      sqlite3_column_text(statement.Handle(), 0));
+    summary.type = reinterpret_cast<const char *>(
+      sqlite3_column_text(statement.Handle(), 1));
+    summary.messageCount = static_cast<uint64_t>(
+      sqlite3_column_int64(statement.Handle(), 2));
+    summary.startTime = std::chrono::nanoseconds(
+      sqlite3_column_int64(statement.Handle(), 3));
+    summary.endTime = std::chrono::nanoseconds(
+      sqlite3_column_int64(statement.Handle(), 4));
+    summary.totalBytes = static_cast<uint64_t>(
+      sqlite3_column_int64(statement.Handle(), 5));
+    _summaries.push_back(std::move(summary));
+  }
+
+  if (returnCode != SQLITE_DONE)
+  {
+    LERR("Failed to query topic summaries: " << sqlite3_errmsg(
+        this->db->Handle()) << "\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+int64_t Log::Implementation::InsertOrGetTopicId(
+    const std::string &_name,
+    const std::string &_type)
+{
+  // If the name and type is known, return a cached ID
+  // Call method to get side effect of updating descriptor
+  const log::Descriptor *desc = this->Descriptor();
+  if (nullptr == desc)
+  {
+    return -1;
+  }
+
+  int64_t topicId = desc->TopicId(_name, _type);
+  if (topicId >= 0)
+  {
+    return topicId;
+  }
+
+  // Otherwise insert it into the database and return the new topic_id.
+  // The statements are kept for the next topics.
+  if (!this->insertTypeStatement)
+  {
+    this->insertTypeStatement.reset(new raii_sqlite3::Statement(*(this->db),
+      "INSERT OR IGNORE INTO message_types (name) VALUES (?001);"));
+    if (!*this->insertTypeStatement)
+    {
+      LERR("Failed to compile statement to insert message type\n");
+      this->insertTypeStatement.reset();
+      return -1;
+    }
+  }
+  if (!this->insertTopicStatement)
+  {
+    this->insertTopicStatement.reset(new raii_sqlite3::Statement(*(this->db),
+      "INSERT INTO topics (name, message_type_id)"
+      " SELECT ?002, id FROM message_types WHERE name = ?001 LIMIT 1;"));
+    if (!*this->insertTopicStatement)
+    {
+      LERR("Failed to compile statement to insert topic\n");
+      this->insertTopicStatement.reset();
+      return -1;
+    }
+  }
+  raii_sqlite3::Statement &messageTypeStatement = *this->insertTypeStatement;
+  raii_sqlite3::Statement &topicStatement = *this->insertTopicStatement;
+
+  // Reset startTime and endTime
+  this->startTime = std::chrono::nanoseconds(-1);
+  this->endTime = std::chrono::nanoseconds(-1);
+
+  int returnCode;
+  // Bind parameters
+  returnCode = sqlite3_bind_text(
+      messageTypeStatement.Handle(), 1, _type.c_str(), _type.size(), nullptr);
+  if (returnCode != SQLITE_OK)
+  {
+    LERR("Failed to bind message type name(1): " << returnCode << "\n");
+    return -1;
+  }
+  returnCode = sqlite3_bind_text(
       topicStatement.Handle(), 1, _type.c_str(), _type.size(), nullptr);
   if (returnCode != SQLITE_OK)
   {
@@ -297,14 +1388,17 @@ int64_t Log::Implementation::InsertOrGetTopicId(
     return -1;
   }
 
-  // Execute the statements
+  // Execute the statements, then reset them for the next topic
   returnCode = sqlite3_step(messageTypeStatement.Handle());
+  sqlite3_reset(messageTypeStatement.Handle());
   if (returnCode != SQLITE_DONE)
   {
+    sqlite3_reset(topicStatement.Handle());
     LERR("Failed to insert message type: " << returnCode << "\n");
     return -1;
   }
   returnCode = sqlite3_step(topicStatement.Handle());
+  sqlite3_reset(topicStatement.Handle());
   if (returnCode != SQLITE_DONE)
   {
     LERR("Faild to insert topic: " << returnCode << "\n");
@@ -314,73 +1408,233 @@ int64_t Log::Implementation::InsertOrGetTopicId(
   // topics.id is an alias for rowid
   int64_t id = sqlite3_last_insert_rowid(this->db->Handle());
   LDBG("Inserted '" << _name << "'[" << _type << "]\n");
+
+  // The descriptor is up to date, so the topic is added to it rather than
+  // reading all the topics again
+  this->descriptor.dataPtr->AddTopic(TopicKey{_name, _type}, id);
+
+  if (!this->AddCompressedTopic(_name, _type, id))
+    return -1;
   return id;
 }
 
 //////////////////////////////////////////////////
-bool Log::Implementation::InsertMessage(
-    const std::chrono::nanoseconds &_time,
-    const int64_t _topic,
-    const void *_data,
-    const std::size_t _len)
+raii_sqlite3::Statement *Log::Implementation::InsertStatement(
+    const std::size_t _rows)
 {
-  // \todo Record and playback empty messages. A topic could publish an
-  // Int32 or Int64 message with data=0. In this situation the protobuf
-  // message has size zero. While this is not a problem for protobuf messages,
-  // it is considered an error for SQLite3. We short circuit here in order to
-  // prevent the final LERR in this function from spamming the console.
-  if (_len == 0)
-    return false;
-
-  int returnCode;
-  const std::string sql =
-    "INSERT INTO messages (time_recv, message, topic_id)"
-    "VALUES (?001, ?002, ?003);";
+  std::unique_ptr<raii_sqlite3::Statement> &statement =
+    _rows == 1 ? this->insertStatement : this->insertBatchStatement;
 
-  // Compile the statement
-  raii_sqlite3::Statement statement(*(this->db), sql);
   if (!statement)
   {
-    LERR("Failed to compile insert message statement\n");
-    return false;
+    std::string sql =
+      "INSERT INTO messages (time_recv, message, topic_id, time_header)"
+      " VALUES (?, ?, ?, ?)";
+    for (std::size_t i = 1; i < _rows; ++i)
+      sql += ", (?, ?, ?, ?)";
+    sql += ";";
+
+    statement.reset(new raii_sqlite3::Statement(*(this->db), sql));
+    if (!*statement)
+    {
+      LERR("Failed to compile insert message statement\n");
+      statement.reset();
+      return nullptr;
+    }
   }
 
-  // Bind parameters
-  returnCode = sqlite3_bind_int64(statement.Handle(), 1, _time.count());
+  return statement.get();
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::BindMessage(
+    sqlite3_stmt *_statement,
+    const std::size_t _row,
+    const std::chrono::nanoseconds &_time,
+    const int64_t _topic,
+    const void *_data,
+    const std::size_t _len,
+    const bool _compressed,
+    const std::chrono::nanoseconds *_headerTime)
+{
+  const int first = static_cast<int>(_row * 4);
+
+  int returnCode = sqlite3_bind_int64(_statement, first + 1, _time.count());
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind time received: " << returnCode << "\n");
     return false;
   }
-  returnCode = sqlite3_bind_blob(statement.Handle(), 2, _data, _len, nullptr);
+
+  // The compressed data are kept until the statement is executed
+  const void *blob = _data;
+  if (this->boundSizes.size() <= _row)
+    this->boundSizes.resize(kRowsPerInsert);
+  std::size_t blobLen = _len;
+  if (!_compressed && !this->compressedIds.empty())
+  {
+    auto dictionary = this->compressedIds.find(_topic);
+    if (dictionary != this->compressedIds.end())
+    {
+      if (!this->codec)
+        this->codec.reset(new BlobCodec);
+      if (this->compressedRows.size() <= _row)
+        this->compressedRows.resize(kRowsPerInsert);
+
+      std::string &compressed = this->compressedRows[_row];
+      if (!this->codec->Compress(_data, _len, dictionary->second, compressed))
+        return false;
+      blob = compressed.data();
+      blobLen = compressed.size();
+    }
+  }
+
+  this->boundSizes[_row] = blobLen;
+  returnCode = sqlite3_bind_blob(_statement, first + 2, blob,
+    static_cast<int>(blobLen), nullptr);
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind message data: " << returnCode << "\n");
     return false;
   }
-  returnCode = sqlite3_bind_int(statement.Handle(), 3, _topic);
+  returnCode = sqlite3_bind_int64(_statement, first + 3, _topic);
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind topic_id: " << returnCode << "\n");
     return false;
   }
+  returnCode = _headerTime ?
+    sqlite3_bind_int64(_statement, first + 4, _headerTime->count()) :
+    sqlite3_bind_null(_statement, first + 4);
+  if (returnCode != SQLITE_OK)
+  {
+    LERR("Failed to bind header time: " << returnCode << "\n");
+    return false;
+  }
+  return true;
+}
 
-  // Reset startTime and endTime
+//////////////////////////////////////////////////
+bool Log::Implementation::InsertMessage(
+    const std::chrono::nanoseconds &_time,
+    const int64_t _topic,
+    const void *_data,
+    const std::size_t _len)
+{
+  // \todo Record and playback empty messages. A topic could publish an
+  // Int32 or Int64 message with data=0. In this situation the protobuf
+  // message has size zero. While this is not a problem for protobuf messages,
+  // it is considered an error for SQLite3. We short circuit here in order to
+  // prevent the final LERR in this function from spamming the console.
+  if (_len == 0)
+    return false;
+
+  raii_sqlite3::Statement *statement = this->InsertStatement(1);
+  if (!statement)
+    return false;
+
+  // Reset startTime, endTime and the seek index
   this->startTime = std::chrono::nanoseconds(-1);
   this->endTime = std::chrono::nanoseconds(-1);
+  this->seekIndexStride = 0;
 
+  // Execute the statement, then reset it for the next message
+  int returnCode = SQLITE_DONE;
+  if (this->BindMessage(statement->Handle(), 0, _time, _topic, _data, _len))
+    returnCode = sqlite3_step(statement->Handle());
+  else
+    returnCode = SQLITE_ERROR;
+  sqlite3_reset(statement->Handle());
 
-  // Execute the statement
-  returnCode = sqlite3_step(statement.Handle());
   if (returnCode != SQLITE_DONE)
   {
     LERR("Failed to insert message. sqlite3 return code[" << returnCode
         << "] data[" << _data << "] len[" << _len << "]\n");
     return false;
   }
+  this->CountMessage(_topic, _time, this->boundSizes[0]);
   return true;
 }
 
+//////////////////////////////////////////////////
+std::size_t Log::Implementation::InsertMessages(
+    const std::vector<std::pair<const MessageRecord *, int64_t>> &_rows)
+{
+  if (_rows.empty())
+    return 0;
+
+  // Reset startTime, endTime and the seek index
+  this->startTime = std::chrono::nanoseconds(-1);
+  this->endTime = std::chrono::nanoseconds(-1);
+  this->seekIndexStride = 0;
+
+  std::size_t inserted = 0;
+  std::size_t next = 0;
+  while (next < _rows.size())
+  {
+    const std::size_t rows =
+      _rows.size() - next >= kRowsPerInsert ? kRowsPerInsert : 1;
+
+    raii_sqlite3::Statement *statement = this->InsertStatement(rows);
+    if (!statement)
+      return inserted;
+
+    bool bound = true;
+    for (std::size_t i = 0; i < rows && bound; ++i)
+    {
+      const MessageRecord &msg = *_rows[next + i].first;
+      bound = this->BindMessage(statement->Handle(), i, msg.time,
+        _rows[next + i].second, msg.data, msg.len, msg.compressed,
+        msg.headerTime);
+    }
+
+    // Execute the statement, then reset it for the next rows
+    const int returnCode =
+      bound ? sqlite3_step(statement->Handle()) : SQLITE_ERROR;
+    sqlite3_reset(statement->Handle());
+
+    if (returnCode == SQLITE_DONE)
+    {
+      inserted += rows;
+      for (std::size_t i = 0; i < rows; ++i)
+      {
+        this->CountMessage(_rows[next + i].second, _rows[next + i].first->time,
+          this->boundSizes[i]);
+      }
+    }
+    else
+    {
+      LERR("Failed to insert " << rows << " messages. sqlite3 return code["
+          << returnCode << "]\n");
+    }
+    next += rows;
+  }
+  return inserted;
+}
+
+//////////////////////////////////////////////////
+LogOpenOptions LogOpenOptions::WriteOptimized()
+{
+  LogOpenOptions options;
+  options.journalMode = "WAL";
+  options.synchronous = "NORMAL";
+  options.cacheSize = -65536;
+  options.pageSize = 32768;
+  options.deferTimeIndex = true;
+  return options;
+}
+
+//////////////////////////////////////////////////
+LogOpenOptions LogOpenOptions::ReadOptimized()
+{
+  LogOpenOptions options;
+  options.cacheSize = -65536;
+  // SQLite3 maps as much as its build allows, 2 GiB by default
+  options.mmapSize = int64_t(1) << 40;
+  options.busyTimeout = 1000;
+  return options;
+}
+
 //////////////////////////////////////////////////
 Log::Log()
   : dataPtr(new Implementation)
@@ -402,23 +1656,156 @@ Log::~Log()
   {
     this->dataPtr->EndTransaction();
   }
+
+  // Build the deferred index in bulk, now that all the messages are in
+  if (this->dataPtr && this->dataPtr->db && *(this->dataPtr->db))
+  {
+    this->dataPtr->CreateTimeIndex();
+  }
+
+  // Checkpoint the write-ahead log into the file, so that the log is a
+  // single file again and can be opened from a read-only location
+  if (this->dataPtr && this->dataPtr->restoreJournalMode &&
+      this->dataPtr->db && *(this->dataPtr->db))
+  {
+    this->dataPtr->insertStatement.reset();
+    this->dataPtr->insertBatchStatement.reset();
+    this->dataPtr->insertStatsStatement.reset();
+    this->dataPtr->updateStatsStatement.reset();
+    this->dataPtr->insertTypeStatement.reset();
+    this->dataPtr->insertTopicStatement.reset();
+    if (sqlite3_exec(this->dataPtr->db->Handle(),
+          "PRAGMA journal_mode = DELETE;", NULL, 0, nullptr) != SQLITE_OK)
+    {
+      LWRN("Failed to leave the WAL journal mode: " << sqlite3_errmsg(
+          this->dataPtr->db->Handle()) << "\n");
+    }
+  }
+
+  // Write the index now, even if a batch still refers to the log
+  if (this->dataPtr && this->dataPtr->chunked)
+  {
+    this->dataPtr->chunked->Close();
+  }
 }
 
 //////////////////////////////////////////////////
 bool Log::Valid() const
 {
-  return this->dataPtr && this->dataPtr->db && *(this->dataPtr->db);
+  return this->dataPtr && (this->dataPtr->chunked ||
+    !this->dataPtr->segments.empty() ||
+    (this->dataPtr->db && *(this->dataPtr->db)));
 }
 
 //////////////////////////////////////////////////
 bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode)
 {
-  // Open the SQLite3 database
-  if (this->dataPtr->db)
+  return this->Open(_file, _mode, LogOpenOptions());
+}
+
+//////////////////////////////////////////////////
+bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode,
+    const LogOpenOptions &_options)
+{
+  LogFormat format = LogFormat::SQLITE;
+  if (std::ios_base::out & _mode)
+  {
+    if (_file.size() > ChunkedLogExtension.size() &&
+        _file.compare(_file.size() - ChunkedLogExtension.size(),
+          ChunkedLogExtension.size(), ChunkedLogExtension) == 0)
+    {
+      format = LogFormat::CHUNKED;
+    }
+  }
+  else if (ChunkedLog::IsChunkedLog(_file))
+  {
+    format = LogFormat::CHUNKED;
+  }
+  else if (Manifest::IsShardManifest(_file))
+  {
+    format = LogFormat::SHARDED;
+  }
+  else if (Manifest::IsManifest(_file))
+  {
+    format = LogFormat::SEGMENTED;
+  }
+
+  return this->Open(_file, _mode, format, _options);
+}
+
+//////////////////////////////////////////////////
+bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode,
+    const LogFormat _format, const LogOpenOptions &_options)
+{
+  if (this->dataPtr->db || this->dataPtr->chunked ||
+      !this->dataPtr->segments.empty())
+  {
+    LERR("A database is already open\n");
+    return false;
+  }
+
+  if (_format == LogFormat::SEGMENTED || _format == LogFormat::SHARDED)
+  {
+    // The manifests are written by the Recorder, along with the segments
+    if (std::ios_base::out & _mode)
+    {
+      LERR("A log manifest can't be opened for writing\n");
+      return false;
+    }
+
+    std::vector<std::string> files;
+    if (!Manifest::Read(_file, files))
+    {
+      // Manifest::Read prints out the reason that the manifest failed to be
+      // read.
+      return false;
+    }
+
+    std::vector<std::unique_ptr<Log>> segments;
+    for (const std::string &file : files)
+    {
+      std::unique_ptr<Log> segment(new Log());
+      if (!segment->Open(file, _mode, _options) ||
+          segment->Format() == LogFormat::SEGMENTED ||
+          segment->Format() == LogFormat::SHARDED)
+      {
+        LERR("Failed to open segment [" << file << "] of [" << _file
+            << "]\n");
+        return false;
+      }
+      segments.push_back(std::move(segment));
+    }
+
+    this->dataPtr->segments = std::move(segments);
+    this->dataPtr->format = _format;
+    this->dataPtr->filename = _file;
+    return true;
+  }
+
+  if (_format == LogFormat::CHUNKED)
+  {
+    std::shared_ptr<ChunkedLog> chunked = std::make_shared<ChunkedLog>();
+    if (!chunked->Open(_file, _mode))
+    {
+      // ChunkedLog::Open prints out the reason that the log failed to open.
+      return false;
+    }
+
+    this->dataPtr->chunked = std::move(chunked);
+    this->dataPtr->format = _format;
+    this->dataPtr->filename = _file;
+    return true;
+  }
+
+  if ((std::ios_base::out & _mode) && !_options.compressedTopics.empty() &&
+      !BlobCodec::Available())
   {
-    LERR("A database is already open\n");
+    LERR("Topics can't be compressed, zlib was not available at build "
+        "time\n");
     return false;
   }
+
+  // Open the SQLite3 database
   int64_t modeSQL = SQLITE_OPEN_URI;
   if (std::ios_base::out & _mode)
   {
@@ -438,71 +1825,133 @@ bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode)
     return false;
   }
 
+  // The page size must be set before the schema creates the tables
+  if (!ApplyOpenOptions(*db, _options, (std::ios_base::out & _mode) != 0))
+  {
+    return false;
+  }
+
   // Don't need to create a schema if this is read only
+  bool created = false;
   if (std::ios_base::out & _mode)
   {
-    // Test hook so tests can be run before `make install`
-    std::string schemaFile;
-    const char *envPath = std::getenv(SchemaLocationEnvVar.c_str());
-    if (envPath)
+    // A log opened to read and write may exist already, it keeps its tables
+    bool exists = false;
+    if (std::ios_base::in & _mode)
     {
-      schemaFile = envPath;
+      raii_sqlite3::Statement statement(*db,
+        "SELECT 1 FROM sqlite_master WHERE type = 'table'"
+        " AND name = 'migrations';");
+      exists = statement && sqlite3_step(statement.Handle()) == SQLITE_ROW;
     }
-    else
-    {
-      schemaFile = SCHEMA_INSTALL_PATH;
-    }
-    schemaFile += "/0.1.0.sql";
 
-    // Assume the database is uninitialized; use the schema to initialize it
-    LDBG("Schema file: " << schemaFile << "\n");
-    std::ifstream fin(schemaFile, std::ifstream::in);
-    if (!fin)
+    if (!exists)
     {
-      LERR("Failed to open schema [" << schemaFile << "].\n"
-          << " Set " << SchemaLocationEnvVar << " to the schema location.\n");
-      return false;
-    }
+      // Assume the database is uninitialized; use the schema to initialize it
+      std::string schema;
+      if (!ReadSchemaFile("0.1.0.sql", schema))
+      {
+        return false;
+      }
 
-    // Read the schema file
-    std::string schema;
-    char buffer[4096];
-    while (fin)
-    {
-      fin.read(buffer, sizeof(buffer));
-      schema.insert(schema.size(), buffer, fin.gcount());
-    }
-    if (schema.empty())
-    {
-      LERR("Failed to read schema file [" << schemaFile << "]\n");
-      return false;
+      // Apply the schema to the database
+      int returnCode =
+        sqlite3_exec(db->Handle(), schema.c_str(), NULL, 0, NULL);
+      if (returnCode != SQLITE_OK)
+      {
+        LERR("Failed to open log: " << sqlite3_errmsg(db->Handle()) << "\n");
+        return false;
+      }
+      created = true;
     }
+  }
+
+  this->dataPtr->db = std::move(db);
 
-    // Apply the schema to the database
-    int returnCode = sqlite3_exec(db->Handle(), schema.c_str(), NULL, 0, NULL);
+  // Bring the schema of the logs opened for writing up to date
+  if ((std::ios_base::out & _mode) && !this->dataPtr->Migrate(this->Version()))
+  {
+    this->dataPtr->db.reset();
+    return false;
+  }
+
+  // The indexes are created again by CreateTimeIndex()
+  if (created && _options.deferTimeIndex)
+  {
+    const int returnCode = sqlite3_exec(this->dataPtr->db->Handle(),
+      "DROP INDEX idx_time_recv; DROP INDEX idx_topic_time_recv;",
+      NULL, 0, NULL);
     if (returnCode != SQLITE_OK)
     {
-      LERR("Failed to open log: " << sqlite3_errmsg(db->Handle()) << "\n");
+      LERR("Failed to defer the time index: "
+          << sqlite3_errmsg(this->dataPtr->db->Handle()) << "\n");
+      this->dataPtr->db.reset();
       return false;
     }
+    this->dataPtr->timeIndexPending = true;
   }
 
-  this->dataPtr->db = std::move(db);
-
-  // Check the schema version
-  // TODO(sloretz) handle multiple versions
+  // Check the schema version. The logs of older versions are read as they
+  // are, without the indexes added since.
   std::string version = this->Version();
-  if ("0.1.0" != this->Version())
+  bool supported = version == kSchemaVersion;
+  for (const SchemaMigration &migration : kMigrations)
+    supported = supported || version == migration.from;
+  if (!supported)
   {
     LERR("Log file Version '" << version << "' is unsupported by this tool\n");
     this->dataPtr->db.reset();
     return false;
   }
 
+  // The logs recorded by older versions don't have the topic statistics
+  {
+    raii_sqlite3::Statement statement(*(this->dataPtr->db),
+      "SELECT 1 FROM sqlite_master WHERE type = 'table'"
+      " AND name = 'topic_stats';");
+    this->dataPtr->hasStats =
+      statement && sqlite3_step(statement.Handle()) == SQLITE_ROW;
+  }
+  if (this->dataPtr->hasStats)
+  {
+    raii_sqlite3::Statement statement(*(this->dataPtr->db),
+      "SELECT total_bytes FROM topic_stats LIMIT 0;");
+    this->dataPtr->hasStatsBytes = static_cast<bool>(statement);
+  }
+  {
+    raii_sqlite3::Statement statement(*(this->dataPtr->db),
+      "SELECT time_header FROM messages LIMIT 0;");
+    this->dataPtr->hasHeaderTimes = static_cast<bool>(statement);
+  }
+  {
+    raii_sqlite3::Statement statement(*(this->dataPtr->db),
+      "SELECT 1 FROM sqlite_master WHERE type = 'index'"
+      " AND name = 'idx_topic_time_recv';");
+    this->dataPtr->hasTopicTimeIndex =
+      statement && sqlite3_step(statement.Handle()) == SQLITE_ROW;
+  }
+
+  if (!this->dataPtr->LoadCompressedTopics())
+  {
+    this->dataPtr->db.reset();
+    return false;
+  }
+  if (std::ios_base::out & _mode)
+    this->dataPtr->compressedTopics = _options.compressedTopics;
+
+  this->dataPtr->format = _format;
   this->dataPtr->filename = _file;
+  this->dataPtr->restoreJournalMode = (std::ios_base::out & _mode) &&
+    _options.journalMode == "WAL";
   return true;
 }
 
+//////////////////////////////////////////////////
+LogFormat Log::Format() const
+{
+  return this->dataPtr->format;
+}
+
 //////////////////////////////////////////////////
 const log::Descriptor *Log::Descriptor() const
 {
@@ -520,6 +1969,20 @@ bool Log::InsertMessage(
     return false;
   }
 
+  if (!this->dataPtr->segments.empty())
+  {
+    LERR("A segmented log is read only\n");
+    return false;
+  }
+
+  // Skip the empty messages like the SQLite3 logs do, see
+  // Implementation::InsertMessage.
+  if (this->dataPtr->chunked)
+  {
+    return _len > 0 &&
+      this->dataPtr->chunked->Insert(_time, _topic, _type, _data, _len);
+  }
+
   // Need to insert multiple messages pertransaction for best performance
   if (SQLITE_OK != this->dataPtr->BeginTransactionIfNotInOne())
   {
@@ -551,6 +2014,186 @@ bool Log::InsertMessage(
   return true;
 }
 
+//////////////////////////////////////////////////
+std::size_t Log::InsertMessages(const std::vector<MessageRecord> &_messages)
+{
+  if (!this->Valid())
+  {
+    return 0;
+  }
+
+  if (!this->dataPtr->segments.empty())
+  {
+    LERR("A segmented log is read only\n");
+    return 0;
+  }
+
+  if (this->dataPtr->chunked)
+  {
+    std::size_t inserted = 0;
+    for (const MessageRecord &msg : _messages)
+    {
+      if (msg.compressed)
+      {
+        LERR("A chunked log has no compressed topics\n");
+        continue;
+      }
+      if (msg.len > 0 && msg.topic && msg.type &&
+          this->dataPtr->chunked->Insert(
+            msg.time, *msg.topic, *msg.type, msg.data, msg.len))
+      {
+        ++inserted;
+      }
+    }
+    return inserted;
+  }
+
+  // All the messages go in the same transaction
+  if (SQLITE_OK != this->dataPtr->BeginTransactionIfNotInOne())
+  {
+    return 0;
+  }
+
+  // Get the topics.id of the messages. The empty messages are skipped, see
+  // Implementation::InsertMessage.
+  std::vector<std::pair<const MessageRecord *, int64_t>> rows;
+  rows.reserve(_messages.size());
+  for (const MessageRecord &msg : _messages)
+  {
+    if (msg.len == 0 || !msg.topic || !msg.type)
+      continue;
+
+    const int64_t topicId =
+      this->dataPtr->InsertOrGetTopicId(*msg.topic, *msg.type);
+    if (topicId < 0)
+      continue;
+
+    if (msg.compressed && !this->dataPtr->compressedIds.count(topicId))
+    {
+      LERR("Message of topic [" << *msg.topic << "] is compressed, but the "
+          "topic isn't compressed in the log\n");
+      continue;
+    }
+    rows.emplace_back(&msg, topicId);
+  }
+
+  const std::size_t inserted = this->dataPtr->InsertMessages(rows);
+
+  // Finish the transaction if enough time has passed
+  if (SQLITE_OK != this->dataPtr->EndTransactionIfEnoughTimeHasPassed())
+  {
+    // Something is really busted if this happens
+    LERR("Failed to end transcation: "<< sqlite3_errmsg(
+        this->dataPtr->db->Handle()) << "\n");
+  }
+
+  return inserted;
+}
+
+//////////////////////////////////////////////////
+int64_t Log::InsertLog(const std::string &_file,
+    const QualifiedTimeRange &_range)
+{
+  if (!this->Valid())
+  {
+    return -1;
+  }
+
+  if (_file == this->dataPtr->filename)
+  {
+    LERR("A log can't be inserted into itself\n");
+    return -1;
+  }
+
+  Log source;
+  if (!source.Open(_file))
+  {
+    LERR("Failed to open the log to insert [" << _file << "]\n");
+    return -1;
+  }
+
+  const bool bulk = !this->dataPtr->chunked &&
+    this->dataPtr->segments.empty() && !source.dataPtr->chunked &&
+    source.dataPtr->segments.empty();
+  if (bulk)
+  {
+    // The transaction of the copy can't be nested in the current one
+    if (this->dataPtr->inTransaction &&
+        SQLITE_OK != this->dataPtr->EndTransaction())
+    {
+      return -1;
+    }
+
+    raii_sqlite3::Statement attach(*(this->dataPtr->db),
+        "ATTACH DATABASE ?001 AS source;");
+    if (!attach)
+    {
+      LERR("Failed to compile statement to attach a log\n");
+      return -1;
+    }
+    sqlite3_bind_text(attach.Handle(), 1, _file.c_str(), _file.size(),
+        nullptr);
+    if (sqlite3_step(attach.Handle()) != SQLITE_DONE)
+    {
+      LERR("Failed to attach [" << _file << "]: " << sqlite3_errmsg(
+          this->dataPtr->db->Handle()) << "\n");
+      return -1;
+    }
+
+    const int64_t copied = this->dataPtr->CopyAttachedLog(_range);
+    ExecuteSql(*(this->dataPtr->db),
+        "DROP TABLE IF EXISTS temp.topic_map;"
+        "DROP TABLE IF EXISTS temp.new_stats;"
+        "DETACH DATABASE source;");
+
+    // The copy added topics and messages behind the caches
+    this->dataPtr->needNewDescriptor = true;
+    this->dataPtr->startTime = std::chrono::nanoseconds(-1);
+    this->dataPtr->endTime = std::chrono::nanoseconds(-1);
+    this->dataPtr->seekIndexStride = 0;
+    if (!this->dataPtr->LoadCompressedTopics())
+      return -1;
+    return copied;
+  }
+
+  // Read the messages and insert them in batches. The records refer to the
+  // copies of the messages, which are decompressed by the query.
+  struct Copy
+  {
+    std::chrono::nanoseconds time;
+    std::string topic;
+    std::string type;
+    std::string data;
+  };
+  const std::size_t batchSize = 1024;
+  std::vector<Copy> copies;
+  copies.reserve(batchSize);
+  std::vector<MessageRecord> records;
+  records.reserve(batchSize);
+  int64_t inserted = 0;
+  auto flush = [&]()
+  {
+    records.clear();
+    for (const Copy &copy : copies)
+    {
+      records.push_back(MessageRecord{copy.time, &copy.topic, &copy.type,
+          copy.data.data(), copy.data.size()});
+    }
+    inserted += this->InsertMessages(records);
+    copies.clear();
+  };
+
+  for (const Message &msg : source.QueryMessages(AllTopics(_range)))
+  {
+    copies.push_back(Copy{msg.TimeReceived(), msg.Topic(), msg.Type(),
+        msg.Data()});
+    if (copies.size() == batchSize)
+      flush();
+  }
+  flush();
+  return inserted;
+}
+
 //////////////////////////////////////////////////
 Batch Log::QueryMessages(const QueryOptions &_options)
 {
@@ -561,16 +2204,188 @@ Batch Log::QueryMessages(const QueryOptions &_options)
   if (!desc)
     return Batch();
 
+  if (this->dataPtr->chunked)
+  {
+    ChunkedQuery query;
+    if (!ChunkedQueryFromOptions(_options, *desc, query))
+      return Batch();
+
+    std::unique_ptr<BatchPrivate> batchPriv(
+          new BatchPrivate(this->dataPtr->chunked, std::move(query)));
+    return Batch(std::move(batchPriv));
+  }
+
+  // The segments were recorded one after the other, so their messages are
+  // in order once the segments are concatenated. The shards were recorded
+  // at the same time, their messages are merged.
+  if (!this->dataPtr->segments.empty())
+  {
+    std::vector<Batch> batches;
+    batches.reserve(this->dataPtr->segments.size());
+    for (const std::unique_ptr<Log> &segment : this->dataPtr->segments)
+      batches.push_back(segment->QueryMessages(_options));
+
+    std::unique_ptr<BatchPrivate> batchPriv(
+          new BatchPrivate(std::move(batches),
+            this->dataPtr->format == LogFormat::SHARDED));
+    return Batch(std::move(batchPriv));
+  }
+
+  const auto *time = dynamic_cast<const TimeRangeOption *>(&_options);
+  if (time && !this->dataPtr->hasHeaderTimes &&
+      time->GetTimeReference() == TimeRangeOption::TimeReference::HEADER)
+  {
+    LERR("The log has no header times, it was recorded by an older "
+         "version\n");
+    return Batch();
+  }
+
+  // The queries are sorted by time received, so they need the index. The
+  // messages inserted afterwards update it one by one.
+  this->dataPtr->CreateTimeIndex();
+
+  // Rather than one scan sorted by time of all the selected topics, read
+  // each topic in order through its index and merge them
+  std::vector<SqlStatement> perTopic;
+  if (this->dataPtr->hasTopicTimeIndex &&
+      PerTopicStatements(_options, *desc, perTopic))
+  {
+    std::unique_ptr<BatchPrivate> batchPriv(
+          new BatchPrivate(this->dataPtr->db, std::move(perTopic), true));
+    batchPriv->dictionaries = this->dataPtr->dictionaries;
+    batchPriv->topicNames = desc->dataPtr->topicNames;
+    return Batch(std::move(batchPriv));
+  }
+
   std::unique_ptr<BatchPrivate> batchPriv(
         new BatchPrivate(this->dataPtr->db,
                          _options.GenerateStatements(*desc)));
+  batchPriv->dictionaries = this->dataPtr->dictionaries;
+  batchPriv->topicNames = desc->dataPtr->topicNames;
+
+  return Batch(std::move(batchPriv));
+}
+
+//////////////////////////////////////////////////
+Batch Log::FollowMessages(const QueryOptions &_options)
+{
+  if (this->dataPtr->chunked || !this->dataPtr->segments.empty())
+  {
+    LERR("Only the SQLite3 logs can be followed\n");
+    return Batch();
+  }
+
+  if (!this->dataPtr->db)
+    return Batch();
+
+  // The messages get increasing ids as they're inserted, and each
+  // transaction of the Recorder commits all of its messages at once, so the
+  // messages up to the highest id are all readable.
+  sqlite_int64 lastMessage = 0;
+  sqlite_int64 lastTopic = 0;
+  {
+    raii_sqlite3::Statement statement(*(this->dataPtr->db),
+      "SELECT (SELECT MAX(id) FROM messages), (SELECT MAX(id) FROM topics);");
+    if (!statement || sqlite3_step(statement.Handle()) != SQLITE_ROW)
+    {
+      LERR("Failed to get the last message: " << sqlite3_errmsg(
+          this->dataPtr->db->Handle()) << "\n");
+      return Batch();
+    }
+    lastMessage = sqlite3_column_int64(statement.Handle(), 0);
+    lastTopic = sqlite3_column_int64(statement.Handle(), 1);
+  }
+
+  // The recording keeps adding topics and extending the time range
+  if (lastTopic != this->dataPtr->followedTopic)
+  {
+    this->dataPtr->followedTopic = lastTopic;
+    this->dataPtr->needNewDescriptor = true;
+    if (!this->dataPtr->LoadCompressedTopics())
+      return Batch();
+  }
+  if (lastMessage != this->dataPtr->followedMessage)
+  {
+    this->dataPtr->startTime = std::chrono::nanoseconds(-1);
+    this->dataPtr->endTime = std::chrono::nanoseconds(-1);
+    this->dataPtr->seekIndexStride = 0;
+  }
+
+  const log::Descriptor *desc = this->Descriptor();
+  ChunkedQuery query;
+  if (!desc || !ChunkedQueryFromOptions(_options, *desc, query))
+    return Batch();
+
+  if (query.period != 0)
+  {
+    LERR("Downsampled topics can't be followed\n");
+    return Batch();
+  }
 
+  const sqlite_int64 firstMessage = this->dataPtr->followedMessage;
+  this->dataPtr->followedMessage = lastMessage;
+  if (query.topics.empty() || lastMessage == firstMessage)
+    return Batch();
+
+  // Read the new messages through the primary key, in the order they were
+  // inserted, which doesn't need the time index
+  SqlStatement sql = QueryOptions::StandardMessageQueryPreamble();
+  sql.statement += " WHERE messages.id > ? AND messages.id <= ?";
+  sql.parameters.emplace_back(static_cast<int64_t>(firstMessage));
+  sql.parameters.emplace_back(static_cast<int64_t>(lastMessage));
+
+  sql.statement += " AND messages.topic_id IN (";
+  for (const int64_t id : query.topics)
+  {
+    sql.statement += sql.parameters.size() == 2 ? "?" : ", ?";
+    sql.parameters.emplace_back(id);
+  }
+  sql.statement += ")";
+
+  const SqlStatement timeCondition =
+    dynamic_cast<const TimeRangeOption &>(_options).GenerateTimeConditions();
+  if (!timeCondition.statement.empty())
+  {
+    sql.statement += " AND (";
+    sql.Append(timeCondition);
+    sql.statement += ")";
+  }
+  sql.statement += " ORDER BY messages.id;";
+
+  std::vector<SqlStatement> statements;
+  statements.push_back(std::move(sql));
+  std::unique_ptr<BatchPrivate> batchPriv(
+        new BatchPrivate(this->dataPtr->db, std::move(statements)));
+  batchPriv->dictionaries = this->dataPtr->dictionaries;
+  batchPriv->topicNames = desc->dataPtr->topicNames;
   return Batch(std::move(batchPriv));
 }
 
 //////////////////////////////////////////////////
 std::chrono::nanoseconds Log::StartTime() const
 {
+  // The chunked logs keep their time ranges in memory
+  if (this->Valid() && this->dataPtr->chunked)
+    return this->dataPtr->chunked->StartTime();
+
+  // The first segment starts the log, or the first shard with messages
+  if (this->dataPtr->format == LogFormat::SHARDED)
+  {
+    std::chrono::nanoseconds startTime = std::chrono::nanoseconds::zero();
+    bool found = false;
+    for (const std::unique_ptr<Log> &segment : this->dataPtr->segments)
+    {
+      if (segment->TopicSummaries().empty())
+        continue;
+      if (!found || segment->StartTime() < startTime)
+        startTime = segment->StartTime();
+      found = true;
+    }
+    return startTime;
+  }
+  if (!this->dataPtr->segments.empty())
+    return this->dataPtr->segments.front()->StartTime();
+
   // Short circuit if we already looked up the start time once.
   if (this->dataPtr->startTime >= std::chrono::nanoseconds::zero())
     return this->dataPtr->startTime;
@@ -583,8 +2398,14 @@ std::chrono::nanoseconds Log::StartTime() const
     return this->dataPtr->startTime;
   }
 
+  // The statistics of the topics hold the time range without reading the
+  // messages
+  if (this->dataPtr->hasStats)
+    this->dataPtr->FlushStats();
+
   // Compile the statement
-  const char* const getStartTimeStatement =
+  const char* const getStartTimeStatement = this->dataPtr->hasStats ?
+      "SELECT MIN(start_time) AS start_time FROM topic_stats;" :
       "SELECT MIN(time_recv) AS start_time FROM messages;";
   raii_sqlite3::Statement statement(*(this->dataPtr->db),
                                     getStartTimeStatement);
@@ -615,6 +2436,17 @@ std::chrono::nanoseconds Log::StartTime() const
 //////////////////////////////////////////////////
 std::chrono::nanoseconds Log::EndTime() const
 {
+  if (this->Valid() && this->dataPtr->chunked)
+    return this->dataPtr->chunked->EndTime();
+
+  if (!this->dataPtr->segments.empty())
+  {
+    std::chrono::nanoseconds endTime = std::chrono::nanoseconds::zero();
+    for (const std::unique_ptr<Log> &segment : this->dataPtr->segments)
+      endTime = std::max(endTime, segment->EndTime());
+    return endTime;
+  }
+
   // Short circuit if we already looked up the end time once.
   if (this->dataPtr->endTime >= std::chrono::nanoseconds::zero())
     return this->dataPtr->endTime;
@@ -627,8 +2459,12 @@ std::chrono::nanoseconds Log::EndTime() const
     return this->dataPtr->endTime;
   }
 
+  if (this->dataPtr->hasStats)
+    this->dataPtr->FlushStats();
+
   // Compile the statement
-  const char* const getEndTimeStatement =
+  const char* const getEndTimeStatement = this->dataPtr->hasStats ?
+      "SELECT MAX(end_time) AS end_time FROM topic_stats;" :
       "SELECT MAX(time_recv) AS end_time FROM messages;";
   raii_sqlite3::Statement statement(*(this->dataPtr->db),
                                     getEndTimeStatement);
@@ -647,23 +2483,11 @@ std::chrono::nanoseconds Log::EndTime() const
     LERR("Database is corrupt, retrieving last valid message." \
          "Playback may fail or be truncated.");
 
-    // If the database is corrupt, then we need to iterate over the valid
-    // messages until we get the to corrupt statement. The timestamp
-    // of the last valid message is returned.
-    const char* const getAllTimesStatement =
-      "SELECT time_recv AS end_time FROM messages;";
-    raii_sqlite3::Statement statementAll(*(this->dataPtr->db),
-        getAllTimesStatement);
-
-    if (!statementAll)
-    {
-      LERR("Failed to compile end time all query statement\n");
-      return this->dataPtr->endTime;
-    }
-
-    // Iterate until we get to the corrupt line.
-    while (sqlite3_step(statementAll.Handle()) != SQLITE_CORRUPT)
-      endTimeAsInt = sqlite3_column_int64(statementAll.Handle(), 0);
+    // If the database is corrupt, the timestamp of the last message that
+    // can be read is returned.
+    std::chrono::nanoseconds lastTime;
+    if (this->dataPtr->LastReadableTime(lastTime))
+      endTimeAsInt = lastTime.count();
   }
   else if (resultCode != SQLITE_ROW)
   {
@@ -680,6 +2504,151 @@ std::chrono::nanoseconds Log::EndTime() const
   return this->dataPtr->endTime;
 }
 
+//////////////////////////////////////////////////
+std::vector<TopicSummary> Log::TopicSummaries() const
+{
+  std::vector<TopicSummary> summaries;
+  if (!this->Valid())
+    return summaries;
+
+  if (this->dataPtr->db)
+  {
+    if (!this->dataPtr->QuerySummaries(summaries))
+      summaries.clear();
+    return summaries;
+  }
+
+  // The chunks only index their topics, so the messages are counted. The
+  // summaries of the segments are merged.
+  std::map<std::pair<std::string, std::string>, TopicSummary> merged;
+  auto add = [&merged](const TopicSummary &_summary)
+  {
+    TopicSummary &entry = merged[{_summary.topic, _summary.type}];
+    if (entry.messageCount == 0)
+    {
+      entry = _summary;
+      return;
+    }
+    entry.messageCount += _summary.messageCount;
+    entry.totalBytes += _summary.totalBytes;
+    entry.startTime = std::min(entry.startTime, _summary.startTime);
+    entry.endTime = std::max(entry.endTime, _summary.endTime);
+  };
+
+  if (this->dataPtr->chunked)
+  {
+    ChunkedQuery query;
+    for (const auto &topic : this->dataPtr->chunked->Topics())
+      query.topics.insert(topic.second);
+
+    std::unique_ptr<ChunkedLogCursor> cursor =
+      this->dataPtr->chunked->Query(query);
+    std::unique_ptr<Message> message;
+    while (cursor && cursor->Next(message))
+    {
+      TopicSummary summary;
+      summary.topic = message->Topic();
+      summary.type = message->Type();
+      summary.messageCount = 1;
+      summary.totalBytes = message->Data().size();
+      summary.startTime = message->TimeReceived();
+      summary.endTime = message->TimeReceived();
+      add(summary);
+    }
+  }
+
+  for (const std::unique_ptr<Log> &segment : this->dataPtr->segments)
+  {
+    for (const TopicSummary &summary : segment->TopicSummaries())
+      add(summary);
+  }
+
+  for (auto &entry : merged)
+    summaries.push_back(std::move(entry.second));
+  return summaries;
+}
+
+//////////////////////////////////////////////////
+LogSummary Log::Summary() const
+{
+  LogSummary summary;
+  summary.topics = this->TopicSummaries();
+  for (const TopicSummary &topic : summary.topics)
+  {
+    if (summary.messageCount == 0 || topic.startTime < summary.startTime)
+      summary.startTime = topic.startTime;
+    if (summary.messageCount == 0 || topic.endTime > summary.endTime)
+      summary.endTime = topic.endTime;
+    summary.messageCount += topic.messageCount;
+    summary.totalBytes += topic.totalBytes;
+  }
+  return summary;
+}
+
+//////////////////////////////////////////////////
+std::vector<std::chrono::nanoseconds> Log::SeekIndex(
+    const std::size_t _stride) const
+{
+  std::vector<std::chrono::nanoseconds> index;
+  if (!this->Valid() || _stride == 0 || this->dataPtr->chunked)
+    return index;
+
+  // The windows of the segments are merged
+  if (!this->dataPtr->segments.empty())
+  {
+    for (const std::unique_ptr<Log> &segment : this->dataPtr->segments)
+    {
+      const std::vector<std::chrono::nanoseconds> times =
+        segment->SeekIndex(_stride);
+      index.insert(index.end(), times.begin(), times.end());
+    }
+    std::sort(index.begin(), index.end());
+    index.erase(std::unique(index.begin(), index.end()), index.end());
+    return index;
+  }
+
+  // Short circuit if we already built the index once.
+  if (this->dataPtr->seekIndexStride == _stride)
+    return this->dataPtr->seekIndex;
+
+  // Only the time index is read, not the messages
+  raii_sqlite3::Statement statement(*(this->dataPtr->db),
+    "SELECT time_recv FROM messages ORDER BY time_recv;");
+  if (!statement)
+  {
+    LERR("Failed to compile seek index query statement\n");
+    return index;
+  }
+
+  std::size_t count = 0;
+  int returnCode;
+  while ((returnCode = sqlite3_step(statement.Handle())) == SQLITE_ROW)
+  {
+    // The first window starts from the beginning
+    const std::size_t row = count++;
+    if (row == 0 || row % _stride != 0)
+      continue;
+
+    const std::chrono::nanoseconds time(
+      sqlite3_column_int64(statement.Handle(), 0));
+    // Messages received at the same time stay in the same window
+    if (index.empty() || index.back() < time)
+      index.push_back(time);
+  }
+
+  if (returnCode != SQLITE_DONE)
+  {
+    LERR("Failed to build the seek index: "
+         << sqlite3_errmsg(this->dataPtr->db->Handle()) << "\n");
+    index.clear();
+    return index;
+  }
+
+  this->dataPtr->seekIndex = index;
+  this->dataPtr->seekIndexStride = _stride;
+  return index;
+}
+
 //////////////////////////////////////////////////
 std::string Log::Version() const
 {
@@ -688,6 +2657,13 @@ std::string Log::Version() const
     return "";
   }
 
+  if (this->dataPtr->chunked)
+    return ChunkedLog::Version();
+
+  // The version of the format of the segments
+  if (!this->dataPtr->segments.empty())
+    return this->dataPtr->segments.front()->Version();
+
   // Compile the statement
   const char *get_version =
     "SELECT to_version FROM migrations ORDER BY id DESC LIMIT 1;";
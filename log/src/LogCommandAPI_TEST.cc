@@ -32,6 +32,14 @@ TEST(LogCommandAPI, RecordBadRegex)
   EXPECT_EQ(BAD_REGEX, recordTopics(":memory:", "*"));
 }
 
+//////////////////////////////////////////////////
+TEST(LogCommandAPI, RecordBadProfile)
+{
+  EXPECT_EQ(INVALID_PROFILE,
+    recordTopicsWithProfile(":memory:", ".*", "fastest"));
+  EXPECT_EQ(BAD_REGEX, recordTopicsWithProfile(":memory:", "*", "write"));
+}
+
 //////////////////////////////////////////////////
 TEST(LogCommandAPI, PlaybackBadRegex)
 {
@@ -15,10 +15,21 @@
  *
 */
 
+#include <sqlite3.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <ios>
+#include <regex>
+#include <set>
 #include <string>
+#include <thread>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "ignition/transport/log/Log.hh"
 #include "ignition/transport/test_config.h"
@@ -231,13 +242,200 @@ TEST(Log, CheckLogTimes)
   EXPECT_EQ(10s, logFile.EndTime());
 }
 
+//////////////////////////////////////////////////
+TEST(Log, InsertMessages)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  // Enough messages for the statements inserting several rows and the ones
+  // inserting a single row.
+  const std::string topic1("/some/topic/name");
+  const std::string topic2("/another/topic/name");
+  const std::string type("some.message.type");
+  const std::string empty;
+  std::vector<std::string> data;
+  for (int i = 0; i < 150; ++i)
+    data.push_back("data_" + std::to_string(i));
+
+  std::vector<log::MessageRecord> records;
+  for (std::size_t i = 0; i < data.size(); ++i)
+  {
+    records.push_back({std::chrono::seconds(i + 1),
+      i % 2 ? &topic2 : &topic1, &type, data[i].data(), data[i].size()});
+  }
+
+  // Empty messages are skipped.
+  records.push_back({200s, &topic1, &type, empty.data(), 0});
+
+  EXPECT_EQ(data.size(), logFile.InsertMessages(records));
+  EXPECT_EQ(0u, logFile.InsertMessages({}));
+
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(150s, logFile.EndTime());
+
+  std::size_t count = 0;
+  for (const log::Message &msg : logFile.QueryMessages())
+  {
+    ASSERT_LT(count, data.size());
+    EXPECT_EQ(data[count], msg.Data());
+    EXPECT_EQ(count % 2 ? topic2 : topic1, msg.Topic());
+    EXPECT_EQ(type, msg.Type());
+    ++count;
+  }
+  EXPECT_EQ(data.size(), count);
+
+  // The single inserts share the cached statements.
+  EXPECT_TRUE(logFile.InsertMessage(300s, topic1, type,
+    data[0].data(), data[0].size()));
+  EXPECT_EQ(300s, logFile.EndTime());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, InsertManyTopics)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  // Each new topic is added to the descriptor
+  const std::string data("data");
+  for (int i = 0; i < 1000; ++i)
+  {
+    EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+      "/topic_" + std::to_string(i), i % 2 ? "some.type" : "another.type",
+      data.data(), data.size()));
+  }
+
+  const log::Descriptor *desc = logFile.Descriptor();
+  ASSERT_NE(nullptr, desc);
+  EXPECT_EQ(1000u, desc->TopicsToMsgTypesToId().size());
+  EXPECT_EQ(2u, desc->MsgTypesToTopicsToId().size());
+  EXPECT_EQ(500u, desc->MsgTypesToTopicsToId().at("some.type").size());
+  EXPECT_EQ(2, desc->TopicId("/topic_1", "some.type"));
+  EXPECT_EQ(-1, desc->TopicId("/topic_1", "another.type"));
+
+  std::size_t count = 0;
+  for (const log::Message &msg : logFile.QueryMessages(
+         log::TopicList("/topic_999")))
+  {
+    EXPECT_EQ("some.type", msg.Type());
+    ++count;
+  }
+  EXPECT_EQ(1u, count);
+}
+
+//////////////////////////////////////////////////
+TEST(Log, InsertMessagesUnopenedLog)
+{
+  log::Log logFile;
+  const std::string topic("/foo/bar");
+  const std::string type(".fiz.buz");
+  char data[] = {1, 2, 3, 4};
+  EXPECT_EQ(0u, logFile.InsertMessages({{0ns, &topic, &type, data, 4}}));
+}
 
 //////////////////////////////////////////////////
 TEST(Log, CheckVersion)
 {
   log::Log logFile;
   ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
-  EXPECT_EQ("0.1.0", logFile.Version());
+  EXPECT_EQ("0.1.4", logFile.Version());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, ReopenToAddMessages)
+{
+  const std::string path = "Log_TEST_reopen.tlog";
+  std::remove(path.c_str());
+
+  std::string data1("first_data");
+  std::string data2("second_data");
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out));
+    EXPECT_TRUE(logFile.InsertMessage(2s, "/some/topic/name",
+      "some.message.type", data2.c_str(), data2.size()));
+  }
+
+  // The log is already at the latest version, it keeps its messages
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::in | std::ios_base::out));
+    EXPECT_EQ("0.1.4", logFile.Version());
+    EXPECT_TRUE(logFile.InsertMessage(1s, "/some/topic/name",
+      "some.message.type", data1.c_str(), data1.size()));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  std::vector<std::string> result;
+  for (const log::Message &msg :
+       logFile.QueryMessages(log::TopicList("/some/topic/name")))
+  {
+    result.push_back(msg.Data());
+  }
+  EXPECT_EQ((std::vector<std::string>{data1, data2}), result);
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, MigrateOriginalSchema)
+{
+  const std::string path = "Log_TEST_original.tlog";
+  std::remove(path.c_str());
+
+  // A log recorded with the original schema, before any migration
+  {
+    const char *sqlPath = std::getenv(log::SchemaLocationEnvVar.c_str());
+    ASSERT_NE(nullptr, sqlPath);
+    std::ifstream fin(std::string(sqlPath) + "/0.1.0.sql");
+    ASSERT_TRUE(fin.good());
+    std::string sql((std::istreambuf_iterator<char>(fin)),
+      std::istreambuf_iterator<char>());
+    sql +=
+      "INSERT INTO message_types (id, name) VALUES (1, 'some.message.type');"
+      "INSERT INTO topics (id, name, message_type_id)"
+      "  VALUES (1, '/some/topic/name', 1);"
+      "INSERT INTO messages (time_recv, topic_id, message)"
+      "  VALUES (1000000000, 1, 'first_data'), (2000000000, 1, 'second')";
+
+    sqlite3 *db = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(path.c_str(), &db));
+    EXPECT_EQ(SQLITE_OK, sqlite3_exec(db, sql.c_str(), NULL, 0, NULL));
+    sqlite3_close(db);
+  }
+
+  // Older logs are read as they are
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path));
+    EXPECT_EQ("0.1.0", logFile.Version());
+    EXPECT_EQ(1s, logFile.StartTime());
+    EXPECT_EQ(2s, logFile.EndTime());
+  }
+
+  // The log is migrated to add to it, its statistics include the messages
+  // recorded before
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::in | std::ios_base::out));
+    EXPECT_EQ("0.1.4", logFile.Version());
+    EXPECT_TRUE(logFile.InsertMessage(3s, "/some/topic/name",
+      "some.message.type", "third", 5));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  EXPECT_EQ("0.1.4", logFile.Version());
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(3s, logFile.EndTime());
+
+  std::vector<std::string> result;
+  for (const log::Message &msg : logFile.QueryMessages())
+    result.push_back(msg.Data());
+  EXPECT_EQ((std::vector<std::string>{"first_data", "second", "third"}),
+    result);
+  std::remove(path.c_str());
 }
 
 //////////////////////////////////////////////////
@@ -247,6 +445,782 @@ TEST(Log, NullDescriptorUnopenedLog)
   EXPECT_EQ(nullptr, logFile.Descriptor());
 }
 
+//////////////////////////////////////////////////
+TEST(Log, OpenWithProfiles)
+{
+  const std::string path = "Log_TEST_profiles.tlog";
+  std::remove(path.c_str());
+
+  std::string data("Hello World");
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out,
+      log::LogOpenOptions::WriteOptimized()));
+    EXPECT_TRUE(logFile.InsertMessage(1s, "/some/topic/name",
+      "some.message.type", data.c_str(), data.size()));
+  }
+
+  // The write-ahead log is merged back into the file when it's closed
+  EXPECT_FALSE(std::ifstream(path + "-wal"));
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path, std::ios_base::in,
+    log::LogOpenOptions::ReadOptimized()));
+  auto batch = logFile.QueryMessages();
+  auto iter = batch.begin();
+  ASSERT_NE(batch.end(), iter);
+  EXPECT_EQ(data, iter->Data());
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, DeferredTimeIndex)
+{
+  const std::string path = "Log_TEST_deferred.tlog";
+  std::remove(path.c_str());
+
+  log::LogOpenOptions options;
+  options.deferTimeIndex = true;
+
+  std::string data1("first_data");
+  std::string data2("second_data");
+  std::string data3("third_data");
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out, options));
+    EXPECT_TRUE(logFile.InsertMessage(2s, "/some/topic/name",
+      "some.message.type", data2.c_str(), data2.size()));
+    EXPECT_TRUE(logFile.InsertMessage(1s, "/some/topic/name",
+      "some.message.type", data1.c_str(), data1.size()));
+
+    // The first query builds the index
+    auto batch = logFile.QueryMessages();
+    auto iter = batch.begin();
+    ASSERT_NE(batch.end(), iter);
+    EXPECT_EQ(data1, iter->Data());
+
+    EXPECT_TRUE(logFile.InsertMessage(3s, "/some/topic/name",
+      "some.message.type", data3.c_str(), data3.size()));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(3s, logFile.EndTime());
+
+  std::vector<std::string> result;
+  for (const log::Message &msg : logFile.QueryMessages())
+    result.push_back(msg.Data());
+  EXPECT_EQ((std::vector<std::string>{data1, data2, data3}), result);
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, QueryMessagesOfSeveralTopics)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  // Out of order, and two messages at the same time on different topics
+  const std::vector<std::pair<std::chrono::nanoseconds, std::string>> msgs =
+  {
+    {3s, "/foo"}, {1s, "/bar"}, {2s, "/foo"}, {2s, "/baz"}, {4s, "/bar"},
+    {2s, "/bar"}, {5s, "/baz"}, {6s, "/qux"}
+  };
+  for (std::size_t i = 0; i < msgs.size(); ++i)
+  {
+    const std::string data = std::to_string(i);
+    EXPECT_TRUE(logFile.InsertMessage(msgs[i].first, msgs[i].second,
+      "some.message.type", data.c_str(), data.size()));
+  }
+
+  auto Data = [](log::Batch _batch)
+  {
+    std::vector<std::string> result;
+    for (const log::Message &msg : _batch)
+      result.push_back(msg.Topic() + "@" + msg.Data());
+    return result;
+  };
+
+  // The messages received at the same time are in order of insertion
+  EXPECT_EQ((std::vector<std::string>{"/bar@1", "/foo@2", "/baz@3", "/bar@5",
+    "/foo@0", "/bar@4", "/baz@6"}),
+    Data(logFile.QueryMessages(log::TopicList::Create(
+      std::vector<std::string>{"/foo", "/bar", "/baz", "/nope"}))));
+
+  EXPECT_EQ((std::vector<std::string>{"/baz@3", "/bar@5", "/bar@4"}),
+    Data(logFile.QueryMessages(log::TopicPattern(std::regex("/ba."),
+      log::QualifiedTimeRange(2s, 4s)))));
+
+  const log::QualifiedTimeRange range = log::QualifiedTimeRange::From(
+    log::QualifiedTime(2s, log::QualifiedTime::Qualifier::EXCLUSIVE));
+  EXPECT_EQ((std::vector<std::string>{"/foo@0", "/bar@4", "/qux@7"}),
+    Data(logFile.QueryMessages(log::TopicList::Create(
+      std::vector<std::string>{"/foo", "/bar", "/qux"}, range))));
+
+  EXPECT_TRUE(Data(logFile.QueryMessages(log::TopicList::Create(
+    std::vector<std::string>{"/foo", "/bar"},
+    log::QualifiedTimeRange(7s, 8s)))).empty());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, QueryDownsampledTopics)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  // A message every 10 ms on /foo, and on /bar 5 ms later
+  for (int i = 0; i <= 10; ++i)
+  {
+    const std::chrono::milliseconds time(10 * i);
+    const std::string data = std::to_string(time.count());
+    EXPECT_TRUE(logFile.InsertMessage(time, "/foo", "some.message.type",
+      data.c_str(), data.size()));
+    EXPECT_TRUE(logFile.InsertMessage(time + 5ms, "/bar", "some.message.type",
+      data.c_str(), data.size()));
+    EXPECT_TRUE(logFile.InsertMessage(time, "/baz", "some.message.type",
+      data.c_str(), data.size()));
+  }
+
+  auto Data = [](log::Batch _batch)
+  {
+    std::vector<std::string> result;
+    for (const log::Message &msg : _batch)
+      result.push_back(msg.Topic() + "@" + msg.Data());
+    return result;
+  };
+
+  EXPECT_EQ((std::vector<std::string>{"/foo@0", "/bar@0", "/foo@30",
+    "/bar@30", "/foo@60", "/bar@60", "/foo@90", "/bar@90"}),
+    Data(logFile.QueryMessages(log::DownsampledTopics(
+      {"/foo", "/bar", "/nope"}, 25ms))));
+
+  EXPECT_EQ((std::vector<std::string>{"/foo@20", "/foo@50", "/foo@80"}),
+    Data(logFile.QueryMessages(log::DownsampledTopics({"/foo"}, 30ms,
+      log::QualifiedTimeRange(20ms, 100ms)))));
+
+  // Without a period, every message is selected
+  EXPECT_EQ(11u, Data(logFile.QueryMessages(
+    log::DownsampledTopics({"/baz"}, 0ms))).size());
+
+  EXPECT_TRUE(Data(logFile.QueryMessages(
+    log::DownsampledTopics({"/nope"}, 10ms))).empty());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, TopicSummaries)
+{
+  const std::string path = "Log_TEST_summaries.tlog";
+  std::remove(path.c_str());
+
+  const std::string topic = "/some/topic/name";
+  const std::string type = "some.message.type";
+  const std::string data("some_data");
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out));
+    EXPECT_TRUE(logFile.TopicSummaries().empty());
+
+    EXPECT_TRUE(logFile.InsertMessage(2s, topic, type, data.c_str(),
+      data.size()));
+    std::vector<log::MessageRecord> records;
+    records.push_back({1s, &topic, &type, data.c_str(), data.size()});
+    records.push_back({5s, &topic, &type, data.c_str(), data.size()});
+    EXPECT_EQ(2u, logFile.InsertMessages(records));
+
+    // The statistics are up to date while writing
+    const std::vector<log::TopicSummary> summaries = logFile.TopicSummaries();
+    ASSERT_EQ(1u, summaries.size());
+    EXPECT_EQ(3u, summaries[0].messageCount);
+    EXPECT_EQ(5s, logFile.EndTime());
+
+    EXPECT_TRUE(logFile.InsertMessage(7s, "/other/topic", type, data.c_str(),
+      data.size()));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(7s, logFile.EndTime());
+
+  std::vector<log::TopicSummary> summaries = logFile.TopicSummaries();
+  ASSERT_EQ(2u, summaries.size());
+  if (summaries[0].topic != topic)
+    std::swap(summaries[0], summaries[1]);
+  EXPECT_EQ(topic, summaries[0].topic);
+  EXPECT_EQ(type, summaries[0].type);
+  EXPECT_EQ(3u, summaries[0].messageCount);
+  EXPECT_EQ(1s, summaries[0].startTime);
+  EXPECT_EQ(5s, summaries[0].endTime);
+  EXPECT_EQ("/other/topic", summaries[1].topic);
+  EXPECT_EQ(1u, summaries[1].messageCount);
+  EXPECT_EQ(7s, summaries[1].startTime);
+  EXPECT_EQ(7s, summaries[1].endTime);
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, Summary)
+{
+  const std::string path = "Log_TEST_summary.tlog";
+  std::remove(path.c_str());
+
+  const std::string type = "some.message.type";
+  const std::string data("some_data");
+  const std::string longData(100, 'x');
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out));
+    const log::LogSummary empty = logFile.Summary();
+    EXPECT_TRUE(empty.topics.empty());
+    EXPECT_EQ(0u, empty.messageCount);
+    EXPECT_EQ(0u, empty.totalBytes);
+
+    EXPECT_TRUE(logFile.InsertMessage(2s, "/foo", type, data.c_str(),
+      data.size()));
+    EXPECT_TRUE(logFile.InsertMessage(3s, "/foo", type, data.c_str(),
+      data.size()));
+    EXPECT_TRUE(logFile.InsertMessage(6s, "/bar", type, longData.c_str(),
+      longData.size()));
+
+    // The sizes are up to date while writing
+    EXPECT_EQ(2 * data.size() + longData.size(),
+      logFile.Summary().totalBytes);
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  const log::LogSummary summary = logFile.Summary();
+  ASSERT_EQ(2u, summary.topics.size());
+  EXPECT_EQ(3u, summary.messageCount);
+  EXPECT_EQ(2 * data.size() + longData.size(), summary.totalBytes);
+  EXPECT_EQ(2s, summary.startTime);
+  EXPECT_EQ(6s, summary.endTime);
+  for (const log::TopicSummary &topic : summary.topics)
+  {
+    if (topic.topic == "/foo")
+    {
+      EXPECT_EQ(2u, topic.messageCount);
+      EXPECT_EQ(2 * data.size(), topic.totalBytes);
+    }
+    else
+    {
+      EXPECT_EQ("/bar", topic.topic);
+      EXPECT_EQ(longData.size(), topic.totalBytes);
+    }
+  }
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, SeekIndex)
+{
+  log::Log unopened;
+  EXPECT_TRUE(unopened.SeekIndex().empty());
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+  EXPECT_TRUE(logFile.SeekIndex(2).empty());
+
+  const std::string topic = "/some/topic/name";
+  const std::string type = "some.message.type";
+  const std::string data("some_data");
+  for (const auto time : {0s, 1s, 2s, 2s, 2s, 3s, 4s})
+  {
+    EXPECT_TRUE(logFile.InsertMessage(time, topic, type, data.c_str(),
+      data.size()));
+  }
+
+  // The messages received at the same time are in the same window
+  EXPECT_EQ((std::vector<std::chrono::nanoseconds>{2s, 4s}),
+    logFile.SeekIndex(2));
+  EXPECT_EQ((std::vector<std::chrono::nanoseconds>{2s, 4s}),
+    logFile.SeekIndex(3));
+  EXPECT_TRUE(logFile.SeekIndex(7).empty());
+  EXPECT_TRUE(logFile.SeekIndex(0).empty());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, TopicNames)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  const std::string data("some_data");
+  EXPECT_TRUE(logFile.InsertMessage(1s, "/foo", "foo.type", data.c_str(),
+    data.size()));
+
+  // The topic inserted after the query is read from the log
+  log::Batch batch = logFile.QueryMessages();
+  EXPECT_TRUE(logFile.InsertMessage(2s, "/bar", "bar.type", data.c_str(),
+    data.size()));
+
+  std::vector<std::pair<std::string, std::string>> names;
+  for (const log::Message &msg : batch)
+  {
+    // The names aren't copied for each message
+    EXPECT_EQ(&msg.Topic(), &msg.Topic());
+    names.emplace_back(msg.Topic(), msg.Type());
+  }
+  EXPECT_EQ((std::vector<std::pair<std::string, std::string>>{
+    {"/foo", "foo.type"}, {"/bar", "bar.type"}}), names);
+}
+
+//////////////////////////////////////////////////
+TEST(Log, QueryByHeaderTime)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  // The stamps of the headers lag behind the times received
+  const std::string foo("/foo");
+  const std::string bar("/bar");
+  const std::string type("some.message.type");
+  std::vector<std::string> data;
+  std::vector<std::chrono::nanoseconds> stamps;
+  for (int i = 0; i < 10; ++i)
+  {
+    data.push_back(std::to_string(i));
+    stamps.push_back(std::chrono::seconds(i) - 500ms);
+  }
+  std::vector<log::MessageRecord> records;
+  for (int i = 0; i < 10; ++i)
+  {
+    records.push_back({std::chrono::seconds(i), i % 2 ? &foo : &bar, &type,
+      data[i].data(), data[i].size()});
+    // A message without a header
+    if (i != 4)
+      records.back().headerTime = &stamps[i];
+  }
+  EXPECT_EQ(records.size(), logFile.InsertMessages(records));
+
+  auto query = [&logFile](const log::QueryOptions &_options)
+  {
+    std::vector<std::string> result;
+    for (const log::Message &msg : logFile.QueryMessages(_options))
+      result.push_back(msg.Data());
+    return result;
+  };
+
+  const log::QualifiedTimeRange range(2s, 5s);
+  EXPECT_EQ((std::vector<std::string>{"2", "3", "4", "5"}),
+    query(log::AllTopics(range)));
+
+  log::AllTopics all(range);
+  all.SetTimeReference(log::TimeRangeOption::TimeReference::HEADER);
+  EXPECT_EQ((std::vector<std::string>{"3", "5"}), query(all));
+
+  // The topics are queried each through the index, then merged
+  log::TopicList topics(std::set<std::string>{"/foo", "/bar"}, range);
+  topics.SetTimeReference(log::TimeRangeOption::TimeReference::HEADER);
+  EXPECT_EQ((std::vector<std::string>{"3", "5"}), query(topics));
+}
+
+//////////////////////////////////////////////////
+TEST(Log, SplitBatch)
+{
+  const std::string path = "Log_TEST_split.tlog";
+  std::remove(path.c_str());
+
+  const std::string data("some_data");
+  std::vector<std::string> topics;
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out));
+    for (int i = 0; i < 100; ++i)
+    {
+      // The messages are received out of order
+      const std::string topic = "/topic" + std::to_string(i % 3);
+      EXPECT_TRUE(logFile.InsertMessage(
+        std::chrono::seconds((i * 37) % 100), topic, "some.message.type",
+        data.c_str(), data.size()));
+      topics.push_back(topic);
+    }
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  EXPECT_TRUE(logFile.QueryMessages().Split(0).empty());
+  EXPECT_EQ(2u, log::Batch().Split(2).size());
+
+  // Each batch is iterated by its own thread
+  std::vector<log::Batch> parts =
+    logFile.QueryMessages(log::TopicList::Create(
+      std::vector<std::string>{"/topic0", "/topic2"}))
+      .Split(4);
+  ASSERT_EQ(4u, parts.size());
+  std::vector<std::vector<int64_t>> times(parts.size());
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < parts.size(); ++i)
+  {
+    threads.emplace_back([&parts, &times, &data, i]()
+      {
+        for (const log::Message &msg : parts[i])
+        {
+          EXPECT_NE("/topic1", msg.Topic());
+          EXPECT_EQ(data, msg.Data());
+          times[i].push_back(
+            std::chrono::duration_cast<std::chrono::seconds>(
+              msg.TimeReceived()).count());
+        }
+      });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // Every message is in one of the batches, ordered within it
+  std::multiset<int64_t> all;
+  for (const std::vector<int64_t> &partTimes : times)
+  {
+    EXPECT_FALSE(partTimes.empty());
+    EXPECT_TRUE(std::is_sorted(partTimes.begin(), partTimes.end()));
+    all.insert(partTimes.begin(), partTimes.end());
+  }
+  std::multiset<int64_t> expected;
+  for (int i = 0; i < 100; ++i)
+  {
+    if (topics[i] != "/topic1")
+      expected.insert((i * 37) % 100);
+  }
+  EXPECT_EQ(expected, all);
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, SplitMemoryBatch)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  const std::string data("some_data");
+  for (int i = 0; i < 10; ++i)
+  {
+    EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i), "/foo",
+      "some.message.type", data.c_str(), data.size()));
+  }
+
+  // The batches share the connection to the database
+  std::size_t count = 0;
+  for (log::Batch &part : logFile.QueryMessages().Split(3))
+  {
+    for (const log::Message &msg : part)
+    {
+      EXPECT_EQ(std::chrono::seconds(count), msg.TimeReceived());
+      ++count;
+    }
+  }
+  EXPECT_EQ(10u, count);
+}
+
+//////////////////////////////////////////////////
+TEST(Log, FollowMessages)
+{
+  const std::string path = "Log_TEST_follow.tlog";
+  std::remove(path.c_str());
+
+  // Data of the messages of a batch
+  auto Data = [](log::Batch _batch)
+  {
+    std::vector<std::string> result;
+    for (const log::Message &msg : _batch)
+      result.push_back(msg.Data());
+    return result;
+  };
+
+  const std::string type = "some.message.type";
+  const std::string data1("first_data");
+  const std::string data2("second_data");
+  const std::string data3("third_data");
+  const std::string data4("fourth_data");
+
+  log::Log writer;
+  ASSERT_TRUE(writer.Open(path, std::ios_base::out,
+    log::LogOpenOptions::WriteOptimized()));
+
+  log::Log reader;
+  ASSERT_TRUE(reader.Open(path, std::ios_base::in,
+    log::LogOpenOptions::ReadOptimized()));
+
+  // The writer commits its transactions every 500 ms
+  EXPECT_TRUE(writer.InsertMessage(2s, "/foo", type, data1.c_str(),
+    data1.size()));
+  std::this_thread::sleep_for(600ms);
+  EXPECT_TRUE(writer.InsertMessage(1s, "/bar", type, data2.c_str(),
+    data2.size()));
+
+  // The messages are in the order they were inserted
+  EXPECT_EQ((std::vector<std::string>{data1, data2}),
+    Data(reader.FollowMessages()));
+  ASSERT_NE(nullptr, reader.Descriptor());
+  EXPECT_EQ(2u, reader.Descriptor()->TopicsToMsgTypesToId().size());
+  EXPECT_EQ(2s, reader.EndTime());
+  EXPECT_TRUE(Data(reader.FollowMessages()).empty());
+
+  EXPECT_TRUE(writer.InsertMessage(3s, "/foo", type, data3.c_str(),
+    data3.size()));
+  std::this_thread::sleep_for(600ms);
+  EXPECT_TRUE(writer.InsertMessage(4s, "/baz", type, data4.c_str(),
+    data4.size()));
+
+  EXPECT_EQ(std::vector<std::string>{data3},
+    Data(reader.FollowMessages(log::TopicList("/foo"))));
+  EXPECT_EQ(3u, reader.Descriptor()->TopicsToMsgTypesToId().size());
+  EXPECT_EQ(4s, reader.EndTime());
+  EXPECT_TRUE(Data(reader.FollowMessages()).empty());
+
+  // Only the SQLite3 logs can be followed
+  EXPECT_TRUE(Data(reader.FollowMessages(
+    log::DownsampledTopics({"/foo"}, 1s))).empty());
+  log::Log unopened;
+  EXPECT_TRUE(Data(unopened.FollowMessages()).empty());
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, CompressedTopics)
+{
+  const std::string path = "Log_TEST_compressed.tlog";
+  std::remove(path.c_str());
+
+  log::LogOpenOptions options;
+  options.compressedTopics["/odometry"] = "position velocity";
+  options.compressedTopics["/camera"] = "";
+
+  const std::string odometry = "position 1 1 1 velocity 0 0 0";
+  const std::string camera(4096, 'x');
+  const std::string chatter = "hello";
+
+#ifdef HAVE_ZLIB
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::out, options));
+    EXPECT_TRUE(logFile.InsertMessage(1s, "/odometry", "some.message.type",
+      odometry.data(), odometry.size()));
+    EXPECT_TRUE(logFile.InsertMessage(2s, "/chatter", "some.message.type",
+      chatter.data(), chatter.size()));
+
+    std::vector<log::MessageRecord> records;
+    const std::string topic = "/camera";
+    const std::string type = "image.type";
+    for (int i = 0; i < 70; ++i)
+    {
+      records.push_back(log::MessageRecord{std::chrono::seconds(3 + i),
+        &topic, &type, camera.data(), camera.size()});
+    }
+    EXPECT_EQ(70u, logFile.InsertMessages(records));
+
+    // Compressed data are only accepted for the compressed topics
+    const std::string chatterTopic = "/chatter";
+    const std::string chatterType = "some.message.type";
+    std::vector<log::MessageRecord> precompressed;
+    precompressed.push_back(log::MessageRecord{std::chrono::seconds(80),
+      &chatterTopic, &chatterType, chatter.data(), chatter.size(), true});
+    EXPECT_EQ(0u, logFile.InsertMessages(precompressed));
+
+    // The messages are decompressed while the log is written
+    std::size_t count = 0;
+    for (const log::Message &msg : logFile.QueryMessages(
+           log::TopicList("/camera")))
+    {
+      EXPECT_EQ(camera, msg.Data());
+      ++count;
+    }
+    EXPECT_EQ(70u, count);
+  }
+
+  // The compressed messages take less space
+  {
+    std::ifstream in(path, std::ios_base::binary | std::ios_base::ate);
+    EXPECT_LT(static_cast<std::size_t>(in.tellg()), 70 * camera.size() / 2);
+  }
+
+  // The topics created when the log is reopened are compressed only if
+  // they're configured so
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path, std::ios_base::in | std::ios_base::out));
+    EXPECT_TRUE(logFile.InsertMessage(100s, "/odometry",
+      "some.message.type", odometry.data(), odometry.size()));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(path));
+  std::vector<std::string> result;
+  for (const log::Message &msg : logFile.QueryMessages())
+    result.push_back(msg.Data());
+  ASSERT_EQ(73u, result.size());
+  EXPECT_EQ(odometry, result[0]);
+  EXPECT_EQ(chatter, result[1]);
+  EXPECT_EQ(camera, result[2]);
+  EXPECT_EQ(camera, result[71]);
+  EXPECT_EQ(odometry, result[72]);
+
+  // Through the scans of a topic merged with another
+  result.clear();
+  const std::set<std::string> topics = {"/odometry", "/chatter"};
+  for (const log::Message &msg : logFile.QueryMessages(log::TopicList(topics)))
+  {
+    result.push_back(msg.Data());
+  }
+  EXPECT_EQ((std::vector<std::string>{odometry, chatter, odometry}), result);
+#else
+  log::Log logFile;
+  EXPECT_FALSE(logFile.Open(path, std::ios_base::out, options));
+#endif
+  std::remove(path.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, InsertLog)
+{
+  const std::string path1 = "Log_TEST_insert1.tlog";
+  const std::string path2 = "Log_TEST_insert2.tlog";
+  const std::string merged = "Log_TEST_merged.tlog";
+  std::remove(path1.c_str());
+  std::remove(path2.c_str());
+  std::remove(merged.c_str());
+
+  const std::string type1 = "some.message.type";
+  const std::string type2 = "another.message.type";
+  const std::string data = "data";
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path1, std::ios_base::out));
+    EXPECT_TRUE(logFile.InsertMessage(1s, "/foo", type1, data.data(),
+      data.size()));
+    EXPECT_TRUE(logFile.InsertMessage(3s, "/bar", type2, data.data(),
+      data.size()));
+    EXPECT_TRUE(logFile.InsertMessage(5s, "/foo", type1, data.data(),
+      data.size()));
+  }
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(path2, std::ios_base::out));
+    EXPECT_TRUE(logFile.InsertMessage(2s, "/foo", type1, data.data(),
+      data.size()));
+    EXPECT_TRUE(logFile.InsertMessage(4s, "/baz", type1, data.data(),
+      data.size()));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(merged, std::ios_base::out));
+  EXPECT_TRUE(logFile.InsertMessage(6s, "/bar", type2, data.data(),
+    data.size()));
+  EXPECT_EQ(3, logFile.InsertLog(path1));
+  EXPECT_EQ(1, logFile.InsertLog(path2,
+    log::QualifiedTimeRange(log::QualifiedTime(3s), log::QualifiedTime())));
+
+  // The topics of both logs are shared and the statistics added up
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(6s, logFile.EndTime());
+  ASSERT_NE(nullptr, logFile.Descriptor());
+  EXPECT_EQ(3u, logFile.Descriptor()->TopicsToMsgTypesToId().size());
+  const std::vector<log::TopicSummary> summaries = logFile.TopicSummaries();
+  ASSERT_EQ(3u, summaries.size());
+  for (const log::TopicSummary &summary : summaries)
+  {
+    if (summary.topic == "/bar")
+    {
+      EXPECT_EQ(type2, summary.type);
+      EXPECT_EQ(2u, summary.messageCount);
+      EXPECT_EQ(3s, summary.startTime);
+      EXPECT_EQ(6s, summary.endTime);
+    }
+    else
+    {
+      EXPECT_EQ(summary.topic == "/foo" ? 2u : 1u, summary.messageCount);
+    }
+  }
+
+  std::vector<std::string> topics;
+  for (const log::Message &msg : logFile.QueryMessages())
+  {
+    EXPECT_EQ(data, msg.Data());
+    topics.push_back(msg.Topic());
+  }
+  EXPECT_EQ((std::vector<std::string>{"/foo", "/bar", "/baz", "/foo",
+    "/bar"}), topics);
+
+  // Missing logs and the log itself can't be inserted
+  EXPECT_EQ(-1, logFile.InsertLog("Log_TEST_missing.tlog"));
+  EXPECT_EQ(-1, logFile.InsertLog(merged));
+  log::Log unopened;
+  EXPECT_EQ(-1, unopened.InsertLog(path1));
+
+#ifdef HAVE_ZLIB
+  // The messages are copied as they are stored, so a topic can't be
+  // compressed differently
+  const std::string compressed = "Log_TEST_insert_compressed.tlog";
+  std::remove(compressed.c_str());
+  {
+    log::LogOpenOptions options;
+    options.compressedTopics["/foo"] = "";
+    options.compressedTopics["/new"] = "";
+    log::Log compressedLog;
+    ASSERT_TRUE(compressedLog.Open(compressed, std::ios_base::out, options));
+    EXPECT_TRUE(compressedLog.InsertMessage(7s, "/new", type1, data.data(),
+      data.size()));
+    EXPECT_TRUE(compressedLog.InsertMessage(8s, "/foo", type1, data.data(),
+      data.size()));
+    EXPECT_EQ(-1, compressedLog.InsertLog(merged));
+  }
+  EXPECT_EQ(-1, logFile.InsertLog(compressed));
+
+  // The failed copies are rolled back
+  ASSERT_NE(nullptr, logFile.Descriptor());
+  EXPECT_EQ(3u, logFile.Descriptor()->TopicsToMsgTypesToId().size());
+
+  // The new topics keep the compression of their log
+  log::Log other;
+  ASSERT_TRUE(other.Open(":memory:", std::ios_base::out));
+  EXPECT_EQ(2, other.InsertLog(compressed));
+  std::size_t count = 0;
+  for (const log::Message &msg : other.QueryMessages())
+  {
+    EXPECT_EQ(data, msg.Data());
+    ++count;
+  }
+  EXPECT_EQ(2u, count);
+  std::remove(compressed.c_str());
+#endif
+
+  std::remove(path1.c_str());
+  std::remove(path2.c_str());
+  std::remove(merged.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, OpenWithInvalidOptions)
+{
+  log::LogOpenOptions options;
+  options.journalMode = "WAL; DROP TABLE messages";
+  log::Log journalLog;
+  EXPECT_FALSE(journalLog.Open(":memory:", std::ios_base::out, options));
+  EXPECT_FALSE(journalLog.Valid());
+
+  options = log::LogOpenOptions();
+  options.synchronous = "SOMETIMES";
+  log::Log synchronousLog;
+  EXPECT_FALSE(synchronousLog.Open(":memory:", std::ios_base::out, options));
+
+  options = log::LogOpenOptions();
+  options.pageSize = 1000;
+  log::Log pageLog;
+  EXPECT_FALSE(pageLog.Open(":memory:", std::ios_base::out, options));
+
+  options = log::LogOpenOptions();
+  options.busyTimeout = -1;
+  log::Log busyLog;
+  EXPECT_FALSE(busyLog.Open(":memory:", std::ios_base::out, options));
+
+  options = log::LogOpenOptions();
+  options.pageSize = 4096;
+  options.cacheSize = -1024;
+  options.mmapSize = 0;
+  log::Log validLog;
+  EXPECT_TRUE(validLog.Open(":memory:", std::ios_base::out, options));
+}
+
 //////////////////////////////////////////////////
 TEST(Log, OpenCorruptDatabase)
 {
@@ -257,6 +1231,10 @@ TEST(Log, OpenCorruptDatabase)
   logFile.Open(path);
   EXPECT_GT(logFile.EndTime(), 0ns) << "logFile.EndTime() == "
     << logFile.EndTime().count() << "ns";;
+
+  // The log was recorded without topic statistics, and its messages can't
+  // all be read to summarize them
+  EXPECT_TRUE(logFile.TopicSummaries().empty());
 }
 
 
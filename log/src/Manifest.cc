@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Console.hh"
+#include "Manifest.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+/// \brief First line of a manifest.
+static const char kManifestHeader[] = "#ignition-transport-log-manifest 1";
+
+/// \brief First line of a manifest of shards.
+static const char kShardManifestHeader[] = "#ignition-transport-log-shards 1";
+
+//////////////////////////////////////////////////
+/// \brief Check whether a file starts with a line.
+/// \param[in] _file Path to the file.
+/// \param[in] _header The line.
+/// \return True if the file starts with the line.
+static bool StartsWith(const std::string &_file, const std::string &_header)
+{
+  std::ifstream in(_file, std::ios_base::binary);
+  std::string header(_header.size(), '\0');
+  return in.read(&header[0], header.size()) && header == _header;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the directory part of a path.
+/// \param[in] _file The path.
+/// \return The directory, with its trailing separator, or an empty string
+/// for a path without directory.
+static std::string DirectoryOf(const std::string &_file)
+{
+  const std::size_t slash = _file.find_last_of("/\\");
+  return slash == std::string::npos ? "" : _file.substr(0, slash + 1);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check whether a path is absolute.
+/// \param[in] _file The path.
+/// \return True if the path starts from the root, or from a drive on
+/// Windows.
+static bool IsAbsolute(const std::string &_file)
+{
+  return (!_file.empty() && (_file[0] == '/' || _file[0] == '\\')) ||
+    (_file.size() > 2 && _file[1] == ':' &&
+     (_file[2] == '/' || _file[2] == '\\'));
+}
+
+//////////////////////////////////////////////////
+bool Manifest::IsManifest(const std::string &_file)
+{
+  return StartsWith(_file, kManifestHeader) ||
+    StartsWith(_file, kShardManifestHeader);
+}
+
+//////////////////////////////////////////////////
+bool Manifest::IsShardManifest(const std::string &_file)
+{
+  return StartsWith(_file, kShardManifestHeader);
+}
+
+//////////////////////////////////////////////////
+bool Manifest::Read(const std::string &_file,
+    std::vector<std::string> &_segments)
+{
+  std::ifstream in(_file);
+  std::string line;
+  if (!std::getline(in, line) ||
+      (line != kManifestHeader && line != kShardManifestHeader))
+  {
+    LERR("[" << _file << "] is not a log manifest\n");
+    return false;
+  }
+
+  const std::string directory = DirectoryOf(_file);
+  _segments.clear();
+  while (std::getline(in, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!line.empty())
+      _segments.push_back(IsAbsolute(line) ? line : directory + line);
+  }
+
+  if (_segments.empty())
+  {
+    LERR("Log manifest [" << _file << "] has no segments\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Manifest::Write(const std::string &_file,
+    const std::vector<std::string> &_segments, const bool _shards)
+{
+  const std::string directory = DirectoryOf(_file);
+  for (const std::string &segment : _segments)
+  {
+    if (DirectoryOf(segment) != directory && !IsAbsolute(segment))
+    {
+      LERR("[" << segment << "] must be in the directory of the log "
+           "manifest [" << _file << "] or an absolute path\n");
+      return false;
+    }
+  }
+
+  const std::string tmpFile = _file + ".tmp";
+  {
+    std::ofstream out(tmpFile, std::ios_base::trunc);
+    out << (_shards ? kShardManifestHeader : kManifestHeader) << "\n";
+    for (const std::string &segment : _segments)
+    {
+      if (DirectoryOf(segment) == directory)
+        out << segment.substr(directory.size()) << "\n";
+      else
+        out << segment << "\n";
+    }
+    out.flush();
+    if (!out)
+    {
+      LERR("Failed to write log manifest [" << tmpFile << "]\n");
+      return false;
+    }
+  }
+
+#ifdef _WIN32
+  // rename() doesn't replace an existing file on Windows
+  std::remove(_file.c_str());
+#endif
+  if (std::rename(tmpFile.c_str(), _file.c_str()) != 0)
+  {
+    LERR("Failed to rename [" << tmpFile << "] to [" << _file << "]\n");
+    std::remove(tmpFile.c_str());
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string Manifest::SegmentFilename(const std::string &_file,
+    const std::size_t _index)
+{
+  char index[32];
+  std::snprintf(index, sizeof(index), ".%04zu", _index);
+
+  // The extension is the last dot of the file name, if any
+  const std::size_t dot = _file.find_last_of('.');
+  if (dot == std::string::npos || dot < DirectoryOf(_file).size() ||
+      dot == DirectoryOf(_file).size())
+  {
+    return _file + index;
+  }
+  return _file.substr(0, dot) + index + _file.substr(dot);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_SRC_MANIFEST_HH_
+#define IGNITION_TRANSPORT_LOG_SRC_MANIFEST_HH_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Text file listing the segments of a rotated recording, in
+      /// the order they were recorded, or the shards of a recording split
+      /// by topic, which were recorded at the same time.
+      ///
+      /// The first line identifies the file and its kind, then each line is
+      /// the path of a segment relative to the directory of the manifest,
+      /// or an absolute path for the shards stored elsewhere.
+      class Manifest
+      {
+        /// \brief Check whether a file is a manifest, of either kind.
+        /// \param[in] _file Path to the file.
+        /// \return True if the file starts like a manifest.
+        public: static bool IsManifest(const std::string &_file);
+
+        /// \brief Check whether a file is a manifest of shards.
+        /// \param[in] _file Path to the file.
+        /// \return True if the file starts like a manifest of shards.
+        public: static bool IsShardManifest(const std::string &_file);
+
+        /// \brief Read a manifest.
+        /// \param[in] _file Path to the manifest.
+        /// \param[out] _segments Path to each segment, in order.
+        /// \return True if the manifest was read.
+        public: static bool Read(const std::string &_file,
+            std::vector<std::string> &_segments);
+
+        /// \brief Write a manifest. It's written next to the file and renamed
+        /// over it, so readers never see a partial manifest.
+        /// \param[in] _file Path to the manifest.
+        /// \param[in] _segments Path to each segment, in order. They must be
+        /// in the directory of the manifest, or absolute paths.
+        /// \param[in] _shards True to list the shards of a recording instead
+        /// of its segments.
+        /// \return True if the manifest was written.
+        public: static bool Write(const std::string &_file,
+            const std::vector<std::string> &_segments,
+            bool _shards = false);
+
+        /// \brief Get the path of a segment of a recording, the path of the
+        /// manifest with the index of the segment before its extension,
+        /// e.g. "rec.0002.tlog" for "rec.tlog".
+        /// \param[in] _file Path to the manifest.
+        /// \param[in] _index Index of the segment.
+        /// \return The path of the segment.
+        public: static std::string SegmentFilename(const std::string &_file,
+            std::size_t _index);
+      };
+      }
+    }
+  }
+}
+
+#endif
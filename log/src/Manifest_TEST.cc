@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "Manifest.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+/// \brief Path of the manifest created by the tests.
+static const char kPath[] = "Manifest_TEST.tlog";
+
+//////////////////////////////////////////////////
+/// \brief Write a segment whose messages' data is their topic followed by
+/// their time.
+/// \param[in] _file Path to the segment.
+/// \param[in] _messages Time and topic of the messages.
+/// \return True if the segment was written.
+static bool WriteSegment(const std::string &_file,
+    const std::vector<std::pair<std::chrono::nanoseconds, std::string>>
+      &_messages)
+{
+  std::remove(_file.c_str());
+  log::Log logFile;
+  if (!logFile.Open(_file, std::ios_base::out))
+    return false;
+  for (const auto &msg : _messages)
+  {
+    const std::string data = msg.second + "@" +
+      std::to_string(msg.first.count());
+    if (!logFile.InsertMessage(msg.first, msg.second, "some.message.type",
+          data.data(), data.size()))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the data of the messages of a batch.
+/// \param[in] _batch The batch.
+/// \return The data of each message, in order.
+static std::vector<std::string> Data(log::Batch _batch)
+{
+  std::vector<std::string> result;
+  for (const log::Message &msg : _batch)
+    result.push_back(msg.Data());
+  return result;
+}
+
+//////////////////////////////////////////////////
+TEST(Manifest, SegmentFilename)
+{
+  EXPECT_EQ("rec.0000.tlog", log::Manifest::SegmentFilename("rec.tlog", 0));
+  EXPECT_EQ("dir/rec.0012.clog",
+    log::Manifest::SegmentFilename("dir/rec.clog", 12));
+  EXPECT_EQ("dir.d/rec.0001", log::Manifest::SegmentFilename("dir.d/rec", 1));
+  EXPECT_EQ(".hidden.0001", log::Manifest::SegmentFilename(".hidden", 1));
+}
+
+//////////////////////////////////////////////////
+TEST(Manifest, ReadWrite)
+{
+  const std::vector<std::string> segments =
+    {"Manifest_TEST.0000.tlog", "Manifest_TEST.0001.tlog"};
+  ASSERT_TRUE(log::Manifest::Write(kPath, segments));
+  EXPECT_TRUE(log::Manifest::IsManifest(kPath));
+
+  std::vector<std::string> read;
+  ASSERT_TRUE(log::Manifest::Read(kPath, read));
+  EXPECT_EQ(segments, read);
+
+  // A manifest without segments is invalid
+  ASSERT_TRUE(log::Manifest::Write(kPath, {}));
+  EXPECT_FALSE(log::Manifest::Read(kPath, read));
+
+  {
+    std::ofstream out(kPath, std::ios_base::trunc);
+    out << "Not a manifest\n";
+  }
+  EXPECT_FALSE(log::Manifest::IsManifest(kPath));
+  EXPECT_FALSE(log::Manifest::Read(kPath, read));
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(Manifest, OpenSegmentedLog)
+{
+  const std::string first = log::Manifest::SegmentFilename(kPath, 0);
+  const std::string second = log::Manifest::SegmentFilename(kPath, 1);
+  ASSERT_TRUE(WriteSegment(first, {{1s, "/foo"}, {2s, "/bar"}}));
+  ASSERT_TRUE(WriteSegment(second, {{3s, "/foo"}, {4s, "/baz"}}));
+  ASSERT_TRUE(log::Manifest::Write(kPath, {first, second}));
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath, std::ios_base::in,
+    log::LogOpenOptions::ReadOptimized()));
+  EXPECT_EQ(log::LogFormat::SEGMENTED, logFile.Format());
+  EXPECT_EQ("0.1.4", logFile.Version());
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(4s, logFile.EndTime());
+
+  const log::Descriptor *desc = logFile.Descriptor();
+  ASSERT_NE(nullptr, desc);
+  EXPECT_EQ(3u, desc->TopicsToMsgTypesToId().size());
+
+  EXPECT_EQ((std::vector<std::string>{"/foo@1000000000", "/bar@2000000000",
+    "/foo@3000000000", "/baz@4000000000"}), Data(logFile.QueryMessages()));
+  EXPECT_EQ((std::vector<std::string>{"/foo@1000000000", "/foo@3000000000"}),
+    Data(logFile.QueryMessages(log::TopicList("/foo"))));
+
+  const log::QualifiedTimeRange range(
+    log::QualifiedTime(2s, log::QualifiedTime::Qualifier::INCLUSIVE),
+    log::QualifiedTime(3s, log::QualifiedTime::Qualifier::INCLUSIVE));
+  EXPECT_EQ((std::vector<std::string>{"/bar@2000000000", "/foo@3000000000"}),
+    Data(logFile.QueryMessages(log::AllTopics(range))));
+  EXPECT_TRUE(Data(logFile.QueryMessages(log::TopicList("/nope"))).empty());
+
+  // The segments are read only
+  EXPECT_FALSE(logFile.InsertMessage(5s, "/foo", "some.message.type",
+    "data", 4));
+
+  std::remove(kPath);
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Manifest, OpenShardedLog)
+{
+  const std::string first = "Manifest_TEST.cameras.tlog";
+  const std::string second = "Manifest_TEST.lidar.clog";
+  const std::string empty = "Manifest_TEST.empty.tlog";
+  ASSERT_TRUE(WriteSegment(first, {{2s, "/camera"}, {5s, "/camera"}}));
+  ASSERT_TRUE(WriteSegment(second,
+    {{1s, "/lidar"}, {2s, "/lidar"}, {6s, "/lidar"}}));
+  ASSERT_TRUE(WriteSegment(empty, {}));
+  ASSERT_TRUE(log::Manifest::Write(kPath, {first, second, empty}, true));
+  EXPECT_TRUE(log::Manifest::IsManifest(kPath));
+  EXPECT_TRUE(log::Manifest::IsShardManifest(kPath));
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(kPath));
+  EXPECT_EQ(log::LogFormat::SHARDED, logFile.Format());
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(6s, logFile.EndTime());
+  EXPECT_EQ(5u, logFile.Summary().messageCount);
+
+  // The messages of the shards are merged by time received, the first
+  // shards first at the same time
+  EXPECT_EQ((std::vector<std::string>{"/lidar@1000000000",
+    "/camera@2000000000", "/lidar@2000000000", "/camera@5000000000",
+    "/lidar@6000000000"}), Data(logFile.QueryMessages()));
+  EXPECT_EQ((std::vector<std::string>{"/camera@2000000000",
+    "/camera@5000000000"}),
+    Data(logFile.QueryMessages(log::TopicList("/camera"))));
+
+  const log::QualifiedTimeRange range(
+    log::QualifiedTime(2s, log::QualifiedTime::Qualifier::EXCLUSIVE),
+    log::QualifiedTime(6s, log::QualifiedTime::Qualifier::INCLUSIVE));
+  EXPECT_EQ((std::vector<std::string>{"/camera@5000000000",
+    "/lidar@6000000000"}), Data(logFile.QueryMessages(log::AllTopics(range))));
+
+  // The shards are read only
+  EXPECT_FALSE(logFile.InsertMessage(7s, "/camera", "some.message.type",
+    "data", 4));
+
+  // The manifests of segments are told apart
+  ASSERT_TRUE(log::Manifest::Write(kPath, {first}));
+  EXPECT_FALSE(log::Manifest::IsShardManifest(kPath));
+
+  std::remove(kPath);
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+  std::remove(empty.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Manifest, AbsolutePaths)
+{
+  // The shards may be stored on other disks
+  const std::string shard = "/tmp/Manifest_TEST.shard.tlog";
+  ASSERT_TRUE(log::Manifest::Write(kPath,
+    {"Manifest_TEST.0000.tlog", shard}, true));
+
+  std::vector<std::string> read;
+  ASSERT_TRUE(log::Manifest::Read(kPath, read));
+  EXPECT_EQ((std::vector<std::string>{"Manifest_TEST.0000.tlog", shard}),
+    read);
+
+  // The relative paths must be in the directory of the manifest
+  EXPECT_FALSE(log::Manifest::Write(kPath, {"elsewhere/rec.tlog"}));
+  std::remove(kPath);
+}
+
+//////////////////////////////////////////////////
+TEST(Manifest, MissingSegment)
+{
+  const std::string first = log::Manifest::SegmentFilename(kPath, 0);
+  const std::string second = log::Manifest::SegmentFilename(kPath, 1);
+  ASSERT_TRUE(WriteSegment(first, {{1s, "/foo"}}));
+  std::remove(second.c_str());
+  ASSERT_TRUE(log::Manifest::Write(kPath, {first, second}));
+
+  log::Log logFile;
+  EXPECT_FALSE(logFile.Open(kPath));
+  EXPECT_FALSE(logFile.Valid());
+
+  // Manifests are written by the recorder
+  log::Log writeLog;
+  EXPECT_FALSE(writeLog.Open(kPath, std::ios_base::out,
+    log::LogFormat::SEGMENTED));
+
+  std::remove(kPath);
+  std::remove(first.c_str());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
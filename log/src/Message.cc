@@ -17,6 +17,7 @@
 
 #include <chrono>
 #include <string>
+#include <string_view>
 
 #include "ignition/transport/log/Message.hh"
 
@@ -35,17 +36,17 @@ class ignition::transport::log::MessagePrivate
   /// \brief Length of data
   public: std::size_t dataLen = 0;
 
-  /// \brief pointer to topic string
-  public: const char *topic = nullptr;
+  /// \brief copy of the topic, when it isn't borrowed
+  public: std::string ownTopic;
 
-  /// \brief Length of topic
-  public: std::size_t topicLen = 0;
+  /// \brief copy of the message type, when it isn't borrowed
+  public: std::string ownType;
 
-  /// \brief pointer to message type string
-  public: const char *type = nullptr;
+  /// \brief the topic
+  public: const std::string *topic = &ownTopic;
 
-  /// \brief Length of message type
-  public: std::size_t typeLen = 0;
+  /// \brief the message type
+  public: const std::string *type = &ownType;
 };
 
 //////////////////////////////////////////////////
@@ -64,10 +65,21 @@ Message::Message(const std::chrono::nanoseconds &_timeRecv,
   this->dataPtr->timeReceived = _timeRecv;
   this->dataPtr->data = _data;
   this->dataPtr->dataLen = _dataLen;
-  this->dataPtr->type = _type;
-  this->dataPtr->typeLen = _typeLen;
-  this->dataPtr->topic = _topic;
-  this->dataPtr->topicLen = _topicLen;
+  this->dataPtr->ownType.assign(_type, _typeLen);
+  this->dataPtr->ownTopic.assign(_topic, _topicLen);
+}
+
+//////////////////////////////////////////////////
+Message::Message(const std::chrono::nanoseconds &_timeRecv,
+            const void *_data, std::size_t _dataLen,
+            const std::string &_type, const std::string &_topic)
+  : dataPtr(new MessagePrivate)
+{
+  this->dataPtr->timeReceived = _timeRecv;
+  this->dataPtr->data = _data;
+  this->dataPtr->dataLen = _dataLen;
+  this->dataPtr->type = &_type;
+  this->dataPtr->topic = &_topic;
 }
 
 //////////////////////////////////////////////////
@@ -83,15 +95,22 @@ std::string Message::Data() const
 }
 
 //////////////////////////////////////////////////
-std::string Message::Type() const
+std::string_view Message::DataView() const
+{
+  return std::string_view(reinterpret_cast<const char *>(this->dataPtr->data),
+      this->dataPtr->dataLen);
+}
+
+//////////////////////////////////////////////////
+const std::string &Message::Type() const
 {
-  return std::string(this->dataPtr->type, this->dataPtr->typeLen);
+  return *this->dataPtr->type;
 }
 
 //////////////////////////////////////////////////
-std::string Message::Topic() const
+const std::string &Message::Topic() const
 {
-  return std::string(this->dataPtr->topic, this->dataPtr->topicLen);
+  return *this->dataPtr->topic;
 }
 
 //////////////////////////////////////////////////
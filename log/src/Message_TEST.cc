@@ -29,6 +29,7 @@ TEST(Message, DefaultConstructor)
 {
   transport::log::Message msg;
   EXPECT_EQ(std::string(""), msg.Data());
+  EXPECT_TRUE(msg.DataView().empty());
   EXPECT_EQ(std::string(""), msg.Topic());
   EXPECT_EQ(std::string(""), msg.Type());
   EXPECT_EQ(0ns, msg.TimeReceived());
@@ -48,11 +49,31 @@ TEST(Message, DataConstructor)
       topic.c_str(), topic.size());
 
   EXPECT_EQ(data, msg.Data());
+  EXPECT_EQ(data, msg.DataView());
+  // The view refers to the data of the creator
+  EXPECT_EQ(data.c_str(), msg.DataView().data());
   EXPECT_EQ(msgType, msg.Type());
   EXPECT_EQ(topic, msg.Topic());
   EXPECT_EQ(goldenTime, msg.TimeReceived());
 }
 
+//////////////////////////////////////////////////
+TEST(Message, BorrowedNames)
+{
+  std::string data("SomeData");
+  std::string topic("/a/topic");
+  std::string msgType("msg.type");
+
+  transport::log::Message msg(1ns, data.c_str(), data.size(), msgType,
+      topic);
+
+  // The names refer to the strings of the creator
+  EXPECT_EQ(&msgType, &msg.Type());
+  EXPECT_EQ(&topic, &msg.Topic());
+  EXPECT_EQ(data, msg.DataView());
+  EXPECT_EQ(1ns, msg.TimeReceived());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -17,6 +17,8 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -36,10 +38,75 @@ MsgIterPrivate::MsgIterPrivate()
 //////////////////////////////////////////////////
 MsgIterPrivate::MsgIterPrivate(
     const std::shared_ptr<raii_sqlite3::Database> &_db,
-    const std::shared_ptr<std::vector<SqlStatement>> &_statements)
+    const std::shared_ptr<std::vector<SqlStatement>> &_statements,
+    const bool _merge)
   : db(_db), statements(_statements)
 {
-  PrepareNextStatement();
+  if (!_merge)
+  {
+    PrepareNextStatement();
+    return;
+  }
+
+  // Step every statement to its first row, the messages are then taken
+  // from the statement with the earliest one
+  for (const SqlStatement &query : *this->statements)
+  {
+    std::unique_ptr<raii_sqlite3::Statement> statement =
+      this->PrepareStatement(query);
+    if (!statement)
+      continue;
+
+    const int returnCode = sqlite3_step(statement->Handle());
+    if (returnCode == SQLITE_ROW)
+    {
+      this->mergeHeap.push_back(MergeHead{
+        sqlite3_column_int64(statement->Handle(), 1),
+        sqlite3_column_int64(statement->Handle(), 0),
+        this->merged.size()});
+      this->merged.push_back(std::move(statement));
+    }
+    else if (returnCode != SQLITE_DONE)
+    {
+      LERR("Failed to get message [" << returnCode << "]\n");
+    }
+  }
+  std::make_heap(this->mergeHeap.begin(), this->mergeHeap.end(),
+    std::greater<MergeHead>());
+  this->statementIndex = this->statements->size();
+}
+
+//////////////////////////////////////////////////
+MsgIterPrivate::MsgIterPrivate(
+    std::unique_ptr<ChunkedLogCursor> &&_cursor)  // NOLINT
+  : cursor(std::move(_cursor))
+{
+}
+
+//////////////////////////////////////////////////
+MsgIterPrivate::MsgIterPrivate(
+    const std::shared_ptr<std::vector<Batch>> &_segments, const bool _merge)
+  : segments(_segments), segmentEnd(new MsgIter), mergeSegments(_merge)
+{
+  if (!_merge)
+    return;
+
+  // Every segment is read from its first message, the messages are then
+  // taken from the segment with the earliest one
+  for (Batch &batch : *this->segments)
+  {
+    std::unique_ptr<MsgIter> iter(new MsgIter(batch.begin()));
+    if (*iter != *this->segmentEnd)
+    {
+      this->segmentHeap.push_back(MergeHead{
+        (*iter)->TimeReceived().count(),
+        static_cast<int64_t>(this->segmentIters.size()),
+        this->segmentIters.size()});
+    }
+    this->segmentIters.push_back(std::move(iter));
+  }
+  std::make_heap(this->segmentHeap.begin(), this->segmentHeap.end(),
+    std::greater<MergeHead>());
 }
 
 //////////////////////////////////////////////////
@@ -57,22 +124,33 @@ bool MsgIterPrivate::PrepareNextStatement()
     return false;
   }
   // Get next statement in list
-  const SqlStatement & query = this->statements->at(this->statementIndex);
+  std::unique_ptr<raii_sqlite3::Statement> nextStatement =
+    this->PrepareStatement(this->statements->at(this->statementIndex));
+  if (!nextStatement)
+    return false;
+
+  this->statement = std::move(nextStatement);
+  return true;
+}
 
+//////////////////////////////////////////////////
+std::unique_ptr<raii_sqlite3::Statement> MsgIterPrivate::PrepareStatement(
+    const SqlStatement &_query)
+{
   // Compile the statement
   std::unique_ptr<raii_sqlite3::Statement> nextStatement(
-      new raii_sqlite3::Statement(*(this->db), query.statement));
+      new raii_sqlite3::Statement(*(this->db), _query.statement));
   if (!*nextStatement)
   {
     LERR("Failed to prepare query: "<< sqlite3_errmsg(
         this->db->Handle()) << "\n");
-    return false;
+    return nullptr;
   }
 
   // Bind the parameters supplied with the statment
   int i = 1;
   int returnCode;
-  for (const SqlParameter &param : query.parameters)
+  for (const SqlParameter &param : _query.parameters)
   {
     switch (param.Type())
     {
@@ -90,62 +168,233 @@ bool MsgIterPrivate::PrepareNextStatement()
           *param.QueryReal());
         break;
       default:
-        return false;
+        return nullptr;
     }
     if (returnCode != SQLITE_OK)
     {
       LERR("Failed to query messages: "<< sqlite3_errmsg(
         this->db->Handle()) << "\n");
-      return false;
+      return nullptr;
     }
     ++i;
   }
 
-  this->statement = std::move(nextStatement);
-  return true;
+  return nextStatement;
+}
+
+//////////////////////////////////////////////////
+void MsgIterPrivate::ReadRow(raii_sqlite3::Statement &_statement)
+{
+  // TODO(anyone) get data and create message in the dereference operators
+  // Assumes statement has column order:
+  // messages id (0), timeRecv(1), topic id(2), message data(3)
+  std::chrono::nanoseconds timeRecv;
+
+  // Time received
+  sqlite_int64 timeRecvInt = sqlite3_column_int64(_statement.Handle(), 1);
+  timeRecv = std::chrono::nanoseconds(timeRecvInt);
+
+  // Topic and message type names, which the message refers to
+  static const TopicKey kUnknownTopic;
+  const TopicKey *topic =
+    this->TopicOf(sqlite3_column_int64(_statement.Handle(), 2));
+  if (!topic)
+    topic = &kUnknownTopic;
+
+  // Message data
+  const void *data = sqlite3_column_blob(_statement.Handle(), 3);
+  std::size_t numData = sqlite3_column_bytes(_statement.Handle(), 3);
+
+  // The messages of the compressed topics are decompressed into memory of
+  // this iterator, which is reused from one message to the next
+  if (this->dictionaries && !this->dictionaries->empty())
+  {
+    auto dictionary = this->dictionaries->find(*topic);
+    if (dictionary != this->dictionaries->end())
+    {
+      if (!this->codec)
+        this->codec.reset(new BlobCodec);
+
+      if (this->codec->Decompress(data, numData, dictionary->second,
+            this->decompressed))
+      {
+        data = this->decompressed.data();
+        numData = this->decompressed.size();
+      }
+      else
+      {
+        LERR("Failed to read message of topic [" << topic->topic << "]\n");
+        data = nullptr;
+        numData = 0;
+      }
+    }
+  }
+
+  this->message.reset(new Message(
+        timeRecv, data, numData, topic->type, topic->topic));
+}
+
+//////////////////////////////////////////////////
+const TopicKey *MsgIterPrivate::TopicOf(const int64_t _id)
+{
+  if (this->topicNames)
+  {
+    auto it = this->topicNames->find(_id);
+    if (it != this->topicNames->end())
+      return &it->second;
+  }
+
+  auto late = this->lateTopics.find(_id);
+  if (late != this->lateTopics.end())
+    return &late->second;
+
+  // A topic inserted after the query was made, e.g. while following a log
+  // being recorded
+  if (!this->db)
+    return nullptr;
+
+  raii_sqlite3::Statement statement(*(this->db),
+    "SELECT topics.name, message_types.name FROM topics"
+    " JOIN message_types ON message_types.id = topics.message_type_id"
+    " WHERE topics.id = ?;");
+  if (!statement ||
+      sqlite3_bind_int64(statement.Handle(), 1, _id) != SQLITE_OK ||
+      sqlite3_step(statement.Handle()) != SQLITE_ROW)
+  {
+    LERR("Failed to get the name of topic [" << _id << "]\n");
+    return nullptr;
+  }
+
+  TopicKey &key = this->lateTopics[_id];
+  key.topic = reinterpret_cast<const char *>(
+    sqlite3_column_text(statement.Handle(), 0));
+  key.type = reinterpret_cast<const char *>(
+    sqlite3_column_text(statement.Handle(), 1));
+  return &key;
+}
+
+//////////////////////////////////////////////////
+void MsgIterPrivate::StepMerge()
+{
+  // Step the statement of the current message, the rows of the others are
+  // still valid
+  if (this->message)
+  {
+    std::pop_heap(this->mergeHeap.begin(), this->mergeHeap.end(),
+      std::greater<MergeHead>());
+    MergeHead &head = this->mergeHeap.back();
+    raii_sqlite3::Statement &current = *this->merged[head.index];
+
+    const int returnCode = sqlite3_step(current.Handle());
+    if (returnCode == SQLITE_ROW)
+    {
+      head.time = sqlite3_column_int64(current.Handle(), 1);
+      head.id = sqlite3_column_int64(current.Handle(), 0);
+      std::push_heap(this->mergeHeap.begin(), this->mergeHeap.end(),
+        std::greater<MergeHead>());
+    }
+    else
+    {
+      if (returnCode != SQLITE_DONE)
+      {
+        LERR("Failed to get message [" << returnCode << "]\n");
+      }
+      this->mergeHeap.pop_back();
+    }
+  }
+
+  if (this->mergeHeap.empty())
+  {
+    // Out of data
+    this->merged.clear();
+    return;
+  }
+
+  this->ReadRow(*this->merged[this->mergeHeap.front().index]);
+}
+
+//////////////////////////////////////////////////
+void MsgIterPrivate::StepSegmentMerge()
+{
+  // The iterators start at their first message, so the first step, made
+  // by the constructor of MsgIter, keeps them there
+  if (this->segmentsStarted)
+  {
+    if (!this->segmentHeap.empty())
+    {
+      std::pop_heap(this->segmentHeap.begin(), this->segmentHeap.end(),
+        std::greater<MergeHead>());
+      MergeHead &head = this->segmentHeap.back();
+      MsgIter &current = *this->segmentIters[head.index];
+      if (++current != *this->segmentEnd)
+      {
+        head.time = current->TimeReceived().count();
+        std::push_heap(this->segmentHeap.begin(), this->segmentHeap.end(),
+          std::greater<MergeHead>());
+      }
+      else
+      {
+        this->segmentHeap.pop_back();
+      }
+    }
+  }
+  this->segmentsStarted = true;
+
+  if (this->segmentHeap.empty())
+  {
+    // Out of data once the segments are reset, like with the statements
+    this->segmentIters.clear();
+    this->segments.reset();
+  }
 }
 
 //////////////////////////////////////////////////
 void MsgIterPrivate::StepStatement()
 {
-  if (this->statement)
+  if (this->cursor)
+  {
+    // Out of data once the cursor is reset, like with the statements
+    if (!this->cursor->Next(this->message))
+      this->cursor.reset();
+  }
+  else if (this->mergeSegments)
+  {
+    if (this->segments)
+      this->StepSegmentMerge();
+  }
+  else if (this->segments)
+  {
+    if (this->segmentIter && ++(*this->segmentIter) != *this->segmentEnd)
+      return;
+
+    // Move on to the next segment with messages
+    this->segmentIter.reset();
+    while (this->segmentIndex < this->segments->size())
+    {
+      Batch &batch = (*this->segments)[this->segmentIndex++];
+      std::unique_ptr<MsgIter> iter(new MsgIter(batch.begin()));
+      if (*iter != *this->segmentEnd)
+      {
+        this->segmentIter = std::move(iter);
+        return;
+      }
+    }
+
+    // Out of data once the segments are reset, like with the statements
+    this->segments.reset();
+  }
+  else if (!this->merged.empty())
+  {
+    this->StepMerge();
+  }
+  else if (this->statement)
   {
     // Get the results from the statement
     int returnCode = sqlite3_step(this->statement->Handle());
 
     if (returnCode == SQLITE_ROW)
     {
-      // TODO(anyone) get data and create message in the dereference operators
-      // Assumes statement has column order:
-      // messages id (0), timeRecv(1), topics name(2),
-      // message_type name(3), message data(4)
-      std::chrono::nanoseconds timeRecv;
-
-      // Time received
-      sqlite_int64 timeRecvInt = sqlite3_column_int64(
-          this->statement->Handle(), 1);
-      timeRecv = std::chrono::nanoseconds(timeRecvInt);
-
-      // Topic name
-      const unsigned char *topic = sqlite3_column_text(
-          this->statement->Handle(), 2);
-      std::size_t numTopic = sqlite3_column_bytes(
-          this->statement->Handle(), 2);
-
-      // Message type name
-      const unsigned char *type = sqlite3_column_text(
-          this->statement->Handle(), 3);
-      std::size_t numType = sqlite3_column_bytes(this->statement->Handle(), 3);
-
-      // Message data
-      const void *data = sqlite3_column_blob(this->statement->Handle(), 4);
-      std::size_t numData = sqlite3_column_bytes(this->statement->Handle(), 4);
-
-      this->message.reset(new Message(
-            timeRecv,
-            data, numData,
-            reinterpret_cast<const char*>(type), numType,
-            reinterpret_cast<const char*>(topic), numTopic));
+      this->ReadRow(*this->statement);
     }
     else
     {
@@ -225,7 +474,12 @@ bool MsgIter::operator==(const MsgIter &_other) const
 {
   // TODO(anyone) this won't work once this class has a proper copy constructor
   // It's only good enough to compare this with an empty iterator
-  return this->dataPtr->statement.get() == _other.dataPtr->statement.get();
+  return this->dataPtr->statement.get() == _other.dataPtr->statement.get() &&
+    this->dataPtr->cursor.get() == _other.dataPtr->cursor.get() &&
+    this->dataPtr->segmentIter.get() == _other.dataPtr->segmentIter.get() &&
+    this->dataPtr->segmentHeap.empty() ==
+      _other.dataPtr->segmentHeap.empty() &&
+    this->dataPtr->mergeHeap.empty() == _other.dataPtr->mergeHeap.empty();
 }
 
 //////////////////////////////////////////////////
@@ -237,11 +491,25 @@ bool MsgIter::operator!=(const MsgIter &_other) const
 //////////////////////////////////////////////////
 const Message &MsgIter::operator*() const
 {
+  if (this->dataPtr->segmentIter)
+    return **this->dataPtr->segmentIter;
+  if (!this->dataPtr->segmentHeap.empty())
+  {
+    return **this->dataPtr->segmentIters[
+      this->dataPtr->segmentHeap.front().index];
+  }
   return *this->dataPtr->message;
 }
 
 //////////////////////////////////////////////////
 const Message *MsgIter::operator->() const
 {
+  if (this->dataPtr->segmentIter)
+    return this->dataPtr->segmentIter->operator->();
+  if (!this->dataPtr->segmentHeap.empty())
+  {
+    return this->dataPtr->segmentIters[
+      this->dataPtr->segmentHeap.front().index]->operator->();
+  }
   return this->dataPtr->message.get();
 }
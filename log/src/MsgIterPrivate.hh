@@ -18,11 +18,20 @@
 #ifndef IGNITION_TRANSPORT_LOG_MSGITERPRIVATE_HH_
 #define IGNITION_TRANSPORT_LOG_MSGITERPRIVATE_HH_
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "ignition/transport/log/Batch.hh"
 #include "ignition/transport/log/Message.hh"
+#include "ignition/transport/log/MsgIter.hh"
 #include "ignition/transport/log/SqlStatement.hh"
+#include "ChunkedLog.hh"
+#include "Compression.hh"
+#include "Descriptor.hh"
 #include "raii-sqlite3.hh"
 
 using namespace ignition::transport;
@@ -46,8 +55,26 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
     /// \param[in] _db Shared reference to a database
     /// \param[in] _statements A set of SQL statements that this message will
     /// iterate through
+    /// \param[in] _merge True to merge the results of the statements, each
+    /// ordered by time received, instead of iterating them one after the
+    /// other
     public: MsgIterPrivate(const std::shared_ptr<raii_sqlite3::Database> &_db,
-        const std::shared_ptr<std::vector<SqlStatement>> &_statements);
+        const std::shared_ptr<std::vector<SqlStatement>> &_statements,
+        bool _merge = false);
+
+    /// \brief constructor
+    /// \param[in] _cursor Cursor through the messages of a chunked log
+    public: explicit MsgIterPrivate(
+        std::unique_ptr<ChunkedLogCursor> &&_cursor);  // NOLINT
+
+    /// \brief constructor
+    /// \param[in] _segments Batches of the segments of a log, iterated one
+    /// after the other
+    /// \param[in] _merge True to merge the batches by time received, for
+    /// the shards of a log
+    public: explicit MsgIterPrivate(
+        const std::shared_ptr<std::vector<Batch>> &_segments,
+        bool _merge = false);
 
     /// \brief destructor
     public: ~MsgIterPrivate();
@@ -59,6 +86,27 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
     /// \return true if the statement was sucessfully prepared
     public: bool PrepareNextStatement();
 
+    /// \brief Compiles a statement and binds its parameters
+    /// \param[in] _query The statement
+    /// \return The compiled statement, or nullptr on failure
+    public: std::unique_ptr<raii_sqlite3::Statement> PrepareStatement(
+        const SqlStatement &_query);
+
+    /// \brief Steps the merged statements once
+    public: void StepMerge();
+
+    /// \brief Steps the merged segments once
+    public: void StepSegmentMerge();
+
+    /// \brief Sets the message from the current row of a statement
+    /// \param[in] _statement A statement that returned a row
+    public: void ReadRow(raii_sqlite3::Statement &_statement);
+
+    /// \brief Get the names of a topic
+    /// \param[in] _id Id of the topic in the database
+    /// \return The names, or nullptr if the topic doesn't exist
+    public: const TopicKey *TopicOf(int64_t _id);
+
     /// \brief a statement that is being stepped
     public: std::unique_ptr<raii_sqlite3::Statement> statement;
 
@@ -71,8 +119,88 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
     /// \brief statements used to get messages from the database
     public: std::shared_ptr<std::vector<SqlStatement>> statements;
 
+    /// \brief statements merged by time received, all stepped at once
+    public: std::vector<std::unique_ptr<raii_sqlite3::Statement>> merged;
+
+    /// \brief A merged statement at a row
+    public: struct MergeHead
+    {
+      /// \brief Time received of the row
+      int64_t time;
+
+      /// \brief Message id of the row, to order the messages received at
+      /// the same time
+      int64_t id;
+
+      /// \brief Index of the statement in merged
+      std::size_t index;
+
+      /// \brief Comparison for a min-heap
+      /// \param[in] _other Another head
+      /// \return True if this head comes after the other
+      bool operator>(const MergeHead &_other) const
+      {
+        return time != _other.time ? time > _other.time : id > _other.id;
+      }
+    };
+
+    /// \brief min-heap of the merged statements at a row, the first one
+    /// holds the message this iterator is at
+    public: std::vector<MergeHead> mergeHeap;
+
+    /// \brief cursor stepped instead of the statements, for chunked logs
+    public: std::unique_ptr<ChunkedLogCursor> cursor;
+
+    /// \brief batches of the segments, stepped instead of the statements
+    public: std::shared_ptr<std::vector<Batch>> segments;
+
+    /// \brief which segment is the msg iterator iterating on
+    public: std::size_t segmentIndex = 0;
+
+    /// \brief iterator through the current segment, it holds the message
+    /// this iterator is at
+    public: std::unique_ptr<MsgIter> segmentIter;
+
+    /// \brief end of the iterators through the segments
+    public: std::unique_ptr<MsgIter> segmentEnd;
+
+    /// \brief true if the segments are merged by time received
+    public: bool mergeSegments = false;
+
+    /// \brief true once the merged segments were stepped, the first step
+    /// keeps them at their first message
+    public: bool segmentsStarted = false;
+
+    /// \brief iterators through the merged segments, by segment index
+    public: std::vector<std::unique_ptr<MsgIter>> segmentIters;
+
+    /// \brief min-heap of the merged segments at a message, by time
+    /// received then segment index. The first one holds the message this
+    /// iterator is at.
+    public: std::vector<MergeHead> segmentHeap;
+
     /// \brief the message this iterator is at
     public: std::unique_ptr<Message> message;
+
+    /// \brief dictionary of each compressed topic of the log, or nullptr
+    /// if it has none
+    public: std::shared_ptr<const TopicDictionaries> dictionaries;
+
+    /// \brief decompresses the messages of the compressed topics, created
+    /// on the first one
+    public: std::unique_ptr<BlobCodec> codec;
+
+    /// \brief names of the topics of the database, by id, which the
+    /// messages refer to
+    public: std::shared_ptr<const TopicNames> topicNames;
+
+    /// \brief names of the topics inserted after the query was made, read
+    /// from the database
+    public: std::map<int64_t, TopicKey> lateTopics;
+
+    /// \brief data of the message this iterator is at, if it was
+    /// decompressed
+    public: std::string decompressed;
   };
 }
 }
@@ -17,52 +17,131 @@
 
 #include <sqlite3.h>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <ignition/transport/Node.hh>
 #include <ignition/transport/log/Log.hh>
 #include <ignition/transport/log/Playback.hh>
 #include "Console.hh"
+#include "ReadAhead.hh"
 #include "build_config.hh"
 #include "raii-sqlite3.hh"
 
 using namespace ignition::transport;
 using namespace ignition::transport::log;
 
+/// \brief Number of messages published at once when the playback doesn't
+/// wait between messages
+static const std::size_t kPublishBatch = 64;
+
+/// \brief Maximum number of messages waiting for a publisher thread
+static const std::size_t kPublisherQueueMessages = 256;
+
+/// \brief Maximum bytes of the messages waiting for a publisher thread. A
+/// larger message is still handed over when the thread has none waiting.
+static const std::size_t kPublisherQueueBytes = 64 << 20;
+
+/// \brief Number of published messages kept by a publisher thread, for their
+/// memory to be reused
+static const std::size_t kPublisherSpares = 8;
+
+/// \brief How often an external clock is read while waiting for it
+static const std::chrono::milliseconds kClockPollPeriod(1);
+
+/// \brief Maximum number of messages read ahead of the playback, per log
+static const std::size_t kReadAheadMessages = 256;
+
+/// \brief Maximum bytes of the messages read ahead of the playback, shared
+/// by the logs
+static const std::size_t kReadAheadBytes = 64 << 20;
+
 // We check whether sqlite3 is potentially threadsafe. Note that this only
 // knows whether sqlite3 was compiled with multi-threading capabilities. It
 // might not catch changes to sqlite3's runtime settings.
 // See: https://www.sqlite.org/threadsafe.html
 static const bool kSqlite3Threadsafe = (sqlite3_threadsafe() != 0);
 
+//////////////////////////////////////////////////
+/// \brief Get the topics of several logs.
+/// \param[in] _logs The logs.
+/// \return The topics found in any of the logs.
+static std::unordered_set<std::string> TopicsOf(
+    const std::vector<std::shared_ptr<Log>> &_logs)
+{
+  std::unordered_set<std::string> topics;
+  for (const auto &logFile : _logs)
+  {
+    for (const auto &entry : logFile->Descriptor()->TopicsToMsgTypesToId())
+      topics.insert(entry.first);
+  }
+  return topics;
+}
+
 //////////////////////////////////////////////////
 /// \brief Private implementation of Playback
 class ignition::transport::log::Playback::Implementation
 {
-  /// \brief Constructor. Creates and initializes the log file
-  /// \param[in] _file The full path of the file to open
+  /// \brief Constructor. Opens the log files
+  /// \param[in] _files The full paths of the files to open
   public: Implementation(
-    const std::string &_file, const NodeOptions &_nodeOptions)
-    : logFile(std::make_shared<Log>()),
-      addTopicWasUsed(false),
+    const std::vector<std::string> &_files, const NodeOptions &_nodeOptions)
+    : addTopicWasUsed(false),
       nodeOptions(_nodeOptions)
   {
-    if (!this->logFile->Open(_file, std::ios_base::in))
+    if (_files.empty())
+      LERR("No log file to play back\n");
+
+    for (const std::string &file : _files)
     {
-      LERR("Could not open file [" << _file << "]\n");
+      auto logFile = std::make_shared<Log>();
+      if (!logFile->Open(file, std::ios_base::in,
+            LogOpenOptions::ReadOptimized()))
+      {
+        LERR("Could not open file [" << file << "]\n");
+      }
+      else
+      {
+        LDBG("Playback opened file [" << file << "]\n");
+      }
+      this->logFiles.push_back(logFile);
     }
-    else
+  }
+
+  /// \brief Check whether every log file was opened.
+  /// \return True if there are log files and they are valid.
+  public: bool Valid() const
+  {
+    for (const auto &logFile : this->logFiles)
     {
-      LDBG("Playback opened file [" << _file << "]\n");
+      if (!logFile->Valid())
+        return false;
     }
+    return !this->logFiles.empty();
   }
 
   /// \brief This gets used by RemoveTopic(~) to make sure we follow the correct
@@ -71,18 +150,15 @@ class ignition::transport::log::Playback::Implementation
   {
     if (!this->addTopicWasUsed)
     {
-      const Descriptor *desc = this->logFile->Descriptor();
-      const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
-      for (const auto &entry : allTopics)
-        this->topicNames.insert(entry.first);
+      this->topicNames = TopicsOf(this->logFiles);
 
       // Topics have been set, so we change this flag to true
       this->addTopicWasUsed = true;
     }
   }
 
-  /// \brief log file to play from
-  public: std::shared_ptr<Log> logFile;
+  /// \brief log files to play from, merged into one timeline
+  public: std::vector<std::shared_ptr<Log>> logFiles;
 
   /// \brief topics that are being played back
   public: std::unordered_set<std::string> topicNames;
@@ -97,6 +173,25 @@ class ignition::transport::log::Playback::Implementation
 
   /// \brief The node options.
   public: NodeOptions nodeOptions;
+
+  /// \brief See Playback::SetPublisherThreads().
+  public: std::size_t publisherThreads = 0;
+
+  /// \brief See Playback::SetExpectedSubscribers().
+  public: std::set<std::string> expectedSubscribers;
+
+  /// \brief Thread publishing each topic, see
+  /// Playback::SetTopicPublisherThread().
+  public: std::map<std::string, std::size_t> topicPublisherThreads;
+
+  /// \brief See Playback::SetFanOut().
+  public: std::vector<NodeOptions> fanOut;
+
+  /// \brief Callbacks of each topic, see Playback::AddDirectSubscriber().
+  public: std::map<std::string, std::vector<RawCallback>> directSubscribers;
+
+  /// \brief See Playback::SetSynchronous().
+  public: bool synchronous = false;
 };
 
 //////////////////////////////////////////////////
@@ -104,35 +199,136 @@ class ignition::transport::log::Playback::Implementation
 class PlaybackHandle::Implementation
 {
   /// \brief Constructor
-  /// \param[in] _logFile A reference to the Log instance
+  /// \param[in] _logFiles The Log instances, merged into one timeline
   /// \param[in] _topics A set of all topics to publish
   /// \param[in] _waitAfterAdvertising How long to wait after advertising the
-  /// topics
+  /// topics, at most if some subscribers are expected
   /// \param[in] _msgWaiting True to wait between publication of
   /// messages based on the message timestamps. False to playback
   /// messages as fast as possible. Default value is true.
+  /// \param[in] _nodeOptions Options of each node publishing the topics.
+  /// \param[in] _fanOut True if the nodes are the fan-out of the playback,
+  /// whose namespaces apply to the topics.
+  /// \param[in] _clock Clock pacing the playback, nullptr for the steady
+  /// clock.
+  /// \param[in] _publisherThreads Number of threads publishing the messages,
+  /// see Playback::SetPublisherThreads().
+  /// \param[in] _topicPublisherThreads Thread chosen for some topics.
+  /// \param[in] _expectedSubscribers Topics whose subscribers are waited
+  /// for, see Playback::SetExpectedSubscribers().
+  /// \param[in] _directSubscribers Callbacks of each topic, see
+  /// Playback::AddDirectSubscriber(). Empty to publish the messages.
+  /// \param[in] _synchronous True to play back from the constructor, see
+  /// Playback::SetSynchronous().
   public: Implementation(
-      const std::shared_ptr<Log> &_logFile,
+      const std::vector<std::shared_ptr<Log>> &_logFiles,
       const std::unordered_set<std::string> &_topics,
       const std::chrono::nanoseconds &_waitAfterAdvertising,
-      const NodeOptions &_nodeOptions,
-      bool _msgWaiting);
+      const std::vector<NodeOptions> &_nodeOptions,
+      bool _fanOut,
+      bool _msgWaiting,
+      const Clock *_clock,
+      std::size_t _publisherThreads,
+      const std::map<std::string, std::size_t> &_topicPublisherThreads,
+      const std::set<std::string> &_expectedSubscribers,
+      const std::map<std::string, std::vector<RawCallback>>
+        &_directSubscribers,
+      bool _synchronous);
+
+  /// \brief The direct subscribers of a topic played back.
+  public: struct DirectTopic
+  {
+    /// \brief Callbacks, in the order they were added
+    std::vector<RawCallback> callbacks;
+
+    /// \brief Information of the messages of each type of the topic
+    std::unordered_map<std::string, MessageInfo> infos;
+  };
+
+  /// \brief A thread publishing the messages of some topics, which the
+  /// playback thread hands over when they are due.
+  public: struct PublisherThread
+  {
+    /// \brief Messages waiting to be published, in order
+    std::deque<ReadAhead::Entry> queue;
+
+    /// \brief Bytes of data of the queued messages
+    std::size_t queuedBytes = 0;
+
+    /// \brief Published messages, whose memory is reused
+    std::vector<ReadAhead::Entry> spares;
+
+    /// \brief True while a message taken from the queue is published
+    bool publishing = false;
+
+    /// \brief Protects the members above
+    std::mutex mutex;
+
+    /// \brief Notified when a message is queued or published, or when the
+    /// playback stops
+    std::condition_variable condVar;
+
+    /// \brief The thread
+    std::thread thread;
+  };
+
+  /// \brief Create the publisher threads and choose the thread of each
+  /// topic.
+  /// \param[in] _count Number of threads.
+  /// \param[in] _assigned Thread chosen for some topics.
+  public: void CreatePublisherThreads(std::size_t _count,
+      const std::map<std::string, std::size_t> &_assigned);
+
+  /// \brief Function of a publisher thread.
+  /// \param[in] _thread The thread.
+  public: void RunPublisherThread(PublisherThread &_thread);
+
+  /// \brief Wait until the publisher threads have published every message
+  /// handed over, or until the playback stops.
+  public: void WaitForPublisherThreads();
+
+  /// \brief Publish the next message of the read-ahead queue, or hand it
+  /// over to the thread of its topic. Must be called with batchMutex locked.
+  /// \param[in] _msg The next message of the read-ahead queue.
+  public: void PublishFront(const ReadAhead::Entry &_msg);
+
+  /// \brief Publish a message.
+  /// \param[in] _msg The message.
+  public: void Publish(const ReadAhead::Entry &_msg);
 
   /// \brief Look through the types of data that _topic can publish and create
   /// a publisher for each type.
   /// \param[in] _topic Name of the topic to publish
   public: void AddTopic(const std::string &_topic);
 
-  /// \brief Create a publisher of a given topic name and type
+  /// \brief Create a publisher of a given topic name and type on each node
   /// \param[in] _topic Topic name to publish to
   /// \param[in] _type The message type name to publish
   public: void CreatePublisher(
       const std::string &_topic,
       const std::string &_type);
 
-  /// \brief Begin playing messages in another thread
+  /// \brief Deliver the messages of a topic to its direct subscribers.
+  /// \param[in] _topic Name of the topic.
+  /// \param[in] _callbacks The callbacks of the topic.
+  public: void AddDirectTopic(const std::string &_topic,
+      const std::vector<RawCallback> &_callbacks);
+
+  /// \brief Wait until each of some topics played back has subscribers.
+  /// \param[in] _topics The topics. The ones that aren't played back are
+  /// ignored.
+  /// \param[in] _timeout Longest wait.
+  public: void WaitForSubscribers(const std::set<std::string> &_topics,
+      const std::chrono::nanoseconds &_timeout);
+
+  /// \brief Begin playing messages in another thread, or in this one if
+  /// the playback is synchronous
   public: void StartPlayback();
 
+  /// \brief Play the messages until the end of the logs or until the
+  /// playback stops.
+  public: void Play();
+
   /// \brief Stop the playback
   public: void Stop();
 
@@ -145,6 +341,34 @@ class PlaybackHandle::Implementation
   /// \param[in] _newElapsedTime Elapsed time at which playback will jump
   public: void Seek(const std::chrono::nanoseconds &_newElapsedTime);
 
+  /// \brief Check whether there are messages left to play, waiting for the
+  /// read-ahead thread if it's behind.
+  /// \return True if there is a next message
+  public: bool HasNextMessage();
+
+  /// \brief Start reading the messages of the tracked topics ahead of the
+  /// playback, from every log, merged by the time they were received.
+  /// \param[in] _start Time of the first message, indeterminate to start
+  /// from the beginning of the logs.
+  /// \return The read-ahead queue.
+  public: std::unique_ptr<MergedReadAhead> ReadFrom(
+      const QualifiedTime &_start);
+
+  /// \brief Start reading the messages of the tracked topics of a log
+  /// ahead of the playback. The log is queried one window of its seek
+  /// index at a time, so that the first messages are found without sorting
+  /// the messages until the end of the log.
+  /// \param[in] _log Index of the log.
+  /// \param[in] _start Time of the first message, indeterminate to start
+  /// from the beginning of the log.
+  /// \return The read-ahead queue.
+  public: std::unique_ptr<ReadAhead> ReadLogFrom(std::size_t _log,
+      const QualifiedTime &_start);
+
+  /// \brief Check whether every log is valid.
+  /// \return True if the logs can be played back.
+  public: bool Valid() const;
+
   /// \brief Puts the calling thread to sleep until a given time is achieved.
   /// \param[in] _targetTime Time at which the wait must finish. Measured in
   /// POSIX time (time since epoch) in nanoseconds
@@ -152,6 +376,23 @@ class PlaybackHandle::Implementation
   /// stop event interrupt it
   public: bool WaitUntil(const std::chrono::nanoseconds &_targetTime);
 
+  /// \brief Puts the calling thread to sleep until the external clock
+  /// reaches a given time.
+  /// \param[in] _targetTime Time at which the wait must finish, on the
+  /// clock.
+  /// \return True if the wait ends successfully or false if a pause or
+  /// stop event interrupt it
+  public: bool WaitForClock(const std::chrono::nanoseconds &_targetTime);
+
+  /// \brief Get the current time of the realtime frame.
+  /// \return The time of the external clock, or of the steady clock.
+  public: std::chrono::nanoseconds Now() const;
+
+  /// \brief Add the delay of a message published to the jitter statistics.
+  /// \param[in] _targetTime Time at which the message was due, in the
+  /// realtime frame.
+  public: void RecordJitter(const std::chrono::nanoseconds &_targetTime);
+
   /// \brief Pauses the playback
   public: void Pause();
 
@@ -161,19 +402,31 @@ class PlaybackHandle::Implementation
   /// \brief Check pause status
   public: bool IsPaused() const;
 
+  /// \brief Convert a duration of the playback frame to the realtime frame.
+  /// \param[in] _duration Duration in the playback frame.
+  /// \param[in] _rate Rate of the playback.
+  /// \return Duration in the realtime frame, zero for an unbounded rate.
+  public: static std::chrono::nanoseconds RealDuration(
+      const std::chrono::nanoseconds &_duration, double _rate);
+
   /// \brief Wait until playback has finished playing
   public: void WaitUntilFinished();
 
-  /// \brief node used to create publishers
+  /// \brief nodes used to create publishers, one per partition or namespace
+  /// of the fan-out
   /// \note This member needs to come before the publishers member so that they
   /// get destructed in the correct order
-  public: std::unique_ptr<ignition::transport::Node> node;
+  public: std::vector<std::unique_ptr<ignition::transport::Node>> nodes;
 
   /// \brief Map whose key is a topic name and value is another map whose
-  /// key is a message type name and value is a publisher
+  /// key is a message type name and value is the publisher of each node
   public: std::unordered_map<std::string,
           std::unordered_map<std::string,
-            ignition::transport::Node::Publisher>> publishers;
+            std::vector<ignition::transport::Node::Publisher>>> publishers;
+
+  /// \brief Direct subscribers of each topic, see
+  /// Playback::AddDirectSubscriber(). They are only added before playing.
+  public: std::unordered_map<std::string, DirectTopic> directTopics;
 
   /// \brief a mutex to use when waiting for playback to finish
   public: std::mutex waitMutex;
@@ -224,8 +477,8 @@ class PlaybackHandle::Implementation
   /// \brief thread running playback
   public: std::thread playbackThread;
 
-  /// \brief log file to play from
-  public: std::shared_ptr<Log> logFile;
+  /// \brief log files to play from, merged into one timeline
+  public: const std::vector<std::shared_ptr<Log>> logFiles;
 
   /// \brief List of topics currently tracked
   public: const std::unordered_set<std::string> trackedTopics;
@@ -233,27 +486,72 @@ class PlaybackHandle::Implementation
   /// \brief mutex for thread safety with log file
   public: std::mutex logFileMutex;
 
-  // \brief Set of messages to be played-back
-  public: Batch batch;
+  /// \brief Times splitting each log into windows, see Log::SeekIndex()
+  public: const std::vector<std::vector<std::chrono::nanoseconds>>
+          seekIndexes;
 
-  // \brief Mutex to operate the batch variable in a thread-safe way
-  public: std::mutex batchMutex;
+  // \brief Messages to be played-back, read from the logs in the background
+  // ahead of the playback so that they are published from memory
+  public: std::unique_ptr<MergedReadAhead> readAhead;
 
-  // \brief Iterator to loop over the messages found in batch
-  public: Batch::iterator messageIter;
+  // \brief Mutex to operate the readAhead variable in a thread-safe way
+  public: std::mutex batchMutex;
 
   // \brief The wall clock time of the first message in batch
   public: const std::chrono::nanoseconds firstMessageTime;
 
-  /// \brief True to wait between publication of
-  /// messages based on the message timestamps. False to playback
-  /// messages as fast as possible.
-  public: bool msgWaiting = true;
+  /// \brief Multiplier of the speed of the playback, infinity to play
+  /// back the messages as fast as possible.
+  public: std::atomic<double> rate;
+
+  /// \brief How long before the time of a message WaitUntil() spins
+  public: std::atomic<int64_t> spinThreshold{0};
+
+  /// \brief Sum of the delays of the messages measured (ns), protected by
+  /// jitterMutex
+  public: double jitterSum = 0;
+
+  /// \brief See PlaybackHandle::JitterStats(), protected by jitterMutex
+  public: PlaybackJitterStats jitter;
+
+  /// \brief Mutex protecting the jitter statistics
+  public: mutable std::mutex jitterMutex;
+
+  /// \brief Clock pacing the playback, nullptr for the steady clock
+  public: const Clock *clock = nullptr;
+
+  /// \brief True if the nodes are the fan-out of the playback, see
+  /// Playback::SetFanOut()
+  public: const bool fanOut = false;
+
+  /// \brief True if the messages go to the direct subscribers instead of
+  /// nodes
+  public: const bool direct = false;
+
+  /// \brief True if the playback runs from the constructor, see
+  /// Playback::SetSynchronous()
+  public: const bool synchronous = false;
+
+  /// \brief Threads publishing the messages, empty to publish them from
+  /// playbackThread
+  public: std::vector<std::unique_ptr<PublisherThread>> publisherThreads;
+
+  /// \brief Thread publishing each topic. The topics that aren't listed are
+  /// published by playbackThread.
+  public: std::unordered_map<std::string, PublisherThread *> topicThreads;
 };
 
 //////////////////////////////////////////////////
 Playback::Playback(const std::string &_file, const NodeOptions &_nodeOptions)
-  : dataPtr(new Implementation(_file, _nodeOptions))
+  : dataPtr(new Implementation({_file}, _nodeOptions))
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+Playback::Playback(const std::vector<std::string> &_files,
+    const NodeOptions &_nodeOptions)
+  : dataPtr(new Implementation(_files, _nodeOptions))
 {
   // Do nothing
 }
@@ -276,7 +574,27 @@ PlaybackHandlePtr Playback::Start(
     const std::chrono::nanoseconds &_waitAfterAdvertising,
     bool _msgWaiting) const
 {
-  if (!this->dataPtr->logFile->Valid())
+  return this->StartPlayback(_waitAfterAdvertising, _msgWaiting, nullptr);
+}
+
+//////////////////////////////////////////////////
+PlaybackHandlePtr Playback::Start(const Clock *_clock,
+    const std::chrono::nanoseconds &_waitAfterAdvertising) const
+{
+  if (!_clock)
+  {
+    LERR("Could not start: No clock\n");
+    return nullptr;
+  }
+  return this->StartPlayback(_waitAfterAdvertising, true, _clock);
+}
+
+//////////////////////////////////////////////////
+PlaybackHandlePtr Playback::StartPlayback(
+    const std::chrono::nanoseconds &_waitAfterAdvertising,
+    bool _msgWaiting, const Clock *_clock) const
+{
+  if (!this->dataPtr->Valid())
   {
     LERR("Could not start: Failed to open log file\n");
     return nullptr;
@@ -299,21 +617,38 @@ PlaybackHandlePtr Playback::Start(
   if (!this->dataPtr->addTopicWasUsed)
   {
     LDBG("No topics added, defaulting to all topics\n");
-    const Descriptor *desc = this->dataPtr->logFile->Descriptor();
-    const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
-    for (const auto &entry : allTopics)
-      topics.insert(entry.first);
+    topics = TopicsOf(this->dataPtr->logFiles);
   }
   else
   {
     topics = this->dataPtr->topicNames;
   }
 
+  // The direct subscribers replace the publications
+  const auto &direct = this->dataPtr->directSubscribers;
+  if (!direct.empty())
+  {
+    for (auto topicIter = topics.begin(); topicIter != topics.end();)
+    {
+      if (direct.find(*topicIter) == direct.end())
+        topicIter = topics.erase(topicIter);
+      else
+        ++topicIter;
+    }
+  }
+
   PlaybackHandlePtr newHandle(
         new PlaybackHandle(
           std::make_unique<PlaybackHandle::Implementation>(
-            this->dataPtr->logFile, topics, _waitAfterAdvertising,
-            this->dataPtr->nodeOptions, _msgWaiting)));
+            this->dataPtr->logFiles, topics, _waitAfterAdvertising,
+            this->dataPtr->fanOut.empty() ?
+              std::vector<NodeOptions>{this->dataPtr->nodeOptions} :
+              this->dataPtr->fanOut,
+            !this->dataPtr->fanOut.empty(), _msgWaiting, _clock,
+            this->dataPtr->publisherThreads,
+            this->dataPtr->topicPublisherThreads,
+            this->dataPtr->expectedSubscribers, direct,
+            this->dataPtr->synchronous)));
 
   // We only need to store this if sqlite3 was not compiled in threadsafe mode.
   if (!kSqlite3Threadsafe)
@@ -325,7 +660,7 @@ PlaybackHandlePtr Playback::Start(
 //////////////////////////////////////////////////
 bool Playback::Valid() const
 {
-  return this->dataPtr->logFile->Valid();
+  return this->dataPtr->Valid();
 }
 
 //////////////////////////////////////////////////
@@ -336,17 +671,15 @@ bool Playback::AddTopic(const std::string &_topic)
   // specify which topics to publish.
   this->dataPtr->addTopicWasUsed = true;
 
-  if (!this->dataPtr->logFile->Valid())
+  if (!this->dataPtr->Valid())
   {
     LERR("Failed to open log file\n");
     return false;
   }
 
-  const Descriptor *desc = this->dataPtr->logFile->Descriptor();
-  const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
-
-  const Descriptor::NameToMap::const_iterator it = allTopics.find(_topic);
-  if (it == allTopics.end())
+  const std::unordered_set<std::string> allTopics =
+    TopicsOf(this->dataPtr->logFiles);
+  if (allTopics.find(_topic) == allTopics.end())
   {
     LWRN("Topic [" << _topic << "] is not in the log\n");
     return false;
@@ -365,19 +698,15 @@ int64_t Playback::AddTopic(const std::regex &_topic)
   // specify which topics to publish.
   this->dataPtr->addTopicWasUsed = true;
 
-  if (!this->dataPtr->logFile->Valid())
+  if (!this->dataPtr->Valid())
   {
     LERR("Failed to open log file\n");
     return -1;
   }
 
   int64_t numMatches = 0;
-  const Descriptor *desc = this->dataPtr->logFile->Descriptor();
-  const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
-
-  for (const auto &topicEntry : allTopics)
+  for (const std::string &topic : TopicsOf(this->dataPtr->logFiles))
   {
-    const std::string &topic = topicEntry.first;
     if (!std::regex_match(topic, _topic))
       continue;
 
@@ -420,33 +749,166 @@ int64_t Playback::RemoveTopic(const std::regex &_topic)
   return count;
 }
 
+//////////////////////////////////////////////////
+void Playback::SetPublisherThreads(std::size_t _count)
+{
+  this->dataPtr->publisherThreads = _count;
+}
+
+//////////////////////////////////////////////////
+std::size_t Playback::PublisherThreads() const
+{
+  return this->dataPtr->publisherThreads;
+}
+
+//////////////////////////////////////////////////
+void Playback::SetExpectedSubscribers(const std::set<std::string> &_topics)
+{
+  this->dataPtr->expectedSubscribers = _topics;
+}
+
+//////////////////////////////////////////////////
+const std::set<std::string> &Playback::ExpectedSubscribers() const
+{
+  return this->dataPtr->expectedSubscribers;
+}
+
+//////////////////////////////////////////////////
+bool Playback::SetTopicPublisherThread(const std::string &_topic,
+    std::size_t _thread)
+{
+  if (_thread >= this->dataPtr->publisherThreads)
+  {
+    LERR("There's no publisher thread [" << _thread << "]\n");
+    return false;
+  }
+
+  this->dataPtr->topicPublisherThreads[_topic] = _thread;
+  return true;
+}
+
+//////////////////////////////////////////////////
+void Playback::SetFanOut(const std::vector<NodeOptions> &_nodeOptions)
+{
+  this->dataPtr->fanOut = _nodeOptions;
+}
+
+//////////////////////////////////////////////////
+const std::vector<NodeOptions> &Playback::FanOut() const
+{
+  return this->dataPtr->fanOut;
+}
+
+//////////////////////////////////////////////////
+bool Playback::AddDirectSubscriber(const std::string &_topic,
+    const RawCallback &_callback)
+{
+  if (!this->dataPtr->Valid())
+  {
+    LERR("Failed to open log file\n");
+    return false;
+  }
+
+  if (!_callback)
+  {
+    LERR("No callback for the direct subscriber of [" << _topic << "]\n");
+    return false;
+  }
+
+  const std::unordered_set<std::string> allTopics =
+    TopicsOf(this->dataPtr->logFiles);
+  if (allTopics.find(_topic) == allTopics.end())
+  {
+    LWRN("Topic [" << _topic << "] is not in the log\n");
+    return false;
+  }
+
+  this->dataPtr->directSubscribers[_topic].push_back(_callback);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void Playback::SetSynchronous(bool _synchronous)
+{
+  this->dataPtr->synchronous = _synchronous;
+}
+
+//////////////////////////////////////////////////
+bool Playback::Synchronous() const
+{
+  return this->dataPtr->synchronous;
+}
+
 //////////////////////////////////////////////////
 PlaybackHandle::Implementation::Implementation(
-    const std::shared_ptr<Log> &_logFile,
+    const std::vector<std::shared_ptr<Log>> &_logFiles,
     const std::unordered_set<std::string> &_topics,
     const std::chrono::nanoseconds &_waitAfterAdvertising,
-    const NodeOptions &_nodeOptions,
-    bool _msgWaiting)
+    const std::vector<NodeOptions> &_nodeOptions,
+    bool _fanOut,
+    bool _msgWaiting,
+    const Clock *_clock,
+    std::size_t _publisherThreads,
+    const std::map<std::string, std::size_t> &_topicPublisherThreads,
+    const std::set<std::string> &_expectedSubscribers,
+    const std::map<std::string, std::vector<RawCallback>> &_directSubscribers,
+    bool _synchronous)
   : stop(true),
     finished(false),
     paused(false),
-    logFile(_logFile),
+    logFiles(_logFiles),
     trackedTopics(_topics),
-    batch(logFile->QueryMessages(TopicList::Create(_topics))),
-    messageIter(batch.begin()),
-    firstMessageTime(messageIter->TimeReceived()),
-    msgWaiting(_msgWaiting)
+    seekIndexes([&_logFiles]()
+      {
+        std::vector<std::vector<std::chrono::nanoseconds>> indexes;
+        for (const auto &logFile : _logFiles)
+          indexes.push_back(logFile->SeekIndex());
+        return indexes;
+      }()),
+    readAhead(this->ReadFrom(QualifiedTime())),
+    firstMessageTime(readAhead->Front() ? readAhead->Front()->time :
+      std::chrono::nanoseconds::zero()),
+    rate(_msgWaiting ? 1.0 : std::numeric_limits<double>::infinity()),
+    clock(_clock),
+    fanOut(_fanOut),
+    direct(!_directSubscribers.empty()),
+    synchronous(_synchronous && !_directSubscribers.empty())
 {
-  this->node.reset(new transport::Node(_nodeOptions));
-
-  for (const std::string &topic : _topics)
+  if (this->direct)
   {
-    this->AddTopic(topic);
+    // Nothing is advertised, so the playback doesn't wait for discovery
+    for (const std::string &topic : _topics)
+    {
+      const auto found = _directSubscribers.find(topic);
+      if (found != _directSubscribers.end())
+        this->AddDirectTopic(topic, found->second);
+    }
+  }
+  else
+  {
+    for (const NodeOptions &nodeOptions : _nodeOptions)
+      this->nodes.push_back(std::make_unique<transport::Node>(nodeOptions));
+
+    for (const std::string &topic : _topics)
+    {
+      this->AddTopic(topic);
+    }
   }
 
-  std::this_thread::sleep_for(_waitAfterAdvertising);
+  if (this->synchronous)
+    this->rate = std::numeric_limits<double>::infinity();
+  else
+    this->CreatePublisherThreads(_publisherThreads, _topicPublisherThreads);
+
+  if (!this->direct)
+  {
+    if (_expectedSubscribers.empty())
+      std::this_thread::sleep_for(_waitAfterAdvertising);
+    else
+      this->WaitForSubscribers(_expectedSubscribers, _waitAfterAdvertising);
+  }
 
-  if (this->batch.begin() == this->batch.end())
+  if (!this->readAhead->Front())
   {
     LWRN("There are no messages to play\n");
   }
@@ -454,19 +916,105 @@ PlaybackHandle::Implementation::Implementation(
   this->StartPlayback();
 }
 
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::WaitForSubscribers(
+    const std::set<std::string> &_topics,
+    const std::chrono::nanoseconds &_timeout)
+{
+  // Types of each topic, of each node, whose publisher has subscribers.
+  // The matched callbacks may still run once the wait is over, so they
+  // share it.
+  using NodeTopic = std::pair<std::size_t, std::string>;
+  struct Matches
+  {
+    std::mutex mutex;
+    std::condition_variable condVar;
+    std::map<NodeTopic, std::set<std::string>> matched;
+  };
+  auto matches = std::make_shared<Matches>();
+
+  std::vector<Node::Publisher *> watched;
+  std::size_t expected = 0;
+  for (const std::string &topic : _topics)
+  {
+    auto topicIter = this->publishers.find(topic);
+    if (topicIter == this->publishers.end())
+      continue;
+
+    expected += this->nodes.size();
+    for (auto &typeEntry : topicIter->second)
+    {
+      const std::string type = typeEntry.first;
+      for (std::size_t i = 0; i < typeEntry.second.size(); ++i)
+      {
+        const NodeTopic key(i, topic);
+        typeEntry.second[i].SetMatchedCallback(
+          [matches, key, type](const bool _matched)
+          {
+            std::lock_guard<std::mutex> lock(matches->mutex);
+            if (_matched)
+            {
+              matches->matched[key].insert(type);
+            }
+            else
+            {
+              auto matchIter = matches->matched.find(key);
+              if (matchIter != matches->matched.end() &&
+                  matchIter->second.erase(type) > 0 &&
+                  matchIter->second.empty())
+              {
+                matches->matched.erase(matchIter);
+              }
+            }
+            matches->condVar.notify_all();
+          });
+        watched.push_back(&typeEntry.second[i]);
+      }
+    }
+  }
+
+  if (expected == 0)
+  {
+    LWRN("None of the topics expected to have subscribers is played back\n");
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(matches->mutex);
+    if (!matches->condVar.wait_for(lock, _timeout, [&matches, expected]
+        {
+          return matches->matched.size() == expected;
+        }))
+    {
+      LWRN("Timed out waiting for the subscribers of " << expected -
+           matches->matched.size() << " topic(s), starting anyway\n");
+    }
+  }
+
+  for (Node::Publisher *publisher : watched)
+    publisher->SetMatchedCallback(nullptr);
+}
+
 //////////////////////////////////////////////////
 void PlaybackHandle::Implementation::AddTopic(
     const std::string &_topic)
 {
-  const Descriptor *desc = this->logFile->Descriptor();
-  const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
-
-  const Descriptor::NameToMap::const_iterator it = allTopics.find(_topic);
-  for (const auto &typeEntry : it->second)
+  // The logs may have recorded the topic with different types
+  for (const auto &logFile : this->logFiles)
   {
-    const std::string &type = typeEntry.first;
-    LDBG("Playing back [" << _topic << "] : [" << type << "]\n");
-    this->CreatePublisher(_topic, type);
+    const Descriptor *desc = logFile->Descriptor();
+    const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
+
+    const Descriptor::NameToMap::const_iterator it = allTopics.find(_topic);
+    if (it == allTopics.end())
+      continue;
+
+    for (const auto &typeEntry : it->second)
+    {
+      const std::string &type = typeEntry.first;
+      LDBG("Playing back [" << _topic << "] : [" << type << "]\n");
+      this->CreatePublisher(_topic, type);
+    }
   }
 }
 
@@ -480,7 +1028,7 @@ void PlaybackHandle::Implementation::CreatePublisher(
   {
     // Create a map for the message topic
     this->publishers[_topic] = std::unordered_map<std::string,
-      ignition::transport::Node::Publisher>();
+      std::vector<ignition::transport::Node::Publisher>>();
     firstMapIter = this->publishers.find(_topic);
   }
 
@@ -492,15 +1040,214 @@ void PlaybackHandle::Implementation::CreatePublisher(
     return;
   }
 
-  // Create a publisher for the topic and type combo
-  firstMapIter->second[_type] = this->node->Advertise(_topic, _type);
+  // Create a publisher for the topic and type combo on each node. The
+  // topics of the fan-out are played back under the namespace of each node,
+  // e.g. /foo as /ns/foo.
+  auto &typePublishers = firstMapIter->second[_type];
+  for (const auto &node : this->nodes)
+  {
+    const bool relative = this->fanOut && !node->Options().NameSpace().empty()
+      && !_topic.empty() && _topic.front() == '/';
+    typePublishers.push_back(
+      node->Advertise(relative ? _topic.substr(1) : _topic, _type));
+  }
   LDBG("Creating publisher for " << _topic << " " << _type << "\n");
 }
 
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::AddDirectTopic(
+    const std::string &_topic, const std::vector<RawCallback> &_callbacks)
+{
+  // The information of the messages is the same for every message of a
+  // type, so it's only set once
+  DirectTopic &directTopic = this->directTopics[_topic];
+  directTopic.callbacks = _callbacks;
+  for (const auto &logFile : this->logFiles)
+  {
+    const Descriptor::NameToMap &allTopics =
+      logFile->Descriptor()->TopicsToMsgTypesToId();
+    const Descriptor::NameToMap::const_iterator it = allTopics.find(_topic);
+    if (it == allTopics.end())
+      continue;
+
+    for (const auto &typeEntry : it->second)
+    {
+      MessageInfo &info = directTopic.infos[typeEntry.first];
+      info.SetTopic(_topic);
+      info.SetType(typeEntry.first);
+      info.SetIntraProcess(true);
+      LDBG("Delivering [" << _topic << "] : [" << typeEntry.first << "]\n");
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::CreatePublisherThreads(
+    std::size_t _count, const std::map<std::string, std::size_t> &_assigned)
+{
+  if (_count == 0)
+    return;
+
+  for (std::size_t i = 0; i < _count; ++i)
+    this->publisherThreads.push_back(std::make_unique<PublisherThread>());
+
+  std::vector<bool> hasAssigned(_count, false);
+  for (const auto &assigned : _assigned)
+  {
+    if (assigned.second >= _count ||
+        this->trackedTopics.find(assigned.first) == this->trackedTopics.end())
+    {
+      continue;
+    }
+    this->topicThreads[assigned.first] =
+      this->publisherThreads[assigned.second].get();
+    hasAssigned[assigned.second] = true;
+  }
+
+  std::vector<PublisherThread *> shared;
+  for (std::size_t i = 0; i < _count; ++i)
+  {
+    if (!hasAssigned[i])
+      shared.push_back(this->publisherThreads[i].get());
+  }
+  if (shared.empty())
+  {
+    for (const auto &thread : this->publisherThreads)
+      shared.push_back(thread.get());
+  }
+
+  // Sorted, so that the topics are spread the same way every time
+  const std::set<std::string> sorted(
+    this->trackedTopics.begin(), this->trackedTopics.end());
+  std::size_t next = 0;
+  for (const std::string &topic : sorted)
+  {
+    if (this->topicThreads.find(topic) != this->topicThreads.end())
+      continue;
+    this->topicThreads[topic] = shared[next];
+    next = (next + 1) % shared.size();
+  }
+
+  for (const auto &thread : this->publisherThreads)
+  {
+    PublisherThread *threadPtr = thread.get();
+    thread->thread = std::thread([this, threadPtr]()
+      {
+        this->RunPublisherThread(*threadPtr);
+      });
+  }
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::RunPublisherThread(
+    PublisherThread &_thread)
+{
+  ReadAhead::Entry msg;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(_thread.mutex);
+      if (_thread.publishing)
+      {
+        // Keep the memory of the message that was published
+        _thread.publishing = false;
+        if (_thread.spares.size() < kPublisherSpares)
+          _thread.spares.push_back(std::move(msg));
+        _thread.condVar.notify_all();
+      }
+
+      _thread.condVar.wait(lock, [this, &_thread]
+        {
+          return this->stop || !_thread.queue.empty();
+        });
+      if (this->stop)
+        return;
+
+      msg = std::move(_thread.queue.front());
+      _thread.queue.pop_front();
+      _thread.queuedBytes -= msg.data.size();
+      _thread.publishing = true;
+      _thread.condVar.notify_all();
+    }
+
+    this->Publish(msg);
+  }
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::WaitForPublisherThreads()
+{
+  for (const auto &thread : this->publisherThreads)
+  {
+    std::unique_lock<std::mutex> lock(thread->mutex);
+    thread->condVar.wait(lock, [this, &thread]
+      {
+        return this->stop ||
+          (thread->queue.empty() && !thread->publishing);
+      });
+  }
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::PublishFront(
+    const ReadAhead::Entry &_msg)
+{
+  const auto found = this->topicThreads.find(_msg.topic);
+  if (found == this->topicThreads.end())
+  {
+    this->Publish(_msg);
+    this->readAhead->Pop();
+    return;
+  }
+
+  // Wait for room, a topic that can't be published at the rate it was
+  // recorded holds back the playback
+  PublisherThread &thread = *found->second;
+  std::unique_lock<std::mutex> lock(thread.mutex);
+  thread.condVar.wait(lock, [this, &thread]
+    {
+      return this->stop || thread.queue.empty() ||
+        (thread.queue.size() < kPublisherQueueMessages &&
+         thread.queuedBytes < kPublisherQueueBytes);
+    });
+  if (this->stop)
+    return;
+
+  ReadAhead::Entry msg;
+  if (!thread.spares.empty())
+  {
+    msg = std::move(thread.spares.back());
+    thread.spares.pop_back();
+  }
+  this->readAhead->Pop(msg);
+  thread.queuedBytes += msg.data.size();
+  thread.queue.push_back(std::move(msg));
+  thread.condVar.notify_all();
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::Publish(const ReadAhead::Entry &_msg)
+{
+  if (this->direct)
+  {
+    // Straight from the memory of the read-ahead queue
+    const DirectTopic &directTopic = this->directTopics.at(_msg.topic);
+    const MessageInfo &info = directTopic.infos.at(_msg.type);
+    for (const RawCallback &callback : directTopic.callbacks)
+      callback(_msg.data.data(), _msg.data.size(), info);
+    return;
+  }
+
+  // The publishers aren't added while playing, so they're looked up from
+  // several threads. The message read once is published by every node.
+  for (auto &publisher : this->publishers.at(_msg.topic).at(_msg.type))
+    publisher.PublishRaw(_msg.data.data(), _msg.data.size(), _msg.type);
+}
+
 //////////////////////////////////////////////////
 void PlaybackHandle::Implementation::WaitUntilFinished()
 {
-  if (this->logFile->Valid() && !this->stop)
+  if (this->Valid() && !this->stop)
   {
     std::unique_lock<std::mutex> lk(this->waitMutex);
     this->waitConditionVariable.wait(lk, [this]{return this->finished.load();});
@@ -518,88 +1265,132 @@ void PlaybackHandle::Implementation::StartPlayback()
 
   // Set time in the playback frame equal to the first message in batch
   // so that it gets played back right after playback starts
-  this->playbackStartTime = this->logFile->StartTime();
+  // The logs without messages don't extend the timeline
+  this->playbackStartTime = std::chrono::nanoseconds::max();
+  this->playbackEndTime = std::chrono::nanoseconds::zero();
+  for (const auto &logFile : this->logFiles)
+  {
+    if (logFile->Descriptor()->TopicsToMsgTypesToId().empty())
+      continue;
+    this->playbackStartTime =
+      std::min(this->playbackStartTime, logFile->StartTime());
+    this->playbackEndTime =
+      std::max(this->playbackEndTime, logFile->EndTime());
+  }
+  if (this->playbackStartTime > this->playbackEndTime)
+    this->playbackStartTime = this->playbackEndTime;
   this->playbackTime = this->playbackStartTime;
-  this->playbackEndTime = this->logFile->EndTime();
 
-  this->nextMessageTime = this->messageIter->TimeReceived();
+  this->nextMessageTime = this->firstMessageTime;
 
-  this->lastEventTime = std::chrono::steady_clock::now().time_since_epoch();
+  this->lastEventTime = this->Now();
 
-  this->playbackThread = std::thread([this] () mutable
+  if (this->synchronous)
+    this->Play();
+  else
+    this->playbackThread = std::thread([this]() { this->Play(); });
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::Play()
+{
+  // An external clock may start later, e.g. with the simulation
+  if (this->clock && !this->clock->IsReady())
+  {
+    std::mutex tempMutex;
+    std::unique_lock<std::mutex> tempLock(tempMutex);
+    while (!this->stop && !this->clock->IsReady())
+      this->stopConditionVariable.wait_for(tempLock, kClockPollPeriod);
+    this->lastEventTime = this->Now();
+  }
+
+  while (!this->stop && this->HasNextMessage()) {
+    // Lock if paused
+    if (this->paused)
     {
-      while (!this->stop && (this->messageIter != this->batch.end())) {
-        // Lock if paused
-        if (this->paused)
-        {
-          std::unique_lock<std::mutex> lk(this->pauseMutex);
-          // If paused, the thread will be blocked here
-          this->pauseConditionVariable.wait(lk,
-            [this]{return !this->paused.load();});
-          this->lastEventTime =
-              std::chrono::steady_clock::now().time_since_epoch();
-          // Abort current iteration after coming back from pause
+      std::unique_lock<std::mutex> lk(this->pauseMutex);
+      // If paused, the thread will be blocked here
+      this->pauseConditionVariable.wait(lk,
+        [this]{return !this->paused.load();});
+      this->lastEventTime = this->Now();
+      // Abort current iteration after coming back from pause
+      continue;
+    }
+    // If not executing a requested step (regular non-paused playback flow)
+    if (this->nextMessageTime <= this->boundaryTime)
+    {
+      const double currentRate = this->rate;
+      const bool unbounded = std::isinf(currentRate);
+      // The timeDelta becomes the time remaining until next message
+      const std::chrono::nanoseconds timeDelta(RealDuration(
+          this->nextMessageTime - this->playbackTime, currentRate));
+      const std::chrono::nanoseconds timeToWaitUntil(
+          this->lastEventTime + timeDelta);
+      // Wait until target time is reached or playback is stopped/paused
+      // In the latter case, break the iteration step
+      if (!unbounded)
+      {
+        if (!this->WaitUntil(timeToWaitUntil))
           continue;
-        }
-        // If not executing a requested step (regular non-paused playback flow)
-        if (this->nextMessageTime <= this->boundaryTime)
-        {
-          // The timeDelta becomes the time remaining until next message
-          const std::chrono::nanoseconds timeDelta(
-              this->nextMessageTime - this->playbackTime);
-          const std::chrono::nanoseconds timeToWaitUntil(
-              this->lastEventTime + timeDelta);
-          // Wait until target time is reached or playback is stopped/paused
-          // In the latter case, break the iteration step
-          if (this->msgWaiting && !this->WaitUntil(timeToWaitUntil))
-          {
-            continue;
-          }
-          // Publish the message
-          {
-          std::unique_lock<std::mutex> lk(this->batchMutex);
-          LDBG("publishing\n");
-          this->publishers[
-            this->messageIter->Topic()][
-              this->messageIter->Type()].PublishRaw(
-                this->messageIter->Data(), this->messageIter->Type());
-          // Advance iterator to next message
-          ++this->messageIter;
-          this->playbackTime = this->nextMessageTime;
-          this->lastEventTime =
-              std::chrono::steady_clock::now().time_since_epoch();
-          this->nextMessageTime = messageIter->TimeReceived();
-          }
-        }
-        // If a custom step has been requested, always from a paused state,
-        // playback gets resumed until the step requested is completed,
-        // then goes back to paused.
-        else
-        {
-          // The timeDelta is equal to the step size passed to the step function
-          const std::chrono::nanoseconds timeDelta(
-              this->boundaryTime - this->playbackTime);
-          // Target time in the realtime frame
-          const std::chrono::nanoseconds timeToWaitUntil(
-              this->lastEventTime + timeDelta);
-          // Wait until target time is reached or playback is stopped/paused
-          // In the latter case, break the iteration step
-          if (!this->WaitUntil(timeToWaitUntil))
-          {
-            continue;
-          }
-          this->Pause();
-        }
+        this->RecordJitter(timeToWaitUntil);
+      }
+      // Publish the message, or a batch of them when there's no waiting
+      // between messages
+      {
+      std::unique_lock<std::mutex> lk(this->batchMutex);
+      LDBG("publishing\n");
+      // The messages were already read by the read-ahead thread, so
+      // they're published from memory
+      const ReadAhead::Entry *msg = this->readAhead->Front();
+      std::size_t published = 0;
+      do
+      {
+        // Advance to next message
+        if (msg)
+          this->PublishFront(*msg);
+        this->playbackTime = this->nextMessageTime;
+        msg = this->readAhead->Front();
+        if (msg)
+          this->nextMessageTime = msg->time;
+      } while (unbounded && msg && ++published < kPublishBatch &&
+               !this->stop && !this->paused &&
+               this->nextMessageTime <= this->boundaryTime);
+      this->lastEventTime = this->Now();
+      }
+    }
+    // If a custom step has been requested, always from a paused state,
+    // playback gets resumed until the step requested is completed,
+    // then goes back to paused.
+    else
+    {
+      // The timeDelta is equal to the step size passed to the step function
+      const std::chrono::nanoseconds timeDelta(RealDuration(
+          this->boundaryTime - this->playbackTime, this->rate));
+      // Target time in the realtime frame
+      const std::chrono::nanoseconds timeToWaitUntil(
+          this->lastEventTime + timeDelta);
+      // Wait until target time is reached or playback is stopped/paused
+      // In the latter case, break the iteration step
+      if (!this->WaitUntil(timeToWaitUntil))
+      {
+        continue;
       }
-      this->finished = true;
-      this->waitConditionVariable.notify_all();
-  });
+      this->Pause();
+    }
+  }
+  // The playback finishes once the messages handed over are published
+  this->WaitForPublisherThreads();
+  this->finished = true;
+  this->waitConditionVariable.notify_all();
 }
 
 //////////////////////////////////////////////////
 bool PlaybackHandle::Implementation::WaitUntil(
     const std::chrono::nanoseconds &_targetTime)
 {
+  if (this->clock)
+    return this->WaitForClock(_targetTime);
+
   const auto waitStartTime =
     std::chrono::steady_clock::now().time_since_epoch();
 
@@ -634,8 +1425,68 @@ bool PlaybackHandle::Implementation::WaitUntil(
   // (having successfully achieved the time to wait) or false if the predicate
   // evaluates to true, which means that a pause or stop order was received,
   // interrupting the wait.
-  return this->stopConditionVariable.wait_for(
-      tempLock, _targetTime - waitStartTime, FinishedWaiting);
+  const std::chrono::nanoseconds spin(this->spinThreshold.load());
+  const bool waited = this->stopConditionVariable.wait_for(
+      tempLock, _targetTime - spin - waitStartTime, [&]() -> bool
+      {
+        return FinishedWaiting() || (spin.count() > 0 &&
+          _targetTime - spin <= std::chrono::steady_clock::now()
+            .time_since_epoch());
+      });
+
+  if (spin.count() <= 0)
+    return waited;
+
+  // Spin on the clock for the last part of the wait, the wake up from a
+  // sleep is too late for high-rate topics
+  while (!this->stop && !this->paused)
+  {
+    if (_targetTime <= std::chrono::steady_clock::now().time_since_epoch())
+      return true;
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::Implementation::WaitForClock(
+    const std::chrono::nanoseconds &_targetTime)
+{
+  // See WaitUntil() about the temporary mutex
+  std::mutex tempMutex;
+  std::unique_lock<std::mutex> tempLock(tempMutex);
+
+  // The clock doesn't notify its updates, so it's read periodically
+  while (!this->stop && !this->paused)
+  {
+    if (this->clock->IsReady() && _targetTime <= this->clock->Time())
+      return true;
+    this->stopConditionVariable.wait_for(tempLock, kClockPollPeriod);
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds PlaybackHandle::Implementation::Now() const
+{
+  if (this->clock)
+    return this->clock->Time();
+  return std::chrono::steady_clock::now().time_since_epoch();
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::RecordJitter(
+    const std::chrono::nanoseconds &_targetTime)
+{
+  const std::chrono::nanoseconds delay = std::max(
+    std::chrono::nanoseconds::zero(),
+    this->Now() - _targetTime);
+
+  std::lock_guard<std::mutex> lock(this->jitterMutex);
+  ++this->jitter.samples;
+  this->jitterSum += static_cast<double>(delay.count());
+  this->jitter.mean = std::chrono::nanoseconds(
+    static_cast<int64_t>(this->jitterSum / this->jitter.samples));
+  this->jitter.max = std::max(this->jitter.max, delay);
 }
 
 //////////////////////////////////////////////////
@@ -643,6 +1494,15 @@ void PlaybackHandle::Implementation::Step(
     const std::chrono::nanoseconds &_stepDuration)
 {
   if (_stepDuration.count() == 0) return;
+
+  // A step backwards jumps to the earlier time, still paused
+  if (_stepDuration.count() < 0)
+  {
+    this->Seek(std::max(std::chrono::nanoseconds::zero(),
+      this->playbackTime + _stepDuration - this->firstMessageTime));
+    return;
+  }
+
   this->boundaryTime = this->playbackTime + _stepDuration;
   this->Resume();
 }
@@ -657,30 +1517,124 @@ void PlaybackHandle::Implementation::Seek(
     return;
   }
   const QualifiedTime beginTime(this->firstMessageTime + _newElapsedTime);
-  const QualifiedTime endTime(std::chrono::nanoseconds::max());
-  const QualifiedTimeRange timeRange(beginTime, endTime);
   {
     std::unique_lock<std::mutex> lk(this->batchMutex);
-    this->batch = this->logFile->QueryMessages(
-        TopicList::Create(this->trackedTopics, timeRange));
-    this->messageIter = this->batch.begin();
+    // Destroying the previous read-ahead stops its thread first
+    this->readAhead.reset();
+    this->readAhead = this->ReadFrom(beginTime);
+
+    // The messages handed over before the seek aren't published
+    for (const auto &thread : this->publisherThreads)
+    {
+      std::lock_guard<std::mutex> lock(thread->mutex);
+      thread->queue.clear();
+      thread->queuedBytes = 0;
+      thread->condVar.notify_all();
+    }
+
+    const ReadAhead::Entry *msg = this->readAhead->Front();
+    if (msg)
+    {
+      this->playbackTime = msg->time;
+      this->nextMessageTime = msg->time;
+    }
   }
-  this->playbackTime = this->messageIter->TimeReceived();
-  this->nextMessageTime = this->messageIter->TimeReceived();
   this->boundaryTime = std::chrono::nanoseconds::max();
-  this->lastEventTime = std::chrono::steady_clock::now().time_since_epoch();
+  this->lastEventTime = this->Now();
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<MergedReadAhead> PlaybackHandle::Implementation::ReadFrom(
+    const QualifiedTime &_start)
+{
+  std::vector<std::unique_ptr<ReadAhead>> inputs;
+  for (std::size_t i = 0; i < this->logFiles.size(); ++i)
+    inputs.push_back(this->ReadLogFrom(i, _start));
+  return std::make_unique<MergedReadAhead>(std::move(inputs));
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<ReadAhead> PlaybackHandle::Implementation::ReadLogFrom(
+    const std::size_t _log, const QualifiedTime &_start)
+{
+  const std::vector<std::chrono::nanoseconds> &seekIndex =
+    this->seekIndexes[_log];
+
+  // Index of the time ending the first window
+  std::size_t next = 0;
+  if (!_start.IsIndeterminate())
+  {
+    next = std::upper_bound(seekIndex.begin(), seekIndex.end(),
+      *_start.GetTime()) - seekIndex.begin();
+  }
+
+  bool first = true;
+  bool done = false;
+  return std::make_unique<ReadAhead>(
+    [this, _log, &seekIndex, _start, next, first, done](
+      Batch &_batch) mutable -> bool
+    {
+      if (done)
+        return false;
+
+      // Each window ends where the next one starts
+      const QualifiedTime begin = first ? _start :
+        QualifiedTime(seekIndex[next - 1]);
+      QualifiedTime end;
+      if (next < seekIndex.size())
+      {
+        end = QualifiedTime(seekIndex[next],
+          QualifiedTime::Qualifier::EXCLUSIVE);
+        ++next;
+      }
+      else
+      {
+        done = true;
+      }
+      first = false;
+
+      _batch = this->logFiles[_log]->QueryMessages(TopicList::Create(
+        this->trackedTopics, QualifiedTimeRange(begin, end)));
+      return true;
+    }, kReadAheadMessages, kReadAheadBytes / this->logFiles.size());
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::Implementation::Valid() const
+{
+  for (const auto &logFile : this->logFiles)
+  {
+    if (!logFile->Valid())
+      return false;
+  }
+  return !this->logFiles.empty();
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::Implementation::HasNextMessage()
+{
+  std::unique_lock<std::mutex> lk(this->batchMutex);
+  return this->readAhead->Front() != nullptr;
 }
 
 //////////////////////////////////////////////////
 void PlaybackHandle::Implementation::Stop()
 {
-  if (!this->logFile->Valid())
+  if (!this->Valid())
   {
     return;
   }
 
   this->stop = true;
   this->stopConditionVariable.notify_all();
+  for (const auto &thread : this->publisherThreads)
+  {
+    {
+      // Locked so that the threads waiting see the change
+      std::lock_guard<std::mutex> lock(thread->mutex);
+    }
+    thread->condVar.notify_all();
+  }
 
   if (this->paused)
   {
@@ -691,6 +1645,12 @@ void PlaybackHandle::Implementation::Stop()
 
   if (this->playbackThread.joinable())
     this->playbackThread.join();
+
+  for (const auto &thread : this->publisherThreads)
+  {
+    if (thread->thread.joinable())
+      thread->thread.join();
+  }
 }
 
 //////////////////////////////////////////////////
@@ -701,10 +1661,16 @@ void PlaybackHandle::Implementation::Pause()
   {
     this->paused = true;
     std::chrono::nanoseconds now(
-        std::chrono::steady_clock::now().time_since_epoch());
-    // Advance time in the playback frame to the moment when pause started
-    this->playbackTime = this->playbackTime +
-        now - this->lastEventTime;
+        this->Now());
+    // Advance time in the playback frame to the moment when pause started.
+    // Without waiting, the playback is at the last message published.
+    const double currentRate = this->rate;
+    if (!std::isinf(currentRate))
+    {
+      this->playbackTime += std::chrono::duration_cast<
+        std::chrono::nanoseconds>(std::chrono::duration<double, std::nano>(
+          now - this->lastEventTime) * currentRate);
+    }
     // Update last event time in the realtime frame.
     this->lastEventTime = now;
     this->boundaryTime = std::chrono::nanoseconds::max();
@@ -728,6 +1694,17 @@ bool PlaybackHandle::Implementation::IsPaused() const
   return this->paused;
 }
 
+//////////////////////////////////////////////////
+std::chrono::nanoseconds PlaybackHandle::Implementation::RealDuration(
+    const std::chrono::nanoseconds &_duration, double _rate)
+{
+  if (std::isinf(_rate))
+    return std::chrono::nanoseconds::zero();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::duration<double, std::nano>(_duration) / _rate);
+}
+
 //////////////////////////////////////////////////
 PlaybackHandle::~PlaybackHandle()
 {
@@ -773,6 +1750,111 @@ bool PlaybackHandle::IsPaused() const
   return this->dataPtr->IsPaused();
 }
 
+//////////////////////////////////////////////////
+bool PlaybackHandle::SetRate(double _rate)
+{
+  // Also false for NaN
+  if (!(_rate > 0))
+  {
+    LERR("Invalid playback rate [" << _rate << "]\n");
+    return false;
+  }
+
+  this->dataPtr->rate = _rate;
+  return true;
+}
+
+//////////////////////////////////////////////////
+double PlaybackHandle::Rate() const
+{
+  return this->dataPtr->rate;
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::SetSpinThreshold(
+    const std::chrono::nanoseconds &_threshold)
+{
+  this->dataPtr->spinThreshold = std::max(
+    std::chrono::nanoseconds::zero(), _threshold).count();
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds PlaybackHandle::SpinThreshold() const
+{
+  return std::chrono::nanoseconds(this->dataPtr->spinThreshold.load());
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::SetThreadAffinity(int _cpu)
+{
+#ifdef __linux__
+  if (_cpu < 0 || _cpu >= CPU_SETSIZE)
+  {
+    LERR("Invalid CPU [" << _cpu << "]\n");
+    return false;
+  }
+
+  if (!this->dataPtr->playbackThread.joinable())
+    return false;
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(_cpu, &cpus);
+  const int result = pthread_setaffinity_np(
+    this->dataPtr->playbackThread.native_handle(), sizeof(cpus), &cpus);
+  if (result != 0)
+  {
+    LERR("Failed to run the playback on CPU [" << _cpu << "]: "
+         << std::strerror(result) << "\n");
+    return false;
+  }
+  return true;
+#else
+  LWRN("Setting the CPU affinity of the playback is only supported on "
+       "Linux\n");
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::SetRealTimePriority(int _priority)
+{
+#ifdef __linux__
+  if (_priority < sched_get_priority_min(SCHED_FIFO) ||
+      _priority > sched_get_priority_max(SCHED_FIFO))
+  {
+    LERR("Invalid real-time priority [" << _priority << "]\n");
+    return false;
+  }
+
+  if (!this->dataPtr->playbackThread.joinable())
+    return false;
+
+  sched_param param;
+  param.sched_priority = _priority;
+  const int result = pthread_setschedparam(
+    this->dataPtr->playbackThread.native_handle(), SCHED_FIFO, &param);
+  if (result != 0)
+  {
+    LERR("Failed to set the real-time priority of the playback: "
+         << std::strerror(result) << "\n");
+    return false;
+  }
+  return true;
+#else
+  LWRN("Setting the real-time priority of the playback is only supported on "
+       "Linux\n");
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+PlaybackJitterStats PlaybackHandle::JitterStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->jitterMutex);
+  return this->dataPtr->jitter;
+}
+
 //////////////////////////////////////////////////
 void PlaybackHandle::WaitUntilFinished()
 {
@@ -15,6 +15,9 @@
  *
 */
 
+#include <string>
+#include <vector>
+
 #include "ignition/transport/log/Playback.hh"
 #include "gtest/gtest.h"
 
@@ -29,8 +32,87 @@ TEST(Playback, PlaybackEmptyDatabase)
   EXPECT_FALSE(playback.AddTopic("/foo/bar"));
   EXPECT_EQ(-1, playback.AddTopic(std::regex(".*")));
   EXPECT_EQ(nullptr, playback.Start());
+  EXPECT_EQ(nullptr, playback.Start(WallClock::Instance()));
+  EXPECT_EQ(nullptr, playback.Start(static_cast<const Clock *>(nullptr)));
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, PublisherThreads)
+{
+  log::Playback playback(":memory:");
+  EXPECT_EQ(0u, playback.PublisherThreads());
+  EXPECT_FALSE(playback.SetTopicPublisherThread("/foo", 0));
+
+  playback.SetPublisherThreads(2);
+  EXPECT_EQ(2u, playback.PublisherThreads());
+  EXPECT_TRUE(playback.SetTopicPublisherThread("/foo", 1));
+  EXPECT_FALSE(playback.SetTopicPublisherThread("/foo", 2));
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, ExpectedSubscribers)
+{
+  log::Playback playback(":memory:");
+  EXPECT_TRUE(playback.ExpectedSubscribers().empty());
+
+  playback.SetExpectedSubscribers({"/foo", "/bar"});
+  EXPECT_EQ((std::set<std::string>{"/bar", "/foo"}),
+    playback.ExpectedSubscribers());
+
+  playback.SetExpectedSubscribers({});
+  EXPECT_TRUE(playback.ExpectedSubscribers().empty());
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, FanOut)
+{
+  log::Playback playback(":memory:");
+  EXPECT_TRUE(playback.FanOut().empty());
+
+  std::vector<NodeOptions> fanOut(2);
+  fanOut[0].SetPartition("first");
+  fanOut[1].SetPartition("second");
+  playback.SetFanOut(fanOut);
+  ASSERT_EQ(2u, playback.FanOut().size());
+  EXPECT_EQ("first", playback.FanOut()[0].Partition());
+  EXPECT_EQ("second", playback.FanOut()[1].Partition());
+
+  playback.SetFanOut({});
+  EXPECT_TRUE(playback.FanOut().empty());
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, MultipleLogs)
+{
+  // Every log must be valid
+  log::Playback none(std::vector<std::string>{});
+  EXPECT_FALSE(none.Valid());
+  EXPECT_EQ(nullptr, none.Start());
+
+  log::Playback playback(
+    std::vector<std::string>{":memory:", "/no/such/dir/file.tlog"});
+  EXPECT_FALSE(playback.Valid());
+  EXPECT_FALSE(playback.AddTopic("/foo/bar"));
+  EXPECT_EQ(-1, playback.AddTopic(std::regex(".*")));
+  EXPECT_EQ(nullptr, playback.Start());
 }
 
+//////////////////////////////////////////////////
+TEST(Playback, DirectSubscribers)
+{
+  log::Playback playback(":memory:");
+  EXPECT_FALSE(playback.Synchronous());
+  playback.SetSynchronous(true);
+  EXPECT_TRUE(playback.Synchronous());
+
+  // The log isn't valid
+  EXPECT_FALSE(playback.AddDirectSubscriber("/foo",
+    [](const char *, const size_t, const MessageInfo &) {}));
+  EXPECT_EQ(nullptr, playback.Start());
+
+  playback.SetSynchronous(false);
+  EXPECT_FALSE(playback.Synchronous());
+}
 
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
@@ -15,6 +15,7 @@
  *
 */
 
+#include <chrono>
 #include <cstdint>
 #include <regex>
 #include <set>
@@ -33,7 +34,16 @@ using namespace ignition::transport::log;
 static void AppendTopicListClause(
     SqlStatement &_sql, const std::vector<int64_t> &_ids)
 {
-  _sql.statement += "topic_id in (";
+  // A single topic is compared for equality, so that its messages are read
+  // in order through the (topic_id, time_recv) index without sorting them
+  if (_ids.size() == 1)
+  {
+    _sql.statement += "messages.topic_id = ?";
+    _sql.parameters.emplace_back(_ids.front());
+    return;
+  }
+
+  _sql.statement += "messages.topic_id in (";
   bool first = true;
   for (const int64_t id : _ids)
   {
@@ -57,11 +67,11 @@ static void AppendTopicListClause(
 SqlStatement QueryOptions::StandardMessageQueryPreamble()
 {
   SqlStatement sql;
+  // The names of the topics are looked up by id in the descriptor, rather
+  // than copied from the topics and message_types tables for every row
   sql.statement =
-      "SELECT messages.id, messages.time_recv, topics.name,"
-      " message_types.name, messages.message FROM messages JOIN topics ON"
-      " topics.id = messages.topic_id JOIN message_types ON"
-      " message_types.id = topics.message_type_id ";
+      "SELECT messages.id, messages.time_recv, messages.topic_id,"
+      " messages.message FROM messages ";
 
   return sql;
 }
@@ -110,9 +120,12 @@ class TimeRangeOption::Implementation
         finishCompare = "<";
     }
 
+    const std::string column = this->reference == TimeReference::HEADER ?
+      "messages.time_header " : "messages.time_recv ";
+
     if (!startCompare.empty())
     {
-      sql.statement += "time_recv " + startCompare + " ?";
+      sql.statement += column + startCompare + " ?";
       sql.parameters.emplace_back(start.GetTime()->count());
 
       if (!finishCompare.empty())
@@ -121,7 +134,7 @@ class TimeRangeOption::Implementation
 
     if (!finishCompare.empty())
     {
-      sql.statement += "time_recv " + finishCompare + " ?";
+      sql.statement += column + finishCompare + " ?";
       sql.parameters.emplace_back(finish.GetTime()->count());
     }
 
@@ -130,6 +143,9 @@ class TimeRangeOption::Implementation
 
   /// \brief Range for this option
   public: QualifiedTimeRange range;
+
+  /// \brief Time of the messages the range applies to
+  public: TimeReference reference = TimeReference::RECEIVED;
 };
 
 //////////////////////////////////////////////////
@@ -166,6 +182,18 @@ const QualifiedTimeRange &TimeRangeOption::TimeRange() const
   return this->dataPtr->range;
 }
 
+//////////////////////////////////////////////////
+void TimeRangeOption::SetTimeReference(const TimeReference _reference)
+{
+  this->dataPtr->reference = _reference;
+}
+
+//////////////////////////////////////////////////
+TimeRangeOption::TimeReference TimeRangeOption::GetTimeReference() const
+{
+  return this->dataPtr->reference;
+}
+
 //////////////////////////////////////////////////
 SqlStatement TimeRangeOption::GenerateTimeConditions() const
 {
@@ -444,3 +472,139 @@ AllTopics::~AllTopics()
 {
   // Destroy the pimpl
 }
+
+//////////////////////////////////////////////////
+class DownsampledTopics::Implementation
+{
+  /// \brief Topics for this option
+  public: std::set<std::string> topics;
+
+  /// \brief Minimum time between the selected messages of a topic
+  public: std::chrono::nanoseconds period;
+};
+
+//////////////////////////////////////////////////
+DownsampledTopics::DownsampledTopics(
+    const std::set<std::string> &_topics,
+    const std::chrono::nanoseconds &_period,
+    const QualifiedTimeRange &_timeRange)
+  : TimeRangeOption(_timeRange),
+    dataPtr(new Implementation{_topics, _period})
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+DownsampledTopics::DownsampledTopics(const DownsampledTopics &_other)
+  : TimeRangeOption(_other),
+    dataPtr(new Implementation{*_other.dataPtr})
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+DownsampledTopics::DownsampledTopics(
+    DownsampledTopics &&_other)  // NOLINT(build/c++11)
+  : TimeRangeOption(std::move(_other)),
+    dataPtr(std::move(_other.dataPtr))
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+std::set<std::string> &DownsampledTopics::Topics()
+{
+  return this->dataPtr->topics;
+}
+
+//////////////////////////////////////////////////
+const std::set<std::string> &DownsampledTopics::Topics() const
+{
+  return this->dataPtr->topics;
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds &DownsampledTopics::Period()
+{
+  return this->dataPtr->period;
+}
+
+//////////////////////////////////////////////////
+const std::chrono::nanoseconds &DownsampledTopics::Period() const
+{
+  return this->dataPtr->period;
+}
+
+//////////////////////////////////////////////////
+std::vector<SqlStatement> DownsampledTopics::GenerateStatements(
+    const Descriptor &_descriptor) const
+{
+  const Descriptor::NameToMap &map = _descriptor.TopicsToMsgTypesToId();
+  std::vector<int64_t> rowIDs;
+  for (const auto &topic : this->dataPtr->topics)
+  {
+    Descriptor::NameToMap::const_iterator it = map.find(topic);
+    if (it != map.end())
+    {
+      for (const auto &msgEntry : it->second)
+        rowIDs.push_back(msgEntry.second);
+    }
+  }
+
+  // Without a period, every message is selected
+  if (this->dataPtr->period.count() <= 0 || rowIDs.empty())
+  {
+    return TopicList(this->dataPtr->topics, this->TimeRange())
+      .GenerateStatements(_descriptor);
+  }
+
+  // Both the first message of a topic and the following ones must be in the
+  // time range
+  SqlStatement timeCondition = this->GenerateTimeConditions();
+  if (!timeCondition.statement.empty())
+  {
+    timeCondition.statement = " AND (" + timeCondition.statement + ")";
+  }
+
+  // Each step of the recursion looks up the next message of a topic through
+  // the (topic_id, time_recv) index, the messages in between are not read.
+  // The recursion of a topic ends with a NULL id, when there are no more
+  // messages. The topic ids are given as values rather than selected from
+  // the topics table, which makes SQLite look up the first messages through
+  // the time index instead.
+  SqlStatement sql;
+  sql.statement = "WITH RECURSIVE ids(topic_id) AS (VALUES ";
+  for (std::size_t i = 0; i < rowIDs.size(); ++i)
+  {
+    sql.statement += i == 0 ? "(?)" : ", (?)";
+    sql.parameters.emplace_back(rowIDs[i]);
+  }
+  sql.statement +=
+      "), picked(id) AS ("
+      "SELECT (SELECT messages.id FROM messages"
+      " WHERE messages.topic_id = ids.topic_id";
+  sql.Append(timeCondition);
+  sql.statement +=
+      " ORDER BY messages.time_recv, messages.id LIMIT 1)"
+      " FROM ids UNION ALL "
+      "SELECT (SELECT messages.id FROM messages"
+      " WHERE messages.topic_id = previous.topic_id"
+      " AND messages.time_recv >= previous.time_recv + ?";
+  sql.parameters.emplace_back(this->dataPtr->period.count());
+  sql.Append(timeCondition);
+  sql.statement +=
+      " ORDER BY messages.time_recv, messages.id LIMIT 1)"
+      " FROM picked JOIN messages AS previous ON previous.id = picked.id) ";
+
+  sql.Append(QueryOptions::StandardMessageQueryPreamble());
+  sql.statement += " JOIN picked ON picked.id = messages.id";
+  sql.Append(QueryOptions::StandardMessageQueryClose());
+
+  return {sql};
+}
+
+//////////////////////////////////////////////////
+DownsampledTopics::~DownsampledTopics()
+{
+  // Destroy the pimpl
+}
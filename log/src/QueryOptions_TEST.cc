@@ -48,6 +48,28 @@ TEST(QueryOptionsTimeRange, GetRangeConst)
   EXPECT_EQ(range, constRangeOption.TimeRange());
 }
 
+//////////////////////////////////////////////////
+TEST(QueryOptionsTimeRange, TimeReference)
+{
+  log::TimeRangeOption rangeOption(log::QualifiedTimeRange(
+    log::QualifiedTime(1s), log::QualifiedTime()));
+  EXPECT_EQ(log::TimeRangeOption::TimeReference::RECEIVED,
+    rangeOption.GetTimeReference());
+  EXPECT_EQ("messages.time_recv >= ?",
+    rangeOption.GenerateTimeConditions().statement);
+
+  rangeOption.SetTimeReference(log::TimeRangeOption::TimeReference::HEADER);
+  EXPECT_EQ(log::TimeRangeOption::TimeReference::HEADER,
+    rangeOption.GetTimeReference());
+  EXPECT_EQ("messages.time_header >= ?",
+    rangeOption.GenerateTimeConditions().statement);
+
+  // The reference is copied with the range
+  log::TimeRangeOption copy(rangeOption);
+  EXPECT_EQ(log::TimeRangeOption::TimeReference::HEADER,
+    copy.GetTimeReference());
+}
+
 //////////////////////////////////////////////////
 TEST(QueryOptionsTopicList, TopicList)
 {
@@ -178,6 +200,24 @@ TEST(QueryOptionsTopicPattern, MoveConstructor)
   EXPECT_FALSE(std::regex_match("bar", uutPattern));
 }
 
+//////////////////////////////////////////////////
+TEST(QueryOptionsDownsampledTopics, Accessors)
+{
+  log::DownsampledTopics option({"/foo", "/bar"}, 100ms);
+  option.Topics().insert("/baz");
+  option.Period() = 200ms;
+
+  log::DownsampledTopics copy(option);
+  const auto &constCopy = copy;
+  EXPECT_EQ((std::set<std::string>{"/bar", "/baz", "/foo"}),
+    constCopy.Topics());
+  EXPECT_EQ(200ms, constCopy.Period());
+
+  log::DownsampledTopics moved(std::move(copy));
+  EXPECT_EQ(3u, moved.Topics().size());
+  EXPECT_EQ(200ms, moved.Period());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/log/Message.hh"
+#include "ReadAhead.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+//////////////////////////////////////////////////
+ReadAhead::ReadAhead(Batch &&_batch,  // NOLINT(build/c++11)
+    const std::size_t _maxMessages, const std::size_t _maxBytes)
+  : batch(std::move(_batch)),
+    slots(_maxMessages > 0 ? _maxMessages : 1),
+    maxBytes(_maxBytes)
+{
+  this->reader = std::thread(&ReadAhead::Read, this);
+}
+
+//////////////////////////////////////////////////
+ReadAhead::ReadAhead(BatchSource _source,
+    const std::size_t _maxMessages, const std::size_t _maxBytes)
+  : source(std::move(_source)),
+    slots(_maxMessages > 0 ? _maxMessages : 1),
+    maxBytes(_maxBytes)
+{
+  this->reader = std::thread(&ReadAhead::Read, this);
+}
+
+//////////////////////////////////////////////////
+ReadAhead::~ReadAhead()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->removed.notify_one();
+  if (this->reader.joinable())
+    this->reader.join();
+}
+
+//////////////////////////////////////////////////
+const ReadAhead::Entry *ReadAhead::Front()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->queued.wait(lock, [this]{return this->count > 0 || this->done;});
+  return this->count > 0 ? &this->slots[this->head] : nullptr;
+}
+
+//////////////////////////////////////////////////
+void ReadAhead::Pop()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->count == 0)
+      return;
+    this->bytes -= this->slots[this->head].data.size();
+    this->head = (this->head + 1) % this->slots.size();
+    --this->count;
+  }
+  this->removed.notify_one();
+}
+
+//////////////////////////////////////////////////
+void ReadAhead::Pop(Entry &_entry)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->count == 0)
+      return;
+    Entry &slot = this->slots[this->head];
+    this->bytes -= slot.data.size();
+    std::swap(_entry, slot);
+    this->head = (this->head + 1) % this->slots.size();
+    --this->count;
+  }
+  this->removed.notify_one();
+}
+
+//////////////////////////////////////////////////
+bool ReadAhead::NextBatch()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->stop)
+      return false;
+  }
+  return this->source(this->batch);
+}
+
+//////////////////////////////////////////////////
+void ReadAhead::Read()
+{
+  // The given batch is read first, then those of the source
+  bool more = !this->source || this->NextBatch();
+  while (more)
+  {
+    for (Batch::iterator iter = this->batch.begin(); iter != this->batch.end();
+         ++iter)
+    {
+      std::size_t tail;
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->removed.wait(lock, [this]
+          {
+            return this->stop || this->count == 0 ||
+              (this->count < this->slots.size() &&
+               this->bytes < this->maxBytes);
+          });
+        if (this->stop)
+          return;
+        tail = (this->head + this->count) % this->slots.size();
+      }
+
+      // The consumer doesn't use the slots past the queued messages, so the
+      // message is copied without holding the lock.
+      Entry &entry = this->slots[tail];
+      const std::string_view data = iter->DataView();
+      entry.time = iter->TimeReceived();
+      entry.topic = iter->Topic();
+      entry.type = iter->Type();
+      entry.data.assign(data.data(), data.size());
+
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->bytes += entry.data.size();
+        ++this->count;
+      }
+      this->queued.notify_one();
+    }
+
+    more = this->source && this->NextBatch();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->done = true;
+  }
+  this->queued.notify_one();
+}
+
+//////////////////////////////////////////////////
+MergedReadAhead::MergedReadAhead(
+    std::vector<std::unique_ptr<ReadAhead>> &&_inputs)  // NOLINT
+  : inputs(std::move(_inputs))
+{
+}
+
+//////////////////////////////////////////////////
+const ReadAhead::Entry *MergedReadAhead::Front()
+{
+  const ReadAhead::Entry *front = nullptr;
+  this->next = nullptr;
+  for (const auto &input : this->inputs)
+  {
+    const ReadAhead::Entry *entry = input->Front();
+    if (entry && (!front || entry->time < front->time))
+    {
+      front = entry;
+      this->next = input.get();
+    }
+  }
+  return front;
+}
+
+//////////////////////////////////////////////////
+void MergedReadAhead::Pop()
+{
+  if (this->next)
+    this->next->Pop();
+  this->next = nullptr;
+}
+
+//////////////////////////////////////////////////
+void MergedReadAhead::Pop(ReadAhead::Entry &_entry)
+{
+  if (this->next)
+    this->next->Pop(_entry);
+  this->next = nullptr;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_SRC_READAHEAD_HH_
+#define IGNITION_TRANSPORT_LOG_SRC_READAHEAD_HH_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/log/Batch.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Reads the messages of a batch in a background thread, ahead
+      /// of their consumer, into a bounded queue. The consumer gets the
+      /// messages from memory, so it isn't delayed by the reads of the log
+      /// as long as the reader keeps up.
+      class ReadAhead
+      {
+        /// \brief A message copied out of the log.
+        public: struct Entry
+        {
+          /// \brief Time the message was received
+          std::chrono::nanoseconds time;
+
+          /// \brief Name of the topic
+          std::string topic;
+
+          /// \brief Name of the message type
+          std::string type;
+
+          /// \brief Serialized message
+          std::string data;
+        };
+
+        /// \brief Produces the batches to read one after the other, e.g.
+        /// consecutive time windows of a log. Called from the reading
+        /// thread.
+        /// \param[out] _batch The next batch.
+        /// \return False if there are no more batches.
+        public: using BatchSource = std::function<bool(Batch &_batch)>;
+
+        /// \brief Constructor. Starts reading the batch.
+        /// \param[in] _batch The messages to read.
+        /// \param[in] _maxMessages Maximum number of messages in the queue.
+        /// \param[in] _maxBytes Maximum bytes of message data in the queue.
+        /// A message larger than that is still read when the queue is
+        /// empty.
+        public: ReadAhead(Batch &&_batch,  // NOLINT(build/c++11)
+            std::size_t _maxMessages = 256,
+            std::size_t _maxBytes = 64 << 20);
+
+        /// \brief Constructor. Starts reading the batches of a source, in
+        /// order.
+        /// \param[in] _source The batches to read.
+        /// \param[in] _maxMessages Maximum number of messages in the queue.
+        /// \param[in] _maxBytes Maximum bytes of message data in the queue.
+        public: ReadAhead(BatchSource _source,
+            std::size_t _maxMessages = 256,
+            std::size_t _maxBytes = 64 << 20);
+
+        /// \brief Destructor. Stops reading.
+        public: ~ReadAhead();
+
+        /// \brief Get the next message, waiting for it to be read if needed.
+        /// \return The message, valid until Pop() is called, or nullptr if
+        /// there are no more messages.
+        public: const Entry *Front();
+
+        /// \brief Remove the next message from the queue. Must only be
+        /// called after Front() returned a message.
+        public: void Pop();
+
+        /// \brief Move the next message out of the queue. Must only be
+        /// called after Front() returned a message.
+        /// \param[in,out] _entry Receives the message. Its previous content
+        /// is swapped into the queue, which reuses its memory for the next
+        /// messages.
+        public: void Pop(Entry &_entry);
+
+        /// \brief Function of the reading thread.
+        private: void Read();
+
+        /// \brief Get the next batch of the source, unless the reader must
+        /// stop.
+        /// \return False if there are no more batches to read.
+        private: bool NextBatch();
+
+        /// \brief The messages to read.
+        private: Batch batch;
+
+        /// \brief The next batches to read, empty to only read batch.
+        private: BatchSource source;
+
+        /// \brief Queued messages, as a ring buffer. The strings of the
+        /// slots keep their memory for the next messages.
+        private: std::vector<Entry> slots;
+
+        /// \brief Maximum bytes of message data in the queue.
+        private: const std::size_t maxBytes;
+
+        /// \brief Index of the slot of the next message.
+        private: std::size_t head = 0;
+
+        /// \brief Number of queued messages.
+        private: std::size_t count = 0;
+
+        /// \brief Bytes of message data in the queue.
+        private: std::size_t bytes = 0;
+
+        /// \brief True once every message of the batch was queued.
+        private: bool done = false;
+
+        /// \brief True when the reader must stop.
+        private: bool stop = false;
+
+        /// \brief Protects the state of the queue.
+        private: std::mutex mutex;
+
+        /// \brief Notified when a message is queued or the reader is done.
+        private: std::condition_variable queued;
+
+        /// \brief Notified when a message is removed or the reader must
+        /// stop.
+        private: std::condition_variable removed;
+
+        /// \brief The reading thread.
+        private: std::thread reader;
+      };
+
+      /// \brief Merges the messages of several read-ahead queues into one
+      /// timeline, by the time the messages were received, e.g. to play
+      /// back logs recorded separately. The messages received at the same
+      /// time are taken from the first queue first.
+      class MergedReadAhead
+      {
+        /// \brief Constructor.
+        /// \param[in] _inputs The queues to merge, each in order.
+        public: explicit MergedReadAhead(
+            std::vector<std::unique_ptr<ReadAhead>> &&_inputs);  // NOLINT
+
+        /// \brief Get the earliest message of the queues, waiting for each
+        /// of them to have read its next message.
+        /// \return The message, valid until Pop() is called, or nullptr if
+        /// there are no more messages.
+        public: const ReadAhead::Entry *Front();
+
+        /// \brief Remove the message returned by Front(). Must only be
+        /// called after Front() returned a message.
+        public: void Pop();
+
+        /// \brief Move the message returned by Front() out of its queue.
+        /// Must only be called after Front() returned a message.
+        /// \param[in,out] _entry Receives the message, see ReadAhead::Pop().
+        public: void Pop(ReadAhead::Entry &_entry);
+
+        /// \brief The queues.
+        private: std::vector<std::unique_ptr<ReadAhead>> inputs;
+
+        /// \brief Queue of the message returned by Front(), nullptr if
+        /// there's none.
+        private: ReadAhead *next = nullptr;
+      };
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <ios>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "ReadAhead.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+/// \brief Fill a log with messages on two topics, with increasing sizes.
+/// \param[in] _log The log.
+/// \param[in] _count Number of messages.
+static void Fill(log::Log &_log, const int _count)
+{
+  for (int i = 0; i < _count; ++i)
+  {
+    const std::string data(i + 1, static_cast<char>('a' + i % 26));
+    ASSERT_TRUE(_log.InsertMessage(std::chrono::nanoseconds(i),
+      i % 2 ? "/bar" : "/foo", "some.message.type", data.data(),
+      data.size()));
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(ReadAhead, ReadsEveryMessageInOrder)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+  Fill(logFile, 100);
+
+  // The queue is much smaller than the batch, so the reader has to wait
+  // for the consumer
+  log::ReadAhead readAhead(logFile.QueryMessages(), 4, 1 << 20);
+  for (int i = 0; i < 100; ++i)
+  {
+    const log::ReadAhead::Entry *entry = readAhead.Front();
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(std::chrono::nanoseconds(i), entry->time);
+    EXPECT_EQ(i % 2 ? "/bar" : "/foo", entry->topic);
+    EXPECT_EQ("some.message.type", entry->type);
+    EXPECT_EQ(std::string(i + 1, static_cast<char>('a' + i % 26)),
+      entry->data);
+    readAhead.Pop();
+  }
+  EXPECT_EQ(nullptr, readAhead.Front());
+}
+
+//////////////////////////////////////////////////
+TEST(ReadAhead, ByteLimit)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+  Fill(logFile, 50);
+
+  // Each message is larger than the limit, they are still read one at a
+  // time
+  log::ReadAhead readAhead(
+    logFile.QueryMessages(log::TopicList("/foo")), 16, 1);
+  int count = 0;
+  for (const log::ReadAhead::Entry *entry = readAhead.Front(); entry;
+       entry = readAhead.Front())
+  {
+    EXPECT_EQ("/foo", entry->topic);
+    EXPECT_EQ(std::chrono::nanoseconds(2 * count), entry->time);
+    readAhead.Pop();
+    ++count;
+  }
+  EXPECT_EQ(25, count);
+}
+
+//////////////////////////////////////////////////
+TEST(ReadAhead, MoveOut)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+  Fill(logFile, 20);
+
+  log::ReadAhead readAhead(logFile.QueryMessages(), 4, 1 << 20);
+  log::ReadAhead::Entry entry;
+  for (int i = 0; i < 20; ++i)
+  {
+    ASSERT_NE(nullptr, readAhead.Front());
+    readAhead.Pop(entry);
+    EXPECT_EQ(std::chrono::nanoseconds(i), entry.time);
+    EXPECT_EQ(i % 2 ? "/bar" : "/foo", entry.topic);
+    EXPECT_EQ(std::string(i + 1, static_cast<char>('a' + i % 26)),
+      entry.data);
+  }
+  EXPECT_EQ(nullptr, readAhead.Front());
+}
+
+//////////////////////////////////////////////////
+TEST(ReadAhead, BatchSource)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+  Fill(logFile, 100);
+
+  // Read in windows of 16 messages
+  const std::vector<std::chrono::nanoseconds> index = logFile.SeekIndex(16);
+  ASSERT_EQ(6u, index.size());
+
+  std::size_t next = 0;
+  log::ReadAhead readAhead([&](log::Batch &_batch)
+    {
+      if (next > index.size())
+        return false;
+
+      const log::QualifiedTime begin = next == 0 ? log::QualifiedTime() :
+        log::QualifiedTime(index[next - 1]);
+      const log::QualifiedTime end = next == index.size() ?
+        log::QualifiedTime() : log::QualifiedTime(index[next],
+          log::QualifiedTime::Qualifier::EXCLUSIVE);
+      ++next;
+      _batch = logFile.QueryMessages(
+        log::AllTopics(log::QualifiedTimeRange(begin, end)));
+      return true;
+    }, 4, 1 << 20);
+
+  for (int i = 0; i < 100; ++i)
+  {
+    const log::ReadAhead::Entry *entry = readAhead.Front();
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(std::chrono::nanoseconds(i), entry->time);
+    readAhead.Pop();
+  }
+  EXPECT_EQ(nullptr, readAhead.Front());
+  EXPECT_EQ(index.size() + 1, next);
+}
+
+//////////////////////////////////////////////////
+TEST(ReadAhead, StopBeforeTheEnd)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+  Fill(logFile, 100);
+
+  // Destroying the read-ahead stops a reader that's waiting for room
+  {
+    log::ReadAhead readAhead(logFile.QueryMessages(), 2, 1 << 20);
+    ASSERT_NE(nullptr, readAhead.Front());
+  }
+
+  log::ReadAhead empty(logFile.QueryMessages(log::TopicList("/nope")));
+  EXPECT_EQ(nullptr, empty.Front());
+}
+
+//////////////////////////////////////////////////
+TEST(ReadAhead, Merge)
+{
+  // The messages of the logs alternate, with a tie at the end
+  log::Log first;
+  log::Log second;
+  ASSERT_TRUE(first.Open(":memory:", std::ios_base::out));
+  ASSERT_TRUE(second.Open(":memory:", std::ios_base::out));
+  for (int i = 0; i < 10; ++i)
+  {
+    log::Log &logFile = i % 2 ? second : first;
+    const std::string data(1, static_cast<char>('a' + i));
+    ASSERT_TRUE(logFile.InsertMessage(std::chrono::nanoseconds(i),
+      i % 2 ? "/second" : "/first", "some.message.type", data.data(),
+      data.size()));
+  }
+  ASSERT_TRUE(second.InsertMessage(std::chrono::nanoseconds(8), "/second",
+    "some.message.type", "z", 1));
+
+  std::vector<std::unique_ptr<log::ReadAhead>> inputs;
+  inputs.push_back(
+    std::make_unique<log::ReadAhead>(first.QueryMessages(), 2, 1 << 20));
+  inputs.push_back(
+    std::make_unique<log::ReadAhead>(second.QueryMessages(), 2, 1 << 20));
+  log::MergedReadAhead merged(std::move(inputs));
+
+  for (int i = 0; i < 10; ++i)
+  {
+    const log::ReadAhead::Entry *entry = merged.Front();
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(std::chrono::nanoseconds(i), entry->time);
+    EXPECT_EQ(std::string(1, static_cast<char>('a' + i)), entry->data);
+    log::ReadAhead::Entry out;
+    merged.Pop(out);
+    EXPECT_EQ(std::string(1, static_cast<char>('a' + i)), out.data);
+
+    // The message of the second log received at the same time as the one
+    // of the first log comes after it
+    if (i == 8)
+    {
+      entry = merged.Front();
+      ASSERT_NE(nullptr, entry);
+      EXPECT_EQ("z", entry->data);
+      merged.Pop();
+    }
+  }
+  EXPECT_EQ(nullptr, merged.Front());
+
+  log::MergedReadAhead none({});
+  EXPECT_EQ(nullptr, none.Front());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -15,19 +15,30 @@
  *
 */
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <fstream>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <regex>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 #include <thread>
+#include <unordered_set>
 
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
+
+#include <ignition/transport/BufferAllocator.hh>
 #include <ignition/transport/Clock.hh>
 #include <ignition/transport/Discovery.hh>
 #include <ignition/transport/log/Log.hh>
@@ -36,31 +47,81 @@
 #include <ignition/transport/Node.hh>
 #include <ignition/transport/TransportTypes.hh>
 
+#include "Compression.hh"
 #include "Console.hh"
+#include "HeaderTime.hh"
+#include "Manifest.hh"
 #include "raii-sqlite3.hh"
 #include "build_config.hh"
 
 using namespace ignition::transport;
 using namespace ignition::transport::log;
 
+/// \brief Memory preallocated for the data of the queued messages, at most
+/// the maximum size of the buffer.
+static const std::size_t kArenaReserve = 16 << 20;
+
+/// \brief Maximum number of batches taken from the queue that are encoded
+/// or written at once. The next batch is encoded while one is written.
+static const std::size_t kPipelineDepth = 2;
+
+/// \brief Number of messages an encode worker takes from a batch at once.
+static const std::size_t kEncodeSlice = 32;
+
 /// \brief Private implementation
 class ignition::transport::log::Recorder::Implementation
 {
-  /// \brief Data type stored in dataQueue
+  /// \brief Data type stored in dataQueue. The serialized message is
+  /// stored in the arena of the queue.
   public: struct LogData
   {
-    /// \brief Constructor
-    LogData(std::chrono::nanoseconds _stamp, std::vector<char> &&_msgData, // NOLINT
-            const transport::MessageInfo &_msgInfo)
-        : stamp(_stamp), msgData(std::move(_msgData)), msgInfo(_msgInfo)
-    {
-    }
     /// \brief Time stamp of when the message was received by the log recorder
     std::chrono::nanoseconds stamp;
-    /// Serialized message data
-    std::vector<char> msgData;
-    /// Extra information about the message, such as its topic.
-    transport::MessageInfo msgInfo;
+    /// \brief Offset of the serialized message data in the arena
+    std::size_t offset;
+    /// \brief Size of the serialized message data
+    std::size_t size;
+    /// \brief Topic of the message, interned in names
+    const std::string *topic;
+    /// \brief Type of the message, interned in names
+    const std::string *type;
+    /// \brief True if headerTime holds the stamp of the header
+    bool hasHeaderTime = false;
+    /// \brief Stamp of the header of the message
+    std::chrono::nanoseconds headerTime{0};
+  };
+
+  /// \brief Messages taken from dataQueue at once, to encode and write.
+  public: struct EncodeBatch
+  {
+    /// \brief The messages, in the order they were received
+    std::deque<LogData> messages;
+    /// \brief Data of the messages
+    std::vector<char, BufferStdAllocator<char>> arena;
+    /// \brief Compressed data of each message, or empty if the message is
+    /// written as it is. The strings keep their memory from one batch to
+    /// the next.
+    std::vector<std::string> encoded;
+    /// \brief Index of the next message for the encode workers
+    std::size_t nextMessage = 0;
+    /// \brief Number of messages not encoded yet
+    std::size_t pending = 0;
+    /// \brief When the batch was taken from dataQueue
+    std::chrono::steady_clock::time_point taken;
+    /// \brief Time taken to encode the batch
+    std::chrono::nanoseconds encodeLatency{0};
+  };
+
+  /// \brief Topics recorded to a log of their own, see
+  /// Recorder::AddShard().
+  public: struct Shard
+  {
+    /// \brief Pattern matched against the topic names
+    std::regex pattern;
+    /// \brief Path to the log file of the shard
+    std::string file;
+    /// \brief Recorder subscribing to the topics and writing the log file
+    std::unique_ptr<Recorder> recorder;
   };
 
   /// \brief constructor
@@ -82,11 +143,28 @@ class ignition::transport::log::Recorder::Implementation
   /// \param[in] _publisher The Publisher that has advertised
   public: void OnAdvertisement(const Publisher &_publisher);
 
-  /// \sa Recorder::AddTopic(const std::string&)
-  public: RecorderError AddTopic(const std::string &_topic);
+  /// \sa Recorder::AddTopic(const std::string&, const RecorderTopicOptions&)
+  public: RecorderError AddTopic(const std::string &_topic,
+                                 const RecorderTopicOptions &_options);
+
+  /// \sa Recorder::AddTopic(const std::regex&, const RecorderTopicOptions&)
+  public: int64_t AddTopic(const std::regex &_pattern,
+                           const RecorderTopicOptions &_options);
+
+  /// \brief Get the recorder of the shard of a topic.
+  /// \param[in] _topic The topic name
+  /// \return The recorder, or nullptr if the topic matches no shard.
+  public: Recorder *ShardOf(const std::string &_topic);
+
+  /// \brief Start recording to the shards and to the log of the topics of
+  /// no shard, and write the manifest of the shards. Must be called with
+  /// logFileMutex locked.
+  /// \param[in] _file Path to the manifest.
+  /// \return SUCCESS if every log was opened, FAILED_TO_OPEN otherwise.
+  public: RecorderError StartShards(const std::string &_file);
 
-  /// \sa Recorder::AddTopic(const std::regex&)
-  public: int64_t AddTopic(const std::regex &_pattern);
+  /// \brief Stop recording to the shards.
+  public: void StopShards();
 
   /// \brief Worker thread function that writes data from the dataQueue to the
   /// database
@@ -98,6 +176,59 @@ class ignition::transport::log::Recorder::Implementation
   /// \brief Stop the data writer thread
   public: void StopDataWriter();
 
+  /// \brief Worker thread function that compresses the messages of the
+  /// batches in the pipeline
+  public: void EncodeWorkerThread();
+
+  /// \brief Take the messages of dataQueue as a batch, reusing the memory
+  /// of a batch written before. Must be called with dataQueueMutex locked.
+  /// \return The batch.
+  public: std::unique_ptr<EncodeBatch> TakeBatch();
+
+  /// \brief Compress messages of a batch whose topic is compressed.
+  /// \param[in,out] _batch The batch
+  /// \param[in] _begin Index of the first message
+  /// \param[in] _end Index after the last message
+  /// \param[in] _codec Codec of the calling thread
+  public: void EncodeMessages(EncodeBatch &_batch, std::size_t _begin,
+                              std::size_t _end, BlobCodec &_codec) const;
+
+  /// \brief Write a batch and keep its memory for the next ones.
+  /// \param[in] _batch The batch
+  public: void WriteBatch(std::unique_ptr<EncodeBatch> _batch);
+
+  /// \brief Copy the data of a message at the end of the arena of the
+  /// queue, reusing the space of the messages dropped from the queue when
+  /// the arena is full. Must be called with dataQueueMutex locked.
+  /// \param[in] _data Data of the message
+  /// \param[in] _len The size of the message data
+  /// \return Offset of the data in the arena.
+  public: std::size_t AppendToArena(const char *_data, std::size_t _len);
+
+  /// \brief Get the interned copy of a topic or type name. Must be called
+  /// with dataQueueMutex locked.
+  /// \param[in] _name The name
+  /// \return The interned name, valid as long as the recorder.
+  public: const std::string *Intern(const std::string &_name);
+
+  /// \brief Read the stamp of the header of a message, when header times
+  /// are recorded. Must be called with dataQueueMutex locked.
+  /// \param[in] _type Interned type of the message
+  /// \param[in] _data Data of the message
+  /// \param[in] _len The size of the message data
+  /// \param[out] _log The message to set the stamp of
+  public: void ReadHeaderTime(const std::string *_type, const char *_data,
+              std::size_t _len, LogData &_log);
+
+  /// \brief Make the record of a message, to insert it into a log.
+  /// \param[in] _log The message, which the record refers to
+  /// \param[in] _data Data of the message
+  /// \param[in] _len The size of the message data
+  /// \param[in] _compressed True if the data are compressed
+  /// \return The record.
+  public: static MessageRecord Record(const LogData &_log, const void *_data,
+              std::size_t _len, bool _compressed = false);
+
   /// \brief Decrement buffer size by given amount
   /// \param[in] _len The amount to decrement
   public: void DecrementBufferSize(std::size_t _len);
@@ -105,22 +236,70 @@ class ignition::transport::log::Recorder::Implementation
   /// \brief Write any data left in the queue to the log file
   public: void FlushDataQueue();
 
-  /// \brief Write data to log file
-  /// \param[in] _logData data to be written
-  public: void WriteToLogFile(const LogData &_logData);
+  /// \brief Forget the messages of the flight recording that are older
+  /// than its window. Must be called with dataQueueMutex locked.
+  /// \param[in] _now Time stamp of the last message.
+  public: void TrimFlightRecording(const std::chrono::nanoseconds &_now);
+
+  /// \sa Recorder::Dump()
+  public: RecorderError Dump(const std::string &_file);
+
+  /// \brief Callback of the service advertised by Recorder::AdvertiseDump()
+  /// \param[in] _req Path to the log file
+  /// \param[out] _rep True if the messages were written
+  /// \return True
+  public: bool OnDumpRequest(const ignition::msgs::StringMsg &_req,
+                             ignition::msgs::Boolean &_rep);
+
+  /// \brief Write several messages to the log file at once
+  /// \param[in] _batch messages to be written, in order
+  public: void WriteToLogFile(const EncodeBatch &_batch);
+
+  /// \brief Insert messages into the log file. Must be called with
+  /// logFileMutex locked.
+  /// \param[in] _records The messages.
+  public: void InsertRecords(const std::vector<MessageRecord> &_records);
+
+  /// \brief Check whether a message must go to a new segment. Must be
+  /// called with logFileMutex locked.
+  /// \param[in] _data The message.
+  /// \return True if the current segment would exceed a limit.
+  public: bool SegmentIsFull(const LogData &_data) const;
+
+  /// \brief Open the next segment of the recording as the log file, and
+  /// list it in the manifest. Must be called with logFileMutex locked.
+  /// \return False if the segment could not be opened, the log file is
+  /// kept in that case.
+  public: bool OpenSegment();
 
   /// \brief log file or nullptr if not recording
   public: std::unique_ptr<Log> logFile;
 
-  /// \brief A set of topic patterns that we want to subscribe to
-  public: std::vector<std::regex> patterns;
+  /// \brief A set of topic patterns that we want to subscribe to, with the
+  /// sampling of the topics that match them
+  public: std::vector<std::pair<std::regex, RecorderTopicOptions>> patterns;
 
   /// \brief A set of topic names that we have already subscribed to. When new
   /// publishers advertise topics that we are already subscribed to, our
   /// OnAdvertisement callback can just ignore it.
   public: std::set<std::string> alreadySubscribed;
 
-  /// \brief mutex for thread safety when evaluating newly advertised topics
+  /// \brief Advertised topics that matched none of the patterns. Matching a
+  /// std::regex is slow, and a topic is advertised once per publisher, so
+  /// the decision is kept until another pattern is added.
+  public: std::unordered_set<std::string> rejectedTopics;
+
+  /// \brief Shards of the recordings, in the order they were added. They
+  /// are never removed, and added with both logFileMutex and topicMutex
+  /// locked, so either protects them.
+  public: std::vector<std::unique_ptr<Shard>> shards;
+
+  /// \brief Path to the manifest of the shards, or empty if the current
+  /// recording isn't sharded. Protected by logFileMutex.
+  public: std::string shardManifest;
+
+  /// \brief mutex for thread safety when evaluating newly advertised topics,
+  /// protects patterns, rejectedTopics and shards
   public: std::mutex topicMutex;
 
   /// \brief mutex for thread safety with log file
@@ -142,6 +321,46 @@ class ignition::transport::log::Recorder::Implementation
   /// from topic callbacks.
   public: std::atomic<std::size_t> maxBufferSize{1000<<20};
 
+  /// \brief Settings of the log files created by Start(). Protected by
+  /// logFileMutex.
+  public: LogOpenOptions openOptions;
+
+  /// \brief Maximum bytes of message data per segment set by the user,
+  /// zero for no limit. Protected by logFileMutex.
+  public: std::size_t maxSegmentSize = 0;
+
+  /// \brief Maximum duration of a segment set by the user, zero for no
+  /// limit. Protected by logFileMutex.
+  public: std::chrono::nanoseconds maxSegmentDuration{0};
+
+  /// \brief Limits of the segments of the current recording, copied from
+  /// the ones above by Start(). Protected by logFileMutex.
+  public: std::size_t segmentSizeLimit = 0;
+
+  /// \brief See segmentSizeLimit.
+  public: std::chrono::nanoseconds segmentDurationLimit{0};
+
+  /// \brief Path to the manifest of the segments, or empty if the current
+  /// recording isn't split. Protected by logFileMutex.
+  public: std::string manifestFile;
+
+  /// \brief Path to each segment of the current recording. Protected by
+  /// logFileMutex.
+  public: std::vector<std::string> segmentFiles;
+
+  /// \brief Number of messages in the current segment.
+  public: std::size_t segmentMessages = 0;
+
+  /// \brief Bytes of message data in the current segment.
+  public: std::size_t segmentBytes = 0;
+
+  /// \brief Time stamp of the first message of the current segment.
+  public: std::chrono::nanoseconds segmentStart{0};
+
+  /// \brief Function called with each complete segment. Protected by
+  /// logFileMutex.
+  public: std::function<void(const std::string &)> segmentCallback;
+
   /// \brief Current size of the buffer (in bytes). This is computed everytime
   /// data is added or removed from the queue. Because of that, we'll use
   /// `dataQueueMutex` to protect it.
@@ -153,9 +372,88 @@ class ignition::transport::log::Recorder::Implementation
   /// overwritten. Thus, it is important to set the queue size appropriately for
   /// your application. The maximum size of this queue is determined by
   /// `maxBufferSize`. The current size of the buffer is calculated from
-  /// `msgData`.
+  /// the `size` of the messages.
   public: std::deque<LogData> dataQueue;
 
+  /// \brief Data of the messages in dataQueue, stored contiguously. The
+  /// callbacks copy the messages here instead of allocating memory for each
+  /// one, the arena only grows until it can hold the usual backlog. Its
+  /// memory comes from the default BufferAllocator.
+  public: std::vector<char, BufferStdAllocator<char>> dataArena;
+
+  /// \brief Batches taken from dataQueue, in order, that are encoded or
+  /// written. Protected by pipelineMutex.
+  public: std::deque<std::unique_ptr<EncodeBatch>> pipeline;
+
+  /// \brief Batches written, whose memory is reused for the next ones.
+  /// Only used by the dataWriter thread, or once it has stopped.
+  public: std::vector<std::unique_ptr<EncodeBatch>> spareBatches;
+
+  /// \brief Mutex to synchronize access to the pipeline and its statistics
+  public: std::mutex pipelineMutex;
+
+  /// \brief Condition variable signaled when a batch can be encoded
+  public: std::condition_variable encodeCondVar;
+
+  /// \brief Condition variable signaled when a batch is encoded
+  public: std::condition_variable encodedCondVar;
+
+  /// \brief True to stop the encode workers. Protected by pipelineMutex.
+  public: bool stopEncoders = false;
+
+  /// \brief Number of encode workers set by the user
+  public: std::atomic<std::size_t> encodeWorkerCount{0};
+
+  /// \brief Threads compressing the messages of the batches
+  public: std::vector<std::thread> encodeWorkers;
+
+  /// \brief Dictionary of each topic compressed by the encode workers,
+  /// copied from openOptions by Start(). Empty if the writer compresses
+  /// them. Constant while recording.
+  public: std::map<std::string, std::string> encodeDictionaries;
+
+  /// \brief Statistics of the batches written, protected by pipelineMutex.
+  /// The queue statistics are filled in by Recorder::PipelineStats().
+  public: RecorderPipelineStats stats;
+
+  /// \brief Names of the topics and types of the messages recorded. The
+  /// messages in the queues point to these.
+  public: std::set<std::string> names;
+
+  /// \brief True to record the stamps of the headers of the messages
+  public: std::atomic<bool> recordHeaderTimes{false};
+
+  /// \brief Whether the messages of each interned type have a header.
+  /// Protected by dataQueueMutex.
+  public: std::map<const std::string *, bool> headerTypes;
+
+  /// \brief Messages dropped from dataQueue, by interned topic. Protected
+  /// by dataQueueMutex, like the counters below.
+  public: std::map<const std::string *, uint64_t> droppedPerTopic;
+
+  /// \brief Number of messages dropped from dataQueue
+  public: uint64_t droppedMessages = 0;
+
+  /// \brief Bytes of the messages dropped from dataQueue
+  public: uint64_t droppedBytes = 0;
+
+  /// \brief Time stamps of the first and the last message received
+  public: std::chrono::nanoseconds firstReceived{0};
+
+  /// \brief See firstReceived.
+  public: std::chrono::nanoseconds lastReceived{0};
+
+  /// \brief True once a message was received in the current recording
+  public: bool received = false;
+
+  /// \brief Time stamp of the last message written, protected by
+  /// pipelineMutex.
+  public: std::chrono::nanoseconds lastWritten{0};
+
+  /// \brief When the current recording started, protected by
+  /// pipelineMutex.
+  public: std::chrono::steady_clock::time_point recordingStart;
+
   /// \brief Mutex to synchronize access to dataQueue and bufferSize
   public: std::mutex dataQueueMutex;
 
@@ -174,6 +472,18 @@ class ignition::transport::log::Recorder::Implementation
   /// \brief Whether the OnMessageReceived should stop queuing received
   /// messages. This will be set to true when `Recorder::Stop` is called
   public: std::atomic<bool> stopQueue{false};
+
+  /// \brief True while the messages are kept in dataQueue until Dump()
+  /// instead of being written, see Recorder::StartFlightRecorder().
+  public: std::atomic<bool> flightRecorder{false};
+
+  /// \brief Time covered by the flight recording, zero for no limit.
+  /// Protected by dataQueueMutex.
+  public: std::chrono::nanoseconds flightWindow{0};
+
+  /// \brief Bytes of message data kept by the flight recording, zero for
+  /// no limit. Protected by dataQueueMutex.
+  public: std::size_t flightMaxSize = 0;
 };
 
 //////////////////////////////////////////////////
@@ -221,20 +531,50 @@ void Recorder::Implementation::OnMessageReceived(
   }
 
   // Don't store anything in the queue unless the data writer has started, which
-  // happens when Recorder::Start is called.
-  if (this->dataWriterState)
+  // happens when Recorder::Start is called, or a flight recording has.
+  if (this->dataWriterState || this->flightRecorder)
   {
-    std::vector<char> tmp(_data, _data+_len);
+    // With the wall clock, the delay since the message was read from the
+    // socket is taken out, so that the stamps follow the arrival of the
+    // messages rather than the dispatch of the callbacks.
+    std::chrono::nanoseconds stamp = this->clock->Time();
+    if (this->clock == WallClock::Instance() &&
+        _info.ReceiveTime() != std::chrono::steady_clock::time_point())
+    {
+      const auto delay = std::chrono::steady_clock::now() - _info.ReceiveTime();
+      if (delay > std::chrono::steady_clock::duration::zero())
+        stamp -= std::chrono::duration_cast<std::chrono::nanoseconds>(delay);
+    }
 
     std::lock_guard<std::mutex> lock(this->dataQueueMutex);
+    if (this->flightRecorder)
+    {
+      // The ring forgets its oldest messages, they aren't dropped.
+      while (this->flightMaxSize > 0 && !this->dataQueue.empty() &&
+             this->bufferSize + _len > this->flightMaxSize)
+      {
+        this->DecrementBufferSize(this->dataQueue.front().size);
+        this->dataQueue.pop_front();
+      }
+    }
     // If the maxBufferSize is zero, we have an infinite queue
-    if (this->maxBufferSize > 0)
+    else if (this->maxBufferSize > 0)
     {
       // Only pop if we have a message in the queue.
       if ((this->bufferSize + _len > this->maxBufferSize) &&
           !this->dataQueue.empty())
       {
-        this->DecrementBufferSize(this->dataQueue.front().msgData.size());
+        const LogData &dropped = this->dataQueue.front();
+        if (this->droppedMessages == 0)
+        {
+          LWRN("The recorder buffer is full, the oldest messages are "
+               "dropped. See Recorder::SetBufferSize()\n");
+        }
+        ++this->droppedMessages;
+        this->droppedBytes += dropped.size;
+        ++this->droppedPerTopic[dropped.topic];
+
+        this->DecrementBufferSize(dropped.size);
         this->dataQueue.pop_front();
       }
     }
@@ -243,8 +583,19 @@ void Recorder::Implementation::OnMessageReceived(
     // If the message being added here is larger than maxBufferSize, it should
     // still be recorded. It just means that the buffer cannot hold another
     // message until it is recorded.
-    this->dataQueue.emplace_back(this->clock->Time(), std::move(tmp), _info);
-    this->dataQueueCondVar.notify_one();
+    const std::size_t offset = this->AppendToArena(_data, _len);
+    if (!this->received)
+      this->firstReceived = stamp;
+    this->received = true;
+    this->lastReceived = stamp;
+    this->dataQueue.push_back({stamp, offset, _len,
+      this->Intern(_info.Topic()), this->Intern(_info.Type())});
+    this->ReadHeaderTime(this->dataQueue.back().type, _data, _len,
+      this->dataQueue.back());
+    if (this->flightRecorder)
+      this->TrimFlightRecording(stamp);
+    else
+      this->dataQueueCondVar.notify_one();
   }
 }
 
@@ -253,6 +604,7 @@ void Recorder::Implementation::OnAdvertisement(const Publisher &_publisher)
 {
   std::string partition;
   std::string topic;
+  RecorderTopicOptions options;
 
   TopicUtils::DecomposeFullyQualifiedTopic(
         _publisher.Topic(), partition, topic);
@@ -273,24 +625,71 @@ void Recorder::Implementation::OnAdvertisement(const Publisher &_publisher)
   if (this->alreadySubscribed.find(topic) != this->alreadySubscribed.end())
     return;
 
-  for (const std::regex &pattern : this->patterns)
   {
-    if (std::regex_match(topic, pattern))
+    std::lock_guard<std::mutex> lock(this->topicMutex);
+    if (this->rejectedTopics.find(topic) != this->rejectedTopics.end())
+      return;
+
+    const auto match = std::find_if(this->patterns.begin(),
+      this->patterns.end(),
+      [&topic](const std::pair<std::regex, RecorderTopicOptions> &_pattern)
+      {
+        return std::regex_match(topic, _pattern.first);
+      });
+    if (match == this->patterns.end())
     {
-      this->AddTopic(topic);
+      this->rejectedTopics.insert(topic);
+      return;
     }
+    options = match->second;
   }
+
+  // Subscribing takes the locks of the node, so topicMutex is released first
+  this->AddTopic(topic, options);
 }
 
 //////////////////////////////////////////////////
-RecorderError Recorder::Implementation::AddTopic(const std::string &_topic)
+RecorderError Recorder::Implementation::AddTopic(const std::string &_topic,
+    const RecorderTopicOptions &_options)
 {
   // Do not subscribe to a topic if we are already subscribed.
   if (this->alreadySubscribed.find(_topic) == this->alreadySubscribed.end())
   {
+    // The topics of a shard are subscribed by its recorder
+    Recorder *shard = this->ShardOf(_topic);
+    if (shard)
+    {
+      if (shard->AddTopic(_topic, _options) ==
+          RecorderError::FAILED_TO_SUBSCRIBE)
+        return RecorderError::FAILED_TO_SUBSCRIBE;
+      this->alreadySubscribed.insert(_topic);
+      return RecorderError::SUCCESS;
+    }
+
     LDBG("Recording [" << _topic << "]\n");
+
+    // The rate is limited by the subscription, before the callback runs
+    SubscribeOptions opts;
+    if (_options.msgsPerSec > 0)
+      opts.SetMsgsPerSec(_options.msgsPerSec);
+
+    // The skipped messages never reach the queue
+    RawCallback callback = this->rawCallback;
+    if (_options.decimation > 1)
+    {
+      const uint64_t decimation = _options.decimation;
+      auto count = std::make_shared<std::atomic<uint64_t>>(0);
+      callback = [this, decimation, count](
+          const char *_data, std::size_t _len,
+          const transport::MessageInfo &_info)
+      {
+        if ((*count)++ % decimation == 0)
+          this->OnMessageReceived(_data, _len, _info);
+      };
+    }
+
     // Subscribe to the topic whether it exists or not
-    if (!this->node.SubscribeRaw(_topic, this->rawCallback))
+    if (!this->node.SubscribeRaw(_topic, callback, kGenericMessageType, opts))
     {
       LERR("Failed to subscribe to [" << _topic << "]\n");
       return RecorderError::FAILED_TO_SUBSCRIBE;
@@ -303,7 +702,8 @@ RecorderError Recorder::Implementation::AddTopic(const std::string &_topic)
 }
 
 //////////////////////////////////////////////////
-int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern)
+int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern,
+    const RecorderTopicOptions &_options)
 {
   int numSubscriptions = 0;
   std::vector<std::string> allTopics;
@@ -313,7 +713,8 @@ int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern)
     if (std::regex_match(topic, _pattern))
     {
       // Subscribe to the topic
-      if (this->AddTopic(topic) == RecorderError::FAILED_TO_SUBSCRIBE)
+      if (this->AddTopic(topic, _options) ==
+          RecorderError::FAILED_TO_SUBSCRIBE)
       {
         return static_cast<int64_t>(RecorderError::FAILED_TO_SUBSCRIBE);
       }
@@ -325,43 +726,335 @@ int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern)
     }
   }
 
-  this->patterns.push_back(_pattern);
+  std::lock_guard<std::mutex> lock(this->topicMutex);
+  this->patterns.emplace_back(_pattern, _options);
+  this->rejectedTopics.clear();
 
   return numSubscriptions;
 }
 
+//////////////////////////////////////////////////
+Recorder *Recorder::Implementation::ShardOf(const std::string &_topic)
+{
+  std::lock_guard<std::mutex> lock(this->topicMutex);
+  for (const std::unique_ptr<Shard> &shard : this->shards)
+  {
+    if (std::regex_match(_topic, shard->pattern))
+      return shard->recorder.get();
+  }
+  return nullptr;
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::Implementation::StartShards(const std::string &_file)
+{
+  if (this->segmentSizeLimit > 0 ||
+      this->segmentDurationLimit > std::chrono::nanoseconds::zero())
+  {
+    LERR("The shards of a recording can't be split in segments\n");
+    return RecorderError::FAILED_TO_OPEN;
+  }
+
+  // The file is the manifest of the shards
+  if (std::ifstream(_file))
+  {
+    LERR("File [" << _file << "] already exists\n");
+    return RecorderError::FAILED_TO_OPEN;
+  }
+
+  // Each shard records with the settings of this recorder
+  const std::string file = Manifest::SegmentFilename(_file, 0);
+  std::vector<std::string> files = {file};
+  bool started = true;
+  for (const std::unique_ptr<Shard> &shard : this->shards)
+  {
+    Recorder &recorder = *shard->recorder;
+    recorder.Sync(this->clock);
+    recorder.SetOpenOptions(this->openOptions);
+    recorder.SetBufferSize(this->maxBufferSize >> 20);
+    recorder.SetEncodeWorkers(this->encodeWorkerCount);
+    recorder.SetRecordHeaderTimes(this->recordHeaderTimes);
+    if (recorder.Start(shard->file) != RecorderError::SUCCESS)
+    {
+      started = false;
+      break;
+    }
+    files.push_back(shard->file);
+  }
+
+  if (started)
+  {
+    this->logFile.reset(new Log());
+    if (!this->logFile->Open(file, std::ios_base::out, this->openOptions))
+    {
+      LERR("Failed to open or create file [" << file << "]\n");
+      this->logFile.reset(nullptr);
+      started = false;
+    }
+  }
+
+  if (started && !Manifest::Write(_file, files, true))
+  {
+    this->logFile.reset(nullptr);
+    started = false;
+  }
+
+  if (!started)
+  {
+    this->StopShards();
+    return RecorderError::FAILED_TO_OPEN;
+  }
+
+  this->shardManifest = _file;
+  return RecorderError::SUCCESS;
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::StopShards()
+{
+  std::vector<Recorder *> recorders;
+  {
+    std::lock_guard<std::mutex> lock(this->topicMutex);
+    for (const std::unique_ptr<Shard> &shard : this->shards)
+      recorders.push_back(shard->recorder.get());
+  }
+
+  for (Recorder *recorder : recorders)
+    recorder->Stop();
+}
+
 //////////////////////////////////////////////////
 void Recorder::Implementation::DataWriterThread()
 {
-  while (this->dataWriterState)
+  // The messages are taken from the queue all at once, so the subscription
+  // callbacks only wait for the queue while it is swapped. The next batch
+  // is taken, and encoded by the workers, while one is written.
+  std::size_t inFlight = 0;
+  while (true)
   {
-    std::unique_lock<std::mutex> lock(this->dataQueueMutex);
-    if (this->dataQueue.empty())
+    std::unique_ptr<EncodeBatch> batch;
     {
-      this->dataQueueCondVar.wait(lock,
+      std::unique_lock<std::mutex> lock(this->dataQueueMutex);
+      if (inFlight == 0)
+      {
+        this->dataQueueCondVar.wait(lock,
+          [this]
+          {
+            return !this->dataQueue.empty() || !this->dataWriterState;
+          });
+      }
+      if (inFlight < kPipelineDepth && !this->dataQueue.empty())
+        batch = this->TakeBatch();
+    }
+
+    // Stopped, with nothing left to write
+    if (!batch && inFlight == 0)
+      return;
+
+    // The queue is unlocked before locking another mutex.
+    if (batch)
+    {
+      std::lock_guard<std::mutex> lock(this->pipelineMutex);
+      this->pipeline.push_back(std::move(batch));
+      ++this->stats.batchesInFlight;
+      this->encodeCondVar.notify_all();
+      ++inFlight;
+    }
+
+    // Write the oldest batch once it's encoded
+    {
+      std::unique_lock<std::mutex> lock(this->pipelineMutex);
+      this->encodedCondVar.wait(lock,
         [this]
         {
-          return !this->dataQueue.empty() || !this->dataWriterState;
+          return this->pipeline.front()->pending == 0;
         });
+      batch = std::move(this->pipeline.front());
+      this->pipeline.pop_front();
+    }
+    this->WriteBatch(std::move(batch));
+    --inFlight;
+  }
+}
 
-      if (this->dataQueue.empty())
+//////////////////////////////////////////////////
+void Recorder::Implementation::EncodeWorkerThread()
+{
+  BlobCodec codec;
+  std::unique_lock<std::mutex> lock(this->pipelineMutex);
+  while (true)
+  {
+    // Take messages of the oldest batch that has some left
+    EncodeBatch *batch = nullptr;
+    this->encodeCondVar.wait(lock,
+      [this, &batch]
       {
-        continue;
-      }
-    }
+        for (const std::unique_ptr<EncodeBatch> &queued : this->pipeline)
+        {
+          if (queued->nextMessage < queued->messages.size())
+          {
+            batch = queued.get();
+            return true;
+          }
+        }
+        return this->stopEncoders;
+      });
+    if (!batch)
+      return;
 
-    const auto logData = std::move(this->dataQueue.front());
-    this->dataQueue.pop_front();
-    // Unlock before locking another mutex.
+    const std::size_t begin = batch->nextMessage;
+    const std::size_t end =
+      std::min(begin + kEncodeSlice, batch->messages.size());
+    batch->nextMessage = end;
+
+    // The batch stays in the pipeline until its messages are encoded
     lock.unlock();
+    this->EncodeMessages(*batch, begin, end, codec);
+    lock.lock();
+
+    batch->pending -= end - begin;
+    if (batch->pending == 0)
+    {
+      batch->encodeLatency = std::chrono::steady_clock::now() - batch->taken;
+      this->encodedCondVar.notify_all();
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<Recorder::Implementation::EncodeBatch>
+Recorder::Implementation::TakeBatch()
+{
+  std::unique_ptr<EncodeBatch> batch;
+  if (this->spareBatches.empty())
+  {
+    batch.reset(new EncodeBatch);
+  }
+  else
+  {
+    batch = std::move(this->spareBatches.back());
+    this->spareBatches.pop_back();
+  }
+
+  batch->messages.swap(this->dataQueue);
+  batch->arena.swap(this->dataArena);
+  this->bufferSize = 0;
+  batch->taken = std::chrono::steady_clock::now();
+  batch->encodeLatency = std::chrono::nanoseconds::zero();
+
+  // Without workers the messages are compressed by the log itself
+  if (this->encodeWorkers.empty())
+  {
+    batch->nextMessage = batch->messages.size();
+    batch->pending = 0;
+  }
+  else
+  {
+    if (batch->encoded.size() < batch->messages.size())
+      batch->encoded.resize(batch->messages.size());
+    batch->nextMessage = 0;
+    batch->pending = batch->messages.size();
+  }
+  return batch;
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::EncodeMessages(EncodeBatch &_batch,
+  const std::size_t _begin, const std::size_t _end, BlobCodec &_codec) const
+{
+  for (std::size_t i = _begin; i < _end; ++i)
+  {
+    const LogData &data = _batch.messages[i];
+    std::string &encoded = _batch.encoded[i];
+    encoded.clear();
+
+    auto dictionary = this->encodeDictionaries.find(*data.topic);
+    if (dictionary == this->encodeDictionaries.end() || data.size == 0)
+      continue;
 
-    this->WriteToLogFile(logData);
+    // A message that fails is left to the log, which reports it
+    if (!_codec.Compress(_batch.arena.data() + data.offset, data.size,
+          dictionary->second, encoded))
+    {
+      encoded.clear();
+    }
   }
 }
 
+//////////////////////////////////////////////////
+void Recorder::Implementation::WriteBatch(std::unique_ptr<EncodeBatch> _batch)
+{
+  const auto start = std::chrono::steady_clock::now();
+  this->WriteToLogFile(*_batch);
+  const auto written = std::chrono::steady_clock::now();
+
+  uint64_t bytes = 0;
+  std::chrono::nanoseconds last{0};
+  for (const LogData &data : _batch->messages)
+  {
+    bytes += data.size;
+    last = std::max(last, data.stamp);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->pipelineMutex);
+    --this->stats.batchesInFlight;
+    ++this->stats.batchesWritten;
+    this->stats.writtenMessages += _batch->messages.size();
+    this->stats.writtenBytes += bytes;
+    this->lastWritten = std::max(this->lastWritten, last);
+    this->stats.encodeLatency = _batch->encodeLatency;
+    this->stats.writeLatency = written - start;
+  }
+
+  // The memory is kept for the next batches.
+  _batch->messages.clear();
+  _batch->arena.clear();
+  this->spareBatches.push_back(std::move(_batch));
+}
+
 //////////////////////////////////////////////////
 void Recorder::Implementation::StartDataWriter()
 {
+  // Preallocate the arenas for the usual backlog of messages, they grow if
+  // needed.
+  const std::size_t reserve = this->maxBufferSize > 0 ?
+    std::min<std::size_t>(this->maxBufferSize, kArenaReserve) : kArenaReserve;
+  {
+    std::lock_guard<std::mutex> lock(this->dataQueueMutex);
+    this->dataArena.reserve(reserve);
+    this->droppedPerTopic.clear();
+    this->droppedMessages = 0;
+    this->droppedBytes = 0;
+    this->received = false;
+  }
+  if (this->spareBatches.empty())
+    this->spareBatches.emplace_back(new EncodeBatch);
+  this->spareBatches.back()->arena.reserve(reserve);
+
+  {
+    std::lock_guard<std::mutex> lock(this->pipelineMutex);
+    this->stats = RecorderPipelineStats();
+    this->lastWritten = std::chrono::nanoseconds::zero();
+    this->recordingStart = std::chrono::steady_clock::now();
+  }
+
+  // The chunked logs compress their chunks instead of the messages
+  this->encodeDictionaries.clear();
+  if (this->encodeWorkerCount > 0 && this->logFile &&
+      this->logFile->Format() == LogFormat::SQLITE)
+  {
+    this->encodeDictionaries = this->openOptions.compressedTopics;
+  }
+  if (!this->encodeDictionaries.empty())
+  {
+    for (std::size_t i = 0; i < this->encodeWorkerCount; ++i)
+    {
+      this->encodeWorkers.emplace_back(
+        &Recorder::Implementation::EncodeWorkerThread, this);
+    }
+  }
+
   this->dataWriterState = true;
 
   this->dataWriter =
@@ -377,6 +1070,17 @@ void Recorder::Implementation::StopDataWriter()
   {
     this->dataWriter.join();
   }
+
+  // The data writer has written every batch of the pipeline
+  {
+    std::lock_guard<std::mutex> lock(this->pipelineMutex);
+    this->stopEncoders = true;
+  }
+  this->encodeCondVar.notify_all();
+  for (std::thread &worker : this->encodeWorkers)
+    worker.join();
+  this->encodeWorkers.clear();
+  this->stopEncoders = false;
 }
 
 //////////////////////////////////////////////////
@@ -398,35 +1102,246 @@ void Recorder::Implementation::DecrementBufferSize(std::size_t _len)
 //////////////////////////////////////////////////
 void Recorder::Implementation::FlushDataQueue()
 {
-  while (true)
+  // The data writer thread and the encode workers have stopped, the
+  // messages left are encoded here.
+  std::unique_ptr<EncodeBatch> batch;
   {
-    std::unique_lock<std::mutex> lock(this->dataQueueMutex);
+    std::lock_guard<std::mutex> lock(this->dataQueueMutex);
     if (this->dataQueue.empty())
       return;
+    batch = this->TakeBatch();
+  }
 
-    const auto logData = std::move(this->dataQueue.front());
+  // The queue is unlocked before locking another mutex.
+  {
+    std::lock_guard<std::mutex> lock(this->pipelineMutex);
+    ++this->stats.batchesInFlight;
+  }
+  if (!this->encodeDictionaries.empty())
+  {
+    BlobCodec codec;
+    if (batch->encoded.size() < batch->messages.size())
+      batch->encoded.resize(batch->messages.size());
+    this->EncodeMessages(*batch, 0, batch->messages.size(), codec);
+  }
+  this->WriteBatch(std::move(batch));
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::TrimFlightRecording(
+  const std::chrono::nanoseconds &_now)
+{
+  if (this->flightWindow <= std::chrono::nanoseconds::zero())
+    return;
+
+  while (!this->dataQueue.empty() &&
+         _now - this->dataQueue.front().stamp > this->flightWindow)
+  {
+    this->DecrementBufferSize(this->dataQueue.front().size);
     this->dataQueue.pop_front();
-    // Unlock before locking another mutex.
-    lock.unlock();
+  }
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::Implementation::Dump(const std::string &_file)
+{
+  LogOpenOptions options;
+  {
+    std::lock_guard<std::mutex> lock(this->logFileMutex);
+    options = this->openOptions;
+  }
 
-    this->WriteToLogFile(logData);
+  // Copy the ring, so that the messages keep arriving while it's written
+  std::deque<LogData> messages;
+  std::vector<char> arena;
+  {
+    std::lock_guard<std::mutex> lock(this->dataQueueMutex);
+    if (!this->flightRecorder)
+    {
+      LERR("No flight recording is in progress\n");
+      return RecorderError::FAILED_TO_OPEN;
+    }
+
+    messages = this->dataQueue;
+    if (!messages.empty())
+    {
+      const std::size_t begin = messages.front().offset;
+      arena.assign(this->dataArena.begin() +
+          static_cast<std::ptrdiff_t>(begin), this->dataArena.end());
+      for (LogData &data : messages)
+        data.offset -= begin;
+    }
+  }
+
+  Log log;
+  if (!log.Open(_file, std::ios_base::out, options))
+  {
+    LERR("Failed to open or create file [" << _file << "]\n");
+    return RecorderError::FAILED_TO_OPEN;
+  }
+
+  // The interned names outlive the recorder
+  std::vector<MessageRecord> records;
+  records.reserve(messages.size());
+  for (const LogData &data : messages)
+  {
+    records.push_back(Record(data,
+      reinterpret_cast<const void *>(arena.data() + data.offset),
+      data.size));
+  }
+
+  if (!records.empty())
+  {
+    const std::size_t inserted = log.InsertMessages(records);
+    if (inserted != records.size())
+    {
+      LWRN("Failed to insert " << records.size() - inserted
+        << " messages into log file\n");
+    }
+  }
+
+  LMSG("Dumped " << records.size() << " messages to [" << _file << "]\n");
+  return RecorderError::SUCCESS;
+}
+
+//////////////////////////////////////////////////
+bool Recorder::Implementation::OnDumpRequest(
+  const ignition::msgs::StringMsg &_req, ignition::msgs::Boolean &_rep)
+{
+  _rep.set_data(this->Dump(_req.data()) == RecorderError::SUCCESS);
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t Recorder::Implementation::AppendToArena(
+  const char *_data, const std::size_t _len)
+{
+  // Move the data of the queue to the beginning of the arena rather than
+  // growing it, when messages were dropped from the front of the queue.
+  const std::size_t begin = this->dataQueue.empty() ?
+    this->dataArena.size() : this->dataQueue.front().offset;
+  if (begin > 0 &&
+      this->dataArena.size() + _len > this->dataArena.capacity())
+  {
+    this->dataArena.erase(this->dataArena.begin(),
+      this->dataArena.begin() + static_cast<std::ptrdiff_t>(begin));
+    for (LogData &data : this->dataQueue)
+      data.offset -= begin;
+  }
+
+  const std::size_t offset = this->dataArena.size();
+  this->dataArena.insert(this->dataArena.end(), _data, _data + _len);
+  return offset;
+}
+
+//////////////////////////////////////////////////
+const std::string *Recorder::Implementation::Intern(const std::string &_name)
+{
+  auto it = this->names.find(_name);
+  if (it == this->names.end())
+    it = this->names.insert(_name).first;
+  return &*it;
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::ReadHeaderTime(const std::string *_type,
+  const char *_data, const std::size_t _len, LogData &_log)
+{
+  if (!this->recordHeaderTimes)
+    return;
+
+  // The types are looked up once, most of them have a header
+  auto it = this->headerTypes.find(_type);
+  if (it == this->headerTypes.end())
+    it = this->headerTypes.emplace(_type, HasHeader(*_type)).first;
+  if (it->second)
+    _log.hasHeaderTime = HeaderTime(_data, _len, _log.headerTime);
+}
+
+//////////////////////////////////////////////////
+MessageRecord Recorder::Implementation::Record(const LogData &_log,
+  const void *_data, const std::size_t _len, const bool _compressed)
+{
+  return {_log.stamp, _log.topic, _log.type, _data, _len, _compressed,
+    _log.hasHeaderTime ? &_log.headerTime : nullptr};
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::WriteToLogFile(const EncodeBatch &_batch)
+{
+  const std::deque<LogData> &logData = _batch.messages;
+  if (logData.empty())
+    return;
+
+  std::vector<std::string> completeSegments;
+  std::function<void(const std::string &)> callback;
+  {
+    std::lock_guard<std::mutex> logLock(this->logFileMutex);
+    // Note: this->logFile will only be a nullptr before Start() has been
+    // called or after Stop() has been called. If it is a nullptr, then we
+    // are not recording anything yet, so we can just skip inserting the
+    // messages.
+    if (!this->logFile)
+      return;
+
+    std::vector<MessageRecord> records;
+    records.reserve(logData.size());
+    for (std::size_t i = 0; i < logData.size(); ++i)
+    {
+      const LogData &data = logData[i];
+
+      // The messages before this one complete the current segment
+      if (this->SegmentIsFull(data))
+      {
+        this->InsertRecords(records);
+        records.clear();
+        const std::string segment = this->logFile->Filename();
+        if (this->OpenSegment())
+          completeSegments.push_back(segment);
+      }
+
+      if (this->segmentMessages == 0)
+        this->segmentStart = data.stamp;
+      ++this->segmentMessages;
+      this->segmentBytes += data.size;
+
+      // The messages compressed by the encode workers are stored as they are
+      if (i < _batch.encoded.size() && !_batch.encoded[i].empty())
+      {
+        const std::string &encoded = _batch.encoded[i];
+        records.push_back(
+          Record(data, encoded.data(), encoded.size(), true));
+        continue;
+      }
+      records.push_back(Record(data,
+        reinterpret_cast<const void *>(_batch.arena.data() + data.offset),
+        data.size));
+    }
+    this->InsertRecords(records);
+    callback = this->segmentCallback;
+  }
+
+  // The callback may take long, e.g. to upload the segment, so it's called
+  // without blocking the recorder.
+  if (callback)
+  {
+    for (const std::string &segment : completeSegments)
+      callback(segment);
   }
 }
 
 //////////////////////////////////////////////////
-void Recorder::Implementation::WriteToLogFile(const LogData &_logData)
+void Recorder::Implementation::InsertRecords(
+  const std::vector<MessageRecord> &_records)
 {
-  std::lock_guard<std::mutex> logLock(this->logFileMutex);
-  // Note: this->logFile will only be a nullptr before Start() has been
-  // called or after Stop() has been called. If it is a nullptr, then we are
-  // not recording anything yet, so we can just skip inserting the message.
-  if (this->logFile &&
-      !this->logFile->InsertMessage(
-        _logData.stamp, _logData.msgInfo.Topic(), _logData.msgInfo.Type(),
-        reinterpret_cast<const void *>(_logData.msgData.data()),
-        _logData.msgData.size()))
+  if (_records.empty())
+    return;
+
+  const std::size_t inserted = this->logFile->InsertMessages(_records);
+  if (inserted != _records.size())
   {
-    LWRN("Failed to insert message into log file\n");
+    LWRN("Failed to insert " << _records.size() - inserted
+      << " messages into log file\n");
   }
   // TODO(anyone) It would be nice for testing to simulate long delays
   // associated with disk writes. In the mean time, a sleep can be added here
@@ -434,6 +1349,47 @@ void Recorder::Implementation::WriteToLogFile(const LogData &_logData)
   // std::this_thread::sleep_for(std::chrono::milliseconds(30));
 }
 
+//////////////////////////////////////////////////
+bool Recorder::Implementation::SegmentIsFull(const LogData &_data) const
+{
+  if (this->manifestFile.empty() || this->segmentMessages == 0)
+    return false;
+
+  return (this->segmentSizeLimit > 0 &&
+          this->segmentBytes + _data.size > this->segmentSizeLimit) ||
+    (this->segmentDurationLimit > std::chrono::nanoseconds::zero() &&
+     _data.stamp - this->segmentStart >= this->segmentDurationLimit);
+}
+
+//////////////////////////////////////////////////
+bool Recorder::Implementation::OpenSegment()
+{
+  // The limits are measured again from the next message, even if the
+  // segment can't be opened, so that it's only retried after a while.
+  this->segmentMessages = 0;
+  this->segmentBytes = 0;
+
+  const std::string file =
+    Manifest::SegmentFilename(this->manifestFile, this->segmentFiles.size());
+  std::unique_ptr<Log> segment(new Log());
+  if (!segment->Open(file, std::ios_base::out, this->openOptions))
+  {
+    LERR("Failed to open or create segment [" << file << "]\n");
+    return false;
+  }
+
+  // Closes the previous segment
+  this->logFile = std::move(segment);
+  this->segmentFiles.push_back(file);
+
+  // The segment is recorded anyway, it can be added to the manifest by hand
+  if (!Manifest::Write(this->manifestFile, this->segmentFiles))
+    LERR("Failed to add segment [" << file << "] to the manifest\n");
+
+  LDBG("Recording segment [" << file << "]\n");
+  return true;
+}
+
 //////////////////////////////////////////////////
 Recorder::Recorder()
   : dataPtr(new Implementation)
@@ -457,7 +1413,7 @@ Recorder::~Recorder()
 
 //////////////////////////////////////////////////
 RecorderError Recorder::Sync(const Clock *_clockIn) {
-  if (this->dataPtr->logFile)
+  if (this->dataPtr->logFile || this->dataPtr->flightRecorder)
   {
     LERR("Recording is already in progress\n");
     return RecorderError::ALREADY_RECORDING;
@@ -470,18 +1426,48 @@ RecorderError Recorder::Sync(const Clock *_clockIn) {
 RecorderError Recorder::Start(const std::string &_file)
 {
   std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
-  if (this->dataPtr->logFile)
+  if (this->dataPtr->logFile || this->dataPtr->flightRecorder)
   {
     LWRN("Recording is already in progress\n");
     return RecorderError::ALREADY_RECORDING;
   }
 
-  this->dataPtr->logFile.reset(new Log());
-  if (!this->dataPtr->logFile->Open(_file, std::ios_base::out))
+  this->dataPtr->segmentSizeLimit = this->dataPtr->maxSegmentSize;
+  this->dataPtr->segmentDurationLimit = this->dataPtr->maxSegmentDuration;
+  if (!this->dataPtr->shards.empty())
   {
-    LERR("Failed to open or create file [" << _file << "]\n");
-    this->dataPtr->logFile.reset(nullptr);
-    return RecorderError::FAILED_TO_OPEN;
+    const RecorderError result = this->dataPtr->StartShards(_file);
+    if (result != RecorderError::SUCCESS)
+      return result;
+  }
+  else if (this->dataPtr->segmentSizeLimit > 0 ||
+      this->dataPtr->segmentDurationLimit > std::chrono::nanoseconds::zero())
+  {
+    // The file is the manifest of the segments
+    if (std::ifstream(_file))
+    {
+      LERR("File [" << _file << "] already exists\n");
+      return RecorderError::FAILED_TO_OPEN;
+    }
+
+    this->dataPtr->manifestFile = _file;
+    this->dataPtr->segmentFiles.clear();
+    if (!this->dataPtr->OpenSegment())
+    {
+      this->dataPtr->manifestFile.clear();
+      return RecorderError::FAILED_TO_OPEN;
+    }
+  }
+  else
+  {
+    this->dataPtr->logFile.reset(new Log());
+    if (!this->dataPtr->logFile->Open(_file, std::ios_base::out,
+          this->dataPtr->openOptions))
+    {
+      LERR("Failed to open or create file [" << _file << "]\n");
+      this->dataPtr->logFile.reset(nullptr);
+      return RecorderError::FAILED_TO_OPEN;
+    }
   }
 
   this->dataPtr->StartDataWriter();
@@ -490,9 +1476,71 @@ RecorderError Recorder::Start(const std::string &_file)
   return RecorderError::SUCCESS;
 }
 
+//////////////////////////////////////////////////
+RecorderError Recorder::StartFlightRecorder(
+  const std::chrono::nanoseconds &_window, const std::size_t _maxSize)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  if (this->dataPtr->logFile || this->dataPtr->flightRecorder)
+  {
+    LWRN("Recording is already in progress\n");
+    return RecorderError::ALREADY_RECORDING;
+  }
+
+  if (!this->dataPtr->shards.empty())
+  {
+    LERR("The shards of a recording can't be flight recorded\n");
+    return RecorderError::FAILED_TO_OPEN;
+  }
+
+  {
+    std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+    this->dataPtr->flightWindow = _window;
+    this->dataPtr->flightMaxSize = _maxSize;
+    this->dataPtr->dataArena.reserve(_maxSize > 0 ?
+      std::min<std::size_t>(2 * _maxSize, kArenaReserve) : kArenaReserve);
+    this->dataPtr->flightRecorder = true;
+  }
+
+  LMSG("Started flight recording\n");
+  return RecorderError::SUCCESS;
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::Dump(const std::string &_file)
+{
+  return this->dataPtr->Dump(_file);
+}
+
+//////////////////////////////////////////////////
+bool Recorder::AdvertiseDump(const std::string &_service)
+{
+  return this->dataPtr->node.Advertise(_service,
+    &Recorder::Implementation::OnDumpRequest, this->dataPtr.get());
+}
+
+//////////////////////////////////////////////////
+bool Recorder::FlightRecording() const
+{
+  return this->dataPtr->flightRecorder;
+}
+
 //////////////////////////////////////////////////
 void Recorder::Stop()
 {
+  // The messages of a flight recording are only written by Dump()
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->dataQueueMutex);
+    if (this->dataPtr->flightRecorder)
+    {
+      this->dataPtr->flightRecorder = false;
+      this->dataPtr->dataQueue.clear();
+      this->dataPtr->dataArena.clear();
+      this->dataPtr->bufferSize = 0;
+      return;
+    }
+  }
+
   {
     std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
     // If the logFile is null, the recorder has already stopped.
@@ -506,27 +1554,88 @@ void Recorder::Stop()
   this->dataPtr->FlushDataQueue();
   LMSG("Done\n");
 
-  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
-  this->dataPtr->logFile.reset(nullptr);
+  std::string lastSegment;
+  std::function<void(const std::string &)> callback;
+  bool sharded;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+    sharded = !this->dataPtr->shardManifest.empty();
+    this->dataPtr->shardManifest.clear();
+    if (!this->dataPtr->manifestFile.empty())
+    {
+      lastSegment = this->dataPtr->logFile->Filename();
+      callback = this->dataPtr->segmentCallback;
+      this->dataPtr->manifestFile.clear();
+      this->dataPtr->segmentFiles.clear();
+    }
+    this->dataPtr->logFile.reset(nullptr);
+  }
+
+  if (sharded)
+    this->dataPtr->StopShards();
+
+  // The last segment is complete once it's closed
+  if (callback)
+    callback(lastSegment);
 }
 
 //////////////////////////////////////////////////
 RecorderError Recorder::AddTopic(const std::string &_topic)
 {
-  return this->dataPtr->AddTopic(_topic);
+  return this->dataPtr->AddTopic(_topic, RecorderTopicOptions());
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::AddTopic(const std::string &_topic,
+    const RecorderTopicOptions &_options)
+{
+  return this->dataPtr->AddTopic(_topic, _options);
 }
 
 //////////////////////////////////////////////////
 int64_t Recorder::AddTopic(const std::regex &_topic)
 {
-  return this->dataPtr->AddTopic(_topic);
+  return this->dataPtr->AddTopic(_topic, RecorderTopicOptions());
+}
+
+//////////////////////////////////////////////////
+int64_t Recorder::AddTopic(const std::regex &_topic,
+    const RecorderTopicOptions &_options)
+{
+  return this->dataPtr->AddTopic(_topic, _options);
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::AddShard(const std::regex &_topics,
+    const std::string &_file)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  if (this->dataPtr->logFile || this->dataPtr->flightRecorder)
+  {
+    LWRN("Recording is already in progress\n");
+    return RecorderError::ALREADY_RECORDING;
+  }
+
+  std::unique_ptr<Implementation::Shard> shard(new Implementation::Shard);
+  shard->pattern = _topics;
+  shard->file = _file;
+  shard->recorder.reset(new Recorder());
+
+  std::lock_guard<std::mutex> topicLock(this->dataPtr->topicMutex);
+  this->dataPtr->shards.push_back(std::move(shard));
+  return RecorderError::SUCCESS;
 }
 
 //////////////////////////////////////////////////
 std::string Recorder::Filename() const
 {
-  return this->dataPtr->logFile == nullptr ? "" :
-         this->dataPtr->logFile->Filename();
+  if (this->dataPtr->logFile == nullptr)
+    return "";
+  if (!this->dataPtr->shardManifest.empty())
+    return this->dataPtr->shardManifest;
+  if (!this->dataPtr->manifestFile.empty())
+    return this->dataPtr->manifestFile;
+  return this->dataPtr->logFile->Filename();
 }
 
 //////////////////////////////////////////////////
@@ -548,3 +1657,141 @@ void Recorder::SetBufferSize(std::size_t _size)
   // Shift by 20 to convert to bytes
   this->dataPtr->maxBufferSize = _size << 20;
 }
+
+//////////////////////////////////////////////////
+void Recorder::SetOpenOptions(const LogOpenOptions &_options)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  this->dataPtr->openOptions = _options;
+}
+
+//////////////////////////////////////////////////
+void Recorder::SetEncodeWorkers(std::size_t _workers)
+{
+  this->dataPtr->encodeWorkerCount = _workers;
+}
+
+//////////////////////////////////////////////////
+std::size_t Recorder::EncodeWorkers() const
+{
+  return this->dataPtr->encodeWorkerCount;
+}
+
+//////////////////////////////////////////////////
+void Recorder::SetRecordHeaderTimes(const bool _record)
+{
+  this->dataPtr->recordHeaderTimes = _record;
+}
+
+//////////////////////////////////////////////////
+bool Recorder::RecordHeaderTimes() const
+{
+  return this->dataPtr->recordHeaderTimes;
+}
+
+//////////////////////////////////////////////////
+RecorderPipelineStats Recorder::PipelineStats() const
+{
+  RecorderPipelineStats stats;
+  std::chrono::nanoseconds lastWritten;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->pipelineMutex);
+    stats = this->dataPtr->stats;
+    lastWritten = this->dataPtr->lastWritten;
+
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - this->dataPtr->recordingStart;
+    if (elapsed.count() > 0)
+      stats.writeThroughput = stats.writtenBytes / elapsed.count();
+  }
+
+  // The queue is unlocked before locking another mutex.
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->dataQueueMutex);
+    stats.queuedMessages = this->dataPtr->dataQueue.size();
+    stats.queuedBytes = this->dataPtr->bufferSize;
+    stats.droppedMessages = this->dataPtr->droppedMessages;
+    stats.droppedBytes = this->dataPtr->droppedBytes;
+    for (const auto &dropped : this->dataPtr->droppedPerTopic)
+      stats.droppedMessagesPerTopic[*dropped.first] = dropped.second;
+
+    // Measured from the first message until one is written
+    if (this->dataPtr->received)
+    {
+      const std::chrono::nanoseconds written = stats.writtenMessages > 0 ?
+        lastWritten : this->dataPtr->firstReceived;
+      stats.writerLag = std::max(std::chrono::nanoseconds::zero(),
+        this->dataPtr->lastReceived - written);
+    }
+  }
+
+  // The shards are added up. Their recorders don't have shards.
+  std::vector<const Recorder *> recorders;
+  {
+    std::lock_guard<std::mutex> topicLock(this->dataPtr->topicMutex);
+    for (const auto &shard : this->dataPtr->shards)
+      recorders.push_back(shard->recorder.get());
+  }
+  for (const Recorder *recorder : recorders)
+  {
+    const RecorderPipelineStats shard = recorder->PipelineStats();
+    stats.queuedMessages += shard.queuedMessages;
+    stats.queuedBytes += shard.queuedBytes;
+    stats.batchesInFlight += shard.batchesInFlight;
+    stats.batchesWritten += shard.batchesWritten;
+    stats.encodeLatency = std::max(stats.encodeLatency, shard.encodeLatency);
+    stats.writeLatency = std::max(stats.writeLatency, shard.writeLatency);
+    stats.droppedMessages += shard.droppedMessages;
+    stats.droppedBytes += shard.droppedBytes;
+    for (const auto &dropped : shard.droppedMessagesPerTopic)
+      stats.droppedMessagesPerTopic[dropped.first] += dropped.second;
+    stats.writtenMessages += shard.writtenMessages;
+    stats.writtenBytes += shard.writtenBytes;
+    stats.writeThroughput += shard.writeThroughput;
+    stats.writerLag = std::max(stats.writerLag, shard.writerLag);
+  }
+  return stats;
+}
+
+//////////////////////////////////////////////////
+const LogOpenOptions &Recorder::OpenOptions() const
+{
+  return this->dataPtr->openOptions;
+}
+
+//////////////////////////////////////////////////
+void Recorder::SetMaxSegmentSize(std::size_t _size)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  // Shift by 20 to convert to bytes
+  this->dataPtr->maxSegmentSize = _size << 20;
+}
+
+//////////////////////////////////////////////////
+std::size_t Recorder::MaxSegmentSize() const
+{
+  // Shift by 20 to convert to MB
+  return this->dataPtr->maxSegmentSize >> 20;
+}
+
+//////////////////////////////////////////////////
+void Recorder::SetMaxSegmentDuration(
+    const std::chrono::nanoseconds &_duration)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  this->dataPtr->maxSegmentDuration = _duration;
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds Recorder::MaxSegmentDuration() const
+{
+  return this->dataPtr->maxSegmentDuration;
+}
+
+//////////////////////////////////////////////////
+void Recorder::SetSegmentCallback(
+    const std::function<void(const std::string &)> &_callback)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  this->dataPtr->segmentCallback = _callback;
+}
@@ -15,9 +15,16 @@
  *
 */
 
+#include <chrono>
+#include <cstdio>
+#include <map>
 #include <regex>
 #include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs/stringmsg.pb.h>
 
+#include "ignition/transport/Node.hh"
 #include "ignition/transport/log/Recorder.hh"
 #include "gtest/gtest.h"
 
@@ -103,9 +110,350 @@ TEST(Record, SetBufferSize)
   EXPECT_EQ(40u, recorder.BufferSize());
 }
 
+//////////////////////////////////////////////////
+TEST(Record, OpenOptions)
+{
+  transport::log::Recorder recorder;
+  EXPECT_TRUE(recorder.OpenOptions().journalMode.empty());
+
+  recorder.SetOpenOptions(transport::log::LogOpenOptions::WriteOptimized());
+  EXPECT_EQ("WAL", recorder.OpenOptions().journalMode);
+  EXPECT_EQ(
+      transport::log::RecorderError::SUCCESS, recorder.Start(":memory:"));
+  recorder.Stop();
+
+  transport::log::LogOpenOptions invalid;
+  invalid.synchronous = "SOMETIMES";
+  recorder.SetOpenOptions(invalid);
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.Start(":memory:"));
+}
+
+//////////////////////////////////////////////////
+TEST(Record, EncodeWorkers)
+{
+  transport::log::Recorder recorder;
+  EXPECT_EQ(0u, recorder.EncodeWorkers());
+
+  recorder.SetEncodeWorkers(2);
+  EXPECT_EQ(2u, recorder.EncodeWorkers());
+  EXPECT_EQ(
+      transport::log::RecorderError::SUCCESS, recorder.Start(":memory:"));
+
+  const transport::log::RecorderPipelineStats stats = recorder.PipelineStats();
+  EXPECT_EQ(0u, stats.queuedMessages);
+  EXPECT_EQ(0u, stats.batchesWritten);
+  EXPECT_EQ(0u, stats.writtenMessages);
+  EXPECT_EQ(0u, stats.droppedMessages);
+  EXPECT_TRUE(stats.droppedMessagesPerTopic.empty());
+  EXPECT_EQ(std::chrono::nanoseconds::zero(), stats.writerLag);
+  recorder.Stop();
+}
+
+//////////////////////////////////////////////////
+TEST(Record, SegmentLimits)
+{
+  const std::string manifest = "Recorder_TEST_segments.tlog";
+  const std::string segment = "Recorder_TEST_segments.0000.tlog";
+  std::remove(manifest.c_str());
+  std::remove(segment.c_str());
+
+  transport::log::Recorder recorder;
+  EXPECT_EQ(0u, recorder.MaxSegmentSize());
+  EXPECT_EQ(std::chrono::nanoseconds::zero(), recorder.MaxSegmentDuration());
+
+  recorder.SetMaxSegmentSize(64);
+  recorder.SetMaxSegmentDuration(std::chrono::minutes(10));
+  EXPECT_EQ(64u, recorder.MaxSegmentSize());
+  EXPECT_EQ(std::chrono::minutes(10), recorder.MaxSegmentDuration());
+
+  std::vector<std::string> complete;
+  recorder.SetSegmentCallback([&](const std::string &_segment)
+  {
+    complete.push_back(_segment);
+  });
+
+  EXPECT_EQ(
+      transport::log::RecorderError::SUCCESS, recorder.Start(manifest));
+  EXPECT_EQ(manifest, recorder.Filename());
+  recorder.Stop();
+  EXPECT_EQ(std::vector<std::string>{segment}, complete);
+
+  // The manifest is read as a log
+  {
+    transport::log::Log log;
+    EXPECT_TRUE(log.Open(manifest));
+    EXPECT_EQ(transport::log::LogFormat::SEGMENTED, log.Format());
+  }
+
+  // The manifest isn't overwritten
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.Start(manifest));
+
+  std::remove(manifest.c_str());
+  std::remove(segment.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Record, FlightRecorder)
+{
+  const std::string file = "Recorder_TEST_flight.tlog";
+  std::remove(file.c_str());
+
+  transport::log::Recorder recorder;
+  EXPECT_FALSE(recorder.FlightRecording());
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.Dump(file));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/flight")));
+
+  // The ring keeps three messages of 100 bytes.
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.StartFlightRecorder(std::chrono::minutes(1), 350));
+  EXPECT_TRUE(recorder.FlightRecording());
+  EXPECT_EQ(transport::log::RecorderError::ALREADY_RECORDING,
+      recorder.Start(":memory:"));
+  EXPECT_EQ(transport::log::RecorderError::ALREADY_RECORDING,
+      recorder.StartFlightRecorder(std::chrono::minutes(1), 0));
+
+  transport::Node node;
+  auto pub = node.Advertise<msgs::StringMsg>("/flight");
+  ASSERT_TRUE(pub);
+  for (int i = 0; i < 10; ++i)
+  {
+    msgs::StringMsg msg;
+    msg.set_data(std::to_string(i) + std::string(97, 'x'));
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Nothing is written until the dump.
+  EXPECT_EQ(0u, recorder.PipelineStats().writtenMessages);
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS, recorder.Dump(file));
+  EXPECT_TRUE(recorder.FlightRecording());
+
+  {
+    transport::log::Log log;
+    ASSERT_TRUE(log.Open(file));
+    std::vector<std::string> received;
+    auto batch = log.QueryMessages();
+    for (const transport::log::Message &message : batch)
+    {
+      msgs::StringMsg msg;
+      ASSERT_TRUE(msg.ParseFromString(message.Data()));
+      received.push_back(msg.data().substr(0, 1));
+    }
+    EXPECT_EQ(std::vector<std::string>({"7", "8", "9"}), received);
+  }
+
+  recorder.Stop();
+  EXPECT_FALSE(recorder.FlightRecording());
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.Dump(file));
+  EXPECT_EQ(
+      transport::log::RecorderError::SUCCESS, recorder.Start(":memory:"));
+
+  std::remove(file.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Record, HeaderTimes)
+{
+  const std::string file = "Recorder_TEST_header.tlog";
+  std::remove(file.c_str());
+
+  transport::log::Recorder recorder;
+  EXPECT_FALSE(recorder.RecordHeaderTimes());
+  recorder.SetRecordHeaderTimes(true);
+  EXPECT_TRUE(recorder.RecordHeaderTimes());
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/header")));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.StartFlightRecorder(std::chrono::minutes(1), 0));
+
+  // The stamps aren't in the order the messages are published
+  transport::Node node;
+  auto pub = node.Advertise<msgs::StringMsg>("/header");
+  ASSERT_TRUE(pub);
+  for (int i = 0; i < 10; ++i)
+  {
+    msgs::StringMsg msg;
+    msg.set_data(std::to_string(i));
+    if (i != 5)
+      msg.mutable_header()->mutable_stamp()->set_sec((i * 3) % 10);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS, recorder.Dump(file));
+  recorder.Stop();
+
+  transport::log::Log log;
+  ASSERT_TRUE(log.Open(file));
+  transport::log::AllTopics options(transport::log::QualifiedTimeRange(
+    transport::log::QualifiedTime(std::chrono::seconds(2)),
+    transport::log::QualifiedTime(std::chrono::seconds(4))));
+  options.SetTimeReference(
+    transport::log::TimeRangeOption::TimeReference::HEADER);
+  std::vector<std::string> received;
+  for (const transport::log::Message &message : log.QueryMessages(options))
+  {
+    msgs::StringMsg msg;
+    ASSERT_TRUE(msg.ParseFromString(message.Data()));
+    received.push_back(msg.data());
+  }
+
+  // The message without a header isn't selected
+  EXPECT_EQ(std::vector<std::string>({"1", "4", "8"}), received);
+  std::remove(file.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Record, Shards)
+{
+  const std::string manifest = "Recorder_TEST_shards.tlog";
+  const std::string rest = "Recorder_TEST_shards.0000.tlog";
+  const std::string cameras = "Recorder_TEST_shards.cameras.tlog";
+  for (const std::string &file : {manifest, rest, cameras})
+    std::remove(file.c_str());
+
+  transport::log::Recorder recorder;
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddShard(std::regex("/shards/camera.*"), cameras));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/shards/camera_front")));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/shards/imu")));
+  EXPECT_EQ(2u, recorder.Topics().size());
+
+  // The shards can't be flight recorded
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.StartFlightRecorder(std::chrono::minutes(1), 0));
+
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS, recorder.Start(manifest));
+  EXPECT_EQ(manifest, recorder.Filename());
+  EXPECT_EQ(transport::log::RecorderError::ALREADY_RECORDING,
+      recorder.AddShard(std::regex(".*"), "Recorder_TEST_other.tlog"));
+
+  transport::Node node;
+  auto camera = node.Advertise<msgs::StringMsg>("/shards/camera_front");
+  auto imu = node.Advertise<msgs::StringMsg>("/shards/imu");
+  ASSERT_TRUE(camera);
+  ASSERT_TRUE(imu);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for (int i = 0; i < 6; ++i)
+  {
+    msgs::StringMsg msg;
+    msg.set_data(std::to_string(i));
+    EXPECT_TRUE((i % 2 == 0 ? camera : imu).Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+  EXPECT_EQ(6u, recorder.PipelineStats().writtenMessages);
+
+  // Each shard has its own topics
+  {
+    transport::log::Log log;
+    ASSERT_TRUE(log.Open(cameras));
+    const auto summaries = log.TopicSummaries();
+    ASSERT_EQ(1u, summaries.size());
+    EXPECT_EQ("/shards/camera_front", summaries[0].topic);
+    EXPECT_EQ(3u, summaries[0].messageCount);
+  }
+
+  // The manifest is read as one log, in the order of the messages
+  {
+    transport::log::Log log;
+    ASSERT_TRUE(log.Open(manifest));
+    EXPECT_EQ(transport::log::LogFormat::SHARDED, log.Format());
+    std::vector<std::string> received;
+    auto batch = log.QueryMessages();
+    for (const transport::log::Message &message : batch)
+    {
+      msgs::StringMsg msg;
+      ASSERT_TRUE(msg.ParseFromString(message.Data()));
+      received.push_back(msg.data());
+    }
+    EXPECT_EQ(std::vector<std::string>({"0", "1", "2", "3", "4", "5"}),
+      received);
+  }
+
+  // The manifest isn't overwritten
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.Start(manifest));
+
+  // The shards can't be split in segments
+  std::remove(manifest.c_str());
+  recorder.SetMaxSegmentSize(64);
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.Start(manifest));
+
+  for (const std::string &file : {manifest, rest, cameras})
+    std::remove(file.c_str());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
 }
+
+//////////////////////////////////////////////////
+TEST(Record, TopicSampling)
+{
+  const std::string file = "Recorder_TEST_sampling.tlog";
+  std::remove(file.c_str());
+
+  transport::log::RecorderTopicOptions decimated;
+  decimated.decimation = 3;
+  transport::log::RecorderTopicOptions limited;
+  limited.msgsPerSec = 1;
+
+  transport::log::Recorder recorder;
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/sampling/decimated"), decimated));
+  EXPECT_EQ(0, recorder.AddTopic(std::regex("/sampling/lim.*"), limited));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/sampling/all")));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS, recorder.Start(file));
+
+  transport::Node node;
+  auto decimatedPub = node.Advertise<msgs::StringMsg>("/sampling/decimated");
+  auto limitedPub = node.Advertise<msgs::StringMsg>("/sampling/limited");
+  auto allPub = node.Advertise<msgs::StringMsg>("/sampling/all");
+  ASSERT_TRUE(decimatedPub);
+  ASSERT_TRUE(limitedPub);
+  ASSERT_TRUE(allPub);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for (int i = 0; i < 10; ++i)
+  {
+    msgs::StringMsg msg;
+    msg.set_data(std::to_string(i));
+    EXPECT_TRUE(decimatedPub.Publish(msg));
+    EXPECT_TRUE(limitedPub.Publish(msg));
+    EXPECT_TRUE(allPub.Publish(msg));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+
+  // The skipped messages are never queued, so none was dropped
+  EXPECT_EQ(0u, recorder.PipelineStats().droppedMessages);
+
+  transport::log::Log log;
+  ASSERT_TRUE(log.Open(file));
+  std::map<std::string, std::vector<std::string>> received;
+  auto batch = log.QueryMessages();
+  for (const transport::log::Message &message : batch)
+  {
+    msgs::StringMsg msg;
+    ASSERT_TRUE(msg.ParseFromString(message.Data()));
+    received[message.Topic()].push_back(msg.data());
+  }
+  EXPECT_EQ(std::vector<std::string>({"0", "3", "6", "9"}),
+    received["/sampling/decimated"]);
+  EXPECT_EQ(std::vector<std::string>({"0"}), received["/sampling/limited"]);
+  EXPECT_EQ(10u, received["/sampling/all"].size());
+
+  std::remove(file.c_str());
+}
@@ -17,17 +17,28 @@
 
 #include "LogCommandAPI.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
+#include <cstdint>
+#include <iomanip>
+#include <ios>
 #include <iostream>
+#include <mutex>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include <ignition/transport/log/Export.hh>
+#include <ignition/transport/log/Log.hh>
 #include <ignition/transport/log/Playback.hh>
 #include <ignition/transport/log/Recorder.hh>
 #include <ignition/transport/Node.hh>
 #include <ignition/transport/NodeOptions.hh>
 #include "../Console.hh"
+#include "../CsvExport.hh"
 
 using namespace ignition;
 ignition::transport::log::PlaybackHandlePtr g_playbackHandler;
@@ -47,6 +58,62 @@ int verbosity(int _level)
 //////////////////////////////////////////////////
 int recordTopics(const char *_file, const char *_pattern)
 {
+  return recordTopicsWithProfile(_file, _pattern, "default");
+}
+
+//////////////////////////////////////////////////
+/// \brief Print the state of a recording on a single line.
+/// \param[in] _stats Statistics of the recorder.
+static void printRecorderStats(
+  const transport::log::RecorderPipelineStats &_stats)
+{
+  std::cout << "Buffered " << _stats.queuedMessages << " messages ("
+            << _stats.queuedBytes << " B), written "
+            << _stats.writtenMessages << " (" << _stats.writtenBytes
+            << " B, " << static_cast<uint64_t>(_stats.writeThroughput)
+            << " B/s), dropped " << _stats.droppedMessages << ", writer lag "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 _stats.writerLag).count() << " ms\n";
+}
+
+//////////////////////////////////////////////////
+int recordTopicsWithProfile(const char *_file, const char *_pattern,
+  const char *_profile)
+{
+  return recordTopicsWithStats(_file, _pattern, _profile, 0);
+}
+
+//////////////////////////////////////////////////
+int recordTopicsWithStats(const char *_file, const char *_pattern,
+  const char *_profile, int _statsPeriod)
+{
+  return recordTopicsWithSampling(_file, _pattern, _profile, _statsPeriod,
+    0, 1);
+}
+
+//////////////////////////////////////////////////
+int recordTopicsWithSampling(const char *_file, const char *_pattern,
+  const char *_profile, int _statsPeriod, int _maxRate, int _decimation)
+{
+  if (_maxRate < 0 || _decimation < 1)
+  {
+    LERR("Invalid sampling, the rate can't be negative and the decimation "
+         "must be at least 1\n");
+    return INVALID_RATE;
+  }
+
+  transport::log::LogOpenOptions options;
+  const std::string profile(_profile);
+  if (profile == "write")
+  {
+    options = transport::log::LogOpenOptions::WriteOptimized();
+  }
+  else if (profile != "default")
+  {
+    LERR("Invalid profile [" << profile << "]\n");
+    return INVALID_PROFILE;
+  }
+
   std::regex regexPattern;
   try
   {
@@ -59,17 +126,61 @@ int recordTopics(const char *_file, const char *_pattern)
   }
 
   transport::log::Recorder recorder;
+  recorder.SetOpenOptions(options);
 
-  if (recorder.AddTopic(regexPattern) < 0)
+  transport::log::RecorderTopicOptions sampling;
+  sampling.msgsPerSec = static_cast<uint64_t>(_maxRate);
+  sampling.decimation = static_cast<uint64_t>(_decimation);
+  if (recorder.AddTopic(regexPattern, sampling) < 0)
     return FAILED_TO_SUBSCRIBE;
 
   if (recorder.Start(_file) != transport::log::RecorderError::SUCCESS)
     return FAILED_TO_OPEN;
 
+  std::mutex statsMutex;
+  std::condition_variable statsCondVar;
+  bool done = false;
+  std::thread statsThread;
+  if (_statsPeriod > 0)
+  {
+    statsThread = std::thread([&]()
+    {
+      std::unique_lock<std::mutex> lock(statsMutex);
+      while (!statsCondVar.wait_for(lock, std::chrono::seconds(_statsPeriod),
+               [&done]() { return done; }))
+      {
+        printRecorderStats(recorder.PipelineStats());
+      }
+    });
+  }
+
   // Wait until signaled (SIGINT, SIGTERM)
   transport::waitForShutdown();
   LDBG("Shutting down\n");
+
+  if (statsThread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      done = true;
+    }
+    statsCondVar.notify_all();
+    statsThread.join();
+  }
+
+  // The counters are kept until the next recording starts.
   recorder.Stop();
+  const transport::log::RecorderPipelineStats stats = recorder.PipelineStats();
+  if (_statsPeriod > 0)
+    printRecorderStats(stats);
+
+  if (stats.droppedMessages > 0)
+  {
+    LERR("Dropped " << stats.droppedMessages << " messages ("
+         << stats.droppedBytes << " B) because the buffer was full\n");
+    for (const auto &dropped : stats.droppedMessagesPerTopic)
+      LERR("  " << dropped.first << ": " << dropped.second << "\n");
+  }
 
   return SUCCESS;
 }
@@ -84,6 +195,20 @@ void playbackSignHandler(int) // NOLINT
 int playbackTopics(const char *_file, const char *_pattern, const int _wait_ms,
   const char *_remap, int _fast)
 {
+  return playbackTopicsWithRate(_file, _pattern, _wait_ms, _remap, _fast, 1.0);
+}
+
+//////////////////////////////////////////////////
+int playbackTopicsWithRate(const char *_file, const char *_pattern,
+  const int _wait_ms, const char *_remap, int _fast, double _rate)
+{
+  // Also rejects NaN
+  if (!_fast && !(_rate > 0))
+  {
+    LERR("Invalid playback rate [" << _rate << "]\n");
+    return INVALID_RATE;
+  }
+
   std::regex regexPattern;
   try
   {
@@ -132,8 +257,150 @@ int playbackTopics(const char *_file, const char *_pattern, const int _wait_ms,
   if (!g_playbackHandler)
     return FAILED_TO_OPEN;
 
+  if (!_fast)
+    g_playbackHandler->SetRate(_rate);
+
   // Wait until playback finishes
   g_playbackHandler->WaitUntilFinished();
   LDBG("Shutting down\n");
   return SUCCESS;
 }
+
+//////////////////////////////////////////////////
+int exportTopics(const char *_file, const char *_pattern, const char *_prefix,
+  int _workers)
+{
+  std::regex regexPattern;
+  try
+  {
+    regexPattern = _pattern;
+  }
+  catch (const std::regex_error &e)
+  {
+    LERR("Regex pattern is invalid\n");
+    return BAD_REGEX;
+  }
+
+  transport::log::Log logFile;
+  if (!logFile.Open(_file, std::ios_base::in,
+        transport::log::LogOpenOptions::ReadOptimized()))
+  {
+    return FAILED_TO_OPEN;
+  }
+
+  transport::log::CsvExport exporter(_prefix,
+    static_cast<std::size_t>(std::max(0, _workers)));
+  if (!exporter.Export(logFile, transport::log::TopicPattern(regexPattern)))
+    return FAILED_TO_EXPORT;
+
+  for (const std::string &file : exporter.Files())
+    std::cout << file << "\n";
+  std::cout << "Exported " << exporter.ExportedMessages() << " messages";
+  if (exporter.SkippedMessages() > 0)
+    std::cout << ", skipped " << exporter.SkippedMessages();
+  std::cout << "\n";
+  return SUCCESS;
+}
+
+//////////////////////////////////////////////////
+int appendLog(const char *_output, const char *_input, double _start,
+  double _end)
+{
+  transport::log::QualifiedTime begin;
+  transport::log::QualifiedTime end;
+  if (_start >= 0 || _end >= 0)
+  {
+    transport::log::Log inputFile;
+    if (!inputFile.Open(_input))
+      return FAILED_TO_OPEN;
+    const std::chrono::nanoseconds origin = inputFile.StartTime();
+    auto toTime = [&origin](double _seconds)
+    {
+      return origin + std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>(_seconds));
+    };
+    if (_start >= 0)
+      begin = transport::log::QualifiedTime(toTime(_start));
+    if (_end >= 0)
+    {
+      end = transport::log::QualifiedTime(toTime(_end),
+          transport::log::QualifiedTime::Qualifier::EXCLUSIVE);
+    }
+  }
+
+  transport::log::Log outputFile;
+  if (!outputFile.Open(_output, std::ios_base::in | std::ios_base::out,
+        transport::log::LogOpenOptions::WriteOptimized()))
+  {
+    return FAILED_TO_OPEN;
+  }
+
+  const int64_t inserted = outputFile.InsertLog(_input,
+      transport::log::QualifiedTimeRange(begin, end));
+  if (inserted < 0)
+    return FAILED_TO_INSERT;
+
+  std::cout << "Inserted " << inserted << " messages of [" << _input
+    << "] into [" << _output << "]\n";
+  return SUCCESS;
+}
+
+//////////////////////////////////////////////////
+/// \brief Format a number of bytes with a binary unit.
+/// \param[in] _bytes The number of bytes.
+/// \return The size, e.g. "1.5 MiB".
+static std::string FormatBytes(const uint64_t _bytes)
+{
+  static const char *const kUnits[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+  double size = static_cast<double>(_bytes);
+  std::size_t unit = 0;
+  while (size >= 1024 && unit + 1 < sizeof(kUnits) / sizeof(kUnits[0]))
+  {
+    size /= 1024;
+    ++unit;
+  }
+
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << size << " "
+         << kUnits[unit];
+  return stream.str();
+}
+
+//////////////////////////////////////////////////
+int logInfo(const char *_file)
+{
+  transport::log::Log logFile;
+  if (!logFile.Open(_file, std::ios_base::in,
+        transport::log::LogOpenOptions::ReadOptimized()))
+  {
+    return FAILED_TO_OPEN;
+  }
+
+  const transport::log::LogSummary summary = logFile.Summary();
+  const std::chrono::duration<double> duration =
+    summary.endTime - summary.startTime;
+
+  std::cout << std::fixed << std::setprecision(3)
+            << "File:      " << _file << "\n"
+            << "Duration:  " << duration.count() << " s\n"
+            << "Messages:  " << summary.messageCount << "\n"
+            << "Size:      " << FormatBytes(summary.totalBytes) << "\n"
+            << "Topics:    " << summary.topics.size() << "\n";
+
+  for (const transport::log::TopicSummary &topic : summary.topics)
+  {
+    const std::chrono::duration<double> span =
+      topic.endTime - topic.startTime;
+    std::cout << "  " << topic.topic << " [" << topic.type << "]: "
+              << topic.messageCount << " messages, "
+              << FormatBytes(topic.totalBytes);
+    if (topic.messageCount > 1 && span.count() > 0)
+    {
+      std::cout << ", " << std::setprecision(1)
+                << static_cast<double>(topic.messageCount - 1) / span.count()
+                << " Hz" << std::setprecision(3);
+    }
+    std::cout << "\n";
+  }
+  return SUCCESS;
+}
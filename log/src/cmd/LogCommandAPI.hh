@@ -27,6 +27,10 @@ extern "C"
     FAILED_TO_SUBSCRIBE = 4,
     INVALID_VERSION     = 5,
     INVALID_REMAP       = 6,
+    INVALID_PROFILE     = 7,
+    INVALID_RATE        = 8,
+    FAILED_TO_EXPORT    = 9,
+    FAILED_TO_INSERT    = 10,
   };
 
   /// \brief Sets verbosity of library
@@ -40,6 +44,49 @@ extern "C"
     const char *_file,
     const char *_pattern);
 
+  /// \brief Record topics whose name matches the given pattern, with the
+  /// database settings of a profile
+  /// \param[in] _file Path to the log file to record
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _profile "write" for LogOpenOptions::WriteOptimized() or
+  /// "default" to keep the settings of SQLite3
+  int IGNITION_TRANSPORT_LOG_VISIBLE recordTopicsWithProfile(
+    const char *_file,
+    const char *_pattern,
+    const char *_profile);
+
+  /// \brief Record topics whose name matches the given pattern, with the
+  /// database settings of a profile, and report the state of the recorder
+  /// \param[in] _file Path to the log file to record
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _profile See recordTopicsWithProfile()
+  /// \param[in] _statsPeriod Print the buffered bytes, the dropped messages
+  /// and the writer throughput and lag every _statsPeriod seconds. Zero only
+  /// prints a summary when the recording stops.
+  int IGNITION_TRANSPORT_LOG_VISIBLE recordTopicsWithStats(
+    const char *_file,
+    const char *_pattern,
+    const char *_profile,
+    int _statsPeriod);
+
+  /// \brief Record topics whose name matches the given pattern, and sample
+  /// the messages of each topic
+  /// \param[in] _file Path to the log file to record
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _profile See recordTopicsWithProfile()
+  /// \param[in] _statsPeriod See recordTopicsWithStats()
+  /// \param[in] _maxRate Messages per second recorded of each topic, or zero
+  /// to record every message
+  /// \param[in] _decimation Record one of every _decimation messages of each
+  /// topic
+  int IGNITION_TRANSPORT_LOG_VISIBLE recordTopicsWithSampling(
+    const char *_file,
+    const char *_pattern,
+    const char *_profile,
+    int _statsPeriod,
+    int _maxRate,
+    int _decimation);
+
   /// \brief Playback topics whose name matches the given pattern
   /// \param[in] _file Path to the log file to playback
   /// \param[in] _pattern ECMAScript regular expression to match against topics
@@ -52,4 +99,56 @@ extern "C"
     const int _wait_ms,
     const char *_remap,
     int _fast);
+
+  /// \brief Playback topics whose name matches the given pattern, at a
+  /// multiple of the speed they were recorded
+  /// \param[in] _file Path to the log file to playback
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _wait_ms How long to wait before the publications begin after
+  /// advertising the topics that will be played back (milliseconds)
+  /// \param[in] _fast Set to > 0 to disable wait between messages.
+  /// \param[in] _rate Multiplier of the speed of the playback, ignored when
+  /// _fast is set. See PlaybackHandle::SetRate().
+  int IGNITION_TRANSPORT_LOG_VISIBLE playbackTopicsWithRate(
+    const char *_file,
+    const char *_pattern,
+    const int _wait_ms,
+    const char *_remap,
+    int _fast,
+    double _rate);
+
+  /// \brief Export the topics whose name matches the given pattern to CSV
+  /// files, one per topic, with a column per field of the message type
+  /// \param[in] _file Path to the log file to export
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _prefix Prefix of the paths of the CSV files, e.g. an
+  /// existing directory followed by a slash
+  /// \param[in] _workers Number of threads decoding the messages, zero for
+  /// one per core
+  int IGNITION_TRANSPORT_LOG_VISIBLE exportTopics(
+    const char *_file,
+    const char *_pattern,
+    const char *_prefix,
+    int _workers);
+
+  /// \brief Append the messages of a log, or of a time range of it, to
+  /// another log, which is created if it doesn't exist. See
+  /// Log::InsertLog().
+  /// \param[in] _output Path to the log file to append to
+  /// \param[in] _input Path to the log file to read
+  /// \param[in] _start First time to copy, in seconds since the start of the
+  /// input log. A negative time copies from the start.
+  /// \param[in] _end Time to stop copying (excluded), in seconds since the
+  /// start of the input log. A negative time copies until the end.
+  int IGNITION_TRANSPORT_LOG_VISIBLE appendLog(
+    const char *_output,
+    const char *_input,
+    double _start,
+    double _end);
+
+  /// \brief Print the duration, the number of messages and the size of a
+  /// log, and the type, number of messages, size and rate of each topic.
+  /// See Log::Summary().
+  /// \param[in] _file Path to the log file
+  int IGNITION_TRANSPORT_LOG_VISIBLE logInfo(const char *_file);
 }
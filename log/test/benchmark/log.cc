@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ignition/transport/log/Batch.hh>
+#include <ignition/transport/log/Log.hh>
+#include <ignition/transport/log/QueryOptions.hh>
+
+#include "logBenchmarkUtils.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Insert messages into a log. The inserts are grouped in one
+/// transaction per period of time, so most of them are cheap and a few pay
+/// for the commit: max_us shows that cost next to the mean. Arguments: size
+/// of the payload, number of topics.
+static void LogInsertMessage(benchmark::State &_state)
+{
+  log::Log logFile;
+  if (!logFile.Open(bench::LogPath("insert"), std::ios_base::out))
+  {
+    _state.SkipWithError("Unable to open the log");
+    return;
+  }
+
+  const int64_t topics = _state.range(1);
+  const std::string payload(static_cast<std::size_t>(_state.range(0)), 'x');
+  int64_t count = 0;
+  double maxTime = 0;
+  for (auto _ : _state)
+  {
+    const std::string topic = bench::Topic(count++ % topics);
+    const auto start = std::chrono::steady_clock::now();
+    const bool inserted = logFile.InsertMessage(
+      std::chrono::nanoseconds(count), topic,
+      bench::kMsgType, payload.data(), payload.size());
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    if (!inserted)
+    {
+      _state.SkipWithError("Unable to insert a message");
+      break;
+    }
+    _state.SetIterationTime(elapsed.count());
+    maxTime = std::max(maxTime, elapsed.count());
+  }
+
+  _state.counters["max_us"] = maxTime * 1e6;
+  _state.SetItemsProcessed(_state.iterations());
+  _state.SetBytesProcessed(_state.iterations() * _state.range(0));
+}
+// Run for several transaction periods, so that the commits are counted.
+BENCHMARK(LogInsertMessage)
+  ->ArgsProduct({{16, 4096, 65536}, {1, 100}})
+  ->UseManualTime()
+  ->MinTime(2.0);
+
+//////////////////////////////////////////////////
+/// \brief Insert batches of messages into a log, as the recorder does.
+/// Arguments: size of the payload, number of messages per batch.
+static void LogInsertMessages(benchmark::State &_state)
+{
+  log::Log logFile;
+  if (!logFile.Open(bench::LogPath("insert_batch"), std::ios_base::out))
+  {
+    _state.SkipWithError("Unable to open the log");
+    return;
+  }
+
+  const std::string topic = bench::Topic(0);
+  const std::string type = bench::kMsgType;
+  const std::string payload(static_cast<std::size_t>(_state.range(0)), 'x');
+  std::vector<log::MessageRecord> records(
+    static_cast<std::size_t>(_state.range(1)),
+    {std::chrono::nanoseconds(0), &topic, &type, payload.data(),
+     payload.size()});
+
+  int64_t count = 0;
+  for (auto _ : _state)
+  {
+    for (log::MessageRecord &record : records)
+      record.time = std::chrono::nanoseconds(++count);
+    if (logFile.InsertMessages(records) != records.size())
+    {
+      _state.SkipWithError("Unable to insert the messages");
+      break;
+    }
+  }
+
+  _state.SetItemsProcessed(_state.iterations() * _state.range(1));
+  _state.SetBytesProcessed(
+    _state.iterations() * _state.range(1) * _state.range(0));
+}
+BENCHMARK(LogInsertMessages)
+  ->ArgsProduct({{16, 4096}, {16, 256}})
+  ->UseRealTime()
+  ->MinTime(2.0);
+
+//////////////////////////////////////////////////
+/// \brief Query all the messages of a log and iterate through them.
+/// Argument: number of messages in the log.
+static void LogQueryAll(benchmark::State &_state)
+{
+  log::Log logFile;
+  if (!logFile.Open(bench::LogPath("query_all"), std::ios_base::out) ||
+      !bench::FillLog(logFile, _state.range(0), 256, 10,
+        std::chrono::milliseconds(1)))
+  {
+    _state.SkipWithError("Unable to create the log");
+    return;
+  }
+
+  for (auto _ : _state)
+  {
+    std::size_t bytes = 0;
+    for (const log::Message &msg : logFile.QueryMessages())
+      bytes += msg.Data().size();
+    benchmark::DoNotOptimize(bytes);
+  }
+
+  _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+}
+BENCHMARK(LogQueryAll)
+  ->Arg(1000)
+  ->Arg(100000)
+  ->Unit(benchmark::kMillisecond);
+
+//////////////////////////////////////////////////
+/// \brief Query one of the ten topics of a log over a tenth of its time
+/// and iterate through the messages. Argument: number of messages in the
+/// log.
+static void LogQueryRange(benchmark::State &_state)
+{
+  log::Log logFile;
+  if (!logFile.Open(bench::LogPath("query_range"), std::ios_base::out) ||
+      !bench::FillLog(logFile, _state.range(0), 256, 10,
+        std::chrono::milliseconds(1)))
+  {
+    _state.SkipWithError("Unable to create the log");
+    return;
+  }
+
+  const std::chrono::milliseconds begin(_state.range(0) / 2);
+  const log::QualifiedTimeRange range(begin, begin + begin / 5);
+  const log::TopicList options(bench::Topic(0), range);
+
+  int64_t messages = 0;
+  for (auto _ : _state)
+  {
+    for (const log::Message &msg : logFile.QueryMessages(options))
+    {
+      benchmark::DoNotOptimize(msg.Data());
+      ++messages;
+    }
+  }
+
+  _state.SetItemsProcessed(messages);
+}
+BENCHMARK(LogQueryRange)
+  ->Arg(1000)
+  ->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+IGN_TRANSPORT_LOG_BENCHMARK_MAIN()
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_LOG_TEST_BENCHMARK_LOGBENCHMARKUTILS_HH_
+#define IGN_TRANSPORT_LOG_TEST_BENCHMARK_LOGBENCHMARKUTILS_HH_
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <ignition/transport/log/Log.hh>
+
+#include "ignition/transport/test_config.h"
+
+namespace bench
+{
+  /// \brief Message type stored by the benchmarks. The payload is opaque
+  /// to the log, so any type name will do.
+  static const char kMsgType[] = "ignition.msgs.Bytes";
+
+  /// \brief Path of a log file of the benchmarks, in the build directory
+  /// so that the disk the logs are usually written to is measured. Any
+  /// previous file with this name is removed.
+  /// \param[in] _name Name of the file, without extension.
+  /// \return The path.
+  inline std::string LogPath(const std::string &_name)
+  {
+    const std::string path = testing::portablePathUnion(
+      IGN_TRANSPORT_LOG_BUILD_PATH, _name + ".tlog");
+    std::remove(path.c_str());
+    return path;
+  }
+
+  /// \brief Topic name used by the benchmarks.
+  /// \param[in] _index Index of the topic.
+  /// \return The topic name.
+  inline std::string Topic(const int64_t _index)
+  {
+    return "/bench/log_" + std::to_string(_index);
+  }
+
+  /// \brief Fill a log with messages published at a fixed period, round
+  /// robin among the topics.
+  /// \param[in] _log Log opened for writing.
+  /// \param[in] _count Number of messages.
+  /// \param[in] _size Size of the payload of each message, in bytes.
+  /// \param[in] _topics Number of topics.
+  /// \param[in] _period Time between two messages.
+  /// \return True if all the messages were inserted.
+  inline bool FillLog(ignition::transport::log::Log &_log,
+    const int64_t _count, const int64_t _size, const int64_t _topics,
+    const std::chrono::nanoseconds &_period)
+  {
+    const std::string payload(static_cast<std::size_t>(_size), 'x');
+    for (int64_t i = 0; i < _count; ++i)
+    {
+      if (!_log.InsertMessage(_period * (i + 1), Topic(i % _topics),
+            kMsgType, payload.data(), payload.size()))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// \brief Run the benchmarks in a partition of their own, with the
+  /// schema of the logs found in the source tree.
+  /// \param[in] _argc Number of arguments.
+  /// \param[in] _argv Arguments, see --help.
+  /// \return Exit code.
+  inline int Main(int _argc, char **_argv)
+  {
+    setenv("IGN_PARTITION", testing::getRandomNumber().c_str(), 1);
+    setenv(ignition::transport::log::SchemaLocationEnvVar.c_str(),
+      IGN_TRANSPORT_LOG_SQL_PATH, 1);
+
+    benchmark::Initialize(&_argc, _argv);
+    if (benchmark::ReportUnrecognizedArguments(_argc, _argv))
+      return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+  }
+}
+
+/// \brief Define the main function of a log benchmark.
+#define IGN_TRANSPORT_LOG_BENCHMARK_MAIN() \
+  int main(int _argc, char **_argv) \
+  { \
+    return bench::Main(_argc, _argv); \
+  }
+
+#endif
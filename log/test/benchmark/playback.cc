@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ignition/transport/Node.hh>
+#include <ignition/transport/log/Log.hh>
+#include <ignition/transport/log/Playback.hh>
+
+#include "logBenchmarkUtils.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Environment variable with the path of an existing log for the
+/// Seek benchmark, e.g. a multi-GB recording. Otherwise, a log is generated.
+static const char kSeekLogEnv[] = "IGN_TRANSPORT_LOG_BENCHMARK_SEEK_FILE";
+
+/// \brief Period of the messages of the timing benchmark.
+static const std::chrono::milliseconds kPeriod(2);
+
+/// \brief Reception times of the messages played back.
+static std::vector<std::chrono::steady_clock::time_point> receptions;
+
+/// \brief Protect receptions.
+static std::mutex receptionsMutex;
+
+//////////////////////////////////////////////////
+/// \brief Record the reception time of a message played back.
+static void OnRaw(const char *, const std::size_t, const MessageInfo &)
+{
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lk(receptionsMutex);
+  receptions.push_back(now);
+}
+
+//////////////////////////////////////////////////
+/// \brief Timing accuracy of a playback: the messages of the log are one
+/// period apart, the jitter of each one is the difference between its
+/// offset from the first reception and its recorded offset. Argument:
+/// number of messages in the log.
+static void PlaybackJitter(benchmark::State &_state)
+{
+  const std::string file = bench::LogPath("jitter");
+  {
+    log::Log logFile;
+    if (!logFile.Open(file, std::ios_base::out) ||
+        !bench::FillLog(logFile, _state.range(0), 64, 1, kPeriod))
+    {
+      _state.SkipWithError("Unable to create the log");
+      return;
+    }
+  }
+
+  Node node;
+  node.SubscribeRaw(bench::Topic(0), OnRaw);
+
+  log::Playback playback(file);
+  std::vector<double> jitters;
+  for (auto _ : _state)
+  {
+    {
+      std::lock_guard<std::mutex> lk(receptionsMutex);
+      receptions.clear();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto handle = playback.Start(std::chrono::milliseconds(100));
+    if (!handle)
+    {
+      _state.SkipWithError("Unable to start the playback");
+      break;
+    }
+    handle->WaitUntilFinished();
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    _state.SetIterationTime(elapsed.count());
+
+    std::lock_guard<std::mutex> lk(receptionsMutex);
+    for (std::size_t i = 1; i < receptions.size(); ++i)
+    {
+      const std::chrono::duration<double, std::micro> offset =
+        receptions[i] - receptions.front();
+      const std::chrono::duration<double, std::micro> expected =
+        kPeriod * static_cast<int64_t>(i);
+      jitters.push_back(std::abs(offset.count() - expected.count()));
+    }
+  }
+
+  if (jitters.empty())
+    return;
+
+  std::sort(jitters.begin(), jitters.end());
+  double sum = 0;
+  for (const double jitter : jitters)
+    sum += jitter;
+  _state.counters["mean_us"] = sum / static_cast<double>(jitters.size());
+  _state.counters["p99_us"] = jitters[jitters.size() * 99 / 100];
+  _state.counters["max_us"] = jitters.back();
+  _state.counters["received"] =
+    static_cast<double>(jitters.size() + 1) /
+    static_cast<double>(_state.iterations());
+}
+BENCHMARK(PlaybackJitter)
+  ->Arg(500)
+  ->Iterations(3)
+  ->UseManualTime()
+  ->Unit(benchmark::kSecond);
+
+//////////////////////////////////////////////////
+/// \brief Latency of a seek to a random time of a paused playback. The log
+/// is the one of IGN_TRANSPORT_LOG_BENCHMARK_SEEK_FILE if set, otherwise
+/// one with 4 KB messages is generated. Argument: size of the generated
+/// log, in MB.
+static void PlaybackSeek(benchmark::State &_state)
+{
+  std::string file;
+  const char *env = std::getenv(kSeekLogEnv);
+  if (env)
+  {
+    file = env;
+  }
+  else
+  {
+    file = bench::LogPath("seek");
+    log::Log logFile;
+    if (!logFile.Open(file, std::ios_base::out) ||
+        !bench::FillLog(logFile, _state.range(0) * 256, 4096, 10,
+          std::chrono::milliseconds(1)))
+    {
+      _state.SkipWithError("Unable to create the log");
+      return;
+    }
+  }
+
+  std::chrono::nanoseconds duration;
+  {
+    log::Log logFile;
+    if (!logFile.Open(file))
+    {
+      _state.SkipWithError("Unable to open the log");
+      return;
+    }
+    duration = logFile.EndTime() - logFile.StartTime();
+  }
+
+  log::Playback playback(file);
+  const auto handle = playback.Start(std::chrono::nanoseconds::zero());
+  if (!handle)
+  {
+    _state.SkipWithError("Unable to start the playback");
+    return;
+  }
+  handle->Pause();
+
+  // Seek to random times, but the same ones on every run.
+  std::mt19937_64 generator(0);
+  std::uniform_int_distribution<int64_t> distribution(0, duration.count());
+  for (auto _ : _state)
+    handle->Seek(std::chrono::nanoseconds(distribution(generator)));
+
+  handle->Stop();
+}
+BENCHMARK(PlaybackSeek)
+  ->Arg(64)
+  ->Arg(1024)
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+IGN_TRANSPORT_LOG_BENCHMARK_MAIN()
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/bytes.pb.h>
+
+#include <string>
+#include <vector>
+
+#include <ignition/transport/Node.hh>
+#include <ignition/transport/log/Batch.hh>
+#include <ignition/transport/log/Log.hh>
+#include <ignition/transport/log/Recorder.hh>
+
+#include "logBenchmarkUtils.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Messages published by each iteration of the ingest benchmark.
+static const int64_t kBurst = 1000;
+
+//////////////////////////////////////////////////
+/// \brief Count the messages of a log.
+/// \param[in] _file The log file.
+/// \return Number of messages.
+static int64_t CountMessages(const std::string &_file)
+{
+  log::Log logFile;
+  if (!logFile.Open(_file))
+    return 0;
+
+  int64_t count = 0;
+  for (const log::Message &msg : logFile.QueryMessages())
+  {
+    benchmark::DoNotOptimize(msg.TimeReceived());
+    ++count;
+  }
+  return count;
+}
+
+//////////////////////////////////////////////////
+/// \brief Sustained ingest of a recorder: each iteration publishes a burst
+/// of messages round robin among the topics and stops the recorder, which
+/// waits for the messages to be written. The messages still in flight when
+/// the recorder stops are not recorded, "recorded" counts the ones that
+/// made it to the file. Arguments: size of the payload, number of topics.
+static void RecorderIngest(benchmark::State &_state)
+{
+  const int64_t topics = _state.range(1);
+
+  Node node;
+  std::vector<Node::Publisher> pubs;
+  for (int64_t i = 0; i < topics; ++i)
+    pubs.push_back(node.Advertise<msgs::Bytes>(bench::Topic(i)));
+
+  msgs::Bytes msg;
+  msg.set_data(std::string(static_cast<std::size_t>(_state.range(0)), 'x'));
+
+  int64_t recorded = 0;
+  for (auto _ : _state)
+  {
+    _state.PauseTiming();
+    const std::string file = bench::LogPath("ingest");
+    log::Recorder recorder;
+    for (int64_t i = 0; i < topics; ++i)
+      recorder.AddTopic(bench::Topic(i));
+    if (recorder.Start(file) != log::RecorderError::SUCCESS)
+    {
+      _state.SkipWithError("Unable to start the recorder");
+      break;
+    }
+    _state.ResumeTiming();
+
+    for (int64_t i = 0; i < kBurst; ++i)
+      pubs[i % topics].Publish(msg);
+    recorder.Stop();
+
+    _state.PauseTiming();
+    recorded += CountMessages(file);
+    _state.ResumeTiming();
+  }
+
+  _state.counters["recorded"] = benchmark::Counter(
+    static_cast<double>(recorded), benchmark::Counter::kIsRate);
+  _state.counters["lost"] = static_cast<double>(
+    _state.iterations() * kBurst - recorded);
+  _state.SetItemsProcessed(_state.iterations() * kBurst);
+  _state.SetBytesProcessed(_state.iterations() * kBurst * _state.range(0));
+}
+BENCHMARK(RecorderIngest)
+  ->ArgsProduct({{16, 4096, 65536}, {1, 10, 100}})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+IGN_TRANSPORT_LOG_BENCHMARK_MAIN()
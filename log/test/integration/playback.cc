@@ -17,9 +17,15 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdio>
+#include <limits>
+#include <memory>
+
 #include <ignition/transport/log/Log.hh>
 #include <ignition/transport/log/Playback.hh>
 #include <ignition/transport/log/Recorder.hh>
+#include <ignition/transport/Clock.hh>
 #include <ignition/transport/Node.hh>
 #include <ignition/utilities/ExtraTestMacros.hh>
 
@@ -91,6 +97,30 @@ bool ExpectSameMessages(
   return true;
 }
 
+//////////////////////////////////////////////////
+/// \brief Compares the messages of one topic of two vectors of messages.
+/// \param[in] _recorded vector of messages that were recorded
+/// \param[in] _played vector of messages that were published
+/// \param[in] _topic the topic to compare
+/// \param[out] a boolean
+bool ExpectSameTopicMessages(
+    const std::vector<MessageInformation> &_recorded,
+    const std::vector<MessageInformation> &_played,
+    const std::string &_topic)
+{
+  auto OfTopic = [&_topic](const std::vector<MessageInformation> &_messages)
+  {
+    std::vector<MessageInformation> result;
+    for (const MessageInformation &msg : _messages)
+    {
+      if (msg.topic == _topic)
+        result.push_back(msg);
+    }
+    return result;
+  };
+  return ExpectSameMessages(OfTopic(_recorded), OfTopic(_played));
+}
+
 
 //////////////////////////////////////////////////
 /// \brief Record a log and then play it back. Verify that the playback matches
@@ -148,6 +178,9 @@ TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayLog))
   }
 
   const auto handle = playback.Start();
+  EXPECT_EQ(std::chrono::nanoseconds::zero(), handle->SpinThreshold());
+  handle->SetSpinThreshold(std::chrono::microseconds(200));
+  EXPECT_EQ(std::chrono::microseconds(200), handle->SpinThreshold());
   std::cout << "Waiting to for playback to finish..." << std::endl;
   handle->WaitUntilFinished();
   std::cout << " Done waiting..." << std::endl;
@@ -167,6 +200,12 @@ TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayLog))
 #endif
   EXPECT_EQ(handle->EndTime(), handle->CurrentTime());
 
+  // Every message but the ones published before the threshold was set
+  const ignition::transport::log::PlaybackJitterStats jitter =
+    handle->JitterStats();
+  EXPECT_GT(jitter.samples, 0u);
+  EXPECT_LE(jitter.mean, jitter.max);
+
   // Wait to make sure our callbacks are done processing the incoming messages
   // (Strangely, Windows throws an exception when this is ~1s or more)
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -174,6 +213,331 @@ TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayLog))
   EXPECT_TRUE(ExpectSameMessages(originalData, incomingData));
 }
 
+//////////////////////////////////////////////////
+/// \brief Record a log and then play it back faster than real time, then
+/// as fast as possible.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayLogRate))
+{
+  std::vector<std::string> topics = {"/foo", "/bar", "/baz"};
+
+  std::vector<MessageInformation> incomingData;
+
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  ignition::transport::log::Recorder recorder;
+
+  for (const std::string &topic : topics)
+  {
+    node.SubscribeRaw(topic, callback);
+    recorder.AddTopic(topic);
+  }
+
+  const std::string logName =
+    "file:playbackReplayLogRate?mode=memory&cache=shared";
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+    recorder.Start(logName));
+
+  const int numChirps = 100;
+  testing::forkHandlerType chirper =
+    ignition::transport::log::test::BeginChirps(topics, numChirps, partition);
+
+  // Wait for the chirping to finish
+  testing::waitAndCleanupFork(chirper);
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  // Create playback before stopping so sqlite memory database is shared
+  ignition::transport::log::Playback playback(logName);
+  recorder.Stop();
+
+  std::vector<MessageInformation> originalData = incomingData;
+  const std::chrono::milliseconds expectedDuration{
+    numChirps * ignition::transport::log::test::DelayBetweenChirps_ms};
+
+  for (const double rate : {4.0, std::numeric_limits<double>::infinity()})
+  {
+    incomingData.clear();
+
+    const auto handle = playback.Start(std::chrono::milliseconds(100));
+    ASSERT_NE(nullptr, handle);
+    EXPECT_DOUBLE_EQ(1.0, handle->Rate());
+    EXPECT_FALSE(handle->SetRate(0));
+    EXPECT_FALSE(handle->SetRate(-1));
+    EXPECT_TRUE(handle->SetRate(rate));
+    EXPECT_DOUBLE_EQ(rate, handle->Rate());
+
+    const auto start = std::chrono::steady_clock::now();
+    handle->WaitUntilFinished();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    handle->Stop();
+
+    EXPECT_LT(elapsed, expectedDuration / 2);
+    EXPECT_EQ(handle->EndTime(), handle->CurrentTime());
+
+    // Wait to make sure our callbacks are done processing the incoming
+    // messages
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EXPECT_TRUE(ExpectSameMessages(originalData, incomingData));
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Clock whose time is set by the test.
+class ManualClock : public ignition::transport::Clock
+{
+  // Documentation inherited
+  public: std::chrono::nanoseconds Time() const override
+  {
+    return std::chrono::nanoseconds(this->time.load());
+  }
+
+  // Documentation inherited
+  public: bool IsReady() const override
+  {
+    return this->ready;
+  }
+
+  /// \brief Current time (ns).
+  public: std::atomic<int64_t> time{0};
+
+  /// \brief Whether the clock is ready.
+  public: std::atomic<bool> ready{false};
+};
+
+//////////////////////////////////////////////////
+/// \brief Record a log and then play it back paced by an external clock.
+/// Verify that nothing is published until the clock is ready and that the
+/// playback follows the clock.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayLogExternalClock))
+{
+  std::vector<std::string> topics = {"/foo", "/bar", "/baz"};
+
+  std::vector<MessageInformation> incomingData;
+
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  ignition::transport::log::Recorder recorder;
+
+  for (const std::string &topic : topics)
+  {
+    node.SubscribeRaw(topic, callback);
+    recorder.AddTopic(topic);
+  }
+
+  const std::string logName =
+    "file:playbackReplayLogExternalClock?mode=memory&cache=shared";
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+    recorder.Start(logName));
+
+  const int numChirps = 100;
+  testing::forkHandlerType chirper =
+    ignition::transport::log::test::BeginChirps(topics, numChirps, partition);
+
+  // Wait for the chirping to finish
+  testing::waitAndCleanupFork(chirper);
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  // Create playback before stopping so sqlite memory database is shared
+  ignition::transport::log::Playback playback(logName);
+  recorder.Stop();
+
+  std::vector<MessageInformation> originalData = incomingData;
+  incomingData.clear();
+
+  ManualClock clock;
+  clock.time = std::chrono::nanoseconds(std::chrono::seconds(10)).count();
+  const auto handle = playback.Start(&clock, std::chrono::milliseconds(100));
+  ASSERT_NE(nullptr, handle);
+
+  // Nothing is published while the clock isn't ready
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  {
+    std::unique_lock<std::mutex> lock(dataMutex);
+    EXPECT_TRUE(incomingData.empty());
+  }
+
+  // Only the first message is due when the clock starts
+  clock.ready = true;
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  {
+    std::unique_lock<std::mutex> lock(dataMutex);
+    EXPECT_EQ(1u, incomingData.size());
+  }
+
+  // Jump the clock past the end of the log
+  clock.time = std::chrono::nanoseconds(std::chrono::seconds(20)).count();
+  handle->WaitUntilFinished();
+  handle->Stop();
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_TRUE(ExpectSameMessages(originalData, incomingData));
+}
+
+//////////////////////////////////////////////////
+/// \brief Record a log and then play it back from several publisher
+/// threads. Verify that the playback matches the original.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayLogPublisherThreads))
+{
+  std::vector<std::string> topics = {"/foo", "/bar", "/baz"};
+
+  std::vector<MessageInformation> incomingData;
+
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  ignition::transport::log::Recorder recorder;
+
+  for (const std::string &topic : topics)
+  {
+    node.SubscribeRaw(topic, callback);
+    recorder.AddTopic(topic);
+  }
+
+  const std::string logName =
+    "file:playbackReplayLogPublisherThreads?mode=memory&cache=shared";
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+    recorder.Start(logName));
+
+  const int numChirps = 100;
+  testing::forkHandlerType chirper =
+    ignition::transport::log::test::BeginChirps(topics, numChirps, partition);
+
+  // Wait for the chirping to finish
+  testing::waitAndCleanupFork(chirper);
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  // Create playback before stopping so sqlite memory database is shared
+  ignition::transport::log::Playback playback(logName);
+  recorder.Stop();
+
+  std::vector<MessageInformation> originalData = incomingData;
+  incomingData.clear();
+
+  // /foo has a thread of its own, /bar and /baz share the other one
+  playback.SetPublisherThreads(2);
+  EXPECT_TRUE(playback.SetTopicPublisherThread("/foo", 0));
+
+  const auto handle = playback.Start();
+  ASSERT_NE(nullptr, handle);
+  handle->WaitUntilFinished();
+  handle->Stop();
+  EXPECT_EQ(handle->EndTime(), handle->CurrentTime());
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // The order is kept within each topic, the messages of different topics
+  // recorded at almost the same time may be published in another order
+  EXPECT_EQ(originalData.size(), incomingData.size());
+  for (const std::string &topic : topics)
+    EXPECT_TRUE(ExpectSameTopicMessages(originalData, incomingData, topic));
+}
+
+
+//////////////////////////////////////////////////
+/// \brief Record a chunked log and then play it back. Verify that the
+/// playback matches the original.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayChunkedLog))
+{
+  std::vector<std::string> topics = {"/foo", "/bar", "/baz"};
+
+  std::vector<MessageInformation> incomingData;
+
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  ignition::transport::log::Recorder recorder;
+
+  for (const std::string &topic : topics)
+  {
+    node.SubscribeRaw(topic, callback);
+    recorder.AddTopic(topic);
+  }
+
+  const std::string logName =
+    std::string(IGN_TRANSPORT_LOG_BUILD_PATH) + "/playbackChunkedLog.clog";
+  std::remove(logName.c_str());
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+    recorder.Start(logName));
+
+  const int numChirps = 100;
+  testing::forkHandlerType chirper =
+    ignition::transport::log::test::BeginChirps(topics, numChirps, partition);
+
+  // Wait for the chirping to finish
+  testing::waitAndCleanupFork(chirper);
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  // Stopping the recorder writes the index of the chunks
+  recorder.Stop();
+
+  {
+    ignition::transport::log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName));
+    EXPECT_EQ(ignition::transport::log::LogFormat::CHUNKED,
+      logFile.Format());
+  }
+
+  ignition::transport::log::Playback playback(logName);
+
+  // Make a copy of the data so we can compare it later
+  std::vector<MessageInformation> originalData = incomingData;
+
+  // Clear out the old data so we can recreate it during the playback
+  incomingData.clear();
+
+  for (const std::string &topic : topics)
+  {
+    playback.AddTopic(topic);
+  }
+
+  const auto handle = playback.Start();
+  handle->WaitUntilFinished();
+  handle->Stop();
+  EXPECT_EQ(handle->EndTime(), handle->CurrentTime());
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_TRUE(ExpectSameMessages(originalData, incomingData));
+  std::remove(logName.c_str());
+}
 
 //////////////////////////////////////////////////
 TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayNoSuchTopic))
@@ -779,6 +1143,13 @@ TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplaySeek))
   // be in the exact same position as the previous one
   EXPECT_TRUE(MessagesAreEqual(firstMessageData, thirdMessageData));
 
+  // A step backwards jumps back and stays paused
+  const std::chrono::nanoseconds beforeStepBack = handle->CurrentTime();
+  handle->Step(-std::chrono::milliseconds(
+      ignition::transport::log::test::DelayBetweenChirps_ms * 5));
+  EXPECT_TRUE(handle->IsPaused());
+  EXPECT_LT(handle->CurrentTime(), beforeStepBack);
+
   // Resume Playback
   handle->Resume();
 
@@ -793,6 +1164,320 @@ TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplaySeek))
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
 
+//////////////////////////////////////////////////
+/// \brief Play back a log as soon as the expected subscribers are there,
+/// instead of after the fixed wait.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayExpectedSubscribers))
+{
+  const std::string logName = "playbackExpectedSubscribers.tlog";
+  std::remove(logName.c_str());
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName, std::ios_base::out));
+    for (int i = 0; i < 3; ++i)
+    {
+      ignition::transport::log::test::ChirpMsgType msg;
+      msg.set_data(i);
+      const std::string data = msg.SerializeAsString();
+      EXPECT_TRUE(log.InsertMessage(std::chrono::milliseconds(i + 1),
+        "/expected", msg.GetTypeName(), data.data(), data.size()));
+    }
+  }
+
+  std::vector<MessageInformation> incomingData;
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+  ignition::transport::Node node;
+  EXPECT_TRUE(node.SubscribeRaw("/expected", callback));
+
+  ignition::transport::log::Playback playback(logName);
+  EXPECT_TRUE(playback.ExpectedSubscribers().empty());
+  playback.SetExpectedSubscribers({"/expected", "/not/played"});
+  EXPECT_EQ(2u, playback.ExpectedSubscribers().size());
+
+  // The subscriber is found long before the wait is over
+  const auto start = std::chrono::steady_clock::now();
+  auto handle = playback.Start(std::chrono::seconds(30));
+  ASSERT_NE(nullptr, handle);
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+    std::chrono::seconds(10));
+  handle->WaitUntilFinished();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::unique_lock<std::mutex> lock(dataMutex);
+    EXPECT_EQ(3u, incomingData.size());
+  }
+
+  // Without any of the expected topics, the playback starts right away
+  playback.SetExpectedSubscribers({"/not/played"});
+  const auto restart = std::chrono::steady_clock::now();
+  handle = playback.Start(std::chrono::seconds(30));
+  ASSERT_NE(nullptr, handle);
+  EXPECT_LT(std::chrono::steady_clock::now() - restart,
+    std::chrono::seconds(10));
+  handle->Stop();
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Play back two logs recorded separately as one timeline.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayMultipleLogs))
+{
+  const std::vector<std::string> logNames =
+    {"playbackMultipleLogs0.tlog", "playbackMultipleLogs1.tlog"};
+  for (std::size_t i = 0; i < logNames.size(); ++i)
+  {
+    std::remove(logNames[i].c_str());
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logNames[i], std::ios_base::out));
+
+    // The messages of the logs alternate
+    for (int j = static_cast<int>(i); j < 6; j += 2)
+    {
+      ignition::transport::log::test::ChirpMsgType msg;
+      msg.set_data(j);
+      const std::string data = msg.SerializeAsString();
+      EXPECT_TRUE(log.InsertMessage(std::chrono::milliseconds(10 * j + 10),
+        "/robot" + std::to_string(i), msg.GetTypeName(), data.data(),
+        data.size()));
+    }
+  }
+
+  std::vector<MessageInformation> incomingData;
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+  ignition::transport::Node node;
+  EXPECT_TRUE(node.SubscribeRaw("/robot0", callback));
+  EXPECT_TRUE(node.SubscribeRaw("/robot1", callback));
+
+  ignition::transport::log::Playback playback(logNames);
+  EXPECT_TRUE(playback.Valid());
+  EXPECT_EQ(2, playback.AddTopic(std::regex("/robot.*")));
+  playback.SetExpectedSubscribers({"/robot0", "/robot1"});
+
+  auto handle = playback.Start(std::chrono::seconds(10));
+  ASSERT_NE(nullptr, handle);
+  EXPECT_EQ(std::chrono::milliseconds(10), handle->StartTime());
+  EXPECT_EQ(std::chrono::milliseconds(60), handle->EndTime());
+  handle->WaitUntilFinished();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  {
+    std::unique_lock<std::mutex> lock(dataMutex);
+    ASSERT_EQ(6u, incomingData.size());
+    for (int j = 0; j < 6; ++j)
+    {
+      ignition::transport::log::test::ChirpMsgType msg;
+      ASSERT_TRUE(msg.ParseFromString(incomingData[j].data));
+      EXPECT_EQ(j, msg.data());
+      EXPECT_EQ("/robot" + std::to_string(j % 2), incomingData[j].topic);
+    }
+    incomingData.clear();
+  }
+
+  // Seeking applies to both logs
+  handle = playback.Start(std::chrono::seconds(10));
+  ASSERT_NE(nullptr, handle);
+  handle->Pause();
+  handle->Seek(std::chrono::milliseconds(30));
+  handle->Resume();
+  handle->WaitUntilFinished();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  {
+    std::unique_lock<std::mutex> lock(dataMutex);
+    ASSERT_LE(3u, incomingData.size());
+    for (std::size_t j = 0; j < 3; ++j)
+    {
+      ignition::transport::log::test::ChirpMsgType msg;
+      ASSERT_TRUE(msg.ParseFromString(
+        incomingData[incomingData.size() - 3 + j].data));
+      EXPECT_EQ(static_cast<int>(j) + 3, msg.data());
+    }
+  }
+
+  for (const std::string &logName : logNames)
+    std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Play back a log into several partitions at once.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayFanOut))
+{
+  const std::string logName = "playbackFanOut.tlog";
+  std::remove(logName.c_str());
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName, std::ios_base::out));
+    for (int i = 0; i < 3; ++i)
+    {
+      ignition::transport::log::test::ChirpMsgType msg;
+      msg.set_data(i);
+      const std::string data = msg.SerializeAsString();
+      EXPECT_TRUE(log.InsertMessage(std::chrono::milliseconds(i + 1),
+        "/fanout", msg.GetTypeName(), data.data(), data.size()));
+    }
+  }
+
+  // Two partitions, and a namespace in a third one
+  std::vector<ignition::transport::NodeOptions> fanOut(3);
+  std::vector<std::unique_ptr<ignition::transport::Node>> nodes;
+  std::vector<std::vector<MessageInformation>> incomingData(3);
+  for (std::size_t i = 0; i < fanOut.size(); ++i)
+  {
+    fanOut[i].SetPartition(partition + "_fanout" + std::to_string(i));
+    nodes.push_back(
+      std::make_unique<ignition::transport::Node>(fanOut[i]));
+
+    auto &archive = incomingData[i];
+    auto callback = [&archive](
+        const char *_data,
+        std::size_t _len,
+        const ignition::transport::MessageInfo &_msgInfo)
+    {
+      TrackMessages(archive, _data, _len, _msgInfo);
+    };
+    EXPECT_TRUE(nodes.back()->SubscribeRaw(
+      i < 2 ? "/fanout" : "/env/fanout", callback));
+  }
+  EXPECT_TRUE(fanOut[2].SetNameSpace("/env"));
+
+  ignition::transport::log::Playback playback(logName);
+  EXPECT_TRUE(playback.FanOut().empty());
+  playback.SetFanOut(fanOut);
+  EXPECT_EQ(3u, playback.FanOut().size());
+  playback.SetExpectedSubscribers({"/fanout"});
+
+  auto handle = playback.Start(std::chrono::seconds(10));
+  ASSERT_NE(nullptr, handle);
+  handle->WaitUntilFinished();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  {
+    std::unique_lock<std::mutex> lock(dataMutex);
+    for (std::size_t i = 0; i < incomingData.size(); ++i)
+    {
+      ASSERT_EQ(3u, incomingData[i].size()) << i;
+      for (int j = 0; j < 3; ++j)
+      {
+        ignition::transport::log::test::ChirpMsgType msg;
+        ASSERT_TRUE(msg.ParseFromString(incomingData[i][j].data));
+        EXPECT_EQ(j, msg.data());
+        EXPECT_EQ(i < 2 ? "/fanout" : "/env/fanout",
+          incomingData[i][j].topic);
+      }
+    }
+  }
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Play back a log to direct subscribers of this process, from the
+/// thread calling Start() and then from the thread of the playback.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayDirectSubscribers))
+{
+  const std::string logName = "playbackDirect.tlog";
+  std::remove(logName.c_str());
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName, std::ios_base::out));
+    for (int i = 0; i < 10; ++i)
+    {
+      ignition::transport::log::test::ChirpMsgType msg;
+      msg.set_data(i);
+      const std::string data = msg.SerializeAsString();
+      EXPECT_TRUE(log.InsertMessage(std::chrono::milliseconds(i + 1),
+        i % 2 ? "/direct/odd" : "/direct/even", msg.GetTypeName(),
+        data.data(), data.size()));
+    }
+  }
+
+  // A subscriber of the network must not receive anything
+  ignition::transport::Node node;
+  std::atomic<int> published{0};
+  EXPECT_TRUE(node.SubscribeRaw("/direct/even",
+    [&published](const char *, const size_t,
+        const ignition::transport::MessageInfo &)
+    {
+      ++published;
+    }));
+
+  ignition::transport::log::Playback playback(logName);
+  EXPECT_FALSE(playback.AddDirectSubscriber("/no/such/topic",
+    [](const char *, const size_t, const ignition::transport::MessageInfo &)
+    {
+    }));
+
+  std::vector<MessageInformation> delivered;
+  EXPECT_TRUE(playback.AddDirectSubscriber("/direct/even",
+    [&delivered](const char *_data, const size_t _len,
+        const ignition::transport::MessageInfo &_info)
+    {
+      EXPECT_TRUE(_info.IntraProcess());
+      TrackMessages(delivered, _data, _len, _info);
+    }));
+
+  std::vector<int> typed;
+  EXPECT_TRUE(playback.AddDirectSubscriber<
+      ignition::transport::log::test::ChirpMsgType>("/direct/odd",
+    [&typed](const ignition::transport::log::test::ChirpMsgType &_msg,
+        const ignition::transport::MessageInfo &_info)
+    {
+      EXPECT_EQ("/direct/odd", _info.Topic());
+      typed.push_back(_msg.data());
+    }));
+
+  // Synchronous, every message is delivered once Start() returns, in order
+  playback.SetSynchronous(true);
+  {
+    auto handle = playback.Start(std::chrono::seconds(10));
+    ASSERT_NE(nullptr, handle);
+    EXPECT_TRUE(handle->Finished());
+  }
+
+  ASSERT_EQ(5u, delivered.size());
+  for (int i = 0; i < 5; ++i)
+  {
+    ignition::transport::log::test::ChirpMsgType msg;
+    ASSERT_TRUE(msg.ParseFromString(delivered[i].data));
+    EXPECT_EQ(2 * i, msg.data());
+    EXPECT_EQ("/direct/even", delivered[i].topic);
+    EXPECT_EQ(msg.GetTypeName(), delivered[i].type);
+  }
+  EXPECT_EQ((std::vector<int>{1, 3, 5, 7, 9}), typed);
+
+  // The same messages, from the thread of the playback. Only the topics
+  // added are played back.
+  delivered.clear();
+  typed.clear();
+  playback.SetSynchronous(false);
+  EXPECT_TRUE(playback.AddTopic("/direct/even"));
+  {
+    auto handle = playback.Start(std::chrono::seconds(10), false);
+    ASSERT_NE(nullptr, handle);
+    handle->WaitUntilFinished();
+  }
+  EXPECT_EQ(5u, delivered.size());
+  EXPECT_TRUE(typed.empty());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(0, published);
+
+  std::remove(logName.c_str());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -17,6 +17,7 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <optional>
 #include <numeric>
 
@@ -342,6 +343,15 @@ TEST(recorder, DataWriterQueue)
     EXPECT_EQ(numChirps, count);
   }
 
+  // The counters are kept after stopping
+  const ignition::transport::log::RecorderPipelineStats stats =
+    recorder.PipelineStats();
+  EXPECT_EQ(static_cast<uint64_t>(numChirps), stats.writtenMessages);
+  EXPECT_GT(stats.writtenBytes, 0u);
+  EXPECT_EQ(0u, stats.droppedMessages);
+  EXPECT_TRUE(stats.droppedMessagesPerTopic.empty());
+  EXPECT_EQ(0u, stats.queuedBytes);
+
   // Publish again and ensure that the recorder doesn't write to the file
   for (int i = 0; i < numChirps; ++i)
   {
@@ -530,6 +540,142 @@ TEST(recorder, DataWriterQueueLargeMessages)
   TestBufferSizeSettings(1, 1);
 }
 
+//////////////////////////////////////////////////
+/// Test that a recording rotated into segments is read as one log
+TEST(recorder, RotateSegments)
+{
+  std::string topic{"/foo"};
+
+  ignition::transport::log::Recorder recorder;
+  recorder.SetMaxSegmentDuration(std::chrono::milliseconds(50));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(topic));
+
+  std::vector<std::string> segments;
+  recorder.SetSegmentCallback([&](const std::string &_segment)
+  {
+    segments.push_back(_segment);
+  });
+
+  const std::string logName = "recorderRotateSegments.tlog";
+  std::remove(logName.c_str());
+  EXPECT_EQ(recorder.Start(logName),
+            ignition::transport::log::RecorderError::SUCCESS);
+  EXPECT_EQ(logName, recorder.Filename());
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto pub = node.Advertise<MsgType>(topic);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  const int numChirps = 50;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    MsgType msg;
+    msg.set_data(i+1);
+    pub.Publish(msg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  // Sleep so data writer can get the message
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+
+  // Every segment was reported as complete
+  EXPECT_GT(segments.size(), 1u);
+
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName));
+    EXPECT_EQ(ignition::transport::log::LogFormat::SEGMENTED, log.Format());
+
+    int count = 0;
+    for (const auto &msg : log.QueryMessages())
+    {
+      VerifyMessage(msg, count, 1,
+          [&](const std::string &_topic)
+          {
+          return topic == _topic;
+          });
+      ++count;
+    }
+    EXPECT_EQ(numChirps, count);
+  }
+
+  std::remove(logName.c_str());
+  for (const std::string &segment : segments)
+    std::remove(segment.c_str());
+}
+
+#ifdef HAVE_ZLIB
+//////////////////////////////////////////////////
+/// \brief Record a compressed topic through the encode workers
+TEST(recorder, EncodeWorkers)
+{
+  std::string topic{"/foo"};
+
+  ignition::transport::log::Recorder recorder;
+  recorder.SetEncodeWorkers(3);
+  EXPECT_EQ(3u, recorder.EncodeWorkers());
+  ignition::transport::log::LogOpenOptions options;
+  options.compressedTopics[topic] = "";
+  recorder.SetOpenOptions(options);
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(topic));
+
+  const std::string logName = "recorderEncodeWorkers.tlog";
+  std::remove(logName.c_str());
+  EXPECT_EQ(recorder.Start(logName),
+            ignition::transport::log::RecorderError::SUCCESS);
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto pub = node.Advertise<MsgType>(topic);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  const int numChirps = 200;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    MsgType msg;
+    msg.set_data(i+1);
+    pub.Publish(msg);
+  }
+
+  // Sleep so data writer can get the message
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+
+  const ignition::transport::log::RecorderPipelineStats stats =
+    recorder.PipelineStats();
+  EXPECT_GT(stats.batchesWritten, 0u);
+  EXPECT_EQ(0u, stats.batchesInFlight);
+  EXPECT_EQ(0u, stats.queuedMessages);
+
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName));
+
+    int count = 0;
+    for (const auto &msg : log.QueryMessages())
+    {
+      VerifyMessage(msg, count, 1,
+          [&](const std::string &_topic)
+          {
+          return topic == _topic;
+          });
+      ++count;
+    }
+    EXPECT_EQ(numChirps, count);
+  }
+
+  std::remove(logName.c_str());
+}
+#endif
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
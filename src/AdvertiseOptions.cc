@@ -15,9 +15,11 @@
  *
 */
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 #include "ignition/transport/AdvertiseOptions.hh"
 #include "ignition/transport/Helpers.hh"
@@ -57,6 +59,49 @@ namespace ignition
 
       /// \brief Default message publication rate.
       public: uint64_t msgsPerSec = kUnthrottled;
+
+      /// \brief Number of messages published back to back.
+      public: uint64_t burst = 1;
+
+      /// \brief Read the coarse clock for the throttling.
+      public: bool coarseClock = false;
+
+      /// \brief Compression of the messages sent to remote subscribers.
+      public: Compression_t compression = Compression_t::NONE;
+
+      /// \brief Minimum size of a message to be compressed.
+      public: std::size_t compressionThreshold = kDefaultCompressionThreshold;
+
+      /// \brief How the messages are sent to remote subscribers.
+      public: PublishMode_t publishMode = PublishMode_t::SYNC;
+
+      /// \brief Capacity of the send queue in asynchronous mode.
+      public: std::size_t asyncQueueSize = kDefaultAsyncQueueSize;
+
+      /// \brief Maximum bytes of the send queue, zero for no limit.
+      public: uint64_t asyncQueueBytes = 0;
+
+      /// \brief What to do when the send queue is full.
+      public: QueuePolicy_t asyncQueuePolicy = QueuePolicy_t::DROP_OLDEST;
+
+      /// \brief Only send the latest message to remote subscribers.
+      public: bool conflated = false;
+
+      /// \brief Multicast group the messages are sent to.
+      public: std::string multicastGroup;
+
+      /// \brief Priority class of the topic.
+      public: Priority_t priority = Priority_t::NORMAL;
+
+      /// \brief Durability of the topic.
+      public: Durability_t durability = Durability_t::VOLATILE;
+
+      /// \brief Messages retained for retransmission, 0 if the topic isn't
+      /// reliable.
+      public: uint64_t retransmitBufferSize = 0;
+
+      /// \brief Whether the remote subscribers acknowledge the messages.
+      public: bool acknowledged = false;
     };
 
     /// \internal
@@ -68,6 +113,18 @@ namespace ignition
 
       /// \brief Destructor.
       public: virtual ~AdvertiseServiceOptionsPrivate() = default;
+
+      /// \brief Maximum number of requests executed at the same time, zero
+      /// to run them on the reception thread.
+      public: unsigned int maxConcurrency = 0;
+
+      /// \brief Maximum number of requests waiting for a thread, zero for no
+      /// limit.
+      public: unsigned int maxQueue = 0;
+
+      /// \brief Time to live of the responses in milliseconds, zero to run
+      /// the callback for every request.
+      public: unsigned int responseCacheTtl = 0;
     };
     }
   }
@@ -148,6 +205,20 @@ AdvertiseMessageOptions &AdvertiseMessageOptions::operator=(
 {
   AdvertiseOptions::operator=(_other);
   this->SetMsgsPerSec(_other.MsgsPerSec());
+  this->SetBurst(_other.Burst());
+  this->SetCoarseClock(_other.CoarseClock());
+  this->SetCompression(_other.Compression());
+  this->SetCompressionThreshold(_other.CompressionThreshold());
+  this->SetPublishMode(_other.PublishMode());
+  this->SetAsyncQueueSize(_other.AsyncQueueSize());
+  this->SetAsyncQueueBytes(_other.AsyncQueueBytes());
+  this->SetAsyncQueuePolicy(_other.AsyncQueuePolicy());
+  this->SetConflated(_other.Conflated());
+  this->SetMulticastGroup(_other.MulticastGroup());
+  this->SetPriority(_other.Priority());
+  this->SetDurability(_other.Durability());
+  this->SetRetransmitBufferSize(_other.RetransmitBufferSize());
+  this->SetAcknowledged(_other.Acknowledged());
   return *this;
 }
 
@@ -156,7 +227,21 @@ bool AdvertiseMessageOptions::operator==(
   const AdvertiseMessageOptions &_other) const
 {
   return AdvertiseOptions::operator==(_other) &&
-         this->MsgsPerSec() == _other.MsgsPerSec();
+         this->MsgsPerSec() == _other.MsgsPerSec() &&
+         this->Burst() == _other.Burst() &&
+         this->CoarseClock() == _other.CoarseClock() &&
+         this->Compression() == _other.Compression() &&
+         this->CompressionThreshold() == _other.CompressionThreshold() &&
+         this->PublishMode() == _other.PublishMode() &&
+         this->AsyncQueueSize() == _other.AsyncQueueSize() &&
+         this->AsyncQueueBytes() == _other.AsyncQueueBytes() &&
+         this->AsyncQueuePolicy() == _other.AsyncQueuePolicy() &&
+         this->Conflated() == _other.Conflated() &&
+         this->MulticastGroup() == _other.MulticastGroup() &&
+         this->Priority() == _other.Priority() &&
+         this->Durability() == _other.Durability() &&
+         this->RetransmitBufferSize() == _other.RetransmitBufferSize() &&
+         this->Acknowledged() == _other.Acknowledged();
 }
 
 //////////////////////////////////////////////////
@@ -184,6 +269,181 @@ void AdvertiseMessageOptions::SetMsgsPerSec(const uint64_t _newMsgsPerSec)
   this->dataPtr->msgsPerSec = _newMsgsPerSec;
 }
 
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::Burst() const
+{
+  return this->dataPtr->burst;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetBurst(const uint64_t _burst)
+{
+  this->dataPtr->burst = std::max<uint64_t>(_burst, 1u);
+}
+
+//////////////////////////////////////////////////
+bool AdvertiseMessageOptions::CoarseClock() const
+{
+  return this->dataPtr->coarseClock;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetCoarseClock(const bool _coarse)
+{
+  this->dataPtr->coarseClock = _coarse;
+}
+
+//////////////////////////////////////////////////
+Compression_t AdvertiseMessageOptions::Compression() const
+{
+  return this->dataPtr->compression;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetCompression(const Compression_t _compression)
+{
+  this->dataPtr->compression = _compression;
+}
+
+//////////////////////////////////////////////////
+std::size_t AdvertiseMessageOptions::CompressionThreshold() const
+{
+  return this->dataPtr->compressionThreshold;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetCompressionThreshold(
+  const std::size_t _threshold)
+{
+  this->dataPtr->compressionThreshold = _threshold;
+}
+
+//////////////////////////////////////////////////
+PublishMode_t AdvertiseMessageOptions::PublishMode() const
+{
+  return this->dataPtr->publishMode;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetPublishMode(const PublishMode_t _mode)
+{
+  this->dataPtr->publishMode = _mode;
+}
+
+//////////////////////////////////////////////////
+std::size_t AdvertiseMessageOptions::AsyncQueueSize() const
+{
+  return this->dataPtr->asyncQueueSize;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetAsyncQueueSize(const std::size_t _size)
+{
+  this->dataPtr->asyncQueueSize = _size;
+}
+
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::AsyncQueueBytes() const
+{
+  return this->dataPtr->asyncQueueBytes;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetAsyncQueueBytes(const uint64_t _bytes)
+{
+  this->dataPtr->asyncQueueBytes = _bytes;
+}
+
+//////////////////////////////////////////////////
+QueuePolicy_t AdvertiseMessageOptions::AsyncQueuePolicy() const
+{
+  return this->dataPtr->asyncQueuePolicy;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetAsyncQueuePolicy(const QueuePolicy_t _policy)
+{
+  this->dataPtr->asyncQueuePolicy = _policy;
+}
+
+//////////////////////////////////////////////////
+bool AdvertiseMessageOptions::Conflated() const
+{
+  return this->dataPtr->conflated;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetConflated(const bool _conflated)
+{
+  this->dataPtr->conflated = _conflated;
+}
+
+//////////////////////////////////////////////////
+const std::string &AdvertiseMessageOptions::MulticastGroup() const
+{
+  return this->dataPtr->multicastGroup;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetMulticastGroup(const std::string &_group)
+{
+  this->dataPtr->multicastGroup = _group;
+}
+
+//////////////////////////////////////////////////
+Priority_t AdvertiseMessageOptions::Priority() const
+{
+  return this->dataPtr->priority;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetPriority(const Priority_t _priority)
+{
+  this->dataPtr->priority = _priority;
+}
+
+//////////////////////////////////////////////////
+Durability_t AdvertiseMessageOptions::Durability() const
+{
+  return this->dataPtr->durability;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetDurability(const Durability_t _durability)
+{
+  this->dataPtr->durability = _durability;
+}
+
+//////////////////////////////////////////////////
+bool AdvertiseMessageOptions::Reliable() const
+{
+  return this->dataPtr->retransmitBufferSize > 0;
+}
+
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::RetransmitBufferSize() const
+{
+  return this->dataPtr->retransmitBufferSize;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetRetransmitBufferSize(const uint64_t _size)
+{
+  this->dataPtr->retransmitBufferSize = _size;
+}
+
+//////////////////////////////////////////////////
+bool AdvertiseMessageOptions::Acknowledged() const
+{
+  return this->dataPtr->acknowledged;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetAcknowledged(const bool _acknowledged)
+{
+  this->dataPtr->acknowledged = _acknowledged;
+}
+
 //////////////////////////////////////////////////
 AdvertiseServiceOptions::AdvertiseServiceOptions()
   : AdvertiseOptions(),
@@ -209,6 +469,9 @@ AdvertiseServiceOptions &AdvertiseServiceOptions::operator=(
   const AdvertiseServiceOptions &_other)
 {
   AdvertiseOptions::operator=(_other);
+  this->SetMaxConcurrency(_other.MaxConcurrency());
+  this->SetMaxQueue(_other.MaxQueue());
+  this->SetResponseCacheTtl(_other.ResponseCacheTtl());
   return *this;
 }
 
@@ -216,7 +479,10 @@ AdvertiseServiceOptions &AdvertiseServiceOptions::operator=(
 bool AdvertiseServiceOptions::operator==(
   const AdvertiseServiceOptions &_other) const
 {
-  return AdvertiseOptions::operator==(_other);
+  return AdvertiseOptions::operator==(_other) &&
+         this->MaxConcurrency() == _other.MaxConcurrency() &&
+         this->MaxQueue() == _other.MaxQueue() &&
+         this->ResponseCacheTtl() == _other.ResponseCacheTtl();
 }
 
 //////////////////////////////////////////////////
@@ -225,3 +491,40 @@ bool AdvertiseServiceOptions::operator!=(
 {
   return !(*this == _other);
 }
+
+//////////////////////////////////////////////////
+unsigned int AdvertiseServiceOptions::MaxConcurrency() const
+{
+  return this->dataPtr->maxConcurrency;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseServiceOptions::SetMaxConcurrency(
+  const unsigned int _maxConcurrency)
+{
+  this->dataPtr->maxConcurrency = _maxConcurrency;
+}
+
+//////////////////////////////////////////////////
+unsigned int AdvertiseServiceOptions::MaxQueue() const
+{
+  return this->dataPtr->maxQueue;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseServiceOptions::SetMaxQueue(const unsigned int _maxQueue)
+{
+  this->dataPtr->maxQueue = _maxQueue;
+}
+
+//////////////////////////////////////////////////
+unsigned int AdvertiseServiceOptions::ResponseCacheTtl() const
+{
+  return this->dataPtr->responseCacheTtl;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseServiceOptions::SetResponseCacheTtl(const unsigned int _ttl)
+{
+  this->dataPtr->responseCacheTtl = _ttl;
+}
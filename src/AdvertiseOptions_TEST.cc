@@ -186,6 +186,261 @@ TEST(AdvertiseOptionsTest, msgAccessors)
   EXPECT_TRUE(opts.Throttled());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the compression options.
+TEST(AdvertiseOptionsTest, msgCompression)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_EQ(opts1.Compression(), Compression_t::NONE);
+  EXPECT_EQ(opts1.CompressionThreshold(), kDefaultCompressionThreshold);
+
+  opts1.SetCompression(Compression_t::ZLIB);
+  opts1.SetCompressionThreshold(100u);
+  EXPECT_EQ(opts1.Compression(), Compression_t::ZLIB);
+  EXPECT_EQ(opts1.CompressionThreshold(), 100u);
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tCompression: zlib (messages of at least 100 bytes)\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the asynchronous publish mode.
+TEST(AdvertiseOptionsTest, msgPublishMode)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_EQ(opts1.PublishMode(), PublishMode_t::SYNC);
+  EXPECT_EQ(opts1.AsyncQueueSize(), kDefaultAsyncQueueSize);
+  EXPECT_EQ(opts1.AsyncQueuePolicy(), QueuePolicy_t::DROP_OLDEST);
+
+  opts1.SetPublishMode(PublishMode_t::ASYNC);
+  opts1.SetAsyncQueueSize(10u);
+  opts1.SetAsyncQueuePolicy(QueuePolicy_t::BLOCK);
+  EXPECT_EQ(opts1.PublishMode(), PublishMode_t::ASYNC);
+  EXPECT_EQ(opts1.AsyncQueueSize(), 10u);
+  EXPECT_EQ(opts1.AsyncQueuePolicy(), QueuePolicy_t::BLOCK);
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tPublish mode: async (queue of 10 msgs, block)\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+
+  EXPECT_EQ(opts1.AsyncQueueBytes(), 0u);
+  opts1.SetAsyncQueueBytes(4096u);
+  EXPECT_EQ(opts1.AsyncQueueBytes(), 4096u);
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  output.str("");
+  output << opts1;
+  expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tPublish mode: async (queue of 10 msgs, 4096 bytes, block)\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the conflation option.
+TEST(AdvertiseOptionsTest, msgConflated)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_FALSE(opts1.Conflated());
+  opts1.SetConflated(true);
+  EXPECT_TRUE(opts1.Conflated());
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tConflated? Yes\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the multicast group option.
+TEST(AdvertiseOptionsTest, msgMulticastGroup)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_TRUE(opts1.MulticastGroup().empty());
+  opts1.SetMulticastGroup("239.255.0.7:11320");
+  EXPECT_EQ("239.255.0.7:11320", opts1.MulticastGroup());
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tMulticast group: 239.255.0.7:11320\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the priority option.
+TEST(AdvertiseOptionsTest, msgPriority)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_EQ(Priority_t::NORMAL, opts1.Priority());
+  opts1.SetPriority(Priority_t::HIGH);
+  EXPECT_EQ(Priority_t::HIGH, opts1.Priority());
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tPriority: high\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the durability.
+TEST(AdvertiseOptionsTest, msgDurability)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_EQ(Durability_t::VOLATILE, opts1.Durability());
+  opts1.SetDurability(Durability_t::TRANSIENT_LOCAL);
+  EXPECT_EQ(Durability_t::TRANSIENT_LOCAL, opts1.Durability());
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tDurability: transient local\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the reliability.
+TEST(AdvertiseOptionsTest, msgReliable)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_FALSE(opts1.Reliable());
+  EXPECT_EQ(0u, opts1.RetransmitBufferSize());
+  opts1.SetRetransmitBufferSize(50u);
+  EXPECT_TRUE(opts1.Reliable());
+  EXPECT_EQ(50u, opts1.RetransmitBufferSize());
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tReliable? Yes (retransmit buffer of 50 msgs)\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the acknowledgements.
+TEST(AdvertiseOptionsTest, msgAcknowledged)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_FALSE(opts1.Acknowledged());
+  opts1.SetAcknowledged(true);
+  EXPECT_TRUE(opts1.Acknowledged());
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? No\n"
+    "\tAcknowledged? Yes\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the burst and the coarse clock of the throttling.
+TEST(AdvertiseOptionsTest, msgBurst)
+{
+  AdvertiseMessageOptions opts1;
+  EXPECT_EQ(1u, opts1.Burst());
+  EXPECT_FALSE(opts1.CoarseClock());
+  opts1.SetMsgsPerSec(10u);
+  opts1.SetBurst(5u);
+  opts1.SetCoarseClock(true);
+  EXPECT_EQ(5u, opts1.Burst());
+  EXPECT_TRUE(opts1.CoarseClock());
+
+  AdvertiseMessageOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tThrottled? Yes\n"
+    "\tRate: 10 msgs/sec\n"
+    "\tBurst: 5 msgs\n"
+    "\tCoarse clock? Yes\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+
+  // Zero is treated as one.
+  opts1.SetBurst(0u);
+  EXPECT_EQ(1u, opts1.Burst());
+}
+
 //////////////////////////////////////////////////
 /// \brief Check the default constructor.
 TEST(AdvertiseOptionsTest, srvDefConstructor)
@@ -253,6 +508,81 @@ TEST(AdvertiseOptionsTest, srvAccessors)
   EXPECT_EQ(opts.Scope(), Scope_t::HOST);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the maximum concurrency of a service.
+TEST(AdvertiseOptionsTest, srvMaxConcurrency)
+{
+  AdvertiseServiceOptions opts1;
+  EXPECT_EQ(0u, opts1.MaxConcurrency());
+  opts1.SetMaxConcurrency(4);
+  EXPECT_EQ(4u, opts1.MaxConcurrency());
+
+  AdvertiseServiceOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+  AdvertiseServiceOptions opts3(opts1);
+  EXPECT_EQ(4u, opts3.MaxConcurrency());
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tMax concurrency: 4\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the maximum number of waiting requests of a service.
+TEST(AdvertiseOptionsTest, srvMaxQueue)
+{
+  AdvertiseServiceOptions opts1;
+  EXPECT_EQ(0u, opts1.MaxQueue());
+  opts1.SetMaxQueue(8);
+  EXPECT_EQ(8u, opts1.MaxQueue());
+
+  AdvertiseServiceOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+  AdvertiseServiceOptions opts3(opts1);
+  EXPECT_EQ(8u, opts3.MaxQueue());
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tMax queue: 8\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the time to live of the responses of a service.
+TEST(AdvertiseOptionsTest, srvResponseCacheTtl)
+{
+  AdvertiseServiceOptions opts1;
+  EXPECT_EQ(0u, opts1.ResponseCacheTtl());
+  opts1.SetResponseCacheTtl(250);
+  EXPECT_EQ(250u, opts1.ResponseCacheTtl());
+
+  AdvertiseServiceOptions opts2;
+  EXPECT_TRUE(opts1 != opts2);
+  opts2 = opts1;
+  EXPECT_TRUE(opts1 == opts2);
+  AdvertiseServiceOptions opts3(opts1);
+  EXPECT_EQ(250u, opts3.ResponseCacheTtl());
+
+  std::ostringstream output;
+  output << opts1;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: All\n"
+    "\tResponse cache TTL: 250 ms\n";
+  EXPECT_EQ(output.str(), expectedOutput);
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "ignition/transport/AllocationCounter.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace
+{
+  /// \brief Number of paths.
+  constexpr int kPaths = static_cast<int>(AllocationPath::COUNT);
+
+  /// \brief Calls of each path.
+  std::atomic<uint64_t> calls[kPaths];
+
+  /// \brief Allocations of each path.
+  std::atomic<uint64_t> allocations[kPaths];
+
+  /// \brief Paths running on this thread, one bit per path. A trivial
+  /// thread local, so reading it from operator new doesn't allocate.
+  thread_local uint32_t runningPaths = 0;
+}
+
+//////////////////////////////////////////////////
+AllocationCounter::Scope::Scope(const AllocationPath _path)
+  : bit(0)
+{
+  const uint32_t pathBit = 1u << static_cast<int>(_path);
+  if (runningPaths & pathBit)
+    return;
+
+  this->bit = pathBit;
+  runningPaths |= pathBit;
+  calls[static_cast<int>(_path)].fetch_add(1, std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+AllocationCounter::Scope::~Scope()
+{
+  runningPaths &= ~this->bit;
+}
+
+//////////////////////////////////////////////////
+bool AllocationCounter::Enabled()
+{
+#ifdef IGN_TRANSPORT_ALLOCATION_COUNTING
+  return true;
+#else
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+void AllocationCounter::Reset()
+{
+  for (int i = 0; i < kPaths; ++i)
+  {
+    calls[i].store(0, std::memory_order_relaxed);
+    allocations[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+//////////////////////////////////////////////////
+uint64_t AllocationCounter::Calls(const AllocationPath _path)
+{
+  return calls[static_cast<int>(_path)].load(std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+uint64_t AllocationCounter::Allocations(const AllocationPath _path)
+{
+  return allocations[static_cast<int>(_path)].load(
+    std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+void AllocationCounter::OnAllocation()
+{
+  uint32_t paths = runningPaths;
+  for (int i = 0; paths; ++i, paths >>= 1)
+  {
+    if (paths & 1u)
+      allocations[i].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+#ifdef IGN_TRANSPORT_ALLOCATION_COUNTING
+//////////////////////////////////////////////////
+/// \brief Allocate memory, counting the allocation.
+/// \param[in] _size Size of the memory.
+/// \return The memory, or nullptr if unable to allocate it.
+static void *countedAlloc(std::size_t _size)
+{
+  AllocationCounter::OnAllocation();
+  return std::malloc(_size ? _size : 1);
+}
+
+//////////////////////////////////////////////////
+void *operator new(std::size_t _size)
+{
+  void *ptr = countedAlloc(_size);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+//////////////////////////////////////////////////
+void *operator new[](std::size_t _size)
+{
+  void *ptr = countedAlloc(_size);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+//////////////////////////////////////////////////
+void *operator new(std::size_t _size, const std::nothrow_t &) noexcept
+{
+  return countedAlloc(_size);
+}
+
+//////////////////////////////////////////////////
+void *operator new[](std::size_t _size, const std::nothrow_t &) noexcept
+{
+  return countedAlloc(_size);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete[](void *_ptr) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr, std::size_t) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete[](void *_ptr, std::size_t) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr, const std::nothrow_t &) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete[](void *_ptr, const std::nothrow_t &) noexcept
+{
+  std::free(_ptr);
+}
+#endif
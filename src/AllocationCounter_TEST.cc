@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <memory>
+
+#include "ignition/transport/AllocationCounter.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Memory allocated by the tests, global so that the allocation
+/// can't be optimized out.
+static std::unique_ptr<int> g_value;
+
+//////////////////////////////////////////////////
+/// \brief Check the calls and the attribution of the allocations to the
+/// running paths.
+TEST(AllocationCounterTest, Scopes)
+{
+  AllocationCounter::Reset();
+  EXPECT_EQ(0u, AllocationCounter::Calls(AllocationPath::RECV_MSG_UPDATE));
+
+  {
+    AllocationCounter::Scope recv(AllocationPath::RECV_MSG_UPDATE);
+    AllocationCounter::OnAllocation();
+    {
+      AllocationCounter::Scope trigger(AllocationPath::TRIGGER_CALLBACKS);
+      AllocationCounter::OnAllocation();
+
+      // Running a path again is not another call.
+      AllocationCounter::Scope again(AllocationPath::TRIGGER_CALLBACKS);
+      AllocationCounter::OnAllocation();
+    }
+  }
+
+  // Not counted, no path is running.
+  AllocationCounter::OnAllocation();
+
+  EXPECT_EQ(1u, AllocationCounter::Calls(AllocationPath::RECV_MSG_UPDATE));
+  EXPECT_EQ(3u,
+    AllocationCounter::Allocations(AllocationPath::RECV_MSG_UPDATE));
+  EXPECT_EQ(1u, AllocationCounter::Calls(AllocationPath::TRIGGER_CALLBACKS));
+  EXPECT_EQ(2u,
+    AllocationCounter::Allocations(AllocationPath::TRIGGER_CALLBACKS));
+  EXPECT_EQ(0u, AllocationCounter::Calls(AllocationPath::PUBLISH_THREAD));
+
+  AllocationCounter::Reset();
+  EXPECT_EQ(0u, AllocationCounter::Calls(AllocationPath::RECV_MSG_UPDATE));
+  EXPECT_EQ(0u,
+    AllocationCounter::Allocations(AllocationPath::RECV_MSG_UPDATE));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that operator new is counted in the instrumented builds.
+TEST(AllocationCounterTest, OperatorNew)
+{
+  AllocationCounter::Reset();
+  {
+    AllocationCounter::Scope scope(AllocationPath::PUBLISHER_PUBLISH);
+    g_value.reset(new int(1));
+  }
+  g_value.reset();
+
+  const uint64_t expected = AllocationCounter::Enabled() ? 1u : 0u;
+  EXPECT_EQ(expected,
+    AllocationCounter::Allocations(AllocationPath::PUBLISHER_PUBLISH));
+}
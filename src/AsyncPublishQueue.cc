@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/Helpers.hh"
+#include "AsyncPublishQueue.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+AsyncPublishQueue::AsyncPublishQueue(const std::size_t _capacity,
+  const QueuePolicy_t _policy, const uint64_t _capacityBytes,
+  std::shared_ptr<ByteBudget> _budget)
+  : capacity(std::max<std::size_t>(_capacity, 1u)),
+    policy(_policy),
+    capacityBytes(_capacityBytes),
+    budget(std::move(_budget))
+{
+  this->thread = std::thread(&AsyncPublishQueue::Run, this);
+  configureThread(this->thread, "ign-async-pub");
+}
+
+//////////////////////////////////////////////////
+AsyncPublishQueue::~AsyncPublishQueue()
+{
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->stop = true;
+  }
+  this->notEmpty.notify_all();
+  this->notFull.notify_all();
+
+  if (this->thread.joinable())
+    this->thread.join();
+}
+
+//////////////////////////////////////////////////
+bool AsyncPublishQueue::Full(const uint64_t _bytes) const
+{
+  return this->tasks.size() >= this->capacity ||
+    (this->capacityBytes > 0 && !this->tasks.empty() &&
+     this->bytes + _bytes > this->capacityBytes);
+}
+
+//////////////////////////////////////////////////
+bool AsyncPublishQueue::Push(Task _task, const uint64_t _bytes)
+{
+  // Dropped tasks are destroyed outside of the lock, they might release a
+  // message buffer.
+  std::vector<Task> droppedTasks;
+  {
+    std::unique_lock<std::mutex> lk(this->mutex);
+    if (this->Full(_bytes))
+    {
+      switch (this->policy)
+      {
+        case QueuePolicy_t::DROP_NEWEST:
+          ++this->dropped;
+          return false;
+        case QueuePolicy_t::BLOCK:
+          this->notFull.wait(lk, [this, _bytes]
+          {
+            return this->stop || !this->Full(_bytes);
+          });
+          break;
+        case QueuePolicy_t::DROP_OLDEST:
+        default:
+          while (this->Full(_bytes))
+          {
+            droppedTasks.push_back(std::move(this->tasks.front().task));
+            this->bytes -= this->tasks.front().bytes;
+            if (this->budget)
+              this->budget->Release(this->tasks.front().bytes);
+            this->tasks.pop_front();
+            ++this->dropped;
+          }
+          break;
+      }
+    }
+
+    // The budget is shared with other queues, which don't signal this one.
+    if (this->budget && !this->budget->TryAcquire(_bytes))
+    {
+      bool acquired = false;
+      switch (this->policy)
+      {
+        case QueuePolicy_t::DROP_NEWEST:
+          break;
+        case QueuePolicy_t::BLOCK:
+          while (!this->stop && !acquired)
+          {
+            this->notFull.wait_for(lk, std::chrono::milliseconds(1));
+            acquired = this->budget->TryAcquire(_bytes);
+          }
+          break;
+        case QueuePolicy_t::DROP_OLDEST:
+        default:
+          while (!acquired && !this->tasks.empty())
+          {
+            droppedTasks.push_back(std::move(this->tasks.front().task));
+            this->bytes -= this->tasks.front().bytes;
+            this->budget->Release(this->tasks.front().bytes);
+            this->tasks.pop_front();
+            ++this->dropped;
+            acquired = this->budget->TryAcquire(_bytes);
+          }
+          break;
+      }
+
+      if (!acquired)
+      {
+        ++this->dropped;
+        return false;
+      }
+    }
+
+    this->tasks.push_back(Pending{std::move(_task), _bytes});
+    this->bytes += _bytes;
+  }
+  this->notEmpty.notify_one();
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t AsyncPublishQueue::Size() const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return this->tasks.size();
+}
+
+//////////////////////////////////////////////////
+uint64_t AsyncPublishQueue::Dropped() const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return this->dropped;
+}
+
+//////////////////////////////////////////////////
+void AsyncPublishQueue::Run()
+{
+  while (true)
+  {
+    Pending pending;
+    {
+      std::unique_lock<std::mutex> lk(this->mutex);
+      this->notEmpty.wait(lk, [this]
+      {
+        return this->stop || !this->tasks.empty();
+      });
+
+      // Pending sends are still executed when stopping.
+      if (this->tasks.empty())
+        return;
+
+      pending = std::move(this->tasks.front());
+      this->tasks.pop_front();
+      this->bytes -= pending.bytes;
+    }
+    this->notFull.notify_one();
+
+    pending.task();
+    pending.task = nullptr;
+    if (this->budget)
+      this->budget->Release(pending.bytes);
+  }
+}
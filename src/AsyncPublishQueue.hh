@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_ASYNCPUBLISHQUEUE_HH_
+#define IGN_TRANSPORT_ASYNCPUBLISHQUEUE_HH_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ByteBudget.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class AsyncPublishQueue AsyncPublishQueue.hh
+    /// \brief A bounded queue of pending sends, drained by its own thread.
+    /// The queue is bounded in number of sends, and optionally in bytes of
+    /// their messages and by a ByteBudget shared with other queues. When
+    /// the queue is full, the queue policy decides whether the oldest
+    /// send is dropped, the new send is dropped, or the caller blocks.
+    class IGNITION_TRANSPORT_VISIBLE AsyncPublishQueue
+    {
+      /// \brief A pending send.
+      public: using Task = std::function<void()>;
+
+      /// \brief Constructor. Starts the sender thread.
+      /// \param[in] _capacity Maximum number of pending sends.
+      /// \param[in] _policy What to do when the queue is full.
+      /// \param[in] _capacityBytes Maximum number of bytes of the pending
+      /// sends, zero for no limit. A send is always accepted by an empty
+      /// queue.
+      /// \param[in] _budget Bytes shared with other queues, held from the
+      /// time a send is queued until it's done. Null for no limit.
+      public: AsyncPublishQueue(const std::size_t _capacity,
+                                const QueuePolicy_t _policy,
+                                const uint64_t _capacityBytes = 0,
+                                std::shared_ptr<ByteBudget> _budget = nullptr);
+
+      /// \brief Destructor. Runs the pending sends and stops the thread.
+      public: ~AsyncPublishQueue();
+
+      /// \brief Queue a send.
+      /// \param[in] _task The send.
+      /// \param[in] _bytes Size of the message sent, counted by the byte
+      /// limits.
+      /// \return False if the task was dropped because the queue was full.
+      /// Tasks dropped with QueuePolicy_t::DROP_OLDEST are not reported,
+      /// unless the budget is exhausted by the other queues.
+      public: bool Push(Task _task, const uint64_t _bytes = 0);
+
+      /// \brief Number of pending sends.
+      /// \return The number of pending sends.
+      public: std::size_t Size() const;
+
+      /// \brief Total number of sends dropped because the queue was full.
+      /// \return The number of sends dropped.
+      public: uint64_t Dropped() const;
+
+      /// \brief Run the pending sends until the queue is destroyed.
+      private: void Run();
+
+      /// \brief Whether the queue must make room for a send. Must be
+      /// called with the mutex locked.
+      /// \param[in] _bytes Size of the message of the send.
+      /// \return True if the queue is full.
+      private: bool Full(const uint64_t _bytes) const;
+
+      /// \brief A pending send.
+      private: struct Pending
+               {
+                 /// \brief The send.
+                 public: Task task;
+
+                 /// \brief Size of its message.
+                 public: uint64_t bytes = 0;
+               };
+
+      /// \brief Maximum number of pending sends.
+      private: const std::size_t capacity;
+
+      /// \brief What to do when the queue is full.
+      private: const QueuePolicy_t policy;
+
+      /// \brief Maximum number of bytes of the pending sends, zero for no
+      /// limit.
+      private: const uint64_t capacityBytes;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Protects the queue.
+      private: mutable std::mutex mutex;
+
+      /// \brief Signaled when a task is queued or the queue is stopped.
+      private: std::condition_variable notEmpty;
+
+      /// \brief Signaled when a task is removed from the queue.
+      private: std::condition_variable notFull;
+
+      /// \brief Pending sends.
+      private: std::deque<Pending> tasks;
+
+      /// \brief Bytes of the pending sends.
+      private: uint64_t bytes = 0;
+
+      /// \brief Bytes shared with other queues, null for no limit.
+      private: std::shared_ptr<ByteBudget> budget;
+
+      /// \brief The sender thread.
+      private: std::thread thread;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+      /// \brief Number of sends dropped.
+      private: uint64_t dropped = 0;
+
+      /// \brief True when the queue is being destroyed.
+      private: bool stop = false;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AsyncPublishQueue.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Fill the queue while the sender thread is stuck in a task.
+/// \param[in] _queue The queue.
+/// \param[in] _gate Future that unblocks the first task.
+/// \param[out] _executed The values of the executed tasks.
+/// \param[in] _mutex Protects _executed.
+static void fill(AsyncPublishQueue &_queue, std::shared_future<void> _gate,
+  std::vector<int> &_executed, std::mutex &_mutex)
+{
+  std::promise<void> started;
+  EXPECT_TRUE(_queue.Push([&started, _gate]()
+  {
+    started.set_value();
+    _gate.wait();
+  }));
+  started.get_future().wait();
+
+  for (int i = 0; i < 3; ++i)
+  {
+    _queue.Push([i, &_executed, &_mutex]()
+    {
+      std::lock_guard<std::mutex> lk(_mutex);
+      _executed.push_back(i);
+    });
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the oldest tasks are dropped.
+TEST(AsyncPublishQueueTest, DropOldest)
+{
+  std::promise<void> gate;
+  std::vector<int> executed;
+  std::mutex mutex;
+  {
+    AsyncPublishQueue queue(2, QueuePolicy_t::DROP_OLDEST);
+    fill(queue, gate.get_future().share(), executed, mutex);
+    EXPECT_EQ(2u, queue.Size());
+    EXPECT_EQ(1u, queue.Dropped());
+    gate.set_value();
+  }
+  EXPECT_EQ(std::vector<int>({1, 2}), executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the newest tasks are dropped.
+TEST(AsyncPublishQueueTest, DropNewest)
+{
+  std::promise<void> gate;
+  std::vector<int> executed;
+  std::mutex mutex;
+  {
+    AsyncPublishQueue queue(2, QueuePolicy_t::DROP_NEWEST);
+    fill(queue, gate.get_future().share(), executed, mutex);
+    EXPECT_EQ(2u, queue.Size());
+    EXPECT_EQ(1u, queue.Dropped());
+    EXPECT_FALSE(queue.Push([](){}));
+    gate.set_value();
+  }
+  EXPECT_EQ(std::vector<int>({0, 1}), executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the caller blocks until there is space.
+TEST(AsyncPublishQueueTest, Block)
+{
+  std::promise<void> gate;
+  std::shared_future<void> gateFuture = gate.get_future().share();
+  std::vector<int> executed;
+  std::mutex mutex;
+  {
+    AsyncPublishQueue queue(2, QueuePolicy_t::BLOCK);
+
+    std::atomic<bool> done(false);
+    std::thread producer([&]()
+    {
+      fill(queue, gateFuture, executed, mutex);
+      done = true;
+    });
+
+    // The third task can't be queued until the first one finishes.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(done);
+    EXPECT_EQ(2u, queue.Size());
+
+    gate.set_value();
+    producer.join();
+    EXPECT_TRUE(done);
+    EXPECT_EQ(0u, queue.Dropped());
+  }
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the limits of the bytes of the pending sends.
+TEST(AsyncPublishQueueTest, Bytes)
+{
+  std::promise<void> gate;
+  std::shared_future<void> gateFuture = gate.get_future().share();
+  std::promise<void> started;
+  auto budget = std::make_shared<ByteBudget>(1500);
+  {
+    AsyncPublishQueue queue(100, QueuePolicy_t::DROP_OLDEST, 1000, budget);
+    EXPECT_TRUE(queue.Push([&started, gateFuture]()
+    {
+      started.set_value();
+      gateFuture.wait();
+    }, 200));
+    started.get_future().wait();
+
+    // The queue holds 1000 bytes, the budget counts the running send too.
+    EXPECT_TRUE(queue.Push([]() {}, 600));
+    EXPECT_TRUE(queue.Push([]() {}, 600));
+    EXPECT_EQ(1u, queue.Size());
+    EXPECT_EQ(1u, queue.Dropped());
+    EXPECT_EQ(800u, budget->Used());
+
+    // Another queue fills the budget, the oldest send makes room.
+    EXPECT_TRUE(budget->TryAcquire(600));
+    EXPECT_TRUE(queue.Push([]() {}, 400));
+    EXPECT_EQ(1u, queue.Size());
+    EXPECT_EQ(2u, queue.Dropped());
+    EXPECT_EQ(1200u, budget->Used());
+    budget->Release(600);
+
+    gate.set_value();
+  }
+  EXPECT_EQ(0u, budget->Used());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
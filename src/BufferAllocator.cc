@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+#include "ignition/transport/BufferAllocator.hh"
+#include "ignition/transport/Helpers.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Size of a huge page, the granularity of the mapped buffers.
+static const std::size_t kHugePageSize = 2 * 1024 * 1024;
+
+/// \brief Private data of LargeBufferAllocator.
+class ignition::transport::LargeBufferAllocatorPrivate
+{
+  /// \brief True to back the buffers with huge pages.
+  public: bool hugePages = true;
+
+  /// \brief NUMA node of the buffers, or -1.
+  public: int numaNode = -1;
+
+  /// \brief Size from which the buffers are mapped.
+  public: std::size_t threshold = LargeBufferAllocator::kDefaultThreshold;
+
+  /// \brief Maximum number of idle mappings.
+  public: std::size_t maxFreeBuffers = 8;
+
+  /// \brief Protects freeList.
+  public: mutable std::mutex mutex;
+
+  /// \brief Idle mappings, by size.
+  public: std::multimap<std::size_t, void *> freeList;
+};
+
+/// \brief Default allocator of the process, created on first use.
+static std::shared_ptr<BufferAllocator> &defaultAllocator()
+{
+  static std::shared_ptr<BufferAllocator> allocator = []()
+    -> std::shared_ptr<BufferAllocator>
+  {
+    std::string hugePages;
+    const bool useHugePages =
+      env("IGN_TRANSPORT_HUGE_PAGES", hugePages) && hugePages == "1";
+
+    int numaNode = -1;
+    std::string node;
+    if (env("IGN_TRANSPORT_NUMA_NODE", node) && !node.empty())
+    {
+      try
+      {
+        numaNode = std::stoi(node);
+      }
+      catch (...)
+      {
+        std::cerr << "Unable to parse IGN_TRANSPORT_NUMA_NODE [" << node
+                  << "]. The buffers won't be bound to a NUMA node."
+                  << std::endl;
+      }
+    }
+
+    if (!useHugePages && numaNode < 0)
+      return std::make_shared<HeapBufferAllocator>();
+    return std::make_shared<LargeBufferAllocator>(useHugePages, numaNode);
+  }();
+  return allocator;
+}
+
+//////////////////////////////////////////////////
+BufferAllocator::~BufferAllocator()
+{
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<BufferAllocator> BufferAllocator::Default()
+{
+  return std::atomic_load(&defaultAllocator());
+}
+
+//////////////////////////////////////////////////
+void BufferAllocator::SetDefault(
+  const std::shared_ptr<BufferAllocator> &_allocator)
+{
+  std::shared_ptr<BufferAllocator> allocator = _allocator;
+  if (!allocator)
+    allocator = std::make_shared<HeapBufferAllocator>();
+  std::atomic_store(&defaultAllocator(), allocator);
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<char> BufferAllocator::Shared(const std::size_t _size)
+{
+  std::shared_ptr<BufferAllocator> allocator = Default();
+  char *data = static_cast<char *>(allocator->Allocate(_size));
+  if (!data)
+    return nullptr;
+
+  return std::shared_ptr<char>(data, [allocator, _size](char *_data)
+    {
+      allocator->Deallocate(_data, _size);
+    });
+}
+
+//////////////////////////////////////////////////
+void *HeapBufferAllocator::Allocate(const std::size_t _size)
+{
+  return ::operator new(_size, std::nothrow);
+}
+
+//////////////////////////////////////////////////
+void HeapBufferAllocator::Deallocate(void *_data, const std::size_t /*_size*/)
+{
+  ::operator delete(_data);
+}
+
+//////////////////////////////////////////////////
+LargeBufferAllocator::LargeBufferAllocator(const bool _hugePages,
+  const int _numaNode, const std::size_t _threshold,
+  const std::size_t _maxFreeBuffers)
+  : dataPtr(new LargeBufferAllocatorPrivate())
+{
+  this->dataPtr->hugePages = _hugePages;
+  this->dataPtr->numaNode = _numaNode;
+  this->dataPtr->threshold = _threshold;
+  this->dataPtr->maxFreeBuffers = _maxFreeBuffers;
+}
+
+//////////////////////////////////////////////////
+LargeBufferAllocator::~LargeBufferAllocator()
+{
+#ifdef __linux__
+  for (const auto &mapping : this->dataPtr->freeList)
+    munmap(mapping.second, mapping.first);
+#endif
+}
+
+//////////////////////////////////////////////////
+void *LargeBufferAllocator::Allocate(const std::size_t _size)
+{
+#ifdef __linux__
+  if (_size >= this->dataPtr->threshold)
+  {
+    const std::size_t size =
+      (_size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+
+    {
+      std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+      auto it = this->dataPtr->freeList.find(size);
+      if (it != this->dataPtr->freeList.end())
+      {
+        void *data = it->second;
+        this->dataPtr->freeList.erase(it);
+        return data;
+      }
+    }
+
+    // Explicit huge pages are only available if the system reserved some.
+    void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (this->dataPtr->hugePages)
+    {
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (data == MAP_FAILED)
+    {
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data == MAP_FAILED)
+        return nullptr;
+#ifdef MADV_HUGEPAGE
+      if (this->dataPtr->hugePages)
+        madvise(data, size, MADV_HUGEPAGE);
+#endif
+    }
+
+#ifdef SYS_mbind
+    // The pages are placed on the preferred node when they are first
+    // touched. Without libnuma, the system call is used directly.
+    const int numaNode = this->dataPtr->numaNode;
+    const std::size_t kBitsPerWord = 8 * sizeof(unsigned long);
+    unsigned long nodeMask[16] = {0};
+    if (numaNode >= 0 &&
+        static_cast<std::size_t>(numaNode) < 16 * kBitsPerWord)
+    {
+      const int kMpolPreferred = 1;
+      nodeMask[numaNode / kBitsPerWord] |= 1ul << (numaNode % kBitsPerWord);
+      if (syscall(SYS_mbind, data, size, kMpolPreferred, nodeMask,
+            16 * kBitsPerWord + 1, 0) != 0)
+      {
+        static std::once_flag warned;
+        std::call_once(warned, [numaNode]()
+        {
+          std::cerr << "Unable to bind the buffers to NUMA node ["
+                    << numaNode << "]" << std::endl;
+        });
+      }
+    }
+#endif
+    return data;
+  }
+#endif
+
+  return ::operator new(_size, std::nothrow);
+}
+
+//////////////////////////////////////////////////
+void LargeBufferAllocator::Deallocate(void *_data, const std::size_t _size)
+{
+  if (!_data)
+    return;
+
+#ifdef __linux__
+  if (_size >= this->dataPtr->threshold)
+  {
+    const std::size_t size =
+      (_size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+
+    {
+      std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+      if (this->dataPtr->freeList.size() < this->dataPtr->maxFreeBuffers)
+      {
+        this->dataPtr->freeList.emplace(size, _data);
+        return;
+      }
+    }
+    munmap(_data, size);
+    return;
+  }
+#endif
+
+  ::operator delete(_data);
+}
+
+//////////////////////////////////////////////////
+std::size_t LargeBufferAllocator::FreeCount() const
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  return this->dataPtr->freeList.size();
+}
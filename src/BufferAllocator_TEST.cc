@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "ignition/transport/BufferAllocator.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Allocator counting its allocations.
+class CountingAllocator : public HeapBufferAllocator
+{
+  // Documentation inherited.
+  public: void *Allocate(const std::size_t _size) override
+  {
+    ++this->allocations;
+    return HeapBufferAllocator::Allocate(_size);
+  }
+
+  // Documentation inherited.
+  public: void Deallocate(void *_data, const std::size_t _size) override
+  {
+    ++this->deallocations;
+    HeapBufferAllocator::Deallocate(_data, _size);
+  }
+
+  /// \brief Number of allocations.
+  public: int allocations = 0;
+
+  /// \brief Number of deallocations.
+  public: int deallocations = 0;
+};
+
+//////////////////////////////////////////////////
+/// \brief Check that the default allocator can be replaced.
+TEST(BufferAllocatorTest, Default)
+{
+  ASSERT_NE(nullptr, BufferAllocator::Default());
+
+  auto counting = std::make_shared<CountingAllocator>();
+  BufferAllocator::SetDefault(counting);
+  EXPECT_EQ(counting, BufferAllocator::Default());
+
+  {
+    std::shared_ptr<char> buffer = BufferAllocator::Shared(64);
+    ASSERT_NE(nullptr, buffer);
+    std::memset(buffer.get(), 1, 64);
+    EXPECT_EQ(1, counting->allocations);
+
+    // Buffers outlive the replacement of their allocator.
+    BufferAllocator::SetDefault(nullptr);
+    EXPECT_NE(counting, BufferAllocator::Default());
+    EXPECT_EQ(0, counting->deallocations);
+  }
+  EXPECT_EQ(1, counting->deallocations);
+
+  // Containers use the default allocator.
+  BufferAllocator::SetDefault(counting);
+  {
+    std::vector<char, BufferStdAllocator<char>> data(1000, 'a');
+    EXPECT_EQ(2, counting->allocations);
+  }
+  EXPECT_EQ(2, counting->deallocations);
+  BufferAllocator::SetDefault(nullptr);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the large buffers are reused.
+TEST(BufferAllocatorTest, LargeBuffers)
+{
+  LargeBufferAllocator allocator(true, -1, 4096, 1);
+
+  // Small buffers come from the heap.
+  void *small = allocator.Allocate(100);
+  ASSERT_NE(nullptr, small);
+  allocator.Deallocate(small, 100);
+  EXPECT_EQ(0u, allocator.FreeCount());
+
+  const std::size_t size = 3 * 1024 * 1024;
+  char *first = static_cast<char *>(allocator.Allocate(size));
+  char *second = static_cast<char *>(allocator.Allocate(size));
+  ASSERT_NE(nullptr, first);
+  ASSERT_NE(nullptr, second);
+  std::memset(first, 1, size);
+  std::memset(second, 2, size);
+
+  // Only one idle buffer is kept.
+  allocator.Deallocate(first, size);
+  allocator.Deallocate(second, size);
+#ifdef __linux__
+  EXPECT_EQ(1u, allocator.FreeCount());
+  EXPECT_EQ(first, allocator.Allocate(size));
+  EXPECT_EQ(0u, allocator.FreeCount());
+  allocator.Deallocate(first, size);
+#endif
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "BufferPool.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Value used to detect pointers that were not loaned by a pool.
+static const uint32_t kSlabMagic = 0x1f2e3d4c;
+
+//////////////////////////////////////////////////
+struct ignition::transport::BufferPool::Slab
+{
+  /// \brief Pool that loaned this slab. Only set while the slab is loaned
+  /// so idle slabs in the free list do not keep their pool alive.
+  std::shared_ptr<BufferPool> pool;
+
+  /// \brief Usable size of the buffer that follows the header (bytes).
+  std::size_t capacity = 0;
+
+  /// \brief Number of references to the loaned buffer.
+  std::atomic<int> refs{0};
+
+  /// \brief kSlabMagic while the slab is loaned.
+  std::atomic<uint32_t> magic{0};
+};
+
+/// \brief Size of the slab header, rounded up so the buffer that follows it
+/// is suitably aligned for any type.
+static const std::size_t kHeaderSize =
+  ((sizeof(BufferPool::Slab) + alignof(std::max_align_t) - 1) /
+    alignof(std::max_align_t)) * alignof(std::max_align_t);
+
+/// \brief Get the buffer stored after a slab header.
+/// \param[in] _slab The slab.
+/// \return Pointer to the buffer.
+static char *SlabData(BufferPool::Slab *_slab)
+{
+  return reinterpret_cast<char *>(_slab) + kHeaderSize;
+}
+
+/// \brief Get the slab header of a buffer.
+/// \param[in] _data Pointer to the buffer.
+/// \return Pointer to the header.
+static BufferPool::Slab *SlabHeader(const char *_data)
+{
+  return reinterpret_cast<BufferPool::Slab *>(
+    const_cast<char *>(_data) - kHeaderSize);
+}
+
+/// \brief Allocate a new slab.
+/// \param[in] _capacity Usable size of the buffer.
+/// \return The slab or nullptr on allocation failure.
+static BufferPool::Slab *NewSlab(const std::size_t _capacity)
+{
+  void *mem = ::operator new(kHeaderSize + _capacity, std::nothrow);
+  if (!mem)
+    return nullptr;
+
+  BufferPool::Slab *slab = new (mem) BufferPool::Slab();
+  slab->capacity = _capacity;
+  return slab;
+}
+
+/// \brief Deallocate a slab.
+/// \param[in] _slab The slab.
+static void DeleteSlab(BufferPool::Slab *_slab)
+{
+  _slab->~Slab();
+  ::operator delete(_slab);
+}
+
+//////////////////////////////////////////////////
+BufferPool::BufferPool(const std::size_t _maxFreeBuffers)
+  : maxFreeBuffers(_maxFreeBuffers)
+{
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<BufferPool> BufferPool::Create(
+  const std::size_t _maxFreeBuffers)
+{
+  return std::shared_ptr<BufferPool>(new BufferPool(_maxFreeBuffers));
+}
+
+//////////////////////////////////////////////////
+BufferPool::~BufferPool()
+{
+  for (Slab *slab : this->freeList)
+    DeleteSlab(slab);
+}
+
+//////////////////////////////////////////////////
+char *BufferPool::Loan(const std::size_t _size)
+{
+  Slab *slab = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+
+    // Reuse the smallest idle slab that fits.
+    auto best = this->freeList.end();
+    for (auto it = this->freeList.begin(); it != this->freeList.end(); ++it)
+    {
+      if ((*it)->capacity >= _size &&
+          (best == this->freeList.end() || (*it)->capacity < (*best)->capacity))
+      {
+        best = it;
+      }
+    }
+
+    if (best != this->freeList.end())
+    {
+      slab = *best;
+      *best = this->freeList.back();
+      this->freeList.pop_back();
+    }
+  }
+
+  if (!slab)
+  {
+    slab = NewSlab(_size);
+    if (!slab)
+    {
+      std::cerr << "BufferPool::Loan(): Unable to allocate [" << _size
+                << "] bytes" << std::endl;
+      return nullptr;
+    }
+  }
+
+  slab->pool = this->shared_from_this();
+  slab->refs = 1;
+  slab->magic = kSlabMagic;
+  return SlabData(slab);
+}
+
+//////////////////////////////////////////////////
+std::size_t BufferPool::FreeCount() const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return this->freeList.size();
+}
+
+//////////////////////////////////////////////////
+bool BufferPool::IsLoaned(const char *_data)
+{
+  return _data && SlabHeader(_data)->magic == kSlabMagic;
+}
+
+//////////////////////////////////////////////////
+std::size_t BufferPool::Capacity(const char *_data)
+{
+  return SlabHeader(_data)->capacity;
+}
+
+//////////////////////////////////////////////////
+void BufferPool::AddRef(char *_data)
+{
+  SlabHeader(_data)->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+void BufferPool::Release(char *_data)
+{
+  Slab *slab = SlabHeader(_data);
+  if (slab->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+
+  slab->magic = 0;
+
+  // The slab may hold the last reference to its pool.
+  std::shared_ptr<BufferPool> pool = std::move(slab->pool);
+  pool->Recycle(slab);
+}
+
+//////////////////////////////////////////////////
+void BufferPool::Recycle(Slab *_slab)
+{
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    if (this->freeList.size() < this->maxFreeBuffers)
+    {
+      this->freeList.push_back(_slab);
+      return;
+    }
+  }
+
+  DeleteSlab(_slab);
+}
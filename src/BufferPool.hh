@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_BUFFERPOOL_HH_
+#define IGN_TRANSPORT_BUFFERPOOL_HH_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class BufferPool BufferPool.hh
+    /// \brief A pool of reusable buffers that can be loaned to a publisher.
+    /// Each loaned buffer is reference counted. When the last reference is
+    /// released (e.g. from the ZeroMQ deallocation function), the buffer goes
+    /// back to the free list of the pool that loaned it, avoiding a
+    /// malloc/free per publication. Buffers that are still in flight keep
+    /// their pool alive, so a pool may be destroyed at any time.
+    class IGNITION_TRANSPORT_VISIBLE BufferPool
+      : public std::enable_shared_from_this<BufferPool>
+    {
+      /// \brief Default maximum number of idle buffers kept by a pool.
+      public: static const std::size_t kDefaultMaxFreeBuffers = 16;
+
+      /// \brief Create a new pool. Pools must be owned by a std::shared_ptr.
+      /// \param[in] _maxFreeBuffers Maximum number of idle buffers kept in
+      /// the free list. Extra buffers are deallocated when released.
+      /// \return A new pool.
+      public: static std::shared_ptr<BufferPool> Create(
+        const std::size_t _maxFreeBuffers = kDefaultMaxFreeBuffers);
+
+      /// \brief Destructor. Deallocates all the idle buffers.
+      public: ~BufferPool();
+
+      /// \brief Loan a writable buffer of at least _size bytes. The caller
+      /// owns one reference that must be released with Release().
+      /// \param[in] _size Minimum size of the buffer (bytes).
+      /// \return Pointer to the buffer or nullptr on allocation failure.
+      public: char *Loan(const std::size_t _size);
+
+      /// \brief Number of idle buffers currently in the free list.
+      /// \return Number of idle buffers.
+      public: std::size_t FreeCount() const;
+
+      /// \brief Check whether a buffer returned by Loan() is still loaned.
+      /// This is a sanity check, _data must point to memory allocated by a
+      /// BufferPool.
+      /// \param[in] _data Pointer to check.
+      /// \return True if _data has not been fully released yet.
+      public: static bool IsLoaned(const char *_data);
+
+      /// \brief Capacity of a loaned buffer.
+      /// \param[in] _data A buffer returned by Loan().
+      /// \return The usable size of the buffer (bytes).
+      public: static std::size_t Capacity(const char *_data);
+
+      /// \brief Add a reference to a loaned buffer.
+      /// \param[in] _data A buffer returned by Loan().
+      public: static void AddRef(char *_data);
+
+      /// \brief Release a reference to a loaned buffer. When the last
+      /// reference is released, the buffer returns to its pool.
+      /// \param[in] _data A buffer returned by Loan().
+      public: static void Release(char *_data);
+
+      /// \brief Constructor. Use Create() instead.
+      /// \param[in] _maxFreeBuffers Maximum number of idle buffers.
+      private: explicit BufferPool(const std::size_t _maxFreeBuffers);
+
+      /// \internal
+      /// \brief Header stored in front of each buffer.
+      public: struct Slab;
+
+      /// \brief Return a slab to the free list or deallocate it.
+      /// \param[in] _slab The slab to recycle.
+      private: void Recycle(Slab *_slab);
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Protects the free list.
+      private: mutable std::mutex mutex;
+
+      /// \brief Idle slabs ready to be loaned.
+      private: std::vector<Slab *> freeList;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+      /// \brief Maximum size of the free list.
+      private: std::size_t maxFreeBuffers;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstring>
+#include <memory>
+
+#include "BufferPool.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Check that released buffers are recycled.
+TEST(BufferPoolTest, Recycle)
+{
+  auto pool = transport::BufferPool::Create();
+  EXPECT_EQ(0u, pool->FreeCount());
+
+  char *buffer = pool->Loan(100);
+  ASSERT_NE(nullptr, buffer);
+  EXPECT_TRUE(transport::BufferPool::IsLoaned(buffer));
+  EXPECT_GE(transport::BufferPool::Capacity(buffer), 100u);
+  memset(buffer, 0, 100);
+
+  transport::BufferPool::Release(buffer);
+  EXPECT_EQ(1u, pool->FreeCount());
+
+  // A smaller request should reuse the same buffer.
+  char *buffer2 = pool->Loan(50);
+  EXPECT_EQ(buffer, buffer2);
+  EXPECT_EQ(0u, pool->FreeCount());
+
+  // A bigger request needs a new buffer.
+  char *buffer3 = pool->Loan(200);
+  EXPECT_NE(buffer2, buffer3);
+  EXPECT_GE(transport::BufferPool::Capacity(buffer3), 200u);
+
+  transport::BufferPool::Release(buffer2);
+  transport::BufferPool::Release(buffer3);
+  EXPECT_EQ(2u, pool->FreeCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the reference counting of a loaned buffer.
+TEST(BufferPoolTest, References)
+{
+  auto pool = transport::BufferPool::Create();
+
+  char *buffer = pool->Loan(10);
+  transport::BufferPool::AddRef(buffer);
+
+  transport::BufferPool::Release(buffer);
+  EXPECT_TRUE(transport::BufferPool::IsLoaned(buffer));
+  EXPECT_EQ(0u, pool->FreeCount());
+
+  transport::BufferPool::Release(buffer);
+  EXPECT_EQ(1u, pool->FreeCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the free list is bounded.
+TEST(BufferPoolTest, MaxFreeBuffers)
+{
+  auto pool = transport::BufferPool::Create(1);
+
+  char *buffer1 = pool->Loan(10);
+  char *buffer2 = pool->Loan(10);
+  transport::BufferPool::Release(buffer1);
+  transport::BufferPool::Release(buffer2);
+  EXPECT_EQ(1u, pool->FreeCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief A buffer in flight should keep its pool alive.
+TEST(BufferPoolTest, OutlivePool)
+{
+  auto pool = transport::BufferPool::Create();
+  std::weak_ptr<transport::BufferPool> weakPool = pool;
+
+  char *buffer = pool->Loan(10);
+  pool.reset();
+  EXPECT_FALSE(weakPool.expired());
+
+  transport::BufferPool::Release(buffer);
+  EXPECT_TRUE(weakPool.expired());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ByteBudget.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+ByteBudget::ByteBudget(const uint64_t _limit)
+  : limit(_limit)
+{
+}
+
+//////////////////////////////////////////////////
+bool ByteBudget::TryAcquire(const uint64_t _bytes)
+{
+  uint64_t current = this->used.load(std::memory_order_relaxed);
+  do
+  {
+    if (current > 0 && current + _bytes > this->limit)
+      return false;
+  }
+  while (!this->used.compare_exchange_weak(current, current + _bytes,
+           std::memory_order_relaxed));
+  return true;
+}
+
+//////////////////////////////////////////////////
+void ByteBudget::Release(const uint64_t _bytes)
+{
+  this->used.fetch_sub(_bytes, std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+uint64_t ByteBudget::Used() const
+{
+  return this->used.load(std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+uint64_t ByteBudget::Limit() const
+{
+  return this->limit;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_BYTEBUDGET_HH_
+#define IGN_TRANSPORT_BYTEBUDGET_HH_
+
+#include <atomic>
+#include <cstdint>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class ByteBudget ByteBudget.hh
+    /// \brief Bytes of the messages queued by several queues, bounded
+    /// together, e.g. the queues fed by the same socket. A message is
+    /// always admitted when nothing is queued, so that a message larger
+    /// than the limit doesn't block its queues forever.
+    class IGNITION_TRANSPORT_VISIBLE ByteBudget
+    {
+      /// \brief Constructor.
+      /// \param[in] _limit Maximum number of bytes queued.
+      public: explicit ByteBudget(const uint64_t _limit);
+
+      /// \brief Reserve bytes for a message, if they fit.
+      /// \param[in] _bytes Size of the message.
+      /// \return True if the bytes were reserved.
+      public: bool TryAcquire(const uint64_t _bytes);
+
+      /// \brief Return the bytes of a message that left its queue.
+      /// \param[in] _bytes Size of the message.
+      public: void Release(const uint64_t _bytes);
+
+      /// \brief Bytes reserved.
+      /// \return The number of bytes.
+      public: uint64_t Used() const;
+
+      /// \brief Maximum number of bytes queued.
+      /// \return The limit.
+      public: uint64_t Limit() const;
+
+      /// \brief Maximum number of bytes queued.
+      private: const uint64_t limit;
+
+      /// \brief Bytes reserved.
+      private: std::atomic<uint64_t> used{0};
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ByteBudget.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check that the bytes reserved stay under the limit.
+TEST(ByteBudgetTest, Limit)
+{
+  ByteBudget budget(100);
+  EXPECT_EQ(100u, budget.Limit());
+  EXPECT_TRUE(budget.TryAcquire(60));
+  EXPECT_TRUE(budget.TryAcquire(40));
+  EXPECT_FALSE(budget.TryAcquire(1));
+  EXPECT_EQ(100u, budget.Used());
+
+  budget.Release(60);
+  EXPECT_FALSE(budget.TryAcquire(61));
+  EXPECT_TRUE(budget.TryAcquire(60));
+  budget.Release(100);
+  EXPECT_EQ(0u, budget.Used());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a message larger than the limit is admitted alone.
+TEST(ByteBudgetTest, LargeMessage)
+{
+  ByteBudget budget(100);
+  EXPECT_TRUE(budget.TryAcquire(1000));
+  EXPECT_FALSE(budget.TryAcquire(1));
+  budget.Release(1000);
+  EXPECT_TRUE(budget.TryAcquire(1));
+}
@@ -15,13 +15,174 @@
  *
 */
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "ignition/transport/Node.hh"
 #include "ignition/transport/SubscribeOptions.hh"
 #include "ignition/transport/CIface.h"
 
+/// \brief A publisher with the name of its message type, to publish without
+/// looking up its topic.
+struct IgnTransportPublisher
+{
+  /// \brief The publisher.
+  ignition::transport::Node::Publisher publisher;
+
+  /// \brief Name of the message type.
+  std::string msgType;
+};
+
+/// \brief A message queued by a subscription of ignTransportSubscribePoll().
+struct QueuedMessage
+{
+  /// \brief Serialized data of the message.
+  std::string data;
+
+  /// \brief Name of the message type.
+  std::string msgType;
+};
+
+/// \brief The queue of a subscription of ignTransportSubscribePoll(). It's
+/// shared with the callback of the subscription, which may still run while
+/// the subscription is destroyed.
+struct IgnTransportSubscription
+{
+  /// \brief Constructor. Creates the file descriptor signaling the
+  /// messages.
+  /// \param[in] _topic Name of the topic.
+  /// \param[in] _capacity Maximum number of messages queued.
+  IgnTransportSubscription(const std::string &_topic, size_t _capacity)
+    : topic(_topic), capacity(_capacity)
+  {
+#ifdef __linux__
+    this->readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    this->writeFd = this->readFd;
+#elif !defined(_WIN32)
+    int fds[2];
+    if (pipe(fds) == 0)
+    {
+      for (int fd : fds)
+      {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+      }
+      this->readFd = fds[0];
+      this->writeFd = fds[1];
+    }
+#endif
+  }
+
+  /// \brief Destructor. Closes the file descriptors.
+  ~IgnTransportSubscription()
+  {
+#ifndef _WIN32
+    if (this->readFd >= 0)
+      close(this->readFd);
+    if (this->writeFd >= 0 && this->writeFd != this->readFd)
+      close(this->writeFd);
+#endif
+  }
+
+  /// \brief Queue a message received, from the reception thread.
+  /// \param[in] _data Serialized data of the message.
+  /// \param[in] _size Number of bytes of _data.
+  /// \param[in] _msgType Name of the message type.
+  void Push(const char *_data, size_t _size, const std::string &_msgType)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->queue.size() >= this->capacity)
+    {
+      ++this->dropped;
+      return;
+    }
+
+    // Reuse the strings of the messages already read
+    QueuedMessage msg;
+    if (!this->spare.empty())
+    {
+      msg = std::move(this->spare.back());
+      this->spare.pop_back();
+    }
+    msg.data.assign(_data, _size);
+    msg.msgType = _msgType;
+    this->queue.push_back(std::move(msg));
+
+    // Signal the first message queued
+    if (this->queue.size() == 1)
+      this->Signal(true);
+  }
+
+  /// \brief Signal whether messages are queued, through the file
+  /// descriptor. The mutex must be locked.
+  /// \param[in] _queued True if messages are queued.
+  void Signal(bool _queued)
+  {
+#ifndef _WIN32
+    if (this->writeFd < 0)
+      return;
+    if (_queued)
+    {
+      const uint64_t one = 1;
+      const ssize_t written = write(this->writeFd, &one,
+        this->writeFd == this->readFd ? sizeof(one) : 1);
+      static_cast<void>(written);
+    }
+    else
+    {
+      // Until the descriptor isn't readable anymore
+      char buffer[64];
+      while (read(this->readFd, buffer, sizeof(buffer)) > 0)
+        continue;
+    }
+#else
+    static_cast<void>(_queued);
+#endif
+  }
+
+  /// \brief Name of the topic.
+  std::string topic;
+
+  /// \brief Maximum number of messages queued.
+  size_t capacity;
+
+  /// \brief Protects the members below.
+  std::mutex mutex;
+
+  /// \brief Messages queued.
+  std::deque<QueuedMessage> queue;
+
+  /// \brief Messages returned by the last ignTransportPoll().
+  std::vector<QueuedMessage> polled;
+
+  /// \brief Messages read before, whose memory is reused.
+  std::vector<QueuedMessage> spare;
+
+  /// \brief Number of messages dropped because the queue was full.
+  size_t dropped = 0;
+
+  /// \brief File descriptor readable while messages are queued.
+  int readFd = -1;
+
+  /// \brief File descriptor written to signal the messages. It's readFd
+  /// for an eventfd.
+  int writeFd = -1;
+};
+
 /// \brief A wrapper to store an Ignition Transport node and its publishers.
 struct IgnTransportNode
 {
@@ -30,6 +191,13 @@ struct IgnTransportNode
 
   /// \brief All publishers of this node.
   std::map<std::string, ignition::transport::Node::Publisher> publishers;
+
+  /// \brief Publishers returned by ignTransportAdvertisePublisher(), by
+  /// topic. They share the publishers above.
+  std::map<std::string, std::unique_ptr<IgnTransportPublisher>> handles;
+
+  /// \brief Subscriptions of ignTransportSubscribePoll(), by topic.
+  std::map<std::string, std::shared_ptr<IgnTransportSubscription>> polled;
 };
 
 /////////////////////////////////////////////////
@@ -67,6 +235,90 @@ int ignTransportAdvertise(IgnTransportNode *_node, const char *_topic,
   return 0;
 }
 
+/////////////////////////////////////////////////
+IgnTransportPublisher *ignTransportAdvertisePublisher(IgnTransportNode *_node,
+    const char *_topic, const char *_msgType)
+{
+  if (!_node || !_topic || !_msgType)
+    return nullptr;
+
+  auto handle = _node->handles.find(_topic);
+  if (handle != _node->handles.end())
+    return handle->second.get();
+
+  if (ignTransportAdvertise(_node, _topic, _msgType) != 0)
+    return nullptr;
+
+  const ignition::transport::Node::Publisher &publisher =
+    _node->publishers[_topic];
+  if (!publisher)
+    return nullptr;
+
+  std::unique_ptr<IgnTransportPublisher> newHandle(
+    new IgnTransportPublisher{publisher, _msgType});
+  IgnTransportPublisher *result = newHandle.get();
+  _node->handles[_topic] = std::move(newHandle);
+  return result;
+}
+
+/////////////////////////////////////////////////
+int ignTransportPublisherPublish(IgnTransportPublisher *_publisher,
+    const void *_data, size_t _size)
+{
+  if (!_publisher || (!_data && _size > 0))
+    return 1;
+
+  return _publisher->publisher.PublishRaw(
+    static_cast<const char *>(_data), _size, _publisher->msgType) ? 0 : 1;
+}
+
+/////////////////////////////////////////////////
+size_t ignTransportPublisherPublishBatch(IgnTransportPublisher *_publisher,
+    const void *const *_data, const size_t *_sizes, size_t _count)
+{
+  if (!_publisher || !_data || !_sizes)
+    return _count;
+
+  size_t failed = 0;
+  for (size_t i = 0; i < _count; ++i)
+  {
+    if (ignTransportPublisherPublish(_publisher, _data[i], _sizes[i]) != 0)
+      ++failed;
+  }
+  return failed;
+}
+
+/////////////////////////////////////////////////
+void *ignTransportPublisherLoan(IgnTransportPublisher *_publisher,
+    size_t _size)
+{
+  if (!_publisher)
+    return nullptr;
+
+  return _publisher->publisher.Loan(_size);
+}
+
+/////////////////////////////////////////////////
+int ignTransportPublisherPublishLoaned(IgnTransportPublisher *_publisher,
+    void *_data, size_t _size)
+{
+  if (!_publisher || !_data)
+    return 1;
+
+  return _publisher->publisher.PublishLoaned(static_cast<char *>(_data),
+    _size, _publisher->msgType) ? 0 : 1;
+}
+
+/////////////////////////////////////////////////
+void ignTransportPublisherReturnLoan(IgnTransportPublisher *_publisher,
+    void *_data)
+{
+  if (!_publisher || !_data)
+    return;
+
+  _publisher->publisher.ReturnLoan(static_cast<char *>(_data));
+}
+
 /////////////////////////////////////////////////
 int ignTransportPublish(IgnTransportNode *_node, const char *_topic,
     const void *_data, const char *_msgType)
@@ -145,6 +397,100 @@ int ignTransportSubscribeNonConst(IgnTransportNode *_node, char *_topic,
                   }) ? 0 : 1;
 }
 
+/////////////////////////////////////////////////
+IgnTransportSubscription *ignTransportSubscribePoll(IgnTransportNode *_node,
+    const char *_topic, size_t _capacity)
+{
+  if (!_node || !_topic || _capacity == 0)
+    return nullptr;
+
+  auto subscription =
+    std::make_shared<IgnTransportSubscription>(_topic, _capacity);
+  std::weak_ptr<IgnTransportSubscription> weak = subscription;
+  const bool subscribed = _node->nodePtr->SubscribeRaw(_topic,
+      [weak](const char *_msg, const size_t _size,
+             const ignition::transport::MessageInfo &_info) -> void
+      {
+        if (auto queue = weak.lock())
+          queue->Push(_msg, _size, _info.Type());
+      });
+  if (!subscribed)
+    return nullptr;
+
+  _node->polled[_topic] = subscription;
+  return subscription.get();
+}
+
+/////////////////////////////////////////////////
+int ignTransportSubscriptionFd(IgnTransportSubscription *_subscription)
+{
+  if (!_subscription)
+    return -1;
+
+  return _subscription->readFd;
+}
+
+/////////////////////////////////////////////////
+size_t ignTransportPoll(IgnTransportSubscription *_subscription,
+    IgnTransportMessage *_msgs, size_t _max)
+{
+  if (!_subscription || !_msgs)
+    return 0;
+
+  std::lock_guard<std::mutex> lock(_subscription->mutex);
+
+  // The messages returned before are read by now
+  for (QueuedMessage &msg : _subscription->polled)
+    _subscription->spare.push_back(std::move(msg));
+  _subscription->polled.clear();
+
+  while (_subscription->polled.size() < _max &&
+         !_subscription->queue.empty())
+  {
+    _subscription->polled.push_back(
+      std::move(_subscription->queue.front()));
+    _subscription->queue.pop_front();
+  }
+  if (_subscription->queue.empty())
+    _subscription->Signal(false);
+
+  for (size_t i = 0; i < _subscription->polled.size(); ++i)
+  {
+    const QueuedMessage &msg = _subscription->polled[i];
+    _msgs[i].data = msg.data.data();
+    _msgs[i].size = msg.data.size();
+    _msgs[i].msgType = msg.msgType.c_str();
+  }
+  return _subscription->polled.size();
+}
+
+/////////////////////////////////////////////////
+size_t ignTransportSubscriptionDropped(IgnTransportSubscription *_subscription)
+{
+  if (!_subscription)
+    return 0;
+
+  std::lock_guard<std::mutex> lock(_subscription->mutex);
+  return _subscription->dropped;
+}
+
+/////////////////////////////////////////////////
+int ignTransportUnsubscribePoll(IgnTransportNode *_node,
+    IgnTransportSubscription **_subscription)
+{
+  if (!_node || !_subscription || !*_subscription)
+    return 1;
+
+  auto it = _node->polled.find((*_subscription)->topic);
+  if (it == _node->polled.end() || it->second.get() != *_subscription)
+    return 1;
+
+  const bool unsubscribed = _node->nodePtr->Unsubscribe(it->first);
+  _node->polled.erase(it);
+  *_subscription = nullptr;
+  return unsubscribed ? 0 : 1;
+}
+
 /////////////////////////////////////////////////
 int ignTransportUnsubscribe(IgnTransportNode *_node, const char *_topic)
 {
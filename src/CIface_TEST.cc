@@ -16,6 +16,12 @@
 */
 #include <ignition/msgs/stringmsg.pb.h>
 
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#include <string>
+
 #include "gtest/gtest.h"
 #include "ignition/transport/CIface.h"
 #include "ignition/transport/test_config.h"
@@ -173,6 +179,117 @@ TEST(CIfaceTest, PubSubPartitions)
   EXPECT_EQ(nullptr, nodeBar);
 }
 
+//////////////////////////////////////////////////
+TEST(CIfaceTest, PublisherHandle)
+{
+  count = 0;
+  IgnTransportNode *node = ignTransportNodeCreate(nullptr);
+  EXPECT_NE(nullptr, node);
+
+  const char *topic = "/foo";
+  int userData = 42;
+  ASSERT_EQ(0, ignTransportSubscribe(node, topic, cb, &userData));
+
+  ignition::msgs::StringMsg msg;
+  msg.set_data("HELLO");
+  const std::string data = msg.SerializeAsString();
+  const char *msgType = "ignition.msgs.StringMsg";
+
+  EXPECT_EQ(nullptr, ignTransportAdvertisePublisher(nullptr, topic, msgType));
+  IgnTransportPublisher *pub =
+    ignTransportAdvertisePublisher(node, topic, msgType);
+  ASSERT_NE(nullptr, pub);
+  EXPECT_EQ(pub, ignTransportAdvertisePublisher(node, topic, msgType));
+
+  // The data can hold null bytes
+  EXPECT_EQ(0, ignTransportPublisherPublish(pub, data.data(), data.size()));
+  EXPECT_EQ(1, count);
+
+  const void *batch[] = {data.data(), data.data(), data.data()};
+  const size_t sizes[] = {data.size(), data.size(), data.size()};
+  EXPECT_EQ(0u, ignTransportPublisherPublishBatch(pub, batch, sizes, 3));
+  EXPECT_EQ(4, count);
+
+  void *buffer = ignTransportPublisherLoan(pub, data.size());
+  ASSERT_NE(nullptr, buffer);
+  ASSERT_TRUE(msg.SerializeToArray(buffer, static_cast<int>(data.size())));
+  EXPECT_EQ(0, ignTransportPublisherPublishLoaned(pub, buffer, data.size()));
+  EXPECT_EQ(5, count);
+
+  buffer = ignTransportPublisherLoan(pub, data.size());
+  ASSERT_NE(nullptr, buffer);
+  ignTransportPublisherReturnLoan(pub, buffer);
+  EXPECT_EQ(5, count);
+
+  EXPECT_NE(0, ignTransportPublisherPublish(nullptr, data.data(),
+    data.size()));
+  EXPECT_EQ(nullptr, ignTransportPublisherLoan(nullptr, 1));
+
+  ignTransportNodeDestroy(&node);
+  EXPECT_EQ(nullptr, node);
+}
+
+//////////////////////////////////////////////////
+TEST(CIfaceTest, PollSubscription)
+{
+  IgnTransportNode *node = ignTransportNodeCreate(nullptr);
+  EXPECT_NE(nullptr, node);
+
+  const char *topic = "/foo";
+  EXPECT_EQ(nullptr, ignTransportSubscribePoll(nullptr, topic, 4));
+  EXPECT_EQ(nullptr, ignTransportSubscribePoll(node, topic, 0));
+  IgnTransportSubscription *sub = ignTransportSubscribePoll(node, topic, 4);
+  ASSERT_NE(nullptr, sub);
+
+  const int fd = ignTransportSubscriptionFd(sub);
+#ifndef _WIN32
+  EXPECT_GE(fd, 0);
+#endif
+
+  ignition::msgs::StringMsg msg;
+  msg.set_data("HELLO");
+  const std::string data = msg.SerializeAsString();
+  const char *msgType = "ignition.msgs.StringMsg";
+  IgnTransportPublisher *pub =
+    ignTransportAdvertisePublisher(node, topic, msgType);
+  ASSERT_NE(nullptr, pub);
+
+  IgnTransportMessage msgs[8];
+  EXPECT_EQ(0u, ignTransportPoll(sub, msgs, 8));
+
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(0, ignTransportPublisherPublish(pub, data.data(), data.size()));
+
+#ifndef _WIN32
+  pollfd pfd = {fd, POLLIN, 0};
+  EXPECT_EQ(1, poll(&pfd, 1, 1000));
+#endif
+
+  EXPECT_EQ(2u, ignTransportPoll(sub, msgs, 2));
+  EXPECT_EQ(1u, ignTransportPoll(sub, msgs, 8));
+  EXPECT_EQ(data, std::string(msgs[0].data, msgs[0].size));
+  EXPECT_STREQ(msgType, msgs[0].msgType);
+  EXPECT_EQ(0u, ignTransportSubscriptionDropped(sub));
+
+#ifndef _WIN32
+  // Nothing is queued anymore
+  EXPECT_EQ(0, poll(&pfd, 1, 0));
+#endif
+
+  // The messages beyond the capacity are dropped
+  for (int i = 0; i < 6; ++i)
+    EXPECT_EQ(0, ignTransportPublisherPublish(pub, data.data(), data.size()));
+  EXPECT_EQ(4u, ignTransportPoll(sub, msgs, 8));
+  EXPECT_EQ(2u, ignTransportSubscriptionDropped(sub));
+
+  EXPECT_EQ(0, ignTransportUnsubscribePoll(node, &sub));
+  EXPECT_EQ(nullptr, sub);
+  EXPECT_NE(0, ignTransportUnsubscribePoll(node, &sub));
+
+  ignTransportNodeDestroy(&node);
+  EXPECT_EQ(nullptr, node);
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/Helpers.hh"
+#include "CallbackExecutor.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+struct ignition::transport::CallbackExecutor::State
+{
+  /// \brief A pending task.
+  struct Pending
+  {
+    /// \brief The task.
+    Task task;
+
+    /// \brief Size of its message.
+    uint64_t bytes = 0;
+  };
+
+  /// \brief Pending tasks of a strand.
+  struct Strand
+  {
+    /// \brief Pending tasks.
+    std::deque<Pending> tasks;
+
+    /// \brief Bytes of the pending tasks.
+    uint64_t bytes = 0;
+
+    /// \brief True while the strand is queued in ready or a thread is
+    /// running one of its tasks.
+    bool scheduled = false;
+  };
+
+  /// \brief Run tasks until the executor is destroyed.
+  void Run();
+
+  /// \brief Run the task of the first ready strand.
+  /// \param[in,out] _lk Lock of the mutex, held when called and on return,
+  /// released while the task runs.
+  /// \return True if a task ran.
+  bool RunOne(std::unique_lock<std::mutex> &_lk);
+
+  /// \brief Make the file descriptor readable, if not already. Must be
+  /// called with the mutex locked.
+  void SignalFd();
+
+  /// \brief Consume the readiness of the file descriptor once no strand
+  /// is ready. Must be called with the mutex locked.
+  void ClearFd();
+
+  /// \brief Remove the oldest task of a strand.
+  /// \param[in] _strand The strand, with pending tasks.
+  /// \return The task.
+  Pending PopFront(Strand &_strand);
+
+  /// \brief Whether a strand must make room for a task.
+  /// \param[in] _strand Strand key.
+  /// \param[in] _bytes Size of the message of the task.
+  /// \return True if the strand is full.
+  bool Full(const std::string &_strand, const uint64_t _bytes) const;
+
+  /// \brief Protects the members below.
+  std::mutex mutex;
+
+  /// \brief Signaled when a strand becomes ready or the executor stops.
+  std::condition_variable signal;
+
+  /// \brief Signaled when a task is removed from a strand or the executor
+  /// stops.
+  std::condition_variable notFull;
+
+  /// \brief Maximum number of pending tasks per strand, zero for no limit.
+  std::size_t capacity = 0;
+
+  /// \brief What to do when a strand is full.
+  QueuePolicy_t policy = QueuePolicy_t::DROP_OLDEST;
+
+  /// \brief Maximum number of bytes of the pending tasks per strand, zero
+  /// for no limit.
+  uint64_t capacityBytes = 0;
+
+  /// \brief Bytes shared with other queues, null for no limit.
+  std::shared_ptr<ByteBudget> budget;
+
+  /// \brief Number of tasks dropped.
+  uint64_t dropped = 0;
+
+  /// \brief Strands with pending tasks. The key is the strand key.
+  std::map<std::string, Strand> strands;
+
+  /// \brief Strands ready to run, in order.
+  std::deque<std::string> ready;
+
+  /// \brief True when the executor is destroyed.
+  bool stop = false;
+
+  /// \brief True if the tasks run on the threads calling RunSome() or
+  /// RunUntil().
+  bool manual = false;
+
+  /// \brief Read and write ends of the pipe of a manual executor, -1 if
+  /// unused.
+  int fds[2] = {-1, -1};
+
+  /// \brief True while the read end of the pipe has a byte.
+  bool fdSignaled = false;
+};
+
+//////////////////////////////////////////////////
+void CallbackExecutor::State::Run()
+{
+  std::unique_lock<std::mutex> lk(this->mutex);
+  while (true)
+  {
+    this->signal.wait(lk, [this]
+    {
+      return this->stop || !this->ready.empty();
+    });
+
+    if (this->stop)
+      return;
+
+    this->RunOne(lk);
+  }
+}
+
+//////////////////////////////////////////////////
+bool CallbackExecutor::State::RunOne(std::unique_lock<std::mutex> &_lk)
+{
+  if (this->stop || this->ready.empty())
+    return false;
+
+  const std::string key = std::move(this->ready.front());
+  this->ready.pop_front();
+
+  Strand &strand = this->strands[key];
+  Pending pending = this->PopFront(strand);
+
+  if (this->capacity > 0 || this->capacityBytes > 0 || this->budget)
+    this->notFull.notify_all();
+
+  _lk.unlock();
+  pending.task();
+  // The task might hold the last reference to a handler, release it
+  // before taking the lock. Its message is in memory until then.
+  pending.task = nullptr;
+  if (this->budget)
+    this->budget->Release(pending.bytes);
+  _lk.lock();
+
+  if (this->stop)
+    return true;
+
+  // Run one task at a time per strand and let the other strands run in
+  // between.
+  auto it = this->strands.find(key);
+  if (it->second.tasks.empty())
+  {
+    this->strands.erase(it);
+  }
+  else
+  {
+    this->ready.push_back(key);
+    if (this->manual)
+      this->SignalFd();
+    this->signal.notify_one();
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+void CallbackExecutor::State::SignalFd()
+{
+#ifndef _WIN32
+  if (this->fdSignaled || this->fds[1] == -1)
+    return;
+
+  const char byte = 0;
+  this->fdSignaled = write(this->fds[1], &byte, 1) == 1;
+#endif
+}
+
+//////////////////////////////////////////////////
+void CallbackExecutor::State::ClearFd()
+{
+#ifndef _WIN32
+  if (!this->fdSignaled || !this->ready.empty())
+    return;
+
+  char byte;
+  this->fdSignaled = read(this->fds[0], &byte, 1) != 1;
+#endif
+}
+
+//////////////////////////////////////////////////
+CallbackExecutor::State::Pending CallbackExecutor::State::PopFront(
+  Strand &_strand)
+{
+  Pending pending = std::move(_strand.tasks.front());
+  _strand.tasks.pop_front();
+  _strand.bytes -= pending.bytes;
+  return pending;
+}
+
+//////////////////////////////////////////////////
+bool CallbackExecutor::State::Full(const std::string &_strand,
+  const uint64_t _bytes) const
+{
+  auto it = this->strands.find(_strand);
+  if (it == this->strands.end() || it->second.tasks.empty())
+    return false;
+
+  const Strand &strand = it->second;
+  return (this->capacity > 0 && strand.tasks.size() >= this->capacity) ||
+    (this->capacityBytes > 0 &&
+     strand.bytes + _bytes > this->capacityBytes);
+}
+
+//////////////////////////////////////////////////
+CallbackExecutor::CallbackExecutor(const std::size_t _numThreads,
+  const std::size_t _capacity, const QueuePolicy_t _policy,
+  const uint64_t _capacityBytes, std::shared_ptr<ByteBudget> _budget)
+  : state(std::make_shared<State>())
+{
+  this->state->capacity = _capacity;
+  this->state->policy = _policy;
+  this->state->capacityBytes = _capacityBytes;
+  this->state->budget = std::move(_budget);
+
+  const std::size_t numThreads = _numThreads == 0 ? 1u : _numThreads;
+  for (std::size_t i = 0; i < numThreads; ++i)
+  {
+    std::shared_ptr<State> threadState = this->state;
+    this->threads.emplace_back([threadState]()
+    {
+      threadState->Run();
+    });
+    configureThread(this->threads.back(), "ign-callback");
+  }
+}
+
+//////////////////////////////////////////////////
+CallbackExecutor::CallbackExecutor(std::shared_ptr<State> _state)
+  : state(std::move(_state))
+{
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<CallbackExecutor> CallbackExecutor::Manual(
+  std::shared_ptr<ByteBudget> _budget)
+{
+  auto state = std::make_shared<State>();
+  state->manual = true;
+  state->budget = std::move(_budget);
+
+#ifndef _WIN32
+  if (pipe(state->fds) == 0)
+  {
+    for (const int fd : state->fds)
+    {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+  else
+  {
+    std::cerr << "CallbackExecutor::Manual(): Unable to create a pipe"
+              << std::endl;
+    state->fds[0] = -1;
+    state->fds[1] = -1;
+  }
+#endif
+
+  return std::shared_ptr<CallbackExecutor>(
+    new CallbackExecutor(std::move(state)));
+}
+
+//////////////////////////////////////////////////
+CallbackExecutor::~CallbackExecutor()
+{
+  std::map<std::string, State::Strand> pending;
+  {
+    std::lock_guard<std::mutex> lk(this->state->mutex);
+    this->state->stop = true;
+    this->state->ready.clear();
+    pending.swap(this->state->strands);
+  }
+  if (this->state->budget)
+  {
+    for (const auto &strand : pending)
+      this->state->budget->Release(strand.second.bytes);
+  }
+  this->state->signal.notify_all();
+  this->state->notFull.notify_all();
+
+  for (std::thread &thread : this->threads)
+  {
+    if (thread.get_id() == std::this_thread::get_id())
+      thread.detach();
+    else if (thread.joinable())
+      thread.join();
+  }
+
+#ifndef _WIN32
+  // A task running on a thread of the application keeps the state, but
+  // no longer uses the pipe.
+  for (int &fd : this->state->fds)
+  {
+    if (fd != -1)
+      close(fd);
+    fd = -1;
+  }
+#endif
+}
+
+//////////////////////////////////////////////////
+bool CallbackExecutor::Post(const std::string &_strand, Task _task,
+  const uint64_t _bytes)
+{
+  // A dropped task might hold the last reference to a handler, release it
+  // without holding the lock.
+  std::vector<State::Pending> dropped;
+  {
+    std::unique_lock<std::mutex> lk(this->state->mutex);
+    State &state = *this->state;
+    if (state.stop)
+      return false;
+
+    if (state.Full(_strand, _bytes))
+    {
+      switch (state.policy)
+      {
+        case QueuePolicy_t::DROP_OLDEST:
+        {
+          State::Strand &strand = state.strands[_strand];
+          while (state.Full(_strand, _bytes))
+          {
+            dropped.push_back(state.PopFront(strand));
+            ++state.dropped;
+          }
+          break;
+        }
+        case QueuePolicy_t::DROP_NEWEST:
+          ++state.dropped;
+          return false;
+        case QueuePolicy_t::BLOCK:
+          state.notFull.wait(lk, [&state, &_strand, _bytes]()
+          {
+            return state.stop || !state.Full(_strand, _bytes);
+          });
+          if (state.stop)
+            return false;
+          break;
+      }
+    }
+
+    // The budget is shared with other queues, which don't signal this one.
+    if (state.budget && !state.budget->TryAcquire(_bytes))
+    {
+      bool acquired = false;
+      switch (state.policy)
+      {
+        case QueuePolicy_t::DROP_OLDEST:
+        {
+          State::Strand &strand = state.strands[_strand];
+          while (!acquired && !strand.tasks.empty())
+          {
+            dropped.push_back(state.PopFront(strand));
+            state.budget->Release(dropped.back().bytes);
+            ++state.dropped;
+            acquired = state.budget->TryAcquire(_bytes);
+          }
+          break;
+        }
+        case QueuePolicy_t::DROP_NEWEST:
+          break;
+        case QueuePolicy_t::BLOCK:
+          while (!state.stop && !acquired)
+          {
+            state.notFull.wait_for(lk, std::chrono::milliseconds(1));
+            acquired = !state.stop && state.budget->TryAcquire(_bytes);
+          }
+          break;
+      }
+
+      if (state.stop)
+        return false;
+      if (!acquired)
+      {
+        ++state.dropped;
+        return false;
+      }
+    }
+
+    State::Strand &strand = state.strands[_strand];
+    strand.tasks.push_back(State::Pending{std::move(_task), _bytes});
+    strand.bytes += _bytes;
+    if (strand.scheduled)
+      return true;
+
+    strand.scheduled = true;
+    state.ready.push_back(_strand);
+    if (state.manual)
+      state.SignalFd();
+  }
+  this->state->signal.notify_one();
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t CallbackExecutor::NumThreads() const
+{
+  return this->threads.size();
+}
+
+//////////////////////////////////////////////////
+bool CallbackExecutor::IsManual() const
+{
+  return this->state->manual;
+}
+
+//////////////////////////////////////////////////
+std::size_t CallbackExecutor::RunSome(const std::size_t _max)
+{
+  // A task may destroy the executor, e.g. by destroying its node.
+  std::shared_ptr<State> runState = this->state;
+  std::unique_lock<std::mutex> lk(runState->mutex);
+
+  std::size_t limit = _max;
+  if (limit == 0)
+  {
+    for (const auto &strand : runState->strands)
+      limit += strand.second.tasks.size();
+  }
+
+  std::size_t ran = 0;
+  while (ran < limit && runState->RunOne(lk))
+    ++ran;
+
+  if (!runState->stop)
+    runState->ClearFd();
+  return ran;
+}
+
+//////////////////////////////////////////////////
+std::size_t CallbackExecutor::RunUntil(
+  const std::chrono::steady_clock::time_point &_deadline)
+{
+  // A task may destroy the executor, e.g. by destroying its node.
+  std::shared_ptr<State> runState = this->state;
+  std::unique_lock<std::mutex> lk(runState->mutex);
+
+  std::size_t ran = 0;
+  while (!runState->stop && std::chrono::steady_clock::now() < _deadline)
+  {
+    if (runState->RunOne(lk))
+    {
+      ++ran;
+      continue;
+    }
+
+    runState->signal.wait_until(lk, _deadline, [&runState]
+    {
+      return runState->stop || !runState->ready.empty();
+    });
+  }
+
+  if (!runState->stop)
+    runState->ClearFd();
+  return ran;
+}
+
+//////////////////////////////////////////////////
+int CallbackExecutor::ReadyFd() const
+{
+  return this->state->fds[0];
+}
+
+//////////////////////////////////////////////////
+uint64_t CallbackExecutor::Dropped() const
+{
+  std::lock_guard<std::mutex> lk(this->state->mutex);
+  return this->state->dropped;
+}
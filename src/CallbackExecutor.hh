@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_CALLBACKEXECUTOR_HH_
+#define IGN_TRANSPORT_CALLBACKEXECUTOR_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ByteBudget.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class CallbackExecutor CallbackExecutor.hh
+    /// \brief A pool of threads running subscription callbacks. Tasks posted
+    /// with the same strand key run in the order they were posted and never
+    /// concurrently, while tasks of different strands run in parallel.
+    /// The pending tasks of each strand may be bounded, in number or in
+    /// bytes, and the bytes of the tasks of several executors may be
+    /// bounded together by a ByteBudget, in which case the queue policy
+    /// decides what happens when a strand is full. A manual executor has
+    /// no threads, its tasks run on the threads calling RunSome() or
+    /// RunUntil().
+    class IGNITION_TRANSPORT_VISIBLE CallbackExecutor
+    {
+      /// \brief A callback to run.
+      public: using Task = std::function<void()>;
+
+      /// \brief Constructor. Starts the threads.
+      /// \param[in] _numThreads Number of threads. A value of zero is
+      /// treated as one.
+      /// \param[in] _capacity Maximum number of pending tasks per strand,
+      /// zero for no limit.
+      /// \param[in] _policy What to do when a strand is full.
+      /// \param[in] _capacityBytes Maximum number of bytes of the pending
+      /// tasks per strand, zero for no limit. A task is always accepted by
+      /// an empty strand.
+      /// \param[in] _budget Bytes shared with other queues, held from the
+      /// time a task is posted until it ran. Null for no limit.
+      public: explicit CallbackExecutor(const std::size_t _numThreads,
+                const std::size_t _capacity = 0,
+                const QueuePolicy_t _policy = QueuePolicy_t::DROP_OLDEST,
+                const uint64_t _capacityBytes = 0,
+                std::shared_ptr<ByteBudget> _budget = nullptr);
+
+      /// \brief Create an executor without threads. Its tasks only run
+      /// when RunSome() or RunUntil() are called.
+      /// \param[in] _budget Bytes shared with other queues, held from the
+      /// time a task is posted until it ran. Null for no limit.
+      /// \return The executor.
+      public: static std::shared_ptr<CallbackExecutor> Manual(
+                std::shared_ptr<ByteBudget> _budget = nullptr);
+
+      /// \brief Destructor. Discards the pending tasks, waits for the
+      /// running ones and stops the threads. It may be called from one of
+      /// the threads of the executor, e.g. when a callback destroys its node.
+      public: ~CallbackExecutor();
+
+      /// \brief Queue a task. With QueuePolicy_t::BLOCK, waits until the
+      /// strand has room for the task.
+      /// \param[in] _strand Strand key, e.g. the topic name.
+      /// \param[in] _task The task.
+      /// \param[in] _bytes Size of the message of the task, counted by the
+      /// byte limits.
+      /// \return False if the task was dropped because the strand was full
+      /// or the executor is being destroyed. Tasks dropped with
+      /// QueuePolicy_t::DROP_OLDEST are not reported, unless the budget is
+      /// exhausted by the other queues.
+      public: bool Post(const std::string &_strand, Task _task,
+                        const uint64_t _bytes = 0);
+
+      /// \brief Number of threads.
+      /// \return The number of threads, zero for a manual executor.
+      public: std::size_t NumThreads() const;
+
+      /// \brief Whether the executor was created by Manual().
+      /// \return True if the tasks run on the threads calling RunSome()
+      /// or RunUntil().
+      public: bool IsManual() const;
+
+      /// \brief Run the ready tasks on the calling thread, one task of each
+      /// strand at a time. The tasks of a strand still run in order when
+      /// several threads call this function.
+      /// \param[in] _max Maximum number of tasks to run. Zero runs at most
+      /// the tasks pending when called, so that the call returns even if
+      /// the tasks keep coming.
+      /// \return Number of tasks run.
+      public: std::size_t RunSome(const std::size_t _max = 0);
+
+      /// \brief Run the tasks on the calling thread, as they are posted,
+      /// until a deadline.
+      /// \param[in] _deadline Time when the function returns. A task
+      /// running at that time is completed first.
+      /// \return Number of tasks run.
+      public: std::size_t RunUntil(
+                const std::chrono::steady_clock::time_point &_deadline);
+
+      /// \brief File descriptor of a manual executor, readable while
+      /// tasks are ready to run, e.g. to wait for them with poll() or an
+      /// event loop. It must not be read or closed by the caller.
+      /// \return The file descriptor, or -1 for an executor with threads
+      /// or on Windows.
+      public: int ReadyFd() const;
+
+      /// \brief Total number of tasks dropped because a strand was full.
+      /// \return The number of tasks dropped.
+      public: uint64_t Dropped() const;
+
+      /// \internal
+      /// \brief State shared with the threads.
+      public: struct State;
+
+      /// \brief Constructor of a manual executor.
+      /// \param[in] _state The state.
+      private: explicit CallbackExecutor(std::shared_ptr<State> _state);
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief State shared with the threads. A thread that destroys the
+      /// executor is detached and keeps the state alive until it exits.
+      private: std::shared_ptr<State> state;
+
+      /// \brief The threads.
+      private: std::vector<std::thread> threads;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
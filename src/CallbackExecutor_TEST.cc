@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CallbackExecutor.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check that the tasks of a strand run in order and one at a time.
+TEST(CallbackExecutorTest, StrandOrder)
+{
+  std::vector<int> executed;
+  std::mutex mutex;
+  std::atomic<int> running(0);
+  std::atomic<bool> overlapped(false);
+  std::promise<void> done;
+  {
+    CallbackExecutor executor(4);
+    EXPECT_EQ(4u, executor.NumThreads());
+
+    for (int i = 0; i < 100; ++i)
+    {
+      executor.Post("/foo", [&, i]()
+      {
+        if (++running > 1)
+          overlapped = true;
+        {
+          std::lock_guard<std::mutex> lk(mutex);
+          executed.push_back(i);
+        }
+        --running;
+        if (i == 99)
+          done.set_value();
+      });
+    }
+    done.get_future().wait();
+  }
+
+  EXPECT_FALSE(overlapped);
+  ASSERT_EQ(100u, executed.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i, executed[i]);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a slow strand doesn't block the other strands.
+TEST(CallbackExecutorTest, IndependentStrands)
+{
+  std::promise<void> gate;
+  std::shared_future<void> gateFuture = gate.get_future().share();
+  std::promise<void> fast;
+
+  CallbackExecutor executor(2);
+  executor.Post("/slow", [gateFuture]()
+  {
+    gateFuture.wait();
+  });
+  executor.Post("/fast", [&fast]()
+  {
+    fast.set_value();
+  });
+
+  EXPECT_EQ(std::future_status::ready,
+    fast.get_future().wait_for(std::chrono::seconds(5)));
+  gate.set_value();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a task can destroy its own executor.
+TEST(CallbackExecutorTest, DestroyFromTask)
+{
+  auto executor = std::make_shared<CallbackExecutor>(1);
+  std::promise<void> destroyed;
+  std::shared_ptr<CallbackExecutor> *holder =
+    new std::shared_ptr<CallbackExecutor>(executor);
+  std::weak_ptr<CallbackExecutor> weak = executor;
+  executor.reset();
+
+  // Post() must return before the task destroys the executor.
+  std::promise<void> posted;
+  std::shared_future<void> postedFuture = posted.get_future().share();
+  (*holder)->Post("/foo", [holder, &destroyed, postedFuture]()
+  {
+    postedFuture.wait();
+    delete holder;
+    destroyed.set_value();
+  });
+  posted.set_value();
+
+  destroyed.get_future().wait();
+  EXPECT_TRUE(weak.expired());
+  // Give the detached thread a chance to exit.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+//////////////////////////////////////////////////
+/// \brief Post a task that blocks the strand until the gate is opened and
+/// wait for it to start.
+static void BlockStrand(CallbackExecutor &_executor,
+  std::shared_future<void> _gate)
+{
+  auto started = std::make_shared<std::promise<void>>();
+  std::future<void> startedFuture = started->get_future();
+  _executor.Post("/foo", [started, _gate]()
+  {
+    started->set_value();
+    _gate.wait();
+  });
+  startedFuture.wait();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the drop policies of a bounded strand.
+TEST(CallbackExecutorTest, BoundedStrand)
+{
+  for (auto policy : {QueuePolicy_t::DROP_OLDEST, QueuePolicy_t::DROP_NEWEST})
+  {
+    std::vector<int> executed;
+    std::mutex mutex;
+    std::promise<void> gate;
+    std::promise<void> done;
+    CallbackExecutor executor(1, 2, policy);
+    BlockStrand(executor, gate.get_future().share());
+
+    for (int i = 0; i < 5; ++i)
+    {
+      bool posted = executor.Post("/foo", [&, i]()
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        executed.push_back(i);
+        if (executed.size() == 2u)
+          done.set_value();
+      });
+      EXPECT_EQ(policy == QueuePolicy_t::DROP_OLDEST || i < 2, posted);
+    }
+    EXPECT_EQ(3u, executor.Dropped());
+
+    // Other strands are not affected.
+    EXPECT_TRUE(executor.Post("/bar", []() {}));
+
+    gate.set_value();
+    done.get_future().wait();
+
+    std::lock_guard<std::mutex> lk(mutex);
+    if (policy == QueuePolicy_t::DROP_OLDEST)
+      EXPECT_EQ(std::vector<int>({3, 4}), executed);
+    else
+      EXPECT_EQ(std::vector<int>({0, 1}), executed);
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that QueuePolicy_t::BLOCK waits for room in the strand.
+TEST(CallbackExecutorTest, BlockingStrand)
+{
+  std::atomic<int> executed(0);
+  std::promise<void> gate;
+  CallbackExecutor executor(1, 1, QueuePolicy_t::BLOCK);
+  BlockStrand(executor, gate.get_future().share());
+
+  EXPECT_TRUE(executor.Post("/foo", [&executed]() { ++executed; }));
+
+  std::atomic<bool> posted(false);
+  std::thread poster([&]()
+  {
+    EXPECT_TRUE(executor.Post("/foo", [&executed]() { ++executed; }));
+    posted = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(posted);
+
+  gate.set_value();
+  poster.join();
+  EXPECT_TRUE(posted);
+  EXPECT_EQ(0u, executor.Dropped());
+
+  for (int i = 0; i < 100 && executed < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(2, executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a strand is bounded by the bytes of its tasks.
+TEST(CallbackExecutorTest, BytesOfStrand)
+{
+  std::vector<int> executed;
+  std::mutex mutex;
+  std::promise<void> gate;
+  std::promise<void> done;
+  CallbackExecutor executor(1, 0, QueuePolicy_t::DROP_OLDEST, 1000);
+  BlockStrand(executor, gate.get_future().share());
+
+  // The oldest messages make room for the new ones, and a message larger
+  // than the limit is accepted alone.
+  const uint64_t sizes[] = {100, 100, 900, 2000, 10};
+  for (int i = 0; i < 5; ++i)
+  {
+    EXPECT_TRUE(executor.Post("/foo", [&, i]()
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      executed.push_back(i);
+      if (i == 4)
+        done.set_value();
+    }, sizes[i]));
+  }
+  EXPECT_EQ(4u, executor.Dropped());
+
+  gate.set_value();
+  done.get_future().wait();
+
+  std::lock_guard<std::mutex> lk(mutex);
+  EXPECT_EQ(std::vector<int>({4}), executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the bytes of several executors are bounded together.
+TEST(CallbackExecutorTest, SharedBudget)
+{
+  auto budget = std::make_shared<ByteBudget>(1000);
+  std::promise<void> gate;
+  std::shared_future<void> gateFuture = gate.get_future().share();
+  {
+    CallbackExecutor first(1, 0, QueuePolicy_t::DROP_OLDEST, 0, budget);
+    CallbackExecutor second(1, 0, QueuePolicy_t::DROP_NEWEST, 0, budget);
+    BlockStrand(first, gateFuture);
+    BlockStrand(second, gateFuture);
+
+    EXPECT_TRUE(first.Post("/foo", []() {}, 600));
+    EXPECT_TRUE(second.Post("/bar", []() {}, 300));
+    EXPECT_EQ(900u, budget->Used());
+
+    // The second executor can't drop the tasks of the first one.
+    EXPECT_FALSE(second.Post("/bar", []() {}, 300));
+    EXPECT_EQ(1u, second.Dropped());
+
+    // The first one drops its oldest task to make room.
+    EXPECT_TRUE(first.Post("/foo", []() {}, 500));
+    EXPECT_EQ(1u, first.Dropped());
+    EXPECT_EQ(800u, budget->Used());
+
+    gate.set_value();
+    for (int i = 0; i < 100 && budget->Used() > 0; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(0u, budget->Used());
+
+    // The bytes are returned whether the tasks run or are discarded.
+    std::promise<void> secondGate;
+    BlockStrand(first, secondGate.get_future().share());
+    EXPECT_TRUE(first.Post("/foo", []() {}, 100));
+    EXPECT_EQ(100u, budget->Used());
+    secondGate.set_value();
+  }
+  EXPECT_EQ(0u, budget->Used());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check whether the file descriptor of an executor is readable.
+/// \param[in] _executor The executor.
+/// \return True if readable.
+static bool Readable(const CallbackExecutor &_executor)
+{
+#ifndef _WIN32
+  pollfd fd{_executor.ReadyFd(), POLLIN, 0};
+  return poll(&fd, 1, 0) == 1 && (fd.revents & POLLIN);
+#else
+  (void)_executor;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the tasks of a manual executor only run on the
+/// threads that ask for them, in order.
+TEST(CallbackExecutorTest, Manual)
+{
+  auto executor = CallbackExecutor::Manual();
+  EXPECT_TRUE(executor->IsManual());
+  EXPECT_EQ(0u, executor->NumThreads());
+  EXPECT_EQ(0u, executor->RunSome());
+#ifndef _WIN32
+  EXPECT_NE(-1, executor->ReadyFd());
+#endif
+  EXPECT_FALSE(Readable(*executor));
+
+  std::vector<std::string> executed;
+  for (int i = 0; i < 3; ++i)
+  {
+    for (const std::string strand : {"/foo", "/bar"})
+    {
+      executor->Post(strand, [&executed, strand, i]()
+      {
+        executed.push_back(strand + std::to_string(i));
+      });
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_TRUE(executed.empty());
+#ifndef _WIN32
+  EXPECT_TRUE(Readable(*executor));
+#endif
+
+  // The strands take turns.
+  EXPECT_EQ(3u, executor->RunSome(3));
+  ASSERT_EQ(3u, executed.size());
+  EXPECT_EQ("/foo0", executed[0]);
+  EXPECT_EQ("/bar0", executed[1]);
+  EXPECT_EQ("/foo1", executed[2]);
+#ifndef _WIN32
+  EXPECT_TRUE(Readable(*executor));
+#endif
+
+  // A task posted while spinning waits for the next call.
+  executor->Post("/foo", [&]()
+  {
+    executor->Post("/baz", [&executed]()
+    {
+      executed.push_back("/baz");
+    });
+  });
+  EXPECT_EQ(4u, executor->RunSome());
+  EXPECT_EQ(6u, executed.size());
+  EXPECT_EQ(1u, executor->RunSome());
+  EXPECT_EQ("/baz", executed.back());
+  EXPECT_FALSE(Readable(*executor));
+
+  // An executor with threads has no file descriptor.
+  CallbackExecutor threaded(1);
+  EXPECT_FALSE(threaded.IsManual());
+  EXPECT_EQ(-1, threaded.ReadyFd());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a manual executor runs the tasks posted by another
+/// thread until the deadline.
+TEST(CallbackExecutorTest, ManualUntil)
+{
+  auto executor = CallbackExecutor::Manual();
+  std::atomic<int> executed(0);
+
+  std::thread producer([&executor, &executed]()
+  {
+    for (int i = 0; i < 5; ++i)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      executor->Post("/foo", [&executed]()
+      {
+        ++executed;
+      });
+    }
+  });
+
+  const auto start = std::chrono::steady_clock::now();
+  std::size_t ran = 0;
+  while (executed < 5 &&
+         std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+  {
+    ran += executor->RunUntil(std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(20));
+  }
+  producer.join();
+  EXPECT_EQ(5, executed);
+  EXPECT_EQ(5u, ran);
+
+  // Nothing to run, the call returns at the deadline.
+  const auto before = std::chrono::steady_clock::now();
+  EXPECT_EQ(0u, executor->RunUntil(before + std::chrono::milliseconds(20)));
+  EXPECT_GE(std::chrono::steady_clock::now() - before,
+    std::chrono::milliseconds(20));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
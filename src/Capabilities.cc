@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "Capabilities.hh"
+#include "Compression.hh"
+#include "MessageBatch.hh"
+#include "MessageChunks.hh"
+#include "Reliability.hh"
+#include "ShmSegment.hh"
+#include "TopicAlias.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+std::string transport::CapabilitiesAddrFlags(const uint64_t _caps)
+{
+  std::ostringstream flags;
+  flags << kCapsAddrFlag << std::hex << _caps;
+  flags << ((_caps & kCapStats) ? kStatsAddrFlag :
+    (_caps & kCapMetadata) ? kMetadataAddrFlag : "");
+  if (_caps & kCapChunks)
+    flags << kChunkAddrFlag;
+  if (_caps & kCapMulticast)
+    flags << kMulticastAddrFlag;
+  if (_caps & kCapReliable)
+    flags << kReliableAddrFlag;
+  if (_caps & kCapAck)
+    flags << kAckAddrFlag;
+  if (_caps & kCapBatch)
+    flags << kBatchAddrFlag;
+  if (_caps & kCapZlib)
+    flags << kZlibAddrSuffix;
+  return flags.str();
+}
+
+//////////////////////////////////////////////////
+uint64_t transport::ParseCapabilities(const std::string &_addr)
+{
+  const std::size_t pos = _addr.find(kCapsAddrFlag);
+  if (pos != std::string::npos)
+  {
+    return std::strtoull(_addr.c_str() + pos + kCapsAddrFlag.size(),
+      nullptr, 16);
+  }
+
+  // The subscribers that predate the bitmap register flags instead.
+  uint64_t caps = 0;
+  if (_addr.compare(0, kShmAddrPrefix.size(), kShmAddrPrefix) == 0)
+    caps |= kCapShm | kCapAlias;
+  if (_addr.compare(0, kTopicAliasAddrPrefix.size(),
+        kTopicAliasAddrPrefix) == 0)
+  {
+    caps |= kCapAlias;
+  }
+  if ((caps & kCapAlias) && _addr.size() >= kZlibAddrSuffix.size() &&
+      _addr.compare(_addr.size() - kZlibAddrSuffix.size(),
+        kZlibAddrSuffix.size(), kZlibAddrSuffix) == 0)
+  {
+    caps |= kCapZlib;
+  }
+
+  if (_addr.find(kStatsAddrFlag) != std::string::npos)
+    caps |= kCapStats | kCapMetadata;
+  if (_addr.find(kMetadataAddrFlag) != std::string::npos)
+    caps |= kCapMetadata;
+  if (_addr.find(kMulticastAddrFlag) != std::string::npos)
+    caps |= kCapMulticast;
+  if (_addr.find(kChunkAddrFlag) != std::string::npos)
+    caps |= kCapChunks;
+  if (_addr.find(kReliableAddrFlag) != std::string::npos)
+    caps |= kCapReliable;
+  if (_addr.find(kAckAddrFlag) != std::string::npos)
+    caps |= kCapAck;
+  if (_addr.find(kBatchAddrFlag) != std::string::npos)
+    caps |= kCapBatch;
+  return caps;
+}
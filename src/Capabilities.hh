@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_CAPABILITIES_HH_
+#define IGN_TRANSPORT_CAPABILITIES_HH_
+
+#include <cstdint>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    // A subscriber announces the bitmap of the encodings and features it's
+    // able to receive a topic with in the address it registers with the
+    // publishers of the topic, and the publisher uses those supported by all
+    // the subscribers of the topic, since they share the frames sent. The
+    // bits that a publisher doesn't know are ignored, so a new encoding is
+    // rolled out by adding a bit instead of changing the version of the wire
+    // protocol: the publishers keep the older encodings until all the
+    // subscribers of a topic are able to receive the new one.
+
+    /// \brief Publications with a topic alias.
+    static const uint64_t kCapAlias = uint64_t(1) << 0;
+
+    /// \brief Publications in shared memory, on the same host.
+    static const uint64_t kCapShm = uint64_t(1) << 1;
+
+    /// \brief Publications compressed with zlib.
+    static const uint64_t kCapZlib = uint64_t(1) << 2;
+
+    /// \brief Publications with their metadata.
+    static const uint64_t kCapMetadata = uint64_t(1) << 3;
+
+    /// \brief The subscriber wants the metadata, for its statistics.
+    static const uint64_t kCapStats = uint64_t(1) << 4;
+
+    /// \brief The subscriber joined the multicast group of the topic.
+    static const uint64_t kCapMulticast = uint64_t(1) << 5;
+
+    /// \brief Large publications sent in chunks.
+    static const uint64_t kCapChunks = uint64_t(1) << 6;
+
+    /// \brief Numbered publications of the reliable topics.
+    static const uint64_t kCapReliable = uint64_t(1) << 7;
+
+    /// \brief Acknowledgements of the publications.
+    static const uint64_t kCapAck = uint64_t(1) << 8;
+
+    /// \brief Several messages packed in one publication, see
+    /// Node::Publisher::Flush(). The service discovery announces it for the
+    /// responsers of a process that unpack the batches of oneway requests.
+    static const uint64_t kCapBatch = uint64_t(1) << 9;
+
+    /// \brief Flag of the address registered by a subscriber that wants the
+    /// publication metadata of a topic, for its topic statistics.
+    static const std::string kStatsAddrFlag = "?stats";
+
+    /// \brief Flag of the address registered by a subscriber that accepts
+    /// the publication metadata of a topic but doesn't need it. Older
+    /// subscribers register neither flag and only accept the metadata when
+    /// IGN_TRANSPORT_TOPIC_STATISTICS is set.
+    static const std::string kMetadataAddrFlag = "?meta";
+
+    /// \brief Flag of the address registered by a subscriber that joined
+    /// the multicast group of a topic. It precedes the zlib suffix.
+    static const std::string kMulticastAddrFlag = "?mcast";
+
+    /// \brief Flag of the address registered by a subscriber, followed by
+    /// the bitmap of its capabilities in hexadecimal. It precedes the other
+    /// flags, which are still registered for the subscribers that predate
+    /// the bitmap.
+    static const std::string kCapsAddrFlag = "?caps=";
+
+    /// \brief Build the flags of the address registered by a subscriber
+    /// with some capabilities: the bitmap followed by the flags understood
+    /// by the older publishers. The shared memory and alias capabilities
+    /// are in the prefix of the address.
+    /// \param[in] _caps The capabilities.
+    /// \return The flags, to append to the address.
+    IGNITION_TRANSPORT_VISIBLE std::string CapabilitiesAddrFlags(
+      const uint64_t _caps);
+
+    /// \brief Get the capabilities registered by a subscriber. The older
+    /// subscribers register flags instead of a bitmap.
+    /// \param[in] _addr The address registered by the subscriber.
+    /// \return The capabilities.
+    IGNITION_TRANSPORT_VISIBLE uint64_t ParseCapabilities(
+      const std::string &_addr);
+    }
+  }
+}
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdint>
+#include <string>
+
+#include "Capabilities.hh"
+#include "Compression.hh"
+#include "MessageBatch.hh"
+#include "MessageChunks.hh"
+#include "Reliability.hh"
+#include "ShmSegment.hh"
+#include "TopicAlias.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check that the bitmap is parsed back, unknown bits included.
+TEST(CapabilitiesTest, Bitmap)
+{
+  const uint64_t caps = kCapAlias | kCapMetadata | kCapChunks |
+    kCapReliable | kCapAck | kCapZlib;
+  const std::string addr =
+    kTopicAliasAddrPrefix + "uuid" + CapabilitiesAddrFlags(caps);
+  EXPECT_EQ(caps, ParseCapabilities(addr));
+  EXPECT_EQ(caps | kCapShm, ParseCapabilities(
+    kShmAddrPrefix + "uuid" + CapabilitiesAddrFlags(caps | kCapShm)));
+
+  // The bits of the encodings of newer subscribers are kept.
+  const uint64_t future = uint64_t(1) << 40;
+  EXPECT_EQ(caps | future, ParseCapabilities(kTopicAliasAddrPrefix + "uuid" +
+    CapabilitiesAddrFlags(caps | future)));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the older publishers still find their flags.
+TEST(CapabilitiesTest, LegacyFlags)
+{
+  const std::string flags = CapabilitiesAddrFlags(kCapAlias | kCapStats |
+    kCapMetadata | kCapMulticast | kCapChunks | kCapReliable | kCapAck |
+    kCapZlib);
+  EXPECT_NE(std::string::npos, flags.find(kStatsAddrFlag));
+  EXPECT_EQ(std::string::npos, flags.find(kMetadataAddrFlag));
+  EXPECT_NE(std::string::npos, flags.find(kMulticastAddrFlag));
+  EXPECT_NE(std::string::npos, flags.find(kChunkAddrFlag));
+  EXPECT_NE(std::string::npos, flags.find(kReliableAddrFlag));
+  EXPECT_NE(std::string::npos, flags.find(kAckAddrFlag));
+  // The zlib suffix is always last.
+  EXPECT_EQ(flags.size() - kZlibAddrSuffix.size(),
+    flags.rfind(kZlibAddrSuffix));
+
+  EXPECT_NE(std::string::npos,
+    CapabilitiesAddrFlags(kCapMetadata).find(kMetadataAddrFlag));
+  EXPECT_EQ(std::string::npos, CapabilitiesAddrFlags(0).find("?zlib"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the capabilities of the subscribers without a bitmap.
+TEST(CapabilitiesTest, LegacyAddresses)
+{
+  EXPECT_EQ(0u, ParseCapabilities("uuid"));
+  EXPECT_EQ(kCapAlias, ParseCapabilities(kTopicAliasAddrPrefix + "uuid"));
+  EXPECT_EQ(kCapAlias | kCapShm | kCapZlib,
+    ParseCapabilities(kShmAddrPrefix + "uuid" + kZlibAddrSuffix));
+  EXPECT_EQ(kCapAlias | kCapStats | kCapMetadata | kCapChunks |
+    kCapReliable | kCapAck | kCapZlib,
+    ParseCapabilities(kTopicAliasAddrPrefix + "uuid" + kStatsAddrFlag +
+      kChunkAddrFlag + kReliableAddrFlag + kAckAddrFlag + kZlibAddrSuffix));
+  EXPECT_EQ(kCapAlias | kCapMetadata | kCapMulticast,
+    ParseCapabilities(kTopicAliasAddrPrefix + "uuid" + kMetadataAddrFlag +
+      kMulticastAddrFlag));
+
+  // Without an alias the publications can't be compressed.
+  EXPECT_EQ(0u, ParseCapabilities("uuid" + kZlibAddrSuffix));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the batches are only sent to the subscribers that
+/// registered as able to unpack them.
+TEST(CapabilitiesTest, Batch)
+{
+  const std::string flags = CapabilitiesAddrFlags(kCapAlias | kCapBatch);
+  EXPECT_NE(std::string::npos, flags.find(kBatchAddrFlag));
+  EXPECT_EQ(kCapAlias | kCapBatch,
+    ParseCapabilities(kTopicAliasAddrPrefix + "uuid" + flags));
+  EXPECT_EQ(kCapAlias | kCapBatch,
+    ParseCapabilities(kTopicAliasAddrPrefix + "uuid" + kBatchAddrFlag));
+
+  // The older subscribers can't unpack them.
+  EXPECT_EQ(0u, ParseCapabilities(kTopicAliasAddrPrefix + "uuid" +
+    CapabilitiesAddrFlags(kCapAlias)) & kCapBatch);
+  EXPECT_EQ(0u, ParseCapabilities("uuid") & kCapBatch);
+}
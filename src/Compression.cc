@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ignition/transport/config.hh"
+
+#ifdef HAVE_ZLIB
+  #include <zlib.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "Compression.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Maximum compression ratio of zlib.
+static const uint64_t kZlibMaxRatio = 1032;
+
+//////////////////////////////////////////////////
+bool transport::CompressionAvailable(const Compression_t _compression)
+{
+  switch (_compression)
+  {
+    case Compression_t::NONE:
+      return true;
+    case Compression_t::ZLIB:
+#ifdef HAVE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+//////////////////////////////////////////////////
+bool transport::ZlibSizeValid(const uint64_t _rawSize, const uint64_t _size)
+{
+  return _rawSize <= _size * kZlibMaxRatio;
+}
+
+//////////////////////////////////////////////////
+bool transport::ZlibDeflate(const char *_data, const std::size_t _size,
+  std::string &_out)
+{
+#ifdef HAVE_ZLIB
+  const std::size_t start = _out.size();
+  uLongf compressedSize = compressBound(static_cast<uLong>(_size));
+  _out.resize(start + compressedSize);
+
+  // Favor speed, the goal is to save bandwidth or disk without stalling
+  // the publisher or the recorder.
+  if (compress2(reinterpret_cast<Bytef *>(&_out[start]), &compressedSize,
+        reinterpret_cast<const Bytef *>(_data), static_cast<uLong>(_size),
+        Z_BEST_SPEED) != Z_OK ||
+      start + compressedSize >= _size)
+  {
+    _out.resize(start);
+    return false;
+  }
+
+  _out.resize(start + compressedSize);
+  return true;
+#else
+  (void)_data;
+  (void)_size;
+  (void)_out;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool transport::ZlibInflate(const char *_data, const std::size_t _size,
+  const uint64_t _rawSize, std::string &_out)
+{
+  _out.clear();
+
+#ifdef HAVE_ZLIB
+  if (_rawSize == 0 || !ZlibSizeValid(_rawSize, _size))
+    return false;
+
+  _out.resize(static_cast<std::size_t>(_rawSize));
+  uLongf outSize = static_cast<uLongf>(_rawSize);
+  if (uncompress(reinterpret_cast<Bytef *>(&_out[0]), &outSize,
+        reinterpret_cast<const Bytef *>(_data),
+        static_cast<uLong>(_size)) != Z_OK ||
+      outSize != _rawSize)
+  {
+    _out.clear();
+    return false;
+  }
+  return true;
+#else
+  (void)_data;
+  (void)_size;
+  (void)_rawSize;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool transport::ZlibCompress(const char *_data, const std::size_t _size,
+  std::string &_out)
+{
+  const uint64_t size = _size;
+  _out.resize(sizeof(size));
+  std::memcpy(&_out[0], &size, sizeof(size));
+
+  if (!ZlibDeflate(_data, _size, _out))
+  {
+    _out.clear();
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool transport::ZlibDecompress(const char *_data, const std::size_t _size,
+  std::string &_out)
+{
+  uint64_t size;
+  if (_size <= sizeof(size))
+  {
+    _out.clear();
+    return false;
+  }
+  std::memcpy(&size, _data, sizeof(size));
+  return ZlibInflate(_data + sizeof(size), _size - sizeof(size), size, _out);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_COMPRESSION_HH_
+#define IGN_TRANSPORT_COMPRESSION_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Prefix of the message type frame of a publication whose data
+    /// frame has been compressed with zlib.
+    static const std::string kZlibMsgTypePrefix = "@zlib@";
+
+    /// \brief Suffix of the address used by subscribers to register as
+    /// capable of decompressing zlib publications.
+    static const std::string kZlibAddrSuffix = "?zlib";
+
+    /// \brief Check whether a compression algorithm is available in this
+    /// build.
+    /// \param[in] _compression The compression algorithm.
+    /// \return True if messages can be compressed with _compression.
+    IGNITION_TRANSPORT_VISIBLE bool CompressionAvailable(
+      const Compression_t _compression);
+
+    /// \brief Check the uncompressed size of zlib data against the maximum
+    /// compression ratio of zlib, to reject corrupted sizes before
+    /// allocating memory for them.
+    /// \param[in] _rawSize Uncompressed size (bytes).
+    /// \param[in] _size Size of the zlib data (bytes).
+    /// \return True if _size bytes of zlib data may inflate to _rawSize.
+    IGNITION_TRANSPORT_VISIBLE bool ZlibSizeValid(const uint64_t _rawSize,
+      const uint64_t _size);
+
+    /// \brief Compress data into a zlib stream, without any header.
+    /// \param[in] _data Data to compress.
+    /// \param[in] _size Size of _data (bytes).
+    /// \param[in,out] _out The zlib stream is appended to its content.
+    /// \return True on success or false if zlib is not available or _out
+    /// doesn't end up smaller than _data. _out is left unchanged on
+    /// failure.
+    IGNITION_TRANSPORT_VISIBLE bool ZlibDeflate(const char *_data,
+      const std::size_t _size, std::string &_out);
+
+    /// \brief Decompress a zlib stream compressed with ZlibDeflate().
+    /// \param[in] _data The zlib stream.
+    /// \param[in] _size Size of _data (bytes).
+    /// \param[in] _rawSize Expected uncompressed size (bytes).
+    /// \param[out] _out Uncompressed data.
+    /// \return True on success or false if zlib is not available, _rawSize
+    /// is invalid or _data doesn't inflate to exactly _rawSize bytes.
+    IGNITION_TRANSPORT_VISIBLE bool ZlibInflate(const char *_data,
+      const std::size_t _size, const uint64_t _rawSize, std::string &_out);
+
+    /// \brief Compress a serialized message with zlib. The output starts
+    /// with the uncompressed size as a 64-bit integer.
+    /// \param[in] _data Serialized message.
+    /// \param[in] _size Size of _data (bytes).
+    /// \param[out] _out Compressed message.
+    /// \return True on success or false if zlib is not available or the
+    /// message doesn't get smaller.
+    IGNITION_TRANSPORT_VISIBLE bool ZlibCompress(const char *_data,
+      const std::size_t _size, std::string &_out);
+
+    /// \brief Decompress a message compressed with ZlibCompress().
+    /// \param[in] _data Compressed message.
+    /// \param[in] _size Size of _data (bytes).
+    /// \param[out] _out Serialized message.
+    /// \return True on success or false if zlib is not available or _data
+    /// is not valid.
+    IGNITION_TRANSPORT_VISIBLE bool ZlibDecompress(const char *_data,
+      const std::size_t _size, std::string &_out);
+    }
+  }
+}
+#endif
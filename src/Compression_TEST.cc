@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+
+#include "Compression.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check that a message can be compressed and decompressed.
+TEST(CompressionTest, Zlib)
+{
+  EXPECT_TRUE(CompressionAvailable(Compression_t::NONE));
+  if (!CompressionAvailable(Compression_t::ZLIB))
+  {
+    std::string out;
+    EXPECT_FALSE(ZlibCompress("data", 4, out));
+    return;
+  }
+
+  std::string data;
+  for (int i = 0; i < 1000; ++i)
+    data += "occupancy grid " + std::to_string(i % 10);
+
+  std::string compressed;
+  ASSERT_TRUE(ZlibCompress(data.data(), data.size(), compressed));
+  EXPECT_LT(compressed.size(), data.size());
+
+  std::string decompressed;
+  ASSERT_TRUE(ZlibDecompress(compressed.data(), compressed.size(),
+    decompressed));
+  EXPECT_EQ(data, decompressed);
+
+  // Data that doesn't get smaller is not compressed.
+  EXPECT_FALSE(ZlibCompress("a", 1, compressed));
+  EXPECT_TRUE(compressed.empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that invalid data is rejected.
+TEST(CompressionTest, ZlibInvalid)
+{
+  std::string out;
+  EXPECT_FALSE(ZlibDecompress("", 0, out));
+  EXPECT_FALSE(ZlibDecompress("12345678", 8, out));
+
+  // A header claiming a huge size.
+  std::string garbage(16, '\x7f');
+  EXPECT_FALSE(ZlibDecompress(garbage.data(), garbage.size(), out));
+  EXPECT_TRUE(out.empty());
+
+  // Wrong uncompressed size.
+  std::string data(4096, 'x');
+  std::string compressed;
+  if (ZlibCompress(data.data(), data.size(), compressed))
+  {
+    compressed[0] = static_cast<char>(compressed[0] + 1);
+    EXPECT_FALSE(ZlibDecompress(compressed.data(), compressed.size(), out));
+  }
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
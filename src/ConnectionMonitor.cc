@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#endif
+#ifdef __linux__
+#include <linux/sockios.h>
+#endif
+
+#include <zmq.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ConnectionMonitor.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace
+{
+  /// \brief A gauge of the connections.
+  struct ConnectionGauge
+  {
+    /// \brief Name of the gauge.
+    const char *name;
+
+    /// \brief Description of the gauge.
+    const char *help;
+  };
+
+  /// \brief Gauges of each connection, in the order of the statistics
+  /// sampled by ConnectionMonitor::AddGauges().
+  const ConnectionGauge kGauges[] =
+  {
+    {"ign_transport_connection_up",
+     "Whether a connection of the sockets carrying the messages is up"},
+    {"ign_transport_connection_queued_bytes",
+     "Bytes sent on a connection not acknowledged by the peer yet"},
+    {"ign_transport_connection_disconnects",
+     "Times a connection of the sockets carrying the messages was lost"},
+    {"ign_transport_connection_reconnects",
+     "Times a connection of the sockets carrying the messages was "
+     "established again after it was lost"}
+  };
+}
+
+//////////////////////////////////////////////////
+ConnectionMonitor::ConnectionMonitor(const std::string &_socket,
+    const bool _metrics)
+  : socket(_socket),
+    metrics(_metrics)
+{
+}
+
+//////////////////////////////////////////////////
+ConnectionMonitor::~ConnectionMonitor()
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  for (const auto &connection : this->connections)
+    this->RemoveGauges(connection.first);
+}
+
+//////////////////////////////////////////////////
+void ConnectionMonitor::OnEvent(const uint16_t _event, const int64_t _value,
+    const std::string &_address)
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  switch (_event)
+  {
+    case ZMQ_EVENT_CONNECTED:
+    case ZMQ_EVENT_ACCEPTED:
+    {
+      // The accepted connections are named after their peer.
+      std::string endpoint = _address;
+      if (_event == ZMQ_EVENT_ACCEPTED)
+      {
+        endpoint = PeerEndpoint(_value);
+        if (endpoint.empty())
+          endpoint = _address + "#" + std::to_string(_value);
+      }
+
+      Connection &connection = this->ConnectionOf(endpoint);
+      if (connection.stats.connected)
+        this->endpoints.erase(connection.fd);
+      else if (connection.stats.disconnects > 0)
+        ++connection.stats.reconnects;
+      connection.stats.connected = true;
+      ++connection.stats.connects;
+      connection.fd = _value;
+      this->endpoints[_value] = endpoint;
+
+      auto down = std::find(this->disconnected.begin(),
+        this->disconnected.end(), endpoint);
+      if (down != this->disconnected.end())
+        this->disconnected.erase(down);
+      break;
+    }
+    case ZMQ_EVENT_DISCONNECTED:
+    {
+      // The endpoint is copied, Disconnected() forgets the descriptor.
+      auto endpoint = this->endpoints.find(_value);
+      if (endpoint != this->endpoints.end())
+        this->Disconnected(std::string(endpoint->second));
+      else if (this->connections.find(_address) != this->connections.end())
+        this->Disconnected(_address);
+      break;
+    }
+    case ZMQ_EVENT_CONNECT_RETRIED:
+      ++this->ConnectionOf(_address).stats.connectRetries;
+      break;
+#ifdef ZMQ_EVENT_HANDSHAKE_FAILED_NO_DETAIL
+    case ZMQ_EVENT_HANDSHAKE_FAILED_NO_DETAIL:
+    case ZMQ_EVENT_HANDSHAKE_FAILED_PROTOCOL:
+    case ZMQ_EVENT_HANDSHAKE_FAILED_AUTH:
+      ++this->ConnectionOf(_address).stats.handshakeFailures;
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+//////////////////////////////////////////////////
+std::vector<ConnectionStatistics> ConnectionMonitor::Stats() const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  std::vector<ConnectionStatistics> stats;
+  stats.reserve(this->connections.size());
+  for (const auto &connection : this->connections)
+  {
+    stats.push_back(connection.second.stats);
+    if (connection.second.stats.connected)
+      stats.back().queuedBytes = QueuedBytes(connection.second.fd);
+  }
+  return stats;
+}
+
+//////////////////////////////////////////////////
+int64_t ConnectionMonitor::QueuedBytes(const int64_t _fd)
+{
+#ifdef SIOCOUTQ
+  int queued = 0;
+  if (_fd >= 0 && ioctl(static_cast<int>(_fd), SIOCOUTQ, &queued) == 0)
+    return queued;
+#else
+  (void)_fd;
+#endif
+  return -1;
+}
+
+//////////////////////////////////////////////////
+std::string ConnectionMonitor::PeerEndpoint(const int64_t _fd)
+{
+#ifndef _WIN32
+  if (_fd < 0)
+    return "";
+
+  sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  if (getpeername(static_cast<int>(_fd), reinterpret_cast<sockaddr *>(&addr),
+        &len) != 0)
+  {
+    return "";
+  }
+
+  // The ipc:// connections have no address.
+  char host[INET6_ADDRSTRLEN] = {0};
+  if (addr.ss_family == AF_INET)
+  {
+    const auto *in = reinterpret_cast<const sockaddr_in *>(&addr);
+    inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+    return "tcp://" + std::string(host) + ":" +
+      std::to_string(ntohs(in->sin_port));
+  }
+  if (addr.ss_family == AF_INET6)
+  {
+    const auto *in = reinterpret_cast<const sockaddr_in6 *>(&addr);
+    inet_ntop(AF_INET6, &in->sin6_addr, host, sizeof(host));
+    return "tcp://[" + std::string(host) + "]:" +
+      std::to_string(ntohs(in->sin6_port));
+  }
+  return "";
+#else
+  (void)_fd;
+  return "";
+#endif
+}
+
+//////////////////////////////////////////////////
+ConnectionMonitor::Connection &ConnectionMonitor::ConnectionOf(
+    const std::string &_endpoint)
+{
+  auto it = this->connections.find(_endpoint);
+  if (it != this->connections.end())
+    return it->second;
+
+  Connection &connection = this->connections[_endpoint];
+  connection.stats.socket = this->socket;
+  connection.stats.endpoint = _endpoint;
+  this->AddGauges(_endpoint);
+  return connection;
+}
+
+//////////////////////////////////////////////////
+void ConnectionMonitor::Disconnected(const std::string &_endpoint)
+{
+  Connection &connection = this->connections[_endpoint];
+  if (!connection.stats.connected)
+    return;
+
+  connection.stats.connected = false;
+  ++connection.stats.disconnects;
+  this->endpoints.erase(connection.fd);
+  connection.fd = -1;
+
+  this->disconnected.push_back(_endpoint);
+  while (this->disconnected.size() > kMaxDisconnected)
+  {
+    this->RemoveGauges(this->disconnected.front());
+    this->connections.erase(this->disconnected.front());
+    this->disconnected.pop_front();
+  }
+}
+
+//////////////////////////////////////////////////
+void ConnectionMonitor::AddGauges(const std::string &_endpoint)
+{
+  if (!this->metrics)
+    return;
+
+  // The callbacks run without the lock of the registry, so they may take
+  // the mutex while it's held to register other gauges.
+  using Field = double (*)(const Connection &);
+  const Field fields[] =
+  {
+    [](const Connection &_c) {return _c.stats.connected ? 1.0 : 0.0;},
+    [](const Connection &_c)
+    {
+      return _c.stats.connected ? static_cast<double>(QueuedBytes(_c.fd)) :
+        0.0;
+    },
+    [](const Connection &_c)
+    {
+      return static_cast<double>(_c.stats.disconnects);
+    },
+    [](const Connection &_c) {return static_cast<double>(_c.stats.reconnects);}
+  };
+
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  const MetricLabels labels = this->Labels(_endpoint);
+  for (std::size_t i = 0; i < sizeof(kGauges) / sizeof(kGauges[0]); ++i)
+  {
+    const Field field = fields[i];
+    registry.AddGaugeCallback(kGauges[i].name, kGauges[i].help, labels,
+      [this, _endpoint, field]{return this->Sample(_endpoint, field);});
+  }
+}
+
+//////////////////////////////////////////////////
+void ConnectionMonitor::RemoveGauges(const std::string &_endpoint)
+{
+  if (!this->metrics)
+    return;
+
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  const MetricLabels labels = this->Labels(_endpoint);
+  for (const ConnectionGauge &gauge : kGauges)
+    registry.RemoveGaugeCallback(gauge.name, labels);
+}
+
+//////////////////////////////////////////////////
+MetricLabels ConnectionMonitor::Labels(const std::string &_endpoint) const
+{
+  return {{"socket", this->socket}, {"endpoint", _endpoint}};
+}
+
+//////////////////////////////////////////////////
+double ConnectionMonitor::Sample(const std::string &_endpoint,
+    double (*_field)(const Connection &)) const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  auto it = this->connections.find(_endpoint);
+  if (it == this->connections.end())
+    return 0;
+  return _field(it->second);
+}
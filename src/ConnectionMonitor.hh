@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_CONNECTIONMONITOR_HH_
+#define IGN_TRANSPORT_CONNECTIONMONITOR_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/ConnectionStatistics.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/MetricsRegistry.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class ConnectionMonitor ConnectionMonitor.hh
+    /// \brief Statistics of the connections of a socket, updated with the
+    /// events of its zmq socket monitor. The events of a socket accepting
+    /// connections carry its own endpoint, so its peers are named after the
+    /// remote address of the file descriptor of the connection.
+    class IGNITION_TRANSPORT_VISIBLE ConnectionMonitor
+    {
+      /// \brief Maximum number of connections kept once they're down. The
+      /// oldest ones are forgotten first, e.g. the remote subscribers that
+      /// left, which reconnect from another port.
+      public: static constexpr std::size_t kMaxDisconnected = 100;
+
+      /// \brief Constructor.
+      /// \param[in] _socket Name of the socket, see
+      /// ConnectionStatistics::socket.
+      /// \param[in] _metrics Whether the connections are exported as
+      /// gauges of MetricsRegistry::Instance(), labeled with the socket and
+      /// the endpoint.
+      public: ConnectionMonitor(const std::string &_socket,
+                                const bool _metrics);
+
+      /// \brief Destructor. Removes the gauges.
+      public: ~ConnectionMonitor();
+
+      /// \brief Update the statistics with an event of the socket monitor.
+      /// \param[in] _event The ZMQ_EVENT_* value.
+      /// \param[in] _value The value of the event, the file descriptor of
+      /// the connection for its connection and disconnection events.
+      /// \param[in] _address The endpoint of the event.
+      public: void OnEvent(const uint16_t _event, const int64_t _value,
+                           const std::string &_address);
+
+      /// \brief Get the statistics of the connections.
+      /// \return The statistics, sorted by endpoint.
+      public: std::vector<ConnectionStatistics> Stats() const;
+
+      /// \brief Get the bytes waiting in the send queue of a socket.
+      /// \param[in] _fd File descriptor of the socket.
+      /// \return The number of bytes, or -1 if unknown.
+      public: static int64_t QueuedBytes(const int64_t _fd);
+
+      /// \brief Get the address of the peer of a TCP socket.
+      /// \param[in] _fd File descriptor of the socket.
+      /// \return The address, e.g. "tcp://10.0.0.2:41234", or empty if
+      /// unknown.
+      public: static std::string PeerEndpoint(const int64_t _fd);
+
+      /// \brief A connection.
+      private: struct Connection
+               {
+                 /// \brief The statistics.
+                 public: ConnectionStatistics stats;
+
+                 /// \brief File descriptor while connected, -1 otherwise.
+                 public: int64_t fd = -1;
+               };
+
+      /// \brief Get the connection of an endpoint, created on first use.
+      /// Must be called with the mutex locked.
+      /// \param[in] _endpoint The endpoint.
+      /// \return The connection.
+      private: Connection &ConnectionOf(const std::string &_endpoint);
+
+      /// \brief Mark a connection as down, and forget the oldest of the
+      /// ones that are down when there are too many. Must be called with
+      /// the mutex locked.
+      /// \param[in] _endpoint Endpoint of the connection.
+      private: void Disconnected(const std::string &_endpoint);
+
+      /// \brief Register the gauges of a connection.
+      /// \param[in] _endpoint Endpoint of the connection.
+      private: void AddGauges(const std::string &_endpoint);
+
+      /// \brief Remove the gauges of a connection.
+      /// \param[in] _endpoint Endpoint of the connection.
+      private: void RemoveGauges(const std::string &_endpoint);
+
+      /// \brief Labels of the gauges of a connection.
+      /// \param[in] _endpoint Endpoint of the connection.
+      /// \return The labels.
+      private: MetricLabels Labels(const std::string &_endpoint) const;
+
+      /// \brief Sample a statistic of a connection for a gauge.
+      /// \param[in] _endpoint Endpoint of the connection.
+      /// \param[in] _field The statistic.
+      /// \return Its value, zero if the connection is gone.
+      private: double Sample(const std::string &_endpoint,
+                             double (*_field)(const Connection &)) const;
+
+      /// \brief Name of the socket.
+      private: const std::string socket;
+
+      /// \brief Whether the gauges are registered.
+      private: const bool metrics;
+
+      /// \brief Protects the members below.
+      private: mutable std::mutex mutex;
+
+      /// \brief Connections by endpoint.
+      private: std::map<std::string, Connection> connections;
+
+      /// \brief Endpoints of the connections by file descriptor, while
+      /// they're up.
+      private: std::map<int64_t, std::string> endpoints;
+
+      /// \brief Endpoints of the connections that are down, oldest first.
+      private: std::deque<std::string> disconnected;
+    };
+    }
+  }
+}
+#endif
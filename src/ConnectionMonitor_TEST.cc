@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <zmq.hpp>
+
+#include <string>
+#include <vector>
+
+#include "ignition/transport/MetricsRegistry.hh"
+#include "ConnectionMonitor.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Check the connections to the remote publishers.
+TEST(ConnectionMonitorTest, Connect)
+{
+  transport::ConnectionMonitor monitor("subscriber", false);
+  EXPECT_TRUE(monitor.Stats().empty());
+
+  const std::string endpoint = "tcp://10.0.0.2:5555";
+  monitor.OnEvent(ZMQ_EVENT_CONNECT_DELAYED, 0, endpoint);
+  monitor.OnEvent(ZMQ_EVENT_CONNECT_RETRIED, 100, endpoint);
+  monitor.OnEvent(ZMQ_EVENT_CONNECTED, -1, endpoint);
+
+  std::vector<transport::ConnectionStatistics> stats = monitor.Stats();
+  ASSERT_EQ(1u, stats.size());
+  EXPECT_EQ("subscriber", stats[0].socket);
+  EXPECT_EQ(endpoint, stats[0].endpoint);
+  EXPECT_TRUE(stats[0].connected);
+  EXPECT_EQ(1u, stats[0].connects);
+  EXPECT_EQ(1u, stats[0].connectRetries);
+  EXPECT_EQ(0u, stats[0].reconnects);
+  EXPECT_EQ(-1, stats[0].queuedBytes);
+
+  // The connection is up again after it was lost.
+  monitor.OnEvent(ZMQ_EVENT_DISCONNECTED, -1, endpoint);
+  stats = monitor.Stats();
+  ASSERT_EQ(1u, stats.size());
+  EXPECT_FALSE(stats[0].connected);
+  EXPECT_EQ(1u, stats[0].disconnects);
+
+  monitor.OnEvent(ZMQ_EVENT_CONNECTED, -1, endpoint);
+  stats = monitor.Stats();
+  ASSERT_EQ(1u, stats.size());
+  EXPECT_TRUE(stats[0].connected);
+  EXPECT_EQ(2u, stats[0].connects);
+  EXPECT_EQ(1u, stats[0].reconnects);
+
+#ifdef ZMQ_EVENT_HANDSHAKE_FAILED_AUTH
+  monitor.OnEvent(ZMQ_EVENT_HANDSHAKE_FAILED_AUTH, 0, endpoint);
+  EXPECT_EQ(1u, monitor.Stats()[0].handshakeFailures);
+#endif
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the connections of the remote subscribers, named after
+/// their file descriptor when the peer is unknown.
+TEST(ConnectionMonitorTest, Accept)
+{
+  transport::ConnectionMonitor monitor("publisher", false);
+  const std::string bound = "tcp://10.0.0.1:4444";
+  monitor.OnEvent(ZMQ_EVENT_LISTENING, 3, bound);
+  monitor.OnEvent(ZMQ_EVENT_ACCEPTED, 1000, bound);
+  monitor.OnEvent(ZMQ_EVENT_ACCEPTED, 1001, bound);
+
+  std::vector<transport::ConnectionStatistics> stats = monitor.Stats();
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_EQ(bound + "#1000", stats[0].endpoint);
+  EXPECT_EQ(bound + "#1001", stats[1].endpoint);
+  EXPECT_TRUE(stats[0].connected);
+  EXPECT_TRUE(stats[1].connected);
+
+  // The disconnections carry the endpoint of the socket, the connection
+  // is found by its file descriptor.
+  monitor.OnEvent(ZMQ_EVENT_DISCONNECTED, 1001, bound);
+  stats = monitor.Stats();
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_TRUE(stats[0].connected);
+  EXPECT_FALSE(stats[1].connected);
+  EXPECT_EQ(1u, stats[1].disconnects);
+
+  // Only the latest connections that are down are kept.
+  for (std::size_t i = 0;
+       i < transport::ConnectionMonitor::kMaxDisconnected; ++i)
+  {
+    const int64_t fd = 2000 + static_cast<int64_t>(i);
+    monitor.OnEvent(ZMQ_EVENT_ACCEPTED, fd, bound);
+    monitor.OnEvent(ZMQ_EVENT_DISCONNECTED, fd, bound);
+  }
+  stats = monitor.Stats();
+  ASSERT_EQ(transport::ConnectionMonitor::kMaxDisconnected + 1, stats.size());
+  EXPECT_EQ(bound + "#1000", stats[0].endpoint);
+  EXPECT_EQ(bound + "#2000", stats[1].endpoint);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the connections are exported as gauges.
+TEST(ConnectionMonitorTest, Metrics)
+{
+  transport::MetricsRegistry &registry =
+    transport::MetricsRegistry::Instance();
+  const std::string endpoint = "tcp://10.0.0.3:5555";
+  {
+    transport::ConnectionMonitor monitor("subscriber", true);
+    monitor.OnEvent(ZMQ_EVENT_CONNECTED, -1, endpoint);
+    monitor.OnEvent(ZMQ_EVENT_DISCONNECTED, -1, endpoint);
+    monitor.OnEvent(ZMQ_EVENT_CONNECTED, -1, endpoint);
+
+    const std::string metrics = registry.OpenMetrics();
+    EXPECT_NE(std::string::npos, metrics.find("ign_transport_connection_up"));
+    EXPECT_NE(std::string::npos,
+      metrics.find("ign_transport_connection_reconnects"));
+    EXPECT_NE(std::string::npos, metrics.find(endpoint));
+  }
+
+  // The gauges are removed with the monitor.
+  EXPECT_EQ(std::string::npos, registry.OpenMetrics().find(endpoint));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the statistics of unknown sockets.
+TEST(ConnectionMonitorTest, UnknownSocket)
+{
+  EXPECT_EQ(-1, transport::ConnectionMonitor::QueuedBytes(-1));
+  EXPECT_TRUE(transport::ConnectionMonitor::PeerEndpoint(-1).empty());
+}
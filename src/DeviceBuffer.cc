@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+
+#include "ignition/transport/DeviceBuffer.hh"
+#include "ignition/transport/Helpers.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+DeviceBufferHandle DeviceBufferHandle::CudaIpc(const void *_ipcHandle,
+  const std::size_t _handleSize, const uint64_t _size, const int32_t _device,
+  const uint64_t _offset)
+{
+  DeviceBufferHandle result;
+  if (!_ipcHandle || _handleSize > kMaxHandleSize)
+  {
+    std::cerr << "DeviceBufferHandle::CudaIpc(): Handle of [" << _handleSize
+              << "] bytes, at most [" << kMaxHandleSize << "] are supported"
+              << std::endl;
+    return result;
+  }
+
+  result.pid = getProcessId();
+  result.size = _size;
+  result.offset = _offset;
+  result.kind = DeviceBufferKind::CUDA_IPC;
+  result.device = _device;
+  result.handleSize = static_cast<uint32_t>(_handleSize);
+  std::memcpy(result.handle, _ipcHandle, _handleSize);
+  return result;
+}
+
+//////////////////////////////////////////////////
+DeviceBufferHandle DeviceBufferHandle::DmaBuf(const int32_t _fd,
+  const uint64_t _size, const uint64_t _offset)
+{
+  DeviceBufferHandle result;
+  result.pid = getProcessId();
+  result.size = _size;
+  result.offset = _offset;
+  result.kind = DeviceBufferKind::DMABUF;
+  result.fd = _fd;
+  return result;
+}
+
+//////////////////////////////////////////////////
+int DeviceBufferHandle::ImportDmaBuf() const
+{
+  if (this->kind != DeviceBufferKind::DMABUF || this->fd < 0)
+    return -1;
+
+#if defined(__linux__) && defined(SYS_pidfd_open) && defined(SYS_pidfd_getfd)
+  const int pidFd = static_cast<int>(syscall(SYS_pidfd_open,
+    static_cast<pid_t>(this->pid), 0));
+  if (pidFd < 0)
+    return -1;
+
+  const int result = static_cast<int>(syscall(SYS_pidfd_getfd, pidFd,
+    this->fd, 0));
+  close(pidFd);
+  return result;
+#else
+  std::cerr << "DeviceBufferHandle::ImportDmaBuf(): dma-bufs are not "
+            << "supported on this platform" << std::endl;
+  return -1;
+#endif
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "ignition/transport/DeviceBuffer.hh"
+#include "ignition/transport/Helpers.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief A type without kHostLocal.
+struct PlainMessage
+{
+  /// \brief Some data.
+  int data = 0;
+};
+
+IGN_TRANSPORT_TRIVIAL_MESSAGE(PlainMessage, "test.PlainMessage")
+
+//////////////////////////////////////////////////
+TEST(DeviceBufferTest, CudaIpc)
+{
+  char ipc[DeviceBufferHandle::kMaxHandleSize];
+  for (std::size_t i = 0; i < sizeof(ipc); ++i)
+    ipc[i] = static_cast<char>(i);
+
+  const DeviceBufferHandle handle =
+    DeviceBufferHandle::CudaIpc(ipc, sizeof(ipc), 1u << 20, 1, 256u);
+  EXPECT_EQ(DeviceBufferKind::CUDA_IPC, handle.kind);
+  EXPECT_EQ(static_cast<int64_t>(getProcessId()), handle.pid);
+  EXPECT_EQ(1u << 20, handle.size);
+  EXPECT_EQ(256u, handle.offset);
+  EXPECT_EQ(1, handle.device);
+  EXPECT_EQ(sizeof(ipc), handle.handleSize);
+
+  // The handle is sent as is.
+  using HandleSerializer = Serializer<DeviceBufferHandle>;
+  const std::size_t size = HandleSerializer::ByteSize(handle);
+  std::string data(size, '\0');
+  EXPECT_TRUE(HandleSerializer::Serialize(handle, &data[0], size));
+  DeviceBufferHandle received;
+  EXPECT_TRUE(HandleSerializer::Deserialize(data.data(), size, received));
+  EXPECT_EQ(DeviceBufferKind::CUDA_IPC, received.kind);
+  EXPECT_EQ(handle.size, received.size);
+  EXPECT_EQ(0, std::memcmp(ipc, received.handle, sizeof(ipc)));
+
+  // Larger handles aren't supported.
+  char tooBig[DeviceBufferHandle::kMaxHandleSize + 1] = {};
+  EXPECT_EQ(DeviceBufferKind::NONE,
+    DeviceBufferHandle::CudaIpc(tooBig, sizeof(tooBig), 1u, 0).kind);
+
+  // Only dma-bufs are imported.
+  EXPECT_EQ(-1, handle.ImportDmaBuf());
+}
+
+//////////////////////////////////////////////////
+TEST(DeviceBufferTest, HostLocal)
+{
+  EXPECT_TRUE(HostLocalMessage<DeviceBufferHandle>::value);
+  EXPECT_FALSE(HostLocalMessage<PlainMessage>::value);
+  EXPECT_FALSE(HostLocalMessage<int>::value);
+  EXPECT_EQ("ignition.transport.DeviceBufferHandle",
+    Serializer<DeviceBufferHandle>::TypeName());
+}
+
+#ifdef __linux__
+//////////////////////////////////////////////////
+TEST(DeviceBufferTest, DmaBuf)
+{
+  // Any file descriptor can be imported, use a pipe of this process.
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  const DeviceBufferHandle handle = DeviceBufferHandle::DmaBuf(fds[1], 4u);
+  EXPECT_EQ(DeviceBufferKind::DMABUF, handle.kind);
+  EXPECT_EQ(fds[1], handle.fd);
+  EXPECT_EQ(4u, handle.size);
+
+  const int imported = handle.ImportDmaBuf();
+  if (imported < 0)
+  {
+    close(fds[0]);
+    close(fds[1]);
+    GTEST_SKIP() << "pidfd_getfd() is not available, errno " << errno;
+  }
+
+  // Writing to the imported descriptor writes to the pipe.
+  EXPECT_NE(fds[1], imported);
+  EXPECT_EQ(4, write(imported, "data", 4));
+  char buffer[4];
+  EXPECT_EQ(4, read(fds[0], buffer, 4));
+  EXPECT_EQ(0, std::memcmp("data", buffer, 4));
+
+  close(imported);
+  close(fds[0]);
+  close(fds[1]);
+
+  // The file descriptor of an invalid handle can't be imported.
+  DeviceBufferHandle invalid = handle;
+  invalid.fd = -1;
+  EXPECT_EQ(-1, invalid.ImportDmaBuf());
+}
+#endif
@@ -36,22 +36,31 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
   /////////////////////////////////////////////////
   bool pollSockets(const std::vector<int> &_sockets, const int _timeout)
   {
-#ifdef _WIN32
-// Disable warning C4838
-#pragma warning(push)
-#pragma warning(disable: 4838)
-#endif
-    zmq::pollitem_t items[] =
+    std::vector<bool> readable;
+    return pollSockets({_sockets.at(0)}, _timeout, readable) && readable[0];
+  }
+
+  /////////////////////////////////////////////////
+  bool pollSockets(const std::vector<int> &_sockets, const int _timeout,
+    std::vector<bool> &_readable)
+  {
+    _readable.assign(_sockets.size(), false);
+
+    std::vector<zmq::pollitem_t> items;
+    items.reserve(_sockets.size());
+    for (const auto sock : _sockets)
     {
-      {0, _sockets.at(0), ZMQ_POLLIN, 0},
-    };
-#ifdef _WIN32
-#pragma warning(pop)
-#endif
+      zmq::pollitem_t item;
+      item.socket = nullptr;
+      item.fd = sock;
+      item.events = ZMQ_POLLIN;
+      item.revents = 0;
+      items.push_back(item);
+    }
 
     try
     {
-      zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
+      zmq::poll(items.data(), items.size(),
                 std::chrono::milliseconds(_timeout));
     }
     catch(...)
@@ -60,7 +69,13 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
     }
 
     // Return if we got a reply.
-    return items[0].revents & ZMQ_POLLIN;
+    bool received = false;
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+      _readable[i] = (items[i].revents & ZMQ_POLLIN) != 0;
+      received = received || _readable[i];
+    }
+    return received;
   }
 }
 }
@@ -15,11 +15,17 @@
  *
 */
 
+#include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "ignition/transport/AdvertiseOptions.hh"
@@ -164,7 +170,42 @@ TEST(DiscoveryTest, TestBasicAPI)
   EXPECT_EQ(discovery.ActivityInterval(), newActivityInterval);
   EXPECT_EQ(discovery.HeartbeatInterval(), newHeartbeatInterval);
 
+  EXPECT_FALSE(discovery.AdaptiveHeartbeat());
+  discovery.SetAdaptiveHeartbeat(true);
+  EXPECT_TRUE(discovery.AdaptiveHeartbeat());
+
   EXPECT_NE(discovery.HostAddr(), "");
+
+  // Network interfaces.
+  auto ifaces = discovery.Interfaces();
+  ASSERT_FALSE(ifaces.empty());
+  EXPECT_FALSE(discovery.SetInterfaces({"unknown_iface"}));
+  EXPECT_EQ(discovery.Interfaces(), ifaces);
+  EXPECT_TRUE(discovery.SetInterfaces({ifaces.front()}));
+  ASSERT_EQ(discovery.Interfaces().size(), 1u);
+  EXPECT_EQ(discovery.Interfaces().front(), ifaces.front());
+  EXPECT_TRUE(discovery.SetInterfaces({}));
+  EXPECT_EQ(discovery.Interfaces(), ifaces);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the reception thread is woken up on shutdown instead
+/// of waiting for its timeout.
+TEST(DiscoveryTest, TestShutdownLatency)
+{
+  std::chrono::steady_clock::time_point start;
+  {
+    MsgDiscovery discovery(pUuid1, g_ip, g_msgPort);
+    discovery.SetActivityInterval(10000);
+    discovery.SetHeartbeatInterval(10000);
+    discovery.Start();
+
+    // Let the thread go to sleep.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    start = std::chrono::steady_clock::now();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(elapsed, std::chrono::milliseconds(100));
 }
 
 //////////////////////////////////////////////////
@@ -527,6 +568,398 @@ TEST(DiscoveryTest, TestActivity)
   discovery1.TestActivity(proc2Uuid, false);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that a process backing off its heartbeats isn't forgotten
+/// by a process with a shorter silence interval.
+TEST(DiscoveryTest, TestAdaptiveHeartbeat)
+{
+  auto proc1Uuid = testing::getRandomNumber();
+  auto proc2Uuid = testing::getRandomNumber();
+  MessagePublisher publisher(g_topic, addr1, ctrl1, proc1Uuid, nUuid1, "type",
+    AdvertiseMessageOptions());
+  DiscoveryDerived<MessagePublisher> discovery1(proc1Uuid, g_ip, g_msgPort);
+  DiscoveryDerived<MessagePublisher> discovery2(proc2Uuid, g_ip, g_msgPort);
+
+  discovery1.SetHeartbeatInterval(100);
+  discovery1.SetAdaptiveHeartbeat(true);
+  discovery2.SetSilenceInterval(300);
+
+  discovery1.Start();
+  discovery2.Start();
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+
+  // The heartbeats of discovery1 back off beyond the silence interval of
+  // discovery2.
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  discovery2.TestActivity(proc1Uuid, true);
+
+  Addresses_M<MessagePublisher> addresses;
+  EXPECT_TRUE(discovery2.Publishers(g_topic, addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the discovery is initialized as soon as the peers
+/// answer the handshake, with their state, instead of after two heartbeats.
+TEST(DiscoveryTest, TestHandshake)
+{
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.Start();
+
+  MessagePublisher publisher(g_topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+
+  // Let the first heartbeats go.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  auto start = std::chrono::steady_clock::now();
+  discovery2.Start();
+  discovery2.WaitForInit();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_LT(elapsed, std::chrono::milliseconds(discovery2.HeartbeatInterval()));
+
+  Addresses_M<MessagePublisher> addresses;
+  EXPECT_TRUE(discovery2.Publishers(g_topic, addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that only the advertisements of the selected partitions are
+/// stored when the partition filter is enabled.
+TEST(DiscoveryTest, TestPartitionFilter)
+{
+  const std::string topic1 = "@/p1@/foo";
+  const std::string topic2 = "@/p2@/foo";
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  EXPECT_FALSE(discovery2.PartitionFilter());
+  discovery2.SetPartitionFilter(true);
+  EXPECT_TRUE(discovery2.PartitionFilter());
+  discovery2.AddPartition("p1");
+
+  discovery1.Start();
+  discovery2.Start();
+  discovery2.WaitForInit();
+
+  MessagePublisher publisher1(topic1, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  MessagePublisher publisher2(topic2, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher1));
+  EXPECT_TRUE(discovery1.Advertise(publisher2));
+
+  Addresses_M<MessagePublisher> addresses;
+  for (int i = 0; i < MaxIters && !discovery2.Publishers(topic1, addresses);
+       ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  }
+  EXPECT_TRUE(discovery2.Publishers(topic1, addresses));
+  EXPECT_FALSE(discovery2.Publishers(topic2, addresses));
+
+  // Discovering a topic adds its partition.
+  EXPECT_TRUE(discovery2.Discover(topic2));
+  for (int i = 0; i < MaxIters && !discovery2.Publishers(topic2, addresses);
+       ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  }
+  EXPECT_TRUE(discovery2.Publishers(topic2, addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the capabilities of a process are received with its
+/// publishers and forgotten when it leaves.
+TEST(DiscoveryTest, TestCapabilities)
+{
+  Discovery<ServicePublisher> discovery2(pUuid2, g_ip, g_srvPort);
+  discovery2.Start();
+
+  {
+    Discovery<ServicePublisher> discovery1(pUuid1, g_ip, g_srvPort);
+    EXPECT_EQ(0u, discovery1.Capabilities(pUuid1));
+    discovery1.SetCapabilities(0x5);
+    EXPECT_EQ(0x5u, discovery1.Capabilities(pUuid1));
+    discovery1.Start();
+
+    ServicePublisher srvPublisher(service, addr1, id1, pUuid1, nUuid1,
+      "reqType", "repType", AdvertiseServiceOptions());
+    EXPECT_TRUE(discovery1.Advertise(srvPublisher));
+
+    for (int i = 0; i < MaxIters && discovery2.Capabilities(pUuid1) == 0;
+         ++i)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    }
+    EXPECT_EQ(0x5u, discovery2.Capabilities(pUuid1));
+  }
+
+  // discovery1 said bye.
+  for (int i = 0; i < MaxIters && discovery2.Capabilities(pUuid1) != 0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  EXPECT_EQ(0u, discovery2.Capabilities(pUuid1));
+
+  // A process that announced no capabilities.
+  EXPECT_EQ(0u, discovery2.Capabilities(pUuid2));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a node started after an advertisement receives it in
+/// the snapshot of the remote discovery state.
+TEST(DiscoveryTest, TestSnapshot)
+{
+  reset();
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.Start();
+
+  MessagePublisher publisher(g_topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+
+  // discovery2 missed the advertisement.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.ConnectionsCb(onDiscoveryResponse);
+  discovery2.Start();
+
+  waitForCallback(MaxIters * 3, Nap, connectionExecuted);
+  EXPECT_TRUE(connectionExecuted);
+
+  // The unadvertisement is received in order, no snapshot is needed.
+  reset();
+  discovery2.DisconnectionsCb(onDisconnection);
+  EXPECT_TRUE(discovery1.Unadvertise(g_topic, nUuid1));
+  waitForCallback(MaxIters, Nap, disconnectionExecuted);
+  EXPECT_TRUE(disconnectionExecuted);
+
+  Addresses_M<MessagePublisher> addresses;
+  EXPECT_FALSE(discovery2.Publishers(g_topic, addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a snapshot with more publishers than fit in a single
+/// datagram is received.
+TEST(DiscoveryTest, TestBatchedSnapshot)
+{
+  const int kPublishers = 100;
+  std::mutex mutex;
+  std::set<std::string> topics;
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.Start();
+
+  for (int i = 0; i < kPublishers; ++i)
+  {
+    MessagePublisher publisher(g_topic + std::to_string(i), addr1, ctrl1,
+      pUuid1, nUuid1, "t", AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  // discovery2 missed the advertisements.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.ConnectionsCb([&](const MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (_publisher.PUuid() == pUuid1)
+        topics.insert(_publisher.Topic());
+    });
+  discovery2.Start();
+
+  for (int i = 0; i < MaxIters * 3; ++i)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (topics.size() == kPublishers)
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(static_cast<size_t>(kPublishers), topics.size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the remote publishers are reloaded from the cache file
+/// and expire if their process doesn't send heartbeats.
+TEST(DiscoveryTest, TestCache)
+{
+  const std::string cachePath =
+    testing::TempDir() + "discovery_cache_" + testing::getRandomNumber();
+  std::remove(cachePath.c_str());
+
+  {
+    MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+    discovery1.Start();
+
+    MessagePublisher publisher(g_topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+      AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+
+    MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+    EXPECT_TRUE(discovery2.CachePath().empty());
+    discovery2.SetCachePath(cachePath);
+    EXPECT_EQ(cachePath, discovery2.CachePath());
+    discovery2.Start();
+
+    Addresses_M<MessagePublisher> addresses;
+    for (int i = 0; i < MaxIters && !discovery2.Publishers(g_topic, addresses);
+         ++i)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    }
+    EXPECT_TRUE(discovery2.Publishers(g_topic, addresses));
+
+    // The cache is written when discovery2 is destroyed, before the
+    // publisher says goodbye.
+  }
+
+  // The publisher is known right after starting, before any heartbeat.
+  MsgDiscovery discovery3(pUuid2, g_ip, g_msgPort);
+  discovery3.SetSilenceInterval(300);
+  discovery3.SetCachePath(cachePath);
+  discovery3.Start();
+
+  Addresses_M<MessagePublisher> addresses;
+  ASSERT_TRUE(discovery3.Publishers(g_topic, addresses));
+  ASSERT_EQ(1u, addresses.count(pUuid1));
+  ASSERT_EQ(1u, addresses[pUuid1].size());
+  EXPECT_EQ(addr1, addresses[pUuid1].front().Addr());
+
+  // Its process is gone, so it expires.
+  for (int i = 0; i < MaxIters && discovery3.Publishers(g_topic, addresses);
+       ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  }
+  EXPECT_FALSE(discovery3.Publishers(g_topic, addresses));
+
+  std::remove(cachePath.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the discovery through a discovery server.
+TEST(DiscoveryTest, TestDiscoveryServer)
+{
+  reset();
+
+  const int port = 11321;
+  const std::string serverUuid = transport::Uuid().ToString();
+  MsgDiscovery server(serverUuid, g_ip, port, false, true);
+  server.Start();
+
+  setenv("IGN_DISCOVERY_SERVER", "127.0.0.1", 1);
+  std::unique_ptr<MsgDiscovery> discovery1(
+    new MsgDiscovery(pUuid1, g_ip, port));
+  MsgDiscovery discovery2(pUuid2, g_ip, port);
+
+  discovery2.ConnectionsCb(onDiscoveryResponse);
+  discovery2.DisconnectionsCb(onDisconnection);
+
+  discovery1->Start();
+  discovery2.Start();
+
+  // The server forwards the advertisement to discovery2.
+  MessagePublisher publisher(g_topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1->Advertise(publisher));
+
+  waitForCallback(MaxIters, Nap, connectionExecuted);
+  EXPECT_TRUE(connectionExecuted);
+  EXPECT_FALSE(disconnectionExecuted);
+
+  // A client joining later receives the state known by the server.
+  reset();
+  MsgDiscovery discovery3(transport::Uuid().ToString(), g_ip, port);
+  unsetenv("IGN_DISCOVERY_SERVER");
+  discovery3.ConnectionsCb(onDiscoveryResponse);
+  discovery3.Start();
+  waitForCallback(MaxIters, Nap, connectionExecuted);
+  EXPECT_TRUE(connectionExecuted);
+
+  // The server forwards the BYE message of discovery1.
+  reset();
+  discovery1.reset();
+  waitForCallback(MaxIters, Nap, disconnectionExecuted);
+  EXPECT_TRUE(disconnectionExecuted);
+
+  // discovery3 might handle the BYE message after discovery2.
+  Addresses_M<MessagePublisher> addresses;
+  for (int i = 0; i < MaxIters && discovery3.Publishers(g_topic, addresses);
+       ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  }
+  EXPECT_FALSE(discovery2.Publishers(g_topic, addresses));
+  EXPECT_FALSE(discovery3.Publishers(g_topic, addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a callback runs without any lock of the discovery: the
+/// other threads and the callback itself keep using it meanwhile.
+TEST(DiscoveryTest, TestCallbackLocking)
+{
+  reset();
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+
+  std::promise<void> running;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::atomic<bool> first{true};
+  std::atomic<bool> found{false};
+  discovery2.ConnectionsCb([&](const MessagePublisher &_publisher)
+    {
+      if (!first.exchange(false))
+        return;
+
+      Addresses_M<MessagePublisher> addresses;
+      found = discovery2.Publishers(_publisher.Topic(), addresses);
+      running.set_value();
+      released.wait();
+    });
+
+  discovery1.Start();
+  discovery2.Start();
+
+  // The reception thread initializes the discovery.
+  discovery2.WaitForInit();
+
+  MessagePublisher publisher(g_topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+  ASSERT_EQ(std::future_status::ready,
+    running.get_future().wait_for(std::chrono::seconds(5)));
+  EXPECT_TRUE(found);
+
+  // The callback is blocked while this thread uses the discovery.
+  auto queries = std::async(std::launch::async, [&]()
+    {
+      Addresses_M<MessagePublisher> addresses;
+      EXPECT_TRUE(discovery2.Publishers(g_topic, addresses));
+      std::vector<std::string> topics;
+      discovery2.TopicList(topics);
+      EXPECT_EQ(1u, topics.size());
+
+      MessagePublisher publisher2(service, addr2, ctrl2, pUuid2, nUuid2, "t",
+        AdvertiseMessageOptions());
+      EXPECT_TRUE(discovery2.Advertise(publisher2));
+
+      // The callback running is kept alive.
+      discovery2.ConnectionsCb(nullptr);
+      EXPECT_TRUE(discovery2.Discover(g_topic));
+    });
+  EXPECT_EQ(std::future_status::ready,
+    queries.wait_for(std::chrono::seconds(5)));
+
+  release.set_value();
+}
+
 //////////////////////////////////////////////////
 /// \brief Check that a wrong IGN_IP value makes HostAddr() to return 127.0.0.1
 TEST(DiscoveryTest, WrongIgnIp)
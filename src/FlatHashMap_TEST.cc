@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "ignition/transport/detail/FlatHashMap.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Hash that sends all the keys to the same slot.
+struct CollidingHash
+{
+  std::size_t operator()(const std::string &) const
+  {
+    return 0;
+  }
+};
+
+//////////////////////////////////////////////////
+/// \brief Check insertion, lookup and removal.
+TEST(FlatHashMapTest, Basic)
+{
+  FlatHashMap<std::string, int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.find("foo") == map.end());
+  EXPECT_EQ(0u, map.erase("foo"));
+
+  map["foo"] = 1;
+  map["bar"] = 2;
+  EXPECT_EQ(2u, map.size());
+  EXPECT_EQ(1, map.at("foo"));
+  EXPECT_EQ(2, map.find("bar")->second);
+  EXPECT_EQ(1u, map.count("foo"));
+  EXPECT_EQ(0u, map.count("baz"));
+
+  ++map["foo"];
+  EXPECT_EQ(2, map.at("foo"));
+
+  EXPECT_EQ(1u, map.erase("foo"));
+  EXPECT_EQ(0u, map.count("foo"));
+  EXPECT_EQ(1u, map.size());
+
+  const FlatHashMap<std::string, int> copy(map);
+  EXPECT_EQ(2, copy.at("bar"));
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the map grows and that the entries survive rehashing,
+/// including after many removals.
+TEST(FlatHashMapTest, Growth)
+{
+  FlatHashMap<std::string, int> map;
+  std::map<std::string, int> expected;
+  for (int i = 0; i < 10000; ++i)
+  {
+    map[std::to_string(i)] = i;
+    expected[std::to_string(i)] = i;
+    if (i % 3 == 0)
+    {
+      map.erase(std::to_string(i / 2));
+      expected.erase(std::to_string(i / 2));
+    }
+  }
+
+  EXPECT_EQ(expected.size(), map.size());
+  std::map<std::string, int> actual;
+  for (const auto &entry : map)
+    actual.insert(entry);
+  EXPECT_EQ(expected, actual);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the probing handles collisions and tombstones.
+TEST(FlatHashMapTest, Collisions)
+{
+  FlatHashMap<std::string, int, CollidingHash> map;
+  for (int i = 0; i < 20; ++i)
+    map[std::to_string(i)] = i;
+
+  // Removing an entry must not hide the entries probed after it.
+  EXPECT_EQ(1u, map.erase("3"));
+  for (int i = 0; i < 20; ++i)
+    EXPECT_EQ(i == 3 ? 0u : 1u, map.count(std::to_string(i)));
+
+  // The tombstone is reused.
+  map["3"] = 30;
+  EXPECT_EQ(30, map.at("3"));
+  EXPECT_EQ(20u, map.size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check erasing while iterating.
+TEST(FlatHashMapTest, EraseWhileIterating)
+{
+  FlatHashMap<int, int> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = i;
+
+  int visited = 0;
+  for (auto it = map.begin(); it != map.end();)
+  {
+    ++visited;
+    if (it->first % 2 == 0)
+      it = map.erase(it);
+    else
+      ++it;
+  }
+
+  EXPECT_EQ(100, visited);
+  EXPECT_EQ(50u, map.size());
+  for (const auto &entry : map)
+    EXPECT_EQ(1, entry.first % 2);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/Gateway.hh"
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/MessageInfo.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/Uuid.hh"
+
+#include "Compression.hh"
+#include "MessageBatch.hh"
+#include "TokenBucket.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Prefix of the topic of a link, followed by its name.
+    static const std::string kGatewayTopicPrefix = "/_ign_gateway/";
+
+    /// \brief Message type of the batches sent on a link.
+    static const std::string kGatewayMsgType = "ign_transport.GatewayBatch";
+
+    /// \brief Flag of the first byte of a batch compressed with zlib.
+    static const char kGatewayZlibFlag = 1;
+
+    /// \internal
+    /// \brief Private data for Gateway class.
+    class GatewayPrivate
+    {
+      /// \brief A message waiting to be sent.
+      public: struct Entry
+      {
+        /// \brief Topic name, without partition.
+        std::string topic;
+
+        /// \brief Message type name.
+        std::string type;
+
+        /// \brief Serialized message.
+        std::string data;
+      };
+
+      /// \brief Queue a message of a forwarded topic.
+      /// \param[in] _priority Priority of the message.
+      /// \param[in] _limit Rate limit of the topic, or null.
+      /// \param[in] _data Serialized message.
+      /// \param[in] _size Size of the message (bytes).
+      /// \param[in] _info Information about the message.
+      public: void Queue(const int _priority, TokenBucket *_limit,
+                         const char *_data, const std::size_t _size,
+                         const MessageInfo &_info);
+
+      /// \brief Send the queued messages in batches until the gateway is
+      /// destroyed.
+      public: void SendThread();
+
+      /// \brief Republish on the local side the messages of a batch
+      /// received on the link.
+      /// \param[in] _data The batch.
+      /// \param[in] _size Size of the batch (bytes).
+      public: void OnBatch(const char *_data, const std::size_t _size);
+
+      /// \brief Unique ID of the gateway, to ignore its own batches.
+      public: std::string uuid = Uuid().ToString();
+
+      /// \brief Node on the local side.
+      public: std::unique_ptr<Node> localNode;
+
+      /// \brief Node on the link.
+      public: std::unique_ptr<Node> linkNode;
+
+      /// \brief Publisher of the batches on the link.
+      public: Node::Publisher linkPub;
+
+      /// \brief Protects the members below.
+      public: std::mutex mutex;
+
+      /// \brief Notified when a batch is full or the gateway is destroyed.
+      public: std::condition_variable signal;
+
+      /// \brief Messages waiting to be sent, by decreasing priority.
+      public: std::map<int, std::deque<Entry>, std::greater<int>> queue;
+
+      /// \brief Number of messages in queue.
+      public: std::size_t queued = 0;
+
+      /// \brief Number of bytes of the messages in queue.
+      public: std::size_t queuedBytes = 0;
+
+      /// \brief Maximum delay of a message in milliseconds.
+      public: unsigned int batchDelay = 10;
+
+      /// \brief Maximum size of a batch (bytes).
+      public: std::size_t maxBatchSize = 1024 * 1024;
+
+      /// \brief Maximum number of messages in queue.
+      public: std::size_t capacity = 10000;
+
+      /// \brief Whether the batches are compressed.
+      public: bool compression = false;
+
+      /// \brief Whether the gateway is being destroyed.
+      public: bool exit = false;
+
+      /// \brief Thread sending the batches.
+      public: std::thread sendThread;
+
+      /// \brief Protects localPubs.
+      public: std::mutex pubsMutex;
+
+      /// \brief Publishers on the local side, by topic and type.
+      public: std::map<std::pair<std::string, std::string>, Node::Publisher>
+        localPubs;
+
+      /// \brief Number of messages sent.
+      public: std::atomic<uint64_t> sentMsgs{0};
+
+      /// \brief Number of batches sent.
+      public: std::atomic<uint64_t> sentBatches{0};
+
+      /// \brief Number of messages dropped.
+      public: std::atomic<uint64_t> droppedMsgs{0};
+
+      /// \brief Number of messages received.
+      public: std::atomic<uint64_t> receivedMsgs{0};
+    };
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void GatewayPrivate::Queue(const int _priority, TokenBucket *_limit,
+  const char *_data, const std::size_t _size, const MessageInfo &_info)
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+
+  if (_limit && !_limit->Consume())
+  {
+    ++this->droppedMsgs;
+    return;
+  }
+
+  // Make room by dropping the oldest message of the lowest priority.
+  if (this->queued >= this->capacity)
+  {
+    auto lowest = std::prev(this->queue.end());
+    if (lowest->first > _priority)
+    {
+      ++this->droppedMsgs;
+      return;
+    }
+
+    this->queuedBytes -= lowest->second.front().data.size();
+    lowest->second.pop_front();
+    if (lowest->second.empty())
+      this->queue.erase(lowest);
+    --this->queued;
+    ++this->droppedMsgs;
+  }
+
+  this->queue[_priority].push_back(
+    Entry{_info.Topic(), _info.Type(), std::string(_data, _size)});
+  ++this->queued;
+  this->queuedBytes += _size;
+
+  if (this->queuedBytes >= this->maxBatchSize)
+    this->signal.notify_one();
+}
+
+//////////////////////////////////////////////////
+void GatewayPrivate::SendThread()
+{
+  std::vector<std::string> parts;
+  std::string buffer;
+  std::string compressed;
+
+  std::unique_lock<std::mutex> lk(this->mutex);
+  while (!this->exit)
+  {
+    this->signal.wait_for(lk, std::chrono::milliseconds(this->batchDelay),
+      [this]()
+      {
+        return this->exit || this->queuedBytes >= this->maxBatchSize;
+      });
+
+    while (!this->exit && this->queued > 0)
+    {
+      // The batch starts with the ID of this gateway, followed by the
+      // topic, the type and the data of each message, by priority.
+      parts.clear();
+      parts.push_back(this->uuid);
+      std::size_t size = 0;
+      std::size_t msgs = 0;
+      while (!this->queue.empty())
+      {
+        auto &highest = this->queue.begin()->second;
+        Entry &entry = highest.front();
+        if (msgs > 0 && size + entry.data.size() > this->maxBatchSize)
+          break;
+
+        size += entry.data.size();
+        this->queuedBytes -= entry.data.size();
+        parts.push_back(std::move(entry.topic));
+        parts.push_back(std::move(entry.type));
+        parts.push_back(std::move(entry.data));
+        highest.pop_front();
+        if (highest.empty())
+          this->queue.erase(this->queue.begin());
+        --this->queued;
+        ++msgs;
+      }
+      const bool compress = this->compression;
+
+      lk.unlock();
+
+      buffer.assign(1, 0);
+      buffer.resize(1 + BatchSize(parts));
+      if (PackBatch(parts, &buffer[1]))
+      {
+        if (compress &&
+            ZlibCompress(buffer.data() + 1, buffer.size() - 1, compressed))
+        {
+          buffer.assign(1, kGatewayZlibFlag);
+          buffer.append(compressed);
+        }
+
+        if (this->linkPub.PublishRaw(buffer, kGatewayMsgType))
+        {
+          this->sentMsgs += msgs;
+          ++this->sentBatches;
+        }
+        else
+        {
+          this->droppedMsgs += msgs;
+        }
+      }
+      else
+      {
+        this->droppedMsgs += msgs;
+      }
+
+      lk.lock();
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void GatewayPrivate::OnBatch(const char *_data, const std::size_t _size)
+{
+  if (_size < 1)
+    return;
+
+  const char *data = _data + 1;
+  std::size_t size = _size - 1;
+  std::string decompressed;
+  if (_data[0] == kGatewayZlibFlag)
+  {
+    if (!ZlibDecompress(data, size, decompressed))
+    {
+      std::cerr << "Gateway: Unable to decompress a batch" << std::endl;
+      return;
+    }
+    data = decompressed.data();
+    size = decompressed.size();
+  }
+
+  std::vector<std::pair<std::size_t, std::size_t>> parts;
+  if (!UnpackBatch(data, size, parts) || parts.empty() ||
+      (parts.size() - 1) % 3 != 0)
+  {
+    std::cerr << "Gateway: Invalid batch received" << std::endl;
+    return;
+  }
+
+  auto part = [data, &parts](const std::size_t _index)
+  {
+    return std::string(data + parts[_index].first, parts[_index].second);
+  };
+
+  // Our own batches.
+  if (part(0) == this->uuid)
+    return;
+
+  std::lock_guard<std::mutex> lk(this->pubsMutex);
+  for (std::size_t i = 1; i < parts.size(); i += 3)
+  {
+    auto key = std::make_pair(part(i), part(i + 1));
+    auto pub = this->localPubs.find(key);
+    if (pub == this->localPubs.end())
+    {
+      pub = this->localPubs.emplace(key,
+        this->localNode->Advertise(key.first, key.second)).first;
+    }
+
+    if (pub->second &&
+        pub->second.PublishRaw(data + parts[i + 2].first,
+          parts[i + 2].second, key.second))
+    {
+      ++this->receivedMsgs;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+Gateway::Gateway(const std::string &_link, const NodeOptions &_localOptions,
+  const NodeOptions &_linkOptions)
+  : dataPtr(new GatewayPrivate())
+{
+  this->dataPtr->localNode = std::make_unique<Node>(_localOptions);
+  this->dataPtr->linkNode = std::make_unique<Node>(_linkOptions);
+
+  const std::string topic = kGatewayTopicPrefix + _link;
+  this->dataPtr->linkPub =
+    this->dataPtr->linkNode->Advertise(topic, kGatewayMsgType);
+  if (!this->dataPtr->linkPub)
+  {
+    std::cerr << "Gateway: Unable to advertise the link [" << topic << "]"
+              << std::endl;
+  }
+
+  GatewayPrivate *dataPtrRaw = this->dataPtr.get();
+  if (!this->dataPtr->linkNode->SubscribeRaw(topic,
+        [dataPtrRaw](const char *_data, const std::size_t _size,
+                     const MessageInfo &)
+        {
+          dataPtrRaw->OnBatch(_data, _size);
+        }, kGatewayMsgType))
+  {
+    std::cerr << "Gateway: Unable to subscribe to the link [" << topic
+              << "]" << std::endl;
+  }
+
+  this->dataPtr->sendThread = std::thread(&GatewayPrivate::SendThread,
+    this->dataPtr.get());
+  configureThread(this->dataPtr->sendThread, "ign-gateway");
+}
+
+//////////////////////////////////////////////////
+Gateway::~Gateway()
+{
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+    this->dataPtr->exit = true;
+    this->dataPtr->signal.notify_all();
+  }
+  if (this->dataPtr->sendThread.joinable())
+    this->dataPtr->sendThread.join();
+
+  // The callbacks of the nodes use the rest of the data.
+  this->dataPtr->linkNode.reset();
+  this->dataPtr->localNode.reset();
+}
+
+//////////////////////////////////////////////////
+bool Gateway::Forward(const std::string &_topic, const int _priority,
+  const uint64_t _maxRate)
+{
+  std::shared_ptr<TokenBucket> limit;
+  if (_maxRate > 0)
+    limit = std::make_shared<TokenBucket>(_maxRate, 1);
+
+  GatewayPrivate *dataPtrRaw = this->dataPtr.get();
+  auto cb = [dataPtrRaw, _priority, limit](const char *_data,
+    const std::size_t _size, const MessageInfo &_info)
+  {
+    // The link carries the topics of the other side too.
+    if (_info.Type() == kGatewayMsgType)
+      return;
+
+    dataPtrRaw->Queue(_priority, limit.get(), _data, _size, _info);
+  };
+
+  if (_topic.find('*') != std::string::npos)
+    return this->dataPtr->localNode->SubscribeRawWildcard(_topic, cb);
+  return this->dataPtr->localNode->SubscribeRaw(_topic, cb);
+}
+
+//////////////////////////////////////////////////
+void Gateway::SetBatchDelay(const unsigned int _delay)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  this->dataPtr->batchDelay = _delay;
+}
+
+//////////////////////////////////////////////////
+void Gateway::SetMaxBatchSize(const std::size_t _size)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  this->dataPtr->maxBatchSize = _size;
+}
+
+//////////////////////////////////////////////////
+void Gateway::SetQueueCapacity(const std::size_t _capacity)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  this->dataPtr->capacity = std::max<std::size_t>(1u, _capacity);
+}
+
+//////////////////////////////////////////////////
+void Gateway::SetCompression(const bool _enabled)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  this->dataPtr->compression = _enabled;
+}
+
+//////////////////////////////////////////////////
+uint64_t Gateway::SentMsgs() const
+{
+  return this->dataPtr->sentMsgs;
+}
+
+//////////////////////////////////////////////////
+uint64_t Gateway::SentBatches() const
+{
+  return this->dataPtr->sentBatches;
+}
+
+//////////////////////////////////////////////////
+uint64_t Gateway::DroppedMsgs() const
+{
+  return this->dataPtr->droppedMsgs;
+}
+
+//////////////////////////////////////////////////
+uint64_t Gateway::ReceivedMsgs() const
+{
+  return this->dataPtr->receivedMsgs;
+}
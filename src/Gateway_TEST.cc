@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/Gateway.hh"
+#include "ignition/transport/MessageInfo.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/NodeOptions.hh"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string partition; // NOLINT(*)
+
+/// \brief Callback of the Int32 messages.
+using Int32Cb = std::function<void(const msgs::Int32 &)>;
+
+//////////////////////////////////////////////////
+/// \brief Get the options of a node on one side.
+/// \param[in] _side Name of the side.
+/// \return The options.
+static transport::NodeOptions Side(const std::string &_side)
+{
+  transport::NodeOptions opts;
+  opts.SetPartition(partition + "_" + _side);
+  return opts;
+}
+
+//////////////////////////////////////////////////
+/// \brief Wait until a counter reaches a value.
+/// \param[in] _counter The counter.
+/// \param[in] _value The value.
+/// \return True if the value was reached within a few seconds.
+static bool WaitFor(const std::atomic<int> &_counter, const int _value)
+{
+  for (int i = 0; i < 300 && _counter < _value; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  return _counter >= _value;
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the topics are forwarded between two sides in batches.
+TEST(GatewayTest, Forward)
+{
+  for (const bool compression : {false, true})
+  {
+    transport::Gateway gatewayA("test", Side("siteA"), Side("link"));
+    transport::Gateway gatewayB("test", Side("siteB"), Side("link"));
+    gatewayA.SetCompression(compression);
+    gatewayA.SetBatchDelay(50);
+    EXPECT_TRUE(gatewayA.Forward("/foo"));
+    EXPECT_TRUE(gatewayA.Forward("/bar/*", 1));
+
+    transport::Node nodeA(Side("siteA"));
+    transport::Node nodeB(Side("siteB"));
+
+    std::atomic<int> foo{0};
+    std::atomic<int> bar{0};
+    Int32Cb fooCb = [&foo](const msgs::Int32 &_msg)
+      {
+        EXPECT_EQ(foo, _msg.data());
+        ++foo;
+      };
+    EXPECT_TRUE(nodeB.Subscribe("/foo", fooCb));
+    std::function<void(const msgs::StringMsg &,
+      const transport::MessageInfo &)> barCb =
+      [&bar](const msgs::StringMsg &_msg, const transport::MessageInfo &_info)
+      {
+        EXPECT_EQ("hello", _msg.data());
+        EXPECT_EQ("/bar/baz", _info.Topic());
+        EXPECT_EQ(partition + "_siteB", _info.Partition());
+        ++bar;
+      };
+    EXPECT_TRUE(nodeB.Subscribe("/bar/baz", barCb));
+
+    auto fooPub = nodeA.Advertise<msgs::Int32>("/foo");
+    auto barPub = nodeA.Advertise<msgs::StringMsg>("/bar/baz");
+    ASSERT_TRUE(fooPub);
+    ASSERT_TRUE(barPub);
+
+    // Wait for the discovery.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    msgs::StringMsg str;
+    str.set_data(std::string("hello"));
+    for (int i = 0; i < 10; ++i)
+    {
+      msgs::Int32 msg;
+      msg.set_data(i);
+      EXPECT_TRUE(fooPub.Publish(msg));
+      EXPECT_TRUE(barPub.Publish(str));
+    }
+
+    EXPECT_TRUE(WaitFor(foo, 10));
+    EXPECT_TRUE(WaitFor(bar, 10));
+    EXPECT_EQ(20u, gatewayA.SentMsgs());
+    EXPECT_EQ(20u, gatewayB.ReceivedMsgs());
+    EXPECT_EQ(0u, gatewayA.DroppedMsgs());
+
+    // The messages published together share a few batches.
+    EXPECT_GE(gatewayA.SentBatches(), 1u);
+    EXPECT_LT(gatewayA.SentBatches(), 20u);
+
+    // Nothing goes back.
+    EXPECT_EQ(0u, gatewayB.SentMsgs());
+    EXPECT_EQ(0u, gatewayA.ReceivedMsgs());
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the rate limits and the capacity of the queue drop
+/// the messages in excess, the lowest priorities first.
+TEST(GatewayTest, Drop)
+{
+  transport::Gateway gatewayA("drop", Side("siteA"), Side("link"));
+  transport::Gateway gatewayB("drop", Side("siteB"), Side("link"));
+  gatewayA.SetBatchDelay(200);
+  gatewayA.SetQueueCapacity(5);
+  EXPECT_TRUE(gatewayA.Forward("/limited", 0, 1));
+  EXPECT_TRUE(gatewayA.Forward("/low", 0));
+  EXPECT_TRUE(gatewayA.Forward("/high", 1));
+
+  transport::Node nodeA(Side("siteA"));
+  transport::Node nodeB(Side("siteB"));
+
+  std::atomic<int> limited{0};
+  std::atomic<int> low{0};
+  std::atomic<int> high{0};
+  Int32Cb limitedCb = [&limited](const msgs::Int32 &) {++limited;};
+  EXPECT_TRUE(nodeB.Subscribe("/limited", limitedCb));
+  Int32Cb lowCb = [&low](const msgs::Int32 &) {++low;};
+  EXPECT_TRUE(nodeB.Subscribe("/low", lowCb));
+  Int32Cb highCb = [&high](const msgs::Int32 &) {++high;};
+  EXPECT_TRUE(nodeB.Subscribe("/high", highCb));
+
+  auto limitedPub = nodeA.Advertise<msgs::Int32>("/limited");
+  auto lowPub = nodeA.Advertise<msgs::Int32>("/low");
+  auto highPub = nodeA.Advertise<msgs::Int32>("/high");
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  // One message per second at most.
+  msgs::Int32 msg;
+  for (int i = 0; i < 3; ++i)
+    EXPECT_TRUE(limitedPub.Publish(msg));
+  EXPECT_TRUE(WaitFor(limited, 1));
+  EXPECT_EQ(2u, gatewayA.DroppedMsgs());
+
+  // The messages of high priority replace the others in a full queue.
+  for (int i = 0; i < 5; ++i)
+    EXPECT_TRUE(lowPub.Publish(msg));
+  for (int i = 0; i < 5; ++i)
+    EXPECT_TRUE(highPub.Publish(msg));
+
+  EXPECT_TRUE(WaitFor(high, 5));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_EQ(1, limited);
+  EXPECT_EQ(7u, gatewayA.DroppedMsgs() + static_cast<uint64_t>(low));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -16,14 +16,22 @@
 */
 
 #include <cstdlib>
+#include <iostream>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <time.h>
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "ignition/transport/Helpers.hh"
 
 namespace ignition
@@ -75,6 +83,209 @@ namespace ignition
       return ::getpid();
 #endif
     }
+
+    //////////////////////////////////////////////////
+    int64_t threadCpuTime()
+    {
+#ifdef _WIN32
+      FILETIME creation, exit, kernel, user;
+      if (!::GetThreadTimes(::GetCurrentThread(), &creation, &exit, &kernel,
+            &user))
+      {
+        return 0;
+      }
+      // The times are in units of 100 ns.
+      ULARGE_INTEGER k, u;
+      k.LowPart = kernel.dwLowDateTime;
+      k.HighPart = kernel.dwHighDateTime;
+      u.LowPart = user.dwLowDateTime;
+      u.HighPart = user.dwHighDateTime;
+      return static_cast<int64_t>(k.QuadPart + u.QuadPart) * 100;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+      timespec ts;
+      if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+      return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+      return 0;
+#endif
+    }
+
+    //////////////////////////////////////////////////
+    bool parseCpus(const std::string &_list, std::vector<int> &_cpus)
+    {
+      _cpus.clear();
+      try
+      {
+        for (const std::string &item : split(_list, ','))
+        {
+          const auto dash = item.find('-');
+          const int first = std::stoi(item.substr(0, dash));
+          const int last = dash == std::string::npos ?
+            first : std::stoi(item.substr(dash + 1));
+          for (int cpu = first; cpu >= 0 && cpu <= last; ++cpu)
+            _cpus.push_back(cpu);
+        }
+      }
+      catch (...)
+      {
+        _cpus.clear();
+        return false;
+      }
+      return true;
+    }
+
+    /// \brief Settings of the threads created by Ignition Transport.
+    struct ThreadSettings
+    {
+      /// \brief CPUs the threads may run on, empty for any CPU.
+      std::vector<int> cpus;
+
+      /// \brief SCHED_FIFO priority of the threads, 0 for the default
+      /// scheduling policy.
+      int priority = 0;
+    };
+
+    //////////////////////////////////////////////////
+    /// \brief Read the thread settings from the environment, once.
+    /// \return The settings.
+    static const ThreadSettings &threadSettings()
+    {
+      static const ThreadSettings settings = []()
+      {
+        ThreadSettings result;
+
+        // A list of CPUs and ranges, e.g. "2,4-7".
+        std::string cpus;
+        if (env("IGN_TRANSPORT_THREAD_AFFINITY", cpus) && !cpus.empty() &&
+            !parseCpus(cpus, result.cpus))
+        {
+          std::cerr << "Unable to parse IGN_TRANSPORT_THREAD_AFFINITY ["
+                    << cpus << "]. Using any CPU instead." << std::endl;
+          result.cpus.clear();
+        }
+
+        std::string priority;
+        if (env("IGN_TRANSPORT_THREAD_PRIORITY", priority) &&
+            !priority.empty())
+        {
+          try
+          {
+            result.priority = std::stoi(priority);
+          }
+          catch (...)
+          {
+            std::cerr << "Unable to parse IGN_TRANSPORT_THREAD_PRIORITY ["
+                      << priority << "]. Using the default scheduling "
+                      << "policy instead." << std::endl;
+          }
+        }
+        return result;
+      }();
+      return settings;
+    }
+
+    //////////////////////////////////////////////////
+    void configureThread(std::thread &_thread, const std::string &_name)
+    {
+#ifdef __linux__
+      const ThreadSettings &settings = threadSettings();
+      const pthread_t handle = _thread.native_handle();
+
+      pthread_setname_np(handle, _name.substr(0, 15).c_str());
+
+      if (!settings.cpus.empty())
+      {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : settings.cpus)
+        {
+          if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+        }
+        if (pthread_setaffinity_np(handle, sizeof(set), &set) != 0)
+        {
+          std::cerr << "Unable to set the CPU affinity of thread [" << _name
+                    << "]" << std::endl;
+        }
+      }
+
+      if (settings.priority > 0)
+      {
+        sched_param param;
+        param.sched_priority = settings.priority;
+        if (pthread_setschedparam(handle, SCHED_FIFO, &param) != 0)
+        {
+          std::cerr << "Unable to set the SCHED_FIFO priority ["
+                    << settings.priority << "] of thread [" << _name
+                    << "]. Is the process allowed to?" << std::endl;
+        }
+      }
+#else
+      static_cast<void>(_thread);
+      static_cast<void>(_name);
+#endif
+    }
+
+    //////////////////////////////////////////////////
+    void pinThread(std::thread &_thread, const int _cpu,
+        const std::string &_name)
+    {
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if (_cpu >= 0 && _cpu < CPU_SETSIZE)
+        CPU_SET(_cpu, &set);
+      if (pthread_setaffinity_np(_thread.native_handle(), sizeof(set),
+            &set) != 0)
+      {
+        std::cerr << "Unable to pin thread [" << _name << "] to CPU ["
+                  << _cpu << "]" << std::endl;
+      }
+#else
+      static_cast<void>(_thread);
+      static_cast<void>(_cpu);
+      static_cast<void>(_name);
+#endif
+    }
+
+    //////////////////////////////////////////////////
+    void cpuRelax()
+    {
+#if defined(_MSC_VER)
+      YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      __asm__ __volatile__("yield");
+#endif
+    }
+
+    //////////////////////////////////////////////////
+    void configureThreads(zmq::context_t &_context)
+    {
+#ifdef IGN_CPPZMQ_POST_4_7_0
+      void *handle = _context.handle();
+#else
+      void *handle = static_cast<void *>(_context);
+#endif
+      const ThreadSettings &settings = threadSettings();
+      static_cast<void>(handle);
+      static_cast<void>(settings);
+
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+      for (int cpu : settings.cpus)
+        zmq_ctx_set(handle, ZMQ_THREAD_AFFINITY_CPU_ADD, cpu);
+#endif
+#if defined(ZMQ_THREAD_SCHED_POLICY) && defined(ZMQ_THREAD_PRIORITY) && \
+    defined(__linux__)
+      if (settings.priority > 0)
+      {
+        zmq_ctx_set(handle, ZMQ_THREAD_SCHED_POLICY, SCHED_FIFO);
+        zmq_ctx_set(handle, ZMQ_THREAD_PRIORITY, settings.priority);
+      }
+#endif
+    }
     }
   }
 }
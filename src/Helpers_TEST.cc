@@ -87,6 +87,18 @@ TEST(HelpersTest, SplitOneDelimiterAtEnd)
   EXPECT_EQ("", pieces[1]);
 }
 
+/////////////////////////////////////////////////
+TEST(HelpersTest, ParseCpus)
+{
+  std::vector<int> cpus;
+  EXPECT_TRUE(transport::parseCpus("3", cpus));
+  EXPECT_EQ(std::vector<int>({3}), cpus);
+  EXPECT_TRUE(transport::parseCpus("2,4-6", cpus));
+  EXPECT_EQ(std::vector<int>({2, 4, 5, 6}), cpus);
+  EXPECT_FALSE(transport::parseCpus("2,x", cpus));
+  EXPECT_TRUE(cpus.empty());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
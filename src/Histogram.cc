@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "ignition/transport/Histogram.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace
+{
+  /// \brief Position of the most significant bit set.
+  /// \param[in] _value A non zero value.
+  /// \return The position, 0 for the least significant bit.
+  unsigned int MostSignificantBit(uint64_t _value)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<unsigned int>(__builtin_clzll(_value));
+#else
+    unsigned int bit = 0u;
+    while (_value >>= 1u)
+      ++bit;
+    return bit;
+#endif
+  }
+}
+
+//////////////////////////////////////////////////
+void Histogram::Record(uint64_t _value, uint64_t _count)
+{
+  if (_count == 0u)
+    return;
+
+  this->counts[BucketIndex(_value)] += _count;
+  this->count += _count;
+  this->sum += static_cast<double>(_value) * static_cast<double>(_count);
+  this->min = std::min(this->min, _value);
+  this->max = std::max(this->max, _value);
+}
+
+//////////////////////////////////////////////////
+void Histogram::Merge(const Histogram &_other)
+{
+  if (_other.count == 0u)
+    return;
+
+  for (std::size_t i = 0; i < kNumBuckets; ++i)
+    this->counts[i] += _other.counts[i];
+  this->count += _other.count;
+  this->sum += _other.sum;
+  this->min = std::min(this->min, _other.min);
+  this->max = std::max(this->max, _other.max);
+}
+
+//////////////////////////////////////////////////
+void Histogram::Reset()
+{
+  *this = Histogram();
+}
+
+//////////////////////////////////////////////////
+uint64_t Histogram::Count() const
+{
+  return this->count;
+}
+
+//////////////////////////////////////////////////
+uint64_t Histogram::Min() const
+{
+  return this->count > 0u ? this->min : 0u;
+}
+
+//////////////////////////////////////////////////
+uint64_t Histogram::Max() const
+{
+  return this->max;
+}
+
+//////////////////////////////////////////////////
+double Histogram::Mean() const
+{
+  return this->count > 0u ? this->sum / static_cast<double>(this->count) : 0;
+}
+
+//////////////////////////////////////////////////
+uint64_t Histogram::ValueAtPercentile(double _percentile) const
+{
+  if (this->count == 0u)
+    return 0u;
+
+  // Rank of the sample of the percentile, starting at 1.
+  const double percentile = std::min(std::max(_percentile, 0.0), 100.0);
+  const uint64_t rank = std::max<uint64_t>(1u, static_cast<uint64_t>(
+    std::ceil(percentile / 100.0 * static_cast<double>(this->count))));
+
+  uint64_t seen = 0u;
+  for (std::size_t i = 0; i < kNumBuckets; ++i)
+  {
+    seen += this->counts[i];
+    if (seen >= rank)
+    {
+      return std::min(std::max(BucketHighestValue(i), this->min),
+        this->max);
+    }
+  }
+  return this->max;
+}
+
+//////////////////////////////////////////////////
+std::size_t Histogram::BucketIndex(uint64_t _value)
+{
+  const uint64_t value = std::min(_value, kMaxValue);
+  if (value < (uint64_t(2) << kSubBucketBits))
+    return static_cast<std::size_t>(value);
+
+  // The values of [2^b, 2^(b+1)) share their kSubBucketBits + 1 most
+  // significant bits with the values of a bucket.
+  const unsigned int shift = MostSignificantBit(value) - kSubBucketBits;
+  return (std::size_t(shift) << kSubBucketBits) +
+    static_cast<std::size_t>(value >> shift);
+}
+
+//////////////////////////////////////////////////
+uint64_t Histogram::BucketLowestValue(std::size_t _index)
+{
+  if (_index < (std::size_t(2) << kSubBucketBits))
+    return _index;
+
+  const unsigned int shift =
+    static_cast<unsigned int>(_index >> kSubBucketBits) - 1u;
+  const uint64_t subBucket = _index - (std::size_t(shift) << kSubBucketBits);
+  return subBucket << shift;
+}
+
+//////////////////////////////////////////////////
+uint64_t Histogram::BucketHighestValue(std::size_t _index)
+{
+  if (_index < (std::size_t(2) << kSubBucketBits))
+    return _index;
+
+  const unsigned int shift =
+    static_cast<unsigned int>(_index >> kSubBucketBits) - 1u;
+  return BucketLowestValue(_index) + (uint64_t(1) << shift) - 1u;
+}
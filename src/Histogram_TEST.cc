@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "gtest/gtest.h"
+#include "ignition/transport/Histogram.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+TEST(HistogramTest, Empty)
+{
+  Histogram histogram;
+  EXPECT_EQ(0u, histogram.Count());
+  EXPECT_EQ(0u, histogram.Min());
+  EXPECT_EQ(0u, histogram.Max());
+  EXPECT_DOUBLE_EQ(0.0, histogram.Mean());
+  EXPECT_EQ(0u, histogram.ValueAtPercentile(50));
+}
+
+//////////////////////////////////////////////////
+/// \brief The buckets cover all the values, without gaps.
+TEST(HistogramTest, Buckets)
+{
+  EXPECT_EQ(0u, Histogram::BucketIndex(0));
+  EXPECT_EQ(Histogram::kNumBuckets - 1u,
+    Histogram::BucketIndex(Histogram::kMaxValue));
+  EXPECT_EQ(Histogram::kNumBuckets - 1u,
+    Histogram::BucketIndex(Histogram::kMaxValue + 1000u));
+
+  for (std::size_t i = 0; i < Histogram::kNumBuckets; ++i)
+  {
+    const uint64_t lowest = Histogram::BucketLowestValue(i);
+    const uint64_t highest = Histogram::BucketHighestValue(i);
+    EXPECT_EQ(i, Histogram::BucketIndex(lowest));
+    EXPECT_EQ(i, Histogram::BucketIndex(highest));
+    if (i > 0u)
+    {
+      EXPECT_EQ(Histogram::BucketHighestValue(i - 1u) + 1u, lowest);
+    }
+
+    // Relative error of the bucket.
+    EXPECT_LE(static_cast<double>(highest - lowest),
+      static_cast<double>(lowest) / (1u << Histogram::kSubBucketBits));
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(HistogramTest, Percentiles)
+{
+  Histogram histogram;
+  for (uint64_t i = 1; i <= 1000; ++i)
+    histogram.Record(i);
+
+  EXPECT_EQ(1000u, histogram.Count());
+  EXPECT_EQ(1u, histogram.Min());
+  EXPECT_EQ(1000u, histogram.Max());
+  EXPECT_DOUBLE_EQ(500.5, histogram.Mean());
+
+  EXPECT_EQ(1u, histogram.ValueAtPercentile(0));
+  EXPECT_EQ(1000u, histogram.ValueAtPercentile(100));
+  EXPECT_NEAR(500.0, histogram.ValueAtPercentile(50), 500.0 / 32);
+  EXPECT_NEAR(990.0, histogram.ValueAtPercentile(99), 990.0 / 32);
+  EXPECT_GE(histogram.ValueAtPercentile(99), 990u);
+
+  // A single slow sample appears in the tail only.
+  histogram.Record(1000000u);
+  EXPECT_EQ(1000000u, histogram.Max());
+  EXPECT_LE(histogram.ValueAtPercentile(99), 1000u);
+  EXPECT_EQ(1000000u, histogram.ValueAtPercentile(100));
+
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.Count());
+  EXPECT_EQ(0u, histogram.Max());
+}
+
+//////////////////////////////////////////////////
+TEST(HistogramTest, Merge)
+{
+  Histogram fast;
+  Histogram slow;
+  fast.Record(10, 90);
+  slow.Record(5000, 10);
+
+  Histogram all;
+  all.Merge(fast);
+  all.Merge(slow);
+  all.Merge(Histogram());
+
+  EXPECT_EQ(100u, all.Count());
+  EXPECT_EQ(10u, all.Min());
+  EXPECT_EQ(5000u, all.Max());
+  EXPECT_DOUBLE_EQ((10.0 * 90 + 5000.0 * 10) / 100, all.Mean());
+  EXPECT_EQ(10u, all.ValueAtPercentile(90));
+  EXPECT_NEAR(5000.0, all.ValueAtPercentile(91), 5000.0 / 32);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+  #include <sys/stat.h>
+#endif
+
+#include <string>
+
+#include "ignition/transport/Helpers.hh"
+
+#include "IpcEndpoint.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Prefix of the ipc:// endpoints.
+static const std::string kIpcPrefix = "ipc://"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+std::string transport::IpcEndpoint(const std::string &_pUuid,
+  const std::string &_socket)
+{
+#ifdef _WIN32
+  (void)_pUuid;
+  (void)_socket;
+  return "";
+#else
+  std::string dir;
+  if (!env("TMPDIR", dir) || dir.empty())
+    dir = "/tmp";
+  if (dir.back() != '/')
+    dir += '/';
+
+  return kIpcPrefix + dir + "ign-transport-" + _pUuid + "-" + _socket;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool transport::IpcEndpointExists(const std::string &_endpoint)
+{
+#ifdef _WIN32
+  (void)_endpoint;
+  return false;
+#else
+  if (_endpoint.compare(0, kIpcPrefix.size(), kIpcPrefix) != 0)
+    return false;
+
+  struct stat st;
+  return stat(_endpoint.c_str() + kIpcPrefix.size(), &st) == 0 &&
+    S_ISSOCK(st.st_mode);
+#endif
+}
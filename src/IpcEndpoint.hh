@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_IPCENDPOINT_HH_
+#define IGN_TRANSPORT_IPCENDPOINT_HH_
+
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Name of the Unix domain socket of the publisher socket.
+    static const std::string kIpcPublisherSocket = "pub";
+
+    /// \brief Name of the Unix domain socket of the service replier socket.
+    static const std::string kIpcReplierSocket = "srv";
+
+    /// \brief Get the ZeroMQ ipc:// endpoint bound by a process, in addition
+    /// to its tcp:// endpoint, for the peers running on the same host. The
+    /// path only depends on the process UUID, so the peers don't need it to
+    /// be advertised: they find it the same way as the shared memory segment
+    /// of the process, see ShmSegment::Name(). The socket is created in
+    /// TMPDIR, or /tmp if it isn't set.
+    /// \param[in] _pUuid UUID of the process.
+    /// \param[in] _socket Socket of the process, e.g. kIpcPublisherSocket.
+    /// \return The endpoint, or an empty string if the platform doesn't
+    /// support ipc:// endpoints.
+    IGNITION_TRANSPORT_VISIBLE std::string IpcEndpoint(
+      const std::string &_pUuid, const std::string &_socket);
+
+    /// \brief Check whether an ipc:// endpoint is bound on this host, i.e.
+    /// its Unix domain socket exists.
+    /// \param[in] _endpoint Endpoint returned by IpcEndpoint().
+    /// \return True if the endpoint can be connected to.
+    IGNITION_TRANSPORT_VISIBLE bool IpcEndpointExists(
+      const std::string &_endpoint);
+    }
+  }
+}
+#endif
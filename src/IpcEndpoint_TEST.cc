@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+  #include <sys/socket.h>
+  #include <sys/un.h>
+  #include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "IpcEndpoint.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the endpoints of the processes.
+TEST(IpcEndpointTest, Endpoint)
+{
+#ifdef _WIN32
+  EXPECT_TRUE(IpcEndpoint("uuid", kIpcPublisherSocket).empty());
+#else
+  const std::string pub = IpcEndpoint("uuid", kIpcPublisherSocket);
+  const std::string srv = IpcEndpoint("uuid", kIpcReplierSocket);
+  EXPECT_EQ(0u, pub.find("ipc://"));
+  EXPECT_NE(std::string::npos, pub.find("uuid"));
+  EXPECT_NE(pub, srv);
+  EXPECT_NE(pub, IpcEndpoint("other", kIpcPublisherSocket));
+  EXPECT_EQ(pub, IpcEndpoint("uuid", kIpcPublisherSocket));
+#endif
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that only the bound endpoints exist.
+TEST(IpcEndpointTest, Exists)
+{
+  EXPECT_FALSE(IpcEndpointExists(""));
+  EXPECT_FALSE(IpcEndpointExists("tcp://127.0.0.1:1234"));
+
+#ifndef _WIN32
+  const std::string endpoint =
+    IpcEndpoint("IpcEndpointTest-" + std::to_string(getpid()),
+      kIpcPublisherSocket);
+  const std::string path = endpoint.substr(6);
+  EXPECT_FALSE(IpcEndpointExists(endpoint));
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  ASSERT_LT(path.size(), sizeof(addr.sun_path));
+  memcpy(addr.sun_path, path.c_str(), path.size());
+
+  const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(sock, 0);
+  ASSERT_EQ(0, bind(sock, reinterpret_cast<sockaddr *>(&addr),
+    sizeof(addr)));
+  EXPECT_TRUE(IpcEndpointExists(endpoint));
+
+  close(sock);
+  std::remove(path.c_str());
+  EXPECT_FALSE(IpcEndpointExists(endpoint));
+#endif
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MessageBatch.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+std::size_t transport::BatchSize(const std::vector<std::string> &_msgs)
+{
+  std::size_t size = sizeof(uint32_t) * (1 + _msgs.size());
+  for (const auto &msg : _msgs)
+    size += msg.size();
+  return size;
+}
+
+//////////////////////////////////////////////////
+bool transport::PackBatch(const std::vector<std::string> &_msgs,
+  char *_buffer)
+{
+  const uint32_t kMax = std::numeric_limits<uint32_t>::max();
+  if (_msgs.empty() || _msgs.size() > kMax)
+    return false;
+
+  char *header = _buffer;
+  char *payload = _buffer + sizeof(uint32_t) * (1 + _msgs.size());
+
+  const uint32_t count = static_cast<uint32_t>(_msgs.size());
+  std::memcpy(header, &count, sizeof(count));
+  header += sizeof(count);
+
+  for (const auto &msg : _msgs)
+  {
+    if (msg.size() > kMax)
+      return false;
+
+    const uint32_t size = static_cast<uint32_t>(msg.size());
+    std::memcpy(header, &size, sizeof(size));
+    header += sizeof(size);
+
+    std::memcpy(payload, msg.data(), msg.size());
+    payload += msg.size();
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool transport::UnpackBatch(const char *_data, const std::size_t _size,
+  std::vector<std::string> &_msgs)
+{
+  _msgs.clear();
+
+  std::vector<std::pair<std::size_t, std::size_t>> offsets;
+  if (!UnpackBatch(_data, _size, offsets))
+    return false;
+
+  _msgs.reserve(offsets.size());
+  for (const auto &entry : offsets)
+    _msgs.emplace_back(_data + entry.first, entry.second);
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool transport::UnpackBatch(const char *_data, const std::size_t _size,
+  std::vector<std::pair<std::size_t, std::size_t>> &_msgs)
+{
+  _msgs.clear();
+
+  uint32_t count;
+  if (_size < sizeof(count))
+    return false;
+  std::memcpy(&count, _data, sizeof(count));
+
+  // Check the header before trusting the count.
+  std::size_t offset = sizeof(uint32_t) * (1 + static_cast<std::size_t>(count));
+  if (count == 0 || offset > _size)
+    return false;
+
+  _msgs.reserve(count);
+  const char *header = _data + sizeof(count);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    uint32_t size;
+    std::memcpy(&size, header, sizeof(size));
+    header += sizeof(size);
+
+    if (size > _size - offset)
+    {
+      _msgs.clear();
+      return false;
+    }
+
+    _msgs.emplace_back(offset, size);
+    offset += size;
+  }
+
+  if (offset != _size)
+  {
+    _msgs.clear();
+    return false;
+  }
+
+  return true;
+}
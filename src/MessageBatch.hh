@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_MESSAGEBATCH_HH_
+#define IGN_TRANSPORT_MESSAGEBATCH_HH_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Prefix of the message type frame of a publication whose data
+    /// frame contains several messages packed with PackBatch().
+    static const std::string kBatchMsgTypePrefix = "@batch@";
+
+    /// \brief Flag of the address registered by a subscriber that is able
+    /// to unpack batches of messages. The other subscribers receive the
+    /// messages of a batch one by one.
+    static const std::string kBatchAddrFlag = "?batch";
+
+    /// \brief Get the size of the buffer needed to pack several messages.
+    /// \param[in] _msgs Serialized messages.
+    /// \return Size of the packed batch (bytes).
+    IGNITION_TRANSPORT_VISIBLE std::size_t BatchSize(
+      const std::vector<std::string> &_msgs);
+
+    /// \brief Pack several serialized messages into a single buffer. The
+    /// buffer starts with the number of messages and the size of each
+    /// message as 32-bit integers, followed by the messages.
+    /// \param[in] _msgs Serialized messages.
+    /// \param[out] _buffer Buffer of at least BatchSize(_msgs) bytes.
+    /// \return True on success or false if there are no messages or a
+    /// message is too large.
+    IGNITION_TRANSPORT_VISIBLE bool PackBatch(
+      const std::vector<std::string> &_msgs, char *_buffer);
+
+    /// \brief Unpack a buffer created with PackBatch().
+    /// \param[in] _data Packed batch.
+    /// \param[in] _size Size of _data (bytes).
+    /// \param[out] _msgs Serialized messages.
+    /// \return True on success or false if _data is not a valid batch.
+    IGNITION_TRANSPORT_VISIBLE bool UnpackBatch(const char *_data,
+      const std::size_t _size, std::vector<std::string> &_msgs);
+
+    /// \brief Locate the messages of a buffer created with PackBatch(),
+    /// without copying them.
+    /// \param[in] _data Packed batch.
+    /// \param[in] _size Size of _data (bytes).
+    /// \param[out] _msgs Offset within _data and size of each message.
+    /// \return True on success or false if _data is not a valid batch.
+    IGNITION_TRANSPORT_VISIBLE bool UnpackBatch(const char *_data,
+      const std::size_t _size,
+      std::vector<std::pair<std::size_t, std::size_t>> &_msgs);
+    }
+  }
+}
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MessageBatch.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check that a batch can be packed and unpacked.
+TEST(MessageBatchTest, PackUnpack)
+{
+  std::vector<std::string> msgs = {"first", "", std::string("a\0b", 3)};
+  std::vector<char> buffer(BatchSize(msgs));
+  EXPECT_EQ(4u * 4u + 8u, buffer.size());
+  ASSERT_TRUE(PackBatch(msgs, buffer.data()));
+
+  std::vector<std::string> unpacked;
+  ASSERT_TRUE(UnpackBatch(buffer.data(), buffer.size(), unpacked));
+  EXPECT_EQ(msgs, unpacked);
+
+  // The offsets point into the buffer.
+  std::vector<std::pair<std::size_t, std::size_t>> offsets;
+  ASSERT_TRUE(UnpackBatch(buffer.data(), buffer.size(), offsets));
+  ASSERT_EQ(msgs.size(), offsets.size());
+  for (std::size_t i = 0; i < msgs.size(); ++i)
+  {
+    EXPECT_EQ(msgs[i],
+      std::string(buffer.data() + offsets[i].first, offsets[i].second));
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that invalid batches are rejected.
+TEST(MessageBatchTest, Invalid)
+{
+  std::vector<std::string> msgs;
+  std::vector<char> buffer(BatchSize(msgs));
+  EXPECT_FALSE(PackBatch(msgs, buffer.data()));
+
+  msgs = {"first", "second"};
+  buffer.resize(BatchSize(msgs));
+  ASSERT_TRUE(PackBatch(msgs, buffer.data()));
+
+  std::vector<std::string> unpacked;
+  EXPECT_FALSE(UnpackBatch(buffer.data(), 2, unpacked));
+  EXPECT_FALSE(UnpackBatch(buffer.data(), buffer.size() - 1, unpacked));
+  EXPECT_TRUE(unpacked.empty());
+
+  // Trailing bytes.
+  buffer.push_back('x');
+  EXPECT_FALSE(UnpackBatch(buffer.data(), buffer.size(), unpacked));
+
+  // A count that doesn't fit in the buffer.
+  std::string garbage(8, '\xff');
+  EXPECT_FALSE(UnpackBatch(garbage.data(), garbage.size(), unpacked));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
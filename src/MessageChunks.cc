@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <cstring>
+#include <string>
+
+#include "ignition/transport/BufferAllocator.hh"
+#include "MessageChunks.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+ChunkAssembler::ChunkAssembler(
+  const std::chrono::steady_clock::duration &_timeout,
+  const std::size_t _maxSize, const std::size_t _maxPending)
+  : timeout(_timeout),
+    maxSize(_maxSize),
+    maxPending(_maxPending)
+{
+}
+
+//////////////////////////////////////////////////
+void ChunkAssembler::SetMaxSize(const std::size_t _maxSize)
+{
+  this->maxSize = _maxSize;
+}
+
+//////////////////////////////////////////////////
+void ChunkAssembler::SetMaxPending(const std::size_t _maxPending)
+{
+  this->maxPending = _maxPending;
+}
+
+//////////////////////////////////////////////////
+bool ChunkAssembler::Add(const std::string &_source,
+  const ChunkHeader &_header, const char *_data, const std::size_t _size,
+  const std::chrono::steady_clock::time_point &_now,
+  std::shared_ptr<char> &_msg)
+{
+  _msg.reset();
+
+  // Forget the messages whose last chunks were lost.
+  for (auto sourceIt = this->partials.begin();
+       sourceIt != this->partials.end();)
+  {
+    auto &msgs = sourceIt->second;
+    for (auto it = msgs.begin(); it != msgs.end();)
+    {
+      if (_now - it->second.updated > this->timeout)
+        it = msgs.erase(it);
+      else
+        ++it;
+    }
+
+    if (msgs.empty())
+      sourceIt = this->partials.erase(sourceIt);
+    else
+      ++sourceIt;
+  }
+
+  auto &msgs = this->partials[_source];
+  auto it = msgs.find(_header.id);
+
+  // Drop the message if the chunk is invalid or out of order.
+  auto drop = [&]()
+  {
+    if (it != msgs.end())
+      msgs.erase(it);
+    if (msgs.empty())
+      this->partials.erase(_source);
+    return false;
+  };
+
+  if (_header.offset > _header.size || _size > _header.size - _header.offset)
+    return drop();
+
+  if (_header.offset == 0)
+  {
+    // The size comes from the wire, it's checked before allocating.
+    if (_header.size > this->maxSize ||
+        (it == msgs.end() && msgs.size() >= this->maxPending))
+    {
+      return drop();
+    }
+
+    Partial partial;
+    partial.size = static_cast<std::size_t>(_header.size);
+    partial.buffer = BufferAllocator::Shared(partial.size);
+    if (!partial.buffer)
+      return drop();
+    it = msgs.insert_or_assign(_header.id, std::move(partial)).first;
+  }
+  else if (it == msgs.end() ||
+           it->second.received != _header.offset ||
+           it->second.size != _header.size)
+  {
+    return drop();
+  }
+
+  Partial &partial = it->second;
+  if (_size > 0)
+    std::memcpy(partial.buffer.get() + partial.received, _data, _size);
+  partial.received += _size;
+  partial.updated = _now;
+
+  if (partial.received == partial.size)
+  {
+    _msg = partial.buffer;
+    msgs.erase(it);
+    if (msgs.empty())
+      this->partials.erase(_source);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t ChunkAssembler::Pending() const
+{
+  std::size_t pending = 0;
+  for (const auto &source : this->partials)
+    pending += source.second.size();
+  return pending;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGN_TRANSPORT_MESSAGECHUNKS_HH_
+#define IGN_TRANSPORT_MESSAGECHUNKS_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Prefix of the message type frame of a publication whose data
+    /// frame is a chunk of a larger message. A frame with a ChunkHeader
+    /// follows the message type frame.
+    static const std::string kChunkMsgTypePrefix = "@chunk@";
+
+    /// \brief Flag of the address registered by a subscriber that is able
+    /// to reassemble chunked messages.
+    static const std::string kChunkAddrFlag = "?chunk";
+
+    /// \brief Default size of the chunks of the large messages (bytes).
+    static const std::size_t kDefaultChunkSize = 1024 * 1024;
+
+    /// \brief Default maximum size of a chunked message (bytes).
+    static const std::size_t kDefaultMaxChunkedMsgSize = 256 * 1024 * 1024;
+
+    /// \brief Default maximum number of chunked messages of a source being
+    /// reassembled at the same time.
+    static const std::size_t kDefaultMaxChunkedMsgs = 8;
+
+    /// \brief Location of a chunk in its message.
+    struct ChunkHeader
+    {
+      /// \brief ID of the message, unique within the publisher process.
+      uint64_t id = 0;
+
+      /// \brief Size of the whole message (bytes).
+      uint64_t size = 0;
+
+      /// \brief Offset of the chunk in the message (bytes).
+      uint64_t offset = 0;
+    };
+
+    /// \class ChunkAssembler MessageChunks.hh
+    /// \brief Reassembles the chunked messages. The chunks of a message are
+    /// expected in order, which the publisher socket guarantees, and the
+    /// message is dropped when one of its chunks is missing. The size of a
+    /// message comes from its first chunk, so the messages larger than a
+    /// maximum size are dropped before allocating them, as well as the
+    /// messages of a source that already has too many messages being
+    /// reassembled.
+    class IGNITION_TRANSPORT_VISIBLE ChunkAssembler
+    {
+      /// \brief Constructor.
+      /// \param[in] _timeout Time after which an incomplete message is
+      /// dropped.
+      /// \param[in] _maxSize Maximum size of a message (bytes).
+      /// \param[in] _maxPending Maximum number of incomplete messages of a
+      /// source.
+      public: explicit ChunkAssembler(
+        const std::chrono::steady_clock::duration &_timeout =
+          std::chrono::seconds(10),
+        const std::size_t _maxSize = kDefaultMaxChunkedMsgSize,
+        const std::size_t _maxPending = kDefaultMaxChunkedMsgs);
+
+      /// \brief Set the maximum size of a message.
+      /// \param[in] _maxSize Maximum size of a message (bytes).
+      public: void SetMaxSize(const std::size_t _maxSize);
+
+      /// \brief Set the maximum number of incomplete messages of a source.
+      /// \param[in] _maxPending Maximum number of incomplete messages.
+      public: void SetMaxPending(const std::size_t _maxPending);
+
+      /// \brief Add a chunk.
+      /// \param[in] _source Identifies the publisher of the chunk, e.g. its
+      /// address.
+      /// \param[in] _header Location of the chunk.
+      /// \param[in] _data Content of the chunk.
+      /// \param[in] _size Size of _data (bytes).
+      /// \param[in] _now Current time.
+      /// \param[out] _msg The whole message, once its last chunk is added.
+      /// Its size is _header.size. The buffer comes from the default
+      /// BufferAllocator.
+      /// \return False if the chunk is invalid or out of order, or if its
+      /// message exceeds a limit, in which case its message is dropped.
+      public: bool Add(const std::string &_source, const ChunkHeader &_header,
+                       const char *_data, const std::size_t _size,
+                       const std::chrono::steady_clock::time_point &_now,
+                       std::shared_ptr<char> &_msg);
+
+      /// \brief Number of incomplete messages.
+      /// \return The number of messages waiting for chunks.
+      public: std::size_t Pending() const;
+
+      /// \brief A message being reassembled.
+      private: struct Partial
+               {
+                 /// \brief The message.
+                 std::shared_ptr<char> buffer;
+
+                 /// \brief Size of the message.
+                 std::size_t size = 0;
+
+                 /// \brief Number of bytes received.
+                 std::size_t received = 0;
+
+                 /// \brief Time of the latest chunk.
+                 std::chrono::steady_clock::time_point updated;
+               };
+
+      /// \brief Time after which an incomplete message is dropped.
+      private: std::chrono::steady_clock::duration timeout;
+
+      /// \brief Maximum size of a message (bytes).
+      private: std::size_t maxSize;
+
+      /// \brief Maximum number of incomplete messages of a source.
+      private: std::size_t maxPending;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Messages being reassembled, by source and ID.
+      private: std::map<std::string, std::map<uint64_t, Partial>> partials;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "MessageChunks.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check that the chunks of interleaved messages are reassembled.
+TEST(MessageChunksTest, Reassemble)
+{
+  ChunkAssembler assembler;
+  const auto now = std::chrono::steady_clock::now();
+  const std::string first = "0123456789";
+  const std::string second = "abcdef";
+  std::shared_ptr<char> msg;
+
+  ChunkHeader header;
+  header.id = 1;
+  header.size = first.size();
+  EXPECT_TRUE(assembler.Add("pub", header, first.data(), 4, now, msg));
+  EXPECT_EQ(nullptr, msg);
+
+  ChunkHeader other;
+  other.id = 2;
+  other.size = second.size();
+  EXPECT_TRUE(assembler.Add("pub", other, second.data(), 3, now, msg));
+  EXPECT_EQ(nullptr, msg);
+  EXPECT_EQ(2u, assembler.Pending());
+
+  header.offset = 4;
+  EXPECT_TRUE(assembler.Add("pub", header, first.data() + 4, 6, now, msg));
+  ASSERT_NE(nullptr, msg);
+  EXPECT_EQ(first, std::string(msg.get(), first.size()));
+
+  other.offset = 3;
+  EXPECT_TRUE(assembler.Add("pub", other, second.data() + 3, 3, now, msg));
+  ASSERT_NE(nullptr, msg);
+  EXPECT_EQ(second, std::string(msg.get(), second.size()));
+  EXPECT_EQ(0u, assembler.Pending());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the messages with missing chunks are dropped.
+TEST(MessageChunksTest, MissingChunks)
+{
+  ChunkAssembler assembler(std::chrono::seconds(1));
+  const auto now = std::chrono::steady_clock::now();
+  const std::string data = "0123456789";
+  std::shared_ptr<char> msg;
+
+  // A chunk is missing.
+  ChunkHeader header;
+  header.size = data.size();
+  EXPECT_TRUE(assembler.Add("pub", header, data.data(), 4, now, msg));
+  header.offset = 8;
+  EXPECT_FALSE(assembler.Add("pub", header, data.data() + 8, 2, now, msg));
+  EXPECT_EQ(nullptr, msg);
+  EXPECT_EQ(0u, assembler.Pending());
+
+  // The first chunk is missing.
+  header.id = 1;
+  EXPECT_FALSE(assembler.Add("pub", header, data.data() + 8, 2, now, msg));
+
+  // The chunk doesn't fit in the message.
+  header.offset = 0;
+  EXPECT_FALSE(assembler.Add("pub", header, data.data(), 11, now, msg));
+
+  // The last chunk never arrives.
+  header.id = 2;
+  EXPECT_TRUE(assembler.Add("pub", header, data.data(), 4, now, msg));
+  EXPECT_EQ(1u, assembler.Pending());
+  header.id = 3;
+  EXPECT_TRUE(assembler.Add("pub", header, data.data(), 4,
+    now + std::chrono::seconds(2), msg));
+  EXPECT_EQ(1u, assembler.Pending());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the messages exceeding the limits are dropped before
+/// they are allocated.
+TEST(MessageChunksTest, Limits)
+{
+  ChunkAssembler assembler(std::chrono::seconds(1), 10, 2);
+  const auto now = std::chrono::steady_clock::now();
+  const std::string data = "0123456789";
+  std::shared_ptr<char> msg;
+
+  // The message is too large.
+  ChunkHeader header;
+  header.size = 11;
+  EXPECT_FALSE(assembler.Add("pub", header, data.data(), 4, now, msg));
+  EXPECT_EQ(0u, assembler.Pending());
+  header.size = std::numeric_limits<uint64_t>::max();
+  EXPECT_FALSE(assembler.Add("pub", header, data.data(), 4, now, msg));
+  EXPECT_EQ(0u, assembler.Pending());
+
+  // Too many messages of the same source.
+  header.size = data.size();
+  for (uint64_t id = 0; id < 3u; ++id)
+  {
+    header.id = id;
+    EXPECT_EQ(id < 2u,
+      assembler.Add("pub", header, data.data(), 4, now, msg));
+  }
+  EXPECT_EQ(2u, assembler.Pending());
+
+  // The other sources still have room.
+  EXPECT_TRUE(assembler.Add("other", header, data.data(), 4, now, msg));
+  EXPECT_EQ(3u, assembler.Pending());
+
+  // A message completed makes room.
+  header.id = 0;
+  header.offset = 4;
+  EXPECT_TRUE(assembler.Add("pub", header, data.data() + 4, 6, now, msg));
+  ASSERT_NE(nullptr, msg);
+  EXPECT_EQ(data, std::string(msg.get(), data.size()));
+  header.id = 2;
+  header.offset = 0;
+  EXPECT_TRUE(assembler.Add("pub", header, data.data(), 4, now, msg));
+  EXPECT_EQ(3u, assembler.Pending());
+
+  // The limits can be changed.
+  assembler.SetMaxSize(20);
+  assembler.SetMaxPending(3);
+  header.id = 3;
+  header.size = 20;
+  EXPECT_TRUE(assembler.Add("pub", header, data.data(), 4, now, msg));
+  EXPECT_EQ(4u, assembler.Pending());
+}
@@ -15,6 +15,7 @@
  *
 */
 
+#include <chrono>
 #include <string>
 
 #include "ignition/transport/MessageInfo.hh"
@@ -50,6 +51,9 @@ namespace ignition
 
       /// \brief Was the message sent via intra-process?
       public: bool isIntraProcess = false;
+
+      /// \brief Time the message was received.
+      public: std::chrono::steady_clock::time_point receiveTime;
     };
     }
   }
@@ -135,3 +139,16 @@ void MessageInfo::SetIntraProcess(bool _value)
 {
   this->dataPtr->isIntraProcess = _value;
 }
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::time_point MessageInfo::ReceiveTime() const
+{
+  return this->dataPtr->receiveTime;
+}
+
+//////////////////////////////////////////////////
+void MessageInfo::SetReceiveTime(
+    const std::chrono::steady_clock::time_point &_time)
+{
+  this->dataPtr->receiveTime = _time;
+}
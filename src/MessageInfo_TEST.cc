@@ -15,6 +15,7 @@
  *
 */
 
+#include <chrono>
 #include <string>
 
 #include "ignition/transport/MessageInfo.hh"
@@ -111,6 +112,18 @@ TEST(MessageInfoTest, InterProcess)
   EXPECT_FALSE(info.IntraProcess());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check [Set]ReceiveTime().
+TEST(MessageInfoTest, ReceiveTime)
+{
+  transport::MessageInfo info;
+  EXPECT_EQ(std::chrono::steady_clock::time_point(), info.ReceiveTime());
+
+  const auto now = std::chrono::steady_clock::now();
+  info.SetReceiveTime(now);
+  EXPECT_EQ(now, info.ReceiveTime());
+}
+
 //////////////////////////////////////////////////
 /// \brief Check Copy constructor.
 TEST(MessageInfoTest, CopyConstructor)
@@ -118,6 +131,8 @@ TEST(MessageInfoTest, CopyConstructor)
   transport::MessageInfo info;
   info.SetTopicAndPartition("@/a_partition@/b_topic");
   info.SetIntraProcess(true);
+  const auto now = std::chrono::steady_clock::now();
+  info.SetReceiveTime(now);
   transport::MessageInfo infoCopy(info);
 
   EXPECT_EQ("/a_partition", info.Partition());
@@ -125,6 +140,7 @@ TEST(MessageInfoTest, CopyConstructor)
   EXPECT_EQ("/a_partition", infoCopy.Partition());
   EXPECT_EQ("/b_topic", infoCopy.Topic());
   EXPECT_TRUE(infoCopy.IntraProcess());
+  EXPECT_EQ(now, infoCopy.ReceiveTime());
 }
 
 //////////////////////////////////////////////////
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <ignition/msgs/header.pb.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ignition/transport/MessagePeek.hh"
+
+using google::protobuf::internal::WireFormatLite;
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    //////////////////////////////////////////////////
+    bool peekField(const char *_data, const std::size_t _size,
+        const int _field, ProtoMsg &_msg)
+    {
+      _msg.Clear();
+      const auto *data = reinterpret_cast<const uint8_t *>(_data);
+      google::protobuf::io::CodedInputStream in(data,
+        static_cast<int>(_size));
+      for (uint32_t tag = in.ReadTag(); tag != 0; tag = in.ReadTag())
+      {
+        if (WireFormatLite::GetTagFieldNumber(tag) != _field)
+        {
+          if (!WireFormatLite::SkipField(&in, tag))
+            return false;
+          continue;
+        }
+
+        if (WireFormatLite::GetTagWireType(tag) !=
+            WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+        {
+          return false;
+        }
+
+        uint32_t length = 0;
+        if (!in.ReadVarint32(&length) ||
+            static_cast<uint64_t>(in.CurrentPosition()) + length > _size)
+        {
+          return false;
+        }
+
+        // The field is parsed in place, and skipped by the outer stream.
+        google::protobuf::io::CodedInputStream field(
+          data + in.CurrentPosition(), static_cast<int>(length));
+        if (!_msg.MergePartialFromCodedStream(&field) ||
+            !field.ConsumedEntireMessage() ||
+            !in.Skip(static_cast<int>(length)))
+        {
+          return false;
+        }
+      }
+      return in.ConsumedEntireMessage();
+    }
+
+    //////////////////////////////////////////////////
+    bool hasHeader(const std::string &_type)
+    {
+      // The generated types don't change, so the answers are kept.
+      static std::mutex mutex;
+      static std::unordered_map<std::string, bool> known;
+
+      std::lock_guard<std::mutex> lk(mutex);
+      auto it = known.find(_type);
+      if (it != known.end())
+        return it->second;
+
+      const google::protobuf::Descriptor *descriptor =
+        google::protobuf::DescriptorPool::generated_pool()->
+          FindMessageTypeByName(_type);
+      const google::protobuf::FieldDescriptor *field =
+        descriptor ? descriptor->FindFieldByNumber(1) : nullptr;
+      const bool result = field && !field->is_repeated() &&
+        field->type() == google::protobuf::FieldDescriptor::TYPE_MESSAGE &&
+        field->message_type()->full_name() ==
+          msgs::Header::descriptor()->full_name();
+      known.emplace(_type, result);
+      return result;
+    }
+
+    //////////////////////////////////////////////////
+    bool peekHeader(const char *_data, const std::size_t _size,
+        msgs::Header &_header)
+    {
+      return peekField(_data, _size, 1, _header);
+    }
+    }
+  }
+}
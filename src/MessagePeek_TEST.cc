@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+
+#include <ignition/msgs/header.pb.h>
+#include <ignition/msgs/int32.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
+#include <ignition/msgs/time.pb.h>
+
+#include "ignition/transport/MessagePeek.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the types with a header.
+TEST(MessagePeekTest, HasHeader)
+{
+  EXPECT_TRUE(hasHeader("ignition.msgs.StringMsg"));
+  EXPECT_TRUE(hasHeader("ignition.msgs.Int32"));
+  EXPECT_FALSE(hasHeader("ignition.msgs.Time"));
+  EXPECT_FALSE(hasHeader("ignition.msgs.Header"));
+  EXPECT_FALSE(hasHeader("_unknown_"));
+
+  // The answers are kept.
+  EXPECT_TRUE(hasHeader("ignition.msgs.StringMsg"));
+  EXPECT_FALSE(hasHeader("_unknown_"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Parse the header of a message without its payload.
+TEST(MessagePeekTest, Header)
+{
+  msgs::StringMsg msg;
+  msg.mutable_header()->mutable_stamp()->set_sec(12);
+  msg.mutable_header()->mutable_stamp()->set_nsec(34);
+  auto *frame = msg.mutable_header()->add_data();
+  frame->set_key("frame_id");
+  frame->add_value("map");
+  msg.set_data(std::string(1000000, 'x'));
+  const std::string data = msg.SerializeAsString();
+
+  msgs::Header header;
+  ASSERT_TRUE(peekHeader(data.data(), data.size(), header));
+  EXPECT_EQ(12, header.stamp().sec());
+  EXPECT_EQ(34, header.stamp().nsec());
+  ASSERT_EQ(1, header.data_size());
+  EXPECT_EQ("frame_id", header.data(0).key());
+
+  // Without a header, the header is empty.
+  msgs::StringMsg noHeader;
+  noHeader.set_data("payload");
+  const std::string noHeaderData = noHeader.SerializeAsString();
+  ASSERT_TRUE(peekHeader(noHeaderData.data(), noHeaderData.size(), header));
+  EXPECT_FALSE(header.has_stamp());
+  EXPECT_EQ(0, header.data_size());
+
+  // The instances of the field are merged, like protobuf does.
+  msgs::StringMsg later;
+  later.mutable_header()->mutable_stamp()->set_sec(56);
+  const std::string merged = data + later.SerializeAsString();
+  ASSERT_TRUE(peekHeader(merged.data(), merged.size(), header));
+  EXPECT_EQ(56, header.stamp().sec());
+  EXPECT_EQ(34, header.stamp().nsec());
+  EXPECT_EQ(1, header.data_size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Parse any field of a message.
+TEST(MessagePeekTest, Field)
+{
+  msgs::Header header;
+  header.mutable_stamp()->set_sec(7);
+  const std::string data = header.SerializeAsString();
+
+  // Header.stamp is the field 1.
+  msgs::Time stamp;
+  ASSERT_TRUE(peekField(data.data(), data.size(), 1, stamp));
+  EXPECT_EQ(7, stamp.sec());
+
+  // Int32.data isn't a message.
+  msgs::Int32 msg;
+  msg.set_data(3);
+  const std::string intData = msg.SerializeAsString();
+  EXPECT_FALSE(peekField(intData.data(), intData.size(), 2, stamp));
+}
+
+//////////////////////////////////////////////////
+/// \brief Malformed messages.
+TEST(MessagePeekTest, Malformed)
+{
+  msgs::StringMsg msg;
+  msg.mutable_header()->mutable_stamp()->set_sec(12);
+  msg.set_data("payload");
+  const std::string data = msg.SerializeAsString();
+
+  // Truncated in the header.
+  msgs::Header header;
+  const std::size_t headerEnd = msg.header().ByteSizeLong() + 2;
+  for (std::size_t size = 1; size < headerEnd; ++size)
+    EXPECT_FALSE(peekHeader(data.data(), size, header)) << size;
+
+  // Cut after the header, the message is valid, not cut in the payload.
+  EXPECT_TRUE(peekHeader(data.data(), headerEnd, header));
+  EXPECT_FALSE(peekHeader(data.data(), data.size() - 1, header));
+
+  const std::string garbage(16, '\xff');
+  EXPECT_FALSE(peekHeader(garbage.data(), garbage.size(), header));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/statistic.pb.h>
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/MetricsRegistry.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace
+{
+  /// \brief Type of a metric family.
+  enum class MetricType
+  {
+    COUNTER,
+    GAUGE
+  };
+
+  /// \brief Metrics sharing the same name.
+  struct MetricFamily
+  {
+    /// \brief Description of the metrics.
+    std::string help;
+
+    /// \brief Type of the metrics.
+    MetricType type;
+
+    /// \brief Counters, by label set.
+    std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+
+    /// \brief Gauges, by label set.
+    std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+
+    /// \brief Sampled gauges, by label set.
+    std::map<std::string, std::function<double()>> callbacks;
+  };
+
+  /// \brief A sample of a metric.
+  struct MetricSample
+  {
+    /// \brief Name of the sample, with its labels.
+    std::string name;
+
+    /// \brief Type of the metric.
+    MetricType type;
+
+    /// \brief Value of the sample.
+    double value;
+  };
+
+  /// \brief Escape a label value, as required by the OpenMetrics format.
+  /// \param[in] _value The value.
+  /// \return The escaped value.
+  std::string EscapeLabelValue(const std::string &_value)
+  {
+    std::string escaped;
+    escaped.reserve(_value.size());
+    for (const char c : _value)
+    {
+      if (c == '\\')
+        escaped += "\\\\";
+      else if (c == '"')
+        escaped += "\\\"";
+      else if (c == '\n')
+        escaped += "\\n";
+      else
+        escaped += c;
+    }
+    return escaped;
+  }
+
+  /// \brief Format the value of a sample, without an exponent for the
+  /// integers.
+  /// \param[in] _value The value.
+  /// \return The formatted value.
+  std::string FormatValue(double _value)
+  {
+    if (std::isfinite(_value) && std::floor(_value) == _value &&
+        std::fabs(_value) < 9007199254740992.0)
+    {
+      return std::to_string(static_cast<int64_t>(_value));
+    }
+
+    std::ostringstream out;
+    out.precision(std::numeric_limits<double>::max_digits10);
+    out << _value;
+    return out.str();
+  }
+
+  /// \brief Render a label set, e.g. {topic="/foo"}.
+  /// \param[in] _labels The labels.
+  /// \return The label set, empty if there are no labels.
+  std::string LabelSet(const MetricLabels &_labels)
+  {
+    if (_labels.empty())
+      return "";
+
+    std::string labelSet = "{";
+    for (const auto &label : _labels)
+    {
+      if (labelSet.size() > 1)
+        labelSet += ",";
+      labelSet += label.first + "=\"" + EscapeLabelValue(label.second) + "\"";
+    }
+    return labelSet + "}";
+  }
+}
+
+class ignition::transport::MetricsRegistryPrivate
+{
+  /// \brief Get a metric family, created on first use.
+  /// \param[in] _name Name of the family.
+  /// \param[in] _help Description of the family.
+  /// \param[in] _type Type of the family.
+  /// \return The family, or nullptr if the name is already used by
+  /// another type of metric.
+  public: MetricFamily *Family(const std::string &_name,
+                               const std::string &_help, MetricType _type)
+  {
+    auto it = this->families.find(_name);
+    if (it == this->families.end())
+    {
+      it = this->families.emplace(_name, MetricFamily()).first;
+      it->second.help = _help;
+      it->second.type = _type;
+    }
+
+    if (it->second.type != _type)
+    {
+      std::cerr << "MetricsRegistry: metric [" << _name << "] already "
+                << "registered with another type" << std::endl;
+      return nullptr;
+    }
+    return &it->second;
+  }
+
+  /// \brief Sample all the metrics. The callbacks run without holding the
+  /// mutex.
+  /// \param[out] _help Description and type of each family, by name.
+  /// \param[out] _samples Samples of each family, by name.
+  public: void Sample(
+    std::map<std::string, std::pair<std::string, MetricType>> &_help,
+    std::map<std::string, std::vector<MetricSample>> &_samples) const
+  {
+    std::vector<std::pair<MetricSample, std::function<double()>>> callbacks;
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+      for (const auto &family : this->families)
+      {
+        const std::string &name = family.first;
+        const MetricFamily &metrics = family.second;
+        _help[name] = {metrics.help, metrics.type};
+        auto &samples = _samples[name];
+
+        for (const auto &counter : metrics.counters)
+        {
+          samples.push_back({name + "_total" + counter.first,
+            MetricType::COUNTER, static_cast<double>(counter.second->Value())});
+        }
+
+        for (const auto &gauge : metrics.gauges)
+        {
+          samples.push_back({name + gauge.first, MetricType::GAUGE,
+            static_cast<double>(gauge.second->Value())});
+        }
+
+        for (const auto &cb : metrics.callbacks)
+        {
+          callbacks.push_back(
+            {{name + cb.first, MetricType::GAUGE, 0.0}, cb.second});
+        }
+      }
+    }
+
+    for (auto &cb : callbacks)
+    {
+      try
+      {
+        cb.first.value = cb.second();
+      }
+      catch (...)
+      {
+        std::cerr << "Exception occurred sampling metric [" << cb.first.name
+                  << "]" << std::endl;
+        continue;
+      }
+
+      const std::string family = cb.first.name.substr(0,
+        cb.first.name.find('{'));
+      _samples[family].push_back(cb.first);
+    }
+  }
+
+  /// \brief Metrics, by name.
+  public: std::map<std::string, MetricFamily> families;
+
+  /// \brief Returned when a name is already used by another type of metric.
+  public: MetricCounter orphanCounter;
+
+  /// \brief Returned when a name is already used by another type of metric.
+  public: MetricGauge orphanGauge;
+
+  /// \brief Protects families.
+  public: mutable std::mutex mutex;
+};
+
+//////////////////////////////////////////////////
+MetricsRegistry &MetricsRegistry::Instance()
+{
+  // Never destroyed, so the threads of the library can update their
+  // metrics while the process exits.
+  static MetricsRegistry *registry = new MetricsRegistry();
+  return *registry;
+}
+
+//////////////////////////////////////////////////
+MetricsRegistry::MetricsRegistry()
+  : dataPtr(new MetricsRegistryPrivate)
+{
+}
+
+//////////////////////////////////////////////////
+MetricsRegistry::~MetricsRegistry()
+{
+}
+
+//////////////////////////////////////////////////
+MetricCounter &MetricsRegistry::Counter(const std::string &_name,
+    const std::string &_help, const MetricLabels &_labels)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  MetricFamily *family =
+    this->dataPtr->Family(_name, _help, MetricType::COUNTER);
+  if (!family)
+    return this->dataPtr->orphanCounter;
+
+  auto &counter = family->counters[LabelSet(_labels)];
+  if (!counter)
+    counter.reset(new MetricCounter());
+  return *counter;
+}
+
+//////////////////////////////////////////////////
+MetricGauge &MetricsRegistry::Gauge(const std::string &_name,
+    const std::string &_help, const MetricLabels &_labels)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  MetricFamily *family =
+    this->dataPtr->Family(_name, _help, MetricType::GAUGE);
+  if (!family)
+    return this->dataPtr->orphanGauge;
+
+  auto &gauge = family->gauges[LabelSet(_labels)];
+  if (!gauge)
+    gauge.reset(new MetricGauge());
+  return *gauge;
+}
+
+//////////////////////////////////////////////////
+bool MetricsRegistry::AddGaugeCallback(const std::string &_name,
+    const std::string &_help, const MetricLabels &_labels,
+    std::function<double()> _cb)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  MetricFamily *family =
+    this->dataPtr->Family(_name, _help, MetricType::GAUGE);
+  if (!family)
+    return false;
+
+  family->callbacks[LabelSet(_labels)] = _cb;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool MetricsRegistry::RemoveGaugeCallback(const std::string &_name,
+    const MetricLabels &_labels)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  auto it = this->dataPtr->families.find(_name);
+  if (it == this->dataPtr->families.end())
+    return false;
+
+  return it->second.callbacks.erase(LabelSet(_labels)) > 0;
+}
+
+//////////////////////////////////////////////////
+std::string MetricsRegistry::OpenMetrics() const
+{
+  std::map<std::string, std::pair<std::string, MetricType>> help;
+  std::map<std::string, std::vector<MetricSample>> samples;
+  this->dataPtr->Sample(help, samples);
+
+  std::ostringstream out;
+  for (const auto &family : samples)
+  {
+    if (family.second.empty())
+      continue;
+
+    const auto &description = help[family.first];
+    out << "# TYPE " << family.first << " "
+        << (description.second == MetricType::COUNTER ? "counter" : "gauge")
+        << "\n";
+    out << "# HELP " << family.first << " " << description.first << "\n";
+    for (const auto &sample : family.second)
+      out << sample.name << " " << FormatValue(sample.value) << "\n";
+  }
+  out << "# EOF\n";
+  return out.str();
+}
+
+//////////////////////////////////////////////////
+void MetricsRegistry::FillMessage(msgs::Metric &_msg) const
+{
+  std::map<std::string, std::pair<std::string, MetricType>> help;
+  std::map<std::string, std::vector<MetricSample>> samples;
+  this->dataPtr->Sample(help, samples);
+
+  for (const auto &family : samples)
+  {
+    for (const auto &sample : family.second)
+    {
+      msgs::Statistic *stat = _msg.add_statistics();
+      stat->set_type(sample.type == MetricType::COUNTER ?
+        msgs::Statistic::SAMPLE_COUNT : msgs::Statistic::UNINITIALIZED);
+      stat->set_name(sample.name);
+      stat->set_value(sample.value);
+    }
+  }
+}
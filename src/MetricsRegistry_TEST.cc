@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/statistic.pb.h>
+
+#include <string>
+
+#include "ignition/transport/MetricsRegistry.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the counters and gauges.
+TEST(MetricsRegistryTest, CountersAndGauges)
+{
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+
+  MetricCounter &counter = registry.Counter("test_counter", "A counter",
+    {{"topic", "/foo"}});
+  counter.Increment();
+  counter.Increment(2);
+  EXPECT_EQ(3u, counter.Value());
+
+  // Same name and labels, same counter.
+  EXPECT_EQ(&counter, &registry.Counter("test_counter", "A counter",
+    {{"topic", "/foo"}}));
+  EXPECT_NE(&counter, &registry.Counter("test_counter", "A counter",
+    {{"topic", "/bar"}}));
+
+  MetricGauge &gauge = registry.Gauge("test_gauge", "A gauge");
+  gauge.Set(5);
+  gauge.Add(-7);
+  EXPECT_EQ(-2, gauge.Value());
+
+  // A name can't be used by two types of metric.
+  MetricGauge &orphan = registry.Gauge("test_counter", "Not a counter");
+  EXPECT_NE(&gauge, &orphan);
+  EXPECT_FALSE(registry.AddGaugeCallback("test_counter", "Not a counter", {},
+    []{return 1.0;}));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the OpenMetrics export.
+TEST(MetricsRegistryTest, OpenMetrics)
+{
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+
+  registry.Counter("om_messages", "Messages",
+    {{"topic", "/a\"b"}}).Increment(1234567);
+  EXPECT_TRUE(registry.AddGaugeCallback("om_depth", "Depth",
+    {{"queue", "local"}}, []{return 0.5;}));
+
+  const std::string text = registry.OpenMetrics();
+  EXPECT_NE(std::string::npos, text.find("# TYPE om_messages counter\n"));
+  EXPECT_NE(std::string::npos, text.find("# HELP om_messages Messages\n"));
+  EXPECT_NE(std::string::npos,
+    text.find("om_messages_total{topic=\"/a\\\"b\"} 1234567\n"));
+  EXPECT_NE(std::string::npos, text.find("# TYPE om_depth gauge\n"));
+  EXPECT_NE(std::string::npos, text.find("om_depth{queue=\"local\"} 0.5\n"));
+  EXPECT_EQ(text.size() - 6, text.rfind("# EOF\n"));
+
+  EXPECT_TRUE(registry.RemoveGaugeCallback("om_depth", {{"queue", "local"}}));
+  EXPECT_FALSE(registry.RemoveGaugeCallback("om_depth", {{"queue", "local"}}));
+  EXPECT_EQ(std::string::npos,
+    registry.OpenMetrics().find("om_depth{queue=\"local\"}"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the metric message.
+TEST(MetricsRegistryTest, FillMessage)
+{
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  registry.Counter("msg_sent", "Sent").Increment(4);
+
+  msgs::Metric msg;
+  registry.FillMessage(msg);
+
+  bool found = false;
+  for (const auto &stat : msg.statistics())
+  {
+    if (stat.name() == "msg_sent_total")
+    {
+      found = true;
+      EXPECT_EQ(msgs::Statistic::SAMPLE_COUNT, stat.type());
+      EXPECT_DOUBLE_EQ(4.0, stat.value());
+    }
+  }
+  EXPECT_TRUE(found);
+}
@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_MPSCRING_HH_
+#define IGN_TRANSPORT_MPSCRING_HH_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class MpscRing MpscRing.hh
+    /// \brief A multi-producer, single-consumer FIFO queue. The values are
+    /// moved into a bounded ring of preallocated slots, producers claim a
+    /// slot with a single compare-and-swap and never take a lock. When the
+    /// ring is full, the values spill into a mutex-guarded overflow list
+    /// until the consumer catches up. The values pushed by the same thread
+    /// are popped in order.
+    ///
+    /// The number of queued values may be limited, the queue policy then
+    /// decides whether the oldest value is dropped, the new value is
+    /// dropped, or the producer blocks. The limit is approximate when
+    /// several producers push at the same time. The consumer never blocks
+    /// when it pushes onto its own queue, it exceeds the limit instead of
+    /// deadlocking.
+    ///
+    /// The consumer only sleeps when the queue is empty, and producers only
+    /// take the mutex to wake it up when it is sleeping.
+    /// \tparam T Value type, it must be move constructible.
+    template<typename T>
+    class MpscRing
+    {
+      /// \brief Constructor.
+      /// \param[in] _capacity Number of slots of the ring, rounded up to a
+      /// power of two.
+      /// \param[in] _maxSize Maximum number of queued values, 0 for no
+      /// limit. It may be larger than the capacity of the ring.
+      /// \param[in] _policy What to do when _maxSize values are queued.
+      public: explicit MpscRing(const std::size_t _capacity,
+                  const std::size_t _maxSize = 0,
+                  const QueuePolicy_t _policy = QueuePolicy_t::DROP_OLDEST)
+        : maxSize(_maxSize), policy(_policy)
+      {
+        std::size_t capacity = 2;
+        while (capacity < _capacity)
+          capacity *= 2;
+
+        this->mask = capacity - 1;
+        this->slots.reset(new Slot[capacity]);
+        for (std::size_t i = 0; i < capacity; ++i)
+          this->slots[i].sequence.store(i, std::memory_order_relaxed);
+      }
+
+      /// \brief Number of slots of the ring.
+      /// \return The number of slots.
+      public: std::size_t Capacity() const
+      {
+        return this->mask + 1;
+      }
+
+      /// \brief Number of queued values.
+      /// \return The number of values.
+      public: std::size_t Size() const
+      {
+        return this->size.load(std::memory_order_relaxed);
+      }
+
+      /// \brief Highest number of queued values so far.
+      /// \return The number of values.
+      public: std::size_t HighWaterMark() const
+      {
+        return this->highWaterMark.load(std::memory_order_relaxed);
+      }
+
+      /// \brief Number of values dropped because the queue was full.
+      /// \return The number of values dropped.
+      public: uint64_t Dropped() const
+      {
+        return this->dropped.load(std::memory_order_relaxed);
+      }
+
+      /// \brief Push a value. Safe to call from any thread.
+      /// \param[in] _value The value.
+      /// \return False if the value was dropped because the queue is closed
+      /// or because it was full and the policy is QueuePolicy_t::DROP_NEWEST.
+      public: bool Push(T &&_value)
+      {
+        if (this->closed.load(std::memory_order_acquire))
+          return false;
+
+        if (this->maxSize > 0 &&
+            this->size.load(std::memory_order_relaxed) >= this->maxSize &&
+            !this->MakeRoom())
+        {
+          return false;
+        }
+
+        this->Count(this->size.fetch_add(1, std::memory_order_relaxed) + 1);
+
+        // Once values have spilled, the next ones follow them until the
+        // consumer empties the overflow list, keeping the order.
+        if (!this->overflowing.load(std::memory_order_acquire) &&
+            this->TryPushRing(std::move(_value)))
+        {
+          // Pairs with the fence in Pop(): either the consumer sees the new
+          // value or we see that it is sleeping.
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (this->consumerWaiting.load(std::memory_order_relaxed))
+          {
+            std::lock_guard<std::mutex> lk(this->mutex);
+            this->signal.notify_one();
+          }
+          return true;
+        }
+
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->overflow.push_back(std::move(_value));
+        this->overflowing.store(true, std::memory_order_release);
+        this->signal.notify_one();
+        return true;
+      }
+
+      /// \brief Pop a value without blocking. Only the consumer thread may
+      /// call this function.
+      /// \param[out] _value The value.
+      /// \return True if a value was popped.
+      public: bool TryPop(std::optional<T> &_value)
+      {
+        if (!this->TryPopAny(_value))
+          return false;
+
+        this->size.fetch_sub(1, std::memory_order_relaxed);
+        if (this->policy == QueuePolicy_t::BLOCK)
+        {
+          // Pairs with the fence in MakeRoom().
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (this->producersWaiting.load(std::memory_order_relaxed) > 0)
+          {
+            std::lock_guard<std::mutex> lk(this->mutex);
+            this->notFull.notify_all();
+          }
+        }
+        return true;
+      }
+
+      /// \brief Pop a value, waiting until one is available or the queue is
+      /// closed. Only the consumer thread may call this function.
+      /// \param[out] _value The value.
+      /// \return True if a value was popped or false if the queue was
+      /// closed.
+      public: bool Pop(std::optional<T> &_value)
+      {
+        this->consumer.store(std::this_thread::get_id(),
+          std::memory_order_relaxed);
+
+        for (;;)
+        {
+          if (this->closed.load(std::memory_order_acquire))
+            return false;
+
+          if (this->TryPop(_value))
+            return true;
+
+          std::unique_lock<std::mutex> lk(this->mutex);
+          this->consumerWaiting.store(true, std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          this->signal.wait(lk, [this]
+          {
+            return this->Ready() ||
+              this->closed.load(std::memory_order_acquire);
+          });
+          this->consumerWaiting.store(false, std::memory_order_relaxed);
+        }
+      }
+
+      /// \brief Close the queue. Wakes up the consumer and the blocked
+      /// producers, the values still queued are not popped and the next
+      /// values pushed are dropped.
+      public: void Close()
+      {
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          this->closed.store(true, std::memory_order_release);
+        }
+        this->signal.notify_all();
+        this->notFull.notify_all();
+      }
+
+      /// \brief A slot of the ring.
+      private: struct Slot
+      {
+        /// \brief Position of the slot in the ring, plus one once a value
+        /// is stored. Producers may claim the slot when it equals the
+        /// position of the next push.
+        std::atomic<std::size_t> sequence;
+
+        /// \brief The value.
+        std::optional<T> value;
+      };
+
+      /// \brief Apply the queue policy when the queue is full.
+      /// \return False if the new value must be dropped.
+      private: bool MakeRoom()
+      {
+        switch (this->policy)
+        {
+          case QueuePolicy_t::DROP_NEWEST:
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+          case QueuePolicy_t::BLOCK:
+          {
+            // The consumer would wait for itself.
+            if (std::this_thread::get_id() ==
+                this->consumer.load(std::memory_order_relaxed))
+            {
+              return true;
+            }
+
+            std::unique_lock<std::mutex> lk(this->mutex);
+            this->producersWaiting.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            this->notFull.wait(lk, [this]
+            {
+              return this->size.load(std::memory_order_relaxed) <
+                this->maxSize || this->closed.load(std::memory_order_acquire);
+            });
+            this->producersWaiting.fetch_sub(1, std::memory_order_relaxed);
+            return !this->closed.load(std::memory_order_acquire);
+          }
+          case QueuePolicy_t::DROP_OLDEST:
+          default:
+          {
+            // The dropped value is destroyed outside of the lock.
+            std::optional<T> oldest;
+            if (this->TryPopAny(oldest))
+            {
+              this->size.fetch_sub(1, std::memory_order_relaxed);
+              this->dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            return true;
+          }
+        }
+      }
+
+      /// \brief Update the high-water mark.
+      /// \param[in] _size Number of queued values.
+      private: void Count(const std::size_t _size)
+      {
+        std::size_t mark = this->highWaterMark.load(std::memory_order_relaxed);
+        while (_size > mark && !this->highWaterMark.compare_exchange_weak(
+                 mark, _size, std::memory_order_relaxed))
+        {
+        }
+      }
+
+      /// \brief Pop the next value from the ring or the overflow list.
+      /// \param[out] _value The value.
+      /// \return True if a value was popped.
+      private: bool TryPopAny(std::optional<T> &_value)
+      {
+        if (this->TryPopRing(_value))
+          return true;
+
+        if (!this->overflowing.load(std::memory_order_acquire))
+          return false;
+
+        std::lock_guard<std::mutex> lk(this->mutex);
+        // Producers that checked the overflow flag before it was set may
+        // still have used the ring.
+        if (this->TryPopRing(_value))
+          return true;
+
+        if (this->overflow.empty())
+          return false;
+
+        _value.emplace(std::move(this->overflow.front()));
+        this->overflow.pop_front();
+        if (this->overflow.empty())
+          this->overflowing.store(false, std::memory_order_release);
+        return true;
+      }
+
+      /// \brief Move a value into the ring.
+      /// \param[in] _value The value, left untouched if the ring is full.
+      /// \return False if the ring is full.
+      private: bool TryPushRing(T &&_value)
+      {
+        std::size_t pos = this->head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+          Slot &slot = this->slots[pos & this->mask];
+          const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+          const std::intptr_t diff =
+            static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+          if (diff == 0)
+          {
+            if (this->head.compare_exchange_weak(pos, pos + 1,
+                  std::memory_order_relaxed))
+            {
+              slot.value.emplace(std::move(_value));
+              slot.sequence.store(pos + 1, std::memory_order_release);
+              return true;
+            }
+          }
+          else if (diff < 0)
+          {
+            // The consumer hasn't released the slot yet.
+            return false;
+          }
+          else
+          {
+            pos = this->head.load(std::memory_order_relaxed);
+          }
+        }
+      }
+
+      /// \brief Move the next value out of the ring. Producers dropping the
+      /// oldest value pop too, so the position is claimed with a
+      /// compare-and-swap.
+      /// \param[out] _value The value.
+      /// \return False if the ring is empty.
+      private: bool TryPopRing(std::optional<T> &_value)
+      {
+        std::size_t pos = this->tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+          Slot &slot = this->slots[pos & this->mask];
+          const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+          const std::intptr_t diff = static_cast<std::intptr_t>(seq) -
+            static_cast<std::intptr_t>(pos + 1);
+          if (diff == 0)
+          {
+            if (this->tail.compare_exchange_weak(pos, pos + 1,
+                  std::memory_order_relaxed))
+            {
+              _value.emplace(std::move(*slot.value));
+              slot.value.reset();
+              slot.sequence.store(pos + this->mask + 1,
+                std::memory_order_release);
+              return true;
+            }
+          }
+          else if (diff < 0)
+          {
+            // The slot is empty or its producer hasn't finished yet.
+            return false;
+          }
+          else
+          {
+            pos = this->tail.load(std::memory_order_relaxed);
+          }
+        }
+      }
+
+      /// \brief Whether the consumer has a value to pop.
+      /// \return True if a value is available.
+      private: bool Ready() const
+      {
+        const std::size_t pos = this->tail.load(std::memory_order_relaxed);
+        return this->overflowing.load(std::memory_order_acquire) ||
+          this->slots[pos & this->mask].sequence.load(
+            std::memory_order_acquire) == pos + 1;
+      }
+
+      /// \brief The slots.
+      private: std::unique_ptr<Slot[]> slots;
+
+      /// \brief Number of slots minus one.
+      private: std::size_t mask = 0;
+
+      /// \brief Position of the next push. On its own cache line, it's
+      /// written by all the producers.
+      private: alignas(64) std::atomic<std::size_t> head{0};
+
+      /// \brief Position of the next pop.
+      private: alignas(64) std::atomic<std::size_t> tail{0};
+
+      /// \brief Number of queued values.
+      private: std::atomic<std::size_t> size{0};
+
+      /// \brief Highest number of queued values.
+      private: std::atomic<std::size_t> highWaterMark{0};
+
+      /// \brief Number of values dropped because the queue was full.
+      private: std::atomic<uint64_t> dropped{0};
+
+      /// \brief Maximum number of queued values, 0 for no limit.
+      private: const std::size_t maxSize;
+
+      /// \brief What to do when the queue is full.
+      private: const QueuePolicy_t policy;
+
+      /// \brief The consumer thread, it never blocks on a full queue.
+      private: std::atomic<std::thread::id> consumer{};
+
+      /// \brief Number of producers blocked on a full queue.
+      private: std::atomic<int> producersWaiting{0};
+
+      /// \brief True while the overflow list has values.
+      private: std::atomic<bool> overflowing{false};
+
+      /// \brief True while the consumer is sleeping or about to sleep.
+      private: std::atomic<bool> consumerWaiting{false};
+
+      /// \brief True once the queue is closed.
+      private: std::atomic<bool> closed{false};
+
+      /// \brief Protects the overflow list and the consumer wakeup.
+      private: std::mutex mutex;
+
+      /// \brief Signaled when a value is pushed or the queue is closed.
+      private: std::condition_variable signal;
+
+      /// \brief Signaled when a blocked producer may push or the queue is
+      /// closed.
+      private: std::condition_variable notFull;
+
+      /// \brief Values pushed while the ring was full.
+      private: std::deque<T> overflow;
+    };
+    }
+  }
+}
+#endif
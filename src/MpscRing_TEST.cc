@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MpscRing.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the FIFO order, including when the ring is full.
+TEST(MpscRingTest, Order)
+{
+  MpscRing<std::unique_ptr<int>> ring(5);
+  EXPECT_EQ(8u, ring.Capacity());
+
+  std::optional<std::unique_ptr<int>> value;
+  EXPECT_FALSE(ring.TryPop(value));
+
+  // Fill the ring and spill into the overflow list, twice.
+  for (int round = 0; round < 2; ++round)
+  {
+    for (int i = 0; i < 20; ++i)
+      EXPECT_TRUE(ring.Push(std::make_unique<int>(i)));
+
+    for (int i = 0; i < 20; ++i)
+    {
+      ASSERT_TRUE(ring.TryPop(value));
+      ASSERT_NE(nullptr, *value);
+      EXPECT_EQ(i, **value);
+    }
+    EXPECT_FALSE(ring.TryPop(value));
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the values of each producer are popped in order and
+/// that none is lost.
+TEST(MpscRingTest, Producers)
+{
+  const int kProducers = 4;
+  const int kValues = 20000;
+  MpscRing<std::pair<int, int>> ring(64);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p)
+  {
+    producers.emplace_back([&ring, p]()
+    {
+      for (int i = 0; i < kValues; ++i)
+        ring.Push(std::make_pair(p, i));
+    });
+  }
+
+  std::vector<int> next(kProducers, 0);
+  std::optional<std::pair<int, int>> value;
+  for (int n = 0; n < kProducers * kValues; ++n)
+  {
+    ASSERT_TRUE(ring.Pop(value));
+    EXPECT_EQ(next[value->first], value->second);
+    next[value->first] = value->second + 1;
+  }
+
+  for (auto &producer : producers)
+    producer.join();
+
+  for (int p = 0; p < kProducers; ++p)
+    EXPECT_EQ(kValues, next[p]);
+  EXPECT_FALSE(ring.TryPop(value));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a sleeping consumer wakes up on push and on close.
+TEST(MpscRingTest, Wakeup)
+{
+  MpscRing<int> ring(4);
+  std::optional<int> value;
+
+  std::thread producer([&ring]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ring.Push(1);
+  });
+  EXPECT_TRUE(ring.Pop(value));
+  EXPECT_EQ(1, *value);
+  producer.join();
+
+  std::thread closer([&ring]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ring.Close();
+  });
+  EXPECT_FALSE(ring.Pop(value));
+  closer.join();
+
+  // Values pushed once closed are dropped.
+  EXPECT_FALSE(ring.Push(2));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the queue policies and the counters of a limited queue.
+TEST(MpscRingTest, Limit)
+{
+  std::optional<int> value;
+
+  MpscRing<int> dropOldest(4, 10, QueuePolicy_t::DROP_OLDEST);
+  for (int i = 0; i < 15; ++i)
+    EXPECT_TRUE(dropOldest.Push(std::move(i)));
+  EXPECT_EQ(10u, dropOldest.Size());
+  EXPECT_EQ(10u, dropOldest.HighWaterMark());
+  EXPECT_EQ(5u, dropOldest.Dropped());
+  for (int i = 5; i < 15; ++i)
+  {
+    ASSERT_TRUE(dropOldest.TryPop(value));
+    EXPECT_EQ(i, *value);
+  }
+  EXPECT_EQ(0u, dropOldest.Size());
+  EXPECT_EQ(10u, dropOldest.HighWaterMark());
+
+  MpscRing<int> dropNewest(4, 10, QueuePolicy_t::DROP_NEWEST);
+  for (int i = 0; i < 15; ++i)
+    EXPECT_EQ(i < 10, dropNewest.Push(std::move(i)));
+  EXPECT_EQ(10u, dropNewest.Size());
+  EXPECT_EQ(5u, dropNewest.Dropped());
+  for (int i = 0; i < 10; ++i)
+  {
+    ASSERT_TRUE(dropNewest.TryPop(value));
+    EXPECT_EQ(i, *value);
+  }
+  EXPECT_FALSE(dropNewest.TryPop(value));
+
+  // The producer waits until the consumer pops a value.
+  MpscRing<int> block(4, 2, QueuePolicy_t::BLOCK);
+  EXPECT_TRUE(block.Push(0));
+  EXPECT_TRUE(block.Push(1));
+  std::thread producer([&block]()
+  {
+    EXPECT_TRUE(block.Push(2));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(2u, block.Size());
+  for (int i = 0; i < 3; ++i)
+  {
+    ASSERT_TRUE(block.Pop(value));
+    EXPECT_EQ(i, *value);
+  }
+  producer.join();
+  EXPECT_EQ(0u, block.Dropped());
+  EXPECT_EQ(2u, block.HighWaterMark());
+
+  // The consumer doesn't wait for itself.
+  EXPECT_TRUE(block.Push(3));
+  EXPECT_TRUE(block.Push(4));
+  EXPECT_TRUE(block.Push(5));
+  EXPECT_EQ(3u, block.Size());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -18,6 +18,7 @@
 
 #ifdef _WIN32
   #include <Winsock2.h>
+  #include <Ws2tcpip.h>
   #include <iphlpapi.h>
   #include <windows.h>
   #include <Lmcons.h>
@@ -30,10 +31,15 @@
 #endif
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -61,32 +67,111 @@ namespace transport
 {
 inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
 {
+  /// \brief Default time to wait for the resolution of the hostname (ms).
+  static const int kDefaultDnsTimeout = 1000;
+
+  /// \brief Resolution of the hostname, shared with the thread resolving it.
+  struct HostResolution
+  {
+    /// \brief Protects the other members.
+    std::mutex mutex;
+
+    /// \brief Notified when the resolution is done.
+    std::condition_variable cv;
+
+    /// \brief True once the resolution is done.
+    bool done = false;
+
+    /// \brief IP address of the hostname, empty if it wasn't resolved.
+    std::string ip;
+  };
+
+  /// \brief Get the resolution of the hostname. It's started once per
+  /// process in a thread of its own, so a slow or misconfigured DNS doesn't
+  /// stall the enumeration of the interfaces, and it's cached.
+  /// \return The resolution.
+  static std::shared_ptr<HostResolution> hostResolution()
+  {
+    static std::shared_ptr<HostResolution> resolution = []()
+    {
+      auto result = std::make_shared<HostResolution>();
+      std::thread([result]()
+      {
+        char host[1024];
+        memset(host, 0, sizeof(host));
+        std::string hostIP;
+
+        // We don't want "localhost" to be our hostname.
+        if (gethostname(host, sizeof(host) - 1) == 0 && strlen(host) &&
+            strcmp("localhost", host) && hostnameToIp(host, hostIP) != 0)
+        {
+          hostIP.clear();
+        }
+
+        std::lock_guard<std::mutex> lk(result->mutex);
+        result->ip = hostIP;
+        result->done = true;
+        result->cv.notify_all();
+      }).detach();
+      return result;
+    }();
+    return resolution;
+  }
+
   /// \brief Get the preferred local IP address.
   /// Note that we don't consider private IP addresses.
   /// \param[out] _ip The preferred local IP address.
   /// \return true if a public local IP was found or false otherwise.
   static bool preferredPublicIP(std::string &_ip)
   {
-    char host[1024];
-    memset(host, 0, sizeof(host));
-    if (gethostname(host, sizeof(host) - 1) != 0)
-      return false;
+    auto resolution = hostResolution();
 
-    // We don't want "localhost" to be our hostname.
-    if (!strlen(host) || !strcmp("localhost", host))
-      return false;
+    // Get the complete list of compatible interfaces while the hostname is
+    // resolved.
+    auto interfaces = determineInterfaces();
+
+    int timeout = kDefaultDnsTimeout;
+    std::string timeoutStr;
+    if (env("IGN_TRANSPORT_DNS_TIMEOUT", timeoutStr) && !timeoutStr.empty())
+    {
+      try
+      {
+        timeout = std::max(0, std::stoi(timeoutStr));
+      }
+      catch (...)
+      {
+        std::cerr << "Unable to parse IGN_TRANSPORT_DNS_TIMEOUT ["
+                  << timeoutStr << "]. Using [" << kDefaultDnsTimeout
+                  << "] instead." << std::endl;
+      }
+    }
 
     std::string hostIP;
+    {
+      std::unique_lock<std::mutex> lk(resolution->mutex);
+      if (!resolution->cv.wait_for(lk, std::chrono::milliseconds(timeout),
+            [&resolution]{return resolution->done;}))
+      {
+        // The resolution goes on, later calls will use its result.
+        static std::once_flag warned;
+        std::call_once(warned, [timeout]()
+        {
+          std::cerr << "Unable to resolve the hostname within [" << timeout
+                    << "] ms, using the network interfaces instead"
+                    << std::endl;
+        });
+        return false;
+      }
+      hostIP = resolution->ip;
+    }
+
     const std::string kPrefix = "127.0.";
-    if ((hostnameToIp(host, hostIP) != 0) || isPrivateIP(hostIP.c_str()) ||
+    if (hostIP.empty() || isPrivateIP(hostIP.c_str()) ||
         hostIP.compare(0, kPrefix.size(), kPrefix) == 0)
     {
       return false;
     }
 
-    // Get the complete list of compatible interfaces.
-    auto interfaces = determineInterfaces();
-
     // Make sure that this interface is compatible with Discovery.
     if (std::find(interfaces.begin(), interfaces.end(), hostIP) ==
           interfaces.end())
@@ -109,23 +194,31 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
   //////////////////////////////////////////////////
   int hostnameToIp(char *_hostname, std::string &_ip)
   {
-    struct hostent *he;
-    struct in_addr **addr_list;
-    int i;
+    // Unlike gethostbyname(), getaddrinfo() is thread safe.
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
 
-    if ((he = gethostbyname(_hostname)) == nullptr)
+    struct addrinfo *addrs = nullptr;
+    if (getaddrinfo(_hostname, nullptr, &hints, &addrs) != 0)
       return 1;
 
-    addr_list = (struct in_addr **) he->h_addr_list;
-
-    for (i = 0; addr_list[i] != nullptr; ++i)
+    int result = 1;
+    for (struct addrinfo *addr = addrs; addr; addr = addr->ai_next)
     {
       // Return the first one;
-      _ip = std::string(inet_ntoa(*addr_list[i]));
-      return 0;
+      char ip[NI_MAXHOST];
+      if (getnameinfo(addr->ai_addr, static_cast<socklen_t>(addr->ai_addrlen),
+            ip, sizeof(ip), nullptr, 0, NI_NUMERICHOST) == 0)
+      {
+        _ip = ip;
+        result = 0;
+        break;
+      }
     }
+    freeaddrinfo(addrs);
 
-    return 1;
+    return result;
   }
 
   //////////////////////////////////////////////////
@@ -136,10 +229,15 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
     if (env("IGN_IP", ignIp) && !ignIp.empty())
       return ignIp;
 
-    // Second, try the preferred local and public IP address.
+    // Second, try the preferred local and public IP address. The hostname
+    // isn't resolved when the interfaces are listed.
     std::string hostIP;
-    if (preferredPublicIP(hostIP))
+    std::string ignIfaces;
+    if ((!env("IGN_TRANSPORT_INTERFACES", ignIfaces) || ignIfaces.empty()) &&
+        preferredPublicIP(hostIP))
+    {
       return hostIP;
+    }
 
     // Third, fall back on interface search, which will yield an IP address
     auto interfaces = determineInterfaces();
@@ -154,7 +252,9 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
   }
 
   //////////////////////////////////////////////////
-  std::vector<std::string> determineInterfaces()
+  /// \brief Enumerate the network interfaces of the host.
+  /// \return The list of network interfaces.
+  static std::vector<std::string> enumerateInterfaces()
   {
 #ifdef HAVE_IFADDRS
     std::vector<std::string> result;
@@ -351,6 +451,32 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
 #endif
   }
 
+  //////////////////////////////////////////////////
+  std::vector<std::string> determineInterfaces()
+  {
+    // A precomputed list skips the enumeration.
+    std::string ignIfaces;
+    if (env("IGN_TRANSPORT_INTERFACES", ignIfaces) && !ignIfaces.empty())
+      return split(ignIfaces, ':');
+
+    // The interfaces are enumerated once per process. The loopback fallback
+    // isn't cached, the network may come up later.
+    static std::mutex mutex;
+    static std::vector<std::string> cached;
+    std::lock_guard<std::mutex> lk(mutex);
+    if (cached.empty())
+    {
+      std::vector<std::string> interfaces = enumerateInterfaces();
+      if (interfaces.empty() ||
+          (interfaces.size() == 1 && interfaces.front() == "127.0.0.1"))
+      {
+        return interfaces;
+      }
+      cached = interfaces;
+    }
+    return cached;
+  }
+
   //////////////////////////////////////////////////
   std::string hostname()
   {
@@ -15,7 +15,11 @@
  *
 */
 
+#include <string>
+#include <vector>
+
 #include "ignition/transport/NetUtils.hh"
+#include "ignition/transport/test_config.h"
 #include "gtest/gtest.h"
 
 using namespace ignition;
@@ -34,6 +38,24 @@ TEST(NetUtilsTest, username)
   EXPECT_TRUE(!transport::username().empty());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that the interfaces can be listed in IGN_TRANSPORT_INTERFACES
+/// and are otherwise cached.
+TEST(NetUtilsTest, determineInterfaces)
+{
+  const std::vector<std::string> interfaces = transport::determineInterfaces();
+  ASSERT_FALSE(interfaces.empty());
+  EXPECT_EQ(interfaces, transport::determineInterfaces());
+
+  setenv("IGN_TRANSPORT_INTERFACES", "10.0.0.1:10.0.0.2", 1);
+  const std::vector<std::string> expected = {"10.0.0.1", "10.0.0.2"};
+  EXPECT_EQ(expected, transport::determineInterfaces());
+  unsetenv("IGN_TRANSPORT_INTERFACES");
+
+  EXPECT_EQ(interfaces, transport::determineInterfaces());
+  EXPECT_FALSE(transport::determineHost().empty());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -19,16 +19,22 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <csignal>
 #include <condition_variable>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "ignition/transport/AllocationCounter.hh"
+#include "ignition/transport/BufferAllocator.hh"
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/MessageInfo.hh"
 #include "ignition/transport/Node.hh"
@@ -38,8 +44,17 @@
 #include "ignition/transport/TransportTypes.hh"
 #include "ignition/transport/Uuid.hh"
 
+#include "AsyncPublishQueue.hh"
+#include "BufferPool.hh"
+#include "CallbackExecutor.hh"
+#include "Compression.hh"
+#include "MessageBatch.hh"
 #include "NodePrivate.hh"
 #include "NodeSharedPrivate.hh"
+#include "TokenBucket.hh"
+#include "TopicTrie.hh"
+#include "Tracing.hh"
+#include "TypeIds.hh"
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4503)
@@ -78,6 +93,10 @@ namespace ignition
       }
     }
 
+    /// \brief Factor applied to the rate announced by throttled remote
+    /// subscribers before skipping messages on the publisher.
+    static const double kRemoteRateMargin = 2.0;
+
     //////////////////////////////////////////////////
     int rcvHwm()
     {
@@ -106,17 +125,18 @@ namespace ignition
     /// \brief Private data for Node::Publisher class.
     class Node::PublisherPrivate
     {
-      /// \brief Default constructor.
-      public: PublisherPrivate()
-        : shared(NodeShared::Instance())
-      {
-      }
+      /// \brief Default constructor, for publishers that aren't valid.
+      public: PublisherPrivate() = default;
 
       /// \brief Constructor
       /// \param[in] _publisher The message publisher.
-      public: explicit PublisherPrivate(const MessagePublisher &_publisher)
-        : shared(NodeShared::Instance()),
-          publisher(_publisher)
+      /// \param[in] _shared The object shared by the nodes of the domain of
+      /// the publisher.
+      public: PublisherPrivate(const MessagePublisher &_publisher,
+                               NodeShared *_shared)
+        : shared(_shared),
+          publisher(_publisher),
+          msgTypeId(InternMsgType(_publisher.MsgTypeName()))
       {
       }
 
@@ -126,34 +146,62 @@ namespace ignition
       /// \return True if it is okay to publish, false otherwise.
       public: bool ThrottledUpdateReady() const
       {
-        if (!this->publisher.Options().Throttled())
+        if (!this->throttle)
           return true;
 
-        Timestamp now = std::chrono::steady_clock::now();
-
         std::lock_guard<std::mutex> lk(this->mutex);
-        auto elapsed = now - this->lastCbTimestamp;
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-              elapsed).count() >= this->periodNs;
+        return this->throttle->Ready();
       }
 
       /// \brief Check if this Publisher is ready to send an update based on
       /// publication settings and the clock.
       ///
-      /// This additionally advances the internal timestamp by one period.
+      /// This additionally takes a token from the throttling bucket.
       ///
       /// \return True if it is okay to publish, false otherwise.
       public: bool UpdateThrottling()
       {
-        if (!this->publisher.Options().Throttled())
+        if (!this->throttle)
           return true;
 
-        if (!this->ThrottledUpdateReady())
+        std::lock_guard<std::mutex> lk(this->mutex);
+        return this->throttle->Consume();
+      }
+
+      /// \brief Check whether a message should be sent to the remote
+      /// subscribers. When all of them are throttled, the messages that
+      /// they would drop aren't sent. The subscribers also throttle on
+      /// arrival, so the messages are sent at kRemoteRateMargin times their
+      /// rate to absorb the network jitter.
+      /// \param[in] _subscribers Subscribers of this publisher.
+      /// \return True if the message should be sent to the remote
+      /// subscribers.
+      public: bool RemoteUpdateReady(
+        const NodeShared::SubscriberInfo &_subscribers)
+      {
+        if (!_subscribers.haveRemote)
           return false;
 
-        // Update the last callback execution.
+        if (_subscribers.remoteMsgsPerSec == kUnthrottled ||
+            _subscribers.remoteMsgsPerSec == 0)
+        {
+          return true;
+        }
+
+        const double periodNs = 1e9 /
+          (kRemoteRateMargin *
+           static_cast<double>(_subscribers.remoteMsgsPerSec));
+        Timestamp now = std::chrono::steady_clock::now();
+
         std::lock_guard<std::mutex> lk(this->mutex);
-        this->lastCbTimestamp = std::chrono::steady_clock::now();
+        auto elapsed = now - this->lastRemoteTimestamp;
+        if (std::chrono::duration_cast<std::chrono::nanoseconds>(
+              elapsed).count() < periodNs)
+        {
+          return false;
+        }
+
+        this->lastRemoteTimestamp = now;
         return true;
       }
 
@@ -164,9 +212,53 @@ namespace ignition
         return !this->publisher.Topic().empty();
       }
 
+      /// \brief Whether the latest message is kept for the subscribers
+      /// that join later.
+      /// \return True if the topic has transient local durability.
+      public: bool Durable() const
+      {
+        return this->publisher.Options().Durability() ==
+          Durability_t::TRANSIENT_LOCAL;
+      }
+
+      /// \brief Keep a copy of the latest message of a durable topic.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message.
+      /// \param[in] _msgType Type of the message.
+      /// \return False if the copy couldn't be allocated.
+      public: bool CopyLastValue(const char *_data, const std::size_t _size,
+                                 const std::string &_msgType)
+      {
+        std::shared_ptr<char> copy = BufferAllocator::Shared(_size);
+        if (!copy)
+          return false;
+        if (_size > 0)
+          memcpy(copy.get(), _data, _size);
+
+        this->shared->dataPtr->RetainLastValue(this->publisher.Topic(),
+          {copy, _size, _msgType});
+        return true;
+      }
+
       /// \brief Destructor.
       public: virtual ~PublisherPrivate()
       {
+        // Send the pending messages before unadvertising. This must happen
+        // before locking the NodeShared mutex, the sender thread might need
+        // it.
+        this->asyncQueue.reset();
+
+        if (!this->shared)
+          return;
+
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          this->StopMatchWatcher();
+        }
+
+        if (this->Durable())
+          this->shared->dataPtr->ForgetLastValue(this->publisher.Topic());
+
         std::lock_guard<std::recursive_mutex> lk(this->shared->mutex);
         // Notify the discovery service to unregister and unadvertise my topic.
         if (!this->shared->dataPtr->msgDiscovery->Unadvertise(
@@ -177,6 +269,146 @@ namespace ignition
         }
       }
 
+      /// \brief Subscribers of this publisher at a given point in time.
+      public: struct SubscribersSnapshot
+      {
+        /// \brief Value of NodeSharedPrivate::subscribersVersion when the
+        /// snapshot was taken.
+        public: uint64_t version = 0;
+
+        /// \brief The subscribers.
+        public: NodeShared::SubscriberInfo info;
+      };
+
+      /// \brief Get the subscribers of this publisher. The snapshot is only
+      /// rebuilt when the subscribers of the process have changed, so the
+      /// common case doesn't take the NodeShared mutex.
+      /// \return The current subscribers.
+      public: std::shared_ptr<const SubscribersSnapshot> Subscribers()
+      {
+        return this->Subscribers(this->publisher.MsgTypeName());
+      }
+
+      /// \brief Get the subscribers of a message published with this
+      /// publisher. A generic publisher publishes messages of any type, and
+      /// the remote subscribers depend on that type, so only the advertised
+      /// type is cached.
+      /// \param[in] _msgType Type of the published message.
+      /// \return The current subscribers.
+      public: std::shared_ptr<const SubscribersSnapshot> Subscribers(
+                  const std::string &_msgType)
+      {
+        if (_msgType != this->publisher.MsgTypeName())
+        {
+          auto typedSnapshot = std::make_shared<SubscribersSnapshot>();
+          typedSnapshot->info = this->shared->CheckSubscriberInfo(
+            this->publisher.Topic(), _msgType);
+          return typedSnapshot;
+        }
+
+        // Load the version first. If the subscribers change while we are
+        // building the snapshot, the next call rebuilds it again.
+        const uint64_t version = this->shared->dataPtr->subscribersVersion.load(
+          std::memory_order_acquire);
+
+        std::shared_ptr<const SubscribersSnapshot> snapshot =
+          std::atomic_load(&this->subscribers);
+        if (snapshot && snapshot->version == version)
+          return snapshot;
+
+        auto newSnapshot = std::make_shared<SubscribersSnapshot>();
+        newSnapshot->version = version;
+        newSnapshot->info = this->shared->CheckSubscriberInfo(
+          this->publisher.Topic(), this->publisher.MsgTypeName());
+
+        snapshot = newSnapshot;
+        std::atomic_store(&this->subscribers, snapshot);
+        return snapshot;
+      }
+
+      /// \brief Queue a serialized message for the local and raw
+      /// subscribers. The publish thread parses it for the local handlers.
+      /// \param[in] _subscribers Subscribers of this publisher.
+      /// \param[in] _msgType Message type.
+      /// \param[in] _data Serialized message.
+      /// \param[in] _size Size of the serialized message.
+      /// \param[in] _caller Name of the calling function, used in errors.
+      /// \param[in] _ackId ID of the message in the pending
+      /// acknowledgements, whose local delivery is recorded once the
+      /// callbacks returned. 0 if the message isn't acknowledged.
+      public: void QueueLocal(const NodeShared::SubscriberInfo &_subscribers,
+                              const std::string &_msgType,
+                              const std::shared_ptr<char> &_data,
+                              const std::size_t _size,
+                              const char *_caller,
+                              const uint64_t _ackId = 0);
+
+      /// \brief Send a serialized message to the remote subscribers. In
+      /// asynchronous or conflated mode, the message is queued and sent from
+      /// the sender thread of this publisher.
+      /// \param[in] _data Serialized message. The reference is released
+      /// once the message has been sent.
+      /// \param[in] _size Size of the serialized message.
+      /// \param[in] _msgType Value of the message type frame.
+      /// \return True on success or false if the message could not be sent
+      /// or queued.
+      public: bool SendRemote(const std::shared_ptr<char> &_data,
+                              const std::size_t _size,
+                              const std::string &_msgType);
+
+      /// \brief Serialize a message given up by the caller and send it to
+      /// the remote subscribers from the sender thread of this publisher,
+      /// so the caller doesn't wait for the serialization. The message is
+      /// also retained for the late subscribers of a durable topic. The
+      /// buffer is allocated and the message checked before it's queued,
+      /// so a message that can't be serialized is reported here.
+      /// \param[in] _msg The message, not modified after this call.
+      /// \param[in] _size Size of the serialized message.
+      /// \param[in] _msgType Value of the message type frame.
+      /// \return True on success or false if the message can't be
+      /// serialized, its buffer can't be allocated or it could not be
+      /// queued.
+      public: bool SendRemoteOwned(
+                const std::shared_ptr<const ProtoMsg> &_msg,
+                const std::size_t _size, const std::string &_msgType);
+
+      /// \brief Whether the remote messages are sent from the sender
+      /// thread of this publisher.
+      /// \return True in asynchronous or conflated mode.
+      public: bool Queued() const
+      {
+        const AdvertiseMessageOptions &opts = this->publisher.Options();
+        return opts.PublishMode() == PublishMode_t::ASYNC || opts.Conflated();
+      }
+
+      /// \brief Get the send queue of this publisher, created on first use.
+      /// \return The queue, which lives as long as this object.
+      public: AsyncPublishQueue *AsyncQueue();
+
+      /// \brief Publish a message.
+      /// \param[in] _msg The message.
+      /// \param[in] _owned The message if the caller gave it up, shared
+      /// with the local handlers instead of a copy, or nullptr.
+      /// \param[in] _typeChecked True if the type of the message is known
+      /// to be the advertised one, e.g. it was checked at compile time.
+      /// \return True on success.
+      /// \sa Node::Publisher::Publish
+      public: bool Publish(const ProtoMsg &_msg,
+                           const std::shared_ptr<const ProtoMsg> &_owned,
+                           const bool _typeChecked = false);
+
+      /// \brief Get the ID of the type of a message whose type matches the
+      /// advertised one.
+      /// \param[in] _msgType Message type name.
+      /// \return msgTypeId, or the ID of _msgType if any type may be
+      /// published.
+      public: MsgTypeId MsgTypeIdOf(const std::string &_msgType) const
+      {
+        if (this->msgTypeId != kGenericMsgTypeId)
+          return this->msgTypeId;
+        return InternMsgType(_msgType);
+      }
+
       /// \brief Create a MessageInfo object for this Publisher
       MessageInfo CreateMessageInfo()
       {
@@ -198,16 +430,355 @@ namespace ignition
       /// \brief The message publisher.
       public: MessagePublisher publisher;
 
-      /// \brief Timestamp of the last callback executed.
-      public: Timestamp lastCbTimestamp;
+      /// \brief Rate limiter of the publications, if throttling is
+      /// enabled. Protected by mutex.
+      public: std::unique_ptr<TokenBucket> throttle;
 
-      /// \brief If throttling is enabled, the minimum period for receiving a
-      /// message in nanoseconds.
-      public: double periodNs = 0.0;
+      /// \brief Timestamp of the last message sent to throttled remote
+      /// subscribers.
+      public: Timestamp lastRemoteTimestamp;
 
       /// \brief Mutex to protect the node::publisher from race conditions.
       public: mutable std::mutex mutex;
+
+      /// \brief Pool of buffers for Publisher::Loan(). Created on first use.
+      public: std::shared_ptr<BufferPool> bufferPool;
+
+      /// \brief Cached subscribers. Use Subscribers() to access it.
+      public: std::shared_ptr<const SubscribersSnapshot> subscribers;
+
+      /// \brief Interned ID of the advertised message type.
+      public: MsgTypeId msgTypeId = kNoMsgTypeId;
+
+      /// \brief Watcher of the subscribers, set by
+      /// Publisher::SetMatchedCallback(). Protected by mutex.
+      public: std::shared_ptr<NodeSharedPrivate::MatchWatcher> matchWatcher;
+
+      /// \brief Stop running the matched callback, if any. Must be called
+      /// with mutex locked.
+      public: void StopMatchWatcher()
+      {
+        if (!this->matchWatcher)
+          return;
+
+        // The match thread may hold the watcher a little longer.
+        {
+          std::lock_guard<std::mutex> lk(this->shared->dataPtr->matchMutex);
+          this->matchWatcher->callback = nullptr;
+        }
+        this->matchWatcher.reset();
+      }
+
+      /// \brief Serialized messages queued by Publisher::Enqueue().
+      /// Protected by mutex.
+      public: std::vector<std::string> batch;
+
+      /// \brief Send queue used in PublishMode_t::ASYNC mode or when the
+      /// publication is conflated. Created on first use, protected by
+      /// mutex.
+      public: std::unique_ptr<AsyncPublishQueue> asyncQueue;
     };
+
+    //////////////////////////////////////////////////
+    /// \brief Create an empty message given its type name.
+    /// \param[in] _type The message type name.
+    /// \return The new message or nullptr if the type is unknown.
+    static std::unique_ptr<ProtoMsg> NewMessage(const std::string &_type)
+    {
+      const google::protobuf::Descriptor *desc =
+        google::protobuf::DescriptorPool::generated_pool()
+          ->FindMessageTypeByName(_type);
+
+      // First, check if we have the descriptor from the generated proto
+      // classes. Otherwise, fallback on Ignition Msgs.
+      if (desc)
+      {
+        return std::unique_ptr<ProtoMsg>(
+          google::protobuf::MessageFactory::generated_factory()
+            ->GetPrototype(desc)->New());
+      }
+
+      return ignition::msgs::Factory::New(_type);
+    }
+
+    //////////////////////////////////////////////////
+    /// \brief Run the callbacks of the subscribers with inline delivery on
+    /// the calling thread. An exception thrown by a callback doesn't reach
+    /// the publisher, like in the publish thread.
+    /// \param[in] _localHandlers Local handlers.
+    /// \param[in] _msg Message for the local handlers.
+    /// \param[in] _rawHandlers Raw handlers.
+    /// \param[in] _data Serialized message for the raw handlers.
+    /// \param[in] _size Size of the serialized message.
+    /// \param[in] _info Message information.
+    static void RunInline(
+      const std::vector<ISubscriptionHandlerPtr> &_localHandlers,
+      const ProtoMsg *_msg,
+      const std::vector<RawSubscriptionHandlerPtr> &_rawHandlers,
+      const char *_data,
+      const std::size_t _size,
+      const MessageInfo &_info)
+    {
+      for (const auto &handler : _localHandlers)
+      {
+        try
+        {
+          handler->RunLocalCallback(*_msg, _info);
+        }
+        catch (...)
+        {
+          std::cerr << "Exception occurred in a local callback "
+                    << "on topic [" << _info.Topic() << "]" << std::endl;
+        }
+      }
+
+      for (const auto &handler : _rawHandlers)
+      {
+        try
+        {
+          handler->RunRawCallback(_data, _size, _info);
+        }
+        catch (...)
+        {
+          std::cerr << "Exception occurred in a local raw callback "
+                    << "on topic [" << _info.Topic() << "]" << std::endl;
+        }
+      }
+    }
+
+    //////////////////////////////////////////////////
+    void Node::PublisherPrivate::QueueLocal(
+      const NodeShared::SubscriberInfo &_subscribers,
+      const std::string &_msgType,
+      const std::shared_ptr<char> &_data,
+      const std::size_t _size,
+      const char *_caller,
+      const uint64_t _ackId)
+    {
+      NodeSharedPrivate::PublishMsgDetails pubMsgDetails;
+
+      pubMsgDetails.info.SetTopicAndPartition(this->publisher.Topic());
+      pubMsgDetails.info.SetType(_msgType);
+      pubMsgDetails.info.SetIntraProcess(true);
+      pubMsgDetails.info.SetReceiveTime(std::chrono::steady_clock::now());
+
+      // The handlers with inline delivery run on this thread.
+      std::vector<ISubscriptionHandlerPtr> inlineHandlers;
+      std::vector<RawSubscriptionHandlerPtr> inlineRawHandlers;
+
+      const MsgTypeId typeId = this->MsgTypeIdOf(_msgType);
+
+      for (const auto &node : _subscribers.localHandlers)
+      {
+        for (const auto &handler : node.second)
+        {
+          if (handler.second &&
+              (handler.second->TypeId() == kGenericMsgTypeId ||
+               handler.second->TypeId() == typeId))
+          {
+            if (handler.second->InlineDelivery())
+              inlineHandlers.push_back(handler.second);
+            else
+              pubMsgDetails.localHandlers.push_back(handler.second);
+          }
+        }
+      }
+
+      for (const auto &node : _subscribers.rawHandlers)
+      {
+        for (const auto &handler : node.second)
+        {
+          if (handler.second &&
+              (handler.second->TypeId() == kGenericMsgTypeId ||
+               handler.second->TypeId() == typeId))
+          {
+            if (handler.second->InlineDelivery())
+              inlineRawHandlers.push_back(handler.second);
+            else
+              pubMsgDetails.rawHandlers.push_back(handler.second);
+          }
+        }
+      }
+
+      if (!inlineHandlers.empty() || !inlineRawHandlers.empty())
+      {
+        std::unique_ptr<ProtoMsg> msg;
+        if (!inlineHandlers.empty())
+        {
+          msg = NewMessage(_msgType);
+          if (!msg || !msg->ParseFromArray(_data.get(),
+                static_cast<int>(_size)))
+          {
+            std::cerr << _caller << ": Unable to parse a message of type ["
+                      << _msgType << "] for inline subscribers" << std::endl;
+            inlineHandlers.clear();
+          }
+        }
+
+        RunInline(inlineHandlers, msg.get(), inlineRawHandlers, _data.get(),
+          _size, pubMsgDetails.info);
+      }
+
+      if (!pubMsgDetails.localHandlers.empty())
+      {
+        pubMsgDetails.msgToParse = NewMessage(_msgType);
+        if (!pubMsgDetails.msgToParse)
+        {
+          std::cerr << _caller << ": Unable to create a message of type ["
+                    << _msgType << "] for local subscribers" << std::endl;
+          pubMsgDetails.localHandlers.clear();
+        }
+      }
+
+      if (pubMsgDetails.localHandlers.empty() &&
+          pubMsgDetails.rawHandlers.empty())
+      {
+        if (_ackId != 0)
+          this->shared->dataPtr->pendingAcks.LocalDone(_ackId);
+        return;
+      }
+
+      pubMsgDetails.sharedBuffer = _data;
+      pubMsgDetails.msgSize = _size;
+      pubMsgDetails.ackId = _ackId;
+#ifdef IGN_TRANSPORT_TRACING
+      pubMsgDetails.traceId = Tracer::CurrentId();
+#endif
+
+      IGN_TRANSPORT_TRACE_INSTANT("enqueue", pubMsgDetails.info.Topic());
+      auto &queue =
+        this->shared->dataPtr->PubQueue(pubMsgDetails.info.Topic());
+      queue.Push(std::move(pubMsgDetails));
+    }
+
+    //////////////////////////////////////////////////
+    bool Node::PublisherPrivate::SendRemote(
+      const std::shared_ptr<char> &_data,
+      const std::size_t _size,
+      const std::string &_msgType)
+    {
+      NodeShared *nodeShared = this->shared;
+      const std::string &topic = this->publisher.Topic();
+#ifdef IGN_TRANSPORT_TRACING
+      // The message might be sent from the asynchronous publish thread.
+      const uint64_t traceId = Tracer::CurrentId();
+#endif
+
+      auto send = [=]()
+      {
+        IGN_TRANSPORT_TRACE_CONTEXT(traceId);
+
+        // Zmq will call this lambda when the message is published.
+        // We use it to release our reference to the shared buffer.
+        auto myDeallocator = [](void */*_buffer*/, void *_hint)
+        {
+          delete reinterpret_cast<std::shared_ptr<char>*>(_hint);
+        };
+
+        std::shared_ptr<char> *hint = new std::shared_ptr<char>(_data);
+
+        return nodeShared->Publish(topic, _data.get(), _size, myDeallocator,
+          _msgType, hint);
+      };
+
+      if (!this->Queued())
+        return send();
+
+      // Push() might block, so the mutex is not held here.
+      return this->AsyncQueue()->Push([send]()
+      {
+        send();
+      }, _size);
+    }
+
+    //////////////////////////////////////////////////
+    bool Node::PublisherPrivate::SendRemoteOwned(
+      const std::shared_ptr<const ProtoMsg> &_msg, const std::size_t _size,
+      const std::string &_msgType)
+    {
+      NodeShared *nodeShared = this->shared;
+      const std::string &topic = this->publisher.Topic();
+      const bool durable = this->Durable();
+#ifdef IGN_TRANSPORT_TRACING
+      const uint64_t traceId = Tracer::CurrentId();
+#endif
+
+      // The failures are reported to the caller: the buffer is allocated
+      // here, and the message is checked for what makes its serialization
+      // fail, i.e. a size beyond the limit of protobuf or missing required
+      // fields. Only the serialization itself is deferred.
+      if (_size > static_cast<std::size_t>(std::numeric_limits<int>::max()) ||
+          !_msg->IsInitialized())
+      {
+        std::cerr << "Node::Publisher::Publish(): Error serializing data"
+                  << std::endl;
+        return false;
+      }
+
+      std::shared_ptr<char> data = BufferAllocator::Shared(_size);
+      if (!data)
+      {
+        std::cerr << "Node::Publisher::Publish(): Unable to allocate ["
+                  << _size << "] bytes" << std::endl;
+        return false;
+      }
+
+      // The tasks of the queue run in order, so the serialized messages are
+      // sent in the order they were published.
+      return this->AsyncQueue()->Push([=]()
+      {
+        IGN_TRANSPORT_TRACE_CONTEXT(traceId);
+
+        {
+          // Only a message modified after Publish() fails here, it's
+          // dropped.
+          IGN_TRANSPORT_TRACE_SCOPE("serialize", topic, START);
+          if (!_msg->SerializeToArray(data.get(), static_cast<int>(_size)))
+          {
+            std::cerr << "Node::Publisher::Publish(): Error serializing data"
+                      << std::endl;
+            return;
+          }
+        }
+
+        if (durable)
+          nodeShared->dataPtr->RetainLastValue(topic, {data, _size, _msgType});
+
+        auto myDeallocator = [](void */*_buffer*/, void *_hint)
+        {
+          delete reinterpret_cast<std::shared_ptr<char>*>(_hint);
+        };
+
+        std::shared_ptr<char> *hint = new std::shared_ptr<char>(data);
+        nodeShared->Publish(topic, data.get(), _size, myDeallocator,
+          _msgType, hint);
+      }, _size);
+    }
+
+    //////////////////////////////////////////////////
+    AsyncPublishQueue *Node::PublisherPrivate::AsyncQueue()
+    {
+      const AdvertiseMessageOptions &opts = this->publisher.Options();
+      std::lock_guard<std::mutex> lk(this->mutex);
+      if (!this->asyncQueue)
+      {
+        // A conflated publisher only keeps the latest message. The bytes
+        // of all the queues of the process are bounded together.
+        const auto &budget = this->shared->dataPtr->sendBudget;
+        if (opts.Conflated())
+        {
+          this->asyncQueue.reset(new AsyncPublishQueue(
+            1u, QueuePolicy_t::DROP_OLDEST, 0u, budget));
+        }
+        else
+        {
+          this->asyncQueue.reset(new AsyncPublishQueue(
+            opts.AsyncQueueSize(), opts.AsyncQueuePolicy(),
+            opts.AsyncQueueBytes(), budget));
+        }
+      }
+      return this->asyncQueue.get();
+    }
     }
   }
 }
@@ -220,12 +791,20 @@ Node::Publisher::Publisher()
 
 //////////////////////////////////////////////////
 Node::Publisher::Publisher(const MessagePublisher &_publisher)
-  : dataPtr(std::make_shared<PublisherPrivate>(_publisher))
+  : Publisher(_publisher, NodeShared::Instance())
 {
-  if (this->dataPtr->publisher.Options().Throttled())
+}
+
+//////////////////////////////////////////////////
+Node::Publisher::Publisher(const MessagePublisher &_publisher,
+    NodeShared *_shared)
+  : dataPtr(std::make_shared<PublisherPrivate>(_publisher, _shared))
+{
+  const AdvertiseMessageOptions &opts = this->dataPtr->publisher.Options();
+  if (opts.Throttled())
   {
-    this->dataPtr->periodNs =
-      1e9 / this->dataPtr->publisher.Options().MsgsPerSec();
+    this->dataPtr->throttle.reset(new TokenBucket(
+      opts.MsgsPerSec(), opts.Burst(), opts.CoarseClock()));
   }
 }
 
@@ -259,6 +838,9 @@ bool Node::Publisher::HasConnections() const
   const std::string &topic = publisher.Topic();
   const std::string &msgType = publisher.MsgTypeName();
 
+  if (!this->dataPtr->shared)
+    return false;
+
   std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
 
   /// \todo(anyone): Checking "remoteSubscribers.HasTopic()" will return
@@ -271,20 +853,69 @@ bool Node::Publisher::HasConnections() const
      this->dataPtr->shared->remoteSubscribers.HasTopic(topic, msgType));
 }
 
+//////////////////////////////////////////////////
+bool Node::Publisher::SetMatchedCallback(
+  const std::function<void(const bool _matched)> &_callback)
+{
+  if (!this->Valid())
+    return false;
+
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  this->dataPtr->StopMatchWatcher();
+  if (!_callback)
+    return true;
+
+  auto watcher = std::make_shared<NodeSharedPrivate::MatchWatcher>();
+  watcher->topic = this->dataPtr->publisher.Topic();
+  watcher->msgType = this->dataPtr->publisher.MsgTypeName();
+  watcher->callback = _callback;
+  this->dataPtr->matchWatcher = watcher;
+  this->dataPtr->shared->dataPtr->AddMatchWatcher(watcher);
+  return true;
+}
+
 //////////////////////////////////////////////////
 bool Node::Publisher::Publish(const ProtoMsg &_msg)
 {
+  return this->dataPtr->Publish(_msg, nullptr);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishTyped(const ProtoMsg &_msg)
+{
+  return this->dataPtr->Publish(_msg, nullptr, true);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::Publish(const std::shared_ptr<const ProtoMsg> &_msg)
+{
+  if (!_msg)
+  {
+    std::cerr << "Node::Publisher::Publish(): NULL message" << std::endl;
+    return false;
+  }
+
+  return this->dataPtr->Publish(*_msg, _msg);
+}
+
+//////////////////////////////////////////////////
+bool Node::PublisherPrivate::Publish(const ProtoMsg &_msg,
+  const std::shared_ptr<const ProtoMsg> &_owned, const bool _typeChecked)
+{
+  IGN_TRANSPORT_COUNT_ALLOCATIONS(PUBLISHER_PUBLISH);
+
   if (!this->Valid())
     return false;
 
-  const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
+  const std::string &publisherMsgType = this->publisher.MsgTypeName();
 
   // Check that the msg type matches the topic type previously advertised.
-  if (publisherMsgType != _msg.GetTypeName())
+  // From here on, the message has the advertised type.
+  if (!_typeChecked && publisherMsgType != _msg.GetTypeName())
   {
     std::cerr << "Node::Publisher::Publish() Type mismatch.\n"
               << "\t* Type advertised: "
-              << this->dataPtr->publisher.MsgTypeName()
+              << this->publisher.MsgTypeName()
               << "\n\t* Type published: " << _msg.GetTypeName() << std::endl;
     return false;
   }
@@ -293,11 +924,11 @@ bool Node::Publisher::Publish(const ProtoMsg &_msg)
   if (!this->UpdateThrottling())
     return true;
 
-  const std::string &publisherTopic = this->dataPtr->publisher.Topic();
+  IGN_TRANSPORT_TRACE_NEW_CONTEXT();
 
-  const NodeShared::SubscriberInfo &subscribers =
-      this->dataPtr->shared->CheckSubscriberInfo(
-        publisherTopic, publisherMsgType);
+  const auto snapshot = this->Subscribers();
+  const NodeShared::SubscriberInfo &subscribers = snapshot->info;
+  const bool sendRemote = this->RemoteUpdateReady(subscribers);
 
   // The serialized message size and buffer.
 #if GOOGLE_PROTOBUF_VERSION >= 3004000
@@ -305,42 +936,66 @@ bool Node::Publisher::Publish(const ProtoMsg &_msg)
 #else
   const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSize());
 #endif
-  char *msgBuffer = nullptr;
+
+  // The message is serialized once into a reference counted buffer. The same
+  // buffer is handed to ZeroMQ for the remote subscribers, to the raw
+  // handlers, and used for parsing the message for the local handlers.
+  std::shared_ptr<char> msgBuffer;
+
+  // A message given up by the caller is serialized by the sender thread in
+  // asynchronous mode, unless the raw subscribers of this process need it.
+  const bool deferred =
+    _owned && sendRemote && !subscribers.haveRaw && this->Queued();
 
   // Only serialize the message if we have a raw subscriber or a remote
-  // subscriber.
-  if (subscribers.haveRaw || subscribers.haveRemote)
+  // subscriber, or if it's kept for the subscribers joining later.
+  const bool durable = this->Durable();
+  if (!deferred && (subscribers.haveRaw || sendRemote || durable))
   {
+    IGN_TRANSPORT_TRACE_SCOPE("serialize", this->publisher.Topic(), START);
+
     // Allocate the buffer to store the serialized data.
-    msgBuffer = static_cast<char *>(new char[msgSize]);
+    msgBuffer = BufferAllocator::Shared(msgSize);
+    if (!msgBuffer)
+    {
+      std::cerr << "Node::Publisher::Publish(): Unable to allocate ["
+                << msgSize << "] bytes" << std::endl;
+      return false;
+    }
 
     // Fail out early if we are unable to serialize the message. We do not
     // want to send a corrupt/bad message to some subscribers and not others.
-    if (!_msg.SerializeToArray(msgBuffer, msgSize))
+    if (!_msg.SerializeToArray(msgBuffer.get(), msgSize))
     {
-      delete[] msgBuffer;
       std::cerr << "Node::Publisher::Publish(): Error serializing data"
                 << std::endl;
       return false;
     }
+
+    // The buffer is never written again, so it's shared with the cache.
+    if (durable)
+    {
+      this->shared->dataPtr->RetainLastValue(this->publisher.Topic(),
+        {msgBuffer, msgSize, publisherMsgType});
+    }
   }
 
   // Local and raw subscribers.
   if (subscribers.haveLocal || subscribers.haveRaw)
   {
-    std::unique_ptr<NodeSharedPrivate::PublishMsgDetails> pubMsgDetails(
-      new NodeSharedPrivate::PublishMsgDetails);
+    // The details are moved into a preallocated slot of the publish queue,
+    // the message will be published asynchronously from there.
+    NodeSharedPrivate::PublishMsgDetails pubMsgDetails;
 
-    // Create and populate the message information object.
-    // This must be a shared pointer so that we can pass it to
-    // multiple threads below, and then allow this function to go
-    // out of scope.
-    pubMsgDetails->info.SetTopicAndPartition(this->dataPtr->publisher.Topic());
-    pubMsgDetails->info.SetType(this->dataPtr->publisher.MsgTypeName());
-    pubMsgDetails->info.SetIntraProcess(true);
+    // Populate the message information object.
+    pubMsgDetails.info.SetTopicAndPartition(this->publisher.Topic());
+    pubMsgDetails.info.SetType(this->publisher.MsgTypeName());
+    pubMsgDetails.info.SetIntraProcess(true);
+    pubMsgDetails.info.SetReceiveTime(std::chrono::steady_clock::now());
 
-    pubMsgDetails->msgCopy.reset(_msg.New());
-    pubMsgDetails->msgCopy->CopyFrom(_msg);
+    // The handlers with inline delivery run on this thread.
+    std::vector<ISubscriptionHandlerPtr> inlineHandlers;
+    std::vector<RawSubscriptionHandlerPtr> inlineRawHandlers;
 
     if (subscribers.haveLocal)
     {
@@ -357,13 +1012,16 @@ bool Node::Publisher::Publish(const ProtoMsg &_msg)
             continue;
           }
 
-          if (handler.second->TypeName() != kGenericMessageType &&
-              handler.second->TypeName() != _msg.GetTypeName())
+          if (handler.second->TypeId() != kGenericMsgTypeId &&
+              handler.second->TypeId() != this->msgTypeId)
           {
             continue;
           }
 
-          pubMsgDetails->localHandlers.push_back(handler.second);
+          if (handler.second->InlineDelivery())
+            inlineHandlers.push_back(handler.second);
+          else
+            pubMsgDetails.localHandlers.push_back(handler.second);
         }
       }
     }
@@ -383,54 +1041,78 @@ bool Node::Publisher::Publish(const ProtoMsg &_msg)
             continue;
           }
 
-          if (rawHandler->TypeName() != kGenericMessageType &&
-              rawHandler->TypeName() != _msg.GetTypeName())
+          if (rawHandler->TypeId() != kGenericMsgTypeId &&
+              rawHandler->TypeId() != this->msgTypeId)
           {
             continue;
           }
 
-          if (!pubMsgDetails->sharedBuffer)
-          {
-            pubMsgDetails->msgSize = msgSize;
-            // If the sharedBuffer has not been created, do so now.
-            pubMsgDetails->sharedBuffer.reset(new char[msgSize]);
-            memcpy(pubMsgDetails->sharedBuffer.get(), msgBuffer, msgSize);
-          }
-          pubMsgDetails->rawHandlers.push_back(rawHandler);
+          if (rawHandler->InlineDelivery())
+            inlineRawHandlers.push_back(rawHandler);
+          else
+            pubMsgDetails.rawHandlers.push_back(rawHandler);
         }
       }
     }
 
-    // Add the publish message details to the publish queue. The message
-    // will be published asynchronously to the local and raw callbacks.
+    // Share the serialized buffer with the raw handlers and the local
+    // handlers, which will parse it lazily from the publish thread.
+    if (msgBuffer)
     {
-      std::unique_lock<std::mutex> queueLock(
-          this->dataPtr->shared->dataPtr->pubThreadMutex);
-      this->dataPtr->shared->dataPtr->pubQueue.push(std::move(pubMsgDetails));
+      pubMsgDetails.sharedBuffer = msgBuffer;
+      pubMsgDetails.msgSize = msgSize;
     }
 
-    this->dataPtr->shared->dataPtr->signalNewPub.notify_one();
-  }
-
-  // Handle remote subscribers.
-  if (subscribers.haveRemote)
-  {
-    // Zmq will call this lambda when the message is published.
-    // We use it to deallocate the buffer.
-    auto myDeallocator = [](void *_buffer, void *)
+    if (!pubMsgDetails.localHandlers.empty())
     {
-      delete[] reinterpret_cast<char*>(_buffer);
-    };
+      if (_owned)
+      {
+        // The caller gave up the message, the local handlers share it.
+        pubMsgDetails.msgCopy = _owned;
+      }
+      else if (msgBuffer)
+      {
+        // Parsing is deferred to the publish thread, this avoids a deep copy
+        // in the caller's thread.
+        pubMsgDetails.msgToParse.reset(_msg.New());
+      }
+      else
+      {
+        // Only local subscribers: a copy is cheaper than serializing and
+        // parsing the message.
+        std::shared_ptr<ProtoMsg> msgCopy(_msg.New());
+        msgCopy->CopyFrom(_msg);
+        pubMsgDetails.msgCopy = std::move(msgCopy);
+      }
+    }
 
-    if (!this->dataPtr->shared->Publish(this->dataPtr->publisher.Topic(),
-          msgBuffer, msgSize, myDeallocator, _msg.GetTypeName()))
+    // The inline handlers receive a reference to the published message.
+    RunInline(inlineHandlers, &_msg, inlineRawHandlers, msgBuffer.get(),
+      msgSize, pubMsgDetails.info);
+
+    // Add the publish message details to the publish queue. The message
+    // will be published asynchronously to the local and raw callbacks.
+    if (!pubMsgDetails.localHandlers.empty() ||
+        !pubMsgDetails.rawHandlers.empty())
     {
-      return false;
+#ifdef IGN_TRANSPORT_TRACING
+      pubMsgDetails.traceId = Tracer::CurrentId();
+#endif
+      IGN_TRANSPORT_TRACE_INSTANT("enqueue", pubMsgDetails.info.Topic());
+      auto &queue =
+        this->shared->dataPtr->PubQueue(pubMsgDetails.info.Topic());
+      queue.Push(std::move(pubMsgDetails));
     }
   }
-  else
+
+  // Handle remote subscribers.
+  if (deferred)
+    return this->SendRemoteOwned(_owned, msgSize, publisherMsgType);
+
+  if (sendRemote)
   {
-    delete[] msgBuffer;
+    if (!this->SendRemote(msgBuffer, msgSize, publisherMsgType))
+      return false;
   }
 
   return true;
@@ -440,6 +1122,15 @@ bool Node::Publisher::Publish(const ProtoMsg &_msg)
 bool Node::Publisher::PublishRaw(
     const std::string &_msgData,
     const std::string &_msgType)
+{
+  return this->PublishRaw(_msgData.data(), _msgData.size(), _msgType);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishRaw(
+    const char *_msgData,
+    const std::size_t _size,
+    const std::string &_msgType)
 {
   if (!this->dataPtr->Valid())
     return false;
@@ -458,35 +1149,356 @@ bool Node::Publisher::PublishRaw(
   if (!this->dataPtr->UpdateThrottling())
     return true;
 
+  IGN_TRANSPORT_TRACE_NEW_CONTEXT();
+
   const std::string &topic = this->dataPtr->publisher.Topic();
 
-  const NodeShared::SubscriberInfo &subscribers =
-      this->dataPtr->shared->CheckSubscriberInfo(topic, _msgType);
+  const auto snapshot = this->dataPtr->Subscribers(_msgType);
+  const NodeShared::SubscriberInfo &subscribers = snapshot->info;
 
   MessageInfo info;
   info.SetTopicAndPartition(topic);
   info.SetType(_msgType);
   info.SetIntraProcess(true);
+  info.SetReceiveTime(std::chrono::steady_clock::now());
 
   // Trigger local subscribers.
-  this->dataPtr->shared->TriggerCallbacks(info, _msgData, subscribers);
+  this->dataPtr->shared->TriggerCallbacks(info, _msgData, _size, subscribers);
 
-  // Remote subscribers. Note that the data is already presumed to be
-  // serialized, so we just pass it along for publication.
-  if (subscribers.haveRemote)
+  // The caller owns the data, keep a copy for the late subscribers.
+  if (this->dataPtr->Durable() &&
+      !this->dataPtr->CopyLastValue(_msgData, _size, _msgType))
+  {
+    return false;
+  }
+
+  // Remote subscribers. Note that the data is already presumed to be
+  // serialized, so we just pass it along for publication. ZeroMQ sends it
+  // after this call, so it's copied into a buffer of the pool, which is
+  // recycled once the frame has been sent.
+  if (this->dataPtr->RemoteUpdateReady(subscribers))
+  {
+    char *msgBuffer = this->Loan(_size);
+    if (!msgBuffer)
+      return false;
+    if (_size > 0)
+      memcpy(msgBuffer, _msgData, _size);
+
+    if (!this->dataPtr->SendRemote(
+          std::shared_ptr<char>(msgBuffer, &BufferPool::Release), _size,
+          _msgType))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishSegments(
+    const std::vector<MessageSegment> &_segments,
+    const std::string &_msgType)
+{
+  // The segments are released once every copy of this pointer is gone:
+  // when this function returns or once ZeroMQ has sent the last chunk.
+  std::shared_ptr<const std::vector<MessageSegment>> segments(
+    new std::vector<MessageSegment>(_segments),
+    [](const std::vector<MessageSegment> *_ptr)
+    {
+      for (const auto &segment : *_ptr)
+      {
+        if (segment.release)
+          segment.release();
+      }
+      delete _ptr;
+    });
+
+  if (!this->dataPtr->Valid())
+    return false;
+
+  const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
+
+  if (publisherMsgType != _msgType && publisherMsgType != kGenericMessageType)
+  {
+    std::cerr << "Node::Publisher::PublishSegments() type mismatch.\n"
+              << "\t* Type advertised: "
+              << this->dataPtr->publisher.MsgTypeName()
+              << "\n\t* Type published: " << _msgType << std::endl;
+    return false;
+  }
+
+  const auto snapshot = this->dataPtr->Subscribers(_msgType);
+  const NodeShared::SubscriberInfo &subscribers = snapshot->info;
+
+  // Local subscribers, late subscribers and the sender thread need a
+  // contiguous message, so the segments are gathered once into a loaned
+  // buffer.
+  const AdvertiseMessageOptions &opts = this->dataPtr->publisher.Options();
+  if (subscribers.haveLocal || subscribers.haveRaw ||
+      this->dataPtr->Durable() || opts.Conflated() ||
+      opts.PublishMode() == PublishMode_t::ASYNC)
+  {
+    std::size_t size = 0;
+    for (const auto &segment : *segments)
+      size += segment.size;
+
+    char *msgBuffer = this->Loan(size);
+    if (!msgBuffer)
+      return false;
+
+    std::size_t offset = 0;
+    for (const auto &segment : *segments)
+    {
+      if (segment.size > 0)
+        memcpy(msgBuffer + offset, segment.data, segment.size);
+      offset += segment.size;
+    }
+    segments.reset();
+
+    return this->PublishLoaned(msgBuffer, size, _msgType);
+  }
+
+  if (!this->dataPtr->UpdateThrottling())
+    return true;
+
+  if (!this->dataPtr->RemoteUpdateReady(subscribers))
+    return true;
+
+  IGN_TRANSPORT_TRACE_NEW_CONTEXT();
+
+  return this->dataPtr->shared->PublishSegments(
+    this->dataPtr->publisher.Topic(), segments, _msgType);
+}
+
+//////////////////////////////////////////////////
+std::future<bool> Node::Publisher::PublishAcked(const ProtoMsg &_msg)
+{
+  std::future<bool> future;
+  auto fail = [&future]()
+  {
+    std::promise<bool> promise;
+    future = promise.get_future();
+    promise.set_value(false);
+    return std::move(future);
+  };
+
+  if (!this->dataPtr->Valid())
+    return fail();
+
+  const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
+
+  // Check that the msg type matches the topic type previously advertised.
+  if (publisherMsgType != _msg.GetTypeName())
   {
-    const std::size_t msgSize = _msgData.size();
-    char *msgBuffer = static_cast<char *>(new char[msgSize]);
-    memcpy(msgBuffer, _msgData.c_str(), msgSize);
-    auto myDeallocator = [](void *_buffer, void * /*_hint*/)
+    std::cerr << "Node::Publisher::PublishAcked() Type mismatch.\n"
+              << "\t* Type advertised: "
+              << this->dataPtr->publisher.MsgTypeName()
+              << "\n\t* Type published: " << _msg.GetTypeName() << std::endl;
+    return fail();
+  }
+
+  NodeSharedPrivate &sharedPrivate = *this->dataPtr->shared->dataPtr;
+  const std::string &topic = this->dataPtr->publisher.Topic();
+
+  // A throttled message has nobody to wait for.
+  if (!this->dataPtr->UpdateThrottling())
+  {
+    sharedPrivate.pendingAcks.Add({}, 0u, future);
+    return future;
+  }
+
+  IGN_TRANSPORT_TRACE_NEW_CONTEXT();
+
+  const auto snapshot = this->dataPtr->Subscribers();
+  const NodeShared::SubscriberInfo &subscribers = snapshot->info;
+  if (subscribers.haveRemote &&
+      !this->dataPtr->publisher.Options().Acknowledged())
+  {
+    std::cerr << "Node::Publisher::PublishAcked(): Topic [" << topic
+              << "] has remote subscribers, advertise it with "
+              << "AdvertiseMessageOptions::SetAcknowledged()" << std::endl;
+    return fail();
+  }
+  const bool sendRemote = this->dataPtr->RemoteUpdateReady(subscribers);
+  const bool local = subscribers.haveLocal || subscribers.haveRaw;
+
+  // The message is serialized once for all the subscribers.
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+  const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSizeLong());
+#else
+  const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSize());
+#endif
+  std::shared_ptr<char> msgBuffer = BufferAllocator::Shared(msgSize);
+  if (!msgBuffer)
+  {
+    std::cerr << "Node::Publisher::PublishAcked(): Unable to allocate ["
+              << msgSize << "] bytes" << std::endl;
+    return fail();
+  }
+  if (!_msg.SerializeToArray(msgBuffer.get(), static_cast<int>(msgSize)))
+  {
+    std::cerr << "Node::Publisher::PublishAcked(): Error serializing data"
+              << std::endl;
+    return fail();
+  }
+
+  if (this->dataPtr->Durable())
+  {
+    sharedPrivate.RetainLastValue(topic,
+      {msgBuffer, msgSize, _msg.GetTypeName()});
+  }
+
+  // Register the message before sending it, the acknowledgements might
+  // arrive before this function returns.
+  const uint64_t ackId = sharedPrivate.pendingAcks.Add(
+    sendRemote ? sharedPrivate.AckSubscribers(topic) :
+      std::set<std::string>(), local ? 1u : 0u, future);
+  if (ackId == 0)
+    return future;
+
+  if (local)
+  {
+    this->dataPtr->QueueLocal(subscribers, _msg.GetTypeName(), msgBuffer,
+      msgSize, "Node::Publisher::PublishAcked()", ackId);
+  }
+
+  if (sendRemote)
+  {
+    auto deallocator = [](void * /*_buffer*/, void *_hint)
     {
-      delete[] reinterpret_cast<char*>(_buffer);
+      delete reinterpret_cast<std::shared_ptr<char> *>(_hint);
     };
+    if (!this->dataPtr->shared->Publish(topic, msgBuffer.get(), msgSize,
+          deallocator, _msg.GetTypeName(),
+          new std::shared_ptr<char>(msgBuffer), ackId))
+    {
+      sharedPrivate.pendingAcks.Cancel(ackId);
+    }
+  }
+
+  return future;
+}
+
+//////////////////////////////////////////////////
+char *Node::Publisher::Loan(const std::size_t _size)
+{
+  if (!this->dataPtr->Valid())
+    return nullptr;
+
+  std::shared_ptr<BufferPool> pool;
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+    if (!this->dataPtr->bufferPool)
+      this->dataPtr->bufferPool = BufferPool::Create();
+    pool = this->dataPtr->bufferPool;
+  }
+
+  return pool->Loan(_size);
+}
+
+//////////////////////////////////////////////////
+void Node::Publisher::ReturnLoan(char *_data)
+{
+  if (!BufferPool::IsLoaned(_data))
+  {
+    std::cerr << "Node::Publisher::ReturnLoan(): Buffer is not loaned"
+              << std::endl;
+    return;
+  }
+
+  BufferPool::Release(_data);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishLoaned(
+    char *_data,
+    const std::size_t _size,
+    const std::string &_msgType)
+{
+  return this->PublishLoanedHelper(_data, _size, _msgType, false);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishLoanedTyped(char *_data, const std::size_t _size)
+{
+  return this->PublishLoanedHelper(_data, _size,
+    this->dataPtr->publisher.MsgTypeName(), true);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishLoanedHelper(
+    char *_data,
+    const std::size_t _size,
+    const std::string &_msgType,
+    const bool _typeChecked)
+{
+  if (!BufferPool::IsLoaned(_data))
+  {
+    std::cerr << "Node::Publisher::PublishLoaned(): Buffer is not loaned"
+              << std::endl;
+    return false;
+  }
+
+  // Release the caller's reference when leaving this function. Subscribers
+  // hold their own references while they need the data.
+  std::unique_ptr<char, void(*)(char *)> loan(_data, &BufferPool::Release);
+
+  if (_size > BufferPool::Capacity(_data))
+  {
+    std::cerr << "Node::Publisher::PublishLoaned(): Size [" << _size
+              << "] exceeds the capacity of the loaned buffer ["
+              << BufferPool::Capacity(_data) << "]" << std::endl;
+    return false;
+  }
+
+  if (!this->dataPtr->Valid())
+    return false;
+
+  const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
+
+  if (!_typeChecked && publisherMsgType != _msgType &&
+      publisherMsgType != kGenericMessageType)
+  {
+    std::cerr << "Node::Publisher::PublishLoaned() type mismatch.\n"
+              << "\t* Type advertised: "
+              << this->dataPtr->publisher.MsgTypeName()
+              << "\n\t* Type published: " << _msgType << std::endl;
+    return false;
+  }
+
+  if (!this->dataPtr->UpdateThrottling())
+    return true;
+
+  const auto snapshot = this->dataPtr->Subscribers(_msgType);
+  const NodeShared::SubscriberInfo &subscribers = snapshot->info;
+
+  // The loaned buffer returns to the pool, so the late subscribers get a
+  // copy.
+  if (this->dataPtr->Durable() &&
+      !this->dataPtr->CopyLastValue(_data, _size, _msgType))
+  {
+    return false;
+  }
+
+  // Local and raw subscribers are served from the publish thread, which
+  // holds a reference to the loaned buffer.
+  if (subscribers.haveLocal || subscribers.haveRaw)
+  {
+    BufferPool::AddRef(_data);
+    this->dataPtr->QueueLocal(subscribers, _msgType,
+      std::shared_ptr<char>(_data, &BufferPool::Release), _size,
+      "Node::Publisher::PublishLoaned()");
+  }
 
-    // Note: This will copy _msgData (i.e. not zero copy)
-    if (!this->dataPtr->shared->Publish(
-          this->dataPtr->publisher.Topic(),
-          msgBuffer, msgSize, myDeallocator, _msgType))
+  // Remote subscribers. ZeroMQ releases its reference once the frame has
+  // been sent, which returns the buffer to the pool.
+  if (this->dataPtr->RemoteUpdateReady(subscribers))
+  {
+    BufferPool::AddRef(_data);
+    if (!this->dataPtr->SendRemote(
+          std::shared_ptr<char>(_data, &BufferPool::Release), _size,
+          _msgType))
     {
       return false;
     }
@@ -495,6 +1507,105 @@ bool Node::Publisher::PublishRaw(
   return true;
 }
 
+//////////////////////////////////////////////////
+bool Node::Publisher::Enqueue(const ProtoMsg &_msg)
+{
+  if (!this->Valid())
+    return false;
+
+  const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
+
+  // Check that the msg type matches the topic type previously advertised.
+  if (publisherMsgType != _msg.GetTypeName())
+  {
+    std::cerr << "Node::Publisher::Enqueue() Type mismatch.\n"
+              << "\t* Type advertised: "
+              << this->dataPtr->publisher.MsgTypeName()
+              << "\n\t* Type published: " << _msg.GetTypeName() << std::endl;
+    return false;
+  }
+
+  // Check the publication throttling option.
+  if (!this->UpdateThrottling())
+    return true;
+
+  // Nobody would receive the message.
+  const auto snapshot = this->dataPtr->Subscribers();
+  const NodeShared::SubscriberInfo &subscribers = snapshot->info;
+  if (!subscribers.haveLocal && !subscribers.haveRaw &&
+      !subscribers.haveRemote)
+  {
+    return true;
+  }
+
+  std::string data;
+  if (!_msg.SerializeToString(&data))
+  {
+    std::cerr << "Node::Publisher::Enqueue(): Error serializing data"
+              << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  this->dataPtr->batch.push_back(std::move(data));
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::Flush()
+{
+  if (!this->Valid())
+    return false;
+
+  std::vector<std::string> batch;
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+    batch.swap(this->dataPtr->batch);
+  }
+
+  if (batch.empty())
+    return true;
+
+  const std::string &msgType = this->dataPtr->publisher.MsgTypeName();
+
+  const auto snapshot = this->dataPtr->Subscribers();
+  const NodeShared::SubscriberInfo &subscribers = snapshot->info;
+
+  bool result = true;
+
+  // Remote subscribers receive the whole batch in a single message.
+  if (subscribers.haveRemote)
+  {
+    const std::size_t batchSize = BatchSize(batch);
+    std::shared_ptr<char> batchBuffer = BufferAllocator::Shared(batchSize);
+    if (!batchBuffer || !PackBatch(batch, batchBuffer.get()))
+    {
+      std::cerr << "Node::Publisher::Flush(): Error packing ["
+                << batch.size() << "] messages" << std::endl;
+      return false;
+    }
+
+    result = this->dataPtr->SendRemote(batchBuffer, batchSize,
+      kBatchMsgTypePrefix + msgType);
+  }
+
+  // Local and raw subscribers receive the messages one by one. The publish
+  // thread takes ownership of the serialized data.
+  if (subscribers.haveLocal || subscribers.haveRaw)
+  {
+    for (std::string &msg : batch)
+    {
+      const std::size_t msgSize = msg.size();
+      auto holder = std::make_shared<std::string>(std::move(msg));
+      this->dataPtr->QueueLocal(subscribers, msgType,
+        std::shared_ptr<char>(holder, &(*holder)[0]), msgSize,
+        "Node::Publisher::Flush()");
+    }
+  }
+
+  return result;
+}
+
 //////////////////////////////////////////////////
 bool Node::Publisher::ThrottledUpdateReady() const
 {
@@ -509,40 +1620,93 @@ bool Node::Publisher::UpdateThrottling()
 
 //////////////////////////////////////////////////
 Node::Node(const NodeOptions &_options)
-  : dataPtr(new NodePrivate())
+  : dataPtr(new NodePrivate(_options))
 {
-  // Generate the node UUID.
-  Uuid uuid;
-  this->dataPtr->nUuid = uuid.ToString();
+  // Each transport domain has its own sockets, threads and discovery.
+  this->dataPtr->shared = NodeShared::Instance(_options.Domain());
+
+  // Generate the node UUID. The UUIDs of a process only differ by a
+  // counter, which spares a random UUID per node.
+  this->dataPtr->nUuid = CompactUuid::Sequential().ToString();
+
+  // Create the queue of the callbacks run by the application, or the
+  // threads that run the subscription callbacks of this node.
+  if (_options.SpinCallbacks())
+  {
+    this->dataPtr->spinExecutor = CallbackExecutor::Manual(
+      this->dataPtr->shared->dataPtr->recvBudget);
+    std::lock_guard<std::mutex> lk(
+      this->dataPtr->shared->dataPtr->executorsMutex);
+    this->dataPtr->shared->dataPtr->nodeExecutors[this->dataPtr->nUuid] =
+      this->dataPtr->spinExecutor;
+    ++this->dataPtr->shared->dataPtr->spinNodes;
+  }
+  else if (_options.CallbackThreads() > 0)
+  {
+    auto executor = std::make_shared<CallbackExecutor>(
+      _options.CallbackThreads(), 0u, QueuePolicy_t::DROP_OLDEST, 0u,
+      this->dataPtr->shared->dataPtr->recvBudget);
+    std::lock_guard<std::mutex> lk(
+      this->dataPtr->shared->dataPtr->executorsMutex);
+    this->dataPtr->shared->dataPtr->nodeExecutors[this->dataPtr->nUuid] =
+      executor;
+  }
 
-  // Save the options.
-  this->dataPtr->options = _options;
+  // The discovery intervals apply to the whole process.
+  this->dataPtr->shared->SetDiscoveryIntervals(
+    _options.DiscoveryHeartbeatInterval(),
+    _options.DiscoverySilenceInterval());
+  this->dataPtr->shared->SetDiscoveryInterfaces(
+    _options.DiscoveryInterfaces());
+
+  // Keep the advertisements of this node's partition when the discovery
+  // filters them by partition.
+  this->dataPtr->shared->dataPtr->AddDiscoveryPartition(
+    _options.Partition());
 }
 
 //////////////////////////////////////////////////
 Node::~Node()
 {
   // Unsubscribe from all the topics.
-  auto subsTopics = this->SubscribedTopics();
-  for (auto const &topic : subsTopics)
-    this->Unsubscribe(topic);
+  this->dataPtr->UnsubscribeAll();
 
   // The list of subscribed topics should be empty.
   assert(this->SubscribedTopics().empty());
 
   // Unadvertise all my services.
-  auto advServices = this->AdvertisedServices();
-  for (auto const &service : advServices)
+  if (!this->dataPtr->UnadvertiseAllSrvs())
   {
-    if (!this->UnadvertiseSrv(service))
-    {
-      std::cerr << "Node::~Node(): Error unadvertising service ["
-                << service << "]" << std::endl;
-    }
+    std::cerr << "Node::~Node(): Error unadvertising services" << std::endl;
   }
 
   // The list of advertised services should be empty.
   assert(this->AdvertisedServices().empty());
+
+  // Stop keeping the services prefetched by this node resolved.
+  {
+    std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+    auto &resolved = this->dataPtr->shared->dataPtr->resolvedServices;
+    for (auto it = resolved.begin(); it != resolved.end();)
+    {
+      it->second.erase(this->NodeUuid());
+      if (it->second.empty())
+        it = resolved.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  // The statistics callbacks publish with this node.
+  for (auto const &topic : this->dataPtr->statsTopics)
+    this->dataPtr->shared->EnableStats(topic, false, nullptr);
+  if (this->dataPtr->metricsEnabled)
+    this->dataPtr->shared->EnableMetrics(false, nullptr, 0);
+
+  // Stop the threads that run the subscription callbacks of this node.
+  this->dataPtr->shared->dataPtr->RemoveExecutors({this->dataPtr->nUuid});
+  if (this->dataPtr->spinExecutor)
+    --this->dataPtr->shared->dataPtr->spinNodes;
 }
 
 //////////////////////////////////////////////////
@@ -556,8 +1720,8 @@ std::vector<std::string> Node::AdvertisedTopics() const
     std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
 
     auto pUUID = this->dataPtr->shared->pUuid;
-    auto &info = this->dataPtr->shared->dataPtr->msgDiscovery->Info();
-    info.PublishersByNode(pUUID, this->NodeUuid(), pubs);
+    this->dataPtr->shared->dataPtr->msgDiscovery->PublishersByNode(pUUID,
+      this->NodeUuid(), pubs);
   }
 
   // Copy the topics to a std::set for removing duplications.
@@ -595,44 +1759,94 @@ std::vector<std::string> Node::SubscribedTopics() const
 //////////////////////////////////////////////////
 bool Node::Unsubscribe(const std::string &_topic)
 {
-  // Topic remapping.
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
-
-  std::string fullyQualifiedTopic;
-  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-    this->Options().NameSpace(), _topic, fullyQualifiedTopic))
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
   {
-    std::cerr << "Topic [" << _topic << "] is not valid." << std::endl;
+    std::cerr << "Topic [" << this->RemappedTopic(_topic) << "] is not valid."
+              << std::endl;
     return false;
   }
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
-
-  // Remove the subscribers for the given topic that belong to this node.
-  this->dataPtr->shared->localSubscribers.RemoveHandlersForNode(
-        fullyQualifiedTopic, this->dataPtr->nUuid);
+  if (IsTopicPattern(fullyQualifiedTopic))
+    return this->dataPtr->UnsubscribeWildcard(fullyQualifiedTopic);
 
-  // Remove the topic from the list of subscribed topics in this node.
-  this->dataPtr->topicsSubscribed.erase(fullyQualifiedTopic);
+  const bool result = this->dataPtr->UnsubscribeHelper(fullyQualifiedTopic);
+  this->dataPtr->DisableUnsubscribedStats(fullyQualifiedTopic);
+  return result;
+}
+
+//////////////////////////////////////////////////
+void NodePrivate::DisableUnsubscribedStats(
+  const std::string &_fullyQualifiedTopic)
+{
+  if (!this->shared->dataPtr->CachedTopicStats(_fullyQualifiedTopic))
+    return;
+
+  {
+    std::lock_guard<std::recursive_mutex> lk(this->shared->mutex);
+    if (this->shared->localSubscribers.HasSubscriber(_fullyQualifiedTopic))
+      return;
+  }
+
+  this->shared->EnableStats(_fullyQualifiedTopic, false, nullptr);
+  this->statsTopics.erase(_fullyQualifiedTopic);
+}
+
+//////////////////////////////////////////////////
+bool NodePrivate::UnsubscribeHelper(const std::string &_fullyQualifiedTopic)
+{
+  // Executors of the subscriptions with a dedicated thread or a queue. They
+  // are destroyed after releasing the mutex, a running callback might need it.
+  std::vector<std::shared_ptr<CallbackExecutor>> executors;
+
+  std::lock_guard<std::recursive_mutex> lk(this->shared->mutex);
+
+  // Stop the dedicated threads of the subscriptions being removed.
+  std::vector<std::string> hUuids;
+  std::map<std::string, ISubscriptionHandler_M> normalHandlers;
+  if (this->shared->localSubscribers.normal.Handlers(
+        _fullyQualifiedTopic, normalHandlers))
+  {
+    for (const auto &handler : normalHandlers[this->nUuid])
+      hUuids.push_back(handler.first);
+  }
+  std::map<std::string, RawSubscriptionHandler_M> rawHandlers;
+  if (this->shared->localSubscribers.raw.Handlers(
+        _fullyQualifiedTopic, rawHandlers))
+  {
+    for (const auto &handler : rawHandlers[this->nUuid])
+      hUuids.push_back(handler.first);
+  }
+  executors = this->shared->dataPtr->RemoveExecutors(hUuids);
+
+  // Remove the subscribers for the given topic that belong to this node.
+  this->shared->localSubscribers.RemoveHandlersForNode(
+        _fullyQualifiedTopic, this->nUuid);
+  this->shared->dataPtr->SubscribersChanged();
+  this->shared->dataPtr->InvalidateHandlers(_fullyQualifiedTopic);
+
+  // Remove the topic from the list of subscribed topics in this node.
+  this->topicsSubscribed.erase(_fullyQualifiedTopic);
 
   // Remove the filter for this topic if I am the last subscriber.
-  if (!this->dataPtr->shared->localSubscribers
-      .HasSubscriber(fullyQualifiedTopic))
+  if (!this->shared->localSubscribers
+      .HasSubscriber(_fullyQualifiedTopic))
   {
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->dataPtr->shared->dataPtr->subscriber->set(
-      zmq::sockopt::unsubscribe, fullyQualifiedTopic);
-#else
-    this->dataPtr->shared->dataPtr->subscriber->setsockopt(
-      ZMQ_UNSUBSCRIBE, fullyQualifiedTopic.data(), fullyQualifiedTopic.size());
-#endif
+    this->shared->dataPtr->RemoveTopicFilter(_fullyQualifiedTopic);
+
+    // Also stop receiving the topic from the publishers that use an alias.
+    this->shared->dataPtr->RemoveTopicAliases(
+      [&_fullyQualifiedTopic](const NodeSharedPrivate::TopicAliasInfo &_info)
+      {
+        return _info.topic == _fullyQualifiedTopic;
+      });
   }
 
   // Notify to the publishers that I am no longer interested in the topic.
   MsgAddresses_M addresses;
-  if (!this->dataPtr->shared->dataPtr->msgDiscovery->Publishers(
-        fullyQualifiedTopic, addresses))
+  if (!this->shared->dataPtr->msgDiscovery->Publishers(
+        _fullyQualifiedTopic, addresses))
   {
     return false;
   }
@@ -640,16 +1854,179 @@ bool Node::Unsubscribe(const std::string &_topic)
   for (auto &proc : addresses)
   {
     std::string dstPUuid = proc.first;
-    MessagePublisher pub(fullyQualifiedTopic, this->dataPtr->shared->myAddress,
-      dstPUuid, this->dataPtr->shared->pUuid, this->dataPtr->nUuid,
+    MessagePublisher pub(_fullyQualifiedTopic, this->shared->myAddress,
+      dstPUuid, this->shared->pUuid, this->nUuid,
       kGenericMessageType, AdvertiseMessageOptions());
 
-    this->Shared()->dataPtr->msgDiscovery->Unregister(pub);
+    this->shared->dataPtr->msgDiscovery->Unregister(pub);
   }
 
   return true;
 }
 
+//////////////////////////////////////////////////
+bool NodePrivate::UnsubscribeWildcard(const std::string &_fullyQualifiedPattern)
+{
+  // Topics subscribed because they matched the pattern.
+  std::set<std::string> topics;
+  {
+    std::lock_guard<std::recursive_mutex> lk(this->shared->mutex);
+
+    if (this->wildcardsSubscribed.erase(_fullyQualifiedPattern) == 0)
+      return false;
+
+    this->shared->dataPtr->wildcards.Remove(_fullyQualifiedPattern,
+      [this, &topics](
+        const std::shared_ptr<NodeSharedPrivate::WildcardSubscription> &_w)
+      {
+        if (_w->nUuid != this->nUuid)
+          return false;
+        topics.insert(_w->topics.begin(), _w->topics.end());
+        return true;
+      });
+  }
+
+  // The mutex is released, so the executors of the subscriptions are
+  // destroyed without it.
+  bool result = true;
+  for (const auto &topic : topics)
+  {
+    result = this->UnsubscribeHelper(topic) && result;
+    this->DisableUnsubscribedStats(topic);
+  }
+
+  return result;
+}
+
+//////////////////////////////////////////////////
+void NodePrivate::UnsubscribeAll()
+{
+  // Executors of the subscriptions with a dedicated thread or a queue. They
+  // are destroyed after releasing the mutex, a running callback might need it.
+  std::vector<std::shared_ptr<CallbackExecutor>> executors;
+
+  std::lock_guard<std::recursive_mutex> lk(this->shared->mutex);
+
+  // Stop matching the new topics against the patterns of this node.
+  for (const auto &pattern : this->wildcardsSubscribed)
+  {
+    this->shared->dataPtr->wildcards.Remove(pattern,
+      [this](
+        const std::shared_ptr<NodeSharedPrivate::WildcardSubscription> &_w)
+      {
+        return _w->nUuid == this->nUuid;
+      });
+  }
+  this->wildcardsSubscribed.clear();
+
+  if (this->topicsSubscribed.empty())
+    return;
+
+  auto &localSubscribers = this->shared->localSubscribers;
+
+  // Stop the dedicated threads of all the subscriptions of this node.
+  std::vector<std::string> hUuids;
+  for (const auto &topic : this->topicsSubscribed)
+  {
+    std::map<std::string, ISubscriptionHandler_M> normalHandlers;
+    if (localSubscribers.normal.Handlers(topic, normalHandlers))
+    {
+      for (const auto &handler : normalHandlers[this->nUuid])
+        hUuids.push_back(handler.first);
+    }
+    std::map<std::string, RawSubscriptionHandler_M> rawHandlers;
+    if (localSubscribers.raw.Handlers(topic, rawHandlers))
+    {
+      for (const auto &handler : rawHandlers[this->nUuid])
+        hUuids.push_back(handler.first);
+    }
+  }
+  executors = this->shared->dataPtr->RemoveExecutors(hUuids);
+
+  // Topics without any local subscriber left.
+  std::unordered_set<std::string> unfiltered;
+
+  // Publishers to notify that I am no longer interested in their topics.
+  std::vector<MessagePublisher> unregistrations;
+
+  for (const auto &topic : this->topicsSubscribed)
+  {
+    localSubscribers.RemoveHandlersForNode(topic, this->nUuid);
+    this->shared->dataPtr->InvalidateHandlers(topic);
+
+    // Remove the filter for this topic if I am the last subscriber.
+    if (!localSubscribers.HasSubscriber(topic))
+    {
+      this->shared->dataPtr->RemoveTopicFilter(topic);
+      unfiltered.insert(topic);
+    }
+
+    MsgAddresses_M addresses;
+    if (!this->shared->dataPtr->msgDiscovery->Publishers(topic, addresses))
+      continue;
+
+    for (const auto &proc : addresses)
+    {
+      unregistrations.emplace_back(topic, this->shared->myAddress,
+        proc.first, this->shared->pUuid, this->nUuid, kGenericMessageType,
+        AdvertiseMessageOptions());
+    }
+  }
+  this->shared->dataPtr->SubscribersChanged();
+  this->topicsSubscribed.clear();
+
+  // Also stop receiving the topics from the publishers that use an alias.
+  if (!unfiltered.empty())
+  {
+    this->shared->dataPtr->RemoveTopicAliases(
+      [&unfiltered](const NodeSharedPrivate::TopicAliasInfo &_info)
+      {
+        return unfiltered.count(_info.topic) > 0;
+      });
+  }
+
+  this->shared->dataPtr->msgDiscovery->Unregister(unregistrations);
+}
+
+//////////////////////////////////////////////////
+bool NodePrivate::UnadvertiseAllSrvs()
+{
+  // Executors of the services with a maximum concurrency. They are destroyed
+  // after releasing the mutex, a running request might need it.
+  std::vector<std::shared_ptr<CallbackExecutor>> executors;
+
+  std::lock_guard<std::recursive_mutex> lk(this->shared->mutex);
+
+  if (this->srvsAdvertised.empty())
+    return true;
+
+  // Stop the worker threads of all the services of this node.
+  std::vector<std::string> hUuids;
+  for (const auto &topic : this->srvsAdvertised)
+  {
+    std::map<std::string, std::map<std::string, IRepHandlerPtr>> repHandlers;
+    if (this->shared->repliers.Handlers(topic, repHandlers))
+    {
+      for (const auto &handler : repHandlers[this->nUuid])
+        hUuids.push_back(handler.first);
+    }
+  }
+  executors = this->shared->dataPtr->RemoveExecutors(hUuids);
+
+  // Remove all the REP handlers for this node.
+  for (const auto &topic : this->srvsAdvertised)
+    this->shared->repliers.RemoveHandlersForNode(topic, this->nUuid);
+  this->srvsAdvertised.clear();
+
+  // Nothing was advertised if the services were never initialized.
+  if (!this->shared->dataPtr->srvDiscovery)
+    return true;
+
+  // Notify the discovery service to unregister and unadvertise all my
+  // services at once.
+  return this->shared->dataPtr->srvDiscovery->UnadvertiseNode(this->nUuid);
+}
+
 //////////////////////////////////////////////////
 std::vector<std::string> Node::AdvertisedServices() const
 {
@@ -668,185 +2045,772 @@ std::vector<std::string> Node::AdvertisedServices() const
 }
 
 //////////////////////////////////////////////////
-bool Node::UnadvertiseSrv(const std::string &_topic)
+bool Node::AdvertiseRaw(const std::string &_topic,
+  const std::string &_reqType, const std::string &_repType,
+  const RawRepCallback &_callback, const AdvertiseServiceOptions &_options)
 {
-  // Topic remapping.
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
+  {
+    std::cerr << "Service [" << this->RemappedTopic(_topic)
+              << "] is not valid." << std::endl;
+    return false;
+  }
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-  std::string fullyQualifiedTopic;
-  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-    this->Options().NameSpace(), _topic, fullyQualifiedTopic))
+  auto repHandlerPtr = std::make_shared<RawRepHandler>(_reqType, _repType);
+  repHandlerPtr->SetCallback(_callback);
+  repHandlerPtr->SetMaxConcurrency(_options.MaxConcurrency());
+  repHandlerPtr->SetMaxQueue(_options.MaxQueue());
+  repHandlerPtr->SetResponseCacheTtl(_options.ResponseCacheTtl());
+
+  NodeShared *shared = this->dataPtr->shared;
+  std::lock_guard<std::recursive_mutex> lk(shared->mutex);
+
+  if (!shared->EnsureServices())
+    return false;
+
+  this->dataPtr->srvsAdvertised.insert(fullyQualifiedTopic);
+  shared->repliers.AddHandler(
+    fullyQualifiedTopic, this->NodeUuid(), repHandlerPtr);
+
+  // Notify the discovery service to register and advertise my responser.
+  ServicePublisher publisher(fullyQualifiedTopic,
+    shared->myReplierAddress, shared->replierId.ToString(),
+    shared->pUuid, this->NodeUuid(), _reqType, _repType, _options);
+
+  if (!shared->AdvertisePublisher(publisher))
+  {
+    std::cerr << "Node::AdvertiseRaw(): Error advertising service ["
+              << this->RemappedTopic(_topic)
+              << "]. Did you forget to start the discovery service?"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::RequestRaw(const std::string &_topic,
+  const std::string &_request, const std::string &_reqType,
+  const std::string &_repType, const unsigned int _timeout,
+  std::string &_response, bool &_result)
+{
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
   {
-    std::cerr << "Service [" << _topic << "] is not valid." << std::endl;
+    std::cerr << "Service [" << this->RemappedTopic(_topic)
+              << "] is not valid." << std::endl;
     return false;
   }
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+  NodeShared *shared = this->dataPtr->shared;
+
+  // If the responser is within my process, call it directly.
+  IRepHandlerPtr repHandler;
+  bool localResponserFound;
+  {
+    std::lock_guard<std::recursive_mutex> lk(shared->mutex);
+    localResponserFound = shared->repliers.FirstHandler(
+      fullyQualifiedTopic, _reqType, _repType, repHandler);
+  }
+
+  if (localResponserFound)
+  {
+    _response.clear();
+    _result = repHandler->RunCachedCallback(_request, _response);
+    return true;
+  }
+
+  auto reqHandlerPtr = std::make_shared<RawReqHandler>(
+    this->NodeUuid(), _request, _reqType, _repType);
+  reqHandlerPtr->SetDeadline(std::chrono::steady_clock::now() +
+    std::chrono::milliseconds(_timeout));
+
+  std::unique_lock<std::recursive_mutex> lk(shared->mutex);
+
+  if (!shared->EnsureServices())
+    return false;
+
+  shared->requests.AddHandler(fullyQualifiedTopic,
+    reqHandlerPtr->NodeId(), reqHandlerPtr->HandlerId(), reqHandlerPtr);
+
+  // If the responser's address is known, make the request.
+  SrvAddresses_M addresses;
+  if (shared->TopicPublishers(fullyQualifiedTopic, addresses))
+    shared->SendPendingRemoteReqs(fullyQualifiedTopic, _reqType, _repType);
+  else if (!shared->DiscoverService(fullyQualifiedTopic))
+  {
+    std::cerr << "Node::RequestRaw(): Error discovering service ["
+              << this->RemappedTopic(_topic)
+              << "]. Did you forget to start the discovery service?"
+              << std::endl;
+    return false;
+  }
+
+  // Wait until the REP is available.
+  if (!reqHandlerPtr->WaitUntil(lk, _timeout))
+  {
+    shared->CancelRemoteReq(fullyQualifiedTopic, reqHandlerPtr);
+    return false;
+  }
+
+  _result = reqHandlerPtr->Result();
+  _response = _result ? reqHandlerPtr->Response() : std::string();
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::RequestRaw(const std::string &_topic,
+  const std::string &_request, const std::string &_reqType,
+  const std::string &_repType, const RawReqCallback &_callback)
+{
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
+  {
+    std::cerr << "Service [" << this->RemappedTopic(_topic)
+              << "] is not valid." << std::endl;
+    return false;
+  }
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+  NodeShared *shared = this->dataPtr->shared;
+
+  // If the responser is within my process, call it directly.
+  IRepHandlerPtr repHandler;
+  bool localResponserFound;
+  {
+    std::lock_guard<std::recursive_mutex> lk(shared->mutex);
+    localResponserFound = shared->repliers.FirstHandler(
+      fullyQualifiedTopic, _reqType, _repType, repHandler);
+  }
+
+  if (localResponserFound)
+  {
+    std::string rep;
+    const bool result = repHandler->RunCachedCallback(_request, rep);
+    if (_callback)
+      _callback(rep, result);
+    return true;
+  }
+
+  auto reqHandlerPtr = std::make_shared<RawReqHandler>(
+    this->NodeUuid(), _request, _reqType, _repType);
+  reqHandlerPtr->SetCallback(_callback);
+
+  std::lock_guard<std::recursive_mutex> lk(shared->mutex);
+
+  if (!shared->EnsureServices())
+    return false;
+
+  shared->requests.AddHandler(fullyQualifiedTopic,
+    reqHandlerPtr->NodeId(), reqHandlerPtr->HandlerId(), reqHandlerPtr);
+
+  // If the responser's address is known, make the request.
+  SrvAddresses_M addresses;
+  if (shared->TopicPublishers(fullyQualifiedTopic, addresses))
+    shared->SendPendingRemoteReqs(fullyQualifiedTopic, _reqType, _repType);
+  else if (!shared->DiscoverService(fullyQualifiedTopic))
+  {
+    std::cerr << "Node::RequestRaw(): Error discovering service ["
+              << this->RemappedTopic(_topic)
+              << "]. Did you forget to start the discovery service?"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::PrefetchServices(const std::vector<std::string> &_services,
+  const bool _keepResolved)
+{
+  std::vector<std::string> topics;
+  topics.reserve(_services.size());
+  for (const auto &service : _services)
+  {
+    auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(service);
+    if (!fullyQualifiedTopicPtr)
+    {
+      std::cerr << "Service [" << this->RemappedTopic(service)
+                << "] is not valid." << std::endl;
+      return false;
+    }
+    topics.push_back(*fullyQualifiedTopicPtr);
+  }
+
+  NodeShared *shared = this->dataPtr->shared;
+  std::lock_guard<std::recursive_mutex> lk(shared->mutex);
+
+  if (!shared->EnsureServices())
+    return false;
+
+  if (_keepResolved)
+  {
+    for (const auto &topic : topics)
+      shared->dataPtr->resolvedServices[topic].insert(this->NodeUuid());
+  }
+
+  // The responsers are connected as soon as they are discovered, so the
+  // first requests don't wait for the discovery.
+  if (!shared->dataPtr->srvDiscovery->Discover(topics))
+  {
+    std::cerr << "Node::PrefetchServices(): Error discovering the services. "
+              << "Did you forget to start the discovery service?"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::Ping(const std::string &_pUuid, const unsigned int _timeout,
+  std::chrono::nanoseconds &_rtt, std::chrono::nanoseconds &_offset)
+{
+  auto toDuration = [](const msgs::Time &_time)
+  {
+    return std::chrono::seconds(_time.sec()) +
+      std::chrono::nanoseconds(_time.nsec());
+  };
+
+  msgs::Empty req;
+  msgs::Clock rep;
+  bool result = false;
+  const auto sent = std::chrono::system_clock::now().time_since_epoch();
+  const auto start = std::chrono::steady_clock::now();
+  if (!this->Request(NodeSharedPrivate::kPingServicePrefix + _pUuid, req,
+        _timeout, rep, result) || !result)
+  {
+    return false;
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const auto received = std::chrono::system_clock::now().time_since_epoch();
+
+  // The other process received the request at "real" and sent the response
+  // at "system", by its clock.
+  const auto remoteReceived = toDuration(rep.real());
+  const auto remoteSent = toDuration(rep.system());
+  _rtt = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    elapsed - (remoteSent - remoteReceived));
+  _offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    ((remoteReceived - sent) + (remoteSent - received)) / 2);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::UnadvertiseSrv(const std::string &_topic)
+{
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
+  {
+    std::cerr << "Service [" << this->RemappedTopic(_topic)
+              << "] is not valid." << std::endl;
+    return false;
+  }
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+  // Executors of the services with a maximum concurrency. They are destroyed
+  // after releasing the mutex, a running request might need it.
+  std::vector<std::shared_ptr<CallbackExecutor>> executors;
 
   std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
 
   // Remove the topic from the list of advertised topics in this node.
   this->dataPtr->srvsAdvertised.erase(fullyQualifiedTopic);
 
+  // Stop the worker threads of the services being removed.
+  std::vector<std::string> hUuids;
+  std::map<std::string, std::map<std::string, IRepHandlerPtr>> repHandlers;
+  if (this->dataPtr->shared->repliers.Handlers(
+        fullyQualifiedTopic, repHandlers))
+  {
+    for (const auto &handler : repHandlers[this->dataPtr->nUuid])
+      hUuids.push_back(handler.first);
+  }
+  executors = this->dataPtr->shared->dataPtr->RemoveExecutors(hUuids);
+
   // Remove all the REP handlers for this node.
   this->dataPtr->shared->repliers.RemoveHandlersForNode(
     fullyQualifiedTopic, this->dataPtr->nUuid);
 
   // Notify the discovery service to unregister and unadvertise my services.
-  if (!this->dataPtr->shared->dataPtr->srvDiscovery->Unadvertise(
+  if (!this->dataPtr->shared->dataPtr->srvDiscovery ||
+      !this->dataPtr->shared->dataPtr->srvDiscovery->Unadvertise(
         fullyQualifiedTopic, this->dataPtr->nUuid))
   {
     return false;
   }
 
-  return true;
+  return true;
+}
+
+//////////////////////////////////////////////////
+void Node::TopicList(std::vector<std::string> &_topics) const
+{
+  std::vector<std::string> allTopics;
+  _topics.clear();
+
+  this->dataPtr->shared->dataPtr->msgDiscovery->TopicList(allTopics);
+
+  for (const auto &fullyQualifiedTopic : allTopics)
+  {
+    std::string partition;
+    std::string topic;
+    TopicUtils::DecomposeFullyQualifiedTopic(
+          fullyQualifiedTopic, partition, topic);
+
+    // Remove the front '/'
+    if (!partition.empty())
+      partition.erase(partition.begin());
+
+    // Discard if the partition name does not match this node's partition.
+    if (partition != this->Options().Partition())
+      continue;
+
+    _topics.push_back(topic);
+  }
+}
+
+//////////////////////////////////////////////////
+void Node::ServiceList(std::vector<std::string> &_services) const
+{
+  std::vector<std::string> allServices;
+  _services.clear();
+
+  // Listing the services starts discovering them.
+  if (!this->dataPtr->shared->EnsureServices())
+    return;
+
+  this->dataPtr->shared->dataPtr->srvDiscovery->TopicList(allServices);
+
+  for (auto &service : allServices)
+  {
+    // Get the partition name.
+    std::string partition = service.substr(1, service.find_last_of("@") - 1);
+    // Remove the front '/'
+    if (!partition.empty())
+      partition.erase(partition.begin());
+
+    // Discard if the partition name does not match this node's partition.
+    if (partition != this->Options().Partition())
+      continue;
+
+    // Remove the partition part from the service.
+    service.erase(0, service.find_last_of("@") + 1);
+
+    _services.push_back(service);
+  }
+}
+
+//////////////////////////////////////////////////
+bool Node::SubscribeRaw(
+    const std::string &_topic,
+    const RawCallback &_callback,
+    const std::string &_msgType,
+    const SubscribeOptions &_opts)
+{
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
+  {
+    std::cerr << "Topic [" << this->RemappedTopic(_topic) << "] is not valid."
+              << std::endl;
+    return false;
+  }
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+  const std::shared_ptr<RawSubscriptionHandler> handlerPtr =
+      std::make_shared<RawSubscriptionHandler>(
+        this->dataPtr->nUuid, _msgType, _opts);
+
+  handlerPtr->SetCallback(_callback);
+
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+
+  this->dataPtr->shared->localSubscribers.raw.AddHandler(
+        fullyQualifiedTopic, this->dataPtr->nUuid, handlerPtr);
+
+  return this->dataPtr->SubscribeHelper(fullyQualifiedTopic, nullptr,
+    handlerPtr);
+}
+
+//////////////////////////////////////////////////
+bool Node::SubscribeRawWildcard(
+    const std::string &_pattern,
+    const RawCallback &_callback,
+    const std::string &_msgType,
+    const SubscribeOptions &_opts)
+{
+  auto fullyQualifiedPatternPtr = this->FullyQualifiedTopic(_pattern);
+  if (!fullyQualifiedPatternPtr)
+  {
+    std::cerr << "Pattern [" << this->RemappedTopic(_pattern)
+              << "] is not valid." << std::endl;
+    return false;
+  }
+  const std::string &fullyQualifiedPattern = *fullyQualifiedPatternPtr;
+
+  // "**" can only be the last segment.
+  const auto segments = TopicSegments(fullyQualifiedPattern);
+  for (std::size_t i = 0; i + 1 < segments.size(); ++i)
+  {
+    if (segments[i] == kWildcardTailSegment)
+    {
+      std::cerr << "Pattern [" << this->RemappedTopic(_pattern)
+                << "] is not valid, [" << kWildcardTailSegment
+                << "] must be the last segment." << std::endl;
+      return false;
+    }
+  }
+
+  auto wildcard = std::make_shared<NodeSharedPrivate::WildcardSubscription>();
+  wildcard->pattern = fullyQualifiedPattern;
+  wildcard->nUuid = this->dataPtr->nUuid;
+  wildcard->msgType = _msgType;
+
+  // Each topic matching the pattern gets its own raw subscription. The
+  // discovery requests are sent by the caller.
+  NodePrivate *self = this->dataPtr.get();
+  wildcard->subscribe =
+    [self, _callback, _msgType, _opts](const std::string &_topic)
+    {
+      auto handlerPtr = std::make_shared<RawSubscriptionHandler>(
+        self->nUuid, _msgType, _opts);
+      handlerPtr->SetCallback(_callback);
+
+      self->shared->localSubscribers.raw.AddHandler(
+        _topic, self->nUuid, handlerPtr);
+      self->topicsSubscribed.insert(_topic);
+      self->shared->dataPtr->SubscribersChanged();
+      self->shared->dataPtr->InvalidateHandlers(_topic);
+      self->shared->dataPtr->QueueLastValue(_topic, nullptr, handlerPtr);
+    };
+
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+
+  if (!this->dataPtr->wildcardsSubscribed.insert(
+        fullyQualifiedPattern).second)
+  {
+    std::cerr << "Node::SubscribeRawWildcard(): Pattern ["
+              << this->RemappedTopic(_pattern) << "] is already subscribed"
+              << std::endl;
+    return false;
+  }
+
+  auto &sharedPrivate = this->dataPtr->shared->dataPtr;
+  sharedPrivate->wildcards.Insert(fullyQualifiedPattern, wildcard);
+
+  // Match the topics already known.
+  std::vector<std::string> topics;
+  sharedPrivate->msgDiscovery->TopicList(topics);
+  std::vector<std::string> matched;
+  for (const auto &topic : topics)
+  {
+    MsgAddresses_M addresses;
+    std::string msgType = kGenericMessageType;
+    if (sharedPrivate->msgDiscovery->Publishers(topic, addresses) &&
+        !addresses.empty() && !addresses.begin()->second.empty())
+    {
+      msgType = addresses.begin()->second.front().MsgTypeName();
+    }
+
+    const std::size_t before = wildcard->topics.size();
+    sharedPrivate->MatchWildcards(topic, msgType);
+    if (wildcard->topics.size() > before)
+      matched.push_back(topic);
+  }
+
+  if (matched.empty())
+    return true;
+
+  // Connect to the publishers of the topics matched.
+  if (!sharedPrivate->msgDiscovery->Discover(matched))
+  {
+    std::cerr << "Node::SubscribeRawWildcard(): Error discovering ["
+              << matched.size() << "] topics. Did you forget to start the "
+              << "discovery service?" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+const NodeOptions &Node::Options() const
+{
+  return this->dataPtr->options;
+}
+
+//////////////////////////////////////////////////
+std::size_t Node::SpinSome(const std::size_t _max)
+{
+  // A callback may destroy the node.
+  std::shared_ptr<CallbackExecutor> executor = this->dataPtr->spinExecutor;
+  if (!executor)
+    return 0;
+  return executor->RunSome(_max);
+}
+
+//////////////////////////////////////////////////
+std::size_t Node::SpinUntil(
+  const std::chrono::steady_clock::time_point &_deadline)
+{
+  // A callback may destroy the node.
+  std::shared_ptr<CallbackExecutor> executor = this->dataPtr->spinExecutor;
+  if (!executor)
+    return 0;
+  return executor->RunUntil(_deadline);
+}
+
+//////////////////////////////////////////////////
+int Node::SpinFd() const
+{
+  if (!this->dataPtr->spinExecutor)
+    return -1;
+  return this->dataPtr->spinExecutor->ReadyFd();
+}
+
+//////////////////////////////////////////////////
+std::optional<TopicStatistics> Node::TopicStats(
+    const std::string &_topic) const
+{
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
+    return std::nullopt;
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
+
+
+  return this->dataPtr->shared->TopicStats(fullyQualifiedTopic);
 }
 
 //////////////////////////////////////////////////
-void Node::TopicList(std::vector<std::string> &_topics) const
+std::vector<ConnectionStatistics> Node::ConnectionStats() const
 {
-  std::vector<std::string> allTopics;
-  _topics.clear();
+  return this->dataPtr->shared->ConnectionStats();
+}
 
-  this->dataPtr->shared->dataPtr->msgDiscovery->TopicList(allTopics);
+//////////////////////////////////////////////////
+uint64_t Node::SubscriptionDroppedMsgs(const std::string &_topic) const
+{
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
+    return 0;
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-  for (const auto &fullyQualifiedTopic : allTopics)
+  std::vector<std::string> hUuids;
   {
-    std::string partition;
-    std::string topic;
-    TopicUtils::DecomposeFullyQualifiedTopic(
-          fullyQualifiedTopic, partition, topic);
-
-    // Remove the front '/'
-    if (!partition.empty())
-      partition.erase(partition.begin());
+    std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
 
-    // Discard if the partition name does not match this node's partition.
-    if (partition != this->Options().Partition())
-      continue;
+    std::map<std::string, ISubscriptionHandler_M> normalHandlers;
+    if (this->dataPtr->shared->localSubscribers.normal.Handlers(
+          fullyQualifiedTopic, normalHandlers))
+    {
+      for (const auto &handler : normalHandlers[this->dataPtr->nUuid])
+        hUuids.push_back(handler.first);
+    }
+    std::map<std::string, RawSubscriptionHandler_M> rawHandlers;
+    if (this->dataPtr->shared->localSubscribers.raw.Handlers(
+          fullyQualifiedTopic, rawHandlers))
+    {
+      for (const auto &handler : rawHandlers[this->dataPtr->nUuid])
+        hUuids.push_back(handler.first);
+    }
+  }
 
-    _topics.push_back(topic);
+  // The executor of a subscription with a queue is created with its first
+  // message.
+  uint64_t dropped = 0;
+  std::lock_guard<std::mutex> lk(
+    this->dataPtr->shared->dataPtr->executorsMutex);
+  for (const std::string &hUuid : hUuids)
+  {
+    auto it = this->dataPtr->shared->dataPtr->handlerExecutors.find(hUuid);
+    if (it != this->dataPtr->shared->dataPtr->handlerExecutors.end())
+      dropped += it->second.executor->Dropped();
   }
+  return dropped;
 }
 
 //////////////////////////////////////////////////
-void Node::ServiceList(std::vector<std::string> &_services) const
+std::vector<CallbackStatistics> Node::CallbackStats(
+  const std::string &_topic) const
 {
-  std::vector<std::string> allServices;
-  _services.clear();
-
-  this->dataPtr->shared->dataPtr->srvDiscovery->TopicList(allServices);
+  std::vector<CallbackStatistics> result;
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
+    return result;
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-  for (auto &service : allServices)
+  auto add = [this, &_topic, &result](const auto &_handlers)
   {
-    // Get the partition name.
-    std::string partition = service.substr(1, service.find_last_of("@") - 1);
-    // Remove the front '/'
-    if (!partition.empty())
-      partition.erase(partition.begin());
-
-    // Discard if the partition name does not match this node's partition.
-    if (partition != this->Options().Partition())
-      continue;
+    auto it = _handlers.find(this->dataPtr->nUuid);
+    if (it == _handlers.end())
+      return;
 
-    // Remove the partition part from the service.
-    service.erase(0, service.find_last_of("@") + 1);
+    for (const auto &handler : it->second)
+    {
+      auto stats = handler.second->CallbackStats();
+      if (!stats)
+        continue;
+      stats->topic = _topic;
+      result.push_back(std::move(*stats));
+    }
+  };
 
-    _services.push_back(service);
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+  std::map<std::string, ISubscriptionHandler_M> normalHandlers;
+  if (this->dataPtr->shared->localSubscribers.normal.Handlers(
+        fullyQualifiedTopic, normalHandlers))
+  {
+    add(normalHandlers);
+  }
+  std::map<std::string, RawSubscriptionHandler_M> rawHandlers;
+  if (this->dataPtr->shared->localSubscribers.raw.Handlers(
+        fullyQualifiedTopic, rawHandlers))
+  {
+    add(rawHandlers);
   }
+  return result;
 }
 
 //////////////////////////////////////////////////
-bool Node::SubscribeRaw(
-    const std::string &_topic,
-    const RawCallback &_callback,
-    const std::string &_msgType,
-    const SubscribeOptions &_opts)
+bool Node::EnableStats(const std::string &_topic, bool _enable,
+    const std::string &_publicationTopic, uint64_t _publicationRate)
 {
-  // Topic remapping.
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
-
-  std::string fullyQualifiedTopic;
-  if (!TopicUtils::FullyQualifiedName(this->dataPtr->options.Partition(),
-                                      this->dataPtr->options.NameSpace(),
-                                      _topic, fullyQualifiedTopic))
-  {
-    std::cerr << "Topic [" << _topic << "] is not valid." << std::endl;
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
     return false;
-  }
-
-  const std::shared_ptr<RawSubscriptionHandler> handlerPtr =
-      std::make_shared<RawSubscriptionHandler>(
-        this->dataPtr->nUuid, _msgType, _opts);
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-  handlerPtr->SetCallback(_callback);
+  // The shared node throttles the callback.
+  if (!this->dataPtr->statPub)
+    this->dataPtr->statPub = std::make_unique<Publisher>();
+  *this->dataPtr->statPub = this->Advertise(_publicationTopic,
+      "ignition.msgs.Metric");
 
-  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+  // Callback used to publish a statistics message.
+  // cppcheck-suppress unreadVariable
+  std::function<void(const TopicStatistics &_stats)> statCb =
+    [this](const TopicStatistics &_stats)
+    {
+      msgs::Metric msg;
+      _stats.FillMessage(msg);
+
+      // State of the local publish queues of this process.
+      const NodeShared *shared = this->dataPtr->shared;
+      msgs::StatisticsGroup *statGroup = msg.add_statistics_groups();
+      statGroup->set_name("local_publish_queue_statistics");
+      msgs::Statistic *stat = statGroup->add_statistics();
+      stat->set_type(msgs::Statistic::SAMPLE_COUNT);
+      stat->set_name("depth");
+      stat->set_value(static_cast<double>(shared->LocalPublishQueueDepth()));
+
+      stat = statGroup->add_statistics();
+      stat->set_type(msgs::Statistic::MAXIMUM);
+      stat->set_name("high_water_mark");
+      stat->set_value(
+        static_cast<double>(shared->LocalPublishQueueHighWaterMark()));
+
+      stat = statGroup->add_statistics();
+      stat->set_type(msgs::Statistic::SAMPLE_COUNT);
+      stat->set_name("dropped_message_count");
+      stat->set_value(
+        static_cast<double>(shared->LocalPublishQueueDroppedMsgs()));
+
+      this->dataPtr->statPub->Publish(msg);
+    };
 
-  this->dataPtr->shared->localSubscribers.raw.AddHandler(
-        fullyQualifiedTopic, this->dataPtr->nUuid, handlerPtr);
+  this->dataPtr->shared->EnableStats(fullyQualifiedTopic, _enable,
+      statCb, _publicationRate);
+  if (_enable)
+    this->dataPtr->statsTopics.insert(fullyQualifiedTopic);
+  else
+    this->dataPtr->statsTopics.erase(fullyQualifiedTopic);
 
-  return this->dataPtr->SubscribeHelper(fullyQualifiedTopic);
+  return true;
 }
 
 //////////////////////////////////////////////////
-const NodeOptions &Node::Options() const
+std::optional<ServiceStatistics> Node::ServiceStats(
+    const std::string &_service) const
 {
-  return this->dataPtr->options;
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_service);
+  if (!fullyQualifiedTopicPtr)
+    return std::nullopt;
+
+  return this->dataPtr->shared->ServiceStats(*fullyQualifiedTopicPtr);
 }
 
 //////////////////////////////////////////////////
-std::optional<TopicStatistics> Node::TopicStats(
-    const std::string &_topic) const
+bool Node::EnableServiceStats(const std::string &_service, bool _enable,
+    const std::string &_publicationTopic, uint64_t _publicationRate)
 {
-  std::string fullyQualifiedTopic;
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_service);
+  if (!fullyQualifiedTopicPtr)
+    return false;
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
-  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-    this->Options().NameSpace(), topic, fullyQualifiedTopic))
+  if (!_enable)
   {
-    return std::nullopt;
+    this->dataPtr->shared->EnableServiceStats(fullyQualifiedTopic, false,
+      nullptr, 0);
+    return true;
   }
 
+  // The shared node throttles the callback.
+  if (!this->dataPtr->srvStatPub)
+    this->dataPtr->srvStatPub = std::make_unique<Publisher>();
+  *this->dataPtr->srvStatPub = this->Advertise(_publicationTopic,
+      "ignition.msgs.Metric");
 
-  return this->dataPtr->shared->TopicStats(fullyQualifiedTopic);
+  // Callback used to publish a statistics message.
+  // cppcheck-suppress unreadVariable
+  std::function<void(const ServiceStatistics &_stats)> statCb =
+    [this](const ServiceStatistics &_stats)
+    {
+      msgs::Metric msg;
+      _stats.FillMessage(msg);
+      this->dataPtr->srvStatPub->Publish(msg);
+    };
+
+  this->dataPtr->shared->EnableServiceStats(fullyQualifiedTopic, true,
+      statCb, _publicationRate);
+
+  return true;
 }
 
 //////////////////////////////////////////////////
-bool Node::EnableStats(const std::string &_topic, bool _enable,
-    const std::string &_publicationTopic, uint64_t _publicationRate)
+bool Node::EnableMetrics(bool _enable, const std::string &_publicationTopic,
+    uint64_t _publicationRate)
 {
-  std::string fullyQualifiedTopic;
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
-
-  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-    this->Options().NameSpace(), topic, fullyQualifiedTopic))
+  if (!_enable)
   {
-    return false;
+    if (this->dataPtr->metricsEnabled)
+      this->dataPtr->shared->EnableMetrics(false, nullptr, 0);
+    this->dataPtr->metricsEnabled = false;
+    return true;
   }
 
-  AdvertiseMessageOptions opts;
-  opts.SetMsgsPerSec(_publicationRate);
-  this->dataPtr->statPub = this->Advertise(_publicationTopic,
-      "ignition.msgs.Metric", opts);
+  if (!this->dataPtr->metricsPub)
+    this->dataPtr->metricsPub = std::make_unique<Publisher>();
+  *this->dataPtr->metricsPub = this->Advertise(_publicationTopic,
+      "ignition.msgs.Metric");
+  if (!*this->dataPtr->metricsPub)
+    return false;
 
-  // Callback used to publish a statistics message.
+  // Callback used to publish a metrics message.
   // cppcheck-suppress unreadVariable
-  std::function<void(const TopicStatistics &_stats)> statCb =
-    [=](const TopicStatistics &_stats) mutable
+  std::function<void(const MetricsRegistry &_metrics)> metricsCb =
+    [this](const MetricsRegistry &_metrics)
     {
-      if (this->dataPtr->statPub.ThrottledUpdateReady())
-      {
-        msgs::Metric msg;
-        _stats.FillMessage(msg);
-        this->dataPtr->statPub.Publish(msg);
-      }
+      msgs::Metric msg;
+      _metrics.FillMessage(msg);
+      this->dataPtr->metricsPub->Publish(msg);
     };
 
-  this->dataPtr->shared->EnableStats(fullyQualifiedTopic, _enable,
-      statCb);
+  this->dataPtr->shared->EnableMetrics(true, metricsCb, _publicationRate);
+  this->dataPtr->metricsEnabled = true;
 
   return true;
 }
@@ -863,6 +2827,48 @@ const std::string &Node::NodeUuid() const
   return this->dataPtr->nUuid;
 }
 
+//////////////////////////////////////////////////
+std::shared_ptr<const std::string> Node::FullyQualifiedTopic(
+    const std::string &_topic) const
+{
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->fullyQualifiedNamesMutex);
+    auto it = this->dataPtr->fullyQualifiedNames.find(_topic);
+    if (it != this->dataPtr->fullyQualifiedNames.end())
+      return it->second;
+  }
+
+  std::string fullyQualifiedTopic;
+  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
+    this->Options().NameSpace(), this->RemappedTopic(_topic),
+    fullyQualifiedTopic))
+  {
+    return nullptr;
+  }
+
+  auto name = std::make_shared<const std::string>(
+    std::move(fullyQualifiedTopic));
+
+  std::lock_guard<std::mutex> lk(this->dataPtr->fullyQualifiedNamesMutex);
+  if (this->dataPtr->fullyQualifiedNames.size() < NodePrivate::kMaxCachedNames)
+  {
+    // Another thread might have inserted the same name in the meantime, in
+    // which case emplace() keeps its entry and we share it.
+    return this->dataPtr->fullyQualifiedNames.emplace(
+      _topic, std::move(name)).first->second;
+  }
+
+  return name;
+}
+
+//////////////////////////////////////////////////
+std::string Node::RemappedTopic(const std::string &_topic) const
+{
+  std::string topic = _topic;
+  this->Options().TopicRemap(_topic, topic);
+  return topic;
+}
+
 //////////////////////////////////////////////////
 std::unordered_set<std::string> &Node::TopicsSubscribed() const
 {
@@ -923,6 +2929,9 @@ bool Node::TopicInfo(const std::string &_topic,
 bool Node::ServiceInfo(const std::string &_service,
                        std::vector<ServicePublisher> &_publishers) const
 {
+  if (!this->dataPtr->shared->EnsureServices())
+    return false;
+
   this->dataPtr->shared->dataPtr->srvDiscovery->WaitForInit();
 
   // Construct a topic name with the partition and namespace
@@ -964,60 +2973,242 @@ bool Node::ServiceInfo(const std::string &_service,
 }
 
 /////////////////////////////////////////////////
-Node::Publisher Node::Advertise(const std::string &_topic,
-    const std::string &_msgTypeName, const AdvertiseMessageOptions &_options)
+bool Node::AdvertiseHelper(const std::string &_topic,
+    const std::string &_msgTypeName, const AdvertiseMessageOptions &_options,
+    MessagePublisher &_publisher)
 {
-  // Topic remapping.
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
-
-  std::string fullyQualifiedTopic;
-  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+  auto fullyQualifiedTopicPtr = this->FullyQualifiedTopic(_topic);
+  if (!fullyQualifiedTopicPtr)
   {
-    std::cerr << "Topic [" << topic << "] is not valid." << std::endl;
-    return Publisher();
+    std::cerr << "Topic [" << this->RemappedTopic(_topic) << "] is not valid."
+              << std::endl;
+    return false;
   }
+  const std::string &fullyQualifiedTopic = *fullyQualifiedTopicPtr;
 
   auto currentTopics = this->AdvertisedTopics();
 
   if (std::find(currentTopics.begin(), currentTopics.end(),
         fullyQualifiedTopic) != currentTopics.end())
   {
-    std::cerr << "Topic [" << topic << "] already advertised. You cannot"
+    std::cerr << "Topic [" << this->RemappedTopic(_topic)
+      << "] already advertised. You cannot"
       << " advertise the same topic twice on the same node."
       << " If you want to advertise the same topic with different"
       << " types, use separate nodes" << std::endl;
-    return Publisher();
+    return false;
   }
 
   std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
 
-  // Notify the discovery service to register and advertise my topic.
-  MessagePublisher publisher(fullyQualifiedTopic,
-      this->Shared()->myAddress,
-      // this->Shared()->myControlAddress,
-      "unused",
+  // The retransmission requests and the acknowledgements arrive on the
+  // service replier.
+  if ((_options.Reliable() || _options.Acknowledged()) &&
+      !this->Shared()->EnsureServices())
+  {
+    std::cerr << "Node::Advertise(): Topic [" << this->RemappedTopic(_topic)
+              << "] can't be reliable or acknowledged without services"
+              << std::endl;
+    return false;
+  }
+
+  // Remember the compression settings of the topic. The cached send
+  // information of the topic has to be recomputed.
+  if (!CompressionAvailable(_options.Compression()))
+  {
+    std::cerr << "Node::Advertise(): Compression is not available in this "
+              << "build. Topic [" << this->RemappedTopic(_topic)
+              << "] will be sent uncompressed"
+              << std::endl;
+  }
+  const std::string topicKey =
+    NodeSharedPrivate::TopicKey(fullyQualifiedTopic, _msgTypeName);
+  this->Shared()->dataPtr->topicCompression[topicKey] =
+      {_options.Compression(), _options.CompressionThreshold()};
+
+  // Without a multicast socket, the topic is only sent over TCP.
+  std::string multicastGroup = _options.MulticastGroup();
+  if (!multicastGroup.empty())
+  {
+    zmq::socket_t *socket =
+      this->Shared()->dataPtr->MulticastPublisher(multicastGroup);
+    if (socket)
+      this->Shared()->dataPtr->topicMulticast[topicKey] = socket;
+    else
+      multicastGroup.clear();
+  }
+
+  // High priority topics are advertised with the address of their own
+  // socket, so the subscribers connect to it.
+  std::string addr = this->Shared()->myAddress;
+  if (_options.Priority() == Priority_t::HIGH)
+  {
+    if (this->Shared()->dataPtr->PriorityPublisher())
+    {
+      addr = this->Shared()->dataPtr->priorityAddress;
+      this->Shared()->dataPtr->priorityTopics.insert(topicKey);
+    }
+    else
+    {
+      std::cerr << "Node::Advertise(): Topic [" << this->RemappedTopic(_topic)
+                << "] will be sent with normal priority" << std::endl;
+    }
+  }
+
+  // The latest messages of a reliable topic are retained, so they can be
+  // sent again to the subscribers that missed them. The publishers of the
+  // topic in this process share the buffer.
+  std::string reliableCtrl;
+  if (_options.Reliable())
+  {
+    auto &buffer =
+      this->Shared()->dataPtr->retransmitBuffers[topicKey];
+    if (!buffer)
+    {
+      buffer = std::make_shared<RetransmitBuffer>(
+        _options.RetransmitBufferSize());
+    }
+    else
+    {
+      std::lock_guard<std::mutex> lock(
+        this->Shared()->dataPtr->publisherMutex);
+      buffer->SetCapacity(std::max<std::size_t>(buffer->Capacity(),
+        _options.RetransmitBufferSize()));
+    }
+    reliableCtrl = ReliableCtrl(this->Shared()->myReplierAddress,
+      this->Shared()->replierId.ToString());
+  }
+  if (_options.Acknowledged())
+  {
+    reliableCtrl += AckCtrl(this->Shared()->myReplierAddress,
+      this->Shared()->replierId.ToString());
+  }
+  this->Shared()->dataPtr->SubscribersChanged();
+
+  // The control field carries the topic ID, used by the subscribers to
+  // receive the topic with a compact alias, the multicast group and where
+  // to request the missing messages of a reliable topic or to send the
+  // acknowledgements.
+  _publisher = MessagePublisher(fullyQualifiedTopic, addr,
+      TopicIdCtrl(this->Shared()->dataPtr->TopicId(
+        fullyQualifiedTopic, _msgTypeName), multicastGroup) + reliableCtrl,
       this->Shared()->pUuid, this->NodeUuid(), _msgTypeName, _options);
 
+  return true;
+}
+
+/////////////////////////////////////////////////
+Node::Publisher Node::Advertise(const std::string &_topic,
+    const std::string &_msgTypeName, const AdvertiseMessageOptions &_options)
+{
+  MessagePublisher publisher;
+  if (!this->AdvertiseHelper(_topic, _msgTypeName, _options, publisher))
+    return Publisher();
+
+  std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+  // Notify the discovery service to register and advertise my topic.
   if (!this->Shared()->dataPtr->msgDiscovery->Advertise(publisher))
   {
     std::cerr << "Node::Advertise(): Error advertising topic ["
-      << topic
+      << this->RemappedTopic(_topic)
       << "]. Did you forget to start the discovery service?"
       << std::endl;
     return Publisher();
   }
 
-  return Publisher(publisher);
+  // The local wildcard subscriptions might match the topic.
+  this->Shared()->dataPtr->MatchWildcards(
+    publisher.Topic(), publisher.MsgTypeName());
+
+  return Publisher(publisher, this->Shared());
+}
+
+/////////////////////////////////////////////////
+std::vector<Node::Publisher> Node::AdvertiseMany(
+    const std::vector<std::string> &_topics, const std::string &_msgTypeName,
+    const AdvertiseMessageOptions &_options)
+{
+  std::vector<Publisher> result(_topics.size());
+
+  // Prepare all the publishers, skipping the invalid topics and the topics
+  // repeated in the list.
+  std::vector<MessagePublisher> publishers;
+  std::vector<std::size_t> indices;
+  std::unordered_set<std::string> batch;
+  for (std::size_t i = 0; i < _topics.size(); ++i)
+  {
+    MessagePublisher publisher;
+    if (!this->AdvertiseHelper(_topics[i], _msgTypeName, _options, publisher))
+      continue;
+
+    if (!batch.insert(publisher.Topic()).second)
+    {
+      std::cerr << "Node::AdvertiseMany(): Topic ["
+                << this->RemappedTopic(_topics[i]) << "] is repeated"
+                << std::endl;
+      continue;
+    }
+
+    publishers.push_back(publisher);
+    indices.push_back(i);
+  }
+
+  if (publishers.empty())
+    return result;
+
+  std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+  // Notify the discovery service to register and advertise all the topics
+  // with one update.
+  std::vector<bool> advertised;
+  if (!this->Shared()->dataPtr->msgDiscovery->Advertise(
+        publishers, advertised))
+  {
+    std::cerr << "Node::AdvertiseMany(): Error advertising ["
+              << publishers.size() << "] topics. Did you forget to start "
+              << "the discovery service?" << std::endl;
+    return result;
+  }
+
+  for (std::size_t i = 0; i < publishers.size(); ++i)
+  {
+    if (!advertised[i])
+      continue;
+
+    // The local wildcard subscriptions might match the topic.
+    this->Shared()->dataPtr->MatchWildcards(
+      publishers[i].Topic(), publishers[i].MsgTypeName());
+    result[indices[i]] = Publisher(publishers[i], this->Shared());
+  }
+
+  return result;
 }
 
 //////////////////////////////////////////////////
-bool NodePrivate::SubscribeHelper(const std::string &_fullyQualifiedTopic)
+bool NodePrivate::SubscribeHelper(const std::string &_fullyQualifiedTopic,
+  const ISubscriptionHandlerPtr &_handler,
+  const RawSubscriptionHandlerPtr &_rawHandler)
 {
   // Add the topic to the list of subscribed topics (if it was not before).
   this->topicsSubscribed.insert(_fullyQualifiedTopic);
 
+  // A new local handler has just been added.
+  this->shared->dataPtr->SubscribersChanged();
+  this->shared->dataPtr->InvalidateHandlers(_fullyQualifiedTopic);
+
+  // It joins late, the publishers of this process won't send it the latest
+  // message of a transient local topic again.
+  this->shared->dataPtr->QueueLastValue(_fullyQualifiedTopic, _handler,
+    _rawHandler);
+
+  // The discovery requests of a batch are sent at the end of it.
+  if (this->discoveryBatch > 0)
+  {
+    this->pendingDiscovery.push_back(_fullyQualifiedTopic);
+    return true;
+  }
+
   // Discover the list of nodes that publish on the topic.
   if (!this->shared->dataPtr->msgDiscovery->Discover(_fullyQualifiedTopic))
   {
@@ -1036,3 +3227,47 @@ bool Node::SubscribeHelper(const std::string &_fullyQualifiedTopic)
 {
   return this->dataPtr->SubscribeHelper(_fullyQualifiedTopic);
 }
+
+/////////////////////////////////////////////////
+bool Node::SubscribeHelper(const std::string &_fullyQualifiedTopic,
+  const ISubscriptionHandlerPtr &_handler)
+{
+  return this->dataPtr->SubscribeHelper(_fullyQualifiedTopic, _handler);
+}
+
+/////////////////////////////////////////////////
+void Node::BeginDiscoveryBatch()
+{
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+  ++this->dataPtr->discoveryBatch;
+}
+
+/////////////////////////////////////////////////
+bool Node::EndDiscoveryBatch()
+{
+  std::vector<std::string> topics;
+  {
+    std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+    if (this->dataPtr->discoveryBatch == 0 ||
+        --this->dataPtr->discoveryBatch > 0)
+    {
+      return true;
+    }
+    topics.swap(this->dataPtr->pendingDiscovery);
+  }
+
+  if (topics.empty())
+    return true;
+
+  // Discover the list of nodes that publish on all the topics at once.
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+  if (!this->dataPtr->shared->dataPtr->msgDiscovery->Discover(topics))
+  {
+    std::cerr << "Node::SubscribeMany(): Error discovering ["
+              << topics.size() << "] topics. Did you forget to start the "
+              << "discovery service?" << std::endl;
+    return false;
+  }
+
+  return true;
+}
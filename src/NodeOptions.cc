@@ -16,7 +16,9 @@
 */
 
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/NodeOptions.hh"
@@ -27,9 +29,19 @@
 using namespace ignition;
 using namespace transport;
 
+//////////////////////////////////////////////////
+/// \brief Stop sharing the private data with the copies of some options,
+/// before modifying them.
+/// \param[in, out] _dataPtr The private data of the options.
+static void Unshare(std::shared_ptr<NodeOptionsPrivate> &_dataPtr)
+{
+  if (_dataPtr.use_count() > 1)
+    _dataPtr = std::make_shared<NodeOptionsPrivate>(*_dataPtr);
+}
+
 //////////////////////////////////////////////////
 NodeOptions::NodeOptions()
-  : dataPtr(new NodeOptionsPrivate())
+  : dataPtr(std::make_shared<NodeOptionsPrivate>())
 {
   // Check if the environment variable IGN_PARTITION is present.
   std::string ignPartition;
@@ -39,9 +51,8 @@ NodeOptions::NodeOptions()
 
 //////////////////////////////////////////////////
 NodeOptions::NodeOptions(const NodeOptions &_other)
-  : dataPtr(new NodeOptionsPrivate())
+  : dataPtr(_other.dataPtr)
 {
-  (*this) = _other;
 }
 
 //////////////////////////////////////////////////
@@ -52,9 +63,7 @@ NodeOptions::~NodeOptions()
 //////////////////////////////////////////////////
 NodeOptions &NodeOptions::operator=(const NodeOptions &_other)
 {
-  this->SetNameSpace(_other.NameSpace());
-  this->SetPartition(_other.Partition());
-  this->dataPtr->topicsRemap = _other.dataPtr->topicsRemap;
+  this->dataPtr = _other.dataPtr;
   return *this;
 }
 
@@ -72,6 +81,7 @@ bool NodeOptions::SetNameSpace(const std::string &_ns)
     std::cerr << "Invalid namespace [" << _ns << "]" << std::endl;
     return false;
   }
+  Unshare(this->dataPtr);
   this->dataPtr->ns = _ns;
   return true;
 }
@@ -90,6 +100,7 @@ bool NodeOptions::SetPartition(const std::string &_partition)
     std::cerr << "Invalid partition name [" << _partition << "]" << std::endl;
     return false;
   }
+  Unshare(this->dataPtr);
   this->dataPtr->partition = _partition;
   return true;
 }
@@ -118,6 +129,7 @@ bool NodeOptions::AddTopicRemap(const std::string &_fromTopic,
     return false;
   }
 
+  Unshare(this->dataPtr);
   this->dataPtr->topicsRemap[_fromTopic] = _toTopic;
 
   return true;
@@ -134,3 +146,82 @@ bool NodeOptions::TopicRemap(const std::string &_fromTopic,
 
   return topicIt != this->dataPtr->topicsRemap.end();
 }
+
+//////////////////////////////////////////////////
+unsigned int NodeOptions::CallbackThreads() const
+{
+  return this->dataPtr->callbackThreads;
+}
+
+//////////////////////////////////////////////////
+void NodeOptions::SetCallbackThreads(const unsigned int _threads)
+{
+  Unshare(this->dataPtr);
+  this->dataPtr->callbackThreads = _threads;
+}
+
+//////////////////////////////////////////////////
+bool NodeOptions::SpinCallbacks() const
+{
+  return this->dataPtr->spinCallbacks;
+}
+
+//////////////////////////////////////////////////
+void NodeOptions::SetSpinCallbacks(const bool _spin)
+{
+  Unshare(this->dataPtr);
+  this->dataPtr->spinCallbacks = _spin;
+}
+
+//////////////////////////////////////////////////
+unsigned int NodeOptions::DiscoveryHeartbeatInterval() const
+{
+  return this->dataPtr->discoveryHeartbeatInterval;
+}
+
+//////////////////////////////////////////////////
+void NodeOptions::SetDiscoveryHeartbeatInterval(const unsigned int _ms)
+{
+  Unshare(this->dataPtr);
+  this->dataPtr->discoveryHeartbeatInterval = _ms;
+}
+
+//////////////////////////////////////////////////
+unsigned int NodeOptions::DiscoverySilenceInterval() const
+{
+  return this->dataPtr->discoverySilenceInterval;
+}
+
+//////////////////////////////////////////////////
+void NodeOptions::SetDiscoverySilenceInterval(const unsigned int _ms)
+{
+  Unshare(this->dataPtr);
+  this->dataPtr->discoverySilenceInterval = _ms;
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> NodeOptions::DiscoveryInterfaces() const
+{
+  return this->dataPtr->discoveryInterfaces;
+}
+
+//////////////////////////////////////////////////
+void NodeOptions::SetDiscoveryInterfaces(
+  const std::vector<std::string> &_ifaces)
+{
+  Unshare(this->dataPtr);
+  this->dataPtr->discoveryInterfaces = _ifaces;
+}
+
+//////////////////////////////////////////////////
+const std::string &NodeOptions::Domain() const
+{
+  return this->dataPtr->domain;
+}
+
+//////////////////////////////////////////////////
+void NodeOptions::SetDomain(const std::string &_domain)
+{
+  Unshare(this->dataPtr);
+  this->dataPtr->domain = _domain;
+}
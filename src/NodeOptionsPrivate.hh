@@ -20,6 +20,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/NetUtils.hh"
@@ -41,15 +42,42 @@ namespace ignition
       /// \brief Destructor.
       public: virtual ~NodeOptionsPrivate() = default;
 
+      /// \brief Get the default partition, made of the host and user names.
+      /// They are only looked up once per process.
+      /// \return The default partition.
+      public: static const std::string &DefaultPartition()
+      {
+        static const std::string kPartition = hostname() + ":" + username();
+        return kPartition;
+      }
+
       /// \brief Namespace for this node.
       public: std::string ns = "";
 
       /// \brief Partition for this node.
-      public: std::string partition = hostname() + ":" + username();
+      public: std::string partition = DefaultPartition();
 
       /// \brief Table of remappings. The key is the original topic name and
       /// its value is the new topic name to be used instead.
       public: std::map<std::string, std::string> topicsRemap;
+
+      /// \brief Number of threads running the subscription callbacks.
+      public: unsigned int callbackThreads = 0;
+
+      /// \brief Whether the application runs the subscription callbacks.
+      public: bool spinCallbacks = false;
+
+      /// \brief Interval between discovery heartbeats (ms.).
+      public: unsigned int discoveryHeartbeatInterval = 0;
+
+      /// \brief Discovery silence interval (ms.).
+      public: unsigned int discoverySilenceInterval = 0;
+
+      /// \brief Network interfaces used by the discovery.
+      public: std::vector<std::string> discoveryInterfaces;
+
+      /// \brief Transport domain of the node.
+      public: std::string domain;
     };
     }
   }
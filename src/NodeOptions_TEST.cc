@@ -72,6 +72,76 @@ TEST(NodeOptionsTest, accessors)
   EXPECT_EQ(opts.Partition(), defaultPartition);
   EXPECT_TRUE(opts.SetPartition(aPartition));
   EXPECT_EQ(opts.Partition(), aPartition);
+
+  // CallbackThreads.
+  EXPECT_EQ(opts.CallbackThreads(), 0u);
+  opts.SetCallbackThreads(4u);
+  EXPECT_EQ(opts.CallbackThreads(), 4u);
+  transport::NodeOptions opts2(opts);
+  EXPECT_EQ(opts2.CallbackThreads(), 4u);
+
+  // SpinCallbacks.
+  EXPECT_FALSE(opts.SpinCallbacks());
+  opts.SetSpinCallbacks(true);
+  EXPECT_TRUE(opts.SpinCallbacks());
+  transport::NodeOptions optsSpin(opts);
+  EXPECT_TRUE(optsSpin.SpinCallbacks());
+  EXPECT_FALSE(opts2.SpinCallbacks());
+
+  // Discovery intervals.
+  EXPECT_EQ(opts.DiscoveryHeartbeatInterval(), 0u);
+  EXPECT_EQ(opts.DiscoverySilenceInterval(), 0u);
+  opts.SetDiscoveryHeartbeatInterval(500u);
+  opts.SetDiscoverySilenceInterval(1500u);
+  transport::NodeOptions opts3(opts);
+  EXPECT_EQ(opts3.DiscoveryHeartbeatInterval(), 500u);
+  EXPECT_EQ(opts3.DiscoverySilenceInterval(), 1500u);
+
+  // Discovery interfaces.
+  EXPECT_TRUE(opts.DiscoveryInterfaces().empty());
+  opts.SetDiscoveryInterfaces({"127.0.0.1"});
+  transport::NodeOptions opts4(opts);
+  ASSERT_EQ(opts4.DiscoveryInterfaces().size(), 1u);
+  EXPECT_EQ(opts4.DiscoveryInterfaces()[0], "127.0.0.1");
+
+  // Domain.
+  EXPECT_TRUE(opts.Domain().empty());
+  opts.SetDomain("robot1");
+  transport::NodeOptions opts5(opts);
+  EXPECT_EQ(opts5.Domain(), "robot1");
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the copies of some options are independent, even if
+/// they share their data until modified.
+TEST(NodeOptionsTest, CopiesAreIndependent)
+{
+  transport::NodeOptions opts;
+  EXPECT_TRUE(opts.SetNameSpace("ns1"));
+  EXPECT_TRUE(opts.AddTopicRemap("/foo", "/bar"));
+
+  transport::NodeOptions copy(opts);
+  transport::NodeOptions assigned;
+  assigned = opts;
+
+  EXPECT_TRUE(copy.SetNameSpace("ns2"));
+  EXPECT_TRUE(copy.AddTopicRemap("/baz", "/qux"));
+  copy.SetCallbackThreads(2u);
+  EXPECT_EQ("ns2", copy.NameSpace());
+  EXPECT_EQ("ns1", opts.NameSpace());
+  EXPECT_EQ("ns1", assigned.NameSpace());
+  EXPECT_EQ(0u, opts.CallbackThreads());
+
+  std::string topic;
+  EXPECT_TRUE(copy.TopicRemap("/foo", topic));
+  EXPECT_EQ("/bar", topic);
+  EXPECT_FALSE(opts.TopicRemap("/baz", topic));
+  EXPECT_FALSE(assigned.TopicRemap("/baz", topic));
+
+  // Modifying the original doesn't change the copies either.
+  opts.SetDomain("robot1");
+  EXPECT_TRUE(assigned.Domain().empty());
+  EXPECT_TRUE(copy.Domain().empty());
 }
 
 //////////////////////////////////////////////////
@@ -18,13 +18,18 @@
 #ifndef IGN_TRANSPORT_NODEPRIVATE_HH_
 #define IGN_TRANSPORT_NODEPRIVATE_HH_
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "ignition/transport/NetUtils.hh"
 #include "ignition/transport/NodeOptions.hh"
 #include "ignition/transport/Node.hh"
 #include "ignition/transport/NodeShared.hh"
+#include "CallbackExecutor.hh"
 
 namespace ignition
 {
@@ -39,20 +44,58 @@ namespace ignition
     class NodePrivate
     {
       /// \brief Constructor.
-      public: NodePrivate() = default;
+      /// \param[in] _options Options of the node, shared with the caller
+      /// until one of the copies is modified.
+      public: explicit NodePrivate(const NodeOptions &_options)
+        : options(_options)
+      {
+      }
 
       /// \brief Destructor.
       public: virtual ~NodePrivate() = default;
 
       /// \brief Helper function for Subscribe.
       /// \param[in] _fullyQualifiedTopic Fully qualified topic name
+      /// \param[in] _handler The new local handler, if any. It receives the
+      /// latest message of a transient local topic of this process.
+      /// \param[in] _rawHandler The new raw handler, if any. It receives the
+      /// latest message of a transient local topic of this process.
       /// \return True on success.
       /// \sa TopicUtils::FullyQualifiedName
-      public: bool SubscribeHelper(const std::string &_fullyQualifiedTopic);
+      public: bool SubscribeHelper(const std::string &_fullyQualifiedTopic,
+                  const ISubscriptionHandlerPtr &_handler = nullptr,
+                  const RawSubscriptionHandlerPtr &_rawHandler = nullptr);
+
+      /// \brief Unsubscribe from all the topics of this node in one pass.
+      /// The publishers are notified together, batched in as few discovery
+      /// datagrams as possible.
+      public: void UnsubscribeAll();
+
+      /// \brief Unsubscribe from a topic.
+      /// \param[in] _fullyQualifiedTopic Fully qualified topic name.
+      /// \return True on success.
+      public: bool UnsubscribeHelper(const std::string &_fullyQualifiedTopic);
+
+      /// \brief Remove a wildcard subscription of this node and unsubscribe
+      /// from the topics that matched it.
+      /// \param[in] _fullyQualifiedPattern Fully qualified pattern.
+      /// \return True on success.
+      public: bool UnsubscribeWildcard(
+                const std::string &_fullyQualifiedPattern);
+
+      /// \brief Unadvertise all the services of this node in one pass. The
+      /// unadvertisements are sent together, batched in as few discovery
+      /// datagrams as possible.
+      /// \return True on success.
+      public: bool UnadvertiseAllSrvs();
 
       /// \brief The list of topics subscribed by this node.
       public: std::unordered_set<std::string> topicsSubscribed;
 
+      /// \brief Fully qualified patterns of the wildcard subscriptions of
+      /// this node. Protected by NodeShared::mutex.
+      public: std::unordered_set<std::string> wildcardsSubscribed;
+
       /// \brief The list of service calls advertised by this node.
       public: std::unordered_set<std::string> srvsAdvertised;
 
@@ -60,20 +103,65 @@ namespace ignition
       public: std::string nUuid;
 
       /// \brief Pointer to the object shared between all the nodes within the
-      /// same process.
-      public: NodeShared *shared = NodeShared::Instance();
-
-      /// \brief Partition for this node.
-      public: std::string partition = hostname() + ":" + username();
-
-      /// \brief Default namespace for this node.
-      public: std::string ns = "";
+      /// same process and transport domain.
+      public: NodeShared *shared = nullptr;
 
       /// \brief Custom options for this node.
       public: NodeOptions options;
 
-      /// \brief Statistics publisher.
-      public: Node::Publisher statPub;
+      /// \brief Executor of the callbacks run by Node::SpinSome() and
+      /// Node::SpinUntil(), null unless NodeOptions::SpinCallbacks().
+      public: std::shared_ptr<CallbackExecutor> spinExecutor;
+
+      /// \brief Statistics publisher, created when the statistics are
+      /// enabled, like the publishers below.
+      public: std::unique_ptr<Node::Publisher> statPub;
+
+      /// \brief Fully qualified topics with statistics enabled by this
+      /// node, disabled when the node is destroyed.
+      public: std::unordered_set<std::string> statsTopics;
+
+      /// \brief Disable the statistics of a topic once no node of the
+      /// process subscribes to it, so the statistics of the topics that come
+      /// and go don't pile up. Must be called without the mutex of the
+      /// shared node, the statistics callbacks publish with it.
+      /// \param[in] _fullyQualifiedTopic Fully qualified topic name.
+      public: void DisableUnsubscribedStats(
+                const std::string &_fullyQualifiedTopic);
+
+      /// \brief Service statistics publisher.
+      public: std::unique_ptr<Node::Publisher> srvStatPub;
+
+      /// \brief Transport metrics publisher.
+      public: std::unique_ptr<Node::Publisher> metricsPub;
+
+      /// \brief True if this node enabled the publication of the transport
+      /// metrics, disabled when the node is destroyed.
+      public: bool metricsEnabled = false;
+
+      /// \brief Maximum number of entries kept in the name cache. Names
+      /// requested once the cache is full are computed but not cached.
+      public: static constexpr std::size_t kMaxCachedNames = 1024;
+
+      /// \brief Cache of fully qualified names. The key is the topic as
+      /// passed by the user and the value is the remapped and fully qualified
+      /// name. The options can't change after constructing the node, so the
+      /// entries never become stale.
+      public: std::unordered_map<std::string,
+                std::shared_ptr<const std::string>> fullyQualifiedNames;
+
+      /// \brief Mutex to protect fullyQualifiedNames.
+      public: std::mutex fullyQualifiedNamesMutex;
+
+      /// \brief Number of nested Node::SubscribeMany() calls in progress.
+      /// While positive, the discovery requests of the new subscriptions
+      /// are kept in pendingDiscovery. Protected by NodeShared::mutex.
+      public: unsigned int discoveryBatch = 0;
+
+      /// \brief Topics subscribed during a batch, whose discovery requests
+      /// are sent together at the end of the batch. Protected by
+      /// NodeShared::mutex.
+      public: std::vector<std::string> pendingDiscovery;
     };
     }
   }
@@ -23,14 +23,24 @@
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <shared_mutex>  //NOLINT
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
@@ -44,6 +54,7 @@
 #endif
 
 #include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/AllocationCounter.hh"
 #include "ignition/transport/Discovery.hh"
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/NodeShared.hh"
@@ -53,18 +64,30 @@
 #include "ignition/transport/TransportTypes.hh"
 #include "ignition/transport/Uuid.hh"
 
+#include "Compression.hh"
+#include "MessageBatch.hh"
 #include "NodeSharedPrivate.hh"
+#include "Tracing.hh"
 
 #ifdef _MSC_VER
 # pragma warning(disable: 4503)
 #endif
 
-using namespace std::chrono_literals;
 using namespace ignition;
 using namespace transport;
 
 const char kIgnAuthDomain[] = "ign-auth";
 
+// Endpoint used to wake up the thread receiving the service requests when a
+// service running on a worker thread has a reply ready.
+const char kSrvReplyEndpoint[] = "inproc://ign-transport-srv-replies";
+
+// Endpoint of the workers authenticating the connections.
+const char kZapWorkersEndpoint[] = "inproc://ign-transport-zap-workers";
+
+// Size of a Z85 encoded CURVE key.
+const std::size_t kCurveKeySize = 40;
+
 // Enum that encapsulates the possible values for ZeroMQ's setsocketopt
 // for ZMQ_PLAIN_SERVER. A value of 1 enables
 // plain authentication server, and a value of 0 disables.
@@ -91,6 +114,168 @@ bool userPass(std::string &_user, std::string &_pass)
   return true;
 }
 
+//////////////////////////////////////////////////
+// Helper to check the CURVE key pair, if any. Keys that are set but are not
+// Z85 encoded keys must not degrade the security to PLAIN or none.
+bool curveKeysValid()
+{
+  char *publicKey = std::getenv("IGN_TRANSPORT_CURVE_PUBLIC_KEY");
+  char *secretKey = std::getenv("IGN_TRANSPORT_CURVE_SECRET_KEY");
+
+  if (!publicKey && !secretKey)
+    return true;
+
+  uint8_t key[32];
+  return publicKey && secretKey &&
+    std::strlen(publicKey) == kCurveKeySize &&
+    std::strlen(secretKey) == kCurveKeySize &&
+    zmq_z85_decode(key, publicKey) && zmq_z85_decode(key, secretKey);
+}
+
+//////////////////////////////////////////////////
+// Helper to get the CURVE key pair shared by the processes, Z85 encoded.
+bool curveKeys(std::string &_public, std::string &_secret)
+{
+  char *publicKey = std::getenv("IGN_TRANSPORT_CURVE_PUBLIC_KEY");
+  char *secretKey = std::getenv("IGN_TRANSPORT_CURVE_SECRET_KEY");
+
+  if (!publicKey || !secretKey || !curveKeysValid())
+    return false;
+
+  _public = publicKey;
+  _secret = secretKey;
+  return true;
+}
+
+//////////////////////////////////////////////////
+// Helper to check if the connections are authenticated.
+bool secured()
+{
+  std::string first, second;
+  return curveKeys(first, second) || userPass(first, second);
+}
+
+//////////////////////////////////////////////////
+// Helper to make a socket accept only the authenticated connections. CURVE
+// takes precedence over the username and password.
+// Return false if the CURVE keys are invalid, the socket must not be used.
+bool secureServerHelper(zmq::socket_t &_socket)
+{
+  if (!curveKeysValid())
+    return false;
+
+  void *handle = static_cast<void *>(_socket);
+  std::string publicKey, secretKey, user, pass;
+  if (curveKeys(publicKey, secretKey))
+  {
+    const int asCurveServer = 1;
+    zmq_setsockopt(handle, ZMQ_CURVE_SERVER, &asCurveServer,
+      sizeof(asCurveServer));
+    zmq_setsockopt(handle, ZMQ_CURVE_SECRETKEY, secretKey.c_str(),
+      secretKey.size());
+  }
+  else if (userPass(user, pass))
+  {
+    const int asPlainSecurityServer = static_cast<int>(
+      ZmqPlainSecurityServerOptions::ZMQ_PLAIN_SECURITY_SERVER_ENABLED);
+    zmq_setsockopt(handle, ZMQ_PLAIN_SERVER, &asPlainSecurityServer,
+      sizeof(asPlainSecurityServer));
+  }
+  else
+  {
+    return true;
+  }
+
+  zmq_setsockopt(handle, ZMQ_ZAP_DOMAIN, kIgnAuthDomain,
+    std::strlen(kIgnAuthDomain));
+  return true;
+}
+
+//////////////////////////////////////////////////
+// Helper to authenticate the connections of a socket. With CURVE, all the
+// processes share the key pair, so the server key is the public key.
+void secureClientHelper(zmq::socket_t &_socket)
+{
+  if (!curveKeysValid())
+    return;
+
+  void *handle = static_cast<void *>(_socket);
+  std::string publicKey, secretKey, user, pass;
+  if (curveKeys(publicKey, secretKey))
+  {
+    zmq_setsockopt(handle, ZMQ_CURVE_SERVERKEY, publicKey.c_str(),
+      publicKey.size());
+    zmq_setsockopt(handle, ZMQ_CURVE_PUBLICKEY, publicKey.c_str(),
+      publicKey.size());
+    zmq_setsockopt(handle, ZMQ_CURVE_SECRETKEY, secretKey.c_str(),
+      secretKey.size());
+  }
+  else if (userPass(user, pass))
+  {
+    zmq_setsockopt(handle, ZMQ_PLAIN_USERNAME, user.c_str(), user.size());
+    zmq_setsockopt(handle, ZMQ_PLAIN_PASSWORD, pass.c_str(), pass.size());
+  }
+}
+
+//////////////////////////////////////////////////
+// Helper to check which features all the remote subscribers of a topic
+// registered as capable of, and if some of them want the publication
+// metadata.
+void checkSubscribers(const TopicStorage<MessagePublisher> &_subscribers,
+    const std::string &_topic, bool &_allShm, bool &_allAlias,
+    bool &_allZlib, bool &_allMulticast, bool &_allChunks,
+    bool &_allReliable, bool &_allBatch, bool &_metadata)
+{
+  _allShm = false;
+  _allAlias = false;
+  _allZlib = false;
+  _allMulticast = false;
+  _allChunks = false;
+  _allReliable = false;
+  _allBatch = false;
+  _metadata = false;
+
+  std::map<std::string, std::vector<MessagePublisher>> subscribers;
+  if (!_subscribers.Publishers(_topic, subscribers))
+    return;
+
+  _allShm = true;
+  _allAlias = true;
+  _allZlib = true;
+  _allMulticast = !subscribers.empty();
+  _allChunks = true;
+  _allReliable = !subscribers.empty();
+  _allBatch = true;
+  bool allMetadata = true;
+  for (const auto &proc : subscribers)
+  {
+    for (const auto &sub : proc.second)
+    {
+      const uint64_t caps = ParseCapabilities(sub.Addr());
+      const bool shm = (caps & kCapShm) != 0;
+      const bool alias = (caps & kCapAlias) != 0;
+      const bool zlib = alias && (caps & kCapZlib) != 0;
+      const bool stats = (caps & kCapStats) != 0;
+      const bool metadata = (caps & kCapMetadata) != 0;
+      const bool multicast = (caps & kCapMulticast) != 0;
+      const bool chunks = (caps & kCapChunks) != 0;
+      const bool reliable = (caps & kCapReliable) != 0;
+      const bool batch = (caps & kCapBatch) != 0;
+
+      _allShm = _allShm && shm;
+      _allAlias = _allAlias && alias;
+      _allZlib = _allZlib && zlib;
+      _allMulticast = _allMulticast && multicast;
+      _allChunks = _allChunks && chunks;
+      _allReliable = _allReliable && reliable;
+      _allBatch = _allBatch && batch;
+      _metadata = _metadata || stats;
+      allMetadata = allMetadata && metadata;
+    }
+  }
+  _metadata = _metadata && allMetadata;
+}
+
 //////////////////////////////////////////////////
 // Helper to send messages
 #ifdef IGN_ZMQ_POST_4_3_1
@@ -149,20 +334,82 @@ std::string receiveHelper(zmq::socket_t &_socket)
 }
 
 //////////////////////////////////////////////////
-// Helper to send an authentication error. This is used by basic
-// authentication.
-void sendAuthErrorHelper(zmq::socket_t &_socket, const std::string &_err)
+// Helper to view a decoded message. The view keeps the buffer alive.
+NodeSharedPrivate::ReceivedMsg viewHelper(
+  const std::shared_ptr<std::string> &_buffer)
+{
+  return {std::shared_ptr<char>(_buffer, &(*_buffer)[0]), _buffer->size(),
+    nullptr};
+}
+
+//////////////////////////////////////////////////
+// Helper to receive all the frames of a message.
+std::vector<std::string> receiveFramesHelper(zmq::socket_t &_socket)
+{
+  std::vector<std::string> frames;
+  zmq::message_t msg;
+  do
+  {
+#ifdef IGN_ZMQ_POST_4_3_1
+    if (!_socket.recv(msg))
+#else
+    if (!_socket.recv(&msg, 0))
+#endif
+      return {};
+
+    frames.emplace_back(reinterpret_cast<char *>(msg.data()), msg.size());
+  }
+  while (msg.more());
+
+  return frames;
+}
+
+//////////////////////////////////////////////////
+// Helper to forward all the frames of a message to another socket.
+void forwardHelper(zmq::socket_t &_from, zmq::socket_t &_to)
+{
+  zmq::message_t msg;
+  bool more = true;
+  while (more)
+  {
+#ifdef IGN_ZMQ_POST_4_3_1
+    if (!_from.recv(msg))
+      return;
+    more = msg.more();
+    _to.send(msg, more ? zmq::send_flags::sndmore : zmq::send_flags::none);
+#else
+    if (!_from.recv(&msg, 0))
+      return;
+    more = msg.more();
+    _to.send(msg, more ? ZMQ_SNDMORE : 0);
+#endif
+  }
+}
+
+//////////////////////////////////////////////////
+// Helper to reply to an authentication request. This is used by the
+// authentication workers.
+void sendZapReplyHelper(zmq::socket_t &_socket, const std::string &_version,
+  const std::string &_sequence, const std::string &_status,
+  const std::string &_text)
 {
-  std::cerr << _err << std::endl;
+  if (_status != "200")
+    std::cerr << _text << std::endl;
+
+  const std::string userId = _status == "200" ? "anonymous" : "";
 #ifdef IGN_ZMQ_POST_4_3_1
-  sendHelper(_socket, "400", zmq::send_flags::sndmore);
-  sendHelper(_socket, _err, zmq::send_flags::sndmore);
-  sendHelper(_socket, "", zmq::send_flags::sndmore);
+  sendHelper(_socket, _version, zmq::send_flags::sndmore);
+  sendHelper(_socket, _sequence, zmq::send_flags::sndmore);
+  sendHelper(_socket, _status, zmq::send_flags::sndmore);
+  sendHelper(_socket, _text, zmq::send_flags::sndmore);
+  sendHelper(_socket, userId, zmq::send_flags::sndmore);
   sendHelper(_socket, "", zmq::send_flags::none);
 #else
-  sendHelper(_socket, "400", ZMQ_SNDMORE);
-  sendHelper(_socket, _err, ZMQ_SNDMORE);
-  sendHelper(_socket, "", ZMQ_SNDMORE);
+  sendHelper(_socket, _version, ZMQ_SNDMORE);
+  sendHelper(_socket, _sequence, ZMQ_SNDMORE);
+  sendHelper(_socket, _status, ZMQ_SNDMORE);
+  sendHelper(_socket, _text, ZMQ_SNDMORE);
+  sendHelper(_socket, userId, ZMQ_SNDMORE);
   sendHelper(_socket, "", 0);
 #endif
 }
@@ -170,14 +417,21 @@ void sendAuthErrorHelper(zmq::socket_t &_socket, const std::string &_err)
 //////////////////////////////////////////////////
 NodeShared *NodeShared::Instance()
 {
-  // Create an instance of NodeShared per process so the ZMQ context
-  // is not shared between different processes.
+  return Instance(std::string());
+}
+
+//////////////////////////////////////////////////
+NodeShared *NodeShared::Instance(const std::string &_domain)
+{
+  // Create an instance of NodeShared per process and domain so the ZMQ
+  // context is not shared between different processes.
 
   static std::shared_mutex mutex;
-  static std::unordered_map<unsigned int, NodeShared*> nodeSharedMap;
+  static std::map<std::pair<unsigned int, std::string>, NodeShared*>
+    nodeSharedMap;
 
-  // Get current process ID.
-  auto pid = getProcessId();
+  // Key of the current process and domain.
+  const auto key = std::make_pair(getProcessId(), _domain);
 
   // Check if there's already a NodeShared instance for this process.
   // Use a shared_lock so multiple threads can read simultaneously.
@@ -188,7 +442,7 @@ NodeShared *NodeShared::Instance()
   try
   {
     std::shared_lock readLock(mutex);
-    return nodeSharedMap.at(pid);
+    return nodeSharedMap.at(key);
   }
   catch (...)
   {
@@ -197,7 +451,7 @@ NodeShared *NodeShared::Instance()
     // not an already constructed NodeShared instance for this process.
     std::lock_guard writeLock(mutex);
 
-    auto iter = nodeSharedMap.find(pid);
+    auto iter = nodeSharedMap.find(key);
     if (iter != nodeSharedMap.end())
     {
       // There's already an instance for this process, return it.
@@ -205,7 +459,7 @@ NodeShared *NodeShared::Instance()
     }
 
     // No instance, construct a new one.
-    auto ret = nodeSharedMap.insert({pid, new NodeShared});
+    auto ret = nodeSharedMap.insert({key, new NodeShared(_domain)});
     assert(ret.second);  // Insert operation should be successful.
     return ret.first->second;
   }
@@ -213,9 +467,18 @@ NodeShared *NodeShared::Instance()
 
 //////////////////////////////////////////////////
 NodeShared::NodeShared()
+  : NodeShared(std::string())
+{
+}
+
+//////////////////////////////////////////////////
+NodeShared::NodeShared(const std::string &_domain)
   : verbose(false),
     dataPtr(new NodeSharedPrivate)
 {
+  this->dataPtr->owner = this;
+  this->dataPtr->domain = _domain;
+
   // If IGN_VERBOSE=1 enable the verbose mode.
   std::string ignVerbose;
   this->verbose = (env("IGN_VERBOSE", ignVerbose) && ignVerbose == "1");
@@ -253,38 +516,235 @@ NodeShared::NodeShared()
   this->dataPtr->topicStatsEnabled =
     (env("IGN_TRANSPORT_TOPIC_STATISTICS", ignStats) && ignStats == "1");
 
+  std::string ignStatsOffset;
+  this->dataPtr->topicStatsClockOffset =
+    (env("IGN_TRANSPORT_TOPIC_STATISTICS_CLOCK_OFFSET", ignStatsOffset) &&
+     ignStatsOffset == "1");
+
+  this->dataPtr->topicStatsMaxTopics = static_cast<std::size_t>(
+    this->dataPtr->NonNegativeEnvVar(
+      "IGN_TRANSPORT_TOPIC_STATISTICS_MAX_TOPICS",
+      static_cast<int>(this->dataPtr->topicStatsMaxTopics)));
+
+  // If IGN_TRANSPORT_SPLIT_RECEPTION=1 receive the messages, the service
+  // requests and the service responses on separate threads.
+  std::string ignSplit;
+  this->dataPtr->splitReception =
+    (env("IGN_TRANSPORT_SPLIT_RECEPTION", ignSplit) && ignSplit == "1");
+
+  // IGN_TRANSPORT_BUSY_POLL lists the sockets received by spinning, "1"
+  // for all of them.
+  std::string ignBusyPoll;
+  if (env("IGN_TRANSPORT_BUSY_POLL", ignBusyPoll) && !ignBusyPoll.empty() &&
+      ignBusyPoll != "0")
+  {
+    for (const std::string &item : split(ignBusyPoll, ','))
+    {
+      if (item == "1")
+        this->dataPtr->busyPoll.set();
+      else if (item == "messages")
+        this->dataPtr->busyPoll.set(NodeSharedPrivate::kMessagesThread);
+      else if (item == "requests")
+        this->dataPtr->busyPoll.set(NodeSharedPrivate::kRequestsThread);
+      else if (item == "responses")
+        this->dataPtr->busyPoll.set(NodeSharedPrivate::kResponsesThread);
+      else
+      {
+        std::cerr << "Unknown IGN_TRANSPORT_BUSY_POLL socket [" << item
+                  << "]. Use messages, requests or responses." << std::endl;
+      }
+    }
+  }
+
+  std::string ignBusyPollPause;
+  this->dataPtr->busyPollPause =
+    (env("IGN_TRANSPORT_BUSY_POLL_PAUSE", ignBusyPollPause) &&
+     ignBusyPollPause == "1");
+
+  std::string ignBusyPollCpus;
+  if (env("IGN_TRANSPORT_BUSY_POLL_CPUS", ignBusyPollCpus) &&
+      !ignBusyPollCpus.empty() &&
+      !parseCpus(ignBusyPollCpus, this->dataPtr->busyPollCpus))
+  {
+    std::cerr << "Unable to parse IGN_TRANSPORT_BUSY_POLL_CPUS ["
+              << ignBusyPollCpus << "]. Not pinning the spinning threads."
+              << std::endl;
+  }
+
+  // IGN_TRANSPORT_RCVQUEUE_BYTES and IGN_TRANSPORT_SNDQUEUE_BYTES bound
+  // the bytes of the messages waiting for the callbacks and for the
+  // network, whatever the number of subscriptions and publications.
+  const int rcvQueueBytes =
+    this->dataPtr->NonNegativeEnvVar("IGN_TRANSPORT_RCVQUEUE_BYTES", 0);
+  if (rcvQueueBytes > 0)
+  {
+    this->dataPtr->recvBudget = std::make_shared<ByteBudget>(
+      static_cast<uint64_t>(rcvQueueBytes));
+  }
+  const int sndQueueBytes =
+    this->dataPtr->NonNegativeEnvVar("IGN_TRANSPORT_SNDQUEUE_BYTES", 0);
+  if (sndQueueBytes > 0)
+  {
+    this->dataPtr->sendBudget = std::make_shared<ByteBudget>(
+      static_cast<uint64_t>(sndQueueBytes));
+  }
+
+  // IGN_TRANSPORT_PING initializes the services with the first node, so
+  // processes that don't use services answer the pings too.
+  std::string ignPing;
+  this->dataPtr->eagerPing =
+    (env("IGN_TRANSPORT_PING", ignPing) && ignPing == "1");
+
+  // IGN_TRANSPORT_SRV_LOAD_BALANCING chooses how the requests of a service
+  // are spread among the processes offering it.
+  std::string ignBalancing;
+  if (env("IGN_TRANSPORT_SRV_LOAD_BALANCING", ignBalancing))
+  {
+    using Balancing = NodeSharedPrivate::SrvLoadBalancing;
+    if (ignBalancing == "round_robin")
+    {
+      this->dataPtr->srvLoadBalancing = Balancing::ROUND_ROBIN;
+    }
+    else if (ignBalancing == "least_outstanding")
+    {
+      this->dataPtr->srvLoadBalancing = Balancing::LEAST_OUTSTANDING;
+    }
+    else if (ignBalancing == "latency")
+    {
+      this->dataPtr->srvLoadBalancing = Balancing::LATENCY;
+    }
+    else if (ignBalancing != "first")
+    {
+      std::cerr << "Unknown IGN_TRANSPORT_SRV_LOAD_BALANCING value ["
+                << ignBalancing << "]. Using [first] instead." << std::endl;
+    }
+  }
+
+  // IGN_TRANSPORT_SRV_ONEWAY_BATCH_DELAY is the maximum time in
+  // milliseconds a oneway request waits to be sent with others to the same
+  // responser. Zero sends them one by one.
+  this->dataPtr->onewayBatchDelay = std::chrono::milliseconds(
+    this->dataPtr->NonNegativeEnvVar("IGN_TRANSPORT_SRV_ONEWAY_BATCH_DELAY",
+      0));
+
+  // IGN_TRANSPORT_CHUNK_SIZE is the size in bytes of the chunks the large
+  // messages are split into. Zero sends them whole.
+  this->dataPtr->chunkSize = static_cast<std::size_t>(
+    this->dataPtr->NonNegativeEnvVar("IGN_TRANSPORT_CHUNK_SIZE",
+      static_cast<int>(kDefaultChunkSize)));
+
+  // IGN_TRANSPORT_MAX_CHUNKED_MSG_SIZE and IGN_TRANSPORT_MAX_CHUNKED_MSGS
+  // bound the memory a publisher can make this process reserve for the
+  // chunked messages it sends.
+  this->dataPtr->chunks.SetMaxSize(static_cast<std::size_t>(
+    this->dataPtr->NonNegativeEnvVar("IGN_TRANSPORT_MAX_CHUNKED_MSG_SIZE",
+      static_cast<int>(kDefaultMaxChunkedMsgSize))));
+  this->dataPtr->chunks.SetMaxPending(static_cast<std::size_t>(
+    this->dataPtr->NonNegativeEnvVar("IGN_TRANSPORT_MAX_CHUNKED_MSGS",
+      static_cast<int>(kDefaultMaxChunkedMsgs))));
+
   // My process UUID.
   Uuid uuid;
   this->pUuid = uuid.ToString();
 
-  // Initialize my discovery services.
+  // If IGN_TRANSPORT_SHM=1 enable the shared memory transport for the
+  // subscribers running on the same host.
+  std::string ignShm;
+  this->dataPtr->shmEnabled = (env("IGN_TRANSPORT_SHM", ignShm) &&
+    ignShm == "1");
+  if (this->dataPtr->shmEnabled)
+  {
+    const std::size_t shmSizeMB = this->dataPtr->NonNegativeEnvVar(
+      "IGN_TRANSPORT_SHM_SIZE", static_cast<int>(kDefaultShmSizeMB));
+
+    // We can still receive through shared memory without our own segment.
+    if (shmSizeMB > 0)
+    {
+      this->dataPtr->shmSegment = ShmSegment::Create(
+        ShmSegment::Name(this->pUuid), shmSizeMB << 20);
+    }
+  }
+
+  // Initialize my discovery service. The service discovery is created with
+  // the first service, see EnsureServices().
   this->dataPtr->msgDiscovery.reset(
       new MsgDiscovery(this->pUuid, this->discoveryIP, this->msgDiscPort));
-  this->dataPtr->srvDiscovery.reset(
-      new SrvDiscovery(this->pUuid, this->discoveryIP, this->srvDiscPort));
+
+  // Set the discovery intervals (ms.), zero keeps the default value.
+  const unsigned int heartbeatInterval = this->dataPtr->NonNegativeEnvVar(
+    "IGN_DISCOVERY_HEARTBEAT_INTERVAL", 0);
+  const unsigned int silenceInterval = this->dataPtr->NonNegativeEnvVar(
+    "IGN_DISCOVERY_SILENCE_INTERVAL", 0);
+  const unsigned int activityInterval = this->dataPtr->NonNegativeEnvVar(
+    "IGN_DISCOVERY_ACTIVITY_INTERVAL", 0);
+  this->SetDiscoveryIntervals(heartbeatInterval, silenceInterval,
+    activityInterval);
+
+  // If IGN_DISCOVERY_ADAPTIVE_HEARTBEAT=1 the heartbeats back off while the
+  // discovery state doesn't change.
+  std::string ignAdaptive;
+  if (env("IGN_DISCOVERY_ADAPTIVE_HEARTBEAT", ignAdaptive) &&
+      ignAdaptive == "1")
+  {
+    this->dataPtr->msgDiscovery->SetAdaptiveHeartbeat(true);
+    this->dataPtr->srvDiscoverySettings.adaptiveHeartbeat = true;
+  }
+
+  // If IGN_DISCOVERY_PARTITION_FILTER=1 only the advertisements of the
+  // partitions used by this process are stored.
+  std::string ignPartitionFilter;
+  if (env("IGN_DISCOVERY_PARTITION_FILTER", ignPartitionFilter) &&
+      ignPartitionFilter == "1")
+  {
+    this->dataPtr->msgDiscovery->SetPartitionFilter(true);
+    this->dataPtr->srvDiscoverySettings.partitionFilter = true;
+  }
+
+  // Unless IGN_TRANSPORT_IPC=0, the peers on the same host are connected
+  // through Unix domain sockets instead of the loopback TCP stack.
+  std::string ignIpc;
+  this->dataPtr->ipcEnabled =
+    !(env("IGN_TRANSPORT_IPC", ignIpc) && ignIpc == "0") &&
+    !IpcEndpoint(this->pUuid, kIpcPublisherSocket).empty();
+
+  // If IGN_DISCOVERY_CACHE is set, the remote publishers are kept in files
+  // with this prefix and reused by the next start.
+  std::string ignCache;
+  if (env("IGN_DISCOVERY_CACHE", ignCache) && !ignCache.empty())
+  {
+    this->dataPtr->msgDiscovery->SetCachePath(ignCache + ".msgs");
+    this->dataPtr->srvDiscoverySettings.cachePath = ignCache + ".srvs";
+  }
 
   // Initialize the 0MQ objects.
   if (!this->InitializeSockets())
     return;
 
+  // If IGN_TRANSPORT_CONNECTION_STATISTICS=1 the connections of the
+  // publisher and the subscriber sockets are monitored, before the
+  // reception thread and the discovery use them.
+  std::string ignConnectionStats;
+  if (env("IGN_TRANSPORT_CONNECTION_STATISTICS", ignConnectionStats) &&
+      ignConnectionStats == "1")
+  {
+    this->dataPtr->StartConnectionMonitors(this->pUuid, _domain.empty());
+  }
+
   if (this->verbose)
   {
     std::cout << "Current host address: " << this->hostAddr << std::endl;
     std::cout << "Process UUID: " << this->pUuid << std::endl;
     std::cout << "Bind at: [udp://" << this->discoveryIP << ":"
               << this->msgDiscPort << "] for msg discovery\n";
-    std::cout << "Bind at: [udp://" << this->discoveryIP << ":"
-              << this->srvDiscPort << "] for srv discovery\n";
-    std::cout << "Bind at: [" << this->myAddress << "] for pub/sub\n";
-    std::cout << "Bind at: [" << this->myReplierAddress << "] for srv. calls\n";
-    std::cout << "Identity for receiving srv. requests: ["
-              << this->replierId.ToString() << "]" << std::endl;
-    std::cout << "Identity for receiving srv. responses: ["
-              << this->responseReceiverId.ToString() << "]" << std::endl;
+    std::cout << "Bind at: [" << this->myAddress << "] for pub/sub"
+              << std::endl;
   }
 
   // Start the service thread.
   this->threadReception = std::thread(&NodeShared::RunReceptionTask, this);
+  configureThread(this->threadReception, "ign-reception");
+  this->dataPtr->PinBusyPoll(this->threadReception,
+    NodeSharedPrivate::kMessagesThread, "ign-reception");
 
   // Set the callback to notify discovery updates (new topics).
   this->dataPtr->msgDiscovery->ConnectionsCb(
@@ -300,22 +760,50 @@ NodeShared::NodeShared()
   this->dataPtr->msgDiscovery->UnregistrationsCb(
       std::bind(&NodeShared::OnEndRegistration, this, std::placeholders::_1));
 
-  // Set the callback to notify svc discovery updates (new services).
-  this->dataPtr->srvDiscovery->ConnectionsCb(
-      std::bind(&NodeShared::OnNewSrvConnection, this, std::placeholders::_1));
-
-  // Set the callback to notify svc discovery updates (invalid services).
-  this->dataPtr->srvDiscovery->DisconnectionsCb(
-      std::bind(&NodeShared::OnNewSrvDisconnection,
-        this, std::placeholders::_1));
-
-  // Start the discovery services.
+  // Start the discovery service.
   this->dataPtr->msgDiscovery->Start();
-  this->dataPtr->srvDiscovery->Start();
 
-  // Create the local publish thread.
-  this->dataPtr->pubThread = std::thread(&NodeSharedPrivate::PublishThread,
-      this->dataPtr.get());
+  // Create the local publish threads, each one with its own queue.
+  const int numPubThreads = std::max(1, this->dataPtr->NonNegativeEnvVar(
+    "IGN_TRANSPORT_LOCAL_PUBLISH_THREADS", 1));
+  // The publish queues may be limited, see
+  // IGN_TRANSPORT_LOCAL_PUBLISH_QUEUE_SIZE.
+  const std::size_t pubQueueSize = this->dataPtr->NonNegativeEnvVar(
+    "IGN_TRANSPORT_LOCAL_PUBLISH_QUEUE_SIZE", 0);
+  QueuePolicy_t pubQueuePolicy = QueuePolicy_t::DROP_OLDEST;
+  std::string ignPolicy;
+  if (env("IGN_TRANSPORT_LOCAL_PUBLISH_QUEUE_POLICY", ignPolicy))
+  {
+    if (ignPolicy == "drop_newest")
+    {
+      pubQueuePolicy = QueuePolicy_t::DROP_NEWEST;
+    }
+    else if (ignPolicy == "block")
+    {
+      pubQueuePolicy = QueuePolicy_t::BLOCK;
+    }
+    else if (ignPolicy != "drop_oldest")
+    {
+      std::cerr << "Unknown IGN_TRANSPORT_LOCAL_PUBLISH_QUEUE_POLICY value ["
+                << ignPolicy << "]. Using [drop_oldest] instead." << std::endl;
+    }
+  }
+  for (int i = 0; i < numPubThreads; ++i)
+  {
+    this->dataPtr->pubQueues.emplace_back(
+      new MpscRing<NodeSharedPrivate::PublishMsgDetails>(
+        NodeSharedPrivate::kPubQueueCapacity, pubQueueSize, pubQueuePolicy));
+  }
+  for (auto &queue : this->dataPtr->pubQueues)
+  {
+    this->dataPtr->pubThreads.emplace_back(&NodeSharedPrivate::PublishThread,
+      this->dataPtr.get(), std::ref(*queue));
+    configureThread(this->dataPtr->pubThreads.back(), "ign-publish");
+  }
+
+  // The gauges have process wide names.
+  if (_domain.empty())
+    this->dataPtr->RegisterGauges(*this);
 }
 
 //////////////////////////////////////////////////
@@ -324,13 +812,105 @@ NodeShared::~NodeShared()
   // Tell the service thread to terminate.
   this->dataPtr->exit = true;
 
-  // Notify the local pubthread and join.
-  this->dataPtr->signalNewPub.notify_all();
-  this->dataPtr->pubThread.join();
+  // Wake up the local pubthreads and join.
+  for (auto &queue : this->dataPtr->pubQueues)
+    queue->Close();
+  for (auto &thread : this->dataPtr->pubThreads)
+    thread.join();
+
+  // Notify the conflation thread and join.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->conflateMutex);
+    this->dataPtr->signalConflated.notify_all();
+  }
+  if (this->dataPtr->conflateThread.joinable())
+    this->dataPtr->conflateThread.join();
+
+  // Notify the batch thread and join.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->batchMutex);
+    this->dataPtr->signalBatched.notify_all();
+  }
+  if (this->dataPtr->batchThread.joinable())
+    this->dataPtr->batchThread.join();
+
+  // Notify the thread sending the latest messages and join.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->lastValueMutex);
+    this->dataPtr->signalLastValue.notify_all();
+  }
+  if (this->dataPtr->lastValueThread.joinable())
+    this->dataPtr->lastValueThread.join();
+
+  // Notify the thread running the match callbacks and join.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->matchMutex);
+    this->dataPtr->signalMatch.notify_all();
+  }
+  if (this->dataPtr->matchThread.joinable())
+    this->dataPtr->matchThread.join();
+
+  // The socket monitors stop with the reception of their events.
+  if (this->dataPtr->connectionMonitorThread.joinable())
+    this->dataPtr->connectionMonitorThread.join();
+
+  // The gauges sample this object.
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  for (const auto &name : NodeSharedPrivate::kGaugeNames)
+    registry.RemoveGaugeCallback(name);
+
+  // Notify the metrics thread and join.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->metricsMutex);
+    this->dataPtr->signalMetrics.notify_all();
+  }
+  if (this->dataPtr->metricsThread.joinable())
+    this->dataPtr->metricsThread.join();
+
+  // Notify the statistics thread and join.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->topicStatsMutex);
+    this->dataPtr->signalTopicStats.notify_all();
+  }
+  if (this->dataPtr->topicStatsThread.joinable())
+    this->dataPtr->topicStatsThread.join();
+
+  // Send the pending oneway requests and join.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->onewayBatchMutex);
+    this->dataPtr->signalOnewayBatch.notify_all();
+  }
+  if (this->dataPtr->onewayBatchThread.joinable())
+    this->dataPtr->onewayBatchThread.join();
 
   // Wait for the service thread before exit.
   if (this->threadReception.joinable())
     this->threadReception.join();
+  if (this->dataPtr->srvRequestThread.joinable())
+    this->dataPtr->srvRequestThread.join();
+  if (this->dataPtr->srvResponseThread.joinable())
+    this->dataPtr->srvResponseThread.join();
+
+  // Wait for the service requests running on worker threads. Their replies
+  // are not sent anymore.
+  std::map<std::string, NodeSharedPrivate::RepHandlerExecutor> repExecutors;
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->executorsMutex);
+    repExecutors.swap(this->dataPtr->repHandlerExecutors);
+  }
+  repExecutors.clear();
+
+  // Wait for the callbacks running on worker threads and drop the pending
+  // conflated and batched messages. The messages they held are not
+  // acknowledged anymore.
+  std::map<std::string, NodeSharedPrivate::HandlerExecutor> handlerExecutors;
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->executorsMutex);
+    handlerExecutors.swap(this->dataPtr->handlerExecutors);
+  }
+  handlerExecutors.clear();
+  this->dataPtr->conflatedMsgs.clear();
+  this->dataPtr->batchedMsgs.clear();
 
   // Wait for the authentication thread before exit.
   if (this->dataPtr->accessControlThread.joinable())
@@ -340,6 +920,17 @@ NodeShared::~NodeShared()
 //////////////////////////////////////////////////
 void NodeShared::RunReceptionTask()
 {
+  const bool spin =
+    this->dataPtr->BusyPolls(NodeSharedPrivate::kMessagesThread);
+
+  // The service sockets have their own threads.
+  if (this->dataPtr->splitReception)
+  {
+    this->dataPtr->PollSocket(*this->dataPtr->subscriber,
+      [this](){this->RecvMsgUpdate();}, spin);
+    return;
+  }
+
   while (!this->dataPtr->exit)
   {
     // Poll socket for a reply, with timeout.
@@ -347,17 +938,16 @@ void NodeShared::RunReceptionTask()
     {
       {static_cast<void*>(*this->dataPtr->subscriber), 0, ZMQ_POLLIN, 0},
       {static_cast<void*>(*this->dataPtr->replier), 0, ZMQ_POLLIN, 0},
-      {static_cast<void*>(*this->dataPtr->responseReceiver), 0, ZMQ_POLLIN, 0}
+      {static_cast<void*>(*this->dataPtr->responseReceiver), 0, ZMQ_POLLIN, 0},
+      {static_cast<void*>(*this->dataPtr->srvReplyWakeup), 0, ZMQ_POLLIN, 0}
     };
-    try
-    {
-      zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
-                std::chrono::milliseconds(NodeSharedPrivate::Timeout));
-    }
-    catch(...)
-    {
+
+    // The service sockets are only polled once they're initialized.
+    const std::size_t numItems =
+      this->dataPtr->servicesInitialized.load(std::memory_order_acquire) ?
+      sizeof(items) / sizeof(items[0]) : 1u;
+    if (this->dataPtr->Poll(&items[0], numItems, spin) == 0)
       continue;
-    }
 
     //  If we got a reply, process it.
     if (items[0].revents & ZMQ_POLLIN)
@@ -366,1514 +956,5825 @@ void NodeShared::RunReceptionTask()
       this->RecvSrvRequest();
     if (items[2].revents & ZMQ_POLLIN)
       this->RecvSrvResponse();
+    if (items[3].revents & ZMQ_POLLIN)
+      this->dataPtr->SendQueuedSrvReplies();
   }
 }
 
 //////////////////////////////////////////////////
-bool NodeShared::Publish(
-    const std::string &_topic,
-    char *_data,
-    const size_t _dataSize, DeallocFunc *_ffn,
-    const std::string &_msgType)
+void NodeSharedPrivate::PollSocket(zmq::socket_t &_socket,
+  const std::function<void()> &_recv, const bool _spin)
 {
-  try
+  this->PollSockets({{&_socket, _recv}}, _spin);
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::PollSockets(const std::vector<SocketReceiver> &_sockets,
+  const bool _spin)
+{
+  std::vector<zmq::pollitem_t> items;
+  while (!this->exit)
   {
-    // Create the messages.
-    // Note that we use zero copy for passing the message data (msg2).
-    zmq::message_t msg0(_topic.data(), _topic.size()),
-                   msg1(this->myAddress.data(), this->myAddress.size()),
-                   msg2(_data, _dataSize, _ffn, nullptr),
-                   msg3(_msgType.data(), _msgType.size());
+    items.clear();
+    for (const auto &socket : _sockets)
+      items.push_back({static_cast<void*>(*socket.first), 0, ZMQ_POLLIN, 0});
 
-    // Send the messages
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    if (this->Poll(items.data(), items.size(), _spin) == 0)
+      continue;
 
-#ifdef IGN_ZMQ_POST_4_3_1
-    this->dataPtr->publisher->send(msg0, zmq::send_flags::sndmore);
-    this->dataPtr->publisher->send(msg1, zmq::send_flags::sndmore);
-    this->dataPtr->publisher->send(msg2, zmq::send_flags::sndmore);
-#else
-    this->dataPtr->publisher->send(msg0, ZMQ_SNDMORE);
-    this->dataPtr->publisher->send(msg1, ZMQ_SNDMORE);
-    this->dataPtr->publisher->send(msg2, ZMQ_SNDMORE);
-#endif
-
-    if (this->dataPtr->topicStatsEnabled)
-    {
-      // Create publication metadata.
-      PublicationMetadata meta;
-      // Send the sequence number, which can be used to detect dropped
-      // messages.
-      meta.seq = this->dataPtr->topicPubSeq[_topic]++;
-      // Send the publication time.
-      meta.stamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::steady_clock::now().time_since_epoch()).count();
-      zmq::message_t msg4(&meta, sizeof(meta));
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->publisher->send(msg3, zmq::send_flags::sndmore);
-      this->dataPtr->publisher->send(msg4, zmq::send_flags::none);
-#else
-      this->dataPtr->publisher->send(msg3, ZMQ_SNDMORE);
-      this->dataPtr->publisher->send(msg4, 0);
-#endif
-    }
-    else
+    for (std::size_t i = 0; i < items.size(); ++i)
     {
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->publisher->send(msg3, zmq::send_flags::none);
-#else
-      this->dataPtr->publisher->send(msg3, 0);
-#endif
+      if (items[i].revents & ZMQ_POLLIN)
+        _sockets[i].second();
     }
   }
-  catch(const zmq::error_t& ze)
+}
+
+//////////////////////////////////////////////////
+int NodeSharedPrivate::Poll(zmq::pollitem_t *_items, const std::size_t _count,
+  const bool _spin) const
+{
+  int ready = 0;
+  try
   {
-     std::cerr << "NodeShared::Publish() Error: " << ze.what() << std::endl;
-     return false;
+    ready = zmq::poll(_items, _count,
+      std::chrono::milliseconds(_spin ? 0 : NodeSharedPrivate::Timeout));
+  }
+  catch(...)
+  {
+    return 0;
   }
 
-  return true;
+  if (ready == 0 && _spin && this->busyPollPause)
+    cpuRelax();
+  return ready;
 }
 
 //////////////////////////////////////////////////
-void NodeShared::RecvMsgUpdate()
+bool NodeSharedPrivate::BusyPolls(const std::size_t _thread) const
 {
-  zmq::message_t msg(0);
-  std::string topic;
-  std::string sender;
-  std::string data;
-  std::string msgType;
-  HandlerInfo handlerInfo;
+  if (!this->splitReception)
+    return _thread == kMessagesThread && this->busyPoll.any();
+  return this->busyPoll.test(_thread);
+}
 
-  {
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+//////////////////////////////////////////////////
+void NodeSharedPrivate::PinBusyPoll(std::thread &_thread,
+  const std::size_t _index, const std::string &_name) const
+{
+  if (this->busyPollCpus.empty() || !this->BusyPolls(_index))
+    return;
 
-    try
+  std::size_t order = 0;
+  for (std::size_t i = 0; i < _index; ++i)
+    order += this->BusyPolls(i) ? 1 : 0;
+  pinThread(_thread, this->busyPollCpus[order % this->busyPollCpus.size()],
+    _name);
+}
+
+//////////////////////////////////////////////////
+NodeSharedPrivate::TopicSendInfo NodeSharedPrivate::SendInfo(
+  const std::string &_topic, const std::string &_msgType)
+{
+  // It's only recomputed when the remote subscribers change.
+  const std::string topicKey = TopicKey(_topic, _msgType);
+  const uint64_t version = this->subscribersVersion.load(
+    std::memory_order_acquire);
+
+  TopicSendInfo sendInfo;
+  bool stale = true;
+  {
+    std::lock_guard<std::mutex> lock(this->publisherMutex);
+    auto sendInfoIt = this->topicSendInfo.find(topicKey);
+    if (sendInfoIt != this->topicSendInfo.end() &&
+        sendInfoIt->second.version == version)
     {
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      sendInfo = sendInfoIt->second;
+      stale = false;
+    }
+  }
 
-      // TODO(caguero): Use this as extra metadata for the subscriber.
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      sender = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+  // Don't take the global mutex while holding the publisher mutex.
+  if (stale)
+  {
+    sendInfo.version = version;
+    {
+      std::lock_guard<std::recursive_mutex> globalLock(this->owner->mutex);
+      bool allAlias;
+      bool allZlib;
+      bool allMulticast;
+      bool allChunks;
+      bool allReliable;
+      checkSubscribers(this->owner->remoteSubscribers, _topic, sendInfo.shm,
+        allAlias, allZlib, allMulticast, allChunks, allReliable,
+        sendInfo.batch, sendInfo.metadata);
+
+      // The messages of a reliable topic are retained as they are sent,
+      // so they are neither chunked nor passed through shared memory.
+      auto reliableIt = this->retransmitBuffers.find(topicKey);
+      if (allReliable && reliableIt != this->retransmitBuffers.end())
+      {
+        sendInfo.reliable = reliableIt->second;
+        sendInfo.shm = false;
+      }
+      else if (allChunks)
+      {
+        sendInfo.chunkSize = this->chunkSize;
+      }
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      data = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      auto idIt = this->topicIds.find(topicKey);
+      if (allAlias && idIt != this->topicIds.end())
+        sendInfo.alias = TopicAlias(this->owner->pUuid, idIt->second);
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      msgType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      auto compressionIt = this->topicCompression.find(topicKey);
+      if (allZlib && compressionIt != this->topicCompression.end())
+        sendInfo.compression = compressionIt->second;
 
-      if (this->dataPtr->topicStatsEnabled)
-      {
-#ifdef IGN_ZMQ_POST_4_3_1
-        if (!this->dataPtr->subscriber->recv(msg))
-#else
-        if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-          return;
-        PublicationMetadata *meta =
-          reinterpret_cast<PublicationMetadata *>(msg.data());
+      // Sending to the multicast group and over TCP would duplicate the
+      // messages of the subscribers that joined the group.
+      auto multicastIt = this->topicMulticast.find(topicKey);
+      if (allMulticast && multicastIt != this->topicMulticast.end())
+        sendInfo.multicast = multicastIt->second;
 
-        // Update topic statistics.
-        if (this->dataPtr->enabledTopicStatistics.find(topic) !=
-            this->dataPtr->enabledTopicStatistics.end())
-        {
-          this->dataPtr->topicStats[topic].Update(sender,
-              meta->stamp, meta->seq);
-          this->dataPtr->enabledTopicStatistics[topic](
-              this->dataPtr->topicStats[topic]);
-        }
-      }
-    }
-    catch(const zmq::error_t &_error)
-    {
-      std::cerr << "Error: " << _error.what() << std::endl;
-      return;
+      sendInfo.priority = this->priorityTopics.find(topicKey) !=
+        this->priorityTopics.end();
     }
+    sendInfo.metrics = MetricsOf(_topic);
 
-    handlerInfo = this->CheckHandlerInfo(topic);
+    std::lock_guard<std::mutex> lock(this->publisherMutex);
+    this->topicSendInfo[topicKey] = sendInfo;
   }
 
-  MessageInfo info;
-  info.SetTopicAndPartition(topic);
-  info.SetType(msgType);
-  this->TriggerCallbacks(info, data, handlerInfo);
+  return sendInfo;
 }
 
 //////////////////////////////////////////////////
-NodeShared::HandlerInfo NodeShared::CheckHandlerInfo(
-    const std::string &_topic) const
+zmq::message_t NodeSharedPrivate::MetadataFrame(const std::string &_topic,
+  const bool _tracing, const uint64_t _ackId)
 {
-  HandlerInfo info;
-
-  std::lock_guard<std::recursive_mutex> lk(this->mutex);
-
-  info.haveLocal = this->localSubscribers.normal.Handlers(
-        _topic, info.localHandlers);
-
-  info.haveRaw = this->localSubscribers.raw.Handlers(
-        _topic, info.rawHandlers);
-
-  return info;
+  PublicationMetadata meta;
+  // Send the sequence number, which can be used to detect dropped
+  // messages.
+  meta.seq = this->topicPubSeq[_topic]++;
+  // Send the publication time.
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  meta.stamp =
+    std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+  meta.stampNs =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  meta.systemStampNs =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+#ifdef IGN_TRANSPORT_TRACING
+  if (_tracing)
+    meta.traceId = Tracer::CurrentId();
+#endif
+  meta.ackId = _ackId;
+  // The trace ID is only sent when recording a trace, and the
+  // acknowledgement ID with the messages acknowledged.
+  return zmq::message_t(&meta, _ackId != 0 ? sizeof(meta) :
+    _tracing ? kTracedPublicationMetadataSize : kLongPublicationMetadataSize);
 }
 
 //////////////////////////////////////////////////
-NodeShared::SubscriberInfo NodeShared::CheckSubscriberInfo(
+bool NodeShared::Publish(
     const std::string &_topic,
-    const std::string &_msgType) const
+    char *_data,
+    const size_t _dataSize, DeallocFunc *_ffn,
+    const std::string &_msgType,
+    void *_hint,
+    const uint64_t _ackId)
 {
-  SubscriberInfo info;
+  IGN_TRANSPORT_COUNT_ALLOCATIONS(NODE_SHARED_PUBLISH);
 
-  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+  try
+  {
+    // Batches of messages keep their prefix in the type frame.
+    std::string typePrefix;
+    std::string msgType = _msgType;
+    if (msgType.compare(0, kBatchMsgTypePrefix.size(),
+          kBatchMsgTypePrefix) == 0)
+    {
+      typePrefix = kBatchMsgTypePrefix;
+      msgType.erase(0, kBatchMsgTypePrefix.size());
+    }
 
-  info.haveLocal = this->localSubscribers.normal.Handlers(
-        _topic, info.localHandlers);
+    // How to send the topic depends on the remote subscribers.
+    const NodeSharedPrivate::TopicSendInfo sendInfo =
+      this->dataPtr->SendInfo(_topic, msgType);
 
-  info.haveRaw = this->localSubscribers.raw.Handlers(
-        _topic, info.rawHandlers);
+    // The subscribers that can't unpack a batch receive its messages one
+    // by one.
+    if (!typePrefix.empty() && !sendInfo.batch)
+    {
+      std::vector<std::string> batch;
+      const bool unpacked = UnpackBatch(_data, _dataSize, batch);
+      if (_ffn)
+        _ffn(_data, _hint);
+      if (!unpacked)
+        return false;
+
+      auto deallocator = [](void * /*_buffer*/, void *_holder)
+      {
+        delete reinterpret_cast<std::string *>(_holder);
+      };
+      bool result = true;
+      for (std::string &msgData : batch)
+      {
+        std::string *holder = new std::string(std::move(msgData));
+        result = this->Publish(_topic, &(*holder)[0], holder->size(),
+          deallocator, msgType, holder, _ackId) && result;
+      }
+      return result;
+    }
 
-  info.haveRemote = this->remoteSubscribers.HasTopic(
-        _topic, _msgType);
+    // Large messages are passed through shared memory when all the remote
+    // subscribers are running on the same host.
+    ShmDescriptor shmDesc;
+    const bool useShm = sendInfo.shm && this->dataPtr->shmSegment &&
+      _dataSize >= kShmMinMsgSize &&
+      this->dataPtr->shmSegment->Write(_data, _dataSize, shmDesc);
+
+    // Otherwise, compress the message if requested when advertising it.
+    // Compression is not worth it when all the subscribers are on this host.
+    std::unique_ptr<std::string> compressed;
+    if (!sendInfo.shm &&
+        sendInfo.compression.compression == Compression_t::ZLIB &&
+        _dataSize >= sendInfo.compression.threshold)
+    {
+      compressed.reset(new std::string());
+      if (!ZlibCompress(_data, _dataSize, *compressed))
+        compressed.reset();
+    }
 
-  return info;
-}
+    if (useShm)
+      typePrefix = kShmMsgTypePrefix + typePrefix;
+    else if (compressed)
+      typePrefix = kZlibMsgTypePrefix + typePrefix;
+
+    // With an alias, the subscribers already know the topic, the advertised
+    // type and our address. High priority topics are advertised with the
+    // address of their own socket.
+    const bool useAlias = !sendInfo.alias.empty();
+    const std::string &topicFrame = useAlias ? sendInfo.alias : _topic;
+    std::string addrFrame;
+    if (!useAlias && sendInfo.priority)
+    {
+      std::lock_guard<std::mutex> lock(this->dataPtr->publisherMutex);
+      addrFrame = this->dataPtr->priorityAddress;
+    }
+    else if (!useAlias)
+    {
+      addrFrame = this->myAddress;
+    }
+    const std::string typeFrame = typePrefix + (useAlias ? "" : msgType);
 
-//////////////////////////////////////////////////
-void NodeShared::TriggerCallbacks(
-    const MessageInfo &_info,
-    const std::string &_msgData,
-    const HandlerInfo &_handlerInfo)
-{
-  if (!_handlerInfo.haveLocal && !_handlerInfo.haveRaw)
-    return;
+    auto sendFrame = [](zmq::socket_t &_socket, zmq::message_t &_frame,
+                        const bool _more)
+    {
+#ifdef IGN_ZMQ_POST_4_3_1
+      _socket.send(_frame,
+        _more ? zmq::send_flags::sndmore : zmq::send_flags::none);
+#else
+      _socket.send(_frame, _more ? ZMQ_SNDMORE : 0);
+#endif
+    };
 
-  if (_handlerInfo.haveRaw)
-  {
-    for (const auto &node : _handlerInfo.rawHandlers)
+#ifdef IGN_TRANSPORT_TRACING
+    // The trace ID is sent in the metadata.
+    const bool tracing = Tracer::Instance().Enabled();
+#else
+    const bool tracing = false;
+#endif
+    const bool sendMetadata = this->dataPtr->topicStatsEnabled ||
+      sendInfo.metadata || tracing || _ackId != 0;
+
+    // Create the publication metadata. Must be called with the publisher
+    // mutex locked.
+    auto metadataFrame = [this, &_topic, tracing, _ackId]()
     {
-      for (const auto &handler : node.second)
+      return this->dataPtr->MetadataFrame(_topic, tracing, _ackId);
+    };
+
+    // Large messages are split into chunks sent as separate messages, so
+    // the messages of the other topics are sent between them. The
+    // subscribers reassemble them.
+    const char *payload = compressed ? compressed->data() : _data;
+    const std::size_t payloadSize =
+      compressed ? compressed->size() : _dataSize;
+    if (!useShm && sendInfo.chunkSize > 0 && payloadSize > sendInfo.chunkSize)
+    {
+      // The chunks are views of the message, which is released once ZeroMQ
+      // is done with all of them.
+      auto source = std::make_shared<NodeSharedPrivate::ChunkedMsg>();
+      if (compressed)
       {
-        const RawSubscriptionHandlerPtr &rawHandler = handler.second;
-        if (rawHandler)
+        source->compressed = std::move(compressed);
+        if (_ffn)
+          _ffn(_data, _hint);
+      }
+      else
+      {
+        source->data = _data;
+        source->ffn = _ffn;
+        source->hint = _hint;
+      }
+      auto deallocator = [](void * /*_buffer*/, void *_holder)
+      {
+        delete reinterpret_cast<std::shared_ptr<
+          NodeSharedPrivate::ChunkedMsg> *>(_holder);
+      };
+
+      const std::string chunkTypeFrame = kChunkMsgTypePrefix + typeFrame;
+      ChunkHeader header;
+      header.id = this->dataPtr->nextChunkedMsgId++;
+      header.size = payloadSize;
+      IGN_TRANSPORT_TRACE_SCOPE("zmq_send", _topic, STEP);
+      while (header.offset < payloadSize)
+      {
+        const std::size_t size = std::min<std::size_t>(sendInfo.chunkSize,
+          payloadSize - header.offset);
+        const bool last = header.offset + size == payloadSize;
+        zmq::message_t msg0(topicFrame.data(), topicFrame.size()),
+                       msg1(addrFrame.data(), addrFrame.size()),
+                       msg2(const_cast<char *>(payload) + header.offset, size,
+                         deallocator,
+                         new std::shared_ptr<NodeSharedPrivate::ChunkedMsg>(
+                           source)),
+                       msg3(chunkTypeFrame.data(), chunkTypeFrame.size()),
+                       msg4(&header, sizeof(header));
+
+        // The metadata is sent with the last chunk.
+        std::lock_guard<std::mutex> lock(this->dataPtr->publisherMutex);
+        zmq::socket_t &socket = sendInfo.multicast ? *sendInfo.multicast :
+          sendInfo.priority ? *this->dataPtr->priorityPublisher :
+          *this->dataPtr->publisher;
+        sendFrame(socket, msg0, true);
+        sendFrame(socket, msg1, true);
+        sendFrame(socket, msg2, true);
+        sendFrame(socket, msg3, true);
+        sendFrame(socket, msg4, last && sendMetadata);
+        if (last && sendMetadata)
         {
-          if (rawHandler->TypeName() == _info.Type() ||
-              rawHandler->TypeName() == kGenericMessageType)
-          {
-            rawHandler->RunRawCallback(_msgData.c_str(), _msgData.size(),
-                _info);
-          }
+          zmq::message_t msg5 = metadataFrame();
+          sendFrame(socket, msg5, false);
         }
-        else
-          std::cerr << "Raw subscription handler is NULL" << std::endl;
+        header.offset += size;
       }
+
+      sendInfo.metrics.sentMsgs->Increment();
+      sendInfo.metrics.sentBytes->Increment(_dataSize);
+      return true;
     }
-  }
 
-  if (_handlerInfo.haveLocal)
-  {
-    // This will be instantiated by the first suitable handler that we
-    // encounter. If there is no suitable handler, then we can avoid
-    // deserializing the message altogether.
-    std::shared_ptr<ProtoMsg> msg;
+    // The messages of a reliable topic are numbered and retained, the
+    // buffer and ZeroMQ share the data frame.
+    if (sendInfo.reliable)
+    {
+      auto retained = std::make_shared<std::string>(payload, payloadSize);
+      compressed.reset();
+      if (_ffn)
+        _ffn(_data, _hint);
+      auto deallocator = [](void * /*_buffer*/, void *_holder)
+      {
+        delete reinterpret_cast<std::shared_ptr<std::string> *>(_holder);
+      };
+
+      const std::string reliableTypeFrame = kReliableMsgTypePrefix + typeFrame;
+      zmq::message_t msg0(topicFrame.data(), topicFrame.size()),
+                     msg1(addrFrame.data(), addrFrame.size()),
+                     msg2(&(*retained)[0], retained->size(), deallocator,
+                       new std::shared_ptr<std::string>(retained)),
+                     msg3(reliableTypeFrame.data(), reliableTypeFrame.size());
+
+      // The sequence numbers are assigned in the order of the messages
+      // sent.
+      IGN_TRANSPORT_TRACE_SCOPE("zmq_send", _topic, STEP);
+      std::lock_guard<std::mutex> lock(this->dataPtr->publisherMutex);
+      ReliableHeader header;
+      header.seq = sendInfo.reliable->Push(retained, typePrefix);
+      zmq::message_t msg4(&header, sizeof(header));
+      zmq::socket_t &socket = sendInfo.multicast ? *sendInfo.multicast :
+        sendInfo.priority ? *this->dataPtr->priorityPublisher :
+        *this->dataPtr->publisher;
+      sendFrame(socket, msg0, true);
+      sendFrame(socket, msg1, true);
+      sendFrame(socket, msg2, true);
+      sendFrame(socket, msg3, true);
+      sendFrame(socket, msg4, sendMetadata);
+      if (sendMetadata)
+      {
+        zmq::message_t msg5 = metadataFrame();
+        sendFrame(socket, msg5, false);
+      }
 
-    for (const auto &node : _handlerInfo.localHandlers)
+      sendInfo.metrics.sentMsgs->Increment();
+      sendInfo.metrics.sentBytes->Increment(_dataSize);
+      return true;
+    }
+
+    // Create the messages.
+    // Note that we use zero copy for passing the message data (msg2).
+    zmq::message_t msg0(topicFrame.data(), topicFrame.size()),
+                   msg1(addrFrame.data(), addrFrame.size()),
+                   msg2,
+                   msg3(typeFrame.data(), typeFrame.size());
+    if (useShm)
     {
-      for (const auto &handler : node.second)
+      msg2.rebuild(&shmDesc, sizeof(shmDesc));
+
+      // The data has already been copied into the segment.
+      if (_ffn)
+        _ffn(_data, _hint);
+    }
+    else if (compressed)
+    {
+      // ZeroMQ owns the compressed data, we don't need the original.
+      auto deallocator = [](void * /*_buffer*/, void *_holder)
       {
-        const ISubscriptionHandlerPtr &localHandler = handler.second;
-        if (localHandler)
-        {
-          if (localHandler->TypeName() == _info.Type() ||
-              localHandler->TypeName() == kGenericMessageType)
-          {
-            if (!msg)
-            {
-              // If the message has not been deserialized yet, do it now since
-              // we have allegedly found a subscriber which should be able to
-              // do it.
-              msg = localHandler->CreateMsg(_msgData, _info.Type());
+        delete reinterpret_cast<std::string *>(_holder);
+      };
+      std::string *holder = compressed.release();
+      msg2.rebuild(&(*holder)[0], holder->size(), deallocator, holder);
 
-              if (!msg)
-              {
-                // If the message could not be created, then none of the
-                // handlers in this process will be able to create it, because
-                // protobuf has access to all message types that the current
-                // process is linked to. If CreateMsg(~,~) fails, then we may
-                // as well quit.
-                return;
-              }
-            }
+      if (_ffn)
+        _ffn(_data, _hint);
+    }
+    else
+    {
+      msg2.rebuild(_data, _dataSize, _ffn, _hint);
+    }
 
-            localHandler->RunLocalCallback(*msg, _info);
-          }
-        }
-        else
-          std::cerr << "Local subscription handler is NULL" << std::endl;
-      }
+    // Send the messages
+    IGN_TRANSPORT_TRACE_SCOPE("zmq_send", _topic, STEP);
+    std::lock_guard<std::mutex> lock(this->dataPtr->publisherMutex);
+    zmq::socket_t &socket = sendInfo.multicast ? *sendInfo.multicast :
+      sendInfo.priority ? *this->dataPtr->priorityPublisher :
+      *this->dataPtr->publisher;
+    sendFrame(socket, msg0, true);
+    sendFrame(socket, msg1, true);
+    sendFrame(socket, msg2, true);
+    sendFrame(socket, msg3, sendMetadata);
+    if (sendMetadata)
+    {
+      zmq::message_t msg4 = metadataFrame();
+      sendFrame(socket, msg4, false);
     }
+
+    sendInfo.metrics.sentMsgs->Increment();
+    sendInfo.metrics.sentBytes->Increment(_dataSize);
+  }
+  catch(const zmq::error_t& ze)
+  {
+     std::cerr << "NodeShared::Publish() Error: " << ze.what() << std::endl;
+     return false;
   }
-}
 
-//////////////////////////////////////////////////
-void NodeShared::RecvControlUpdate()
-{
+  return true;
 }
 
 //////////////////////////////////////////////////
-void NodeShared::RecvSrvRequest()
+bool NodeShared::PublishSegments(const std::string &_topic,
+  const std::shared_ptr<const std::vector<MessageSegment>> &_segments,
+  const std::string &_msgType)
 {
-  if (verbose)
-    std::cout << "Message received requesting a service call" << std::endl;
-
-  zmq::message_t msg(0);
-  std::string topic;
-  std::string sender;
-  std::string nodeUuid;
-  std::string reqUuid;
-  std::string req;
-  std::string rep;
-  std::string resultStr;
-  std::string dstId;
-  std::string reqType;
-  std::string repType;
+  std::size_t size = 0;
+  for (const auto &segment : *_segments)
+    size += segment.size;
+
+  const NodeSharedPrivate::TopicSendInfo sendInfo =
+    this->dataPtr->SendInfo(_topic, _msgType);
+
+  // The segments are sent as the chunks of a message, unless the message
+  // has to be contiguous: some subscribers can't reassemble it, it's read
+  // from shared memory, compressed or retained for retransmission.
+  const bool compress =
+    sendInfo.compression.compression == Compression_t::ZLIB &&
+    size >= sendInfo.compression.threshold;
+  if (sendInfo.chunkSize == 0 || sendInfo.shm || sendInfo.reliable ||
+      compress || size == 0 || _segments->size() < 2u)
+  {
+    std::string *gathered = new std::string();
+    gathered->reserve(size);
+    for (const auto &segment : *_segments)
+      gathered->append(segment.data, segment.size);
 
-  IRepHandlerPtr repHandler;
-  bool hasHandler;
+    auto deallocator = [](void * /*_buffer*/, void *_holder)
+    {
+      delete reinterpret_cast<std::string *>(_holder);
+    };
+    return this->Publish(_topic, &(*gathered)[0], gathered->size(),
+      deallocator, _msgType, gathered);
+  }
 
+  try
   {
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    const bool useAlias = !sendInfo.alias.empty();
+    const std::string &topicFrame = useAlias ? sendInfo.alias : _topic;
+    std::string addrFrame;
+    if (!useAlias && sendInfo.priority)
+    {
+      std::lock_guard<std::mutex> lock(this->dataPtr->publisherMutex);
+      addrFrame = this->dataPtr->priorityAddress;
+    }
+    else if (!useAlias)
+    {
+      addrFrame = this->myAddress;
+    }
+    const std::string typeFrame =
+      kChunkMsgTypePrefix + (useAlias ? "" : _msgType);
 
-    try
+    auto sendFrame = [](zmq::socket_t &_socket, zmq::message_t &_frame,
+                        const bool _more)
     {
 #ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
+      _socket.send(_frame,
+        _more ? zmq::send_flags::sndmore : zmq::send_flags::none);
 #else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+      _socket.send(_frame, _more ? ZMQ_SNDMORE : 0);
 #endif
-        return;
+    };
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
-#else
-      if (!this->dataPtr->replier->recv(&msg, 0))
-#endif
-        return;
-      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+    // Each frame keeps the segments alive until ZeroMQ sent it.
+    auto deallocator = [](void * /*_buffer*/, void *_holder)
+    {
+      delete reinterpret_cast<
+        std::shared_ptr<const std::vector<MessageSegment>> *>(_holder);
+    };
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
+#ifdef IGN_TRANSPORT_TRACING
+    const bool tracing = Tracer::Instance().Enabled();
 #else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+    const bool tracing = false;
 #endif
-        return;
-      sender = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
-
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
-#else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+    const bool sendMetadata =
+      this->dataPtr->topicStatsEnabled || sendInfo.metadata || tracing;
+
+    ChunkHeader header;
+    header.id = this->dataPtr->nextChunkedMsgId++;
+    header.size = size;
+    IGN_TRANSPORT_TRACE_SCOPE("zmq_send", _topic, STEP);
+    for (const auto &segment : *_segments)
+    {
+      // Large segments are split, so the messages of the other topics are
+      // sent between their chunks.
+      std::size_t offset = 0;
+      while (offset < segment.size)
+      {
+        const std::size_t chunk =
+          std::min(sendInfo.chunkSize, segment.size - offset);
+        const bool last = header.offset + chunk == size;
+        zmq::message_t msg0(topicFrame.data(), topicFrame.size()),
+                       msg1(addrFrame.data(), addrFrame.size()),
+                       msg2(const_cast<char *>(segment.data) + offset, chunk,
+                         deallocator,
+                         new std::shared_ptr<const std::vector<
+                           MessageSegment>>(_segments)),
+                       msg3(typeFrame.data(), typeFrame.size()),
+                       msg4(&header, sizeof(header));
+
+        // The metadata is sent with the last chunk.
+        std::lock_guard<std::mutex> lock(this->dataPtr->publisherMutex);
+        zmq::socket_t &socket = sendInfo.multicast ? *sendInfo.multicast :
+          sendInfo.priority ? *this->dataPtr->priorityPublisher :
+          *this->dataPtr->publisher;
+        sendFrame(socket, msg0, true);
+        sendFrame(socket, msg1, true);
+        sendFrame(socket, msg2, true);
+        sendFrame(socket, msg3, true);
+        sendFrame(socket, msg4, last && sendMetadata);
+        if (last && sendMetadata)
+        {
+          zmq::message_t msg5 = this->dataPtr->MetadataFrame(_topic, tracing);
+          sendFrame(socket, msg5, false);
+        }
+        offset += chunk;
+        header.offset += chunk;
+      }
+    }
+
+    sendInfo.metrics.sentMsgs->Increment();
+    sendInfo.metrics.sentBytes->Increment(size);
+  }
+  catch(const zmq::error_t& ze)
+  {
+     std::cerr << "NodeShared::PublishSegments() Error: " << ze.what()
+               << std::endl;
+     return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RecvMsgUpdate()
+{
+  IGN_TRANSPORT_COUNT_ALLOCATIONS(RECV_MSG_UPDATE);
+
+  zmq::message_t msg(0);
+  std::string topic;
+  std::string sender;
+  NodeSharedPrivate::ReceivedMsg data;
+  std::string msgType;
+  std::vector<NodeSharedPrivate::ReceivedMsg> msgs;
+  bool drop = false;
+  const NodeSharedPrivate::TopicAliasInfo *aliasInfo = nullptr;
+  PublicationMetadata meta;
+  std::size_t metaSize = 0;
+  uint64_t ackId = 0;
+  std::chrono::steady_clock::time_point received;
+#ifdef IGN_TRANSPORT_TRACING
+  const double recvStart =
+    Tracer::Instance().Enabled() ? Tracer::Now() : -1.0;
 #endif
-        return;
-      dstId = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
 
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    try
+    {
 #ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
+      if (!this->dataPtr->subscriber->recv(msg))
 #else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+      if (!this->dataPtr->subscriber->recv(&msg, 0))
 #endif
         return;
-      nodeUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      // Stamped before the message is parsed and its callbacks dispatched
+      received = std::chrono::steady_clock::now();
+      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+      // The message was sent to this process only.
+      if (topic.compare(0, this->dataPtr->directPrefix.size(),
+            this->dataPtr->directPrefix) == 0)
+      {
+        topic.erase(0, this->dataPtr->directPrefix.size());
+      }
+
+      // The publisher replaced the topic name with an alias.
+      if (IsTopicAlias(topic))
+      {
+        auto aliasIt = this->dataPtr->topicAliases.find(topic);
+        if (aliasIt != this->dataPtr->topicAliases.end())
+        {
+          aliasInfo = &aliasIt->second;
+          topic = aliasInfo->topic;
+        }
+        else
+        {
+          drop = true;
+        }
+      }
 
+      // TODO(caguero): Use this as extra metadata for the subscriber.
 #ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
+      if (!this->dataPtr->subscriber->recv(msg))
 #else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+      if (!this->dataPtr->subscriber->recv(&msg, 0))
 #endif
         return;
-      reqUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      sender = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      if (aliasInfo)
+        sender = aliasInfo->addr;
+
+      // The multicast groups loop our own messages back. The local
+      // subscribers already got them.
+      if (sender == this->myAddress ||
+          (!this->dataPtr->priorityAddress.empty() &&
+           sender == this->dataPtr->priorityAddress))
+      {
+        drop = true;
+      }
 
+      // The callbacks read the data frame in place, without copying it.
+      auto dataFrame = std::make_shared<zmq::message_t>();
 #ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
+      if (!this->dataPtr->subscriber->recv(*dataFrame))
 #else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+      if (!this->dataPtr->subscriber->recv(dataFrame.get(), 0))
 #endif
         return;
-      req = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      data.data = std::shared_ptr<char>(dataFrame,
+        static_cast<char *>(dataFrame->data()));
+      data.size = dataFrame->size();
 
 #ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
+      if (!this->dataPtr->subscriber->recv(msg))
 #else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+      if (!this->dataPtr->subscriber->recv(&msg, 0))
 #endif
         return;
-      reqType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      msgType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+      // The message of a reliable topic is numbered by the publisher. It's
+      // dropped if it was already received, and the messages missed are
+      // requested.
+      if (msgType.compare(0, kReliableMsgTypePrefix.size(),
+            kReliableMsgTypePrefix) == 0)
+      {
+        msgType.erase(0, kReliableMsgTypePrefix.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->replier->recv(msg))
+        if (!this->dataPtr->subscriber->recv(msg))
 #else
-      if (!this->dataPtr->replier->recv(&msg, 0))
+        if (!this->dataPtr->subscriber->recv(&msg, 0))
 #endif
-        return;
-      repType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+          return;
+
+        ReliableHeader header;
+        auto streamIt = this->dataPtr->reliableStreams.find(sender + topic);
+        if (!drop && msg.size() == sizeof(header) &&
+            streamIt != this->dataPtr->reliableStreams.end())
+        {
+          std::memcpy(&header, msg.data(), sizeof(header));
+          if (!streamIt->second.tracker.Received(header.seq))
+            drop = true;
+
+          const auto nacks = streamIt->second.tracker.Nacks(received);
+          if (!nacks.empty())
+            this->dataPtr->SendNack(topic, streamIt->second, nacks);
+        }
+      }
+
+      // The data frame is a chunk of a larger message, which is processed
+      // once all its chunks are received.
+      bool partial = false;
+      if (msgType.compare(0, kChunkMsgTypePrefix.size(),
+            kChunkMsgTypePrefix) == 0)
+      {
+        msgType.erase(0, kChunkMsgTypePrefix.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+        if (!this->dataPtr->subscriber->recv(msg))
+#else
+        if (!this->dataPtr->subscriber->recv(&msg, 0))
+#endif
+          return;
+
+        ChunkHeader header;
+        std::shared_ptr<char> whole;
+        bool valid = !drop && msg.size() == sizeof(header);
+        if (valid)
+        {
+          std::memcpy(&header, msg.data(), sizeof(header));
+          valid = this->dataPtr->chunks.Add(sender, header,
+            data.data.get(), data.size, received, whole);
+        }
+
+        if (!valid)
+        {
+          if (!drop && this->verbose)
+          {
+            std::cerr << "Dropping message on topic [" << topic << "] from ["
+                      << sender << "]: some of its chunks are missing or "
+                      << "it exceeds the limits of the chunked messages"
+                      << std::endl;
+          }
+          drop = true;
+        }
+        else if (whole)
+        {
+          data = {whole, static_cast<std::size_t>(header.size), nullptr};
+        }
+        else
+        {
+          partial = true;
+        }
+      }
+
+      // The data frame contains the location of the message in the shared
+      // memory segment of the publisher.
+      if (msgType.compare(0, kShmMsgTypePrefix.size(), kShmMsgTypePrefix) == 0)
+      {
+        msgType.erase(0, kShmMsgTypePrefix.size());
+
+        ShmDescriptor desc;
+        auto peerIt = this->dataPtr->shmPeers.find(sender);
+        bool valid = peerIt != this->dataPtr->shmPeers.end() &&
+          data.size == sizeof(desc);
+        if (valid)
+        {
+          std::memcpy(&desc, data.data.get(), sizeof(desc));
+          auto buffer = std::make_shared<std::string>();
+          valid = peerIt->second.segment->Read(desc, *buffer);
+          if (valid)
+            data = viewHelper(buffer);
+        }
+
+        // The message was overwritten before we could read it.
+        if (!valid)
+        {
+          if (this->verbose)
+          {
+            std::cerr << "Dropping message on topic [" << topic << "] from ["
+                      << sender << "]: unable to read it from shared memory"
+                      << std::endl;
+          }
+          drop = true;
+        }
+      }
+
+      // The data frame was compressed by the publisher.
+      if (msgType.compare(0, kZlibMsgTypePrefix.size(),
+            kZlibMsgTypePrefix) == 0)
+      {
+        msgType.erase(0, kZlibMsgTypePrefix.size());
+
+        auto decompressed = std::make_shared<std::string>();
+        if (!drop && !partial &&
+            !ZlibDecompress(data.data.get(), data.size, *decompressed))
+        {
+          std::cerr << "Dropping message on topic [" << topic << "] from ["
+                    << sender << "]: unable to decompress it" << std::endl;
+          drop = true;
+        }
+        if (!drop && !partial)
+          data = viewHelper(decompressed);
+      }
+
+      // The data frame contains several messages packed with PackBatch().
+      if (msgType.compare(0, kBatchMsgTypePrefix.size(),
+            kBatchMsgTypePrefix) == 0)
+      {
+        msgType.erase(0, kBatchMsgTypePrefix.size());
+
+        // Each message of the batch is a view into the same buffer.
+        std::vector<std::pair<std::size_t, std::size_t>> offsets;
+        if (!drop && !partial &&
+            !UnpackBatch(data.data.get(), data.size, offsets))
+        {
+          std::cerr << "Dropping invalid batch of messages on topic ["
+                    << topic << "] from [" << sender << "]" << std::endl;
+          drop = true;
+        }
+
+        for (const auto &offset : offsets)
+        {
+          msgs.push_back({std::shared_ptr<char>(data.data,
+            data.data.get() + offset.first), offset.second, nullptr});
+        }
+      }
+      else if (!partial)
+      {
+        msgs.push_back(data);
+      }
+
+      // The type is omitted when it's the advertised type.
+      if (aliasInfo && msgType.empty())
+        msgType = aliasInfo->msgType;
+
+      // The publication metadata is optional, the publisher sends it if
+      // IGN_TRANSPORT_TOPIC_STATISTICS is set or if a subscriber wants it.
+      if (msg.more())
+      {
+#ifdef IGN_ZMQ_POST_4_3_1
+        if (!this->dataPtr->subscriber->recv(msg))
+#else
+        if (!this->dataPtr->subscriber->recv(&msg, 0))
+#endif
+          return;
+        metaSize = msg.size();
+        memcpy(&meta, msg.data(), std::min(metaSize, sizeof(meta)));
+
+        // The publisher waits for our acknowledgement of the whole message.
+        if (!partial && metaSize >= sizeof(meta))
+          ackId = meta.ackId;
+      }
     }
     catch(const zmq::error_t &_error)
     {
-      std::cerr << "NodeShared::RecvSrvRequest() error parsing request: "
-                << _error.what() << std::endl;
+      std::cerr << "Error: " << _error.what() << std::endl;
       return;
     }
-
-    hasHandler =
-      this->repliers.FirstHandler(topic, reqType, repType, repHandler);
   }
 
-  // Get the REP handler.
-  if (hasHandler)
+  // Acknowledge the message once the last callback holding it returned,
+  // also if it's dropped, so its publisher doesn't wait for it. The
+  // subscriptions running on executors or on threads of their own keep it
+  // until their callbacks ran.
+  std::shared_ptr<void> ack;
+  if (ackId != 0)
+  {
+    ack = std::shared_ptr<void>(nullptr, [this, topic, sender, ackId](void *)
+    {
+      if (this->dataPtr->exit)
+        return;
+      std::lock_guard<std::recursive_mutex> lock(this->mutex);
+      this->dataPtr->SendAck(topic, sender, ackId);
+    });
+    for (auto &msgData : msgs)
+      msgData.ack = ack;
+  }
+
+#ifdef IGN_TRANSPORT_TRACING
+  // The callbacks of the message are linked to its publication.
+  const uint64_t traceId =
+    metaSize >= kTracedPublicationMetadataSize ? meta.traceId : 0u;
+  if (recvStart >= 0)
+  {
+    Tracer::Instance().Complete("zmq_recv", topic, traceId, recvStart,
+      Tracer::Now(), TraceFlow::STEP);
+  }
+#endif
+  IGN_TRANSPORT_TRACE_CONTEXT(traceId);
+
+  // Update the topic statistics without holding the mutex, the statistics
+  // thread triggers the callback.
+  std::shared_ptr<NodeSharedPrivate::TopicStatsEntry> topicStats;
+  if (metaSize >= kShortPublicationMetadataSize)
+    topicStats = this->dataPtr->CachedTopicStats(topic);
+  if (topicStats)
+  {
+    const bool sameHost = NodeSharedPrivate::SameHost(sender, this->hostAddr);
+    this->dataPtr->UpdateTopicStats(*topicStats,
+      [&meta, &metaSize, &sender, sameHost](TopicStatistics &_stats)
+      {
+        if (metaSize < kLongPublicationMetadataSize)
+        {
+          // An older publisher, with a millisecond time stamp.
+          _stats.Update(sender, meta.stamp, meta.seq);
+        }
+        else
+        {
+          _stats.Update(sender, std::chrono::nanoseconds(meta.stampNs),
+            std::chrono::nanoseconds(meta.systemStampNs), sameHost, meta.seq);
+        }
+      });
+  }
+
+  // All the frames have been received, we can skip the message now.
+  if (drop || msgs.empty())
+  {
+    if (drop)
+      this->dataPtr->discardedMsgs.Increment();
+    return;
+  }
+
+  MessageInfo info;
+  info.SetTopicAndPartition(topic);
+  info.SetType(msgType);
+  info.SetReceiveTime(received);
+
+  const std::shared_ptr<const NodeSharedPrivate::TopicHandlers> handlers =
+    this->dataPtr->CachedHandlers(topic);
+
+  uint64_t receivedBytes = 0;
+  for (const auto &msgData : msgs)
+    receivedBytes += msgData.size;
+  handlers->metrics.receivedMsgs->Increment(msgs.size());
+  handlers->metrics.receivedBytes->Increment(receivedBytes);
+
+  // Common case: all the callbacks run here, use the snapshot as is.
+  if (handlers->direct)
+  {
+    for (const auto &msgData : msgs)
+    {
+      this->TriggerCallbacks(info, msgData.data.get(), msgData.size,
+        handlers->info);
+    }
+    return;
+  }
+
+  HandlerInfo handlerInfo = handlers->info;
+
+  // Conflated subscriptions only get the latest message of a batch.
+  this->dataPtr->ConflateHandlers(info, msgs.back(), handlerInfo);
+
+  // Batched subscriptions get all the messages pending at once.
+  this->dataPtr->BatchHandlers(info, msgs, handlerInfo);
+
+  // The subscriptions with an executor run on their own threads.
+  const uint64_t dropped =
+    this->dataPtr->DispatchHandlers(info, msgs, handlerInfo);
+
+  if (dropped > 0)
+  {
+    handlers->metrics.queueDroppedMsgs->Increment(dropped);
+
+    if (!topicStats)
+      topicStats = this->dataPtr->CachedTopicStats(topic);
+    if (topicStats)
+    {
+      this->dataPtr->UpdateTopicStats(*topicStats,
+        [dropped](TopicStatistics &_stats)
+        {
+          _stats.UpdateQueueDrops(dropped);
+        });
+    }
+  }
+
+  if (!handlerInfo.haveLocal && !handlerInfo.haveRaw)
+    return;
+
+  for (const auto &msgData : msgs)
+  {
+    this->TriggerCallbacks(info, msgData.data.get(), msgData.size,
+      handlerInfo);
+  }
+}
+
+//////////////////////////////////////////////////
+NodeShared::HandlerInfo NodeShared::CheckHandlerInfo(
+    const std::string &_topic) const
+{
+  HandlerInfo info;
+
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+
+  info.haveLocal = this->localSubscribers.normal.Handlers(
+        _topic, info.localHandlers);
+
+  info.haveRaw = this->localSubscribers.raw.Handlers(
+        _topic, info.rawHandlers);
+
+  return info;
+}
+
+//////////////////////////////////////////////////
+NodeShared::SubscriberInfo NodeShared::CheckSubscriberInfo(
+    const std::string &_topic,
+    const std::string &_msgType) const
+{
+  SubscriberInfo info;
+
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+
+  info.haveLocal = this->localSubscribers.normal.Handlers(
+        _topic, info.localHandlers);
+
+  info.haveRaw = this->localSubscribers.raw.Handlers(
+        _topic, info.rawHandlers);
+
+  info.haveRemote = this->remoteSubscribers.HasTopic(
+        _topic, _msgType);
+
+  // The remote subscribers announce their rate when they register.
+  MsgAddresses_M remotes;
+  if (info.haveRemote && this->remoteSubscribers.Publishers(_topic, remotes))
+  {
+    bool found = false;
+    for (const auto &proc : remotes)
+    {
+      for (const MessagePublisher &remote : proc.second)
+      {
+        if (remote.MsgTypeName() != _msgType &&
+            remote.MsgTypeName() != kGenericMessageType)
+        {
+          continue;
+        }
+
+        const uint64_t rate = remote.Options().MsgsPerSec();
+        info.remoteMsgsPerSec =
+          found ? std::max(info.remoteMsgsPerSec, rate) : rate;
+        found = true;
+      }
+    }
+  }
+
+  return info;
+}
+
+//////////////////////////////////////////////////
+void NodeShared::TriggerCallbacks(
+    const MessageInfo &_info,
+    const std::string &_msgData,
+    const HandlerInfo &_handlerInfo)
+{
+  this->TriggerCallbacks(_info, _msgData.data(), _msgData.size(),
+    _handlerInfo);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::TriggerCallbacks(
+    const MessageInfo &_info,
+    const char *_msgData,
+    const std::size_t _size,
+    const HandlerInfo &_handlerInfo)
+{
+  IGN_TRANSPORT_COUNT_ALLOCATIONS(TRIGGER_CALLBACKS);
+
+  if (!_handlerInfo.haveLocal && !_handlerInfo.haveRaw)
+    return;
+
+  if (_handlerInfo.haveRaw)
+  {
+    for (const auto &node : _handlerInfo.rawHandlers)
+    {
+      for (const auto &handler : node.second)
+      {
+        const RawSubscriptionHandlerPtr &rawHandler = handler.second;
+        if (rawHandler)
+        {
+          if (rawHandler->TypeName() == _info.Type() ||
+              rawHandler->TypeName() == kGenericMessageType)
+          {
+            IGN_TRANSPORT_TRACE_SCOPE("callback", _info.Topic(), END);
+            rawHandler->RunRawCallback(_msgData, _size, _info);
+          }
+        }
+        else
+          std::cerr << "Raw subscription handler is NULL" << std::endl;
+      }
+    }
+  }
+
+  if (_handlerInfo.haveLocal)
+  {
+    // This will be instantiated by the first suitable handler that we
+    // encounter. If there is no suitable handler, then we can avoid
+    // deserializing the message altogether. A throttled or filtered handler
+    // that would discard the message is not suitable.
+    std::shared_ptr<ProtoMsg> msg;
+
+    for (const auto &node : _handlerInfo.localHandlers)
+    {
+      for (const auto &handler : node.second)
+      {
+        const ISubscriptionHandlerPtr &localHandler = handler.second;
+        if (localHandler)
+        {
+          if ((localHandler->TypeName() == _info.Type() ||
+               localHandler->TypeName() == kGenericMessageType) &&
+              localHandler->ThrottledUpdateReady() &&
+              localHandler->HeaderAccepted(_msgData, _size, _info.Type()))
+          {
+            if (!msg)
+            {
+              // If the message has not been deserialized yet, do it now since
+              // we have allegedly found a subscriber which should be able to
+              // do it.
+              IGN_TRANSPORT_TRACE_SCOPE("parse", _info.Topic(), STEP);
+              msg = localHandler->ParseMsg(_msgData, _size, _info.Type());
+
+              if (!msg)
+              {
+                // If the message could not be created, then none of the
+                // handlers in this process will be able to create it, because
+                // protobuf has access to all message types that the current
+                // process is linked to. If ParseMsg(~,~,~) fails, then we may
+                // as well quit.
+                return;
+              }
+            }
+
+            IGN_TRANSPORT_TRACE_SCOPE("callback", _info.Topic(), END);
+            localHandler->RunLocalCallback(msg, _info);
+          }
+        }
+        else
+          std::cerr << "Local subscription handler is NULL" << std::endl;
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RecvControlUpdate()
+{
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RecvSrvRequest()
+{
+  if (verbose)
+    std::cout << "Message received requesting a service call" << std::endl;
+
+  zmq::message_t msg(0);
+  std::string topic;
+  std::string sender;
+  std::string nodeUuid;
+  std::string reqUuid;
+  std::string req;
+  std::string dstId;
+  std::string reqType;
+  std::string repType;
+  bool batch = false;
+  std::chrono::steady_clock::time_point received;
+
+  IRepHandlerPtr repHandler;
+  bool hasHandler;
+
+  // The socket is only used by this thread, the mutex is only needed to
+  // look up the handler.
+  {
+    try
+    {
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      sender = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      dstId = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      nodeUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      reqUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      req = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      reqType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->replier->recv(msg))
+#else
+      if (!this->dataPtr->replier->recv(&msg, 0))
+#endif
+        return;
+      repType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+    }
+    catch(const zmq::error_t &_error)
+    {
+      std::cerr << "NodeShared::RecvSrvRequest() error parsing request: "
+                << _error.what() << std::endl;
+      return;
+    }
+    received = std::chrono::steady_clock::now();
+
+    // The data frame of a batch of oneway requests contains several
+    // requests packed with PackBatch().
+    if (reqType.compare(0, kBatchMsgTypePrefix.size(),
+          kBatchMsgTypePrefix) == 0)
+    {
+      reqType.erase(0, kBatchMsgTypePrefix.size());
+      batch = true;
+    }
+
+    // A requester stopped waiting for a request.
+    if (reqType == NodeSharedPrivate::kSrvCancelType)
+    {
+      std::lock_guard<std::mutex> lk(this->dataPtr->queuedSrvRequestsMutex);
+      auto it = this->dataPtr->queuedSrvRequests.find(dstId + reqUuid);
+      if (it != this->dataPtr->queuedSrvRequests.end())
+        *it->second = true;
+      return;
+    }
+
+    // A subscriber of a reliable topic missed some messages. The node UUID
+    // frame carries its process UUID and the response type frame the
+    // message type.
+    if (reqType == kReliableNackType)
+    {
+      std::vector<SeqRange> ranges;
+      if (ParseNackFrame(req, ranges))
+        this->dataPtr->Retransmit(topic, repType, nodeUuid, ranges);
+      return;
+    }
+
+    // A subscriber ran its callbacks of a message published with
+    // PublishAcked(). The node UUID frame carries its process UUID.
+    if (reqType == kAckType)
+    {
+      uint64_t ackId;
+      if (ParseAckFrame(req, ackId))
+        this->dataPtr->pendingAcks.Received(ackId, nodeUuid);
+      return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    hasHandler =
+      this->repliers.FirstHandler(topic, reqType, repType, repHandler);
+  }
+
+  if (!hasHandler)
+  {
+    // std::cerr << "I do not have a service call registered for topic ["
+    //           << topic << "]\n";
+    return;
+  }
+
+  // The deadline of the request, if the requester has a timeout. The
+  // budget doesn't account for the time the request spent in the queues,
+  // the deadline does but it's only comparable when both processes share
+  // the system clock.
+  auto deadline = std::chrono::steady_clock::time_point::max();
+  int64_t requesterDeadline;
+  uint32_t budget;
+  if (NodeSharedPrivate::ParseDeadlineFrame(nodeUuid, requesterDeadline,
+        budget))
+  {
+    const auto now = std::chrono::steady_clock::now();
+    deadline = now + std::chrono::milliseconds(budget);
+
+    if (NodeSharedPrivate::SameHost(sender, this->hostAddr))
+    {
+      const int64_t systemNow =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count();
+      deadline = std::min(deadline,
+        now + std::chrono::milliseconds(requesterDeadline - systemNow));
+    }
+
+    if (std::chrono::steady_clock::now() >= deadline)
+    {
+      if (this->verbose)
+      {
+        std::cout << "Skipping an expired request of service [" << topic
+                  << "]" << std::endl;
+      }
+      this->dataPtr->UpdateServiceStats(topic, [](ServiceStatistics &_stats)
+        {
+          _stats.RequestReceived();
+          _stats.RequestDropped();
+        });
+      return;
+    }
+  }
+
+  // If 'reptype' is msgs::Empty", this is a oneway request
+  // and we don't send response
+  const bool oneway = repType == ignition::msgs::Empty().GetTypeName();
+
+  if (batch)
+  {
+    std::vector<std::string> reqs;
+    if (!oneway || !UnpackBatch(req.data(), req.size(), reqs))
+    {
+      std::cerr << "NodeShared::RecvSrvRequest() error: invalid batch of "
+                << "requests for service [" << topic << "]" << std::endl;
+      return;
+    }
+
+    this->dataPtr->UpdateServiceStats(topic,
+      [&reqs](ServiceStatistics &_stats)
+      {
+        for (std::size_t i = 0; i < reqs.size(); ++i)
+          _stats.RequestReceived();
+      });
+
+    std::shared_ptr<CallbackExecutor> executor;
+    if (repHandler->MaxConcurrency() > 0)
+    {
+      std::lock_guard<std::mutex> lk(this->dataPtr->executorsMutex);
+      executor = this->dataPtr->ReplierExecutor(repHandler);
+    }
+
+    NodeSharedPrivate *dataPtrRaw = this->dataPtr.get();
+    auto batchTopic = std::make_shared<const std::string>(topic);
+    for (std::string &batchReq : reqs)
+    {
+      if (!executor)
+      {
+        this->dataPtr->RunServiceCallback(topic, received,
+          [&repHandler, &batchReq]()
+          {
+            std::string rep;
+            return repHandler->RunCallback(batchReq, rep);
+          });
+        continue;
+      }
+
+      // The queue of the service is full, there is no response to send.
+      if (!repHandler->Admit())
+      {
+        this->dataPtr->UpdateServiceStats(topic,
+          [](ServiceStatistics &_stats) {_stats.RequestRejected();});
+        continue;
+      }
+
+      std::string strand;
+      {
+        std::lock_guard<std::mutex> lk(this->dataPtr->executorsMutex);
+        strand = std::to_string(++this->dataPtr->lastSrvTask);
+      }
+      executor->Post(strand,
+        [dataPtrRaw, repHandler, batchReq = std::move(batchReq), batchTopic,
+         received, deadline]()
+        {
+          if (std::chrono::steady_clock::now() >= deadline)
+          {
+            repHandler->Release();
+            dataPtrRaw->UpdateServiceStats(*batchTopic,
+              [](ServiceStatistics &_stats) {_stats.RequestDropped();});
+            return;
+          }
+
+          dataPtrRaw->RunServiceCallback(*batchTopic, received,
+            [&repHandler, &batchReq]()
+            {
+              std::string rep;
+              return repHandler->RunCallback(batchReq, rep);
+            });
+          repHandler->Release();
+        });
+    }
+    return;
+  }
+
+  this->dataPtr->UpdateServiceStats(topic,
+    [](ServiceStatistics &_stats) {_stats.RequestReceived();});
+
+  NodeSharedPrivate::SrvReply reply;
+  reply.sender = std::move(sender);
+  reply.dstId = std::move(dstId);
+  reply.topic = std::move(topic);
+  reply.nodeUuid = std::move(nodeUuid);
+  reply.reqUuid = std::move(reqUuid);
+
+  // Run the requests of a service with a maximum concurrency on its worker
+  // threads, the reply is queued and sent by this thread when ready.
+  std::shared_ptr<CallbackExecutor> executor;
+  std::string strand;
+  if (repHandler->MaxConcurrency() > 0)
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->executorsMutex);
+    executor = this->dataPtr->ReplierExecutor(repHandler);
+    strand = std::to_string(++this->dataPtr->lastSrvTask);
+  }
+
+  if (executor)
+  {
+    // Reject the request right away when the queue of the service is full,
+    // the requester may send it to another responser.
+    if (!repHandler->Admit())
+    {
+      this->dataPtr->UpdateServiceStats(reply.topic,
+        [](ServiceStatistics &_stats) {_stats.RequestRejected();});
+      if (oneway)
+        return;
+
+      reply.resultStr = NodeSharedPrivate::kSrvBusyResult;
+      this->dataPtr->SendSrvReply(reply);
+      return;
+    }
+
+    // The request might be cancelled or expire while it waits for a worker.
+    const std::string key = reply.dstId + reply.reqUuid;
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    {
+      std::lock_guard<std::mutex> lk(this->dataPtr->queuedSrvRequestsMutex);
+      this->dataPtr->queuedSrvRequests[key] = cancelled;
+    }
+
+    NodeSharedPrivate *dataPtrRaw = this->dataPtr.get();
+    executor->Post(strand,
+      [dataPtrRaw, repHandler, oneway, req = std::move(req),
+       reply = std::move(reply), key, cancelled, received,
+       deadline]() mutable
+      {
+        {
+          std::lock_guard<std::mutex> lk(dataPtrRaw->queuedSrvRequestsMutex);
+          auto it = dataPtrRaw->queuedSrvRequests.find(key);
+          if (it != dataPtrRaw->queuedSrvRequests.end() &&
+              it->second == cancelled)
+          {
+            dataPtrRaw->queuedSrvRequests.erase(it);
+          }
+        }
+
+        if (*cancelled || std::chrono::steady_clock::now() >= deadline)
+        {
+          repHandler->Release();
+          dataPtrRaw->UpdateServiceStats(reply.topic,
+            [](ServiceStatistics &_stats) {_stats.RequestDropped();});
+          return;
+        }
+
+        const bool result = dataPtrRaw->RunServiceCallback(reply.topic,
+          received, [dataPtrRaw, &repHandler, &req, &reply]()
+          {
+            if (!repHandler->Streaming())
+              return repHandler->RunCachedCallback(req, reply.rep);
+
+            // The chunks are queued like the replies, in order.
+            return repHandler->RunStreamCallback(req,
+              [dataPtrRaw, &reply](const std::string &_chunk)
+              {
+                NodeSharedPrivate::SrvReply chunk = reply;
+                chunk.rep = _chunk;
+                chunk.resultStr = NodeSharedPrivate::kSrvChunkResult;
+                dataPtrRaw->QueueSrvReply(std::move(chunk));
+                return true;
+              });
+          });
+        repHandler->Release();
+        if (oneway)
+          return;
+
+        reply.resultStr = result ? "1" : "0";
+        dataPtrRaw->QueueSrvReply(std::move(reply));
+      });
+    return;
+  }
+
+  // Run the service call and get the results. The chunks of a streaming
+  // service are sent as they are written.
+  const bool result = this->dataPtr->RunServiceCallback(reply.topic,
+    received, [this, &repHandler, &req, &reply]()
+    {
+      if (!repHandler->Streaming())
+        return repHandler->RunCachedCallback(req, reply.rep);
+
+      return repHandler->RunStreamCallback(req,
+        [this, &reply](const std::string &_chunk)
+        {
+          NodeSharedPrivate::SrvReply chunk = reply;
+          chunk.rep = _chunk;
+          chunk.resultStr = NodeSharedPrivate::kSrvChunkResult;
+          return this->dataPtr->SendSrvReply(chunk);
+        });
+    });
+  if (oneway)
+    return;
+
+  reply.resultStr = result ? "1" : "0";
+  this->dataPtr->SendSrvReply(reply);
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::SendSrvReply(const SrvReply &_reply)
+{
+  NodeShared *shared = this->owner;
+
+  {
+    std::lock_guard<std::recursive_mutex> lock(shared->mutex);
+    // I am still not connected to this address.
+    auto &connections = shared->srvConnections;
+    if (std::find(connections.begin(), connections.end(), _reply.sender) ==
+          connections.end())
+    {
+      this->replier->connect(_reply.sender.c_str());
+      connections.push_back(_reply.sender);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      if (shared->verbose)
+      {
+        std::cout << "\t* Connected to [" << _reply.sender
+                  << "] for sending a response" << std::endl;
+      }
+    }
+  }
+
+  // Send the reply.
+  try
+  {
+    zmq::message_t response;
+
+    response.rebuild(_reply.dstId.size());
+    memcpy(response.data(), _reply.dstId.data(), _reply.dstId.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->replier->send(response, zmq::send_flags::sndmore);
+#else
+    this->replier->send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_reply.topic.size());
+    memcpy(response.data(), _reply.topic.data(), _reply.topic.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->replier->send(response, zmq::send_flags::sndmore);
+#else
+    this->replier->send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_reply.nodeUuid.size());
+    memcpy(response.data(), _reply.nodeUuid.data(), _reply.nodeUuid.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->replier->send(response, zmq::send_flags::sndmore);
+#else
+    this->replier->send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_reply.reqUuid.size());
+    memcpy(response.data(), _reply.reqUuid.data(), _reply.reqUuid.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->replier->send(response, zmq::send_flags::sndmore);
+#else
+    this->replier->send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_reply.rep.size());
+    memcpy(response.data(), _reply.rep.data(), _reply.rep.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->replier->send(response, zmq::send_flags::sndmore);
+#else
+    this->replier->send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_reply.resultStr.size());
+    memcpy(response.data(), _reply.resultStr.data(), _reply.resultStr.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->replier->send(response, zmq::send_flags::none);
+#else
+    this->replier->send(response, 0);
+#endif
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "NodeSharedPrivate::SendSrvReply() error sending response: "
+              << _error.what() << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::QueueSrvReply(SrvReply &&_reply)
+{
+  std::lock_guard<std::mutex> lk(this->srvRepliesMutex);
+  this->srvReplies.push_back(std::move(_reply));
+
+  // A single notification is pending while the replies aren't sent.
+  if (this->srvReplies.size() > 1u)
+    return;
+
+  try
+  {
+    zmq::message_t msg(0);
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->srvReplyNotifier->send(msg, zmq::send_flags::dontwait);
+#else
+    this->srvReplyNotifier->send(msg, ZMQ_DONTWAIT);
+#endif
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "NodeSharedPrivate::QueueSrvReply() error: "
+              << _error.what() << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SendQueuedSrvReplies()
+{
+  std::vector<SrvReply> replies;
+  {
+    std::lock_guard<std::mutex> lk(this->srvRepliesMutex);
+
+    // Consume the notifications.
+    try
+    {
+      zmq::message_t msg(0);
+#ifdef IGN_ZMQ_POST_4_3_1
+      while (this->srvReplyWakeup->recv(msg, zmq::recv_flags::dontwait))
+#else
+      while (this->srvReplyWakeup->recv(&msg, ZMQ_DONTWAIT))
+#endif
+      {
+      }
+    }
+    catch(const zmq::error_t &_error)
+    {
+      std::cerr << "NodeSharedPrivate::SendQueuedSrvReplies() error: "
+                << _error.what() << std::endl;
+    }
+
+    replies.swap(this->srvReplies);
+  }
+
+  for (const SrvReply &reply : replies)
+    this->SendSrvReply(reply);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RecvSrvResponse()
+{
+  if (verbose)
+    std::cout << "Message received containing a service call REP" << std::endl;
+
+  zmq::message_t msg(0);
+  std::string topic;
+  std::string nodeUuid;
+  std::string reqUuid;
+  std::string rep;
+  std::string resultStr;
+  bool result;
+  bool chunk;
+  bool busy;
+
+  IReqHandlerPtr reqHandlerPtr;
+  bool hasHandler;
+
+  // The socket is only used by this thread, the mutex is only needed to
+  // look up the handler.
+  {
+    try
+    {
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->responseReceiver->recv(msg))
+#else
+      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
+#endif
+        return;
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->responseReceiver->recv(msg))
+#else
+      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
+#endif
+        return;
+      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->responseReceiver->recv(msg))
+#else
+      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
+#endif
+        return;
+      nodeUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->responseReceiver->recv(msg))
+#else
+      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
+#endif
+        return;
+      reqUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->responseReceiver->recv(msg))
+#else
+      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
+#endif
+        return;
+      rep = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->responseReceiver->recv(msg))
+#else
+      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
+#endif
+        return;
+      resultStr = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      result = resultStr == "1";
+      chunk = resultStr == NodeSharedPrivate::kSrvChunkResult;
+      busy = resultStr == NodeSharedPrivate::kSrvBusyResult;
+    }
+    catch(const zmq::error_t &_error)
+    {
+      std::cerr << "NodeShared::RecvSrvResponse() error: "
+                << _error.what() << std::endl;
+      return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    uint64_t reqId;
+    if (NodeSharedPrivate::ParseRequestIdFrame(reqUuid, reqId))
+    {
+      auto pending = this->dataPtr->pendingRequests.find(reqId);
+      if (pending == this->dataPtr->pendingRequests.end())
+      {
+        std::cerr << "Received a service call response with an unknown "
+                  << "request ID" << std::endl;
+        return;
+      }
+
+      reqHandlerPtr = pending->second.handler.lock();
+      topic = pending->second.topic;
+
+      // The responser rejected the request, it doesn't receive the next
+      // requests for a while.
+      if (busy)
+      {
+        this->dataPtr->busyResponsers[pending->second.responserId] =
+          std::chrono::steady_clock::now() +
+          NodeSharedPrivate::kSrvBusyBackoff;
+        this->dataPtr->UpdateServiceStats(topic,
+          [](ServiceStatistics &_stats) {_stats.BusyReceived();});
+        this->dataPtr->pendingRequests.erase(pending);
+      }
+      // More chunks of a streaming response will follow, keep the request
+      // pending until the final response.
+      else if (!chunk || !reqHandlerPtr)
+      {
+        const auto latency =
+          std::chrono::steady_clock::now() - pending->second.sent;
+        this->dataPtr->UpdateServiceStats(topic,
+          [latency](ServiceStatistics &_stats)
+          {
+            _stats.ResponseReceived(NodeSharedPrivate::Microseconds(latency));
+          });
+        this->dataPtr->UpdateResponserLatency(pending->second);
+        this->dataPtr->pendingRequests.erase(pending);
+      }
+
+      // The requester stopped waiting for this response.
+      if (!reqHandlerPtr)
+        return;
+
+      hasHandler = true;
+    }
+    else
+    {
+      hasHandler =
+        this->requests.Handler(topic, nodeUuid, reqUuid, reqHandlerPtr);
+    }
+  }
+
+  // Send a rejected request to another responser of the service, unless
+  // all of them rejected a request recently. The request fails right away
+  // otherwise.
+  if (hasHandler && busy)
+  {
+    const std::string reqType = reqHandlerPtr->ReqTypeName();
+    const std::string repType = reqHandlerPtr->RepTypeName();
+    SrvAddresses_M addresses;
+    this->dataPtr->srvDiscovery->Publishers(topic, addresses);
+
+    bool retry = false;
+    {
+      std::lock_guard<std::recursive_mutex> lock(this->mutex);
+      for (const auto &proc : addresses)
+      {
+        for (const auto &pub : proc.second)
+        {
+          if (pub.ReqTypeName() == reqType && pub.RepTypeName() == repType &&
+              !this->dataPtr->ResponserBusy(pub.SocketId()))
+          {
+            retry = true;
+          }
+        }
+      }
+    }
+
+    if (retry)
+    {
+      reqHandlerPtr->Requested(false);
+      this->SendPendingRemoteReqs(topic, reqType, repType);
+      return;
+    }
+  }
+
+  if (hasHandler && chunk)
+  {
+    // Deliver a chunk of a streaming response, the handler stays registered.
+    reqHandlerPtr->NotifyChunk(rep);
+  }
+  else if (hasHandler)
+  {
+    // Notify the result.
+    reqHandlerPtr->NotifyResult(rep, result);
+
+    // Remove the handler.
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    {
+      if (!this->requests.RemoveHandler(topic, reqHandlerPtr->NodeId(),
+            reqHandlerPtr->HandlerId()))
+      {
+        std::cerr << "NodeShare::RecvSrvResponse(): "
+                  << "Error removing request handler" << std::endl;
+      }
+    }
+  }
+  else
+  {
+    std::cerr << "Received a service call response but I don't have a handler"
+              << " for it" << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
+  const std::string &_reqType, const std::string &_repType)
+{
+  SrvAddresses_M addresses;
+  this->dataPtr->srvDiscovery->Publishers(_topic, addresses);
+  if (addresses.empty())
+    return;
+
+  // Find the processes that offer this service with a particular pair of
+  // REQ/REP types. The nodes of a process share its replier socket.
+  std::vector<NodeSharedPrivate::Responser> responsers;
+  for (auto &proc : addresses)
+  {
+    auto &v = proc.second;
+    for (auto &pub : v)
+    {
+      if (pub.ReqTypeName() == _reqType && pub.RepTypeName() == _repType)
+      {
+        NodeSharedPrivate::Responser responser;
+        responser.addr = pub.Addr();
+        responser.id = pub.SocketId();
+        responser.pUuid = pub.PUuid();
+        responser.batch = (this->dataPtr->srvDiscovery->Capabilities(
+          pub.PUuid()) & kCapBatch) != 0;
+        responsers.push_back(std::move(responser));
+        break;
+      }
+    }
+  }
+
+  if (responsers.empty())
+    return;
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  // Skip the responsers that rejected a request recently, unless all of
+  // them did.
+  auto busy = [this](const NodeSharedPrivate::Responser &_responser)
+  {
+    return this->dataPtr->ResponserBusy(_responser.id);
+  };
+  if (!std::all_of(responsers.begin(), responsers.end(), busy))
+  {
+    responsers.erase(
+      std::remove_if(responsers.begin(), responsers.end(), busy),
+      responsers.end());
+  }
+
+  // Only the first responser receives requests.
+  if (this->dataPtr->srvLoadBalancing ==
+        NodeSharedPrivate::SrvLoadBalancing::FIRST)
+  {
+    responsers.resize(1u);
+  }
+
+  if (verbose)
+  {
+    for (const auto &responser : responsers)
+    {
+      std::cout << "Found a service call responser at ["
+                << responser.addr << "]" << std::endl;
+    }
+  }
+
+  // Connect to a responser the first time it's chosen.
+  auto connect = [this](const std::string &_responserAddr,
+                        const std::string &_responserPUuid)
+  {
+    // I am still not connected to this address.
+    if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
+          _responserAddr) == this->srvConnections.end())
+    {
+      this->dataPtr->requester->connect(this->dataPtr->PeerEndpoint(
+        _responserAddr, _responserPUuid, kIpcReplierSocket));
+      this->srvConnections.push_back(_responserAddr);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (this->verbose)
+      {
+        std::cout << "\t* Connected to [" << _responserAddr
+                  << "] for service requests" << std::endl;
+      }
+    }
+  };
+
+  // The requests of this service still waiting for a response from each
+  // responser.
+  if (responsers.size() > 1u)
+  {
+    for (const auto &pending : this->dataPtr->pendingRequests)
+    {
+      if (pending.second.topic != _topic || pending.second.handler.expired())
+        continue;
+
+      for (auto &responser : responsers)
+      {
+        if (responser.id == pending.second.responserId)
+        {
+          ++responser.outstanding;
+          break;
+        }
+      }
+    }
+  }
+
+  // Collect the pending REQs, without copying all the handlers of the
+  // service: most of them might be in flight already.
+  std::vector<IReqHandlerPtr> reqs;
+  this->requests.ForEachHandler(_topic,
+    [&reqs](const IReqHandlerPtr &_req)
+    {
+      // Check if this service call has been already requested.
+      if (!_req->Requested())
+        reqs.push_back(_req);
+    });
+
+  const std::string myId = this->responseReceiverId.ToString();
+  const bool oneway = _repType == MessageTypeName<ignition::msgs::Empty>();
+
+  // Serialized request, its capacity is reused by all the requests.
+  std::string data;
+
+  // Send all the pending REQs.
+  for (auto &req : reqs)
+  {
+    // Check that the pending service call has types that match the responser.
+    if (!req->HasTypes(_reqType, _repType))
+      continue;
+
+    // Mark the handler as requested.
+    req->Requested(true);
+
+    if (!req->Serialize(data))
+      continue;
+
+    NodeSharedPrivate::Responser &responser =
+      responsers[this->dataPtr->ChooseResponser(_topic, responsers)];
+    const std::string &responserId = responser.id;
+
+    // Don't send a request whose requester already stopped waiting.
+    std::string deadlineFrame;
+    const auto deadline = req->Deadline();
+    if (deadline != std::chrono::steady_clock::time_point::max())
+    {
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+        continue;
+
+      const auto budget =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+      const int64_t systemDeadline =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          (std::chrono::system_clock::now() + budget).time_since_epoch())
+        .count();
+      deadlineFrame = NodeSharedPrivate::DeadlineFrame(systemDeadline,
+        static_cast<uint32_t>(std::min<int64_t>(budget.count(),
+          std::numeric_limits<uint32_t>::max())));
+    }
+
+    connect(responser.addr, responser.pUuid);
+
+    this->dataPtr->UpdateServiceStats(_topic,
+      [oneway](ServiceStatistics &_stats) {_stats.RequestSent(oneway);});
+
+    // The oneway requests are sent later with others to the same responser,
+    // unless it predates the batches.
+    if (oneway && responser.batch &&
+        this->dataPtr->onewayBatchDelay.count() > 0)
+    {
+      this->dataPtr->QueueOnewayRequest(responser, _topic, _reqType, data);
+      this->requests.RemoveHandler(_topic, req->NodeId(), req->HandlerId());
+      continue;
+    }
+
+    // Send a compact request ID instead of the node and request UUIDs.
+    // The responser echoes it and RecvSrvResponse() maps it back to the
+    // handler, so many requests can be in flight without comparing UUIDs.
+    const uint64_t reqId = ++this->dataPtr->lastRequestId;
+    const std::string reqIdFrame = NodeSharedPrivate::RequestIdFrame(reqId);
+    if (!oneway)
+    {
+      this->dataPtr->pendingRequests[reqId] = {_topic, req, responserId,
+        std::chrono::steady_clock::now()};
+      this->dataPtr->PurgePendingRequests();
+      ++responser.outstanding;
+    }
+
+    try
+    {
+      zmq::message_t msg;
+
+      msg.rebuild(responserId.size());
+      memcpy(msg.data(), responserId.data(), responserId.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      msg.rebuild(_topic.size());
+      memcpy(msg.data(), _topic.data(), _topic.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      msg.rebuild(this->myRequesterAddress.size());
+      memcpy(msg.data(), this->myRequesterAddress.data(),
+        this->myRequesterAddress.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      msg.rebuild(myId.size());
+      memcpy(msg.data(), myId.data(), myId.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      // The node UUID frame carries the deadline, if any.
+      msg.rebuild(deadlineFrame.size());
+      memcpy(msg.data(), deadlineFrame.data(), deadlineFrame.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      msg.rebuild(reqIdFrame.size());
+      memcpy(msg.data(), reqIdFrame.data(), reqIdFrame.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      msg.rebuild(data.size());
+      memcpy(msg.data(), data.data(), data.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      msg.rebuild(_reqType.size());
+      memcpy(msg.data(), _reqType.data(), _reqType.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+#endif
+
+      msg.rebuild(_repType.size());
+      memcpy(msg.data(), _repType.data(), _repType.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg, zmq::send_flags::none);
+#else
+      this->dataPtr->requester->send(msg, 0);
+#endif
+    }
+    catch(const zmq::error_t& /*ze*/)
+    {
+      // Debug output.
+      // std::cerr << "Error connecting [" << ze.what() << "]\n";
+    }
+
+    // Remove the handler associated to this service request. We won't
+    // receive a response because this is a oneway request.
+    if (oneway)
+    {
+      this->requests.RemoveHandler(_topic, req->NodeId(), req->HandlerId());
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::QueueOnewayRequest(const Responser &_responser,
+  const std::string &_topic, const std::string &_reqType,
+  const std::string &_req)
+{
+  std::lock_guard<std::mutex> lk(this->onewayBatchMutex);
+  auto key = std::make_tuple(_responser.id, _topic, _reqType);
+  auto it = this->onewayBatches.find(key);
+  if (it == this->onewayBatches.end())
+  {
+    OnewayBatch batch;
+    batch.responserId = _responser.id;
+    batch.topic = _topic;
+    batch.reqType = _reqType;
+    batch.first = std::chrono::steady_clock::now();
+    it = this->onewayBatches.emplace(std::move(key), std::move(batch)).first;
+    this->signalOnewayBatch.notify_one();
+  }
+
+  it->second.reqs.push_back(_req);
+  if (it->second.reqs.size() >= kMaxOnewayBatchSize)
+    this->signalOnewayBatch.notify_one();
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::OnewayBatchThread(NodeShared &_shared)
+{
+  std::vector<OnewayBatch> ready;
+  std::unique_lock<std::mutex> lk(this->onewayBatchMutex);
+  while (true)
+  {
+    // Wait until the oldest batch is due or a batch is full.
+    auto due = std::chrono::steady_clock::time_point::max();
+    bool full = false;
+    for (const auto &entry : this->onewayBatches)
+    {
+      due = std::min(due, entry.second.first + this->onewayBatchDelay);
+      full = full || entry.second.reqs.size() >= kMaxOnewayBatchSize;
+    }
+
+    if (this->exit)
+    {
+      // Send everything left before the sockets are closed.
+      due = std::chrono::steady_clock::time_point::min();
+    }
+    else if (!full && due == std::chrono::steady_clock::time_point::max())
+    {
+      this->signalOnewayBatch.wait(lk);
+      continue;
+    }
+    else if (!full && std::chrono::steady_clock::now() < due)
+    {
+      this->signalOnewayBatch.wait_until(lk, due);
+      continue;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = this->onewayBatches.begin();
+         it != this->onewayBatches.end();)
+    {
+      if (this->exit || it->second.reqs.size() >= kMaxOnewayBatchSize ||
+          now >= it->second.first + this->onewayBatchDelay)
+      {
+        ready.push_back(std::move(it->second));
+        it = this->onewayBatches.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    // Send without blocking the requesters queuing new requests.
+    lk.unlock();
+    for (const auto &batch : ready)
+      this->SendOnewayBatch(_shared, batch);
+    ready.clear();
+    lk.lock();
+
+    if (this->exit && this->onewayBatches.empty())
+      return;
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SendOnewayBatch(NodeShared &_shared,
+  const OnewayBatch &_batch)
+{
+  std::string data(BatchSize(_batch.reqs), '\0');
+  if (!PackBatch(_batch.reqs, &data[0]))
+  {
+    std::cerr << "Error packing [" << _batch.reqs.size() << "] requests of "
+              << "service [" << _batch.topic << "]" << std::endl;
+    return;
+  }
+
+  const std::string reqType = kBatchMsgTypePrefix + _batch.reqType;
+  const std::string &repType = MessageTypeName<ignition::msgs::Empty>();
+  const std::string empty;
+
+  std::lock_guard<std::recursive_mutex> lock(_shared.mutex);
+  const std::string myId = _shared.responseReceiverId.ToString();
+  const std::string *frames[] =
+  {
+    &_batch.responserId, &_batch.topic, &_shared.myRequesterAddress, &myId,
+    &empty, &empty, &data, &reqType, &repType
+  };
+  const std::size_t numFrames = sizeof(frames) / sizeof(frames[0]);
+
+  try
+  {
+    zmq::message_t msg;
+    for (std::size_t i = 0; i < numFrames; ++i)
+    {
+      msg.rebuild(frames[i]->size());
+      memcpy(msg.data(), frames[i]->data(), frames[i]->size());
+      const bool last = i + 1 == numFrames;
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->requester->send(msg,
+        last ? zmq::send_flags::none : zmq::send_flags::sndmore);
+#else
+      this->requester->send(msg, last ? 0 : ZMQ_SNDMORE);
+#endif
+    }
+  }
+  catch(const zmq::error_t& /*ze*/)
+  {
+    // The responser might be gone.
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::CancelRemoteReq(const std::string &_topic,
+  const IReqHandlerPtr &_handler)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  this->requests.RemoveHandler(_topic, _handler->NodeId(),
+    _handler->HandlerId());
+
+  // Find the remote request, if it was sent.
+  auto &pending = this->dataPtr->pendingRequests;
+  auto it = std::find_if(pending.begin(), pending.end(),
+    [&_topic, &_handler](
+      const std::pair<const uint64_t, NodeSharedPrivate::PendingRequest> &_p)
+    {
+      return _p.second.topic == _topic && _p.second.handler.lock() == _handler;
+    });
+  if (it == pending.end())
+    return;
+
+  const std::string responserId = it->second.responserId;
+  const std::string reqIdFrame = NodeSharedPrivate::RequestIdFrame(it->first);
+  pending.erase(it);
+
+  this->dataPtr->UpdateServiceStats(_topic,
+    [](ServiceStatistics &_stats) {_stats.RequestAbandoned();});
+
+  const std::string myId = this->responseReceiverId.ToString();
+  const std::string empty;
+  const std::string *frames[] =
+  {
+    &responserId, &_topic, &this->myRequesterAddress, &myId, &empty,
+    &reqIdFrame, &empty, &NodeSharedPrivate::kSrvCancelType,
+    &NodeSharedPrivate::kSrvCancelType
+  };
+  const std::size_t numFrames = sizeof(frames) / sizeof(frames[0]);
+
+  try
+  {
+    zmq::message_t msg;
+    for (std::size_t i = 0; i < numFrames; ++i)
+    {
+      msg.rebuild(frames[i]->size());
+      memcpy(msg.data(), frames[i]->data(), frames[i]->size());
+      const bool last = i + 1 == numFrames;
+#ifdef IGN_ZMQ_POST_4_3_1
+      this->dataPtr->requester->send(msg,
+        last ? zmq::send_flags::none : zmq::send_flags::sndmore);
+#else
+      this->dataPtr->requester->send(msg, last ? 0 : ZMQ_SNDMORE);
+#endif
+    }
+  }
+  catch(const zmq::error_t& /*ze*/)
+  {
+    // The responser might be gone.
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::PurgePendingRequests()
+{
+  auto &pending = this->pendingRequests;
+  if (pending.size() < this->pendingRequestsPurgeSize)
+    return;
+
+  // Requests whose responser never answered and whose requester gave up.
+  for (auto it = pending.begin(); it != pending.end();)
+  {
+    if (it->second.handler.expired())
+    {
+      this->UpdateServiceStats(it->second.topic,
+        [](ServiceStatistics &_stats) {_stats.RequestAbandoned();});
+      it = pending.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  this->pendingRequestsPurgeSize =
+    std::max<std::size_t>(1024u, 2 * pending.size());
+}
+
+//////////////////////////////////////////////////
+std::size_t NodeSharedPrivate::ChooseResponser(const std::string &_topic,
+  const std::vector<Responser> &_responsers)
+{
+  if (_responsers.size() == 1u ||
+      this->srvLoadBalancing == SrvLoadBalancing::FIRST)
+  {
+    return 0u;
+  }
+
+  // Start the search at the next responser in turn, so the ties are broken
+  // in round-robin order.
+  const std::size_t start =
+    static_cast<std::size_t>(this->srvRoundRobin[_topic]++ %
+      _responsers.size());
+  if (this->srvLoadBalancing == SrvLoadBalancing::ROUND_ROBIN)
+    return start;
+
+  // Expected wait of a responser. A responser that never answered is tried
+  // before the others, so its response time is learned.
+  auto cost = [this, &_responsers](const std::size_t _index)
+  {
+    const Responser &responser = _responsers[_index];
+    if (this->srvLoadBalancing == SrvLoadBalancing::LEAST_OUTSTANDING)
+      return static_cast<double>(responser.outstanding);
+
+    auto it = this->responserLatency.find(responser.id);
+    if (it == this->responserLatency.end())
+      return 0.0;
+    return it->second * static_cast<double>(responser.outstanding + 1);
+  };
+
+  std::size_t best = start;
+  double bestCost = cost(start);
+  for (std::size_t i = 1; i < _responsers.size(); ++i)
+  {
+    const std::size_t index = (start + i) % _responsers.size();
+    const double indexCost = cost(index);
+    if (indexCost < bestCost)
+    {
+      best = index;
+      bestCost = indexCost;
+    }
+  }
+  return best;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::ResponserBusy(const std::string &_id)
+{
+  auto it = this->busyResponsers.find(_id);
+  if (it == this->busyResponsers.end())
+    return false;
+
+  if (std::chrono::steady_clock::now() < it->second)
+    return true;
+
+  this->busyResponsers.erase(it);
+  return false;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateResponserLatency(const PendingRequest &_request)
+{
+  if (this->srvLoadBalancing != SrvLoadBalancing::LATENCY)
+    return;
+
+  const double elapsed = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - _request.sent).count();
+
+  // Exponential moving average, recent responses weigh more.
+  auto it = this->responserLatency.find(_request.responserId);
+  if (it == this->responserLatency.end())
+    this->responserLatency[_request.responserId] = elapsed;
+  else
+    it->second += 0.25 * (elapsed - it->second);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::OnNewConnection(const MessagePublisher &_pub)
+{
+  std::string topic = _pub.Topic();
+  std::string addr = _pub.Addr();
+  std::string procUuid = _pub.PUuid();
+
+  if (this->verbose)
+  {
+    std::cout << "Connection callback" << std::endl;
+    std::cout << _pub;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  // The topic might match a wildcard subscription.
+  this->dataPtr->MatchWildcards(topic, _pub.MsgTypeName());
+
+  // Check if we are interested in this topic.
+  if (this->localSubscribers.HasSubscriber(topic) &&
+      this->pUuid.compare(procUuid) != 0)
+  {
+    // Handle security
+    this->dataPtr->SecurityOnNewConnection();
+
+    // Each address is connected once, however many topics it publishes.
+    this->dataPtr->ConnectPeer(addr, procUuid);
+
+    // Add a new filter for the topic.
+    this->dataPtr->AddTopicFilter(topic);
+
+    // The publisher might send the topic with an alias.
+    uint32_t topicId;
+    if (ParseTopicIdCtrl(_pub.Ctrl(), topicId))
+    {
+      const std::string alias = TopicAlias(procUuid, topicId);
+      if (this->dataPtr->topicAliases.find(alias) ==
+          this->dataPtr->topicAliases.end())
+      {
+        this->dataPtr->topicAliases[alias] =
+          {topic, _pub.MsgTypeName(), addr, procUuid};
+#ifdef IGN_CPPZMQ_POST_4_7_0
+        this->dataPtr->subscriber->set(zmq::sockopt::subscribe, alias);
+#else
+        this->dataPtr->subscriber->setsockopt(ZMQ_SUBSCRIBE,
+            alias.data(), alias.size());
+#endif
+      }
+    }
+
+    // The publisher numbers the messages of a reliable topic, and resends
+    // the ones we request from its service replier. The requests need the
+    // service sockets.
+    std::string replierAddr;
+    std::string replierId;
+    if (ParseReliableCtrl(_pub.Ctrl(), replierAddr, replierId) &&
+        this->EnsureServices())
+    {
+      auto &stream = this->dataPtr->reliableStreams[addr + topic];
+      if (stream.pUuid != procUuid)
+      {
+        stream.pUuid = procUuid;
+        stream.msgType = _pub.MsgTypeName();
+        stream.replierAddr = replierAddr;
+        stream.replierId = replierId;
+        stream.tracker = GapTracker();
+      }
+
+      if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
+            replierAddr) == this->srvConnections.end())
+      {
+        this->dataPtr->requester->connect(this->dataPtr->PeerEndpoint(
+          replierAddr, procUuid, kIpcReplierSocket));
+        this->srvConnections.push_back(replierAddr);
+      }
+    }
+
+    // The publisher of an acknowledged topic receives the acknowledgements
+    // on its service replier too.
+    if (ParseAckCtrl(_pub.Ctrl(), replierAddr, replierId) &&
+        this->EnsureServices())
+    {
+      this->dataPtr->ackPeers[addr] = {procUuid, replierId};
+
+      if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
+            replierAddr) == this->srvConnections.end())
+      {
+        this->dataPtr->requester->connect(this->dataPtr->PeerEndpoint(
+          replierAddr, procUuid, kIpcReplierSocket));
+        this->srvConnections.push_back(replierAddr);
+      }
+    }
+
+    // Register the new connection with the publisher.
+    this->connections.AddPublisher(_pub);
+
+    if (this->verbose)
+      std::cout << "\t* Connected to [" << addr << "] for data\n";
+
+    MessagePublisher pub(_pub);
+    pub.SetPUuid(this->pUuid);
+
+    // Hack: We use this field to store the PUuid of the topic publisher.
+    pub.SetCtrl(_pub.PUuid());
+
+    // Let the publisher know that it can send the topic with an alias,
+    // with the publication metadata, which it should send if we want
+    // statistics of the topic, in chunks, numbered if it's reliable, that
+    // we acknowledge messages, in batches, and compressed if this build is
+    // able to decompress it.
+    const bool stats = this->dataPtr->topicStatsEnabled ||
+      this->dataPtr->CachedTopicStats(topic) != nullptr;
+    // If the topic is sent to a multicast group, the publisher uses it once
+    // all its subscribers joined.
+    const std::string group = ParseMulticastCtrl(_pub.Ctrl());
+    const bool multicast =
+      !group.empty() && this->dataPtr->JoinMulticastGroup(group);
+    const uint64_t caps = kCapAlias | kCapMetadata |
+      (stats ? kCapStats : 0) | kCapChunks |
+      (multicast ? kCapMulticast : 0) | kCapReliable | kCapAck | kCapBatch |
+      (CompressionAvailable(Compression_t::ZLIB) ? kCapZlib : 0);
+    pub.SetAddr(
+      kTopicAliasAddrPrefix + this->pUuid + CapabilitiesAddrFlags(caps));
+
+    // If we can map the segment of the publisher, we are running on the same
+    // host. Let the publisher know that it can use shared memory with us.
+    if (this->dataPtr->shmEnabled)
+    {
+      auto &peer = this->dataPtr->shmPeers[addr];
+      if (!peer.segment || peer.pUuid != procUuid)
+      {
+        peer.pUuid = procUuid;
+        peer.segment = ShmSegment::Open(ShmSegment::Name(procUuid));
+      }
+
+      if (peer.segment)
+      {
+        pub.SetAddr(kShmAddrPrefix + this->pUuid +
+          CapabilitiesAddrFlags(caps | kCapShm));
+        if (this->verbose)
+          std::cout << "\t* Using shared memory with [" << addr << "]\n";
+      }
+      else
+      {
+        this->dataPtr->shmPeers.erase(addr);
+      }
+    }
+
+    std::vector<std::string> handlerNodeUuids =
+        this->localSubscribers.NodeUuids(topic, _pub.MsgTypeName());
+    for (const std::string &nodeUuid : handlerNodeUuids)
+    {
+      pub.SetNUuid(nodeUuid);
+
+      // Announce the rate accepted by the node, so the publisher doesn't
+      // send messages that would be throttled here anyway.
+      AdvertiseMessageOptions opts = _pub.Options();
+      opts.SetMsgsPerSec(this->localSubscribers.MsgsPerSec(
+        topic, _pub.MsgTypeName(), nodeUuid));
+      pub.SetOptions(opts);
+
+      // Send a message to the publisher notify it
+      // about all my remoteSubscribers.
+      this->dataPtr->msgDiscovery->Register(pub);
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::OnNewDisconnection(const MessagePublisher &_pub)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  std::string topic = _pub.Topic();
+  std::string procUuid = _pub.PUuid();
+  std::string nUuid = _pub.NUuid();
+
+  if (this->verbose)
+  {
+    std::cout << "New disconnection detected " << std::endl;
+    std::cout << "\tProcess UUID: " << procUuid << std::endl;
+  }
+
+  // A remote subscriber[s] has been disconnected.
+  if (topic != "" && nUuid != "")
+  {
+    this->remoteSubscribers.DelPublisherByNode(topic, procUuid, nUuid);
+    this->dataPtr->SubscribersChanged();
+
+    MessagePublisher connection;
+    if (!this->connections.Publisher(topic, procUuid, nUuid, connection))
+      return;
+
+    // I am no longer connected.
+    this->connections.DelPublisherByNode(topic, procUuid, nUuid);
+  }
+  else
+  {
+    // Note: We deliberately don't remove the list of remote subscribers
+    // for this process. Remote nodes might suffer package delays (due to WiFi
+    // or traffic load) and if we remove them, they won't be able to receive
+    // data anymore.
+
+    // Forget the aliases of the process disconnected.
+    this->dataPtr->RemoveTopicAliases(
+      [&procUuid](const NodeSharedPrivate::TopicAliasInfo &_info)
+      {
+        return _info.pUuid == procUuid;
+      });
+
+    // Forget the reliable topics of the process disconnected.
+    for (auto it = this->dataPtr->reliableStreams.begin();
+         it != this->dataPtr->reliableStreams.end();)
+    {
+      if (it->second.pUuid == procUuid)
+        it = this->dataPtr->reliableStreams.erase(it);
+      else
+        ++it;
+    }
+
+    // Forget the acknowledged topics of the process disconnected, and stop
+    // waiting for its acknowledgements.
+    for (auto it = this->dataPtr->ackPeers.begin();
+         it != this->dataPtr->ackPeers.end();)
+    {
+      if (it->second.pUuid == procUuid)
+        it = this->dataPtr->ackPeers.erase(it);
+      else
+        ++it;
+    }
+    this->dataPtr->pendingAcks.ProcessGone(procUuid);
+
+    // Unmap the segments of the process disconnected.
+    for (auto it = this->dataPtr->shmPeers.begin();
+         it != this->dataPtr->shmPeers.end();)
+    {
+      if (it->second.pUuid == procUuid)
+        it = this->dataPtr->shmPeers.erase(it);
+      else
+        ++it;
+    }
+
+    // Stop reconnecting to the addresses of the process disconnected.
+    this->dataPtr->DisconnectPeer(procUuid);
+
+    MsgAddresses_M info;
+    if (!this->connections.Publishers(topic, info))
+      return;
+
+    // Remove all the connections from the process disonnected.
+    this->connections.DelPublishersByProc(procUuid);
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::OnNewSrvConnection(const ServicePublisher &_pub)
+{
+  std::string topic = _pub.Topic();
+  std::string addr = _pub.Addr();
+  std::string reqType = _pub.ReqTypeName();
+  std::string repType = _pub.RepTypeName();
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  if (this->verbose)
+  {
+    std::cout << "Service call connection callback" << std::endl;
+    std::cout << _pub;
+  }
+
+  // I am still not connected to this address.
+  if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
+        addr) == this->srvConnections.end())
+  {
+    this->dataPtr->requester->connect(
+      this->dataPtr->PeerEndpoint(addr, _pub.PUuid(), kIpcReplierSocket));
+    this->srvConnections.push_back(addr);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (this->verbose)
+    {
+      std::cout << "\t* Connected to [" << addr
+                << "] for service requests" << std::endl;
+    }
+  }
+
+  // Check if there's a pending service request with this specific combination
+  // of request and response types.
+  IReqHandlerPtr handler;
+  if (this->requests.FirstHandler(topic, reqType, repType, handler))
+  {
+    // Request all pending service calls for this topic and req/rep types.
+    this->SendPendingRemoteReqs(topic, reqType, repType);
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::OnNewSrvDisconnection(const ServicePublisher &_pub)
+{
+  std::string addr = _pub.Addr();
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  // Remove the address from the list of connected addresses.
+  this->srvConnections.erase(std::remove(std::begin(this->srvConnections),
+    std::end(this->srvConnections), addr.c_str()),
+    std::end(this->srvConnections));
+
+  if (this->verbose)
+  {
+    std::cout << "Service call disconnection callback" << std::endl;
+    std::cout << _pub;
+  }
+
+  // Look up the services kept resolved again, so their next responser is
+  // connected as soon as it's advertised. The publishers of a process
+  // leaving are still known at this point, they are not notified.
+  std::vector<std::string> topics;
+  for (const auto &resolved : this->dataPtr->resolvedServices)
+  {
+    if (_pub.Topic().empty() || _pub.Topic() == resolved.first)
+      topics.push_back(resolved.first);
+  }
+  if (!topics.empty() && this->dataPtr->srvDiscovery)
+    this->dataPtr->srvDiscovery->Discover(topics, false);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::OnNewRegistration(const MessagePublisher &_pub)
+{
+  // Discard the message if the destination PUUID is not me.
+  if (_pub.Ctrl() != this->pUuid)
+    return;
+
+  std::string procUuid = _pub.PUuid();
+  std::string nodeUuid = _pub.NUuid();
+
+  if (this->verbose)
+  {
+    std::cout << "Registering a new remote connection" << std::endl;
+    std::cout << "\tProc UUID: [" << procUuid << "]" << std::endl;
+    std::cout << "\tNode UUID: [" << nodeUuid << "]" << std::endl;
+  }
+
+  // Add a remote subscriber. A node registers again when its subscriptions
+  // change, replace the previous entry to update the announced rate.
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  this->remoteSubscribers.DelPublisherByNode(_pub.Topic(), procUuid, nodeUuid);
+  this->remoteSubscribers.AddPublisher(_pub);
+  this->dataPtr->SubscribersChanged();
+
+  // Send the latest message of a transient local topic to the subscriber.
+  this->dataPtr->ScheduleLastValue(_pub.Topic(), _pub.MsgTypeName(),
+    procUuid);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::OnEndRegistration(const MessagePublisher &_pub)
+{
+  // Discard the message if the destination PUUID is not me.
+  if (_pub.Ctrl() != this->pUuid)
+    return;
+
+  std::string topic = _pub.Topic();
+  std::string procUuid = _pub.PUuid();
+  std::string nodeUuid = _pub.NUuid();
+
+  if (this->verbose)
+  {
+    std::cout << "Registering the end of a remote connection" << std::endl;
+    std::cout << "\tProc UUID: " << procUuid << std::endl;
+    std::cout << "\tNode UUID: [" << nodeUuid << "]" << std::endl;
+  }
+
+  // Delete a remote subscriber.
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  this->remoteSubscribers.DelPublisherByNode(topic, procUuid, nodeUuid);
+  this->dataPtr->SubscribersChanged();
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::InitializeSockets()
+{
+  try
+  {
+    // Set the hostname's ip address.
+    this->hostAddr = this->dataPtr->msgDiscovery->HostAddr();
+
+    // Publisher socket listening in a random port.
+    std::string anyTcpEp = "tcp://" + this->hostAddr + ":*";
+
+    // Initialize security
+    if (!this->dataPtr->SecurityInit())
+      return false;
+
+    this->dataPtr->TuneSockets();
+
+    int lingerVal = 0;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    this->dataPtr->publisher->set(zmq::sockopt::linger, lingerVal);
+#else
+    this->dataPtr->publisher->setsockopt(ZMQ_LINGER,
+        &lingerVal, sizeof(lingerVal));
+#endif
+
+    // Set the capacity of the buffer for receiving messages.
+    int rcvQueueVal = this->dataPtr->NonNegativeEnvVar(
+      "IGN_TRANSPORT_RCVHWM", kDefaultRcvHwm);
+
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    this->dataPtr->subscriber->set(zmq::sockopt::rcvhwm, rcvQueueVal);
+#else
+    this->dataPtr->subscriber->setsockopt(ZMQ_RCVHWM,
+          &rcvQueueVal, sizeof(rcvQueueVal));
+#endif
+
+    // Set the capacity of the buffer for sending messages.
+    int sndQueueVal = this->dataPtr->NonNegativeEnvVar(
+      "IGN_TRANSPORT_SNDHWM", kDefaultSndHwm);
+
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    this->dataPtr->publisher->set(zmq::sockopt::sndhwm, sndQueueVal);
+
+    this->dataPtr->publisher->bind(anyTcpEp.c_str());
+    this->myAddress =
+        this->dataPtr->publisher->get(zmq::sockopt::last_endpoint);
+#else
+    char bindEndPoint[1024];
+    this->dataPtr->publisher->setsockopt(ZMQ_SNDHWM,
+        &sndQueueVal, sizeof(sndQueueVal));
+
+    this->dataPtr->publisher->bind(anyTcpEp.c_str());
+    size_t size = sizeof(bindEndPoint);
+    this->dataPtr->publisher->getsockopt(ZMQ_LAST_ENDPOINT,
+        &bindEndPoint, &size);
+    this->myAddress = bindEndPoint;
+#endif
+
+    // The peers on the same host connect to this endpoint instead.
+    if (this->dataPtr->ipcEnabled)
+    {
+      try
+      {
+        this->dataPtr->publisher->bind(
+          IpcEndpoint(this->pUuid, kIpcPublisherSocket));
+      }
+      catch(const zmq::error_t &_error)
+      {
+        std::cerr << "Unable to bind the ipc:// endpoint, the peers on the "
+                  << "same host will use TCP: " << _error.what()
+                  << std::endl;
+      }
+    }
+
+    // Receive the messages sent to this process only, e.g. the latest
+    // message of the transient local topics.
+    this->dataPtr->directPrefix = DirectTopicPrefix(this->pUuid);
+    this->dataPtr->AddTopicFilter(this->dataPtr->directPrefix);
+  }
+  catch(const zmq::error_t& ze)
+  {
+    std::cerr << "InitializeSockets() Error: " << ze.what() << std::endl;
+    std::cerr << "Ignition Transport has not been correctly initialized"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool NodeShared::EnsureServices()
+{
+  if (this->dataPtr->servicesInitialized.load(std::memory_order_acquire))
+    return this->dataPtr->servicesAvailable;
+
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+  if (!this->dataPtr->servicesInitialized)
+  {
+    this->dataPtr->servicesAvailable = this->InitializeServices();
+    this->dataPtr->servicesInitialized.store(true, std::memory_order_release);
+  }
+  return this->dataPtr->servicesAvailable;
+}
+
+/////////////////////////////////////////////////
+bool NodeShared::InitializeServices()
+{
+  try
+  {
+    std::string anyTcpEp = "tcp://" + this->hostAddr + ":*";
+    int lingerVal = 0;
+    int routeOn = 1;
+
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    // ResponseReceiver socket listening in a random port.
+    std::string id = this->responseReceiverId.ToString();
+    this->dataPtr->responseReceiver->set(zmq::sockopt::routing_id, id);
+    this->dataPtr->responseReceiver->bind(anyTcpEp.c_str());
+    this->myRequesterAddress = this->dataPtr->responseReceiver->get(
+        zmq::sockopt::last_endpoint);
+
+    // Replier socket listening in a random port.
+    id = this->replierId.ToString();
+    this->dataPtr->replier->set(zmq::sockopt::routing_id, id);
+    this->dataPtr->replier->set(zmq::sockopt::linger, lingerVal);
+    this->dataPtr->replier->set(zmq::sockopt::router_mandatory, routeOn);
+    this->dataPtr->replier->bind(anyTcpEp.c_str());
+    this->myReplierAddress =
+        this->dataPtr->replier->get(zmq::sockopt::last_endpoint);
+
+    this->dataPtr->requester->set(zmq::sockopt::linger, lingerVal);
+    this->dataPtr->requester->set(zmq::sockopt::router_mandatory, routeOn);
+
+    this->dataPtr->srvReplyWakeup->set(zmq::sockopt::linger, lingerVal);
+    this->dataPtr->srvReplyNotifier->set(zmq::sockopt::linger, lingerVal);
+#else
+    char bindEndPoint[1024];
+    size_t size = sizeof(bindEndPoint);
+
+    // ResponseReceiver socket listening in a random port.
+    std::string id = this->responseReceiverId.ToString();
+    this->dataPtr->responseReceiver->setsockopt(ZMQ_IDENTITY,
+        id.c_str(), id.size());
+    this->dataPtr->responseReceiver->bind(anyTcpEp.c_str());
+    this->dataPtr->responseReceiver->getsockopt(ZMQ_LAST_ENDPOINT,
+        &bindEndPoint, &size);
+    this->myRequesterAddress = bindEndPoint;
+
+    // Replier socket listening in a random port.
+    id = this->replierId.ToString();
+    this->dataPtr->replier->setsockopt(ZMQ_IDENTITY, id.c_str(), id.size());
+    this->dataPtr->replier->setsockopt(ZMQ_LINGER,
+        &lingerVal, sizeof(lingerVal));
+    this->dataPtr->replier->setsockopt(ZMQ_ROUTER_MANDATORY,
+        &routeOn, sizeof(routeOn));
+    this->dataPtr->replier->bind(anyTcpEp.c_str());
+    size = sizeof(bindEndPoint);
+    this->dataPtr->replier->getsockopt(ZMQ_LAST_ENDPOINT, &bindEndPoint, &size);
+    this->myReplierAddress = bindEndPoint;
+
+    this->dataPtr->requester->setsockopt(ZMQ_LINGER,
+        &lingerVal, sizeof(lingerVal));
+    this->dataPtr->requester->setsockopt(ZMQ_ROUTER_MANDATORY, &routeOn,
+      sizeof(routeOn));
+
+    this->dataPtr->srvReplyWakeup->setsockopt(ZMQ_LINGER,
+        &lingerVal, sizeof(lingerVal));
+    this->dataPtr->srvReplyNotifier->setsockopt(ZMQ_LINGER,
+        &lingerVal, sizeof(lingerVal));
+#endif
+
+    // The peers on the same host connect to this endpoint instead.
+    if (this->dataPtr->ipcEnabled)
+    {
+      try
+      {
+        this->dataPtr->replier->bind(
+          IpcEndpoint(this->pUuid, kIpcReplierSocket));
+      }
+      catch(const zmq::error_t &_error)
+      {
+        std::cerr << "Unable to bind the ipc:// endpoint, the peers on the "
+                  << "same host will call the services through TCP: "
+                  << _error.what() << std::endl;
+      }
+    }
+
+    // The replies of the services running on worker threads are sent by the
+    // thread receiving the requests, which is woken up through this pair.
+    this->dataPtr->srvReplyWakeup->bind(kSrvReplyEndpoint);
+    this->dataPtr->srvReplyNotifier->connect(kSrvReplyEndpoint);
+  }
+  catch(const zmq::error_t& ze)
+  {
+    std::cerr << "InitializeServices() Error: " << ze.what() << std::endl;
+    std::cerr << "Ignition Transport services are not available" << std::endl;
+    return false;
+  }
+
+  if (this->verbose)
+  {
+    std::cout << "Bind at: [udp://" << this->discoveryIP << ":"
+              << this->srvDiscPort << "] for srv discovery\n";
+    std::cout << "Bind at: [" << this->myReplierAddress << "] for srv. calls\n";
+    std::cout << "Identity for receiving srv. requests: ["
+              << this->replierId.ToString() << "]" << std::endl;
+    std::cout << "Identity for receiving srv. responses: ["
+              << this->responseReceiverId.ToString() << "]" << std::endl;
+  }
+
+  // Initialize the service discovery with the settings received so far.
+  const NodeSharedPrivate::SrvDiscoverySettings &settings =
+    this->dataPtr->srvDiscoverySettings;
+  this->dataPtr->srvDiscovery.reset(
+      new SrvDiscovery(this->pUuid, this->discoveryIP, this->srvDiscPort));
+  if (settings.heartbeat > 0)
+    this->dataPtr->srvDiscovery->SetHeartbeatInterval(settings.heartbeat);
+  if (settings.silence > 0)
+    this->dataPtr->srvDiscovery->SetSilenceInterval(settings.silence);
+  if (settings.activity > 0)
+    this->dataPtr->srvDiscovery->SetActivityInterval(settings.activity);
+  if (!settings.interfaces.empty())
+    this->dataPtr->srvDiscovery->SetInterfaces(settings.interfaces);
+  this->dataPtr->srvDiscovery->SetAdaptiveHeartbeat(
+    settings.adaptiveHeartbeat);
+  this->dataPtr->srvDiscovery->SetPartitionFilter(settings.partitionFilter);
+  for (const std::string &partition : settings.partitions)
+    this->dataPtr->srvDiscovery->AddPartition(partition);
+  if (!settings.cachePath.empty())
+    this->dataPtr->srvDiscovery->SetCachePath(settings.cachePath);
+
+  // The responsers of this process unpack the batches of oneway requests.
+  this->dataPtr->srvDiscovery->SetCapabilities(kCapBatch);
+
+  // Set the callback to notify svc discovery updates (new services).
+  this->dataPtr->srvDiscovery->ConnectionsCb(
+      std::bind(&NodeShared::OnNewSrvConnection, this, std::placeholders::_1));
+
+  // Set the callback to notify svc discovery updates (invalid services).
+  this->dataPtr->srvDiscovery->DisconnectionsCb(
+      std::bind(&NodeShared::OnNewSrvDisconnection,
+        this, std::placeholders::_1));
+
+  // Isolate the service calls from the bulk of the messages. Otherwise the
+  // reception thread polls the service sockets once servicesInitialized is
+  // set.
+  if (this->dataPtr->splitReception)
+  {
+    this->dataPtr->srvRequestThread = std::thread([this]()
+    {
+      this->dataPtr->PollSockets({
+        {this->dataPtr->replier.get(), [this](){this->RecvSrvRequest();}},
+        {this->dataPtr->srvReplyWakeup.get(),
+          [this](){this->dataPtr->SendQueuedSrvReplies();}}},
+        this->dataPtr->BusyPolls(NodeSharedPrivate::kRequestsThread));
+    });
+    this->dataPtr->srvResponseThread = std::thread([this]()
+    {
+      this->dataPtr->PollSocket(*this->dataPtr->responseReceiver,
+        [this](){this->RecvSrvResponse();},
+        this->dataPtr->BusyPolls(NodeSharedPrivate::kResponsesThread));
+    });
+    configureThread(this->dataPtr->srvRequestThread, "ign-srv-request");
+    configureThread(this->dataPtr->srvResponseThread, "ign-srv-reply");
+    this->dataPtr->PinBusyPoll(this->dataPtr->srvRequestThread,
+      NodeSharedPrivate::kRequestsThread, "ign-srv-request");
+    this->dataPtr->PinBusyPoll(this->dataPtr->srvResponseThread,
+      NodeSharedPrivate::kResponsesThread, "ign-srv-reply");
+  }
+
+  if (this->dataPtr->onewayBatchDelay.count() > 0)
+  {
+    this->dataPtr->onewayBatchThread = std::thread(
+      &NodeSharedPrivate::OnewayBatchThread, this->dataPtr.get(),
+      std::ref(*this));
+    configureThread(this->dataPtr->onewayBatchThread, "ign-oneway");
+  }
+
+  // Start the service discovery.
+  this->dataPtr->srvDiscovery->Start();
+
+  // Answer the pings in the partitions of the nodes created so far.
+  for (const auto &partition : settings.partitions)
+    this->dataPtr->AdvertisePing(partition);
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool NodeShared::TopicPublishers(const std::string &_topic,
+                                 SrvAddresses_M &_publishers) const
+{
+  if (!this->dataPtr->srvDiscovery)
+    return false;
+
+  return this->dataPtr->srvDiscovery->Publishers(_topic, _publishers);
+}
+
+/////////////////////////////////////////////////
+bool NodeShared::DiscoverService(const std::string &_topic) const
+{
+  if (!this->dataPtr->srvDiscovery)
+    return false;
+
+  return this->dataPtr->srvDiscovery->Discover(_topic);
+}
+
+/////////////////////////////////////////////////
+bool NodeShared::AdvertisePublisher(const ServicePublisher &_publisher)
+{
+  if (!this->EnsureServices())
+    return false;
+
+  return this->dataPtr->srvDiscovery->Advertise(_publisher);
+}
+
+/////////////////////////////////////////////////
+int NodeShared::RcvHwm()
+{
+  int rcvHwm;
+  try
+  {
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    rcvHwm = this->dataPtr->subscriber->get(zmq::sockopt::rcvhwm);
+#else
+    size_t rcvHwmSize = sizeof(rcvHwm);
+    this->dataPtr->subscriber->getsockopt(ZMQ_RCVHWM, &rcvHwm, &rcvHwmSize);
+#endif
+  }
+  catch (zmq::error_t &_e)
+  {
+    return -1;
+  }
+
+  return rcvHwm;
+}
+
+/////////////////////////////////////////////////
+int NodeShared::SndHwm()
+{
+  int sndHwm;
+  try
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->publisherMutex);
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    sndHwm = this->dataPtr->publisher->get(zmq::sockopt::sndhwm);
+#else
+    size_t sndHwmSize = sizeof(sndHwm);
+    this->dataPtr->publisher->getsockopt(ZMQ_SNDHWM, &sndHwm, &sndHwmSize);
+#endif
+  }
+  catch (zmq::error_t &_e)
+  {
+    return -1;
+  }
+
+  return sndHwm;
+}
+
+/////////////////////////////////////////////////
+std::size_t NodeShared::LocalPublishQueueDepth() const
+{
+  std::size_t depth = 0;
+  for (const auto &queue : this->dataPtr->pubQueues)
+    depth += queue->Size();
+  return depth;
+}
+
+/////////////////////////////////////////////////
+std::size_t NodeShared::LocalPublishQueueHighWaterMark() const
+{
+  std::size_t mark = 0;
+  for (const auto &queue : this->dataPtr->pubQueues)
+    mark = std::max(mark, queue->HighWaterMark());
+  return mark;
+}
+
+/////////////////////////////////////////////////
+std::vector<ConnectionStatistics> NodeShared::ConnectionStats() const
+{
+  std::vector<ConnectionStatistics> stats;
+  for (const auto *monitor : {this->dataPtr->publisherMonitor.get(),
+                              this->dataPtr->subscriberMonitor.get()})
+  {
+    if (!monitor)
+      continue;
+
+    const std::vector<ConnectionStatistics> socketStats = monitor->Stats();
+    stats.insert(stats.end(), socketStats.begin(), socketStats.end());
+  }
+  return stats;
+}
+
+/////////////////////////////////////////////////
+uint64_t NodeShared::LocalPublishQueueDroppedMsgs() const
+{
+  uint64_t dropped = 0;
+  for (const auto &queue : this->dataPtr->pubQueues)
+    dropped += queue->Dropped();
+  return dropped;
+}
+
+//////////////////////////////////////////////////
+void NodeShared::SetDiscoveryIntervals(const unsigned int _heartbeat,
+  const unsigned int _silence, const unsigned int _activity)
+{
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+  NodeSharedPrivate::SrvDiscoverySettings &settings =
+    this->dataPtr->srvDiscoverySettings;
+  SrvDiscovery *srvDiscovery = this->dataPtr->srvDiscovery.get();
+
+  if (_heartbeat > 0)
+  {
+    this->dataPtr->msgDiscovery->SetHeartbeatInterval(_heartbeat);
+    settings.heartbeat = _heartbeat;
+    if (srvDiscovery)
+      srvDiscovery->SetHeartbeatInterval(_heartbeat);
+  }
+
+  if (_silence > 0)
+  {
+    this->dataPtr->msgDiscovery->SetSilenceInterval(_silence);
+    settings.silence = _silence;
+    if (srvDiscovery)
+      srvDiscovery->SetSilenceInterval(_silence);
+  }
+
+  if (_activity > 0)
+  {
+    this->dataPtr->msgDiscovery->SetActivityInterval(_activity);
+    settings.activity = _activity;
+    if (srvDiscovery)
+      srvDiscovery->SetActivityInterval(_activity);
+  }
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::SetDiscoveryInterfaces(
+  const std::vector<std::string> &_ifaces)
+{
+  if (_ifaces.empty())
+    return true;
+
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+  bool result = this->dataPtr->msgDiscovery->SetInterfaces(_ifaces);
+  this->dataPtr->srvDiscoverySettings.interfaces = _ifaces;
+  if (this->dataPtr->srvDiscovery)
+    result = this->dataPtr->srvDiscovery->SetInterfaces(_ifaces) && result;
+  return result;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::AddDiscoveryPartition(const std::string &_partition)
+{
+  std::lock_guard<std::recursive_mutex> lk(this->owner->mutex);
+
+  // Most nodes share the partition of the previous ones.
+  if (!this->srvDiscoverySettings.partitions.insert(_partition).second)
+    return;
+
+  this->msgDiscovery->AddPartition(_partition);
+  if (this->srvDiscovery)
+  {
+    this->srvDiscovery->AddPartition(_partition);
+    this->AdvertisePing(_partition);
+  }
+  else if (this->eagerPing)
+  {
+    this->owner->EnsureServices();
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::AdvertisePing(const std::string &_partition)
+{
+  if (!this->pingPartitions.insert(_partition).second)
+    return;
+
+  std::string topic;
+  if (!TopicUtils::FullyQualifiedName(_partition, "",
+        kPingServicePrefix + this->owner->pUuid, topic))
+  {
+    return;
+  }
+
+  const std::string reqType = msgs::Empty().GetTypeName();
+  const std::string repType = msgs::Clock().GetTypeName();
+  if (!this->pingHandler)
+  {
+    this->pingHandler = std::make_shared<RawRepHandler>(reqType, repType);
+
+    // The receive and send times let the requester tell the clock offset
+    // apart from the transit time.
+    this->pingHandler->SetCallback(
+      [](const std::string &, std::string &_rep)
+      {
+        auto stamp = [](msgs::Time *_time)
+        {
+          const auto now = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(
+              std::chrono::system_clock::now().time_since_epoch()).count();
+          _time->set_sec(now / 1000000000);
+          _time->set_nsec(static_cast<int32_t>(now % 1000000000));
+        };
+
+        msgs::Clock clock;
+        stamp(clock.mutable_real());
+        stamp(clock.mutable_system());
+        return clock.SerializeToString(&_rep);
+      });
+  }
+
+  this->owner->repliers.AddHandler(topic, this->owner->pUuid,
+    this->pingHandler);
+
+  ServicePublisher publisher(topic, this->owner->myReplierAddress,
+    this->owner->replierId.ToString(), this->owner->pUuid,
+    this->owner->pUuid, reqType, repType, AdvertiseServiceOptions());
+  this->srvDiscovery->Advertise(publisher);
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::HandlerWrapper::HasSubscriber(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_msgType) const
+{
+  std::shared_ptr<ISubscriptionHandler> normalSubscriberPtr;
+  std::shared_ptr<RawSubscriptionHandler> rawSubscriberPtr;
+
+  return this->normal.FirstHandler(
+            _fullyQualifiedTopic, _msgType, normalSubscriberPtr)
+         || this->raw.FirstHandler(
+            _fullyQualifiedTopic, _msgType, rawSubscriberPtr);
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::HandlerWrapper::HasSubscriber(
+    const std::string &_fullyQualifiedTopic) const
+{
+  return this->normal.HasHandlersForTopic(_fullyQualifiedTopic)
+      || this->raw.HasHandlersForTopic(_fullyQualifiedTopic);
+}
+
+//////////////////////////////////////////////////
+template <typename HandlerT>
+static void AppendNodeUuids(const HandlerStorage<HandlerT> &_handlerStorage,
+                            const std::string &_fullyQualifiedTopic,
+                            const std::string &_msgTypeName,
+                            std::vector<std::string> &_uuids)
+{
+  using HandlerTPtr = std::shared_ptr<HandlerT>;
+  std::map<std::string, std::map<std::string, HandlerTPtr>> handlers;
+
+  _handlerStorage.Handlers(_fullyQualifiedTopic, handlers);
+  for (const auto &collection : handlers)
+  {
+    for (const auto &collectionEntry : collection.second)
+    {
+      const HandlerTPtr &handler = collectionEntry.second;
+      const std::string &handlerMsgType = handler->TypeName();
+      if (handlerMsgType == _msgTypeName
+          || handlerMsgType == kGenericMessageType)
+      {
+        _uuids.push_back(handler->NodeUuid());
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> NodeShared::HandlerWrapper::NodeUuids(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_msgTypeName) const
+{
+  std::vector<std::string> uuids;
+  AppendNodeUuids(this->normal, _fullyQualifiedTopic, _msgTypeName, uuids);
+  AppendNodeUuids(this->raw, _fullyQualifiedTopic, _msgTypeName, uuids);
+
+  return uuids;
+}
+
+//////////////////////////////////////////////////
+template <typename HandlerT>
+static void UpdateMsgsPerSec(const HandlerStorage<HandlerT> &_handlerStorage,
+                             const std::string &_fullyQualifiedTopic,
+                             const std::string &_msgTypeName,
+                             const std::string &_nUuid,
+                             bool &_found,
+                             uint64_t &_msgsPerSec)
+{
+  using HandlerTPtr = std::shared_ptr<HandlerT>;
+  std::map<std::string, std::map<std::string, HandlerTPtr>> handlers;
+
+  _handlerStorage.Handlers(_fullyQualifiedTopic, handlers);
+  auto nodeIt = handlers.find(_nUuid);
+  if (nodeIt == handlers.end())
+    return;
+
+  for (const auto &handler : nodeIt->second)
+  {
+    const std::string &handlerMsgType = handler.second->TypeName();
+    if (handlerMsgType == _msgTypeName
+        || handlerMsgType == kGenericMessageType)
+    {
+      _msgsPerSec = _found ?
+        std::max(_msgsPerSec, handler.second->MsgsPerSec()) :
+        handler.second->MsgsPerSec();
+      _found = true;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+uint64_t NodeShared::HandlerWrapper::MsgsPerSec(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_msgTypeName,
+    const std::string &_nUuid) const
+{
+  bool found = false;
+  uint64_t msgsPerSec = kUnthrottled;
+  UpdateMsgsPerSec(this->normal, _fullyQualifiedTopic, _msgTypeName, _nUuid,
+    found, msgsPerSec);
+  UpdateMsgsPerSec(this->raw, _fullyQualifiedTopic, _msgTypeName, _nUuid,
+    found, msgsPerSec);
+
+  return msgsPerSec;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::HandlerWrapper::RemoveHandlersForNode(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_nUuid)
+{
+  bool removed = false;
+  removed |= this->normal.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
+  removed |= this->raw.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
+
+  return removed;
+}
+
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SecurityOnNewConnection()
+{
+  // Set the CURVE keys or the username and pass if they exist
+  // \todo(anyone): This will cause the subscriber to connect only to secure
+  // connections. Would be nice if the subscriber could still connect to
+  // unsecure connections. This might require an unsecure and secure
+  // subscriber.
+  // See issue #74
+  secureClientHelper(*this->subscriber);
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::TuneSockets()
+{
+  // Options left unset keep the defaults of libzmq and of the system.
+  auto setOption = [this](zmq::socket_t &_socket, const int _option,
+      const std::string &_envVar, const bool _wide)
+  {
+    const int value = this->NonNegativeEnvVar(_envVar, 0);
+    if (value == 0)
+      return;
+
+    // The affinity is a 64 bits mask, the other options are ints.
+    const uint64_t wide = static_cast<uint64_t>(value);
+    const int rc = _wide ?
+      zmq_setsockopt(static_cast<void *>(_socket), _option, &wide,
+        sizeof(wide)) :
+      zmq_setsockopt(static_cast<void *>(_socket), _option, &value,
+        sizeof(value));
+    if (rc != 0)
+    {
+      std::cerr << "Unable to apply " << _envVar << " [" << value << "]: "
+                << zmq_strerror(zmq_errno()) << std::endl;
+    }
+  };
+
+  zmq::socket_t *tcpSockets[] = {this->publisher.get(),
+    this->subscriber.get(), this->requester.get(),
+    this->responseReceiver.get(), this->replier.get()};
+  for (zmq::socket_t *socket : tcpSockets)
+  {
+    setOption(*socket, ZMQ_SNDBUF, "IGN_TRANSPORT_SNDBUF", false);
+    setOption(*socket, ZMQ_RCVBUF, "IGN_TRANSPORT_RCVBUF", false);
+#if defined(ZMQ_OUT_BATCH_SIZE) && defined(ZMQ_IN_BATCH_SIZE)
+    setOption(*socket, ZMQ_OUT_BATCH_SIZE, "IGN_TRANSPORT_OUT_BATCH_SIZE",
+      false);
+    setOption(*socket, ZMQ_IN_BATCH_SIZE, "IGN_TRANSPORT_IN_BATCH_SIZE",
+      false);
+#endif
+  }
+
+  // With several I/O threads, each kind of socket can be served by its own
+  // threads, e.g. to keep the service calls away from heavy topics.
+  setOption(*this->publisher, ZMQ_AFFINITY, "IGN_TRANSPORT_PUB_AFFINITY",
+    true);
+  setOption(*this->subscriber, ZMQ_AFFINITY, "IGN_TRANSPORT_SUB_AFFINITY",
+    true);
+  for (zmq::socket_t *socket : {this->requester.get(),
+       this->responseReceiver.get(), this->replier.get()})
+  {
+    setOption(*socket, ZMQ_AFFINITY, "IGN_TRANSPORT_SRV_AFFINITY", true);
+  }
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::SecurityInit()
+{
+  if (!curveKeysValid())
+  {
+    std::cerr << "IGN_TRANSPORT_CURVE_PUBLIC_KEY and "
+              << "IGN_TRANSPORT_CURVE_SECRET_KEY must both be Z85 encoded "
+              << "keys of " << kCurveKeySize << " characters. Ignition "
+              << "Transport has not been initialized" << std::endl;
+    return false;
+  }
+
+  // Check if CURVE keys or a username and password have been set. If so,
+  // then setup a CURVE or PLAIN authentication server.
+  if (secured())
+  {
+    // Create the access control thread.
+    this->accessControlThread = std::thread(
+        &NodeSharedPrivate::AccessControlHandler, this);
+    configureThread(this->accessControlThread, "ign-access");
+
+    secureServerHelper(*this->publisher);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+// Access control handler.
+// This function is designed to be run in a thread.
+void NodeSharedPrivate::AccessControlHandler()
+{
+  // The requests of ZeroMQ are dispatched to a pool of workers, so that
+  // the connections of many peers are authenticated concurrently.
+  std::unique_ptr<zmq::socket_t> frontend;
+  std::unique_ptr<zmq::socket_t> backend;
+  std::vector<std::thread> workers;
+
+  try
+  {
+    // Bind to the zap address
+    frontend.reset(new zmq::socket_t(*this->context, ZMQ_ROUTER));
+    frontend->bind("inproc://zeromq.zap.01");
+    backend.reset(new zmq::socket_t(*this->context, ZMQ_DEALER));
+    backend->bind(kZapWorkersEndpoint);
+
+    const int numWorkers = std::max(1,
+      this->NonNegativeEnvVar("IGN_TRANSPORT_AUTH_THREADS", 1));
+    for (int i = 0; i < numWorkers; ++i)
+    {
+      workers.emplace_back(&NodeSharedPrivate::AccessControlWorker, this);
+      configureThread(workers.back(), "ign-auth");
+    }
+
+    zmq::pollitem_t items[] =
+    {
+      {static_cast<void*>(*frontend), 0, ZMQ_POLLIN, 0},
+      {static_cast<void*>(*backend), 0, ZMQ_POLLIN, 0},
+    };
+
+    // Process
+    while (!this->exit)
+    {
+      try
+      {
+        zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
+            std::chrono::milliseconds(NodeSharedPrivate::Timeout));
+      }
+      catch(...)
+      {
+        continue;
+      }
+
+      if (items[0].revents & ZMQ_POLLIN)
+        forwardHelper(*frontend, *backend);
+      if (items[1].revents & ZMQ_POLLIN)
+        forwardHelper(*backend, *frontend);
+    }
+  }
+  catch (...)
+  {
+    // This catch can be triggered when ctrl-c is pressed and the context is
+    // deleted. Capture this case, and quit gracefully.
+  }
+
+  // The workers stop on exit too.
+  for (std::thread &worker : workers)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::AccessControlWorker()
+{
+  zmq::socket_t *sock = new zmq::socket_t(*this->context, ZMQ_REP);
+
+  try
+  {
+    sock->connect(kZapWorkersEndpoint);
+
+    // Get the CURVE public key or the username and password
+    std::string publicKey, secretKey, user, pass;
+    std::string expectedMechanism = "PLAIN";
+    std::vector<std::string> expectedCredentials;
+    if (curveKeys(publicKey, secretKey))
+    {
+      // The clients use the key pair shared by the processes.
+      std::string key(32, '\0');
+      zmq_z85_decode(reinterpret_cast<uint8_t *>(&key[0]), publicKey.c_str());
+      expectedMechanism = "CURVE";
+      expectedCredentials = {key};
+    }
+    else if (userPass(user, pass))
+    {
+      expectedCredentials = {user, pass};
+    }
+    else
+    {
+      std::cerr << "Username and password not set. "
+                << "Authentication is disabled\n";
+      sock->close();
+      delete sock;
+      return;
+    }
+
+    zmq::pollitem_t items[] =
+    {
+      {static_cast<void*>(*sock), 0, ZMQ_POLLIN, 0},
+    };
+
+    // Process
+    while (!this->exit)
+    {
+      try
+      {
+        zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
+            std::chrono::milliseconds(NodeSharedPrivate::Timeout));
+      }
+      catch(...)
+      {
+        continue;
+      }
+
+      if (!(items[0].revents & ZMQ_POLLIN))
+        continue;
+
+      // The request contains the version, sequence, domain, address,
+      // routing id and mechanism, followed by the credentials.
+      const std::vector<std::string> request = receiveFramesHelper(*sock);
+      if (request.empty())
+        break;
+
+      const std::string &version = request[0];
+      const std::string sequence = request.size() > 1 ? request[1] : "";
+      if (request.size() < 6)
+      {
+        sendZapReplyHelper(*sock, version, sequence, "400",
+          "Invalid request");
+        continue;
+      }
+
+      const std::string &domain = request[2];
+      const std::string &address = request[3];
+      const std::string &mechanism = request[5];
+      const std::vector<std::string> credentials(request.begin() + 6,
+        request.end());
+
+      // Check that we received some kind of address. This could be used
+      // in the future to only accept connections from specific addresses.
+      if (address.empty())
+      {
+        sendZapReplyHelper(*sock, version, sequence, "400",
+          "Invalid address");
+      }
+      // Check the version
+      else if (version != "1.0")
+      {
+        sendZapReplyHelper(*sock, version, sequence, "400",
+          "Invalid version");
+      }
+      // Check the mechanism
+      else if (mechanism != expectedMechanism)
+      {
+        sendZapReplyHelper(*sock, version, sequence, "400",
+          "Invalid mechanism");
+      }
+      // Check the domain
+      else if (std::strcmp(domain.c_str(), kIgnAuthDomain) != 0)
+      {
+        sendZapReplyHelper(*sock, version, sequence, "400",
+          "Invalid domain");
+      }
+      // Check the username and password or the public key
+      else if (credentials != expectedCredentials)
+      {
+        sendZapReplyHelper(*sock, version, sequence, "400",
+          expectedMechanism == "CURVE" ? "Invalid public key" :
+          "Invalid username or password");
+      }
+      else
+      {
+        sendZapReplyHelper(*sock, version, sequence, "200", "OK");
+      }
+    }
+  }
+  catch (...)
+  {
+    // This catch can be triggered when ctrl-c is pressed and the context is
+    // deleted. Capture this case, and quit gracefully.
+  }
+
+  sock->close();
+  delete sock;
+}
+
+/////////////////////////////////////////////////
+MpscRing<NodeSharedPrivate::PublishMsgDetails> &NodeSharedPrivate::PubQueue(
+  const std::string &_topic)
+{
+  if (this->pubQueues.size() == 1)
+    return *this->pubQueues.front();
+
+  return *this->pubQueues[
+    std::hash<std::string>()(_topic) % this->pubQueues.size()];
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::PublishThread(MpscRing<PublishMsgDetails> &_queue)
+{
+  // Loop until exits
+  std::optional<PublishMsgDetails> msgDetails;
+  while (_queue.Pop(msgDetails))
+  {
+    // Stop early on exit.
+    if (this->exit)
+      break;
+
+    IGN_TRANSPORT_COUNT_ALLOCATIONS(PUBLISH_THREAD);
+    IGN_TRANSPORT_TRACE_CONTEXT(msgDetails->traceId);
+
+    // Deserialize the message for the local handlers if the publisher
+    // only provided the serialized buffer. Skip the throttled and filtered
+    // handlers that would discard the message, if none is left the message
+    // isn't parsed.
+    if (msgDetails->msgToParse)
+    {
+      auto &handlers = msgDetails->localHandlers;
+      const PublishMsgDetails &details = *msgDetails;
+      handlers.erase(std::remove_if(handlers.begin(), handlers.end(),
+        [&details](const ISubscriptionHandlerPtr &_handler)
+        {
+          return !_handler->ThrottledUpdateReady() ||
+            !_handler->HeaderAccepted(details.sharedBuffer.get(),
+              details.msgSize, details.info.Type());
+        }), handlers.end());
+    }
+
+    if (msgDetails->msgToParse && !msgDetails->localHandlers.empty())
+    {
+      IGN_TRANSPORT_TRACE_SCOPE("parse", msgDetails->info.Topic(), STEP);
+      if (msgDetails->msgToParse->ParseFromArray(
+            msgDetails->sharedBuffer.get(),
+            static_cast<int>(msgDetails->msgSize)))
+      {
+        msgDetails->msgCopy = std::move(msgDetails->msgToParse);
+      }
+      else
+      {
+        std::cerr << "NodeSharedPrivate::PublishThread(): Error parsing "
+          << "message on topic [" << msgDetails->info.Topic() << "]"
+          << std::endl;
+        msgDetails->localHandlers.clear();
+      }
+    }
+
+    // The callbacks running on the executors of the nodes keep the local
+    // delivery until they ran.
+    if (msgDetails->ackId != 0)
+    {
+      const uint64_t ackId = msgDetails->ackId;
+      msgDetails->ack = std::shared_ptr<void>(nullptr, [this, ackId](void *)
+      {
+        this->pendingAcks.LocalDone(ackId);
+      });
+    }
+
+    if (this->spinNodes > 0)
+      this->PostSpinHandlers(*msgDetails);
+
+    // Send the message to all the local handlers.
+    for (auto &handler : msgDetails->localHandlers)
+    {
+      try
+      {
+        IGN_TRANSPORT_TRACE_SCOPE("callback", msgDetails->info.Topic(), END);
+        handler->RunLocalCallback(msgDetails->msgCopy, msgDetails->info);
+      }
+      catch (...)
+      {
+        std::cerr << "Exception occurred in a local callback "
+          << "on topic [" << msgDetails->info.Topic() << "] with message ["
+          << msgDetails->msgCopy->DebugString() << "]" << std::endl;
+      }
+    }
+
+    // Send the message to all the raw handlers.
+    for (auto &handler : msgDetails->rawHandlers)
+    {
+      try
+      {
+        IGN_TRANSPORT_TRACE_SCOPE("callback", msgDetails->info.Topic(), END);
+        handler->RunRawCallback(msgDetails->sharedBuffer.get(),
+            msgDetails->msgSize, msgDetails->info);
+      }
+      catch (...)
+      {
+        std::cerr << "Exception occured in a local raw callback "
+          << "on topic [" << msgDetails->info.Topic() << "]" << std::endl;
+      }
+    }
+    this->localMsgs.Increment();
+
+    // Release the message and the handlers before waiting for the next one.
+    msgDetails.reset();
+  }
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::PostSpinHandlers(PublishMsgDetails &_msgDetails)
+{
+  // Handlers of each executor.
+  std::map<std::shared_ptr<CallbackExecutor>,
+    std::pair<std::vector<ISubscriptionHandlerPtr>,
+              std::vector<RawSubscriptionHandlerPtr>>> work;
+
+  auto spinExecutor = [this](const std::string &_nUuid)
+  {
+    auto it = this->nodeExecutors.find(_nUuid);
+    if (it == this->nodeExecutors.end() || !it->second->IsManual())
+      return std::shared_ptr<CallbackExecutor>();
+    return it->second;
+  };
+
+  {
+    std::lock_guard<std::mutex> lk(this->executorsMutex);
+
+    auto &localHandlers = _msgDetails.localHandlers;
+    for (auto it = localHandlers.begin(); it != localHandlers.end();)
+    {
+      auto executor = spinExecutor((*it)->NodeUuid());
+      if (!executor)
+      {
+        ++it;
+        continue;
+      }
+      work[executor].first.push_back(std::move(*it));
+      it = localHandlers.erase(it);
+    }
+
+    auto &rawHandlers = _msgDetails.rawHandlers;
+    for (auto it = rawHandlers.begin(); it != rawHandlers.end();)
+    {
+      auto executor = spinExecutor((*it)->NodeUuid());
+      if (!executor)
+      {
+        ++it;
+        continue;
+      }
+      work[executor].second.push_back(std::move(*it));
+      it = rawHandlers.erase(it);
+    }
+  }
+
+  // The message and its buffer are shared with the callbacks, not copied.
+  for (auto &entry : work)
+  {
+    auto msg = _msgDetails.msgCopy;
+    auto buffer = _msgDetails.sharedBuffer;
+    const std::size_t size = _msgDetails.msgSize;
+    const MessageInfo info = _msgDetails.info;
+    // Held until the task is released, once the callbacks ran.
+    auto ack = _msgDetails.ack;
+    auto handlers = std::make_shared<const std::pair<
+      std::vector<ISubscriptionHandlerPtr>,
+      std::vector<RawSubscriptionHandlerPtr>>>(std::move(entry.second));
+
+    entry.first->Post(info.Topic(), [msg, buffer, size, info, ack, handlers]()
+    {
+      for (const auto &handler : handlers->first)
+      {
+        try
+        {
+          handler->RunLocalCallback(msg, info);
+        }
+        catch (...)
+        {
+          std::cerr << "Exception occurred in a local callback "
+            << "on topic [" << info.Topic() << "]" << std::endl;
+        }
+      }
+
+      for (const auto &handler : handlers->second)
+      {
+        try
+        {
+          handler->RunRawCallback(buffer.get(), size, info);
+        }
+        catch (...)
+        {
+          std::cerr << "Exception occurred in a local raw callback "
+            << "on topic [" << info.Topic() << "]" << std::endl;
+        }
+      }
+    }, size);
+  }
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::ConflateHandlers(const MessageInfo &_info,
+  const ReceivedMsg &_msgData, NodeShared::HandlerInfo &_handlerInfo)
+{
+  std::vector<ISubscriptionHandlerPtr> localHandlers;
+  std::vector<RawSubscriptionHandlerPtr> rawHandlers;
+
+  auto matches = [&_info](const std::string &_type)
+  {
+    return _type == _info.Type() || _type == kGenericMessageType;
+  };
+
+  for (auto &node : _handlerInfo.localHandlers)
+  {
+    for (auto it = node.second.begin(); it != node.second.end();)
+    {
+      const ISubscriptionHandlerPtr &handler = it->second;
+      if (!handler || !handler->Conflated())
+      {
+        ++it;
+        continue;
+      }
+
+      if (matches(handler->TypeName()))
+        localHandlers.push_back(handler);
+      it = node.second.erase(it);
+    }
+  }
+
+  for (auto &node : _handlerInfo.rawHandlers)
+  {
+    for (auto it = node.second.begin(); it != node.second.end();)
+    {
+      const RawSubscriptionHandlerPtr &handler = it->second;
+      if (!handler || !handler->Conflated())
+      {
+        ++it;
+        continue;
+      }
+
+      if (matches(handler->TypeName()))
+        rawHandlers.push_back(handler);
+      it = node.second.erase(it);
+    }
+  }
+
+  if (localHandlers.empty() && rawHandlers.empty())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lk(this->conflateMutex);
+    if (!this->conflateThread.joinable())
+    {
+      this->conflateThread = std::thread(&NodeSharedPrivate::ConflateThread,
+        this);
+      configureThread(this->conflateThread, "ign-conflate");
+    }
+
+    // Replace the pending message of each handler, if any.
+    for (const auto &handler : localHandlers)
+    {
+      this->conflatedMsgs.erase(handler->HandlerUuid());
+      this->conflatedMsgs.emplace(handler->HandlerUuid(),
+        ConflatedMsg{handler, nullptr, _msgData, _info});
+    }
+
+    for (const auto &handler : rawHandlers)
+    {
+      this->conflatedMsgs.erase(handler->HandlerUuid());
+      this->conflatedMsgs.emplace(handler->HandlerUuid(),
+        ConflatedMsg{nullptr, handler, _msgData, _info});
+    }
+  }
+  this->signalConflated.notify_one();
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::ConflateThread()
+{
+  while (true)
+  {
+    std::map<std::string, ConflatedMsg> msgs;
+    {
+      std::unique_lock<std::mutex> lk(this->conflateMutex);
+      this->signalConflated.wait(lk,
+        [this]{return !this->conflatedMsgs.empty() || this->exit;});
+
+      if (this->exit)
+        return;
+
+      msgs.swap(this->conflatedMsgs);
+    }
+
+    for (auto &entry : msgs)
+    {
+      ConflatedMsg &msg = entry.second;
+      try
+      {
+        if (msg.rawHandler)
+        {
+          msg.rawHandler->RunRawCallback(msg.data.data.get(), msg.data.size,
+            msg.info);
+        }
+        else if (msg.localHandler->ThrottledUpdateReady() &&
+                 msg.localHandler->HeaderAccepted(msg.data.data.get(),
+                   msg.data.size, msg.info.Type()))
+        {
+          // Stale and filtered messages are never parsed.
+          auto protoMsg = msg.localHandler->ParseMsg(msg.data.data.get(),
+            msg.data.size, msg.info.Type());
+          if (protoMsg)
+            msg.localHandler->RunLocalCallback(protoMsg, msg.info);
+        }
+      }
+      catch (...)
+      {
+        std::cerr << "Exception occurred in a conflated callback "
+          << "on topic [" << msg.info.Topic() << "]" << std::endl;
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::BatchHandlers(const MessageInfo &_info,
+  const std::vector<ReceivedMsg> &_msgs, NodeShared::HandlerInfo &_handlerInfo)
+{
+  std::vector<ISubscriptionHandlerPtr> handlers;
+  for (auto &node : _handlerInfo.localHandlers)
+  {
+    for (auto it = node.second.begin(); it != node.second.end();)
+    {
+      const ISubscriptionHandlerPtr &handler = it->second;
+      if (!handler || !handler->Batched())
+      {
+        ++it;
+        continue;
+      }
+
+      if (handler->TypeName() == _info.Type() ||
+          handler->TypeName() == kGenericMessageType)
+      {
+        handlers.push_back(handler);
+      }
+      it = node.second.erase(it);
+    }
+  }
+
+  if (handlers.empty())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lk(this->batchMutex);
+    if (!this->batchThread.joinable())
+    {
+      this->batchThread = std::thread(&NodeSharedPrivate::BatchThread, this);
+      configureThread(this->batchThread, "ign-batch");
+    }
+
+    for (const auto &handler : handlers)
+    {
+      BatchedMsgs &pending = this->batchedMsgs[handler->HandlerUuid()];
+      pending.handler = handler;
+      pending.data.insert(pending.data.end(), _msgs.begin(), _msgs.end());
+      for (std::size_t i = 0; i < _msgs.size(); ++i)
+        pending.infos.push_back(_info);
+
+      // The oldest messages beyond the queue size are dropped. MessageInfo
+      // can't be assigned, so the latest messages are copied.
+      const uint64_t queueSize = handler->QueueSize();
+      if (queueSize > 0 && pending.data.size() > queueSize)
+      {
+        const auto excess = static_cast<std::ptrdiff_t>(
+          pending.data.size() - queueSize);
+        pending.data.erase(pending.data.begin(),
+          pending.data.begin() + excess);
+        std::vector<MessageInfo> infos(pending.infos.begin() + excess,
+          pending.infos.end());
+        pending.infos.swap(infos);
+      }
+    }
+  }
+  this->signalBatched.notify_one();
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::BatchThread()
+{
+  while (true)
   {
-    // Run the service call and get the results.
-    bool result = repHandler->RunCallback(req, rep);
-
-    // If 'reptype' is msgs::Empty", this is a oneway request
-    // and we don't send response
-    if (repType == ignition::msgs::Empty().GetTypeName())
+    std::map<std::string, BatchedMsgs> batches;
     {
-      return;
-    }
+      std::unique_lock<std::mutex> lk(this->batchMutex);
+      this->signalBatched.wait(lk,
+        [this]{return !this->batchedMsgs.empty() || this->exit;});
 
-    if (result)
-      resultStr = "1";
-    else
-      resultStr = "0";
+      if (this->exit)
+        return;
+
+      batches.swap(this->batchedMsgs);
+    }
 
+    for (auto &entry : batches)
     {
-      std::lock_guard<std::recursive_mutex> lock(this->mutex);
-      // I am still not connected to this address.
-      if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
-            sender) == this->srvConnections.end())
+      BatchedMsgs &batch = entry.second;
+      try
       {
-        this->dataPtr->replier->connect(sender.c_str());
-        this->srvConnections.push_back(sender);
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-        if (this->verbose)
+        std::vector<std::shared_ptr<const ProtoMsg>> msgs;
+        msgs.reserve(batch.data.size());
+        for (std::size_t i = 0; i < batch.data.size(); ++i)
         {
-          std::cout << "\t* Connected to [" << sender
-                    << "] for sending a response" << std::endl;
+          // The filtered messages are left out of the batch unparsed.
+          if (!batch.handler->HeaderAccepted(batch.data[i].data.get(),
+                batch.data[i].size, batch.infos[i].Type()))
+          {
+            msgs.push_back(nullptr);
+            continue;
+          }
+          msgs.push_back(batch.handler->ParseMsg(batch.data[i].data.get(),
+            batch.data[i].size, batch.infos[i].Type()));
         }
+        batch.handler->RunBatchCallback(msgs, batch.infos);
+      }
+      catch (...)
+      {
+        std::cerr << "Exception occurred in a batched callback "
+          << "on topic [" << batch.infos.front().Topic() << "]" << std::endl;
       }
     }
+  }
+}
 
-    // Send the reply.
-    try
-    {
-      std::lock_guard<std::recursive_mutex> lock(this->mutex);
-      zmq::message_t response;
-
-      response.rebuild(dstId.size());
-      memcpy(response.data(), dstId.data(), dstId.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
-
-      response.rebuild(topic.size());
-      memcpy(response.data(), topic.data(), topic.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
-
-      response.rebuild(nodeUuid.size());
-      memcpy(response.data(), nodeUuid.data(), nodeUuid.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RetainLastValue(const std::string &_topic,
+  LastValue _value)
+{
+  std::lock_guard<std::mutex> lk(this->lastValueMutex);
+  this->lastValues[_topic] = std::move(_value);
+}
 
-      response.rebuild(reqUuid.size());
-      memcpy(response.data(), reqUuid.data(), reqUuid.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::ForgetLastValue(const std::string &_topic)
+{
+  std::lock_guard<std::mutex> lk(this->lastValueMutex);
+  this->lastValues.erase(_topic);
+}
 
-      response.rebuild(rep.size());
-      memcpy(response.data(), rep.data(), rep.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::ScheduleLastValue(const std::string &_topic,
+  const std::string &_msgType, const std::string &_pUuid)
+{
+  {
+    std::lock_guard<std::mutex> lk(this->lastValueMutex);
+    auto it = this->lastValues.find(_topic);
+    if (it == this->lastValues.end() ||
+        (_msgType != kGenericMessageType && _msgType != it->second.msgType))
+    {
+      return;
+    }
 
-      response.rebuild(resultStr.size());
-      memcpy(response.data(), resultStr.data(), resultStr.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::none);
-#else
-      this->dataPtr->replier->send(response, 0);
-#endif
+    // The nodes of a process usually register together, they share a
+    // single message.
+    for (const auto &delivery : this->lastValueDeliveries)
+    {
+      if (delivery.topic == _topic && delivery.pUuid == _pUuid)
+        return;
     }
-    catch(const zmq::error_t &_error)
+
+    if (!this->lastValueThread.joinable())
     {
-      std::cerr << "NodeShared::RecvSrvRequest() error sending response: "
-                << _error.what() << std::endl;
-      return;
+      this->lastValueThread = std::thread(
+        &NodeSharedPrivate::LastValueThread, this);
+      configureThread(this->lastValueThread, "ign-last-value");
     }
+
+    this->lastValueDeliveries.push_back({_topic, _pUuid,
+      std::chrono::steady_clock::now() + kLastValueDelay});
   }
-  // else
-  //   std::cerr << "I do not have a service call registered for topic ["
-  //             << topic << "]\n";
+  this->signalLastValue.notify_one();
 }
 
-//////////////////////////////////////////////////
-void NodeShared::RecvSrvResponse()
+/////////////////////////////////////////////////
+void NodeSharedPrivate::QueueLastValue(const std::string &_topic,
+  const ISubscriptionHandlerPtr &_handler,
+  const RawSubscriptionHandlerPtr &_rawHandler)
 {
-  if (verbose)
-    std::cout << "Message received containing a service call REP" << std::endl;
-
-  zmq::message_t msg(0);
-  std::string topic;
-  std::string nodeUuid;
-  std::string reqUuid;
-  std::string rep;
-  std::string resultStr;
-  bool result;
+  // The message is queued with the mutex held, so it's not queued after a
+  // newer message published meanwhile.
+  std::lock_guard<std::mutex> lk(this->lastValueMutex);
+  auto it = this->lastValues.find(_topic);
+  if (it == this->lastValues.end())
+    return;
+  const LastValue &value = it->second;
 
-  IReqHandlerPtr reqHandlerPtr;
-  bool hasHandler;
+  auto accepts = [&value](const std::string &_type)
+  {
+    return _type == kGenericMessageType || _type == value.msgType;
+  };
 
+  PublishMsgDetails details;
+  if (_handler && accepts(_handler->TypeName()) &&
+      _handler->HeaderAccepted(value.data.get(), value.size, value.msgType))
   {
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    details.msgCopy = _handler->ParseMsg(value.data.get(), value.size,
+      value.msgType);
+    if (details.msgCopy)
+      details.localHandlers.push_back(_handler);
+  }
+  if (_rawHandler && accepts(_rawHandler->TypeName()))
+    details.rawHandlers.push_back(_rawHandler);
 
-    try
-    {
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->responseReceiver->recv(msg))
-#else
-      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
-#endif
-        return;
+  if (details.localHandlers.empty() && details.rawHandlers.empty())
+    return;
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->responseReceiver->recv(msg))
-#else
-      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
-#endif
-        return;
-      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+  details.info.SetTopicAndPartition(_topic);
+  details.info.SetType(value.msgType);
+  details.info.SetIntraProcess(true);
+  details.info.SetReceiveTime(std::chrono::steady_clock::now());
+  details.sharedBuffer = value.data;
+  details.msgSize = value.size;
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->responseReceiver->recv(msg))
-#else
-      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
-#endif
-        return;
-      nodeUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+  this->PubQueue(_topic).Push(std::move(details));
+}
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->responseReceiver->recv(msg))
-#else
-      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::LastValueThread()
+{
+  while (true)
+  {
+    LastValueDelivery delivery;
+    {
+      std::unique_lock<std::mutex> lk(this->lastValueMutex);
+      this->signalLastValue.wait(lk,
+        [this]{return !this->lastValueDeliveries.empty() || this->exit;});
+      if (this->exit)
         return;
-      reqUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->responseReceiver->recv(msg))
-#else
-      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
-#endif
+      const auto due = this->lastValueDeliveries.front().due;
+      if (this->signalLastValue.wait_until(lk, due,
+            [this]{return this->exit.load();}))
+      {
         return;
-      rep = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      }
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->responseReceiver->recv(msg))
-#else
-      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
-#endif
-        return;
-      resultStr = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
-      result = resultStr == "1";
-    }
-    catch(const zmq::error_t &_error)
-    {
-      std::cerr << "NodeShared::RecvSrvResponse() error: "
-                << _error.what() << std::endl;
-      return;
+      delivery = std::move(this->lastValueDeliveries.front());
+      this->lastValueDeliveries.pop_front();
     }
 
-    hasHandler =
-      this->requests.Handler(topic, nodeUuid, reqUuid, reqHandlerPtr);
+    this->SendLastValue(delivery);
   }
+}
 
-  if (hasHandler)
+/////////////////////////////////////////////////
+void NodeSharedPrivate::SendLastValue(const LastValueDelivery &_delivery)
+{
+  LastValue value;
   {
-    // Notify the result.
-    reqHandlerPtr->NotifyResult(rep, result);
-
-    // Remove the handler.
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
-    {
-      if (!this->requests.RemoveHandler(topic, nodeUuid, reqUuid))
-      {
-        std::cerr << "NodeShare::RecvSrvResponse(): "
-                  << "Error removing request handler" << std::endl;
-      }
-    }
+    std::lock_guard<std::mutex> lk(this->lastValueMutex);
+    auto it = this->lastValues.find(_delivery.topic);
+    if (it == this->lastValues.end())
+      return;
+    value = it->second;
   }
-  else
+
+  // The subscriber connected to the socket the topic is advertised with.
+  bool priority;
   {
-    std::cerr << "Received a service call response but I don't have a handler"
-              << " for it" << std::endl;
+    std::lock_guard<std::recursive_mutex> lk(this->owner->mutex);
+    priority = this->priorityTopics.find(
+      TopicKey(_delivery.topic, value.msgType)) != this->priorityTopics.end();
   }
-}
 
-//////////////////////////////////////////////////
-void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
-  const std::string &_reqType, const std::string &_repType)
-{
-  std::string responserAddr;
-  std::string responserId;
-  SrvAddresses_M addresses;
-  this->dataPtr->srvDiscovery->Publishers(_topic, addresses);
-  if (addresses.empty())
-    return;
+  // Only the subscriber process filters this topic frame. The message is
+  // sent whole and uncompressed, without metadata.
+  const std::string topicFrame =
+    DirectTopicPrefix(_delivery.pUuid) + _delivery.topic;
+  auto deallocator = [](void * /*_buffer*/, void *_holder)
+  {
+    delete reinterpret_cast<std::shared_ptr<char> *>(_holder);
+  };
 
-  // Find a publisher that offers this service with a particular pair of REQ/REP
-  // types.
-  bool found = false;
-  for (auto &proc : addresses)
+  try
   {
-    auto &v = proc.second;
-    for (auto &pub : v)
-    {
-      if (pub.ReqTypeName() == _reqType && pub.RepTypeName() == _repType)
-      {
-        found = true;
-        responserAddr = pub.Addr();
-        responserId = pub.SocketId();
-        break;
-      }
-    }
-    if (found)
-      break;
+    std::lock_guard<std::mutex> lock(this->publisherMutex);
+    zmq::socket_t *socket = priority ? this->priorityPublisher.get() :
+      this->publisher.get();
+    if (!socket)
+      return;
+
+    const std::string &addr =
+      priority ? this->priorityAddress : this->owner->myAddress;
+    zmq::message_t msg0(topicFrame.data(), topicFrame.size()),
+                   msg1(addr.data(), addr.size()),
+                   msg2(value.data.get(), value.size, deallocator,
+                     new std::shared_ptr<char>(value.data)),
+                   msg3(value.msgType.data(), value.msgType.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    socket->send(msg0, zmq::send_flags::sndmore);
+    socket->send(msg1, zmq::send_flags::sndmore);
+    socket->send(msg2, zmq::send_flags::sndmore);
+    socket->send(msg3, zmq::send_flags::none);
+#else
+    socket->send(msg0, ZMQ_SNDMORE);
+    socket->send(msg1, ZMQ_SNDMORE);
+    socket->send(msg2, ZMQ_SNDMORE);
+    socket->send(msg3, 0);
+#endif
+  }
+  catch (const zmq::error_t &_error)
+  {
+    std::cerr << "Unable to send the latest message of topic ["
+              << _delivery.topic << "]: " << _error.what() << std::endl;
   }
+}
 
-  if (!found)
-    return;
+/////////////////////////////////////////////////
+void NodeSharedPrivate::SubscribersChanged()
+{
+  ++this->subscribersVersion;
 
-  if (verbose)
   {
-    std::cout << "Found a service call responser at ["
-              << responserAddr << "]" << std::endl;
+    std::lock_guard<std::mutex> lk(this->matchMutex);
+    if (this->matchWatchers.empty())
+      return;
+    this->matchPending = true;
   }
+  this->signalMatch.notify_one();
+}
 
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
-
-  // I am still not connected to this address.
-  if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
-        responserAddr) == this->srvConnections.end())
+/////////////////////////////////////////////////
+void NodeSharedPrivate::AddMatchWatcher(
+  const std::shared_ptr<MatchWatcher> &_watcher)
+{
   {
-    this->dataPtr->requester->connect(responserAddr.c_str());
-    this->srvConnections.push_back(responserAddr);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    if (this->verbose)
+    std::lock_guard<std::mutex> lk(this->matchMutex);
+    if (!this->matchThread.joinable())
     {
-      std::cout << "\t* Connected to [" << responserAddr
-                << "] for service requests" << std::endl;
+      this->matchThread = std::thread(&NodeSharedPrivate::MatchThread, this);
+      configureThread(this->matchThread, "ign-match");
     }
-  }
 
-  // Send all the pending REQs.
-  IReqHandler_M reqs;
-  if (!this->requests.Handlers(_topic, reqs))
-    return;
+    this->matchWatchers.push_back(_watcher);
+    this->matchPending = true;
+  }
+  this->signalMatch.notify_one();
+}
 
-  for (auto &node : reqs)
+/////////////////////////////////////////////////
+void NodeSharedPrivate::MatchThread()
+{
+  while (true)
   {
-    for (auto &req : node.second)
+    std::vector<std::shared_ptr<MatchWatcher>> watchers;
     {
-      // Check if this service call has been already requested.
-      if (req.second->Requested())
-        continue;
+      std::unique_lock<std::mutex> lk(this->matchMutex);
+      this->signalMatch.wait(lk,
+        [this]{return this->matchPending || this->exit;});
+      if (this->exit)
+        return;
 
-      // Check that the pending service call has types that match the responser.
-      if (req.second->ReqTypeName() != _reqType ||
-          req.second->RepTypeName() != _repType)
+      this->matchPending = false;
+      for (auto it = this->matchWatchers.begin();
+           it != this->matchWatchers.end();)
       {
-        continue;
+        std::shared_ptr<MatchWatcher> watcher = it->lock();
+        if (!watcher)
+        {
+          it = this->matchWatchers.erase(it);
+          continue;
+        }
+        watchers.push_back(std::move(watcher));
+        ++it;
       }
+    }
 
-      // Mark the handler as requested.
-      req.second->Requested(true);
+    // Same check as Node::Publisher::HasConnections().
+    std::vector<char> matched(watchers.size(), false);
+    {
+      std::lock_guard<std::recursive_mutex> lk(this->owner->mutex);
+      for (std::size_t i = 0; i < watchers.size(); ++i)
+      {
+        const MatchWatcher &watcher = *watchers[i];
+        matched[i] = this->owner->localSubscribers.HasSubscriber(
+            watcher.topic, watcher.msgType) ||
+          this->owner->remoteSubscribers.HasTopic(
+            watcher.topic, watcher.msgType);
+      }
+    }
 
-      std::string data;
-      if (!req.second->Serialize(data))
+    // The callbacks run without any lock held, so they may publish,
+    // subscribe or destroy their publisher.
+    for (std::size_t i = 0; i < watchers.size(); ++i)
+    {
+      MatchWatcher &watcher = *watchers[i];
+      if (static_cast<bool>(matched[i]) == watcher.matched)
         continue;
+      watcher.matched = matched[i];
 
-      auto nodeUuid = req.second->NodeUuid();
-      auto reqUuid = req.second->HandlerUuid();
-
-      try
+      std::function<void(const bool)> callback;
       {
-        zmq::message_t msg;
+        std::lock_guard<std::mutex> lk(this->matchMutex);
+        callback = watcher.callback;
+      }
+      if (callback)
+        callback(watcher.matched);
+    }
+  }
+}
 
-        msg.rebuild(responserId.size());
-        memcpy(msg.data(), responserId.data(), responserId.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
-#else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::Retransmit(const std::string &_topic,
+  const std::string &_msgType, const std::string &_pUuid,
+  const std::vector<SeqRange> &_ranges)
+{
+  const std::string topicKey = TopicKey(_topic, _msgType);
+  std::shared_ptr<RetransmitBuffer> buffer;
+  bool priority;
+  {
+    std::lock_guard<std::recursive_mutex> lk(this->owner->mutex);
+    auto it = this->retransmitBuffers.find(topicKey);
+    if (it == this->retransmitBuffers.end())
+      return;
+    buffer = it->second;
+    priority = this->priorityTopics.find(topicKey) !=
+      this->priorityTopics.end();
+  }
 
-        msg.rebuild(_topic.size());
-        memcpy(msg.data(), _topic.data(), _topic.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
-#else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
-#endif
+  // Only the subscriber process filters this topic frame. The messages are
+  // sent as they were the first time, without metadata.
+  const std::string topicFrame = DirectTopicPrefix(_pUuid) + _topic;
+  auto deallocator = [](void * /*_buffer*/, void *_holder)
+  {
+    delete reinterpret_cast<std::shared_ptr<std::string> *>(_holder);
+  };
+
+  try
+  {
+    std::lock_guard<std::mutex> lock(this->publisherMutex);
+    zmq::socket_t *socket = priority ? this->priorityPublisher.get() :
+      this->publisher.get();
+    if (!socket)
+      return;
 
-        msg.rebuild(this->myRequesterAddress.size());
-        memcpy(msg.data(), this->myRequesterAddress.data(),
-          this->myRequesterAddress.size());
+    const std::string &addr =
+      priority ? this->priorityAddress : this->owner->myAddress;
+    for (const auto &range : _ranges)
+    {
+      for (const auto &entry : buffer->Range(range))
+      {
+        const std::string typeFrame =
+          kReliableMsgTypePrefix + entry.typePrefix + _msgType;
+        ReliableHeader header;
+        header.seq = entry.seq;
+        zmq::message_t msg0(topicFrame.data(), topicFrame.size()),
+                       msg1(addr.data(), addr.size()),
+                       msg2(&(*entry.data)[0], entry.data->size(),
+                         deallocator,
+                         new std::shared_ptr<std::string>(entry.data)),
+                       msg3(typeFrame.data(), typeFrame.size()),
+                       msg4(&header, sizeof(header));
 #ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+        socket->send(msg0, zmq::send_flags::sndmore);
+        socket->send(msg1, zmq::send_flags::sndmore);
+        socket->send(msg2, zmq::send_flags::sndmore);
+        socket->send(msg3, zmq::send_flags::sndmore);
+        socket->send(msg4, zmq::send_flags::none);
 #else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+        socket->send(msg0, ZMQ_SNDMORE);
+        socket->send(msg1, ZMQ_SNDMORE);
+        socket->send(msg2, ZMQ_SNDMORE);
+        socket->send(msg3, ZMQ_SNDMORE);
+        socket->send(msg4, 0);
 #endif
+      }
+    }
+  }
+  catch (const zmq::error_t &_error)
+  {
+    std::cerr << "Unable to resend the messages of topic [" << _topic
+              << "]: " << _error.what() << std::endl;
+  }
+}
 
-        std::string myId = this->responseReceiverId.ToString();
-        msg.rebuild(myId.size());
-        memcpy(msg.data(), myId.data(), myId.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
-#else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::SendNack(const std::string &_topic,
+  const ReliableStream &_stream, const std::vector<SeqRange> &_ranges)
+{
+  if (this->owner->verbose)
+  {
+    std::cout << "Requesting " << _ranges.size() << " ranges of missing "
+              << "messages on topic [" << _topic << "]" << std::endl;
+  }
 
-        msg.rebuild(nodeUuid.size());
-        memcpy(msg.data(), nodeUuid.data(), nodeUuid.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
-#else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
-#endif
+  const std::string myId = this->owner->responseReceiverId.ToString();
+  const std::string nackFrame = NackFrame(_ranges);
+  const std::string empty;
+  const std::string *frames[] =
+  {
+    &_stream.replierId, &_topic, &this->owner->myRequesterAddress, &myId,
+    &this->owner->pUuid, &empty, &nackFrame, &kReliableNackType,
+    &_stream.msgType
+  };
+  const std::size_t numFrames = sizeof(frames) / sizeof(frames[0]);
 
-        msg.rebuild(reqUuid.size());
-        memcpy(msg.data(), reqUuid.data(), reqUuid.size());
+  try
+  {
+    zmq::message_t msg;
+    for (std::size_t i = 0; i < numFrames; ++i)
+    {
+      msg.rebuild(frames[i]->size());
+      memcpy(msg.data(), frames[i]->data(), frames[i]->size());
+      const bool last = i + 1 == numFrames;
 #ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
+      this->requester->send(msg,
+        last ? zmq::send_flags::none : zmq::send_flags::sndmore);
 #else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
+      this->requester->send(msg, last ? 0 : ZMQ_SNDMORE);
 #endif
+    }
+  }
+  catch(const zmq::error_t& /*ze*/)
+  {
+    // The publisher might be gone.
+  }
+}
 
-        msg.rebuild(data.size());
-        memcpy(msg.data(), data.data(), data.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
-#else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::SendAck(const std::string &_topic,
+  const std::string &_sender, const uint64_t _ackId)
+{
+  auto peerIt = this->ackPeers.find(_sender);
+  if (peerIt == this->ackPeers.end())
+    return;
 
-        msg.rebuild(_reqType.size());
-        memcpy(msg.data(), _reqType.data(), _reqType.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
-#else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
-#endif
+  const std::string myId = this->owner->responseReceiverId.ToString();
+  const std::string ackFrame = std::to_string(_ackId);
+  const std::string empty;
+  const std::string *frames[] =
+  {
+    &peerIt->second.replierId, &_topic, &this->owner->myRequesterAddress,
+    &myId, &this->owner->pUuid, &empty, &ackFrame, &kAckType, &empty
+  };
+  const std::size_t numFrames = sizeof(frames) / sizeof(frames[0]);
 
-        msg.rebuild(_repType.size());
-        memcpy(msg.data(), _repType.data(), _repType.size());
+  try
+  {
+    zmq::message_t msg;
+    for (std::size_t i = 0; i < numFrames; ++i)
+    {
+      msg.rebuild(frames[i]->size());
+      memcpy(msg.data(), frames[i]->data(), frames[i]->size());
+      const bool last = i + 1 == numFrames;
 #ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::none);
+      this->requester->send(msg,
+        last ? zmq::send_flags::none : zmq::send_flags::sndmore);
 #else
-        this->dataPtr->requester->send(msg, 0);
+      this->requester->send(msg, last ? 0 : ZMQ_SNDMORE);
 #endif
-      }
-      catch(const zmq::error_t& /*ze*/)
-      {
-        // Debug output.
-        // std::cerr << "Error connecting [" << ze.what() << "]\n";
-      }
+    }
+  }
+  catch(const zmq::error_t& /*ze*/)
+  {
+    // The publisher might be gone.
+  }
+}
 
-      // Remove the handler associated to this service request. We won't
-      // receive a response because this is a oneway request.
-      if (_repType == ignition::msgs::Empty().GetTypeName())
+/////////////////////////////////////////////////
+std::set<std::string> NodeSharedPrivate::AckSubscribers(
+  const std::string &_topic)
+{
+  std::set<std::string> processes;
+  std::lock_guard<std::recursive_mutex> lock(this->owner->mutex);
+  std::map<std::string, std::vector<MessagePublisher>> subscribers;
+  if (!this->owner->remoteSubscribers.Publishers(_topic, subscribers))
+    return processes;
+
+  for (const auto &proc : subscribers)
+  {
+    for (const auto &sub : proc.second)
+    {
+      if (ParseCapabilities(sub.Addr()) & kCapAck)
       {
-        this->requests.RemoveHandler(_topic, nodeUuid, reqUuid);
+        processes.insert(proc.first);
+        break;
       }
     }
   }
+  return processes;
 }
 
-//////////////////////////////////////////////////
-void NodeShared::OnNewConnection(const MessagePublisher &_pub)
+/////////////////////////////////////////////////
+std::shared_ptr<CallbackExecutor> NodeSharedPrivate::Executor(
+  const std::shared_ptr<SubscriptionHandlerBase> &_handler)
 {
-  std::string topic = _pub.Topic();
-  std::string addr = _pub.Addr();
-  std::string procUuid = _pub.PUuid();
-
-  if (this->verbose)
+  // The callbacks of a node that spins run on the thread of the
+  // application, whatever the options of the subscription.
+  auto nodeIt = this->nodeExecutors.find(_handler->NodeUuid());
+  if (nodeIt != this->nodeExecutors.end() && nodeIt->second->IsManual())
+    return nodeIt->second;
+
+  if (!_handler->DedicatedThread() && _handler->QueueSize() == 0 &&
+      _handler->QueueBytes() == 0)
   {
-    std::cout << "Connection callback" << std::endl;
-    std::cout << _pub;
+    if (nodeIt == this->nodeExecutors.end())
+      return nullptr;
+    return nodeIt->second;
   }
 
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  const std::string hUuid = _handler->HandlerUuid();
+  auto it = this->handlerExecutors.find(hUuid);
+  if (it != this->handlerExecutors.end())
+    return it->second.executor;
 
-  // Check if we are interested in this topic.
-  if (this->localSubscribers.HasSubscriber(topic) &&
-      this->pUuid.compare(procUuid) != 0)
+  // Remove the executors of the handlers that no longer exist. This covers
+  // a message received while its handler was being unsubscribed.
+  for (auto execIt = this->handlerExecutors.begin();
+       execIt != this->handlerExecutors.end();)
   {
-    // Handle security
-    this->dataPtr->SecurityOnNewConnection();
+    if (execIt->second.handler.expired())
+      execIt = this->handlerExecutors.erase(execIt);
+    else
+      ++execIt;
+  }
 
-    // I am not connected to the process.
-    if (!this->connections.HasPublisher(addr))
-      this->dataPtr->subscriber->connect(addr.c_str());
+  HandlerExecutor handlerExecutor;
+  handlerExecutor.handler = _handler;
+  handlerExecutor.executor = std::make_shared<CallbackExecutor>(1u,
+    static_cast<std::size_t>(_handler->QueueSize()), _handler->QueuePolicy(),
+    _handler->QueueBytes(), this->recvBudget);
+  this->handlerExecutors[hUuid] = handlerExecutor;
+  return handlerExecutor.executor;
+}
 
-    // Add a new filter for the topic.
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->dataPtr->subscriber->set(zmq::sockopt::subscribe, topic);
-#else
-    this->dataPtr->subscriber->setsockopt(ZMQ_SUBSCRIBE,
-        topic.data(), topic.size());
-#endif
+/////////////////////////////////////////////////
+std::shared_ptr<CallbackExecutor> NodeSharedPrivate::ReplierExecutor(
+  const IRepHandlerPtr &_handler)
+{
+  if (_handler->MaxConcurrency() == 0)
+    return nullptr;
 
-    // Register the new connection with the publisher.
-    this->connections.AddPublisher(_pub);
+  const std::string hUuid = _handler->HandlerUuid();
+  auto it = this->repHandlerExecutors.find(hUuid);
+  if (it != this->repHandlerExecutors.end())
+    return it->second.executor;
 
-    if (this->verbose)
-      std::cout << "\t* Connected to [" << addr << "] for data\n";
+  // Remove the executors of the services that no longer exist.
+  for (auto execIt = this->repHandlerExecutors.begin();
+       execIt != this->repHandlerExecutors.end();)
+  {
+    if (execIt->second.handler.expired())
+      execIt = this->repHandlerExecutors.erase(execIt);
+    else
+      ++execIt;
+  }
 
-    MessagePublisher pub(_pub);
-    pub.SetPUuid(this->pUuid);
+  RepHandlerExecutor repHandlerExecutor;
+  repHandlerExecutor.handler = _handler;
+  repHandlerExecutor.executor =
+    std::make_shared<CallbackExecutor>(_handler->MaxConcurrency());
+  this->repHandlerExecutors[hUuid] = repHandlerExecutor;
+  return repHandlerExecutor.executor;
+}
 
-    // Hack: We use this field to store the PUuid of the topic publisher.
-    pub.SetCtrl(_pub.PUuid());
+/////////////////////////////////////////////////
+uint64_t NodeSharedPrivate::DispatchHandlers(const MessageInfo &_info,
+  const std::vector<ReceivedMsg> &_msgs, NodeShared::HandlerInfo &_handlerInfo)
+{
+  // Handlers of each executor.
+  std::map<std::shared_ptr<CallbackExecutor>, NodeShared::HandlerInfo> work;
 
-    std::vector<std::string> handlerNodeUuids =
-        this->localSubscribers.NodeUuids(topic, _pub.MsgTypeName());
-    for (const std::string &nodeUuid : handlerNodeUuids)
+  bool remainingLocal = false;
+  bool remainingRaw = false;
+  {
+    std::lock_guard<std::mutex> lk(this->executorsMutex);
+
+    for (auto &node : _handlerInfo.localHandlers)
     {
-      pub.SetNUuid(nodeUuid);
+      for (auto it = node.second.begin(); it != node.second.end();)
+      {
+        std::shared_ptr<CallbackExecutor> executor =
+          it->second ? this->Executor(it->second) : nullptr;
+        if (!executor)
+        {
+          remainingLocal = true;
+          ++it;
+          continue;
+        }
 
-      // Send a message to the publisher notify it
-      // about all my remoteSubscribers.
-      this->dataPtr->msgDiscovery->Register(pub);
+        NodeShared::HandlerInfo &handlerInfo = work[executor];
+        handlerInfo.localHandlers[node.first][it->first] = it->second;
+        it = node.second.erase(it);
+      }
+    }
+
+    for (auto &node : _handlerInfo.rawHandlers)
+    {
+      for (auto it = node.second.begin(); it != node.second.end();)
+      {
+        std::shared_ptr<CallbackExecutor> executor =
+          it->second ? this->Executor(it->second) : nullptr;
+        if (!executor)
+        {
+          remainingRaw = true;
+          ++it;
+          continue;
+        }
+
+        NodeShared::HandlerInfo &handlerInfo = work[executor];
+        handlerInfo.rawHandlers[node.first][it->first] = it->second;
+        it = node.second.erase(it);
+      }
     }
   }
-}
 
-//////////////////////////////////////////////////
-void NodeShared::OnNewDisconnection(const MessagePublisher &_pub)
-{
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  if (work.empty())
+    return 0;
 
-  std::string topic = _pub.Topic();
-  std::string procUuid = _pub.PUuid();
-  std::string nUuid = _pub.NUuid();
+  _handlerInfo.haveLocal = _handlerInfo.haveLocal && remainingLocal;
+  _handlerInfo.haveRaw = _handlerInfo.haveRaw && remainingRaw;
 
-  if (this->verbose)
+  uint64_t dropped = 0;
+  for (auto &entry : work)
   {
-    std::cout << "New disconnection detected " << std::endl;
-    std::cout << "\tProcess UUID: " << procUuid << std::endl;
+    NodeShared::HandlerInfo &handlerInfo = entry.second;
+    handlerInfo.haveLocal = !handlerInfo.localHandlers.empty();
+    handlerInfo.haveRaw = !handlerInfo.rawHandlers.empty();
+    auto handlers =
+      std::make_shared<const NodeShared::HandlerInfo>(handlerInfo);
+
+    // Messages of the same topic are delivered in order. One task per
+    // message, so the bounded queues of the subscriptions count messages,
+    // and the bytes of the message are charged to the queue. The views
+    // keep the received buffers alive until the callback runs.
+    const uint64_t droppedBefore = entry.first->Dropped();
+    for (const ReceivedMsg &msgData : _msgs)
+    {
+      NodeShared *shared = this->owner;
+      entry.first->Post(_info.Topic(), [shared, _info, msgData, handlers]()
+      {
+        shared->TriggerCallbacks(_info, msgData.data.get(), msgData.size,
+          *handlers);
+      }, msgData.size);
+    }
+    dropped += entry.first->Dropped() - droppedBefore;
   }
 
-  // A remote subscriber[s] has been disconnected.
-  if (topic != "" && nUuid != "")
-  {
-    this->remoteSubscribers.DelPublisherByNode(topic, procUuid, nUuid);
+  return dropped;
+}
 
-    MessagePublisher connection;
-    if (!this->connections.Publisher(topic, procUuid, nUuid, connection))
-      return;
+/////////////////////////////////////////////////
+std::vector<std::shared_ptr<CallbackExecutor>>
+  NodeSharedPrivate::RemoveExecutors(const std::vector<std::string> &_uuids)
+{
+  std::vector<std::shared_ptr<CallbackExecutor>> removed;
 
-    // I am no longer connected.
-    this->connections.DelPublisherByNode(topic, procUuid, nUuid);
-  }
-  else
+  std::lock_guard<std::mutex> lk(this->executorsMutex);
+  for (const std::string &uuid : _uuids)
   {
-    // Note: We deliberately don't remove the list of remote subscribers
-    // for this process. Remote nodes might suffer package delays (due to WiFi
-    // or traffic load) and if we remove them, they won't be able to receive
-    // data anymore.
+    auto nodeIt = this->nodeExecutors.find(uuid);
+    if (nodeIt != this->nodeExecutors.end())
+    {
+      removed.push_back(nodeIt->second);
+      this->nodeExecutors.erase(nodeIt);
+    }
 
-    MsgAddresses_M info;
-    if (!this->connections.Publishers(topic, info))
-      return;
+    auto handlerIt = this->handlerExecutors.find(uuid);
+    if (handlerIt != this->handlerExecutors.end())
+    {
+      removed.push_back(handlerIt->second.executor);
+      this->handlerExecutors.erase(handlerIt);
+    }
 
-    // Remove all the connections from the process disonnected.
-    this->connections.DelPublishersByProc(procUuid);
+    auto repIt = this->repHandlerExecutors.find(uuid);
+    if (repIt != this->repHandlerExecutors.end())
+    {
+      removed.push_back(repIt->second.executor);
+      this->repHandlerExecutors.erase(repIt);
+    }
   }
+
+  return removed;
 }
 
-//////////////////////////////////////////////////
-void NodeShared::OnNewSrvConnection(const ServicePublisher &_pub)
+/////////////////////////////////////////////////
+std::shared_ptr<const NodeSharedPrivate::TopicHandlers>
+  NodeSharedPrivate::CachedHandlers(const std::string &_topic)
 {
-  std::string topic = _pub.Topic();
-  std::string addr = _pub.Addr();
-  std::string reqType = _pub.ReqTypeName();
-  std::string repType = _pub.RepTypeName();
+  std::shared_ptr<const TopicHandlers_M> cache =
+    std::atomic_load(&this->handlerCache);
+  if (cache)
+  {
+    auto it = cache->find(_topic);
+    if (it != cache->end())
+      return it->second;
+  }
 
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  NodeShared *shared = this->owner;
+  std::lock_guard<std::recursive_mutex> lk(shared->mutex);
 
-  if (this->verbose)
+  // The cache might have been updated while we were waiting.
+  cache = std::atomic_load(&this->handlerCache);
+  if (cache)
   {
-    std::cout << "Service call connection callback" << std::endl;
-    std::cout << _pub;
+    auto it = cache->find(_topic);
+    if (it != cache->end())
+      return it->second;
   }
 
-  // I am still not connected to this address.
-  if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
-        addr) == this->srvConnections.end())
+  auto handlers = std::make_shared<TopicHandlers>();
+  handlers->info = shared->CheckHandlerInfo(_topic);
+  handlers->metrics = MetricsOf(_topic);
+
+  auto isDirect = [this](const auto &_handlers)
   {
-    this->dataPtr->requester->connect(addr.c_str());
-    this->srvConnections.push_back(addr);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    if (this->verbose)
+    for (const auto &node : _handlers)
     {
-      std::cout << "\t* Connected to [" << addr
-                << "] for service requests" << std::endl;
+      for (const auto &handler : node.second)
+      {
+        if (handler.second && (handler.second->Conflated() ||
+              handler.second->Batched() ||
+              handler.second->DedicatedThread() ||
+              handler.second->QueueSize() > 0 ||
+              handler.second->QueueBytes() > 0 ||
+              this->nodeExecutors.find(node.first) !=
+                this->nodeExecutors.end()))
+        {
+          return false;
+        }
+      }
     }
+    return true;
+  };
+
+  {
+    std::lock_guard<std::mutex> execLk(this->executorsMutex);
+    handlers->direct = isDirect(handlers->info.localHandlers) &&
+      isDirect(handlers->info.rawHandlers);
   }
 
-  // Check if there's a pending service request with this specific combination
-  // of request and response types.
-  IReqHandlerPtr handler;
-  if (this->requests.FirstHandler(topic, reqType, repType, handler))
+  auto newCache = cache ? std::make_shared<TopicHandlers_M>(*cache) :
+    std::make_shared<TopicHandlers_M>();
+  (*newCache)[_topic] = handlers;
+  std::atomic_store(&this->handlerCache,
+    std::shared_ptr<const TopicHandlers_M>(newCache));
+
+  return handlers;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::InvalidateHandlers(const std::string &_topic)
+{
+  std::shared_ptr<const TopicHandlers_M> cache =
+    std::atomic_load(&this->handlerCache);
+  if (!cache || cache->find(_topic) == cache->end())
+    return;
+
+  auto newCache = std::make_shared<TopicHandlers_M>(*cache);
+  newCache->erase(_topic);
+  std::atomic_store(&this->handlerCache,
+    std::shared_ptr<const TopicHandlers_M>(newCache));
+}
+
+//////////////////////////////////////////////////
+std::optional<transport::TopicStatistics> NodeShared::TopicStats(
+    const std::string &_topic) const
+{
+  auto entry = this->dataPtr->CachedTopicStats(_topic);
+  if (!entry)
+    return std::nullopt;
+
+  std::lock_guard<std::mutex> lk(entry->mutex);
+  if (!entry->hasStats)
+    return std::nullopt;
+  return entry->stats;
+}
+
+//////////////////////////////////////////////////
+void NodeShared::EnableStats(const std::string &_topic, bool _enable,
+    std::function<void(const TopicStatistics &_stats)> _statCb,
+    uint64_t _rate)
+{
+  std::shared_ptr<NodeSharedPrivate::TopicStatsEntry> entry;
+  std::shared_ptr<NodeSharedPrivate::TopicStatsEntry> evicted;
   {
-    // Request all pending service calls for this topic and req/rep types.
-    this->SendPendingRemoteReqs(topic, reqType, repType);
+    std::lock_guard<std::mutex> lk(this->dataPtr->topicStatsMutex);
+    std::shared_ptr<const NodeSharedPrivate::TopicStats_M> cache =
+      std::atomic_load(&this->dataPtr->topicStatsCache);
+    auto newCache = cache ?
+      std::make_shared<NodeSharedPrivate::TopicStats_M>(*cache) :
+      std::make_shared<NodeSharedPrivate::TopicStats_M>();
+
+    auto it = newCache->find(_topic);
+    if (it != newCache->end())
+      entry = it->second;
+
+    if (_enable)
+    {
+      // Enabling the statistics again keeps the current statistics.
+      if (!entry)
+      {
+        // Forget the topic updated the least recently when there are too
+        // many, e.g. the topics that came and went in a long running
+        // process.
+        const std::size_t maxTopics = this->dataPtr->topicStatsMaxTopics;
+        if (maxTopics > 0 && newCache->size() >= maxTopics)
+        {
+          auto oldest = newCache->end();
+          auto oldestUpdate = std::chrono::steady_clock::time_point::max();
+          for (auto candidate = newCache->begin();
+               candidate != newCache->end(); ++candidate)
+          {
+            std::lock_guard<std::mutex> entryLk(candidate->second->mutex);
+            if (candidate->second->lastUpdate < oldestUpdate)
+            {
+              oldestUpdate = candidate->second->lastUpdate;
+              oldest = candidate;
+            }
+          }
+          if (oldest != newCache->end())
+          {
+            std::cerr << "Too many topics with statistics, disabling the "
+                      << "statistics of [" << oldest->first << "]"
+                      << std::endl;
+            evicted = oldest->second;
+            newCache->erase(oldest);
+          }
+        }
+
+        entry = std::make_shared<NodeSharedPrivate::TopicStatsEntry>();
+        entry->stats.SetClockOffsetCorrection(
+          this->dataPtr->topicStatsClockOffset);
+        entry->lastUpdate = std::chrono::steady_clock::now();
+        (*newCache)[_topic] = entry;
+      }
+
+      entry->period = std::chrono::steady_clock::duration::zero();
+      if (_rate > 0)
+      {
+        entry->period =
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(1000000000 / _rate));
+      }
+      entry->next = std::chrono::steady_clock::now();
+
+      if (!this->dataPtr->topicStatsThread.joinable())
+      {
+        this->dataPtr->topicStatsThread = std::thread(
+          &NodeSharedPrivate::TopicStatsThread, this->dataPtr.get());
+        configureThread(this->dataPtr->topicStatsThread, "ign-topic-stats");
+      }
+    }
+    else
+    {
+      newCache->erase(_topic);
+    }
+
+    bool everyUpdate = false;
+    for (const auto &topicStats : *newCache)
+    {
+      everyUpdate = everyUpdate ||
+        topicStats.second->period ==
+          std::chrono::steady_clock::duration::zero();
+    }
+    this->dataPtr->topicStatsEveryUpdate = everyUpdate;
+    this->dataPtr->topicStatsUpdated = true;
+
+    std::atomic_store(&this->dataPtr->topicStatsCache,
+      std::shared_ptr<const NodeSharedPrivate::TopicStats_M>(newCache));
+    this->dataPtr->signalTopicStats.notify_all();
+  }
+
+  // Waits for a callback running with the previous value.
+  if (entry || evicted)
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->topicStatsCbMutex);
+    if (entry)
+      entry->cb = _enable ? _statCb : nullptr;
+    if (evicted)
+      evicted->cb = nullptr;
   }
+
+  // Without IGN_TRANSPORT_TOPIC_STATISTICS, the publishers only send the
+  // publication metadata of a topic to the subscribers that ask for it.
+  // Discovering the topic again registers our subscriptions with the new
+  // flags.
+  if (!this->dataPtr->topicStatsEnabled)
+    this->dataPtr->msgDiscovery->Discover(_topic);
+}
+
+/////////////////////////////////////////////////
+std::shared_ptr<NodeSharedPrivate::TopicStatsEntry>
+  NodeSharedPrivate::CachedTopicStats(const std::string &_topic) const
+{
+  std::shared_ptr<const TopicStats_M> cache =
+    std::atomic_load(&this->topicStatsCache);
+  if (!cache)
+    return nullptr;
+
+  auto it = cache->find(_topic);
+  if (it == cache->end())
+    return nullptr;
+  return it->second;
 }
 
-//////////////////////////////////////////////////
-void NodeShared::OnNewSrvDisconnection(const ServicePublisher &_pub)
-{
-  std::string addr = _pub.Addr();
+/////////////////////////////////////////////////
+void NodeSharedPrivate::TopicStatsThread()
+{
+  std::unique_lock<std::mutex> lk(this->topicStatsMutex);
+  while (!this->exit)
+  {
+    // Find the topics whose callback is due, and when the next one is.
+    const auto now = std::chrono::steady_clock::now();
+    auto wakeup = std::chrono::steady_clock::time_point::max();
+    std::vector<std::shared_ptr<TopicStatsEntry>> due;
+    std::shared_ptr<const TopicStats_M> cache =
+      std::atomic_load(&this->topicStatsCache);
+    if (cache)
+    {
+      for (const auto &topicStats : *cache)
+      {
+        TopicStatsEntry &entry = *topicStats.second;
+        if (entry.next <= now)
+        {
+          due.push_back(topicStats.second);
+          entry.next = now + entry.period;
+        }
+
+        // The topics without a period wait for their updates.
+        if (entry.period > std::chrono::steady_clock::duration::zero())
+          wakeup = std::min(wakeup, entry.next);
+      }
+    }
+    this->topicStatsUpdated = false;
+    lk.unlock();
 
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    {
+      std::lock_guard<std::mutex> cbLk(this->topicStatsCbMutex);
+      for (const auto &entry : due)
+      {
+        std::unique_ptr<TopicStatistics> snapshot;
+        {
+          std::lock_guard<std::mutex> entryLk(entry->mutex);
+          if (!entry->updated)
+            continue;
+          entry->updated = false;
+          snapshot.reset(new TopicStatistics(entry->stats));
+        }
 
-  // Remove the address from the list of connected addresses.
-  this->srvConnections.erase(std::remove(std::begin(this->srvConnections),
-    std::end(this->srvConnections), addr.c_str()),
-    std::end(this->srvConnections));
+        if (!entry->cb)
+          continue;
 
-  if (this->verbose)
-  {
-    std::cout << "Service call disconnection callback" << std::endl;
-    std::cout << _pub;
+        try
+        {
+          entry->cb(*snapshot);
+        }
+        catch (...)
+        {
+          std::cerr << "Exception occurred in a topic statistics callback"
+                    << std::endl;
+        }
+      }
+    }
+
+    lk.lock();
+    auto ready = [this]{return this->topicStatsUpdated || this->exit;};
+    if (wakeup == std::chrono::steady_clock::time_point::max())
+      this->signalTopicStats.wait(lk, ready);
+    else
+      this->signalTopicStats.wait_until(lk, wakeup, ready);
   }
 }
 
 //////////////////////////////////////////////////
-void NodeShared::OnNewRegistration(const MessagePublisher &_pub)
+void NodeShared::EnableMetrics(bool _enable,
+    std::function<void(const MetricsRegistry &_metrics)> _cb,
+    uint64_t _rate)
 {
-  // Discard the message if the destination PUUID is not me.
-  if (_pub.Ctrl() != this->pUuid)
-    return;
-
-  std::string procUuid = _pub.PUuid();
-  std::string nodeUuid = _pub.NUuid();
-
-  if (this->verbose)
   {
-    std::cout << "Registering a new remote connection" << std::endl;
-    std::cout << "\tProc UUID: [" << procUuid << "]" << std::endl;
-    std::cout << "\tNode UUID: [" << nodeUuid << "]" << std::endl;
+    std::lock_guard<std::mutex> lk(this->dataPtr->metricsMutex);
+    if (_enable)
+    {
+      this->dataPtr->metricsPeriod = std::chrono::seconds(1);
+      if (_rate > 0)
+      {
+        this->dataPtr->metricsPeriod =
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(1000000000 / _rate));
+      }
+
+      if (!this->dataPtr->metricsThread.joinable())
+      {
+        this->dataPtr->metricsThread = std::thread(
+          &NodeSharedPrivate::MetricsThread, this->dataPtr.get());
+        configureThread(this->dataPtr->metricsThread, "ign-metrics");
+      }
+    }
+    this->dataPtr->signalMetrics.notify_all();
   }
 
-  // Add a remote subscriber.
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
-  this->remoteSubscribers.AddPublisher(_pub);
+  // Waits for a callback running with the previous value.
+  std::lock_guard<std::mutex> lk(this->dataPtr->metricsCbMutex);
+  this->dataPtr->metricsCb = _enable ? _cb : nullptr;
 }
 
-//////////////////////////////////////////////////
-void NodeShared::OnEndRegistration(const MessagePublisher &_pub)
+/////////////////////////////////////////////////
+NodeSharedPrivate::TopicMetrics NodeSharedPrivate::MetricsOf(
+    const std::string &_topic)
 {
-  // Discard the message if the destination PUUID is not me.
-  if (_pub.Ctrl() != this->pUuid)
-    return;
+  // The metrics are labeled with the partition and the topic name, without
+  // the namespace separator.
+  std::string partition;
+  std::string topic;
+  if (!TopicUtils::DecomposeFullyQualifiedTopic(_topic, partition, topic))
+    topic = _topic;
+  const MetricLabels labels = {{"partition", partition}, {"topic", topic}};
+
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  TopicMetrics metrics;
+  metrics.sentMsgs = &registry.Counter("ign_transport_messages_sent",
+    "Messages sent to the subscribers of other processes", labels);
+  metrics.sentBytes = &registry.Counter("ign_transport_message_bytes_sent",
+    "Bytes of the messages sent to the subscribers of other processes, "
+    "before compression", labels);
+  metrics.receivedMsgs = &registry.Counter("ign_transport_messages_received",
+    "Messages received from the publishers of other processes", labels);
+  metrics.receivedBytes = &registry.Counter(
+    "ign_transport_message_bytes_received",
+    "Bytes of the messages received from the publishers of other processes, "
+    "after decompression", labels);
+  metrics.queueDroppedMsgs = &registry.Counter(
+    "ign_transport_queue_dropped_messages",
+    "Messages received discarded by the full queue of a subscription",
+    labels);
+  return metrics;
+}
 
-  std::string topic = _pub.Topic();
-  std::string procUuid = _pub.PUuid();
-  std::string nodeUuid = _pub.NUuid();
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RegisterGauges(NodeShared &_shared)
+{
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  NodeShared *shared = &_shared;
+
+  registry.AddGaugeCallback(kGaugeNames[0],
+    "Messages waiting in the local publish queues", {},
+    [shared]{return static_cast<double>(shared->LocalPublishQueueDepth());});
+  registry.AddGaugeCallback(kGaugeNames[1],
+    "Largest number of messages waiting in a local publish queue", {},
+    [shared]
+    {
+      return static_cast<double>(shared->LocalPublishQueueHighWaterMark());
+    });
+  registry.AddGaugeCallback(kGaugeNames[2],
+    "Messages discarded by the full local publish queues", {},
+    [shared]
+    {
+      return static_cast<double>(shared->LocalPublishQueueDroppedMsgs());
+    });
+  registry.AddGaugeCallback(kGaugeNames[3],
+    "Service requests sent to other processes waiting for a response", {},
+    [this, shared]
+    {
+      std::lock_guard<std::recursive_mutex> lk(shared->mutex);
+      return static_cast<double>(this->pendingRequests.size());
+    });
+}
 
-  if (this->verbose)
+/////////////////////////////////////////////////
+void NodeSharedPrivate::StartConnectionMonitors(const std::string &_id,
+  const bool _metrics)
+{
+  const std::string pubEndpoint = "inproc://ign-monitor-publisher-" + _id;
+  const std::string subEndpoint = "inproc://ign-monitor-subscriber-" + _id;
+  if (zmq_socket_monitor(static_cast<void *>(*this->publisher),
+        pubEndpoint.c_str(), ZMQ_EVENT_ALL) != 0 ||
+      zmq_socket_monitor(static_cast<void *>(*this->subscriber),
+        subEndpoint.c_str(), ZMQ_EVENT_ALL) != 0)
   {
-    std::cout << "Registering the end of a remote connection" << std::endl;
-    std::cout << "\tProc UUID: " << procUuid << std::endl;
-    std::cout << "\tNode UUID: [" << nodeUuid << "]" << std::endl;
+    std::cerr << "Unable to monitor the connections: "
+              << zmq_strerror(zmq_errno()) << std::endl;
+    return;
   }
 
-  // Delete a remote subscriber.
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
-  this->remoteSubscribers.DelPublisherByNode(topic, procUuid, nodeUuid);
+  this->publisherMonitor =
+    std::make_unique<ConnectionMonitor>("publisher", _metrics);
+  this->subscriberMonitor =
+    std::make_unique<ConnectionMonitor>("subscriber", _metrics);
+  this->connectionMonitorThread = std::thread(
+    &NodeSharedPrivate::ConnectionMonitorThread, this, pubEndpoint,
+    subEndpoint);
+  configureThread(this->connectionMonitorThread, "ign-connections");
 }
 
-//////////////////////////////////////////////////
-bool NodeShared::InitializeSockets()
+/////////////////////////////////////////////////
+void NodeSharedPrivate::ConnectionMonitorThread(
+  const std::string &_pubEndpoint, const std::string &_subEndpoint)
 {
+  zmq::socket_t pubEvents(*this->context, ZMQ_PAIR);
+  zmq::socket_t subEvents(*this->context, ZMQ_PAIR);
   try
   {
-    // Set the hostname's ip address.
-    this->hostAddr = this->dataPtr->msgDiscovery->HostAddr();
-
-    // Publisher socket listening in a random port.
-    std::string anyTcpEp = "tcp://" + this->hostAddr + ":*";
-
-    // Initialize security
-    this->dataPtr->SecurityInit();
-
-    int lingerVal = 0;
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->dataPtr->publisher->set(zmq::sockopt::linger, lingerVal);
-#else
-    this->dataPtr->publisher->setsockopt(ZMQ_LINGER,
-        &lingerVal, sizeof(lingerVal));
-#endif
-
-    // Set the capacity of the buffer for receiving messages.
-    int rcvQueueVal = this->dataPtr->NonNegativeEnvVar(
-      "IGN_TRANSPORT_RCVHWM", kDefaultRcvHwm);
-
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->dataPtr->subscriber->set(zmq::sockopt::rcvhwm, rcvQueueVal);
-#else
-    this->dataPtr->subscriber->setsockopt(ZMQ_RCVHWM,
-          &rcvQueueVal, sizeof(rcvQueueVal));
-#endif
+    pubEvents.connect(_pubEndpoint);
+    subEvents.connect(_subEndpoint);
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "Unable to receive the events of the socket monitors: "
+              << _error.what() << std::endl;
+    return;
+  }
 
-    // Set the capacity of the buffer for sending messages.
-    int sndQueueVal = this->dataPtr->NonNegativeEnvVar(
-      "IGN_TRANSPORT_SNDHWM", kDefaultSndHwm);
+  // Each event is a frame with its number and value, followed by a frame
+  // with its endpoint.
+  auto receive = [](zmq::socket_t &_socket, ConnectionMonitor &_monitor)
+  {
+    const std::vector<std::string> frames = receiveFramesHelper(_socket);
+    if (frames.size() < 2 || frames[0].size() < 6)
+      return;
 
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->dataPtr->publisher->set(zmq::sockopt::sndhwm, sndQueueVal);
+    uint16_t event;
+    uint32_t value;
+    std::memcpy(&event, frames[0].data(), sizeof(event));
+    std::memcpy(&value, frames[0].data() + sizeof(event), sizeof(value));
+    _monitor.OnEvent(event, value, frames[1]);
+  };
 
-    this->dataPtr->publisher->bind(anyTcpEp.c_str());
-    this->myAddress =
-        this->dataPtr->publisher->get(zmq::sockopt::last_endpoint);
+  this->PollSockets(
+    {
+      {&pubEvents, [&]{receive(pubEvents, *this->publisherMonitor);}},
+      {&subEvents, [&]{receive(subEvents, *this->subscriberMonitor);}}
+    });
+}
 
-    // ResponseReceiver socket listening in a random port.
-    std::string id = this->responseReceiverId.ToString();
-    this->dataPtr->responseReceiver->set(zmq::sockopt::routing_id, id);
-    this->dataPtr->responseReceiver->bind(anyTcpEp.c_str());
-    this->myRequesterAddress = this->dataPtr->responseReceiver->get(
-        zmq::sockopt::last_endpoint);
+/////////////////////////////////////////////////
+void NodeSharedPrivate::MetricsThread()
+{
+  std::unique_lock<std::mutex> lk(this->metricsMutex);
+  while (!this->exit)
+  {
+    auto next = std::chrono::steady_clock::now() + this->metricsPeriod;
+    if (this->signalMetrics.wait_until(lk, next,
+          [this]{return this->exit.load();}))
+    {
+      return;
+    }
+    lk.unlock();
 
-    // Replier socket listening in a random port.
-    id = this->replierId.ToString();
-    this->dataPtr->replier->set(zmq::sockopt::routing_id, id);
-    int routeOn = 1;
-    this->dataPtr->replier->set(zmq::sockopt::linger, lingerVal);
-    this->dataPtr->replier->set(zmq::sockopt::router_mandatory, routeOn);
-    this->dataPtr->replier->bind(anyTcpEp.c_str());
-    this->myReplierAddress =
-        this->dataPtr->replier->get(zmq::sockopt::last_endpoint);
+    {
+      std::lock_guard<std::mutex> cbLk(this->metricsCbMutex);
+      if (this->metricsCb)
+      {
+        try
+        {
+          this->metricsCb(MetricsRegistry::Instance());
+        }
+        catch (...)
+        {
+          std::cerr << "Exception occurred in the metrics callback"
+                    << std::endl;
+        }
+      }
+    }
 
-    this->dataPtr->requester->set(zmq::sockopt::linger, lingerVal);
-    this->dataPtr->requester->set(zmq::sockopt::router_mandatory, routeOn);
-#else
-    char bindEndPoint[1024];
-    this->dataPtr->publisher->setsockopt(ZMQ_SNDHWM,
-        &sndQueueVal, sizeof(sndQueueVal));
+    lk.lock();
+  }
+}
 
-    this->dataPtr->publisher->bind(anyTcpEp.c_str());
-    size_t size = sizeof(bindEndPoint);
-    this->dataPtr->publisher->getsockopt(ZMQ_LAST_ENDPOINT,
-        &bindEndPoint, &size);
-    this->myAddress = bindEndPoint;
+//////////////////////////////////////////////////
+uint64_t NodeSharedPrivate::Microseconds(
+    const std::chrono::steady_clock::duration &_duration)
+{
+  return static_cast<uint64_t>(std::max<int64_t>(0,
+    std::chrono::duration_cast<std::chrono::microseconds>(_duration)
+    .count()));
+}
 
-    // ResponseReceiver socket listening in a random port.
-    std::string id = this->responseReceiverId.ToString();
-    this->dataPtr->responseReceiver->setsockopt(ZMQ_IDENTITY,
-        id.c_str(), id.size());
-    this->dataPtr->responseReceiver->bind(anyTcpEp.c_str());
-    this->dataPtr->responseReceiver->getsockopt(ZMQ_LAST_ENDPOINT,
-        &bindEndPoint, &size);
-    this->myRequesterAddress = bindEndPoint;
+//////////////////////////////////////////////////
+std::optional<ServiceStatistics> NodeShared::ServiceStats(
+    const std::string &_service) const
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->serviceStatsMutex);
+  auto it = this->dataPtr->serviceStats.find(_service);
+  if (it != this->dataPtr->serviceStats.end())
+    return it->second;
+  return std::nullopt;
+}
 
-    // Replier socket listening in a random port.
-    id = this->replierId.ToString();
-    this->dataPtr->replier->setsockopt(ZMQ_IDENTITY, id.c_str(), id.size());
-    int RouteOn = 1;
-    this->dataPtr->replier->setsockopt(ZMQ_LINGER,
-        &lingerVal, sizeof(lingerVal));
-    this->dataPtr->replier->setsockopt(ZMQ_ROUTER_MANDATORY,
-        &RouteOn, sizeof(RouteOn));
-    this->dataPtr->replier->bind(anyTcpEp.c_str());
-    this->dataPtr->replier->getsockopt(ZMQ_LAST_ENDPOINT, &bindEndPoint, &size);
-    this->myReplierAddress = bindEndPoint;
+//////////////////////////////////////////////////
+void NodeShared::EnableServiceStats(const std::string &_service,
+    bool _enable, std::function<void(const ServiceStatistics &_stats)> _cb,
+    uint64_t _rate)
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->serviceStatsMutex);
+  if (_enable)
+  {
+    NodeSharedPrivate::ServiceStatsPublication publication;
+    publication.cb = _cb;
+    publication.period = std::chrono::steady_clock::duration::zero();
+    if (_rate > 0)
+    {
+      publication.period =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::nanoseconds(1000000000 / _rate));
+    }
+    publication.next = std::chrono::steady_clock::now();
+    this->dataPtr->enabledServiceStatistics[_service] = publication;
 
-    this->dataPtr->requester->setsockopt(ZMQ_LINGER,
-        &lingerVal, sizeof(lingerVal));
-    this->dataPtr->requester->setsockopt(ZMQ_ROUTER_MANDATORY, &RouteOn,
-      sizeof(RouteOn));
-#endif
+    // Available from ServiceStats() before the first request.
+    this->dataPtr->serviceStats[_service];
   }
-  catch(const zmq::error_t& ze)
+  else
   {
-    std::cerr << "InitializeSockets() Error: " << ze.what() << std::endl;
-    std::cerr << "Ignition Transport has not been correctly initialized"
-              << std::endl;
-    return false;
+    this->dataPtr->enabledServiceStatistics.erase(_service);
+    this->dataPtr->serviceStats.erase(_service);
   }
 
-  return true;
+  this->dataPtr->serviceStatsEnabled =
+    !this->dataPtr->enabledServiceStatistics.empty();
 }
 
 /////////////////////////////////////////////////
-bool NodeShared::TopicPublishers(const std::string &_topic,
-                                 SrvAddresses_M &_publishers) const
+bool NodeSharedPrivate::SameHost(const std::string &_addr,
+    const std::string &_hostAddr)
 {
-  return this->dataPtr->srvDiscovery->Publishers(_topic, _publishers);
+  return _addr.compare(0, 6, "tcp://") == 0 &&
+    _addr.compare(6, _hostAddr.size(), _hostAddr) == 0 &&
+    _addr.size() > 6 + _hostAddr.size() &&
+    _addr[6 + _hostAddr.size()] == ':';
 }
 
 /////////////////////////////////////////////////
-bool NodeShared::DiscoverService(const std::string &_topic) const
+std::string NodeSharedPrivate::TopicKey(const std::string &_topic,
+    const std::string &_msgType)
 {
-  return this->dataPtr->srvDiscovery->Discover(_topic);
+  return _topic + '\0' + _msgType;
 }
 
 /////////////////////////////////////////////////
-bool NodeShared::AdvertisePublisher(const ServicePublisher &_publisher)
+std::string NodeSharedPrivate::RequestIdFrame(const uint64_t _id)
 {
-  return this->dataPtr->srvDiscovery->Advertise(_publisher);
+  std::string frame(1 + sizeof(_id), '\0');
+  for (std::size_t i = 0; i < sizeof(_id); ++i)
+    frame[1 + i] = static_cast<char>((_id >> (8 * i)) & 0xFF);
+  return frame;
 }
 
 /////////////////////////////////////////////////
-int NodeShared::RcvHwm()
+bool NodeSharedPrivate::ParseRequestIdFrame(const std::string &_frame,
+    uint64_t &_id)
 {
-  int rcvHwm;
-  try
-  {
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    rcvHwm = this->dataPtr->subscriber->get(zmq::sockopt::rcvhwm);
-#else
-    size_t rcvHwmSize = sizeof(rcvHwm);
-    this->dataPtr->subscriber->getsockopt(ZMQ_RCVHWM, &rcvHwm, &rcvHwmSize);
-#endif
-  }
-  catch (zmq::error_t &_e)
+  if (_frame.size() != 1 + sizeof(_id) || _frame[0] != '\0')
+    return false;
+
+  _id = 0;
+  for (std::size_t i = 0; i < sizeof(_id); ++i)
   {
-    return -1;
+    _id |= static_cast<uint64_t>(static_cast<uint8_t>(_frame[1 + i])) <<
+      (8 * i);
   }
-
-  return rcvHwm;
+  return true;
 }
 
 /////////////////////////////////////////////////
-int NodeShared::SndHwm()
+std::string NodeSharedPrivate::DeadlineFrame(const int64_t _deadline,
+    const uint32_t _budget)
 {
-  int sndHwm;
-  try
-  {
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    sndHwm = this->dataPtr->publisher->get(zmq::sockopt::sndhwm);
-#else
-    size_t sndHwmSize = sizeof(sndHwm);
-    this->dataPtr->publisher->getsockopt(ZMQ_SNDHWM, &sndHwm, &sndHwmSize);
-#endif
-  }
-  catch (zmq::error_t &_e)
+  const uint64_t deadline = static_cast<uint64_t>(_deadline);
+  std::string frame(1 + sizeof(deadline) + sizeof(_budget), '\0');
+  for (std::size_t i = 0; i < sizeof(deadline); ++i)
+    frame[1 + i] = static_cast<char>((deadline >> (8 * i)) & 0xFF);
+  for (std::size_t i = 0; i < sizeof(_budget); ++i)
   {
-    return -1;
+    frame[1 + sizeof(deadline) + i] =
+      static_cast<char>((_budget >> (8 * i)) & 0xFF);
   }
-
-  return sndHwm;
+  return frame;
 }
 
-//////////////////////////////////////////////////
-bool NodeShared::HandlerWrapper::HasSubscriber(
-    const std::string &_fullyQualifiedTopic,
-    const std::string &_msgType) const
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::ParseDeadlineFrame(const std::string &_frame,
+    int64_t &_deadline, uint32_t &_budget)
 {
-  std::shared_ptr<ISubscriptionHandler> normalSubscriberPtr;
-  std::shared_ptr<RawSubscriptionHandler> rawSubscriberPtr;
+  uint64_t deadline = 0;
+  if (_frame.size() != 1 + sizeof(deadline) + sizeof(_budget) ||
+      _frame[0] != '\0')
+  {
+    return false;
+  }
 
-  return this->normal.FirstHandler(
-            _fullyQualifiedTopic, _msgType, normalSubscriberPtr)
-         || this->raw.FirstHandler(
-            _fullyQualifiedTopic, _msgType, rawSubscriberPtr);
+  for (std::size_t i = 0; i < sizeof(deadline); ++i)
+  {
+    deadline |= static_cast<uint64_t>(static_cast<uint8_t>(_frame[1 + i])) <<
+      (8 * i);
+  }
+  _deadline = static_cast<int64_t>(deadline);
+
+  _budget = 0;
+  for (std::size_t i = 0; i < sizeof(_budget); ++i)
+  {
+    _budget |= static_cast<uint32_t>(
+      static_cast<uint8_t>(_frame[1 + sizeof(deadline) + i])) << (8 * i);
+  }
+  return true;
 }
 
-//////////////////////////////////////////////////
-bool NodeShared::HandlerWrapper::HasSubscriber(
-    const std::string &_fullyQualifiedTopic) const
+/////////////////////////////////////////////////
+uint32_t NodeSharedPrivate::TopicId(const std::string &_topic,
+    const std::string &_msgType)
 {
-  return this->normal.HasHandlersForTopic(_fullyQualifiedTopic)
-      || this->raw.HasHandlersForTopic(_fullyQualifiedTopic);
+  const std::string key = TopicKey(_topic, _msgType);
+  auto it = this->topicIds.find(key);
+  if (it == this->topicIds.end())
+  {
+    it = this->topicIds.emplace(
+      key, static_cast<uint32_t>(this->topicIds.size())).first;
+  }
+  return it->second;
 }
 
-//////////////////////////////////////////////////
-template <typename HandlerT>
-static void AppendNodeUuids(const HandlerStorage<HandlerT> &_handlerStorage,
-                            const std::string &_fullyQualifiedTopic,
-                            const std::string &_msgTypeName,
-                            std::vector<std::string> &_uuids)
+/////////////////////////////////////////////////
+void NodeSharedPrivate::ConnectPeer(const std::string &_addr,
+  const std::string &_pUuid)
 {
-  using HandlerTPtr = std::shared_ptr<HandlerT>;
-  std::map<std::string, std::map<std::string, HandlerTPtr>> handlers;
+  const std::string endpoint =
+    this->PeerEndpoint(_addr, _pUuid, kIpcPublisherSocket);
 
-  _handlerStorage.Handlers(_fullyQualifiedTopic, handlers);
-  for (const auto &collection : handlers)
+  auto it = this->peerAddresses.find(_addr);
+  if (it != this->peerAddresses.end())
   {
-    for (const auto &collectionEntry : collection.second)
+    // A process restarted on the same address is reconnected by ZeroMQ,
+    // unless we were connected to the ipc:// endpoint of the old one.
+    it->second = _pUuid;
+    std::string &connected = this->peerEndpoints[_addr];
+    if (connected == endpoint)
+      return;
+
+    try
+    {
+      this->subscriber->disconnect(connected.c_str());
+    }
+    catch (const zmq::error_t &)
     {
-      const HandlerTPtr &handler = collectionEntry.second;
-      const std::string &handlerMsgType = handler->TypeName();
-      if (handlerMsgType == _msgTypeName
-          || handlerMsgType == kGenericMessageType)
-      {
-        _uuids.push_back(handler->NodeUuid());
-      }
     }
+    this->subscriber->connect(endpoint.c_str());
+    connected = endpoint;
+    return;
   }
+
+  this->subscriber->connect(endpoint.c_str());
+  this->peerAddresses[_addr] = _pUuid;
+  this->peerEndpoints[_addr] = endpoint;
 }
 
-//////////////////////////////////////////////////
-std::vector<std::string> NodeShared::HandlerWrapper::NodeUuids(
-    const std::string &_fullyQualifiedTopic,
-    const std::string &_msgTypeName) const
+/////////////////////////////////////////////////
+std::string NodeSharedPrivate::PeerEndpoint(const std::string &_addr,
+  const std::string &_pUuid, const std::string &_socket) const
 {
-  std::vector<std::string> uuids;
-  AppendNodeUuids(this->normal, _fullyQualifiedTopic, _msgTypeName, uuids);
-  AppendNodeUuids(this->raw, _fullyQualifiedTopic, _msgTypeName, uuids);
+  if (!this->ipcEnabled || _pUuid.empty())
+    return _addr;
 
-  return uuids;
+  // The socket only exists if the peer runs on this host.
+  const std::string endpoint = IpcEndpoint(_pUuid, _socket);
+  if (!IpcEndpointExists(endpoint))
+    return _addr;
+
+  return endpoint;
 }
 
-//////////////////////////////////////////////////
-bool NodeShared::HandlerWrapper::RemoveHandlersForNode(
-    const std::string &_fullyQualifiedTopic,
-    const std::string &_nUuid)
+/////////////////////////////////////////////////
+void NodeSharedPrivate::DisconnectPeer(const std::string &_pUuid)
 {
-  bool removed = false;
-  removed |= this->normal.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
-  removed |= this->raw.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
+  for (auto it = this->peerAddresses.begin();
+       it != this->peerAddresses.end();)
+  {
+    if (it->second != _pUuid)
+    {
+      ++it;
+      continue;
+    }
 
-  return removed;
+    auto endpoint = this->peerEndpoints.find(it->first);
+    const std::string connected = endpoint != this->peerEndpoints.end() ?
+      endpoint->second : it->first;
+    try
+    {
+      this->subscriber->disconnect(connected.c_str());
+    }
+    catch (const zmq::error_t &_error)
+    {
+      std::cerr << "Error disconnecting from [" << connected << "]: "
+                << _error.what() << std::endl;
+    }
+    if (endpoint != this->peerEndpoints.end())
+      this->peerEndpoints.erase(endpoint);
+    it = this->peerAddresses.erase(it);
+  }
 }
 
-
-//////////////////////////////////////////////////
-void NodeSharedPrivate::SecurityOnNewConnection()
+/////////////////////////////////////////////////
+void NodeSharedPrivate::AddTopicFilter(const std::string &_topic)
 {
-  std::string user, pass;
+  if (!this->topicFilters.insert(_topic).second)
+    return;
 
-  // Set username and pass if they exist
-  // \todo(anyone): This will cause the subscriber to connect only to secure
-  // connections. Would be nice if the subscriber could still connect to
-  // unsecure connections. This might require an unsecure and secure
-  // subscriber.
-  // See issue #74
-  if (userPass(user, pass))
-  {
 #ifdef IGN_CPPZMQ_POST_4_7_0
-    this->subscriber->set(zmq::sockopt::plain_username, user);
-    this->subscriber->set(zmq::sockopt::plain_password, pass);
+  this->subscriber->set(zmq::sockopt::subscribe, _topic);
 #else
-    this->subscriber->setsockopt(ZMQ_PLAIN_USERNAME, user.c_str(), user.size());
-    this->subscriber->setsockopt(ZMQ_PLAIN_PASSWORD, pass.c_str(), pass.size());
+  this->subscriber->setsockopt(ZMQ_SUBSCRIBE, _topic.data(), _topic.size());
 #endif
-  }
 }
 
-//////////////////////////////////////////////////
-void NodeSharedPrivate::SecurityInit()
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveTopicFilter(const std::string &_topic)
 {
-  // Check if a username and password has been set. If so, then
-  // setup a PLAIN authentication server.
-  std::string user, pass;
-  if (userPass(user, pass))
-  {
-    // Create the access control thread.
-    this->accessControlThread = std::thread(
-        &NodeSharedPrivate::AccessControlHandler, this);
-
-    int asPlainSecurityServer = static_cast<int>(
-        ZmqPlainSecurityServerOptions::ZMQ_PLAIN_SECURITY_SERVER_ENABLED);
+  if (this->topicFilters.erase(_topic) == 0)
+    return;
 
 #ifdef IGN_CPPZMQ_POST_4_7_0
-    this->publisher->set(zmq::sockopt::plain_server, asPlainSecurityServer);
-    this->publisher->set(zmq::sockopt::zap_domain, kIgnAuthDomain);
+  this->subscriber->set(zmq::sockopt::unsubscribe, _topic);
 #else
-    this->publisher->setsockopt(ZMQ_PLAIN_SERVER,
-        &asPlainSecurityServer, sizeof(asPlainSecurityServer));
-    this->publisher->setsockopt(ZMQ_ZAP_DOMAIN, kIgnAuthDomain,
-        std::strlen(kIgnAuthDomain));
+  this->subscriber->setsockopt(ZMQ_UNSUBSCRIBE, _topic.data(), _topic.size());
 #endif
-  }
 }
 
-//////////////////////////////////////////////////
-// Access control handler for plain security.
-// This function is designed to be run in a thread.
-void NodeSharedPrivate::AccessControlHandler()
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::MatchWildcards(const std::string &_topic,
+    const std::string &_msgType)
 {
-  zmq::socket_t *sock = new zmq::socket_t(*this->context, ZMQ_REP);
+  if (this->wildcards.Empty())
+    return false;
 
-  try
-  {
-    // Bind to the zap address
-    sock->bind("inproc://zeromq.zap.01");
+  std::vector<std::shared_ptr<WildcardSubscription>> matches;
+  this->wildcards.Match(_topic, matches);
 
-    // Get the username and password
-    std::string user, pass;
-    if (!userPass(user, pass))
+  bool subscribed = false;
+  for (const auto &wildcard : matches)
+  {
+    if (wildcard->msgType != kGenericMessageType &&
+        wildcard->msgType != _msgType)
     {
-      std::cerr << "Username and password not set. "
-                << "Authentication is disabled\n";
-      sock->close();
-      delete sock;
-      return;
+      continue;
     }
 
-    std::string sequence;
-    std::string domain;
-    std::string address;
-    std::string routingId;
-    std::string mechanism;
-    std::string givenUsername;
-    std::string givenPassword;
-    std::string version;
-
-    zmq::pollitem_t items[] =
-    {
-      {static_cast<void*>(*sock), 0, ZMQ_POLLIN, 0},
-    };
-
-    // Process
-    while (!this->exit)
-    {
-      try
-      {
-        zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
-            std::chrono::milliseconds(NodeSharedPrivate::Timeout));
-      }
-      catch(...)
-      {
-        continue;
-      }
-
-      if (items[0].revents & ZMQ_POLLIN)
-      {
-        // Get the version.
-        version = receiveHelper(*sock);
-        if (version.empty())
-          break;
-
-        // Get remaining data
-        sequence = receiveHelper(*sock);
-        domain = receiveHelper(*sock);
-        address = receiveHelper(*sock);
-        routingId = receiveHelper(*sock);
-        mechanism = receiveHelper(*sock);
-        givenUsername = receiveHelper(*sock);
-        givenPassword = receiveHelper(*sock);
-
-        // eliminate unused variable warning when debug statements are commented
-        (void)routingId;
-
-        // Debug statements
-        // std::cout << "Version[" << version << "]\n";
-        // std::cout << "Sequence[" << sequence << "]\n";
-        // std::cout << "Domain[" << domain << "]\n";
-        // std::cout << "Address[" << address << "]\n";
-        // std::cout << "Routing Id[" << routingId << "]\n";
-        // std::cout << "Mechanism[" << mechanism << "]\n";
-        // std::cout << "Username[" << givenUsername << "] [" << user << "]\n";
-        // std::cout << "Pass[" << givenPassword << "] [" << pass << "]\n";
-
-        // Check that we received some kind of address. This could be used
-        // in the future to only accept connections from specific addresses.
-        if (address.empty())
-        {
-          sendAuthErrorHelper(*sock, "Invalid address");
-          continue;
-        }
-
-        // Check the version
-        if (version != "1.0")
-        {
-          sendAuthErrorHelper(*sock, "Invalid version");
-          continue;
-        }
+    if (!wildcard->topics.insert(_topic).second)
+      continue;
 
-        // Check the mechanism
-        if (mechanism != "PLAIN")
-        {
-          sendAuthErrorHelper(*sock, "Invalid mechanism");
-          continue;
-        }
+    wildcard->subscribe(_topic);
+    subscribed = true;
+  }
 
-        // Check the domain
-        if (std::strcmp(domain.c_str(), kIgnAuthDomain) != 0)
-        {
-          sendAuthErrorHelper(*sock, "Invalid domain");
-          continue;
-        }
+  return subscribed;
+}
 
-#ifdef IGN_ZMQ_POST_4_3_1
-        sendHelper(*sock, version, zmq::send_flags::sndmore);
-        sendHelper(*sock, sequence, zmq::send_flags::sndmore);
-#else
-        sendHelper(*sock, version, ZMQ_SNDMORE);
-        sendHelper(*sock, sequence, ZMQ_SNDMORE);
-#endif
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveTopicAliases(
+    const std::function<bool(const TopicAliasInfo &)> &_remove)
+{
+  for (auto it = this->topicAliases.begin(); it != this->topicAliases.end();)
+  {
+    if (!_remove(it->second))
+    {
+      ++it;
+      continue;
+    }
 
-        // Check the username and password
-        if (givenUsername == user && givenPassword == pass)
-        {
-#ifdef IGN_ZMQ_POST_4_3_1
-          sendHelper(*sock, "200", zmq::send_flags::sndmore);
-          sendHelper(*sock, "OK", zmq::send_flags::sndmore);
-          sendHelper(*sock, "anonymous", zmq::send_flags::sndmore);
-          sendHelper(*sock, "", zmq::send_flags::none);
+    try
+    {
+#ifdef IGN_CPPZMQ_POST_4_7_0
+      this->subscriber->set(zmq::sockopt::unsubscribe, it->first);
 #else
-          sendHelper(*sock, "200", ZMQ_SNDMORE);
-          sendHelper(*sock, "OK", ZMQ_SNDMORE);
-          sendHelper(*sock, "anonymous", ZMQ_SNDMORE);
-          sendHelper(*sock, "", 0);
+      this->subscriber->setsockopt(ZMQ_UNSUBSCRIBE,
+        it->first.data(), it->first.size());
 #endif
-        }
-        else
-        {
-          sendAuthErrorHelper(*sock, "Invalid username or password");
-        }
-      }
     }
+    catch (const zmq::error_t &_error)
+    {
+      std::cerr << "Error unsubscribing from a topic alias: "
+                << _error.what() << std::endl;
+    }
+    it = this->topicAliases.erase(it);
   }
-  catch (...)
-  {
-    // This catch can be triggered when ctrl-c is pressed and the context is
-    // deleted. Capture this case, and quit gracefully.
-  }
+}
 
-  sock->close();
-  delete sock;
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::MulticastEndpoint(const std::string &_hostAddr,
+  const std::string &_group)
+{
+  return "epgm://" + _hostAddr + ";" + _group;
 }
 
-/////////////////////////////////////////////////
-void NodeSharedPrivate::PublishThread()
+//////////////////////////////////////////////////
+zmq::socket_t *NodeSharedPrivate::MulticastPublisher(const std::string &_group)
 {
-  // Loop until exits
-  while (!this->exit)
+  if (secured())
   {
-    std::unique_ptr<PublishMsgDetails> msgDetails = nullptr;
-    // Lock the mutex, and acquire the next message to be published.
-    {
-      std::unique_lock<std::mutex> queueLock(this->pubThreadMutex);
+    std::cerr << "Multicast group [" << _group << "] ignored: multicast "
+              << "messages can't be authenticated with IGN_TRANSPORT_USERNAME"
+              << " and IGN_TRANSPORT_PASSWORD or with the CURVE keys"
+              << std::endl;
+    return nullptr;
+  }
 
-      // Wait for more messages if the queue is empty. Otherwise get the
-      // next message and continue.
-      if (this->pubQueue.empty())
-      {
-        auto now = std::chrono::system_clock::now();
-        this->signalNewPub.wait_until(queueLock, now + 500ms,
-          [&]{return !this->pubQueue.empty() || this->exit;});
-      }
+  std::lock_guard<std::mutex> lock(this->publisherMutex);
+  auto &socket = this->multicastPublishers[_group];
+  if (socket)
+    return socket.get();
 
-      if (this->pubQueue.empty())
-        continue;
+  try
+  {
+    socket.reset(new zmq::socket_t(*this->context, ZMQ_PUB));
+    const int lingerVal = 0;
+    const int rate = this->NonNegativeEnvVar("IGN_TRANSPORT_MULTICAST_RATE",
+      kDefaultMulticastRate);
+    zmq_setsockopt(static_cast<void *>(*socket), ZMQ_LINGER, &lingerVal,
+      sizeof(lingerVal));
+    zmq_setsockopt(static_cast<void *>(*socket), ZMQ_RATE, &rate,
+      sizeof(rate));
+    socket->connect(MulticastEndpoint(this->owner->hostAddr, _group));
+  }
+  catch (const zmq::error_t &_error)
+  {
+    std::cerr << "Unable to send to multicast group [" << _group << "]: "
+              << _error.what() << ". Is ZeroMQ built with OpenPGM?"
+              << std::endl;
+    this->multicastPublishers.erase(_group);
+    return nullptr;
+  }
 
-      // Stop early on exit.
-      if (this->exit)
-        break;
+  return socket.get();
+}
 
-      // Get the message
-      msgDetails = std::move(this->pubQueue.front());
-      this->pubQueue.pop();
-    }
+//////////////////////////////////////////////////
+zmq::socket_t *NodeSharedPrivate::PriorityPublisher()
+{
+  std::lock_guard<std::mutex> lock(this->publisherMutex);
+  if (this->priorityPublisher)
+    return this->priorityPublisher.get();
 
-    // Send the message to all the local handlers.
-    for (auto &handler : msgDetails->localHandlers)
+  try
+  {
+    // Same settings as the publisher socket.
+    std::unique_ptr<zmq::socket_t> socket(
+      new zmq::socket_t(*this->context, ZMQ_PUB));
+    void *handle = static_cast<void *>(*socket);
+    const int lingerVal = 0;
+    const int sndQueueVal =
+      this->NonNegativeEnvVar("IGN_TRANSPORT_SNDHWM", kDefaultSndHwm);
+    zmq_setsockopt(handle, ZMQ_LINGER, &lingerVal, sizeof(lingerVal));
+    zmq_setsockopt(handle, ZMQ_SNDHWM, &sndQueueVal, sizeof(sndQueueVal));
+
+    if (!secureServerHelper(*socket))
     {
-      try
-      {
-        handler->RunLocalCallback(*(msgDetails->msgCopy.get()),
-            msgDetails->info);
-      }
-      catch (...)
-      {
-        std::cerr << "Exception occurred in a local callback "
-          << "on topic [" << msgDetails->info.Topic() << "] with message ["
-          << msgDetails->msgCopy->DebugString() << "]" << std::endl;
-      }
+      std::cerr << "Unable to secure the high priority publisher socket"
+                << std::endl;
+      return nullptr;
     }
 
-    // Send the message to all the raw handlers.
-    for (auto &handler : msgDetails->rawHandlers)
+#ifdef ZMQ_TOS
+    // The DSCP takes the upper 6 bits of the TOS byte.
+    const int dscp = this->NonNegativeEnvVar("IGN_TRANSPORT_PRIORITY_DSCP", 0);
+    if (dscp > 0)
     {
-      try
+      const int tos = (dscp & 0x3F) << 2;
+      if (zmq_setsockopt(handle, ZMQ_TOS, &tos, sizeof(tos)) != 0)
       {
-        handler->RunRawCallback(msgDetails->sharedBuffer.get(),
-            msgDetails->msgSize, msgDetails->info);
-      }
-      catch (...)
-      {
-        std::cerr << "Exception occured in a local raw callback "
-          << "on topic [" << msgDetails->info.Topic() << "] with "
-          << "message [" << msgDetails->msgCopy->DebugString() << "]"
-          << std::endl;
+        std::cerr << "Unable to apply IGN_TRANSPORT_PRIORITY_DSCP [" << dscp
+                  << "]: " << zmq_strerror(zmq_errno()) << std::endl;
       }
     }
+#endif
+
+    socket->bind("tcp://" + this->owner->hostAddr + ":*");
+    char endpoint[1024];
+    size_t size = sizeof(endpoint);
+    zmq_getsockopt(handle, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    this->priorityAddress = endpoint;
+    this->priorityPublisher = std::move(socket);
+  }
+  catch (const zmq::error_t &_error)
+  {
+    std::cerr << "Unable to create the high priority publisher socket: "
+              << _error.what() << std::endl;
+    return nullptr;
   }
-}
 
-//////////////////////////////////////////////////
-std::optional<transport::TopicStatistics> NodeShared::TopicStats(
-    const std::string &_topic) const
-{
-  if (this->dataPtr->topicStats.find(_topic) != this->dataPtr->topicStats.end())
-    return this->dataPtr->topicStats.at(_topic);
-  return std::nullopt;
+  return this->priorityPublisher.get();
 }
 
 //////////////////////////////////////////////////
-void NodeShared::EnableStats(const std::string &_topic, bool _enable,
-    std::function<void(const TopicStatistics &_stats)> _statCb)
+bool NodeSharedPrivate::JoinMulticastGroup(const std::string &_group)
 {
-  if (_enable)
+  if (this->multicastGroups.find(_group) != this->multicastGroups.end())
+    return true;
+
+  // Multicast messages aren't authenticated, so secure subscribers don't
+  // accept them.
+  if (secured())
+    return false;
+
+  try
   {
-    this->dataPtr->enabledTopicStatistics.insert({_topic, _statCb});
+    const int rate = this->NonNegativeEnvVar("IGN_TRANSPORT_MULTICAST_RATE",
+      kDefaultMulticastRate);
+    zmq_setsockopt(static_cast<void *>(*this->subscriber), ZMQ_RATE, &rate,
+      sizeof(rate));
+    this->subscriber->connect(
+      MulticastEndpoint(this->owner->hostAddr, _group));
   }
-  else
+  catch (const zmq::error_t &_error)
   {
-    this->dataPtr->enabledTopicStatistics.extract(_topic);
-    // \todo Also cleanup topicStats.
+    std::cerr << "Unable to join multicast group [" << _group << "]: "
+              << _error.what() << ". Receiving over TCP instead."
+              << std::endl;
+    return false;
   }
+
+  this->multicastGroups.insert(_group);
+  return true;
 }
 
 /////////////////////////////////////////////////
+zmq::context_t *NodeSharedPrivate::NewContext() const
+{
+  auto *newContext = new zmq::context_t(
+    std::max(1, this->NonNegativeEnvVar("IGN_TRANSPORT_IO_THREADS", 1)));
+  configureThreads(*newContext);
+  return newContext;
+}
+
+//////////////////////////////////////////////////
 int NodeSharedPrivate::NonNegativeEnvVar(const std::string &_envVar,
     int _defaultValue) const
 {
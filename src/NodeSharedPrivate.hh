@@ -26,16 +26,43 @@
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
-#include <queue>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "ignition/transport/Discovery.hh"
+#include "ignition/transport/MetricsRegistry.hh"
 #include "ignition/transport/Node.hh"
 
+#include "ByteBudget.hh"
+#include "CallbackExecutor.hh"
+#include "Capabilities.hh"
+#include "ConnectionMonitor.hh"
+#include "IpcEndpoint.hh"
+#include "MessageChunks.hh"
+#include "MpscRing.hh"
+#include "Reliability.hh"
+#include "ShmSegment.hh"
+#include "TopicAlias.hh"
+#include "TopicTrie.hh"
+#include "Tracing.hh"
+
 namespace ignition
 {
   namespace transport
@@ -44,41 +71,88 @@ namespace ignition
     inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
     //
     /// \brief Metadata for a publication. This is sent as part of the ZMQ
-    /// message for topic statistics.
+    /// message for topic statistics. Older versions only send and read the
+    /// first two fields, the size of the frame tells which ones are set.
     class PublicationMetadata
     {
-      /// \brief Publication timestamp.
+      /// \brief Publication time of the steady clock, in milliseconds.
       public: uint64_t stamp = 0;
 
       /// \brief Sequence number, used to detect dropped messages.
       public: uint64_t seq = 0;
+
+      /// \brief Publication time of the steady clock, in nanoseconds.
+      /// Comparable by the subscribers of the same host.
+      public: uint64_t stampNs = 0;
+
+      /// \brief Publication time of the system clock, in nanoseconds.
+      /// Used by the subscribers of other hosts.
+      public: uint64_t systemStampNs = 0;
+
+      /// \brief Correlation ID of the message in the traces. Only sent by
+      /// the publishers recording a trace.
+      public: uint64_t traceId = 0;
+
+      /// \brief ID of the message in the acknowledgements, only sent with
+      /// the messages published with PublishAcked().
+      public: uint64_t ackId = 0;
     };
 
+    /// \brief Size of the metadata frame sent by older versions.
+    static const std::size_t kShortPublicationMetadataSize =
+      2 * sizeof(uint64_t);
+
+    /// \brief Size of the metadata frame without the trace ID.
+    static const std::size_t kLongPublicationMetadataSize =
+      4 * sizeof(uint64_t);
+
+    /// \brief Size of the metadata frame with the trace ID.
+    static const std::size_t kTracedPublicationMetadataSize =
+      5 * sizeof(uint64_t);
+
+    /// \brief Default rate of the multicast sockets (kilobits per second).
+    /// The default of libzmq, 100 kbit/s, is too low for most topics.
+    static const int kDefaultMulticastRate = 100000;
+
+    /// \brief Time between the registration of a remote subscriber and the
+    /// sending of the latest message of a topic with transient local
+    /// durability.
+    static const std::chrono::milliseconds kLastValueDelay(100);
+
     //
     // Private data class for NodeShared.
     class NodeSharedPrivate
     {
       // Constructor
       public: NodeSharedPrivate() :
-                context(new zmq::context_t(1)),
+                context(this->NewContext()),
                 publisher(new zmq::socket_t(*context, ZMQ_PUB)),
                 subscriber(new zmq::socket_t(*context, ZMQ_SUB)),
                 requester(new zmq::socket_t(*context, ZMQ_ROUTER)),
                 responseReceiver(new zmq::socket_t(*context, ZMQ_ROUTER)),
-                replier(new zmq::socket_t(*context, ZMQ_ROUTER))
+                replier(new zmq::socket_t(*context, ZMQ_ROUTER)),
+                srvReplyNotifier(new zmq::socket_t(*context, ZMQ_PUSH)),
+                srvReplyWakeup(new zmq::socket_t(*context, ZMQ_PULL))
       {
       }
 
       /// \brief Initialize security
-      public: void SecurityInit();
+      /// \return False if the CURVE keys are set but invalid. The sockets
+      /// must not be started then.
+      public: bool SecurityInit();
 
       /// \brief Handle new secure connections
       public: void SecurityOnNewConnection();
 
-      /// \brief Access control handler for plain security.
+      /// \brief Access control handler for plain and CURVE security. It
+      /// dispatches the authentication requests to a pool of workers.
       /// This function is designed to be run in a thread.
       public: void AccessControlHandler();
 
+      /// \brief Authenticate the connections dispatched by the access
+      /// control handler. This function is designed to be run in a thread.
+      public: void AccessControlWorker();
+
       /// \brief Get and validate a non-negative environment variable.
       /// \param[in] _envVar The name of the environment variable to get.
       /// \param[in] _defaultValue The default value returned in case the
@@ -89,6 +163,54 @@ namespace ignition
       public: int NonNegativeEnvVar(const std::string &_envVar,
                                     int _defaultValue) const;
 
+      /// \brief Create the ZeroMQ context with the number of I/O threads
+      /// set in IGN_TRANSPORT_IO_THREADS, and apply the CPU affinity and
+      /// the priority of the transport threads to them.
+      /// \return The new context.
+      public: zmq::context_t *NewContext() const;
+
+      /// \brief Apply the socket options set through environment variables:
+      /// the kernel buffer sizes (IGN_TRANSPORT_SNDBUF and
+      /// IGN_TRANSPORT_RCVBUF), the I/O threads serving each kind of socket
+      /// (IGN_TRANSPORT_PUB_AFFINITY, IGN_TRANSPORT_SUB_AFFINITY and
+      /// IGN_TRANSPORT_SRV_AFFINITY) and, when libzmq supports them, the
+      /// batch sizes (IGN_TRANSPORT_OUT_BATCH_SIZE and
+      /// IGN_TRANSPORT_IN_BATCH_SIZE). It must be called before the sockets
+      /// bind or connect.
+      public: void TuneSockets();
+
+      /// \brief Get the ZeroMQ endpoint of a multicast group.
+      /// \param[in] _hostAddr IP address of the interface used.
+      /// \param[in] _group Multicast group and port.
+      /// \return The epgm endpoint.
+      public: static std::string MulticastEndpoint(
+        const std::string &_hostAddr, const std::string &_group);
+
+      /// \brief Get the socket publishing to a multicast group, creating it
+      /// if needed.
+      /// \param[in] _group Multicast group and port.
+      /// \return The socket, or nullptr if multicast is unavailable.
+      public: zmq::socket_t *MulticastPublisher(const std::string &_group);
+
+      /// \brief Get the socket publishing the high priority topics, creating
+      /// and binding it if needed. Must be called with NodeShared::mutex
+      /// locked.
+      /// \return The socket, or nullptr if it couldn't be bound.
+      public: zmq::socket_t *PriorityPublisher();
+
+      /// \brief Connect the subscriber socket to a multicast group, if it
+      /// isn't already. Must be called with NodeShared::mutex locked.
+      /// \param[in] _group Multicast group and port.
+      /// \return True if the subscriber socket joined the group.
+      public: bool JoinMulticastGroup(const std::string &_group);
+
+      /// \brief The NodeShared instance owning this data.
+      public: NodeShared *owner = nullptr;
+
+      /// \brief Transport domain of the instance, empty for the default
+      /// domain.
+      public: std::string domain;
+
       //////////////////////////////////////////////////
       ///////    Declare here the ZMQ Context    ///////
       //////////////////////////////////////////////////
@@ -104,6 +226,64 @@ namespace ignition
       /// \brief ZMQ socket to send topic updates.
       public: std::unique_ptr<zmq::socket_t> publisher;
 
+      /// \brief Protects the publisher socket and topicPubSeq. Publishing
+      /// only takes this mutex, so publications don't contend with the
+      /// reception thread, the discovery callbacks or the service calls.
+      public: std::mutex publisherMutex;
+
+      /// \brief ZMQ socket to send the high priority topics, once one is
+      /// advertised. Protected by publisherMutex.
+      public: std::unique_ptr<zmq::socket_t> priorityPublisher;
+
+      /// \brief Address of priorityPublisher. Written with both
+      /// NodeShared::mutex and publisherMutex locked, so either is enough to
+      /// read it.
+      public: std::string priorityAddress;
+
+      /// \brief A message sent in chunks, released when ZeroMQ is done with
+      /// all of them.
+      public: struct ChunkedMsg
+              {
+                /// \brief Destructor. Releases the message.
+                public: ~ChunkedMsg()
+                {
+                  if (this->ffn)
+                    this->ffn(this->data, this->hint);
+                }
+
+                /// \brief The compressed message, if it was compressed.
+                public: std::unique_ptr<std::string> compressed;
+
+                /// \brief The message, if it wasn't compressed.
+                public: char *data = nullptr;
+
+                /// \brief Function releasing data.
+                public: DeallocFunc *ffn = nullptr;
+
+                /// \brief Argument of ffn.
+                public: void *hint = nullptr;
+              };
+
+      /// \brief ID of the next message sent in chunks.
+      public: std::atomic<uint64_t> nextChunkedMsgId{0};
+
+      /// \brief Size of the chunks of the large messages, 0 to send them
+      /// whole. See IGN_TRANSPORT_CHUNK_SIZE.
+      public: std::size_t chunkSize = kDefaultChunkSize;
+
+      /// \brief Reassembles the chunked messages received. Protected by
+      /// NodeShared::mutex.
+      public: ChunkAssembler chunks;
+
+      /// \brief ZMQ sockets sending to each multicast group. Protected by
+      /// publisherMutex.
+      public: std::map<std::string, std::unique_ptr<zmq::socket_t>>
+        multicastPublishers;
+
+      /// \brief Multicast groups joined by the subscriber socket. Protected
+      /// by NodeShared::mutex.
+      public: std::set<std::string> multicastGroups;
+
       /// \brief ZMQ socket to receive topic updates.
       public: std::unique_ptr<zmq::socket_t> subscriber;
 
@@ -116,6 +296,15 @@ namespace ignition
       /// \brief ZMQ socket to receive service call requests.
       public: std::unique_ptr<zmq::socket_t> replier;
 
+      /// \brief ZMQ socket used by the service worker threads to wake up the
+      /// thread receiving the service requests when a reply is queued.
+      /// Protected by srvRepliesMutex.
+      public: std::unique_ptr<zmq::socket_t> srvReplyNotifier;
+
+      /// \brief ZMQ socket polled along with the replier to send the replies
+      /// queued by the service worker threads.
+      public: std::unique_ptr<zmq::socket_t> srvReplyWakeup;
+
       /// \brief Thread the handle access control
       public: std::thread accessControlThread;
 
@@ -126,9 +315,87 @@ namespace ignition
       /// \brief Discovery service (messages).
       public: std::unique_ptr<MsgDiscovery> msgDiscovery;
 
-      /// \brief Discovery service (services).
+      /// \brief Discovery service (services). Null until the services are
+      /// initialized, see NodeShared::EnsureServices(). Created while
+      /// holding NodeShared::mutex.
       public: std::unique_ptr<SrvDiscovery> srvDiscovery;
 
+      /// \brief Settings of the service discovery, applied once it's
+      /// created.
+      public: struct SrvDiscoverySettings
+              {
+                /// \brief Heartbeat interval (ms), zero for the default.
+                public: unsigned int heartbeat = 0;
+
+                /// \brief Silence interval (ms), zero for the default.
+                public: unsigned int silence = 0;
+
+                /// \brief Activity interval (ms), zero for the default.
+                public: unsigned int activity = 0;
+
+                /// \brief Network interfaces, empty for the default.
+                public: std::vector<std::string> interfaces;
+
+                /// \brief Partitions kept by the partition filter.
+                public: std::set<std::string> partitions;
+
+                /// \brief Whether the heartbeats back off.
+                public: bool adaptiveHeartbeat = false;
+
+                /// \brief Whether the advertisements are filtered by
+                /// partition.
+                public: bool partitionFilter = false;
+
+                /// \brief Path of the discovery cache, empty for none.
+                public: std::string cachePath;
+              };
+
+      /// \brief Settings of the service discovery. Protected by
+      /// NodeShared::mutex.
+      public: SrvDiscoverySettings srvDiscoverySettings;
+
+      /// \brief Prefix of the service answering the pings of the other
+      /// processes, followed by the process UUID.
+      public: inline static const std::string kPingServicePrefix =
+        "/_ign_transport/ping/";
+
+      /// \brief Advertise the ping service of this process in a partition.
+      /// Must be called with NodeShared::mutex locked once the service
+      /// discovery exists.
+      /// \param[in] _partition The partition.
+      public: void AdvertisePing(const std::string &_partition);
+
+      /// \brief Handler of the ping service, shared by the partitions.
+      /// Protected by NodeShared::mutex.
+      public: std::shared_ptr<RawRepHandler> pingHandler;
+
+      /// \brief Partitions where the ping service is advertised. Protected
+      /// by NodeShared::mutex.
+      public: std::set<std::string> pingPartitions;
+
+      /// \brief Whether the services are initialized with the first node,
+      /// so the process answers the pings even if it doesn't use services.
+      /// Set with the IGN_TRANSPORT_PING environment variable.
+      public: bool eagerPing = false;
+
+      /// \brief Services kept resolved with Node::PrefetchServices() and
+      /// the UUIDs of the nodes that asked for them. Protected by
+      /// NodeShared::mutex.
+      public: std::map<std::string, std::set<std::string>> resolvedServices;
+
+      /// \brief Add a partition to the ones kept by the discoveries when
+      /// they filter the advertisements by partition.
+      /// \param[in] _partition The partition.
+      public: void AddDiscoveryPartition(const std::string &_partition);
+
+      /// \brief True once NodeShared::EnsureServices() has tried to
+      /// initialize the services.
+      public: std::atomic<bool> servicesInitialized{false};
+
+      /// \brief True if the services were initialized successfully. Set
+      /// before servicesInitialized.
+      public: bool servicesAvailable = false;
+
       //////////////////////////////////////////////////
       /////// Other private member variables     ///////
       //////////////////////////////////////////////////
@@ -145,10 +412,10 @@ namespace ignition
       ////////////////////////////////////////////////////////////////
 
       /// \brief Encapsulates information needed to publish a message. An
-      /// instance of this class is pushed onto a publish queue, pubQueue, when
-      /// a message is published through Node::Publisher::Publish.
-      /// The pubThread processes the pubQueue in the
-      /// NodeSharedPrivate::PublishThread function.
+      /// instance of this class is pushed onto one of the publish queues,
+      /// pubQueues, when a message is published through
+      /// Node::Publisher::Publish. Each one of the pubThreads processes its
+      /// queue in the NodeSharedPrivate::PublishThread function.
       ///
       /// A producer-consumer mechanism is used to send messages so that
       /// Node::Publisher::Publish function does not block while executing
@@ -161,11 +428,19 @@ namespace ignition
                 /// \brief All the raw handlers.
                 public: std::vector<RawSubscriptionHandlerPtr> rawHandlers;
 
-                /// \brief Buffer for the raw handlers.
-                public: std::unique_ptr<char[]> sharedBuffer = nullptr;
+                /// \brief Serialized message shared with the raw handlers
+                /// and, when there are remote subscribers, with ZeroMQ.
+                public: std::shared_ptr<char> sharedBuffer = nullptr;
 
-                /// \brief Msg copy for the local handlers.
-                public: std::unique_ptr<ProtoMsg> msgCopy = nullptr;
+                /// \brief Msg for the local handlers, either a copy or the
+                /// message given up by the publisher. The handlers may keep
+                /// a reference, it's never modified.
+                public: std::shared_ptr<const ProtoMsg> msgCopy = nullptr;
+
+                /// \brief Empty message parsed from sharedBuffer by the
+                /// publish thread, which then becomes msgCopy. Null when
+                /// msgCopy is ready.
+                public: std::shared_ptr<ProtoMsg> msgToParse = nullptr;
 
                 /// \brief Message size.
                 // cppcheck-suppress unusedStructMember
@@ -173,38 +448,1523 @@ namespace ignition
 
                 /// \brief Information about the topic and type.
                 public: MessageInfo info;
+
+#ifdef IGN_TRANSPORT_TRACING
+                /// \brief Correlation ID of the message in the traces.
+                public: uint64_t traceId = 0;
+#endif
+
+                /// \brief ID of the message in pendingAcks, 0 if the message
+                /// isn't acknowledged.
+                public: uint64_t ackId = 0;
+
+                /// \brief Local delivery of the message, recorded once the
+                /// last copy is released, i.e. once the callbacks holding it
+                /// ran. Set by the publish thread if ackId isn't 0.
+                public: std::shared_ptr<void> ack;
+              };
+
+      /// \brief Publish threads, each one processes one of the pubQueues.
+      /// Set the number of threads with the
+      /// IGN_TRANSPORT_LOCAL_PUBLISH_THREADS environment variable.
+      public: std::vector<std::thread> pubThreads;
+
+      /// \brief Number of preallocated slots of each one of the pubQueues.
+      public: static const std::size_t kPubQueueCapacity = 1024;
+
+      /// \brief Queues onto which new messages are pushed, one per
+      /// pubThread. The pubThreads will pop off the messages and send them
+      /// to local subscribers. Publishers don't contend on a lock, and the
+      /// pubThreads sleep until a message is pushed. The vector is not
+      /// modified after the constructor of NodeShared.
+      public: std::vector<std::unique_ptr<MpscRing<PublishMsgDetails>>>
+        pubQueues;
+
+      /// \brief Get the publish queue of a topic. All the messages of a
+      /// topic go to the same queue, so they are delivered in order, while
+      /// the messages of other topics can be delivered in parallel.
+      /// \param[in] _topic Topic name.
+      /// \return The queue.
+      public: MpscRing<PublishMsgDetails> &PubQueue(const std::string &_topic);
+
+      /// \brief Handles local publication of messages on a pubQueue.
+      /// \param[in] _queue The queue.
+      public: void PublishThread(MpscRing<PublishMsgDetails> &_queue);
+
+      /// \brief Move the handlers of the nodes that spin their callbacks
+      /// out of a local message and queue the message to their executors.
+      /// \param[in,out] _msgDetails The message, its handlers with an
+      /// executor are removed.
+      public: void PostSpinHandlers(PublishMsgDetails &_msgDetails);
+
+      /// \brief Receive from a single socket until exit.
+      /// \param[in] _socket The socket.
+      /// \param[in] _recv Function receiving a message from the socket.
+      /// \param[in] _spin Whether the socket is busy polled, see busyPoll.
+      public: void PollSocket(zmq::socket_t &_socket,
+                              const std::function<void()> &_recv,
+                              const bool _spin = false);
+
+      /// \brief A socket and the function receiving its messages.
+      public: using SocketReceiver =
+                std::pair<zmq::socket_t *, std::function<void()>>;
+
+      /// \brief Receive from several sockets until exit.
+      /// \param[in] _sockets The sockets and their receiving functions.
+      /// \param[in] _spin Whether the sockets are busy polled, see busyPoll.
+      public: void PollSockets(const std::vector<SocketReceiver> &_sockets,
+                               const bool _spin = false);
+
+      /// \brief Poll sockets once.
+      /// \param[in] _items The sockets.
+      /// \param[in] _count Number of sockets.
+      /// \param[in] _spin Whether the sockets are busy polled, in which case
+      /// it returns at once.
+      /// \return The number of sockets ready, 0 on timeout or error.
+      public: int Poll(zmq::pollitem_t *_items, const std::size_t _count,
+                       const bool _spin) const;
+
+      /// \brief Index of the thread receiving the messages, in busyPoll.
+      public: static constexpr std::size_t kMessagesThread = 0;
+
+      /// \brief Index of the thread receiving the service requests, in
+      /// busyPoll.
+      public: static constexpr std::size_t kRequestsThread = 1;
+
+      /// \brief Index of the thread receiving the service responses, in
+      /// busyPoll.
+      public: static constexpr std::size_t kResponsesThread = 2;
+
+      /// \brief Whether a reception thread busy polls its sockets. A single
+      /// thread receives every socket unless splitReception is true, it
+      /// spins if any of them is busy polled.
+      /// \param[in] _thread kMessagesThread, kRequestsThread or
+      /// kResponsesThread.
+      /// \return True if the thread spins.
+      public: bool BusyPolls(const std::size_t _thread) const;
+
+      /// \brief Pin a reception thread that busy polls its sockets to its
+      /// CPU of busyPollCpus. The spinning threads take the CPUs in order.
+      /// \param[in] _thread The thread.
+      /// \param[in] _index kMessagesThread, kRequestsThread or
+      /// kResponsesThread.
+      /// \param[in] _name Name of the thread.
+      public: void PinBusyPoll(std::thread &_thread, const std::size_t _index,
+                               const std::string &_name) const;
+
+      /// \brief The sockets received by polling them without waiting, by
+      /// thread index, instead of blocking in zmq::poll(). It trades a core
+      /// for the wakeup latency of the reception thread. Set with the
+      /// IGN_TRANSPORT_BUSY_POLL environment variable.
+      public: std::bitset<3> busyPoll;
+
+      /// \brief Whether the spinning threads run a pause instruction
+      /// between polls. Set with IGN_TRANSPORT_BUSY_POLL_PAUSE.
+      public: bool busyPollPause = false;
+
+      /// \brief CPUs the spinning threads are pinned to, empty to keep the
+      /// affinity of the transport threads. Set with
+      /// IGN_TRANSPORT_BUSY_POLL_CPUS.
+      public: std::vector<int> busyPollCpus;
+
+      /// \brief True if the messages, the service requests and the service
+      /// responses are received on separate threads. Set with the
+      /// IGN_TRANSPORT_SPLIT_RECEPTION environment variable.
+      public: bool splitReception = false;
+
+      /// \brief Thread receiving the service requests when splitReception
+      /// is true.
+      public: std::thread srvRequestThread;
+
+      /// \brief Thread receiving the service responses when splitReception
+      /// is true.
+      public: std::thread srvResponseThread;
+
+      ////////////////////////////////////////////////////////////////
+      /////// The following is for conflated subscriptions.      ///////
+      ////////////////////////////////////////////////////////////////
+
+      /// \brief A serialized message received from another process. The
+      /// data points into the ZeroMQ frame it was received in, or into the
+      /// buffer holding the decoded message, and keeps that buffer alive.
+      public: struct ReceivedMsg
+              {
+                /// \brief Beginning of the serialized message.
+                public: std::shared_ptr<char> data;
+
+                /// \brief Size of the serialized message.
+                public: std::size_t size = 0;
+
+                /// \brief Acknowledgement of the message, sent once the last
+                /// copy is released, i.e. once the callbacks holding it ran
+                /// or dropped it. Null if the message isn't acknowledged.
+                public: std::shared_ptr<void> ack;
+              };
+
+      /// \brief Latest message received for a conflated subscription.
+      public: struct ConflatedMsg
+              {
+                /// \brief The handler, if it's a local handler.
+                public: ISubscriptionHandlerPtr localHandler;
+
+                /// \brief The handler, if it's a raw handler.
+                public: RawSubscriptionHandlerPtr rawHandler;
+
+                /// \brief Serialized message.
+                public: ReceivedMsg data;
+
+                /// \brief Information about the topic and type.
+                public: MessageInfo info;
+              };
+
+      /// \brief Move the conflated handlers out of a HandlerInfo. The
+      /// message replaces any message still pending for those handlers and
+      /// the conflation thread runs their callbacks.
+      /// \param[in] _info Information about the message.
+      /// \param[in] _msgData Serialized message.
+      /// \param[in,out] _handlerInfo The handlers of the topic. The conflated
+      /// handlers are removed.
+      public: void ConflateHandlers(const MessageInfo &_info,
+                                    const ReceivedMsg &_msgData,
+                                    NodeShared::HandlerInfo &_handlerInfo);
+
+      /// \brief Runs the callbacks of the conflated subscriptions.
+      public: void ConflateThread();
+
+      /// \brief Conflation thread. Started on first use.
+      public: std::thread conflateThread;
+
+      /// \brief Protects conflateThread and conflatedMsgs.
+      public: std::mutex conflateMutex;
+
+      /// \brief Pending messages of the conflated subscriptions. The key is
+      /// the handler UUID, so each handler has a single slot.
+      public: std::map<std::string, ConflatedMsg> conflatedMsgs;
+
+      /// \brief Signaled when a message is stored in conflatedMsgs.
+      public: std::condition_variable signalConflated;
+
+      ////////////////////////////////////////////////////////////////
+      /////// The following is for batched subscriptions.        ///////
+      ////////////////////////////////////////////////////////////////
+
+      /// \brief Messages received for a batched subscription that its
+      /// callback didn't receive yet.
+      public: struct BatchedMsgs
+              {
+                /// \brief The handler.
+                public: ISubscriptionHandlerPtr handler;
+
+                /// \brief Serialized messages, oldest first.
+                public: std::vector<ReceivedMsg> data;
+
+                /// \brief Information about each message.
+                public: std::vector<MessageInfo> infos;
+              };
+
+      /// \brief Move the batched handlers out of a HandlerInfo. The
+      /// messages are appended to the messages pending for those handlers
+      /// and the batch thread runs their callbacks.
+      /// \param[in] _info Information about the messages.
+      /// \param[in] _msgs Serialized messages.
+      /// \param[in,out] _handlerInfo The handlers of the topic. The batched
+      /// handlers are removed.
+      public: void BatchHandlers(const MessageInfo &_info,
+                                 const std::vector<ReceivedMsg> &_msgs,
+                                 NodeShared::HandlerInfo &_handlerInfo);
+
+      /// \brief Runs the callbacks of the batched subscriptions, each with
+      /// all the messages pending for it.
+      public: void BatchThread();
+
+      /// \brief Batch thread. Started on first use.
+      public: std::thread batchThread;
+
+      /// \brief Protects batchThread and batchedMsgs.
+      public: std::mutex batchMutex;
+
+      /// \brief Pending messages of the batched subscriptions. The key is
+      /// the handler UUID.
+      public: std::map<std::string, BatchedMsgs> batchedMsgs;
+
+      /// \brief Signaled when a message is stored in batchedMsgs.
+      public: std::condition_variable signalBatched;
+
+      ////////////////////////////////////////////////////////////////
+      /////// The following is for the transient local topics.   ///////
+      ////////////////////////////////////////////////////////////////
+
+      /// \brief Latest message of a topic with transient local durability.
+      public: struct LastValue
+              {
+                /// \brief Serialized message.
+                public: std::shared_ptr<char> data;
+
+                /// \brief Size of the serialized message.
+                public: std::size_t size = 0;
+
+                /// \brief Message type.
+                public: std::string msgType;
+              };
+
+      /// \brief Latest message of a subscriber process waiting to be sent.
+      public: struct LastValueDelivery
+              {
+                /// \brief Fully qualified topic name.
+                public: std::string topic;
+
+                /// \brief Process UUID of the subscriber.
+                public: std::string pUuid;
+
+                /// \brief Time from which the message is sent.
+                public: std::chrono::steady_clock::time_point due;
+              };
+
+      /// \brief Retain the latest message of a topic with transient local
+      /// durability.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _value The message.
+      public: void RetainLastValue(const std::string &_topic,
+                                   LastValue _value);
+
+      /// \brief Forget the latest message of a topic that is no longer
+      /// advertised.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void ForgetLastValue(const std::string &_topic);
+
+      /// \brief Send the latest message of a topic to a new remote
+      /// subscriber, if the topic has transient local durability. It's sent
+      /// after kLastValueDelay, so the subscriber's filters have reached the
+      /// publisher socket.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _msgType Message type of the subscriber.
+      /// \param[in] _pUuid Process UUID of the subscriber.
+      public: void ScheduleLastValue(const std::string &_topic,
+                                     const std::string &_msgType,
+                                     const std::string &_pUuid);
+
+      /// \brief Queue the latest message of a topic for a new local
+      /// subscription, if the topic has transient local durability. The
+      /// publish thread of the topic runs the callback.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _handler The new local handler, or nullptr.
+      /// \param[in] _rawHandler The new raw handler, or nullptr.
+      public: void QueueLastValue(const std::string &_topic,
+                                  const ISubscriptionHandlerPtr &_handler,
+                                  const RawSubscriptionHandlerPtr &_rawHandler);
+
+      /// \brief Sends the latest messages scheduled.
+      public: void LastValueThread();
+
+      /// \brief Send the latest message of a topic to a subscriber process.
+      /// \param[in] _delivery The topic and the process.
+      public: void SendLastValue(const LastValueDelivery &_delivery);
+
+      /// \brief Thread sending the latest messages. Started on first use.
+      public: std::thread lastValueThread;
+
+      /// \brief Protects lastValueThread, lastValues and lastValueDeliveries.
+      public: std::mutex lastValueMutex;
+
+      /// \brief Latest message of the topics with transient local
+      /// durability, by topic.
+      public: std::map<std::string, LastValue> lastValues;
+
+      /// \brief Latest messages waiting to be sent, in due order.
+      public: std::deque<LastValueDelivery> lastValueDeliveries;
+
+      /// \brief Signaled when a delivery is scheduled.
+      public: std::condition_variable signalLastValue;
+
+      ////////////////////////////////////////////////////////////////
+      /////// The following is for the callback executors.       ///////
+      ////////////////////////////////////////////////////////////////
+
+      /// \brief Executor of a subscription with a dedicated thread or a
+      /// queue.
+      public: struct HandlerExecutor
+              {
+                /// \brief The subscription handler.
+                public: std::weak_ptr<SubscriptionHandlerBase> handler;
+
+                /// \brief The executor.
+                public: std::shared_ptr<CallbackExecutor> executor;
+              };
+
+      /// \brief Get the executor that runs the callbacks of a handler.
+      /// Creates the executor of a subscription with a dedicated thread or a
+      /// queue. Must be called while holding executorsMutex.
+      /// \param[in] _handler The handler.
+      /// \return The executor or nullptr if the callbacks run on the
+      /// reception thread.
+      public: std::shared_ptr<CallbackExecutor> Executor(
+                const std::shared_ptr<SubscriptionHandlerBase> &_handler);
+
+      /// \brief Move the handlers that have an executor out of a
+      /// HandlerInfo and post their callbacks to the executors.
+      /// \param[in] _info Information about the messages.
+      /// \param[in] _msgs Serialized messages.
+      /// \param[in,out] _handlerInfo The handlers of the topic. The handlers
+      /// with an executor are removed.
+      /// \return Number of messages dropped by the subscription queues.
+      public: uint64_t DispatchHandlers(const MessageInfo &_info,
+                                    const std::vector<ReceivedMsg> &_msgs,
+                                    NodeShared::HandlerInfo &_handlerInfo);
+
+      /// \brief Remove executors. Returns them so they can be destroyed
+      /// without holding any lock, as destroying an executor waits for its
+      /// running callbacks.
+      /// \param[in] _uuids Node or handler UUIDs.
+      /// \return The removed executors.
+      public: std::vector<std::shared_ptr<CallbackExecutor>> RemoveExecutors(
+                const std::vector<std::string> &_uuids);
+
+      /// \brief Executor of a service whose requests run concurrently.
+      public: struct RepHandlerExecutor
+              {
+                /// \brief The replier handler.
+                public: std::weak_ptr<IRepHandler> handler;
+
+                /// \brief The executor.
+                public: std::shared_ptr<CallbackExecutor> executor;
+              };
+
+      /// \brief Get the executor that runs the requests of a service with a
+      /// maximum concurrency. Must be called while holding executorsMutex.
+      /// \param[in] _handler The replier handler.
+      /// \return The executor or nullptr if the requests run on the
+      /// reception thread.
+      public: std::shared_ptr<CallbackExecutor> ReplierExecutor(
+                const IRepHandlerPtr &_handler);
+
+      /// \brief Protects nodeExecutors, handlerExecutors,
+      /// repHandlerExecutors and lastSrvTask.
+      public: std::mutex executorsMutex;
+
+      /// \brief Executors of the nodes with callback threads, or whose
+      /// callbacks are run by the application. The key is the node UUID.
+      public: std::map<std::string, std::shared_ptr<CallbackExecutor>>
+                nodeExecutors;
+
+      /// \brief Number of nodes whose callbacks are run by the
+      /// application, so the local messages only look for their executors
+      /// when there are some.
+      public: std::atomic<std::size_t> spinNodes{0};
+
+      /// \brief Executors of the subscriptions with dedicated threads or
+      /// queues. The key is the handler UUID.
+      public: std::map<std::string, HandlerExecutor> handlerExecutors;
+
+      /// \brief Bytes of the received messages waiting in all the callback
+      /// executors, bounded by IGN_TRANSPORT_RCVQUEUE_BYTES. Null if
+      /// unbounded.
+      public: std::shared_ptr<ByteBudget> recvBudget;
+
+      /// \brief Bytes of the messages waiting in all the asynchronous
+      /// publish queues, bounded by IGN_TRANSPORT_SNDQUEUE_BYTES. Null if
+      /// unbounded.
+      public: std::shared_ptr<ByteBudget> sendBudget;
+
+      /// \brief Executors of the services with a maximum concurrency. The
+      /// key is the handler UUID.
+      public: std::map<std::string, RepHandlerExecutor> repHandlerExecutors;
+
+      /// \brief Number of service requests posted to the executors. Each
+      /// request gets its own strand, so the requests of a service run in
+      /// parallel up to its maximum concurrency.
+      public: uint64_t lastSrvTask = 0;
+
+      ////////////////////////////////////////////////////////////////
+      /////// The following is for the asynchronous replies.      ///////
+      ////////////////////////////////////////////////////////////////
+
+      /// \brief Reply to a service request from another process.
+      public: struct SrvReply
+              {
+                /// \brief Address of the requester.
+                public: std::string sender;
+
+                /// \brief Identity of the requester's response receiver.
+                public: std::string dstId;
+
+                /// \brief Service name.
+                public: std::string topic;
+
+                /// \brief Requester node UUID.
+                public: std::string nodeUuid;
+
+                /// \brief Request UUID.
+                public: std::string reqUuid;
+
+                /// \brief Serialized response.
+                public: std::string rep;
+
+                /// \brief "1" if the service call succeeded, "0" otherwise,
+                /// kSrvChunkResult for a chunk of a streaming response,
+                /// kSrvBusyResult for a rejected request.
+                public: std::string resultStr;
+              };
+
+      /// \brief Send a reply through the replier. Must be called from the
+      /// thread receiving the service requests.
+      /// \param[in] _reply The reply.
+      /// \return False if the reply couldn't be sent.
+      public: bool SendSrvReply(const SrvReply &_reply);
+
+      /// \brief Queue a reply and wake up the thread receiving the service
+      /// requests. Called from the service worker threads.
+      /// \param[in] _reply The reply.
+      public: void QueueSrvReply(SrvReply &&_reply);
+
+      /// \brief Send the replies queued by the service worker threads. Must
+      /// be called from the thread receiving the service requests.
+      public: void SendQueuedSrvReplies();
+
+      /// \brief Protects srvReplies and srvReplyNotifier.
+      public: std::mutex srvRepliesMutex;
+
+      /// \brief Replies waiting to be sent.
+      public: std::vector<SrvReply> srvReplies;
+
+      ////////////////////////////////////////////////////////////////
+      /////// The following is for the transport metrics.       ///////
+      ////////////////////////////////////////////////////////////////
+
+      /// \brief Counters of a topic, in MetricsRegistry::Instance(). They
+      /// live as long as the process.
+      public: struct TopicMetrics
+              {
+                /// \brief Messages sent to the remote subscribers.
+                public: MetricCounter *sentMsgs = nullptr;
+
+                /// \brief Bytes of the messages sent to the remote
+                /// subscribers, before compression.
+                public: MetricCounter *sentBytes = nullptr;
+
+                /// \brief Messages received from the remote publishers.
+                public: MetricCounter *receivedMsgs = nullptr;
+
+                /// \brief Bytes of the messages received from the remote
+                /// publishers, after decompression.
+                public: MetricCounter *receivedBytes = nullptr;
+
+                /// \brief Messages received discarded by the full queue
+                /// of a subscription.
+                public: MetricCounter *queueDroppedMsgs = nullptr;
+              };
+
+      /// \brief Get the counters of a topic, created on first use. Takes
+      /// the mutex of the registry, call it when the topic is new to a
+      /// cache rather than for every message.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return The counters.
+      public: static TopicMetrics MetricsOf(const std::string &_topic);
+
+      /// \brief Names of the gauges registered by RegisterGauges().
+      public: static constexpr const char *kGaugeNames[] =
+              {
+                "ign_transport_local_publish_queue_depth",
+                "ign_transport_local_publish_queue_high_water_mark",
+                "ign_transport_local_publish_queue_dropped_messages",
+                "ign_transport_service_requests_in_flight"
+              };
+
+      /// \brief Register the gauges sampled from the shared node when the
+      /// metrics are exported.
+      /// \param[in] _shared The shared node.
+      public: void RegisterGauges(NodeShared &_shared);
+
+      /// \brief Messages received discarded before reaching the
+      /// subscriptions, because of an unknown alias or an invalid payload.
+      public: MetricCounter &discardedMsgs = MetricsRegistry::Instance().
+                Counter("ign_transport_messages_discarded",
+                  "Messages received discarded before reaching the "
+                  "subscriptions");
+
+      /// \brief Messages delivered by the local publish threads.
+      public: MetricCounter &localMsgs = MetricsRegistry::Instance().
+                Counter("ign_transport_local_messages_delivered",
+                  "Messages delivered to the subscriptions of this process "
+                  "by the local publish threads");
+
+      /// \brief Callback triggered with the metrics, null if the
+      /// publication of the metrics is disabled. Protected by
+      /// metricsCbMutex.
+      public: std::function<void(const MetricsRegistry &)> metricsCb;
+
+      /// \brief Time between two calls of metricsCb. Protected by
+      /// metricsMutex.
+      public: std::chrono::steady_clock::duration metricsPeriod{
+                std::chrono::seconds(1)};
+
+      /// \brief Triggers metricsCb periodically.
+      public: void MetricsThread();
+
+      /// \brief Metrics thread. Started when the publication of the
+      /// metrics is first enabled.
+      public: std::thread metricsThread;
+
+      /// \brief Protects metricsThread and metricsPeriod.
+      public: std::mutex metricsMutex;
+
+      /// \brief Held while the metrics thread runs metricsCb.
+      public: std::mutex metricsCbMutex;
+
+      /// \brief Signaled when metricsPeriod changes or on exit.
+      public: std::condition_variable signalMetrics;
+
+      /// \brief Monitors of the connections of the publisher and the
+      /// subscriber sockets. Null unless the
+      /// IGN_TRANSPORT_CONNECTION_STATISTICS environment variable is 1.
+      public: std::unique_ptr<ConnectionMonitor> publisherMonitor;
+
+      /// \brief See publisherMonitor.
+      public: std::unique_ptr<ConnectionMonitor> subscriberMonitor;
+
+      /// \brief Start monitoring the connections of the publisher and the
+      /// subscriber sockets. Must be called before the sockets are used by
+      /// other threads.
+      /// \param[in] _id Identifier of the shared node, unique in the
+      /// process.
+      /// \param[in] _metrics Whether the connections are exported as
+      /// metrics.
+      public: void StartConnectionMonitors(const std::string &_id,
+                                           const bool _metrics);
+
+      /// \brief Receives the events of the socket monitors until exit.
+      /// \param[in] _pubEndpoint Endpoint of the monitor of the publisher.
+      /// \param[in] _subEndpoint Endpoint of the monitor of the subscriber.
+      public: void ConnectionMonitorThread(const std::string &_pubEndpoint,
+                                           const std::string &_subEndpoint);
+
+      /// \brief Thread receiving the events of the socket monitors.
+      public: std::thread connectionMonitorThread;
+
+      ////////////////////////////////////////////////////////////////
+      /////// The following is for the handler lookup.          ///////
+      ////////////////////////////////////////////////////////////////
+
+      /// \brief Immutable snapshot of the local handlers of a topic.
+      public: struct TopicHandlers
+              {
+                /// \brief The handlers.
+                public: NodeShared::HandlerInfo info;
+
+                /// \brief Counters of the topic.
+                public: TopicMetrics metrics;
+
+                /// \brief True if all the callbacks run on the reception
+                /// thread: no handler is conflated or has an executor. The
+                /// handlers can be used without copying them.
+                public: bool direct = true;
+              };
+
+      /// \brief Snapshots of the handlers of each topic.
+      public: using TopicHandlers_M = std::unordered_map<std::string,
+                std::shared_ptr<const TopicHandlers>>;
+
+      /// \brief Get the handlers of a topic, without locking nor copying
+      /// them unless the topic is not in the cache yet.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return The handlers.
+      public: std::shared_ptr<const TopicHandlers> CachedHandlers(
+                const std::string &_topic);
+
+      /// \brief Remove a topic from the handler cache, after its local
+      /// handlers change. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void InvalidateHandlers(const std::string &_topic);
+
+      /// \brief Handler cache. It's never modified, only replaced with
+      /// std::atomic_store() while holding NodeShared::mutex, so the
+      /// reception thread reads it with std::atomic_load().
+      public: std::shared_ptr<const TopicHandlers_M> handlerCache;
+
+      /// \brief Incremented every time the local or remote subscribers or
+      /// the advertised topics change, while holding NodeShared::mutex.
+      /// Publishers use it to know when their cached
+      /// NodeShared::SubscriberInfo or TopicSendInfo is stale.
+      public: std::atomic<uint64_t> subscribersVersion{0};
+
+      /// \brief Increment subscribersVersion and wake up the match thread
+      /// if some publishers watch their subscribers. Called every time the
+      /// local or remote subscribers or the advertised topics change.
+      public: void SubscribersChanged();
+
+      /// \brief A publisher told when its topic gets its first subscriber
+      /// or loses its last one.
+      public: struct MatchWatcher
+              {
+                /// \brief Fully qualified topic name.
+                public: std::string topic;
+
+                /// \brief Message type of the publisher.
+                public: std::string msgType;
+
+                /// \brief Callback. Protected by matchMutex.
+                public: std::function<void(const bool)> callback;
+
+                /// \brief Whether the topic had subscribers the last time
+                /// the callback was run. Only used by the match thread.
+                public: bool matched = false;
               };
 
-      /// \brief Publish thread used to process the pubQueue.
-      public: std::thread pubThread;
+      /// \brief Start watching the subscribers of a publisher. The
+      /// callback is run right away if the topic already has subscribers.
+      /// The watcher is forgotten once it's destroyed.
+      /// \param[in] _watcher The watcher.
+      public: void AddMatchWatcher(
+        const std::shared_ptr<MatchWatcher> &_watcher);
 
-      /// \brief Mutex to protect the pubThread and pubQueue.
-      public: std::mutex pubThreadMutex;
+      /// \brief Runs the callbacks of the watchers whose topic got its
+      /// first subscriber or lost its last one.
+      public: void MatchThread();
 
-      /// \brief Queue onto which new messages are pushed. The pubThread
-      /// will pop off the messages and send them to local subscribers.
-      public: std::queue<std::unique_ptr<PublishMsgDetails>> pubQueue;
+      /// \brief Thread running the match callbacks. Started on first use.
+      public: std::thread matchThread;
 
-      /// \brief used to signal when new work is available
-      public: std::condition_variable signalNewPub;
+      /// \brief Protects matchThread, matchWatchers, matchPending and the
+      /// callbacks of the watchers. Taken after NodeShared::mutex, never
+      /// before.
+      public: std::mutex matchMutex;
 
-      /// \brief Handles local publication of messages on the pubQueue.
-      public: void PublishThread();
+      /// \brief Publishers watching their subscribers.
+      public: std::vector<std::weak_ptr<MatchWatcher>> matchWatchers;
 
-      /// \brief Topic publication sequence numbers.
+      /// \brief True if the subscribers changed since the match thread last
+      /// checked them.
+      public: bool matchPending = false;
+
+      /// \brief Signaled when the subscribers change.
+      public: std::condition_variable signalMatch;
+
+      /// \brief Topic publication sequence numbers. Protected by
+      /// publisherMutex.
       public: std::map<std::string, uint64_t> topicPubSeq;
 
-      /// \brief True if topic statistics have been enabled.
+      /// \brief True if the publication metadata is sent with all the
+      /// messages, because IGN_TRANSPORT_TOPIC_STATISTICS is set. Otherwise
+      /// it's only sent for the topics whose subscribers ask for it.
       public: bool topicStatsEnabled = false;
 
-      /// \brief Statistics for a topic. The key in the map is the topic
-      /// name and the value contains the topic statistics.
-      public: std::map<std::string, TopicStatistics> topicStats;
+      /// \brief True if the age of the messages from other hosts is
+      /// corrected by an estimate of the offset of their clocks.
+      public: bool topicStatsClockOffset = false;
+
+      /// \brief Maximum number of topics with statistics enabled, set by
+      /// IGN_TRANSPORT_TOPIC_STATISTICS_MAX_TOPICS. Zero for no limit.
+      public: std::size_t topicStatsMaxTopics = 1000;
+
+      /// \brief Statistics of a topic with statistics enabled.
+      public: struct TopicStatsEntry
+              {
+                /// \brief Protects stats, hasStats and updated. The
+                /// reception thread is the only one updating the statistics,
+                /// so it's only contended while the statistics thread or
+                /// TopicStats() copies them.
+                public: std::mutex mutex;
+
+                /// \brief The statistics.
+                public: TopicStatistics stats;
+
+                /// \brief True once the statistics have been updated.
+                public: bool hasStats = false;
+
+                /// \brief True if the statistics have been updated since
+                /// the last call of the callback.
+                public: bool updated = false;
+
+                /// \brief Time of the latest update, or of enabling the
+                /// statistics. The topic updated the least recently is the
+                /// first one forgotten when there are too many of them.
+                public: std::chrono::steady_clock::time_point lastUpdate;
+
+                /// \brief Callback triggered with the statistics, null once
+                /// the statistics are disabled. Protected by
+                /// topicStatsCbMutex.
+                public: std::function<void(const TopicStatistics &)> cb;
+
+                /// \brief Minimum time between two calls of the callback,
+                /// zero for every update. Protected by topicStatsMutex.
+                public: std::chrono::steady_clock::duration period;
+
+                /// \brief Time of the next call of the callback. Protected
+                /// by topicStatsMutex.
+                public: std::chrono::steady_clock::time_point next;
+              };
+
+      /// \brief Topics with statistics enabled.
+      public: using TopicStats_M = std::unordered_map<std::string,
+                std::shared_ptr<TopicStatsEntry>>;
+
+      /// \brief Get the statistics of a topic without locking.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return The statistics, or nullptr if they are not enabled.
+      public: std::shared_ptr<TopicStatsEntry> CachedTopicStats(
+                const std::string &_topic) const;
+
+      /// \brief Update the statistics of a topic and let the statistics
+      /// thread know when the callback has to run for every update.
+      /// \param[in] _entry Statistics of the topic.
+      /// \param[in] _update Function updating the TopicStatistics.
+      public: template<typename F>
+              void UpdateTopicStats(TopicStatsEntry &_entry, F _update)
+      {
+        {
+          std::lock_guard<std::mutex> lk(_entry.mutex);
+          _update(_entry.stats);
+          _entry.hasStats = true;
+          _entry.updated = true;
+          _entry.lastUpdate = std::chrono::steady_clock::now();
+        }
+
+        if (this->topicStatsEveryUpdate)
+        {
+          std::lock_guard<std::mutex> lk(this->topicStatsMutex);
+          this->topicStatsUpdated = true;
+          this->signalTopicStats.notify_one();
+        }
+      }
+
+      /// \brief Triggers the callbacks of the topic statistics, at the rate
+      /// requested for each topic.
+      public: void TopicStatsThread();
+
+      /// \brief Statistics of the topics, by topic name. It's never
+      /// modified, only replaced with std::atomic_store() while holding
+      /// topicStatsMutex, so the reception thread reads it with
+      /// std::atomic_load().
+      public: std::shared_ptr<const TopicStats_M> topicStatsCache;
+
+      /// \brief Statistics thread. Started when the statistics of a topic
+      /// are first enabled.
+      public: std::thread topicStatsThread;
+
+      /// \brief Protects topicStatsThread, topicStatsUpdated, replacing
+      /// topicStatsCache and the publication times of the entries. Never
+      /// held while running a callback.
+      public: std::mutex topicStatsMutex;
+
+      /// \brief Held while the statistics thread runs the callbacks, so no
+      /// callback runs after disabling the statistics of its topic.
+      public: std::mutex topicStatsCbMutex;
+
+      /// \brief Signaled when the topics with statistics enabled change, or
+      /// when the statistics of a topic whose callback runs for every
+      /// update are updated.
+      public: std::condition_variable signalTopicStats;
+
+      /// \brief True if a topic has its callback triggered for every
+      /// update, so its updates must wake up the statistics thread.
+      public: std::atomic<bool> topicStatsEveryUpdate{false};
+
+      /// \brief True if the topics with statistics enabled changed, or a
+      /// topic with its callback triggered for every update was updated,
+      /// since the statistics thread last checked.
+      public: bool topicStatsUpdated = false;
+
+      /// \brief Callback of a service with statistics enabled.
+      public: struct ServiceStatsPublication
+              {
+                /// \brief Callback triggered with the statistics.
+                public: std::function<void(const ServiceStatistics &)> cb;
+
+                /// \brief Minimum time between two calls of the callback.
+                public: std::chrono::steady_clock::duration period;
+
+                /// \brief Time of the next call of the callback.
+                public: std::chrono::steady_clock::time_point next;
+              };
+
+      /// \brief Update the statistics of a service, if enabled, and
+      /// trigger its callback once per publication period. The callback
+      /// runs without holding serviceStatsMutex.
+      /// \param[in] _topic Fully qualified service name.
+      /// \param[in] _update Function updating the ServiceStatistics.
+      public: template<typename F>
+              void UpdateServiceStats(const std::string &_topic, F _update)
+      {
+        if (!this->serviceStatsEnabled)
+          return;
+
+        std::function<void(const ServiceStatistics &)> cb;
+        std::unique_ptr<ServiceStatistics> snapshot;
+        {
+          std::lock_guard<std::mutex> lk(this->serviceStatsMutex);
+          auto it = this->enabledServiceStatistics.find(_topic);
+          if (it == this->enabledServiceStatistics.end())
+            return;
+
+          ServiceStatistics &stats = this->serviceStats[_topic];
+          _update(stats);
+
+          const auto now = std::chrono::steady_clock::now();
+          if (!it->second.cb || now < it->second.next)
+            return;
+
+          it->second.next = now + it->second.period;
+          cb = it->second.cb;
+          snapshot.reset(new ServiceStatistics(stats));
+        }
+        cb(*snapshot);
+      }
+
+      /// \brief Run the callback of a request received, recording its
+      /// queueing and execution times in the statistics of the service.
+      /// \param[in] _topic Fully qualified service name.
+      /// \param[in] _received Time the request was received.
+      /// \param[in] _callback Function running the callback.
+      /// \return The result of _callback.
+      public: template<typename F>
+              bool RunServiceCallback(const std::string &_topic,
+                const std::chrono::steady_clock::time_point &_received,
+                F _callback)
+      {
+        if (!this->serviceStatsEnabled)
+          return _callback();
+
+        const auto start = std::chrono::steady_clock::now();
+        this->UpdateServiceStats(_topic,
+          [&_received, &start](ServiceStatistics &_stats)
+          {
+            _stats.RequestStarted(Microseconds(start - _received));
+          });
+
+        const bool result = _callback();
+
+        const auto end = std::chrono::steady_clock::now();
+        this->UpdateServiceStats(_topic,
+          [&start, &end](ServiceStatistics &_stats)
+          {
+            _stats.RequestFinished(Microseconds(end - start));
+          });
+        return result;
+      }
+
+      /// \brief Convert a duration to the microseconds of the service
+      /// statistics.
+      /// \param[in] _duration The duration.
+      /// \return The duration in microseconds, 0 if negative.
+      public: static uint64_t Microseconds(
+                const std::chrono::steady_clock::duration &_duration);
+
+      /// \brief True if any service has statistics enabled.
+      public: std::atomic<bool> serviceStatsEnabled{false};
+
+      /// \brief Statistics of the services. The key is the fully qualified
+      /// service name. Protected by serviceStatsMutex.
+      public: std::map<std::string, ServiceStatistics> serviceStats;
+
+      /// \brief Services that have statistics enabled. Protected by
+      /// serviceStatsMutex.
+      public: std::map<std::string, ServiceStatsPublication>
+                enabledServiceStatistics;
+
+      /// \brief Mutex to protect the service statistics. Never held while
+      /// taking NodeShared::mutex, the statistics are updated by the
+      /// service worker threads.
+      public: std::mutex serviceStatsMutex;
+
+      /// \brief True if the shared memory transport has been enabled.
+      public: bool shmEnabled = false;
+
+      /// \brief Shared memory segment used to send large messages to the
+      /// subscribers running on the same host. Null if the shared memory
+      /// transport is disabled or the segment couldn't be created.
+      public: std::unique_ptr<ShmSegment> shmSegment;
+
+      /// \brief Shared memory segment of a same-host publisher.
+      public: struct ShmPeer
+              {
+                /// \brief Process UUID of the publisher.
+                public: std::string pUuid;
+
+                /// \brief Segment of the publisher, mapped read-only.
+                public: std::unique_ptr<ShmSegment> segment;
+              };
+
+      /// \brief Segments of the same-host publishers that we are connected
+      /// to. The key is the publisher address.
+      public: std::map<std::string, ShmPeer> shmPeers;
+
+      /// \brief Check if an address belongs to this host.
+      /// \param[in] _addr A ZeroMQ address, such as "tcp://10.0.0.1:3000".
+      /// \param[in] _hostAddr IP address of this host.
+      /// \return True if _addr uses _hostAddr.
+      public: static bool SameHost(const std::string &_addr,
+                                   const std::string &_hostAddr);
+
+      /// \brief Get the key used to index topicIds and topicSendInfo.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _msgType Message type.
+      /// \return The key.
+      public: static std::string TopicKey(const std::string &_topic,
+                                          const std::string &_msgType);
+
+      /// \brief Get the ID of a topic advertised by this process, assigning
+      /// a new one if needed. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _msgType Advertised message type.
+      /// \return The topic ID.
+      public: uint32_t TopicId(const std::string &_topic,
+                               const std::string &_msgType);
+
+      /// \brief Topic IDs of the topics advertised by this process. The key
+      /// is created with TopicKey(). Protected by NodeShared::mutex.
+      public: std::map<std::string, uint32_t> topicIds;
+
+      /// \brief Compression settings of a topic advertised by this process.
+      public: struct TopicCompression
+              {
+                /// \brief Compression algorithm.
+                public: Compression_t compression = Compression_t::NONE;
+
+                /// \brief Minimum size of a message to be compressed.
+                public: std::size_t threshold = 0;
+              };
+
+      /// \brief Compression settings of the topics advertised by this
+      /// process. The key is created with TopicKey(). Protected by
+      /// NodeShared::mutex.
+      public: std::map<std::string, TopicCompression> topicCompression;
+
+      /// \brief Multicast socket of the topics advertised by this process
+      /// with a multicast group. The key is created with TopicKey().
+      /// Protected by NodeShared::mutex.
+      public: std::map<std::string, zmq::socket_t *> topicMulticast;
+
+      /// \brief High priority topics advertised by this process. The key is
+      /// created with TopicKey(). Protected by NodeShared::mutex.
+      public: std::set<std::string> priorityTopics;
+
+      /// \brief Messages retained for the reliable topics advertised by this
+      /// process. The key is created with TopicKey(). The map is protected
+      /// by NodeShared::mutex, the buffers by publisherMutex.
+      public: std::map<std::string, std::shared_ptr<RetransmitBuffer>>
+        retransmitBuffers;
+
+      /// \brief Send again some messages of a reliable topic to a subscriber
+      /// process that missed them.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _msgType Advertised message type.
+      /// \param[in] _pUuid Process UUID of the subscriber.
+      /// \param[in] _ranges Sequence numbers of the messages.
+      public: void Retransmit(const std::string &_topic,
+                              const std::string &_msgType,
+                              const std::string &_pUuid,
+                              const std::vector<SeqRange> &_ranges);
+
+      /// \brief A reliable topic that a remote publisher sends to us.
+      public: struct ReliableStream
+              {
+                /// \brief Process UUID of the publisher.
+                public: std::string pUuid;
+
+                /// \brief Advertised message type.
+                public: std::string msgType;
+
+                /// \brief Address of the service replier of the publisher,
+                /// which receives the requests for missing messages.
+                public: std::string replierAddr;
+
+                /// \brief Socket ID of the service replier of the publisher.
+                public: std::string replierId;
+
+                /// \brief Sequence numbers received.
+                public: GapTracker tracker;
+              };
+
+      /// \brief Reliable topics of the remote publishers that we are
+      /// subscribed to. The key is the publisher address followed by the
+      /// topic name. Protected by NodeShared::mutex.
+      public: std::map<std::string, ReliableStream> reliableStreams;
+
+      /// \brief Request the missing messages of a reliable topic. Must be
+      /// called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _stream The topic.
+      /// \param[in] _ranges Sequence numbers of the missing messages.
+      public: void SendNack(const std::string &_topic,
+                            const ReliableStream &_stream,
+                            const std::vector<SeqRange> &_ranges);
+
+      /// \brief Service replier of a remote publisher of acknowledged
+      /// topics.
+      public: struct AckPeer
+              {
+                /// \brief UUID of the publisher process.
+                public: std::string pUuid;
+
+                /// \brief Socket ID of the service replier of the publisher.
+                public: std::string replierId;
+              };
+
+      /// \brief Remote publishers of acknowledged topics that we are
+      /// subscribed to, by address. Protected by NodeShared::mutex.
+      public: std::map<std::string, AckPeer> ackPeers;
+
+      /// \brief Send the acknowledgement of a message to its publisher.
+      /// Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _sender Address of the publisher.
+      /// \param[in] _ackId ID of the message.
+      public: void SendAck(const std::string &_topic,
+                           const std::string &_sender,
+                           const uint64_t _ackId);
+
+      /// \brief Get the remote subscriber processes of a topic that
+      /// acknowledge the messages.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return UUIDs of the processes.
+      public: std::set<std::string> AckSubscribers(const std::string &_topic);
+
+      /// \brief Messages published with PublishAcked() that are waiting for
+      /// acknowledgements.
+      public: PendingAcks pendingAcks;
+
+      /// \brief Connect the subscriber socket to the address of a remote
+      /// publisher, unless it's already connected to it. Must be called with
+      /// NodeShared::mutex locked.
+      /// \param[in] _addr Address of the publisher.
+      /// \param[in] _pUuid Process UUID of the publisher.
+      public: void ConnectPeer(const std::string &_addr,
+                               const std::string &_pUuid);
+
+      /// \brief Disconnect the subscriber socket from the addresses of a
+      /// remote process, so it doesn't try to reconnect to them. Must be
+      /// called with NodeShared::mutex locked.
+      /// \param[in] _pUuid Process UUID of the remote process.
+      public: void DisconnectPeer(const std::string &_pUuid);
+
+      /// \brief Add the subscription filter of a topic, unless it's already
+      /// set. ZeroMQ counts the filters, so each one is set only once to be
+      /// removed with a single call. Must be called with NodeShared::mutex
+      /// locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void AddTopicFilter(const std::string &_topic);
+
+      /// \brief Remove the subscription filter of a topic. Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void RemoveTopicFilter(const std::string &_topic);
+
+      /// \brief Addresses the subscriber socket is connected to, each one
+      /// once, and the process UUID of their publishers. Protected by
+      /// NodeShared::mutex.
+      public: std::map<std::string, std::string> peerAddresses;
+
+      /// \brief Endpoint actually connected for each address of
+      /// peerAddresses: the address itself, or the ipc:// endpoint of a
+      /// publisher on the same host. Protected by NodeShared::mutex.
+      public: std::map<std::string, std::string> peerEndpoints;
+
+      /// \brief True if the publisher and replier sockets are also bound to
+      /// ipc:// endpoints, and the peers on the same host are connected
+      /// through theirs. See IpcEndpoint().
+      public: bool ipcEnabled = false;
+
+      /// \brief Get the endpoint to connect to a peer: its ipc:// endpoint
+      /// if it runs on this host and ipc is enabled, or its address.
+      /// \param[in] _addr The tcp:// address advertised by the peer.
+      /// \param[in] _pUuid UUID of the peer process.
+      /// \param[in] _socket Socket of the peer, e.g. kIpcPublisherSocket.
+      /// \return The endpoint.
+      public: std::string PeerEndpoint(const std::string &_addr,
+                                       const std::string &_pUuid,
+                                       const std::string &_socket) const;
+
+      /// \brief Topics with a subscription filter. Protected by
+      /// NodeShared::mutex.
+      public: std::set<std::string> topicFilters;
+
+      /// \brief Prefix of the topic frame of the messages sent to this
+      /// process only. See DirectTopicPrefix().
+      public: std::string directPrefix;
+
+      /// \brief A topic that a remote publisher sends with an alias.
+      public: struct TopicAliasInfo
+              {
+                /// \brief Fully qualified topic name.
+                public: std::string topic;
+
+                /// \brief Advertised message type.
+                public: std::string msgType;
+
+                /// \brief Address of the publisher.
+                public: std::string addr;
+
+                /// \brief Process UUID of the publisher.
+                public: std::string pUuid;
+              };
+
+      /// \brief Aliases of the remote topics that we are subscribed to. The
+      /// key is the alias. Protected by NodeShared::mutex.
+      public: std::map<std::string, TopicAliasInfo> topicAliases;
+
+      /// \brief Remove some aliases and their subscription filters. Must be
+      /// called with NodeShared::mutex locked.
+      /// \param[in] _remove Returns true for the aliases to remove.
+      public: void RemoveTopicAliases(
+                const std::function<bool(const TopicAliasInfo &)> &_remove);
+
+      /// \brief A wildcard subscription of a node. See
+      /// Node::SubscribeRawWildcard().
+      public: struct WildcardSubscription
+              {
+                /// \brief Fully qualified pattern.
+                public: std::string pattern;
+
+                /// \brief UUID of the node.
+                public: std::string nUuid;
+
+                /// \brief Message type accepted, or kGenericMessageType.
+                public: std::string msgType;
+
+                /// \brief Subscribe the node to a topic matching the
+                /// pattern. Called with NodeShared::mutex locked.
+                public: std::function<void(const std::string &)> subscribe;
+
+                /// \brief Topics already subscribed for this pattern.
+                public: std::set<std::string> topics;
+              };
+
+      /// \brief Subscribe the wildcard subscriptions matching a topic that
+      /// they didn't match yet. Must be called with NodeShared::mutex
+      /// locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _msgType Advertised message type.
+      /// \return True if a new subscription was made.
+      public: bool MatchWildcards(const std::string &_topic,
+                                  const std::string &_msgType);
+
+      /// \brief Wildcard subscriptions, by pattern. Protected by
+      /// NodeShared::mutex.
+      public: TopicTrie<std::shared_ptr<WildcardSubscription>> wildcards;
+
+      /// \brief Get the frame sent instead of the request UUID, carrying a
+      /// compact request ID. The responsers echo the node and request UUID
+      /// frames without interpreting them, so they don't need to know about
+      /// compact IDs. The frame starts with a null character, so it can't
+      /// match a UUID.
+      /// \param[in] _id Request ID.
+      /// \return The frame.
+      public: static std::string RequestIdFrame(const uint64_t _id);
+
+      /// \brief Get the request ID carried by a request UUID frame.
+      /// \param[in] _frame Request UUID frame of a response.
+      /// \param[out] _id Request ID.
+      /// \return True if _frame was created with RequestIdFrame().
+      public: static bool ParseRequestIdFrame(const std::string &_frame,
+                                              uint64_t &_id);
+
+      /// \brief Create the frame carrying the deadline of a request. It's
+      /// sent in place of the node UUID, which responsers echo without
+      /// interpreting it, and starts with a null character so it can't match
+      /// a UUID.
+      /// \param[in] _deadline Deadline in milliseconds since the epoch of
+      /// the system clock.
+      /// \param[in] _budget Milliseconds left before the deadline when the
+      /// request is sent.
+      /// \return The frame.
+      public: static std::string DeadlineFrame(const int64_t _deadline,
+                                               const uint32_t _budget);
+
+      /// \brief Get the deadline carried by a node UUID frame.
+      /// \param[in] _frame Node UUID frame of a request.
+      /// \param[out] _deadline Deadline in milliseconds since the epoch of
+      /// the requester's system clock.
+      /// \param[out] _budget Milliseconds left before the deadline when the
+      /// request was sent.
+      /// \return True if _frame was created with DeadlineFrame().
+      public: static bool ParseDeadlineFrame(const std::string &_frame,
+                                             int64_t &_deadline,
+                                             uint32_t &_budget);
+
+      /// \brief Request and response type of the messages cancelling a
+      /// service request. Responsers without cancellation support don't
+      /// have a service with these types, so they ignore the message.
+      public: inline static const std::string kSrvCancelType =
+        "ignition.transport.CancelRequest";
+
+      /// \brief Result frame of a response carrying one chunk of a
+      /// streaming service. The final response has the usual "1" or "0".
+      public: inline static const std::string kSrvChunkResult = "c";
+
+      /// \brief Result frame of the response to a request rejected because
+      /// the queue of the service is full. The older requesters see it as a
+      /// failed request.
+      public: inline static const std::string kSrvBusyResult = "b";
+
+      /// \brief How long a responser that rejected a request doesn't
+      /// receive the requests of the service if another responser offers
+      /// it.
+      public: static constexpr std::chrono::milliseconds kSrvBusyBackoff{
+        100};
+
+      /// \brief Requests posted to the service executors that didn't run
+      /// yet. The key is the requester's identity followed by the request
+      /// UUID frame, the value is set when the request is cancelled.
+      public: std::unordered_map<std::string,
+                std::shared_ptr<std::atomic<bool>>> queuedSrvRequests;
+
+      /// \brief Protects queuedSrvRequests.
+      public: std::mutex queuedSrvRequestsMutex;
+
+      /// \brief A service request sent to a remote responser with a compact
+      /// request ID and waiting for its response.
+      public: struct PendingRequest
+              {
+                /// \brief Fully qualified service name.
+                public: std::string topic;
+
+                /// \brief Request handler. It expires if the requester
+                /// stops waiting and removes the handler.
+                public: std::weak_ptr<IReqHandler> handler;
+
+                /// \brief Socket ID of the responser the request was sent
+                /// to.
+                public: std::string responserId;
+
+                /// \brief When the request was sent.
+                public: std::chrono::steady_clock::time_point sent;
+              };
+
+      /// \brief Remote requests waiting for a response. The key is the
+      /// request ID. Protected by NodeShared::mutex.
+      public: std::unordered_map<uint64_t, PendingRequest> pendingRequests;
+
+      /// \brief Last request ID assigned. Protected by NodeShared::mutex.
+      public: uint64_t lastRequestId = 0;
+
+      /// \brief Size of pendingRequests that triggers the next removal of
+      /// expired entries. Protected by NodeShared::mutex.
+      public: std::size_t pendingRequestsPurgeSize = 1024;
+
+      /// \brief Remove the expired entries of pendingRequests once it grows
+      /// past pendingRequestsPurgeSize. Must be called with
+      /// NodeShared::mutex locked.
+      public: void PurgePendingRequests();
+
+      /// \brief How the remote requests of a service are spread among the
+      /// processes offering it.
+      public: enum class SrvLoadBalancing
+              {
+                /// \brief All the requests go to the first responser found.
+                FIRST,
+
+                /// \brief The responsers take turns.
+                ROUND_ROBIN,
+
+                /// \brief The responser with the fewest requests waiting for
+                /// a response.
+                LEAST_OUTSTANDING,
+
+                /// \brief The responser with the lowest expected wait, its
+                /// average response time multiplied by its requests waiting
+                /// for a response plus one.
+                LATENCY
+              };
+
+      /// \brief Load balancing strategy. Set with the
+      /// IGN_TRANSPORT_SRV_LOAD_BALANCING environment variable.
+      public: SrvLoadBalancing srvLoadBalancing = SrvLoadBalancing::FIRST;
+
+      /// \brief A remote process offering a service.
+      public: struct Responser
+              {
+                /// \brief Address of the responser.
+                public: std::string addr;
+
+                /// \brief Socket ID of the responser.
+                public: std::string id;
+
+                /// \brief Process UUID of the responser.
+                public: std::string pUuid;
+
+                /// \brief Whether the responser announced kCapBatch, i.e. it
+                /// unpacks the batches of oneway requests.
+                public: bool batch = false;
+
+                /// \brief Requests sent to the responser and waiting for a
+                /// response.
+                public: uint64_t outstanding = 0;
+              };
+
+      /// \brief Choose the responser of the next request of a service. Must
+      /// be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified service name.
+      /// \param[in] _responsers The candidate responsers, not empty.
+      /// \return The index of the chosen responser.
+      public: std::size_t ChooseResponser(const std::string &_topic,
+                const std::vector<Responser> &_responsers);
+
+      /// \brief Record the response time of a responser. Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _request The request answered.
+      public: void UpdateResponserLatency(const PendingRequest &_request);
+
+      /// \brief Next responser of each service with round-robin load
+      /// balancing. The key is the fully qualified service name. Protected
+      /// by NodeShared::mutex.
+      public: std::unordered_map<std::string, uint64_t> srvRoundRobin;
+
+      /// \brief Average response time in milliseconds of each responser,
+      /// used by the latency load balancing. The key is the responser's
+      /// socket ID. Protected by NodeShared::mutex.
+      public: std::unordered_map<std::string, double> responserLatency;
+
+      /// \brief When the responsers that rejected a request receive the
+      /// requests again. The key is the responser's socket ID. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<std::string,
+                std::chrono::steady_clock::time_point> busyResponsers;
+
+      /// \brief Whether a responser rejected a request less than
+      /// kSrvBusyBackoff ago. Must be called with NodeShared::mutex locked.
+      /// \param[in] _id Socket ID of the responser.
+      /// \return True if the responser is busy.
+      public: bool ResponserBusy(const std::string &_id);
+
+      /// \brief Oneway requests of a service waiting to be sent to a
+      /// responser in a single message.
+      public: struct OnewayBatch
+              {
+                /// \brief Socket ID of the responser.
+                public: std::string responserId;
+
+                /// \brief Fully qualified service name.
+                public: std::string topic;
+
+                /// \brief Request type name.
+                public: std::string reqType;
+
+                /// \brief Serialized requests, in order.
+                public: std::vector<std::string> reqs;
+
+                /// \brief When the first request was queued.
+                public: std::chrono::steady_clock::time_point first;
+              };
+
+      /// \brief Queue a oneway request to be sent in a batch. Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _responser The responser.
+      /// \param[in] _topic Fully qualified service name.
+      /// \param[in] _reqType Request type name.
+      /// \param[in] _req Serialized request.
+      public: void QueueOnewayRequest(const Responser &_responser,
+                                      const std::string &_topic,
+                                      const std::string &_reqType,
+                                      const std::string &_req);
+
+      /// \brief Send each batch of oneway requests when its first request
+      /// has waited onewayBatchDelay or it is full.
+      /// \param[in] _shared The NodeShared instance owning the requester.
+      public: void OnewayBatchThread(NodeShared &_shared);
+
+      /// \brief Send a batch of oneway requests in one message. The data
+      /// frame contains the requests packed with PackBatch() and the request
+      /// type frame starts with kBatchMsgTypePrefix. Only the responsers that
+      /// announced kCapBatch receive batches.
+      /// \param[in] _shared The NodeShared instance owning the requester.
+      /// \param[in] _batch The batch.
+      public: void SendOnewayBatch(NodeShared &_shared,
+                                   const OnewayBatch &_batch);
+
+      /// \brief Maximum time a oneway request waits in a batch, zero if the
+      /// oneway requests are sent one by one. Set with the
+      /// IGN_TRANSPORT_SRV_ONEWAY_BATCH_DELAY environment variable.
+      public: std::chrono::milliseconds onewayBatchDelay{0};
+
+      /// \brief Maximum number of requests of a batch. A full batch is sent
+      /// without waiting for onewayBatchDelay.
+      public: static const std::size_t kMaxOnewayBatchSize = 1024;
+
+      /// \brief Thread sending the batches of oneway requests. Only started
+      /// when onewayBatchDelay is not zero.
+      public: std::thread onewayBatchThread;
+
+      /// \brief Protects onewayBatches.
+      public: std::mutex onewayBatchMutex;
+
+      /// \brief Signaled when a batch is created or full.
+      public: std::condition_variable signalOnewayBatch;
+
+      /// \brief Batches of oneway requests waiting to be sent. The key is
+      /// the responser's socket ID, the service name and the request type.
+      public: std::map<std::tuple<std::string, std::string, std::string>,
+                       OnewayBatch> onewayBatches;
+
+      /// \brief How the publications of a topic are sent to the remote
+      /// subscribers.
+      public: struct TopicSendInfo
+              {
+                /// \brief Value of subscribersVersion when this was computed.
+                public: uint64_t version = 0;
+
+                /// \brief True if all the remote subscribers can read large
+                /// messages from shared memory.
+                public: bool shm = false;
+
+                /// \brief Alias sent instead of the topic name, or empty if
+                /// some remote subscribers don't support aliases.
+                public: std::string alias;
+
+                /// \brief Compression settings, if all the remote subscribers
+                /// support them.
+                public: TopicCompression compression;
+
+                /// \brief True if some remote subscribers want the
+                /// publication metadata and all of them accept it.
+                public: bool metadata = false;
+
+                /// \brief Multicast socket used instead of the publisher
+                /// socket, if all the remote subscribers joined the group.
+                public: zmq::socket_t *multicast = nullptr;
+
+                /// \brief True if the topic is sent through the high
+                /// priority publisher socket.
+                public: bool priority = false;
+
+                /// \brief Size of the chunks of the large messages, or 0
+                /// if some remote subscribers can't reassemble them.
+                public: std::size_t chunkSize = 0;
+
+                /// \brief True if all the remote subscribers can unpack
+                /// batches of messages.
+                public: bool batch = false;
+
+                /// \brief Messages retained for retransmission, if the topic
+                /// is reliable and all the remote subscribers can request
+                /// the messages they missed.
+                public: std::shared_ptr<RetransmitBuffer> reliable;
+
+                /// \brief Counters of the topic.
+                public: TopicMetrics metrics;
+              };
+
+      /// \brief Send information for each topic and type published by this
+      /// process. The key is created with TopicKey(). Protected by
+      /// publisherMutex.
+      public: std::map<std::string, TopicSendInfo> topicSendInfo;
+
+      /// \brief Get how to send a topic to its remote subscribers, using
+      /// the cached information unless they changed.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _msgType Message type.
+      /// \return The send information.
+      public: TopicSendInfo SendInfo(const std::string &_topic,
+                                     const std::string &_msgType);
 
-      /// \brief Set of topics that have statistics enabled.
-      public: std::map<std::string,
-              std::function<void(const TopicStatistics &_stats)>>
-                enabledTopicStatistics;
+      /// \brief Create the publication metadata of a message. Must be called
+      /// with publisherMutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _tracing Whether the trace ID is sent.
+      /// \param[in] _ackId ID of the message in the acknowledgements, 0 if
+      /// the message isn't acknowledged.
+      /// \return The metadata frame.
+      public: zmq::message_t MetadataFrame(const std::string &_topic,
+                                           const bool _tracing,
+                                           const uint64_t _ackId = 0);
     };
     }
   }
@@ -15,20 +15,30 @@
  *
 */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <csignal>
 #include <cstdlib>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <thread>
+#include <vector>
 #include <ignition/msgs.hh>
 
 #include "gtest/gtest.h"
 #include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/DeviceBuffer.hh"
 #include "ignition/transport/MessageInfo.hh"
+#include "ignition/transport/MetricsRegistry.hh"
 #include "ignition/transport/Node.hh"
 #include "ignition/transport/NodeOptions.hh"
+#include "ignition/transport/NodeShared.hh"
 #include "ignition/transport/TopicStatistics.hh"
 #include "ignition/transport/TopicUtils.hh"
 #include "ignition/transport/TransportTypes.hh"
@@ -36,6 +46,16 @@
 
 using namespace ignition;
 
+/// \brief A trivially copyable message, sent without protobuf.
+struct TrivialPose
+{
+  double x;
+  double y;
+  double z;
+  int id;
+};
+IGN_TRANSPORT_TRIVIAL_MESSAGE(TrivialPose, "test.TrivialPose")
+
 static std::string partition; // NOLINT(*)
 static std::string g_FQNPartition; // NOLINT(*)
 static std::string g_topic = "/foo"; // NOLINT(*)
@@ -778,6 +798,43 @@ TEST(NodeTest, RawPubRawSubSameThreadMessageInfo)
   reset();
 }
 
+//////////////////////////////////////////////////
+TEST(NodeTest, RawPubBufferRawSubSameThread)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish the message from a buffer of the caller.
+  const std::string serialized = msg.SerializeAsString();
+  EXPECT_TRUE(pub.PublishRaw(serialized.data(), serialized.size(),
+    msg.GetTypeName()));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the message was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+
+  // The type is checked like with the other overload.
+  EXPECT_FALSE(pub.PublishRaw(serialized.data(), serialized.size(),
+    "wrong.message.type"));
+
+  reset();
+}
+
 //////////////////////////////////////////////////
 TEST(NodeTest, PubRawSubSameThreadMessageInfo)
 {
@@ -819,8 +876,9 @@ TEST(NodeTest, PubRawSubSameThreadMessageInfo)
 }
 
 //////////////////////////////////////////////////
-/// \brief Subscribe to a topic using a lambda function.
-TEST(NodeTest, PubSubSameThreadLambda)
+/// \brief A raw and a typed local subscriber should both receive the message
+/// when it has been serialized only once for the raw subscriber.
+TEST(NodeTest, PubRawAndTypedSubSameThreadMessageInfo)
 {
   reset();
 
@@ -828,46 +886,43 @@ TEST(NodeTest, PubSubSameThreadLambda)
   msg.set_data(data);
 
   transport::Node node;
-
   auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
   EXPECT_TRUE(pub);
 
-  std::mutex mutex;
-  std::condition_variable condition;
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
 
-  bool executed = false;
-  std::function<void(const ignition::msgs::Int32&)> subCb =
-    [&executed, &mutex, &condition](const ignition::msgs::Int32 &_msg)
-  {
-    EXPECT_EQ(_msg.data(), data);
-    std::lock_guard<std::mutex> lk(mutex);
-    executed = true;
-    condition.notify_all();
-  };
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+  // Publish a first message.
+  EXPECT_TRUE(pub.Publish(msg));
 
   // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  // Publish a first message.
+  // Check that the message was received by both subscribers.
+  EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(2, counter);
+
+  reset();
+
+  // Publish a second message on topic.
   EXPECT_TRUE(pub.Publish(msg));
 
-  // The local publish is asynchronous, which means we need to wait
-  // for the callback.
-  std::unique_lock<std::mutex> lk(mutex);
-  condition.wait(lk, [&executed]{return executed;});
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  EXPECT_TRUE(executed);
+  // Check that the data was received by both subscribers.
+  EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(2, counter);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Subscribe to a topic using a lambda function.
-/// This test uses a callback that accepts a parameter with the message
-/// information.
-TEST(NodeTest, PubSubSameThreadLambdaMessageInfo)
+/// \brief Publish messages serialized into loaned buffers.
+TEST(NodeTest, PubLoanedSubSameThreadMessageInfo)
 {
   reset();
 
@@ -875,149 +930,1070 @@ TEST(NodeTest, PubSubSameThreadLambdaMessageInfo)
   msg.set_data(data);
 
   transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  const std::size_t msgSize = msg.ByteSizeLong();
+  for (int i = 0; i < 2; ++i)
+  {
+    char *buffer = pub.Loan(msgSize);
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_TRUE(msg.SerializeToArray(buffer, static_cast<int>(msgSize)));
+    EXPECT_TRUE(pub.PublishLoaned(buffer, msgSize, msg.GetTypeName()));
+
+    // Give some time to the subscribers.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Check that the message was received by both subscribers.
+    EXPECT_TRUE(cbExecuted);
+    EXPECT_EQ(2, counter);
+
+    reset();
+  }
+
+  // A loaned buffer can be returned without publishing it.
+  char *buffer = pub.Loan(msgSize);
+  ASSERT_NE(nullptr, buffer);
+  pub.ReturnLoan(buffer);
+
+  // Type mismatch.
+  buffer = pub.Loan(msgSize);
+  ASSERT_NE(nullptr, buffer);
+  EXPECT_FALSE(pub.PublishLoaned(buffer, msgSize, "ignition.msgs.StringMsg"));
+
+  // An invalid publisher can't loan buffers.
+  transport::Node::Publisher invalidPub;
+  EXPECT_EQ(nullptr, invalidPub.Loan(msgSize));
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish a message made of several buffers.
+TEST(NodeTest, PubSegmentsSubSameThreadMessageInfo)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
 
+  transport::Node node;
   auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
   EXPECT_TRUE(pub);
 
-  bool executed = false;
-  std::function<void(const ignition::msgs::Int32&,
-                     const ignition::transport::MessageInfo &)> subCb =
-    [&executed](const ignition::msgs::Int32 &_msg,
-                const ignition::transport::MessageInfo &_info)
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Split the serialized message in two segments. The local subscribers get
+  // a gathered copy, so the segments are released before returning.
+  const std::string serialized = msg.SerializeAsString();
+  ASSERT_GT(serialized.size(), 1u);
+  int released = 0;
+  auto release = [&released]() { ++released; };
+  const std::vector<transport::MessageSegment> segments =
   {
-    EXPECT_EQ(_info.Topic(), g_topic);
-    EXPECT_EQ(_msg.data(), data);
-    EXPECT_EQ(g_FQNPartition, _info.Partition());
-    EXPECT_EQ(_msg.GetTypeName(), _info.Type());
-    EXPECT_TRUE(_info.IntraProcess());
-    std::lock_guard<std::mutex> lk(cbMutex);
-    executed = true;
-    cbCondition.notify_all();
+    {serialized.data(), 1, release},
+    {serialized.data() + 1, serialized.size() - 1, release}
   };
-
-  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+  EXPECT_TRUE(pub.PublishSegments(segments, msg.GetTypeName()));
+  EXPECT_EQ(2, released);
 
   // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  // Publish a first message.
-  std::unique_lock<std::mutex> lk(cbMutex);
-  EXPECT_TRUE(pub.Publish(msg));
-  cbCondition.wait(lk, [&executed]{return executed;});
+  // Check that the message was received by both subscribers.
+  EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(2, counter);
 
-  EXPECT_TRUE(executed);
+  reset();
+
+  // The segments are released even if the type doesn't match.
+  released = 0;
+  EXPECT_FALSE(pub.PublishSegments(segments, "ignition.msgs.StringMsg"));
+  EXPECT_EQ(2, released);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Advertise two topics with the same name. It's not possible to do it
-/// within the same node but it's valid on separate nodes.
-TEST(NodeTest, AdvertiseTwoEqualTopics)
+/// \brief Wait until the local subscribers ran their callbacks.
+TEST(NodeTest, PubAckedSubSameThread)
 {
-  transport::Node node1;
-  transport::Node node2;
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
 
-  auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub1);
-  auto pub2 = node1.Advertise<ignition::msgs::StringMsg>(g_topic);
-  EXPECT_FALSE(pub2);
-  auto pub3 = node2.Advertise<ignition::msgs::StringMsg>(g_topic);
-  EXPECT_TRUE(pub3);
-}
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
 
-//////////////////////////////////////////////////
-/// \brief Use two threads using their own transport nodes. One thread
-/// will publish a message, whereas the other thread is subscribed to the topic.
-TEST(NodeTest, PubSubTwoThreadsSameTopic)
-{
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options);
-}
+  // Nobody to wait for.
+  auto none = pub.PublishAcked(msg);
+  ASSERT_EQ(std::future_status::ready,
+    none.wait_for(std::chrono::milliseconds(0)));
+  EXPECT_TRUE(none.get());
 
-//////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Process" scope.
-TEST(NodeTest, ScopeProcess)
-{
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
-}
+  std::atomic<int> received{0};
+  std::function<void(const ignition::msgs::Int32 &)> slowCb =
+    [&received](const ignition::msgs::Int32 &)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      ++received;
+    };
+  std::function<void(const char *, const size_t,
+                     const transport::MessageInfo &)> rawCb =
+    [&received](const char *, const size_t, const transport::MessageInfo &)
+    {
+      ++received;
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, slowCb));
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCb));
 
-//////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Host" scope.
-TEST(NodeTest, ScopeHost)
-{
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
-}
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-//////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "All" scope.
-TEST(NodeTest, ScopeAll)
-{
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
-}
+  for (int i = 1; i <= 3; ++i)
+  {
+    auto acked = pub.PublishAcked(msg);
+    ASSERT_EQ(std::future_status::ready,
+      acked.wait_for(std::chrono::seconds(5)));
+    EXPECT_TRUE(acked.get());
+    EXPECT_EQ(2 * i, received);
+  }
 
-//////////////////////////////////////////////////
-/// \brief Use two threads using their own transport nodes. One thread
-/// will publish a message, whereas the other thread is subscribed to the topic.
-/// Topic remapping is enabled.
-TEST(NodeTest, PubSubTwoThreadsSameTopicRemap)
-{
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options);
-}
+  // Type mismatch.
+  ignition::msgs::StringMsg wrong;
+  EXPECT_FALSE(pub.PublishAcked(wrong).get());
 
-//////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Process" scope.
-/// Topic remapping is enabled.
-TEST(NodeTest, ScopeProcessRemap)
-{
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
+  // An invalid publisher can't publish.
+  transport::Node::Publisher invalidPub;
+  EXPECT_FALSE(invalidPub.PublishAcked(msg).get());
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Host" scope.
-/// Topic remapping is enabled.
-TEST(NodeTest, ScopeHostRemap)
+/// \brief Check that the callbacks that don't run on the publish thread
+/// acknowledge a message once they ran, not once it's queued for them.
+TEST(NodeTest, PubAckedSubSpinCallbacks)
 {
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
+  transport::NodeOptions opts;
+  opts.SetSpinCallbacks(true);
+  transport::Node node(opts);
+  transport::Node pubNode;
+
+  std::atomic<int> received{0};
+  std::function<void(const ignition::msgs::Int32 &)> cb =
+    [&received](const ignition::msgs::Int32 &)
+    {
+      ++received;
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+  auto pub = pubNode.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  auto acked = pub.PublishAcked(msg);
+
+  // Queued for the node, which didn't spin yet.
+  EXPECT_EQ(std::future_status::timeout,
+    acked.wait_for(std::chrono::milliseconds(100)));
+  EXPECT_EQ(0, received);
+
+  EXPECT_EQ(1u, node.SpinSome());
+  ASSERT_EQ(std::future_status::ready,
+    acked.wait_for(std::chrono::seconds(5)));
+  EXPECT_TRUE(acked.get());
+  EXPECT_EQ(1, received);
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "All" scope.
-/// Topic remapping is enabled.
-TEST(NodeTest, ScopeAllRemap)
+/// \brief Check that a publisher is told when its first subscriber comes
+/// and when its last one leaves.
+TEST(NodeTest, PubMatchedCallback)
 {
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
+  std::mutex mutex;
+  std::condition_variable signal;
+  std::vector<bool> events;
+  auto waitEvents = [&](const std::size_t _size)
+    {
+      std::unique_lock<std::mutex> lk(mutex);
+      return signal.wait_for(lk, std::chrono::seconds(5),
+        [&]{return events.size() >= _size;});
+    };
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(pub.SetMatchedCallback(
+    [&](const bool _matched)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      events.push_back(_matched);
+      signal.notify_all();
+    }));
+
+  // Nobody listens yet.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_TRUE(events.empty());
+  }
+
+  // Only the first subscriber and the last one matter.
+  transport::Node subNode;
+  EXPECT_TRUE(subNode.Subscribe(g_topic, cb));
+  ASSERT_TRUE(waitEvents(1u));
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+  EXPECT_TRUE(subNode.Unsubscribe(g_topic));
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
+  ASSERT_TRUE(waitEvents(2u));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_EQ(std::vector<bool>({true, false}), events);
+    events.clear();
+  }
+
+  // A new callback is told right away about the current subscribers.
+  EXPECT_TRUE(subNode.Subscribe(g_topic, cb));
+  EXPECT_TRUE(pub.SetMatchedCallback(
+    [&](const bool _matched)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      events.push_back(!_matched);
+      signal.notify_all();
+    }));
+  ASSERT_TRUE(waitEvents(1u));
+
+  // Without callback, nothing is reported.
+  EXPECT_TRUE(pub.SetMatchedCallback(nullptr));
+  EXPECT_TRUE(subNode.Unsubscribe(g_topic));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_EQ(std::vector<bool>({false}), events);
+  }
+
+  transport::Node::Publisher invalidPub;
+  EXPECT_FALSE(invalidPub.SetMatchedCallback([](const bool){}));
 }
 
 //////////////////////////////////////////////////
-/// \brief Use two different transport nodes on the same thread. Check that
-/// both receive the updates when they are subscribed to the same topic. Check
-/// also that when one of the nodes unsubscribes, no longer receives updates.
-TEST(NodeTest, PubSubOneThreadTwoSubs)
+/// \brief Publish with a publisher whose type is checked at compile time.
+TEST(NodeTest, TypedPubSubSameThread)
 {
   reset();
 
   ignition::msgs::Int32 msg;
   msg.set_data(data);
 
-  transport::Node node1;
+  transport::Node node;
+  transport::Node::TypedPublisher<ignition::msgs::Int32> pub =
+    node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  // Only the subscribers of the advertised type and the generic ones get
+  // the messages.
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+  EXPECT_TRUE(node.Subscribe(g_topic, genericCb));
+  EXPECT_TRUE(node.Subscribe(g_topic, cbVector));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // The overloads checked at runtime are still available.
+  EXPECT_TRUE(pub.Publish(std::make_shared<ignition::msgs::Int32>(msg)));
+  ignition::msgs::Vector3d wrong;
+  EXPECT_FALSE(pub.Publish(wrong));
+
+  // A typed publisher is a publisher.
+  transport::Node::Publisher untyped = pub;
+  EXPECT_TRUE(untyped.Publish(msg));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(3, counter);
+  EXPECT_TRUE(genericCbExecuted);
+  EXPECT_FALSE(cbVectorExecuted);
+
+  // A default typed publisher isn't valid.
+  transport::Node::TypedPublisher<ignition::msgs::Int32> invalidPub;
+  EXPECT_FALSE(invalidPub);
+  EXPECT_FALSE(invalidPub.Publish(msg));
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish and subscribe to messages that aren't protobuf messages.
+TEST(NodeTest, PubSubSerializerSameThread)
+{
+  transport::Node node;
+  auto pub = node.Advertise<TrivialPose>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::vector<transport::MessagePublisher> publishers;
+  ASSERT_TRUE(node.TopicInfo(g_topic, publishers));
+  ASSERT_EQ(1u, publishers.size());
+  EXPECT_EQ("test.TrivialPose", publishers.front().MsgTypeName());
+
+  std::mutex mutex;
+  std::vector<TrivialPose> received;
+  std::function<void(const TrivialPose &, const transport::MessageInfo &)>
+    cb = [&](const TrivialPose &_msg, const transport::MessageInfo &_info)
+    {
+      EXPECT_EQ("test.TrivialPose", _info.Type());
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_msg);
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+
+  int shared = 0;
+  std::function<void(std::shared_ptr<const TrivialPose>,
+                     const transport::MessageInfo &)> sharedCb =
+    [&](std::shared_ptr<const TrivialPose> _msg,
+        const transport::MessageInfo &)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      shared += _msg->id;
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, sharedCb));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  TrivialPose pose{1.0, 2.0, 3.0, 4};
+  EXPECT_TRUE(pub.Publish(pose));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::lock_guard<std::mutex> lk(mutex);
+  ASSERT_EQ(1u, received.size());
+  EXPECT_DOUBLE_EQ(1.0, received.front().x);
+  EXPECT_DOUBLE_EQ(2.0, received.front().y);
+  EXPECT_DOUBLE_EQ(3.0, received.front().z);
+  EXPECT_EQ(4, received.front().id);
+  EXPECT_EQ(4, shared);
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish handles of device buffers, restricted to the host.
+TEST(NodeTest, PubSubDeviceBufferSameThread)
+{
+  transport::Node node;
+  auto pub = node.Advertise<transport::DeviceBufferHandle>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::vector<transport::MessagePublisher> publishers;
+  ASSERT_TRUE(node.TopicInfo(g_topic, publishers));
+  ASSERT_EQ(1u, publishers.size());
+  EXPECT_EQ(transport::Scope_t::HOST, publishers.front().Options().Scope());
+
+  std::mutex mutex;
+  std::vector<transport::DeviceBufferHandle> received;
+  std::function<void(const transport::DeviceBufferHandle &,
+                     const transport::MessageInfo &)> cb =
+    [&](const transport::DeviceBufferHandle &_msg,
+        const transport::MessageInfo &)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_msg);
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  const char ipc[] = "opaque handle";
+  EXPECT_TRUE(pub.Publish(
+    transport::DeviceBufferHandle::CudaIpc(ipc, sizeof(ipc), 1024u, 0)));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::lock_guard<std::mutex> lk(mutex);
+  ASSERT_EQ(1u, received.size());
+  EXPECT_EQ(transport::DeviceBufferKind::CUDA_IPC, received.front().kind);
+  EXPECT_EQ(1024u, received.front().size);
+  EXPECT_EQ(sizeof(ipc), received.front().handleSize);
+  EXPECT_STREQ(ipc, reinterpret_cast<const char *>(received.front().handle));
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish a batch of messages with Enqueue() and Flush().
+TEST(NodeTest, PubBatchSubSameThreadMessageInfo)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Nothing is published until the batch is flushed.
+  EXPECT_TRUE(pub.Enqueue(msg));
+  EXPECT_TRUE(pub.Enqueue(msg));
+  EXPECT_TRUE(pub.Enqueue(msg));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(cbExecuted);
+
+  EXPECT_TRUE(pub.Flush());
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Each message was received by both subscribers.
+  EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(6, counter);
+
+  reset();
+
+  // Flushing an empty batch is a no-op.
+  EXPECT_TRUE(pub.Flush());
+
+  // Type mismatch.
+  ignition::msgs::StringMsg strMsg;
+  EXPECT_FALSE(pub.Enqueue(strMsg));
+
+  // An invalid publisher can't queue messages.
+  transport::Node::Publisher invalidPub;
+  EXPECT_FALSE(invalidPub.Enqueue(msg));
+  EXPECT_FALSE(invalidPub.Flush());
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe to a topic using a lambda function.
+TEST(NodeTest, PubSubSameThreadLambda)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  bool executed = false;
+  std::function<void(const ignition::msgs::Int32&)> subCb =
+    [&executed, &mutex, &condition](const ignition::msgs::Int32 &_msg)
+  {
+    EXPECT_EQ(_msg.data(), data);
+    std::lock_guard<std::mutex> lk(mutex);
+    executed = true;
+    condition.notify_all();
+  };
+
+  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // The local publish is asynchronous, which means we need to wait
+  // for the callback.
+  std::unique_lock<std::mutex> lk(mutex);
+  condition.wait(lk, [&executed]{return executed;});
+
+  EXPECT_TRUE(executed);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe to a topic using a lambda function.
+/// This test uses a callback that accepts a parameter with the message
+/// information.
+TEST(NodeTest, PubSubSameThreadLambdaMessageInfo)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  bool executed = false;
+  std::function<void(const ignition::msgs::Int32&,
+                     const ignition::transport::MessageInfo &)> subCb =
+    [&executed](const ignition::msgs::Int32 &_msg,
+                const ignition::transport::MessageInfo &_info)
+  {
+    EXPECT_EQ(_info.Topic(), g_topic);
+    EXPECT_EQ(_msg.data(), data);
+    EXPECT_EQ(g_FQNPartition, _info.Partition());
+    EXPECT_EQ(_msg.GetTypeName(), _info.Type());
+    EXPECT_TRUE(_info.IntraProcess());
+    std::lock_guard<std::mutex> lk(cbMutex);
+    executed = true;
+    cbCondition.notify_all();
+  };
+
+  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  std::unique_lock<std::mutex> lk(cbMutex);
+  EXPECT_TRUE(pub.Publish(msg));
+  cbCondition.wait(lk, [&executed]{return executed;});
+
+  EXPECT_TRUE(executed);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe to a topic using a callback that shares the ownership of
+/// the message. The subscribers keep the message and receive the same
+/// instance.
+TEST(NodeTest, PubSubSameThreadSharedMessage)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node1;
+  transport::Node node2;
+
+  auto pub = node1.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::vector<std::shared_ptr<const ignition::msgs::Int32>> received;
+  auto subCb = [&received](
+    std::shared_ptr<const ignition::msgs::Int32> _msg,
+    const ignition::transport::MessageInfo &_info)
+  {
+    EXPECT_EQ(_info.Topic(), g_topic);
+    EXPECT_TRUE(_info.IntraProcess());
+    std::lock_guard<std::mutex> lk(cbMutex);
+    received.push_back(_msg);
+    cbCondition.notify_all();
+  };
+
+  EXPECT_TRUE(node1.Subscribe<ignition::msgs::Int32>(g_topic, subCb));
+  EXPECT_TRUE(node2.Subscribe<ignition::msgs::Int32>(g_topic, subCb));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  {
+    std::unique_lock<std::mutex> lk(cbMutex);
+    EXPECT_TRUE(pub.Publish(msg));
+    cbCondition.wait(lk, [&received]{return received.size() == 2u;});
+  }
+
+  // The message outlives the callbacks and wasn't copied per subscriber.
+  ASSERT_EQ(2u, received.size());
+  ASSERT_NE(nullptr, received[0]);
+  EXPECT_EQ(data, received[0]->data());
+  EXPECT_EQ(received[0], received[1]);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief A batched subscription receives the intra-process messages in
+/// batches of one.
+TEST(NodeTest, PubSubSameThreadBatch)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::vector<int> received;
+  std::vector<std::size_t> batchSizes;
+  transport::BatchMsgCallback<ignition::msgs::Int32> subCb =
+    [&received, &batchSizes](
+      const std::vector<const ignition::msgs::Int32 *> &_msgs,
+      const std::vector<ignition::transport::MessageInfo> &_infos)
+  {
+    ASSERT_EQ(_msgs.size(), _infos.size());
+    std::lock_guard<std::mutex> lk(cbMutex);
+    for (std::size_t i = 0; i < _msgs.size(); ++i)
+    {
+      EXPECT_EQ(_infos[i].Topic(), g_topic);
+      received.push_back(_msgs[i]->data());
+    }
+    batchSizes.push_back(_msgs.size());
+    cbCondition.notify_all();
+  };
+
+  EXPECT_TRUE(node.SubscribeBatch<ignition::msgs::Int32>(g_topic, subCb));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  {
+    std::unique_lock<std::mutex> lk(cbMutex);
+    EXPECT_TRUE(pub.Publish(msg));
+    EXPECT_TRUE(pub.Publish(msg));
+    cbCondition.wait(lk, [&received]{return received.size() == 2u;});
+  }
+
+  EXPECT_EQ(std::vector<int>({data, data}), received);
+  EXPECT_EQ(std::vector<std::size_t>({1u, 1u}), batchSizes);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish messages given up by the publisher. The local subscribers
+/// receive the published message itself instead of a copy.
+TEST(NodeTest, PubSubSameThreadOwnedMessage)
+{
+  reset();
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::vector<std::shared_ptr<const ignition::msgs::Int32>> received;
+  auto subCb = [&received](
+    std::shared_ptr<const ignition::msgs::Int32> _msg,
+    const ignition::transport::MessageInfo &)
+  {
+    std::lock_guard<std::mutex> lk(cbMutex);
+    received.push_back(_msg);
+    cbCondition.notify_all();
+  };
+  EXPECT_TRUE(node.Subscribe<ignition::msgs::Int32>(g_topic, subCb));
+
+  auto uniqueMsg = std::make_unique<ignition::msgs::Int32>();
+  uniqueMsg->set_data(data);
+  const ignition::msgs::Int32 *uniqueRaw = uniqueMsg.get();
+
+  auto sharedMsg = std::make_shared<ignition::msgs::Int32>();
+  sharedMsg->set_data(data + 1);
+
+  {
+    std::unique_lock<std::mutex> lk(cbMutex);
+    EXPECT_TRUE(pub.Publish(std::move(uniqueMsg)));
+    EXPECT_TRUE(pub.Publish(sharedMsg));
+    cbCondition.wait(lk, [&received]{return received.size() == 2u;});
+  }
+
+  ASSERT_EQ(2u, received.size());
+  EXPECT_EQ(uniqueRaw, received[0].get());
+  EXPECT_EQ(data, received[0]->data());
+  EXPECT_EQ(sharedMsg, received[1]);
+
+  // A null message isn't published.
+  std::shared_ptr<const ignition::msgs::Int32> nullMsg;
+  EXPECT_FALSE(pub.Publish(nullMsg));
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Nodes of different transport domains communicate as if they were
+/// in different processes.
+TEST(NodeTest, PubSubTransportDomains)
+{
+  transport::NodeOptions domainOpts;
+  domainOpts.SetDomain("domain1");
+  EXPECT_EQ(transport::NodeShared::Instance(),
+            transport::NodeShared::Instance(""));
+  EXPECT_NE(transport::NodeShared::Instance(),
+            transport::NodeShared::Instance("domain1"));
+  EXPECT_EQ(transport::NodeShared::Instance("domain1"),
+            transport::NodeShared::Instance("domain1"));
+
+  transport::Node pubNode;
+  transport::Node subNode(domainOpts);
+  auto pub = pubNode.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::mutex mutex;
+  std::vector<transport::MessageInfo> received;
+  std::function<void(const ignition::msgs::Int32 &,
+                     const transport::MessageInfo &)> cb =
+    [&](const ignition::msgs::Int32 &_msg,
+        const transport::MessageInfo &_info)
+    {
+      EXPECT_EQ(data, _msg.data());
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_info);
+    };
+  EXPECT_TRUE(subNode.Subscribe(g_topic, cb));
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  // The domains discover each other like remote processes.
+  bool done = false;
+  for (int i = 0; i < 50 && !done; ++i)
+  {
+    EXPECT_TRUE(pub.Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::lock_guard<std::mutex> lk(mutex);
+    done = !received.empty();
+  }
+
+  std::lock_guard<std::mutex> lk(mutex);
+  ASSERT_FALSE(received.empty());
+  EXPECT_FALSE(received.front().IntraProcess());
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe with inline delivery. The callbacks run on the
+/// publisher's thread before Publish() returns.
+TEST(NodeTest, PubSubInlineDelivery)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  const std::thread::id publisherThread = std::this_thread::get_id();
+  int received = 0;
+  int receivedRaw = 0;
+  std::function<void(const ignition::msgs::Int32&,
+                     const ignition::transport::MessageInfo &)> subCb =
+    [&](const ignition::msgs::Int32 &_msg,
+        const ignition::transport::MessageInfo &_info)
+  {
+    EXPECT_EQ(publisherThread, std::this_thread::get_id());
+    EXPECT_TRUE(_info.IntraProcess());
+    EXPECT_EQ(data, _msg.data());
+    ++received;
+  };
+
+  transport::SubscribeOptions opts;
+  opts.SetInlineDelivery(true);
+  EXPECT_TRUE(node.Subscribe(g_topic, subCb, opts));
+  EXPECT_TRUE(node.SubscribeRaw(g_topic,
+    [&](const char *, const std::size_t,
+        const ignition::transport::MessageInfo &_info)
+    {
+      EXPECT_EQ(publisherThread, std::this_thread::get_id());
+      EXPECT_TRUE(_info.IntraProcess());
+      ++receivedRaw;
+    }, msg.GetTypeName(), opts));
+
+  EXPECT_TRUE(pub.Publish(msg));
+  EXPECT_EQ(1, received);
+  EXPECT_EQ(1, receivedRaw);
+
+  // The messages published through a loaned buffer are also delivered
+  // inline.
+  const std::size_t msgSize = static_cast<std::size_t>(msg.ByteSizeLong());
+  char *buffer = pub.Loan(msgSize);
+  ASSERT_NE(nullptr, buffer);
+  ASSERT_TRUE(msg.SerializeToArray(buffer, static_cast<int>(msgSize)));
+  EXPECT_TRUE(pub.PublishLoaned(buffer, msgSize, msg.GetTypeName()));
+  EXPECT_EQ(2, received);
+  EXPECT_EQ(2, receivedRaw);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the callbacks of a node that spins only run when the
+/// application spins it, on the spinning thread and in order.
+TEST(NodeTest, PubSubSpinCallbacks)
+{
+  transport::NodeOptions opts;
+  opts.SetSpinCallbacks(true);
+  transport::Node node(opts);
+  transport::Node pubNode;
+
+  std::vector<int> received;
+  std::atomic<bool> otherThread(false);
+  const std::thread::id spinThread = std::this_thread::get_id();
+  std::function<void(const ignition::msgs::Int32 &)> spinCb =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      if (std::this_thread::get_id() != spinThread)
+        otherThread = true;
+      received.push_back(_msg.data());
+    };
+
+  // The queue options of the subscription don't apply.
+  transport::SubscribeOptions subOpts;
+  subOpts.SetQueueSize(1);
+  EXPECT_TRUE(node.Subscribe(g_topic, spinCb, subOpts));
+  auto pub = pubNode.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  ignition::msgs::Int32 msg;
+  for (int i = 0; i < 3; ++i)
+  {
+    msg.set_data(i);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+
+  // Nothing runs until the node spins.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(received.empty());
+#ifndef _WIN32
+  EXPECT_NE(-1, node.SpinFd());
+#endif
+  EXPECT_EQ(-1, pubNode.SpinFd());
+  EXPECT_EQ(0u, pubNode.SpinSome());
+
+  EXPECT_EQ(1u, node.SpinSome(1));
+  EXPECT_EQ(2u, node.SpinSome());
+  EXPECT_EQ(0u, node.SpinSome());
+  ASSERT_EQ(3u, received.size());
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(i, received[i]);
+
+  // The messages published while spinning are delivered before the
+  // deadline.
+  std::thread publisher([&pub, &msg]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    msg.set_data(3);
+    pub.Publish(msg);
+  });
+  const auto start = std::chrono::steady_clock::now();
+  while (received.size() < 4u &&
+         std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+  {
+    node.SpinUntil(std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(100));
+  }
+  publisher.join();
+  ASSERT_EQ(4u, received.size());
+  EXPECT_EQ(3, received.back());
+  EXPECT_FALSE(otherThread);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the execution time of the callbacks of the profiled
+/// subscriptions of a node.
+TEST(NodeTest, CallbackStats)
+{
+  transport::NodeOptions opts;
+  opts.SetSpinCallbacks(true);
+  transport::Node node(opts);
+
+  std::function<void(const ignition::msgs::Int32 &)> spinCb =
+    [](const ignition::msgs::Int32 &) {};
+  transport::SubscribeOptions subOpts;
+  subOpts.SetCallbackProfiling(true);
+  EXPECT_TRUE(node.Subscribe(g_topic, spinCb, subOpts));
+  EXPECT_TRUE(node.Subscribe(g_topic, spinCb));
+  EXPECT_TRUE(node.CallbackStats("/unknown").empty());
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  ignition::msgs::Int32 msg;
+  EXPECT_TRUE(pub.Publish(msg));
+  const auto start = std::chrono::steady_clock::now();
+  while (node.SpinSome() == 0 &&
+         std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Only the profiled subscription is timed.
+  auto stats = node.CallbackStats(g_topic);
+  ASSERT_EQ(1u, stats.size());
+  EXPECT_EQ(g_topic, stats[0].topic);
+  EXPECT_FALSE(stats[0].handlerUuid.empty());
+  EXPECT_EQ(1u, stats[0].duration.Count());
+  EXPECT_EQ(0u, stats[0].overBudget);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the counters of the local publish queues while a local
+/// callback is slower than the publisher.
+TEST(NodeTest, LocalPublishQueueCounters)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool released = false;
+  int received = 0;
+  std::function<void(const ignition::msgs::Int32 &)> subCb =
+    [&](const ignition::msgs::Int32 &)
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    cv.wait(lk, [&]{return released;});
+    ++received;
+    cv.notify_all();
+  };
+  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+
+  transport::NodeShared *shared = transport::NodeShared::Instance();
+  const uint64_t droppedBefore = shared->LocalPublishQueueDroppedMsgs();
+
+  const int kMessages = 10;
+  for (int i = 0; i < kMessages; ++i)
+    EXPECT_TRUE(pub.Publish(msg));
+
+  // The first message may already be in the callback.
+  EXPECT_GE(shared->LocalPublishQueueDepth(), 9u);
+  EXPECT_GE(shared->LocalPublishQueueHighWaterMark(), 9u);
+
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    released = true;
+    cv.notify_all();
+    EXPECT_TRUE(cv.wait_for(lk, std::chrono::seconds(5),
+      [&]{return received == kMessages;}));
+  }
+
+  EXPECT_EQ(0u, shared->LocalPublishQueueDepth());
+  EXPECT_EQ(droppedBefore, shared->LocalPublishQueueDroppedMsgs());
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Advertise two topics with the same name. It's not possible to do it
+/// within the same node but it's valid on separate nodes.
+TEST(NodeTest, AdvertiseTwoEqualTopics)
+{
+  transport::Node node1;
+  transport::Node node2;
+
+  auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub1);
+  auto pub2 = node1.Advertise<ignition::msgs::StringMsg>(g_topic);
+  EXPECT_FALSE(pub2);
+  auto pub3 = node2.Advertise<ignition::msgs::StringMsg>(g_topic);
+  EXPECT_TRUE(pub3);
+}
+
+//////////////////////////////////////////////////
+/// \brief Use two threads using their own transport nodes. One thread
+/// will publish a message, whereas the other thread is subscribed to the topic.
+TEST(NodeTest, PubSubTwoThreadsSameTopic)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Process" scope.
+TEST(NodeTest, ScopeProcess)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Host" scope.
+TEST(NodeTest, ScopeHost)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "All" scope.
+TEST(NodeTest, ScopeAll)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
+}
+
+//////////////////////////////////////////////////
+/// \brief Use two threads using their own transport nodes. One thread
+/// will publish a message, whereas the other thread is subscribed to the topic.
+/// Topic remapping is enabled.
+TEST(NodeTest, PubSubTwoThreadsSameTopicRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Process" scope.
+/// Topic remapping is enabled.
+TEST(NodeTest, ScopeProcessRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Host" scope.
+/// Topic remapping is enabled.
+TEST(NodeTest, ScopeHostRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "All" scope.
+/// Topic remapping is enabled.
+TEST(NodeTest, ScopeAllRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
+}
+
+//////////////////////////////////////////////////
+/// \brief Use two different transport nodes on the same thread. Check that
+/// both receive the updates when they are subscribed to the same topic. Check
+/// also that when one of the nodes unsubscribes, no longer receives updates.
+TEST(NodeTest, PubSubOneThreadTwoSubs)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node1;
   transport::Node node2;
 
   {
@@ -1528,155 +2504,532 @@ TEST(NodeTest, MultipleServiceCallWithoutInputAsync)
     ++i;
   }
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 3);
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 3);
+
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+
+  reset();
+}
+
+/// \brief Request multiple service calls without without waiting for a response
+/// \ at the same time.
+TEST(NodeTest, MultipleServiceWithoutOutputCallAsync)
+{
+  reset();
+
+  transport::Node node;
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  // Advertise an invalid service name.
+  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutOutput));
+
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutOutput));
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", req));
+
+  EXPECT_TRUE(node.Request(g_topic, req));
+
+  int i = 0;
+  while (i < 100 && !srvExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call was executed.
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Make another request.
+  reset();
+  EXPECT_TRUE(node.Request(g_topic, req));
+  EXPECT_TRUE(node.Request(g_topic, req));
+  EXPECT_TRUE(node.Request(g_topic, req));
+
+  i = 0;
+  while (i < 100 && counter < 3)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call was executed.
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 3);
+
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+}
+
+//////////////////////////////////////////////////
+/// \brief Make a synchronous service call.
+TEST(NodeTest, ServiceCallSync)
+{
+  reset();
+
+  ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  bool result;
+  unsigned int timeout = 1000;
+
+  req.set_data(data);
+
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", req, timeout, rep, result));
+
+  EXPECT_TRUE(node.Request(g_topic, req, timeout, rep, result));
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(result);
+  EXPECT_EQ(rep.data(), req.data());
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make a synchronous service call to a responser in the same process
+/// using generic messages, as "ign service" does.
+TEST(NodeTest, ServiceCallSyncGeneric)
+{
+  reset();
+
+  ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  transport::ProtoMsg &genericReq = req;
+  transport::ProtoMsg &genericRep = rep;
+  bool result;
+  unsigned int timeout = 1000;
+
+  req.set_data(data);
+
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  EXPECT_TRUE(node.Request(g_topic, genericReq, timeout, genericRep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(rep.data(), req.data());
+
+  // The types don't match the responser.
+  ignition::msgs::Vector3d wrongRep;
+  transport::ProtoMsg &genericWrongRep = wrongRep;
+  EXPECT_FALSE(node.Request(g_topic, genericReq, 100, genericWrongRep,
+    result));
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make a synchronous service call without input.
+TEST(NodeTest, ServiceCallWithoutInputSync)
+{
+  reset();
+
+  ignition::msgs::Int32 rep;
+  bool result;
+  unsigned int timeout = 1000;
+
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", timeout, rep, result));
+
+  EXPECT_TRUE(node.Request(g_topic, timeout, rep, result));
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(result);
+  EXPECT_EQ(rep.data(), data);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check a timeout in a synchronous service call.
+TEST(NodeTest, ServiceCallSyncTimeout)
+{
+  reset();
+
+  ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  bool result;
+  int64_t timeout = 1000;
+
+  req.set_data(data);
+
+  transport::Node node;
+
+  auto t1 = std::chrono::steady_clock::now();
+  bool executed = node.Request(g_topic, req, static_cast<unsigned int>(timeout),
+      rep, result);
+  auto t2 = std::chrono::steady_clock::now();
+
+  int64_t elapsed =
+    std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+
+  // Check if the elapsed time was close to the timeout.
+  auto diff = std::max(elapsed, timeout) - std::min(elapsed, timeout);
+  EXPECT_LE(diff, 200);
+
+  // Check that the service call response was not executed.
+  EXPECT_FALSE(executed);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make several synchronous service calls at once.
+TEST(NodeTest, ServiceCallAllSync)
+{
+  reset();
+
+  std::vector<ignition::msgs::Int32> reqs(10);
+  for (std::size_t i = 0; i < reqs.size(); ++i)
+    reqs[i].set_data(static_cast<int>(i));
+
+  std::vector<ignition::msgs::Int32> reps;
+  std::vector<bool> results;
+  unsigned int timeout = 1000;
+
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.RequestAll("invalid service", reqs, timeout, reps,
+    results));
 
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+  EXPECT_TRUE(node.RequestAll(g_topic, reqs, timeout, reps, results));
+  ASSERT_EQ(reqs.size(), reps.size());
+  ASSERT_EQ(reqs.size(), results.size());
+  for (std::size_t i = 0; i < reqs.size(); ++i)
+  {
+    EXPECT_TRUE(results[i]);
+    EXPECT_EQ(reqs[i].data(), reps[i].data());
+  }
 
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+  // No requests.
+  EXPECT_TRUE(node.RequestAll(g_topic, std::vector<ignition::msgs::Int32>(),
+    timeout, reps, results));
+  EXPECT_TRUE(reps.empty());
+  EXPECT_TRUE(results.empty());
 
   reset();
 }
 
-/// \brief Request multiple service calls without without waiting for a response
-/// \ at the same time.
-TEST(NodeTest, MultipleServiceWithoutOutputCallAsync)
+//////////////////////////////////////////////////
+/// \brief Make a service call that returns a handle to its response.
+TEST(NodeTest, ServiceCallFuture)
 {
   reset();
 
-  transport::Node node;
   ignition::msgs::Int32 req;
   req.set_data(data);
 
-  // Advertise an invalid service name.
-  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutOutput));
-
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutOutput));
+  transport::Node node;
 
   // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", req));
+  auto invalid = node.RequestAsync<ignition::msgs::Int32,
+    ignition::msgs::Int32>("invalid service", req);
+  ASSERT_TRUE(invalid.Valid());
+  EXPECT_TRUE(invalid.Ready());
+  EXPECT_FALSE(invalid.Get().executed);
 
-  EXPECT_TRUE(node.Request(g_topic, req));
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
 
-  int i = 0;
-  while (i < 100 && !srvExecuted)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+  auto future = node.RequestAsync<ignition::msgs::Int32,
+    ignition::msgs::Int32>(g_topic, req);
+  ASSERT_TRUE(future.WaitFor(1000));
+  auto result = future.Get();
+  EXPECT_TRUE(result.executed);
+  EXPECT_TRUE(result.result);
+  EXPECT_EQ(data, result.reply.data());
 
-  // Check that the service call was executed.
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
+  // Without input.
+  transport::Node node2;
+  EXPECT_TRUE(node2.Advertise(g_topic + "2", srvWithoutInput));
+  auto future2 = node2.RequestAsync<ignition::msgs::Int32>(g_topic + "2");
+  ASSERT_TRUE(future2.WaitFor(1000));
+  EXPECT_TRUE(future2.Get().result);
+  EXPECT_EQ(data, future2.Get().reply.data());
 
-  // Make another request.
   reset();
-  EXPECT_TRUE(node.Request(g_topic, req));
-  EXPECT_TRUE(node.Request(g_topic, req));
-  EXPECT_TRUE(node.Request(g_topic, req));
+}
 
-  i = 0;
-  while (i < 100 && counter < 3)
+//////////////////////////////////////////////////
+/// \brief Make a request to a streaming service.
+TEST(NodeTest, ServiceCallStream)
+{
+  reset();
+
+  ignition::msgs::Int32 req;
+  req.set_data(3);
+
+  transport::Node node;
+  std::function<bool(const ignition::msgs::Int32 &,
+    const std::function<bool(const ignition::msgs::Int32 &)> &)> stream =
+    [](const ignition::msgs::Int32 &_req,
+       const std::function<bool(const ignition::msgs::Int32 &)> &_write)
   {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+    ignition::msgs::Int32 chunk;
+    for (int i = 0; i < _req.data(); ++i)
+    {
+      chunk.set_data(i);
+      if (!_write(chunk))
+        return false;
+    }
+    return true;
+  };
+  EXPECT_TRUE(node.AdvertiseStream(g_topic, stream));
+
+  std::vector<int> chunks;
+  int doneCalls = 0;
+  bool result = false;
+  EXPECT_TRUE((node.RequestStream<ignition::msgs::Int32,
+    ignition::msgs::Int32>(g_topic, req,
+    [&chunks](const ignition::msgs::Int32 &_chunk)
+    {
+      chunks.push_back(_chunk.data());
+    },
+    [&doneCalls, &result](const bool _result)
+    {
+      result = _result;
+      ++doneCalls;
+    })));
 
-  // Check that the service call was executed.
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 3);
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), chunks);
+  EXPECT_EQ(1, doneCalls);
+  EXPECT_TRUE(result);
 
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+  // A regular service delivers its reply as a single chunk.
+  transport::Node node2;
+  EXPECT_TRUE(node2.Advertise(g_topic + "2", srvEcho));
+  chunks.clear();
+  req.set_data(data);
+  EXPECT_TRUE((node2.RequestStream<ignition::msgs::Int32,
+    ignition::msgs::Int32>(g_topic + "2", req,
+    [&chunks](const ignition::msgs::Int32 &_chunk)
+    {
+      chunks.push_back(_chunk.data());
+    },
+    [&doneCalls](const bool)
+    {
+      ++doneCalls;
+    })));
+  EXPECT_EQ(std::vector<int>({data}), chunks);
+  EXPECT_EQ(2, doneCalls);
 
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+  reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make a synchronous service call.
-TEST(NodeTest, ServiceCallSync)
+/// \brief Make service calls with serialized requests and responses.
+TEST(NodeTest, ServiceCallRaw)
 {
   reset();
 
   ignition::msgs::Int32 req;
-  ignition::msgs::Int32 rep;
-  bool result;
-  unsigned int timeout = 1000;
-
   req.set_data(data);
+  const std::string type = req.GetTypeName();
 
   transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+  int calls = 0;
+  EXPECT_TRUE(node.AdvertiseRaw(g_topic, type, type,
+    [&calls](const std::string &_req, std::string &_rep)
+    {
+      ++calls;
+      _rep = _req;
+      return true;
+    }));
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", req, timeout, rep, result));
+  // A typed requester sees a regular service.
+  ignition::msgs::Int32 rep;
+  bool result = false;
+  EXPECT_TRUE(node.Request(g_topic, req, 300, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(data, rep.data());
+  EXPECT_EQ(1, calls);
+
+  // A raw requester gets the bytes as they were written.
+  std::string response;
+  result = false;
+  EXPECT_TRUE(node.RequestRaw(g_topic, req.SerializeAsString(), type, type,
+    300, response, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(req.SerializeAsString(), response);
+  EXPECT_EQ(2, calls);
 
-  EXPECT_TRUE(node.Request(g_topic, req, timeout, rep, result));
+  // Typed services answer raw requests too.
+  transport::Node node2;
+  EXPECT_TRUE(node2.Advertise(g_topic + "2", srvEcho));
+  int responses = 0;
+  EXPECT_TRUE(node2.RequestRaw(g_topic + "2", req.SerializeAsString(),
+    type, type,
+    [&responses](const std::string &_rep, const bool _result)
+    {
+      EXPECT_TRUE(_result);
+      ignition::msgs::Int32 msg;
+      EXPECT_TRUE(msg.ParseFromString(_rep));
+      EXPECT_EQ(data, msg.data());
+      ++responses;
+    }));
+  EXPECT_EQ(1, responses);
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(result);
-  EXPECT_EQ(rep.data(), req.data());
+  // The types must match.
+  EXPECT_FALSE(node.RequestRaw(g_topic, req.SerializeAsString(), type,
+    "_unknown_", 100, response, result));
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make a synchronous service call without input.
-TEST(NodeTest, ServiceCallWithoutInputSync)
+/// \brief Check that an idempotent service reuses its responses and runs
+/// the identical concurrent requests once.
+TEST(NodeTest, ServiceCallCached)
 {
   reset();
 
+  std::atomic<int> calls{0};
+  std::function<bool(const ignition::msgs::Int32 &, ignition::msgs::Int32 &)>
+    cb = [&calls](const ignition::msgs::Int32 &_req,
+                  ignition::msgs::Int32 &_rep)
+    {
+      ++calls;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      _rep.set_data(_req.data());
+      return true;
+    };
+
+  transport::AdvertiseServiceOptions opts;
+  opts.SetResponseCacheTtl(200);
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, cb, opts));
+
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  // The identical requests made at the same time share one call.
+  auto request = [&node, &req]()
+  {
+    ignition::msgs::Int32 rep;
+    bool result = false;
+    EXPECT_TRUE(node.Request(g_topic, req, 500, rep, result));
+    EXPECT_TRUE(result);
+    EXPECT_EQ(data, rep.data());
+  };
+  std::thread other(request);
+  request();
+  other.join();
+  EXPECT_EQ(1, calls);
+
+  // The response is reused during its time to live.
+  request();
+  EXPECT_EQ(1, calls);
+
+  // Other requests run the callback.
   ignition::msgs::Int32 rep;
-  bool result;
-  unsigned int timeout = 1000;
+  bool result = false;
+  ignition::msgs::Int32 req2;
+  req2.set_data(data + 1);
+  EXPECT_TRUE(node.Request(g_topic, req2, 500, rep, result));
+  EXPECT_EQ(data + 1, rep.data());
+  EXPECT_EQ(2, calls);
 
-  transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+  // The responses expire.
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  request();
+  EXPECT_EQ(3, calls);
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", timeout, rep, result));
+  reset();
+}
 
-  EXPECT_TRUE(node.Request(g_topic, timeout, rep, result));
+//////////////////////////////////////////////////
+/// \brief Ping this process.
+TEST(NodeTest, Ping)
+{
+  reset();
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(result);
-  EXPECT_EQ(rep.data(), data);
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  std::chrono::nanoseconds rtt{-1};
+  std::chrono::nanoseconds offset{0};
+  ASSERT_TRUE(node.Ping(transport::NodeShared::Instance()->pUuid, 1000, rtt,
+    offset));
+  EXPECT_GE(rtt.count(), 0);
+  EXPECT_LT(std::chrono::abs(offset), std::chrono::seconds(1));
+
+  // Unknown processes don't answer.
+  EXPECT_FALSE(node.Ping("_unknown_process_", 100, rtt, offset));
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Check a timeout in a synchronous service call.
-TEST(NodeTest, ServiceCallSyncTimeout)
+/// \brief Prefetch services before their first request.
+TEST(NodeTest, PrefetchServices)
 {
   reset();
 
+  transport::Node node;
+  EXPECT_TRUE(node.PrefetchServices({g_topic}));
+  EXPECT_TRUE(node.PrefetchServices({g_topic, g_topic + "2"}, true));
+  EXPECT_TRUE(node.PrefetchServices({}));
+  EXPECT_FALSE(node.PrefetchServices({g_topic, "invalid topic"}));
+
+  // The services work as usual afterwards.
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
   ignition::msgs::Int32 req;
+  req.set_data(data);
   ignition::msgs::Int32 rep;
-  bool result;
-  int64_t timeout = 1000;
+  bool result = false;
+  EXPECT_TRUE(node.Request(g_topic, req, 300, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(data, rep.data());
 
-  req.set_data(data);
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check a timeout when making several synchronous service calls.
+TEST(NodeTest, ServiceCallAllSyncTimeout)
+{
+  reset();
+
+  std::vector<ignition::msgs::Int32> reqs(3);
+  std::vector<ignition::msgs::Int32> reps;
+  std::vector<bool> results;
+  int64_t timeout = 500;
 
   transport::Node node;
 
   auto t1 = std::chrono::steady_clock::now();
-  bool executed = node.Request(g_topic, req, static_cast<unsigned int>(timeout),
-      rep, result);
+  bool executed = node.RequestAll(g_topic, reqs,
+    static_cast<unsigned int>(timeout), reps, results);
   auto t2 = std::chrono::steady_clock::now();
 
   int64_t elapsed =
     std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
 
-  // Check if the elapsed time was close to the timeout.
+  // The requests share the timeout.
   auto diff = std::max(elapsed, timeout) - std::min(elapsed, timeout);
   EXPECT_LE(diff, 200);
 
-  // Check that the service call response was not executed.
   EXPECT_FALSE(executed);
+  ASSERT_EQ(reqs.size(), results.size());
+  for (auto result : results)
+    EXPECT_FALSE(result);
 
   reset();
 }
@@ -1944,6 +3297,78 @@ TEST(NodeTest, SubThrottled)
   reset();
 }
 
+//////////////////////////////////////////////////
+/// \brief A handler counting the messages it parses.
+class CountingHandler
+  : public transport::SubscriptionHandler<ignition::msgs::Int32>
+{
+  // Documentation inherited.
+  public: using transport::SubscriptionHandler<
+    ignition::msgs::Int32>::SubscriptionHandler;
+
+  // Documentation inherited.
+  public: const std::shared_ptr<transport::ProtoMsg> ParseMsg(
+    const char *_data, const std::size_t _size,
+    const std::string &_type) const override
+  {
+    ++this->parsed;
+    return transport::SubscriptionHandler<ignition::msgs::Int32>::ParseMsg(
+      _data, _size, _type);
+  }
+
+  /// \brief Number of messages parsed.
+  public: mutable std::atomic<int> parsed{0};
+};
+
+//////////////////////////////////////////////////
+/// \brief Check that the messages received for a throttled subscriber are
+/// only parsed when its callback would run.
+TEST(NodeTest, SubThrottledSkipsParsing)
+{
+  transport::SubscribeOptions opts;
+  opts.SetMsgsPerSec(1u);
+  auto handler = std::make_shared<CountingHandler>("node-UUID", opts);
+  int received = 0;
+  handler->SetCallback(transport::MsgCallback<ignition::msgs::Int32>(
+    [&received](const ignition::msgs::Int32 &,
+                const transport::MessageInfo &)
+    {
+      ++received;
+    }));
+
+  transport::NodeShared::HandlerInfo handlerInfo;
+  handlerInfo.localHandlers["node-UUID"][handler->HandlerUuid()] = handler;
+  handlerInfo.haveLocal = true;
+  handlerInfo.haveRaw = false;
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  const std::string serialized = msg.SerializeAsString();
+  transport::MessageInfo info;
+  info.SetTopic(g_topic);
+  info.SetType(msg.GetTypeName());
+
+  EXPECT_TRUE(handler->ThrottledUpdateReady());
+  for (int i = 0; i < 10; ++i)
+  {
+    transport::NodeShared::Instance()->TriggerCallbacks(info, serialized,
+      handlerInfo);
+  }
+
+  // Only the message delivered was parsed.
+  EXPECT_EQ(1, received);
+  EXPECT_EQ(1, handler->parsed);
+  EXPECT_FALSE(handler->ThrottledUpdateReady());
+
+  // Once the throttling period is over, the next message is parsed.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  EXPECT_TRUE(handler->ThrottledUpdateReady());
+  transport::NodeShared::Instance()->TriggerCallbacks(info, serialized,
+    handlerInfo);
+  EXPECT_EQ(2, received);
+  EXPECT_EQ(2, handler->parsed);
+}
+
 //////////////////////////////////////////////////
 /// \brief This test creates one publisher and one subscriber. The publisher
 /// publishes at a throttled frequency .
@@ -2163,6 +3588,176 @@ TEST(NodeTest, TopicList)
       (elapsed).count(), 2);
 }
 
+//////////////////////////////////////////////////
+/// \brief Advertise and subscribe to several topics at once.
+TEST(NodeTest, AdvertiseSubscribeMany)
+{
+  transport::Node node;
+  const std::vector<std::string> topics = {"/many1", "/many2", "/many3"};
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::set<std::string> received;
+  std::function<void(const ignition::msgs::Int32 &,
+                     const transport::MessageInfo &)> cbMany =
+    [&](const ignition::msgs::Int32 &, const transport::MessageInfo &_info)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      received.insert(_info.Topic());
+      condition.notify_all();
+    };
+
+  EXPECT_TRUE(node.SubscribeMany<ignition::msgs::Int32>(topics, cbMany));
+  EXPECT_EQ(3u, node.SubscribedTopics().size());
+
+  // The invalid and repeated topics don't get a publisher.
+  auto pubs = node.AdvertiseMany<ignition::msgs::Int32>(
+    {"/many1", "/many2", "/many3", "/many1", ""});
+  ASSERT_EQ(5u, pubs.size());
+  EXPECT_TRUE(pubs[0]);
+  EXPECT_TRUE(pubs[1]);
+  EXPECT_TRUE(pubs[2]);
+  EXPECT_FALSE(pubs[3]);
+  EXPECT_FALSE(pubs[4]);
+  EXPECT_EQ(3u, node.AdvertisedTopics().size());
+
+  // Topics can't be advertised twice.
+  EXPECT_FALSE(node.AdvertiseMany<ignition::msgs::Int32>({"/many1"})[0]);
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  for (std::size_t i = 0; i < 3u; ++i)
+    EXPECT_TRUE(pubs[i].Publish(msg));
+
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(2),
+      [&received]{return received.size() == 3u;}));
+  }
+
+  // The valid topics are subscribed even if some topics are invalid.
+  EXPECT_FALSE(node.SubscribeMany<ignition::msgs::Int32>(
+    {"", "/many4"}, cbMany));
+  EXPECT_EQ(4u, node.SubscribedTopics().size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a wildcard subscription receives the messages of the
+/// topics matching its pattern, advertised before or after subscribing.
+TEST(NodeTest, SubscribeRawWildcard)
+{
+  transport::Node node;
+
+  auto before = node.Advertise<ignition::msgs::Int32>("/wild/a");
+  ASSERT_TRUE(before);
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::set<std::string> received;
+  auto cb = [&](const char *, const std::size_t,
+                const transport::MessageInfo &_info)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      received.insert(_info.Topic());
+      condition.notify_all();
+    };
+
+  EXPECT_FALSE(node.SubscribeRawWildcard("/wild/**/a", cb));
+  EXPECT_TRUE(node.SubscribeRawWildcard("/wild/*", cb));
+  EXPECT_FALSE(node.SubscribeRawWildcard("/wild/*", cb));
+
+  auto after = node.Advertise<ignition::msgs::Int32>("/wild/b");
+  ASSERT_TRUE(after);
+  auto deeper = node.Advertise<ignition::msgs::Int32>("/wild/b/c");
+  ASSERT_TRUE(deeper);
+  EXPECT_EQ(2u, node.SubscribedTopics().size());
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  EXPECT_TRUE(before.Publish(msg));
+  EXPECT_TRUE(after.Publish(msg));
+  EXPECT_TRUE(deeper.Publish(msg));
+
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(2),
+      [&received]{return received.size() == 2u;}));
+    EXPECT_EQ(0u, received.count("/wild/b/c"));
+  }
+
+  // Removing the pattern removes the subscriptions it made.
+  EXPECT_TRUE(node.Unsubscribe("/wild/*"));
+  EXPECT_TRUE(node.SubscribedTopics().empty());
+  EXPECT_FALSE(node.Unsubscribe("/wild/*"));
+
+  // "**" matches the deeper topics too.
+  EXPECT_TRUE(node.SubscribeRawWildcard("/wild/**", cb));
+  EXPECT_EQ(3u, node.SubscribedTopics().size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the local subscribers of a transient local topic
+/// receive its latest message when they subscribe after it was published.
+TEST(NodeTest, TransientLocalLateSubscribers)
+{
+  transport::Node node;
+
+  transport::AdvertiseMessageOptions opts;
+  opts.SetDurability(transport::Durability_t::TRANSIENT_LOCAL);
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic, opts);
+  ASSERT_TRUE(pub);
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  EXPECT_TRUE(pub.Publish(msg));
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  int typed = 0;
+  int raw = 0;
+  std::function<void(const ignition::msgs::Int32 &)> cbTyped =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      EXPECT_EQ(data, _msg.data());
+      std::lock_guard<std::mutex> lk(mutex);
+      ++typed;
+      condition.notify_all();
+    };
+  auto cbRaw = [&](const char *_msgData, const std::size_t _size,
+                   const transport::MessageInfo &_info)
+    {
+      ignition::msgs::Int32 received;
+      EXPECT_TRUE(received.ParseFromArray(_msgData, static_cast<int>(_size)));
+      EXPECT_EQ(data, received.data());
+      EXPECT_EQ(g_topic, _info.Topic());
+      std::lock_guard<std::mutex> lk(mutex);
+      ++raw;
+      condition.notify_all();
+    };
+
+  transport::Node lateNode;
+  EXPECT_TRUE(lateNode.Subscribe(g_topic, cbTyped));
+  EXPECT_TRUE(lateNode.SubscribeRaw(g_topic, cbRaw,
+    msg.GetTypeName()));
+
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(2),
+      [&typed, &raw]{return typed == 1 && raw == 1;}));
+  }
+
+  // The subscribers of a volatile topic only receive the newer messages.
+  auto volatilePub = node.Advertise<ignition::msgs::Int32>("/volatile");
+  ASSERT_TRUE(volatilePub);
+  EXPECT_TRUE(volatilePub.Publish(msg));
+  EXPECT_TRUE(lateNode.Subscribe("/volatile", cbTyped));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::lock_guard<std::mutex> lk(mutex);
+  EXPECT_EQ(1, typed);
+  EXPECT_EQ(1, raw);
+}
+
 //////////////////////////////////////////////////
 /// \brief This test creates two nodes and advertises some topics. The test
 /// verifies that TopicList() returns the list of all the topics advertised.
@@ -2228,6 +3823,40 @@ TEST(NodeTest, ServiceListRemap)
   EXPECT_EQ(g_topic_remap, services.at(0));
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that unsubscribing and unadvertising a service use the same
+/// remapped name that subscribing and advertising used. The names are
+/// resolved through the node cache, so resolve them several times.
+TEST(NodeTest, UnsubscribeUnadvertiseRemap)
+{
+  transport::NodeOptions nodeOptions;
+  nodeOptions.AddTopicRemap(g_topic, g_topic_remap);
+  transport::Node node(nodeOptions);
+
+  for (int i = 0; i < 2; ++i)
+  {
+    EXPECT_TRUE(node.Subscribe(g_topic, cb));
+    auto subscribedTopics = node.SubscribedTopics();
+    ASSERT_EQ(1u, subscribedTopics.size());
+    EXPECT_EQ(g_topic_remap, subscribedTopics.at(0));
+
+    EXPECT_TRUE(node.Unsubscribe(g_topic));
+    EXPECT_TRUE(node.SubscribedTopics().empty());
+
+    EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+    auto advertisedServices = node.AdvertisedServices();
+    ASSERT_EQ(1u, advertisedServices.size());
+    EXPECT_EQ(g_topic_remap, advertisedServices.at(0));
+
+    EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+    EXPECT_TRUE(node.AdvertisedServices().empty());
+  }
+
+  // Invalid names are rejected every time.
+  EXPECT_FALSE(node.Subscribe("  ", cb));
+  EXPECT_FALSE(node.Subscribe("  ", cb));
+}
+
 //////////////////////////////////////////////////
 /// \brief Check bad topic remap use cases.
 TEST(NodeTest, WrongTopicRemap)
@@ -2302,6 +3931,67 @@ TEST(NodeTest, statistics)
   EXPECT_EQ(std::nullopt, node.TopicStats("/test"));
 }
 
+//////////////////////////////////////////////////
+/// \brief Test the publication of the transport metrics.
+TEST(NodeTest, metrics)
+{
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<std::string> names;
+  int metricsCount = 0;
+  std::function<void(const msgs::Metric &)> metricsCb =
+    [&](const msgs::Metric &_msg)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      names.clear();
+      for (const auto &stat : _msg.statistics())
+        names.push_back(stat.name());
+      ++metricsCount;
+      condition.notify_all();
+    };
+
+  transport::Node node;
+  EXPECT_TRUE(node.Subscribe("/test_metrics", metricsCb));
+
+  // Deliver a local message.
+  std::function<void(const msgs::Int32 &)> cb = [](const msgs::Int32 &){};
+  EXPECT_TRUE(node.Subscribe("/foo_metrics", cb));
+  auto pub = node.Advertise<msgs::Int32>("/foo_metrics");
+  msgs::Int32 msg;
+  EXPECT_TRUE(pub.Publish(msg));
+
+  EXPECT_TRUE(node.EnableMetrics(true, "/test_metrics", 20));
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(2),
+      [&]{return metricsCount >= 2;}));
+    auto has = [&names](const std::string &_name)
+    {
+      return std::find(names.begin(), names.end(), _name) != names.end();
+    };
+    EXPECT_TRUE(has("ign_transport_local_messages_delivered_total"));
+    EXPECT_TRUE(has("ign_transport_local_publish_queue_depth"));
+    EXPECT_TRUE(has("ign_transport_service_requests_in_flight"));
+    EXPECT_TRUE(
+      has("ign_transport_discovery_datagrams_received_total"
+        "{discovery=\"msg\"}"));
+  }
+
+  EXPECT_TRUE(node.EnableMetrics(false));
+  int count;
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    count = metricsCount;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  std::lock_guard<std::mutex> lk(mutex);
+  EXPECT_EQ(count, metricsCount);
+
+  const std::string text = transport::MetricsRegistry::Instance().OpenMetrics();
+  EXPECT_NE(std::string::npos,
+    text.find("# TYPE ign_transport_local_messages_delivered counter"));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/detail/PoolAllocator.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Object allocated through the pool.
+class Pooled
+{
+  /// \brief Constructor.
+  /// \param[in] _value Value stored.
+  public: explicit Pooled(const std::string &_value)
+    : value(_value)
+  {
+  }
+
+  /// \brief Value stored.
+  public: std::string value;
+
+  /// \brief Padding, gives the object a block size of its own.
+  public: char padding[333];
+};
+
+//////////////////////////////////////////////////
+/// \brief Check that the memory of released objects is reused.
+TEST(PoolAllocatorTest, Reuse)
+{
+  auto first = std::allocate_shared<Pooled>(PoolAllocator<Pooled>(), "a");
+  EXPECT_EQ("a", first->value);
+  const Pooled *address = first.get();
+
+  // A weak reference keeps the block allocated.
+  std::weak_ptr<Pooled> weak = first;
+  first.reset();
+  auto second = std::allocate_shared<Pooled>(PoolAllocator<Pooled>(), "b");
+  EXPECT_NE(address, second.get());
+  second.reset();
+
+  // The last block released is the first one reused.
+  weak.reset();
+  auto third = std::allocate_shared<Pooled>(PoolAllocator<Pooled>(), "c");
+  EXPECT_EQ("c", third->value);
+  EXPECT_EQ(address, third.get());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the limit of idle blocks.
+TEST(PoolAllocatorTest, MaxFreeBlocks)
+{
+  using FreeList = BlockFreeList<1000>;
+  const std::size_t initial = FreeList::Instance().FreeCount();
+
+  void *block = FreeList::Instance().Allocate();
+  ASSERT_NE(nullptr, block);
+  FreeList::Instance().Deallocate(block);
+  EXPECT_EQ(initial + 1u, FreeList::Instance().FreeCount());
+
+  std::vector<void *> blocks;
+  for (std::size_t i = 0; i < FreeList::kMaxFreeBlocks + 10u; ++i)
+    blocks.push_back(FreeList::Instance().Allocate());
+  EXPECT_EQ(0u, FreeList::Instance().FreeCount());
+
+  for (void *b : blocks)
+    FreeList::Instance().Deallocate(b);
+  EXPECT_EQ(FreeList::kMaxFreeBlocks, FreeList::Instance().FreeCount());
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Reliability.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace
+{
+  /// \brief Get the replier address that follows a separator in a control
+  /// field.
+  /// \param[in] _ctrl Control field of an advertisement.
+  /// \param[in] _separator Separator, e.g. kReliableCtrlSeparator.
+  /// \param[out] _addr Address of the service replier of the publisher.
+  /// \param[out] _id Socket ID of the service replier of the publisher.
+  /// \return True if the control field has the separator.
+  bool ParseReplierCtrl(const std::string &_ctrl,
+    const std::string &_separator, std::string &_addr, std::string &_id)
+  {
+    const auto start = _ctrl.find(_separator);
+    if (start == std::string::npos)
+      return false;
+
+    const auto begin = start + _separator.size();
+    const auto end = _ctrl.find(';', begin);
+    const std::string value = end == std::string::npos ?
+      _ctrl.substr(begin) : _ctrl.substr(begin, end - begin);
+    const auto comma = value.find(',');
+    if (comma == std::string::npos || comma == 0 || comma + 1 == value.size())
+      return false;
+
+    _addr = value.substr(0, comma);
+    _id = value.substr(comma + 1);
+    return true;
+  }
+}
+
+//////////////////////////////////////////////////
+std::string transport::ReliableCtrl(const std::string &_addr,
+  const std::string &_id)
+{
+  return kReliableCtrlSeparator + _addr + "," + _id;
+}
+
+//////////////////////////////////////////////////
+bool transport::ParseReliableCtrl(const std::string &_ctrl,
+  std::string &_addr, std::string &_id)
+{
+  return ParseReplierCtrl(_ctrl, kReliableCtrlSeparator, _addr, _id);
+}
+
+//////////////////////////////////////////////////
+std::string transport::AckCtrl(const std::string &_addr,
+  const std::string &_id)
+{
+  return kAckCtrlSeparator + _addr + "," + _id;
+}
+
+//////////////////////////////////////////////////
+bool transport::ParseAckCtrl(const std::string &_ctrl,
+  std::string &_addr, std::string &_id)
+{
+  return ParseReplierCtrl(_ctrl, kAckCtrlSeparator, _addr, _id);
+}
+
+//////////////////////////////////////////////////
+std::string transport::NackFrame(const std::vector<SeqRange> &_ranges)
+{
+  std::string frame;
+  for (const auto &range : _ranges)
+  {
+    if (!frame.empty())
+      frame += ",";
+    frame += std::to_string(range.first) + ":" + std::to_string(range.second);
+  }
+  return frame;
+}
+
+//////////////////////////////////////////////////
+bool transport::ParseNackFrame(const std::string &_frame,
+  std::vector<SeqRange> &_ranges)
+{
+  _ranges.clear();
+  if (_frame.empty())
+    return false;
+
+  std::size_t begin = 0;
+  while (begin <= _frame.size())
+  {
+    auto end = _frame.find(',', begin);
+    if (end == std::string::npos)
+      end = _frame.size();
+
+    const std::string range = _frame.substr(begin, end - begin);
+    const auto colon = range.find(':');
+    if (colon == std::string::npos || colon == 0 ||
+        colon + 1 == range.size() ||
+        range.find_first_not_of("0123456789:") != std::string::npos ||
+        range.find(':', colon + 1) != std::string::npos)
+    {
+      _ranges.clear();
+      return false;
+    }
+
+    try
+    {
+      const SeqRange seqs(std::stoull(range.substr(0, colon)),
+        std::stoull(range.substr(colon + 1)));
+      if (seqs.first > seqs.second)
+      {
+        _ranges.clear();
+        return false;
+      }
+      _ranges.push_back(seqs);
+    }
+    catch (std::out_of_range &)
+    {
+      _ranges.clear();
+      return false;
+    }
+
+    begin = end + 1;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+RetransmitBuffer::RetransmitBuffer(const std::size_t _capacity)
+  : capacity(std::max<std::size_t>(_capacity, 1u))
+{
+}
+
+//////////////////////////////////////////////////
+uint64_t RetransmitBuffer::Push(const std::shared_ptr<std::string> &_data,
+  const std::string &_typePrefix)
+{
+  const uint64_t seq = this->nextSeq++;
+  this->entries.push_back({seq, _data, _typePrefix});
+  while (this->entries.size() > this->capacity)
+    this->entries.pop_front();
+  return seq;
+}
+
+//////////////////////////////////////////////////
+std::vector<RetransmitBuffer::Entry> RetransmitBuffer::Range(
+  const SeqRange &_range) const
+{
+  std::vector<Entry> result;
+  if (this->entries.empty() || _range.first > _range.second)
+    return result;
+
+  // The sequence numbers retained are consecutive.
+  const uint64_t oldest = this->entries.front().seq;
+  const uint64_t newest = this->entries.back().seq;
+  const uint64_t first = std::max(_range.first, oldest);
+  const uint64_t last = std::min(_range.second, newest);
+  for (uint64_t seq = first; seq <= last && first <= last; ++seq)
+    result.push_back(this->entries[seq - oldest]);
+  return result;
+}
+
+//////////////////////////////////////////////////
+std::size_t RetransmitBuffer::Capacity() const
+{
+  return this->capacity;
+}
+
+//////////////////////////////////////////////////
+void RetransmitBuffer::SetCapacity(const std::size_t _capacity)
+{
+  this->capacity = std::max<std::size_t>(_capacity, 1u);
+  while (this->entries.size() > this->capacity)
+    this->entries.pop_front();
+}
+
+//////////////////////////////////////////////////
+GapTracker::GapTracker(const std::size_t _maxMissing)
+  : maxMissing(_maxMissing)
+{
+}
+
+//////////////////////////////////////////////////
+bool GapTracker::Received(const uint64_t _seq)
+{
+  if (!this->started)
+  {
+    this->started = true;
+    this->next = _seq + 1;
+    return true;
+  }
+
+  // A recovered message, a duplicate or a message given up.
+  if (_seq < this->next)
+    return this->missing.erase(_seq) > 0;
+
+  // Every message skipped is missing, but only the newest are tracked.
+  const uint64_t first = _seq - this->next > this->maxMissing ?
+    _seq - this->maxMissing : this->next;
+  for (uint64_t seq = first; seq < _seq; ++seq)
+    this->missing[seq] = Gap();
+  while (this->missing.size() > this->maxMissing)
+    this->missing.erase(this->missing.begin());
+
+  this->next = _seq + 1;
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::vector<SeqRange> GapTracker::Nacks(
+  const std::chrono::steady_clock::time_point &_now)
+{
+  std::vector<SeqRange> ranges;
+  for (auto it = this->missing.begin(); it != this->missing.end();)
+  {
+    Gap &gap = it->second;
+    if (gap.nacks > 0 && _now - gap.lastNack < kReliableNackInterval)
+    {
+      ++it;
+      continue;
+    }
+
+    // The publisher no longer has the message, or it's gone.
+    if (gap.nacks >= kReliableMaxNacks)
+    {
+      it = this->missing.erase(it);
+      continue;
+    }
+
+    ++gap.nacks;
+    gap.lastNack = _now;
+    if (!ranges.empty() && ranges.back().second + 1 == it->first)
+      ranges.back().second = it->first;
+    else
+      ranges.push_back({it->first, it->first});
+    ++it;
+  }
+  return ranges;
+}
+
+//////////////////////////////////////////////////
+std::size_t GapTracker::Missing() const
+{
+  return this->missing.size();
+}
+
+//////////////////////////////////////////////////
+bool transport::ParseAckFrame(const std::string &_frame, uint64_t &_id)
+{
+  if (_frame.empty() ||
+      _frame.find_first_not_of("0123456789") != std::string::npos)
+  {
+    return false;
+  }
+
+  try
+  {
+    _id = std::stoull(_frame);
+  }
+  catch (std::out_of_range &)
+  {
+    return false;
+  }
+  return _id != 0;
+}
+
+//////////////////////////////////////////////////
+PendingAcks::PendingAcks(const std::size_t _maxPending)
+  : maxPending(std::max<std::size_t>(_maxPending, 1u))
+{
+}
+
+//////////////////////////////////////////////////
+PendingAcks::~PendingAcks()
+{
+  for (auto &entry : this->entries)
+    entry.second.promise.set_value(false);
+}
+
+//////////////////////////////////////////////////
+uint64_t PendingAcks::Add(const std::set<std::string> &_processes,
+  const unsigned int _local, std::future<bool> &_future)
+{
+  if (_processes.empty() && _local == 0)
+  {
+    std::promise<bool> promise;
+    _future = promise.get_future();
+    promise.set_value(true);
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lk(this->mutex);
+
+  // Give up the oldest message.
+  if (this->entries.size() >= this->maxPending)
+  {
+    this->entries.begin()->second.promise.set_value(false);
+    this->entries.erase(this->entries.begin());
+  }
+
+  const uint64_t id = this->nextId++;
+  Entry &entry = this->entries[id];
+  entry.processes = _processes;
+  entry.local = _local;
+  _future = entry.promise.get_future();
+  return id;
+}
+
+//////////////////////////////////////////////////
+void PendingAcks::LocalDone(const uint64_t _id)
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  auto it = this->entries.find(_id);
+  if (it == this->entries.end() || it->second.local == 0)
+    return;
+
+  --it->second.local;
+  this->Update(it);
+}
+
+//////////////////////////////////////////////////
+void PendingAcks::Received(const uint64_t _id, const std::string &_pUuid)
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  auto it = this->entries.find(_id);
+  if (it == this->entries.end() || it->second.processes.erase(_pUuid) == 0)
+    return;
+
+  this->Update(it);
+}
+
+//////////////////////////////////////////////////
+void PendingAcks::Cancel(const uint64_t _id)
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  auto it = this->entries.find(_id);
+  if (it == this->entries.end())
+    return;
+
+  it->second.promise.set_value(false);
+  this->entries.erase(it);
+}
+
+//////////////////////////////////////////////////
+void PendingAcks::ProcessGone(const std::string &_pUuid)
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  for (auto it = this->entries.begin(); it != this->entries.end();)
+  {
+    auto next = std::next(it);
+    if (it->second.processes.erase(_pUuid) > 0)
+    {
+      it->second.failed = true;
+      this->Update(it);
+    }
+    it = next;
+  }
+}
+
+//////////////////////////////////////////////////
+std::size_t PendingAcks::Size() const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return this->entries.size();
+}
+
+//////////////////////////////////////////////////
+void PendingAcks::Update(std::map<uint64_t, Entry>::iterator _it)
+{
+  if (!_it->second.processes.empty() || _it->second.local > 0)
+    return;
+
+  _it->second.promise.set_value(!_it->second.failed);
+  this->entries.erase(_it);
+}
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_RELIABILITY_HH_
+#define IGN_TRANSPORT_RELIABILITY_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Prefix of the message type frame of a publication on a
+    /// reliable topic. A frame with a ReliableHeader follows the message
+    /// type frame.
+    static const std::string kReliableMsgTypePrefix = "@rel@";
+
+    /// \brief Flag of the address registered by a subscriber that is able
+    /// to request the messages it missed on a reliable topic.
+    static const std::string kReliableAddrFlag = "?rel";
+
+    /// \brief Separator of the address that receives the requests for
+    /// missing messages, which follows the topic ID in the control field of
+    /// the advertisement of a reliable topic.
+    static const std::string kReliableCtrlSeparator = ";nack:";
+
+    /// \brief Request type of the service messages requesting missing
+    /// messages of a reliable topic. Older publishers don't have a service
+    /// with this type, so they ignore the message.
+    static const std::string kReliableNackType =
+      "ignition.transport.ReliableNack";
+
+    /// \brief Maximum number of missing messages tracked per publisher.
+    static const std::size_t kReliableMaxMissing = 1000;
+
+    /// \brief Maximum number of requests for a missing message.
+    static const unsigned int kReliableMaxNacks = 5;
+
+    /// \brief Time between two requests for a missing message.
+    static const std::chrono::milliseconds kReliableNackInterval(100);
+
+    /// \brief Flag of the address registered by a subscriber that
+    /// acknowledges the messages published with PublishAcked().
+    static const std::string kAckAddrFlag = "?ack";
+
+    /// \brief Separator of the address that receives the acknowledgements,
+    /// which follows the topic ID in the control field of the advertisement
+    /// of an acknowledged topic.
+    static const std::string kAckCtrlSeparator = ";ack:";
+
+    /// \brief Request type of the service messages acknowledging a message.
+    static const std::string kAckType = "ignition.transport.PublishAck";
+
+    /// \brief Maximum number of messages waiting for acknowledgements per
+    /// process. The oldest are given up first.
+    static const std::size_t kMaxPendingAcks = 1000;
+
+    /// \brief Sequence number of a message of a reliable topic.
+    struct ReliableHeader
+    {
+      /// \brief Sequence number, consecutive for each topic and publisher
+      /// process.
+      uint64_t seq = 0;
+    };
+
+    /// \brief Range of sequence numbers, both included.
+    using SeqRange = std::pair<uint64_t, uint64_t>;
+
+    /// \brief Get the part of the control field of an advertisement that
+    /// carries the address receiving the requests for missing messages.
+    /// \param[in] _addr Address of the service replier of the publisher.
+    /// \param[in] _id Socket ID of the service replier of the publisher.
+    /// \return The part of the control field, appended to TopicIdCtrl().
+    IGNITION_TRANSPORT_VISIBLE std::string ReliableCtrl(
+      const std::string &_addr, const std::string &_id);
+
+    /// \brief Get the address receiving the requests for missing messages
+    /// advertised in a control field.
+    /// \param[in] _ctrl Control field of an advertisement.
+    /// \param[out] _addr Address of the service replier of the publisher.
+    /// \param[out] _id Socket ID of the service replier of the publisher.
+    /// \return True if the topic is reliable.
+    IGNITION_TRANSPORT_VISIBLE bool ParseReliableCtrl(
+      const std::string &_ctrl, std::string &_addr, std::string &_id);
+
+    /// \brief Get the part of the control field of an advertisement that
+    /// carries the address receiving the acknowledgements.
+    /// \param[in] _addr Address of the service replier of the publisher.
+    /// \param[in] _id Socket ID of the service replier of the publisher.
+    /// \return The part of the control field, appended to TopicIdCtrl().
+    IGNITION_TRANSPORT_VISIBLE std::string AckCtrl(
+      const std::string &_addr, const std::string &_id);
+
+    /// \brief Get the address receiving the acknowledgements advertised in
+    /// a control field.
+    /// \param[in] _ctrl Control field of an advertisement.
+    /// \param[out] _addr Address of the service replier of the publisher.
+    /// \param[out] _id Socket ID of the service replier of the publisher.
+    /// \return True if the topic is acknowledged.
+    IGNITION_TRANSPORT_VISIBLE bool ParseAckCtrl(
+      const std::string &_ctrl, std::string &_addr, std::string &_id);
+
+    /// \brief Get the request frame of a request for missing messages.
+    /// \param[in] _ranges Sequence numbers of the missing messages.
+    /// \return The frame, e.g. "3:5,9:9".
+    IGNITION_TRANSPORT_VISIBLE std::string NackFrame(
+      const std::vector<SeqRange> &_ranges);
+
+    /// \brief Get the sequence numbers requested by a request frame.
+    /// \param[in] _frame Request frame created with NackFrame().
+    /// \param[out] _ranges Sequence numbers of the missing messages.
+    /// \return False if _frame is invalid.
+    IGNITION_TRANSPORT_VISIBLE bool ParseNackFrame(const std::string &_frame,
+      std::vector<SeqRange> &_ranges);
+
+    /// \brief Parse the request frame of an acknowledgement, the ID of the
+    /// message in decimal.
+    /// \param[in] _frame Request frame.
+    /// \param[out] _id ID of the message.
+    /// \return False if _frame is invalid.
+    IGNITION_TRANSPORT_VISIBLE bool ParseAckFrame(const std::string &_frame,
+      uint64_t &_id);
+
+    /// \class RetransmitBuffer Reliability.hh
+    /// \brief Latest messages published on a reliable topic, sent again to
+    /// the subscribers that missed them. It isn't thread safe.
+    class IGNITION_TRANSPORT_VISIBLE RetransmitBuffer
+    {
+      /// \brief A message retained.
+      public: struct Entry
+              {
+                /// \brief Sequence number of the message.
+                uint64_t seq = 0;
+
+                /// \brief Data frame, as it was sent.
+                std::shared_ptr<std::string> data;
+
+                /// \brief Prefixes of the message type frame, e.g. when the
+                /// message was compressed.
+                std::string typePrefix;
+              };
+
+      /// \brief Constructor.
+      /// \param[in] _capacity Maximum number of messages retained.
+      public: explicit RetransmitBuffer(const std::size_t _capacity);
+
+      /// \brief Retain a message, dropping the oldest if the buffer is full.
+      /// \param[in] _data Data frame of the message.
+      /// \param[in] _typePrefix Prefixes of the message type frame.
+      /// \return The sequence number assigned to the message.
+      public: uint64_t Push(const std::shared_ptr<std::string> &_data,
+                            const std::string &_typePrefix);
+
+      /// \brief Get the messages retained within a range of sequence
+      /// numbers. The messages already dropped are skipped.
+      /// \param[in] _range Sequence numbers requested.
+      /// \return The messages, in order.
+      public: std::vector<Entry> Range(const SeqRange &_range) const;
+
+      /// \brief Get the maximum number of messages retained.
+      /// \return The capacity.
+      public: std::size_t Capacity() const;
+
+      /// \brief Set the maximum number of messages retained. The oldest
+      /// messages are dropped if needed.
+      /// \param[in] _capacity Maximum number of messages retained, at
+      /// least 1.
+      public: void SetCapacity(const std::size_t _capacity);
+
+      /// \brief Maximum number of messages retained.
+      private: std::size_t capacity;
+
+      /// \brief Sequence number of the next message.
+      private: uint64_t nextSeq = 0;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Messages retained, oldest first.
+      private: std::deque<Entry> entries;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+
+    /// \class GapTracker Reliability.hh
+    /// \brief Tracks the sequence numbers received from a publisher of a
+    /// reliable topic, to find the missing messages and to drop the
+    /// messages received twice. The first message received sets the start
+    /// of the sequence, earlier messages aren't requested.
+    class IGNITION_TRANSPORT_VISIBLE GapTracker
+    {
+      /// \brief Constructor.
+      /// \param[in] _maxMissing Maximum number of missing messages tracked.
+      /// The oldest are given up first.
+      public: explicit GapTracker(
+        const std::size_t _maxMissing = kReliableMaxMissing);
+
+      /// \brief Record a message received.
+      /// \param[in] _seq Sequence number of the message.
+      /// \return False if the message was already received, or given up.
+      public: bool Received(const uint64_t _seq);
+
+      /// \brief Get the missing messages to request now. Each message is
+      /// requested every kReliableNackInterval, at most kReliableMaxNacks
+      /// times.
+      /// \param[in] _now Current time.
+      /// \return Ranges of sequence numbers, in order.
+      public: std::vector<SeqRange> Nacks(
+        const std::chrono::steady_clock::time_point &_now);
+
+      /// \brief Number of missing messages tracked.
+      /// \return The number of messages.
+      public: std::size_t Missing() const;
+
+      /// \brief A missing message.
+      private: struct Gap
+               {
+                 /// \brief Number of requests sent.
+                 unsigned int nacks = 0;
+
+                 /// \brief Time of the latest request.
+                 std::chrono::steady_clock::time_point lastNack;
+               };
+
+      /// \brief Maximum number of missing messages tracked.
+      private: std::size_t maxMissing;
+
+      /// \brief Whether a message was received.
+      private: bool started = false;
+
+      /// \brief Sequence number of the next message expected.
+      private: uint64_t next = 0;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Missing messages, by sequence number.
+      private: std::map<uint64_t, Gap> missing;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+
+    /// \class PendingAcks Reliability.hh
+    /// \brief Messages published with PublishAcked() that are waiting for
+    /// the acknowledgements of their subscribers. Each message waits for
+    /// its local deliveries and for one acknowledgement per remote
+    /// subscriber process. It's thread safe.
+    class IGNITION_TRANSPORT_VISIBLE PendingAcks
+    {
+      /// \brief Constructor.
+      /// \param[in] _maxPending Maximum number of messages waiting. The
+      /// oldest are completed with false first.
+      public: explicit PendingAcks(
+        const std::size_t _maxPending = kMaxPendingAcks);
+
+      /// \brief Destructor. The messages still waiting are completed with
+      /// false.
+      public: ~PendingAcks();
+
+      /// \brief Wait for the acknowledgements of a message.
+      /// \param[in] _processes UUIDs of the remote subscriber processes.
+      /// \param[in] _local Number of local deliveries.
+      /// \param[out] _future Completed with true once all the subscribers
+      /// acknowledged the message, or with false if one of them left.
+      /// \return ID of the message, or 0 if there is nothing to wait for, in
+      /// which case _future is ready.
+      public: uint64_t Add(const std::set<std::string> &_processes,
+                           const unsigned int _local,
+                           std::future<bool> &_future);
+
+      /// \brief Record a local delivery of a message.
+      /// \param[in] _id ID of the message.
+      public: void LocalDone(const uint64_t _id);
+
+      /// \brief Record the acknowledgement of a remote subscriber.
+      /// \param[in] _id ID of the message.
+      /// \param[in] _pUuid UUID of the subscriber process.
+      public: void Received(const uint64_t _id, const std::string &_pUuid);
+
+      /// \brief Stop waiting for a message, which is completed with false,
+      /// e.g. because it couldn't be sent.
+      /// \param[in] _id ID of the message.
+      public: void Cancel(const uint64_t _id);
+
+      /// \brief Stop waiting for a process that left. The messages that
+      /// waited for it are completed with false.
+      /// \param[in] _pUuid UUID of the process.
+      public: void ProcessGone(const std::string &_pUuid);
+
+      /// \brief Get the number of messages waiting.
+      /// \return The number of messages.
+      public: std::size_t Size() const;
+
+      /// \brief A message waiting.
+      private: struct Entry
+               {
+                 /// \brief Completed once nothing is left to wait for.
+                 std::promise<bool> promise;
+
+                 /// \brief Remote processes that didn't acknowledge yet.
+                 std::set<std::string> processes;
+
+                 /// \brief Local deliveries left.
+                 unsigned int local = 0;
+
+                 /// \brief Whether a subscriber left.
+                 bool failed = false;
+               };
+
+      /// \brief Complete a message if nothing is left to wait for. Must be
+      /// called with the mutex locked.
+      /// \param[in] _it The message.
+      private: void Update(std::map<uint64_t, Entry>::iterator _it);
+
+      /// \brief Maximum number of messages waiting.
+      private: std::size_t maxPending;
+
+      /// \brief ID of the next message.
+      private: uint64_t nextId = 1;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Protects the members.
+      private: mutable std::mutex mutex;
+
+      /// \brief Messages waiting, by ID.
+      private: std::map<uint64_t, Entry> entries;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
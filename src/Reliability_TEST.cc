@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Reliability.hh"
+#include "TopicAlias.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the control field and the request frames.
+TEST(ReliabilityTest, Frames)
+{
+  const std::string ctrl =
+    TopicIdCtrl(3, "239.255.0.7:11320") + ReliableCtrl("tcp://h:1", "id");
+  std::string addr;
+  std::string id;
+  EXPECT_TRUE(ParseReliableCtrl(ctrl, addr, id));
+  EXPECT_EQ("tcp://h:1", addr);
+  EXPECT_EQ("id", id);
+  EXPECT_EQ("239.255.0.7:11320", ParseMulticastCtrl(ctrl));
+
+  EXPECT_FALSE(ParseReliableCtrl(TopicIdCtrl(3), addr, id));
+  EXPECT_FALSE(ParseReliableCtrl("id:3;nack:", addr, id));
+  EXPECT_FALSE(ParseReliableCtrl("id:3;nack:tcp://h:1", addr, id));
+  EXPECT_FALSE(ParseReliableCtrl("id:3;nack:,id", addr, id));
+
+  // Both replier addresses can be advertised.
+  const std::string ackCtrl = ctrl + AckCtrl("tcp://h:2", "id2");
+  EXPECT_TRUE(ParseAckCtrl(ackCtrl, addr, id));
+  EXPECT_EQ("tcp://h:2", addr);
+  EXPECT_EQ("id2", id);
+  EXPECT_TRUE(ParseReliableCtrl(ackCtrl, addr, id));
+  EXPECT_EQ("tcp://h:1", addr);
+  EXPECT_FALSE(ParseAckCtrl(ctrl, addr, id));
+  EXPECT_FALSE(ParseAckCtrl("id:3;ack:", addr, id));
+
+  std::vector<SeqRange> ranges;
+  EXPECT_EQ("3:5,9:9", NackFrame({{3, 5}, {9, 9}}));
+  EXPECT_TRUE(ParseNackFrame("3:5,9:9", ranges));
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(SeqRange(3, 5), ranges[0]);
+  EXPECT_EQ(SeqRange(9, 9), ranges[1]);
+
+  EXPECT_FALSE(ParseNackFrame("", ranges));
+  EXPECT_FALSE(ParseNackFrame("3", ranges));
+  EXPECT_FALSE(ParseNackFrame("5:3", ranges));
+  EXPECT_FALSE(ParseNackFrame("3:5,", ranges));
+  EXPECT_FALSE(ParseNackFrame("3:-5", ranges));
+  EXPECT_FALSE(ParseNackFrame("1:99999999999999999999999", ranges));
+  EXPECT_TRUE(ranges.empty());
+
+  uint64_t ackId = 0;
+  EXPECT_TRUE(ParseAckFrame(std::to_string(42u), ackId));
+  EXPECT_EQ(42u, ackId);
+  EXPECT_FALSE(ParseAckFrame("", ackId));
+  EXPECT_FALSE(ParseAckFrame("0", ackId));
+  EXPECT_FALSE(ParseAckFrame("-3", ackId));
+  EXPECT_FALSE(ParseAckFrame("99999999999999999999999", ackId));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the buffer retains the latest messages.
+TEST(ReliabilityTest, RetransmitBuffer)
+{
+  RetransmitBuffer buffer(3);
+  EXPECT_EQ(3u, buffer.Capacity());
+  EXPECT_TRUE(buffer.Range({0, 10}).empty());
+
+  for (int i = 0; i < 5; ++i)
+  {
+    auto data = std::make_shared<std::string>(std::to_string(i));
+    EXPECT_EQ(static_cast<uint64_t>(i), buffer.Push(data, "@zlib@"));
+  }
+
+  // The first two messages were dropped.
+  auto entries = buffer.Range({0, 10});
+  ASSERT_EQ(3u, entries.size());
+  EXPECT_EQ(2u, entries[0].seq);
+  EXPECT_EQ("2", *entries[0].data);
+  EXPECT_EQ("@zlib@", entries[0].typePrefix);
+  EXPECT_EQ(4u, entries[2].seq);
+
+  entries = buffer.Range({3, 3});
+  ASSERT_EQ(1u, entries.size());
+  EXPECT_EQ("3", *entries[0].data);
+  EXPECT_TRUE(buffer.Range({0, 1}).empty());
+  EXPECT_TRUE(buffer.Range({5, 8}).empty());
+
+  buffer.SetCapacity(0);
+  EXPECT_EQ(1u, buffer.Capacity());
+  entries = buffer.Range({0, 10});
+  ASSERT_EQ(1u, entries.size());
+  EXPECT_EQ(4u, entries[0].seq);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the detection of the missing messages.
+TEST(ReliabilityTest, GapTracker)
+{
+  GapTracker tracker(4);
+  auto now = std::chrono::steady_clock::now();
+
+  // The sequence starts with the first message received.
+  EXPECT_TRUE(tracker.Received(10));
+  EXPECT_TRUE(tracker.Received(11));
+  EXPECT_FALSE(tracker.Received(11));
+  EXPECT_EQ(0u, tracker.Missing());
+  EXPECT_TRUE(tracker.Nacks(now).empty());
+
+  // 12, 13 and 15 are missing.
+  EXPECT_TRUE(tracker.Received(14));
+  EXPECT_TRUE(tracker.Received(16));
+  EXPECT_EQ(3u, tracker.Missing());
+  auto nacks = tracker.Nacks(now);
+  ASSERT_EQ(2u, nacks.size());
+  EXPECT_EQ(SeqRange(12, 13), nacks[0]);
+  EXPECT_EQ(SeqRange(15, 15), nacks[1]);
+
+  // The requests aren't repeated right away.
+  EXPECT_TRUE(tracker.Nacks(now).empty());
+
+  // Recovered messages are delivered once.
+  EXPECT_TRUE(tracker.Received(13));
+  EXPECT_FALSE(tracker.Received(13));
+  EXPECT_EQ(2u, tracker.Missing());
+
+  // The requests are repeated until they are given up.
+  for (unsigned int i = 1; i < kReliableMaxNacks; ++i)
+  {
+    now += kReliableNackInterval;
+    nacks = tracker.Nacks(now);
+    ASSERT_EQ(2u, nacks.size());
+    EXPECT_EQ(SeqRange(12, 12), nacks[0]);
+  }
+  now += kReliableNackInterval;
+  EXPECT_TRUE(tracker.Nacks(now).empty());
+  EXPECT_EQ(0u, tracker.Missing());
+  EXPECT_FALSE(tracker.Received(12));
+
+  // Only the newest missing messages are tracked.
+  EXPECT_TRUE(tracker.Received(100));
+  EXPECT_EQ(4u, tracker.Missing());
+  nacks = tracker.Nacks(now);
+  ASSERT_EQ(1u, nacks.size());
+  EXPECT_EQ(SeqRange(96, 99), nacks[0]);
+  EXPECT_FALSE(tracker.Received(50));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the messages complete once all their subscribers
+/// acknowledged them.
+TEST(ReliabilityTest, PendingAcks)
+{
+  PendingAcks acks(2u);
+  std::future<bool> future;
+
+  // Nothing to wait for.
+  EXPECT_EQ(0u, acks.Add({}, 0u, future));
+  ASSERT_EQ(std::future_status::ready,
+    future.wait_for(std::chrono::seconds(0)));
+  EXPECT_TRUE(future.get());
+
+  // Two processes and one local delivery.
+  const uint64_t id = acks.Add({"p1", "p2"}, 1u, future);
+  EXPECT_NE(0u, id);
+  EXPECT_EQ(1u, acks.Size());
+  acks.Received(id, "p1");
+  acks.Received(id, "p1");
+  acks.Received(id, "unknown");
+  acks.LocalDone(id);
+  EXPECT_EQ(std::future_status::timeout,
+    future.wait_for(std::chrono::seconds(0)));
+  acks.Received(id, "p2");
+  ASSERT_EQ(std::future_status::ready,
+    future.wait_for(std::chrono::seconds(0)));
+  EXPECT_TRUE(future.get());
+  EXPECT_EQ(0u, acks.Size());
+
+  // A process leaves.
+  const uint64_t left = acks.Add({"p1", "p2"}, 0u, future);
+  acks.ProcessGone("p2");
+  acks.Received(left, "p1");
+  EXPECT_FALSE(future.get());
+
+  // A message that couldn't be sent.
+  const uint64_t cancelled = acks.Add({"p1"}, 1u, future);
+  acks.Cancel(cancelled);
+  EXPECT_FALSE(future.get());
+
+  // The oldest message is given up.
+  std::future<bool> first;
+  std::future<bool> second;
+  std::future<bool> third;
+  acks.Add({"p1"}, 0u, first);
+  acks.Add({"p1"}, 0u, second);
+  acks.Add({"p1"}, 0u, third);
+  EXPECT_EQ(2u, acks.Size());
+  EXPECT_FALSE(first.get());
+  EXPECT_EQ(std::future_status::timeout,
+    second.wait_for(std::chrono::seconds(0)));
+
+  // The messages still waiting fail when the process exits.
+  {
+    PendingAcks shortLived;
+    shortLived.Add({"p1"}, 0u, first);
+  }
+  EXPECT_FALSE(first.get());
+}
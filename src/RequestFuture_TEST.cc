@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/int32.pb.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "ignition/transport/RequestFuture.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+using Future = RequestFuture<msgs::Int32>;
+
+//////////////////////////////////////////////////
+/// \brief Check a handle that doesn't refer to a request.
+TEST(RequestFutureTest, Invalid)
+{
+  Future future;
+  EXPECT_FALSE(future.Valid());
+  EXPECT_FALSE(future.Ready());
+  EXPECT_FALSE(future.WaitFor(1));
+  EXPECT_FALSE(future.Get().executed);
+  EXPECT_FALSE(future.Then([](const RequestResult<msgs::Int32> &){}));
+}
+
+//////////////////////////////////////////////////
+/// \brief Complete a request from another thread.
+TEST(RequestFutureTest, Complete)
+{
+  auto state = std::make_shared<Future::State>();
+  Future future(state);
+  EXPECT_TRUE(future.Valid());
+  EXPECT_FALSE(future.Ready());
+  EXPECT_FALSE(future.WaitFor(10));
+
+  int thenCalls = 0;
+  EXPECT_TRUE(future.Then([&thenCalls](const RequestResult<msgs::Int32> &_r)
+  {
+    EXPECT_TRUE(_r.executed);
+    EXPECT_TRUE(_r.result);
+    EXPECT_EQ(5, _r.reply.data());
+    ++thenCalls;
+  }));
+
+  std::thread responder([state]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    msgs::Int32 rep;
+    rep.set_data(5);
+    state->Complete(true, &rep, true);
+
+    // Only the first completion counts.
+    rep.set_data(6);
+    state->Complete(true, &rep, false);
+  });
+
+  auto result = future.Get();
+  responder.join();
+
+  EXPECT_TRUE(future.Ready());
+  EXPECT_TRUE(result.executed);
+  EXPECT_TRUE(result.result);
+  EXPECT_EQ(5, result.reply.data());
+  EXPECT_EQ(1, thenCalls);
+
+  // A continuation registered afterwards runs immediately.
+  EXPECT_TRUE(future.Then([&thenCalls](const RequestResult<msgs::Int32> &)
+  {
+    ++thenCalls;
+  }));
+  EXPECT_EQ(2, thenCalls);
+}
+
+//////////////////////////////////////////////////
+/// \brief Complete a request that couldn't be made.
+TEST(RequestFutureTest, NotExecuted)
+{
+  auto state = std::make_shared<Future::State>();
+  Future future(state);
+  state->Complete(false, nullptr, true);
+
+  EXPECT_TRUE(future.WaitFor(0));
+  auto result = future.Get();
+  EXPECT_FALSE(result.executed);
+  EXPECT_FALSE(result.result);
+}
+
+#ifdef IGN_TRANSPORT_HAS_COROUTINES
+//////////////////////////////////////////////////
+/// \brief Minimal coroutine type that starts eagerly.
+class Task
+{
+  public: class promise_type
+  {
+    public: Task get_return_object() { return Task(); }
+    public: std::suspend_never initial_suspend() { return {}; }
+    public: std::suspend_never final_suspend() noexcept { return {}; }
+    public: void return_void() {}
+    public: void unhandled_exception() {}
+  };
+};
+
+//////////////////////////////////////////////////
+/// \brief Await two requests, one completed before awaiting and one after.
+Task AwaitTwice(Future _first, Future _second, int &_sum)
+{
+  auto first = co_await _first;
+  auto second = co_await _second;
+  _sum = first.reply.data() + second.reply.data();
+}
+
+//////////////////////////////////////////////////
+/// \brief Await requests from a coroutine.
+TEST(RequestFutureTest, Coroutine)
+{
+  auto state1 = std::make_shared<Future::State>();
+  auto state2 = std::make_shared<Future::State>();
+
+  msgs::Int32 rep;
+  rep.set_data(1);
+  state1->Complete(true, &rep, true);
+
+  int sum = 0;
+  AwaitTwice(Future(state1), Future(state2), sum);
+
+  // The coroutine is suspended on the second request.
+  EXPECT_EQ(0, sum);
+
+  rep.set_data(2);
+  state2->Complete(true, &rep, true);
+  EXPECT_EQ(3, sum);
+}
+#endif
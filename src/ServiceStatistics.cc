@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/statistic.pb.h>
+
+#include <string>
+#include <utility>
+
+#include "ignition/transport/ServiceStatistics.hh"
+
+using namespace ignition;
+using namespace transport;
+
+class ignition::transport::ServiceStatisticsPrivate
+{
+  /// \brief Number of requests sent.
+  public: uint64_t sent = 0;
+
+  /// \brief Number of requests sent waiting for a response.
+  public: uint64_t inFlight = 0;
+
+  /// \brief Number of requests sent abandoned by their requester.
+  public: uint64_t abandoned = 0;
+
+  /// \brief Number of requests sent rejected by a busy responser.
+  public: uint64_t busy = 0;
+
+  /// \brief Latency of the responses received.
+  public: Histogram latency;
+
+  /// \brief Number of requests received.
+  public: uint64_t received = 0;
+
+  /// \brief Number of requests received queued or running.
+  public: uint64_t serving = 0;
+
+  /// \brief Number of requests received discarded before running.
+  public: uint64_t dropped = 0;
+
+  /// \brief Number of requests received rejected because of a full queue.
+  public: uint64_t rejected = 0;
+
+  /// \brief Time the requests received waited before running.
+  public: Histogram queueTime;
+
+  /// \brief Execution time of the service callback.
+  public: Histogram handlerTime;
+};
+
+namespace
+{
+  /// \brief Add a statistic to a group.
+  /// \param[in] _group The group.
+  /// \param[in] _type Type of the statistic.
+  /// \param[in] _name Name of the statistic.
+  /// \param[in] _value Value of the statistic.
+  void AddStatistic(msgs::StatisticsGroup &_group,
+    msgs::Statistic::DataType _type, const std::string &_name,
+    double _value)
+  {
+    msgs::Statistic *stat = _group.add_statistics();
+    stat->set_type(_type);
+    stat->set_name(_name);
+    stat->set_value(_value);
+  }
+
+  /// \brief Add the statistics of a histogram to a group.
+  /// \param[in] _group The group.
+  /// \param[in] _histogram The histogram.
+  void AddHistogram(msgs::StatisticsGroup &_group,
+    const Histogram &_histogram)
+  {
+    AddStatistic(_group, msgs::Statistic::SAMPLE_COUNT, "sample_count",
+      static_cast<double>(_histogram.Count()));
+    AddStatistic(_group, msgs::Statistic::AVERAGE, "avg",
+      _histogram.Mean());
+    AddStatistic(_group, msgs::Statistic::MINIMUM, "min",
+      static_cast<double>(_histogram.Min()));
+    AddStatistic(_group, msgs::Statistic::MAXIMUM, "max",
+      static_cast<double>(_histogram.Max()));
+
+    // There is no percentile type of statistic, the name tells which one
+    // it is.
+    const std::pair<const char *, double> percentiles[] =
+    {
+      {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}
+    };
+    for (const auto &percentile : percentiles)
+    {
+      AddStatistic(_group, msgs::Statistic::UNINITIALIZED, percentile.first,
+        static_cast<double>(_histogram.ValueAtPercentile(percentile.second)));
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+ServiceStatistics::ServiceStatistics()
+  : dataPtr(new ServiceStatisticsPrivate)
+{
+}
+
+//////////////////////////////////////////////////
+ServiceStatistics::ServiceStatistics(const ServiceStatistics &_stats)
+  : dataPtr(new ServiceStatisticsPrivate(*(_stats.dataPtr.get())))
+{
+}
+
+//////////////////////////////////////////////////
+ServiceStatistics::~ServiceStatistics()
+{
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::RequestSent(bool _oneway)
+{
+  this->dataPtr->sent++;
+  if (!_oneway)
+    this->dataPtr->inFlight++;
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::ResponseReceived(uint64_t _latency)
+{
+  // The request might have been sent before enabling the statistics.
+  if (this->dataPtr->inFlight > 0)
+    this->dataPtr->inFlight--;
+  this->dataPtr->latency.Record(_latency);
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::RequestAbandoned()
+{
+  if (this->dataPtr->inFlight > 0)
+    this->dataPtr->inFlight--;
+  this->dataPtr->abandoned++;
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::BusyReceived()
+{
+  if (this->dataPtr->inFlight > 0)
+    this->dataPtr->inFlight--;
+  this->dataPtr->busy++;
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::RequestReceived()
+{
+  this->dataPtr->received++;
+  this->dataPtr->serving++;
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::RequestStarted(uint64_t _queueTime)
+{
+  this->dataPtr->queueTime.Record(_queueTime);
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::RequestFinished(uint64_t _handlerTime)
+{
+  if (this->dataPtr->serving > 0)
+    this->dataPtr->serving--;
+  this->dataPtr->handlerTime.Record(_handlerTime);
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::RequestDropped()
+{
+  if (this->dataPtr->serving > 0)
+    this->dataPtr->serving--;
+  this->dataPtr->dropped++;
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::RequestRejected()
+{
+  if (this->dataPtr->serving > 0)
+    this->dataPtr->serving--;
+  this->dataPtr->rejected++;
+}
+
+//////////////////////////////////////////////////
+void ServiceStatistics::FillMessage(msgs::Metric &_msg) const
+{
+  _msg.set_unit("microseconds");
+
+  // Requester statistics
+  msgs::StatisticsGroup *statGroup = _msg.add_statistics_groups();
+  statGroup->set_name("requester_statistics");
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "sent_count",
+    static_cast<double>(this->dataPtr->sent));
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "in_flight_count",
+    static_cast<double>(this->dataPtr->inFlight));
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "abandoned_count",
+    static_cast<double>(this->dataPtr->abandoned));
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "busy_count",
+    static_cast<double>(this->dataPtr->busy));
+
+  statGroup = _msg.add_statistics_groups();
+  statGroup->set_name("latency_statistics");
+  AddHistogram(*statGroup, this->dataPtr->latency);
+
+  // Responder statistics
+  statGroup = _msg.add_statistics_groups();
+  statGroup->set_name("responder_statistics");
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "received_count",
+    static_cast<double>(this->dataPtr->received));
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "serving_count",
+    static_cast<double>(this->dataPtr->serving));
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "dropped_count",
+    static_cast<double>(this->dataPtr->dropped));
+  AddStatistic(*statGroup, msgs::Statistic::SAMPLE_COUNT, "rejected_count",
+    static_cast<double>(this->dataPtr->rejected));
+
+  statGroup = _msg.add_statistics_groups();
+  statGroup->set_name("queue_time_statistics");
+  AddHistogram(*statGroup, this->dataPtr->queueTime);
+
+  statGroup = _msg.add_statistics_groups();
+  statGroup->set_name("handler_time_statistics");
+  AddHistogram(*statGroup, this->dataPtr->handlerTime);
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::SentCount() const
+{
+  return this->dataPtr->sent;
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::InFlightCount() const
+{
+  return this->dataPtr->inFlight;
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::AbandonedCount() const
+{
+  return this->dataPtr->abandoned;
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::BusyCount() const
+{
+  return this->dataPtr->busy;
+}
+
+//////////////////////////////////////////////////
+const Histogram &ServiceStatistics::Latency() const
+{
+  return this->dataPtr->latency;
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::ReceivedCount() const
+{
+  return this->dataPtr->received;
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::ServingCount() const
+{
+  return this->dataPtr->serving;
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::DroppedCount() const
+{
+  return this->dataPtr->dropped;
+}
+
+//////////////////////////////////////////////////
+uint64_t ServiceStatistics::RejectedCount() const
+{
+  return this->dataPtr->rejected;
+}
+
+//////////////////////////////////////////////////
+const Histogram &ServiceStatistics::QueueTime() const
+{
+  return this->dataPtr->queueTime;
+}
+
+//////////////////////////////////////////////////
+const Histogram &ServiceStatistics::HandlerTime() const
+{
+  return this->dataPtr->handlerTime;
+}
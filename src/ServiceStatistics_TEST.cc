@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/statistic.pb.h>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/ServiceStatistics.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+TEST(ServiceStatisticsTest, Requester)
+{
+  ServiceStatistics stats;
+  EXPECT_EQ(0u, stats.SentCount());
+  EXPECT_EQ(0u, stats.InFlightCount());
+
+  stats.RequestSent(false);
+  stats.RequestSent(false);
+  stats.RequestSent(false);
+  stats.RequestSent(true);
+  EXPECT_EQ(4u, stats.SentCount());
+  EXPECT_EQ(3u, stats.InFlightCount());
+
+  stats.ResponseReceived(100);
+  stats.ResponseReceived(300);
+  EXPECT_EQ(1u, stats.InFlightCount());
+  EXPECT_EQ(2u, stats.Latency().Count());
+  EXPECT_DOUBLE_EQ(200.0, stats.Latency().Mean());
+
+  stats.RequestAbandoned();
+  EXPECT_EQ(0u, stats.InFlightCount());
+  EXPECT_EQ(1u, stats.AbandonedCount());
+
+  // Responses of requests sent before enabling the statistics.
+  stats.ResponseReceived(100);
+  EXPECT_EQ(0u, stats.InFlightCount());
+
+  // A busy response isn't a latency sample.
+  stats.RequestSent(false);
+  stats.BusyReceived();
+  EXPECT_EQ(0u, stats.InFlightCount());
+  EXPECT_EQ(1u, stats.BusyCount());
+  EXPECT_EQ(3u, stats.Latency().Count());
+}
+
+//////////////////////////////////////////////////
+TEST(ServiceStatisticsTest, Responder)
+{
+  ServiceStatistics stats;
+  stats.RequestReceived();
+  stats.RequestReceived();
+  EXPECT_EQ(2u, stats.ReceivedCount());
+  EXPECT_EQ(2u, stats.ServingCount());
+
+  stats.RequestStarted(10);
+  EXPECT_EQ(2u, stats.ServingCount());
+  stats.RequestFinished(1000);
+  stats.RequestDropped();
+  EXPECT_EQ(0u, stats.ServingCount());
+  EXPECT_EQ(1u, stats.DroppedCount());
+  EXPECT_EQ(10u, stats.QueueTime().Max());
+  EXPECT_EQ(1000u, stats.HandlerTime().Max());
+
+  // Copies are independent snapshots.
+  ServiceStatistics snapshot(stats);
+  stats.RequestReceived();
+  EXPECT_EQ(2u, snapshot.ReceivedCount());
+  EXPECT_EQ(3u, stats.ReceivedCount());
+
+  stats.RequestRejected();
+  EXPECT_EQ(0u, stats.ServingCount());
+  EXPECT_EQ(1u, stats.RejectedCount());
+  EXPECT_EQ(1u, stats.DroppedCount());
+  EXPECT_EQ(0u, snapshot.RejectedCount());
+}
+
+//////////////////////////////////////////////////
+TEST(ServiceStatisticsTest, FillMessage)
+{
+  ServiceStatistics stats;
+  stats.RequestSent(false);
+  stats.ResponseReceived(2000);
+
+  msgs::Metric msg;
+  stats.FillMessage(msg);
+  EXPECT_EQ("microseconds", msg.unit());
+  ASSERT_EQ(5, msg.statistics_groups_size());
+  EXPECT_EQ("requester_statistics", msg.statistics_groups(0).name());
+
+  const msgs::StatisticsGroup &latency = msg.statistics_groups(1);
+  EXPECT_EQ("latency_statistics", latency.name());
+  bool found = false;
+  for (const auto &stat : latency.statistics())
+  {
+    if (stat.name() == "p99")
+    {
+      EXPECT_DOUBLE_EQ(2000.0, stat.value());
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "ShmSegment.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Magic number stored in the header of every segment.
+static const uint64_t kShmMagic = 0x69676e73686d3031;
+
+/// \brief Layout version of the segment.
+static const uint32_t kShmVersion = 1;
+
+/// \brief Offset of the ring buffer within the segment.
+static const std::size_t kRingOffset = 64;
+
+#ifndef _WIN32
+/// \brief Segments created by this process. NodeShared is never destroyed,
+/// so the segments still alive at exit are removed from here.
+class ShmRegistry
+{
+  /// \brief Get the registry.
+  /// \return The registry.
+  public: static ShmRegistry &Instance()
+  {
+    // Never destroyed, so segments destroyed after the static destructors
+    // can still unregister themselves.
+    static ShmRegistry *registry = new ShmRegistry();
+    return *registry;
+  }
+
+  /// \brief Add a segment.
+  /// \param[in] _name Segment name.
+  public: void Add(const std::string &_name)
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->names.insert({_name, getpid()});
+  }
+
+  /// \brief Remove a segment.
+  /// \param[in] _name Segment name.
+  public: void Remove(const std::string &_name)
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->names.erase({_name, getpid()});
+  }
+
+  /// \brief Unlink all the segments created by this process.
+  public: void UnlinkAll()
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    for (const auto &entry : this->names)
+    {
+      // A forked child must not remove the segments of its parent.
+      if (entry.second == getpid())
+        shm_unlink(entry.first.c_str());
+    }
+    this->names.clear();
+  }
+
+  /// \brief Protects the names.
+  private: std::mutex mutex;
+
+  /// \brief Segment names and the process that created them.
+  private: std::set<std::pair<std::string, pid_t>> names;
+};
+
+/// \brief Unlinks the remaining segments when the process exits.
+static struct ShmCleaner
+{
+  ~ShmCleaner()
+  {
+    ShmRegistry::Instance().UnlinkAll();
+  }
+} shmCleaner;
+#endif
+
+//////////////////////////////////////////////////
+struct ignition::transport::ShmSegment::Header
+{
+  /// \brief kShmMagic once the segment is initialized.
+  uint64_t magic;
+
+  /// \brief kShmVersion.
+  uint32_t version;
+
+  /// \brief Capacity of the ring buffer (bytes).
+  uint64_t capacity;
+
+  /// \brief Absolute position of the end of the last reserved message.
+  /// The position in the ring buffer is writePos % capacity.
+  std::atomic<uint64_t> writePos;
+};
+
+static_assert(sizeof(ShmSegment::Header) <= kRingOffset,
+  "ShmSegment::Header does not fit before the ring buffer");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+  "Shared memory transport requires lock-free 64-bit atomics");
+
+//////////////////////////////////////////////////
+std::string ShmSegment::Name(const std::string &_pUuid)
+{
+  // Some platforms (e.g. macOS) limit the names to 31 characters.
+  std::string name = "/ign";
+  for (const char c : _pUuid)
+  {
+    if (c == '-')
+      continue;
+    name += c;
+    if (name.size() >= 30)
+      break;
+  }
+  return name;
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<ShmSegment> ShmSegment::Create(const std::string &_name,
+  const std::size_t _capacity)
+{
+#ifdef _WIN32
+  (void)_name;
+  (void)_capacity;
+  return nullptr;
+#else
+  int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0)
+  {
+    std::cerr << "ShmSegment::Create(): Unable to create [" << _name
+              << "]: " << std::strerror(errno) << std::endl;
+    return nullptr;
+  }
+
+  const std::size_t mapSize = kRingOffset + _capacity;
+
+  // Reserve the memory now. Otherwise, writing into a segment that the
+  // system can't back triggers a SIGBUS.
+  int res = posix_fallocate(fd, 0, static_cast<off_t>(mapSize));
+  if (res != 0)
+  {
+    std::cerr << "ShmSegment::Create(): Unable to allocate [" << mapSize
+              << "] bytes for [" << _name << "]: " << std::strerror(res)
+              << std::endl;
+    close(fd);
+    shm_unlink(_name.c_str());
+    return nullptr;
+  }
+
+  void *base = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+    fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+  {
+    std::cerr << "ShmSegment::Create(): Unable to map [" << _name << "]: "
+              << std::strerror(errno) << std::endl;
+    shm_unlink(_name.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<ShmSegment> segment(new ShmSegment());
+  segment->name = _name;
+  segment->base = base;
+  segment->mapSize = mapSize;
+  segment->owner = true;
+  segment->capacity = _capacity;
+  segment->ring = static_cast<char *>(base) + kRingOffset;
+  segment->header = new (base) Header();
+  segment->header->version = kShmVersion;
+  segment->header->capacity = _capacity;
+  segment->header->writePos.store(0);
+  std::atomic_thread_fence(std::memory_order_release);
+  segment->header->magic = kShmMagic;
+
+  ShmRegistry::Instance().Add(_name);
+
+  return segment;
+#endif
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<ShmSegment> ShmSegment::Open(const std::string &_name)
+{
+#ifdef _WIN32
+  (void)_name;
+  return nullptr;
+#else
+  int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < kRingOffset)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  const std::size_t mapSize = static_cast<std::size_t>(st.st_size);
+  void *base = mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return nullptr;
+
+  Header *header = static_cast<Header *>(base);
+  if (header->magic != kShmMagic || header->version != kShmVersion ||
+      header->capacity + kRingOffset > mapSize)
+  {
+    munmap(base, mapSize);
+    return nullptr;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  std::unique_ptr<ShmSegment> segment(new ShmSegment());
+  segment->name = _name;
+  segment->base = base;
+  segment->mapSize = mapSize;
+  segment->capacity = header->capacity;
+  segment->ring = static_cast<char *>(base) + kRingOffset;
+  segment->header = header;
+
+  return segment;
+#endif
+}
+
+//////////////////////////////////////////////////
+ShmSegment::~ShmSegment()
+{
+#ifndef _WIN32
+  if (this->base)
+    munmap(this->base, this->mapSize);
+
+  if (this->owner)
+  {
+    shm_unlink(this->name.c_str());
+    ShmRegistry::Instance().Remove(this->name);
+  }
+#endif
+}
+
+//////////////////////////////////////////////////
+std::size_t ShmSegment::MaxMessageSize() const
+{
+  // Leave room for a few messages in flight.
+  return this->capacity / 4;
+}
+
+//////////////////////////////////////////////////
+bool ShmSegment::Write(const char *_data, const std::size_t _size,
+  ShmDescriptor &_desc)
+{
+  if (!this->owner || _size == 0 || _size > this->MaxMessageSize())
+    return false;
+
+  std::lock_guard<std::mutex> lk(this->writeMutex);
+
+  uint64_t start = this->header->writePos.load(std::memory_order_relaxed);
+
+  // Messages are stored contiguously. Skip the tail of the ring buffer if
+  // the message doesn't fit there.
+  const uint64_t offsetInRing = start % this->capacity;
+  if (offsetInRing + _size > this->capacity)
+    start += this->capacity - offsetInRing;
+
+  // Reserve the space before writing so the readers can detect that older
+  // messages are being overwritten.
+  this->header->writePos.store(start + _size, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(this->ring + (start % this->capacity), _data, _size);
+
+  _desc.offset = start;
+  _desc.size = _size;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ShmSegment::Read(const ShmDescriptor &_desc, std::string &_data) const
+{
+  if (_desc.size == 0 || _desc.size > this->MaxMessageSize() ||
+      (_desc.offset % this->capacity) + _desc.size > this->capacity)
+  {
+    return false;
+  }
+
+  // The message must have been reserved already.
+  uint64_t end = this->header->writePos.load(std::memory_order_acquire);
+  if (_desc.offset + _desc.size > end)
+    return false;
+
+  _data.assign(this->ring + (_desc.offset % this->capacity),
+    static_cast<std::size_t>(_desc.size));
+
+  // Check that the writer didn't reuse the memory while we were copying.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  end = this->header->writePos.load(std::memory_order_relaxed);
+  return end <= _desc.offset + this->capacity;
+}
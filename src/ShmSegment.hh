@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_SHMSEGMENT_HH_
+#define IGN_TRANSPORT_SHMSEGMENT_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Prefix of the message type frame of a publication whose data
+    /// frame contains a ShmDescriptor instead of the serialized message.
+    static const std::string kShmMsgTypePrefix = "@shm@";
+
+    /// \brief Prefix of the address used by subscribers to register as
+    /// capable of receiving publications through shared memory.
+    static const std::string kShmAddrPrefix = "shm://";
+
+    /// \brief Messages smaller than this are always sent inline, the
+    /// overhead of the descriptor is not worth it.
+    static const std::size_t kShmMinMsgSize = 4096;
+
+    /// \brief Default capacity of a shared memory segment (MB).
+    static const std::size_t kDefaultShmSizeMB = 16;
+
+    /// \brief Location of a message stored in a ShmSegment.
+    struct ShmDescriptor
+    {
+      /// \brief Absolute position of the message in the ring buffer.
+      uint64_t offset = 0;
+
+      /// \brief Message size (bytes).
+      uint64_t size = 0;
+    };
+
+    /// \class ShmSegment ShmSegment.hh
+    /// \brief A POSIX shared memory ring buffer. The process that creates the
+    /// segment is the only writer. Readers map the segment read-only and copy
+    /// the messages out given a ShmDescriptor. A reader detects when a
+    /// message has been overwritten because it was too slow, in which case
+    /// the message is dropped.
+    class IGNITION_TRANSPORT_VISIBLE ShmSegment
+    {
+      /// \brief Get the segment name used by a given process.
+      /// \param[in] _pUuid Process UUID.
+      /// \return The segment name.
+      public: static std::string Name(const std::string &_pUuid);
+
+      /// \brief Create a new segment. The segment is removed when the
+      /// returned object is destroyed.
+      /// \param[in] _name Segment name.
+      /// \param[in] _capacity Size of the ring buffer (bytes).
+      /// \return The segment or nullptr on error.
+      public: static std::unique_ptr<ShmSegment> Create(
+        const std::string &_name, const std::size_t _capacity);
+
+      /// \brief Open an existing segment for reading.
+      /// \param[in] _name Segment name.
+      /// \return The segment or nullptr if the segment does not exist.
+      public: static std::unique_ptr<ShmSegment> Open(
+        const std::string &_name);
+
+      /// \brief Destructor.
+      public: ~ShmSegment();
+
+      /// \brief Largest message that can be stored in this segment.
+      /// \return Size in bytes.
+      public: std::size_t MaxMessageSize() const;
+
+      /// \brief Copy a message into the ring buffer.
+      /// \param[in] _data Message data.
+      /// \param[in] _size Message size.
+      /// \param[out] _desc Location of the message.
+      /// \return True on success or false if the segment is read-only or
+      /// the message is too big.
+      public: bool Write(const char *_data, const std::size_t _size,
+                         ShmDescriptor &_desc);
+
+      /// \brief Copy a message out of the ring buffer.
+      /// \param[in] _desc Location of the message.
+      /// \param[out] _data Message data.
+      /// \return True on success or false if the descriptor is not valid or
+      /// the message has already been overwritten.
+      public: bool Read(const ShmDescriptor &_desc, std::string &_data) const;
+
+      /// \brief Constructor. Use Create() or Open() instead.
+      private: ShmSegment() = default;
+
+      /// \internal
+      /// \brief Header stored at the beginning of the segment.
+      public: struct Header;
+
+      /// \brief Segment name.
+      private: std::string name;
+
+      /// \brief Mapped memory.
+      private: void *base = nullptr;
+
+      /// \brief Size of the mapped memory.
+      private: std::size_t mapSize = 0;
+
+      /// \brief Header of the segment.
+      private: Header *header = nullptr;
+
+      /// \brief Beginning of the ring buffer.
+      private: char *ring = nullptr;
+
+      /// \brief Capacity of the ring buffer.
+      private: std::size_t capacity = 0;
+
+      /// \brief True if this object created the segment.
+      private: bool owner = false;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Serializes the writers within the owner process.
+      private: std::mutex writeMutex;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+
+#include "ignition/transport/Uuid.hh"
+#include "ShmSegment.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+#ifndef _WIN32
+//////////////////////////////////////////////////
+/// \brief Check the segment names.
+TEST(ShmSegmentTest, Name)
+{
+  transport::Uuid uuid;
+  std::string name = transport::ShmSegment::Name(uuid.ToString());
+  EXPECT_EQ('/', name[0]);
+  EXPECT_LE(name.size(), 31u);
+  EXPECT_EQ(std::string::npos, name.find('-'));
+}
+
+//////////////////////////////////////////////////
+/// \brief Write messages in a segment and read them from another mapping.
+TEST(ShmSegmentTest, WriteRead)
+{
+  transport::Uuid uuid;
+  const std::string name = transport::ShmSegment::Name(uuid.ToString());
+
+  EXPECT_EQ(nullptr, transport::ShmSegment::Open(name));
+
+  auto writer = transport::ShmSegment::Create(name, 1024);
+  ASSERT_NE(nullptr, writer);
+  EXPECT_EQ(256u, writer->MaxMessageSize());
+
+  // The segment already exists.
+  EXPECT_EQ(nullptr, transport::ShmSegment::Create(name, 1024));
+
+  auto reader = transport::ShmSegment::Open(name);
+  ASSERT_NE(nullptr, reader);
+
+  transport::ShmDescriptor desc;
+  const std::string msg1(200, 'a');
+  ASSERT_TRUE(writer->Write(msg1.data(), msg1.size(), desc));
+
+  std::string data;
+  EXPECT_TRUE(reader->Read(desc, data));
+  EXPECT_EQ(msg1, data);
+
+  // Readers can't write.
+  EXPECT_FALSE(reader->Write(msg1.data(), msg1.size(), desc));
+
+  // Too big.
+  const std::string big(300, 'b');
+  EXPECT_FALSE(writer->Write(big.data(), big.size(), desc));
+
+  // A descriptor pointing past the last message is not valid.
+  transport::ShmDescriptor future = desc;
+  future.offset += 1024;
+  EXPECT_FALSE(reader->Read(future, data));
+}
+
+//////////////////////////////////////////////////
+/// \brief A reader must detect messages that have been overwritten.
+TEST(ShmSegmentTest, Overwrite)
+{
+  transport::Uuid uuid;
+  const std::string name = transport::ShmSegment::Name(uuid.ToString());
+
+  auto writer = transport::ShmSegment::Create(name, 1024);
+  ASSERT_NE(nullptr, writer);
+  auto reader = transport::ShmSegment::Open(name);
+  ASSERT_NE(nullptr, reader);
+
+  transport::ShmDescriptor first;
+  const std::string msg(250, 'c');
+  ASSERT_TRUE(writer->Write(msg.data(), msg.size(), first));
+
+  transport::ShmDescriptor last;
+  for (int i = 0; i < 3; ++i)
+  {
+    ASSERT_TRUE(writer->Write(msg.data(), msg.size(), last));
+    std::string data;
+    EXPECT_TRUE(reader->Read(first, data));
+  }
+
+  // This write wraps around and reuses the memory of the first message.
+  ASSERT_TRUE(writer->Write(msg.data(), msg.size(), last));
+  EXPECT_EQ(1024u, last.offset);
+
+  std::string data;
+  EXPECT_FALSE(reader->Read(first, data));
+  EXPECT_TRUE(reader->Read(last, data));
+  EXPECT_EQ(msg, data);
+}
+
+//////////////////////////////////////////////////
+/// \brief The segment is removed when its owner is destroyed.
+TEST(ShmSegmentTest, Unlink)
+{
+  transport::Uuid uuid;
+  const std::string name = transport::ShmSegment::Name(uuid.ToString());
+
+  {
+    auto writer = transport::ShmSegment::Create(name, 1024);
+    ASSERT_NE(nullptr, writer);
+  }
+
+  EXPECT_EQ(nullptr, transport::ShmSegment::Open(name));
+}
+#endif
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
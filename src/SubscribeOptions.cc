@@ -15,6 +15,7 @@
  *
 */
 
+#include <algorithm>
 #include <cstdint>
 
 #include "ignition/transport/Helpers.hh"
@@ -36,6 +37,18 @@ SubscribeOptions::SubscribeOptions(const SubscribeOptions &_otherSubscribeOpts)
   : dataPtr(new SubscribeOptionsPrivate())
 {
   this->SetMsgsPerSec(_otherSubscribeOpts.MsgsPerSec());
+  this->SetBurst(_otherSubscribeOpts.Burst());
+  this->SetCoarseClock(_otherSubscribeOpts.CoarseClock());
+  this->SetConflated(_otherSubscribeOpts.Conflated());
+  this->SetDedicatedThread(_otherSubscribeOpts.DedicatedThread());
+  this->SetQueueSize(_otherSubscribeOpts.QueueSize());
+  this->SetQueueBytes(_otherSubscribeOpts.QueueBytes());
+  this->SetQueuePolicy(_otherSubscribeOpts.QueuePolicy());
+  this->SetInlineDelivery(_otherSubscribeOpts.InlineDelivery());
+  this->SetArenaAllocation(_otherSubscribeOpts.ArenaAllocation());
+  this->SetCallbackProfiling(_otherSubscribeOpts.CallbackProfiling());
+  this->SetCallbackBudget(_otherSubscribeOpts.CallbackBudget());
+  this->SetHeaderFilter(_otherSubscribeOpts.HeaderFilter());
 }
 
 //////////////////////////////////////////////////
@@ -60,3 +73,150 @@ void SubscribeOptions::SetMsgsPerSec(const uint64_t _newMsgsPerSec)
 {
   this->dataPtr->msgsPerSec = _newMsgsPerSec;
 }
+
+//////////////////////////////////////////////////
+uint64_t SubscribeOptions::Burst() const
+{
+  return this->dataPtr->burst;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetBurst(const uint64_t _burst)
+{
+  this->dataPtr->burst = std::max<uint64_t>(_burst, 1u);
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::CoarseClock() const
+{
+  return this->dataPtr->coarseClock;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetCoarseClock(const bool _coarse)
+{
+  this->dataPtr->coarseClock = _coarse;
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::Conflated() const
+{
+  return this->dataPtr->conflated;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetConflated(const bool _conflated)
+{
+  this->dataPtr->conflated = _conflated;
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::DedicatedThread() const
+{
+  return this->dataPtr->dedicatedThread;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetDedicatedThread(const bool _dedicated)
+{
+  this->dataPtr->dedicatedThread = _dedicated;
+}
+
+//////////////////////////////////////////////////
+uint64_t SubscribeOptions::QueueSize() const
+{
+  return this->dataPtr->queueSize;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetQueueSize(const uint64_t _size)
+{
+  this->dataPtr->queueSize = _size;
+}
+
+//////////////////////////////////////////////////
+uint64_t SubscribeOptions::QueueBytes() const
+{
+  return this->dataPtr->queueBytes;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetQueueBytes(const uint64_t _bytes)
+{
+  this->dataPtr->queueBytes = _bytes;
+}
+
+//////////////////////////////////////////////////
+QueuePolicy_t SubscribeOptions::QueuePolicy() const
+{
+  return this->dataPtr->queuePolicy;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetQueuePolicy(const QueuePolicy_t _policy)
+{
+  this->dataPtr->queuePolicy = _policy;
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::InlineDelivery() const
+{
+  return this->dataPtr->inlineDelivery;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetInlineDelivery(const bool _inline)
+{
+  this->dataPtr->inlineDelivery = _inline;
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::ArenaAllocation() const
+{
+  return this->dataPtr->arenaAllocation;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetArenaAllocation(const bool _arena)
+{
+  this->dataPtr->arenaAllocation = _arena;
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::CallbackProfiling() const
+{
+  return this->dataPtr->callbackProfiling;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetCallbackProfiling(const bool _profiling)
+{
+  this->dataPtr->callbackProfiling = _profiling;
+}
+
+//////////////////////////////////////////////////
+std::chrono::microseconds SubscribeOptions::CallbackBudget() const
+{
+  return this->dataPtr->callbackBudget;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetCallbackBudget(
+  const std::chrono::microseconds &_budget)
+{
+  this->dataPtr->callbackBudget = _budget;
+}
+
+//////////////////////////////////////////////////
+const std::function<bool(const msgs::Header &)> &
+SubscribeOptions::HeaderFilter() const
+{
+  return this->dataPtr->headerFilter;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetHeaderFilter(
+  const std::function<bool(const msgs::Header &)> &_filter)
+{
+  this->dataPtr->headerFilter = _filter;
+}
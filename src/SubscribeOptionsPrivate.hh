@@ -18,8 +18,11 @@
 #ifndef IGN_TRANSPORT_SUBSCRIBEOPTIONSPRIVATE_HH_
 #define IGN_TRANSPORT_SUBSCRIBEOPTIONSPRIVATE_HH_
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
 
+#include "ignition/transport/AdvertiseOptions.hh"
 #include "ignition/transport/Helpers.hh"
 
 namespace ignition
@@ -41,6 +44,43 @@ namespace ignition
 
       /// \brief Default message subscription rate.
       public: uint64_t msgsPerSec = kUnthrottled;
+
+      /// \brief Number of messages received back to back.
+      public: uint64_t burst = 1;
+
+      /// \brief Read the coarse clock for the throttling.
+      public: bool coarseClock = false;
+
+      /// \brief Only deliver the latest message.
+      public: bool conflated = false;
+
+      /// \brief Run the callback on its own thread.
+      public: bool dedicatedThread = false;
+
+      /// \brief Maximum number of pending messages, zero for no queue.
+      public: uint64_t queueSize = 0;
+
+      /// \brief Maximum number of pending bytes, zero for no limit.
+      public: uint64_t queueBytes = 0;
+
+      /// \brief What happens when the queue is full.
+      public: QueuePolicy_t queuePolicy = QueuePolicy_t::DROP_OLDEST;
+
+      /// \brief Run the callback on the publisher's thread for intra-process
+      /// messages.
+      public: bool inlineDelivery = false;
+
+      /// \brief Parse the messages received into a recycled arena.
+      public: bool arenaAllocation = false;
+
+      /// \brief Time the callbacks.
+      public: bool callbackProfiling = false;
+
+      /// \brief Longest expected execution time of the callbacks.
+      public: std::chrono::microseconds callbackBudget{0};
+
+      /// \brief Filter of the headers of the messages received.
+      public: std::function<bool(const msgs::Header &)> headerFilter;
     };
     }
   }
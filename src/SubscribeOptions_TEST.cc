@@ -15,6 +15,10 @@
  *
 */
 
+#include <chrono>
+
+#include <ignition/msgs/header.pb.h>
+
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/SubscribeOptions.hh"
 #include "ignition/transport/test_config.h"
@@ -55,6 +59,130 @@ TEST(SubscribeOptionsTest, throttled)
   EXPECT_TRUE(opts.Throttled());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check Burst() and CoarseClock().
+TEST(SubscribeOptionsTest, burst)
+{
+  SubscribeOptions opts1;
+  EXPECT_EQ(1u, opts1.Burst());
+  EXPECT_FALSE(opts1.CoarseClock());
+  opts1.SetBurst(5u);
+  opts1.SetCoarseClock(true);
+  EXPECT_EQ(5u, opts1.Burst());
+  EXPECT_TRUE(opts1.CoarseClock());
+  SubscribeOptions opts2(opts1);
+  EXPECT_EQ(5u, opts2.Burst());
+  EXPECT_TRUE(opts2.CoarseClock());
+
+  // Zero is treated as one.
+  opts1.SetBurst(0u);
+  EXPECT_EQ(1u, opts1.Burst());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check Conflated().
+TEST(SubscribeOptionsTest, conflated)
+{
+  SubscribeOptions opts1;
+  EXPECT_FALSE(opts1.Conflated());
+  opts1.SetConflated(true);
+  EXPECT_TRUE(opts1.Conflated());
+  SubscribeOptions opts2(opts1);
+  EXPECT_TRUE(opts2.Conflated());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check DedicatedThread().
+TEST(SubscribeOptionsTest, dedicatedThread)
+{
+  SubscribeOptions opts1;
+  EXPECT_FALSE(opts1.DedicatedThread());
+  opts1.SetDedicatedThread(true);
+  EXPECT_TRUE(opts1.DedicatedThread());
+  SubscribeOptions opts2(opts1);
+  EXPECT_TRUE(opts2.DedicatedThread());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check QueueSize(), QueueBytes() and QueuePolicy().
+TEST(SubscribeOptionsTest, queue)
+{
+  SubscribeOptions opts1;
+  EXPECT_EQ(0u, opts1.QueueSize());
+  EXPECT_EQ(0u, opts1.QueueBytes());
+  EXPECT_EQ(QueuePolicy_t::DROP_OLDEST, opts1.QueuePolicy());
+  opts1.SetQueueSize(10u);
+  opts1.SetQueueBytes(1024u);
+  opts1.SetQueuePolicy(QueuePolicy_t::BLOCK);
+  EXPECT_EQ(10u, opts1.QueueSize());
+  EXPECT_EQ(1024u, opts1.QueueBytes());
+  EXPECT_EQ(QueuePolicy_t::BLOCK, opts1.QueuePolicy());
+  SubscribeOptions opts2(opts1);
+  EXPECT_EQ(10u, opts2.QueueSize());
+  EXPECT_EQ(1024u, opts2.QueueBytes());
+  EXPECT_EQ(QueuePolicy_t::BLOCK, opts2.QueuePolicy());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check InlineDelivery().
+TEST(SubscribeOptionsTest, inlineDelivery)
+{
+  SubscribeOptions opts1;
+  EXPECT_FALSE(opts1.InlineDelivery());
+  opts1.SetInlineDelivery(true);
+  EXPECT_TRUE(opts1.InlineDelivery());
+  SubscribeOptions opts2(opts1);
+  EXPECT_TRUE(opts2.InlineDelivery());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check ArenaAllocation().
+TEST(SubscribeOptionsTest, arenaAllocation)
+{
+  SubscribeOptions opts1;
+  EXPECT_FALSE(opts1.ArenaAllocation());
+  opts1.SetArenaAllocation(true);
+  EXPECT_TRUE(opts1.ArenaAllocation());
+  SubscribeOptions opts2(opts1);
+  EXPECT_TRUE(opts2.ArenaAllocation());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check CallbackProfiling() and CallbackBudget().
+TEST(SubscribeOptionsTest, callbackProfiling)
+{
+  SubscribeOptions opts1;
+  EXPECT_FALSE(opts1.CallbackProfiling());
+  EXPECT_EQ(std::chrono::microseconds(0), opts1.CallbackBudget());
+  opts1.SetCallbackProfiling(true);
+  opts1.SetCallbackBudget(std::chrono::microseconds(500));
+  SubscribeOptions opts2(opts1);
+  EXPECT_TRUE(opts2.CallbackProfiling());
+  EXPECT_EQ(std::chrono::microseconds(500), opts2.CallbackBudget());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the header filter.
+TEST(SubscribeOptionsTest, headerFilter)
+{
+  SubscribeOptions opts1;
+  EXPECT_FALSE(opts1.HeaderFilter());
+  opts1.SetHeaderFilter([](const msgs::Header &_header)
+    {
+      return _header.stamp().sec() > 10;
+    });
+  SubscribeOptions opts2(opts1);
+  ASSERT_TRUE(opts2.HeaderFilter());
+
+  msgs::Header header;
+  EXPECT_FALSE(opts2.HeaderFilter()(header));
+  header.mutable_stamp()->set_sec(11);
+  EXPECT_TRUE(opts2.HeaderFilter()(header));
+
+  opts2.SetHeaderFilter(nullptr);
+  EXPECT_FALSE(opts2.HeaderFilter());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
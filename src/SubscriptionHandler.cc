@@ -15,26 +15,222 @@
  *
 */
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <ignition/msgs/header.pb.h>
+
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/MessagePeek.hh"
+#include "ignition/transport/MetricsRegistry.hh"
 #include "ignition/transport/SubscriptionHandler.hh"
 
+#include "TokenBucket.hh"
+#include "TypeIds.hh"
+
 namespace ignition
 {
   namespace transport
   {
     inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
     {
+    /// \brief Size of the first block of a new arena.
+    static const std::size_t kArenaInitialBlock = 64 * 1024;
+
+    /// \brief Maximum size of the first block of an arena. Messages that
+    /// need more allocate the rest from the heap.
+    static const std::size_t kArenaMaxBlock = 16 * 1024 * 1024;
+
+    /// \brief Maximum number of idle arenas kept by a handler.
+    static const std::size_t kArenaPoolSize = 8;
+
+    /// \brief An arena and its first block. Once reset, the arena reuses
+    /// the block, so the messages that fit in it allocate nothing.
+    class RecycledArenaBlock
+    {
+      /// \brief Constructor.
+      /// \param[in] _size Size of the first block.
+      public: explicit RecycledArenaBlock(const std::size_t _size)
+      {
+        this->Create(_size);
+      }
+
+      /// \brief Reset the arena. Its first block grows to the space used
+      /// by the message, so the next messages of this size fit in it.
+      public: void Recycle()
+      {
+        const std::size_t used =
+          static_cast<std::size_t>(this->arena->SpaceAllocated());
+        if (used > this->block.size() && this->block.size() < kArenaMaxBlock)
+          this->Create(std::min(used, kArenaMaxBlock));
+        else
+          this->arena->Reset();
+      }
+
+      /// \brief Create the arena with a new first block.
+      /// \param[in] _size Size of the first block.
+      private: void Create(const std::size_t _size)
+      {
+        this->arena.reset();
+        this->block.assign(_size, 0);
+
+        google::protobuf::ArenaOptions options;
+        options.initial_block = this->block.data();
+        options.initial_block_size = this->block.size();
+        this->arena.reset(new google::protobuf::Arena(options));
+      }
+
+      /// \brief First block of the arena.
+      private: std::vector<char> block;
+
+      /// \brief The arena.
+      public: std::unique_ptr<google::protobuf::Arena> arena;
+    };
+
+    /// \brief Idle arenas of a subscription handler. Arenas in use return
+    /// to the pool when their last message is released.
+    class ArenaPool : public std::enable_shared_from_this<ArenaPool>
+    {
+      /// \brief Get an idle arena, or a new one.
+      /// \return The arena, returned to the pool once released.
+      public: std::shared_ptr<google::protobuf::Arena> Acquire()
+      {
+        RecycledArenaBlock *recycled = nullptr;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (!this->idle.empty())
+          {
+            recycled = this->idle.back().release();
+            this->idle.pop_back();
+          }
+        }
+        if (!recycled)
+          recycled = new RecycledArenaBlock(kArenaInitialBlock);
+
+        std::weak_ptr<ArenaPool> weak = this->shared_from_this();
+        return std::shared_ptr<google::protobuf::Arena>(
+          recycled->arena.get(),
+          [weak, recycled](google::protobuf::Arena *)
+          {
+            std::unique_ptr<RecycledArenaBlock> owned(recycled);
+            auto pool = weak.lock();
+            if (!pool)
+              return;
+
+            owned->Recycle();
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            if (pool->idle.size() < kArenaPoolSize)
+              pool->idle.push_back(std::move(owned));
+          });
+      }
+
+      /// \brief Protects the idle arenas.
+      private: std::mutex mutex;
+
+      /// \brief Idle arenas.
+      private: std::vector<std::unique_ptr<RecycledArenaBlock>> idle;
+    };
+
+    /// \brief Shortest interval between two warnings about the slow
+    /// callbacks of a handler.
+    static const std::chrono::seconds kSlowCallbackWarningInterval(1);
+
+    /////////////////////////////////////////////////
+    /// \brief Get the callback budget of the subscriptions that have none,
+    /// from the IGN_TRANSPORT_CALLBACK_BUDGET environment variable.
+    /// \return The budget, zero if the variable isn't set.
+    static std::chrono::microseconds DefaultCallbackBudget()
+    {
+      static const std::chrono::microseconds budget = []()
+      {
+        std::string value;
+        if (!env("IGN_TRANSPORT_CALLBACK_BUDGET", value) || value.empty())
+          return std::chrono::microseconds(0);
+
+        try
+        {
+          return std::chrono::microseconds(std::stoll(value));
+        }
+        catch (...)
+        {
+          std::cerr << "Invalid IGN_TRANSPORT_CALLBACK_BUDGET value ["
+                    << value << "]" << std::endl;
+          return std::chrono::microseconds(0);
+        }
+      }();
+      return budget;
+    }
+
+    /// \brief Execution time of the callbacks of a handler.
+    class CallbackProfile
+    {
+      /// \brief Constructor.
+      /// \param[in] _budget Budget of the callbacks, zero for none.
+      public: explicit CallbackProfile(
+                const std::chrono::microseconds &_budget)
+        : budget(_budget)
+      {
+      }
+
+      /// \brief Budget of the callbacks, zero for none.
+      public: const std::chrono::microseconds budget;
+
+      /// \brief Protects the members below.
+      public: std::mutex mutex;
+
+      /// \brief Durations of the callbacks, in microseconds.
+      public: Histogram duration;
+
+      /// \brief Number of callbacks above the budget.
+      public: uint64_t overBudget = 0;
+
+      /// \brief Time of the last warning about a slow callback.
+      public: std::chrono::steady_clock::time_point lastWarning;
+    };
+
     /////////////////////////////////////////////////
     SubscriptionHandlerBase::SubscriptionHandlerBase(
         const std::string &_nUuid,
         const SubscribeOptions &_opts)
       : opts(_opts),
-        periodNs(0.0),
         hUuid(Uuid().ToString()),
-        lastCbTimestamp(std::chrono::seconds{0}),
         nUuid(_nUuid)
     {
       if (this->opts.Throttled())
-        this->periodNs = 1e9 / this->opts.MsgsPerSec();
+      {
+        this->throttle = std::make_shared<TokenBucket>(
+          this->opts.MsgsPerSec(), this->opts.Burst(),
+          this->opts.CoarseClock());
+      }
+
+      if (this->opts.ArenaAllocation())
+        this->arenas = std::make_shared<ArenaPool>();
+
+      std::chrono::microseconds budget = this->opts.CallbackBudget();
+      if (budget.count() <= 0)
+        budget = DefaultCallbackBudget();
+      if (budget.count() < 0)
+        budget = std::chrono::microseconds(0);
+      if (this->opts.CallbackProfiling() || budget.count() > 0)
+        this->profile = std::make_shared<CallbackProfile>(budget);
+    }
+
+    /////////////////////////////////////////////////
+    uint32_t SubscriptionHandlerBase::TypeId()
+    {
+      uint32_t id = this->typeId.load(std::memory_order_relaxed);
+      if (id == kNoMsgTypeId)
+      {
+        // The type name never changes, so threads racing here store the
+        // same ID.
+        id = InternMsgType(this->TypeName());
+        this->typeId.store(id, std::memory_order_relaxed);
+      }
+      return id;
     }
 
     /////////////////////////////////////////////////
@@ -50,25 +246,170 @@ namespace ignition
     }
 
     /////////////////////////////////////////////////
-    bool SubscriptionHandlerBase::UpdateThrottling()
+    bool SubscriptionHandlerBase::Conflated() const
+    {
+      return this->opts.Conflated();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::DedicatedThread() const
+    {
+      return this->opts.DedicatedThread();
+    }
+
+    /////////////////////////////////////////////////
+    uint64_t SubscriptionHandlerBase::QueueSize() const
+    {
+      return this->opts.QueueSize();
+    }
+
+    /////////////////////////////////////////////////
+    uint64_t SubscriptionHandlerBase::QueueBytes() const
+    {
+      return this->opts.QueueBytes();
+    }
+
+    /////////////////////////////////////////////////
+    QueuePolicy_t SubscriptionHandlerBase::QueuePolicy() const
     {
-      if (!this->opts.Throttled())
+      return this->opts.QueuePolicy();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::InlineDelivery() const
+    {
+      return this->opts.InlineDelivery();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::ArenaAllocation() const
+    {
+      return this->opts.ArenaAllocation();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::Batched() const
+    {
+      return false;
+    }
+
+    /////////////////////////////////////////////////
+    uint64_t SubscriptionHandlerBase::MsgsPerSec() const
+    {
+      return this->opts.Throttled() ? this->opts.MsgsPerSec() : kUnthrottled;
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::ThrottledUpdateReady() const
+    {
+      return !this->throttle || this->throttle->Ready();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::HeaderAccepted(const char *_data,
+      const std::size_t _size, const std::string &_type) const
+    {
+      const auto &filter = this->opts.HeaderFilter();
+      if (!filter || !hasHeader(_type))
+        return true;
+
+      // A malformed message is reported when it's parsed.
+      msgs::Header header;
+      return !peekHeader(_data, _size, header) || filter(header);
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::HeaderAccepted(const ProtoMsg &_msg) const
+    {
+      const auto &filter = this->opts.HeaderFilter();
+      if (!filter || !hasHeader(_msg.GetDescriptor()->full_name()))
         return true;
 
-      Timestamp now = std::chrono::steady_clock::now();
+      const ProtoMsg &field = _msg.GetReflection()->GetMessage(_msg,
+        _msg.GetDescriptor()->FindFieldByNumber(1));
+      if (field.GetDescriptor() == msgs::Header::descriptor())
+        return filter(static_cast<const msgs::Header &>(field));
+
+      // The header of a dynamic message.
+      msgs::Header header;
+      header.ParseFromString(field.SerializeAsString());
+      return filter(header);
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::UpdateThrottling()
+    {
+      return !this->throttle || this->throttle->Consume();
+    }
+
+    /////////////////////////////////////////////////
+    std::optional<CallbackStatistics>
+    SubscriptionHandlerBase::CallbackStats() const
+    {
+      if (!this->profile)
+        return std::nullopt;
 
-      // Elapsed time since the last callback execution.
-      auto elapsed = now - this->lastCbTimestamp;
+      CallbackStatistics stats;
+      stats.handlerUuid = this->hUuid;
+      stats.budget = this->profile->budget;
+      std::lock_guard<std::mutex> lk(this->profile->mutex);
+      stats.duration = this->profile->duration;
+      stats.overBudget = this->profile->overBudget;
+      return stats;
+    }
 
-      if (std::chrono::duration_cast<std::chrono::nanoseconds>(
-            elapsed).count() < this->periodNs)
+    /////////////////////////////////////////////////
+    void SubscriptionHandlerBase::RecordCallback(
+      const std::chrono::steady_clock::duration &_duration,
+      const MessageInfo &_info)
+    {
+      CallbackProfile &prof = *this->profile;
+      const auto us =
+        std::chrono::duration_cast<std::chrono::microseconds>(_duration);
+
+      bool warn = false;
+      uint64_t overBudget = 0;
       {
-        return false;
+        std::lock_guard<std::mutex> lk(prof.mutex);
+        prof.duration.Record(static_cast<uint64_t>(std::max<int64_t>(
+          us.count(), 0)));
+        if (prof.budget.count() == 0 || us <= prof.budget)
+          return;
+
+        overBudget = ++prof.overBudget;
+        const auto now = std::chrono::steady_clock::now();
+        if (overBudget == 1 ||
+            now - prof.lastWarning >= kSlowCallbackWarningInterval)
+        {
+          prof.lastWarning = now;
+          warn = true;
+        }
       }
 
-      // Update the last callback execution.
-      this->lastCbTimestamp = now;
-      return true;
+      // The slow path, a slow callback already ran.
+      MetricsRegistry::Instance().Counter(
+        "ign_transport_callbacks_over_budget",
+        "Callbacks of the subscriptions that took longer than their budget",
+        {{"partition", _info.Partition()}, {"topic", _info.Topic()}})
+        .Increment();
+
+      if (warn)
+      {
+        std::cerr << "Callback of a subscription to topic [" << _info.Topic()
+                  << "] took " << us.count() << " us, above its budget of "
+                  << prof.budget.count() << " us (" << overBudget
+                  << " times)" << std::endl;
+      }
+    }
+
+    /////////////////////////////////////////////////
+    std::shared_ptr<google::protobuf::Arena>
+    SubscriptionHandlerBase::RecycledArena() const
+    {
+      if (!this->arenas)
+        return nullptr;
+
+      return this->arenas->Acquire();
     }
 
     /////////////////////////////////////////////////
@@ -80,6 +421,36 @@ namespace ignition
       // Do nothing
     }
 
+    /////////////////////////////////////////////////
+    bool ISubscriptionHandler::RunLocalCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info)
+    {
+      return this->RunLocalCallback(*_msg, _info);
+    }
+
+    /////////////////////////////////////////////////
+    bool ISubscriptionHandler::RunBatchCallback(
+        const std::vector<std::shared_ptr<const ProtoMsg>> &_msgs,
+        const std::vector<MessageInfo> &_infos)
+    {
+      bool result = true;
+      for (std::size_t i = 0; i < _msgs.size() && i < _infos.size(); ++i)
+      {
+        if (_msgs[i])
+          result = this->RunLocalCallback(_msgs[i], _infos[i]) && result;
+      }
+      return result;
+    }
+
+    /////////////////////////////////////////////////
+    const std::shared_ptr<ProtoMsg> ISubscriptionHandler::ParseMsg(
+        const char *_data, const std::size_t _size,
+        const std::string &_type) const
+    {
+      return this->CreateMsg(std::string(_data, _size), _type);
+    }
+
     /////////////////////////////////////////////////
     class RawSubscriptionHandler::Implementation
     {
@@ -130,11 +501,15 @@ namespace ignition
         return false;
       }
 
-      // Check if we need to throttle
-      if (!this->UpdateThrottling())
+      // Check if we need to filter or throttle
+      if (!this->HeaderAccepted(_msgData, _size, _info.Type()) ||
+          !this->UpdateThrottling())
+      {
         return true;
+      }
 
       // Trigger the callback
+      CallbackTimer timer(*this, _info);
       this->pimpl->callback(_msgData, _size, _info);
       return true;
     }
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/MetricsRegistry.hh"
+#include "ignition/transport/SubscriptionHandler.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Check that a generic handler reuses the messages that nobody
+/// retained.
+TEST(SubscriptionHandlerTest, GenericReusesMessages)
+{
+  transport::SubscriptionHandler<transport::ProtoMsg> handler("node-UUID");
+
+  msgs::StringMsg msg;
+  msg.set_data("hello");
+  const std::string data = msg.SerializeAsString();
+  const std::string type = msg.GetTypeName();
+
+  auto first = handler.ParseMsg(data.data(), data.size(), type);
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(type, first->GetTypeName());
+  EXPECT_EQ("hello", static_cast<msgs::StringMsg *>(first.get())->data());
+
+  // The first message is still held, so it's not reused.
+  auto second = handler.ParseMsg(data.data(), data.size(), type);
+  ASSERT_NE(nullptr, second);
+  EXPECT_NE(first.get(), second.get());
+
+  // Once released, the message is cleared and parsed again.
+  const transport::ProtoMsg *released = second.get();
+  second.reset();
+  msgs::StringMsg empty;
+  const std::string emptyData = empty.SerializeAsString();
+  auto third = handler.ParseMsg(emptyData.data(), emptyData.size(), type);
+  ASSERT_NE(nullptr, third);
+  EXPECT_EQ(released, third.get());
+  EXPECT_TRUE(static_cast<msgs::StringMsg *>(third.get())->data().empty());
+
+  // Other types have their own messages.
+  msgs::Int32 other;
+  other.set_data(4);
+  const std::string otherData = other.SerializeAsString();
+  auto fourth = handler.CreateMsg(otherData, other.GetTypeName());
+  ASSERT_NE(nullptr, fourth);
+  EXPECT_EQ(4, static_cast<msgs::Int32 *>(fourth.get())->data());
+
+  // Unknown types can't be parsed.
+  EXPECT_EQ(nullptr, handler.ParseMsg(data.data(), data.size(), "_unknown_"));
+  EXPECT_EQ(nullptr, handler.CreateMsg(data, "_unknown_"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the messages are parsed into recycled arenas.
+TEST(SubscriptionHandlerTest, ArenaAllocation)
+{
+  transport::SubscribeOptions opts;
+  opts.SetArenaAllocation(true);
+  transport::SubscriptionHandler<msgs::StringMsg> typed("node-UUID", opts);
+  transport::SubscriptionHandler<transport::ProtoMsg> generic(
+    "node-UUID", opts);
+  EXPECT_TRUE(typed.ArenaAllocation());
+
+  msgs::StringMsg msg;
+  msg.set_data("hello");
+  const std::string data = msg.SerializeAsString();
+  const std::string type = msg.GetTypeName();
+
+  auto first = typed.ParseMsg(data.data(), data.size(), type);
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ("hello", static_cast<msgs::StringMsg *>(first.get())->data());
+  google::protobuf::Arena *arena = first->GetArena();
+  ASSERT_NE(nullptr, arena);
+
+  // Arenas in use aren't shared.
+  auto second = typed.CreateMsg(data, type);
+  ASSERT_NE(nullptr, second);
+  EXPECT_NE(arena, second->GetArena());
+
+  // Released arenas are reused.
+  first.reset();
+  auto third = typed.ParseMsg(data.data(), data.size(), type);
+  ASSERT_NE(nullptr, third);
+  EXPECT_EQ(arena, third->GetArena());
+  EXPECT_EQ("hello", static_cast<msgs::StringMsg *>(third.get())->data());
+
+  // Generic handlers allocate on arenas too.
+  auto fourth = generic.ParseMsg(data.data(), data.size(), type);
+  ASSERT_NE(nullptr, fourth);
+  EXPECT_NE(nullptr, fourth->GetArena());
+  EXPECT_EQ("hello", static_cast<msgs::StringMsg *>(fourth.get())->data());
+
+  // Messages outlive their handler.
+  transport::ProtoMsgPtr kept;
+  {
+    transport::SubscriptionHandler<msgs::StringMsg> shortLived(
+      "node-UUID", opts);
+    kept = shortLived.ParseMsg(data.data(), data.size(), type);
+  }
+  ASSERT_NE(nullptr, kept);
+  EXPECT_EQ("hello", static_cast<msgs::StringMsg *>(kept.get())->data());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a batch handler runs its callback once per batch.
+TEST(SubscriptionHandlerTest, Batch)
+{
+  transport::SubscribeOptions opts;
+  transport::BatchSubscriptionHandler<msgs::Int32> handler("node-UUID", opts);
+  EXPECT_TRUE(handler.Batched());
+
+  std::vector<std::vector<int>> batches;
+  handler.SetCallback(
+    [&batches](const std::vector<const msgs::Int32 *> &_msgs,
+               const std::vector<transport::MessageInfo> &_infos)
+    {
+      EXPECT_EQ(_msgs.size(), _infos.size());
+      std::vector<int> batch;
+      for (const auto *msg : _msgs)
+        batch.push_back(msg->data());
+      batches.push_back(batch);
+    });
+
+  std::vector<std::shared_ptr<const transport::ProtoMsg>> received;
+  std::vector<transport::MessageInfo> infos(3);
+  for (int i = 0; i < 3; ++i)
+  {
+    msgs::Int32 msg;
+    msg.set_data(i);
+    const std::string data = msg.SerializeAsString();
+    received.push_back(
+      handler.ParseMsg(data.data(), data.size(), msg.GetTypeName()));
+  }
+  EXPECT_TRUE(handler.RunBatchCallback(received, infos));
+
+  // A single message is a batch of one.
+  EXPECT_TRUE(handler.RunLocalCallback(*received[2], infos[2]));
+
+  ASSERT_EQ(2u, batches.size());
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), batches[0]);
+  EXPECT_EQ(std::vector<int>({2}), batches[1]);
+
+  // Other handlers run their callback for each message.
+  transport::SubscriptionHandler<msgs::Int32> single("node-UUID");
+  EXPECT_FALSE(single.Batched());
+  int calls = 0;
+  single.SetCallback(transport::MsgCallback<msgs::Int32>(
+    [&calls](const msgs::Int32 &, const transport::MessageInfo &)
+    {
+      ++calls;
+    }));
+  EXPECT_TRUE(single.RunBatchCallback(received, infos));
+  EXPECT_EQ(3, calls);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the handlers of a type share its interned ID.
+TEST(SubscriptionHandlerTest, TypeId)
+{
+  transport::SubscriptionHandler<msgs::Int32> first("node-UUID");
+  transport::SubscriptionHandler<msgs::Int32> second("node-UUID");
+  transport::SubscriptionHandler<msgs::StringMsg> other("node-UUID");
+  transport::SubscriptionHandler<transport::ProtoMsg> generic("node-UUID");
+
+  EXPECT_NE(0u, first.TypeId());
+  EXPECT_EQ(first.TypeId(), first.TypeId());
+  EXPECT_EQ(first.TypeId(), second.TypeId());
+  EXPECT_NE(first.TypeId(), other.TypeId());
+  EXPECT_NE(first.TypeId(), generic.TypeId());
+  EXPECT_NE(other.TypeId(), generic.TypeId());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the callbacks of a profiled handler are timed, and the
+/// ones above the budget counted.
+TEST(SubscriptionHandlerTest, CallbackProfiling)
+{
+  transport::SubscriptionHandler<msgs::Int32> unprofiled("node-UUID");
+  EXPECT_FALSE(unprofiled.CallbackStats());
+
+  transport::SubscribeOptions opts;
+  opts.SetCallbackBudget(std::chrono::milliseconds(20));
+  transport::SubscriptionHandler<msgs::Int32> handler("node-UUID", opts);
+  std::chrono::milliseconds sleep(0);
+  handler.SetCallback(transport::MsgCallback<msgs::Int32>(
+    [&sleep](const msgs::Int32 &, const transport::MessageInfo &)
+    {
+      std::this_thread::sleep_for(sleep);
+    }));
+
+  msgs::Int32 msg;
+  transport::MessageInfo info;
+  info.SetTopicAndPartition("@/partition@/foo");
+  EXPECT_TRUE(handler.RunLocalCallback(msg, info));
+  sleep = std::chrono::milliseconds(30);
+  EXPECT_TRUE(handler.RunLocalCallback(msg, info));
+
+  auto stats = handler.CallbackStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(handler.HandlerUuid(), stats->handlerUuid);
+  EXPECT_EQ(std::chrono::microseconds(20000), stats->budget);
+  EXPECT_EQ(2u, stats->duration.Count());
+  EXPECT_GE(stats->duration.Max(), 29000u);
+  EXPECT_LT(stats->duration.Min(), 20000u);
+  EXPECT_EQ(1u, stats->overBudget);
+
+  // The slow callbacks are counted by the metrics of the topic.
+  EXPECT_EQ(1u, transport::MetricsRegistry::Instance().Counter(
+    "ign_transport_callbacks_over_budget", "",
+    {{"partition", "/partition"}, {"topic", "/foo"}}).Value());
+
+  // A callback that throws is timed too.
+  transport::SubscribeOptions rawOpts;
+  rawOpts.SetCallbackProfiling(true);
+  transport::RawSubscriptionHandler raw("node-UUID",
+    transport::kGenericMessageType, rawOpts);
+  raw.SetCallback([](const char *, std::size_t,
+                     const transport::MessageInfo &)
+  {
+    throw std::runtime_error("error");
+  });
+  EXPECT_THROW(raw.RunRawCallback("", 0, info), std::runtime_error);
+  stats = raw.CallbackStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(1u, stats->duration.Count());
+  EXPECT_EQ(0u, stats->overBudget);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that ThrottledUpdateReady() tells whether the callback of a
+/// throttled handler would run, without consuming the throttling.
+TEST(SubscriptionHandlerTest, ThrottledUpdateReady)
+{
+  transport::SubscribeOptions opts;
+  opts.SetMsgsPerSec(1u);
+  transport::SubscriptionHandler<msgs::Int32> handler("node-UUID", opts);
+  int received = 0;
+  handler.SetCallback(transport::MsgCallback<msgs::Int32>(
+    [&received](const msgs::Int32 &, const transport::MessageInfo &)
+    {
+      ++received;
+    }));
+
+  // Checking doesn't consume the throttling.
+  EXPECT_TRUE(handler.ThrottledUpdateReady());
+  EXPECT_TRUE(handler.ThrottledUpdateReady());
+
+  msgs::Int32 msg;
+  transport::MessageInfo info;
+  EXPECT_TRUE(handler.RunLocalCallback(msg, info));
+  EXPECT_EQ(1, received);
+  EXPECT_FALSE(handler.ThrottledUpdateReady());
+
+  // The messages discarded by the throttling don't run the callback.
+  EXPECT_TRUE(handler.RunLocalCallback(msg, info));
+  EXPECT_EQ(1, received);
+  EXPECT_FALSE(handler.ThrottledUpdateReady());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  EXPECT_TRUE(handler.ThrottledUpdateReady());
+  EXPECT_TRUE(handler.RunLocalCallback(msg, info));
+  EXPECT_EQ(2, received);
+
+  // An unthrottled handler is always ready.
+  transport::SubscriptionHandler<msgs::Int32> unthrottled("node-UUID");
+  unthrottled.SetCallback(transport::MsgCallback<msgs::Int32>(
+    [](const msgs::Int32 &, const transport::MessageInfo &) {}));
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_TRUE(unthrottled.ThrottledUpdateReady());
+    EXPECT_TRUE(unthrottled.RunLocalCallback(msg, info));
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the header filter drops the messages it rejects.
+TEST(SubscriptionHandlerTest, HeaderFilter)
+{
+  transport::SubscribeOptions opts;
+  opts.SetHeaderFilter([](const msgs::Header &_header)
+    {
+      return _header.stamp().sec() >= 10;
+    });
+  transport::SubscriptionHandler<msgs::Int32> handler("node-UUID", opts);
+  std::vector<int> received;
+  handler.SetCallback(transport::MsgCallback<msgs::Int32>(
+    [&received](const msgs::Int32 &_msg, const transport::MessageInfo &)
+    {
+      received.push_back(_msg.data());
+    }));
+
+  msgs::Int32 early;
+  early.mutable_header()->mutable_stamp()->set_sec(5);
+  early.set_data(1);
+  msgs::Int32 late;
+  late.mutable_header()->mutable_stamp()->set_sec(15);
+  late.set_data(2);
+  const std::string type = early.GetTypeName();
+  const std::string earlyData = early.SerializeAsString();
+  const std::string lateData = late.SerializeAsString();
+
+  // The serialized messages are checked before they're parsed.
+  EXPECT_FALSE(handler.HeaderAccepted(earlyData.data(), earlyData.size(),
+    type));
+  EXPECT_TRUE(handler.HeaderAccepted(lateData.data(), lateData.size(), type));
+
+  // The types without a header aren't filtered.
+  msgs::Time time;
+  const std::string timeData = time.SerializeAsString();
+  EXPECT_TRUE(handler.HeaderAccepted(timeData.data(), timeData.size(),
+    time.GetTypeName()));
+
+  transport::MessageInfo info;
+  EXPECT_TRUE(handler.RunLocalCallback(early, info));
+  EXPECT_TRUE(handler.RunLocalCallback(late, info));
+  EXPECT_EQ(std::vector<int>({2}), received);
+
+  // The generic handlers are filtered too.
+  transport::SubscriptionHandler<transport::ProtoMsg> generic("node-UUID",
+    opts);
+  int genericCalls = 0;
+  generic.SetCallback(transport::MsgCallback<transport::ProtoMsg>(
+    [&genericCalls](const transport::ProtoMsg &,
+                    const transport::MessageInfo &)
+    {
+      ++genericCalls;
+    }));
+  auto parsed = generic.ParseMsg(earlyData.data(), earlyData.size(), type);
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_TRUE(generic.RunLocalCallback(parsed, info));
+  parsed = generic.ParseMsg(lateData.data(), lateData.size(), type);
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_TRUE(generic.RunLocalCallback(parsed, info));
+  EXPECT_EQ(1, genericCalls);
+
+  // So are the raw handlers, without parsing the messages.
+  transport::RawSubscriptionHandler raw("node-UUID", type, opts);
+  int rawCalls = 0;
+  raw.SetCallback([&rawCalls](const char *, std::size_t,
+                              const transport::MessageInfo &)
+  {
+    ++rawCalls;
+  });
+  info.SetType(type);
+  EXPECT_TRUE(raw.RunRawCallback(earlyData.data(), earlyData.size(), info));
+  EXPECT_TRUE(raw.RunRawCallback(lateData.data(), lateData.size(), info));
+  EXPECT_EQ(1, rawCalls);
+}
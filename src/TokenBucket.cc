@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "TokenBucket.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace
+{
+  /// \brief Get the time of the steady clock.
+  /// \return The time in nanoseconds.
+  int64_t steadyNow()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+#ifdef CLOCK_MONOTONIC_COARSE
+  /// \brief Get the time of the coarse monotonic clock. It reads the time
+  /// of the last tick of the kernel without querying the hardware.
+  /// \return The time in nanoseconds.
+  int64_t coarseNow()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  /// \brief Get the resolution of the coarse monotonic clock.
+  /// \return The resolution in nanoseconds.
+  int64_t coarseResolution()
+  {
+    timespec ts;
+    if (clock_getres(CLOCK_MONOTONIC_COARSE, &ts) != 0)
+      return 0;
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+#endif
+}
+
+//////////////////////////////////////////////////
+TokenBucket::TokenBucket(const uint64_t _rate, const uint64_t _burst,
+    const bool _coarseClock)
+  : ratePerNs(static_cast<double>(_rate) / 1e9),
+    capacity(static_cast<double>(std::max<uint64_t>(_burst, 1u))),
+    coarse(false)
+{
+#ifdef CLOCK_MONOTONIC_COARSE
+  if (_coarseClock)
+  {
+    static const int64_t kResolution = coarseResolution();
+    if (kResolution > 0)
+    {
+      this->coarse = true;
+      this->capacity = std::max(this->capacity,
+        this->ratePerNs * static_cast<double>(kResolution));
+    }
+  }
+#else
+  (void)_coarseClock;
+#endif
+
+  // The bucket starts full, the first messages are always accepted.
+  this->tokens = this->capacity;
+  this->lastNs = this->Now();
+}
+
+//////////////////////////////////////////////////
+bool TokenBucket::Ready() const
+{
+  return this->Ready(this->Now());
+}
+
+//////////////////////////////////////////////////
+bool TokenBucket::Ready(const int64_t _nowNs) const
+{
+  return this->Tokens(_nowNs) >= 1.0;
+}
+
+//////////////////////////////////////////////////
+bool TokenBucket::Consume()
+{
+  return this->Consume(this->Now());
+}
+
+//////////////////////////////////////////////////
+bool TokenBucket::Consume(const int64_t _nowNs)
+{
+  const double available = this->Tokens(_nowNs);
+  if (_nowNs > this->lastNs)
+    this->lastNs = _nowNs;
+
+  if (available < 1.0)
+  {
+    this->tokens = available;
+    return false;
+  }
+
+  this->tokens = available - 1.0;
+  return true;
+}
+
+//////////////////////////////////////////////////
+double TokenBucket::Capacity() const
+{
+  return this->capacity;
+}
+
+//////////////////////////////////////////////////
+int64_t TokenBucket::Now() const
+{
+#ifdef CLOCK_MONOTONIC_COARSE
+  if (this->coarse)
+    return coarseNow();
+#endif
+  return steadyNow();
+}
+
+//////////////////////////////////////////////////
+double TokenBucket::Tokens(const int64_t _nowNs) const
+{
+  if (_nowNs <= this->lastNs)
+    return this->tokens;
+
+  return std::min(this->capacity, this->tokens +
+    static_cast<double>(_nowNs - this->lastNs) * this->ratePerNs);
+}
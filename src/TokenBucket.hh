@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TOKENBUCKET_HH_
+#define IGN_TRANSPORT_TOKENBUCKET_HH_
+
+#include <cstdint>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class TokenBucket TokenBucket.hh
+    /// \brief Rate limiter of the throttled publishers and subscriptions.
+    /// The bucket holds up to _burst tokens and is refilled at _rate tokens
+    /// per second. Each accepted message takes one token, so the average
+    /// rate is bounded while up to _burst messages may pass back to back.
+    /// A burst of one accepts a message when a full period has elapsed
+    /// since the previous one.
+    class IGNITION_TRANSPORT_VISIBLE TokenBucket
+    {
+      /// \brief Constructor.
+      /// \param[in] _rate Number of tokens added per second.
+      /// \param[in] _burst Capacity of the bucket, at least one.
+      /// \param[in] _coarseClock Read the time from the coarse clock of the
+      /// system, which is cheaper than std::chrono::steady_clock. The
+      /// capacity then covers at least one tick of that clock, otherwise
+      /// the messages sent within a tick would be dropped.
+      public: TokenBucket(const uint64_t _rate, const uint64_t _burst,
+                          const bool _coarseClock = false);
+
+      /// \brief Check whether a message would be accepted now, without
+      /// taking a token.
+      /// \return True if a token is available.
+      public: bool Ready() const;
+
+      /// \brief Check whether a message would be accepted at a given time,
+      /// without taking a token.
+      /// \param[in] _nowNs Current time (nanoseconds), as returned by Now().
+      /// \return True if a token is available.
+      public: bool Ready(const int64_t _nowNs) const;
+
+      /// \brief Take a token if available.
+      /// \return True if the message is accepted.
+      public: bool Consume();
+
+      /// \brief Take a token if available at a given time.
+      /// \param[in] _nowNs Current time (nanoseconds), as returned by Now().
+      /// \return True if the message is accepted.
+      public: bool Consume(const int64_t _nowNs);
+
+      /// \brief Capacity of the bucket.
+      /// \return The maximum number of tokens.
+      public: double Capacity() const;
+
+      /// \brief Get the time of the clock used by this bucket.
+      /// \return Monotonic time in nanoseconds.
+      public: int64_t Now() const;
+
+      /// \brief Number of tokens available at a given time.
+      /// \param[in] _nowNs Current time (nanoseconds).
+      /// \return The number of tokens.
+      private: double Tokens(const int64_t _nowNs) const;
+
+      /// \brief Tokens added per nanosecond.
+      private: double ratePerNs;
+
+      /// \brief Maximum number of tokens.
+      private: double capacity;
+
+      /// \brief Tokens available at lastNs.
+      private: double tokens;
+
+      /// \brief Time of the last refill (nanoseconds).
+      private: int64_t lastNs = 0;
+
+      /// \brief Whether the coarse clock is used.
+      private: bool coarse;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdint>
+
+#include "TokenBucket.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief A burst of one accepts a message per period.
+TEST(TokenBucketTest, StrictPeriod)
+{
+  transport::TokenBucket bucket(10u, 1u);
+  const int64_t start = bucket.Now();
+
+  EXPECT_TRUE(bucket.Consume(start));
+  EXPECT_FALSE(bucket.Ready(start + 50000000));
+  EXPECT_FALSE(bucket.Consume(start + 50000000));
+  EXPECT_TRUE(bucket.Ready(start + 100000000));
+  EXPECT_TRUE(bucket.Consume(start + 100000000));
+
+  // Idle time doesn't accumulate more than the capacity.
+  EXPECT_TRUE(bucket.Consume(start + 1000000000));
+  EXPECT_FALSE(bucket.Consume(start + 1000000000));
+}
+
+//////////////////////////////////////////////////
+/// \brief Bursts are accepted up to the capacity without exceeding the
+/// average rate.
+TEST(TokenBucketTest, Burst)
+{
+  transport::TokenBucket bucket(10u, 5u);
+  EXPECT_DOUBLE_EQ(5.0, bucket.Capacity());
+  const int64_t start = bucket.Now();
+
+  for (int i = 0; i < 5; ++i)
+    EXPECT_TRUE(bucket.Consume(start));
+  EXPECT_FALSE(bucket.Consume(start));
+
+  // Half a period later there is still no token.
+  EXPECT_FALSE(bucket.Consume(start + 50000000));
+  EXPECT_TRUE(bucket.Consume(start + 100000000));
+  EXPECT_FALSE(bucket.Consume(start + 100000000));
+
+  // Over one second, the average rate is bounded.
+  int accepted = 0;
+  for (int64_t t = 0; t <= 1000000000; t += 1000000)
+  {
+    if (bucket.Consume(start + 1000000000 + t))
+      ++accepted;
+  }
+  EXPECT_LE(accepted, 5 + 10 + 1);
+  EXPECT_GE(accepted, 10);
+}
+
+//////////////////////////////////////////////////
+/// \brief The coarse clock raises the capacity to cover one of its ticks.
+TEST(TokenBucketTest, CoarseClock)
+{
+  transport::TokenBucket bucket(1000000u, 1u, true);
+  EXPECT_GE(bucket.Capacity(), 1.0);
+  EXPECT_TRUE(bucket.Consume());
+
+  const int64_t before = bucket.Now();
+  const int64_t after = bucket.Now();
+  EXPECT_LE(before, after);
+
+  // Zero is treated as one.
+  transport::TokenBucket zero(10u, 0u);
+  EXPECT_DOUBLE_EQ(1.0, zero.Capacity());
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "TopicAlias.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+std::string transport::TopicIdCtrl(const uint32_t _id,
+  const std::string &_multicastGroup)
+{
+  std::string ctrl = kTopicIdCtrlPrefix + std::to_string(_id);
+  if (!_multicastGroup.empty())
+    ctrl += kMulticastCtrlSeparator + _multicastGroup;
+  return ctrl;
+}
+
+//////////////////////////////////////////////////
+bool transport::ParseTopicIdCtrl(const std::string &_ctrl, uint32_t &_id)
+{
+  if (_ctrl.size() <= kTopicIdCtrlPrefix.size() ||
+      _ctrl.compare(0, kTopicIdCtrlPrefix.size(), kTopicIdCtrlPrefix) != 0)
+  {
+    return false;
+  }
+
+  // Other fields may follow the topic ID, separated with ';'.
+  const auto end = _ctrl.find(';');
+  const std::string number = end == std::string::npos ?
+    _ctrl.substr(kTopicIdCtrlPrefix.size()) :
+    _ctrl.substr(kTopicIdCtrlPrefix.size(), end - kTopicIdCtrlPrefix.size());
+  if (number.empty() ||
+      number.find_first_not_of("0123456789") != std::string::npos)
+  {
+    return false;
+  }
+
+  try
+  {
+    const unsigned long long id = std::stoull(number);
+    if (id > UINT32_MAX)
+      return false;
+    _id = static_cast<uint32_t>(id);
+  }
+  catch (std::out_of_range &)
+  {
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string transport::ParseMulticastCtrl(const std::string &_ctrl)
+{
+  uint32_t id;
+  const auto pos = _ctrl.find(kMulticastCtrlSeparator);
+  if (pos == std::string::npos || !ParseTopicIdCtrl(_ctrl, id))
+    return "";
+
+  const auto begin = pos + kMulticastCtrlSeparator.size();
+  const auto end = _ctrl.find(';', begin);
+  return end == std::string::npos ?
+    _ctrl.substr(begin) : _ctrl.substr(begin, end - begin);
+}
+
+//////////////////////////////////////////////////
+std::string transport::TopicAlias(const std::string &_pUuid,
+  const uint32_t _id)
+{
+  // FNV-1a, which is stable across platforms and compilers, unlike
+  // std::hash.
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char c : _pUuid)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+
+  std::string alias(kTopicAliasSize, '\0');
+  std::memcpy(&alias[1], &hash, sizeof(hash));
+  std::memcpy(&alias[1 + sizeof(hash)], &_id, sizeof(_id));
+  return alias;
+}
+
+//////////////////////////////////////////////////
+bool transport::IsTopicAlias(const std::string &_frame)
+{
+  return _frame.size() == kTopicAliasSize && _frame[0] == '\0';
+}
+
+//////////////////////////////////////////////////
+std::string transport::DirectTopicPrefix(const std::string &_pUuid)
+{
+  return std::string(1, '\0') + "direct:" + _pUuid + ":";
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TOPICALIAS_HH_
+#define IGN_TRANSPORT_TOPICALIAS_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Prefix of the control field of an advertisement that carries
+    /// the topic ID assigned by the publisher process.
+    static const std::string kTopicIdCtrlPrefix = "id:";
+
+    /// \brief Separator of the multicast group that follows the topic ID in
+    /// the control field of an advertisement.
+    static const std::string kMulticastCtrlSeparator = ";mcast:";
+
+    /// \brief Prefix of the address used by subscribers to register as
+    /// capable of receiving publications with a topic alias.
+    static const std::string kTopicAliasAddrPrefix = "alias://";
+
+    /// \brief Size of a topic alias (bytes).
+    static const std::size_t kTopicAliasSize = 13;
+
+    /// \brief Get the control field of an advertisement for a topic ID.
+    /// \param[in] _id Topic ID.
+    /// \param[in] _multicastGroup Multicast group the topic is sent to, if
+    /// any.
+    /// \return The control field.
+    IGNITION_TRANSPORT_VISIBLE std::string TopicIdCtrl(const uint32_t _id,
+      const std::string &_multicastGroup = "");
+
+    /// \brief Get the topic ID advertised in a control field.
+    /// \param[in] _ctrl Control field of an advertisement.
+    /// \param[out] _id Topic ID.
+    /// \return True if the advertisement contains a topic ID. Publishers
+    /// from older versions don't advertise topic IDs.
+    IGNITION_TRANSPORT_VISIBLE bool ParseTopicIdCtrl(const std::string &_ctrl,
+      uint32_t &_id);
+
+    /// \brief Get the multicast group advertised in a control field.
+    /// \param[in] _ctrl Control field of an advertisement.
+    /// \return The multicast group, or an empty string if the topic isn't
+    /// sent to a multicast group.
+    IGNITION_TRANSPORT_VISIBLE std::string ParseMulticastCtrl(
+      const std::string &_ctrl);
+
+    /// \brief Get the alias sent in the topic frame instead of the topic
+    /// name. The alias always starts with a null character, so it can't
+    /// match a fully qualified topic name, and contains a hash of the
+    /// process UUID, so aliases from different publishers don't collide in
+    /// the subscription filters.
+    /// \param[in] _pUuid UUID of the publisher process.
+    /// \param[in] _id Topic ID assigned by the publisher process.
+    /// \return The alias.
+    IGNITION_TRANSPORT_VISIBLE std::string TopicAlias(
+      const std::string &_pUuid, const uint32_t _id);
+
+    /// \brief Check whether a topic frame contains an alias.
+    /// \param[in] _frame Topic frame.
+    /// \return True if _frame is an alias.
+    IGNITION_TRANSPORT_VISIBLE bool IsTopicAlias(const std::string &_frame);
+
+    /// \brief Get the prefix of the topic frame of the messages sent to a
+    /// single subscriber process, e.g. the latest message of a topic with
+    /// transient local durability. Each process filters its own prefix. It
+    /// starts with a null character, like the aliases, but it's longer.
+    /// \param[in] _pUuid UUID of the subscriber process.
+    /// \return The prefix, followed by the topic name in the topic frame.
+    IGNITION_TRANSPORT_VISIBLE std::string DirectTopicPrefix(
+      const std::string &_pUuid);
+    }
+  }
+}
+#endif
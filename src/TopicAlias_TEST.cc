@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdint>
+#include <string>
+
+#include "TopicAlias.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the control field carrying the topic ID.
+TEST(TopicAliasTest, Ctrl)
+{
+  uint32_t id = 0;
+  EXPECT_TRUE(ParseTopicIdCtrl(TopicIdCtrl(42), id));
+  EXPECT_EQ(42u, id);
+  EXPECT_TRUE(ParseTopicIdCtrl(TopicIdCtrl(UINT32_MAX), id));
+  EXPECT_EQ(UINT32_MAX, id);
+
+  // Older publishers.
+  EXPECT_FALSE(ParseTopicIdCtrl("unused", id));
+  EXPECT_FALSE(ParseTopicIdCtrl("", id));
+  EXPECT_FALSE(ParseTopicIdCtrl("id:", id));
+  EXPECT_FALSE(ParseTopicIdCtrl("id:-1", id));
+  EXPECT_FALSE(ParseTopicIdCtrl("id:12a", id));
+  EXPECT_FALSE(ParseTopicIdCtrl("id:4294967296", id));
+  EXPECT_FALSE(ParseTopicIdCtrl("id:99999999999999999999999", id));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the multicast group carried after the topic ID.
+TEST(TopicAliasTest, MulticastCtrl)
+{
+  const std::string ctrl = TopicIdCtrl(7, "239.255.0.7:11320");
+  uint32_t id = 0;
+  EXPECT_TRUE(ParseTopicIdCtrl(ctrl, id));
+  EXPECT_EQ(7u, id);
+  EXPECT_EQ("239.255.0.7:11320", ParseMulticastCtrl(ctrl));
+
+  EXPECT_TRUE(ParseMulticastCtrl(TopicIdCtrl(7)).empty());
+  EXPECT_TRUE(ParseMulticastCtrl("unused").empty());
+  EXPECT_TRUE(ParseMulticastCtrl("id:;mcast:239.255.0.7:11320").empty());
+  EXPECT_FALSE(ParseTopicIdCtrl("id:;mcast:239.255.0.7:11320", id));
+
+  // Other fields may follow.
+  EXPECT_TRUE(ParseTopicIdCtrl("id:8;nack:tcp://10.0.0.1:4000,abc", id));
+  EXPECT_EQ(8u, id);
+  EXPECT_TRUE(ParseMulticastCtrl("id:8;nack:tcp://10.0.0.1:4000,abc").empty());
+  EXPECT_EQ("239.255.0.7:11320",
+    ParseMulticastCtrl(ctrl + ";nack:tcp://10.0.0.1:4000,abc"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the aliases.
+TEST(TopicAliasTest, Alias)
+{
+  const std::string alias = TopicAlias("process-a", 1);
+  EXPECT_EQ(kTopicAliasSize, alias.size());
+  EXPECT_TRUE(IsTopicAlias(alias));
+  EXPECT_EQ(alias, TopicAlias("process-a", 1));
+  EXPECT_NE(alias, TopicAlias("process-a", 2));
+  EXPECT_NE(alias, TopicAlias("process-b", 1));
+
+  EXPECT_FALSE(IsTopicAlias("@/foo"));
+  EXPECT_FALSE(IsTopicAlias("@partition@/x"));
+  EXPECT_FALSE(IsTopicAlias(""));
+}
+
+//////////////////////////////////////////////////
+TEST(TopicAliasTest, DirectTopicPrefix)
+{
+  const std::string prefix = DirectTopicPrefix("process-a");
+  EXPECT_EQ('\0', prefix[0]);
+  EXPECT_GT(prefix.size(), kTopicAliasSize);
+  EXPECT_NE(prefix, DirectTopicPrefix("process-b"));
+  EXPECT_FALSE(IsTopicAlias(prefix + "@/foo"));
+
+  // A process doesn't receive the messages sent to a process whose UUID
+  // starts with its own.
+  const std::string other = DirectTopicPrefix("process-ab");
+  EXPECT_NE(0, other.compare(0, prefix.size(), prefix));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
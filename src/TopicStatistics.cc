@@ -16,9 +16,12 @@
 */
 #include <ignition/msgs/statistic.pb.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <map>
 #include <sstream>
+#include <string>
 
 #include "ignition/transport/TopicStatistics.hh"
 
@@ -33,19 +36,66 @@ class ignition::transport::TopicStatisticsPrivate
   /// \brief Copy constructor
   /// \param[in] _stats Statistics to copy.
   public: explicit TopicStatisticsPrivate(const TopicStatisticsPrivate &_stats)
-          : seq(_stats.seq),
+          : senders(_stats.senders),
+            useCount(_stats.useCount),
             publication(_stats.publication),
             reception(_stats.reception),
             age(_stats.age),
             droppedMsgCount(_stats.droppedMsgCount),
+            queueDroppedMsgCount(_stats.queueDroppedMsgCount),
             prevPublicationStamp(_stats.prevPublicationStamp),
-            prevReceptionStamp(_stats.prevReceptionStamp)
+            prevReceptionStamp(_stats.prevReceptionStamp),
+            clockOffsetCorrection(_stats.clockOffsetCorrection)
   {
   }
 
-  /// \brief Map of address to sequence numbers. This is used to
-  /// identify dropped messages.
-  public: std::map<std::string, uint64_t> seq;
+  /// \brief What is tracked for each sender.
+  public: struct Sender
+          {
+            /// \brief Latest sequence number, used to identify dropped
+            /// messages.
+            public: uint64_t seq = 0;
+
+            /// \brief Whether clockOffset was estimated.
+            public: bool hasClockOffset = false;
+
+            /// \brief Estimated clock offset of a sender of another host, in
+            /// nanoseconds.
+            public: int64_t clockOffset = 0;
+
+            /// \brief Value of useCount when the sender was last heard.
+            public: uint64_t lastUse = 0;
+          };
+
+  /// \brief Get a sender, forgetting the least recently heard one if there
+  /// are too many.
+  /// \param[in] _sender Address of the sender.
+  /// \return The sender.
+  public: Sender &SenderOf(const std::string &_sender)
+  {
+    auto it = this->senders.find(_sender);
+    if (it == this->senders.end())
+    {
+      if (this->senders.size() >= TopicStatistics::kMaxSenders)
+      {
+        auto oldest = std::min_element(this->senders.begin(),
+          this->senders.end(), [](const auto &_a, const auto &_b)
+          {
+            return _a.second.lastUse < _b.second.lastUse;
+          });
+        this->senders.erase(oldest);
+      }
+      it = this->senders.emplace(_sender, Sender()).first;
+    }
+    it->second.lastUse = ++this->useCount;
+    return it->second;
+  }
+
+  /// \brief Senders by address, at most TopicStatistics::kMaxSenders.
+  public: std::map<std::string, Sender> senders;
+
+  /// \brief Number of updates, orders the senders by last use.
+  public: uint64_t useCount = 0;
 
   /// \brief Statistics for the publisher.
   public: Statistics publication;
@@ -59,13 +109,54 @@ class ignition::transport::TopicStatisticsPrivate
   /// \brief Total number of dropped messages.
   public: uint64_t droppedMsgCount = 0;
 
-  /// \brief Previous publication time stamp.
-  public: uint64_t prevPublicationStamp = 0;
+  /// \brief Total number of messages discarded by the subscription queues.
+  public: uint64_t queueDroppedMsgCount = 0;
+
+  /// \brief Previous publication time stamp, in nanoseconds.
+  public: int64_t prevPublicationStamp = 0;
+
+  /// \brief Previous reception time stamp, in nanoseconds.
+  public: int64_t prevReceptionStamp = 0;
 
-  /// \brief Previous reception time stamp.
-  public: uint64_t prevReceptionStamp = 0;
+  /// \brief True if the age of the messages from other hosts is corrected.
+  public: bool clockOffsetCorrection = false;
 };
 
+namespace
+{
+  /// \brief Convert nanoseconds to the milliseconds of the statistics.
+  /// \param[in] _ns Duration in nanoseconds.
+  /// \return Duration in milliseconds.
+  double Milliseconds(int64_t _ns)
+  {
+    return static_cast<double>(_ns) / 1e6;
+  }
+}
+
+namespace
+{
+  /// \brief Add the percentiles of some statistics to a group.
+  /// \param[in] _group The group.
+  /// \param[in] _stats The statistics.
+  /// \param[in] _suffix Suffix of the names of the statistics, e.g.
+  /// "_age" for "p99_age".
+  void AddPercentiles(msgs::StatisticsGroup &_group,
+    const Statistics &_stats, const std::string &_suffix)
+  {
+    const double percentiles[] = {50, 90, 99, 99.9};
+    for (const double percentile : percentiles)
+    {
+      std::ostringstream name;
+      name << "p" << percentile << _suffix;
+
+      // msgs::Statistic has no percentile type.
+      msgs::Statistic *stat = _group.add_statistics();
+      stat->set_name(name.str());
+      stat->set_value(_stats.Percentile(percentile));
+    }
+  }
+}
+
 //////////////////////////////////////////////////
 void Statistics::Update(double _stat)
 {
@@ -86,6 +177,11 @@ void Statistics::Update(double _stat)
   // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Welford%27s_online_algorithm
   this->sumSquareMeanDist += (_stat - currentAvg) *
     (_stat - this->average);
+
+  // Keep the distribution in integer units of kPercentileResolution.
+  const double value = std::min(std::max(_stat, 0.0) / kPercentileResolution,
+    static_cast<double>(Histogram::kMaxValue));
+  this->histogram.Record(static_cast<uint64_t>(std::llround(value)));
 }
 
 //////////////////////////////////////////////////
@@ -118,6 +214,40 @@ uint64_t Statistics::Count() const
   return this->count;
 }
 
+//////////////////////////////////////////////////
+double Statistics::Percentile(double _percentile) const
+{
+  return static_cast<double>(this->histogram.ValueAtPercentile(_percentile)) *
+    kPercentileResolution;
+}
+
+//////////////////////////////////////////////////
+void Statistics::Merge(const Statistics &_other)
+{
+  if (_other.count == 0)
+    return;
+
+  // Combine the averages and variances of both sets of samples, see
+  // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm
+  const double total = static_cast<double>(this->count + _other.count);
+  const double delta = _other.average - this->average;
+  this->sumSquareMeanDist += _other.sumSquareMeanDist + delta * delta *
+    static_cast<double>(this->count) * static_cast<double>(_other.count) /
+    total;
+  this->average += delta * static_cast<double>(_other.count) / total;
+  this->count += _other.count;
+
+  this->min = std::min(this->min, _other.min);
+  this->max = std::max(this->max, _other.max);
+  this->histogram.Merge(_other.histogram);
+}
+
+//////////////////////////////////////////////////
+const Histogram &Statistics::Distribution() const
+{
+  return this->histogram;
+}
+
 //////////////////////////////////////////////////
 TopicStatistics::TopicStatistics()
   : dataPtr(new TopicStatisticsPrivate)
@@ -138,30 +268,67 @@ TopicStatistics::~TopicStatistics()
 //////////////////////////////////////////////////
 void TopicStatistics::Update(const std::string &_sender,
     uint64_t _stamp, uint64_t _seq)
+{
+  const std::chrono::nanoseconds stamp = std::chrono::milliseconds(_stamp);
+  this->Update(_sender, stamp, std::chrono::nanoseconds::zero(), true, _seq);
+}
+
+//////////////////////////////////////////////////
+void TopicStatistics::Update(const std::string &_sender,
+    const std::chrono::nanoseconds &_stamp,
+    const std::chrono::nanoseconds &_systemStamp, bool _sameHost,
+    uint64_t _seq)
 {
   // Current wall time
-  uint64_t now =
-    std::chrono::duration_cast<std::chrono::milliseconds>(
+  const int64_t now =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
         std::chrono::steady_clock::now().time_since_epoch()).count();
+  const int64_t stamp = _stamp.count();
+  TopicStatisticsPrivate::Sender &sender = this->dataPtr->SenderOf(_sender);
 
   if (this->dataPtr->prevPublicationStamp != 0)
   {
-    this->dataPtr->publication.Update(static_cast<double>(_stamp -
+    this->dataPtr->publication.Update(Milliseconds(stamp -
         this->dataPtr->prevPublicationStamp));
-    this->dataPtr->reception.Update(static_cast<double>(now -
+    this->dataPtr->reception.Update(Milliseconds(now -
           this->dataPtr->prevReceptionStamp));
-    this->dataPtr->age.Update(static_cast<double>(now - _stamp));
 
-    if (this->dataPtr->seq[_sender] + 1 != _seq)
+    int64_t age = now - stamp;
+    if (!_sameHost)
+    {
+      age = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() -
+        _systemStamp.count();
+
+      if (this->dataPtr->clockOffsetCorrection)
+      {
+        if (!sender.hasClockOffset)
+        {
+          sender.clockOffset = age;
+          sender.hasClockOffset = true;
+        }
+        sender.clockOffset = std::min(sender.clockOffset, age);
+        age -= sender.clockOffset;
+      }
+    }
+    this->dataPtr->age.Update(Milliseconds(age));
+
+    if (sender.seq + 1 != _seq)
     {
       this->dataPtr->droppedMsgCount++;
     }
   }
 
-  this->dataPtr->prevPublicationStamp = _stamp;
+  this->dataPtr->prevPublicationStamp = stamp;
   this->dataPtr->prevReceptionStamp = now;
 
-  this->dataPtr->seq[_sender] = _seq;
+  sender.seq = _seq;
+}
+
+//////////////////////////////////////////////////
+void TopicStatistics::SetClockOffsetCorrection(bool _enable)
+{
+  this->dataPtr->clockOffsetCorrection = _enable;
 }
 
 //////////////////////////////////////////////////
@@ -173,6 +340,11 @@ void TopicStatistics::FillMessage(msgs::Metric &_msg) const
   stat->set_name("dropped_message_count");
   stat->set_value(static_cast<double>(this->dataPtr->droppedMsgCount));
 
+  stat = _msg.add_statistics();
+  stat->set_type(msgs::Statistic::SAMPLE_COUNT);
+  stat->set_name("queue_dropped_message_count");
+  stat->set_value(static_cast<double>(this->dataPtr->queueDroppedMsgCount));
+
   // Publication statistics
   msgs::StatisticsGroup *statGroup = _msg.add_statistics_groups();
   statGroup->set_name("publication_statistics");
@@ -196,6 +368,8 @@ void TopicStatistics::FillMessage(msgs::Metric &_msg) const
   stat->set_name("period_standard_devation");
   stat->set_value(this->dataPtr->publication.StdDev());
 
+  AddPercentiles(*statGroup, this->dataPtr->publication, "_period");
+
   // Reception statistics
   statGroup = _msg.add_statistics_groups();
   statGroup->set_name("reception_statistics");
@@ -220,6 +394,8 @@ void TopicStatistics::FillMessage(msgs::Metric &_msg) const
   stat->set_name("period_standard_devation");
   stat->set_value(this->dataPtr->reception.StdDev());
 
+  AddPercentiles(*statGroup, this->dataPtr->reception, "_period");
+
   // Age statistics
   statGroup = _msg.add_statistics_groups();
   statGroup->set_name("age_statistics");
@@ -243,6 +419,8 @@ void TopicStatistics::FillMessage(msgs::Metric &_msg) const
   stat->set_type(msgs::Statistic::STDDEV);
   stat->set_name("age_standard_devation");
   stat->set_value(this->dataPtr->age.StdDev());
+
+  AddPercentiles(*statGroup, this->dataPtr->age, "_age");
 }
 
 //////////////////////////////////////////////////
@@ -251,6 +429,18 @@ uint64_t TopicStatistics::DroppedMsgCount() const
   return this->dataPtr->droppedMsgCount;
 }
 
+//////////////////////////////////////////////////
+void TopicStatistics::UpdateQueueDrops(uint64_t _count)
+{
+  this->dataPtr->queueDroppedMsgCount += _count;
+}
+
+//////////////////////////////////////////////////
+uint64_t TopicStatistics::QueueDroppedMsgCount() const
+{
+  return this->dataPtr->queueDroppedMsgCount;
+}
+
 //////////////////////////////////////////////////
 Statistics TopicStatistics::PublicationStatistics() const
 {
@@ -268,3 +458,13 @@ Statistics TopicStatistics::AgeStatistics() const
 {
   return this->dataPtr->age;
 }
+
+//////////////////////////////////////////////////
+void TopicStatistics::Merge(const TopicStatistics &_other)
+{
+  this->dataPtr->publication.Merge(_other.dataPtr->publication);
+  this->dataPtr->reception.Merge(_other.dataPtr->reception);
+  this->dataPtr->age.Merge(_other.dataPtr->age);
+  this->dataPtr->droppedMsgCount += _other.dataPtr->droppedMsgCount;
+  this->dataPtr->queueDroppedMsgCount += _other.dataPtr->queueDroppedMsgCount;
+}
@@ -15,6 +15,8 @@
  *
 */
 
+#include <chrono>
+
 #include "gtest/gtest.h"
 #include "ignition/transport/TopicStatistics.hh"
 
@@ -33,6 +35,7 @@ TEST(TopicsStatistics, Constructor)
 
   TopicStatistics topicStats;
   EXPECT_EQ(0u, topicStats.DroppedMsgCount());
+  EXPECT_EQ(0u, topicStats.QueueDroppedMsgCount());
   EXPECT_DOUBLE_EQ(0.0, topicStats.PublicationStatistics().Avg());
   EXPECT_DOUBLE_EQ(0.0, topicStats.PublicationStatistics().StdDev());
   EXPECT_DOUBLE_EQ(std::numeric_limits<double>::max(),
@@ -65,6 +68,44 @@ TEST(TopicsStatistics, DroppedMsg)
   EXPECT_EQ(2u, topicStats.DroppedMsgCount());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that the least recently heard senders are forgotten.
+TEST(TopicsStatistics, MaxSenders)
+{
+  TopicStatistics topicStats;
+  uint64_t stamp = 1;
+  topicStats.Update("a", stamp++, 0);
+  for (std::size_t i = 0; i + 1 < TopicStatistics::kMaxSenders; ++i)
+    topicStats.Update("s" + std::to_string(i), stamp++, 1);
+  topicStats.Update("a", stamp++, 1);
+  EXPECT_EQ(0u, topicStats.DroppedMsgCount());
+
+  // The new sender replaces s0, which is new again when heard.
+  topicStats.Update("new", stamp++, 1);
+  topicStats.Update("a", stamp++, 2);
+  EXPECT_EQ(0u, topicStats.DroppedMsgCount());
+  topicStats.Update("s0", stamp++, 2);
+  EXPECT_EQ(1u, topicStats.DroppedMsgCount());
+
+  // The copies keep track of the same senders.
+  TopicStatistics copy(topicStats);
+  copy.Update("a", stamp++, 3);
+  EXPECT_EQ(1u, copy.DroppedMsgCount());
+}
+
+//////////////////////////////////////////////////
+TEST(TopicsStatistics, QueueDroppedMsg)
+{
+  TopicStatistics topicStats;
+  topicStats.UpdateQueueDrops(3);
+  topicStats.UpdateQueueDrops(2);
+  EXPECT_EQ(5u, topicStats.QueueDroppedMsgCount());
+  EXPECT_EQ(0u, topicStats.DroppedMsgCount());
+
+  TopicStatistics copy(topicStats);
+  EXPECT_EQ(5u, copy.QueueDroppedMsgCount());
+}
+
 //////////////////////////////////////////////////
 TEST(TopicsStatistics, MinMax)
 {
@@ -102,6 +143,139 @@ TEST(TopicsStatistics, AvgStdDev)
   EXPECT_NEAR(0.816, stats.StdDev(), 1e-3);
 }
 
+//////////////////////////////////////////////////
+TEST(TopicsStatistics, Percentiles)
+{
+  Statistics stats;
+  EXPECT_DOUBLE_EQ(0.0, stats.Percentile(99));
+
+  // 1000 samples of 1 ms and 10 slow samples of 50 ms.
+  for (int i = 0; i < 1000; ++i)
+    stats.Update(1.0);
+  for (int i = 0; i < 10; ++i)
+    stats.Update(50.0);
+
+  const double tolerance = 1.0 / (1u << Histogram::kSubBucketBits);
+  EXPECT_NEAR(1.0, stats.Percentile(50), 1.0 * tolerance);
+  EXPECT_NEAR(1.0, stats.Percentile(99), 1.0 * tolerance);
+  EXPECT_NEAR(50.0, stats.Percentile(99.9), 50.0 * tolerance);
+  EXPECT_DOUBLE_EQ(50.0, stats.Percentile(100));
+  EXPECT_EQ(1010u, stats.Distribution().Count());
+}
+
+//////////////////////////////////////////////////
+TEST(TopicsStatistics, Merge)
+{
+  Statistics first;
+  first.Update(1.0);
+  first.Update(2.0);
+
+  Statistics second;
+  second.Update(3.0);
+
+  Statistics all;
+  all.Merge(first);
+  all.Merge(second);
+  all.Merge(Statistics());
+  EXPECT_EQ(3u, all.Count());
+  EXPECT_DOUBLE_EQ(2.0, all.Avg());
+  EXPECT_NEAR(0.816, all.StdDev(), 1e-3);
+  EXPECT_DOUBLE_EQ(1.0, all.Min());
+  EXPECT_DOUBLE_EQ(3.0, all.Max());
+  EXPECT_NEAR(3.0, all.Percentile(100), 1e-3);
+
+  TopicStatistics topicStats;
+  topicStats.Update("foo", 1, 0);
+  topicStats.Update("foo", 2, 2);
+  TopicStatistics otherStats;
+  otherStats.Update("bar", 1, 0);
+  otherStats.Update("bar", 3, 1);
+  otherStats.UpdateQueueDrops(2);
+
+  topicStats.Merge(otherStats);
+  EXPECT_EQ(1u, topicStats.DroppedMsgCount());
+  EXPECT_EQ(2u, topicStats.QueueDroppedMsgCount());
+  EXPECT_EQ(2u, topicStats.PublicationStatistics().Count());
+  EXPECT_DOUBLE_EQ(1.5, topicStats.PublicationStatistics().Avg());
+}
+
+//////////////////////////////////////////////////
+TEST(TopicsStatistics, FillMessagePercentiles)
+{
+  TopicStatistics topicStats;
+  topicStats.Update("foo", 1, 0);
+  topicStats.Update("foo", 5, 1);
+
+  msgs::Metric msg;
+  topicStats.FillMessage(msg);
+  ASSERT_EQ(3, msg.statistics_groups_size());
+
+  const msgs::StatisticsGroup &publication = msg.statistics_groups(0);
+  EXPECT_EQ("publication_statistics", publication.name());
+  bool found = false;
+  for (const auto &stat : publication.statistics())
+  {
+    if (stat.name() == "p99.9_period")
+    {
+      EXPECT_DOUBLE_EQ(4.0, stat.value());
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+//////////////////////////////////////////////////
+/// \brief Sub-millisecond ages of the messages from the same host.
+TEST(TopicsStatistics, NanosecondAge)
+{
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+
+  TopicStatistics topicStats;
+  for (uint64_t seq = 0; seq < 3; ++seq)
+  {
+    const auto stamp = duration_cast<nanoseconds>(
+      (std::chrono::steady_clock::now() - std::chrono::microseconds(200))
+      .time_since_epoch());
+    topicStats.Update("foo", stamp, nanoseconds::zero(), true, seq);
+  }
+
+  const Statistics age = topicStats.AgeStatistics();
+  EXPECT_EQ(2u, age.Count());
+  EXPECT_GE(age.Min(), 0.2);
+  EXPECT_LT(age.Max(), 1000.0);
+}
+
+//////////////////////////////////////////////////
+/// \brief Ages of the messages from a host whose clock is 10 seconds late.
+TEST(TopicsStatistics, ClockOffset)
+{
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+
+  auto systemStamp = []()
+  {
+    return duration_cast<nanoseconds>(
+      (std::chrono::system_clock::now() - std::chrono::seconds(10))
+      .time_since_epoch());
+  };
+
+  TopicStatistics raw;
+  TopicStatistics corrected;
+  corrected.SetClockOffsetCorrection(true);
+  for (uint64_t seq = 0; seq < 3; ++seq)
+  {
+    const nanoseconds stamp(static_cast<int64_t>(seq + 1) * 1000000);
+    raw.Update("tcp://10.0.0.2:5000", stamp, systemStamp(), false, seq);
+    corrected.Update("tcp://10.0.0.2:5000", stamp, systemStamp(), false,
+      seq);
+  }
+
+  EXPECT_GE(raw.AgeStatistics().Min(), 10000.0);
+  EXPECT_LT(corrected.AgeStatistics().Max(), 1000.0);
+  EXPECT_DOUBLE_EQ(1.0, corrected.PublicationStatistics().Avg());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -479,6 +479,87 @@ TEST(TopicStorageTest, PublishersByNode)
   EXPECT_EQ(pubs.at(0).Addr(), g_addr1);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that the process and node indexes follow the removals.
+TEST(TopicStorageTest, IndexesAfterRemovals)
+{
+  init();
+
+  Publisher publisher1(g_topic1, g_addr1, g_pUuid1, g_nUuid1, g_opts1);
+  Publisher publisher2(g_topic2, g_addr1, g_pUuid1, g_nUuid1, g_opts1);
+  Publisher publisher3(g_topic2, g_addr1, g_pUuid1, g_nUuid2, g_opts2);
+  Publisher publisher4(g_topic1, g_addr2, g_pUuid2, g_nUuid3, g_opts3);
+
+  TopicStorage<Publisher> test;
+
+  EXPECT_TRUE(test.AddPublisher(publisher1));
+  EXPECT_TRUE(test.AddPublisher(publisher2));
+  EXPECT_TRUE(test.AddPublisher(publisher3));
+  EXPECT_TRUE(test.AddPublisher(publisher4));
+
+  std::vector<Publisher> pubs;
+  test.PublishersByNode(g_pUuid1, g_nUuid1, pubs);
+  EXPECT_EQ(pubs.size(), 2u);
+
+  // Remove one of the topics of the node.
+  EXPECT_TRUE(test.DelPublisherByNode(g_topic1, g_pUuid1, g_nUuid1));
+  test.PublishersByNode(g_pUuid1, g_nUuid1, pubs);
+  ASSERT_EQ(pubs.size(), 1u);
+  EXPECT_EQ(pubs.at(0).Topic(), g_topic2);
+  EXPECT_TRUE(test.HasPublisher(g_addr1));
+
+  // Removing the process keeps the publishers of other processes.
+  EXPECT_TRUE(test.DelPublishersByProc(g_pUuid1));
+  EXPECT_FALSE(test.DelPublishersByProc(g_pUuid1));
+  EXPECT_FALSE(test.HasPublisher(g_addr1));
+  EXPECT_FALSE(test.HasTopic(g_topic2));
+  EXPECT_TRUE(test.HasAnyPublishers(g_topic1, g_pUuid2));
+  EXPECT_TRUE(test.HasPublisher(g_addr2));
+
+  std::map<std::string, std::vector<Publisher>> procPubs;
+  test.PublishersByProc(g_pUuid1, procPubs);
+  EXPECT_TRUE(procPubs.empty());
+  test.PublishersByProc(g_pUuid2, procPubs);
+  EXPECT_EQ(procPubs.size(), 1u);
+
+  // Adding the publishers again rebuilds the indexes.
+  EXPECT_TRUE(test.AddPublisher(publisher1));
+  test.PublishersByNode(g_pUuid1, g_nUuid1, pubs);
+  EXPECT_EQ(pubs.size(), 1u);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that all the publishers of a node are removed at once.
+TEST(TopicStorageTest, DelPublishersByNode)
+{
+  init();
+
+  Publisher publisher1(g_topic1, g_addr1, g_pUuid1, g_nUuid1, g_opts1);
+  Publisher publisher2(g_topic2, g_addr1, g_pUuid1, g_nUuid1, g_opts1);
+  Publisher publisher3(g_topic2, g_addr1, g_pUuid1, g_nUuid2, g_opts2);
+
+  TopicStorage<Publisher> test;
+
+  EXPECT_TRUE(test.AddPublisher(publisher1));
+  EXPECT_TRUE(test.AddPublisher(publisher2));
+  EXPECT_TRUE(test.AddPublisher(publisher3));
+
+  std::vector<Publisher> pubs;
+  EXPECT_FALSE(test.DelPublishersByNode(g_pUuid1, "unknown_nuuid", pubs));
+  EXPECT_TRUE(pubs.empty());
+
+  EXPECT_TRUE(test.DelPublishersByNode(g_pUuid1, g_nUuid1, pubs));
+  EXPECT_EQ(pubs.size(), 2u);
+  EXPECT_FALSE(test.DelPublishersByNode(g_pUuid1, g_nUuid1, pubs));
+
+  // The other nodes keep their publishers.
+  EXPECT_FALSE(test.HasTopic(g_topic1));
+  EXPECT_TRUE(test.HasTopic(g_topic2));
+  EXPECT_TRUE(test.HasPublisher(g_addr1));
+  test.PublishersByNode(g_pUuid1, g_nUuid2, pubs);
+  EXPECT_EQ(pubs.size(), 1u);
+}
+
 //////////////////////////////////////////////////
 /// \brief Check HasTopic(<topic>, <type>).
 TEST(TopicStorageTest, HasTopicWithType)
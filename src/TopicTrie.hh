@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TOPICTRIE_HH_
+#define IGN_TRANSPORT_TOPICTRIE_HH_
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Segment of a pattern that matches any single segment of a
+    /// topic.
+    static const std::string kWildcardSegment = "*";
+
+    /// \brief Last segment of a pattern that matches one or more segments of
+    /// a topic.
+    static const std::string kWildcardTailSegment = "**";
+
+    /// \brief Split a fully qualified topic or pattern in segments. The
+    /// first segment is the partition.
+    /// \param[in] _name Fully qualified name.
+    /// \return The segments.
+    inline std::vector<std::string> TopicSegments(const std::string &_name)
+    {
+      std::vector<std::string> segments;
+      std::size_t pos = 0;
+
+      // The partition may contain slashes.
+      const std::size_t partitionEnd = _name.find_last_of('@');
+      if (partitionEnd != std::string::npos)
+      {
+        segments.push_back(_name.substr(0, partitionEnd + 1));
+        pos = partitionEnd + 1;
+      }
+
+      while (pos < _name.size())
+      {
+        std::size_t next = _name.find('/', pos);
+        if (next == std::string::npos)
+          next = _name.size();
+        if (next > pos)
+          segments.push_back(_name.substr(pos, next - pos));
+        pos = next + 1;
+      }
+
+      return segments;
+    }
+
+    /// \brief Check whether a name is a topic pattern, i.e. it has a wildcard
+    /// segment.
+    /// \param[in] _name Fully qualified name or topic name.
+    /// \return True if the name has a wildcard segment.
+    inline bool IsTopicPattern(const std::string &_name)
+    {
+      for (const auto &segment : TopicSegments(_name))
+      {
+        if (segment == kWildcardSegment || segment == kWildcardTailSegment)
+          return true;
+      }
+      return false;
+    }
+
+    /// \class TopicTrie TopicTrie.hh
+    /// \brief Index of topic patterns, matched against fully qualified topic
+    /// names. The patterns are fully qualified topic names where a segment
+    /// may be "*", which matches one segment, and the last segment may be
+    /// "**", which matches the rest of the topic. E.g.
+    /// "@p@/robot1/sensors/*" matches "@p@/robot1/sensors/lidar" and
+    /// "@p@/robot1/**" matches "@p@/robot1/sensors/lidar". The partition is
+    /// matched as a single segment. Matching a topic only visits the
+    /// branches that can match it, so the cost doesn't grow with the number
+    /// of patterns.
+    template<typename T>
+    class TopicTrie
+    {
+      /// \brief Add a value for a pattern.
+      /// \param[in] _pattern Fully qualified pattern.
+      /// \param[in] _value The value.
+      public: void Insert(const std::string &_pattern, const T &_value)
+      {
+        TrieNode *node = &this->root;
+        for (const auto &segment : TopicSegments(_pattern))
+        {
+          auto &child = node->children[segment];
+          if (!child)
+            child.reset(new TrieNode());
+          node = child.get();
+        }
+        node->values.push_back(_value);
+        ++this->size;
+      }
+
+      /// \brief Remove the values of a pattern.
+      /// \param[in] _pattern Fully qualified pattern.
+      /// \param[in] _pred Whether a value is removed.
+      /// \return Number of values removed.
+      public: std::size_t Remove(const std::string &_pattern,
+                                 const std::function<bool(const T &)> &_pred)
+      {
+        const std::size_t removed =
+          Remove(this->root, TopicSegments(_pattern), 0, _pred);
+        this->size -= removed;
+        return removed;
+      }
+
+      /// \brief Get the values of the patterns matching a topic.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[out] _values The values found are appended.
+      public: void Match(const std::string &_topic,
+                         std::vector<T> &_values) const
+      {
+        if (this->size == 0)
+          return;
+        Match(this->root, TopicSegments(_topic), 0, _values);
+      }
+
+      /// \brief Whether the trie is empty.
+      /// \return True if there are no values.
+      public: bool Empty() const
+      {
+        return this->size == 0;
+      }
+
+      /// \brief A node of the trie.
+      private: struct TrieNode
+      {
+        /// \brief Children by segment, including the wildcards.
+        std::map<std::string, std::unique_ptr<TrieNode>> children;
+
+        /// \brief Values of the pattern ending at this node.
+        std::vector<T> values;
+      };
+
+      /// \brief Match the segments of a topic from a node.
+      /// \param[in] _node The node.
+      /// \param[in] _segments Segments of the topic.
+      /// \param[in] _index Index of the next segment to match.
+      /// \param[out] _values The values found are appended.
+      private: static void Match(const TrieNode &_node,
+                                 const std::vector<std::string> &_segments,
+                                 const std::size_t _index,
+                                 std::vector<T> &_values)
+      {
+        if (_index == _segments.size())
+        {
+          _values.insert(_values.end(), _node.values.begin(),
+            _node.values.end());
+          return;
+        }
+
+        auto it = _node.children.find(_segments[_index]);
+        if (it != _node.children.end())
+          Match(*it->second, _segments, _index + 1, _values);
+
+        // The partition is never matched by a wildcard.
+        if (_index == 0)
+          return;
+
+        it = _node.children.find(kWildcardSegment);
+        if (it != _node.children.end())
+          Match(*it->second, _segments, _index + 1, _values);
+
+        it = _node.children.find(kWildcardTailSegment);
+        if (it != _node.children.end())
+        {
+          _values.insert(_values.end(), it->second->values.begin(),
+            it->second->values.end());
+        }
+      }
+
+      /// \brief Remove the values of a pattern from a node.
+      /// \param[in] _node The node.
+      /// \param[in] _segments Segments of the pattern.
+      /// \param[in] _index Index of the next segment.
+      /// \param[in] _pred Whether a value is removed.
+      /// \return Number of values removed.
+      private: static std::size_t Remove(TrieNode &_node,
+        const std::vector<std::string> &_segments, const std::size_t _index,
+        const std::function<bool(const T &)> &_pred)
+      {
+        if (_index == _segments.size())
+        {
+          const std::size_t prior = _node.values.size();
+          _node.values.erase(std::remove_if(_node.values.begin(),
+            _node.values.end(), _pred), _node.values.end());
+          return prior - _node.values.size();
+        }
+
+        auto it = _node.children.find(_segments[_index]);
+        if (it == _node.children.end())
+          return 0;
+
+        const std::size_t removed =
+          Remove(*it->second, _segments, _index + 1, _pred);
+
+        // Prune the empty branches.
+        if (it->second->values.empty() && it->second->children.empty())
+          _node.children.erase(it);
+
+        return removed;
+      }
+
+      /// \brief Root of the trie.
+      private: TrieNode root;
+
+      /// \brief Number of values stored.
+      private: std::size_t size = 0;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "TopicTrie.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the segments of the names.
+TEST(TopicTrieTest, Segments)
+{
+  auto segments = TopicSegments("@/my/partition@/a/b/c");
+  ASSERT_EQ(4u, segments.size());
+  EXPECT_EQ("@/my/partition@", segments[0]);
+  EXPECT_EQ("a", segments[1]);
+  EXPECT_EQ("c", segments[3]);
+
+  EXPECT_TRUE(IsTopicPattern("@p@/a/*/c"));
+  EXPECT_TRUE(IsTopicPattern("/a/**"));
+  EXPECT_FALSE(IsTopicPattern("@p@/a/b*/c"));
+  EXPECT_FALSE(IsTopicPattern("@p@/a/b/c"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the matching of the wildcards.
+TEST(TopicTrieTest, Match)
+{
+  TopicTrie<int> trie;
+  EXPECT_TRUE(trie.Empty());
+
+  trie.Insert("@p@/robot1/sensors/*", 1);
+  trie.Insert("@p@/robot1/**", 2);
+  trie.Insert("@p@/*/sensors/lidar", 3);
+  trie.Insert("@p@/robot1/sensors/lidar", 4);
+  trie.Insert("@q@/robot1/**", 5);
+  EXPECT_FALSE(trie.Empty());
+
+  std::vector<int> values;
+  trie.Match("@p@/robot1/sensors/lidar", values);
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), values);
+
+  // A wildcard matches exactly one segment.
+  values.clear();
+  trie.Match("@p@/robot1/sensors/lidar/points", values);
+  EXPECT_EQ(std::vector<int>{2}, values);
+
+  // The tail wildcard needs at least one segment.
+  values.clear();
+  trie.Match("@p@/robot1", values);
+  EXPECT_TRUE(values.empty());
+
+  // The partitions are matched exactly.
+  values.clear();
+  trie.Match("@q@/robot1/odom", values);
+  EXPECT_EQ(std::vector<int>{5}, values);
+  values.clear();
+  trie.Match("@r@/robot1/odom", values);
+  EXPECT_TRUE(values.empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the removal of the values.
+TEST(TopicTrieTest, Remove)
+{
+  TopicTrie<int> trie;
+  trie.Insert("@p@/robot1/sensors/*", 1);
+  trie.Insert("@p@/robot1/sensors/*", 2);
+
+  EXPECT_EQ(0u, trie.Remove("@p@/robot1/*", [](int){return true;}));
+  EXPECT_EQ(1u, trie.Remove("@p@/robot1/sensors/*",
+    [](int _v){return _v == 1;}));
+
+  std::vector<int> values;
+  trie.Match("@p@/robot1/sensors/lidar", values);
+  EXPECT_EQ(std::vector<int>{2}, values);
+
+  EXPECT_EQ(1u, trie.Remove("@p@/robot1/sensors/*", [](int){return true;}));
+  EXPECT_TRUE(trie.Empty());
+  values.clear();
+  trie.Match("@p@/robot1/sensors/lidar", values);
+  EXPECT_TRUE(values.empty());
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/NetUtils.hh"
+#include "Tracing.hh"
+
+using namespace ignition;
+using namespace transport;
+
+namespace
+{
+  /// \brief Default maximum number of events kept in memory.
+  const std::size_t kDefaultMaxTraceEvents = 1000000;
+
+  /// \brief Write a string as a JSON string.
+  /// \param[out] _out Output stream.
+  /// \param[in] _str The string.
+  void WriteJsonString(std::ostream &_out, const std::string &_str)
+  {
+    _out << '"';
+    for (const char c : _str)
+    {
+      if (c == '"' || c == '\\')
+      {
+        _out << '\\' << c;
+      }
+      else if (static_cast<unsigned char>(c) < 0x20)
+      {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        _out << escaped;
+      }
+      else
+      {
+        _out << c;
+      }
+    }
+    _out << '"';
+  }
+
+  /// \brief Write the fields shared by all the events.
+  /// \param[out] _out Output stream.
+  /// \param[in] _name Name of the event.
+  /// \param[in] _phase Phase of the event.
+  /// \param[in] _ts Time stamp of the event.
+  /// \param[in] _pid Process ID.
+  /// \param[in] _tid Thread ID.
+  void WriteEventHeader(std::ostream &_out, const char *_name,
+    const char *_phase, double _ts, unsigned int _pid, uint64_t _tid)
+  {
+    _out << "{\"name\":";
+    WriteJsonString(_out, _name);
+    _out << ",\"cat\":\"ign_transport\",\"ph\":\"" << _phase
+         << "\",\"ts\":" << _ts << ",\"pid\":" << _pid
+         << ",\"tid\":" << _tid;
+  }
+}
+
+//////////////////////////////////////////////////
+Tracer::Tracer(std::size_t _maxEvents)
+  : maxEvents(_maxEvents),
+    pid(getProcessId())
+{
+  // The correlation IDs of different processes differ in their high bits.
+  const uint64_t salt = std::hash<std::string>()(determineHost() + ":" +
+    std::to_string(this->pid) + ":" + std::to_string(
+      std::chrono::steady_clock::now().time_since_epoch().count()));
+  this->idPrefix = salt << 32;
+}
+
+//////////////////////////////////////////////////
+Tracer &Tracer::Instance()
+{
+  // Never destroyed, the threads of the library can record events while
+  // the process exits.
+  static Tracer *tracer = []()
+  {
+    std::size_t maxEvents = kDefaultMaxTraceEvents;
+    std::string maxEventsStr;
+    if (env("IGN_TRANSPORT_TRACE_MAX_EVENTS", maxEventsStr))
+    {
+      try
+      {
+        maxEvents = std::stoul(maxEventsStr);
+      }
+      catch (...)
+      {
+        std::cerr << "Unable to parse IGN_TRANSPORT_TRACE_MAX_EVENTS value ["
+                  << maxEventsStr << "]. Using [" << maxEvents
+                  << "] instead." << std::endl;
+      }
+    }
+
+    Tracer *t = new Tracer(maxEvents);
+
+    static std::string path;
+    if (env("IGN_TRANSPORT_TRACE_FILE", path) && !path.empty())
+    {
+      t->SetEnabled(true);
+      std::atexit([]()
+      {
+        if (!Tracer::Instance().WriteChromeTrace(path))
+        {
+          std::cerr << "Unable to write the trace file [" << path << "]"
+                    << std::endl;
+        }
+      });
+    }
+    return t;
+  }();
+  return *tracer;
+}
+
+//////////////////////////////////////////////////
+void Tracer::SetEnabled(bool _enabled)
+{
+  this->enabled.store(_enabled, std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+uint64_t Tracer::NewId()
+{
+  uint32_t id = ++this->lastId;
+  if (id == 0)
+    id = ++this->lastId;
+  return this->idPrefix | id;
+}
+
+//////////////////////////////////////////////////
+uint64_t &Tracer::CurrentId()
+{
+  static thread_local uint64_t id = 0;
+  return id;
+}
+
+//////////////////////////////////////////////////
+double Tracer::Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+//////////////////////////////////////////////////
+void Tracer::Complete(const char *_name, const std::string &_topic,
+    uint64_t _id, double _start, double _end, TraceFlow _flow)
+{
+  const uint64_t tid = std::hash<std::thread::id>()(
+    std::this_thread::get_id());
+
+  std::lock_guard<std::mutex> lk(this->mutex);
+  if (this->events.size() >= this->maxEvents)
+  {
+    ++this->dropped;
+    return;
+  }
+  this->events.push_back({_name, _topic, _id, _start,
+    std::max(0.0, _end - _start), tid, _flow});
+}
+
+//////////////////////////////////////////////////
+void Tracer::Instant(const char *_name, const std::string &_topic,
+    uint64_t _id)
+{
+  const uint64_t tid = std::hash<std::thread::id>()(
+    std::this_thread::get_id());
+  const double now = Now();
+
+  std::lock_guard<std::mutex> lk(this->mutex);
+  if (this->events.size() >= this->maxEvents)
+  {
+    ++this->dropped;
+    return;
+  }
+  this->events.push_back({_name, _topic, _id, now, -1.0, tid,
+    TraceFlow::NONE});
+}
+
+//////////////////////////////////////////////////
+std::size_t Tracer::EventCount() const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return this->events.size();
+}
+
+//////////////////////////////////////////////////
+uint64_t Tracer::DroppedEventCount() const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+  return this->dropped;
+}
+
+//////////////////////////////////////////////////
+void Tracer::WriteChromeTrace(std::ostream &_out) const
+{
+  std::lock_guard<std::mutex> lk(this->mutex);
+
+  _out << std::fixed << std::setprecision(3);
+  _out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto &event : this->events)
+  {
+    if (!first)
+      _out << ",\n";
+    first = false;
+
+    const bool instant = event.duration < 0;
+    WriteEventHeader(_out, event.name, instant ? "i" : "X", event.start,
+      this->pid, event.tid);
+    if (instant)
+      _out << ",\"s\":\"t\"";
+    else
+      _out << ",\"dur\":" << event.duration;
+    _out << ",\"args\":{\"topic\":";
+    WriteJsonString(_out, event.topic);
+    _out << ",\"id\":\"0x" << std::hex << event.id << std::dec << "\"}}";
+
+    // Flow events link the events of a message, also across processes
+    // once their traces are merged.
+    if (event.flow == TraceFlow::NONE || event.id == 0)
+      continue;
+
+    const char *phase = event.flow == TraceFlow::START ? "s" :
+      event.flow == TraceFlow::STEP ? "t" : "f";
+    _out << ",\n";
+    WriteEventHeader(_out, "message", phase, event.start, this->pid,
+      event.tid);
+    _out << ",\"id\":\"0x" << std::hex << event.id << std::dec << "\"";
+    if (event.flow == TraceFlow::END)
+      _out << ",\"bp\":\"e\"";
+    _out << "}";
+  }
+  _out << "]}\n";
+}
+
+//////////////////////////////////////////////////
+bool Tracer::WriteChromeTrace(const std::string &_path) const
+{
+  std::ofstream out(_path);
+  if (!out)
+    return false;
+
+  this->WriteChromeTrace(out);
+  return static_cast<bool>(out);
+}
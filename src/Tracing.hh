@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TRACING_HH_
+#define IGN_TRANSPORT_TRACING_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief How a trace event relates to the other events of the same
+    /// message.
+    enum class TraceFlow
+    {
+      /// \brief Not linked to the other events.
+      NONE,
+
+      /// \brief First event of the message.
+      START,
+
+      /// \brief Intermediate event of the message.
+      STEP,
+
+      /// \brief Last event of the message.
+      END
+    };
+
+    /// \brief Records the trace events of the publish, receive and callback
+    /// paths in memory and writes them in the Chrome trace event format,
+    /// which Perfetto and chrome://tracing open. The events of a message
+    /// carry the same correlation ID in every process, so the traces of
+    /// several processes can be merged to follow a message between them.
+    ///
+    /// The tracepoints are only compiled in with the IGN_TRANSPORT_TRACING
+    /// CMake option, and only record events if the IGN_TRANSPORT_TRACE_FILE
+    /// environment variable is set. The trace is written to that file when
+    /// the process exits.
+    class IGNITION_TRANSPORT_VISIBLE Tracer
+    {
+      /// \brief A trace event.
+      public: struct Event
+              {
+                /// \brief Name of the event, a string literal.
+                public: const char *name;
+
+                /// \brief Topic or service name.
+                public: std::string topic;
+
+                /// \brief Correlation ID of the message, 0 if unknown.
+                public: uint64_t id;
+
+                /// \brief Start time, in microseconds of the system clock.
+                public: double start;
+
+                /// \brief Duration, in microseconds. Negative for an
+                /// instant event.
+                public: double duration;
+
+                /// \brief Hash of the thread ID.
+                public: uint64_t tid;
+
+                /// \brief Relation to the other events of the message.
+                public: TraceFlow flow;
+              };
+
+      /// \brief Constructor.
+      /// \param[in] _maxEvents Maximum number of events kept in memory.
+      /// The events past it are discarded.
+      public: explicit Tracer(std::size_t _maxEvents);
+
+      /// \brief Get the tracer of the process, configured with the
+      /// IGN_TRANSPORT_TRACE_FILE and IGN_TRANSPORT_TRACE_MAX_EVENTS
+      /// environment variables.
+      /// \return The tracer.
+      public: static Tracer &Instance();
+
+      /// \brief Start or stop recording events.
+      /// \param[in] _enabled True to record events.
+      public: void SetEnabled(bool _enabled);
+
+      /// \brief Whether events are recorded.
+      /// \return True if events are recorded.
+      public: bool Enabled() const
+      {
+        return this->enabled.load(std::memory_order_relaxed);
+      }
+
+      /// \brief Get a new correlation ID, unique among processes.
+      /// \return The ID, never 0.
+      public: uint64_t NewId();
+
+      /// \brief Correlation ID of the message handled by this thread.
+      /// \return Reference to the ID of this thread, 0 if none.
+      public: static uint64_t &CurrentId();
+
+      /// \brief Current time, in microseconds of the system clock, which
+      /// is comparable among the processes of a host.
+      /// \return The time.
+      public: static double Now();
+
+      /// \brief Record an event that has a duration.
+      /// \param[in] _name Name of the event, a string literal.
+      /// \param[in] _topic Topic or service name.
+      /// \param[in] _id Correlation ID of the message, 0 if unknown.
+      /// \param[in] _start Start time, from Now().
+      /// \param[in] _end End time, from Now().
+      /// \param[in] _flow Relation to the other events of the message.
+      public: void Complete(const char *_name, const std::string &_topic,
+                            uint64_t _id, double _start, double _end,
+                            TraceFlow _flow = TraceFlow::NONE);
+
+      /// \brief Record an event without duration.
+      /// \param[in] _name Name of the event, a string literal.
+      /// \param[in] _topic Topic or service name.
+      /// \param[in] _id Correlation ID of the message, 0 if unknown.
+      public: void Instant(const char *_name, const std::string &_topic,
+                           uint64_t _id);
+
+      /// \brief Get the number of events recorded.
+      /// \return Number of events.
+      public: std::size_t EventCount() const;
+
+      /// \brief Get the number of events discarded because the buffer was
+      /// full.
+      /// \return Number of events discarded.
+      public: uint64_t DroppedEventCount() const;
+
+      /// \brief Write the events in the Chrome trace event format.
+      /// \param[out] _out Output stream.
+      public: void WriteChromeTrace(std::ostream &_out) const;
+
+      /// \brief Write the events to a file in the Chrome trace event
+      /// format.
+      /// \param[in] _path Path of the file.
+      /// \return False if the file can't be written.
+      public: bool WriteChromeTrace(const std::string &_path) const;
+
+      /// \brief Whether events are recorded.
+      private: std::atomic<bool> enabled{false};
+
+      /// \brief Maximum number of events kept in memory.
+      private: std::size_t maxEvents;
+
+      /// \brief Process ID written in the events.
+      private: unsigned int pid;
+
+      /// \brief High bits of the correlation IDs of this process.
+      private: uint64_t idPrefix;
+
+      /// \brief Last correlation ID assigned, low bits only.
+      private: std::atomic<uint32_t> lastId{0};
+
+      /// \brief Protects events and dropped.
+      private: mutable std::mutex mutex;
+
+      /// \brief Events recorded.
+      private: std::vector<Event> events;
+
+      /// \brief Number of events discarded.
+      private: uint64_t dropped = 0;
+    };
+
+    /// \brief Records an event lasting as long as this object.
+    class IGNITION_TRANSPORT_VISIBLE TraceScope
+    {
+      /// \brief Constructor.
+      /// \param[in] _name Name of the event, a string literal.
+      /// \param[in] _topic Topic or service name.
+      /// \param[in] _id Correlation ID of the message, 0 if unknown.
+      /// \param[in] _flow Relation to the other events of the message.
+      public: TraceScope(const char *_name, const std::string &_topic,
+                         uint64_t _id, TraceFlow _flow = TraceFlow::NONE)
+        : name(_name), id(_id), flow(_flow)
+      {
+        if (Tracer::Instance().Enabled())
+        {
+          this->topic = _topic;
+          this->start = Tracer::Now();
+        }
+      }
+
+      /// \brief Destructor. Records the event.
+      public: ~TraceScope()
+      {
+        if (this->start >= 0)
+        {
+          Tracer::Instance().Complete(this->name, this->topic, this->id,
+            this->start, Tracer::Now(), this->flow);
+        }
+      }
+
+      /// \brief Name of the event.
+      private: const char *name;
+
+      /// \brief Topic or service name, only set if the tracer is enabled.
+      private: std::string topic;
+
+      /// \brief Correlation ID of the message.
+      private: uint64_t id;
+
+      /// \brief Relation to the other events of the message.
+      private: TraceFlow flow;
+
+      /// \brief Start time, negative if the tracer is disabled.
+      private: double start = -1.0;
+    };
+
+    /// \brief Sets the correlation ID of the message handled by this thread
+    /// as long as this object lives.
+    class IGNITION_TRANSPORT_VISIBLE TraceContext
+    {
+      /// \brief Constructor.
+      /// \param[in] _id Correlation ID of the message.
+      public: explicit TraceContext(uint64_t _id)
+        : previous(Tracer::CurrentId())
+      {
+        Tracer::CurrentId() = _id;
+      }
+
+      /// \brief Destructor. Restores the previous ID.
+      public: ~TraceContext()
+      {
+        Tracer::CurrentId() = this->previous;
+      }
+
+      /// \brief Correlation ID before this object.
+      private: uint64_t previous;
+    };
+    }
+  }
+}
+
+#define IGN_TRANSPORT_TRACE_CONCAT_(_a, _b) _a##_b
+#define IGN_TRANSPORT_TRACE_CONCAT(_a, _b) IGN_TRANSPORT_TRACE_CONCAT_(_a, _b)
+
+#ifdef IGN_TRANSPORT_TRACING
+/// \brief Record an event lasting until the end of the enclosing scope,
+/// for the message handled by this thread.
+#define IGN_TRANSPORT_TRACE_SCOPE(_name, _topic, _flow) \
+  ignition::transport::TraceScope IGN_TRANSPORT_TRACE_CONCAT( \
+    ignTransportTraceScope, __LINE__)(_name, _topic, \
+      ignition::transport::Tracer::CurrentId(), \
+      ignition::transport::TraceFlow::_flow)
+
+/// \brief Set the message handled by this thread until the end of the
+/// enclosing scope.
+#define IGN_TRANSPORT_TRACE_CONTEXT(_id) \
+  ignition::transport::TraceContext IGN_TRANSPORT_TRACE_CONCAT( \
+    ignTransportTraceContext, __LINE__)(_id)
+
+/// \brief Set a new message, with a new correlation ID, until the end of
+/// the enclosing scope.
+#define IGN_TRANSPORT_TRACE_NEW_CONTEXT() \
+  IGN_TRANSPORT_TRACE_CONTEXT( \
+    ignition::transport::Tracer::Instance().Enabled() ? \
+      ignition::transport::Tracer::Instance().NewId() : 0u)
+
+/// \brief Record an event without duration, for the message handled by
+/// this thread.
+#define IGN_TRANSPORT_TRACE_INSTANT(_name, _topic) \
+  do \
+  { \
+    ignition::transport::Tracer &ignTransportTracer = \
+      ignition::transport::Tracer::Instance(); \
+    if (ignTransportTracer.Enabled()) \
+    { \
+      ignTransportTracer.Instant(_name, _topic, \
+        ignition::transport::Tracer::CurrentId()); \
+    } \
+  } while (false)
+#else
+#define IGN_TRANSPORT_TRACE_SCOPE(_name, _topic, _flow)
+#define IGN_TRANSPORT_TRACE_CONTEXT(_id)
+#define IGN_TRANSPORT_TRACE_NEW_CONTEXT()
+#define IGN_TRANSPORT_TRACE_INSTANT(_name, _topic) do {} while (false)
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <sstream>
+#include <string>
+
+#include "Tracing.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the correlation IDs.
+TEST(TracingTest, Ids)
+{
+  Tracer tracer(10);
+  const uint64_t id1 = tracer.NewId();
+  const uint64_t id2 = tracer.NewId();
+  EXPECT_NE(0u, id1);
+  EXPECT_NE(id1, id2);
+
+  EXPECT_EQ(0u, Tracer::CurrentId());
+  {
+    TraceContext context(id1);
+    EXPECT_EQ(id1, Tracer::CurrentId());
+    {
+      TraceContext nested(id2);
+      EXPECT_EQ(id2, Tracer::CurrentId());
+    }
+    EXPECT_EQ(id1, Tracer::CurrentId());
+  }
+  EXPECT_EQ(0u, Tracer::CurrentId());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the events recorded and the Chrome trace output.
+TEST(TracingTest, ChromeTrace)
+{
+  Tracer tracer(3);
+  const double start = Tracer::Now();
+  tracer.Complete("serialize", "/foo", 0x2a, start, start + 5,
+    TraceFlow::START);
+  tracer.Complete("callback", "/foo", 0x2a, start + 10, start + 12,
+    TraceFlow::END);
+  tracer.Instant("enqueue", "/b\"ar", 0);
+  EXPECT_EQ(3u, tracer.EventCount());
+  EXPECT_EQ(0u, tracer.DroppedEventCount());
+
+  // The buffer is full.
+  tracer.Instant("enqueue", "/foo", 0);
+  EXPECT_EQ(3u, tracer.EventCount());
+  EXPECT_EQ(1u, tracer.DroppedEventCount());
+
+  std::ostringstream out;
+  tracer.WriteChromeTrace(out);
+  const std::string trace = out.str();
+
+  EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, trace.find(
+    "{\"name\":\"serialize\",\"cat\":\"ign_transport\",\"ph\":\"X\""));
+  EXPECT_NE(std::string::npos, trace.find("\"dur\":5.000"));
+  EXPECT_NE(std::string::npos,
+    trace.find("\"args\":{\"topic\":\"/foo\",\"id\":\"0x2a\"}"));
+  EXPECT_NE(std::string::npos, trace.find("\"ph\":\"s\""));
+  EXPECT_NE(std::string::npos, trace.find("\"ph\":\"f\""));
+  EXPECT_NE(std::string::npos, trace.find("\"bp\":\"e\""));
+  EXPECT_NE(std::string::npos, trace.find("\"ph\":\"i\",\"ts\""));
+  EXPECT_NE(std::string::npos, trace.find("\"topic\":\"/b\\\"ar\""));
+  EXPECT_EQ(trace.size() - 3, trace.rfind("]}\n"));
+}
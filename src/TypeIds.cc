@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ignition/transport/TransportTypes.hh"
+#include "TypeIds.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    //////////////////////////////////////////////////
+    MsgTypeId InternMsgType(const std::string &_msgType)
+    {
+      static std::mutex mutex;
+      static std::unordered_map<std::string, MsgTypeId> ids =
+        {{kGenericMessageType, kGenericMsgTypeId}};
+
+      std::lock_guard<std::mutex> lk(mutex);
+      auto it = ids.find(_msgType);
+      if (it != ids.end())
+        return it->second;
+
+      const MsgTypeId id = static_cast<MsgTypeId>(ids.size()) + 1u;
+      ids.emplace(_msgType, id);
+      return id;
+    }
+    }
+  }
+}
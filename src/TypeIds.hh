@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TYPEIDS_HH_
+#define IGN_TRANSPORT_TYPEIDS_HH_
+
+#include <cstdint>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Interned message type name. Equal names have equal IDs, so
+    /// the publication paths compare types without comparing strings.
+    using MsgTypeId = uint32_t;
+
+    /// \brief ID of a type that hasn't been interned yet.
+    static const MsgTypeId kNoMsgTypeId = 0;
+
+    /// \brief ID of kGenericMessageType.
+    static const MsgTypeId kGenericMsgTypeId = 1;
+
+    /// \brief Get the ID of a message type name, assigning a new one the
+    /// first time the name is seen. IDs are never released. Thread safe.
+    /// \param[in] _msgType Message type name.
+    /// \return The ID of the type.
+    IGNITION_TRANSPORT_VISIBLE
+    MsgTypeId InternMsgType(const std::string &_msgType);
+    }
+  }
+}
+#endif
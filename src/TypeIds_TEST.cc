@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/TransportTypes.hh"
+#include "TypeIds.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Check that equal type names share their ID.
+TEST(TypeIdsTest, Intern)
+{
+  EXPECT_EQ(transport::kGenericMsgTypeId,
+    transport::InternMsgType(transport::kGenericMessageType));
+
+  const transport::MsgTypeId id =
+    transport::InternMsgType("ignition.msgs.Int32");
+  EXPECT_NE(transport::kNoMsgTypeId, id);
+  EXPECT_NE(transport::kGenericMsgTypeId, id);
+  EXPECT_EQ(id, transport::InternMsgType(std::string("ignition.msgs.Int32")));
+  EXPECT_NE(id, transport::InternMsgType("ignition.msgs.StringMsg"));
+  EXPECT_NE(transport::kNoMsgTypeId, transport::InternMsgType(""));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the threads interning a type get the same ID.
+TEST(TypeIdsTest, Threads)
+{
+  std::vector<transport::MsgTypeId> ids(8, transport::kNoMsgTypeId);
+  std::vector<std::thread> threads;
+  for (auto &id : ids)
+  {
+    threads.emplace_back([&id]
+      {
+        id = transport::InternMsgType("ignition.msgs.Vector3d");
+      });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (const auto id : ids)
+    EXPECT_EQ(ids.front(), id);
+}
@@ -15,6 +15,10 @@
  *
 */
 
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -88,3 +92,162 @@ std::string Uuid::ToString() const
 }
 
 #endif
+
+namespace
+{
+  /// \brief Value of each lowercase hexadecimal digit, or -1 for the other
+  /// characters. A table avoids a mispredicted branch per digit.
+  struct HexTable
+  {
+    constexpr HexTable()
+      : values()
+    {
+      for (int c = 0; c < 256; ++c)
+        this->values[c] = -1;
+      for (int c = '0'; c <= '9'; ++c)
+        this->values[c] = static_cast<int8_t>(c - '0');
+      for (int c = 'a'; c <= 'f'; ++c)
+        this->values[c] = static_cast<int8_t>(c - 'a' + 10);
+    }
+
+    int8_t values[256];
+  };
+
+  /// \brief Table of hexadecimal digits.
+  constexpr HexTable kHexTable;
+
+  /// \brief Value of a lowercase hexadecimal digit.
+  /// \param[in] _c The character.
+  /// \return The value or -1 if _c is not a lowercase hexadecimal digit.
+  int HexValue(const char _c)
+  {
+    return kHexTable.values[static_cast<unsigned char>(_c)];
+  }
+
+  /// \brief Parse a UUID in canonical format.
+  /// \param[in] _str The string.
+  /// \param[out] _bytes The 16 bytes of the UUID.
+  /// \return True if _str is a UUID in canonical (lowercase) format.
+  bool ParseUuid(const std::string &_str, uint8_t _bytes[16])
+  {
+    // Offset of each byte in the 8-4-4-4-12 format.
+    static const std::size_t kOffsets[16] =
+      {0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34};
+
+    if (_str.size() != 36u || _str[8] != '-' || _str[13] != '-' ||
+        _str[18] != '-' || _str[23] != '-')
+    {
+      return false;
+    }
+
+    int invalid = 0;
+    for (std::size_t i = 0; i < 16u; ++i)
+    {
+      const int high = HexValue(_str[kOffsets[i]]);
+      const int low = HexValue(_str[kOffsets[i] + 1]);
+      invalid |= high | low;
+      _bytes[i] = static_cast<uint8_t>(((high & 0xf) << 4) | (low & 0xf));
+    }
+    return invalid >= 0;
+  }
+}
+
+//////////////////////////////////////////////////
+CompactUuid::CompactUuid()
+  : words{{0u, 0u}}
+{
+}
+
+//////////////////////////////////////////////////
+CompactUuid::CompactUuid(const Uuid &_uuid)
+  : CompactUuid(_uuid.ToString())
+{
+}
+
+//////////////////////////////////////////////////
+CompactUuid::CompactUuid(const std::string &_str)
+  : words{{0u, 0u}}
+{
+  uint8_t bytes[16];
+  if (ParseUuid(_str, bytes))
+    std::memcpy(this->words.data(), bytes, sizeof(bytes));
+  else
+    this->text = std::make_shared<const std::string>(_str);
+}
+
+//////////////////////////////////////////////////
+CompactUuid CompactUuid::Sequential()
+{
+  static const CompactUuid kBase{Uuid()};
+  static std::atomic<uint64_t> counter{0u};
+
+  // The system UUID isn't in canonical format, generate a full one.
+  if (!kBase.Packed())
+    return CompactUuid(Uuid());
+
+  CompactUuid uuid;
+  uuid.words[0] = kBase.words[0];
+  uuid.words[1] = kBase.words[1] + (++counter);
+  return uuid;
+}
+
+//////////////////////////////////////////////////
+std::string CompactUuid::ToString() const
+{
+  if (this->text)
+    return *this->text;
+
+  uint8_t d[16];
+  std::memcpy(d, this->words.data(), sizeof(d));
+
+  char uuidStr[37];
+  snprintf(uuidStr, sizeof(uuidStr),
+    "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+    d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7],
+    d[8], d[9], d[10], d[11], d[12], d[13], d[14], d[15]);
+  return std::string(uuidStr, 36);
+}
+
+//////////////////////////////////////////////////
+bool CompactUuid::Packed() const
+{
+  return !this->text;
+}
+
+//////////////////////////////////////////////////
+std::size_t CompactUuid::Hash() const
+{
+  if (this->text)
+    return std::hash<std::string>()(*this->text);
+
+  // The bytes of a UUID are random, mixing the two words is enough.
+  return static_cast<std::size_t>(
+    this->words[0] ^ (this->words[1] * 0x9e3779b97f4a7c15ull));
+}
+
+//////////////////////////////////////////////////
+bool CompactUuid::operator==(const CompactUuid &_other) const
+{
+  if (this->text || _other.text)
+    return this->text && _other.text && *this->text == *_other.text;
+  return this->words == _other.words;
+}
+
+//////////////////////////////////////////////////
+bool CompactUuid::operator!=(const CompactUuid &_other) const
+{
+  return !(*this == _other);
+}
+
+//////////////////////////////////////////////////
+bool CompactUuid::operator<(const CompactUuid &_other) const
+{
+  // Packed UUIDs sort before the other identifiers.
+  if (this->text || _other.text)
+  {
+    if (!this->text || !_other.text)
+      return !this->text;
+    return *this->text < *_other.text;
+  }
+  return this->words < _other.words;
+}
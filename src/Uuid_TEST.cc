@@ -17,6 +17,7 @@
 
 #include <cctype>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include "ignition/transport/Uuid.hh"
@@ -52,6 +53,63 @@ TEST(UuidTest, testToString)
     EXPECT_GT(isxdigit(output.str()[i]), 0);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the CompactUuid helper class.
+TEST(UuidTest, CompactUuid)
+{
+  transport::Uuid uuid1;
+  transport::Uuid uuid2;
+
+  // A UUID is packed and converted back to the same string.
+  transport::CompactUuid compact1(uuid1);
+  EXPECT_TRUE(compact1.Packed());
+  EXPECT_EQ(uuid1.ToString(), compact1.ToString());
+  EXPECT_EQ(compact1, transport::CompactUuid(uuid1.ToString()));
+  EXPECT_EQ(compact1.Hash(),
+    transport::CompactUuid(uuid1.ToString()).Hash());
+
+  transport::CompactUuid compact2(uuid2);
+  EXPECT_NE(compact1, compact2);
+  EXPECT_NE(compact1 < compact2, compact2 < compact1);
+
+  // The nil UUID.
+  transport::CompactUuid nil;
+  EXPECT_TRUE(nil.Packed());
+  EXPECT_EQ("00000000-0000-0000-0000-000000000000", nil.ToString());
+
+  // Other identifiers are kept as is.
+  const std::string upper = "6BA7B810-9DAD-11D1-80B4-00C04FD430C8";
+  for (const std::string &str : {std::string("node1"), upper,
+    std::string("6ba7b810-9dad-11d1-80b4-00c04fd430cg"), std::string()})
+  {
+    transport::CompactUuid compact(str);
+    EXPECT_FALSE(compact.Packed());
+    EXPECT_EQ(str, compact.ToString());
+    EXPECT_EQ(compact, transport::CompactUuid(str));
+    EXPECT_NE(compact, compact1);
+    EXPECT_NE(compact < compact1, compact1 < compact);
+  }
+
+  std::ostringstream output;
+  output << compact1;
+  EXPECT_EQ(uuid1.ToString(), output.str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the UUIDs created without the system generator.
+TEST(UuidTest, Sequential)
+{
+  auto uuid1 = transport::CompactUuid::Sequential();
+  auto uuid2 = transport::CompactUuid::Sequential();
+  EXPECT_TRUE(uuid1.Packed());
+  EXPECT_NE(uuid1, uuid2);
+  EXPECT_NE(uuid1.Hash(), uuid2.Hash());
+
+  // The string format is a canonical UUID.
+  EXPECT_EQ(36u, uuid1.ToString().size());
+  EXPECT_EQ(uuid1, transport::CompactUuid(uuid1.ToString()));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
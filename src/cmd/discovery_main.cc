@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <ignition/utils/cli/CLI.hpp>
+
+#include <ignition/transport/config.hh>
+#include "ignition/transport/Discovery.hh"
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/NodeShared.hh"
+#include "ignition/transport/Uuid.hh"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Structure to hold all available discovery server options
+struct DiscoveryServerOptions
+{
+  /// \brief Port used for msg discovery
+  int msgPort{NodeShared::kDefaultMsgDiscPort};
+
+  /// \brief Port used for srv discovery
+  int srvPort{NodeShared::kDefaultSrvDiscPort};
+
+  /// \brief Print the discovery state on each update
+  bool verbose{false};
+};
+
+//////////////////////////////////////////////////
+/// \brief Read a discovery port from an environment variable.
+/// \param[in] _name Name of the environment variable.
+/// \param[in, out] _port The port, unchanged if the variable isn't set.
+void portFromEnv(const std::string &_name, int &_port)
+{
+  std::string value;
+  if (!env(_name, value) || value.empty())
+    return;
+
+  try
+  {
+    _port = std::stoi(value);
+  }
+  catch (...)
+  {
+    std::cerr << "Unable to convert " << _name << " value [" << value
+              << "] to a port." << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Callback fired when options are successfully parsed
+void runDiscoveryServer(const DiscoveryServerOptions &_opt)
+{
+  if (_opt.msgPort == _opt.srvPort)
+  {
+    std::cerr << "The msg and srv discovery ports must be different."
+              << std::endl;
+    return;
+  }
+
+  const std::string pUuid = Uuid().ToString();
+  const std::string ip = "239.255.0.7";
+
+  MsgDiscovery msgDiscovery(pUuid, ip, _opt.msgPort, _opt.verbose, true);
+  SrvDiscovery srvDiscovery(pUuid, ip, _opt.srvPort, _opt.verbose, true);
+  msgDiscovery.Start();
+  srvDiscovery.Start();
+
+  std::cout << "Discovery server listening on ports [" << _opt.msgPort
+            << "] (messages) and [" << _opt.srvPort << "] (services)"
+            << std::endl;
+
+  waitForShutdown();
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+  CLI::App app{"Ignition transport discovery server"};
+
+  app.add_flag_callback("--version", [](){
+      std::cout << IGNITION_TRANSPORT_VERSION_FULL << std::endl;
+      throw CLI::Success();
+  });
+
+  auto opt = std::make_shared<DiscoveryServerOptions>();
+  portFromEnv("IGN_DISCOVERY_MSG_PORT", opt->msgPort);
+  portFromEnv("IGN_DISCOVERY_SRV_PORT", opt->srvPort);
+
+  app.add_option("--msg-port", opt->msgPort,
+                 "UDP port used for msg discovery.");
+  app.add_option("--srv-port", opt->srvPort,
+                 "UDP port used for srv discovery.");
+  app.add_flag("-v,--verbose", opt->verbose,
+               "Print the discovery state on each update.");
+
+  app.callback([opt](){runDiscoveryServer(*opt); });
+  CLI11_PARSE(app, argc, argv);
+}
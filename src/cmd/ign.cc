@@ -15,10 +15,21 @@
  *
 */
 
+#include <google/protobuf/util/json_util.h>
+
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -33,6 +44,7 @@
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/Node.hh"
+#include "ignition/transport/TopicStatistics.hh"
 
 #ifdef _MSC_VER
 # pragma warning(disable: 4503)
@@ -41,6 +53,160 @@
 using namespace ignition;
 using namespace transport;
 
+namespace
+{
+  /// \brief Set by a signal to stop publishing, see cmdTopicPubRepeated().
+  std::atomic<bool> g_stopPublishing(false);
+
+  /// \brief Stop publishing on SIGINT and SIGTERM.
+  /// \param[in] _signal The signal.
+  void stopPublishing(int /*_signal*/)
+  {
+    g_stopPublishing = true;
+  }
+
+  /// \brief Append a varint, see the protobuf encoding.
+  /// \param[in] _value The value.
+  /// \param[in] _bytes Number of bytes of the varint, at least the ones the
+  /// value needs. The parsers accept the leading zero groups.
+  /// \param[in,out] _data The data.
+  void AppendVarint(uint64_t _value, std::size_t _bytes, std::string &_data)
+  {
+    for (std::size_t i = 1; i < _bytes; ++i)
+    {
+      _data += static_cast<char>((_value & 0x7F) | 0x80);
+      _value >>= 7;
+    }
+    _data += static_cast<char>(_value);
+  }
+
+  /// \brief Pad a serialized message to a size with an unknown bytes field,
+  /// which the subscribers skip when they parse it.
+  /// \param[in] _size The size of the message.
+  /// \param[in,out] _data The serialized message.
+  /// \return False if the message is already too large for the field.
+  bool PadMessage(std::size_t _size, std::string &_data)
+  {
+    // Key of the largest field number, with the length-delimited wire type,
+    // followed by the length of the padding
+    const uint64_t key = (uint64_t(536870911) << 3) | 2;
+    const std::size_t keyBytes = 5;
+    for (std::size_t lengthBytes = 1; lengthBytes <= 9; ++lengthBytes)
+    {
+      const std::size_t overhead = _data.size() + keyBytes + lengthBytes;
+      if (_size < overhead)
+        return false;
+      const uint64_t padding = _size - overhead;
+      if (padding >> (7 * lengthBytes) == 0)
+      {
+        AppendVarint(key, keyBytes, _data);
+        AppendVarint(padding, lengthBytes, _data);
+        _data.append(padding, '\0');
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// \brief Bytes of output buffered while the terminal or the pipe is
+  /// busy. Further messages are dropped, rather than slowing down the
+  /// subscription.
+  const std::size_t kMaxEchoBuffer = 64 * 1024 * 1024;
+
+  /// \brief Writes the messages echoed to std::cout from a thread of its
+  /// own, so that the callbacks only format the messages while the output
+  /// is written and flushed in batches.
+  class EchoOutput
+  {
+    /// \brief Constructor. Starts the writer thread.
+    public: EchoOutput()
+    {
+      this->writer = std::thread([this]()
+      {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true)
+        {
+          this->condition.wait(lock, [this]()
+          {
+            return this->done || !this->buffer.empty();
+          });
+          if (this->buffer.empty())
+            break;
+          batch.clear();
+          batch.swap(this->buffer);
+          lock.unlock();
+          std::cout.write(batch.data(), batch.size());
+          std::cout.flush();
+          lock.lock();
+        }
+      });
+    }
+
+    /// \brief Destructor. Writes the remaining messages.
+    public: ~EchoOutput()
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->done = true;
+      }
+      this->condition.notify_all();
+      this->writer.join();
+      if (this->dropped > 0)
+      {
+        std::cerr << "Dropped " << this->dropped
+                  << " messages while the output was busy\n";
+      }
+    }
+
+    /// \brief Queue a formatted message.
+    /// \param[in] _text The message, as it's written.
+    public: void Write(const std::string &_text)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->buffer.size() + _text.size() > kMaxEchoBuffer)
+        {
+          ++this->dropped;
+          return;
+        }
+        this->buffer += _text;
+        ++this->count;
+      }
+      this->condition.notify_all();
+    }
+
+    /// \brief Wait until a number of messages have been queued.
+    /// \param[in] _count The number of messages.
+    public: void WaitForCount(int _count)
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [&]{return this->count >= _count;});
+    }
+
+    /// \brief Protects the members below.
+    private: std::mutex mutex;
+
+    /// \brief Signals the writer and WaitForCount().
+    private: std::condition_variable condition;
+
+    /// \brief Messages to write.
+    private: std::string buffer;
+
+    /// \brief Number of messages queued.
+    private: int count = 0;
+
+    /// \brief Number of messages dropped because the buffer was full.
+    private: uint64_t dropped = 0;
+
+    /// \brief True when the writer must stop, once the buffer is written.
+    private: bool done = false;
+
+    /// \brief Writes the buffer.
+    private: std::thread writer;
+  };
+}
+
 //////////////////////////////////////////////////
 extern "C" void cmdTopicList()
 {
@@ -186,6 +352,117 @@ extern "C" void cmdTopicPub(const char *_topic,
   }
 }
 
+//////////////////////////////////////////////////
+extern "C" void cmdTopicPubRepeated(const char *_topic,
+  const char *_msgType, const char *_msgData, const double _rate,
+  const int _count, const int _size)
+{
+  if (!_topic)
+  {
+    std::cerr << "Topic name is null\n";
+    return;
+  }
+
+  if (!_msgType)
+  {
+    std::cerr << "Message type is null\n";
+    return;
+  }
+
+  if (!_msgData)
+  {
+    std::cerr << "Message data is null\n";
+    return;
+  }
+
+  if (_rate <= 0 && _count <= 0)
+  {
+    std::cerr << "Either the rate or the count must be positive\n";
+    return;
+  }
+
+  auto msg = ignition::msgs::Factory::New(_msgType, _msgData);
+  if (!msg)
+  {
+    std::cerr << "Unable to create message of type[" << _msgType << "] "
+      << "with data[" << _msgData << "].\n";
+    return;
+  }
+
+  // The message is serialized once and published as raw data
+  std::string data;
+  if (!msg->SerializeToString(&data))
+  {
+    std::cerr << "Unable to serialize the message\n";
+    return;
+  }
+  if (_size > 0 &&
+      !PadMessage(static_cast<std::size_t>(_size), data))
+  {
+    std::cerr << "The message takes more than [" << _size << "] bytes, it's "
+      << "published with [" << data.size() << "] bytes\n";
+  }
+
+  ignition::transport::Node node;
+  auto pub = node.Advertise(_topic, msg->GetTypeName());
+  if (!pub)
+  {
+    std::cerr << "Unable to publish on topic[" << _topic << "] "
+      << "with message type[" << _msgType << "].\n";
+    return;
+  }
+
+  // \todo(anyone) Change this sleep to a WaitForSubscribers() call.
+  // See issue #47.
+  std::this_thread::sleep_for(std::chrono::milliseconds(800));
+
+  g_stopPublishing = false;
+  std::signal(SIGINT, stopPublishing);
+  std::signal(SIGTERM, stopPublishing);
+
+  // The publications follow a fixed schedule from the start, rather than
+  // sleeping for a period after each one, so that the rate doesn't drift
+  using Clock = std::chrono::steady_clock;
+  const Clock::duration period = _rate > 0 ?
+    std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / _rate)) : Clock::duration::zero();
+  const std::string type = msg->GetTypeName();
+  const Clock::time_point start = Clock::now();
+  uint64_t published = 0;
+  uint64_t failed = 0;
+  for (int64_t i = 0; (_count <= 0 || i < _count) && !g_stopPublishing; ++i)
+  {
+    if (_rate > 0)
+      std::this_thread::sleep_until(start + i * period);
+
+    char *buffer = pub.Loan(data.size());
+    if (!buffer)
+    {
+      ++failed;
+      continue;
+    }
+    std::memcpy(buffer, data.data(), data.size());
+    if (pub.PublishLoaned(buffer, data.size(), type))
+      ++published;
+    else
+      ++failed;
+  }
+  const double elapsed =
+    std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::signal(SIGINT, SIG_DFL);
+  std::signal(SIGTERM, SIG_DFL);
+
+  std::cout << std::fixed << std::setprecision(3)
+            << "Published " << published << " messages of " << data.size()
+            << " bytes in " << elapsed << " s: "
+            << (elapsed > 0 ? published / elapsed : 0.0) << " Hz, "
+            << (elapsed > 0 ? published * data.size() / elapsed / 1e6 : 0.0)
+            << " MB/s\n";
+  if (failed > 0)
+    std::cout << "Failed to publish " << failed << " messages\n";
+}
+
 //////////////////////////////////////////////////
 extern "C" void cmdServiceReq(const char *_service,
   const char *_reqType, const char *_repType, const int _timeout,
@@ -249,9 +526,40 @@ extern "C" void cmdServiceReq(const char *_service,
     std::cerr << "Service call timed out" << std::endl;
 }
 
+//////////////////////////////////////////////////
+extern "C" void cmdServicePing(const char *_pUuid, const int _timeout)
+{
+  if (!_pUuid)
+  {
+    std::cerr << "Process UUID is null\n";
+    return;
+  }
+
+  ignition::transport::Node node;
+  std::chrono::nanoseconds rtt;
+  std::chrono::nanoseconds offset;
+  if (!node.Ping(_pUuid, _timeout, rtt, offset))
+  {
+    std::cerr << "Ping timed out\n";
+    return;
+  }
+
+  std::cout << "RTT: " << std::chrono::duration<double, std::milli>(rtt).count()
+            << " ms, clock offset: "
+            << std::chrono::duration<double, std::milli>(offset).count()
+            << " ms" << std::endl;
+}
+
 //////////////////////////////////////////////////
 extern "C" void cmdTopicEcho(const char *_topic,
   const double _duration, int _count)
+{
+  cmdTopicEchoFormat(_topic, _duration, _count, "text");
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdTopicEchoFormat(const char *_topic,
+  const double _duration, int _count, const char *_format)
 {
   if (!_topic || std::string(_topic).empty())
   {
@@ -259,21 +567,60 @@ extern "C" void cmdTopicEcho(const char *_topic,
     return;
   }
 
-  std::mutex mutex;
-  std::condition_variable condition;
-  int count = 0;
-
-  std::function<void(const ProtoMsg&)> cb = [&](const ProtoMsg &_msg)
+  const std::string format = _format ? _format : "text";
+  if (format != "text" && format != "compact" && format != "json" &&
+      format != "raw")
   {
-    std::lock_guard<std::mutex> lock(mutex);
-    std::cout << _msg.DebugString() << std::endl;
-    ++count;
-    condition.notify_one();
-  };
+    std::cerr << "Invalid format [" << format << "]. Use text, compact, "
+              << "json or raw.\n";
+    return;
+  }
 
+  // Declared before the node, so that the subscription is gone when the
+  // output is destroyed
+  EchoOutput output;
   Node node;
-  if (!node.Subscribe(_topic, cb))
-    return;
+
+  if (format == "raw")
+  {
+    // The data are written as they're received, without decoding them,
+    // each preceded by its size as 4 bytes, little endian
+    RawCallback cb = [&](const char *_data, const size_t _size,
+        const MessageInfo &)
+    {
+      std::string text(4 + _size, '\0');
+      for (std::size_t i = 0; i < 4; ++i)
+        text[i] = static_cast<char>((_size >> (8 * i)) & 0xFF);
+      text.replace(4, _size, _data, _size);
+      output.Write(text);
+    };
+    if (!node.SubscribeRaw(_topic, cb))
+      return;
+  }
+  else
+  {
+    std::function<void(const ProtoMsg&)> cb = [&](const ProtoMsg &_msg)
+    {
+      std::string text;
+      if (format == "compact")
+      {
+        text = _msg.ShortDebugString();
+      }
+      else if (format == "json")
+      {
+        if (!google::protobuf::util::MessageToJsonString(_msg, &text).ok())
+          return;
+      }
+      else
+      {
+        text = _msg.DebugString();
+      }
+      text += '\n';
+      output.Write(text);
+    };
+    if (!node.Subscribe(_topic, cb))
+      return;
+  }
 
   if (_duration >= 0)
   {
@@ -290,12 +637,154 @@ extern "C" void cmdTopicEcho(const char *_topic,
   }
   else
   {
-    while (count < _count)
+    output.WaitForCount(_count);
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Measure the messages of a topic, without decoding them, and print
+/// a report per window.
+/// \param[in] _topic Topic name.
+/// \param[in] _duration Duration (seconds) to run. A value < 0 indicates no
+/// time limit.
+/// \param[in] _window Duration (seconds) of each window.
+/// \param[in] _bandwidth True to report the bandwidth and the sizes of the
+/// messages, false for the rate and the intervals between them.
+static void measureTopic(const char *_topic, const double _duration,
+  const double _window, const bool _bandwidth)
+{
+  if (!_topic || std::string(_topic).empty())
+  {
+    std::cerr << "Invalid topic. Topic must not be empty.\n";
+    return;
+  }
+
+  if (_window <= 0)
+  {
+    std::cerr << "Invalid window. The window must be positive.\n";
+    return;
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  // Intervals in milliseconds and sizes in kilobytes, like the topic
+  // statistics, so that the percentiles are known to the microsecond and to
+  // the byte.
+  std::mutex mutex;
+  Statistics intervals;
+  Statistics sizes;
+  Clock::time_point lastMessage;
+  bool received = false;
+
+  RawCallback cb = [&](const char *, const size_t _size,
+      const MessageInfo &)
+  {
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (received)
+    {
+      intervals.Update(std::chrono::duration<double, std::milli>(
+        now - lastMessage).count());
+    }
+    sizes.Update(static_cast<double>(_size) / 1000.0);
+    lastMessage = now;
+    received = true;
+  };
+
+  Node node;
+  if (!node.SubscribeRaw(_topic, cb))
+    return;
+
+  // Report from a thread of its own, while this one waits for the end
+  std::mutex reportMutex;
+  std::condition_variable reportCondition;
+  bool done = false;
+  std::thread reporter([&]()
+  {
+    Clock::time_point windowStart = Clock::now();
+    std::unique_lock<std::mutex> reportLock(reportMutex);
+    while (!reportCondition.wait_for(reportLock,
+        std::chrono::duration<double>(_window), [&]{return done;}))
     {
-      std::unique_lock<std::mutex> lock(mutex);
-      condition.wait(lock, [&]{return count >= _count;});
+      Statistics windowIntervals;
+      Statistics windowSizes;
+      const Clock::time_point windowEnd = Clock::now();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(windowIntervals, intervals);
+        std::swap(windowSizes, sizes);
+      }
+      const double elapsed =
+        std::chrono::duration<double>(windowEnd - windowStart).count();
+      windowStart = windowEnd;
+
+      std::ostringstream report;
+      report << std::fixed << std::setprecision(3);
+      if (windowSizes.Count() == 0)
+      {
+        report << "No messages in the last " << elapsed << " s\n";
+      }
+      else if (_bandwidth)
+      {
+        const double bytes = windowSizes.Avg() * 1000.0 *
+          static_cast<double>(windowSizes.Count());
+        report << "Bandwidth: " << bytes / elapsed / 1e6 << " MB/s"
+               << " (" << windowSizes.Count() << " messages in " << elapsed
+               << " s)\n"
+               << "  size [B] mean: " << windowSizes.Avg() * 1000.0
+               << " min: " << windowSizes.Min() * 1000.0
+               << " p50: " << windowSizes.Percentile(50) * 1000.0
+               << " p99: " << windowSizes.Percentile(99) * 1000.0
+               << " max: " << windowSizes.Max() * 1000.0 << "\n";
+      }
+      else
+      {
+        report << "Rate: " << windowSizes.Count() / elapsed << " Hz"
+               << " (" << windowSizes.Count() << " messages in " << elapsed
+               << " s)\n";
+        if (windowIntervals.Count() > 0)
+        {
+          report << "  interval [ms] mean: " << windowIntervals.Avg()
+                 << " min: " << windowIntervals.Min()
+                 << " p99: " << windowIntervals.Percentile(99)
+                 << " max: " << windowIntervals.Max()
+                 << " jitter (std dev): " << windowIntervals.StdDev() << "\n";
+        }
+      }
+      std::cout << report.str() << std::flush;
     }
+  });
+
+  if (_duration >= 0)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(
+      static_cast<int64_t>(_duration * 1000)));
   }
+  else
+  {
+    ignition::transport::waitForShutdown();
+  }
+
+  {
+    std::lock_guard<std::mutex> reportLock(reportMutex);
+    done = true;
+  }
+  reportCondition.notify_all();
+  reporter.join();
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdTopicHz(const char *_topic, const double _duration,
+  const double _window)
+{
+  measureTopic(_topic, _duration, _window, false);
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdTopicBw(const char *_topic, const double _duration,
+  const double _window)
+{
+  measureTopic(_topic, _duration, _window, true);
 }
 
 //////////////////////////////////////////////////
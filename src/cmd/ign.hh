@@ -47,6 +47,25 @@ extern "C" void cmdTopicPub(const char *_topic,
                                                        const char *_msgType,
                                                        const char *_msgData);
 
+/// \brief External hook to execute 'ign topic -p' from the command line,
+/// publishing the message repeatedly, e.g. for load tests. The message is
+/// serialized once and the throughput achieved is printed at the end.
+/// \param[in] _topic Topic name.
+/// \param[in] _msgType Message type.
+/// \param[in] _msgData See cmdTopicPub().
+/// \param[in] _rate Publications per second. A value <= 0 publishes as
+/// fast as possible.
+/// \param[in] _count Number of messages to publish. A value <= 0 publishes
+/// until SIGINT or SIGTERM; the rate must then be positive.
+/// \param[in] _size Size (bytes) to pad the serialized message to, with a
+/// field unknown to the subscribers. A value <= 0 leaves it as it is.
+extern "C" void cmdTopicPubRepeated(const char *_topic,
+                                    const char *_msgType,
+                                    const char *_msgData,
+                                    const double _rate,
+                                    const int _count,
+                                    const int _size);
+
 /// \brief External hook to execute 'ign service -r' from the command line.
 /// \param[in] _service Service name.
 /// \param[in] _reqType Message type used in the request.
@@ -63,6 +82,11 @@ extern "C" void cmdServiceReq(const char *_service,
                                                          const int _timeout,
                                                          const char *_reqData);
 
+/// \brief External hook to execute 'ign service -p' from the command line.
+/// \param[in] _pUuid UUID of the process to ping.
+/// \param[in] _timeout The ping will timeout after '_timeout' ms.
+extern "C" void cmdServicePing(const char *_pUuid, const int _timeout);
+
 /// \brief External hook to execute 'ign topic -e' from the command line.
 /// The _duration parameter overrides the _count parameter.
 /// \param[in] _topic Topic name.
@@ -75,6 +99,43 @@ extern "C" void cmdTopicEcho(const char *_topic,
                                                         const double _duration,
                                                         int _count);
 
+/// \brief External hook to execute 'ign topic -e' from the command line,
+/// with a given output format. The messages are written by a thread of
+/// their own, in batches.
+/// \param[in] _topic Topic name.
+/// \param[in] _duration See cmdTopicEcho().
+/// \param[in] _count See cmdTopicEcho().
+/// \param[in] _format "text" for the DebugString() of each message,
+/// "compact" for one line per message, "json" for one JSON object per line
+/// or "raw" for the serialized messages, each preceded by its size as 4
+/// bytes, little endian, without decoding them.
+extern "C" void cmdTopicEchoFormat(const char *_topic,
+                                   const double _duration,
+                                   int _count,
+                                   const char *_format);
+
+/// \brief External hook to execute 'ign topic --hz' from the command line.
+/// The messages are counted without decoding them, and the rate and the
+/// intervals between them are printed for each window.
+/// \param[in] _topic Topic name.
+/// \param[in] _duration Duration (seconds) to run. A value < 0 indicates
+/// no time limit.
+/// \param[in] _window Duration (seconds) of each report.
+extern "C" void cmdTopicHz(const char *_topic,
+                           const double _duration,
+                           const double _window);
+
+/// \brief External hook to execute 'ign topic --bw' from the command line.
+/// The messages are measured without decoding them, and the bandwidth and
+/// the distribution of the sizes are printed for each window.
+/// \param[in] _topic Topic name.
+/// \param[in] _duration Duration (seconds) to run. A value < 0 indicates
+/// no time limit.
+/// \param[in] _window Duration (seconds) of each report.
+extern "C" void cmdTopicBw(const char *_topic,
+                           const double _duration,
+                           const double _window);
+
 /// \brief External hook to read the library version.
 /// \return C-string representing the version. Ex.: 0.1.2
 extern "C" const char *ignitionVersion();
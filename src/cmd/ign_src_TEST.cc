@@ -15,9 +15,14 @@
  *
 */
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <vector>
 #include <ignition/msgs.hh>
 
 #include "gtest/gtest.h"
@@ -145,6 +150,48 @@ TEST(ignTest, cmdTopicPub)
   restoreIO();
 }
 
+//////////////////////////////////////////////////
+/// \brief Check cmdTopicPubRepeated running the subscriber on a the same
+/// process.
+TEST(ignTest, cmdTopicPubRepeated)
+{
+  std::stringstream stdOutBuffer;
+  std::stringstream stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  // Publishing forever as fast as possible should generate an error message.
+  cmdTopicPubRepeated(g_topic.c_str(), g_intType.c_str(), g_reqData.c_str(),
+    0, 0, 0);
+  EXPECT_EQ(stdErrBuffer.str(),
+    "Either the rate or the count must be positive\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  // The messages are padded to the size requested.
+  std::mutex mutex;
+  std::vector<std::size_t> sizes;
+  transport::Node node;
+  ASSERT_TRUE(node.SubscribeRaw(g_topic,
+    [&](const char *, const size_t _size, const transport::MessageInfo &)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      sizes.push_back(_size);
+    }));
+
+  cmdTopicPubRepeated(g_topic.c_str(), g_intType.c_str(), g_reqData.c_str(),
+    100, 10, 1000);
+  EXPECT_EQ(0u, stdOutBuffer.str().find("Published 10 messages of 1000 bytes"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(10u, sizes.size());
+    for (std::size_t size : sizes)
+      EXPECT_EQ(1000u, size);
+  }
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  restoreIO();
+}
+
 //////////////////////////////////////////////////
 /// \brief Check cmdServiceReq running the advertiser on a the same process.
 TEST(ignTest, cmdServiceReq)
@@ -218,6 +265,34 @@ TEST(ignTest, cmdServiceReq)
   restoreIO();
 }
 
+//////////////////////////////////////////////////
+/// \brief Check cmdServicePing pinging this process.
+TEST(ignTest, cmdServicePing)
+{
+  std::stringstream  stdOutBuffer;
+  std::stringstream  stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  // A null process UUID should generate an error message.
+  cmdServicePing(nullptr, 10);
+  EXPECT_EQ(stdErrBuffer.str(), "Process UUID is null\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  // Nobody answers the pings of an unknown process.
+  cmdServicePing("_unknown_process_", 10);
+  EXPECT_EQ(stdErrBuffer.str(), "Ping timed out\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  // This process answers once it uses services.
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_service, srvEcho));
+  cmdServicePing(transport::NodeShared::Instance()->pUuid.c_str(), 1000);
+  EXPECT_EQ(0u, stdOutBuffer.str().find("RTT: "));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  restoreIO();
+}
+
 //////////////////////////////////////////////////
 /// \brief Check cmdTopicEcho running the advertiser on a the same process.
 TEST(ignTest, cmdTopicEcho)
@@ -241,6 +316,111 @@ TEST(ignTest, cmdTopicEcho)
   restoreIO();
 }
 
+//////////////////////////////////////////////////
+/// \brief Check cmdTopicEchoFormat running the advertiser on a the same
+/// process.
+TEST(ignTest, cmdTopicEchoFormat)
+{
+  std::stringstream  stdOutBuffer;
+  std::stringstream  stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  // An unknown format should trigger an error message.
+  cmdTopicEchoFormat(g_topic.c_str(), 1.00, 0, "yaml");
+  EXPECT_EQ(stdErrBuffer.str(),
+    "Invalid format [yaml]. Use text, compact, json or raw.\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  ASSERT_TRUE(pub);
+  ignition::msgs::Int32 msg;
+  msg.set_data(10);
+
+  // Publish until the echo has received enough messages.
+  std::atomic<bool> running{true};
+  std::thread publisher([&]()
+  {
+    while (running)
+    {
+      pub.Publish(msg);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  cmdTopicEchoFormat(g_topic.c_str(), -1, 2, "compact");
+  EXPECT_EQ(0u, stdOutBuffer.str().find("data: 10\ndata: 10\n"));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  cmdTopicEchoFormat(g_topic.c_str(), -1, 1, "json");
+  EXPECT_EQ(0u, stdOutBuffer.str().find("{\"data\":10}\n"));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  // The raw messages are preceded by their size.
+  cmdTopicEchoFormat(g_topic.c_str(), -1, 1, "raw");
+  const std::string serialized = msg.SerializeAsString();
+  const std::string raw = stdOutBuffer.str();
+  ASSERT_GE(raw.size(), 4u + serialized.size());
+  EXPECT_EQ(static_cast<char>(serialized.size()), raw[0]);
+  EXPECT_EQ('\0', raw[1]);
+  EXPECT_EQ(serialized, raw.substr(4, serialized.size()));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  running = false;
+  publisher.join();
+  restoreIO();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check cmdTopicHz and cmdTopicBw running the advertiser on a the
+/// same process.
+TEST(ignTest, cmdTopicHzBw)
+{
+  std::stringstream  stdOutBuffer;
+  std::stringstream  stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  cmdTopicHz(nullptr, 1.00, 1.00);
+  EXPECT_EQ(stdErrBuffer.str(), "Invalid topic. Topic must not be empty.\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  cmdTopicBw(g_topic.c_str(), 1.00, 0.00);
+  EXPECT_EQ(stdErrBuffer.str(),
+    "Invalid window. The window must be positive.\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  ASSERT_TRUE(pub);
+  ignition::msgs::Int32 msg;
+  msg.set_data(10);
+
+  std::atomic<bool> running{true};
+  std::thread publisher([&]()
+  {
+    while (running)
+    {
+      pub.Publish(msg);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  cmdTopicHz(g_topic.c_str(), 1.25, 0.5);
+  EXPECT_NE(std::string::npos, stdOutBuffer.str().find("Rate: "));
+  EXPECT_NE(std::string::npos, stdOutBuffer.str().find("interval [ms]"));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  // Each message is 2 bytes long
+  cmdTopicBw(g_topic.c_str(), 1.25, 0.5);
+  EXPECT_NE(std::string::npos, stdOutBuffer.str().find("Bandwidth: "));
+  EXPECT_NE(std::string::npos, stdOutBuffer.str().find("max: 2.000"));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  running = false;
+  publisher.join();
+  restoreIO();
+}
+
 /////////////////////////////////////////////////
 /// Main
 int main(int argc, char **argv)
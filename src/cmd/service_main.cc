@@ -29,6 +29,7 @@ enum class ServiceCommand
   kServiceList,
   kServiceInfo,
   kServiceReq,
+  kServicePing,
 };
 
 //////////////////////////////////////////////////
@@ -52,6 +53,9 @@ struct ServiceOptions
 
   /// \brief Timeout to use when requesting (in milliseconds)
   int timeout{-1};
+
+  /// \brief UUID of the process to ping
+  std::string pUuid{""};
 };
 
 //////////////////////////////////////////////////
@@ -71,6 +75,10 @@ void runServiceCommand(const ServiceOptions &_opt)
           _opt.reqType.c_str(), _opt.repType.c_str(),
           _opt.timeout, _opt.reqData.c_str());
       break;
+    case ServiceCommand::kServicePing:
+      cmdServicePing(_opt.pUuid.c_str(),
+          _opt.timeout > 0 ? _opt.timeout : 1000);
+      break;
     case ServiceCommand::kNone:
     default:
       // In the event that there is no command, display help
@@ -115,6 +123,12 @@ void addServiceFlags(CLI::App &_app)
     ->needs(repTypeOpt)
     ->needs(timeoutOpt);
 
+  command->add_option_function<std::string>("-p,--ping",
+      [opt](const std::string &_pUuid){
+        opt->command = ServiceCommand::kServicePing;
+        opt->pUuid = _pUuid;
+      }, "Measure the round trip time and the clock offset to a process");
+
   _app.callback([opt](){runServiceCommand(*opt); });
 }
 
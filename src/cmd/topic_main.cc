@@ -15,6 +15,8 @@
  *
  */
 
+#include <algorithm>
+
 #include <ignition/utils/cli/CLI.hpp>
 
 #include "ign.hh"
@@ -29,7 +31,9 @@ enum class TopicCommand
   kTopicList,
   kTopicInfo,
   kTopicPub,
-  kTopicEcho
+  kTopicEcho,
+  kTopicHz,
+  kTopicBw
 };
 
 //////////////////////////////////////////////////
@@ -53,6 +57,23 @@ struct TopicOptions
 
   /// \brief Number of messages to echo
   int count{-1};
+
+  /// \brief Output format of the messages echoed
+  std::string format{"text"};
+
+  /// \brief Publications per second when publishing repeatedly
+  double rate{0};
+
+  /// \brief Number of messages to publish, 0 for a single one unless a
+  /// rate is set
+  int pubCount{0};
+
+  /// \brief Size (bytes) to pad the messages published to
+  int size{0};
+
+  /// \brief Duration of each report of the rate or the bandwidth (in
+  /// seconds)
+  double window{1};
 };
 
 //////////////////////////////////////////////////
@@ -68,12 +89,32 @@ void runTopicCommand(const TopicOptions &_opt)
       cmdTopicInfo(_opt.topic.c_str());
       break;
     case TopicCommand::kTopicPub:
-      cmdTopicPub(_opt.topic.c_str(),
-                  _opt.msgType.c_str(),
-                  _opt.msgData.c_str());
+      if (_opt.rate > 0 || _opt.pubCount > 0 || _opt.size > 0)
+      {
+        cmdTopicPubRepeated(_opt.topic.c_str(),
+                            _opt.msgType.c_str(),
+                            _opt.msgData.c_str(),
+                            _opt.rate,
+                            _opt.rate > 0 ? _opt.pubCount :
+                              std::max(_opt.pubCount, 1),
+                            _opt.size);
+      }
+      else
+      {
+        cmdTopicPub(_opt.topic.c_str(),
+                    _opt.msgType.c_str(),
+                    _opt.msgData.c_str());
+      }
       break;
     case TopicCommand::kTopicEcho:
-      cmdTopicEcho(_opt.topic.c_str(), _opt.duration, _opt.count);
+      cmdTopicEchoFormat(_opt.topic.c_str(), _opt.duration, _opt.count,
+                         _opt.format.c_str());
+      break;
+    case TopicCommand::kTopicHz:
+      cmdTopicHz(_opt.topic.c_str(), _opt.duration, _opt.window);
+      break;
+    case TopicCommand::kTopicBw:
+      cmdTopicBw(_opt.topic.c_str(), _opt.duration, _opt.window);
       break;
     case TopicCommand::kNone:
     default:
@@ -98,6 +139,17 @@ void addTopicFlags(CLI::App &_app)
                                   opt->count,
                                   "Numer of messages to echo and then exit");
 
+  _app.add_option("--format", opt->format,
+                  "Format of the messages echoed: text, compact, json or raw");
+  _app.add_option("--rate", opt->rate,
+                  "Publications per second of -p, until --count or Ctrl-C");
+  _app.add_option("--count", opt->pubCount,
+                  "Number of messages published by -p");
+  _app.add_option("--size", opt->size,
+                  "Size (bytes) to pad the messages published by -p to");
+  _app.add_option("-w,--window", opt->window,
+                  "Duration (seconds) of each report of --hz and --bw");
+
   durationOpt->excludes(countOpt);
   countOpt->excludes(durationOpt);
 
@@ -119,6 +171,18 @@ void addTopicFlags(CLI::App &_app)
       opt->command = TopicCommand::kTopicEcho;
     });
 
+  command->add_flag_callback("--hz",
+    [opt](){
+      opt->command = TopicCommand::kTopicHz;
+    })
+    ->needs(topicOpt);
+
+  command->add_flag_callback("--bw",
+    [opt](){
+      opt->command = TopicCommand::kTopicBw;
+    })
+    ->needs(topicOpt);
+
   command->add_option_function<std::string>("-p,--pub",
       [opt](const std::string &_msgData){
         opt->command = TopicCommand::kTopicPub;
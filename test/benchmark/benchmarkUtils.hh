@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TEST_BENCHMARK_BENCHMARKUTILS_HH_
+#define IGN_TRANSPORT_TEST_BENCHMARK_BENCHMARKUTILS_HH_
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/test_config.h"
+
+namespace bench
+{
+  /// \brief Topic the remote peers subscribe to.
+  static const char kRemoteTopic[] = "/bench/remote";
+
+  /// \brief Service advertised by the remote peers.
+  static const char kRemoteService[] = "/bench/remote_echo";
+
+  /// \brief Partition of the benchmarks, shared with the remote peers so
+  /// that concurrent runs don't see each other.
+  /// \return The partition.
+  inline std::string &Partition()
+  {
+    static std::string partition;
+    return partition;
+  }
+
+  /// \brief Remote peers, processes running remotePeer_aux. They are
+  /// started on demand and stopped when the benchmark exits, because the
+  /// discovery of a new process takes much longer than a benchmark run.
+  class RemotePeers
+  {
+    /// \brief Get the peers of the benchmark.
+    /// \return The peers.
+    public: static RemotePeers &Instance()
+    {
+      static RemotePeers peers;
+      return peers;
+    }
+
+    /// \brief Destructor, stops the peers.
+    public: ~RemotePeers()
+    {
+      for (const auto &peer : this->peers)
+      {
+        testing::killFork(peer);
+        testing::waitAndCleanupFork(peer);
+      }
+    }
+
+    /// \brief Make sure that at least some peers are running.
+    /// \param[in] _count Number of peers.
+    public: void Start(const std::size_t _count)
+    {
+      const std::string peerPath = testing::portablePathUnion(
+        IGN_TRANSPORT_TEST_DIR, "BENCHMARK_remotePeer_aux");
+
+      while (this->peers.size() < _count)
+      {
+        this->peers.push_back(testing::forkAndRun(peerPath.c_str(),
+          Partition().c_str()));
+      }
+    }
+
+    /// \brief Running peers.
+    private: std::vector<testing::forkHandlerType> peers;
+  };
+
+  /// \brief Wait for a condition, e.g. the discovery of the remote peers.
+  /// \param[in] _condition The condition.
+  /// \param[in] _timeout Maximum time to wait.
+  /// \return True if the condition was met before the timeout.
+  inline bool WaitFor(const std::function<bool()> &_condition,
+    const std::chrono::milliseconds &_timeout = std::chrono::seconds(10))
+  {
+    const auto deadline = std::chrono::steady_clock::now() + _timeout;
+    while (!_condition())
+    {
+      if (std::chrono::steady_clock::now() > deadline)
+        return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+  }
+
+  /// \brief Run the benchmarks in a partition of their own.
+  /// \param[in] _argc Number of arguments.
+  /// \param[in] _argv Arguments, see --help.
+  /// \return Exit code.
+  inline int Main(int _argc, char **_argv)
+  {
+    Partition() = testing::getRandomNumber();
+    setenv("IGN_PARTITION", Partition().c_str(), 1);
+
+    benchmark::Initialize(&_argc, _argv);
+    if (benchmark::ReportUnrecognizedArguments(_argc, _argv))
+      return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+  }
+}
+
+/// \brief Define the main function of a benchmark.
+#define IGN_TRANSPORT_BENCHMARK_MAIN() \
+  int main(int _argc, char **_argv) \
+  { \
+    return bench::Main(_argc, _argv); \
+  }
+
+#endif
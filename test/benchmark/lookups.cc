@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/int32.pb.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/HandlerStorage.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/NodeShared.hh"
+#include "ignition/transport/SubscriptionHandler.hh"
+#include "ignition/transport/TopicUtils.hh"
+#include "ignition/transport/Uuid.hh"
+#include "benchmarkUtils.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Handlers of the HandlerStorage benchmarks.
+using Int32Handler = SubscriptionHandler<msgs::Int32>;
+
+//////////////////////////////////////////////////
+/// \brief Topic name used by the benchmarks.
+/// \param[in] _index Index of the topic.
+/// \return The topic name.
+static std::string Topic(const int64_t _index)
+{
+  return "/bench/topic_" + std::to_string(_index);
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscription callback doing nothing.
+static void OnInt32(const msgs::Int32 &)
+{
+}
+
+//////////////////////////////////////////////////
+/// \brief Look up the subscribers of a topic before publishing, with
+/// several topics subscribed. Argument: number of topics.
+static void CheckSubscriberInfo(benchmark::State &_state)
+{
+  Node node;
+  for (int64_t i = 0; i < _state.range(0); ++i)
+    node.Subscribe(Topic(i), OnInt32);
+
+  std::string topic;
+  TopicUtils::FullyQualifiedName(node.Options().Partition(),
+    node.Options().NameSpace(), Topic(0), topic);
+  const std::string msgType = msgs::Int32().GetTypeName();
+
+  NodeShared *shared = NodeShared::Instance();
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(shared->CheckSubscriberInfo(topic, msgType));
+}
+BENCHMARK(CheckSubscriberInfo)->Arg(1)->Arg(1000);
+
+//////////////////////////////////////////////////
+/// \brief Fill a handler storage.
+/// \param[in] _topics Number of topics.
+/// \param[in] _nodes Number of nodes subscribed to each topic.
+/// \param[out] _storage The storage.
+static void FillStorage(const int64_t _topics, const int64_t _nodes,
+  HandlerStorage<ISubscriptionHandler> &_storage)
+{
+  std::vector<std::string> nodes;
+  for (int64_t i = 0; i < _nodes; ++i)
+    nodes.push_back(Uuid().ToString());
+
+  for (int64_t i = 0; i < _topics; ++i)
+  {
+    for (const auto &nUuid : nodes)
+    {
+      _storage.AddHandler(Topic(i), nUuid,
+        std::make_shared<Int32Handler>(nUuid));
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Copy the handlers of a topic. Argument: number of nodes
+/// subscribed to each one of the 1000 topics.
+static void HandlerStorageHandlers(benchmark::State &_state)
+{
+  HandlerStorage<ISubscriptionHandler> storage;
+  FillStorage(1000, _state.range(0), storage);
+
+  const std::string topic = Topic(500);
+  std::map<std::string, ISubscriptionHandler_M> handlers;
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(storage.Handlers(topic, handlers));
+}
+BENCHMARK(HandlerStorageHandlers)->Arg(1)->Arg(100);
+
+//////////////////////////////////////////////////
+/// \brief Find the first handler of a topic for a type. Argument: number
+/// of nodes subscribed to each one of the 1000 topics.
+static void HandlerStorageFirstHandler(benchmark::State &_state)
+{
+  HandlerStorage<ISubscriptionHandler> storage;
+  FillStorage(1000, _state.range(0), storage);
+
+  const std::string topic = Topic(500);
+  const std::string msgType = msgs::Int32().GetTypeName();
+  ISubscriptionHandlerPtr handler;
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(storage.FirstHandler(topic, msgType, handler));
+}
+BENCHMARK(HandlerStorageFirstHandler)->Arg(1)->Arg(100);
+
+//////////////////////////////////////////////////
+/// \brief Check whether a topic has handlers. Argument: number of nodes
+/// subscribed to each one of the 1000 topics.
+static void HandlerStorageHasHandlers(benchmark::State &_state)
+{
+  HandlerStorage<ISubscriptionHandler> storage;
+  FillStorage(1000, _state.range(0), storage);
+
+  const std::string topic = Topic(500);
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(storage.HasHandlersForTopic(topic));
+}
+BENCHMARK(HandlerStorageHasHandlers)->Arg(1)->Arg(100);
+
+//////////////////////////////////////////////////
+/// \brief Build the fully qualified name of a topic.
+static void FullyQualifiedName(benchmark::State &_state)
+{
+  std::string name;
+  for (auto _ : _state)
+  {
+    benchmark::DoNotOptimize(TopicUtils::FullyQualifiedName("partition",
+      "/ns", "topic", name));
+  }
+}
+BENCHMARK(FullyQualifiedName);
+
+//////////////////////////////////////////////////
+/// \brief Generate a UUID.
+static void UuidGeneration(benchmark::State &_state)
+{
+  for (auto _ : _state)
+  {
+    Uuid uuid;
+    benchmark::DoNotOptimize(uuid);
+  }
+}
+BENCHMARK(UuidGeneration);
+
+//////////////////////////////////////////////////
+/// \brief Format a UUID.
+static void UuidToString(benchmark::State &_state)
+{
+  const Uuid uuid;
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(uuid.ToString());
+}
+BENCHMARK(UuidToString);
+
+IGN_TRANSPORT_BENCHMARK_MAIN()
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/bytes.pb.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/Node.hh"
+#include "benchmarkUtils.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Topic of the local benchmarks.
+static const char kLocalTopic[] = "/bench/local";
+
+//////////////////////////////////////////////////
+/// \brief Create a message with a payload.
+/// \param[in] _size Size of the payload, in bytes.
+/// \return The message.
+static msgs::Bytes Payload(const int64_t _size)
+{
+  msgs::Bytes msg;
+  msg.set_data(std::string(static_cast<std::size_t>(_size), 'x'));
+  return msg;
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscription callback doing nothing.
+static void OnBytes(const msgs::Bytes &)
+{
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish to local subscribers, each one in its own node.
+/// Arguments: number of subscribers, size of the payload.
+static void PublishLocal(benchmark::State &_state)
+{
+  Node node;
+  auto pub = node.Advertise<msgs::Bytes>(kLocalTopic);
+
+  std::vector<std::unique_ptr<Node>> subscribers;
+  for (int64_t i = 0; i < _state.range(0); ++i)
+  {
+    subscribers.emplace_back(new Node());
+    subscribers.back()->Subscribe(kLocalTopic, OnBytes);
+  }
+
+  const msgs::Bytes msg = Payload(_state.range(1));
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(pub.Publish(msg));
+
+  _state.SetItemsProcessed(_state.iterations());
+  _state.SetBytesProcessed(_state.iterations() * _state.range(1));
+}
+BENCHMARK(PublishLocal)->ArgsProduct({{0, 1, 8}, {16, 65536}});
+
+//////////////////////////////////////////////////
+/// \brief Publish to local raw subscribers, which need the message to be
+/// serialized. Arguments: number of subscribers, size of the payload.
+static void PublishRaw(benchmark::State &_state)
+{
+  Node node;
+  auto pub = node.Advertise<msgs::Bytes>(kLocalTopic);
+
+  std::vector<std::unique_ptr<Node>> subscribers;
+  for (int64_t i = 0; i < _state.range(0); ++i)
+  {
+    subscribers.emplace_back(new Node());
+    subscribers.back()->SubscribeRaw(kLocalTopic,
+      [](const char *, const std::size_t, const MessageInfo &) {});
+  }
+
+  const msgs::Bytes msg = Payload(_state.range(1));
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(pub.Publish(msg));
+
+  _state.SetItemsProcessed(_state.iterations());
+  _state.SetBytesProcessed(_state.iterations() * _state.range(1));
+}
+BENCHMARK(PublishRaw)->ArgsProduct({{1, 8}, {16, 65536}});
+
+//////////////////////////////////////////////////
+/// \brief Publish to the subscribers of other processes. Arguments: number
+/// of remote peers, size of the payload.
+static void PublishRemote(benchmark::State &_state)
+{
+  bench::RemotePeers::Instance().Start(
+    static_cast<std::size_t>(_state.range(0)));
+
+  Node node;
+  auto pub = node.Advertise<msgs::Bytes>(bench::kRemoteTopic);
+  if (!bench::WaitFor([&pub]() {return pub.HasConnections();}))
+  {
+    _state.SkipWithError("The remote peers were not discovered");
+    return;
+  }
+
+  const msgs::Bytes msg = Payload(_state.range(1));
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(pub.Publish(msg));
+
+  _state.SetItemsProcessed(_state.iterations());
+  _state.SetBytesProcessed(_state.iterations() * _state.range(1));
+}
+BENCHMARK(PublishRemote)->ArgsProduct({{1, 4}, {16, 65536}});
+
+IGN_TRANSPORT_BENCHMARK_MAIN()
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/int32.pb.h>
+
+#include <iostream>
+#include <string>
+
+#include "ignition/transport/Node.hh"
+#include "benchmarkUtils.hh"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Provide the service of the remote round-trip benchmark.
+bool srvEcho(const msgs::Int32 &_req, msgs::Int32 &_rep)
+{
+  _rep.set_data(_req.data());
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscriber and replier of the remote benchmarks, running until
+/// it's terminated.
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Partition name has not be passed as argument" << std::endl;
+    return -1;
+  }
+
+  // Set the partition name for this peer.
+  setenv("IGN_PARTITION", argv[1], 1);
+
+  transport::Node node;
+  if (!node.SubscribeRaw(bench::kRemoteTopic,
+        [](const char *, const std::size_t, const transport::MessageInfo &)
+        {
+        }))
+  {
+    std::cerr << "Error subscribing to [" << bench::kRemoteTopic << "]"
+              << std::endl;
+    return -1;
+  }
+
+  if (!node.Advertise(bench::kRemoteService, srvEcho))
+  {
+    std::cerr << "Error advertising [" << bench::kRemoteService << "]"
+              << std::endl;
+    return -1;
+  }
+
+  transport::waitForShutdown();
+  return 0;
+}
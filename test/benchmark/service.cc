@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/int32.pb.h>
+
+#include <string>
+
+#include "ignition/transport/Node.hh"
+#include "benchmarkUtils.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Service of the local benchmark.
+static const char kLocalService[] = "/bench/echo";
+
+/// \brief Timeout of the requests, in milliseconds.
+static const unsigned int kTimeout = 5000;
+
+//////////////////////////////////////////////////
+/// \brief Provide the service of the local round-trip benchmark.
+bool srvEcho(const msgs::Int32 &_req, msgs::Int32 &_rep)
+{
+  _rep.set_data(_req.data());
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Round-trip of a blocking request to a service of this process.
+static void ServiceLocal(benchmark::State &_state)
+{
+  Node node;
+  node.Advertise(kLocalService, srvEcho);
+
+  msgs::Int32 req;
+  msgs::Int32 rep;
+  bool result;
+  req.set_data(1);
+  for (auto _ : _state)
+  {
+    if (!node.Request(kLocalService, req, kTimeout, rep, result) || !result)
+    {
+      _state.SkipWithError("The request failed");
+      break;
+    }
+  }
+
+  _state.SetItemsProcessed(_state.iterations());
+}
+BENCHMARK(ServiceLocal);
+
+//////////////////////////////////////////////////
+/// \brief Round-trip of a blocking request to a service of another process.
+static void ServiceRemote(benchmark::State &_state)
+{
+  bench::RemotePeers::Instance().Start(1);
+
+  Node node;
+  msgs::Int32 req;
+  msgs::Int32 rep;
+  bool result;
+  req.set_data(1);
+
+  // The first request waits for the discovery of the service.
+  if (!node.Request(bench::kRemoteService, req, kTimeout, rep, result) ||
+      !result)
+  {
+    _state.SkipWithError("The remote service was not discovered");
+    return;
+  }
+
+  for (auto _ : _state)
+  {
+    if (!node.Request(bench::kRemoteService, req, kTimeout, rep, result) ||
+        !result)
+    {
+      _state.SkipWithError("The request failed");
+      break;
+    }
+  }
+
+  _state.SetItemsProcessed(_state.iterations());
+}
+BENCHMARK(ServiceRemote)->UseRealTime();
+
+IGN_TRANSPORT_BENCHMARK_MAIN()
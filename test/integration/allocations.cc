@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/AllocationCounter.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+using transport::AllocationCounter;
+using transport::AllocationPath;
+
+static std::string partition;  // NOLINT(*)
+static const std::string g_local = "/allocations/local";  // NOLINT(*)
+static const std::string g_toPeer = "/allocations/to_peer";  // NOLINT(*)
+static const std::string g_fromPeer = "/allocations/from_peer";  // NOLINT(*)
+
+/// \brief Messages of each measure.
+static const int kMessages = 1000;
+
+/// \brief Messages received by the subscribers of the tests.
+static std::atomic<int> received{0};
+
+//////////////////////////////////////////////////
+/// \brief Function called each time a message of the tests is received.
+void cb(const ignition::msgs::Int32 &/*_msg*/)
+{
+  ++received;
+}
+
+//////////////////////////////////////////////////
+/// \brief Wait for a condition.
+/// \param[in] _condition The condition.
+/// \return True if the condition was met before the timeout.
+bool waitFor(const std::function<bool()> &_condition)
+{
+  for (int i = 0; i < 500 && !_condition(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  return _condition();
+}
+
+//////////////////////////////////////////////////
+/// \brief Report the allocations per call of a path since the last reset.
+/// The values depend on the standard library, protobuf and ZeroMQ, so they
+/// are printed for the comparison of the builds instead of checked.
+/// \param[in] _path The path.
+/// \param[in] _name Name of the path in the output.
+void reportAllocations(const AllocationPath _path, const std::string &_name)
+{
+  const uint64_t calls = AllocationCounter::Calls(_path);
+  ASSERT_GT(calls, 0u) << _name;
+
+  const double perCall =
+    static_cast<double>(AllocationCounter::Allocations(_path)) /
+    static_cast<double>(calls);
+  std::cout << _name << ": " << perCall << " allocations per message"
+            << std::endl;
+}
+
+//////////////////////////////////////////////////
+/// \brief Start the peer process of the remote tests.
+/// \return The handler of the process.
+testing::forkHandlerType startPeer()
+{
+  const std::string peerPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR, "INTEGRATION_allocationsPeer_aux");
+  return testing::forkAndRun(peerPath.c_str(), partition.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish to a subscriber of the same process, delivered by the
+/// publish thread.
+TEST(allocations, PublishLocal)
+{
+  if (!AllocationCounter::Enabled())
+    GTEST_SKIP() << "Built without IGN_TRANSPORT_ALLOCATION_COUNTING";
+
+  transport::Node pubNode;
+  transport::Node subNode;
+  auto pub = pubNode.Advertise<ignition::msgs::Int32>(g_local);
+  ASSERT_TRUE(subNode.Subscribe(g_local, cb));
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(1);
+
+  // Warm up the caches of the paths, they allocate on first use.
+  received = 0;
+  for (int i = 0; i < kMessages; ++i)
+    EXPECT_TRUE(pub.Publish(msg));
+  ASSERT_TRUE(waitFor([]() {return received == kMessages;}));
+
+  AllocationCounter::Reset();
+  received = 0;
+  for (int i = 0; i < kMessages; ++i)
+    EXPECT_TRUE(pub.Publish(msg));
+  ASSERT_TRUE(waitFor([]() {return received == kMessages;}));
+
+  reportAllocations(AllocationPath::PUBLISHER_PUBLISH, "Publish");
+  reportAllocations(AllocationPath::PUBLISH_THREAD, "PublishThread");
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish to a subscriber of another process.
+TEST(allocations, PublishRemote)
+{
+  if (!AllocationCounter::Enabled())
+    GTEST_SKIP() << "Built without IGN_TRANSPORT_ALLOCATION_COUNTING";
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_toPeer);
+
+  testing::forkHandlerType peer = startPeer();
+  ASSERT_TRUE(waitFor([&pub]() {return pub.HasConnections();}));
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(1);
+
+  // Warm up the caches of the paths, they allocate on first use.
+  for (int i = 0; i < kMessages; ++i)
+    EXPECT_TRUE(pub.Publish(msg));
+
+  AllocationCounter::Reset();
+  for (int i = 0; i < kMessages; ++i)
+    EXPECT_TRUE(pub.Publish(msg));
+
+  reportAllocations(AllocationPath::PUBLISHER_PUBLISH, "Publish");
+  reportAllocations(AllocationPath::NODE_SHARED_PUBLISH,
+    "NodeShared::Publish");
+
+  testing::killFork(peer);
+  testing::waitAndCleanupFork(peer);
+}
+
+//////////////////////////////////////////////////
+/// \brief Receive the messages of a publisher of another process.
+TEST(allocations, ReceiveRemote)
+{
+  if (!AllocationCounter::Enabled())
+    GTEST_SKIP() << "Built without IGN_TRANSPORT_ALLOCATION_COUNTING";
+
+  transport::Node node;
+  ASSERT_TRUE(node.Subscribe(g_fromPeer, cb));
+
+  received = 0;
+  testing::forkHandlerType peer = startPeer();
+
+  // Warm up the caches of the paths, they allocate on first use.
+  ASSERT_TRUE(waitFor([]() {return received >= kMessages / 10;}));
+
+  AllocationCounter::Reset();
+  const int start = received;
+  ASSERT_TRUE(waitFor([start]() {return received >= start + kMessages;}));
+
+  reportAllocations(AllocationPath::RECV_MSG_UPDATE, "RecvMsgUpdate");
+  reportAllocations(AllocationPath::TRIGGER_CALLBACKS, "TriggerCallbacks");
+
+  testing::killFork(peer);
+  testing::waitAndCleanupFork(peer);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
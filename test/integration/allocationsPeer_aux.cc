@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static const std::string g_toPeer = "/allocations/to_peer";  // NOLINT(*)
+static const std::string g_fromPeer = "/allocations/from_peer";  // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Function called each time a message of the test is received.
+void cb(const ignition::msgs::Int32 &/*_msg*/)
+{
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe to the messages of the test and publish to it at 1 kHz
+/// until killed.
+void subscribeAndPublish()
+{
+  transport::Node node;
+  if (!node.Subscribe(g_toPeer, cb))
+  {
+    std::cerr << "Error subscribing to [" << g_toPeer << "]" << std::endl;
+    return;
+  }
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_fromPeer);
+  ignition::msgs::Int32 msg;
+  for (int i = 0; ; ++i)
+  {
+    msg.set_data(i);
+    pub.Publish(msg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Partition name has not be passed as argument" << std::endl;
+    return -1;
+  }
+
+  // Set the partition name for this test.
+  setenv("IGN_PARTITION", argv[1], 1);
+
+  subscribeAndPublish();
+}
@@ -29,6 +29,16 @@ using namespace ignition;
 static std::string partition; // NOLINT(*)
 static std::string g_topic = "/foo"; // NOLINT(*)
 
+/// \brief Two CURVE key pairs, Z85 encoded.
+static const char kCurvePublicKey[] =
+  "rq:rM>}U?@Lns47E1%kR.o@n%FcmmsL/@{H8]yf7";
+static const char kCurveSecretKey[] =
+  "JTKVSB%%)wK0E.X)V>+}o?pNmC{O&4W4b!Ni{Lh6";
+static const char kOtherCurvePublicKey[] =
+  "Yne@$w-vo<fVvi]a<NY6T1ed:M$fCG*[IaLV{hID";
+static const char kOtherCurveSecretKey[] =
+  "D:)Q[IlAW!ahhC2ac:9*A}h:p?([4%wOTJ%JR%cs";
+
 //////////////////////////////////////////////////
 TEST(authPubSub, InvalidAuth)
 {
@@ -72,6 +82,42 @@ TEST(authPubSub, InvalidAuth)
   testing::waitAndCleanupFork(pi);
 }
 
+//////////////////////////////////////////////////
+/// \brief The processes sharing a CURVE key pair exchange messages.
+TEST(authPubSub, CurveAuth)
+{
+  std::string curvePath = testing::portablePathUnion(
+     IGN_TRANSPORT_TEST_DIR,
+     "INTEGRATION_authPubSubCurve_aux");
+
+  testing::forkHandlerType pi1 = testing::forkAndRun(curvePath.c_str(),
+    partition.c_str(), kCurvePublicKey, kCurveSecretKey);
+  testing::forkHandlerType pi2 = testing::forkAndRun(curvePath.c_str(),
+    partition.c_str(), kCurvePublicKey, kCurveSecretKey);
+
+  // Each process receives the messages of the other one.
+  EXPECT_EQ(0, testing::waitAndCleanupFork(pi1));
+  EXPECT_EQ(0, testing::waitAndCleanupFork(pi2));
+}
+
+//////////////////////////////////////////////////
+/// \brief The processes with another CURVE key pair are not connected.
+TEST(authPubSub, CurveWrongKey)
+{
+  std::string curvePath = testing::portablePathUnion(
+     IGN_TRANSPORT_TEST_DIR,
+     "INTEGRATION_authPubSubCurve_aux");
+
+  testing::forkHandlerType pi1 = testing::forkAndRun(curvePath.c_str(),
+    partition.c_str(), kCurvePublicKey, kCurveSecretKey);
+  testing::forkHandlerType pi2 = testing::forkAndRun(curvePath.c_str(),
+    partition.c_str(), kOtherCurvePublicKey, kOtherCurveSecretKey);
+
+  // Neither process receives the messages of the other one.
+  EXPECT_EQ(1, testing::waitAndCleanupFork(pi1));
+  EXPECT_EQ(1, testing::waitAndCleanupFork(pi2));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string g_topic = "/foo"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Publish and subscribe with a CURVE key pair.
+/// \return 0 if a message of another process was received, 1 otherwise.
+int advertiseAndSubscribe()
+{
+  // The messages of this process carry its own id.
+  const int32_t id = std::stoi(testing::getRandomNumber());
+  std::atomic<bool> received{false};
+
+  std::function<void(const ignition::msgs::Int32 &)> cb =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      if (_msg.data() != id)
+        received = true;
+    };
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  if (!node.Subscribe(g_topic, cb))
+  {
+    std::cerr << "Unable to subscribe to [" << g_topic << "]" << std::endl;
+    return 1;
+  }
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(id);
+
+  // Keep publishing until the end, the other process may still be waiting.
+  for (auto i = 0; i < 30; ++i)
+  {
+    pub.Publish(msg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  return received ? 0 : 1;
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc != 4)
+  {
+    std::cerr << "Partition name, public key and secret key have not been "
+      << "passed as arguments" << std::endl;
+    return -1;
+  }
+
+  // Set the partition name for this test.
+  setenv("IGN_PARTITION", argv[1], 1);
+
+  // Set the CURVE key pair for this test.
+  setenv("IGN_TRANSPORT_CURVE_PUBLIC_KEY", argv[2], 1);
+  setenv("IGN_TRANSPORT_CURVE_SECRET_KEY", argv[3], 1);
+
+  return advertiseAndSubscribe();
+}
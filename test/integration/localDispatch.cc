@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "gtest/gtest.h"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string partition; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief A slow local callback must not delay the callbacks of the topics
+/// delivered by the other publish threads.
+TEST(LocalDispatchTest, ParallelTopics)
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  int fastCounter = 0;
+  bool slowDone = false;
+  bool fastDuringSlow = false;
+
+  transport::Node node;
+  std::function<void(const msgs::Int32 &)> slowCb =
+    [&](const msgs::Int32 &)
+    {
+      std::unique_lock<std::mutex> lk(mutex);
+      fastDuringSlow = cv.wait_for(lk, std::chrono::seconds(5),
+        [&]{return fastCounter > 0;});
+      slowDone = true;
+      cv.notify_all();
+    };
+  std::function<void(const msgs::Int32 &)> fastCb =
+    [&](const msgs::Int32 &)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      ++fastCounter;
+      cv.notify_all();
+    };
+
+  // With two publish threads, at least one of the fast topics is not
+  // handled by the thread of the slow topic.
+  EXPECT_TRUE(node.Subscribe("/slow", slowCb));
+  std::vector<transport::Node::Publisher> fastPubs;
+  for (int i = 0; i < 8; ++i)
+  {
+    const std::string topic = "/fast" + std::to_string(i);
+    EXPECT_TRUE(node.Subscribe(topic, fastCb));
+    fastPubs.push_back(node.Advertise<msgs::Int32>(topic));
+  }
+  auto slowPub = node.Advertise<msgs::Int32>("/slow");
+
+  msgs::Int32 msg;
+  msg.set_data(1);
+  EXPECT_TRUE(slowPub.Publish(msg));
+  for (auto &pub : fastPubs)
+    EXPECT_TRUE(pub.Publish(msg));
+
+  std::unique_lock<std::mutex> lk(mutex);
+  EXPECT_TRUE(cv.wait_for(lk, std::chrono::seconds(10),
+    [&]{return slowDone && fastCounter == 8;}));
+  EXPECT_TRUE(fastDuringSlow);
+}
+
+//////////////////////////////////////////////////
+/// \brief The messages of each topic are delivered in order.
+TEST(LocalDispatchTest, PerTopicOrder)
+{
+  const int kTopics = 4;
+  const int kMessages = 500;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<int> next(kTopics, 0);
+  int outOfOrder = 0;
+  int received = 0;
+
+  transport::Node node;
+  std::vector<transport::Node::Publisher> pubs;
+  for (int t = 0; t < kTopics; ++t)
+  {
+    std::function<void(const msgs::Int32 &)> cb =
+      [&, t](const msgs::Int32 &_msg)
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (_msg.data() != next[t])
+          ++outOfOrder;
+        next[t] = _msg.data() + 1;
+        ++received;
+        cv.notify_all();
+      };
+    const std::string topic = "/order" + std::to_string(t);
+    EXPECT_TRUE(node.Subscribe(topic, cb));
+    pubs.push_back(node.Advertise<msgs::Int32>(topic));
+  }
+
+  msgs::Int32 msg;
+  for (int i = 0; i < kMessages; ++i)
+  {
+    msg.set_data(i);
+    for (auto &pub : pubs)
+      EXPECT_TRUE(pub.Publish(msg));
+  }
+
+  std::unique_lock<std::mutex> lk(mutex);
+  EXPECT_TRUE(cv.wait_for(lk, std::chrono::seconds(10),
+    [&]{return received == kTopics * kMessages;}));
+  EXPECT_EQ(0, outOfOrder);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+  setenv("IGN_TRANSPORT_LOCAL_PUBLISH_THREADS", "2", 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <chrono>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "gtest/gtest.h"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string partition; // NOLINT(*)
+static std::string g_topic = "/foo"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Two processes offer the same service. With round-robin load
+/// balancing both of them receive requests.
+TEST(srvLoadBalancing, RoundRobin)
+{
+  std::string responserPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_srvLoadBalancingReplier_aux");
+
+  testing::forkHandlerType pi1 = testing::forkAndRun(responserPath.c_str(),
+    partition.c_str());
+  testing::forkHandlerType pi2 = testing::forkAndRun(responserPath.c_str(),
+    partition.c_str());
+
+  transport::Node node;
+
+  // Wait until both responsers are discovered.
+  std::vector<transport::ServicePublisher> publishers;
+  for (int i = 0; i < 50 && publishers.size() < 2u; ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    node.ServiceInfo(g_topic, publishers);
+  }
+  ASSERT_EQ(2u, publishers.size());
+
+  ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  bool result;
+  std::set<int> responsers;
+  for (int i = 0; i < 10; ++i)
+  {
+    EXPECT_TRUE(node.Request(g_topic, req, 3000, rep, result));
+    EXPECT_TRUE(result);
+    responsers.insert(rep.data());
+  }
+
+  EXPECT_EQ(2u, responsers.size());
+
+  testing::killFork(pi1);
+  testing::killFork(pi2);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  // Spread the requests among the responsers.
+  setenv("IGN_TRANSPORT_SRV_LOAD_BALANCING", "round_robin", 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
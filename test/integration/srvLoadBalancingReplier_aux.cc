@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <chrono>
+#include <climits>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/Node.hh"
+#include "gtest/gtest.h"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string g_topic = "/foo"; // NOLINT(*)
+static int Forever = INT_MAX;
+
+//////////////////////////////////////////////////
+/// \brief Provide a service that replies with the ID of this process.
+bool srvProcessId(const ignition::msgs::Int32 &/*_req*/,
+  ignition::msgs::Int32 &_rep)
+{
+  _rep.set_data(static_cast<int>(transport::getProcessId()));
+  return true;
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Partition name has not be passed as argument" << std::endl;
+    return -1;
+  }
+
+  // Set the partition name for this test.
+  setenv("IGN_PARTITION", argv[1], 1);
+
+  transport::Node node;
+  if (!node.Advertise(g_topic, srvProcessId))
+    return -1;
+
+  // Run the node forever. Should be killed by the test that uses this.
+  std::this_thread::sleep_for(std::chrono::milliseconds(Forever));
+}
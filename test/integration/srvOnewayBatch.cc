@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "gtest/gtest.h"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string partition; // NOLINT(*)
+static std::string g_topic = "/foo"; // NOLINT(*)
+static std::string g_countTopic = "/count"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Send many oneway requests to another process. They are sent in
+/// batches and all of them arrive, in order.
+TEST(srvOnewayBatch, ManyRequests)
+{
+  std::string responserPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_srvOnewayBatchReplier_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(responserPath.c_str(),
+    partition.c_str());
+
+  transport::Node node;
+
+  // Wait until the responser is discovered.
+  ignition::msgs::Int32 rep;
+  bool result;
+  EXPECT_TRUE(node.Request(g_countTopic, 3000, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(0, rep.data());
+
+  const int numRequests = 3000;
+  ignition::msgs::Int32 req;
+  for (int i = 0; i < numRequests; ++i)
+  {
+    req.set_data(i);
+    EXPECT_TRUE(node.Request(g_topic, req));
+  }
+
+  // Wait for the last batch.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  EXPECT_TRUE(node.Request(g_countTopic, 3000, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(numRequests, rep.data());
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  // Send the oneway requests in batches.
+  setenv("IGN_TRANSPORT_SRV_ONEWAY_BATCH_DELAY", "50", 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "gtest/gtest.h"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string g_topic = "/foo"; // NOLINT(*)
+static std::string g_countTopic = "/count"; // NOLINT(*)
+static std::mutex g_mutex;
+static int g_count = 0;
+static bool g_inOrder = true;
+
+//////////////////////////////////////////////////
+/// \brief Provide a service without output. The requests carry a sequence
+/// number starting at zero.
+void srvWithoutOutput(const ignition::msgs::Int32 &_req)
+{
+  std::lock_guard<std::mutex> lk(g_mutex);
+  g_inOrder = g_inOrder && _req.data() == g_count;
+  ++g_count;
+}
+
+//////////////////////////////////////////////////
+/// \brief Provide the number of requests received, or -1 if they were
+/// received out of order.
+bool srvCount(ignition::msgs::Int32 &_rep)
+{
+  std::lock_guard<std::mutex> lk(g_mutex);
+  _rep.set_data(g_inOrder ? g_count : -1);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void runReplier()
+{
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutOutput));
+  EXPECT_TRUE(node.Advertise(g_countTopic, srvCount));
+  std::this_thread::sleep_for(std::chrono::milliseconds(6000));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Partition name has not be passed as argument" << std::endl;
+    return -1;
+  }
+
+  // Set the partition name for this test.
+  setenv("IGN_PARTITION", argv[1], 1);
+
+  runReplier();
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/NodeShared.hh"
+#include "ignition/transport/TopicUtils.hh"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string partition; // NOLINT(*)
+static std::atomic<int> msgCount(0);
+static std::atomic<int> statisticsCount(0);
+static std::atomic<int> slowStatisticsCount(0);
+
+//////////////////////////////////////////////////
+void cb(const ignition::msgs::Int32 & /*_msg*/)
+{
+  ++msgCount;
+}
+
+//////////////////////////////////////////////////
+void statsCb(const ignition::msgs::Metric & /*_msg*/)
+{
+  ++statisticsCount;
+}
+
+//////////////////////////////////////////////////
+/// \brief Enable the statistics of a topic published by another process,
+/// without IGN_TRANSPORT_TOPIC_STATISTICS. The publisher starts sending
+/// the publication metadata of the topic when we ask for it.
+TEST(topicStatistics, PerTopicStatistics)
+{
+  std::string publisherPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_pub_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(publisherPath.c_str(),
+    partition.c_str());
+
+  transport::Node node;
+  EXPECT_TRUE(node.Subscribe("/foo", cb));
+  EXPECT_TRUE(node.Subscribe("/statistics", statsCb));
+
+  // Receive a few messages without statistics.
+  for (int i = 0; i < 100 && msgCount < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GE(msgCount, 2);
+  EXPECT_EQ(std::nullopt, node.TopicStats("/foo"));
+
+  // The subscription is registered again, asking for the metadata.
+  EXPECT_TRUE(node.EnableStats("/foo", true, "/statistics", 100));
+  for (int i = 0; i < 100 && statisticsCount < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  // The messages keep coming, with the metadata.
+  const int received = msgCount;
+  for (int i = 0; i < 100 && msgCount < received + 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GE(msgCount, received + 2);
+
+  EXPECT_GE(statisticsCount, 2);
+  auto stats = node.TopicStats("/foo");
+  ASSERT_NE(std::nullopt, stats);
+  EXPECT_GT(stats->ReceptionStatistics().Count(), 0u);
+  EXPECT_GE(stats->AgeStatistics().Min(), 0.0);
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+void slowStatsCb(const transport::TopicStatistics & /*_stats*/)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  ++slowStatisticsCount;
+}
+
+//////////////////////////////////////////////////
+/// \brief A slow statistics callback doesn't delay the reception of the
+/// messages, and it's not triggered anymore after disabling the statistics.
+TEST(topicStatistics, SlowStatisticsCallback)
+{
+  msgCount = 0;
+
+  std::string publisherPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_pub_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(publisherPath.c_str(),
+    partition.c_str());
+
+  transport::Node node;
+  std::string topic;
+  ASSERT_TRUE(transport::TopicUtils::FullyQualifiedName(
+    node.Options().Partition(), node.Options().NameSpace(), "/foo", topic));
+
+  // The callback is triggered for every update.
+  transport::NodeShared *shared = transport::NodeShared::Instance();
+  shared->EnableStats(topic, true, slowStatsCb, 0);
+  EXPECT_TRUE(node.Subscribe("/foo", cb));
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // The publisher sends 15 messages in 1.5 seconds, the callback only
+  // gets the latest statistics when it's done with the previous ones.
+  EXPECT_GE(msgCount, 10);
+  EXPECT_GT(slowStatisticsCount, 0);
+  EXPECT_LT(slowStatisticsCount, msgCount);
+
+  shared->EnableStats(topic, false, nullptr);
+  const int count = slowStatisticsCount;
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_EQ(count, slowStatisticsCount);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -14,9 +14,14 @@
  * limitations under the License.
  *
 */
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <ignition/msgs.hh>
 
 #include "ignition/transport/Node.hh"
@@ -114,6 +119,310 @@ TEST(twoProcSrvCall, SrvTwoProcs)
   testing::waitAndCleanupFork(pi);
 }
 
+//////////////////////////////////////////////////
+/// \brief Two different nodes running in two different processes. One node
+/// advertises a service and the other requests many service calls at once.
+/// All the requests are in flight at the same time, each response has to be
+/// matched with its request.
+TEST(twoProcSrvCall, SrvTwoProcsRequestAll)
+{
+  std::string responser_path = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsSrvCallReplier_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(responser_path.c_str(),
+    partition.c_str());
+
+  reset();
+
+  std::vector<ignition::msgs::Int32> reqs(100);
+  for (std::size_t i = 0; i < reqs.size(); ++i)
+    reqs[i].set_data(static_cast<int>(i));
+
+  std::vector<ignition::msgs::Int32> reps;
+  std::vector<bool> results;
+  unsigned int timeout = 3000;
+
+  transport::Node node;
+  EXPECT_TRUE(node.RequestAll(g_topic, reqs, timeout, reps, results));
+  ASSERT_EQ(reqs.size(), reps.size());
+  ASSERT_EQ(reqs.size(), results.size());
+  for (std::size_t i = 0; i < reqs.size(); ++i)
+  {
+    EXPECT_TRUE(results[i]);
+    EXPECT_EQ(reqs[i].data(), reps[i].data());
+  }
+
+  // The connection to the responser is reused.
+  EXPECT_TRUE(node.RequestAll(g_topic, reqs, timeout, reps, results));
+  for (std::size_t i = 0; i < reqs.size(); ++i)
+  {
+    EXPECT_TRUE(results[i]);
+    EXPECT_EQ(reqs[i].data(), reps[i].data());
+  }
+
+  reset();
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief The responser runs up to four requests of a slow service at the
+/// same time, so four requests take about as long as one.
+TEST(twoProcSrvCall, SrvTwoProcsMaxConcurrency)
+{
+  std::string responser_path = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsSrvCallReplier_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(responser_path.c_str(),
+    partition.c_str());
+
+  reset();
+
+  const std::string slowTopic = "/slow";
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+  ignition::msgs::Int32 rep;
+  bool result;
+
+  // Wait for the discovery and the connections.
+  transport::Node node;
+  EXPECT_TRUE(node.Request(slowTopic, req, 3000, rep, result));
+  EXPECT_TRUE(result);
+
+  std::vector<ignition::msgs::Int32> reqs(4);
+  for (std::size_t i = 0; i < reqs.size(); ++i)
+    reqs[i].set_data(static_cast<int>(i));
+
+  // Running the requests one after the other would take 2 seconds.
+  std::vector<ignition::msgs::Int32> reps;
+  std::vector<bool> results;
+  EXPECT_TRUE(node.RequestAll(slowTopic, reqs, 1500, reps, results));
+  ASSERT_EQ(reqs.size(), reps.size());
+  ASSERT_EQ(reqs.size(), results.size());
+  for (std::size_t i = 0; i < reqs.size(); ++i)
+  {
+    EXPECT_TRUE(results[i]);
+    EXPECT_EQ(reqs[i].data(), reps[i].data());
+  }
+
+  reset();
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief The requests received while the queue of a service is full fail
+/// right away instead of timing out.
+TEST(twoProcSrvCall, SrvTwoProcsMaxQueue)
+{
+  std::string responser_path = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsSrvCallReplier_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(responser_path.c_str(),
+    partition.c_str());
+
+  reset();
+
+  const std::string shedTopic = "/shed";
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+  ignition::msgs::Int32 rep;
+  bool result;
+
+  // Wait for the discovery and the connections.
+  transport::Node node;
+  EXPECT_TRUE(node.Request(shedTopic, req, 3000, rep, result));
+  EXPECT_TRUE(result);
+
+  // One request runs, one waits and the other two are rejected.
+  std::vector<ignition::msgs::Int32> reqs(4);
+  std::vector<ignition::msgs::Int32> reps;
+  std::vector<bool> results;
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(node.RequestAll(shedTopic, reqs, 3000, reps, results));
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(reqs.size(), results.size());
+  EXPECT_EQ(2, std::count(results.begin(), results.end(), true));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(2500));
+
+  reset();
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief The requests that time out while they wait for a worker of the
+/// responser are not executed.
+TEST(twoProcSrvCall, SrvTwoProcsExpiredRequests)
+{
+  std::string responser_path = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsSrvCallReplier_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(responser_path.c_str(),
+    partition.c_str());
+
+  reset();
+
+  const std::string slowTopic = "/slow";
+  const std::string slowCountTopic = "/slow_count";
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+  ignition::msgs::Int32 rep;
+  bool result;
+
+  // Wait for the discovery and the connections.
+  transport::Node node;
+  EXPECT_TRUE(node.Request(slowTopic, req, 3000, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_TRUE(node.Request(slowCountTopic, 3000, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(1, rep.data());
+
+  // Four requests run at once, the other four time out before a worker is
+  // available.
+  std::vector<ignition::msgs::Int32> reqs(8);
+  std::vector<ignition::msgs::Int32> reps;
+  std::vector<bool> results;
+  EXPECT_FALSE(node.RequestAll(slowTopic, reqs, 200, reps, results));
+
+  // Wait for the running requests.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  EXPECT_TRUE(node.Request(slowCountTopic, 3000, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(5, rep.data());
+
+  reset();
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief Receive the chunks of a streaming service from another process.
+TEST(twoProcSrvCall, SrvTwoProcsStream)
+{
+  std::string responser_path = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsSrvCallReplier_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(responser_path.c_str(),
+    partition.c_str());
+
+  reset();
+
+  ignition::msgs::Int32 req;
+  req.set_data(100);
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<int> chunks;
+  bool done = false;
+  bool result = false;
+
+  transport::Node node;
+  EXPECT_TRUE((node.RequestStream<ignition::msgs::Int32,
+    ignition::msgs::Int32>("/stream", req,
+    [&](const ignition::msgs::Int32 &_chunk)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      chunks.push_back(_chunk.data());
+    },
+    [&](const bool _result)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      result = _result;
+      done = true;
+      condition.notify_one();
+    })));
+
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::milliseconds(3000),
+      [&done] {return done;}));
+    EXPECT_TRUE(result);
+
+    // The chunks arrive in order.
+    ASSERT_EQ(100u, chunks.size());
+    for (int i = 0; i < 100; ++i)
+      EXPECT_EQ(i, chunks[i]);
+  }
+
+  reset();
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief Collect the statistics of the requests sent to another process.
+TEST(twoProcSrvCall, SrvTwoProcsStats)
+{
+  std::string responser_path = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsSrvCallReplier_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(responser_path.c_str(),
+    partition.c_str());
+
+  reset();
+
+  transport::Node node;
+  EXPECT_FALSE(node.ServiceStats(g_topic));
+
+  std::mutex mutex;
+  bool statsReceived = false;
+  std::function<void(const ignition::msgs::Metric &)> statsCb =
+    [&](const ignition::msgs::Metric &_msg)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      EXPECT_EQ("microseconds", _msg.unit());
+      statsReceived = true;
+    };
+  EXPECT_TRUE(node.Subscribe("/service_statistics", statsCb));
+  EXPECT_TRUE(node.EnableServiceStats(g_topic, true, "/service_statistics",
+    100));
+
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+  ignition::msgs::Int32 rep;
+  bool result;
+  for (int i = 0; i < 10; ++i)
+  {
+    EXPECT_TRUE(node.Request(g_topic, req, 3000, rep, result));
+    EXPECT_TRUE(result);
+  }
+
+  auto stats = node.ServiceStats(g_topic);
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(10u, stats->SentCount());
+  EXPECT_EQ(0u, stats->InFlightCount());
+  EXPECT_EQ(10u, stats->Latency().Count());
+  EXPECT_GT(stats->Latency().Max(), 0u);
+
+  // The requests are served by the other process.
+  EXPECT_EQ(0u, stats->ReceivedCount());
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_TRUE(statsReceived);
+  }
+
+  EXPECT_TRUE(node.EnableServiceStats(g_topic, false));
+  EXPECT_FALSE(node.ServiceStats(g_topic));
+
+  reset();
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
 //////////////////////////////////////////////////
 /// \brief This test spawns a service responser and a service requester. The
 /// requester uses a wrong type for the request argument. The test should verify
@@ -15,8 +15,11 @@
  *
 */
 
+#include <atomic>
 #include <chrono>
+#include <functional>
 #include <string>
+#include <thread>
 #include <ignition/msgs.hh>
 
 #include "ignition/transport/Node.hh"
@@ -26,6 +29,11 @@
 using namespace ignition;
 
 static std::string g_topic = "/foo"; // NOLINT(*)
+static std::string g_slowTopic = "/slow"; // NOLINT(*)
+static std::string g_slowCountTopic = "/slow_count"; // NOLINT(*)
+static std::string g_shedTopic = "/shed"; // NOLINT(*)
+static std::string g_streamTopic = "/stream"; // NOLINT(*)
+static std::atomic<int> g_slowCount{0};
 
 //////////////////////////////////////////////////
 /// \brief Provide a service.
@@ -35,11 +43,61 @@ bool srvEcho(const ignition::msgs::Int32 &_req, ignition::msgs::Int32 &_rep)
   return true;
 }
 
+//////////////////////////////////////////////////
+/// \brief Provide a slow service.
+bool srvSlowEcho(const ignition::msgs::Int32 &_req,
+  ignition::msgs::Int32 &_rep)
+{
+  ++g_slowCount;
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  _rep.set_data(_req.data());
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Provide the number of calls to the slow service.
+bool srvSlowCount(ignition::msgs::Int32 &_rep)
+{
+  _rep.set_data(g_slowCount);
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Provide a streaming service writing as many chunks as requested.
+bool srvStream(const ignition::msgs::Int32 &_req,
+  const std::function<bool(const ignition::msgs::Int32 &)> &_write)
+{
+  ignition::msgs::Int32 chunk;
+  for (int i = 0; i < _req.data(); ++i)
+  {
+    chunk.set_data(i);
+    if (!_write(chunk))
+      return false;
+  }
+  return true;
+}
+
 //////////////////////////////////////////////////
 void runReplier()
 {
   transport::Node node;
   EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  transport::AdvertiseServiceOptions opts;
+  opts.SetMaxConcurrency(4);
+  EXPECT_TRUE(node.Advertise(g_slowTopic, srvSlowEcho, opts));
+  EXPECT_TRUE(node.Advertise(g_slowCountTopic, srvSlowCount));
+
+  // One request runs and one waits, the others are rejected.
+  transport::AdvertiseServiceOptions shedOpts;
+  shedOpts.SetMaxConcurrency(1);
+  shedOpts.SetMaxQueue(1);
+  EXPECT_TRUE(node.Advertise(g_shedTopic, srvSlowEcho, shedOpts));
+
+  std::function<bool(const ignition::msgs::Int32 &,
+    const std::function<bool(const ignition::msgs::Int32 &)> &)> stream =
+    srvStream;
+  EXPECT_TRUE(node.AdvertiseStream(g_streamTopic, stream));
   std::this_thread::sleep_for(std::chrono::milliseconds(6000));
 }
 
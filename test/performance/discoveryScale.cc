@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/Discovery.hh"
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/MetricsRegistry.hh"
+#include "ignition/transport/Publisher.hh"
+#include "ignition/transport/TopicStorage.hh"
+#include "ignition/transport/Uuid.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+// Many virtual discovery peers run in this process, as the clients of a
+// discovery server on the loopback interface, so no multicast traffic is
+// needed. The scale is set with the IGN_DISCOVERY_SCALE_PEERS and
+// IGN_DISCOVERY_SCALE_TOPICS environment variables, e.g. 1000 and 50000 for
+// a large deployment, which needs about three file descriptors per peer.
+// The peers only recover the announcements lost by their own sockets with
+// the next announcement of the same publisher, so the larger deployments
+// may not converge before the timeout on a loaded host. The peers that
+// didn't are then reported.
+
+/// \brief Default number of virtual peers.
+static const std::size_t kDefaultPeers = 20;
+
+/// \brief Default number of topics, spread over the peers.
+static const std::size_t kDefaultTopics = 500;
+
+/// \brief UDP port of the discovery server.
+static const int kPort = 11329;
+
+/// \brief Longest wait for the peers to know every topic.
+static const std::chrono::seconds kTimeout(60);
+
+/// \brief Size of the header storing the size of each allocation, keeping
+/// the alignment of the allocations.
+static const std::size_t kHeader = alignof(std::max_align_t);
+
+/// \brief Bytes currently allocated by this process.
+static std::atomic<int64_t> g_liveBytes{0};
+
+//////////////////////////////////////////////////
+void *operator new(std::size_t _size)
+{
+  auto *ptr = static_cast<char *>(std::malloc(_size + kHeader));
+  if (!ptr)
+    throw std::bad_alloc();
+  *reinterpret_cast<std::size_t *>(ptr) = _size;
+  g_liveBytes.fetch_add(static_cast<int64_t>(_size),
+    std::memory_order_relaxed);
+  return ptr + kHeader;
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr) noexcept
+{
+  if (!_ptr)
+    return;
+  char *ptr = static_cast<char *>(_ptr) - kHeader;
+  g_liveBytes.fetch_sub(
+    static_cast<int64_t>(*reinterpret_cast<std::size_t *>(ptr)),
+    std::memory_order_relaxed);
+  std::free(ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr, std::size_t) noexcept
+{
+  operator delete(_ptr);
+}
+
+//////////////////////////////////////////////////
+/// \brief Get a size from an environment variable.
+/// \param[in] _name Name of the variable.
+/// \param[in] _default Value when the variable isn't set.
+/// \return The size.
+static std::size_t sizeFromEnv(const std::string &_name,
+    const std::size_t _default)
+{
+  std::string value;
+  if (!env(_name, value) || value.empty())
+    return _default;
+  return static_cast<std::size_t>(std::stoull(value));
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the value of a counter of the message discovery.
+/// \param[in] _name Name of the counter.
+/// \return The value.
+static uint64_t discoveryCounter(const std::string &_name)
+{
+  return MetricsRegistry::Instance().Counter(_name, "",
+    {{"discovery", "msg"}}).Value();
+}
+
+//////////////////////////////////////////////////
+/// \brief A virtual peer, a discovery client advertising a share of the
+/// topics.
+struct Peer
+{
+  /// \brief Process UUID of the peer.
+  std::string pUuid = Uuid().ToString();
+
+  /// \brief Remote publishers announced so far, some of them possibly
+  /// more than once.
+  std::atomic<std::size_t> known{0};
+
+  /// \brief True once the peer knows every topic.
+  bool converged = false;
+
+  /// \brief The discovery, created after the callback can count.
+  std::unique_ptr<MsgDiscovery> discovery;
+};
+
+//////////////////////////////////////////////////
+/// \brief Time for every peer to know every topic, discovery traffic,
+/// memory and CPU time of the discovery at scale.
+TEST(DiscoveryPerformance, Convergence)
+{
+  const std::size_t numPeers =
+    sizeFromEnv("IGN_DISCOVERY_SCALE_PEERS", kDefaultPeers);
+  const std::size_t numTopics =
+    sizeFromEnv("IGN_DISCOVERY_SCALE_TOPICS", kDefaultTopics);
+  ASSERT_GT(numPeers, 0u);
+
+#ifndef _WIN32
+  // Each peer has its own sockets.
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+  {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+#endif
+
+  // Only use the loopback interface.
+  setenv("IGN_IP", "127.0.0.1", 1);
+  const std::string ip = "239.255.0.7";
+  MsgDiscovery server(Uuid().ToString(), ip, kPort, false, true);
+  server.Start();
+
+  setenv("IGN_DISCOVERY_SERVER", "127.0.0.1", 1);
+  const int64_t bytesBefore = g_liveBytes;
+  std::vector<std::unique_ptr<Peer>> peers;
+  for (std::size_t i = 0; i < numPeers; ++i)
+  {
+    peers.push_back(std::make_unique<Peer>());
+    Peer *peer = peers.back().get();
+    peer->discovery = std::make_unique<MsgDiscovery>(peer->pUuid, ip, kPort);
+    peer->discovery->ConnectionsCb([peer](const MessagePublisher &)
+      {
+        peer->known.fetch_add(1, std::memory_order_relaxed);
+      });
+  }
+  unsetenv("IGN_DISCOVERY_SERVER");
+
+  // The topics of each peer, advertised at once.
+  std::vector<std::vector<MessagePublisher>> publishers(numPeers);
+  for (std::size_t t = 0; t < numTopics; ++t)
+  {
+    const std::size_t owner = t % numPeers;
+    const std::string &pUuid = peers[owner]->pUuid;
+    publishers[owner].emplace_back("/scale/topic" + std::to_string(t),
+      "tcp://127.0.0.1:" + std::to_string(20000 + owner),
+      "tcp://127.0.0.1:" + std::to_string(40000 + owner), pUuid,
+      Uuid().ToString(), "ignition.msgs.Int32", AdvertiseMessageOptions());
+  }
+
+  const uint64_t datagramsBefore =
+    discoveryCounter("ign_transport_discovery_datagrams_received");
+  const uint64_t msgsBefore =
+    discoveryCounter("ign_transport_discovery_messages_received");
+  const uint64_t cpuBefore =
+    discoveryCounter("ign_transport_discovery_dispatch_cpu_nanoseconds");
+  const auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < numPeers; ++i)
+  {
+    peers[i]->discovery->Start();
+    std::vector<bool> advertised;
+    EXPECT_TRUE(peers[i]->discovery->Advertise(publishers[i], advertised));
+
+    // The peers of a deployment don't all start at once.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  // Every peer knows the topics of the others.
+  bool converged = false;
+  while (!converged && std::chrono::steady_clock::now() - start < kTimeout)
+  {
+    // The announcements are counted first, the topics are only listed
+    // once there are enough of them.
+    converged = true;
+    for (std::size_t i = 0; i < numPeers && converged; ++i)
+    {
+      Peer &peer = *peers[i];
+      if (!peer.converged &&
+          peer.known >= numTopics - publishers[i].size())
+      {
+        std::vector<std::string> topics;
+        peer.discovery->TopicList(topics);
+        peer.converged = topics.size() == numTopics;
+      }
+      converged = peer.converged;
+    }
+    if (!converged)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  if (!converged)
+  {
+    std::size_t convergedPeers = 0;
+    std::size_t missing = 0;
+    for (std::size_t i = 0; i < numPeers; ++i)
+    {
+      const Peer &peer = *peers[i];
+      const std::size_t remote = numTopics - publishers[i].size();
+      convergedPeers += peer.converged ? 1 : 0;
+      if (!peer.converged && peer.known < remote)
+        missing += remote - peer.known;
+    }
+    std::cout << "Converged peers: " << convergedPeers << "/" << numPeers
+              << ", announcements missing: " << missing << std::endl;
+  }
+  EXPECT_TRUE(converged);
+
+  const double seconds =
+    std::chrono::duration<double>(elapsed).count();
+  const uint64_t datagrams =
+    discoveryCounter("ign_transport_discovery_datagrams_received") -
+    datagramsBefore;
+  const uint64_t msgs =
+    discoveryCounter("ign_transport_discovery_messages_received") -
+    msgsBefore;
+  const uint64_t cpu =
+    discoveryCounter("ign_transport_discovery_dispatch_cpu_nanoseconds") -
+    cpuBefore;
+  const int64_t peerBytes = g_liveBytes - bytesBefore;
+
+  // The state of the network, as stored by each peer.
+  const int64_t storageBefore = g_liveBytes;
+  {
+    TopicStorage<MessagePublisher> storage;
+    for (const auto &peerPublishers : publishers)
+    {
+      for (const auto &publisher : peerPublishers)
+        storage.AddPublisher(publisher);
+    }
+    const int64_t storageBytes = g_liveBytes - storageBefore;
+
+    std::cout << "Peers: " << numPeers << ", topics: " << numTopics
+              << std::endl
+              << "Convergence: " << seconds << " s" << std::endl
+              << "Datagrams received: " << datagrams << " ("
+              << static_cast<double>(datagrams) / seconds << "/s), messages: "
+              << msgs << " (" << static_cast<double>(msgs) / seconds
+              << "/s)" << std::endl
+              << "CPU handling the datagrams: "
+              << static_cast<double>(cpu) * 1e-9 << " s, "
+              << (msgs ? static_cast<double>(cpu) / msgs : 0.0)
+              << " ns/message" << std::endl
+              << "TopicStorage of the network: " << storageBytes
+              << " bytes, "
+              << (numTopics ?
+                  static_cast<double>(storageBytes) / numTopics : 0.0)
+              << " bytes/topic" << std::endl
+              << "Memory: "
+              << static_cast<double>(peerBytes) / numPeers
+              << " bytes/peer" << std::endl;
+  }
+
+  peers.clear();
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/HandlerStorage.hh"
+#include "ignition/transport/Uuid.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Number of topics, our simulation scale.
+static const std::size_t kNumTopics = 10000;
+
+/// \brief Number of nodes subscribed to each topic.
+static const std::size_t kNumNodes = 100;
+
+/// \brief Minimal handler stored in the benchmarked containers.
+class BenchHandler
+{
+  /// \brief Constructor.
+  public: BenchHandler()
+    : hUuid(Uuid().ToString())
+  {
+  }
+
+  /// \brief Handler UUID.
+  /// \return The handler UUID.
+  public: std::string HandlerUuid() const
+  {
+    return this->hUuid;
+  }
+
+  /// \brief Message type.
+  /// \return The message type.
+  public: std::string TypeName() const
+  {
+    return "ignition.msgs.Int32";
+  }
+
+  /// \brief Handler UUID.
+  private: std::string hUuid;
+};
+
+/// \brief The layout used by HandlerStorage before: three levels of
+/// std::map keyed by strings.
+using NestedMap_M = std::map<std::string, std::map<std::string,
+  std::map<std::string, std::shared_ptr<BenchHandler>>>>;
+
+/// \brief Topics, node UUIDs and handlers of the benchmark.
+struct Fixture
+{
+  /// \brief Topic names.
+  std::vector<std::string> topics;
+
+  /// \brief Node UUIDs.
+  std::vector<std::string> nodes;
+
+  /// \brief Node UUIDs in binary format.
+  std::vector<CompactUuid> nodeKeys;
+
+  /// \brief Handler UUIDs in binary format.
+  std::vector<CompactUuid> handlerKeys;
+
+  /// \brief Handler of each (topic, node) pair.
+  std::vector<std::shared_ptr<BenchHandler>> handlers;
+};
+
+//////////////////////////////////////////////////
+/// \brief Run a function and report how long it took per operation.
+/// \param[in] _name Name of the measurement.
+/// \param[in] _ops Number of operations run by _f.
+/// \param[in] _f The function.
+static void Measure(const std::string &_name, const std::size_t _ops,
+  const std::function<void()> &_f)
+{
+  auto start = std::chrono::steady_clock::now();
+  _f();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  const double ns = static_cast<double>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  std::cout << "  " << _name << ": " << ns / 1e6 << " ms total, "
+            << ns / static_cast<double>(_ops) << " ns/op" << std::endl;
+}
+
+//////////////////////////////////////////////////
+/// \brief Lookup and iteration cost of HandlerStorage compared to nested
+/// std::map containers, at 10k topics x 100 nodes.
+TEST(HandlerStoragePerformance, LookupAndIteration)
+{
+  Fixture f;
+  for (std::size_t i = 0; i < kNumTopics; ++i)
+    f.topics.push_back("/@/world/default/model/" + std::to_string(i));
+  for (std::size_t i = 0; i < kNumNodes; ++i)
+    f.nodes.push_back(Uuid().ToString());
+  for (std::size_t i = 0; i < kNumTopics * kNumNodes; ++i)
+    f.handlers.push_back(std::make_shared<BenchHandler>());
+  for (const std::string &node : f.nodes)
+    f.nodeKeys.emplace_back(node);
+  for (const auto &handler : f.handlers)
+    f.handlerKeys.emplace_back(handler->HandlerUuid());
+
+  const std::size_t numHandlers = f.handlers.size();
+  const std::size_t numLookups = numHandlers;
+
+  HandlerStorage<BenchHandler> storage;
+  NestedMap_M nested;
+
+  std::cout << "Insertion" << std::endl;
+  Measure("HandlerStorage", numHandlers, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+        storage.AddHandler(f.topics[t], f.nodes[n],
+          f.handlers[t * kNumNodes + n]);
+  });
+  Measure("nested std::map", numHandlers, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+    {
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+      {
+        auto &handler = f.handlers[t * kNumNodes + n];
+        nested[f.topics[t]][f.nodes[n]][handler->HandlerUuid()] = handler;
+      }
+    }
+  });
+
+  // Look up every handler by topic, node UUID and handler UUID.
+  std::size_t found = 0;
+  std::cout << "Lookup by topic, node and handler UUID" << std::endl;
+  Measure("HandlerStorage", numLookups, [&]()
+  {
+    std::shared_ptr<BenchHandler> handler;
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+    {
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+      {
+        found += storage.Handler(f.topics[t], f.nodes[n],
+          f.handlers[t * kNumNodes + n]->HandlerUuid(), handler);
+      }
+    }
+  });
+  EXPECT_EQ(numLookups, found);
+
+  found = 0;
+  Measure("HandlerStorage, binary UUIDs", numLookups, [&]()
+  {
+    std::shared_ptr<BenchHandler> handler;
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+    {
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+      {
+        found += storage.Handler(f.topics[t], f.nodeKeys[n],
+          f.handlerKeys[t * kNumNodes + n], handler);
+      }
+    }
+  });
+  EXPECT_EQ(numLookups, found);
+
+  found = 0;
+  Measure("nested std::map", numLookups, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+    {
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+      {
+        auto topicIt = nested.find(f.topics[t]);
+        auto nodeIt = topicIt->second.find(f.nodes[n]);
+        found += nodeIt->second.count(
+          f.handlers[t * kNumNodes + n]->HandlerUuid());
+      }
+    }
+  });
+  EXPECT_EQ(numLookups, found);
+
+  // Check whether each node has handlers for each topic.
+  found = 0;
+  std::cout << "HasHandlersForNode" << std::endl;
+  Measure("HandlerStorage", numLookups, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+        found += storage.HasHandlersForNode(f.topics[t], f.nodes[n]);
+  });
+  EXPECT_EQ(numLookups, found);
+
+  found = 0;
+  Measure("HandlerStorage, binary UUIDs", numLookups, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+        found += storage.HasHandlersForNode(f.topics[t], f.nodeKeys[n]);
+  });
+  EXPECT_EQ(numLookups, found);
+
+  found = 0;
+  Measure("nested std::map", numLookups, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+        found += nested.find(f.topics[t])->second.count(f.nodes[n]);
+  });
+  EXPECT_EQ(numLookups, found);
+
+  // Find the first handler of a type, which iterates over the handlers of
+  // a topic. The type never matches, so every handler is visited.
+  found = 0;
+  std::cout << "Iteration over the handlers of each topic" << std::endl;
+  Measure("HandlerStorage", numHandlers, [&]()
+  {
+    std::shared_ptr<BenchHandler> handler;
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+      found += storage.FirstHandler(f.topics[t], "unknown", handler);
+  });
+  EXPECT_EQ(0u, found);
+
+  Measure("nested std::map", numHandlers, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+    {
+      for (const auto &node : nested.find(f.topics[t])->second)
+      {
+        for (const auto &handler : node.second)
+          found += handler.second->TypeName() == "unknown";
+      }
+    }
+  });
+  EXPECT_EQ(0u, found);
+
+  // Remove all the handlers, node by node.
+  std::cout << "Removal" << std::endl;
+  Measure("HandlerStorage", numHandlers, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+        storage.RemoveHandlersForNode(f.topics[t], f.nodes[n]);
+  });
+  Measure("nested std::map", numHandlers, [&]()
+  {
+    for (std::size_t t = 0; t < kNumTopics; ++t)
+    {
+      auto topicIt = nested.find(f.topics[t]);
+      for (std::size_t n = 0; n < kNumNodes; ++n)
+        topicIt->second.erase(f.nodes[n]);
+      nested.erase(topicIt);
+    }
+  });
+
+  for (const std::string &topic : f.topics)
+    EXPECT_FALSE(storage.HasHandlersForTopic(topic));
+  EXPECT_TRUE(nested.empty());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/NodeOptions.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Number of nodes, one per entity of a large simulation.
+static const std::size_t kNumNodes = 10000;
+
+/// \brief Bytes allocated by this process.
+static std::atomic<uint64_t> g_allocatedBytes{0};
+
+//////////////////////////////////////////////////
+void *operator new(std::size_t _size)
+{
+  g_allocatedBytes.fetch_add(_size, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(_size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr, std::size_t) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+/// \brief Time and memory allocated to create many nodes sharing the same
+/// options.
+TEST(NodePerformance, Construction)
+{
+  NodeOptions opts;
+  opts.SetNameSpace("world");
+
+  // The first node creates the shared node of the process.
+  auto first = std::make_unique<Node>(opts);
+
+  std::vector<std::unique_ptr<Node>> nodes;
+  nodes.reserve(kNumNodes);
+
+  const uint64_t bytesBefore = g_allocatedBytes;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kNumNodes; ++i)
+    nodes.push_back(std::make_unique<Node>(opts));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  const uint64_t bytes = g_allocatedBytes - bytesBefore;
+
+  const double ns = static_cast<double>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  std::cout << "Construction: " << ns / static_cast<double>(kNumNodes)
+            << " ns/node, "
+            << static_cast<double>(bytes) / static_cast<double>(kNumNodes)
+            << " bytes allocated/node" << std::endl;
+
+  for (const auto &node : nodes)
+    EXPECT_EQ("world", node->Options().NameSpace());
+
+  start = std::chrono::steady_clock::now();
+  nodes.clear();
+  elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "Destruction: "
+            << static_cast<double>(
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   elapsed).count()) / static_cast<double>(kNumNodes)
+            << " ns/node" << std::endl;
+}
@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <ignition/msgs/int32.pb.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/MetricsRegistry.hh"
+#include "ignition/transport/Node.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+// The benchmark starts every process of a fleet at once, each of them
+// advertising its own topics and subscribing to a topic of the next one,
+// and measures how long each process takes, from the start of its main, to
+// receive its first message and to discover every topic of the fleet. The
+// processes are this executable, run again with IGN_STARTUP_STORM_PEER set
+// to their index, and report their results through a pipe. The scale is set
+// with the IGN_STARTUP_STORM_PROCESSES and IGN_STARTUP_STORM_TOPICS
+// environment variables, e.g. 300 and 20 for a large fleet. The discovery
+// uses the multicast group of the host, so the fleet runs in a partition of
+// its own.
+
+/// \brief Default number of processes.
+static const std::size_t kDefaultProcesses = 20;
+
+/// \brief Default number of topics advertised by each process.
+static const std::size_t kDefaultTopics = 10;
+
+/// \brief Longest wait for the processes to report.
+static const std::chrono::seconds kTimeout(60);
+
+/// \brief Period of the messages published by each process.
+static const std::chrono::milliseconds kPublishPeriod(50);
+
+/// \brief Environment variable with the index of a peer process.
+static const char kPeerEnv[] = "IGN_STARTUP_STORM_PEER";
+
+/// \brief Environment variable with the file descriptor of the pipe.
+static const char kFdEnv[] = "IGN_STARTUP_STORM_FD";
+
+/// \brief Environment variable with the steady time, in nanoseconds, at
+/// which a peer process was launched.
+static const char kLaunchEnv[] = "IGN_STARTUP_STORM_LAUNCH";
+
+/// \brief The results of a peer process, in microseconds since its main,
+/// -1 if the event didn't happen.
+struct PeerResult
+{
+  /// \brief Index of the process.
+  std::size_t index = 0;
+
+  /// \brief Time from the launch to the start of main.
+  int64_t mainUs = -1;
+
+  /// \brief Time to the first message received.
+  int64_t firstMsgUs = -1;
+
+  /// \brief Time to the discovery of every topic.
+  int64_t discoveryUs = -1;
+
+  /// \brief Discovery datagrams sent to the multicast group.
+  uint64_t multicastSent = 0;
+
+  /// \brief Discovery datagrams received.
+  uint64_t datagramsReceived = 0;
+};
+
+//////////////////////////////////////////////////
+/// \brief Get a size from an environment variable.
+/// \param[in] _name Name of the variable.
+/// \param[in] _default Value when the variable isn't set.
+/// \return The size.
+static std::size_t sizeFromEnv(const std::string &_name,
+    const std::size_t _default)
+{
+  std::string value;
+  if (!env(_name, value) || value.empty())
+    return _default;
+  return static_cast<std::size_t>(std::stoull(value));
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the value of a counter of the message discovery.
+/// \param[in] _name Name of the counter.
+/// \return The value.
+static uint64_t discoveryCounter(const std::string &_name)
+{
+  return MetricsRegistry::Instance().Counter(_name, "",
+    {{"discovery", "msg"}}).Value();
+}
+
+//////////////////////////////////////////////////
+/// \brief Name of a topic of the fleet.
+/// \param[in] _process Index of the process advertising it.
+/// \param[in] _topic Index of the topic in the process.
+/// \return The name.
+static std::string topicName(const std::size_t _process,
+    const std::size_t _topic)
+{
+  return "/storm/p" + std::to_string(_process) + "/t" +
+    std::to_string(_topic);
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the steady time.
+/// \return Nanoseconds since the epoch of the steady clock.
+static int64_t steadyNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//////////////////////////////////////////////////
+/// \brief Percentile of sorted values.
+/// \param[in] _values The values, sorted.
+/// \param[in] _p The percentile, in [0, 1].
+/// \return The value, zero if there are none.
+static int64_t percentile(const std::vector<int64_t> &_values,
+    const double _p)
+{
+  if (_values.empty())
+    return 0;
+  const auto i = static_cast<std::size_t>(_p * (_values.size() - 1));
+  return _values[i];
+}
+
+#ifndef _WIN32
+//////////////////////////////////////////////////
+/// \brief Body of a peer process. It reports once it received a message
+/// and discovered the fleet, or when the timeout expires, and then keeps
+/// publishing until it's killed, so the slower processes can still receive
+/// its messages.
+/// \param[in] _mainNs Steady time at the start of main.
+/// \return The exit status.
+static int runPeer(const int64_t _mainNs)
+{
+  const std::size_t index = sizeFromEnv(kPeerEnv, 0);
+  const std::size_t numProcesses =
+    sizeFromEnv("IGN_STARTUP_STORM_PROCESSES", kDefaultProcesses);
+  const std::size_t numTopics =
+    sizeFromEnv("IGN_STARTUP_STORM_TOPICS", kDefaultTopics);
+  const int fd = static_cast<int>(sizeFromEnv(kFdEnv, 0));
+  const int64_t launchNs =
+    static_cast<int64_t>(sizeFromEnv(kLaunchEnv, 0));
+
+  Node node;
+  std::vector<Node::Publisher> publishers;
+  for (std::size_t t = 0; t < numTopics; ++t)
+    publishers.push_back(node.Advertise<msgs::Int32>(topicName(index, t)));
+
+  std::atomic<int64_t> firstMsgNs{-1};
+  std::function<void(const msgs::Int32 &)> cb =
+    [&firstMsgNs](const msgs::Int32 &)
+    {
+      int64_t none = -1;
+      firstMsgNs.compare_exchange_strong(none, steadyNs());
+    };
+  node.Subscribe(topicName((index + 1) % numProcesses, 0), cb);
+
+  PeerResult result;
+  result.index = index;
+  result.mainUs = launchNs ? (_mainNs - launchNs) / 1000 : -1;
+
+  const std::size_t fleetTopics = numProcesses * numTopics;
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  bool reported = false;
+  msgs::Int32 msg;
+  while (std::chrono::steady_clock::now() < deadline + kTimeout)
+  {
+    for (auto &publisher : publishers)
+      publisher.Publish(msg);
+    msg.set_data(msg.data() + 1);
+
+    if (result.discoveryUs < 0)
+    {
+      std::vector<std::string> topics;
+      node.TopicList(topics);
+      const auto fleet = std::count_if(topics.begin(), topics.end(),
+        [](const std::string &_topic)
+        {
+          return _topic.compare(0, 7, "/storm/") == 0;
+        });
+      if (static_cast<std::size_t>(fleet) >= fleetTopics)
+        result.discoveryUs = (steadyNs() - _mainNs) / 1000;
+    }
+
+    const int64_t first = firstMsgNs;
+    if (first >= 0)
+      result.firstMsgUs = (first - _mainNs) / 1000;
+
+    const bool done = result.firstMsgUs >= 0 && result.discoveryUs >= 0;
+    if (!reported && (done || std::chrono::steady_clock::now() >= deadline))
+    {
+      result.multicastSent = discoveryCounter(
+        "ign_transport_discovery_multicast_datagrams_sent");
+      result.datagramsReceived = discoveryCounter(
+        "ign_transport_discovery_datagrams_received");
+
+      // A line shorter than PIPE_BUF, written at once.
+      std::ostringstream line;
+      line << result.index << " " << result.mainUs << " "
+           << result.firstMsgUs << " " << result.discoveryUs << " "
+           << result.multicastSent << " " << result.datagramsReceived
+           << "\n";
+      const std::string text = line.str();
+      if (write(fd, text.data(), text.size()) !=
+          static_cast<ssize_t>(text.size()))
+      {
+        std::cerr << "Unable to report the results of process " << index
+                  << std::endl;
+      }
+      close(fd);
+      reported = true;
+    }
+
+    std::this_thread::sleep_for(kPublishPeriod);
+  }
+  return 0;
+}
+
+//////////////////////////////////////////////////
+/// \brief Time for each process of a fleet started at once to receive its
+/// first message and to discover every topic, and the discovery traffic.
+TEST(StartupPerformance, Storm)
+{
+  const std::size_t numProcesses =
+    sizeFromEnv("IGN_STARTUP_STORM_PROCESSES", kDefaultProcesses);
+  const std::size_t numTopics =
+    sizeFromEnv("IGN_STARTUP_STORM_TOPICS", kDefaultTopics);
+  ASSERT_GT(numProcesses, 0u);
+  ASSERT_GT(numTopics, 0u);
+
+  // Each process opens several sockets, and the pipe is shared by all of
+  // them.
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+  {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  setenv("IGN_PARTITION",
+    ("storm" + std::to_string(getpid())).c_str(), 1);
+  setenv("IGN_STARTUP_STORM_PROCESSES",
+    std::to_string(numProcesses).c_str(), 1);
+  setenv("IGN_STARTUP_STORM_TOPICS", std::to_string(numTopics).c_str(), 1);
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  std::vector<pid_t> pids;
+  for (std::size_t i = 0; i < numProcesses; ++i)
+  {
+    const std::string launch = std::to_string(steadyNs());
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+      close(fds[0]);
+      setenv(kPeerEnv, std::to_string(i).c_str(), 1);
+      setenv(kFdEnv, std::to_string(fds[1]).c_str(), 1);
+      setenv(kLaunchEnv, launch.c_str(), 1);
+      execl("/proc/self/exe", "startupStorm", static_cast<char *>(nullptr));
+      _exit(127);
+    }
+    pids.push_back(pid);
+  }
+  close(fds[1]);
+
+  // The lines of the processes, each written at once.
+  std::vector<PeerResult> results;
+  std::string pending;
+  const auto deadline =
+    std::chrono::steady_clock::now() + kTimeout + std::chrono::seconds(10);
+  while (results.size() < numProcesses &&
+         std::chrono::steady_clock::now() < deadline)
+  {
+    pollfd pfd{fds[0], POLLIN, 0};
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+    char buffer[4096];
+    const ssize_t n = read(fds[0], buffer, sizeof(buffer));
+    if (n <= 0)
+      break;
+    pending.append(buffer, static_cast<std::size_t>(n));
+
+    std::size_t end;
+    while ((end = pending.find('\n')) != std::string::npos)
+    {
+      std::istringstream line(pending.substr(0, end));
+      pending.erase(0, end + 1);
+      PeerResult result;
+      if (line >> result.index >> result.mainUs >> result.firstMsgUs
+               >> result.discoveryUs >> result.multicastSent
+               >> result.datagramsReceived)
+      {
+        results.push_back(result);
+      }
+    }
+  }
+  close(fds[0]);
+
+  for (const pid_t pid : pids)
+    kill(pid, SIGTERM);
+  for (const pid_t pid : pids)
+    waitpid(pid, nullptr, 0);
+
+  EXPECT_EQ(numProcesses, results.size());
+
+  std::vector<int64_t> mainUs;
+  std::vector<int64_t> firstMsgUs;
+  std::vector<int64_t> discoveryUs;
+  uint64_t multicastSent = 0;
+  uint64_t datagramsReceived = 0;
+  std::sort(results.begin(), results.end(),
+    [](const PeerResult &_a, const PeerResult &_b)
+    {
+      return _a.index < _b.index;
+    });
+  std::cout << "process main_us first_msg_us discovery_us multicast_sent "
+            << "datagrams_received" << std::endl;
+  for (const PeerResult &result : results)
+  {
+    std::cout << result.index << " " << result.mainUs << " "
+              << result.firstMsgUs << " " << result.discoveryUs << " "
+              << result.multicastSent << " " << result.datagramsReceived
+              << std::endl;
+    EXPECT_GE(result.firstMsgUs, 0) << "Process " << result.index;
+    EXPECT_GE(result.discoveryUs, 0) << "Process " << result.index;
+    if (result.mainUs >= 0)
+      mainUs.push_back(result.mainUs);
+    if (result.firstMsgUs >= 0)
+      firstMsgUs.push_back(result.firstMsgUs);
+    if (result.discoveryUs >= 0)
+      discoveryUs.push_back(result.discoveryUs);
+    multicastSent += result.multicastSent;
+    datagramsReceived += result.datagramsReceived;
+  }
+  std::sort(mainUs.begin(), mainUs.end());
+  std::sort(firstMsgUs.begin(), firstMsgUs.end());
+  std::sort(discoveryUs.begin(), discoveryUs.end());
+
+  auto summary = [](const std::vector<int64_t> &_values)
+  {
+    std::ostringstream out;
+    out << "median " << percentile(_values, 0.5) * 1e-3 << " ms, p90 "
+        << percentile(_values, 0.9) * 1e-3 << " ms, max "
+        << percentile(_values, 1.0) * 1e-3 << " ms ("
+        << _values.size() << " processes)";
+    return out.str();
+  };
+  std::cout << "Processes: " << numProcesses << ", topics per process: "
+            << numTopics << std::endl
+            << "Launch to main: " << summary(mainUs) << std::endl
+            << "Main to first message: " << summary(firstMsgUs) << std::endl
+            << "Main to full discovery: " << summary(discoveryUs)
+            << std::endl
+            << "Multicast datagrams sent: " << multicastSent << " ("
+            << (results.empty() ? 0.0 :
+                static_cast<double>(multicastSent) / results.size())
+            << "/process)" << std::endl
+            << "Discovery datagrams received: " << datagramsReceived << " ("
+            << (results.empty() ? 0.0 :
+                static_cast<double>(datagramsReceived) / results.size())
+            << "/process)" << std::endl;
+}
+#else
+//////////////////////////////////////////////////
+TEST(StartupPerformance, Storm)
+{
+  GTEST_SKIP() << "The processes are launched with fork and exec";
+}
+#endif
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  const int64_t mainNs = steadyNs();
+#ifndef _WIN32
+  std::string peer;
+  if (env(kPeerEnv, peer) && !peer.empty())
+    return runPeer(mainNs);
+#else
+  (void)mainNs;
+#endif
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}